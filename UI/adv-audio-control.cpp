@@ -62,6 +62,8 @@ OBSAdvAudioCtrl::OBSAdvAudioCtrl(QGridLayout *, obs_source_t *source_)
 				 this);
 	syncOffsetSignal.Connect(handler, "audio_sync", OBSSourceSyncChanged,
 				 this);
+	filterLatencySignal.Connect(handler, "audio_filter_latency",
+				    OBSSourceFilterLatencyChanged, this);
 	flagsSignal.Connect(handler, "update_flags", OBSSourceFlagsChanged,
 			    this);
 	if (obs_audio_monitoring_available())
@@ -167,6 +169,8 @@ OBSAdvAudioCtrl::OBSAdvAudioCtrl(QGridLayout *, obs_source_t *source_)
 	syncOffset->setFixedWidth(100);
 	syncOffset->setAccessibleName(
 		QTStr("Basic.AdvAudio.SyncOffsetSource").arg(sourceName));
+	SourceFilterLatencyChanged(
+		(int64_t)obs_source_get_audio_filter_latency(source));
 
 	int idx;
 	if (obs_audio_monitoring_available()) {
@@ -330,6 +334,15 @@ void OBSAdvAudioCtrl::OBSSourceSyncChanged(void *param, calldata_t *calldata)
 				  "SourceSyncChanged", Q_ARG(int64_t, offset));
 }
 
+void OBSAdvAudioCtrl::OBSSourceFilterLatencyChanged(void *param,
+						     calldata_t *calldata)
+{
+	int64_t latency = calldata_int(calldata, "latency");
+	QMetaObject::invokeMethod(reinterpret_cast<OBSAdvAudioCtrl *>(param),
+				  "SourceFilterLatencyChanged",
+				  Q_ARG(int64_t, latency));
+}
+
 void OBSAdvAudioCtrl::OBSSourceMonitoringTypeChanged(void *param,
 						     calldata_t *calldata)
 {
@@ -413,6 +426,17 @@ void OBSAdvAudioCtrl::SourceSyncChanged(int64_t offset)
 	syncOffset->blockSignals(false);
 }
 
+void OBSAdvAudioCtrl::SourceFilterLatencyChanged(int64_t latency)
+{
+	/* already compensated for by libobs, this is only informational */
+	if (latency)
+		syncOffset->setToolTip(
+			QTStr("Basic.AdvAudio.SyncOffset.FilterLatency")
+				.arg(latency / NSEC_PER_MSEC));
+	else
+		syncOffset->setToolTip(QString());
+}
+
 void OBSAdvAudioCtrl::SourceMonitoringTypeChanged(int type)
 {
 	int idx = monitoringType->findData(type);
@@ -48,6 +48,7 @@ private:
 
 	OBSSignal volChangedSignal;
 	OBSSignal syncOffsetSignal;
+	OBSSignal filterLatencySignal;
 	OBSSignal flagsSignal;
 	OBSSignal monitoringTypeSignal;
 	OBSSignal mixersSignal;
@@ -63,6 +64,8 @@ private:
 	static void OBSSourceFlagsChanged(void *param, calldata_t *calldata);
 	static void OBSSourceVolumeChanged(void *param, calldata_t *calldata);
 	static void OBSSourceSyncChanged(void *param, calldata_t *calldata);
+	static void OBSSourceFilterLatencyChanged(void *param,
+						  calldata_t *calldata);
 	static void OBSSourceMonitoringTypeChanged(void *param,
 						   calldata_t *calldata);
 	static void OBSSourceMixersChanged(void *param, calldata_t *calldata);
@@ -84,6 +87,7 @@ public slots:
 	void SourceFlagsChanged(uint32_t flags);
 	void SourceVolumeChanged(float volume);
 	void SourceSyncChanged(int64_t offset);
+	void SourceFilterLatencyChanged(int64_t latency);
 	void SourceMonitoringTypeChanged(int type);
 	void SourceMixersChanged(uint32_t mixers);
 	void SourceBalanceChanged(int balance);
@@ -131,6 +131,8 @@ target_sources(
           auth-oauth.hpp
           auth-listener.cpp
           auth-listener.hpp
+          metrics-server.cpp
+          metrics-server.hpp
           obf.c
           obf.h
           obs-app-theming.cpp
@@ -164,6 +164,10 @@ void UpdateSourceComboToolbarProperties(QComboBox *combo, OBSSource source,
 	combo->blockSignals(true);
 
 	obs_property_t *p = obs_properties_get(props, prop_name);
+
+	/* toolbars have no placeholder state, fill deferred lists now */
+	obs_property_list_populate(p, source);
+
 	int cur_idx = FillPropertyCombo(combo, p, cur_id, is_int);
 
 	if (cur_idx == -1 || obs_property_list_item_disabled(p, cur_idx)) {
@@ -18,6 +18,7 @@
 #include <QMenu>
 #include <QUrl>
 #include <QDesktopServices>
+#include <QTimer>
 
 #include <obs.hpp>
 #include <obs-module.h>
@@ -188,6 +189,31 @@ ScriptsTool::ScriptsTool() : QDialog(nullptr), ui(new Ui_ScriptsTool)
 	ui->setupUi(this);
 	RefreshLists();
 
+	ui->budgetAction->addItem(
+		obs_module_text("ScriptPerformance.BudgetAction.Log"),
+		(int)OBS_SCRIPT_BUDGET_LOG);
+	ui->budgetAction->addItem(
+		obs_module_text("ScriptPerformance.BudgetAction.Defer"),
+		(int)OBS_SCRIPT_BUDGET_DEFER);
+	ui->budgetAction->addItem(
+		obs_module_text("ScriptPerformance.BudgetAction.Disable"),
+		(int)OBS_SCRIPT_BUDGET_DISABLE);
+
+	ui->frameBudget->setValue((double)obs_scripting_get_frame_budget() /
+				  1000000.0);
+	ui->budgetAction->setCurrentIndex(ui->budgetAction->findData(
+		(int)obs_scripting_get_budget_action()));
+
+	connect(ui->frameBudget, &QDoubleSpinBox::valueChanged, this,
+		&ScriptsTool::BudgetChanged);
+	connect(ui->budgetAction, &QComboBox::currentIndexChanged, this,
+		&ScriptsTool::BudgetChanged);
+
+	QTimer *statsTimer = new QTimer(this);
+	connect(statsTimer, &QTimer::timeout, this,
+		&ScriptsTool::UpdateScriptStats);
+	statsTimer->start(1000);
+
 #if PYTHON_UI
 	config_t *config = obs_frontend_get_global_config();
 	const char *path =
@@ -234,6 +260,51 @@ void ScriptsTool::updatePythonVersionLabel()
 	ui->pythonVersionLabel->setText(label);
 }
 
+void ScriptsTool::UpdateScriptStats()
+{
+	QListWidgetItem *item = ui->scripts->currentItem();
+	obs_script_t *script = nullptr;
+	struct obs_script_stats stats;
+
+	if (item) {
+		QByteArray path =
+			item->data(Qt::UserRole).toString().toUtf8();
+		script = scriptData->FindScript(path.constData());
+	}
+
+	if (!script || !obs_script_get_stats(script, &stats)) {
+		ui->scriptStats->clear();
+		return;
+	}
+
+	QString text =
+		QString(obs_module_text("ScriptPerformance.Stats"))
+			.arg((double)stats.last_frame_ns / 1000000.0, 0, 'f', 2)
+			.arg((double)stats.max_frame_ns / 1000000.0, 0, 'f', 2)
+			.arg(stats.calls)
+			.arg(stats.frames_over_budget);
+
+	if (stats.disabled) {
+		text += "\n";
+		text += obs_module_text("ScriptPerformance.Stats.Disabled");
+	}
+
+	ui->scriptStats->setText(text);
+}
+
+void ScriptsTool::BudgetChanged()
+{
+	double budget = ui->frameBudget->value();
+	int action = ui->budgetAction->currentData().toInt();
+
+	obs_scripting_set_frame_budget((uint64_t)(budget * 1000000.0),
+				       (enum obs_script_budget_action)action);
+
+	config_t *config = obs_frontend_get_global_config();
+	config_set_double(config, "scripts-tool", "FrameBudget", budget);
+	config_set_int(config, "scripts-tool", "BudgetAction", action);
+}
+
 void ScriptsTool::RemoveScript(const char *path)
 {
 	for (size_t i = 0; i < scriptData->scripts.size(); i++) {
@@ -514,6 +585,7 @@ void ScriptsTool::on_scripts_currentRowChanged(int row)
 					      QSizePolicy::Expanding);
 		ui->propertiesLayout->addWidget(propertiesView);
 		ui->description->setText(QString());
+		ui->scriptStats->clear();
 		return;
 	}
 
@@ -539,6 +611,8 @@ void ScriptsTool::on_scripts_currentRowChanged(int row)
 
 	ui->propertiesLayout->addWidget(propertiesView);
 	ui->description->setText(obs_script_get_description(script));
+
+	UpdateScriptStats();
 }
 
 void ScriptsTool::on_defaults_clicked()
@@ -681,6 +755,14 @@ extern "C" void InitScripts()
 	obs_scripting_load();
 	obs_scripting_set_log_callback(script_log, nullptr);
 
+	config_t *global_config = obs_frontend_get_global_config();
+	double budget =
+		config_get_double(global_config, "scripts-tool", "FrameBudget");
+	int action = (int)config_get_int(global_config, "scripts-tool",
+					 "BudgetAction");
+	obs_scripting_set_frame_budget((uint64_t)(budget * 1000000.0),
+				       (enum obs_script_budget_action)action);
+
 	QAction *action = (QAction *)obs_frontend_add_tools_menu_qaction(
 		obs_module_text("Scripts"));
 
@@ -32,6 +32,8 @@ class ScriptsTool : public QDialog {
 	QWidget *propertiesView = nullptr;
 
 	void updatePythonVersionLabel();
+	void UpdateScriptStats();
+	void BudgetChanged();
 
 public:
 	ScriptsTool();
@@ -0,0 +1,61 @@
+#include <metrics-server.hpp>
+
+#include <QtNetwork/QTcpSocket>
+
+#include <util/dstr.hpp>
+#include <util/metrics.h>
+
+#include "obs-app.hpp"
+
+MetricsServer::MetricsServer(quint16 port, QObject *parent) : QObject(parent)
+{
+	server = new QTcpServer(this);
+	connect(server, &QTcpServer::newConnection, this,
+		&MetricsServer::NewConnection);
+	if (!server->listen(QHostAddress::LocalHost, port)) {
+		blog(LOG_WARNING, "Metrics server could not listen on port %d",
+		     (int)port);
+	} else {
+		blog(LOG_INFO, "Metrics server started at port %d",
+		     server->serverPort());
+	}
+}
+
+quint16 MetricsServer::GetPort()
+{
+	return server ? server->serverPort() : 0;
+}
+
+void MetricsServer::NewConnection()
+{
+	QTcpSocket *socket;
+
+	while ((socket = server->nextPendingConnection()) != nullptr) {
+		connect(socket, &QTcpSocket::disconnected, socket,
+			&QTcpSocket::deleteLater);
+		connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+			/* every request gets the metrics, there is nothing
+			 * else to route to */
+			socket->readAll();
+
+			DStr body;
+			metrics_write_prometheus(body);
+
+			QByteArray response;
+			response.append("HTTP/1.0 200 OK\r\n"
+					"Connection: close\r\n"
+					"Content-Type: text/plain; "
+					"version=0.0.4; charset=utf-8\r\n"
+					"Server: OBS Studio\r\n");
+			response.append("Content-Length: ");
+			response.append(QByteArray::number(
+				(qulonglong)body->len));
+			response.append("\r\n\r\n");
+			if (body->len)
+				response.append(body->array, (int)body->len);
+
+			socket->write(response);
+			socket->disconnectFromHost();
+		});
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QObject>
+#include <QtNetwork/QTcpServer>
+
+/* Serves the libobs metrics registry in the Prometheus text format on the
+ * loopback interface. */
+class MetricsServer : public QObject {
+	Q_OBJECT
+
+	QTcpServer *server;
+
+protected:
+	void NewConnection();
+
+public:
+	explicit MetricsServer(quint16 port, QObject *parent = 0);
+	quint16 GetPort();
+};
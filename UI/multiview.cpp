@@ -19,6 +19,8 @@ Multiview::~Multiview()
 	}
 
 	obs_enter_graphics();
+	for (gs_texrender_t *thumbnail : thumbnails)
+		gs_texrender_destroy(thumbnail);
 	gs_vertexbuffer_destroy(actionSafeMargin);
 	gs_vertexbuffer_destroy(graphicsSafeMargin);
 	gs_vertexbuffer_destroy(fourByThreeSafeMargin);
@@ -65,11 +67,12 @@ static OBSSource CreateLabel(const char *name, size_t h)
 }
 
 void Multiview::Update(MultiviewLayout multiviewLayout, bool drawLabel,
-		       bool drawSafeArea)
+		       bool drawSafeArea, bool cacheThumbnails)
 {
 	this->multiviewLayout = multiviewLayout;
 	this->drawLabel = drawLabel;
 	this->drawSafeArea = drawSafeArea;
+	this->cacheThumbnails = cacheThumbnails;
 
 	multiviewScenes.clear();
 	multiviewLabels.clear();
@@ -212,6 +215,64 @@ static inline uint32_t labelOffset(MultiviewLayout multiviewLayout,
 	return (cx / 2) - w;
 }
 
+void Multiview::RenderThumbnail(size_t idx, obs_source_t *src, uint32_t cx,
+				uint32_t cy)
+{
+	if (thumbnails.size() <= idx)
+		thumbnails.resize(idx + 1, nullptr);
+
+	gs_texrender_t *&thumbnail = thumbnails[idx];
+	if (!thumbnail)
+		thumbnail = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	gs_texture_t *tex = gs_texrender_get_texture(thumbnail);
+	bool resized = !tex || gs_texture_get_width(tex) != cx ||
+		       gs_texture_get_height(tex) != cy;
+
+	// Stagger the updates so that only some scenes render each frame
+	if (!resized && (thumbnailFrame + idx) % thumbnailInterval != 0)
+		return;
+
+	gs_texrender_reset(thumbnail);
+	if (!gs_texrender_begin(thumbnail, cx, cy))
+		return;
+
+	struct vec4 clear_color;
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+	gs_ortho(0.0f, fw, 0.0f, fh, -100.0f, 100.0f);
+
+	obs_source_video_render(src);
+
+	gs_texrender_end(thumbnail);
+}
+
+void Multiview::DrawThumbnail(size_t idx)
+{
+	if (thumbnails.size() <= idx || !thumbnails[idx])
+		return;
+
+	gs_texture_t *tex = gs_texrender_get_texture(thumbnails[idx]);
+	if (!tex)
+		return;
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_effect_set_texture_srgb(image, tex);
+
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, (uint32_t)siCX, (uint32_t)siCY);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+}
+
 void Multiview::Render(uint32_t cx, uint32_t cy)
 {
 	OBSBasic *main = (OBSBasic *)obs_frontend_get_main_window();
@@ -422,13 +483,23 @@ void Multiview::Render(uint32_t cx, uint32_t cy)
 		/* ----------- */
 
 		// Render the source
-		gs_matrix_push();
-		gs_matrix_translate3f(siX, siY, 0.0f);
-		gs_matrix_scale3f(siScaleX, siScaleY, 1.0f);
-		setRegion(siX, siY, siCX, siCY);
-		obs_source_video_render(src);
-		endRegion();
-		gs_matrix_pop();
+		if (cacheThumbnails) {
+			RenderThumbnail(i, src, uint32_t(siCX * scale),
+					uint32_t(siCY * scale));
+
+			gs_matrix_push();
+			gs_matrix_translate3f(siX, siY, 0.0f);
+			DrawThumbnail(i);
+			gs_matrix_pop();
+		} else {
+			gs_matrix_push();
+			gs_matrix_translate3f(siX, siY, 0.0f);
+			gs_matrix_scale3f(siScaleX, siScaleY, 1.0f);
+			setRegion(siX, siY, siCX, siCY);
+			obs_source_video_render(src);
+			endRegion();
+			gs_matrix_pop();
+		}
 
 		/* ----------- */
 
@@ -453,6 +524,8 @@ void Multiview::Render(uint32_t cx, uint32_t cy)
 		gs_matrix_pop();
 	}
 
+	thumbnailFrame++;
+
 	if (multiviewLayout == MultiviewLayout::SCENES_ONLY_4_SCENES ||
 	    multiviewLayout == MultiviewLayout::SCENES_ONLY_9_SCENES ||
 	    multiviewLayout == MultiviewLayout::SCENES_ONLY_16_SCENES ||
@@ -21,12 +21,16 @@ public:
 	Multiview();
 	~Multiview();
 	void Update(MultiviewLayout multiviewLayout, bool drawLabel,
-		    bool drawSafeArea);
+		    bool drawSafeArea, bool cacheThumbnails);
 	void Render(uint32_t cx, uint32_t cy);
 	OBSSource GetSourceByPosition(int x, int y);
 
 private:
-	bool drawLabel, drawSafeArea;
+	void RenderThumbnail(size_t idx, obs_source_t *src, uint32_t cx,
+			     uint32_t cy);
+	void DrawThumbnail(size_t idx);
+
+	bool drawLabel, drawSafeArea, cacheThumbnails;
 	MultiviewLayout multiviewLayout;
 	size_t maxSrcs, numSrcs;
 	gs_vertbuffer_t *actionSafeMargin = nullptr;
@@ -39,6 +43,12 @@ private:
 	std::vector<OBSWeakSource> multiviewScenes;
 	std::vector<OBSSource> multiviewLabels;
 
+	// Scene thumbnails rendered at their displayed size, each one is
+	// only updated every few frames
+	std::vector<gs_texrender_t *> thumbnails;
+	uint64_t thumbnailFrame = 0;
+	static const uint64_t thumbnailInterval = 4;
+
 	// Multiview position helpers
 	float thickness = 4;
 	float offset, thicknessx2 = thickness * 2, pvwprgCX, pvwprgCY, sourceX,
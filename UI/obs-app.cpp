@@ -23,10 +23,14 @@
 #include <string>
 #include <sstream>
 #include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
 #include <util/bmem.h>
 #include <util/dstr.hpp>
 #include <util/platform.h>
 #include <util/profiler.hpp>
+#include <util/threading.h>
 #include <util/cf-parser.h>
 #include <obs-config.h>
 #include <obs.hpp>
@@ -291,14 +295,11 @@ string CurrentDateTimeString()
 static void LogString(fstream &logFile, const char *timeString, char *str,
 		      int log_level)
 {
-	static mutex logfile_mutex;
 	string msg;
 	msg += timeString;
 	msg += str;
 
-	logfile_mutex.lock();
-	logFile << msg << endl;
-	logfile_mutex.unlock();
+	logFile << msg << '\n';
 
 	if (!!obsLogViewer)
 		QMetaObject::invokeMethod(obsLogViewer.data(), "AddLine",
@@ -307,10 +308,11 @@ static void LogString(fstream &logFile, const char *timeString, char *str,
 					  Q_ARG(QString, QString(msg.c_str())));
 }
 
-static inline void LogStringChunk(fstream &logFile, char *str, int log_level)
+static inline void LogStringChunk(fstream &logFile, const char *time,
+				  char *str, int log_level)
 {
 	char *nextLine = str;
-	string timeString = CurrentTimeString();
+	string timeString = time;
 	timeString += ": ";
 
 	while (*nextLine) {
@@ -332,6 +334,140 @@ static inline void LogStringChunk(fstream &logFile, char *str, int log_level)
 	LogString(logFile, timeString.c_str(), str, log_level);
 }
 
+static void echo_log(int log_level, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	def_log_handler(log_level, format, args, nullptr);
+	va_end(args);
+}
+
+/* upper bound of log text waiting for the writer thread.  once it is reached
+ * new entries are dropped and counted instead of blocking the thread that
+ * logged */
+#define MAX_QUEUED_LOG_BYTES (4 * 1024 * 1024)
+
+struct LogEntry {
+	int log_level;
+	bool to_file;
+	bool echo;
+	string time;
+	string text;
+};
+
+/* Writes log entries to the log file on a thread of its own.  Messages are
+ * still formatted by the thread that logs them, since the format arguments
+ * are only valid for the duration of the call, but the file writes, console
+ * echo and log viewer updates all happen here. */
+class LogWriter {
+	fstream &logFile;
+
+	mutex queueMutex;
+	condition_variable wake;
+	condition_variable drained;
+	deque<LogEntry> entries;
+	size_t queuedBytes = 0;
+	size_t droppedEntries = 0;
+	bool writing = false;
+	bool stopping = false;
+
+	thread writer;
+
+	void Write(LogEntry &entry)
+	{
+		if (entry.echo)
+			echo_log(entry.log_level, "%s", entry.text.c_str());
+		if (entry.to_file)
+			LogStringChunk(logFile, entry.time.c_str(),
+				       &entry.text[0], entry.log_level);
+	}
+
+	void Run()
+	{
+		unique_lock<mutex> lock(queueMutex);
+
+		for (;;) {
+			wake.wait(lock, [this] {
+				return stopping || !entries.empty();
+			});
+			if (entries.empty())
+				break;
+
+			deque<LogEntry> batch;
+			batch.swap(entries);
+			size_t dropped = droppedEntries;
+			droppedEntries = 0;
+			queuedBytes = 0;
+			writing = true;
+
+			lock.unlock();
+
+			if (dropped)
+				logFile << CurrentTimeString()
+					<< ": Log writer fell behind, dropped "
+					<< to_string(dropped) << " log entries"
+					<< '\n';
+
+			for (LogEntry &entry : batch)
+				Write(entry);
+			logFile.flush();
+
+			lock.lock();
+			writing = false;
+			drained.notify_all();
+		}
+	}
+
+public:
+	inline LogWriter(fstream &logFile_) : logFile(logFile_)
+	{
+		writer = thread([this] { Run(); });
+	}
+
+	inline ~LogWriter()
+	{
+		{
+			lock_guard<mutex> lock(queueMutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		writer.join();
+	}
+
+	void Push(int log_level, const char *str, bool to_file, bool echo)
+	{
+		LogEntry entry = {log_level, to_file, echo, string(), str};
+		if (to_file)
+			entry.time = CurrentTimeString();
+
+		{
+			lock_guard<mutex> lock(queueMutex);
+			if (queuedBytes + entry.text.size() >
+			    MAX_QUEUED_LOG_BYTES) {
+				droppedEntries++;
+				return;
+			}
+
+			queuedBytes += entry.text.size();
+			entries.push_back(std::move(entry));
+		}
+
+		wake.notify_one();
+	}
+
+	/* waits for everything queued so far to be written, used when the
+	 * program is about to go down */
+	void Flush(chrono::milliseconds timeout)
+	{
+		unique_lock<mutex> lock(queueMutex);
+		drained.wait_for(lock, timeout, [this] {
+			return entries.empty() && !writing;
+		});
+	}
+};
+
+static unique_ptr<LogWriter> logWriter;
+
 #define MAX_REPEATED_LINES 30
 #define MAX_CHAR_VARIATION (255 * 3)
 
@@ -344,7 +480,7 @@ static inline int sum_chars(const char *str)
 	return val;
 }
 
-static inline bool too_many_repeated_entries(fstream &logFile, const char *msg,
+static inline bool too_many_repeated_entries(LogWriter &writer, const char *msg,
 					     const char *output_str)
 {
 	static mutex log_mutex;
@@ -369,10 +505,10 @@ static inline bool too_many_repeated_entries(fstream &logFile, const char *msg,
 	}
 
 	if (rep_count > MAX_REPEATED_LINES) {
-		logFile << CurrentTimeString()
-			<< ": Last log entry repeated for "
-			<< to_string(rep_count - MAX_REPEATED_LINES)
-			<< " more lines" << endl;
+		string repeated = "Last log entry repeated for " +
+				  to_string(rep_count - MAX_REPEATED_LINES) +
+				  " more lines";
+		writer.Push(LOG_INFO, repeated.c_str(), true, false);
 	}
 
 	last_msg_ptr = msg;
@@ -385,10 +521,10 @@ static inline bool too_many_repeated_entries(fstream &logFile, const char *msg,
 
 static void do_log(int log_level, const char *msg, va_list args, void *param)
 {
-	fstream &logFile = *static_cast<fstream *>(param);
+	LogWriter &writer = *static_cast<LogWriter *>(param);
 	char str[4096];
 
-#ifndef _WIN32
+#if !defined(_WIN32) && defined(_DEBUG)
 	va_list args2;
 	va_copy(args2, args);
 #endif
@@ -416,24 +552,26 @@ static void do_log(int log_level, const char *msg, va_list args, void *param)
 
 #if !defined(_WIN32) && defined(_DEBUG)
 	def_log_handler(log_level, msg, args2, nullptr);
+	va_end(args2);
 #endif
 
 	if (log_level <= LOG_INFO || log_verbose) {
 #if !defined(_WIN32) && !defined(_DEBUG)
-		def_log_handler(log_level, msg, args2, nullptr);
+		const bool echo = true;
+#else
+		const bool echo = false;
 #endif
-		if (!too_many_repeated_entries(logFile, msg, str))
-			LogStringChunk(logFile, str, log_level);
+		const bool to_file =
+			!too_many_repeated_entries(writer, msg, str);
+
+		if (to_file || echo)
+			writer.Push(log_level, str, to_file, echo);
 	}
 
 #if defined(_WIN32) && defined(OBS_DEBUGBREAK_ON_ERROR)
 	if (log_level <= LOG_ERROR && IsDebuggerPresent())
 		__debugbreak();
 #endif
-
-#ifndef _WIN32
-	va_end(args2);
-#endif
 }
 
 #define DEFAULT_LANG "en-US"
@@ -448,6 +586,14 @@ bool OBSApp::InitGlobalConfigDefaults()
 				true);
 
 	config_set_default_bool(globalConfig, "General", "ConfirmOnExit", true);
+	config_set_default_bool(globalConfig, "General", "DeferSourceLoading",
+				false);
+	config_set_default_uint(globalConfig, "General", "DisplayRenderDivisor",
+				1);
+
+	config_set_default_bool(globalConfig, "Metrics", "ServerEnabled",
+				false);
+	config_set_default_uint(globalConfig, "Metrics", "ServerPort", 9464);
 
 #if _WIN32
 	config_set_default_string(globalConfig, "Video", "Renderer",
@@ -514,6 +660,12 @@ bool OBSApp::InitGlobalConfigDefaults()
 	config_set_default_bool(globalConfig, "BasicWindow",
 				"MultiviewDrawAreas", true);
 
+	config_set_default_bool(globalConfig, "BasicWindow",
+				"MultiviewCacheThumbnails", false);
+
+	config_set_default_uint(globalConfig, "Audio", "AudioBufferingReduceMs",
+				30000);
+
 #ifdef _WIN32
 	config_set_default_bool(globalConfig, "Audio", "DisableAudioDucking",
 				true);
@@ -1876,7 +2028,8 @@ static void create_log_file(fstream &logFile)
 
 	if (logFile.is_open()) {
 		delete_oldest_file(false, "obs-studio/logs");
-		base_set_log_handler(do_log, &logFile);
+		logWriter = make_unique<LogWriter>(logFile);
+		base_set_log_handler(do_log, logWriter.get());
 	} else {
 		blog(LOG_ERROR, "Failed to open log file");
 	}
@@ -2253,6 +2406,9 @@ static void main_crash_handler(const char *format, va_list args,
 {
 	char *text = new char[MAX_CRASH_REPORT_SIZE];
 
+	if (logWriter)
+		logWriter->Flush(chrono::milliseconds(1000));
+
 	vsnprintf(text, MAX_CRASH_REPORT_SIZE, format, args);
 	text[MAX_CRASH_REPORT_SIZE - 1] = 0;
 
@@ -2983,6 +3139,9 @@ int main(int argc, char *argv[])
 		} else if (arg_is(argv[i], "--unfiltered_log", nullptr)) {
 			unfiltered_log = true;
 
+		} else if (arg_is(argv[i], "--profile-locks", nullptr)) {
+			os_mutex_profiling_set_enabled(true);
+
 		} else if (arg_is(argv[i], "--startstreaming", nullptr)) {
 			opt_start_streaming = true;
 
@@ -3049,6 +3208,7 @@ int main(int argc, char *argv[])
 				"--verbose: Make log more verbose.\n"
 				"--always-on-top: Start in 'always on top' mode.\n\n"
 				"--unfiltered_log: Make log unfiltered.\n\n"
+				"--profile-locks: Record wait and hold times of libobs mutexes.\n\n"
 				"--disable-updater: Disable built-in updater (Windows/Mac only)\n\n"
 				"--disable-missing-files-check: Disable the missing files dialog which can appear on startup.\n\n";
 
@@ -3114,7 +3274,17 @@ int main(int argc, char *argv[])
 
 	delete_safe_mode_sentinel();
 	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	for (int i = 0; bmem_tags_enabled() && i < BMEM_TAG_COUNT; i++) {
+		bmem_tag tag = (bmem_tag)i;
+		bmem_tag_usage usage;
+
+		if (bmem_get_tag_usage(tag, &usage) && usage.allocs)
+			blog(LOG_INFO, "    %s: %ld leaks, %lld bytes",
+			     bmem_tag_name(tag), usage.allocs,
+			     (long long)usage.bytes);
+	}
 	base_set_log_handler(nullptr, nullptr);
+	logWriter.reset();
 
 	if (restart || restart_safe) {
 		auto executable = arguments.takeFirst();
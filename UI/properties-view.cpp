@@ -24,6 +24,7 @@
 #include <QGroupBox>
 #include <QObject>
 #include <QDesktopServices>
+#include <QThreadPool>
 #include "double-slider.hpp"
 #include "slider-ignorewheel.hpp"
 #include "spinbox-ignorewheel.hpp"
@@ -90,6 +91,10 @@ Q_DECLARE_METATYPE(media_frames_per_second);
 
 void OBSPropertiesView::ReloadProperties()
 {
+	/* lists still being populated belong to the old properties */
+	propertiesGeneration++;
+	populatingLists.clear();
+
 	if (weakObj || rawObj) {
 		OBSObject strongObj = GetObject();
 		void *obj = strongObj ? strongObj.Get() : rawObj;
@@ -607,8 +612,79 @@ static QVariant from_obs_data_autoselect(obs_data_t *data, const char *name,
 		data, name, format);
 }
 
+QWidget *OBSPropertiesView::AddPopulatingList(obs_property_t *prop)
+{
+	QComboBox *combo = new QComboBox();
+	combo->addItem(QTStr("Basic.PropertiesWindow.Populating"));
+	combo->setEnabled(false);
+	combo->setToolTip(QT_UTF8(obs_property_long_description(prop)));
+
+	PopulateList(prop);
+	return combo;
+}
+
+void OBSPropertiesView::PopulateList(obs_property_t *prop)
+{
+	std::string name = obs_property_name(prop);
+	if (!populatingLists.insert(name).second)
+		return;
+
+	OBSObject strongObj = GetObject();
+	void *obj = strongObj ? strongObj.Get() : rawObj;
+
+	obs_property_list_job_t *job =
+		obs_property_list_populate_begin(prop, obj);
+	if (!job) {
+		populatingLists.erase(name);
+		return;
+	}
+
+	QPointer<OBSPropertiesView> view = this;
+	uint64_t generation = propertiesGeneration;
+
+	/* the strong reference keeps the object data that the populate
+	 * callback uses alive until it returns */
+	QThreadPool::globalInstance()->start([strongObj, job, view, generation,
+					      name]() {
+		obs_property_list_populate_run(job);
+
+		QMetaObject::invokeMethod(
+			QCoreApplication::instance(),
+			[job, view, generation, name]() {
+				if (view)
+					view->ListPopulated(job, generation,
+							    name);
+				else
+					obs_property_list_populate_end(job,
+								       nullptr);
+			},
+			Qt::QueuedConnection);
+	});
+}
+
+void OBSPropertiesView::ListPopulated(obs_property_list_job_t *job,
+				      uint64_t generation,
+				      const std::string &name)
+{
+	if (generation != propertiesGeneration) {
+		obs_property_list_populate_end(job, nullptr);
+		return;
+	}
+
+	populatingLists.erase(name);
+
+	obs_property_t *prop =
+		obs_properties_get(properties.get(), name.c_str());
+	obs_property_list_populate_end(job, prop);
+
+	RefreshProperties();
+}
+
 QWidget *OBSPropertiesView::AddList(obs_property_t *prop, bool &warning)
 {
+	if (obs_property_list_populating(prop))
+		return AddPopulatingList(prop);
+
 	const char *name = obs_property_name(prop);
 	obs_combo_type type = obs_property_list_type(prop);
 	obs_combo_format format = obs_property_list_format(prop);
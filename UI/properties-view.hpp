@@ -7,6 +7,7 @@
 #include <QPointer>
 #include <vector>
 #include <memory>
+#include <unordered_set>
 
 class QFormLayout;
 class OBSPropertiesView;
@@ -109,6 +110,8 @@ private:
 	bool deferUpdate;
 	bool enableDefer = true;
 	bool disableScrolling = false;
+	uint64_t propertiesGeneration = 0;
+	std::unordered_set<std::string> populatingLists;
 
 	template<typename Sender, typename SenderParent, typename... Args>
 	QWidget *NewWidget(obs_property_t *prop, Sender *widget,
@@ -122,6 +125,10 @@ private:
 	void AddFloat(obs_property_t *prop, QFormLayout *layout,
 		      QLabel **label);
 	QWidget *AddList(obs_property_t *prop, bool &warning);
+	QWidget *AddPopulatingList(obs_property_t *prop);
+	void PopulateList(obs_property_t *prop);
+	void ListPopulated(obs_property_list_job_t *job, uint64_t generation,
+			   const std::string &name);
 	void AddEditableList(obs_property_t *prop, QFormLayout *layout,
 			     QLabel *&label);
 	QWidget *AddButton(obs_property_t *prop);
@@ -1,6 +1,7 @@
 #include "qt-display.hpp"
 #include "qt-wrappers.hpp"
 #include "display-helpers.hpp"
+#include "obs-app.hpp"
 #include <QWindow>
 #include <QScreen>
 #include <QResizeEvent>
@@ -76,6 +77,8 @@ OBSQTDisplay::OBSQTDisplay(QWidget *parent, Qt::WindowFlags flags)
 		if (!visible) {
 #if !defined(_WIN32) && !defined(__APPLE__)
 			display = nullptr;
+#else
+			obs_display_set_visible(display, false);
 #endif
 			return;
 		}
@@ -83,6 +86,8 @@ OBSQTDisplay::OBSQTDisplay(QWidget *parent, Qt::WindowFlags flags)
 		if (!display) {
 			CreateDisplay();
 		} else {
+			obs_display_set_visible(display, true);
+
 			QSize size = GetPixelSize(this);
 			obs_display_resize(display, size.width(),
 					   size.height());
@@ -146,6 +151,12 @@ void OBSQTDisplay::CreateDisplay()
 
 	display = obs_display_create(&info, backgroundColor);
 
+	/* lets machines where nobody watches the preview spend less GPU time
+	 * on it, there is no settings UI for this */
+	uint32_t divisor = (uint32_t)config_get_uint(
+		App()->GlobalConfig(), "General", "DisplayRenderDivisor");
+	obs_display_set_render_divisor(display, divisor);
+
 	emit DisplayCreated(this);
 }
 
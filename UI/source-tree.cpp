@@ -8,6 +8,7 @@
 #include <obs-frontend-api.h>
 #include <obs.h>
 
+#include <algorithm>
 #include <string>
 
 #include <QLabel>
@@ -17,6 +18,7 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QMouseEvent>
+#include <QScrollBar>
 #include <QAccessible>
 
 #include <QStylePainter>
@@ -201,22 +203,10 @@ void SourceTreeItem::ReconnectSignals()
 
 	/* --------------------------------------------------------- */
 
-	auto removeItem = [](void *data, calldata_t *cd) {
+	auto removeScene = [](void *data, calldata_t *) {
 		SourceTreeItem *this_ =
 			reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem =
-			(obs_sceneitem_t *)calldata_ptr(cd, "item");
-		obs_scene_t *curScene =
-			(obs_scene_t *)calldata_ptr(cd, "scene");
-
-		if (curItem == this_->sceneitem) {
-			QMetaObject::invokeMethod(this_->tree, "Remove",
-						  Q_ARG(OBSSceneItem, curItem),
-						  Q_ARG(OBSScene, curScene));
-			curItem = nullptr;
-		}
-		if (!curItem)
-			QMetaObject::invokeMethod(this_, "Clear");
+		QMetaObject::invokeMethod(this_, "Clear");
 	};
 
 	auto itemVisible = [](void *data, calldata_t *cd) {
@@ -243,26 +233,6 @@ void SourceTreeItem::ReconnectSignals()
 						  Q_ARG(bool, locked));
 	};
 
-	auto itemSelect = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ =
-			reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem =
-			(obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "Select");
-	};
-
-	auto itemDeselect = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ =
-			reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem =
-			(obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "Deselect");
-	};
-
 	auto reorderGroup = [](void *data, calldata_t *) {
 		SourceTreeItem *this_ =
 			reinterpret_cast<SourceTreeItem *>(data);
@@ -273,12 +243,9 @@ void SourceTreeItem::ReconnectSignals()
 	obs_source_t *sceneSource = obs_scene_get_source(scene);
 	signal_handler_t *signal = obs_source_get_signal_handler(sceneSource);
 
-	sigs.emplace_back(signal, "remove", removeItem, this);
-	sigs.emplace_back(signal, "item_remove", removeItem, this);
+	sigs.emplace_back(signal, "remove", removeScene, this);
 	sigs.emplace_back(signal, "item_visible", itemVisible, this);
 	sigs.emplace_back(signal, "item_locked", itemLocked, this);
-	sigs.emplace_back(signal, "item_select", itemSelect, this);
-	sigs.emplace_back(signal, "item_deselect", itemDeselect, this);
 
 	if (obs_sceneitem_is_group(sceneitem)) {
 		obs_source_t *source = obs_sceneitem_get_source(sceneitem);
@@ -592,20 +559,6 @@ void SourceTreeItem::ExpandClicked(bool checked)
 		tree->GetStm()->CollapseGroup(sceneitem);
 }
 
-void SourceTreeItem::Select()
-{
-	tree->SelectItem(sceneitem, true);
-	OBSBasic::Get()->UpdateContextBarDeferred();
-	OBSBasic::Get()->UpdateEditMenu();
-}
-
-void SourceTreeItem::Deselect()
-{
-	tree->SelectItem(sceneitem, false);
-	OBSBasic::Get()->UpdateContextBarDeferred();
-	OBSBasic::Get()->UpdateEditMenu();
-}
-
 /* ========================================================================= */
 
 void SourceTreeModel::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
@@ -630,6 +583,8 @@ void SourceTreeModel::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
 
 void SourceTreeModel::Clear()
 {
+	sceneSigs.clear();
+
 	beginResetModel();
 	items.clear();
 	endResetModel();
@@ -637,6 +592,75 @@ void SourceTreeModel::Clear()
 	hasGroups = false;
 }
 
+void SourceTreeModel::ReconnectSceneSignals()
+{
+	auto removeItem = [](void *data, calldata_t *cd) {
+		SourceTreeModel *this_ =
+			reinterpret_cast<SourceTreeModel *>(data);
+		obs_sceneitem_t *item =
+			(obs_sceneitem_t *)calldata_ptr(cd, "item");
+		obs_scene_t *scene = (obs_scene_t *)calldata_ptr(cd, "scene");
+
+		QMetaObject::invokeMethod(this_->st, "Remove",
+					  Q_ARG(OBSSceneItem, item),
+					  Q_ARG(OBSScene, scene));
+	};
+
+	auto itemSelect = [](void *data, calldata_t *cd) {
+		SourceTreeModel *this_ =
+			reinterpret_cast<SourceTreeModel *>(data);
+		obs_sceneitem_t *item =
+			(obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+		QMetaObject::invokeMethod(this_->st, "ItemSelected",
+					  Q_ARG(OBSSceneItem, item),
+					  Q_ARG(bool, true));
+	};
+
+	auto itemDeselect = [](void *data, calldata_t *cd) {
+		SourceTreeModel *this_ =
+			reinterpret_cast<SourceTreeModel *>(data);
+		obs_sceneitem_t *item =
+			(obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+		QMetaObject::invokeMethod(this_->st, "ItemSelected",
+					  Q_ARG(OBSSceneItem, item),
+					  Q_ARG(bool, false));
+	};
+
+	auto connectScene = [&](obs_scene_t *scene) {
+		obs_source_t *source = obs_scene_get_source(scene);
+		signal_handler_t *signal =
+			obs_source_get_signal_handler(source);
+
+		sceneSigs.emplace_back(signal, "item_remove", removeItem, this);
+		sceneSigs.emplace_back(signal, "item_select", itemSelect, this);
+		sceneSigs.emplace_back(signal, "item_deselect", itemDeselect,
+				       this);
+	};
+
+	using connectScene_t = decltype(connectScene);
+
+	auto connectGroup = [](obs_scene_t *, obs_sceneitem_t *item,
+			       void *param) {
+		if (obs_sceneitem_is_group(item)) {
+			obs_scene_t *scene =
+				obs_sceneitem_group_get_scene(item);
+			(*reinterpret_cast<connectScene_t *>(param))(scene);
+		}
+		return true;
+	};
+
+	sceneSigs.clear();
+
+	OBSScene scene = GetCurrentScene();
+	if (!scene)
+		return;
+
+	connectScene(scene);
+	obs_scene_enum_items(scene, connectGroup, &connectScene);
+}
+
 static bool enumItem(obs_scene_t *, obs_sceneitem_t *item, void *ptr)
 {
 	QVector<OBSSceneItem> &items =
@@ -673,6 +697,8 @@ void SourceTreeModel::SceneChanged()
 	obs_scene_enum_items(scene, enumItem, &items);
 	endResetModel();
 
+	ReconnectSceneSignals();
+
 	UpdateGroupState(false);
 	st->ResetWidgets();
 
@@ -781,8 +807,6 @@ void SourceTreeModel::Add(obs_sceneitem_t *item)
 		beginInsertRows(QModelIndex(), 0, 0);
 		items.insert(0, item);
 		endInsertRows();
-
-		st->UpdateWidget(createIndex(0, 0, nullptr), item);
 	}
 }
 
@@ -822,8 +846,10 @@ void SourceTreeModel::Remove(obs_sceneitem_t *item)
 	items.remove(idx, endIdx - startIdx + 1);
 	endRemoveRows();
 
-	if (is_group)
+	if (is_group) {
+		ReconnectSceneSignals();
 		UpdateGroupState(true);
+	}
 
 	OBSBasic::Get()->UpdateContextBarDeferred();
 }
@@ -905,7 +931,7 @@ void SourceTreeModel::AddGroup()
 	items.insert(0, group);
 	endInsertRows();
 
-	st->UpdateWidget(createIndex(0, 0, nullptr), group);
+	ReconnectSceneSignals();
 	UpdateGroupState(true);
 
 	QMetaObject::invokeMethod(st, "Edit", Qt::QueuedConnection,
@@ -1067,6 +1093,17 @@ SourceTree::SourceTree(QWidget *parent_) : QListView(parent_)
 	connect(App(), &OBSApp::StyleChanged, this, &SourceTree::UpdateIcons);
 
 	setItemDelegate(new SourceTreeDelegate(this));
+
+	connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+		&SourceTree::QueueUpdateVisibleWidgets);
+	connect(stm_, &QAbstractItemModel::rowsInserted, this,
+		&SourceTree::QueueUpdateVisibleWidgets);
+	connect(stm_, &QAbstractItemModel::rowsRemoved, this,
+		&SourceTree::QueueUpdateVisibleWidgets);
+	connect(stm_, &QAbstractItemModel::rowsMoved, this,
+		&SourceTree::QueueUpdateVisibleWidgets);
+	connect(stm_, &QAbstractItemModel::modelReset, this,
+		&SourceTree::QueueUpdateVisibleWidgets);
 }
 
 void SourceTree::UpdateIcons()
@@ -1085,20 +1122,19 @@ void SourceTree::SetIconsVisible(bool visible)
 
 void SourceTree::ResetWidgets()
 {
-	OBSScene scene = GetCurrentScene();
-
 	SourceTreeModel *stm = GetStm();
 	stm->UpdateGroupState(false);
 
-	for (int i = 0; i < stm->items.count(); i++) {
-		QModelIndex index = stm->createIndex(i, 0, nullptr);
-		setIndexWidget(index, new SourceTreeItem(this, stm->items[i]));
-	}
+	/* the model reset removed all widgets, only the rows in view get
+	 * new ones */
+	UpdateVisibleWidgets();
 }
 
 void SourceTree::UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item)
 {
-	setIndexWidget(idx, new SourceTreeItem(this, item));
+	SourceTreeItem *widget = new SourceTreeItem(this, item);
+	rowHeight = std::max(rowHeight, widget->sizeHint().height());
+	setIndexWidget(idx, widget);
 }
 
 void SourceTree::UpdateWidgets(bool force)
@@ -1106,17 +1142,104 @@ void SourceTree::UpdateWidgets(bool force)
 	SourceTreeModel *stm = GetStm();
 
 	for (int i = 0; i < stm->items.size(); i++) {
-		obs_sceneitem_t *item = stm->items[i];
-		SourceTreeItem *widget = GetItemWidget(i);
+		QWidget *widget = indexWidget(stm->createIndex(i, 0));
+		if (widget)
+			reinterpret_cast<SourceTreeItem *>(widget)->Update(
+				force);
+	}
+
+	QueueUpdateVisibleWidgets();
+}
+
+SourceTreeItem *SourceTree::GetItemWidget(int idx)
+{
+	SourceTreeModel *stm = GetStm();
+	if (idx < 0 || idx >= stm->items.count())
+		return nullptr;
 
-		if (!widget) {
-			UpdateWidget(stm->createIndex(i, 0), item);
-		} else {
-			widget->Update(force);
+	QModelIndex index = stm->createIndex(idx, 0);
+	if (!indexWidget(index))
+		UpdateWidget(index, stm->items[idx]);
+
+	return reinterpret_cast<SourceTreeItem *>(indexWidget(index));
+}
+
+void SourceTree::QueueUpdateVisibleWidgets()
+{
+	if (visibleWidgetsPending)
+		return;
+
+	visibleWidgetsPending = true;
+	QMetaObject::invokeMethod(this, "UpdateVisibleWidgets",
+				  Qt::QueuedConnection);
+}
+
+/* creates widgets for the rows in view and a page around them, and deletes
+ * the ones that are far out of view, so large scenes only ever have a few
+ * dozen item widgets */
+void SourceTree::UpdateVisibleWidgets()
+{
+	SourceTreeModel *stm = GetStm();
+	int count = stm->items.count();
+
+	visibleWidgetsPending = false;
+
+	if (!count)
+		return;
+
+	/* the first widget sets the height of the rows without one */
+	if (!rowHeight) {
+		QModelIndex index = stm->createIndex(0, 0);
+		if (!indexWidget(index))
+			UpdateWidget(index, stm->items[0]);
+		doItemsLayout();
+	}
+
+	QRect rect = viewport()->rect();
+	int first = indexAt(rect.topLeft()).row();
+	int last = indexAt(rect.bottomLeft()).row();
+	if (first == -1)
+		first = 0;
+	if (last == -1)
+		last = count - 1;
+
+	int page = last - first + 1;
+	first = std::max(first - page, 0);
+	last = std::min(last + page, count - 1);
+
+	QItemSelectionModel *selection = selectionModel();
+
+	for (int i = 0; i < count; i++) {
+		QModelIndex index = stm->createIndex(i, 0);
+		SourceTreeItem *widget =
+			reinterpret_cast<SourceTreeItem *>(indexWidget(index));
+
+		if (i >= first && i <= last) {
+			if (!widget)
+				UpdateWidget(index, stm->items[i]);
+
+			/* selected and edited widgets may still be referenced,
+			 * by the color dialog for example */
+		} else if (widget && !widget->IsEditing() &&
+			   !selection->isSelected(index)) {
+			setIndexWidget(index, nullptr);
 		}
 	}
 }
 
+void SourceTree::ItemSelected(OBSSceneItem item, bool select)
+{
+	SelectItem(item, select);
+	OBSBasic::Get()->UpdateContextBarDeferred();
+	OBSBasic::Get()->UpdateEditMenu();
+}
+
+void SourceTree::resizeEvent(QResizeEvent *event)
+{
+	QListView::resizeEvent(event);
+	QueueUpdateVisibleWidgets();
+}
+
 void SourceTree::SelectItem(obs_sceneitem_t *sceneitem, bool select)
 {
 	SourceTreeModel *stm = GetStm();
@@ -1417,14 +1540,12 @@ void SourceTree::dropEvent(QDropEvent *event)
 					 orderList.size());
 	};
 
-	using updateScene_t = decltype(updateScene);
-
-	auto preUpdateScene = [](void *data, obs_scene_t *) {
-		(*reinterpret_cast<updateScene_t *>(data))();
-	};
-
+	/* moving items in and out of groups changes their transforms, the
+	 * update coalesces those into a single signal */
 	ignoreReorder = true;
-	obs_scene_atomic_update(scene, preUpdateScene, &updateScene);
+	obs_scene_begin_update(scene);
+	updateScene();
+	obs_scene_commit_update(scene);
 	ignoreReorder = false;
 
 	/* --------------------------------------- */
@@ -1524,8 +1645,7 @@ bool SourceTree::Edit(int row)
 		return false;
 
 	QModelIndex index = stm->createIndex(row, 0);
-	QWidget *widget = indexWidget(index);
-	SourceTreeItem *itemWidget = reinterpret_cast<SourceTreeItem *>(widget);
+	SourceTreeItem *itemWidget = GetItemWidget(row);
 	if (itemWidget->IsEditing()) {
 #ifdef __APPLE__
 		itemWidget->ExitEditMode(true);
@@ -1702,7 +1822,7 @@ QSize SourceTreeDelegate::sizeHint(const QStyleOptionViewItem &option,
 	QWidget *item = tree->indexWidget(index);
 
 	if (!item)
-		return (QSize(0, 0));
+		return QSize(option.widget->minimumWidth(), tree->RowHeight());
 
 	return (QSize(option.widget->minimumWidth(), item->height()));
 }
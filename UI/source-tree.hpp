@@ -82,9 +82,6 @@ private slots:
 	void LockedChanged(bool locked);
 
 	void ExpandClicked(bool checked);
-
-	void Select();
-	void Deselect();
 };
 
 class SourceTreeModel : public QAbstractListModel {
@@ -97,6 +94,13 @@ class SourceTreeModel : public QAbstractListModel {
 	QVector<OBSSceneItem> items;
 	bool hasGroups = false;
 
+	/* item_remove/select/deselect of the current scene and its groups,
+	 * connected here instead of in every item widget since widgets only
+	 * exist for the rows in view */
+	std::vector<OBSSignal> sceneSigs;
+
+	void ReconnectSceneSignals();
+
 	static void OBSFrontendEvent(enum obs_frontend_event event, void *ptr);
 	void Clear();
 	void SceneChanged();
@@ -143,11 +147,16 @@ class SourceTree : public QListView {
 
 	bool iconsVisible = true;
 
+	/* height of rows that don't have a widget yet */
+	int rowHeight = 0;
+	bool visibleWidgetsPending = false;
+
 	void UpdateNoSourcesMessage();
 
 	void ResetWidgets();
 	void UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item);
 	void UpdateWidgets(bool force = false);
+	void QueueUpdateVisibleWidgets();
 
 	inline SourceTreeModel *GetStm() const
 	{
@@ -155,11 +164,9 @@ class SourceTree : public QListView {
 	}
 
 public:
-	inline SourceTreeItem *GetItemWidget(int idx)
-	{
-		QWidget *widget = indexWidget(GetStm()->createIndex(idx, 0));
-		return reinterpret_cast<SourceTreeItem *>(widget);
-	}
+	/* creates the widget if the row is not in view */
+	SourceTreeItem *GetItemWidget(int idx);
+	inline int RowHeight() const { return rowHeight; }
 
 	explicit SourceTree(QWidget *parent = nullptr);
 
@@ -189,10 +196,15 @@ public slots:
 	bool Edit(int idx);
 	void NewGroupEdit(int idx);
 
+private slots:
+	void ItemSelected(OBSSceneItem item, bool select);
+	void UpdateVisibleWidgets();
+
 protected:
 	virtual void mouseDoubleClickEvent(QMouseEvent *event) override;
 	virtual void dropEvent(QDropEvent *event) override;
 	virtual void paintEvent(QPaintEvent *event) override;
+	virtual void resizeEvent(QResizeEvent *event) override;
 
 	virtual void
 	selectionChanged(const QItemSelection &selected,
@@ -1,8 +1,287 @@
 #include "undo-stack-obs.hpp"
 
 #include <util/util.hpp>
+#include <obs.hpp>
+
+#include <cstring>
 
 #define MAX_STACK_SIZE 5000
+#define MAX_STACK_BYTES (64 * 1024 * 1024)
+
+/* smaller states are stored as they are, diffing them isn't worth it */
+#define MIN_DIFF_SIZE 4096
+
+/* ------------------------------------------------------------------------- */
+/* obs_data diffs                                                            */
+
+/* A diff turns one obs_data object into another one:
+ *
+ *   set    - values that were added or changed, stored as they are
+ *   remove - names of values that were removed
+ *   patch  - diffs of objects that exist in both
+ *   items  - diffs of the elements of arrays that have the same length
+ *
+ * Redo data is stored as a diff against the undo data of the same entry, so
+ * moving one item of a large scene only stores the changed values twice. */
+
+static bool data_empty(obs_data_t *data)
+{
+	obs_data_item_t *item = obs_data_first(data);
+	bool empty = !item;
+	obs_data_item_release(&item);
+	return empty;
+}
+
+static bool values_equal(obs_data_item_t *a, obs_data_item_t *b)
+{
+	switch (obs_data_item_gettype(a)) {
+	case OBS_DATA_STRING:
+		return strcmp(obs_data_item_get_string(a),
+			      obs_data_item_get_string(b)) == 0;
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(a) != obs_data_item_numtype(b))
+			return false;
+		if (obs_data_item_numtype(a) == OBS_DATA_NUM_INT)
+			return obs_data_item_get_int(a) ==
+			       obs_data_item_get_int(b);
+		return obs_data_item_get_double(a) ==
+		       obs_data_item_get_double(b);
+	case OBS_DATA_BOOLEAN:
+		return obs_data_item_get_bool(a) == obs_data_item_get_bool(b);
+	case OBS_DATA_NULL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void set_value(obs_data_t *data, const char *name,
+		      obs_data_item_t *item)
+{
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		obs_data_set_string(data, name, obs_data_item_get_string(item));
+		break;
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT)
+			obs_data_set_int(data, name,
+					 obs_data_item_get_int(item));
+		else
+			obs_data_set_double(data, name,
+					    obs_data_item_get_double(item));
+		break;
+	case OBS_DATA_BOOLEAN:
+		obs_data_set_bool(data, name, obs_data_item_get_bool(item));
+		break;
+	case OBS_DATA_OBJECT: {
+		OBSDataAutoRelease obj = obs_data_item_get_obj(item);
+		obs_data_set_obj(data, name, obj);
+		break;
+	}
+	case OBS_DATA_ARRAY: {
+		OBSDataArrayAutoRelease array = obs_data_item_get_array(item);
+		obs_data_set_array(data, name, array);
+		break;
+	}
+	case OBS_DATA_NULL:
+		break;
+	}
+}
+
+static obs_data_t *diff_data(obs_data_t *base, obs_data_t *target);
+
+/* returns nullptr if the arrays can't be patched element by element */
+static obs_data_array_t *diff_array(obs_data_array_t *base,
+				    obs_data_array_t *target)
+{
+	size_t count = obs_data_array_count(target);
+	if (obs_data_array_count(base) != count)
+		return nullptr;
+
+	obs_data_array_t *diff = obs_data_array_create();
+	bool changed = false;
+
+	for (size_t i = 0; i < count; i++) {
+		OBSDataAutoRelease a = obs_data_array_item(base, i);
+		OBSDataAutoRelease b = obs_data_array_item(target, i);
+		OBSDataAutoRelease item_diff = diff_data(a, b);
+
+		if (!data_empty(item_diff))
+			changed = true;
+		obs_data_array_push_back(diff, item_diff);
+	}
+
+	/* an empty diff means the arrays are equal */
+	if (!changed) {
+		obs_data_array_release(diff);
+		diff = obs_data_array_create();
+	}
+	return diff;
+}
+
+static obs_data_t *diff_data(obs_data_t *base, obs_data_t *target)
+{
+	OBSDataAutoRelease set = obs_data_create();
+	OBSDataAutoRelease patch = obs_data_create();
+	OBSDataAutoRelease items = obs_data_create();
+	OBSDataArrayAutoRelease remove = obs_data_array_create();
+
+	obs_data_item_t *item = obs_data_first(target);
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		obs_data_item_t *old = obs_data_item_byname(base, name);
+		enum obs_data_type type = obs_data_item_gettype(item);
+
+		if (!old || obs_data_item_gettype(old) != type) {
+			set_value(set, name, item);
+
+		} else if (type == OBS_DATA_OBJECT) {
+			OBSDataAutoRelease a = obs_data_item_get_obj(old);
+			OBSDataAutoRelease b = obs_data_item_get_obj(item);
+			OBSDataAutoRelease obj_diff = diff_data(a, b);
+
+			if (!data_empty(obj_diff))
+				obs_data_set_obj(patch, name, obj_diff);
+
+		} else if (type == OBS_DATA_ARRAY) {
+			OBSDataArrayAutoRelease a =
+				obs_data_item_get_array(old);
+			OBSDataArrayAutoRelease b =
+				obs_data_item_get_array(item);
+			OBSDataArrayAutoRelease array_diff = diff_array(a, b);
+
+			if (!array_diff)
+				set_value(set, name, item);
+			else if (obs_data_array_count(array_diff))
+				obs_data_set_array(items, name, array_diff);
+
+		} else if (!values_equal(old, item)) {
+			set_value(set, name, item);
+		}
+
+		obs_data_item_release(&old);
+	}
+
+	item = obs_data_first(base);
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		obs_data_item_t *cur = obs_data_item_byname(target, name);
+
+		if (!cur) {
+			OBSDataAutoRelease entry = obs_data_create();
+			obs_data_set_string(entry, "name", name);
+			obs_data_array_push_back(remove, entry);
+		}
+
+		obs_data_item_release(&cur);
+	}
+
+	obs_data_t *diff = obs_data_create();
+	if (!data_empty(set))
+		obs_data_set_obj(diff, "set", set);
+	if (obs_data_array_count(remove))
+		obs_data_set_array(diff, "remove", remove);
+	if (!data_empty(patch))
+		obs_data_set_obj(diff, "patch", patch);
+	if (!data_empty(items))
+		obs_data_set_obj(diff, "items", items);
+	return diff;
+}
+
+static void apply_diff(obs_data_t *data, obs_data_t *diff)
+{
+	OBSDataAutoRelease set = obs_data_get_obj(diff, "set");
+	OBSDataArrayAutoRelease remove = obs_data_get_array(diff, "remove");
+	OBSDataAutoRelease patch = obs_data_get_obj(diff, "patch");
+	OBSDataAutoRelease items = obs_data_get_obj(diff, "items");
+	obs_data_item_t *item;
+
+	item = obs_data_first(set);
+	for (; item; obs_data_item_next(&item))
+		set_value(data, obs_data_item_get_name(item), item);
+
+	for (size_t i = 0; i < obs_data_array_count(remove); i++) {
+		OBSDataAutoRelease entry = obs_data_array_item(remove, i);
+		obs_data_erase(data, obs_data_get_string(entry, "name"));
+	}
+
+	item = obs_data_first(patch);
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		OBSDataAutoRelease obj = obs_data_get_obj(data, name);
+		OBSDataAutoRelease obj_diff = obs_data_item_get_obj(item);
+		apply_diff(obj, obj_diff);
+	}
+
+	item = obs_data_first(items);
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		OBSDataArrayAutoRelease array = obs_data_get_array(data, name);
+		OBSDataArrayAutoRelease array_diff =
+			obs_data_item_get_array(item);
+		size_t count = obs_data_array_count(array_diff);
+
+		for (size_t i = 0; i < count; i++) {
+			OBSDataAutoRelease elem = obs_data_array_item(array, i);
+			OBSDataAutoRelease elem_diff =
+				obs_data_array_item(array_diff, i);
+			apply_diff(elem, elem_diff);
+		}
+	}
+}
+
+static inline bool is_json_object(const std::string &str)
+{
+	size_t pos = str.find_first_not_of(" \t\r\n");
+	return pos != std::string::npos && str[pos] == '{';
+}
+
+size_t undo_stack::item_size(const undo_redo_t &item)
+{
+	return sizeof(item) + item.name.size() * sizeof(QChar) +
+	       item.undo_data.size() + item.redo_data.size();
+}
+
+void undo_stack::set_redo_data(undo_redo_t &item,
+			       const std::string &redo_data)
+{
+	item.redo_data = redo_data;
+	item.redo_is_diff = false;
+
+	if (item.undo_data.size() + redo_data.size() < MIN_DIFF_SIZE ||
+	    !is_json_object(item.undo_data) || !is_json_object(redo_data))
+		return;
+
+	OBSDataAutoRelease undo =
+		obs_data_create_from_json(item.undo_data.c_str());
+	OBSDataAutoRelease redo = obs_data_create_from_json(redo_data.c_str());
+	if (!undo || !redo)
+		return;
+
+	OBSDataAutoRelease diff = diff_data(undo, redo);
+	const char *json = obs_data_get_json(diff);
+
+	if (json && strlen(json) < redo_data.size()) {
+		item.redo_data = json;
+		item.redo_is_diff = true;
+	}
+}
+
+std::string undo_stack::get_redo_data(const undo_redo_t &item)
+{
+	if (!item.redo_is_diff)
+		return item.redo_data;
+
+	OBSDataAutoRelease data =
+		obs_data_create_from_json(item.undo_data.c_str());
+	OBSDataAutoRelease diff =
+		obs_data_create_from_json(item.redo_data.c_str());
+	apply_diff(data, diff);
+
+	return obs_data_get_json(data);
+}
+
+/* ------------------------------------------------------------------------- */
 
 undo_stack::undo_stack(ui_ptr ui) : ui(ui)
 {
@@ -21,6 +300,7 @@ void undo_stack::clear()
 {
 	undo_items.clear();
 	redo_items.clear();
+	stack_bytes = 0;
 	last_is_repeatable = false;
 
 	ui->actionMainUndo->setText(QTStr("Undo.Undo"));
@@ -39,7 +319,7 @@ void undo_stack::add_action(const QString &name, const undo_redo_cb &undo,
 		return;
 
 	while (undo_items.size() >= MAX_STACK_SIZE) {
-		undo_redo_t item = undo_items.back();
+		stack_bytes -= item_size(undo_items.back());
 		undo_items.pop_back();
 	}
 
@@ -48,16 +328,25 @@ void undo_stack::add_action(const QString &name, const undo_redo_cb &undo,
 	}
 
 	if (last_is_repeatable && repeatable && name == undo_items[0].name) {
+		stack_bytes -= item_size(undo_items[0]);
 		undo_items[0].redo = redo;
-		undo_items[0].redo_data = redo_data;
+		set_redo_data(undo_items[0], redo_data);
+		stack_bytes += item_size(undo_items[0]);
 		return;
 	}
 
-	undo_redo_t n = {name, undo_data, redo_data, undo, redo};
+	undo_redo_t n = {name, undo_data, std::string(), false, undo, redo};
+	set_redo_data(n, redo_data);
 
 	last_is_repeatable = repeatable;
-	undo_items.push_front(n);
 	clear_redo();
+	stack_bytes += item_size(n);
+	undo_items.push_front(std::move(n));
+
+	while (stack_bytes > MAX_STACK_BYTES && undo_items.size() > 1) {
+		stack_bytes -= item_size(undo_items.back());
+		undo_items.pop_back();
+	}
 
 	ui->actionMainUndo->setText(QTStr("Undo.Item.Undo").arg(name));
 	ui->actionMainUndo->setEnabled(true);
@@ -98,7 +387,7 @@ void undo_stack::redo()
 	last_is_repeatable = false;
 
 	undo_redo_t temp = redo_items.front();
-	temp.redo(temp.redo_data);
+	temp.redo(get_redo_data(temp));
 	undo_items.push_front(temp);
 	redo_items.pop_front();
 
@@ -161,5 +450,7 @@ void undo_stack::pop_disabled()
 
 void undo_stack::clear_redo()
 {
+	for (const undo_redo_t &item : redo_items)
+		stack_bytes -= item_size(item);
 	redo_items.clear();
 }
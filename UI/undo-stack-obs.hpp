@@ -21,7 +21,9 @@ class undo_stack : public QObject {
 	struct undo_redo_t {
 		QString name;
 		std::string undo_data;
+		/* full data, or an obs_data diff against undo_data */
 		std::string redo_data;
+		bool redo_is_diff;
 		undo_redo_cb undo;
 		undo_redo_cb redo;
 	};
@@ -29,6 +31,7 @@ class undo_stack : public QObject {
 	ui_ptr ui;
 	std::deque<undo_redo_t> undo_items;
 	std::deque<undo_redo_t> redo_items;
+	size_t stack_bytes = 0;
 	int disable_refs = 0;
 	bool enabled = true;
 	bool last_is_repeatable = false;
@@ -41,6 +44,11 @@ class undo_stack : public QObject {
 	void disable_internal();
 	void clear_redo();
 
+	static size_t item_size(const undo_redo_t &item);
+	static void set_redo_data(undo_redo_t &item,
+				  const std::string &redo_data);
+	static std::string get_redo_data(const undo_redo_t &item);
+
 private slots:
 	void reset_repeatable_state();
 
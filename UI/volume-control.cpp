@@ -64,7 +64,8 @@ static void ShowUnassignedWarning(const char *name)
 		if (cb->isChecked()) {
 			config_set_bool(App()->GlobalConfig(), "General",
 					"WarnedAboutUnassignedSources", true);
-			config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+			config_save_safe_deferred(App()->GlobalConfig(), "tmp",
+						  nullptr);
 		}
 	};
 
@@ -80,16 +81,6 @@ void VolControl::OBSVolumeChanged(void *data, float db)
 	QMetaObject::invokeMethod(volControl, "VolumeChanged");
 }
 
-void VolControl::OBSVolumeLevel(void *data,
-				const float magnitude[MAX_AUDIO_CHANNELS],
-				const float peak[MAX_AUDIO_CHANNELS],
-				const float inputPeak[MAX_AUDIO_CHANNELS])
-{
-	VolControl *volControl = static_cast<VolControl *>(data);
-
-	volControl->volMeter->setLevels(magnitude, peak, inputPeak);
-}
-
 void VolControl::OBSVolumeMuted(void *data, calldata_t *calldata)
 {
 	VolControl *volControl = static_cast<VolControl *>(data);
@@ -368,7 +359,6 @@ VolControl::VolControl(OBSSource source_, bool showConfig, bool vertical)
 	volMeter->muted = muted || unassigned;
 	mute->setAccessibleName(QTStr("VolControl.Mute").arg(sourceName));
 	obs_fader_add_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_add_callback(obs_volmeter, OBSVolumeLevel, this);
 
 	sigs.emplace_back(obs_source_get_signal_handler(source), "mute",
 			  OBSVolumeMuted, this);
@@ -410,7 +400,6 @@ void VolControl::EnableSlider(bool enable)
 VolControl::~VolControl()
 {
 	obs_fader_remove_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_remove_callback(obs_volmeter, OBSVolumeLevel, this);
 
 	sigs.clear();
 
@@ -886,6 +875,16 @@ void VolumeMeter::setLevels(const float magnitude[MAX_AUDIO_CHANNELS],
 	calculateBallistics(ts);
 }
 
+void VolumeMeter::updateLevels()
+{
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float inputPeak[MAX_AUDIO_CHANNELS];
+
+	if (obs_volmeter_get_levels(obs_volmeter, magnitude, peak, inputPeak))
+		setLevels(magnitude, peak, inputPeak);
+}
+
 inline void VolumeMeter::resetLevels()
 {
 	currentLastUpdateTime = 0;
@@ -1509,6 +1508,10 @@ void VolumeMeterTimer::RemoveVolControl(VolumeMeter *meter)
 void VolumeMeterTimer::timerEvent(QTimerEvent *)
 {
 	for (VolumeMeter *meter : volumeMeters) {
+		// Levels are picked up here rather than pushed from the audio
+		// thread, so that every meter costs one read per redraw
+		meter->updateLevels();
+
 		if (meter->needLayoutChange()) {
 			// Tell paintEvent to update layout and paint everything
 			meter->update();
@@ -187,6 +187,7 @@ public:
 	void setLevels(const float magnitude[MAX_AUDIO_CHANNELS],
 		       const float peak[MAX_AUDIO_CHANNELS],
 		       const float inputPeak[MAX_AUDIO_CHANNELS]);
+	void updateLevels();
 	QRect getBarRect() const;
 	bool needLayoutChange();
 
@@ -294,10 +295,6 @@ private:
 	QMenu *contextMenu;
 
 	static void OBSVolumeChanged(void *param, float db);
-	static void OBSVolumeLevel(void *data,
-				   const float magnitude[MAX_AUDIO_CHANNELS],
-				   const float peak[MAX_AUDIO_CHANNELS],
-				   const float inputPeak[MAX_AUDIO_CHANNELS]);
 	static void OBSVolumeMuted(void *data, calldata_t *calldata);
 	static void OBSMixersOrMonitoringChanged(void *data, calldata_t *);
 
@@ -47,10 +47,16 @@ class TestMode {
 			gs_draw_sprite(nullptr, 0, cx, cy);
 	}
 
+	bool useScene;
+
 public:
-	inline TestMode()
+	/* renders noise unless testing with the user's actual scenes */
+	inline TestMode(bool useScene_ = false) : useScene(useScene_)
 	{
 		obs_get_video_info(&ovi);
+		if (useScene)
+			return;
+
 		obs_add_main_render_callback(render_rand, this);
 
 		for (uint32_t i = 0; i < 6; i++) {
@@ -62,10 +68,12 @@ public:
 
 	inline ~TestMode()
 	{
-		for (uint32_t i = 0; i < 6; i++)
-			obs_set_output_source(i, source[i]);
+		if (!useScene) {
+			for (uint32_t i = 0; i < 6; i++)
+				obs_set_output_source(i, source[i]);
 
-		obs_remove_main_render_callback(render_rand, this);
+			obs_remove_main_render_callback(render_rand, this);
+		}
 		obs_reset_video(&ovi);
 	}
 
@@ -566,7 +574,7 @@ static void CalcBaseRes(int &baseCX, int &baseCY)
 
 bool AutoConfigTestPage::TestSoftwareEncoding()
 {
-	TestMode testMode;
+	TestMode testMode(wiz->benchmarkScene);
 	QMetaObject::invokeMethod(this, "UpdateMessage",
 				  Q_ARG(QString, QStringLiteral("")));
 
@@ -669,37 +677,12 @@ bool AutoConfigTestPage::TestSoftwareEncoding()
 	int i = 0;
 	int count = 1;
 
-	auto testRes = [&](int cy, int fps_num, int fps_den, bool force) {
-		int per = ++i * 100 / count;
-		QMetaObject::invokeMethod(this, "Progress", Q_ARG(int, per));
-
-		if (cy > baseCY)
-			return true;
-
-		/* no need for more than 3 tests max */
-		if (results.size() >= 3)
-			return true;
-
-		if (!fps_num || !fps_den) {
-			fps_num = wiz->specificFPSNum;
-			fps_den = wiz->specificFPSDen;
-		}
-
+	/* when testing with the actual scenes, a setting only holds if it
+	 * neither skips nor lags a single frame */
+	auto runTest = [&](int cx, int cy, int fps_num, int fps_den,
+			   bool &held) {
 		long double fps = ((long double)fps_num / (long double)fps_den);
 
-		int cx = int(((long double)baseCX / (long double)baseCY) *
-			     (long double)cy);
-
-		if (!force && wiz->type != AutoConfig::Type::Recording) {
-			int est = EstimateMinBitrate(cx, cy, fps_num, fps_den);
-			if (est > wiz->idealBitrate)
-				return true;
-		}
-
-		long double rate = (long double)cx * (long double)cy * fps;
-		if (!force && rate > maxDataRate)
-			return true;
-
 		testMode.SetVideo(cx, cy, fps_num, fps_den);
 
 		obs_encoder_set_video(vencoder, obs_get_video());
@@ -723,6 +706,8 @@ bool AutoConfigTestPage::TestSoftwareEncoding()
 		if (cancel)
 			return false;
 
+		uint32_t lagged = obs_get_lagged_frames();
+
 		if (!obs_output_start(output)) {
 			QMetaObject::invokeMethod(this, "Failure",
 						  Q_ARG(QString,
@@ -732,12 +717,68 @@ bool AutoConfigTestPage::TestSoftwareEncoding()
 
 		cv.wait_for(ul, chrono::seconds(5));
 
+		struct obs_encoder_stats stats = {};
+		obs_encoder_get_stats(vencoder, &stats);
+
 		obs_output_stop(output);
 		cv.wait(ul);
 
 		int skipped =
 			(int)video_output_get_skipped_frames(obs_get_video());
-		if (force || skipped <= 10)
+		lagged = obs_get_lagged_frames() - lagged;
+
+		blog(LOG_INFO,
+		     "Tested %dx%d %s FPS (%s): %d skipped, %u lagged, "
+		     "encode latency %.1f ms avg / %.1f ms max",
+		     cx, cy, QT_TO_UTF8(fpsStr),
+		     obs_data_get_string(vencoder_settings, "preset"), skipped,
+		     lagged, (double)stats.latency_avg_ns / 1000000.0,
+		     (double)stats.latency_max_ns / 1000000.0);
+
+		if (wiz->benchmarkScene)
+			held = skipped == 0 && lagged == 0;
+		else
+			held = skipped <= 10;
+		return true;
+	};
+
+	auto testRes = [&](int cy, int fps_num, int fps_den, bool force) {
+		int per = ++i * 100 / count;
+		QMetaObject::invokeMethod(this, "Progress", Q_ARG(int, per));
+
+		if (cy > baseCY)
+			return true;
+
+		/* no need for more than 3 tests max */
+		if (results.size() >= 3)
+			return true;
+
+		if (!fps_num || !fps_den) {
+			fps_num = wiz->specificFPSNum;
+			fps_den = wiz->specificFPSDen;
+		}
+
+		long double fps = ((long double)fps_num / (long double)fps_den);
+
+		int cx = int(((long double)baseCX / (long double)baseCY) *
+			     (long double)cy);
+
+		if (!force && wiz->type != AutoConfig::Type::Recording) {
+			int est = EstimateMinBitrate(cx, cy, fps_num, fps_den);
+			if (est > wiz->idealBitrate)
+				return true;
+		}
+
+		/* the actual scenes are measured rather than estimated */
+		long double rate = (long double)cx * (long double)cy * fps;
+		if (!force && !wiz->benchmarkScene && rate > maxDataRate)
+			return true;
+
+		bool held;
+		if (!runTest(cx, cy, fps_num, fps_den, held))
+			return false;
+
+		if (force || held)
 			results.emplace_back(cx, cy, fps_num, fps_den);
 
 		return !cancel;
@@ -813,6 +854,29 @@ bool AutoConfigTestPage::TestSoftwareEncoding()
 	wiz->idealFPSNum = result.fps_num;
 	wiz->idealFPSDen = result.fps_den;
 
+	/* -----------------------------------*/
+	/* find the slowest preset that holds */
+
+	wiz->idealPreset.clear();
+
+	if (wiz->benchmarkScene) {
+		static const char *presets[] = {"faster", "fast"};
+
+		for (const char *preset : presets) {
+			obs_data_set_string(vencoder_settings, "preset",
+					    preset);
+
+			bool held;
+			if (!runTest(result.cx, result.cy, result.fps_num,
+				     result.fps_den, held))
+				return false;
+			if (!held)
+				break;
+
+			wiz->idealPreset = preset;
+		}
+	}
+
 	long double fUpperBitrate = EstimateUpperBitrate(
 		result.cx, result.cy, result.fps_num, result.fps_den);
 
@@ -1156,6 +1220,12 @@ void AutoConfigTestPage::FinalizeResults()
 	form->addRow(newLabel("Basic.Settings.Output.Simple.RecordingQuality"),
 		     new QLabel(recQuality, ui->finishPage));
 
+	if (!wiz->idealPreset.empty() &&
+	    wiz->streamingEncoder == AutoConfig::Encoder::x264)
+		form->addRow(newLabel("Basic.Settings.Output.EncoderPreset"),
+			     new QLabel(wiz->idealPreset.c_str(),
+					ui->finishPage));
+
 	long double fps =
 		(long double)wiz->idealFPSNum / (long double)wiz->idealFPSDen;
 
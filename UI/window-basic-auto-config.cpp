@@ -209,6 +209,7 @@ bool AutoConfigVideoPage::validatePage()
 	wiz->baseResolutionCX = encRes >> 16;
 	wiz->baseResolutionCY = encRes & 0xFFFF;
 	wiz->fpsType = (AutoConfig::FPSType)ui->fps->currentData().toInt();
+	wiz->benchmarkScene = ui->benchmarkScene->isChecked();
 
 	obs_video_info ovi;
 	obs_get_video_info(&ovi);
@@ -1158,6 +1159,10 @@ void AutoConfig::SaveSettings()
 	config_set_string(main->Config(), "Output", "Mode", "Simple");
 	config_set_string(main->Config(), "SimpleOutput", "RecQuality",
 			  quality);
+
+	if (!idealPreset.empty() && streamingEncoder == Encoder::x264)
+		config_set_string(main->Config(), "SimpleOutput", "Preset",
+				  idealPreset.c_str());
 	config_set_int(main->Config(), "Video", "BaseCX", baseResolutionCX);
 	config_set_int(main->Config(), "Video", "BaseCY", baseResolutionCY);
 	config_set_int(main->Config(), "Video", "OutputCX", idealResolutionCX);
@@ -83,6 +83,7 @@ class AutoConfig : public QWizard {
 	int idealFPSDen = 1;
 	std::string serviceName;
 	std::string serverName;
+	std::string idealPreset;
 	std::string server;
 	std::string key;
 
@@ -102,6 +103,7 @@ class AutoConfig : public QWizard {
 	bool regionAsia = true;
 	bool regionOther = true;
 	bool preferHighFPS = false;
+	bool benchmarkScene = false;
 	bool preferHardware = false;
 	int specificFPSNum = 0;
 	int specificFPSDen = 0;
@@ -1209,24 +1209,20 @@ bool SimpleOutput::StartStreaming(obs_service_t *service)
 		config_get_string(main->Config(), "Output", "BindIP");
 	const char *ipFamily =
 		config_get_string(main->Config(), "Output", "IPFamily");
-#ifdef _WIN32
 	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output",
 						   "NewSocketLoopEnable");
 	bool enableLowLatencyMode =
 		config_get_bool(main->Config(), "Output", "LowLatencyEnable");
-#endif
 	bool enableDynBitrate =
 		config_get_bool(main->Config(), "Output", "DynamicBitrate");
 
 	OBSDataAutoRelease settings = obs_data_create();
 	obs_data_set_string(settings, "bind_ip", bindIP);
 	obs_data_set_string(settings, "ip_family", ipFamily);
-#ifdef _WIN32
 	obs_data_set_bool(settings, "new_socket_loop_enabled",
 			  enableNewSocketLoop);
 	obs_data_set_bool(settings, "low_latency_mode_enabled",
 			  enableLowLatencyMode);
-#endif
 	obs_data_set_bool(settings, "dyn_bitrate", enableDynBitrate);
 	obs_output_update(streamOutput, settings);
 
@@ -1949,6 +1945,16 @@ inline void AdvancedOutput::SetupRecording()
 		obs_data_set_string(settings, "muxer_settings", mux);
 	}
 
+	obs_data_set_bool(settings, "direct_io",
+			  config_get_bool(main->Config(), "AdvOut",
+					  "RecDirectIO"));
+	obs_data_set_int(settings, "write_buffer_size",
+			 config_get_uint(main->Config(), "AdvOut",
+					 "RecWriteBufferMB"));
+	obs_data_set_int(settings, "preallocate_size",
+			 config_get_uint(main->Config(), "AdvOut",
+					 "RecPreallocateMB"));
+
 	obs_data_set_string(settings, "path", path);
 	obs_output_update(fileOutput, settings);
 	if (replayBuffer)
@@ -2259,12 +2265,10 @@ bool AdvancedOutput::StartStreaming(obs_service_t *service)
 		config_get_string(main->Config(), "Output", "BindIP");
 	const char *ipFamily =
 		config_get_string(main->Config(), "Output", "IPFamily");
-#ifdef _WIN32
 	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output",
 						   "NewSocketLoopEnable");
 	bool enableLowLatencyMode =
 		config_get_bool(main->Config(), "Output", "LowLatencyEnable");
-#endif
 	bool enableDynBitrate =
 		config_get_bool(main->Config(), "Output", "DynamicBitrate");
 
@@ -2280,12 +2284,10 @@ bool AdvancedOutput::StartStreaming(obs_service_t *service)
 	OBSDataAutoRelease settings = obs_data_create();
 	obs_data_set_string(settings, "bind_ip", bindIP);
 	obs_data_set_string(settings, "ip_family", ipFamily);
-#ifdef _WIN32
 	obs_data_set_bool(settings, "new_socket_loop_enabled",
 			  enableNewSocketLoop);
 	obs_data_set_bool(settings, "low_latency_mode_enabled",
 			  enableLowLatencyMode);
-#endif
 	obs_data_set_bool(settings, "dyn_bitrate", enableDynBitrate);
 	obs_output_update(streamOutput, settings);
 
@@ -2474,6 +2476,12 @@ bool AdvancedOutput::StartReplayBuffer()
 		obs_data_set_int(settings, "max_time_sec", rbTime);
 		obs_data_set_int(settings, "max_size_mb",
 				 usesBitrate ? 0 : rbSize);
+		obs_data_set_int(settings, "memory_time_sec",
+				 config_get_int(main->Config(), "AdvOut",
+						"RecRBMemTime"));
+		obs_data_set_int(settings, "spill_size_mb",
+				 config_get_int(main->Config(), "AdvOut",
+						"RecRBSpillSize"));
 
 		obs_output_update(replayBuffer, settings);
 	}
@@ -507,6 +507,8 @@ void OBSBasic::ResetProfileData()
 							  "MonitoringDeviceId");
 
 		obs_set_audio_monitoring_device(device_name, device_id);
+		obs_set_audio_monitoring_buffer_ms((uint32_t)config_get_uint(
+			basicConfig, "Audio", "MonitoringBufferMs"));
 
 		blog(LOG_INFO, "Audio monitoring device:\n\tname: %s\n\tid: %s",
 		     device_name, device_id);
@@ -75,6 +75,7 @@
 #include "ui-validation.hpp"
 #include "media-controls.hpp"
 #include "undo-stack-obs.hpp"
+#include "metrics-server.hpp"
 #include <fstream>
 #include <sstream>
 
@@ -785,6 +786,27 @@ obs_data_array_t *OBSBasic::SaveProjectors()
 	return savedProjectors;
 }
 
+struct SaveProjectTask {
+	OBSDataAutoRelease data;
+	std::string file;
+	long serial;
+	volatile long *latestSerial;
+};
+
+static void SaveProjectTaskProc(void *param)
+{
+	std::unique_ptr<SaveProjectTask> task(
+		static_cast<SaveProjectTask *>(param));
+
+	/* a newer save has already been queued behind this one */
+	if (task->serial != os_atomic_load_long(task->latestSerial))
+		return;
+
+	const char *file = task->file.c_str();
+	if (!obs_data_save_json_safe(task->data, file, "tmp", "bak"))
+		blog(LOG_ERROR, "Could not save scene data to %s", file);
+}
+
 void OBSBasic::Save(const char *file)
 {
 	OBSScene scene = GetCurrentScene();
@@ -847,8 +869,21 @@ void OBSBasic::Save(const char *file)
 		obs_data_set_obj(saveData, "resolution", res);
 	}
 
-	if (!obs_data_save_json_safe(saveData, file, "tmp", "bak"))
-		blog(LOG_ERROR, "Could not save scene data to %s", file);
+	/* Converting to json and writing the file happens on the save thread,
+	 * which is most of the time spent saving a large collection.  The
+	 * data is copied first, as it still references the settings of live
+	 * sources which may be changed in the meantime. */
+	SaveProjectTask *task = new SaveProjectTask;
+	task->data = obs_data_create();
+	obs_data_apply(task->data, saveData);
+	task->file = file;
+	task->serial = os_atomic_inc_long(&saveSerial);
+	task->latestSerial = &saveSerial;
+
+	if (!saveQueue)
+		saveQueue = os_task_queue_create();
+	if (!os_task_queue_queue_task(saveQueue, SaveProjectTaskProc, task))
+		SaveProjectTaskProc(task);
 }
 
 void OBSBasic::DeferSaveBegin()
@@ -1100,6 +1135,12 @@ static inline void AddMissingFiles(void *data, obs_source_t *source)
 	obs_missing_files_destroy(sf);
 }
 
+static inline void AddMissingFilesSource(void *data, obs_source_t *source)
+{
+	auto sources = static_cast<std::vector<OBSSource> *>(data);
+	sources->emplace_back(source);
+}
+
 void OBSBasic::LoadData(obs_data_t *data, const char *file)
 {
 	ClearSceneData();
@@ -1181,11 +1222,20 @@ void OBSBasic::LoadData(obs_data_t *data, const char *file)
 		obs_data_array_push_back_array(sources, groups);
 	}
 
-	obs_missing_files_t *files = obs_missing_files_create();
-	obs_load_sources(sources, AddMissingFiles, files);
+	std::vector<OBSSource> fileSources;
+
+	/* inputs are created in the background, so their missing files are
+	 * not reported */
+	if (config_get_bool(App()->GlobalConfig(), "General",
+			    "DeferSourceLoading"))
+		obs_load_sources_deferred(sources, AddMissingFilesSource,
+					  &fileSources);
+	else
+		obs_load_sources(sources, AddMissingFilesSource, &fileSources);
 
 	if (transitions)
-		LoadTransitions(transitions, AddMissingFiles, files);
+		LoadTransitions(transitions, AddMissingFilesSource,
+				&fileSources);
 	if (sceneOrder)
 		LoadSceneListOrder(sceneOrder);
 
@@ -1346,7 +1396,7 @@ retryScene:
 	LogScenes();
 
 	if (!App()->IsMissingFilesCheckDisabled())
-		ShowMissingFilesDialog(files);
+		CheckMissingFiles(fileSources);
 
 	disableSaving--;
 
@@ -1683,9 +1733,15 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_uint(basicConfig, "AdvOut", "RecSplitFileSize",
 				2048);
 
+	config_set_default_bool(basicConfig, "AdvOut", "RecDirectIO", false);
+	config_set_default_uint(basicConfig, "AdvOut", "RecWriteBufferMB", 256);
+	config_set_default_uint(basicConfig, "AdvOut", "RecPreallocateMB", 0);
+
 	config_set_default_bool(basicConfig, "AdvOut", "RecRB", false);
 	config_set_default_uint(basicConfig, "AdvOut", "RecRBTime", 20);
 	config_set_default_int(basicConfig, "AdvOut", "RecRBSize", 512);
+	config_set_default_int(basicConfig, "AdvOut", "RecRBMemTime", 0);
+	config_set_default_int(basicConfig, "AdvOut", "RecRBSpillSize", 2048);
 
 	config_set_default_uint(basicConfig, "Video", "BaseCX", cx);
 	config_set_default_uint(basicConfig, "Video", "BaseCY", cy);
@@ -1761,6 +1817,7 @@ bool OBSBasic::InitBasicConfigDefaults()
 		basicConfig, "Audio", "MonitoringDeviceName",
 		Str("Basic.Settings.Advanced.Audio.MonitoringDevice"
 		    ".Default"));
+	config_set_default_uint(basicConfig, "Audio", "MonitoringBufferMs", 30);
 	config_set_default_uint(basicConfig, "Audio", "SampleRate", 48000);
 	config_set_default_string(basicConfig, "Audio", "ChannelSetup",
 				  "Stereo");
@@ -2005,6 +2062,53 @@ static inline void LogEncoders()
 	list_encoders(OBS_ENCODER_AUDIO);
 }
 
+/* Optional [ThreadScheduling] section of global.ini, e.g.
+ *   Audio=Realtime
+ *   AudioAffinity=0x3 */
+static void LoadThreadScheduling()
+{
+	struct role_config {
+		enum obs_thread_role role;
+		const char *name;
+		const char *affinity_name;
+	};
+	static const role_config roles[] = {
+		{OBS_THREAD_ROLE_GRAPHICS, "Graphics", "GraphicsAffinity"},
+		{OBS_THREAD_ROLE_VIDEO_OUTPUT, "VideoOutput",
+		 "VideoOutputAffinity"},
+		{OBS_THREAD_ROLE_AUDIO, "Audio", "AudioAffinity"},
+		{OBS_THREAD_ROLE_ENCODER, "Encoder", "EncoderAffinity"},
+	};
+
+	config_t *config = App()->GlobalConfig();
+
+	for (const role_config &rc : roles) {
+		const char *priority_str =
+			config_get_string(config, "ThreadScheduling", rc.name);
+		const char *affinity_str = config_get_string(
+			config, "ThreadScheduling", rc.affinity_name);
+		if (!priority_str && !affinity_str)
+			continue;
+
+		enum os_thread_priority priority = OS_THREAD_PRIORITY_NORMAL;
+		if (astrcmpi(priority_str, "AboveNormal") == 0)
+			priority = OS_THREAD_PRIORITY_ABOVE_NORMAL;
+		else if (astrcmpi(priority_str, "High") == 0)
+			priority = OS_THREAD_PRIORITY_HIGH;
+		else if (astrcmpi(priority_str, "Realtime") == 0)
+			priority = OS_THREAD_PRIORITY_REALTIME;
+
+		uint64_t affinity =
+			affinity_str ? strtoull(affinity_str, nullptr, 0) : 0;
+
+		blog(LOG_INFO,
+		     "Thread scheduling for %s: priority %s, affinity 0x%llx",
+		     rc.name, priority_str ? priority_str : "Normal",
+		     (unsigned long long)affinity);
+		obs_set_thread_scheduling(rc.role, priority, affinity);
+	}
+}
+
 void OBSBasic::OBSInit()
 {
 	ProfileScope("OBSBasic::OBSInit");
@@ -2029,6 +2133,9 @@ void OBSBasic::OBSInit()
 
 	if (!InitBasicConfig())
 		throw "Failed to load basic.ini";
+
+	LoadThreadScheduling();
+
 	if (!ResetAudio())
 		throw "Failed to initialize audio";
 
@@ -2054,6 +2161,8 @@ void OBSBasic::OBSInit()
 							  "MonitoringDeviceId");
 
 		obs_set_audio_monitoring_device(device_name, device_id);
+		obs_set_audio_monitoring_buffer_ms((uint32_t)config_get_uint(
+			basicConfig, "Audio", "MonitoringBufferMs"));
 
 		blog(LOG_INFO, "Audio monitoring device:\n\tname: %s\n\tid: %s",
 		     device_name, device_id);
@@ -2062,6 +2171,13 @@ void OBSBasic::OBSInit()
 	InitOBSCallbacks();
 	InitHotkeys();
 
+	if (config_get_bool(App()->GlobalConfig(), "Metrics",
+			    "ServerEnabled")) {
+		quint16 port = (quint16)config_get_uint(
+			App()->GlobalConfig(), "Metrics", "ServerPort");
+		metricsServer = new MetricsServer(port, this);
+	}
+
 	/* hack to prevent elgato from loading its own QtNetwork that it tries
 	 * to ship with */
 #if defined(_WIN32) && !defined(_DEBUG)
@@ -2541,7 +2657,7 @@ void OBSBasic::ReceivedIntroJson(const QString &text)
 
 	config_set_int(App()->GlobalConfig(), "General", "InfoIncrement",
 		       info_increment);
-	config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+	config_save_safe_deferred(App()->GlobalConfig(), "tmp", nullptr);
 
 	cef->init_browser();
 
@@ -2948,6 +3064,11 @@ OBSBasic::~OBSBasic()
 	if (patronJsonThread && patronJsonThread->isRunning())
 		patronJsonThread->wait();
 
+	/* finishes any save that is still queued */
+	os_task_queue_destroy(saveQueue);
+
+	obs_missing_files_check_destroy(missingFilesCheck);
+
 	delete screenshotData;
 	delete previewProjector;
 	delete studioProgramProjector;
@@ -3052,6 +3173,10 @@ void OBSBasic::SaveProjectNow()
 
 	projectChanged = true;
 	SaveProjectDeferred();
+
+	/* callers rely on the file being written once this returns */
+	if (saveQueue)
+		os_task_queue_wait(saveQueue);
 }
 
 void OBSBasic::SaveProject()
@@ -4839,6 +4964,9 @@ bool OBSBasic::ResetAudio()
 		ai.fixed_buffering = true;
 	}
 
+	ai.buffering_reduce_ms = (uint32_t)config_get_uint(
+		GetGlobalConfig(), "Audio", "AudioBufferingReduceMs");
+
 	return obs_reset_audio2(&ai);
 }
 
@@ -4964,6 +5092,12 @@ void OBSBasic::ClearSceneData()
 {
 	disableSaving++;
 
+	/* drops the result of a missing files check that is still running
+	 * for the previous collection */
+	obs_missing_files_check_destroy(missingFilesCheck);
+	missingFilesCheck = nullptr;
+	missingFilesCheckId++;
+
 	setCursor(Qt::WaitCursor);
 
 	CloseDialogs();
@@ -5321,7 +5455,7 @@ void OBSBasic::on_actionShowMacPermissions_triggered()
 #endif
 }
 
-void OBSBasic::ShowMissingFilesDialog(obs_missing_files_t *files)
+void OBSBasic::ShowMissingFilesDialog(obs_missing_files_t *files, bool manual)
 {
 	if (obs_missing_files_count(files) > 0) {
 		/* When loading the missing files dialog on launch, the
@@ -5338,13 +5472,45 @@ void OBSBasic::ShowMissingFilesDialog(obs_missing_files_t *files)
 		obs_missing_files_destroy(files);
 
 		/* Only raise dialog if triggered manually */
-		if (!disableSaving)
+		if (manual)
 			OBSMessageBox::information(
 				this, QTStr("MissingFiles.NoMissing.Title"),
 				QTStr("MissingFiles.NoMissing.Text"));
 	}
 }
 
+/* Checking the files of every source at load can take a long time on network
+ * storage, so it is done in the background and the dialog shows up once the
+ * check is done */
+#define MISSING_FILES_CHECK_TIMEOUT_MS 15000
+
+void OBSBasic::CheckMissingFiles(const std::vector<OBSSource> &sources)
+{
+	std::vector<obs_source_t *> list(sources.begin(), sources.end());
+	uint64_t id = ++missingFilesCheckId;
+
+	auto cb = [](void *param, obs_missing_files_t *files) {
+		uint64_t id = (uint64_t)(uintptr_t)param;
+		OBSBasic *main = OBSBasic::Get();
+
+		QMetaObject::invokeMethod(
+			main,
+			[main, id, files]() {
+				if (id == main->missingFilesCheckId)
+					main->ShowMissingFilesDialog(files,
+								     false);
+				else
+					obs_missing_files_destroy(files);
+			},
+			Qt::QueuedConnection);
+	};
+
+	obs_missing_files_check_destroy(missingFilesCheck);
+	missingFilesCheck = obs_missing_files_check_sources(
+		list.data(), list.size(), MISSING_FILES_CHECK_TIMEOUT_MS, cb,
+		(void *)(uintptr_t)id);
+}
+
 void OBSBasic::on_actionShowMissingFiles_triggered()
 {
 	obs_missing_files_t *files = obs_missing_files_create();
@@ -6939,7 +7105,8 @@ void OBSBasic::ShowYouTubeAutoStartWarning()
 		if (cb->isChecked()) {
 			config_set_bool(App()->GlobalConfig(), "General",
 					"WarnedAboutYouTubeAutoStart", true);
-			config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+			config_save_safe_deferred(App()->GlobalConfig(), "tmp",
+						  nullptr);
 		}
 	};
 
@@ -7824,7 +7991,8 @@ void OBSBasic::ShowReplayBufferPauseWarning()
 		if (cb->isChecked()) {
 			config_set_bool(App()->GlobalConfig(), "General",
 					"WarnedAboutReplayBufferPausing", true);
-			config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+			config_save_safe_deferred(App()->GlobalConfig(), "tmp",
+						  nullptr);
 		}
 	};
 
@@ -10373,18 +10541,16 @@ void OBSBasic::ColorChange()
 SourceTreeItem *OBSBasic::GetItemWidgetFromSceneItem(obs_sceneitem_t *sceneItem)
 {
 	int i = 0;
-	SourceTreeItem *treeItem = ui->sources->GetItemWidget(i);
 	OBSSceneItem item = ui->sources->Get(i);
 	int64_t id = obs_sceneitem_get_id(sceneItem);
-	while (treeItem && obs_sceneitem_get_id(item) != id) {
+	while (item && obs_sceneitem_get_id(item) != id) {
 		i++;
-		treeItem = ui->sources->GetItemWidget(i);
 		item = ui->sources->Get(i);
 	}
-	if (treeItem)
-		return treeItem;
 
-	return nullptr;
+	/* only the widget of the matching row is created if it's not in
+	 * view */
+	return item ? ui->sources->GetItemWidget(i) : nullptr;
 }
 
 void OBSBasic::on_autoConfigure_triggered()
@@ -47,6 +47,7 @@
 
 #include <util/platform.h>
 #include <util/threading.h>
+#include <util/task.h>
 #include <util/util.hpp>
 
 #include <QPointer>
@@ -55,6 +56,7 @@ class QMessageBox;
 class QListWidgetItem;
 class VolControl;
 class OBSBasicStats;
+class MetricsServer;
 class OBSBasicVCamConfig;
 
 #include "ui_OBSBasic.h"
@@ -240,6 +242,11 @@ private:
 	bool loaded = false;
 	long disableSaving = 1;
 	bool projectChanged = false;
+	os_task_queue_t *saveQueue = nullptr;
+
+	obs_missing_files_check_t *missingFilesCheck = nullptr;
+	uint64_t missingFilesCheckId = 0;
+	volatile long saveSerial = 0;
 	bool previewEnabled = true;
 	ContextBarSize contextBarSize = ContextBarSize_Normal;
 
@@ -285,6 +292,7 @@ private:
 
 	OBSService service;
 	std::unique_ptr<BasicOutputHandler> outputHandler;
+	QPointer<MetricsServer> metricsServer;
 	bool streamingStopping = false;
 	bool recordingStopping = false;
 	bool replayBufferStopping = false;
@@ -654,7 +662,9 @@ private:
 	bool drawSafeAreas = false;
 
 	void CenterSelectedSceneItems(const CenterType &centerType);
-	void ShowMissingFilesDialog(obs_missing_files_t *files);
+	void ShowMissingFilesDialog(obs_missing_files_t *files,
+				    bool manual = true);
+	void CheckMissingFiles(const std::vector<OBSSource> &sources);
 
 	QColor selectionColor;
 	QColor cropColor;
@@ -844,12 +844,15 @@ void OBSBasicPreview::mouseReleaseEvent(QMouseEvent *event)
 	if (wrapper && rwrapper) {
 		std::string undo_data(obs_data_get_json(wrapper));
 		std::string redo_data(obs_data_get_json(rwrapper));
+		/* drags following each other closely are merged in to a
+		 * single undo action */
 		if (changed && undo_data.compare(redo_data) != 0)
 			main->undo_s.add_action(
 				QTStr("Undo.Transform")
 					.arg(obs_source_get_name(
 						main->GetCurrentSceneSource())),
-				undo_redo, undo_redo, undo_data, redo_data);
+				undo_redo, undo_redo, undo_data, redo_data,
+				true);
 	}
 
 	wrapper = nullptr;
@@ -405,6 +405,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->multiviewMouseSwitch, CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->multiviewDrawNames,   CHECK_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->multiviewDrawAreas,   CHECK_CHANGED,  GENERAL_CHANGED);
+	HookWidget(ui->multiviewCacheThumbnails, CHECK_CHANGED, GENERAL_CHANGED);
 	HookWidget(ui->multiviewLayout,      COMBO_CHANGED,  GENERAL_CHANGED);
 	HookWidget(ui->theme, 		     COMBO_CHANGED,  APPEAR_CHANGED);
 	HookWidget(ui->themeVariant,	     COMBO_CHANGED,  APPEAR_CHANGED);
@@ -646,8 +647,6 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	delete ui->adapter;
 	delete ui->processPriorityLabel;
 	delete ui->processPriority;
-	delete ui->enableNewSocketLoop;
-	delete ui->enableLowLatencyMode;
 	delete ui->hideOBSFromCapture;
 #ifdef __linux__
 	delete ui->browserHWAccel;
@@ -661,8 +660,6 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	ui->adapter = nullptr;
 	ui->processPriorityLabel = nullptr;
 	ui->processPriority = nullptr;
-	ui->enableNewSocketLoop = nullptr;
-	ui->enableLowLatencyMode = nullptr;
 	ui->hideOBSFromCapture = nullptr;
 #ifdef __linux__
 	ui->browserHWAccel = nullptr;
@@ -1491,6 +1488,10 @@ void OBSBasicSettings::LoadGeneralSettings()
 		GetGlobalConfig(), "BasicWindow", "MultiviewDrawAreas");
 	ui->multiviewDrawAreas->setChecked(multiviewDrawAreas);
 
+	bool multiviewCacheThumbnails = config_get_bool(
+		GetGlobalConfig(), "BasicWindow", "MultiviewCacheThumbnails");
+	ui->multiviewCacheThumbnails->setChecked(multiviewCacheThumbnails);
+
 	ui->multiviewLayout->addItem(
 		QTStr("Basic.Settings.General.MultiviewLayout.Horizontal.Top"),
 		static_cast<int>(MultiviewLayout::HORIZONTAL_TOP_8_SCENES));
@@ -2924,21 +2925,21 @@ void OBSBasicSettings::LoadAdvancedSettings()
 
 	const char *processPriority = config_get_string(
 		App()->GlobalConfig(), "General", "ProcessPriority");
-	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output",
-						   "NewSocketLoopEnable");
-	bool enableLowLatencyMode =
-		config_get_bool(main->Config(), "Output", "LowLatencyEnable");
 
 	int idx = ui->processPriority->findData(processPriority);
 	if (idx == -1)
 		idx = ui->processPriority->findData("Normal");
 	ui->processPriority->setCurrentIndex(idx);
+#endif
+	bool enableNewSocketLoop = config_get_bool(main->Config(), "Output",
+						   "NewSocketLoopEnable");
+	bool enableLowLatencyMode =
+		config_get_bool(main->Config(), "Output", "LowLatencyEnable");
 
 	ui->enableNewSocketLoop->setChecked(enableNewSocketLoop);
 	ui->enableLowLatencyMode->setChecked(enableLowLatencyMode);
 	ui->enableLowLatencyMode->setToolTip(
 		QTStr("Basic.Settings.Advanced.Network.TCPPacing.Tooltip"));
-#endif
 #if defined(_WIN32) || defined(__APPLE__)
 	bool browserHWAccel = config_get_bool(App()->GlobalConfig(), "General",
 					      "BrowserHWAccel");
@@ -3506,6 +3507,13 @@ void OBSBasicSettings::SaveGeneralSettings()
 		multiviewChanged = true;
 	}
 
+	if (WidgetChanged(ui->multiviewCacheThumbnails)) {
+		config_set_bool(GetGlobalConfig(), "BasicWindow",
+				"MultiviewCacheThumbnails",
+				ui->multiviewCacheThumbnails->isChecked());
+		multiviewChanged = true;
+	}
+
 	if (WidgetChanged(ui->multiviewLayout)) {
 		config_set_int(GetGlobalConfig(), "BasicWindow",
 			       "MultiviewLayout",
@@ -3564,10 +3572,9 @@ void OBSBasicSettings::SaveAdvancedSettings()
 			  priority.c_str());
 	if (main->Active())
 		SetProcessPriority(priority.c_str());
-
+#endif
 	SaveCheckBox(ui->enableNewSocketLoop, "Output", "NewSocketLoopEnable");
 	SaveCheckBox(ui->enableLowLatencyMode, "Output", "LowLatencyEnable");
-#endif
 #if defined(_WIN32) || defined(__APPLE__)
 	bool browserHWAccel = ui->browserHWAccel->isChecked();
 	config_set_bool(App()->GlobalConfig(), "General", "BrowserHWAccel",
@@ -6224,10 +6231,8 @@ void OBSBasicSettings::UpdateAdvNetworkGroup()
 	ui->dynBitrate->setVisible(enabled);
 	ui->ipFamilyLabel->setVisible(enabled);
 	ui->ipFamily->setVisible(enabled);
-#ifdef _WIN32
 	ui->enableNewSocketLoop->setVisible(enabled);
 	ui->enableLowLatencyMode->setVisible(enabled);
-#endif
 }
 
 void OBSBasicSettings::SimpleStreamAudioEncoderChanged()
@@ -18,6 +18,9 @@
 #define TIMER_INTERVAL 2000
 #define REC_TIME_LEFT_INTERVAL 30000
 
+/* GPU source timing stays enabled while any stats window is visible */
+static int gpuTimingRefs = 0;
+
 void OBSBasicStats::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
 {
 	OBSBasicStats *stats = reinterpret_cast<OBSBasicStats *>(ptr);
@@ -87,6 +90,10 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	hddSpace = new QLabel(this);
 	recordTimeLeft = new QLabel(this);
 	memUsage = new QLabel(this);
+	gpuHeaviestSource = new QLabel(this);
+	gpuMemUsage = new QLabel(this);
+	gpuLargestSource = new QLabel(this);
+	recWriteBuffer = new QLabel(this);
 
 	QString str = MakeTimeLeftText(99999, 59);
 	int textWidth = recordTimeLeft->fontMetrics().boundingRect(str).width();
@@ -96,9 +103,14 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	newStat("HDDSpaceAvailable", hddSpace, 0);
 	newStat("DiskFullIn", recordTimeLeft, 0);
 	newStat("MemoryUsage", memUsage, 0);
+	newStat("HeaviestGPUSource", gpuHeaviestSource, 0);
+	newStat("GPUMemoryUsage", gpuMemUsage, 0);
+	newStat("LargestGPUMemorySource", gpuLargestSource, 0);
+	newStat("RecordingWriteBuffer", recWriteBuffer, 0);
 
 	fps = new QLabel(this);
 	renderTime = new QLabel(this);
+	renderTimeP99 = new QLabel(this);
 	skippedFrames = new QLabel(this);
 	missedFrames = new QLabel(this);
 
@@ -110,6 +122,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 
 	newStatBare("FPS", fps, 2);
 	newStat("AverageTimeToRender", renderTime, 2);
+	newStat("RenderTimeP99", renderTimeP99, 2);
 	newStat("MissedFrames", missedFrames, 2);
 	newStat("SkippedFrames", skippedFrames, 2);
 
@@ -138,6 +151,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	addOutputCol("Basic.Stats.DroppedFrames");
 	addOutputCol("Basic.Stats.MegabytesSent");
 	addOutputCol("Basic.Stats.Bitrate");
+	addOutputCol("Basic.Stats.EncodeLatency");
 
 	/* --------------------------------------------- */
 
@@ -187,6 +201,12 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closable)
 	setWindowModality(Qt::NonModal);
 	setAttribute(Qt::WA_DeleteOnClose, true);
 
+	renderTimeMetric = metric_get(METRIC_HISTOGRAM,
+				      "obs_render_time_seconds", nullptr,
+				      nullptr);
+	renderTimeBase.resize(METRIC_HISTOGRAM_BUCKETS);
+	metric_histogram_get_counts(renderTimeMetric, renderTimeBase.data());
+
 	QObject::connect(&timer, &QTimer::timeout, this,
 			 &OBSBasicStats::Update);
 	timer.setInterval(TIMER_INTERVAL);
@@ -231,7 +251,7 @@ void OBSBasicStats::closeEvent(QCloseEvent *event)
 	if (isVisible()) {
 		config_set_string(main->Config(), "Stats", "geometry",
 				  saveGeometry().toBase64().constData());
-		config_save_safe(main->Config(), "tmp", nullptr);
+		config_save_safe_deferred(main->Config(), "tmp", nullptr);
 	}
 
 	// This code is only reached when the non-dockable stats window is
@@ -245,6 +265,7 @@ OBSBasicStats::~OBSBasicStats()
 {
 	delete shortcutFilter;
 	os_cpu_usage_info_destroy(cpu_info);
+	metric_release(renderTimeMetric);
 }
 
 void OBSBasicStats::AddOutputLabels(QString name)
@@ -255,6 +276,7 @@ void OBSBasicStats::AddOutputLabels(QString name)
 	ol.droppedFrames = new QLabel(this);
 	ol.megabytesSent = new QLabel(this);
 	ol.bitrate = new QLabel(this);
+	ol.encodeLatency = new QLabel(this);
 
 	int col = 0;
 	int row = outputLabels.size() + 1;
@@ -263,6 +285,7 @@ void OBSBasicStats::AddOutputLabels(QString name)
 	outputLayout->addWidget(ol.droppedFrames, row, col++);
 	outputLayout->addWidget(ol.megabytesSent, row, col++);
 	outputLayout->addWidget(ol.bitrate, row, col++);
+	outputLayout->addWidget(ol.encodeLatency, row, col++);
 	outputLabels.push_back(ol);
 }
 
@@ -356,6 +379,121 @@ void OBSBasicStats::Update()
 
 	/* ------------------ */
 
+	struct GPUSource {
+		QString name;
+		uint64_t time_ns = 0;
+	} heaviest;
+
+	auto findHeaviest = [](void *param, obs_source_t *source) {
+		GPUSource *heaviest = static_cast<GPUSource *>(param);
+		uint64_t time_ns = obs_source_get_gpu_render_time_ns(source);
+
+		obs_source_enum_filters(
+			source,
+			[](obs_source_t *, obs_source_t *filter, void *param) {
+				*static_cast<uint64_t *>(param) +=
+					obs_source_get_gpu_render_time_ns(
+						filter);
+			},
+			&time_ns);
+		if (time_ns > heaviest->time_ns) {
+			heaviest->name = obs_source_get_name(source);
+			heaviest->time_ns = time_ns;
+		}
+		return true;
+	};
+
+	obs_enum_sources(findHeaviest, &heaviest);
+
+	if (heaviest.time_ns) {
+		num = (long double)heaviest.time_ns / 1000000.0l;
+		str = QString("%1 (%2 ms)")
+			      .arg(heaviest.name,
+				   QString::number(num, 'f', 2));
+	} else {
+		str = QStringLiteral("-");
+	}
+	gpuHeaviestSource->setText(str);
+
+	/* ------------------ */
+
+	num = (long double)obs_get_gpu_memory_total() / (1024.0l * 1024.0l);
+
+	str = QString::number(num, 'f', 1) + QStringLiteral(" MB");
+	gpuMemUsage->setText(str);
+
+	struct GPUMemorySource {
+		QString name;
+		uint64_t bytes = 0;
+	} largest;
+
+	auto findLargest = [](void *param, obs_source_t *source) {
+		GPUMemorySource *largest =
+			static_cast<GPUMemorySource *>(param);
+		uint64_t bytes = obs_source_get_gpu_memory(source);
+
+		obs_source_enum_filters(
+			source,
+			[](obs_source_t *, obs_source_t *filter, void *param) {
+				*static_cast<uint64_t *>(param) +=
+					obs_source_get_gpu_memory(filter);
+			},
+			&bytes);
+		if (bytes > largest->bytes) {
+			largest->name = obs_source_get_name(source);
+			largest->bytes = bytes;
+		}
+		return true;
+	};
+
+	obs_enum_sources(findLargest, &largest);
+
+	if (largest.bytes) {
+		num = (long double)largest.bytes / (1024.0l * 1024.0l);
+		str = QString("%1 (%2 MB)")
+			      .arg(largest.name,
+				   QString::number(num, 'f', 1));
+	} else {
+		str = QStringLiteral("-");
+	}
+	gpuLargestSource->setText(str);
+
+	/* ------------------ */
+
+	long long bufUsedKB = 0;
+	long long bufMaxKB = 0;
+
+	if (obs_output_active(recOutput)) {
+		calldata_t cd = {};
+		proc_handler_t *ph = obs_output_get_proc_handler(recOutput);
+		if (proc_handler_call(ph, "get_write_buffer", &cd)) {
+			bufUsedKB = calldata_int(&cd, "used_kb");
+			bufMaxKB = calldata_int(&cd, "max_kb");
+		}
+		calldata_free(&cd);
+	}
+
+	if (bufMaxKB > 0) {
+		long double percent = (long double)bufUsedKB /
+				      (long double)bufMaxKB * 100.0l;
+		str = QString("%1 / %2 MB (%3%)")
+			      .arg(QString::number(bufUsedKB / 1024),
+				   QString::number(bufMaxKB / 1024),
+				   QString::number(percent, 'f', 1));
+		if (percent > 80.0l)
+			setThemeID(recWriteBuffer, "error");
+		else if (percent > 50.0l)
+			setThemeID(recWriteBuffer, "warning");
+		else
+			setThemeID(recWriteBuffer, "");
+	} else {
+		str = QStringLiteral("-");
+		setThemeID(recWriteBuffer, "");
+	}
+	recWriteBuffer->setText(str);
+
+	/* ------------------ */
+
 	num = (long double)obs_get_average_frame_time_ns() / 1000000.0l;
 
 	str = QString::number(num, 'f', 1) + QStringLiteral(" ms");
@@ -371,6 +509,25 @@ void OBSBasicStats::Update()
 	else
 		setThemeID(renderTime, "");
 
+	/* percentile of the frames rendered since the last reset */
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+	metric_histogram_get_counts(renderTimeMetric, counts);
+	for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+		counts[i] -= renderTimeBase[i];
+
+	num = (long double)metric_histogram_percentile(counts, 99.0) /
+	      1000000.0l;
+
+	str = QString::number(num, 'f', 1) + QStringLiteral(" ms");
+	renderTimeP99->setText(str);
+
+	if (num > fpsFrameTime)
+		setThemeID(renderTimeP99, "error");
+	else if (num > fpsFrameTime * 0.75l)
+		setThemeID(renderTimeP99, "warning");
+	else
+		setThemeID(renderTimeP99, "");
+
 	/* ------------------ */
 
 	video_t *video = obs_get_video();
@@ -493,6 +650,8 @@ void OBSBasicStats::Reset()
 	first_rendered = 0xFFFFFFFF;
 	first_lagged = 0xFFFFFFFF;
 
+	metric_histogram_get_counts(renderTimeMetric, renderTimeBase.data());
+
 	OBSOutputAutoRelease strOutput = obs_frontend_get_streaming_output();
 	OBSOutputAutoRelease recOutput = obs_frontend_get_recording_output();
 
@@ -561,6 +720,21 @@ void OBSBasicStats::OutputLabels::Update(obs_output_t *output, bool rec)
 	}
 	bitrate->setText(QString("%1 %2").arg(num, 0, 'f', 0).arg(unit));
 
+	obs_encoder_t *venc = output ? obs_output_get_video_encoder(output)
+				     : nullptr;
+	struct obs_encoder_stats stats;
+
+	if (active && obs_encoder_get_stats(venc, &stats)) {
+		str = QString("%1 / %2 ms")
+			      .arg(stats.latency_avg_ns / 1000000.0, 0, 'f', 1)
+			      .arg(stats.latency_max_ns / 1000000.0, 0, 'f', 1);
+		if (stats.qp_avg > 0.0f)
+			str += QString(" (QP %1)").arg(stats.qp_avg, 0, 'f', 1);
+		encodeLatency->setText(str);
+	} else {
+		encodeLatency->setText("-");
+	}
+
 	if (!rec) {
 		int total = output ? obs_output_get_total_frames(output) : 0;
 		int dropped = output ? obs_output_get_frames_dropped(output)
@@ -607,9 +781,15 @@ void OBSBasicStats::OutputLabels::Reset(obs_output_t *output)
 void OBSBasicStats::showEvent(QShowEvent *)
 {
 	timer.start(TIMER_INTERVAL);
+
+	if (gpuTimingRefs++ == 0)
+		obs_set_gpu_source_timing(true);
 }
 
 void OBSBasicStats::hideEvent(QHideEvent *)
 {
 	timer.stop();
+
+	if (--gpuTimingRefs == 0)
+		obs_set_gpu_source_timing(false);
 }
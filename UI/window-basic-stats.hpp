@@ -2,6 +2,7 @@
 
 #include <obs.hpp>
 #include <util/platform.h>
+#include <util/metrics.h>
 #include <obs-frontend-api.h>
 #include <QPointer>
 #include <QWidget>
@@ -20,8 +21,13 @@ class OBSBasicStats : public QFrame {
 	QLabel *hddSpace = nullptr;
 	QLabel *recordTimeLeft = nullptr;
 	QLabel *memUsage = nullptr;
+	QLabel *gpuHeaviestSource = nullptr;
+	QLabel *gpuMemUsage = nullptr;
+	QLabel *gpuLargestSource = nullptr;
+	QLabel *recWriteBuffer = nullptr;
 
 	QLabel *renderTime = nullptr;
+	QLabel *renderTimeP99 = nullptr;
 	QLabel *skippedFrames = nullptr;
 	QLabel *missedFrames = nullptr;
 
@@ -29,6 +35,9 @@ class OBSBasicStats : public QFrame {
 
 	os_cpu_usage_info_t *cpu_info = nullptr;
 
+	metric_t *renderTimeMetric = nullptr;
+	std::vector<uint64_t> renderTimeBase;
+
 	QTimer timer;
 	QTimer recTimeLeft;
 	uint64_t num_bytes = 0;
@@ -40,6 +49,7 @@ class OBSBasicStats : public QFrame {
 		QPointer<QLabel> droppedFrames;
 		QPointer<QLabel> megabytesSent;
 		QPointer<QLabel> bitrate;
+		QPointer<QLabel> encodeLatency;
 
 		uint64_t lastBytesSent = 0;
 		uint64_t lastBytesSentTime = 0;
@@ -22,7 +22,8 @@ void OBSDock::closeEvent(QCloseEvent *event)
 		if (cb->isChecked()) {
 			config_set_bool(App()->GlobalConfig(), "General",
 					"WarnedAboutClosingDocks", true);
-			config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+			config_save_safe_deferred(App()->GlobalConfig(), "tmp",
+						  nullptr);
 		}
 	};
 
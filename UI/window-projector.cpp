@@ -339,13 +339,17 @@ void OBSProjector::UpdateMultiview()
 	bool drawSafeArea = config_get_bool(GetGlobalConfig(), "BasicWindow",
 					    "MultiviewDrawAreas");
 
+	bool cacheThumbnails = config_get_bool(
+		GetGlobalConfig(), "BasicWindow", "MultiviewCacheThumbnails");
+
 	mouseSwitching = config_get_bool(GetGlobalConfig(), "BasicWindow",
 					 "MultiviewMouseSwitch");
 
 	transitionOnDoubleClick = config_get_bool(
 		GetGlobalConfig(), "BasicWindow", "TransitionOnDoubleClick");
 
-	multiview->Update(multiviewLayout, drawLabel, drawSafeArea);
+	multiview->Update(multiviewLayout, drawLabel, drawSafeArea,
+			  cacheThumbnails);
 }
 
 void OBSProjector::UpdateProjectorTitle(QString name)
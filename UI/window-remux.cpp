@@ -595,46 +595,53 @@ void RemuxQueueModel::endProcessing()
 			 index(queue.length(), RemuxEntryColumn::State));
 }
 
-bool RemuxQueueModel::beginNextEntry(QString &inputPath, QString &outputPath)
+bool RemuxQueueModel::beginPendingEntries(QStringList &inputPaths,
+					  QStringList &outputPaths,
+					  QList<int> &rows)
 {
-	bool anyStarted = false;
-
 	for (int row = 0; row < queue.length(); row++) {
 		RemuxQueueEntry &entry = queue[row];
 		if (entry.state == RemuxEntryState::Pending) {
 			entry.state = RemuxEntryState::InProgress;
 
-			inputPath = entry.sourcePath;
-			outputPath = entry.targetPath;
+			inputPaths.append(entry.sourcePath);
+			outputPaths.append(entry.targetPath);
+			rows.append(row);
 
 			QModelIndex index =
 				this->index(row, RemuxEntryColumn::State);
 			emit dataChanged(index, index);
-
-			anyStarted = true;
-			break;
 		}
 	}
 
-	return anyStarted;
+	return !rows.empty();
 }
 
-void RemuxQueueModel::finishEntry(bool success)
+void RemuxQueueModel::finishEntry(int row, bool success)
 {
-	for (int row = 0; row < queue.length(); row++) {
-		RemuxQueueEntry &entry = queue[row];
-		if (entry.state == RemuxEntryState::InProgress) {
-			if (success)
-				entry.state = RemuxEntryState::Complete;
-			else
-				entry.state = RemuxEntryState::Error;
+	if (row < 0 || row >= queue.length())
+		return;
 
-			QModelIndex index =
-				this->index(row, RemuxEntryColumn::State);
-			emit dataChanged(index, index);
+	RemuxQueueEntry &entry = queue[row];
+	if (entry.state != RemuxEntryState::InProgress)
+		return;
 
-			break;
-		}
+	if (success)
+		entry.state = RemuxEntryState::Complete;
+	else
+		entry.state = RemuxEntryState::Error;
+
+	QModelIndex index = this->index(row, RemuxEntryColumn::State);
+	emit dataChanged(index, index);
+}
+
+void RemuxQueueModel::finishEntry(bool success)
+{
+	// Anything still in progress here was stopped before it finished,
+	// or is the single entry of an automatic remux.
+	for (int row = 0; row < queue.length(); row++) {
+		if (queue[row].state == RemuxEntryState::InProgress)
+			finishEntry(row, success);
 	}
 }
 
@@ -714,9 +721,13 @@ OBSRemux::OBSRemux(const char *path, QWidget *parent, bool autoRemux_)
 		&OBSRemux::updateProgress);
 	connect(&remuxer, &QThread::finished, worker.data(),
 		&QObject::deleteLater);
+	connect(worker.data(), &RemuxWorker::entryFinished, this,
+		&OBSRemux::entryFinished);
 	connect(worker.data(), &RemuxWorker::remuxFinished, this,
 		&OBSRemux::remuxFinished);
 	connect(this, &OBSRemux::remux, worker.data(), &RemuxWorker::remux);
+	connect(this, &OBSRemux::remuxBatch, worker.data(),
+		&RemuxWorker::remuxBatch);
 
 	connect(queueModel.data(), &RemuxQueueModel::rowsInserted, this,
 		&OBSRemux::rowCountChanged);
@@ -753,6 +764,7 @@ bool OBSRemux::stopRemux()
 		// working. It will interrupt accordingly in
 		// its next update callback.
 		worker->isWorking = false;
+		media_remux_batch_cancel(worker->batch);
 	}
 
 	return exit;
@@ -884,9 +896,11 @@ void OBSRemux::remuxNextEntry()
 {
 	worker->lastProgress = 0.f;
 
-	QString inputPath, outputPath;
-	if (queueModel->beginNextEntry(inputPath, outputPath)) {
-		emit remux(inputPath, outputPath);
+	QStringList inputPaths, outputPaths;
+	batchRows.clear();
+	if (queueModel->beginPendingEntries(inputPaths, outputPaths,
+					    batchRows)) {
+		emit remuxBatch(inputPaths, outputPaths);
 	} else {
 		queueModel->autoRemux = autoRemux;
 		queueModel->endProcessing();
@@ -931,6 +945,12 @@ void OBSRemux::updateProgress(float percent)
 	ui->progressBar->setValue(percent * 10);
 }
 
+void OBSRemux::entryFinished(int entry, bool success)
+{
+	if (entry >= 0 && entry < batchRows.length())
+		queueModel->finishEntry(batchRows[entry], success);
+}
+
 void OBSRemux::remuxFinished(bool success)
 {
 	ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
@@ -1005,3 +1025,55 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 
 	emit remuxFinished(!stopped && success);
 }
+
+void RemuxWorker::remuxBatch(const QStringList &sources,
+			     const QStringList &targets)
+{
+	isWorking = true;
+
+	auto progress = [](void *data, size_t job, float percent) {
+		RemuxWorker *rw = static_cast<RemuxWorker *>(data);
+
+		QMutexLocker lock(&rw->updateMutex);
+
+		rw->batchProgress[job] = percent;
+
+		float total = 0.f;
+		for (float jobProgress : rw->batchProgress)
+			total += jobProgress;
+		rw->UpdateProgress(total / rw->batchProgress.size());
+
+		return rw->isWorking;
+	};
+
+	auto finished = [](void *data, size_t job, bool success) {
+		RemuxWorker *rw = static_cast<RemuxWorker *>(data);
+		emit rw->entryFinished((int)job, success);
+	};
+
+	bool success = false;
+
+	{
+		QMutexLocker lock(&updateMutex);
+		batchProgress.assign(sources.size(), 0.f);
+		batch = media_remux_batch_create(0);
+	}
+
+	for (int i = 0; i < sources.size(); i++)
+		media_remux_batch_add(batch, QT_TO_UTF8(sources[i]),
+				      QT_TO_UTF8(targets[i]));
+
+	if (media_remux_batch_start(batch, progress, finished, this))
+		success = media_remux_batch_wait(batch);
+
+	{
+		QMutexLocker lock(&updateMutex);
+		media_remux_batch_destroy(batch);
+		batch = nullptr;
+	}
+
+	bool stopped = !isWorking;
+	isWorking = false;
+
+	emit remuxFinished(!stopped && success);
+}
@@ -23,6 +23,7 @@
 #include <QThread>
 #include <QStyledItemDelegate>
 #include <memory>
+#include <vector>
 #include "ui_OBSRemux.h"
 
 #include <media-io/media-remux.h>
@@ -59,6 +60,8 @@ class OBSRemux : public QDialog {
 	bool autoRemux;
 	QString autoRemuxFile;
 
+	QList<int> batchRows;
+
 public:
 	explicit OBSRemux(const char *recPath, QWidget *parent = nullptr,
 			  bool autoRemux = false);
@@ -79,6 +82,7 @@ private slots:
 
 public slots:
 	void updateProgress(float percent);
+	void entryFinished(int entry, bool success);
 	void remuxFinished(bool success);
 	void beginRemux();
 	bool stopRemux();
@@ -87,6 +91,7 @@ public slots:
 
 signals:
 	void remux(const QString &source, const QString &target);
+	void remuxBatch(const QStringList &sources, const QStringList &targets);
 };
 
 class RemuxQueueModel : public QAbstractTableModel {
@@ -113,7 +118,9 @@ public:
 	bool checkForErrors() const;
 	void beginProcessing();
 	void endProcessing();
-	bool beginNextEntry(QString &inputPath, QString &outputPath);
+	bool beginPendingEntries(QStringList &inputPaths,
+				 QStringList &outputPaths, QList<int> &rows);
+	void finishEntry(int row, bool success);
 	void finishEntry(bool success);
 	bool canClearFinished() const;
 	void clearFinished();
@@ -147,14 +154,19 @@ class RemuxWorker : public QObject {
 	float lastProgress;
 	void UpdateProgress(float percent);
 
+	media_remux_batch_t batch = nullptr;
+	std::vector<float> batchProgress;
+
 	explicit RemuxWorker() : isWorking(false) {}
 	virtual ~RemuxWorker(){};
 
 private slots:
 	void remux(const QString &source, const QString &target);
+	void remuxBatch(const QStringList &sources, const QStringList &targets);
 
 signals:
 	void updateProgress(float percent);
+	void entryFinished(int entry, bool success);
 	void remuxFinished(bool success);
 
 	friend class OBSRemux;
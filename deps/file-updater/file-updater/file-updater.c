@@ -10,6 +10,11 @@
 	blog(LOG_WARNING, "%s" msg, info->log_prefix, ##__VA_ARGS__)
 #define info(msg, ...) blog(LOG_INFO, "%s" msg, info->log_prefix, ##__VA_ARGS__)
 
+/* files of a package come from the same host, with HTTP/2 they are all
+ * multiplexed over one of these connections */
+#define MAX_DOWNLOAD_CONNECTIONS 4
+#define CONNECT_TIMEOUT_SEC 15
+
 struct update_info {
 	char error[CURL_ERROR_SIZE];
 	struct curl_slist *header;
@@ -36,6 +41,7 @@ struct update_info {
 
 	pthread_t thread;
 	bool thread_created;
+	volatile bool cancel;
 	char *log_prefix;
 };
 
@@ -44,6 +50,8 @@ void update_info_destroy(struct update_info *info)
 	if (!info)
 		return;
 
+	/* aborts running transfers instead of waiting on a slow network */
+	os_atomic_set_bool(&info->cancel, true);
 	if (info->thread_created)
 		pthread_join(info->thread, NULL);
 
@@ -102,6 +110,34 @@ static size_t http_header(char *buffer, size_t size, size_t nitems,
 	return nitems * size;
 }
 
+static int http_progress(void *param, curl_off_t dltotal, curl_off_t dlnow,
+			 curl_off_t ultotal, curl_off_t ulnow)
+{
+	struct update_info *info = param;
+
+	UNUSED_PARAMETER(dltotal);
+	UNUSED_PARAMETER(dlnow);
+	UNUSED_PARAMETER(ultotal);
+	UNUSED_PARAMETER(ulnow);
+	return os_atomic_load_bool(&info->cancel) ? 1 : 0;
+}
+
+static void set_request_options(struct update_info *info, CURL *curl,
+				const char *url, char *error)
+{
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, info->header);
+	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, error);
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, CONNECT_TIMEOUT_SEC);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, http_progress);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, info);
+	curl_obs_set_revoke_setting(curl);
+}
+
 static bool do_http_request(struct update_info *info, const char *url,
 			    long *response_code)
 {
@@ -109,22 +145,13 @@ static bool do_http_request(struct update_info *info, const char *url,
 	uint8_t null_terminator = 0;
 
 	da_resize(info->file_data, 0);
-	curl_easy_setopt(info->curl, CURLOPT_URL, url);
-	curl_easy_setopt(info->curl, CURLOPT_HTTPHEADER, info->header);
-	curl_easy_setopt(info->curl, CURLOPT_ERRORBUFFER, info->error);
+	set_request_options(info, info->curl, url, info->error);
 	curl_easy_setopt(info->curl, CURLOPT_WRITEFUNCTION, http_write);
 	curl_easy_setopt(info->curl, CURLOPT_WRITEDATA, info);
-	curl_easy_setopt(info->curl, CURLOPT_FAILONERROR, true);
-	curl_easy_setopt(info->curl, CURLOPT_NOSIGNAL, 1);
-	curl_easy_setopt(info->curl, CURLOPT_ACCEPT_ENCODING, "");
-	curl_obs_set_revoke_setting(info->curl);
 
-	if (!info->remote_url) {
-		// We only care about headers from the main package file
-		curl_easy_setopt(info->curl, CURLOPT_HEADERFUNCTION,
-				 http_header);
-		curl_easy_setopt(info->curl, CURLOPT_HEADERDATA, info);
-	}
+	// We only care about headers from the main package file
+	curl_easy_setopt(info->curl, CURLOPT_HEADERFUNCTION, http_header);
+	curl_easy_setopt(info->curl, CURLOPT_HEADERDATA, info);
 
 	code = curl_easy_perform(info->curl);
 	if (code != CURLE_OK) {
@@ -308,22 +335,11 @@ static int update_local_version(struct update_info *info)
 	return cache_version;
 }
 
-static inline bool do_relative_http_request(struct update_info *info,
-					    const char *url, const char *file)
-{
-	long response_code;
-	char *full_url = get_path(url, file);
-	bool success = do_http_request(info, full_url, &response_code);
-	bfree(full_url);
-	return success && response_code == 200;
-}
-
-static inline void write_file_data(struct update_info *info,
+static inline void write_file_data(const uint8_t *data, size_t size,
 				   const char *base_path, const char *file)
 {
 	char *full_path = get_path(base_path, file);
-	os_quick_write_utf8_file(full_path, (char *)info->file_data.array,
-				 info->file_data.num - 1, false);
+	os_quick_write_utf8_file(full_path, (const char *)data, size, false);
 	bfree(full_path);
 }
 
@@ -342,9 +358,33 @@ static inline void replace_file(const char *src_base_path,
 	bfree(src_path);
 }
 
-static bool update_remote_files(void *param, obs_data_t *remote_file)
+struct remote_file {
+	char *name;
+	int version;
+	CURL *curl;
+	DARRAY(uint8_t) data;
+	char error[CURL_ERROR_SIZE];
+};
+
+struct remote_files {
+	struct update_info *info;
+	DARRAY(struct remote_file) files;
+};
+
+static size_t remote_file_write(uint8_t *ptr, size_t size, size_t nmemb,
+				struct remote_file *file)
 {
-	struct update_info *info = param;
+	size_t total = size * nmemb;
+	if (total)
+		da_push_back_array(file->data, ptr, total);
+
+	return total;
+}
+
+static bool add_remote_file(void *param, obs_data_t *remote_file)
+{
+	struct remote_files *remote = param;
+	struct update_info *info = remote->info;
 
 	struct file_update_data data = {
 		.name = obs_data_get_string(remote_file, "name"),
@@ -354,34 +394,154 @@ static bool update_remote_files(void *param, obs_data_t *remote_file)
 	if (!data.newer && data.found)
 		return true;
 
-	if (!do_relative_http_request(info, info->remote_url, data.name))
-		return true;
+	struct remote_file *file = da_push_back_new(remote->files);
+	file->name = bstrdup(data.name);
+	file->version = data.version;
+	return true;
+}
+
+static bool start_remote_file(struct update_info *info, CURLM *multi,
+			      struct remote_file *file)
+{
+	char *url = get_path(info->remote_url, file->name);
+
+	file->curl = curl_easy_init();
+	if (!file->curl) {
+		bfree(url);
+		return false;
+	}
+
+	set_request_options(info, file->curl, url, file->error);
+	curl_easy_setopt(file->curl, CURLOPT_WRITEFUNCTION, remote_file_write);
+	curl_easy_setopt(file->curl, CURLOPT_WRITEDATA, file);
+	curl_easy_setopt(file->curl, CURLOPT_PRIVATE, file);
+	curl_easy_setopt(file->curl, CURLOPT_HTTP_VERSION,
+			 (long)CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(file->curl, CURLOPT_PIPEWAIT, 1L);
+	bfree(url);
+
+	return curl_multi_add_handle(multi, file->curl) == CURLM_OK;
+}
+
+static void update_remote_file(struct update_info *info,
+			       struct remote_file *file)
+{
+	uint8_t null_terminator = 0;
+
+	da_push_back(file->data, &null_terminator);
 
 	if (info->callback) {
 		struct file_download_data download_data;
 		bool confirm;
 
-		download_data.name = data.name;
-		download_data.version = data.version;
-		download_data.buffer.da = info->file_data.da;
+		download_data.name = file->name;
+		download_data.version = file->version;
+		download_data.buffer.da = file->data.da;
 
 		confirm = info->callback(info->param, &download_data);
 
-		info->file_data.da = download_data.buffer.da;
+		file->data.da = download_data.buffer.da;
 
 		if (!confirm) {
 			info("Update file '%s' (version %d) rejected",
-			     data.name, data.version);
-			return true;
+			     file->name, file->version);
+			return;
 		}
 	}
 
-	write_file_data(info, info->temp, data.name);
-	replace_file(info->temp, info->cache, data.name);
+	write_file_data(file->data.array, file->data.num - 1, info->temp,
+			file->name);
+	replace_file(info->temp, info->cache, file->name);
 
-	info("Successfully updated file '%s' (version %d)", data.name,
-	     data.version);
-	return true;
+	info("Successfully updated file '%s' (version %d)", file->name,
+	     file->version);
+}
+
+static void finish_remote_files(struct update_info *info, CURLM *multi)
+{
+	CURLMsg *msg;
+	int left;
+
+	while ((msg = curl_multi_info_read(multi, &left))) {
+		struct remote_file *file;
+		long response_code = 0;
+
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &file);
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE,
+				  &response_code);
+
+		if (msg->data.result != CURLE_OK) {
+			warn("Remote update of file \"%s\" failed: %s",
+			     file->name, file->error);
+		} else if (response_code == 200) {
+			update_remote_file(info, file);
+		}
+	}
+}
+
+/* Downloads all files that changed at once, instead of one request after
+ * the other.  Returns false if the downloads were interrupted. */
+static bool download_remote_files(struct update_info *info)
+{
+	struct remote_files remote = {.info = info};
+	bool success = false;
+	CURLM *multi;
+	int running = 0;
+
+	enum_files(info->remote_package, add_remote_file, &remote);
+	if (!remote.files.num)
+		return true;
+
+	multi = curl_multi_init();
+	if (!multi) {
+		warn("Could not initialize Curl");
+		goto free_files;
+	}
+
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+			  (long)MAX_DOWNLOAD_CONNECTIONS);
+
+	for (size_t i = 0; i < remote.files.num; i++) {
+		if (!start_remote_file(info, multi, &remote.files.array[i]))
+			warn("Could not start download of file \"%s\"",
+			     remote.files.array[i].name);
+	}
+
+	do {
+		CURLMcode code = curl_multi_perform(multi, &running);
+		if (code == CURLM_OK && running)
+			code = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+		if (code != CURLM_OK) {
+			warn("Remote update failed: %s",
+			     curl_multi_strerror(code));
+			break;
+		}
+
+		finish_remote_files(info, multi);
+		success = !running;
+	} while (running && !os_atomic_load_bool(&info->cancel));
+
+	for (size_t i = 0; i < remote.files.num; i++) {
+		CURL *curl = remote.files.array[i].curl;
+		if (curl) {
+			curl_multi_remove_handle(multi, curl);
+			curl_easy_cleanup(curl);
+		}
+	}
+
+	curl_multi_cleanup(multi);
+
+free_files:
+	for (size_t i = 0; i < remote.files.num; i++) {
+		bfree(remote.files.array[i].name);
+		da_free(remote.files.array[i].data);
+	}
+	da_free(remote.files);
+	return success;
 }
 
 static void update_save_metadata(struct update_info *info)
@@ -432,7 +592,8 @@ static void update_remote_version(struct update_info *info, int cur_version)
 	if (remote_version <= cur_version)
 		return;
 
-	write_file_data(info, info->temp, "package.json");
+	write_file_data(info->file_data.array, info->file_data.num - 1,
+			info->temp, "package.json");
 
 	info->remote_url = obs_data_get_string(info->remote_package, "url");
 	if (!info->remote_url) {
@@ -440,8 +601,10 @@ static void update_remote_version(struct update_info *info, int cur_version)
 		return;
 	}
 
-	/* download new files */
-	enum_files(info->remote_package, update_remote_files, info);
+	/* download new files, the package is only replaced once they are all
+	 * done so an interrupted update is tried again next time */
+	if (!download_remote_files(info))
+		return;
 
 	replace_file(info->temp, info->cache, "package.json");
 
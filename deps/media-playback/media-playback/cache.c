@@ -16,6 +16,7 @@
 
 #include <media-io/audio-io.h>
 #include <util/platform.h>
+#include <sys/stat.h>
 
 #include "media-playback.h"
 #include "cache.h"
@@ -32,8 +33,201 @@ static bool mp_cache_reset(mp_cache_t *c);
 
 static int64_t base_sys_ts = 0;
 
-#define v_eof(c) (c->cur_v_idx == c->video_frames.num)
-#define a_eof(c) (c->cur_a_idx == c->audio_segments.num)
+#define MP_CACHE_DEFAULT_LIMIT (1024ULL * 1024ULL * 1024ULL)
+
+struct mp_cache_clip {
+	char *path;
+	char *format_name;
+	char *ffmpeg_options;
+	int speed;
+	time_t mtime;
+
+	/* protected by clips_mutex */
+	long refs;
+	bool listed;
+
+	/* written by the owning cache's thread until decoded is signalled */
+	os_event_t *decoded;
+	bool finished;
+	bool ready;
+	uint64_t size;
+
+	bool has_video;
+	bool has_audio;
+	int64_t media_duration;
+	int64_t start_time;
+	int64_t final_v_duration;
+	int64_t final_a_duration;
+
+	DARRAY(struct obs_source_frame) video_frames;
+	DARRAY(struct obs_source_audio) audio_segments;
+};
+
+/* clips are ordered from least to most recently used */
+static pthread_mutex_t clips_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct mp_cache_clip *) clips;
+static uint64_t clips_size = 0;
+static uint64_t clips_limit = MP_CACHE_DEFAULT_LIMIT;
+
+static inline bool str_equal(const char *a, const char *b)
+{
+	return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+static time_t get_mtime(const char *path)
+{
+	struct stat st;
+	return path && os_stat(path, &st) == 0 ? st.st_mtime : 0;
+}
+
+static void clip_free(struct mp_cache_clip *clip)
+{
+	for (size_t i = 0; i < clip->video_frames.num; i++) {
+		struct obs_source_frame *f = &clip->video_frames.array[i];
+		obs_source_frame_free(f);
+	}
+	for (size_t i = 0; i < clip->audio_segments.num; i++) {
+		struct obs_source_audio *a = &clip->audio_segments.array[i];
+		bfree((void *)a->data[0]);
+	}
+	da_free(clip->video_frames);
+	da_free(clip->audio_segments);
+
+	os_event_destroy(clip->decoded);
+	bfree(clip->path);
+	bfree(clip->format_name);
+	bfree(clip->ffmpeg_options);
+	bfree(clip);
+}
+
+/* frees unused clips, oldest first, until the cache fits into its limit */
+static void clips_trim(uint64_t limit)
+{
+	size_t i = 0;
+
+	while (clips_size > limit && i < clips.num) {
+		struct mp_cache_clip *clip = clips.array[i];
+
+		if (clip->refs) {
+			i++;
+			continue;
+		}
+
+		da_erase(clips, i);
+		clips_size -= clip->size;
+		clip_free(clip);
+	}
+}
+
+static struct mp_cache_clip *clip_acquire(const struct mp_media_info *info,
+					  time_t mtime)
+{
+	for (size_t i = 0; i < clips.num; i++) {
+		struct mp_cache_clip *clip = clips.array[i];
+
+		if (clip->speed == info->speed && clip->mtime == mtime &&
+		    str_equal(clip->path, info->path) &&
+		    str_equal(clip->format_name, info->format) &&
+		    str_equal(clip->ffmpeg_options, info->ffmpeg_options)) {
+			da_erase(clips, i);
+			da_push_back(clips, &clip);
+			clip->refs++;
+			return clip;
+		}
+	}
+
+	return NULL;
+}
+
+static struct mp_cache_clip *clip_create(const struct mp_media_info *info,
+					 time_t mtime, mp_media_t *m)
+{
+	struct mp_cache_clip *clip = bzalloc(sizeof(*clip));
+
+	if (os_event_init(&clip->decoded, OS_EVENT_TYPE_MANUAL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init event");
+		bfree(clip);
+		return NULL;
+	}
+
+	clip->path = bstrdup(info->path);
+	clip->format_name = info->format ? bstrdup(info->format) : NULL;
+	clip->ffmpeg_options =
+		info->ffmpeg_options ? bstrdup(info->ffmpeg_options) : NULL;
+	clip->speed = info->speed;
+	clip->mtime = mtime;
+	clip->has_video = m->has_video;
+	clip->has_audio = m->has_audio;
+	clip->media_duration = m->fmt->duration;
+	clip->refs = 1;
+	clip->listed = true;
+
+	da_push_back(clips, &clip);
+	return clip;
+}
+
+static void clip_finish(struct mp_cache_clip *clip, bool success)
+{
+	pthread_mutex_lock(&clips_mutex);
+
+	clip->finished = true;
+	clip->ready = success;
+
+	if (success) {
+		clips_size += clip->size;
+		clips_trim(clips_limit);
+	} else {
+		/* let the next cache that opens this file try again */
+		da_erase_item(clips, &clip);
+		clip->listed = false;
+	}
+
+	pthread_mutex_unlock(&clips_mutex);
+
+	os_event_signal(clip->decoded);
+}
+
+static void clip_release(struct mp_cache_clip *clip)
+{
+	bool destroy;
+
+	pthread_mutex_lock(&clips_mutex);
+	destroy = --clip->refs == 0 && !clip->listed;
+	if (!clip->refs && clip->listed) {
+		da_erase_item(clips, &clip);
+		da_push_back(clips, &clip);
+		clips_trim(clips_limit);
+	}
+	pthread_mutex_unlock(&clips_mutex);
+
+	if (destroy)
+		clip_free(clip);
+}
+
+static uint64_t frame_size(const struct obs_source_frame *frame)
+{
+	uint64_t size = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++) {
+		uint32_t height = frame->height;
+
+		/* chroma planes of 4:2:0 formats are half height */
+		if (i > 0 && i < 3 &&
+		    (frame->format == VIDEO_FORMAT_I420 ||
+		     frame->format == VIDEO_FORMAT_NV12 ||
+		     frame->format == VIDEO_FORMAT_I40A ||
+		     frame->format == VIDEO_FORMAT_I010 ||
+		     frame->format == VIDEO_FORMAT_P010))
+			height = (height + 1) / 2;
+
+		size += (uint64_t)frame->linesize[i] * height;
+	}
+
+	return size;
+}
+
+#define v_eof(c) (c->cur_v_idx == c->clip->video_frames.num)
+#define a_eof(c) (c->cur_a_idx == c->clip->audio_segments.num)
 
 static inline int64_t mp_cache_get_next_min_pts(mp_cache_t *c)
 {
@@ -64,7 +258,7 @@ static inline int64_t mp_cache_get_base_pts(mp_cache_t *c)
 static void reset_ts(mp_cache_t *c)
 {
 	c->base_ts += mp_cache_get_base_pts(c);
-	c->play_sys_ts = (int64_t)os_gettime_ns();
+	c->play_sys_ts = (int64_t)obs_get_clock_ns();
 	c->start_ts = c->next_pts_ns = mp_cache_get_next_min_pts(c);
 	c->next_ns = 0;
 }
@@ -74,9 +268,12 @@ static inline bool mp_cache_sleep(mp_cache_t *c)
 	bool timeout = false;
 
 	if (!c->next_ns) {
-		c->next_ns = os_gettime_ns();
+		c->next_ns = obs_get_clock_ns();
+	} else if (c->clock_hold) {
+		timeout = !obs_clock_hold_wait(c->clock_hold, c->next_ns,
+					       200);
 	} else {
-		const uint64_t t = os_gettime_ns();
+		const uint64_t t = obs_get_clock_ns();
 		if (c->next_ns > t) {
 			const uint32_t delta_ms =
 				(uint32_t)((c->next_ns - t + 500000) / 1000000);
@@ -132,9 +329,9 @@ bool mp_cache_decode(mp_cache_t *c)
 
 	success = true;
 
-	c->start_time = c->m.fmt->start_time;
-	if (c->start_time == AV_NOPTS_VALUE)
-		c->start_time = 0;
+	c->clip->start_time = c->m.fmt->start_time;
+	if (c->clip->start_time == AV_NOPTS_VALUE)
+		c->clip->start_time = 0;
 
 fail:
 	mp_media_free(m);
@@ -154,8 +351,8 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 	if (c->has_video) {
 		struct obs_source_frame *v;
 
-		for (size_t i = 0; i < c->video_frames.num; i++) {
-			v = &c->video_frames.array[i];
+		for (size_t i = 0; i < c->clip->video_frames.num; i++) {
+			v = &c->clip->video_frames.array[i];
 			new_v_idx = i;
 			if ((int64_t)v->timestamp >= pos) {
 				break;
@@ -163,19 +360,19 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		}
 
 		size_t next_idx = new_v_idx + 1;
-		if (next_idx == c->video_frames.num) {
-			c->next_v_ts =
-				(int64_t)v->timestamp + c->final_v_duration;
+		if (next_idx == c->clip->video_frames.num) {
+			c->next_v_ts = (int64_t)v->timestamp +
+				       c->clip->final_v_duration;
 		} else {
 			struct obs_source_frame *next =
-				&c->video_frames.array[next_idx];
+				&c->clip->video_frames.array[next_idx];
 			c->next_v_ts = (int64_t)next->timestamp;
 		}
 	}
 	if (c->has_audio) {
 		struct obs_source_audio *a;
-		for (size_t i = 0; i < c->audio_segments.num; i++) {
-			a = &c->audio_segments.array[i];
+		for (size_t i = 0; i < c->clip->audio_segments.num; i++) {
+			a = &c->clip->audio_segments.array[i];
 			new_a_idx = i;
 			if ((int64_t)a->timestamp >= pos) {
 				break;
@@ -183,12 +380,12 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		}
 
 		size_t next_idx = new_a_idx + 1;
-		if (next_idx == c->audio_segments.num) {
-			c->next_a_ts =
-				(int64_t)a->timestamp + c->final_a_duration;
+		if (next_idx == c->clip->audio_segments.num) {
+			c->next_a_ts = (int64_t)a->timestamp +
+				       c->clip->final_a_duration;
 		} else {
 			struct obs_source_audio *next =
-				&c->audio_segments.array[next_idx];
+				&c->clip->audio_segments.array[next_idx];
 			c->next_a_ts = (int64_t)next->timestamp;
 		}
 	}
@@ -215,12 +412,12 @@ static inline bool mp_media_can_play_audio(mp_cache_t *c)
 static inline void calc_next_v_ts(mp_cache_t *c, struct obs_source_frame *frame)
 {
 	int64_t offset;
-	if (c->next_v_idx < c->video_frames.num) {
+	if (c->next_v_idx < c->clip->video_frames.num) {
 		struct obs_source_frame *next =
-			&c->video_frames.array[c->next_v_idx];
+			&c->clip->video_frames.array[c->next_v_idx];
 		offset = (int64_t)(next->timestamp - frame->timestamp);
 	} else {
-		offset = c->final_v_duration;
+		offset = c->clip->final_v_duration;
 	}
 
 	c->next_v_ts += offset;
@@ -229,12 +426,12 @@ static inline void calc_next_v_ts(mp_cache_t *c, struct obs_source_frame *frame)
 static inline void calc_next_a_ts(mp_cache_t *c, struct obs_source_audio *audio)
 {
 	int64_t offset;
-	if (c->next_a_idx < c->audio_segments.num) {
+	if (c->next_a_idx < c->clip->audio_segments.num) {
 		struct obs_source_audio *next =
-			&c->audio_segments.array[c->next_a_idx];
+			&c->clip->audio_segments.array[c->next_a_idx];
 		offset = (int64_t)(next->timestamp - audio->timestamp);
 	} else {
-		offset = c->final_a_duration;
+		offset = c->clip->final_a_duration;
 	}
 
 	c->next_a_ts += offset;
@@ -243,15 +440,17 @@ static inline void calc_next_a_ts(mp_cache_t *c, struct obs_source_audio *audio)
 static void mp_cache_next_video(mp_cache_t *c, bool preload)
 {
 	/* eof check */
-	if (c->next_v_idx == c->video_frames.num) {
+	if (c->next_v_idx == c->clip->video_frames.num) {
 		if (mp_media_can_play_video(c))
 			c->cur_v_idx = c->next_v_idx;
 		return;
 	}
 
-	struct obs_source_frame *frame = &c->video_frames.array[c->next_v_idx];
+	struct obs_source_frame *frame =
+		&c->clip->video_frames.array[c->next_v_idx];
 	struct obs_source_frame dup = *frame;
 
+	dup.flags = c->is_linear_alpha ? OBS_SOURCE_FRAME_LINEAR_ALPHA : 0;
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts +
 			c->play_sys_ts - base_sys_ts;
 
@@ -278,7 +477,7 @@ static void mp_cache_next_video(mp_cache_t *c, bool preload)
 static void mp_cache_next_audio(mp_cache_t *c)
 {
 	/* eof check */
-	if (c->next_a_idx == c->audio_segments.num) {
+	if (c->next_a_idx == c->clip->audio_segments.num) {
 		if (mp_media_can_play_audio(c))
 			c->cur_a_idx = c->next_a_idx;
 		return;
@@ -288,7 +487,7 @@ static void mp_cache_next_audio(mp_cache_t *c)
 		return;
 
 	struct obs_source_audio *audio =
-		&c->audio_segments.array[c->next_a_idx];
+		&c->clip->audio_segments.array[c->next_a_idx];
 	struct obs_source_audio dup = *audio;
 
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts +
@@ -309,7 +508,7 @@ static bool mp_cache_reset(mp_cache_t *c)
 
 	int64_t next_ts = mp_cache_get_base_pts(c);
 	int64_t offset = next_ts - c->next_pts_ns;
-	int64_t start_time = c->start_time;
+	int64_t start_time = c->clip->start_time;
 
 	c->eof = false;
 	c->base_ts += next_ts;
@@ -324,25 +523,26 @@ static bool mp_cache_reset(mp_cache_t *c)
 	pthread_mutex_unlock(&c->mutex);
 
 	if (c->has_video) {
-		size_t next_idx = c->video_frames.num > 1 ? 1 : 0;
+		size_t next_idx = c->clip->video_frames.num > 1 ? 1 : 0;
 		c->cur_v_idx = c->next_v_idx = 0;
-		c->next_v_ts = c->video_frames.array[next_idx].timestamp;
+		c->next_v_ts = c->clip->video_frames.array[next_idx].timestamp;
 	}
 	if (c->has_audio) {
-		size_t next_idx = c->audio_segments.num > 1 ? 1 : 0;
+		size_t next_idx = c->clip->audio_segments.num > 1 ? 1 : 0;
 		c->cur_a_idx = c->next_a_idx = 0;
-		c->next_a_ts = c->audio_segments.array[next_idx].timestamp;
+		c->next_a_ts =
+			c->clip->audio_segments.array[next_idx].timestamp;
 	}
 
 	if (active) {
 		if (!c->play_sys_ts)
-			c->play_sys_ts = (int64_t)os_gettime_ns();
+			c->play_sys_ts = (int64_t)obs_get_clock_ns();
 		c->start_ts = c->next_pts_ns = mp_cache_get_next_min_pts(c);
 		if (c->next_ns)
 			c->next_ns += offset;
 	} else {
 		c->start_ts = c->next_pts_ns = mp_cache_get_next_min_pts(c);
-		c->play_sys_ts = (int64_t)os_gettime_ns();
+		c->play_sys_ts = (int64_t)obs_get_clock_ns();
 		c->next_ns = 0;
 	}
 
@@ -377,11 +577,34 @@ static void mp_cache_calc_next_ns(mp_cache_t *c)
 	c->next_pts_ns = min_next_ns;
 }
 
+static void mp_cache_preload_first(mp_cache_t *c)
+{
+	struct obs_source_frame dup = c->clip->video_frames.array[0];
+
+	dup.flags = c->is_linear_alpha ? OBS_SOURCE_FRAME_LINEAR_ALPHA : 0;
+	c->v_preload_cb(c->opaque, &dup);
+}
+
+/* the cache that created the clip decodes it, all others wait for it */
+static bool mp_cache_wait_clip(mp_cache_t *c)
+{
+	struct mp_cache_clip *clip = c->clip;
+
+	if (c->clip_owner) {
+		bool success = mp_cache_decode(c);
+		clip_finish(clip, success);
+		return success;
+	}
+
+	os_event_wait(clip->decoded);
+	return clip->ready;
+}
+
 static inline bool mp_cache_thread(mp_cache_t *c)
 {
 	os_set_thread_name("mp_cache_thread");
 
-	if (!mp_cache_decode(c)) {
+	if (!mp_cache_wait_clip(c)) {
 		return false;
 	}
 
@@ -397,6 +620,7 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 		pthread_mutex_unlock(&c->mutex);
 
 		if (!is_active || pause) {
+			obs_clock_hold_set(c->clock_hold, 0);
 			if (os_sem_wait(c->sem) < 0)
 				return false;
 			if (pause)
@@ -446,7 +670,7 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 			continue;
 
 		if (preload_frame)
-			c->v_preload_cb(c->opaque, &c->video_frames.array[0]);
+			mp_cache_preload_first(c);
 
 		/* frames are ready */
 		if (is_active && !timeout) {
@@ -459,6 +683,7 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 				continue;
 
 			mp_cache_calc_next_ns(c);
+			obs_clock_hold_set(c->clock_hold, c->next_ns);
 		}
 	}
 
@@ -488,9 +713,10 @@ static void fill_video(void *data, struct obs_source_frame *frame)
 
 	dup.timestamp = frame->timestamp;
 
-	c->final_v_duration = c->m.v.last_duration;
+	c->clip->final_v_duration = c->m.v.last_duration;
+	c->clip->size += frame_size(&dup);
 
-	da_push_back(c->video_frames, &dup);
+	da_push_back(c->clip->video_frames, &dup);
 }
 
 static void fill_audio(void *data, struct obs_source_audio *audio)
@@ -518,9 +744,11 @@ static void fill_audio(void *data, struct obs_source_audio *audio)
 		memcpy((uint8_t *)dup.data[0], audio->data[0], size);
 	}
 
-	c->final_a_duration = c->m.a.last_duration;
+	c->clip->final_a_duration = c->m.a.last_duration;
+	c->clip->size += get_total_audio_size(dup.format, dup.speakers,
+					      dup.frames);
 
-	da_push_back(c->audio_segments, &dup);
+	da_push_back(c->clip->audio_segments, &dup);
 }
 
 static inline bool mp_cache_init_internal(mp_cache_t *c,
@@ -537,6 +765,7 @@ static inline bool mp_cache_init_internal(mp_cache_t *c,
 
 	c->path = info->path ? bstrdup(info->path) : NULL;
 	c->format_name = info->format ? bstrdup(info->format) : NULL;
+	c->clock_hold = obs_clock_hold_create();
 
 	if (pthread_create(&c->thread, NULL, mp_cache_thread_start, c) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
@@ -557,19 +786,44 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	info2.v_preload_cb = NULL;
 	info2.v_seek_cb = NULL;
 	info2.stop_cb = NULL;
+	info2.v_gpu_cb = NULL;
+	info2.index_dir = NULL;
 	info2.full_decode = true;
 
 	mp_media_t *m = &c->m;
+	time_t mtime = get_mtime(info->path);
 
 	pthread_mutex_init_value(&c->mutex);
 
-	if (!mp_media_init(m, &info2)) {
-		mp_cache_free(c);
-		return false;
-	}
-	if (!mp_media_init2(m)) {
-		mp_cache_free(c);
-		return false;
+	pthread_mutex_lock(&clips_mutex);
+	c->clip = clip_acquire(info, mtime);
+	pthread_mutex_unlock(&clips_mutex);
+
+	if (!c->clip) {
+		if (!mp_media_init(m, &info2)) {
+			mp_cache_free(c);
+			return false;
+		}
+		if (!mp_media_init2(m)) {
+			mp_cache_free(c);
+			return false;
+		}
+
+		/* another cache may have opened the same file meanwhile */
+		pthread_mutex_lock(&clips_mutex);
+		c->clip = clip_acquire(info, mtime);
+		if (!c->clip) {
+			c->clip = clip_create(info, mtime, m);
+			c->clip_owner = true;
+		}
+		pthread_mutex_unlock(&clips_mutex);
+
+		if (!c->clip) {
+			mp_cache_free(c);
+			return false;
+		}
+		if (!c->clip_owner)
+			mp_media_free(m);
 	}
 
 	c->opaque = info->opaque;
@@ -581,13 +835,14 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	c->v_preload_cb = info->v_preload_cb;
 	c->request_preload = info->request_preload;
 	c->speed = info->speed;
-	c->media_duration = m->fmt->duration;
+	c->is_linear_alpha = info->is_linear_alpha;
+	c->media_duration = c->clip->media_duration;
 
-	c->has_video = m->has_video;
-	c->has_audio = m->has_audio;
+	c->has_video = c->clip->has_video;
+	c->has_audio = c->clip->has_audio;
 
 	if (!base_sys_ts)
-		base_sys_ts = (int64_t)os_gettime_ns();
+		base_sys_ts = (int64_t)obs_get_clock_ns();
 
 	if (!mp_cache_init_internal(c, info)) {
 		mp_cache_free(c);
@@ -616,20 +871,17 @@ void mp_cache_free(mp_cache_t *c)
 
 	mp_cache_stop(c);
 	mp_kill_thread(c);
+	obs_clock_hold_destroy(c->clock_hold);
 
 	if (c->m.fmt)
 		mp_media_free(&c->m);
 
-	for (size_t i = 0; i < c->video_frames.num; i++) {
-		struct obs_source_frame *f = &c->video_frames.array[i];
-		obs_source_frame_free(f);
-	}
-	for (size_t i = 0; i < c->audio_segments.num; i++) {
-		struct obs_source_audio *a = &c->audio_segments.array[i];
-		bfree((void *)a->data[0]);
+	if (c->clip) {
+		/* the thread never got to decode the clip */
+		if (c->clip_owner && !c->clip->finished)
+			clip_finish(c->clip, false);
+		clip_release(c->clip);
 	}
-	da_free(c->video_frames);
-	da_free(c->audio_segments);
 
 	bfree(c->path);
 	bfree(c->format_name);
@@ -650,6 +902,8 @@ void mp_cache_play(mp_cache_t *c, bool loop)
 
 	pthread_mutex_unlock(&c->mutex);
 
+	/* don't let the clock run ahead before the first frame is out */
+	obs_clock_hold_set(c->clock_hold, obs_get_clock_ns());
 	os_sem_post(c->sem);
 }
 
@@ -707,10 +961,35 @@ void mp_cache_seek(mp_cache_t *c, int64_t pos)
 
 int64_t mp_cache_get_frames(mp_cache_t *c)
 {
-	return c->video_frames.num;
+	return c->clip ? c->clip->video_frames.num : 0;
 }
 
 int64_t mp_cache_get_duration(mp_cache_t *c)
 {
 	return c->media_duration;
 }
+
+void mp_cache_set_limit(uint64_t bytes)
+{
+	pthread_mutex_lock(&clips_mutex);
+	clips_limit = bytes;
+	clips_trim(clips_limit);
+	pthread_mutex_unlock(&clips_mutex);
+}
+
+void mp_cache_purge(void)
+{
+	pthread_mutex_lock(&clips_mutex);
+	for (size_t i = clips.num; i > 0; i--) {
+		struct mp_cache_clip *clip = clips.array[i - 1];
+
+		if (!clip->refs) {
+			da_erase(clips, i - 1);
+			clips_size -= clip->size;
+			clip_free(clip);
+		}
+	}
+	if (!clips.num)
+		da_free(clips);
+	pthread_mutex_unlock(&clips_mutex);
+}
@@ -22,6 +22,11 @@
 
 #include "media.h"
 
+/* Decoded frames of a clip, shared by every cache that plays the same file
+ * with the same options.  Clips that are no longer used are kept around
+ * until the total size of all clips exceeds the cache limit. */
+struct mp_cache_clip;
+
 struct mp_cache {
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
@@ -32,6 +37,7 @@ struct mp_cache {
 	bool request_preload;
 	bool has_video;
 	bool has_audio;
+	bool is_linear_alpha;
 
 	char *path;
 	char *format_name;
@@ -51,8 +57,8 @@ struct mp_cache {
 	bool thread_valid;
 	pthread_t thread;
 
-	DARRAY(struct obs_source_frame) video_frames;
-	DARRAY(struct obs_source_audio) audio_segments;
+	struct mp_cache_clip *clip;
+	bool clip_owner;
 
 	size_t cur_v_idx;
 	size_t cur_a_idx;
@@ -61,12 +67,11 @@ struct mp_cache {
 	int64_t next_v_ts;
 	int64_t next_a_ts;
 
-	int64_t final_v_duration;
-	int64_t final_a_duration;
-
 	int64_t play_sys_ts;
 	int64_t next_pts_ns;
 	uint64_t next_ns;
+	/* offline rendering waits for the frame at next_ns */
+	obs_clock_hold_t *clock_hold;
 	int64_t start_ts;
 	int64_t base_ts;
 
@@ -76,7 +81,6 @@ struct mp_cache {
 	bool seek_next_ts;
 	bool eof;
 	int64_t seek_pos;
-	int64_t start_time;
 	int64_t media_duration;
 
 	mp_media_t m;
@@ -95,3 +99,6 @@ extern int64_t mp_cache_get_current_time(mp_cache_t *c);
 extern void mp_cache_seek(mp_cache_t *c, int64_t pos);
 extern int64_t mp_cache_get_frames(mp_cache_t *c);
 extern int64_t mp_cache_get_duration(mp_cache_t *c);
+
+extern void mp_cache_set_limit(uint64_t bytes);
+extern void mp_cache_purge(void);
@@ -19,6 +19,13 @@
 #include "media-playback.h"
 #include "media.h"
 #include <libavutil/mastering_display_metadata.h>
+#include <libavutil/hwcontext.h>
+
+#ifdef __linux__
+#include <libavutil/hwcontext_drm.h>
+#define MP_GPU_FRAMES 1
+#define MP_DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
+#endif
 
 enum AVHWDeviceType hw_priority[] = {
 	AV_HWDEVICE_TYPE_CUDA,         AV_HWDEVICE_TYPE_D3D11VA,
@@ -55,8 +62,10 @@ static void init_hw_decoder(struct mp_decode *d, AVCodecContext *c)
 		if (has_hw_type(d->codec, *priority, &d->hw_format)) {
 			int ret = av_hwdevice_ctx_create(&hw_ctx, *priority,
 							 NULL, NULL, 0);
-			if (ret == 0)
+			if (ret == 0) {
+				d->hw_type = *priority;
 				break;
+			}
 		}
 
 		priority++;
@@ -217,6 +226,15 @@ bool mp_decode_init(mp_media_t *m, enum AVMediaType type, bool hw)
 		d->in_frame = d->sw_frame;
 	}
 
+#ifdef MP_GPU_FRAMES
+	/* VA-API surfaces can be exported as dma-bufs and imported by the
+	 * renderer, other hardware frames are still downloaded */
+	d->gpu_frames = d->hw && m->v_gpu_cb &&
+			d->hw_type == AV_HWDEVICE_TYPE_VAAPI;
+	if (d->gpu_frames)
+		blog(LOG_INFO, "MP: keeping hardware frames on the GPU");
+#endif
+
 #if LIBAVCODEC_VERSION_MAJOR < 60
 	if (d->codec->capabilities & CODEC_CAP_TRUNC)
 		d->decoder->flags |= CODEC_FLAG_TRUNC;
@@ -337,31 +355,44 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 			return ret;
 		}
 
-		/* does not check for color format or other parameter changes which would require frame buffer realloc */
-		if (d->sw_frame->data[0] &&
-		    (d->sw_frame->width != d->hw_frame->width ||
-		     d->sw_frame->height != d->hw_frame->height)) {
-			blog(LOG_DEBUG,
-			     "MP: hardware frame size changed from %dx%d to %dx%d. reallocating frame",
-			     d->sw_frame->width, d->sw_frame->height,
-			     d->hw_frame->width, d->hw_frame->height);
-			av_frame_unref(d->sw_frame);
+		if (d->gpu_frames) {
+			d->frame = d->hw_frame;
+			return ret;
 		}
 
-		int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
-		if (err == 0) {
-			err = av_frame_copy_props(d->sw_frame, d->hw_frame);
-		}
-		if (err) {
+		if (!mp_decode_download(d)) {
 			ret = 0;
 			*got_frame = false;
 		}
+		return ret;
 	}
 
 	d->frame = d->sw_frame;
 	return ret;
 }
 
+bool mp_decode_download(struct mp_decode *d)
+{
+	/* does not check for color format or other parameter changes which would require frame buffer realloc */
+	if (d->sw_frame->data[0] &&
+	    (d->sw_frame->width != d->hw_frame->width ||
+	     d->sw_frame->height != d->hw_frame->height)) {
+		blog(LOG_DEBUG,
+		     "MP: hardware frame size changed from %dx%d to %dx%d. reallocating frame",
+		     d->sw_frame->width, d->sw_frame->height,
+		     d->hw_frame->width, d->hw_frame->height);
+		av_frame_unref(d->sw_frame);
+	}
+
+	int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
+	if (err == 0) {
+		err = av_frame_copy_props(d->sw_frame, d->hw_frame);
+	}
+
+	d->frame = d->sw_frame;
+	return err == 0;
+}
+
 bool mp_decode_next(struct mp_decode *d)
 {
 	bool eof = d->m->eof;
@@ -473,3 +504,137 @@ void mp_decode_flush(struct mp_decode *d)
 	d->frame_ready = false;
 	d->next_pts = 0;
 }
+
+#ifdef MP_GPU_FRAMES
+struct mp_gpu_frame {
+	AVFrame *drm;
+	enum video_format format;
+};
+#endif
+
+enum video_format mp_gpu_frame_format(const AVFrame *frame)
+{
+	if (!frame->hw_frames_ctx)
+		return VIDEO_FORMAT_NONE;
+
+	const AVHWFramesContext *ctx =
+		(const AVHWFramesContext *)frame->hw_frames_ctx->data;
+
+	switch (ctx->sw_format) {
+	case AV_PIX_FMT_NV12:
+		return VIDEO_FORMAT_NV12;
+	case AV_PIX_FMT_P010LE:
+		return VIDEO_FORMAT_P010;
+	default:
+		return VIDEO_FORMAT_NONE;
+	}
+}
+
+void *mp_gpu_frame_create(const AVFrame *frame)
+{
+#ifdef MP_GPU_FRAMES
+	enum video_format format = mp_gpu_frame_format(frame);
+	if (format == VIDEO_FORMAT_NONE)
+		return NULL;
+
+	AVFrame *drm = av_frame_alloc();
+	if (!drm)
+		return NULL;
+
+	/* the mapping keeps a reference to the hardware surface, so the
+	 * decoder won't reuse it until the frame is released */
+	drm->format = AV_PIX_FMT_DRM_PRIME;
+	if (av_hwframe_map(drm, frame, AV_HWFRAME_MAP_READ) < 0) {
+		av_frame_free(&drm);
+		return NULL;
+	}
+
+	struct mp_gpu_frame *gpu_frame = bmalloc(sizeof(*gpu_frame));
+	gpu_frame->drm = drm;
+	gpu_frame->format = format;
+	return gpu_frame;
+#else
+	UNUSED_PARAMETER(frame);
+	return NULL;
+#endif
+}
+
+bool mp_gpu_frame_import(void *param, gs_texture_t *textures[MAX_AV_PLANES])
+{
+#ifdef MP_GPU_FRAMES
+	struct mp_gpu_frame *gpu_frame = param;
+	const AVFrame *drm = gpu_frame->drm;
+	const AVDRMFrameDescriptor *desc =
+		(const AVDRMFrameDescriptor *)drm->data[0];
+	const bool p010 = gpu_frame->format == VIDEO_FORMAT_P010;
+	const enum gs_color_format formats[2] = {
+		p010 ? GS_R16 : GS_R8,
+		p010 ? GS_RG16 : GS_R8G8,
+	};
+
+	/* VA-API exports each plane as its own layer */
+	if (desc->nb_layers != 2)
+		return false;
+
+	for (int i = 0; i < 2; i++) {
+		const AVDRMLayerDescriptor *layer = &desc->layers[i];
+		const AVDRMPlaneDescriptor *plane = &layer->planes[0];
+		const AVDRMObjectDescriptor *object =
+			&desc->objects[plane->object_index];
+		const uint32_t cx = i ? (drm->width + 1) / 2 : drm->width;
+		const uint32_t cy = i ? (drm->height + 1) / 2 : drm->height;
+		const int fd = object->fd;
+		const uint32_t stride = (uint32_t)plane->pitch;
+		const uint32_t offset = (uint32_t)plane->offset;
+		const uint64_t modifier = object->format_modifier;
+
+		textures[i] = gs_texture_create_from_dmabuf(
+			cx, cy, layer->format, formats[i], 1, &fd, &stride,
+			&offset,
+			modifier != MP_DRM_FORMAT_MOD_INVALID ? &modifier
+							      : NULL);
+		if (!textures[i]) {
+			gs_texture_destroy(textures[0]);
+			textures[0] = NULL;
+			return false;
+		}
+	}
+
+	return true;
+#else
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(textures);
+	return false;
+#endif
+}
+
+/* the clone references the same hardware surface */
+void *mp_gpu_frame_clone(void *param)
+{
+#ifdef MP_GPU_FRAMES
+	struct mp_gpu_frame *gpu_frame = param;
+
+	AVFrame *drm = av_frame_clone(gpu_frame->drm);
+	if (!drm)
+		return NULL;
+
+	struct mp_gpu_frame *clone = bmalloc(sizeof(*clone));
+	clone->drm = drm;
+	clone->format = gpu_frame->format;
+	return clone;
+#else
+	UNUSED_PARAMETER(param);
+	return NULL;
+#endif
+}
+
+void mp_gpu_frame_release(void *param)
+{
+#ifdef MP_GPU_FRAMES
+	struct mp_gpu_frame *gpu_frame = param;
+	av_frame_free(&gpu_frame->drm);
+	bfree(gpu_frame);
+#else
+	UNUSED_PARAMETER(param);
+#endif
+}
@@ -30,6 +30,7 @@ extern "C" {
 
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
 #include <util/threading.h>
 
 #ifdef _MSC_VER
@@ -50,6 +51,7 @@ struct mp_decode {
 
 	AVCodecContext *decoder;
 	AVBufferRef *hw_ctx;
+	enum AVHWDeviceType hw_type;
 	const AVCodec *codec;
 
 	int64_t last_duration;
@@ -64,6 +66,9 @@ struct mp_decode {
 	bool frame_ready;
 	bool eof;
 	bool hw;
+	/* hardware frames are handed out as d->frame = d->hw_frame instead of
+	 * being downloaded, see mp_media_next_video */
+	bool gpu_frames;
 	uint16_t max_luminance;
 
 	AVPacket *orig_pkt;
@@ -80,6 +85,11 @@ extern void mp_decode_clear_packets(struct mp_decode *decode);
 
 extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
+extern bool mp_decode_download(struct mp_decode *decode);
+
+extern enum video_format mp_gpu_frame_format(const AVFrame *frame);
+extern void *mp_gpu_frame_create(const AVFrame *frame);
+extern void *mp_gpu_frame_clone(void *gpu_frame);
 extern void mp_decode_flush(struct mp_decode *decode);
 
 #ifdef __cplusplus
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <util/file-serializer.h>
+#include <util/platform.h>
+#include <util/crc32.h>
+#include <util/dstr.h>
+#include <sys/stat.h>
+#include <inttypes.h>
+
+#include "index.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4204)
+#endif
+
+#include <libavformat/avformat.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define INDEX_MAGIC 0x5844494DU /* "MIDX" */
+#define INDEX_VERSION 1
+
+struct index_header {
+	uint32_t magic;
+	uint32_t version;
+	int64_t file_size;
+	int64_t file_mtime;
+	int32_t stream_index;
+	int32_t time_base_num;
+	int32_t time_base_den;
+	uint32_t path_len;
+	uint64_t count;
+};
+
+static void init_header(struct mp_index *index, struct index_header *header)
+{
+	struct stat st;
+
+	memset(header, 0, sizeof(*header));
+	header->magic = INDEX_MAGIC;
+	header->version = INDEX_VERSION;
+	header->path_len = (uint32_t)strlen(index->path);
+
+	if (os_stat(index->path, &st) == 0) {
+		header->file_size = (int64_t)st.st_size;
+		header->file_mtime = (int64_t)st.st_mtime;
+	}
+}
+
+/* the file is only used if it was written for the same version of the same
+ * file, including its size and modification time */
+static bool load_index(struct mp_index *index)
+{
+	struct index_header expected;
+	struct index_header header;
+	struct serializer s;
+	struct dstr path = {0};
+	bool success = false;
+
+	if (!index->cache_file ||
+	    !file_input_serializer_init(&s, index->cache_file))
+		return false;
+
+	init_header(index, &expected);
+
+	if (s_read(&s, &header, sizeof(header)) != sizeof(header) ||
+	    header.magic != expected.magic ||
+	    header.version != expected.version ||
+	    header.file_size != expected.file_size ||
+	    header.file_mtime != expected.file_mtime ||
+	    header.path_len != expected.path_len || !header.time_base_den)
+		goto fail;
+
+	dstr_resize(&path, header.path_len);
+	if (s_read(&s, path.array, header.path_len) != header.path_len ||
+	    strcmp(path.array, index->path) != 0)
+		goto fail;
+
+	da_resize(index->keyframes, (size_t)header.count);
+	if (s_read(&s, index->keyframes.array,
+		   sizeof(int64_t) * index->keyframes.num) !=
+	    sizeof(int64_t) * index->keyframes.num) {
+		da_free(index->keyframes);
+		goto fail;
+	}
+
+	index->stream_index = header.stream_index;
+	index->time_base_num = header.time_base_num;
+	index->time_base_den = header.time_base_den;
+	success = true;
+
+fail:
+	file_input_serializer_free(&s);
+	dstr_free(&path);
+	return success;
+}
+
+static void save_index(struct mp_index *index)
+{
+	struct index_header header;
+	struct serializer s;
+
+	if (!index->cache_file ||
+	    !file_output_serializer_init_safe(&s, index->cache_file, "tmp"))
+		return;
+
+	init_header(index, &header);
+	header.stream_index = index->stream_index;
+	header.time_base_num = index->time_base_num;
+	header.time_base_den = index->time_base_den;
+	header.count = index->keyframes.num;
+
+	s_write(&s, &header, sizeof(header));
+	s_write(&s, index->path, header.path_len);
+	s_write(&s, index->keyframes.array,
+		sizeof(int64_t) * index->keyframes.num);
+	file_output_serializer_free(&s);
+}
+
+static int interrupt_callback(void *data)
+{
+	struct mp_index *index = data;
+	return os_atomic_load_bool(&index->stop);
+}
+
+static int cmp_pts(const void *a, const void *b)
+{
+	const int64_t pts_a = *(const int64_t *)a;
+	const int64_t pts_b = *(const int64_t *)b;
+	return pts_a < pts_b ? -1 : (pts_a > pts_b ? 1 : 0);
+}
+
+/* only demuxes the file, nothing is decoded */
+static bool build_index(struct mp_index *index)
+{
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(59, 0, 100)
+	AVInputFormat *format = NULL;
+#else
+	const AVInputFormat *format = NULL;
+#endif
+	AVFormatContext *fmt = avformat_alloc_context();
+	AVPacket *pkt = NULL;
+	bool success = false;
+	int ret;
+
+	if (index->format_name && *index->format_name)
+		format = av_find_input_format(index->format_name);
+
+	fmt->interrupt_callback.callback = interrupt_callback;
+	fmt->interrupt_callback.opaque = index;
+
+	if (avformat_open_input(&fmt, index->path, format, NULL) < 0)
+		return false;
+	if (avformat_find_stream_info(fmt, NULL) < 0)
+		goto fail;
+
+	ret = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	if (ret < 0)
+		goto fail;
+
+	AVStream *stream = fmt->streams[ret];
+	index->stream_index = ret;
+	index->time_base_num = stream->time_base.num;
+	index->time_base_den = stream->time_base.den;
+
+	for (unsigned int i = 0; i < fmt->nb_streams; i++) {
+		if (fmt->streams[i] != stream)
+			fmt->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	pkt = av_packet_alloc();
+
+	while ((ret = av_read_frame(fmt, pkt)) >= 0) {
+		int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+
+		if (pkt->stream_index == index->stream_index &&
+		    (pkt->flags & AV_PKT_FLAG_KEY) && pts != AV_NOPTS_VALUE)
+			da_push_back(index->keyframes, &pts);
+		av_packet_unref(pkt);
+	}
+
+	success = ret == AVERROR_EOF && index->keyframes.num;
+	if (success)
+		qsort(index->keyframes.array, index->keyframes.num,
+		      sizeof(int64_t), cmp_pts);
+
+fail:
+	av_packet_free(&pkt);
+	avformat_close_input(&fmt);
+	return success;
+}
+
+static void *index_thread(void *data)
+{
+	struct mp_index *index = data;
+	uint64_t start = os_gettime_ns();
+
+	os_set_thread_name("mp_index_thread");
+
+	if (load_index(index)) {
+		os_atomic_set_bool(&index->ready, true);
+		return NULL;
+	}
+
+	if (!build_index(index)) {
+		da_free(index->keyframes);
+		return NULL;
+	}
+
+	blog(LOG_DEBUG, "MP: Indexed %zu keyframes of '%s' in %" PRIu64 " ms",
+	     index->keyframes.num, index->path,
+	     (os_gettime_ns() - start) / 1000000);
+
+	save_index(index);
+	os_atomic_set_bool(&index->ready, true);
+	return NULL;
+}
+
+static char *get_cache_file(const char *path, const char *cache_dir)
+{
+	struct dstr file = {0};
+
+	if (!cache_dir || !*cache_dir || os_mkdirs(cache_dir) == MKDIR_ERROR)
+		return NULL;
+
+	dstr_printf(&file, "%s/%08x.idx", cache_dir,
+		    calc_crc32(0, path, strlen(path)));
+	return file.array;
+}
+
+void mp_index_start(struct mp_index *index, const char *path,
+		    const char *format_name, const char *cache_dir)
+{
+	memset(index, 0, sizeof(*index));
+	index->path = bstrdup(path);
+	index->format_name = format_name ? bstrdup(format_name) : NULL;
+	index->cache_file = get_cache_file(path, cache_dir);
+
+	if (pthread_create(&index->thread, NULL, index_thread, index) != 0) {
+		blog(LOG_WARNING, "MP: Could not create index thread");
+		mp_index_stop(index);
+		return;
+	}
+
+	index->thread_valid = true;
+}
+
+void mp_index_stop(struct mp_index *index)
+{
+	if (index->thread_valid) {
+		os_atomic_set_bool(&index->stop, true);
+		pthread_join(index->thread, NULL);
+	}
+
+	da_free(index->keyframes);
+	bfree(index->path);
+	bfree(index->format_name);
+	bfree(index->cache_file);
+	memset(index, 0, sizeof(*index));
+}
+
+bool mp_index_find(struct mp_index *index, int64_t pos, int *stream_index,
+		   int64_t *pts)
+{
+	if (!os_atomic_load_bool(&index->ready))
+		return false;
+
+	AVRational time_base = {index->time_base_num, index->time_base_den};
+	int64_t target = av_rescale_q(pos, AV_TIME_BASE_Q, time_base);
+	size_t lo = 0;
+	size_t hi = index->keyframes.num;
+
+	/* first keyframe after the target */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (index->keyframes.array[mid] <= target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*stream_index = index->stream_index;
+	*pts = index->keyframes.array[lo ? lo - 1 : 0];
+	return true;
+}
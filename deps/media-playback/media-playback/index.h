@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <util/threading.h>
+#include <util/darray.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Keyframes of the video stream of a local file, so that seeks can go to the
+ * keyframe right before the target.  The index is built on its own thread by
+ * reading the whole file once, and saved to a cache directory so that it's
+ * only built the first time a file is opened. */
+struct mp_index {
+	char *path;
+	char *format_name;
+	char *cache_file;
+
+	pthread_t thread;
+	bool thread_valid;
+	volatile bool stop;
+
+	/* written by the index thread until ready is set */
+	int stream_index;
+	int time_base_num;
+	int time_base_den;
+	DARRAY(int64_t) keyframes;
+	volatile bool ready;
+};
+
+extern void mp_index_start(struct mp_index *index, const char *path,
+			   const char *format_name, const char *cache_dir);
+extern void mp_index_stop(struct mp_index *index);
+
+/* finds the last keyframe at or before pos (in AV_TIME_BASE units), pts is
+ * in the time base of the returned stream */
+extern bool mp_index_find(struct mp_index *index, int64_t pos,
+			  int *stream_index, int64_t *pts);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,22 +17,35 @@
 #include "media-playback.h"
 #include "media.h"
 #include "cache.h"
+#include "share.h"
 
 struct media_playback {
 	bool is_cached;
+	bool is_shared;
 	union {
 		mp_media_t media;
 		mp_cache_t cache;
+		mp_share_client_t client;
 	};
 };
 
+/* the media of playbacks that aren't cached */
+static inline mp_media_t *get_media(media_playback_t *mp)
+{
+	return mp->is_shared ? mp_share_get_media(&mp->client) : &mp->media;
+}
+
 media_playback_t *media_playback_create(const struct mp_media_info *info)
 {
 	media_playback_t *mp = bzalloc(sizeof(*mp));
 	mp->is_cached = info->is_local_file && info->full_decode;
+	mp->is_shared = !mp->is_cached && info->share_decoder &&
+			!info->full_decode && !info->request_preload;
 
 	if ((mp->is_cached && !mp_cache_init(&mp->cache, info)) ||
-	    (!mp->is_cached && !mp_media_init(&mp->media, info))) {
+	    (mp->is_shared && !mp_share_init(&mp->client, info)) ||
+	    (!mp->is_cached && !mp->is_shared &&
+	     !mp_media_init(&mp->media, info))) {
 		bfree(mp);
 		return NULL;
 	}
@@ -47,6 +60,8 @@ void media_playback_destroy(media_playback_t *mp)
 
 	if (mp->is_cached)
 		mp_cache_free(&mp->cache);
+	else if (mp->is_shared)
+		mp_share_free(&mp->client);
 	else
 		mp_media_free(&mp->media);
 	bfree(mp);
@@ -59,6 +74,8 @@ void media_playback_play(media_playback_t *mp, bool looping, bool reconnecting)
 
 	if (mp->is_cached)
 		mp_cache_play(&mp->cache, looping);
+	else if (mp->is_shared)
+		mp_share_play(&mp->client, looping, reconnecting);
 	else
 		mp_media_play(&mp->media, looping, reconnecting);
 }
@@ -71,7 +88,7 @@ void media_playback_play_pause(media_playback_t *mp, bool pause)
 	if (mp->is_cached)
 		mp_cache_play_pause(&mp->cache, pause);
 	else
-		mp_media_play_pause(&mp->media, pause);
+		mp_media_play_pause(get_media(mp), pause);
 }
 
 void media_playback_stop(media_playback_t *mp)
@@ -81,6 +98,8 @@ void media_playback_stop(media_playback_t *mp)
 
 	if (mp->is_cached)
 		mp_cache_stop(&mp->cache);
+	else if (mp->is_shared)
+		mp_share_stop(&mp->client);
 	else
 		mp_media_stop(&mp->media);
 }
@@ -90,16 +109,16 @@ void media_playback_set_looping(media_playback_t *mp, bool looping)
 	if (mp->is_cached)
 		mp->cache.looping = looping;
 	else
-		mp->media.looping = looping;
+		get_media(mp)->looping = looping;
 }
 
 void media_playback_set_is_linear_alpha(media_playback_t *mp,
 					bool is_linear_alpha)
 {
 	if (mp->is_cached)
-		mp->cache.m.is_linear_alpha = is_linear_alpha;
+		mp->cache.is_linear_alpha = is_linear_alpha;
 	else
-		mp->media.is_linear_alpha = is_linear_alpha;
+		get_media(mp)->is_linear_alpha = is_linear_alpha;
 }
 
 void media_playback_preload_frame(media_playback_t *mp)
@@ -110,7 +129,7 @@ void media_playback_preload_frame(media_playback_t *mp)
 	if (mp->is_cached)
 		mp_cache_preload_frame(&mp->cache);
 	else
-		mp_media_preload_frame(&mp->media);
+		mp_media_preload_frame(get_media(mp));
 }
 
 int64_t media_playback_get_current_time(media_playback_t *mp)
@@ -121,7 +140,7 @@ int64_t media_playback_get_current_time(media_playback_t *mp)
 	if (mp->is_cached)
 		return mp_cache_get_current_time(&mp->cache);
 	else
-		return mp_media_get_current_time(&mp->media);
+		return mp_media_get_current_time(get_media(mp));
 }
 
 void media_playback_seek(media_playback_t *mp, int64_t pos)
@@ -129,7 +148,7 @@ void media_playback_seek(media_playback_t *mp, int64_t pos)
 	if (mp->is_cached)
 		mp_cache_seek(&mp->cache, pos);
 	else
-		mp_media_seek(&mp->media, pos);
+		mp_media_seek(get_media(mp), pos);
 }
 
 int64_t media_playback_get_frames(media_playback_t *mp)
@@ -140,7 +159,7 @@ int64_t media_playback_get_frames(media_playback_t *mp)
 	if (mp->is_cached)
 		return mp_cache_get_frames(&mp->cache);
 	else
-		return mp_media_get_frames(&mp->media);
+		return mp_media_get_frames(get_media(mp));
 }
 
 int64_t media_playback_get_duration(media_playback_t *mp)
@@ -151,7 +170,7 @@ int64_t media_playback_get_duration(media_playback_t *mp)
 	if (mp->is_cached)
 		return mp_cache_get_duration(&mp->cache);
 	else
-		return mp_media_get_duration(&mp->media);
+		return mp_media_get_duration(get_media(mp));
 }
 
 bool media_playback_has_video(media_playback_t *mp)
@@ -162,7 +181,7 @@ bool media_playback_has_video(media_playback_t *mp)
 	if (mp->is_cached)
 		return mp->cache.has_video;
 	else
-		return mp->media.has_video;
+		return get_media(mp)->has_video;
 }
 
 bool media_playback_has_audio(media_playback_t *mp)
@@ -173,5 +192,28 @@ bool media_playback_has_audio(media_playback_t *mp)
 	if (mp->is_cached)
 		return mp->cache.has_audio;
 	else
-		return mp->media.has_audio;
+		return get_media(mp)->has_audio;
+}
+
+void media_playback_get_buffer_stats(media_playback_t *mp,
+				     struct mp_buffer_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	if (!mp || mp->is_cached)
+		return;
+
+	mp_media_t *media = get_media(mp);
+	stats->buffered_ns = mp_prefetch_buffered_ns(&media->prefetch);
+	stats->target_ns = media->prebuffer_ns;
+	stats->underruns = mp_prefetch_underruns(&media->prefetch);
+}
+
+void media_playback_set_cache_limit(uint64_t bytes)
+{
+	mp_cache_set_limit(bytes);
+}
+
+void media_playback_purge_cache(void)
+{
+	mp_cache_purge();
 }
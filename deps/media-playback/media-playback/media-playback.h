@@ -22,6 +22,11 @@ struct media_playback;
 typedef struct media_playback media_playback_t;
 
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
+typedef void (*mp_video_gpu_cb)(void *opaque, struct obs_source_frame *frame,
+				void *gpu_frame);
+typedef void (*mp_video_shared_cb)(void *opaque,
+				   struct obs_source_frame *frame,
+				   void *shared_frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
@@ -29,6 +34,14 @@ struct mp_media_info {
 	void *opaque;
 
 	mp_video_cb v_cb;
+	/* optional, receives hardware decoded frames that stay on the GPU,
+	 * pass them to obs_source_output_video_gpu together with
+	 * mp_gpu_frame_import and mp_gpu_frame_release */
+	mp_video_gpu_cb v_gpu_cb;
+	/* optional, receives frames that other playbacks of a shared decoder
+	 * display as well, pass them to obs_source_output_video_nocopy
+	 * together with mp_shared_frame_release */
+	mp_video_shared_cb v_shared_cb;
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
 	mp_audio_cb a_cb;
@@ -38,6 +51,8 @@ struct mp_media_info {
 	const char *format;
 	char *ffmpeg_options;
 	int buffering;
+	/* duration network inputs are read ahead by, 0 to disable */
+	int prebuffer_ms;
 	int speed;
 	enum video_range_type force_range;
 	bool is_linear_alpha;
@@ -46,6 +61,12 @@ struct mp_media_info {
 	bool reconnecting;
 	bool request_preload;
 	bool full_decode;
+	/* playbacks of the same input with the same options decode it only
+	 * once, they can't be paused or seeked independently */
+	bool share_decoder;
+	/* local files get a keyframe index for seeking, which is cached in
+	 * this directory */
+	const char *index_dir;
 };
 
 extern media_playback_t *
@@ -66,3 +87,25 @@ extern int64_t media_playback_get_frames(media_playback_t *mp);
 extern int64_t media_playback_get_duration(media_playback_t *mp);
 extern bool media_playback_has_video(media_playback_t *mp);
 extern bool media_playback_has_audio(media_playback_t *mp);
+
+struct mp_buffer_stats {
+	int64_t buffered_ns;
+	int64_t target_ns;
+	long underruns;
+};
+
+/* read-ahead state of network inputs, for example to decide whether to
+ * switch to a lower bandwidth stream */
+extern void media_playback_get_buffer_stats(media_playback_t *mp,
+					    struct mp_buffer_stats *stats);
+
+/* Fully decoded local files are shared between all playbacks of the same file
+ * and kept after their last playback is destroyed, until the total size of
+ * the decoded clips exceeds the limit.  Clips in use are never evicted. */
+extern void media_playback_set_cache_limit(uint64_t bytes);
+extern void media_playback_purge_cache(void);
+
+extern bool mp_gpu_frame_import(void *gpu_frame,
+				gs_texture_t *textures[MAX_AV_PLANES]);
+extern void mp_gpu_frame_release(void *gpu_frame);
+extern void mp_shared_frame_release(void *shared_frame);
@@ -168,22 +168,39 @@ static inline struct mp_decode *get_packet_decoder(mp_media_t *media,
 
 void mp_media_free_packet(struct mp_media *media, AVPacket *pkt)
 {
+	if (media->prefetch.thread_valid) {
+		mp_prefetch_recycle(&media->prefetch, pkt);
+		return;
+	}
+
 	av_packet_unref(pkt);
 	da_push_back(media->packet_pool, &pkt);
 }
 
-static int mp_media_next_packet(mp_media_t *media)
+static int read_packet(mp_media_t *media, AVPacket **pkt)
 {
-	AVPacket *pkt;
+	if (media->prefetch.thread_valid)
+		return mp_prefetch_read(&media->prefetch, pkt);
+
 	AVPacket **const cached = da_end(media->packet_pool);
 	if (cached) {
-		pkt = *cached;
+		*pkt = *cached;
 		da_pop_back(media->packet_pool);
 	} else {
-		pkt = av_packet_alloc();
+		*pkt = av_packet_alloc();
 	}
 
-	int ret = av_read_frame(media->fmt, pkt);
+	int ret = av_read_frame(media->fmt, *pkt);
+	if (ret < 0)
+		da_push_back(media->packet_pool, pkt);
+	return ret;
+}
+
+static int mp_media_next_packet(mp_media_t *media)
+{
+	AVPacket *pkt;
+
+	int ret = read_packet(media, &pkt);
 	if (ret < 0) {
 		if (ret != AVERROR_EOF && ret != AVERROR_EXIT)
 			blog(LOG_WARNING, "MP: av_read_frame failed: %s (%d)",
@@ -244,6 +261,26 @@ static inline int get_sws_range(enum AVColorRange r)
 
 #define FIXED_1_0 (1 << 16)
 
+static inline bool mp_media_is_gpu_frame(mp_media_t *m)
+{
+	return m->v.gpu_frames && m->v.frame == m->v.hw_frame &&
+	       m->v.frame->format == m->v.hw_format;
+}
+
+static bool mp_media_init_scaling(mp_media_t *m);
+
+static bool mp_media_update_scaling(mp_media_t *m)
+{
+	if (m->swscale)
+		return true;
+
+	m->scale_format = closest_format(m->v.frame->format);
+	if (m->scale_format != m->v.frame->format)
+		return mp_media_init_scaling(m);
+
+	return true;
+}
+
 static bool mp_media_init_scaling(mp_media_t *m)
 {
 	int space = get_sws_colorspace(m->v.decoder->colorspace);
@@ -275,6 +312,32 @@ static bool mp_media_init_scaling(mp_media_t *m)
 	return true;
 }
 
+static inline bool past_seek_target(mp_media_t *m, struct mp_decode *d,
+				    bool has)
+{
+	return !has || d->eof ||
+	       (d->frame_ready && d->next_pts > m->seek_target_ns);
+}
+
+/* seeks land on the keyframe before the target, the frames up to the target
+ * are decoded but not shown */
+static void skip_to_seek_target(mp_media_t *m)
+{
+	if (!m->seek_target_ns)
+		return;
+
+	if (m->has_video && m->v.frame_ready &&
+	    m->v.next_pts <= m->seek_target_ns)
+		m->v.frame_ready = false;
+	if (m->has_audio && m->a.frame_ready &&
+	    m->a.next_pts <= m->seek_target_ns)
+		m->a.frame_ready = false;
+
+	if (past_seek_target(m, &m->v, m->has_video) &&
+	    past_seek_target(m, &m->a, m->has_audio))
+		m->seek_target_ns = 0;
+}
+
 bool mp_media_prepare_frames(mp_media_t *m)
 {
 	bool actively_seeking = m->seek_next_ts && m->pause;
@@ -305,17 +368,14 @@ bool mp_media_prepare_frames(mp_media_t *m)
 			return false;
 		if (m->has_audio && !mp_decode_frame(&m->a))
 			return false;
-	}
 
-	if (m->has_video && m->v.frame_ready && !m->swscale) {
-		m->scale_format = closest_format(m->v.frame->format);
-		if (m->scale_format != m->v.frame->format) {
-			if (!mp_media_init_scaling(m)) {
-				return false;
-			}
-		}
+		skip_to_seek_target(m);
 	}
 
+	if (m->has_video && m->v.frame_ready && !mp_media_is_gpu_frame(m) &&
+	    !mp_media_update_scaling(m))
+		return false;
+
 	return true;
 }
 
@@ -403,6 +463,7 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 	enum video_format new_format;
 	enum video_colorspace new_space;
 	enum video_range_type new_range;
+	void *gpu_frame = NULL;
 	AVFrame *f = d->frame;
 
 	if (!preload) {
@@ -417,8 +478,27 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		return;
 	}
 
+	/* preloaded frames are copied by libobs, so they need system memory,
+	 * and surfaces that can't be mapped are downloaded as before */
+	if (mp_media_is_gpu_frame(m)) {
+		if (!preload)
+			gpu_frame = mp_gpu_frame_create(f);
+		if (!gpu_frame) {
+			if (!mp_decode_download(d) ||
+			    !mp_media_update_scaling(m))
+				return;
+			f = d->frame;
+		}
+	}
+
 	bool flip = false;
-	if (m->swscale) {
+	if (gpu_frame) {
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			frame->data[i] = NULL;
+			frame->linesize[i] = 0;
+		}
+
+	} else if (m->swscale) {
 		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data,
 				    f->linesize, 0, f->height, m->scale_pic,
 				    m->scale_linesizes);
@@ -443,7 +523,8 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 	if (flip)
 		frame->data[0] -= frame->linesize[0] * ((size_t)f->height - 1);
 
-	new_format = convert_pixel_format(m->scale_format);
+	new_format = gpu_frame ? mp_gpu_frame_format(f)
+			       : convert_pixel_format(m->scale_format);
 	new_space = convert_color_space(f->colorspace, f->color_trc,
 					f->color_primaries);
 	new_range = m->force_range == VIDEO_RANGE_DEFAULT
@@ -467,12 +548,12 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 
 		if (!success) {
 			frame->format = VIDEO_FORMAT_NONE;
-			return;
+			goto drop;
 		}
 	}
 
 	if (frame->format == VIDEO_FORMAT_NONE)
-		return;
+		goto drop;
 
 	frame->timestamp = m->full_decode
 				   ? d->frame_pts
@@ -510,7 +591,7 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 #else
 		if (!(f->flags & AV_FRAME_FLAG_KEY))
 #endif
-			return;
+			goto drop;
 
 		d->got_first_keyframe = true;
 	}
@@ -521,9 +602,16 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		} else if (!m->request_preload) {
 			m->v_preload_cb(m->opaque, frame);
 		}
+	} else if (gpu_frame) {
+		m->v_gpu_cb(m->opaque, frame, gpu_frame);
 	} else {
 		m->v_cb(m->opaque, frame);
 	}
+	return;
+
+drop:
+	if (gpu_frame)
+		mp_gpu_frame_release(gpu_frame);
 }
 
 static void mp_media_calc_next_ns(mp_media_t *m)
@@ -564,8 +652,16 @@ static void seek_to(mp_media_t *m, int64_t pos)
 						     stream->time_base)
 				      : seek_pos;
 
+	int stream_index = 0;
+	int64_t keyframe;
+
+	if (seek_flags == AVSEEK_FLAG_BACKWARD &&
+	    mp_index_find(&m->index, seek_pos, &stream_index, &keyframe))
+		seek_target = keyframe;
+
 	if (m->is_local_file) {
-		int ret = av_seek_frame(m->fmt, 0, seek_target, seek_flags);
+		int ret = av_seek_frame(m->fmt, stream_index, seek_target,
+					seek_flags);
 		if (ret < 0) {
 			blog(LOG_WARNING, "MP: Failed to seek: %s",
 			     av_err2str(ret));
@@ -596,6 +692,7 @@ bool mp_media_reset(mp_media_t *m)
 	m->eof = false;
 	m->base_ts += next_ts;
 	m->seek_next_ts = false;
+	m->seek_target_ns = 0;
 
 	seek_to(m, start_time);
 
@@ -605,18 +702,21 @@ bool mp_media_reset(mp_media_t *m)
 	m->stopping = false;
 	pthread_mutex_unlock(&m->mutex);
 
+	if (stopping)
+		mp_prefetch_flush(&m->prefetch);
+
 	if (!mp_media_prepare_frames(m))
 		return false;
 
 	if (active) {
 		if (!m->play_sys_ts)
-			m->play_sys_ts = (int64_t)os_gettime_ns();
+			m->play_sys_ts = (int64_t)obs_get_clock_ns();
 		m->start_ts = m->next_pts_ns = mp_media_get_next_min_pts(m);
 		if (m->next_ns)
 			m->next_ns += offset;
 	} else {
 		m->start_ts = m->next_pts_ns = mp_media_get_next_min_pts(m);
-		m->play_sys_ts = (int64_t)os_gettime_ns();
+		m->play_sys_ts = (int64_t)obs_get_clock_ns();
 		m->next_ns = 0;
 	}
 
@@ -634,9 +734,12 @@ static inline bool mp_media_sleep(mp_media_t *m)
 	bool timeout = false;
 
 	if (!m->next_ns) {
-		m->next_ns = os_gettime_ns();
+		m->next_ns = obs_get_clock_ns();
+	} else if (m->clock_hold) {
+		timeout = !obs_clock_hold_wait(m->clock_hold, m->next_ns,
+					       200);
 	} else {
-		const uint64_t t = os_gettime_ns();
+		const uint64_t t = obs_get_clock_ns();
 		if (m->next_ns > t) {
 			const uint32_t delta_ms =
 				(uint32_t)((m->next_ns - t + 500000) / 1000000);
@@ -685,12 +788,33 @@ static int interrupt_callback(void *data)
 		stop = m->kill || m->stopping;
 		pthread_mutex_unlock(&m->mutex);
 
+		stop = stop || mp_prefetch_stopping(&m->prefetch);
+
 		m->interrupt_poll_ts = ts;
 	}
 
 	return stop;
 }
 
+static void start_prefetch(mp_media_t *m)
+{
+	int ref_stream = m->has_video ? m->v.stream->index
+				      : m->a.stream->index;
+
+	/* streams that aren't decoded don't need to be read at all, for HLS
+	 * this means the other variants aren't downloaded */
+	for (unsigned int i = 0; i < m->fmt->nb_streams; i++) {
+		AVStream *stream = m->fmt->streams[i];
+		if ((!m->has_video || stream != m->v.stream) &&
+		    (!m->has_audio || stream != m->a.stream))
+			stream->discard = AVDISCARD_ALL;
+	}
+
+	if (!mp_prefetch_start(&m->prefetch, m->fmt, ref_stream,
+			       m->prebuffer_ns))
+		blog(LOG_WARNING, "MP: Could not create prefetch thread");
+}
+
 #define RIST_PROTO "rist"
 
 static bool init_avformat(mp_media_t *m)
@@ -724,6 +848,15 @@ static bool init_avformat(mp_media_t *m)
 			     av_err2str(ret), m->ffmpeg_options);
 	}
 
+	if (m->prebuffer_ns && !m->is_local_file) {
+		/* HLS: keep connections alive between segments and request
+		 * the next segment while the current one is downloading */
+		av_dict_set(&opts, "http_persistent", "1",
+			    AV_DICT_DONT_OVERWRITE);
+		av_dict_set(&opts, "http_multiple", "1",
+			    AV_DICT_DONT_OVERWRITE);
+	}
+
 	m->fmt = avformat_alloc_context();
 	if (m->buffering == 0) {
 		m->fmt->flags |= AVFMT_FLAG_NOBUFFER;
@@ -763,13 +896,20 @@ static bool init_avformat(mp_media_t *m)
 		return false;
 	}
 
+	if (m->prebuffer_ns && !m->is_local_file)
+		start_prefetch(m);
+	if (m->index_dir && m->is_local_file && m->has_video &&
+	    !m->full_decode && os_file_exists(m->path))
+		mp_index_start(&m->index, m->path, m->format_name,
+			       m->index_dir);
+
 	return true;
 }
 
 static void reset_ts(mp_media_t *m)
 {
 	m->base_ts += mp_media_get_base_pts(m);
-	m->play_sys_ts = (int64_t)os_gettime_ns();
+	m->play_sys_ts = (int64_t)obs_get_clock_ns();
 	m->start_ts = m->next_pts_ns = mp_media_get_next_min_pts(m);
 	m->next_ns = 0;
 }
@@ -805,6 +945,7 @@ static inline bool mp_media_thread(mp_media_t *m)
 		pthread_mutex_unlock(&m->mutex);
 
 		if (!is_active || pause) {
+			obs_clock_hold_set(m->clock_hold, 0);
 			if (os_sem_wait(m->sem) < 0)
 				return false;
 			if (pause)
@@ -841,6 +982,10 @@ static inline bool mp_media_thread(mp_media_t *m)
 
 		if (seek) {
 			m->seek_next_ts = true;
+			m->seek_target_ns = 0;
+			if (m->is_local_file && seek_pos > 0)
+				m->seek_target_ns =
+					seek_pos * 1000 * 100 / m->speed;
 			seek_to(m, seek_pos);
 			continue;
 		}
@@ -872,6 +1017,7 @@ static inline bool mp_media_thread(mp_media_t *m)
 				continue;
 
 			mp_media_calc_next_ns(m);
+			obs_clock_hold_set(m->clock_hold, m->next_ns);
 		}
 	}
 
@@ -881,8 +1027,12 @@ static inline bool mp_media_thread(mp_media_t *m)
 static void *mp_media_thread_start(void *opaque)
 {
 	mp_media_t *m = opaque;
+	bool success = mp_media_thread(m);
+
+	mp_prefetch_stop(&m->prefetch);
 
-	if (!mp_media_thread(m)) {
+	if (!success) {
+		m->failed = true;
 		if (m->stop_cb) {
 			m->stop_cb(m->opaque);
 		}
@@ -910,6 +1060,9 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 	if (info->full_decode)
 		return true;
 
+	if (info->is_local_file)
+		m->clock_hold = obs_clock_hold_create();
+
 	if (pthread_create(&m->thread, NULL, mp_media_thread_start, m) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
 		return false;
@@ -925,6 +1078,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	pthread_mutex_init_value(&media->mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
+	media->v_gpu_cb = info->v_gpu_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
 	media->ffmpeg_options = info->ffmpeg_options;
@@ -933,6 +1087,8 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->force_range = info->force_range;
 	media->is_linear_alpha = info->is_linear_alpha;
 	media->buffering = info->buffering;
+	media->prebuffer_ns = (int64_t)info->prebuffer_ms * 1000000;
+	media->index_dir = info->index_dir ? bstrdup(info->index_dir) : NULL;
 	media->speed = info->speed;
 	media->request_preload = info->request_preload;
 	media->is_local_file = info->is_local_file;
@@ -949,7 +1105,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	}
 
 	if (!base_sys_ts)
-		base_sys_ts = (int64_t)os_gettime_ns();
+		base_sys_ts = (int64_t)obs_get_clock_ns();
 
 	if (!mp_media_init_internal(media, info)) {
 		mp_media_free(media);
@@ -978,6 +1134,8 @@ void mp_media_free(mp_media_t *media)
 
 	mp_media_stop(media);
 	mp_kill_thread(media);
+	mp_index_stop(&media->index);
+	obs_clock_hold_destroy(media->clock_hold);
 	mp_decode_free(&media->v);
 	mp_decode_free(&media->a);
 	for (size_t i = 0; i < media->packet_pool.num; i++)
@@ -990,6 +1148,7 @@ void mp_media_free(mp_media_t *media)
 	av_freep(&media->scale_pic[0]);
 	bfree(media->path);
 	bfree(media->format_name);
+	bfree(media->index_dir);
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
 }
@@ -1007,6 +1166,8 @@ void mp_media_play(mp_media_t *m, bool loop, bool reconnecting)
 
 	pthread_mutex_unlock(&m->mutex);
 
+	/* don't let the clock run ahead before the first frame is out */
+	obs_clock_hold_set(m->clock_hold, obs_get_clock_ns());
 	os_sem_post(m->sem);
 }
 
@@ -18,6 +18,8 @@
 
 #include <obs.h>
 #include "decode.h"
+#include "prefetch.h"
+#include "index.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +47,7 @@ struct mp_media {
 	mp_video_cb v_seek_cb;
 	mp_stop_cb stop_cb;
 	mp_video_cb v_cb;
+	mp_video_gpu_cb v_gpu_cb;
 	mp_audio_cb a_cb;
 	void *opaque;
 
@@ -54,6 +57,16 @@ struct mp_media {
 	int buffering;
 	int speed;
 
+	/* network inputs are read ahead by up to this duration */
+	struct mp_prefetch prefetch;
+	int64_t prebuffer_ns;
+
+	/* seek index of local files, cached in index_dir */
+	struct mp_index index;
+	char *index_dir;
+	/* frames that end before this are dropped after a seek */
+	int64_t seek_target_ns;
+
 	enum AVPixelFormat scale_format;
 	struct SwsContext *swscale;
 	int scale_linesizes[4];
@@ -80,6 +93,8 @@ struct mp_media {
 	int64_t play_sys_ts;
 	int64_t next_pts_ns;
 	uint64_t next_ns;
+	/* offline rendering waits for the frame at next_ns */
+	obs_clock_hold_t *clock_hold;
 	int64_t start_ts;
 	int64_t base_ts;
 	bool full_decode;
@@ -97,6 +112,8 @@ struct mp_media {
 
 	bool thread_valid;
 	pthread_t thread;
+	/* set by the media thread when it exits because of an error */
+	bool failed;
 
 	bool pause;
 	bool reset_ts;
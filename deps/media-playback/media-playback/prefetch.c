@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "prefetch.h"
+
+#include <util/platform.h>
+
+/* limits the queue when packets have no usable timestamps */
+#define MAX_QUEUED_PACKETS 10000
+
+struct prefetch_entry {
+	AVPacket *pkt;
+	int ret;
+};
+
+static inline int64_t packet_ns(struct mp_prefetch *p, const AVPacket *pkt)
+{
+	AVStream *stream = p->fmt->streams[pkt->stream_index];
+	int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+
+	if (ts == AV_NOPTS_VALUE)
+		return AV_NOPTS_VALUE;
+
+	return av_rescale_q(ts, stream->time_base, (AVRational){1, 1000000000});
+}
+
+static inline size_t queued_packets(struct mp_prefetch *p)
+{
+	return p->entries.size / sizeof(struct prefetch_entry);
+}
+
+static inline int64_t buffered_ns(struct mp_prefetch *p)
+{
+	if (!p->entries.size || p->queued_ns == AV_NOPTS_VALUE ||
+	    p->taken_ns == AV_NOPTS_VALUE || p->queued_ns < p->taken_ns)
+		return 0;
+
+	return p->queued_ns - p->taken_ns;
+}
+
+static inline bool buffer_full(struct mp_prefetch *p)
+{
+	return p->error_queued || buffered_ns(p) >= p->target_ns ||
+	       queued_packets(p) >= MAX_QUEUED_PACKETS;
+}
+
+static void *prefetch_thread(void *data)
+{
+	struct mp_prefetch *p = data;
+
+	os_set_thread_name("mp_prefetch_thread");
+
+	for (;;) {
+		struct prefetch_entry entry = {0};
+
+		pthread_mutex_lock(&p->mutex);
+		while (!mp_prefetch_stopping(p) && buffer_full(p))
+			pthread_cond_wait(&p->cond, &p->mutex);
+
+		if (mp_prefetch_stopping(p)) {
+			pthread_mutex_unlock(&p->mutex);
+			break;
+		}
+
+		AVPacket **const cached = da_end(p->pool);
+		if (cached) {
+			entry.pkt = *cached;
+			da_pop_back(p->pool);
+		}
+		pthread_mutex_unlock(&p->mutex);
+
+		if (!entry.pkt)
+			entry.pkt = av_packet_alloc();
+
+		entry.ret = av_read_frame(p->fmt, entry.pkt);
+		if (entry.ret < 0)
+			av_packet_free(&entry.pkt);
+
+		pthread_mutex_lock(&p->mutex);
+		if (entry.ret < 0) {
+			p->error_queued = true;
+		} else if (entry.pkt->stream_index == p->ref_stream) {
+			int64_t ts = packet_ns(p, entry.pkt);
+			if (ts != AV_NOPTS_VALUE)
+				p->queued_ns = ts;
+		}
+		deque_push_back(&p->entries, &entry, sizeof(entry));
+		os_atomic_store_int64(&p->buffered_ns, buffered_ns(p));
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->mutex);
+	}
+
+	return NULL;
+}
+
+bool mp_prefetch_start(struct mp_prefetch *p, AVFormatContext *fmt,
+		       int ref_stream, int64_t target_ns)
+{
+	memset(p, 0, sizeof(*p));
+	p->fmt = fmt;
+	p->ref_stream = ref_stream;
+	p->target_ns = target_ns;
+	p->queued_ns = AV_NOPTS_VALUE;
+	p->taken_ns = AV_NOPTS_VALUE;
+
+	if (pthread_mutex_init(&p->mutex, NULL) != 0)
+		return false;
+	if (pthread_cond_init(&p->cond, NULL) != 0) {
+		pthread_mutex_destroy(&p->mutex);
+		return false;
+	}
+
+	if (pthread_create(&p->thread, NULL, prefetch_thread, p) != 0) {
+		pthread_cond_destroy(&p->cond);
+		pthread_mutex_destroy(&p->mutex);
+		return false;
+	}
+
+	p->thread_valid = true;
+	return true;
+}
+
+void mp_prefetch_stop(struct mp_prefetch *p)
+{
+	struct prefetch_entry entry;
+
+	if (!p->thread_valid)
+		return;
+
+	pthread_mutex_lock(&p->mutex);
+	os_atomic_set_bool(&p->stop, true);
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+	pthread_join(p->thread, NULL);
+
+	while (p->entries.size) {
+		deque_pop_front(&p->entries, &entry, sizeof(entry));
+		av_packet_free(&entry.pkt);
+	}
+	for (size_t i = 0; i < p->pool.num; i++)
+		av_packet_free(&p->pool.array[i]);
+
+	deque_free(&p->entries);
+	da_free(p->pool);
+	pthread_cond_destroy(&p->cond);
+	pthread_mutex_destroy(&p->mutex);
+	os_atomic_store_int64(&p->buffered_ns, 0);
+	p->thread_valid = false;
+}
+
+int mp_prefetch_read(struct mp_prefetch *p, AVPacket **pkt)
+{
+	struct prefetch_entry entry;
+
+	pthread_mutex_lock(&p->mutex);
+	if (!p->entries.size && p->taken_ns != AV_NOPTS_VALUE)
+		os_atomic_inc_long(&p->underruns);
+	while (!p->entries.size && !mp_prefetch_stopping(p))
+		pthread_cond_wait(&p->cond, &p->mutex);
+
+	if (!p->entries.size) {
+		pthread_mutex_unlock(&p->mutex);
+		return AVERROR_EXIT;
+	}
+
+	deque_pop_front(&p->entries, &entry, sizeof(entry));
+	if (entry.ret < 0) {
+		p->error_queued = false;
+	} else if (entry.pkt->stream_index == p->ref_stream) {
+		int64_t ts = packet_ns(p, entry.pkt);
+		if (ts != AV_NOPTS_VALUE)
+			p->taken_ns = ts;
+	}
+	os_atomic_store_int64(&p->buffered_ns, buffered_ns(p));
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+
+	*pkt = entry.pkt;
+	return entry.ret;
+}
+
+void mp_prefetch_flush(struct mp_prefetch *p)
+{
+	struct prefetch_entry entry;
+
+	if (!p->thread_valid)
+		return;
+
+	pthread_mutex_lock(&p->mutex);
+	while (p->entries.size) {
+		deque_pop_front(&p->entries, &entry, sizeof(entry));
+		if (entry.pkt) {
+			av_packet_unref(entry.pkt);
+			da_push_back(p->pool, &entry.pkt);
+		}
+	}
+	p->error_queued = false;
+	p->queued_ns = AV_NOPTS_VALUE;
+	p->taken_ns = AV_NOPTS_VALUE;
+	os_atomic_store_int64(&p->buffered_ns, 0);
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+}
+
+void mp_prefetch_recycle(struct mp_prefetch *p, AVPacket *pkt)
+{
+	av_packet_unref(pkt);
+
+	pthread_mutex_lock(&p->mutex);
+	da_push_back(p->pool, &pkt);
+	pthread_mutex_unlock(&p->mutex);
+}
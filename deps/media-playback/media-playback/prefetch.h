@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <util/threading.h>
+#include <util/darray.h>
+#include <util/deque.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4204)
+#endif
+
+#include <libavformat/avformat.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+/* Reads packets of network inputs ahead on its own thread, so that waiting on
+ * the network (such as for the next segment of an HLS stream) doesn't stall
+ * playback as long as enough is buffered.  Reads stop once the buffered
+ * duration of the reference stream reaches the target. */
+struct mp_prefetch {
+	AVFormatContext *fmt;
+	int ref_stream;
+	int64_t target_ns;
+
+	pthread_t thread;
+	bool thread_valid;
+	volatile bool stop;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct deque entries;
+	DARRAY(AVPacket *) pool;
+	/* a read error is queued like a packet, reading resumes once it was
+	 * taken */
+	bool error_queued;
+
+	int64_t queued_ns;
+	int64_t taken_ns;
+
+	/* read without locking by the stats getters */
+	volatile int64_t buffered_ns;
+	volatile long underruns;
+};
+
+extern bool mp_prefetch_start(struct mp_prefetch *p, AVFormatContext *fmt,
+			      int ref_stream, int64_t target_ns);
+extern void mp_prefetch_stop(struct mp_prefetch *p);
+
+/* same return values as av_read_frame, blocks until a packet was read */
+extern int mp_prefetch_read(struct mp_prefetch *p, AVPacket **pkt);
+extern void mp_prefetch_recycle(struct mp_prefetch *p, AVPacket *pkt);
+
+/* drops everything read so far, used when playback stops so that it doesn't
+ * restart from stale packets */
+extern void mp_prefetch_flush(struct mp_prefetch *p);
+
+static inline bool mp_prefetch_stopping(struct mp_prefetch *p)
+{
+	return os_atomic_load_bool(&p->stop);
+}
+
+static inline int64_t mp_prefetch_buffered_ns(struct mp_prefetch *p)
+{
+	return os_atomic_load_int64(&p->buffered_ns);
+}
+
+static inline long mp_prefetch_underruns(struct mp_prefetch *p)
+{
+	return os_atomic_load_long(&p->underruns);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "media-playback.h"
+#include "share.h"
+
+struct mp_shared_frame {
+	struct obs_source_frame frame;
+	volatile long refs;
+};
+
+struct mp_share {
+	char *path;
+	char *format_name;
+	char *ffmpeg_options;
+	int buffering;
+	int prebuffer_ms;
+	int speed;
+	enum video_range_type force_range;
+	bool is_linear_alpha;
+	bool hardware_decoding;
+	bool gpu_frames;
+	bool is_local_file;
+
+	/* the list is changed with both mutexes locked */
+	pthread_mutex_t mutex;
+	DARRAY(mp_share_client_t *) clients;
+
+	mp_media_t media;
+};
+
+static pthread_mutex_t shares_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct mp_share *) shares;
+
+static inline bool str_equal(const char *a, const char *b)
+{
+	return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+static bool share_matches(const struct mp_share *share,
+			  const struct mp_media_info *info)
+{
+	return share->buffering == info->buffering &&
+	       share->prebuffer_ms == info->prebuffer_ms &&
+	       share->speed == info->speed &&
+	       share->force_range == info->force_range &&
+	       share->is_linear_alpha == info->is_linear_alpha &&
+	       share->hardware_decoding == info->hardware_decoding &&
+	       share->gpu_frames == (info->v_gpu_cb != NULL) &&
+	       share->is_local_file == info->is_local_file &&
+	       str_equal(share->path, info->path) &&
+	       str_equal(share->format_name, info->format) &&
+	       str_equal(share->ffmpeg_options, info->ffmpeg_options);
+}
+
+/* ------------------------------------------------------------------------- */
+/* media thread callbacks                                                    */
+
+void mp_shared_frame_release(void *param)
+{
+	struct mp_shared_frame *shared = param;
+
+	if (os_atomic_dec_long(&shared->refs) == 0) {
+		obs_source_frame_free(&shared->frame);
+		bfree(shared);
+	}
+}
+
+static struct mp_shared_frame *
+shared_frame_create(const struct obs_source_frame *frame, long refs)
+{
+	struct mp_shared_frame *shared = bzalloc(sizeof(*shared));
+
+	obs_source_frame_init(&shared->frame, frame->format, frame->width,
+			      frame->height);
+	obs_source_frame_copy(&shared->frame, frame);
+	shared->refs = refs;
+	return shared;
+}
+
+static inline bool client_plays_video(const mp_share_client_t *c)
+{
+	return c->playing && c->v_cb;
+}
+
+static void share_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_share *share = opaque;
+	struct mp_shared_frame *shared = NULL;
+	long playing = 0;
+	long nocopy = 0;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (client_plays_video(c)) {
+			playing++;
+			if (c->v_shared_cb)
+				nocopy++;
+		}
+	}
+
+	/* one copy for all clients that can take it instead of one copy per
+	 * client in libobs */
+	if (playing > 1 && nocopy)
+		shared = shared_frame_create(frame, nocopy);
+
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (!client_plays_video(c))
+			continue;
+
+		if (shared && c->v_shared_cb)
+			c->v_shared_cb(c->opaque, &shared->frame, shared);
+		else
+			c->v_cb(c->opaque, frame);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_gpu_video(void *opaque, struct obs_source_frame *frame,
+			    void *gpu_frame)
+{
+	struct mp_share *share = opaque;
+	size_t playing = 0;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (c->playing && c->v_gpu_cb)
+			playing++;
+	}
+
+	/* the hardware surface is referenced by each client */
+	for (size_t i = 0; i < share->clients.num && playing; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		void *client_frame;
+
+		if (!c->playing || !c->v_gpu_cb)
+			continue;
+
+		client_frame = --playing ? mp_gpu_frame_clone(gpu_frame)
+					 : gpu_frame;
+		if (client_frame)
+			c->v_gpu_cb(c->opaque, frame, client_frame);
+		if (!client_frame || client_frame == gpu_frame)
+			gpu_frame = NULL;
+	}
+	pthread_mutex_unlock(&share->mutex);
+
+	if (gpu_frame)
+		mp_gpu_frame_release(gpu_frame);
+}
+
+static void share_preload_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (c->v_preload_cb)
+			c->v_preload_cb(c->opaque, frame);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_seek_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (c->v_seek_cb)
+			c->v_seek_cb(c->opaque, frame);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_audio(void *opaque, struct obs_source_audio *audio)
+{
+	struct mp_share *share = opaque;
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (c->playing && c->a_cb)
+			c->a_cb(c->opaque, audio);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+static void share_stopped(void *opaque)
+{
+	struct mp_share *share = opaque;
+	bool failed = share->media.failed;
+
+	/* new playbacks of the input get a new decoder, and every client is
+	 * told so that it can reopen the input */
+	if (failed) {
+		pthread_mutex_lock(&shares_mutex);
+		da_erase_item(shares, &share);
+		pthread_mutex_unlock(&shares_mutex);
+	}
+
+	pthread_mutex_lock(&share->mutex);
+	for (size_t i = 0; i < share->clients.num; i++) {
+		mp_share_client_t *c = share->clients.array[i];
+		if (!failed && !c->playing && !c->stop_pending)
+			continue;
+
+		c->playing = false;
+		c->stop_pending = false;
+		if (c->stop_cb)
+			c->stop_cb(c->opaque);
+	}
+	pthread_mutex_unlock(&share->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct mp_share *share_create(const struct mp_media_info *info)
+{
+	struct mp_share *share = bzalloc(sizeof(*share));
+	struct mp_media_info info2 = *info;
+
+	if (pthread_mutex_init(&share->mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init mutex");
+		bfree(share);
+		return NULL;
+	}
+
+	share->path = info->path ? bstrdup(info->path) : NULL;
+	share->format_name = info->format ? bstrdup(info->format) : NULL;
+	share->ffmpeg_options =
+		info->ffmpeg_options ? bstrdup(info->ffmpeg_options) : NULL;
+	share->buffering = info->buffering;
+	share->prebuffer_ms = info->prebuffer_ms;
+	share->speed = info->speed;
+	share->force_range = info->force_range;
+	share->is_linear_alpha = info->is_linear_alpha;
+	share->hardware_decoding = info->hardware_decoding;
+	share->gpu_frames = info->v_gpu_cb != NULL;
+	share->is_local_file = info->is_local_file;
+
+	/* the media keeps the options pointer, so it gets the copy */
+	info2.opaque = share;
+	info2.ffmpeg_options = share->ffmpeg_options;
+	info2.v_cb = share_video;
+	info2.v_gpu_cb = info->v_gpu_cb ? share_gpu_video : NULL;
+	info2.v_preload_cb = info->v_preload_cb ? share_preload_video : NULL;
+	info2.v_seek_cb = info->v_seek_cb ? share_seek_video : NULL;
+	info2.a_cb = share_audio;
+	info2.stop_cb = share_stopped;
+
+	if (!mp_media_init(&share->media, &info2)) {
+		pthread_mutex_destroy(&share->mutex);
+		bfree(share->path);
+		bfree(share->format_name);
+		bfree(share->ffmpeg_options);
+		bfree(share);
+		return NULL;
+	}
+
+	return share;
+}
+
+static void share_free(struct mp_share *share)
+{
+	mp_media_free(&share->media);
+	da_free(share->clients);
+	pthread_mutex_destroy(&share->mutex);
+	bfree(share->path);
+	bfree(share->format_name);
+	bfree(share->ffmpeg_options);
+	bfree(share);
+}
+
+bool mp_share_init(mp_share_client_t *c, const struct mp_media_info *info)
+{
+	struct mp_share *share = NULL;
+
+	memset(c, 0, sizeof(*c));
+	c->opaque = info->opaque;
+	c->v_cb = info->v_cb;
+	c->v_gpu_cb = info->v_gpu_cb;
+	c->v_shared_cb = info->v_shared_cb;
+	c->v_preload_cb = info->v_preload_cb;
+	c->v_seek_cb = info->v_seek_cb;
+	c->a_cb = info->a_cb;
+	c->stop_cb = info->stop_cb;
+
+	pthread_mutex_lock(&shares_mutex);
+	for (size_t i = 0; i < shares.num; i++) {
+		if (share_matches(shares.array[i], info)) {
+			share = shares.array[i];
+			break;
+		}
+	}
+
+	if (!share) {
+		share = share_create(info);
+		if (share)
+			da_push_back(shares, &share);
+	}
+
+	if (share) {
+		pthread_mutex_lock(&share->mutex);
+		da_push_back(share->clients, &c);
+		pthread_mutex_unlock(&share->mutex);
+		c->share = share;
+	}
+	pthread_mutex_unlock(&shares_mutex);
+
+	return share != NULL;
+}
+
+void mp_share_free(mp_share_client_t *c)
+{
+	struct mp_share *share = c->share;
+	bool destroy;
+
+	if (!share)
+		return;
+
+	pthread_mutex_lock(&shares_mutex);
+	pthread_mutex_lock(&share->mutex);
+	da_erase_item(share->clients, &c);
+	destroy = !share->clients.num;
+	pthread_mutex_unlock(&share->mutex);
+
+	if (destroy)
+		da_erase_item(shares, &share);
+	pthread_mutex_unlock(&shares_mutex);
+
+	/* stops the media thread, with no clients left its callbacks do
+	 * nothing */
+	if (destroy)
+		share_free(share);
+
+	memset(c, 0, sizeof(*c));
+}
+
+static inline bool others_playing(const mp_share_client_t *c)
+{
+	const struct mp_share *share = c->share;
+
+	for (size_t i = 0; i < share->clients.num; i++) {
+		const mp_share_client_t *other = share->clients.array[i];
+		if (other != c && other->playing)
+			return true;
+	}
+
+	return false;
+}
+
+void mp_share_play(mp_share_client_t *c, bool loop, bool reconnecting)
+{
+	struct mp_share *share = c->share;
+
+	pthread_mutex_lock(&share->mutex);
+	/* joins the playback of the others instead of restarting it */
+	if (!others_playing(c))
+		mp_media_play(&share->media, loop, reconnecting);
+	c->playing = true;
+	c->stop_pending = false;
+	pthread_mutex_unlock(&share->mutex);
+}
+
+void mp_share_stop(mp_share_client_t *c)
+{
+	struct mp_share *share = c->share;
+	bool notify = false;
+
+	pthread_mutex_lock(&share->mutex);
+	if (others_playing(c)) {
+		notify = c->playing;
+	} else {
+		/* notified by the media thread once the media has stopped */
+		c->stop_pending = c->playing;
+		mp_media_stop(&share->media);
+	}
+	c->playing = false;
+	pthread_mutex_unlock(&share->mutex);
+
+	if (notify && c->stop_cb)
+		c->stop_cb(c->opaque);
+}
+
+mp_media_t *mp_share_get_media(mp_share_client_t *c)
+{
+	return &c->share->media;
+}
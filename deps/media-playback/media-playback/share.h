@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "media.h"
+
+/* A decoder shared by every playback of the same input with the same
+ * options.  Frames are decoded once and passed to each playing client.  The
+ * clients only keep whether they are playing, everything else, such as the
+ * playback position, is common to all of them. */
+struct mp_share;
+
+struct mp_share_client {
+	struct mp_share *share;
+
+	mp_video_cb v_preload_cb;
+	mp_video_cb v_seek_cb;
+	mp_stop_cb stop_cb;
+	mp_video_cb v_cb;
+	mp_video_gpu_cb v_gpu_cb;
+	mp_video_shared_cb v_shared_cb;
+	mp_audio_cb a_cb;
+	void *opaque;
+
+	/* protected by the mutex of the share */
+	bool playing;
+	bool stop_pending;
+};
+
+typedef struct mp_share_client mp_share_client_t;
+
+extern bool mp_share_init(mp_share_client_t *c,
+			  const struct mp_media_info *info);
+extern void mp_share_free(mp_share_client_t *c);
+
+/* playing or stopping only affects the client, unless it is the only one
+ * that is playing */
+extern void mp_share_play(mp_share_client_t *c, bool loop, bool reconnecting);
+extern void mp_share_stop(mp_share_client_t *c);
+
+/* for everything that applies to all clients, such as pausing and seeking */
+extern mp_media_t *mp_share_get_media(mp_share_client_t *c);
@@ -59,7 +59,12 @@ add_library(OBS::scripting ALIAS obs-scripting)
 target_sources(
   obs-scripting
   PUBLIC obs-scripting.h
-  PRIVATE obs-scripting.c cstrcache.cpp cstrcache.h obs-scripting-logging.c obs-scripting-callback.h)
+  PRIVATE obs-scripting.c
+          cstrcache.cpp
+          cstrcache.h
+          obs-scripting-logging.c
+          obs-scripting-profiling.c
+          obs-scripting-callback.h)
 
 target_link_libraries(obs-scripting PRIVATE OBS::libobs)
 
@@ -30,6 +30,19 @@ struct obs_script {
 	struct dstr path;
 	struct dstr file;
 	struct dstr desc;
+
+	/* profiling */
+	const char *profile_name;
+	volatile int64_t total_ns;
+	volatile int64_t calls;
+	volatile int64_t frame_ns;
+	volatile int64_t last_frame_ns;
+	volatile int64_t max_frame_ns;
+	volatile int64_t frames_over_budget;
+	volatile bool over_budget_skip;
+	volatile bool budget_disabled;
+	int consecutive_over_budget;
+	uint64_t last_budget_warning;
 };
 
 struct script_callback;
@@ -37,6 +50,24 @@ typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
 
+extern bool script_profiling_init(void);
+extern void script_profiling_free(void);
+extern void script_profiling_add(obs_script_t *script);
+extern void script_profiling_remove(obs_script_t *script);
+extern void script_profiling_reset(obs_script_t *script);
+
+/* wrap every call into script code, the time is attributed to the script
+ * and shows up in the profiler under the given (static) name */
+extern uint64_t script_call_begin(obs_script_t *script, const char *name);
+extern void script_call_end(obs_script_t *script, const char *name,
+			    uint64_t start);
+
+/* whether per-frame callbacks (ticks, timers) should be skipped because
+ * the script went over the frame budget, or whether render callbacks should
+ * because the script was disabled for it */
+extern bool script_call_deferred(obs_script_t *script);
+extern bool script_call_disabled(obs_script_t *script);
+
 extern void script_log(obs_script_t *script, int level, const char *format,
 		       ...);
 extern void script_log_va(obs_script_t *script, int level, const char *format,
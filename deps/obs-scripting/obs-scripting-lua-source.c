@@ -78,11 +78,51 @@ static inline void get_callback_from_table_(lua_State *script, int idx,
 #define get_callback_from_table(script, idx, name, p_reg_idx) \
 	get_callback_from_table_(script, idx, name, p_reg_idx, __FUNCTION__)
 
+/* SWIG_TypeQuery compares the name against every type of the module, so
+ * the types that are actually converted are cached.  The type info is static
+ * data of the wrapper and therefore shared by all lua states. */
+#define TYPE_CACHE_SIZE 32
+
+struct type_cache_entry {
+	char type[64];
+	swig_type_info *info;
+};
+
+static struct type_cache_entry type_cache[TYPE_CACHE_SIZE];
+static size_t type_cache_num = 0;
+static pthread_mutex_t type_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static swig_type_info *type_query(lua_State *script, const char *type)
+{
+	swig_type_info *info = NULL;
+
+	pthread_mutex_lock(&type_cache_mutex);
+
+	for (size_t i = 0; i < type_cache_num; i++) {
+		if (strcmp(type_cache[i].type, type) == 0) {
+			info = type_cache[i].info;
+			goto unlock;
+		}
+	}
+
+	info = SWIG_TypeQuery(script, type);
+	if (info && type_cache_num < TYPE_CACHE_SIZE &&
+	    strlen(type) < sizeof(type_cache[0].type)) {
+		struct type_cache_entry *entry = &type_cache[type_cache_num++];
+		strcpy(entry->type, type);
+		entry->info = info;
+	}
+
+unlock:
+	pthread_mutex_unlock(&type_cache_mutex);
+	return info;
+}
+
 bool ls_get_libobs_obj_(lua_State *script, const char *type, int lua_idx,
 			void *libobs_out, const char *id, const char *func,
 			int line)
 {
-	swig_type_info *info = SWIG_TypeQuery(script, type);
+	swig_type_info *info = type_query(script, type);
 	if (info == NULL) {
 		warn("%s:%d: SWIG could not find type: %s%s%s", func, line,
 		     id ? id : "", id ? "::" : "", type);
@@ -108,7 +148,7 @@ bool ls_push_libobs_obj_(lua_State *script, const char *type, void *libobs_in,
 			 bool ownership, const char *id, const char *func,
 			 int line)
 {
-	swig_type_info *info = SWIG_TypeQuery(script, type);
+	swig_type_info *info = type_query(script, type);
 	if (info == NULL) {
 		warn("%s:%d: SWIG could not find type: %s%s%s", func, line,
 		     id ? id : "", id ? "::" : "", type);
@@ -420,6 +460,8 @@ static void obs_lua_source_video_tick(void *data, float seconds)
 		goto fail;
 	if (!have_func(video_tick))
 		goto fail;
+	if (script_call_deferred(&ls->data->base))
+		goto fail;
 
 	lock_script();
 
@@ -443,6 +485,8 @@ static void obs_lua_source_video_render(void *data, gs_effect_t *effect)
 		goto fail;
 	if (!have_func(video_render))
 		goto fail;
+	if (script_call_disabled(&ls->data->base))
+		goto fail;
 
 	lock_script();
 
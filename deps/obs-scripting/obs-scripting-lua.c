@@ -18,6 +18,7 @@
 #include "obs-scripting-lua.h"
 #include <util/platform.h>
 #include <util/base.h>
+#include <util/darray.h>
 #include <util/dstr.h>
 
 #include <obs.h>
@@ -304,6 +305,8 @@ static void timer_call(struct script_callback *p_cb)
 
 	if (script_callback_removed(p_cb))
 		return;
+	if (script_call_deferred(p_cb->script))
+		return;
 
 	lock_callback();
 	call_func_(cb->script, cb->reg_idx, 0, 0, "timer_cb", __FUNCTION__);
@@ -349,6 +352,9 @@ static void obs_lua_main_render_callback(void *priv, uint32_t cx, uint32_t cy)
 		return;
 	}
 
+	if (script_call_disabled(cb->base.script))
+		return;
+
 	lock_callback();
 
 	lua_pushinteger(script, (lua_Integer)cx);
@@ -396,6 +402,9 @@ static void obs_lua_tick_callback(void *priv, float seconds)
 		return;
 	}
 
+	if (script_call_deferred(cb->base.script))
+		return;
+
 	lock_callback();
 
 	lua_pushnumber(script, (lua_Number)seconds);
@@ -667,6 +676,46 @@ static int sceneitem_group_enum_items(lua_State *script)
 	return 1;
 }
 
+static int sceneitems_set_info2(lua_State *script)
+{
+	DARRAY(obs_sceneitem_t *) items = {0};
+	DARRAY(struct obs_transform_info) infos = {0};
+
+	size_t count = lua_rawlen(script, 1);
+	if (lua_rawlen(script, 2) != count) {
+		warn("obs_sceneitems_set_info2: item and transform tables "
+		     "differ in length");
+		return 0;
+	}
+
+	da_resize(items, count);
+	da_resize(infos, count);
+
+	for (size_t i = 0; i < count; i++) {
+		struct obs_transform_info *info = NULL;
+
+		lua_rawgeti(script, 1, (int)i + 1);
+		ls_get_libobs_obj(obs_sceneitem_t, -1, &items.array[i]);
+		lua_pop(script, 1);
+
+		lua_rawgeti(script, 2, (int)i + 1);
+		ls_get_libobs_obj(struct obs_transform_info, -1, &info);
+		lua_pop(script, 1);
+
+		if (!items.array[i] || !info) {
+			items.array[i] = NULL;
+			continue;
+		}
+		infos.array[i] = *info;
+	}
+
+	obs_sceneitems_set_info2(items.array, infos.array, count);
+
+	da_free(items);
+	da_free(infos);
+	return 0;
+}
+
 /* -------------------------------------------- */
 
 static void defer_hotkey_unregister(void *p_cb)
@@ -1038,6 +1087,7 @@ static void add_hook_functions(lua_State *script)
 	add_func("obs_source_enum_filters", source_enum_filters);
 	add_func("obs_scene_enum_items", scene_enum_items);
 	add_func("obs_sceneitem_group_enum_items", sceneitem_group_enum_items);
+	add_func("obs_sceneitems_set_info2", sceneitems_set_info2);
 	add_func("source_list_release", source_list_release);
 	add_func("sceneitem_list_release", sceneitem_list_release);
 	add_func("calldata_source", calldata_source);
@@ -1081,6 +1131,12 @@ static void lua_tick(void *param, float seconds)
 	data = first_tick_script;
 	while (data) {
 		lua_State *script = data->script;
+
+		if (script_call_deferred(&data->base)) {
+			data = data->next_tick;
+			continue;
+		}
+
 		current_lua_script = data;
 
 		pthread_mutex_lock(&data->mutex);
@@ -1170,6 +1226,7 @@ obs_script_t *obs_lua_script_create(const char *path, obs_data_t *settings)
 	if (settings)
 		obs_data_apply(data->base.settings, settings);
 
+	script_profiling_add((obs_script_t *)data);
 	obs_lua_script_load((obs_script_t *)data);
 	return (obs_script_t *)data;
 }
@@ -231,7 +231,11 @@ static inline bool call_func_(lua_State *script, int reg_idx, int args,
 	lua_rawgeti(script, LUA_REGISTRYINDEX, reg_idx);
 	lua_insert(script, -1 - args);
 
-	if (lua_pcall(script, args, rets, 0) != 0) {
+	uint64_t start = script_call_begin(&data->base, func);
+	int ret = lua_pcall(script, args, rets, 0);
+	script_call_end(&data->base, func, start);
+
+	if (ret != 0) {
 		script_warn(&data->base, "Failed to call %s for %s: %s", func,
 			    display_name, lua_tostring(script, -1));
 		lua_pop(script, 1);
@@ -0,0 +1,224 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+
+#include "obs-scripting-internal.h"
+
+/* number of consecutive frames over budget before a script's per-frame
+ * callbacks are disabled with OBS_SCRIPT_BUDGET_DISABLE */
+#define DISABLE_FRAMES 30
+
+/* minimum interval between over budget warnings for a script */
+#define WARN_INTERVAL_NS 10000000000ULL
+
+static pthread_mutex_t profiling_mutex;
+static DARRAY(obs_script_t *) profiled_scripts;
+
+static volatile int64_t frame_budget_ns = 0;
+static volatile long budget_action = OBS_SCRIPT_BUDGET_LOG;
+
+/* -------------------------------------------- */
+
+uint64_t script_call_begin(obs_script_t *script, const char *name)
+{
+	profile_start(script->profile_name);
+	profile_start(name);
+	return os_gettime_ns();
+}
+
+void script_call_end(obs_script_t *script, const char *name, uint64_t start)
+{
+	int64_t elapsed = (int64_t)(os_gettime_ns() - start);
+
+	profile_end(name);
+	profile_end(script->profile_name);
+
+	os_atomic_add_int64(&script->total_ns, elapsed);
+	os_atomic_add_int64(&script->calls, 1);
+
+	/* the budget is about the time taken from the graphics thread */
+	if (obs_in_task_thread(OBS_TASK_GRAPHICS))
+		os_atomic_add_int64(&script->frame_ns, elapsed);
+}
+
+bool script_call_deferred(obs_script_t *script)
+{
+	return os_atomic_load_bool(&script->over_budget_skip) ||
+	       os_atomic_load_bool(&script->budget_disabled);
+}
+
+bool script_call_disabled(obs_script_t *script)
+{
+	return os_atomic_load_bool(&script->budget_disabled);
+}
+
+/* -------------------------------------------- */
+
+static void check_script_budget(obs_script_t *script, uint64_t budget,
+				enum obs_script_budget_action action,
+				uint64_t now)
+{
+	int64_t frame_ns = os_atomic_load_int64(&script->frame_ns);
+	os_atomic_add_int64(&script->frame_ns, -frame_ns);
+
+	os_atomic_store_int64(&script->last_frame_ns, frame_ns);
+	if (frame_ns > os_atomic_load_int64(&script->max_frame_ns))
+		os_atomic_store_int64(&script->max_frame_ns, frame_ns);
+
+	if (!budget || (uint64_t)frame_ns <= budget) {
+		script->consecutive_over_budget = 0;
+		os_atomic_set_bool(&script->over_budget_skip, false);
+		return;
+	}
+
+	os_atomic_add_int64(&script->frames_over_budget, 1);
+	script->consecutive_over_budget++;
+
+	if (!script->last_budget_warning ||
+	    now - script->last_budget_warning >= WARN_INTERVAL_NS) {
+		script_warn(script,
+			    "Script callbacks took %.2f ms in one frame, "
+			    "over the budget of %.2f ms",
+			    (double)frame_ns / 1000000.0,
+			    (double)budget / 1000000.0);
+		script->last_budget_warning = now;
+	}
+
+	if (action == OBS_SCRIPT_BUDGET_DEFER) {
+		os_atomic_set_bool(&script->over_budget_skip, true);
+
+	} else if (action == OBS_SCRIPT_BUDGET_DISABLE &&
+		   script->consecutive_over_budget >= DISABLE_FRAMES &&
+		   !os_atomic_load_bool(&script->budget_disabled)) {
+		os_atomic_set_bool(&script->budget_disabled, true);
+		script_error(script,
+			     "Over the frame budget for %d frames in a row, "
+			     "tick, timer and render callbacks are disabled "
+			     "until the script is reloaded",
+			     DISABLE_FRAMES);
+	}
+}
+
+static void profiling_tick(void *param, float seconds)
+{
+	uint64_t budget = (uint64_t)os_atomic_load_int64(&frame_budget_ns);
+	enum obs_script_budget_action action =
+		(enum obs_script_budget_action)os_atomic_load_long(
+			&budget_action);
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&profiling_mutex);
+	for (size_t i = 0; i < profiled_scripts.num; i++)
+		check_script_budget(profiled_scripts.array[i], budget, action,
+				    now);
+	pthread_mutex_unlock(&profiling_mutex);
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(seconds);
+}
+
+/* -------------------------------------------- */
+
+bool script_profiling_init(void)
+{
+	if (pthread_mutex_init(&profiling_mutex, NULL) != 0)
+		return false;
+
+	da_init(profiled_scripts);
+	obs_add_tick_callback(profiling_tick, NULL);
+	return true;
+}
+
+void script_profiling_free(void)
+{
+	obs_remove_tick_callback(profiling_tick, NULL);
+	da_free(profiled_scripts);
+	pthread_mutex_destroy(&profiling_mutex);
+}
+
+void script_profiling_add(obs_script_t *script)
+{
+	script->profile_name = profile_store_name(obs_get_profiler_name_store(),
+						  "script: %s",
+						  script->file.array);
+
+	pthread_mutex_lock(&profiling_mutex);
+	da_push_back(profiled_scripts, &script);
+	pthread_mutex_unlock(&profiling_mutex);
+}
+
+void script_profiling_remove(obs_script_t *script)
+{
+	pthread_mutex_lock(&profiling_mutex);
+	da_erase_item(profiled_scripts, &script);
+	pthread_mutex_unlock(&profiling_mutex);
+}
+
+void script_profiling_reset(obs_script_t *script)
+{
+	pthread_mutex_lock(&profiling_mutex);
+	os_atomic_store_int64(&script->max_frame_ns, 0);
+	os_atomic_store_int64(&script->frames_over_budget, 0);
+	os_atomic_set_bool(&script->over_budget_skip, false);
+	os_atomic_set_bool(&script->budget_disabled, false);
+	script->consecutive_over_budget = 0;
+	script->last_budget_warning = 0;
+	pthread_mutex_unlock(&profiling_mutex);
+}
+
+/* -------------------------------------------- */
+
+void obs_scripting_set_frame_budget(uint64_t budget_ns,
+				    enum obs_script_budget_action action)
+{
+	os_atomic_store_int64(&frame_budget_ns, (int64_t)budget_ns);
+	os_atomic_store_long(&budget_action, (long)action);
+}
+
+uint64_t obs_scripting_get_frame_budget(void)
+{
+	return (uint64_t)os_atomic_load_int64(&frame_budget_ns);
+}
+
+enum obs_script_budget_action obs_scripting_get_budget_action(void)
+{
+	return (enum obs_script_budget_action)os_atomic_load_long(
+		&budget_action);
+}
+
+bool obs_script_get_stats(const obs_script_t *script,
+			  struct obs_script_stats *stats)
+{
+	if (!script || !stats)
+		return false;
+
+	stats->total_ns = (uint64_t)os_atomic_load_int64(&script->total_ns);
+	stats->calls = (uint64_t)os_atomic_load_int64(&script->calls);
+	stats->last_frame_ns =
+		(uint64_t)os_atomic_load_int64(&script->last_frame_ns);
+	stats->max_frame_ns =
+		(uint64_t)os_atomic_load_int64(&script->max_frame_ns);
+	stats->frames_over_budget =
+		(uint64_t)os_atomic_load_int64(&script->frames_over_budget);
+	stats->disabled = os_atomic_load_bool(&script->budget_disabled);
+	return true;
+}
@@ -57,6 +57,24 @@ static bool mutexes_loaded = false;
 
 static pthread_mutex_t tick_mutex;
 static struct obs_python_script *first_tick_script = NULL;
+static size_t tick_count = 0;
+static size_t threaded_tick_count = 0;
+
+/* script_tick_threaded functions are called on their own thread, which is
+ * woken up by the graphics thread tick.  tick_thread_mutex is held for a
+ * whole pass so scripts can't be freed while the thread still calls them. */
+static pthread_t tick_thread;
+static pthread_mutex_t tick_thread_mutex;
+static os_event_t *tick_thread_event = NULL;
+static bool tick_thread_active = false;
+static bool tick_thread_exit = false;
+static float tick_thread_seconds = 0.0f;
+
+/* transform batches set from the tick thread, applied at the start of the
+ * next frame */
+static pthread_mutex_t transforms_mutex;
+static DARRAY(obs_sceneitem_t *) pending_items;
+static DARRAY(struct obs_transform_info) pending_infos;
 
 static PyObject *py_obspython = NULL;
 struct obs_python_script *cur_python_script = NULL;
@@ -64,10 +82,41 @@ struct python_obs_callback *cur_python_cb = NULL;
 
 /* -------------------------------------------- */
 
+/* SWIG_TypeQuery compares the name against every type of the module, so
+ * the types that are actually converted are cached.  Only used with the GIL
+ * held. */
+#define TYPE_CACHE_SIZE 32
+
+struct type_cache_entry {
+	char type[64];
+	swig_type_info *info;
+};
+
+static struct type_cache_entry type_cache[TYPE_CACHE_SIZE];
+static size_t type_cache_num = 0;
+
+static swig_type_info *type_query(const char *type)
+{
+	for (size_t i = 0; i < type_cache_num; i++) {
+		if (strcmp(type_cache[i].type, type) == 0)
+			return type_cache[i].info;
+	}
+
+	swig_type_info *info = SWIG_TypeQuery(type);
+	if (info && type_cache_num < TYPE_CACHE_SIZE &&
+	    strlen(type) < sizeof(type_cache[0].type)) {
+		struct type_cache_entry *entry = &type_cache[type_cache_num++];
+		strcpy(entry->type, type);
+		entry->info = info;
+	}
+
+	return info;
+}
+
 bool py_to_libobs_(const char *type, PyObject *py_in, void *libobs_out,
 		   const char *id, const char *func, int line)
 {
-	swig_type_info *info = SWIG_TypeQuery(type);
+	swig_type_info *info = type_query(type);
 	if (info == NULL) {
 		warn("%s:%d: SWIG could not find type: %s%s%s", func, line,
 		     id ? id : "", id ? "::" : "", type);
@@ -89,7 +138,7 @@ bool libobs_to_py_(const char *type, void *libobs_in, bool ownership,
 		   PyObject **py_out, const char *id, const char *func,
 		   int line)
 {
-	swig_type_info *info = SWIG_TypeQuery(type);
+	swig_type_info *info = type_query(type);
 	if (info == NULL) {
 		warn("%s:%d: SWIG could not find type: %s%s%s", func, line,
 		     id ? id : "", id ? "::" : "", type);
@@ -118,10 +167,13 @@ bool libobs_to_py_(const char *type, void *libobs_in, bool ownership,
 	struct obs_python_script *__last_script = cur_python_script;     \
 	struct python_obs_callback *__last_cb = cur_python_cb;           \
 	cur_python_script = (struct obs_python_script *)cb->base.script; \
-	cur_python_cb = cb
-#define unlock_callback()                  \
-	cur_python_cb = __last_cb;         \
-	cur_python_script = __last_script; \
+	cur_python_cb = cb;                                              \
+	obs_script_t *__call_script = cb->base.script;                   \
+	uint64_t __call_start = script_call_begin(__call_script, __func__)
+#define unlock_callback()                                          \
+	script_call_end(__call_script, __func__, __call_start);    \
+	cur_python_cb = __last_cb;                                 \
+	cur_python_script = __last_script;                         \
 	unlock_python()
 
 /* ========================================================================= */
@@ -177,6 +229,7 @@ static bool load_python_script(struct obs_python_script *data)
 	PyObject *py_module = NULL;
 	PyObject *py_success = NULL;
 	PyObject *py_tick = NULL;
+	PyObject *py_tick_threaded = NULL;
 	PyObject *py_load = NULL;
 	PyObject *py_defaults = NULL;
 	bool success = false;
@@ -257,7 +310,15 @@ static bool load_python_script(struct obs_python_script *data)
 	}
 
 	py_tick = PyObject_GetAttrString(py_module, "script_tick");
-	if (py_tick) {
+	if (!py_tick)
+		PyErr_Clear();
+
+	py_tick_threaded =
+		PyObject_GetAttrString(py_module, "script_tick_threaded");
+	if (!py_tick_threaded)
+		PyErr_Clear();
+
+	if (py_tick || py_tick_threaded) {
 		pthread_mutex_lock(&tick_mutex);
 
 		struct obs_python_script *next = first_tick_script;
@@ -267,12 +328,17 @@ static bool load_python_script(struct obs_python_script *data)
 			next->p_prev_next_tick = &data->next_tick;
 		first_tick_script = data;
 
+		if (py_tick)
+			tick_count++;
+		if (py_tick_threaded)
+			threaded_tick_count++;
+
 		data->tick = py_tick;
+		data->tick_threaded = py_tick_threaded;
 		py_tick = NULL;
+		py_tick_threaded = NULL;
 
 		pthread_mutex_unlock(&tick_mutex);
-	} else {
-		PyErr_Clear();
 	}
 
 	py_load = PyObject_GetAttrString(py_module, "script_load");
@@ -299,6 +365,7 @@ static bool load_python_script(struct obs_python_script *data)
 fail:
 	Py_XDECREF(py_load);
 	Py_XDECREF(py_tick);
+	Py_XDECREF(py_tick_threaded);
 	Py_XDECREF(py_defaults);
 	Py_XDECREF(py_success);
 	Py_XDECREF(py_file);
@@ -433,6 +500,8 @@ static void timer_call(struct script_callback *p_cb)
 
 	if (script_callback_removed(p_cb))
 		return;
+	if (script_call_deferred(p_cb->script))
+		return;
 
 	lock_callback(cb);
 	PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
@@ -481,6 +550,9 @@ static void obs_python_tick_callback(void *priv, float seconds)
 		return;
 	}
 
+	if (script_call_deferred(cb->base.script))
+		return;
+
 	lock_callback(cb);
 
 	PyObject *args = Py_BuildValue("(f)", seconds);
@@ -1124,6 +1196,83 @@ static PyObject *sceneitem_group_enum_items(PyObject *self, PyObject *args)
 	return list;
 }
 
+static inline bool on_tick_thread(void)
+{
+	return tick_thread_active && pthread_equal(pthread_self(), tick_thread);
+}
+
+static void apply_pending_transforms(void)
+{
+	DARRAY(obs_sceneitem_t *) items;
+	DARRAY(struct obs_transform_info) infos;
+
+	pthread_mutex_lock(&transforms_mutex);
+	items.da = pending_items.da;
+	infos.da = pending_infos.da;
+	da_init(pending_items);
+	da_init(pending_infos);
+	pthread_mutex_unlock(&transforms_mutex);
+
+	obs_sceneitems_set_info2(items.array, infos.array, items.num);
+
+	for (size_t i = 0; i < items.num; i++)
+		obs_sceneitem_release(items.array[i]);
+	da_free(items);
+	da_free(infos);
+}
+
+static PyObject *sceneitems_set_info2(PyObject *self, PyObject *args)
+{
+	PyObject *py_items;
+	PyObject *py_infos;
+	DARRAY(obs_sceneitem_t *) items = {0};
+	DARRAY(struct obs_transform_info) infos = {0};
+
+	UNUSED_PARAMETER(self);
+
+	if (!parse_args(args, "OO", &py_items, &py_infos))
+		return python_none();
+
+	Py_ssize_t count = PyList_Size(py_items);
+	if (count < 0 || PyList_Size(py_infos) != count) {
+		PyErr_Clear();
+		warn("obs_sceneitems_set_info2: expected two lists of the "
+		     "same length");
+		return python_none();
+	}
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		PyObject *py_item = PyList_GetItem(py_items, i);
+		PyObject *py_info = PyList_GetItem(py_infos, i);
+		struct obs_transform_info *info;
+		obs_sceneitem_t *item;
+
+		if (!py_to_libobs(obs_sceneitem_t, py_item, &item) ||
+		    !py_to_libobs(struct obs_transform_info, py_info, &info))
+			continue;
+		if (!item || !info)
+			continue;
+
+		da_push_back(items, &item);
+		da_push_back(infos, info);
+	}
+
+	if (on_tick_thread()) {
+		pthread_mutex_lock(&transforms_mutex);
+		for (size_t i = 0; i < items.num; i++)
+			obs_sceneitem_addref(items.array[i]);
+		da_push_back_da(pending_items, items);
+		da_push_back_da(pending_infos, infos);
+		pthread_mutex_unlock(&transforms_mutex);
+	} else {
+		obs_sceneitems_set_info2(items.array, infos.array, items.num);
+	}
+
+	da_free(items);
+	da_free(infos);
+	return python_none();
+}
+
 /* -------------------------------------------- */
 
 static PyObject *source_list_release(PyObject *self, PyObject *args)
@@ -1253,6 +1402,7 @@ static void add_hook_functions(PyObject *module)
 		DEF_FUNC("obs_scene_enum_items", scene_enum_items),
 		DEF_FUNC("obs_sceneitem_group_enum_items",
 			 sceneitem_group_enum_items),
+		DEF_FUNC("obs_sceneitems_set_info2", sceneitems_set_info2),
 		DEF_FUNC("obs_remove_tick_callback",
 			 obs_python_remove_tick_callback),
 		DEF_FUNC("obs_add_tick_callback", obs_python_add_tick_callback),
@@ -1333,6 +1483,8 @@ obs_script_t *obs_python_script_create(const char *path, obs_data_t *settings)
 	if (settings)
 		obs_data_apply(data->base.settings, settings);
 
+	script_profiling_add((obs_script_t *)data);
+
 	if (!python_loaded)
 		return (obs_script_t *)data;
 
@@ -1387,8 +1539,19 @@ void obs_python_script_unload(obs_script_t *s)
 			next->p_prev_next_tick = data->p_prev_next_tick;
 		*data->p_prev_next_tick = next;
 
+		if (data->tick)
+			tick_count--;
+		if (data->tick_threaded)
+			threaded_tick_count--;
+
 		pthread_mutex_unlock(&tick_mutex);
 
+		/* wait for the tick thread to be done with the script */
+		if (data->tick_threaded) {
+			pthread_mutex_lock(&tick_thread_mutex);
+			pthread_mutex_unlock(&tick_thread_mutex);
+		}
+
 		data->p_prev_next_tick = NULL;
 		data->next_tick = NULL;
 	}
@@ -1396,10 +1559,12 @@ void obs_python_script_unload(obs_script_t *s)
 	relock_python();
 
 	Py_XDECREF(data->tick);
+	Py_XDECREF(data->tick_threaded);
 	Py_XDECREF(data->save);
 	Py_XDECREF(data->update);
 	Py_XDECREF(data->get_properties);
 	data->tick = NULL;
+	data->tick_threaded = NULL;
 	data->save = NULL;
 	data->update = NULL;
 	data->get_properties = NULL;
@@ -1465,7 +1630,9 @@ void obs_python_script_update(obs_script_t *s, obs_data_t *settings)
 	PyObject *py_settings;
 	if (libobs_to_py(obs_data_t, s->settings, false, &py_settings)) {
 		PyObject *args = Py_BuildValue("(O)", py_settings);
+		uint64_t start = script_call_begin(s, "script_update");
 		PyObject *ret = PyObject_CallObject(data->update, args);
+		script_call_end(s, "script_update", start);
 		py_error();
 
 		Py_XDECREF(ret);
@@ -1490,7 +1657,9 @@ obs_properties_t *obs_python_script_get_properties(obs_script_t *s)
 	lock_python();
 	cur_python_script = data;
 
+	uint64_t start = script_call_begin(s, "script_properties");
 	PyObject *ret = PyObject_CallObject(data->get_properties, NULL);
+	script_call_end(s, "script_properties", start);
 	if (!py_error())
 		py_to_libobs(obs_properties_t, ret, &props);
 	Py_XDECREF(ret);
@@ -1529,6 +1698,131 @@ void obs_python_script_save(obs_script_t *s)
 
 /* -------------------------------------------- */
 
+static void python_tick(void *param, float seconds);
+
+struct threaded_tick {
+	struct obs_python_script *script;
+	PyObject *func;
+};
+
+static void *tick_thread_proc(void *unused)
+{
+	DARRAY(struct threaded_tick) ticks = {0};
+
+	UNUSED_PARAMETER(unused);
+	os_set_thread_name("scripting: python tick");
+
+	while (os_event_wait(tick_thread_event) == 0) {
+		float seconds;
+
+		pthread_mutex_lock(&tick_thread_mutex);
+
+		/* the list is copied so tick_mutex is never held while
+		 * python code runs, the graphics thread takes it with the GIL
+		 * held */
+		pthread_mutex_lock(&tick_mutex);
+		if (tick_thread_exit) {
+			pthread_mutex_unlock(&tick_mutex);
+			pthread_mutex_unlock(&tick_thread_mutex);
+			break;
+		}
+
+		seconds = tick_thread_seconds;
+		tick_thread_seconds = 0.0f;
+
+		da_resize(ticks, 0);
+		for (struct obs_python_script *data = first_tick_script; data;
+		     data = data->next_tick) {
+			if (data->tick_threaded) {
+				struct threaded_tick tick = {
+					.script = data,
+					.func = data->tick_threaded,
+				};
+				da_push_back(ticks, &tick);
+			}
+		}
+		pthread_mutex_unlock(&tick_mutex);
+
+		if (ticks.num) {
+			lock_python();
+
+			PyObject *args = Py_BuildValue("(f)", seconds);
+
+			for (size_t i = 0; i < ticks.num; i++) {
+				struct obs_python_script *prev =
+					cur_python_script;
+				cur_python_script = ticks.array[i].script;
+
+				obs_script_t *script =
+					&ticks.array[i].script->base;
+				uint64_t start = script_call_begin(
+					script, "script_tick_threaded");
+
+				PyObject *py_ret = PyObject_CallObject(
+					ticks.array[i].func, args);
+				Py_XDECREF(py_ret);
+				py_error();
+
+				script_call_end(script, "script_tick_threaded",
+						start);
+
+				cur_python_script = prev;
+			}
+
+			Py_XDECREF(args);
+
+			unlock_python();
+		}
+
+		pthread_mutex_unlock(&tick_thread_mutex);
+	}
+
+	da_free(ticks);
+	return NULL;
+}
+
+static void start_tick_thread(void)
+{
+	tick_thread_exit = false;
+	tick_thread_seconds = 0.0f;
+
+	if (os_event_init(&tick_thread_event, OS_EVENT_TYPE_AUTO) != 0)
+		return;
+	if (pthread_create(&tick_thread, NULL, tick_thread_proc, NULL) != 0) {
+		os_event_destroy(tick_thread_event);
+		tick_thread_event = NULL;
+		warn("Failed to create python tick thread");
+		return;
+	}
+
+	tick_thread_active = true;
+}
+
+static void stop_tick_thread(void)
+{
+	if (!tick_thread_active)
+		return;
+
+	/* python_tick applies the pending transforms, stop it first */
+	obs_remove_tick_callback(python_tick, NULL);
+
+	pthread_mutex_lock(&tick_mutex);
+	tick_thread_exit = true;
+	pthread_mutex_unlock(&tick_mutex);
+
+	os_event_signal(tick_thread_event);
+	pthread_join(tick_thread, NULL);
+
+	os_event_destroy(tick_thread_event);
+	tick_thread_event = NULL;
+	tick_thread_active = false;
+
+	for (size_t i = 0; i < pending_items.num; i++)
+		obs_sceneitem_release(pending_items.array[i]);
+	da_free(pending_items);
+	da_free(pending_infos);
+}
+
 static void python_tick(void *param, float seconds)
 {
 	struct obs_python_script *data;
@@ -1539,12 +1833,25 @@ static void python_tick(void *param, float seconds)
 	 */
 	struct obs_python_script *busy_script = NULL;
 	bool valid;
+	bool threaded;
 	uint64_t ts = obs_get_video_frame_time();
 
+	/* --------------------------------- */
+	/* apply changes from the tick thread */
+
+	if (tick_thread_active)
+		apply_pending_transforms();
+
 	pthread_mutex_lock(&tick_mutex);
-	valid = !!first_tick_script;
+	valid = tick_count > 0;
+	threaded = threaded_tick_count > 0;
+	if (threaded)
+		tick_thread_seconds += seconds;
 	pthread_mutex_unlock(&tick_mutex);
 
+	if (threaded && tick_thread_active)
+		os_event_signal(tick_thread_event);
+
 	/* --------------------------------- */
 	/* process script_tick calls         */
 
@@ -1560,12 +1867,20 @@ static void python_tick(void *param, float seconds)
 			busy_script = cur_python_script;
 
 		while (data) {
-			cur_python_script = data;
+			if (data->tick && !script_call_deferred(&data->base)) {
+				cur_python_script = data;
+
+				uint64_t start = script_call_begin(
+					&data->base, "script_tick");
 
-			PyObject *py_ret =
-				PyObject_CallObject(data->tick, args);
-			Py_XDECREF(py_ret);
-			py_error();
+				PyObject *py_ret =
+					PyObject_CallObject(data->tick, args);
+				Py_XDECREF(py_ret);
+				py_error();
+
+				script_call_end(&data->base, "script_tick",
+						start);
+			}
 
 			data = data->next_tick;
 		}
@@ -1643,6 +1958,8 @@ void obs_python_load(void)
 	da_init(python_paths);
 
 	pthread_mutex_init(&tick_mutex, NULL);
+	pthread_mutex_init(&tick_thread_mutex, NULL);
+	pthread_mutex_init(&transforms_mutex, NULL);
 	pthread_mutex_init_recursive(&timer_mutex);
 
 	mutexes_loaded = true;
@@ -1791,16 +2108,22 @@ out:
 
 	python_loaded_at_all = success;
 
-	if (python_loaded)
+	if (python_loaded) {
+		start_tick_thread();
 		obs_add_tick_callback(python_tick, NULL);
+	}
 
 	return python_loaded;
 }
 
 void obs_python_unload(void)
 {
+	stop_tick_thread();
+
 	if (mutexes_loaded) {
 		pthread_mutex_destroy(&tick_mutex);
+		pthread_mutex_destroy(&tick_thread_mutex);
+		pthread_mutex_destroy(&transforms_mutex);
 		pthread_mutex_destroy(&timer_mutex);
 	}
 
@@ -78,6 +78,7 @@ struct obs_python_script {
 	struct script_callback *first_callback;
 
 	PyObject *tick;
+	PyObject *tick_threaded;
 	struct obs_python_script *next_tick;
 	struct obs_python_script **p_prev_next_tick;
 };
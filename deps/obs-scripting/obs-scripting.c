@@ -137,7 +137,15 @@ bool obs_scripting_load(void)
 		return false;
 	}
 
+	if (!script_profiling_init()) {
+		os_sem_destroy(defer_call_semaphore);
+		pthread_mutex_destroy(&defer_call_mutex);
+		pthread_mutex_destroy(&detach_mutex);
+		return false;
+	}
+
 	if (pthread_create(&defer_call_thread, NULL, defer_thread, NULL) != 0) {
+		script_profiling_free();
 		os_sem_destroy(defer_call_semaphore);
 		pthread_mutex_destroy(&defer_call_mutex);
 		pthread_mutex_destroy(&detach_mutex);
@@ -177,6 +185,7 @@ void obs_scripting_unload(void)
 #endif
 
 	dstr_free(&file_filter);
+	script_profiling_free();
 
 	/* ---------------------- */
 
@@ -398,6 +407,7 @@ bool obs_script_reload(obs_script_t *script)
 	if (script->type == OBS_SCRIPT_LANG_LUA) {
 		obs_lua_script_unload(script);
 		clear_call_queue();
+		script_profiling_reset(script);
 		obs_lua_script_load(script);
 		goto out;
 	}
@@ -406,6 +416,7 @@ bool obs_script_reload(obs_script_t *script)
 	if (script->type == OBS_SCRIPT_LANG_PYTHON) {
 		obs_python_script_unload(script);
 		clear_call_queue();
+		script_profiling_reset(script);
 		obs_python_script_load(script);
 		goto out;
 	}
@@ -425,6 +436,8 @@ void obs_script_destroy(obs_script_t *script)
 	if (!script)
 		return;
 
+	script_profiling_remove(script);
+
 #if defined(LUAJIT_FOUND)
 	if (script->type == OBS_SCRIPT_LANG_LUA) {
 		obs_lua_script_unload(script);
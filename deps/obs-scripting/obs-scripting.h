@@ -66,6 +66,40 @@ EXPORT void obs_script_update(obs_script_t *script, obs_data_t *settings);
 EXPORT bool obs_script_loaded(const obs_script_t *script);
 EXPORT bool obs_script_reload(obs_script_t *script);
 
+/* ------------------------------------------------------------------------- */
+/* Profiling */
+
+enum obs_script_budget_action {
+	/* only log scripts that go over the budget */
+	OBS_SCRIPT_BUDGET_LOG,
+	/* skip the tick and timer callbacks of the next frame */
+	OBS_SCRIPT_BUDGET_DEFER,
+	/* disable tick, timer and render callbacks after repeated overruns,
+	 * until the script is reloaded */
+	OBS_SCRIPT_BUDGET_DISABLE,
+};
+
+struct obs_script_stats {
+	uint64_t total_ns;
+	uint64_t calls;
+	uint64_t last_frame_ns;
+	uint64_t max_frame_ns;
+	uint64_t frames_over_budget;
+	bool disabled;
+};
+
+/**
+ * Sets how much time the callbacks of each script may take from the graphics
+ * thread per frame, 0 for no budget.
+ */
+EXPORT void obs_scripting_set_frame_budget(uint64_t budget_ns,
+					   enum obs_script_budget_action action);
+EXPORT uint64_t obs_scripting_get_frame_budget(void);
+EXPORT enum obs_script_budget_action obs_scripting_get_budget_action(void);
+
+EXPORT bool obs_script_get_stats(const obs_script_t *script,
+				 struct obs_script_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -83,6 +83,7 @@ static inline void wrap_blog(int log_level, const char *message)
 %ignore obs_hotkey_pair_register_output;
 %ignore obs_hotkey_pair_register_service;
 %ignore obs_hotkey_pair_register_source;
+%ignore obs_sceneitems_set_info2;
 
 %include "graphics/graphics.h"
 %include "graphics/vec4.h"
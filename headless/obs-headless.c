@@ -0,0 +1,1191 @@
+/* obs-headless.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Headless front end: loads a scene collection and a profile written by the
+ * regular UI, renders through the surfaceless EGL platform and is controlled
+ * through a local unix socket.
+ *
+ * The socket protocol is line based.  Every command is answered with zero or
+ * more data lines, followed by a line that is either "OK" or "ERROR <reason>":
+ *
+ *   status           streaming/recording state, current scene, frame stats
+ *   scenes           names of all scenes
+ *   scene <name>     switch the program to another scene (hard cut)
+ *   start-streaming, stop-streaming
+ *   start-recording, stop-recording
+ *   metrics          the metrics registry in Prometheus text format
+ *   quit             stop all outputs and exit
+ *
+ * With --remux it instead remuxes the given recordings to mp4, several at a
+ * time, and exits without starting libobs.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <obs.h>
+#include <obs-nix-platform.h>
+#include <media-io/media-remux.h>
+#include <util/config-file.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/metrics.h>
+#include <util/platform.h>
+
+#define MAX_CLIENTS 16
+#define MAX_LINE 4096
+#define DEFAULT_FILENAME_FORMAT "%CCYY-%MM-%DD %hh-%mm-%ss"
+
+struct client {
+	int fd;
+	struct dstr buf;
+};
+
+struct headless {
+	char *profile_dir;
+	config_t *basic;
+	bool advanced;
+
+	obs_service_t *service;
+	obs_encoder_t *stream_video;
+	obs_encoder_t *stream_audio;
+	obs_encoder_t *record_video;
+	obs_output_t *stream;
+	obs_output_t *record;
+
+	char *socket_path;
+	int listen_fd;
+	DARRAY(struct client) clients;
+};
+
+static int signal_pipe[2] = {-1, -1};
+static volatile bool quit_requested = false;
+static int log_verbosity = LOG_INFO;
+
+/* ------------------------------------------------------------------------- */
+/* logging                                                                   */
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	static const char *prefixes[] = {
+		[LOG_ERROR] = "error: ",
+		[LOG_WARNING] = "warning: ",
+		[LOG_INFO] = "",
+		[LOG_DEBUG] = "debug: ",
+	};
+	char str[MAX_LINE];
+
+	if (log_level > log_verbosity)
+		return;
+
+	vsnprintf(str, sizeof(str), msg, args);
+	fprintf(stderr, "%s%s\n", prefixes[log_level], str);
+
+	UNUSED_PARAMETER(param);
+}
+
+/* ------------------------------------------------------------------------- */
+/* profile                                                                   */
+
+static char *get_profile_file(struct headless *h, const char *file)
+{
+	struct dstr path = {0};
+	dstr_printf(&path, "%s/%s", h->profile_dir, file);
+	return path.array;
+}
+
+static obs_data_t *load_profile_json(struct headless *h, const char *file)
+{
+	char *path = get_profile_file(h, file);
+	obs_data_t *data = obs_data_create_from_json_file_safe(path, "bak");
+	bfree(path);
+	return data ? data : obs_data_create();
+}
+
+static void set_basic_defaults(config_t *basic)
+{
+	char *home = getenv("HOME");
+
+	config_set_default_string(basic, "Output", "Mode", "Simple");
+	config_set_default_string(basic, "Output", "FilenameFormatting",
+				  DEFAULT_FILENAME_FORMAT);
+
+	config_set_default_uint(basic, "SimpleOutput", "VBitrate", 2500);
+	config_set_default_uint(basic, "SimpleOutput", "ABitrate", 160);
+	config_set_default_string(basic, "SimpleOutput", "FilePath",
+				  home ? home : ".");
+	config_set_default_string(basic, "SimpleOutput", "RecFormat2", "mkv");
+
+	config_set_default_string(basic, "AdvOut", "Encoder", "obs_x264");
+	config_set_default_string(basic, "AdvOut", "AudioEncoder",
+				  "ffmpeg_aac");
+	config_set_default_string(basic, "AdvOut", "RecEncoder", "none");
+	config_set_default_uint(basic, "AdvOut", "TrackIndex", 1);
+	config_set_default_string(basic, "AdvOut", "RecFilePath",
+				  home ? home : ".");
+	config_set_default_string(basic, "AdvOut", "RecFormat2", "mkv");
+	for (int i = 1; i <= MAX_AUDIO_MIXES; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "Track%dBitrate", i);
+		config_set_default_uint(basic, "AdvOut", name, 160);
+	}
+
+	config_set_default_uint(basic, "Video", "BaseCX", 1920);
+	config_set_default_uint(basic, "Video", "BaseCY", 1080);
+	config_set_default_uint(basic, "Video", "OutputCX", 1920);
+	config_set_default_uint(basic, "Video", "OutputCY", 1080);
+	config_set_default_uint(basic, "Video", "FPSType", 0);
+	config_set_default_string(basic, "Video", "FPSCommon", "30");
+	config_set_default_uint(basic, "Video", "FPSInt", 30);
+	config_set_default_uint(basic, "Video", "FPSNum", 30);
+	config_set_default_uint(basic, "Video", "FPSDen", 1);
+	config_set_default_string(basic, "Video", "ScaleType", "bicubic");
+	config_set_default_string(basic, "Video", "ColorFormat", "NV12");
+	config_set_default_string(basic, "Video", "ColorSpace", "709");
+	config_set_default_string(basic, "Video", "ColorRange", "Partial");
+
+	config_set_default_uint(basic, "Audio", "SampleRate", 48000);
+	config_set_default_string(basic, "Audio", "ChannelSetup", "Stereo");
+}
+
+static bool load_profile(struct headless *h)
+{
+	char *path = get_profile_file(h, "basic.ini");
+	int ret = config_open(&h->basic, path, CONFIG_OPEN_EXISTING);
+
+	if (ret != CONFIG_SUCCESS) {
+		blog(LOG_ERROR, "Failed to open profile config '%s'", path);
+		bfree(path);
+		return false;
+	}
+
+	bfree(path);
+	set_basic_defaults(h->basic);
+
+	h->advanced = astrcmpi(config_get_string(h->basic, "Output", "Mode"),
+			       "Advanced") == 0;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* video/audio, these mirror what the UI does with the same settings         */
+
+static void get_fps(config_t *basic, uint32_t *num, uint32_t *den)
+{
+	static const struct {
+		const char *name;
+		uint32_t num;
+		uint32_t den;
+	} common_fps[] = {
+		{"10", 10, 1},         {"20", 20, 1},
+		{"24 NTSC", 24000, 1001}, {"25 PAL", 25, 1},
+		{"29.97", 30000, 1001}, {"48", 48, 1},
+		{"50 PAL", 50, 1},     {"59.94", 60000, 1001},
+		{"60", 60, 1},
+	};
+
+	uint64_t type = config_get_uint(basic, "Video", "FPSType");
+
+	if (type == 1) {
+		*num = (uint32_t)config_get_uint(basic, "Video", "FPSInt");
+		*den = 1;
+	} else if (type == 2) {
+		*num = (uint32_t)config_get_uint(basic, "Video", "FPSNum");
+		*den = (uint32_t)config_get_uint(basic, "Video", "FPSDen");
+	} else {
+		const char *val =
+			config_get_string(basic, "Video", "FPSCommon");
+		size_t count = sizeof(common_fps) / sizeof(common_fps[0]);
+
+		*num = 30;
+		*den = 1;
+		for (size_t i = 0; i < count; i++) {
+			if (val && strcmp(val, common_fps[i].name) == 0) {
+				*num = common_fps[i].num;
+				*den = common_fps[i].den;
+				break;
+			}
+		}
+	}
+
+	if (!*num || !*den) {
+		*num = 30;
+		*den = 1;
+	}
+}
+
+static enum video_format get_video_format(const char *name)
+{
+	if (astrcmpi(name, "I420") == 0)
+		return VIDEO_FORMAT_I420;
+	else if (astrcmpi(name, "NV12") == 0)
+		return VIDEO_FORMAT_NV12;
+	else if (astrcmpi(name, "I444") == 0)
+		return VIDEO_FORMAT_I444;
+	else if (astrcmpi(name, "I010") == 0)
+		return VIDEO_FORMAT_I010;
+	else if (astrcmpi(name, "P010") == 0)
+		return VIDEO_FORMAT_P010;
+	else if (astrcmpi(name, "P216") == 0)
+		return VIDEO_FORMAT_P216;
+	else if (astrcmpi(name, "P416") == 0)
+		return VIDEO_FORMAT_P416;
+	else
+		return VIDEO_FORMAT_BGRA;
+}
+
+static enum video_colorspace get_colorspace(const char *name)
+{
+	if (astrcmpi(name, "601") == 0)
+		return VIDEO_CS_601;
+	else if (astrcmpi(name, "709") == 0)
+		return VIDEO_CS_709;
+	else if (astrcmpi(name, "2100PQ") == 0)
+		return VIDEO_CS_2100_PQ;
+	else if (astrcmpi(name, "2100HLG") == 0)
+		return VIDEO_CS_2100_HLG;
+	else
+		return VIDEO_CS_SRGB;
+}
+
+static enum obs_scale_type get_scale_type(const char *name)
+{
+	if (astrcmpi(name, "bilinear") == 0)
+		return OBS_SCALE_BILINEAR;
+	else if (astrcmpi(name, "lanczos") == 0)
+		return OBS_SCALE_LANCZOS;
+	else if (astrcmpi(name, "area") == 0)
+		return OBS_SCALE_AREA;
+	else
+		return OBS_SCALE_BICUBIC;
+}
+
+static bool reset_video(struct headless *h, uint32_t adapter)
+{
+	struct obs_video_info ovi = {0};
+	config_t *basic = h->basic;
+
+	get_fps(basic, &ovi.fps_num, &ovi.fps_den);
+
+	ovi.graphics_module = DL_OPENGL;
+	ovi.base_width = (uint32_t)config_get_uint(basic, "Video", "BaseCX");
+	ovi.base_height = (uint32_t)config_get_uint(basic, "Video", "BaseCY");
+	ovi.output_width =
+		(uint32_t)config_get_uint(basic, "Video", "OutputCX");
+	ovi.output_height =
+		(uint32_t)config_get_uint(basic, "Video", "OutputCY");
+	ovi.output_format = get_video_format(
+		config_get_string(basic, "Video", "ColorFormat"));
+	ovi.colorspace =
+		get_colorspace(config_get_string(basic, "Video", "ColorSpace"));
+	ovi.range = astrcmpi(config_get_string(basic, "Video", "ColorRange"),
+			     "Full") == 0
+			    ? VIDEO_RANGE_FULL
+			    : VIDEO_RANGE_PARTIAL;
+	ovi.scale_type =
+		get_scale_type(config_get_string(basic, "Video", "ScaleType"));
+	ovi.adapter = adapter;
+	ovi.gpu_conversion = true;
+
+	if (ovi.base_width < 32 || ovi.base_height < 32) {
+		ovi.base_width = 1920;
+		ovi.base_height = 1080;
+	}
+	if (ovi.output_width < 32 || ovi.output_height < 32) {
+		ovi.output_width = ovi.base_width;
+		ovi.output_height = ovi.base_height;
+	}
+
+	int ret = obs_reset_video(&ovi);
+	if (ret != OBS_VIDEO_SUCCESS) {
+		blog(LOG_ERROR, "Failed to initialize video (%d)", ret);
+		return false;
+	}
+
+	return true;
+}
+
+static bool reset_audio(struct headless *h)
+{
+	struct obs_audio_info2 ai = {0};
+	const char *channels =
+		config_get_string(h->basic, "Audio", "ChannelSetup");
+
+	ai.samples_per_sec =
+		(uint32_t)config_get_uint(h->basic, "Audio", "SampleRate");
+
+	if (astrcmpi(channels, "Mono") == 0)
+		ai.speakers = SPEAKERS_MONO;
+	else if (astrcmpi(channels, "2.1") == 0)
+		ai.speakers = SPEAKERS_2POINT1;
+	else if (astrcmpi(channels, "4.0") == 0)
+		ai.speakers = SPEAKERS_4POINT0;
+	else if (astrcmpi(channels, "4.1") == 0)
+		ai.speakers = SPEAKERS_4POINT1;
+	else if (astrcmpi(channels, "5.1") == 0)
+		ai.speakers = SPEAKERS_5POINT1;
+	else if (astrcmpi(channels, "7.1") == 0)
+		ai.speakers = SPEAKERS_7POINT1;
+	else
+		ai.speakers = SPEAKERS_STEREO;
+
+	if (!obs_reset_audio2(&ai)) {
+		blog(LOG_ERROR, "Failed to initialize audio");
+		return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* scene collection                                                          */
+
+static const char *global_audio_devices[] = {
+	"DesktopAudioDevice1", "DesktopAudioDevice2", "AuxAudioDevice1",
+	"AuxAudioDevice2",     "AuxAudioDevice3",     "AuxAudioDevice4",
+};
+
+static bool find_first_scene(void *param, obs_source_t *scene)
+{
+	obs_source_t **first = param;
+	*first = obs_source_get_ref(scene);
+	return false;
+}
+
+static bool load_collection(const char *file)
+{
+	obs_data_t *data = obs_data_create_from_json_file_safe(file, "bak");
+	if (!data) {
+		blog(LOG_ERROR, "Failed to load scene collection '%s'", file);
+		return false;
+	}
+
+	for (size_t i = 0; i < sizeof(global_audio_devices) /
+				       sizeof(global_audio_devices[0]);
+	     i++) {
+		obs_data_t *device =
+			obs_data_get_obj(data, global_audio_devices[i]);
+		if (!device)
+			continue;
+
+		obs_source_t *source = obs_load_source(device);
+		if (source) {
+			obs_set_output_source((uint32_t)i + 1, source);
+			obs_source_release(source);
+		}
+		obs_data_release(device);
+	}
+
+	obs_data_array_t *sources = obs_data_get_array(data, "sources");
+	obs_data_array_t *groups = obs_data_get_array(data, "groups");
+
+	if (!sources) {
+		sources = groups;
+		groups = NULL;
+	} else if (groups) {
+		obs_data_array_push_back_array(sources, groups);
+	}
+
+	obs_load_sources(sources, NULL, NULL);
+
+	obs_data_array_release(sources);
+	obs_data_array_release(groups);
+
+	/* without a preview there is only the program scene */
+	const char *name = obs_data_get_string(data, "current_program_scene");
+	if (!name || !*name)
+		name = obs_data_get_string(data, "current_scene");
+
+	obs_source_t *scene = obs_get_source_by_name(name);
+	if (!scene || !obs_source_is_scene(scene)) {
+		obs_source_release(scene);
+		scene = NULL;
+		obs_enum_scenes(find_first_scene, &scene);
+	}
+
+	if (scene) {
+		obs_set_output_source(0, scene);
+		blog(LOG_INFO, "Program scene: '%s'",
+		     obs_source_get_name(scene));
+		obs_source_release(scene);
+	} else {
+		blog(LOG_WARNING, "Scene collection has no scenes");
+	}
+
+	obs_data_release(data);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* outputs                                                                   */
+
+static obs_encoder_t *create_video_encoder(struct headless *h,
+					   const char *id, const char *name,
+					   const char *settings_file)
+{
+	obs_data_t *settings = load_profile_json(h, settings_file);
+	obs_encoder_t *encoder;
+
+	if (!h->advanced) {
+		obs_data_set_string(settings, "rate_control", "CBR");
+		obs_data_set_int(settings, "bitrate",
+				 (int)config_get_uint(h->basic, "SimpleOutput",
+						      "VBitrate"));
+	}
+
+	encoder = obs_video_encoder_create(id, name, settings, NULL);
+	obs_data_release(settings);
+
+	if (!encoder) {
+		blog(LOG_ERROR, "Failed to create video encoder '%s'", id);
+		return NULL;
+	}
+
+	obs_encoder_set_video(encoder, obs_get_video());
+	return encoder;
+}
+
+static bool create_encoders(struct headless *h)
+{
+	const char *video_id = "obs_x264";
+	const char *audio_id = "ffmpeg_aac";
+	uint64_t audio_bitrate;
+	size_t track = 0;
+
+	if (h->advanced) {
+		char name[32];
+
+		video_id = config_get_string(h->basic, "AdvOut", "Encoder");
+		audio_id =
+			config_get_string(h->basic, "AdvOut", "AudioEncoder");
+		track = (size_t)config_get_uint(h->basic, "AdvOut",
+						"TrackIndex");
+		track = (track >= 1 && track <= MAX_AUDIO_MIXES) ? track - 1
+								 : 0;
+
+		snprintf(name, sizeof(name), "Track%dBitrate", (int)track + 1);
+		audio_bitrate = config_get_uint(h->basic, "AdvOut", name);
+	} else {
+		audio_bitrate =
+			config_get_uint(h->basic, "SimpleOutput", "ABitrate");
+	}
+
+	h->stream_video = create_video_encoder(h, video_id, "stream_video",
+					       "streamEncoder.json");
+	if (!h->stream_video)
+		return false;
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "bitrate", (int)audio_bitrate);
+	h->stream_audio = obs_audio_encoder_create(audio_id, "stream_audio",
+						   settings, track, NULL);
+	obs_data_release(settings);
+
+	if (!h->stream_audio) {
+		blog(LOG_ERROR, "Failed to create audio encoder '%s'",
+		     audio_id);
+		return false;
+	}
+
+	obs_encoder_set_audio(h->stream_audio, obs_get_audio());
+
+	const char *rec_id =
+		config_get_string(h->basic, "AdvOut", "RecEncoder");
+	if (h->advanced && rec_id && astrcmpi(rec_id, "none") != 0) {
+		h->record_video = create_video_encoder(
+			h, rec_id, "record_video", "recordEncoder.json");
+		if (!h->record_video)
+			return false;
+	} else {
+		h->record_video = obs_encoder_get_ref(h->stream_video);
+	}
+
+	return true;
+}
+
+static bool create_outputs(struct headless *h)
+{
+	obs_data_t *service_data = load_profile_json(h, "service.json");
+	const char *type = obs_data_get_string(service_data, "type");
+	obs_data_t *settings = obs_data_get_obj(service_data, "settings");
+
+	h->service = obs_service_create(type && *type ? type : "rtmp_custom",
+					"default_service", settings, NULL);
+	obs_data_release(settings);
+	obs_data_release(service_data);
+
+	if (!h->service) {
+		blog(LOG_ERROR, "Failed to create streaming service");
+		return false;
+	}
+
+	if (!create_encoders(h))
+		return false;
+
+	obs_data_t *vsettings = obs_encoder_get_settings(h->stream_video);
+	obs_data_t *asettings = obs_encoder_get_settings(h->stream_audio);
+	obs_service_apply_encoder_settings(h->service, vsettings, asettings);
+	obs_encoder_update(h->stream_video, vsettings);
+	obs_encoder_update(h->stream_audio, asettings);
+	obs_data_release(vsettings);
+	obs_data_release(asettings);
+
+	const char *output_type =
+		obs_service_get_preferred_output_type(h->service);
+	if (!output_type)
+		output_type = "rtmp_output";
+
+	h->stream = obs_output_create(output_type, "stream", NULL, NULL);
+	h->record = obs_output_create("ffmpeg_muxer", "record", NULL, NULL);
+	if (!h->stream || !h->record) {
+		blog(LOG_ERROR, "Failed to create outputs");
+		return false;
+	}
+
+	obs_output_set_service(h->stream, h->service);
+	obs_output_set_video_encoder(h->stream, h->stream_video);
+	obs_output_set_audio_encoder(h->stream, h->stream_audio, 0);
+
+	obs_output_set_video_encoder(h->record, h->record_video);
+	obs_output_set_audio_encoder(h->record, h->stream_audio, 0);
+	return true;
+}
+
+static void free_outputs(struct headless *h)
+{
+	obs_output_release(h->stream);
+	obs_output_release(h->record);
+	obs_encoder_release(h->stream_video);
+	obs_encoder_release(h->stream_audio);
+	obs_encoder_release(h->record_video);
+	obs_service_release(h->service);
+}
+
+static bool start_recording(struct headless *h, struct dstr *error)
+{
+	const char *section = h->advanced ? "AdvOut" : "SimpleOutput";
+	const char *dir = config_get_string(h->basic, section,
+					    h->advanced ? "RecFilePath"
+							: "FilePath");
+	const char *format = config_get_string(h->basic, section, "RecFormat2");
+	const char *filename_format =
+		config_get_string(h->basic, "Output", "FilenameFormatting");
+	bool fragmented = astrcmp_n(format, "fragmented_", 11) == 0;
+	const char *ext = fragmented ? format + 11 : format;
+
+	char *filename =
+		os_generate_formatted_filename(ext, true, filename_format);
+	struct dstr path = {0};
+	dstr_printf(&path, "%s/%s", dir, filename);
+	bfree(filename);
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_string(settings, "path", path.array);
+	if (fragmented)
+		obs_data_set_string(settings, "muxer_settings",
+				    "movflags=frag_keyframe+empty_moov"
+				    "+delay_moov");
+	obs_output_update(h->record, settings);
+	obs_data_release(settings);
+
+	bool success = obs_output_start(h->record);
+	if (success) {
+		blog(LOG_INFO, "Recording to '%s'", path.array);
+	} else {
+		const char *err = obs_output_get_last_error(h->record);
+		dstr_copy(error, err ? err : "failed to start recording");
+	}
+
+	dstr_free(&path);
+	return success;
+}
+
+static bool start_streaming(struct headless *h, struct dstr *error)
+{
+	if (obs_output_start(h->stream))
+		return true;
+
+	const char *err = obs_output_get_last_error(h->stream);
+	dstr_copy(error, err ? err : "failed to start streaming");
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* commands                                                                  */
+
+static bool enum_scene_names(void *param, obs_source_t *scene)
+{
+	struct dstr *out = param;
+	dstr_catf(out, "%s\n", obs_source_get_name(scene));
+	return true;
+}
+
+static void write_status(struct dstr *out, struct headless *h)
+{
+	obs_source_t *scene = obs_get_output_source(0);
+	video_t *video = obs_get_video();
+
+	dstr_catf(out, "streaming %d\n", obs_output_active(h->stream));
+	dstr_catf(out, "recording %d\n", obs_output_active(h->record));
+	dstr_catf(out, "scene %s\n", scene ? obs_source_get_name(scene) : "");
+	dstr_catf(out, "fps %.2f\n", obs_get_active_fps());
+	dstr_catf(out, "frames-rendered %u\n", obs_get_total_frames());
+	dstr_catf(out, "frames-lagged %u\n", obs_get_lagged_frames());
+	dstr_catf(out, "frames-encoded %u\n",
+		  video_output_get_total_frames(video));
+	dstr_catf(out, "frames-skipped %u\n",
+		  video_output_get_skipped_frames(video));
+	if (obs_output_active(h->stream))
+		dstr_catf(out, "frames-dropped %d\n",
+			  obs_output_get_frames_dropped(h->stream));
+
+	obs_source_release(scene);
+}
+
+static bool set_scene(const char *name, struct dstr *error)
+{
+	obs_source_t *scene = obs_get_source_by_name(name);
+	bool success = scene && obs_source_is_scene(scene);
+
+	if (success)
+		obs_set_output_source(0, scene);
+	else
+		dstr_printf(error, "no scene named '%s'", name);
+
+	obs_source_release(scene);
+	return success;
+}
+
+static void run_command(struct headless *h, const char *line,
+			struct dstr *out)
+{
+	struct dstr error = {0};
+	bool success = true;
+
+	if (strcmp(line, "status") == 0) {
+		write_status(out, h);
+	} else if (strcmp(line, "scenes") == 0) {
+		obs_enum_scenes(enum_scene_names, out);
+	} else if (strncmp(line, "scene ", 6) == 0) {
+		success = set_scene(line + 6, &error);
+	} else if (strcmp(line, "start-streaming") == 0) {
+		success = obs_output_active(h->stream) ||
+			  start_streaming(h, &error);
+	} else if (strcmp(line, "stop-streaming") == 0) {
+		obs_output_stop(h->stream);
+	} else if (strcmp(line, "start-recording") == 0) {
+		success = obs_output_active(h->record) ||
+			  start_recording(h, &error);
+	} else if (strcmp(line, "stop-recording") == 0) {
+		obs_output_stop(h->record);
+	} else if (strcmp(line, "metrics") == 0) {
+		metrics_write_prometheus(out);
+	} else if (strcmp(line, "quit") == 0) {
+		quit_requested = true;
+	} else {
+		success = false;
+		dstr_printf(&error, "unknown command '%s'", line);
+	}
+
+	if (success)
+		dstr_cat(out, "OK\n");
+	else
+		dstr_catf(out, "ERROR %s\n", error.array ? error.array : "");
+
+	dstr_free(&error);
+}
+
+/* ------------------------------------------------------------------------- */
+/* socket                                                                    */
+
+static bool send_all(int fd, const char *data, size_t size)
+{
+	while (size) {
+		ssize_t ret = send(fd, data, size, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		data += ret;
+		size -= (size_t)ret;
+	}
+
+	return true;
+}
+
+static bool open_socket(struct headless *h)
+{
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+
+	if (strlen(h->socket_path) >= sizeof(addr.sun_path)) {
+		blog(LOG_ERROR, "Socket path '%s' is too long", h->socket_path);
+		return false;
+	}
+
+	strcpy(addr.sun_path, h->socket_path);
+	unlink(h->socket_path);
+
+	h->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (h->listen_fd < 0) {
+		blog(LOG_ERROR, "socket failed: %s", strerror(errno));
+		return false;
+	}
+
+	if (bind(h->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(h->listen_fd, MAX_CLIENTS) < 0) {
+		blog(LOG_ERROR, "Failed to listen on '%s': %s", h->socket_path,
+		     strerror(errno));
+		close(h->listen_fd);
+		h->listen_fd = -1;
+		return false;
+	}
+
+	/* the socket controls outputs, keep it private to the user */
+	chmod(h->socket_path, 0600);
+
+	blog(LOG_INFO, "Listening on '%s'", h->socket_path);
+	return true;
+}
+
+static void close_client(struct headless *h, size_t idx)
+{
+	close(h->clients.array[idx].fd);
+	dstr_free(&h->clients.array[idx].buf);
+	da_erase(h->clients, idx);
+}
+
+static void accept_client(struct headless *h)
+{
+	int fd = accept4(h->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	if (h->clients.num >= MAX_CLIENTS) {
+		static const char busy[] = "ERROR too many clients\n";
+		send_all(fd, busy, sizeof(busy) - 1);
+		close(fd);
+		return;
+	}
+
+	struct client *client = da_push_back_new(h->clients);
+	client->fd = fd;
+}
+
+/* returns false if the client should be dropped */
+static bool read_client(struct headless *h, struct client *client)
+{
+	char buf[MAX_LINE];
+	ssize_t ret = recv(client->fd, buf, sizeof(buf), 0);
+
+	if (ret <= 0)
+		return ret < 0 && errno == EINTR;
+
+	dstr_ncat(&client->buf, buf, (size_t)ret);
+
+	char *line;
+	char *end;
+	while ((line = client->buf.array) &&
+	       (end = strchr(line, '\n')) != NULL) {
+		struct dstr out = {0};
+
+		*end = 0;
+		if (end > line && end[-1] == '\r')
+			end[-1] = 0;
+
+		run_command(h, line, &out);
+		dstr_remove(&client->buf, 0, (size_t)(end - line) + 1);
+
+		bool sent = send_all(client->fd, out.array, out.len);
+		dstr_free(&out);
+		if (!sent)
+			return false;
+	}
+
+	return client->buf.len < MAX_LINE;
+}
+
+static void run_loop(struct headless *h)
+{
+	struct pollfd fds[MAX_CLIENTS + 2];
+
+	while (!quit_requested) {
+		nfds_t num = 0;
+
+		fds[num++] = (struct pollfd){signal_pipe[0], POLLIN, 0};
+		if (h->listen_fd >= 0)
+			fds[num++] = (struct pollfd){h->listen_fd, POLLIN, 0};
+		for (size_t i = 0; i < h->clients.num; i++)
+			fds[num++] = (struct pollfd){h->clients.array[i].fd,
+						     POLLIN, 0};
+
+		if (poll(fds, num, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			blog(LOG_ERROR, "poll failed: %s", strerror(errno));
+			break;
+		}
+
+		if (fds[0].revents)
+			break;
+
+		size_t first_client = h->listen_fd >= 0 ? 2 : 1;
+
+		/* walk backwards, clients get erased while iterating */
+		for (size_t i = h->clients.num; i > 0; i--) {
+			struct pollfd *pfd = &fds[first_client + i - 1];
+
+			if (!pfd->revents)
+				continue;
+			if (!read_client(h, &h->clients.array[i - 1]))
+				close_client(h, i - 1);
+		}
+
+		if (h->listen_fd >= 0 && fds[1].revents & POLLIN)
+			accept_client(h);
+	}
+}
+
+static void close_socket(struct headless *h)
+{
+	while (h->clients.num)
+		close_client(h, h->clients.num - 1);
+	da_free(h->clients);
+
+	if (h->listen_fd >= 0) {
+		close(h->listen_fd);
+		unlink(h->socket_path);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void signal_handler(int sig)
+{
+	ssize_t ret = write(signal_pipe[1], "", 1);
+	UNUSED_PARAMETER(ret);
+	UNUSED_PARAMETER(sig);
+}
+
+static void init_signals(void)
+{
+	struct sigaction sa = {.sa_handler = signal_handler};
+
+	if (pipe2(signal_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+		blog(LOG_ERROR, "pipe2 failed: %s", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+}
+
+/* ------------------------------------------------------------------------- */
+/* batch remux                                                               */
+
+struct remux_state {
+	char **files;
+	volatile long remaining;
+};
+
+static void remux_finished(void *data, size_t job, bool success)
+{
+	struct remux_state *state = data;
+
+	if (success)
+		blog(LOG_INFO, "Remuxed '%s'", state->files[job]);
+	else
+		blog(LOG_ERROR, "Failed to remux '%s'", state->files[job]);
+
+	os_atomic_dec_long(&state->remaining);
+}
+
+static char *get_remux_target(const char *dir, const char *file)
+{
+	const char *name = strrchr(file, '/');
+	const char *ext;
+	struct dstr path = {0};
+
+	name = name ? name + 1 : file;
+	ext = os_get_path_extension(name);
+
+	dstr_printf(&path, "%s/%.*s.mp4", dir,
+		    (int)(ext ? (size_t)(ext - name) : strlen(name)), name);
+	return path.array;
+}
+
+static int run_remux(const char *dir, size_t jobs, char **files, int count)
+{
+	struct remux_state state = {files, count};
+	media_remux_batch_t batch = media_remux_batch_create(jobs);
+	bool success = false;
+
+	if (!batch)
+		return EXIT_FAILURE;
+
+	for (int i = 0; i < count; i++) {
+		char *target = get_remux_target(dir, files[i]);
+		media_remux_batch_add(batch, files[i], target);
+		bfree(target);
+	}
+
+	if (media_remux_batch_start(batch, NULL, remux_finished, &state)) {
+		struct pollfd pfd = {.fd = signal_pipe[0], .events = POLLIN};
+
+		while (os_atomic_load_long(&state.remaining) > 0) {
+			if (poll(&pfd, 1, 100) > 0) {
+				blog(LOG_INFO, "Stopping remux");
+				media_remux_batch_cancel(batch);
+				break;
+			}
+		}
+
+		success = media_remux_batch_wait(batch);
+	}
+
+	media_remux_batch_destroy(batch);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void stop_outputs(struct headless *h)
+{
+	obs_output_t *outputs[] = {h->stream, h->record};
+
+	for (size_t i = 0; i < 2; i++) {
+		if (outputs[i] && obs_output_active(outputs[i]))
+			obs_output_stop(outputs[i]);
+	}
+
+	/* give the outputs time to flush, like the UI does on exit */
+	for (int i = 0; i < 100; i++) {
+		bool active = false;
+		for (size_t j = 0; j < 2; j++)
+			active |= outputs[j] && obs_output_active(outputs[j]);
+		if (!active)
+			return;
+		os_sleep_ms(100);
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		if (outputs[i] && obs_output_active(outputs[i]))
+			obs_output_force_stop(outputs[i]);
+	}
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s --profile <dir> --collection <file> [options]\n"
+		"       %s --remux <dir> [--remux-jobs <n>] <file>...\n"
+		"\n"
+		"  -p, --profile <dir>       profile directory (basic.ini)\n"
+		"  -c, --collection <file>   scene collection json file\n"
+		"  -s, --socket <path>       control socket path\n"
+		"  -a, --adapter <index>     EGL device to render on\n"
+		"      --start-streaming     start streaming right away\n"
+		"      --start-recording     start recording right away\n"
+		"      --offline             render as fast as outputs allow\n"
+		"      --remux <dir>         remux files to mp4 in <dir>\n"
+		"      --remux-jobs <n>      files to remux at once\n"
+		"  -v, --verbose             log debug messages\n",
+		name, name);
+}
+
+enum {
+	OPT_START_STREAMING = 256,
+	OPT_START_RECORDING,
+	OPT_OFFLINE,
+	OPT_REMUX,
+	OPT_REMUX_JOBS,
+};
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_options[] = {
+		{"profile", required_argument, NULL, 'p'},
+		{"collection", required_argument, NULL, 'c'},
+		{"socket", required_argument, NULL, 's'},
+		{"adapter", required_argument, NULL, 'a'},
+		{"start-streaming", no_argument, NULL, OPT_START_STREAMING},
+		{"start-recording", no_argument, NULL, OPT_START_RECORDING},
+		{"offline", no_argument, NULL, OPT_OFFLINE},
+		{"remux", required_argument, NULL, OPT_REMUX},
+		{"remux-jobs", required_argument, NULL, OPT_REMUX_JOBS},
+		{"verbose", no_argument, NULL, 'v'},
+		{"help", no_argument, NULL, 'h'},
+		{0},
+	};
+
+	struct headless h = {.listen_fd = -1};
+	const char *collection = NULL;
+	const char *socket_path = NULL;
+	const char *remux_dir = NULL;
+	size_t remux_jobs = 0;
+	bool start_stream = false;
+	bool start_record = false;
+	bool offline = false;
+	uint32_t adapter = 0;
+	int ret = EXIT_FAILURE;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "p:c:s:a:vh", long_options,
+				  NULL)) != -1) {
+		switch (opt) {
+		case 'p':
+			h.profile_dir = bstrdup(optarg);
+			break;
+		case 'c':
+			collection = optarg;
+			break;
+		case 's':
+			socket_path = optarg;
+			break;
+		case 'a':
+			adapter = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'v':
+			log_verbosity = LOG_DEBUG;
+			break;
+		case OPT_START_STREAMING:
+			start_stream = true;
+			break;
+		case OPT_START_RECORDING:
+			start_record = true;
+			break;
+		case OPT_OFFLINE:
+			offline = true;
+			break;
+		case OPT_REMUX:
+			remux_dir = optarg;
+			break;
+		case OPT_REMUX_JOBS:
+			remux_jobs = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if (remux_dir) {
+		if (optind >= argc) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		base_set_log_handler(do_log, NULL);
+		init_signals();
+		ret = run_remux(remux_dir, remux_jobs, argv + optind,
+				argc - optind);
+		bfree(h.profile_dir);
+		return ret;
+	}
+
+	if (!h.profile_dir || !collection) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	base_set_log_handler(do_log, NULL);
+	init_signals();
+
+	if (socket_path) {
+		h.socket_path = bstrdup(socket_path);
+	} else {
+		const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+		struct dstr path = {0};
+		dstr_printf(&path, "%s/obs-headless.sock",
+			    runtime_dir ? runtime_dir : "/tmp");
+		h.socket_path = path.array;
+	}
+
+	if (!load_profile(&h))
+		goto fail_profile;
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_SURFACELESS);
+
+	char *module_config =
+		os_get_config_path_ptr("obs-studio/plugin_config");
+	bool started = obs_startup("en-US", module_config, NULL);
+	bfree(module_config);
+
+	if (!started) {
+		blog(LOG_ERROR, "Failed to initialize libobs");
+		goto fail_startup;
+	}
+
+	if (offline)
+		obs_set_offline_rendering(true);
+
+	if (!reset_audio(&h) || !reset_video(&h, adapter))
+		goto fail_reset;
+
+	struct obs_module_failure_info mfi;
+	obs_load_all_modules2(&mfi);
+	obs_module_failure_info_free(&mfi);
+	obs_log_loaded_modules();
+	obs_post_load_modules();
+
+	if (!load_collection(collection) || !create_outputs(&h))
+		goto fail_load;
+
+	if (!open_socket(&h))
+		goto fail_load;
+
+	struct dstr error = {0};
+	if (start_stream && !start_streaming(&h, &error))
+		blog(LOG_ERROR, "Could not start streaming: %s", error.array);
+	if (start_record && !start_recording(&h, &error))
+		blog(LOG_ERROR, "Could not start recording: %s", error.array);
+	dstr_free(&error);
+
+	run_loop(&h);
+	ret = EXIT_SUCCESS;
+
+	blog(LOG_INFO, "Shutting down");
+	close_socket(&h);
+
+fail_load:
+	stop_outputs(&h);
+	free_outputs(&h);
+	for (uint32_t i = 0; i < MAX_CHANNELS; i++)
+		obs_set_output_source(i, NULL);
+fail_reset:
+	obs_shutdown();
+fail_startup:
+	config_close(h.basic);
+fail_profile:
+	bfree(h.socket_path);
+	bfree(h.profile_dir);
+	return ret;
+}
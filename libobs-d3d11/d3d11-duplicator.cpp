@@ -44,6 +44,8 @@ void gs_duplicator::Start()
 	if (!get_monitor(device, idx, output.Assign()))
 		throw "Invalid monitor index";
 
+	full_copy = true;
+
 	hr = output->QueryInterface(IID_PPV_ARGS(output5.Assign()));
 	hdr = false;
 	sdr_white_nits = 80.f;
@@ -233,7 +235,39 @@ EXPORT void gs_duplicator_destroy(gs_duplicator_t *duplicator)
 	}
 }
 
-static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
+/* above this many dirty rects the whole frame is copied at once */
+static constexpr UINT MAX_DIRTY_RECTS = 64;
+
+/* Returns false if the changed areas are unknown or include moved areas */
+static bool get_dirty_rects(gs_duplicator_t *d,
+			    const DXGI_OUTDUPL_FRAME_INFO &info, UINT &count)
+{
+	UINT required = 0;
+	HRESULT hr;
+
+	if (!info.TotalMetadataBufferSize)
+		return false;
+	if (d->metadata.size() < info.TotalMetadataBufferSize)
+		d->metadata.resize(info.TotalMetadataBufferSize);
+
+	const UINT size = (UINT)d->metadata.size();
+
+	hr = d->duplicator->GetFrameMoveRects(
+		size, (DXGI_OUTDUPL_MOVE_RECT *)d->metadata.data(), &required);
+	if (FAILED(hr) || required)
+		return false;
+
+	hr = d->duplicator->GetFrameDirtyRects(
+		size, (RECT *)d->metadata.data(), &required);
+	if (FAILED(hr))
+		return false;
+
+	count = required / sizeof(RECT);
+	return count <= MAX_DIRTY_RECTS;
+}
+
+static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex,
+				const DXGI_OUTDUPL_FRAME_INFO &info)
 {
 	D3D11_TEXTURE2D_DESC desc;
 	tex->GetDesc(&desc);
@@ -245,6 +279,7 @@ static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
 	    (d->texture->format != general_format)) {
 
 		delete d->texture;
+		d->full_copy = true;
 		d->texture = (gs_texture_2d *)gs_texture_create(
 			desc.Width, desc.Height, general_format, 1, nullptr, 0);
 		d->color_space = d->hdr ? GS_CS_709_SCRGB
@@ -254,8 +289,28 @@ static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
 						   : GS_CS_SRGB);
 	}
 
-	if (d->texture)
+	if (!d->texture)
+		return;
+
+	UINT count;
+	if (d->full_copy || !get_dirty_rects(d, info, count)) {
 		d->device->context->CopyResource(d->texture->texture, tex);
+		d->full_copy = false;
+		return;
+	}
+
+	const RECT *rects = (const RECT *)d->metadata.data();
+	for (UINT i = 0; i < count; i++) {
+		const D3D11_BOX box = {(UINT)rects[i].left,
+				       (UINT)rects[i].top,
+				       0,
+				       (UINT)rects[i].right,
+				       (UINT)rects[i].bottom,
+				       1};
+		d->device->context->CopySubresourceRegion(
+			d->texture->texture, 0, box.left, box.top, 0, tex, 0,
+			&box);
+	}
 }
 
 EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
@@ -287,6 +342,14 @@ EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
 		return true;
 	}
 
+	/* only the pointer changed, the texture still holds the frame */
+	if (info.LastPresentTime.QuadPart == 0 && d->texture &&
+	    !d->full_copy) {
+		d->duplicator->ReleaseFrame();
+		d->updated = true;
+		return true;
+	}
+
 	hr = res->QueryInterface(__uuidof(ID3D11Texture2D),
 				 (void **)tex.Assign());
 	if (FAILED(hr)) {
@@ -298,7 +361,7 @@ EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
 		return true;
 	}
 
-	copy_texture(d, tex);
+	copy_texture(d, tex, info);
 	d->duplicator->ReleaseFrame();
 	d->updated = true;
 	return true;
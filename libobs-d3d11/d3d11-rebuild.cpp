@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <util/platform.h>
 #include "d3d11-subsystem.hpp"
 
 void gs_vertex_buffer::Rebuild()
@@ -122,6 +123,25 @@ void gs_texture_2d::Rebuild(ID3D11Device *dev)
 	}
 }
 
+/* static textures are the bulk of the data to upload again, everything the
+ * render and output paths write to is recreated right away */
+bool gs_texture_2d::CanDeferRebuild() const
+{
+	return !isShared && !isRenderTarget && !isDynamic && !isGDICompatible &&
+	       !pairedTexture &&
+	       (td.MiscFlags & D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX) == 0;
+}
+
+void gs_texture_2d::FinishRebuild()
+try {
+	rebuildPending = false;
+	Rebuild(device->device);
+
+} catch (const HRError &error) {
+	blog(LOG_ERROR, "Failed to rebuild texture: %s (%08lX)", error.str,
+	     error.hr);
+}
+
 void gs_texture_2d::RebuildPaired_Y(ID3D11Device *dev)
 {
 	gs_texture_2d *tex_uv = pairedTexture;
@@ -501,7 +521,10 @@ try {
 			break;
 		case gs_type::gs_texture_2d: {
 			gs_texture_2d *tex = (gs_texture_2d *)obj;
-			if (!tex->pairedTexture) {
+			if (tex->CanDeferRebuild()) {
+				tex->rebuildPending = true;
+				rebuildsPending = true;
+			} else if (!tex->pairedTexture) {
 				tex->Rebuild(dev);
 			} else if (!tex->chroma) {
 				tex->RebuildPaired_Y(dev);
@@ -550,7 +573,10 @@ try {
 	curZStencilBuffer = nullptr;
 	curRenderSide = 0;
 	memset(&curTextures, 0, sizeof(curTextures));
+	memset(&curTextureViews, 0, sizeof(curTextureViews));
 	memset(&curSamplers, 0, sizeof(curSamplers));
+	viewportValid = false;
+	scissorRectValid = false;
 	curVertexBuffer = nullptr;
 	curIndexBuffer = nullptr;
 	curVertexShader = nullptr;
@@ -574,9 +600,41 @@ try {
 	for (gs_device_loss &callback : loss_callbacks)
 		callback.device_loss_rebuild(device.Get(), callback.data);
 
+	if (rebuildsPending)
+		blog(LOG_INFO, "Deferring rebuild of static textures");
+
 } catch (const char *error) {
 	bcrash("Failed to recreate D3D11: %s", error);
 
 } catch (const HRError &error) {
 	bcrash("Failed to recreate D3D11: %s (%08lX)", error.str, error.hr);
 }
+
+/* spreads the rest of the rebuild over the frames after device loss so the
+ * outputs don't stall */
+#define PENDING_REBUILD_BUDGET_NS 4000000ULL
+
+void gs_device::RebuildPendingTextures()
+{
+	if (!rebuildsPending)
+		return;
+
+	const uint64_t start = os_gettime_ns();
+
+	for (gs_obj *obj = first_obj; obj; obj = obj->next) {
+		if (obj->obj_type != gs_type::gs_texture_2d)
+			continue;
+
+		gs_texture_2d *tex = (gs_texture_2d *)obj;
+		if (!tex->rebuildPending)
+			continue;
+
+		if (os_gettime_ns() - start >= PENDING_REBUILD_BUDGET_NS)
+			return;
+
+		tex->FinishRebuild();
+	}
+
+	rebuildsPending = false;
+	blog(LOG_INFO, "Finished rebuilding static textures");
+}
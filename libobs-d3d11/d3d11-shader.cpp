@@ -186,6 +186,8 @@ void gs_shader::BuildConstantBuffer()
 		constantSize += size;
 	}
 
+	constData.assign(constantSize, 0);
+
 	memset(&bd, 0, sizeof(bd));
 
 	if (constantSize) {
@@ -327,29 +329,23 @@ void gs_shader::Compile(const char *shaderString, const char *file,
 #endif
 }
 
-inline void gs_shader::UpdateParam(vector<uint8_t> &constData,
-				   gs_shader_param &param, bool &upload)
+inline void gs_shader::UpdateParam(gs_shader_param &param, bool &upload)
 {
 	if (param.type != GS_SHADER_PARAM_TEXTURE) {
 		if (!param.curValue.size())
 			throw "Not all shader parameters were set";
 
-		/* padding in case the constant needs to start at a new
-		 * register */
-		if (param.pos > constData.size()) {
-			uint8_t zero = 0;
-
-			constData.insert(constData.end(),
-					 param.pos - constData.size(), zero);
-		}
+		if (!param.changed)
+			return;
 
-		constData.insert(constData.end(), param.curValue.begin(),
-				 param.curValue.end());
+		const size_t end = param.pos + param.curValue.size();
+		if (end > constData.size())
+			throw "Invalid constant data size given to shader";
 
-		if (param.changed) {
-			upload = true;
-			param.changed = false;
-		}
+		memcpy(constData.data() + param.pos, param.curValue.data(),
+		       param.curValue.size());
+		upload = true;
+		param.changed = false;
 
 	} else if (param.curValue.size() == sizeof(struct gs_shader_texture)) {
 		struct gs_shader_texture shader_tex;
@@ -362,9 +358,8 @@ inline void gs_shader::UpdateParam(vector<uint8_t> &constData,
 					    param.textureID);
 
 		if (param.nextSampler) {
-			ID3D11SamplerState *state = param.nextSampler->state;
-			device->context->PSSetSamplers(param.textureID, 1,
-						       &state);
+			device_load_samplerstate(device, param.nextSampler,
+						 param.textureID);
 			param.nextSampler = nullptr;
 		}
 	}
@@ -372,16 +367,10 @@ inline void gs_shader::UpdateParam(vector<uint8_t> &constData,
 
 void gs_shader::UploadParams()
 {
-	vector<uint8_t> constData;
 	bool upload = false;
 
-	constData.reserve(constantSize);
-
 	for (size_t i = 0; i < params.size(); i++)
-		UpdateParam(constData, params[i], upload);
-
-	if (constData.size() != constantSize)
-		throw "Invalid constant data size given to shader";
+		UpdateParam(params[i], upload);
 
 	if (upload) {
 		D3D11_MAPPED_SUBRESOURCE map;
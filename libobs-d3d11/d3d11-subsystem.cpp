@@ -824,12 +824,75 @@ ID3D11BlendState *gs_device::AddBlendState()
 	return state;
 }
 
+static const char *state_call_names[] = {
+	"blend",
+	"raster",
+	"zstencil",
+	"viewport",
+	"scissor",
+	"topology",
+	"vertex_buffers",
+	"index_buffer",
+	"texture",
+	"sampler",
+	"vertex_shader",
+	"pixel_shader",
+};
+static_assert(_countof(state_call_names) == StateCallStats::count,
+	      "state_call_names does not match StateCall");
+
+static metric_t *get_state_call_metric(const char *state, const char *result)
+{
+	struct dstr labels = {0};
+	metric_t *metric;
+
+	metric_label_cat(&labels, "state", state);
+	metric_label_cat(&labels, "result", result);
+	metric = metric_get(METRIC_COUNTER, "obs_d3d11_state_calls_total",
+			    labels.array,
+			    "D3D11 state and binding calls by whether they "
+			    "were issued or skipped as redundant");
+	dstr_free(&labels);
+	return metric;
+}
+
+StateCallStats::StateCallStats()
+{
+	for (size_t i = 0; i < count; i++) {
+		issuedMetrics[i] =
+			get_state_call_metric(state_call_names[i], "issued");
+		skippedMetrics[i] =
+			get_state_call_metric(state_call_names[i], "skipped");
+	}
+}
+
+StateCallStats::~StateCallStats()
+{
+	for (size_t i = 0; i < count; i++) {
+		metric_release(issuedMetrics[i]);
+		metric_release(skippedMetrics[i]);
+	}
+}
+
+/* counted locally as this is done for every draw, published once a frame */
+void StateCallStats::Publish()
+{
+	for (size_t i = 0; i < count; i++) {
+		metric_add(issuedMetrics[i], (int64_t)issued[i]);
+		metric_add(skippedMetrics[i], (int64_t)skipped[i]);
+		issued[i] = 0;
+		skipped[i] = 0;
+	}
+}
+
 void gs_device::UpdateZStencilState()
 {
 	ID3D11DepthStencilState *state = NULL;
 
-	if (!zstencilStateChanged)
+	if (!zstencilStateChanged) {
+		stateCalls.Count(StateCall::ZStencil, false);
 		return;
+	}
 
 	for (size_t i = 0; i < zstencilStates.size(); i++) {
 		SavedZStencilState &s = zstencilStates[i];
@@ -842,6 +905,7 @@ void gs_device::UpdateZStencilState()
 	if (!state)
 		state = AddZStencilState();
 
+	stateCalls.Count(StateCall::ZStencil, state != curDepthStencilState);
 	if (state != curDepthStencilState) {
 		context->OMSetDepthStencilState(state, 0);
 		curDepthStencilState = state;
@@ -854,8 +918,10 @@ void gs_device::UpdateRasterState()
 {
 	ID3D11RasterizerState *state = NULL;
 
-	if (!rasterStateChanged)
+	if (!rasterStateChanged) {
+		stateCalls.Count(StateCall::Raster, false);
 		return;
+	}
 
 	for (size_t i = 0; i < rasterStates.size(); i++) {
 		SavedRasterState &s = rasterStates[i];
@@ -868,6 +934,7 @@ void gs_device::UpdateRasterState()
 	if (!state)
 		state = AddRasterState();
 
+	stateCalls.Count(StateCall::Raster, state != curRasterState);
 	if (state != curRasterState) {
 		context->RSSetState(state);
 		curRasterState = state;
@@ -880,8 +947,10 @@ void gs_device::UpdateBlendState()
 {
 	ID3D11BlendState *state = NULL;
 
-	if (!blendStateChanged)
+	if (!blendStateChanged) {
+		stateCalls.Count(StateCall::Blend, false);
 		return;
+	}
 
 	for (size_t i = 0; i < blendStates.size(); i++) {
 		SavedBlendState &s = blendStates[i];
@@ -894,6 +963,7 @@ void gs_device::UpdateBlendState()
 	if (!state)
 		state = AddBlendState();
 
+	stateCalls.Count(StateCall::Blend, state != curBlendState);
 	if (state != curBlendState) {
 		float f[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 		context->OMSetBlendState(state, f, 0xFFFFFFFF);
@@ -956,6 +1026,7 @@ gs_device::gs_device(uint32_t adapterIdx)
 
 	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
 		curTextures[i] = NULL;
+		curTextureViews[i] = NULL;
 		curSamplers[i] = NULL;
 	}
 
@@ -1940,8 +2011,12 @@ enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
 void gs_device::LoadVertexBufferData()
 {
 	if (curVertexBuffer == lastVertexBuffer &&
-	    curVertexShader == lastVertexShader)
+	    curVertexShader == lastVertexShader) {
+		stateCalls.Count(StateCall::VertexBuffers, false);
 		return;
+	}
+
+	stateCalls.Count(StateCall::VertexBuffers, true);
 
 	ID3D11Buffer *buffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
 	uint32_t strides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
@@ -1983,6 +2058,8 @@ void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *indexbuffer)
 	DXGI_FORMAT format;
 	ID3D11Buffer *buffer;
 
+	device->stateCalls.Count(StateCall::IndexBuffer,
+				 device->curIndexBuffer != indexbuffer);
 	if (device->curIndexBuffer == indexbuffer)
 		return;
 
@@ -2011,16 +2088,23 @@ static void device_load_texture_internal(gs_device_t *device, gs_texture_t *tex,
 					 int unit,
 					 ID3D11ShaderResourceView *view)
 {
-	if (device->curTextures[unit] == tex)
+	/* the linear and sRGB views of a texture are different bindings */
+	bool same = device->curTextures[unit] == tex &&
+		    device->curTextureViews[unit] == view;
+
+	device->stateCalls.Count(StateCall::Texture, !same);
+	if (same)
 		return;
 
 	device->curTextures[unit] = tex;
+	device->curTextureViews[unit] = view;
 	device->context->PSSetShaderResources(unit, 1, &view);
 }
 
 void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
 {
 	ID3D11ShaderResourceView *view;
+	finish_texture_rebuild(tex);
 	if (tex)
 		view = tex->shaderRes;
 	else
@@ -2031,6 +2115,7 @@ void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
 void device_load_texture_srgb(gs_device_t *device, gs_texture_t *tex, int unit)
 {
 	ID3D11ShaderResourceView *view;
+	finish_texture_rebuild(tex);
 	if (tex)
 		view = tex->shaderResLinear;
 	else
@@ -2043,6 +2128,8 @@ void device_load_samplerstate(gs_device_t *device,
 {
 	ID3D11SamplerState *state = NULL;
 
+	device->stateCalls.Count(StateCall::Sampler,
+				 device->curSamplers[unit] != samplerstate);
 	if (device->curSamplers[unit] == samplerstate)
 		return;
 
@@ -2059,6 +2146,8 @@ void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
 	ID3D11InputLayout *layout = NULL;
 	ID3D11Buffer *constants = NULL;
 
+	device->stateCalls.Count(StateCall::VertexShader,
+				 device->curVertexShader != vertshader);
 	if (device->curVertexShader == vertshader)
 		return;
 
@@ -2088,6 +2177,7 @@ static inline void clear_textures(gs_device_t *device)
 	ID3D11ShaderResourceView *views[GS_MAX_TEXTURES];
 	memset(views, 0, sizeof(views));
 	memset(device->curTextures, 0, sizeof(device->curTextures));
+	memset(device->curTextureViews, 0, sizeof(device->curTextureViews));
 	device->context->PSSetShaderResources(0, GS_MAX_TEXTURES, views);
 }
 
@@ -2097,6 +2187,8 @@ void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
 	ID3D11Buffer *constants = NULL;
 	ID3D11SamplerState *states[GS_MAX_TEXTURES];
 
+	device->stateCalls.Count(StateCall::PixelShader,
+				 device->curPixelShader != pixelshader);
 	if (device->curPixelShader == pixelshader)
 		return;
 
@@ -2267,6 +2359,7 @@ void gs_device::CopyTex(ID3D11Texture2D *dst, uint32_t dst_x, uint32_t dst_y,
 		throw "Source texture must be a 2D texture";
 
 	gs_texture_2d *tex2d = static_cast<gs_texture_2d *>(src);
+	finish_texture_rebuild(src);
 
 	if (dst_x == 0 && dst_y == 0 && src_x == 0 && src_y == 0 &&
 	    src_w == 0 && src_h == 0) {
@@ -2349,6 +2442,7 @@ void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst,
 			copyHeight = 0;
 		}
 
+		finish_texture_rebuild(dst);
 		device->CopyTex(dst2d->texture, dst_x, dst_y, src, src_x, src_y,
 				copyWidth, copyHeight);
 
@@ -2383,6 +2477,14 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 
 		device->CopyTex(dst->texture, 0, 0, src, 0, 0, 0, 0);
 
+		/* marks the end of the copy for gs_stagesurface_ready */
+		if (!dst->query) {
+			D3D11_QUERY_DESC qd = {D3D11_QUERY_EVENT, 0};
+			device->device->CreateQuery(&qd, dst->query.Assign());
+		}
+		if (dst->query)
+			device->context->End(dst->query);
+
 	} catch (const char *error) {
 		blog(LOG_ERROR, "device_copy_texture (D3D11): %s", error);
 	}
@@ -2392,8 +2494,8 @@ extern "C" void reset_duplicators(void);
 
 void device_begin_frame(gs_device_t *device)
 {
-	/* does nothing in D3D11 */
-	UNUSED_PARAMETER(device);
+	device->stateCalls.Publish();
+	device->RebuildPendingTextures();
 
 	reset_duplicators();
 }
@@ -2445,6 +2547,8 @@ void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
 	}
 
 	D3D11_PRIMITIVE_TOPOLOGY newTopology = ConvertGSTopology(draw_mode);
+	device->stateCalls.Count(StateCall::Topology,
+				 device->curToplogy != newTopology);
 	if (device->curToplogy != newTopology) {
 		device->context->IASetPrimitiveTopology(newTopology);
 		device->curToplogy = newTopology;
@@ -2740,6 +2844,15 @@ void device_set_viewport(gs_device_t *device, int x, int y, int width,
 			 int height)
 {
 	D3D11_VIEWPORT vp;
+
+	bool same = device->viewportValid && device->viewport.x == x &&
+		    device->viewport.y == y && device->viewport.cx == width &&
+		    device->viewport.cy == height;
+
+	device->stateCalls.Count(StateCall::Viewport, !same);
+	if (same)
+		return;
+
 	memset(&vp, 0, sizeof(vp));
 	vp.MaxDepth = 1.0f;
 	vp.TopLeftX = (float)x;
@@ -2752,6 +2865,7 @@ void device_set_viewport(gs_device_t *device, int x, int y, int width,
 	device->viewport.y = y;
 	device->viewport.cx = width;
 	device->viewport.cy = height;
+	device->viewportValid = true;
 }
 
 void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
@@ -2763,17 +2877,29 @@ void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
 {
 	D3D11_RECT d3drect;
 
-	device->rasterState.scissorEnabled = (rect != NULL);
-
-	if (rect != NULL) {
-		d3drect.left = rect->x;
-		d3drect.top = rect->y;
-		d3drect.right = rect->x + rect->cx;
-		d3drect.bottom = rect->y + rect->cy;
-		device->context->RSSetScissorRects(1, &d3drect);
+	if (device->rasterState.scissorEnabled != (rect != NULL)) {
+		device->rasterState.scissorEnabled = (rect != NULL);
+		device->rasterStateChanged = true;
 	}
 
-	device->rasterStateChanged = true;
+	if (!rect)
+		return;
+
+	bool same = device->scissorRectValid &&
+		    memcmp(&device->scissorRect, rect, sizeof(*rect)) == 0;
+
+	device->stateCalls.Count(StateCall::Scissor, !same);
+	if (same)
+		return;
+
+	d3drect.left = rect->x;
+	d3drect.top = rect->y;
+	d3drect.right = rect->x + rect->cx;
+	d3drect.bottom = rect->y + rect->cy;
+	device->context->RSSetScissorRects(1, &d3drect);
+
+	device->scissorRect = *rect;
+	device->scissorRectValid = true;
 }
 
 void device_ortho(gs_device_t *device, float left, float right, float top,
@@ -2918,6 +3044,7 @@ void *gs_texture_get_obj(gs_texture_t *tex)
 		return nullptr;
 
 	gs_texture_2d *tex2d = static_cast<gs_texture_2d *>(tex);
+	finish_texture_rebuild(tex);
 	return tex2d->texture.Get();
 }
 
@@ -3017,6 +3144,15 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 	stagesurf->device->context->Unmap(stagesurf->texture, 0);
 }
 
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf->query)
+		return true;
+
+	return stagesurf->device->context->GetData(stagesurf->query, nullptr,
+						   0, 0) == S_OK;
+}
+
 void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 {
 	delete zstencil;
@@ -29,6 +29,7 @@
 #include <d3dcompiler.h>
 
 #include <util/base.h>
+#include <util/metrics.h>
 #include <graphics/matrix4.h>
 #include <graphics/graphics.h>
 #include <graphics/device-exports.h>
@@ -529,6 +530,10 @@ struct gs_texture_2d : gs_texture {
 	vector<D3D11_SUBRESOURCE_DATA> srd;
 	D3D11_TEXTURE2D_DESC td = {};
 
+	/* set after device loss until the texture is recreated, which is
+	 * done when it's first used or a few at a time each frame */
+	bool rebuildPending = false;
+
 	void InitSRD(vector<D3D11_SUBRESOURCE_DATA> &srd);
 	void InitTexture(const uint8_t *const *data);
 	void InitResourceView();
@@ -538,6 +543,8 @@ struct gs_texture_2d : gs_texture {
 
 	void RebuildSharedTextureFallback();
 	void Rebuild(ID3D11Device *dev);
+	bool CanDeferRebuild() const;
+	void FinishRebuild();
 	void RebuildPaired_Y(ID3D11Device *dev);
 	void RebuildPaired_UV(ID3D11Device *dev);
 
@@ -649,6 +656,7 @@ struct gs_zstencil_buffer : gs_obj {
 
 struct gs_stage_surface : gs_obj {
 	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11Query> query;
 	D3D11_TEXTURE2D_DESC td = {};
 
 	uint32_t width, height;
@@ -657,7 +665,11 @@ struct gs_stage_surface : gs_obj {
 
 	void Rebuild(ID3D11Device *dev);
 
-	inline void Release() { texture.Release(); }
+	inline void Release()
+	{
+		texture.Release();
+		query.Release();
+	}
 
 	gs_stage_surface(gs_device_t *device, uint32_t width, uint32_t height,
 			 gs_color_format colorFormat);
@@ -712,11 +724,14 @@ struct gs_shader : gs_obj {
 	ComPtr<ID3D11Buffer> constants;
 	size_t constantSize;
 
+	/* CPU-side copy of the constant buffer, only changed parameters are
+	 * written to it before it is uploaded */
+	vector<uint8_t> constData;
+
 	D3D11_BUFFER_DESC bd = {};
 	vector<uint8_t> data;
 
-	inline void UpdateParam(vector<uint8_t> &constData,
-				gs_shader_param &param, bool &upload);
+	inline void UpdateParam(gs_shader_param &param, bool &upload);
 	void UploadParams();
 
 	void BuildConstantBuffer();
@@ -797,6 +812,11 @@ struct gs_duplicator : gs_obj {
 	long refs;
 	bool updated;
 
+	/* frame metadata, and whether the next frame must be copied in full
+	 * because the texture does not hold the previous frame */
+	vector<uint8_t> metadata;
+	bool full_copy = true;
+
 	void Start();
 
 	inline void Release() { duplicator.Release(); }
@@ -999,6 +1019,46 @@ struct mat4float {
 	float mat[16];
 };
 
+/* state and binding calls are only made when they change something, these
+ * count how many were made and how many were skipped */
+enum class StateCall {
+	Blend,
+	Raster,
+	ZStencil,
+	Viewport,
+	Scissor,
+	Topology,
+	VertexBuffers,
+	IndexBuffer,
+	Texture,
+	Sampler,
+	VertexShader,
+	PixelShader,
+	Count,
+};
+
+struct StateCallStats {
+	static constexpr size_t count = (size_t)StateCall::Count;
+
+	uint64_t issued[count] = {};
+	uint64_t skipped[count] = {};
+	metric_t *issuedMetrics[count] = {};
+	metric_t *skippedMetrics[count] = {};
+
+	inline void Count(StateCall call, bool issue)
+	{
+		if (issue)
+			issued[(size_t)call]++;
+		else
+			skipped[(size_t)call]++;
+	}
+
+	void Publish();
+
+	StateCallStats();
+	~StateCallStats();
+};
+
 struct gs_monitor_color_info {
 	bool hdr;
 	UINT bits_per_color;
@@ -1030,6 +1090,7 @@ struct gs_device {
 	bool curFramebufferSrgb = false;
 	bool curFramebufferInvalidate = false;
 	gs_texture *curTextures[GS_MAX_TEXTURES];
+	ID3D11ShaderResourceView *curTextureViews[GS_MAX_TEXTURES];
 	gs_sampler_state *curSamplers[GS_MAX_TEXTURES];
 	gs_vertex_buffer *curVertexBuffer = nullptr;
 	gs_index_buffer *curIndexBuffer = nullptr;
@@ -1055,6 +1116,11 @@ struct gs_device {
 	D3D11_PRIMITIVE_TOPOLOGY curToplogy;
 
 	gs_rect viewport;
+	bool viewportValid = false;
+	gs_rect scissorRect;
+	bool scissorRectValid = false;
+
+	StateCallStats stateCalls;
 
 	vector<mat4float> projStack;
 
@@ -1089,6 +1155,8 @@ struct gs_device {
 	void FlushOutputViews();
 
 	void RebuildDevice();
+	void RebuildPendingTextures();
+	bool rebuildsPending = false;
 
 	bool HasBadNV12Output();
 
@@ -1098,5 +1166,14 @@ struct gs_device {
 	~gs_device();
 };
 
+static inline void finish_texture_rebuild(gs_texture_t *tex)
+{
+	if (tex && tex->type == GS_TEXTURE_2D) {
+		gs_texture_2d *tex2d = static_cast<gs_texture_2d *>(tex);
+		if (tex2d->rebuildPending)
+			tex2d->FinishRebuild();
+	}
+}
+
 extern "C" EXPORT int device_texture_acquire_sync(gs_texture_t *tex,
 						  uint64_t key, uint32_t ms);
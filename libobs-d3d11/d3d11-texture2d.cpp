@@ -34,6 +34,8 @@ void gs_texture_2d::InitSRD(vector<D3D11_SUBRESOURCE_DATA> &srd)
 	for (size_t i = 0; i < textures; i++) {
 		uint32_t newRowSize = rowSizeBytes;
 		uint32_t newTexSize = texSizeBytes;
+		uint32_t w = width;
+		uint32_t h = height;
 
 		for (uint32_t j = 0; j < actual_levels; j++) {
 			D3D11_SUBRESOURCE_DATA newSRD;
@@ -42,8 +44,20 @@ void gs_texture_2d::InitSRD(vector<D3D11_SUBRESOURCE_DATA> &srd)
 			newSRD.SysMemSlicePitch = newTexSize;
 			srd.push_back(newSRD);
 
-			newRowSize /= 2;
-			newTexSize /= 4;
+			if (w > 1)
+				w /= 2;
+			if (h > 1)
+				h /= 2;
+
+			/* halving the previous pitch is only right for
+			 * power of two sizes */
+			if (gs_is_compressed_format(format)) {
+				newRowSize /= 2;
+				newTexSize /= 4;
+			} else {
+				newRowSize = w * gs_get_format_bpp(format) / 8;
+				newTexSize = h * newRowSize;
+			}
 		}
 	}
 }
@@ -12,6 +12,7 @@ target_sources(
           gl-shaderparser.c
           gl-shaderparser.h
           gl-stagesurf.c
+          gl-streambuffer.c
           gl-subsystem.c
           gl-subsystem.h
           gl-texture2d.c
@@ -49,7 +50,7 @@ elseif(OS_POSIX)
   find_package(XCB COMPONENTS XCB)
   find_package(X11_XCB REQUIRED)
 
-  target_sources(libobs-opengl PRIVATE gl-egl-common.c gl-nix.c gl-x11-egl.c)
+  target_sources(libobs-opengl PRIVATE gl-egl-common.c gl-nix.c gl-surfaceless-egl.c gl-x11-egl.c)
 
   target_link_libraries(libobs-opengl PRIVATE XCB::XCB X11::X11_xcb)
 
@@ -377,6 +377,86 @@ fail:
     return NULL;
 }
 
+static enum gs_color_format get_iosurface_plane_format(OSType pf, size_t plane)
+{
+    const FourCharCode nv12_video = ('4' << 24) | ('2' << 16) | ('0' << 8) | 'v';
+    const FourCharCode nv12_full = ('4' << 24) | ('2' << 16) | ('0' << 8) | 'f';
+    const FourCharCode p010_video = ('x' << 24) | ('4' << 16) | ('2' << 8) | '0';
+    const FourCharCode p010_full = ('x' << 24) | ('f' << 16) | ('2' << 8) | '0';
+
+    if (plane > 1)
+        return GS_UNKNOWN;
+
+    if (pf == nv12_video || pf == nv12_full)
+        return plane ? GS_R8G8 : GS_R8;
+    if (pf == p010_video || pf == p010_full)
+        return plane ? GS_RG16 : GS_R16;
+
+    return GS_UNKNOWN;
+}
+
+gs_texture_t *device_texture_create_from_iosurface_plane(gs_device_t *device, void *iosurf, uint32_t plane)
+{
+    IOSurfaceRef ref = (IOSurfaceRef) iosurf;
+    OSType pf = IOSurfaceGetPixelFormat(ref);
+
+    const enum gs_color_format color_format = get_iosurface_plane_format(pf, plane);
+    if (color_format == GS_UNKNOWN) {
+        blog(LOG_ERROR, "Unexpected pixel format for plane %u: %d (%c%c%c%c)", plane, pf, pf >> 24, pf >> 16,
+             pf >> 8, pf);
+        return NULL;
+    }
+
+    struct gs_texture_2d *tex = bzalloc(sizeof(struct gs_texture_2d));
+
+    tex->base.device = device;
+    tex->base.type = GS_TEXTURE_2D;
+    tex->base.format = color_format;
+    tex->base.levels = 1;
+    tex->base.gl_format = convert_gs_format(color_format);
+    tex->base.gl_internal_format = convert_gs_internal_format(color_format);
+    tex->base.gl_type = get_gl_format_type(color_format);
+    tex->base.gl_target = GL_TEXTURE_RECTANGLE_ARB;
+    tex->base.is_dynamic = false;
+    tex->base.is_render_target = true;
+    tex->base.gen_mipmaps = false;
+    tex->width = (uint32_t) IOSurfaceGetWidthOfPlane(ref, plane);
+    tex->height = (uint32_t) IOSurfaceGetHeightOfPlane(ref, plane);
+
+    if (!gl_gen_textures(1, &tex->base.texture))
+        goto fail;
+
+    if (!gl_bind_texture(tex->base.gl_target, tex->base.texture))
+        goto fail;
+
+    CGLError err = CGLTexImageIOSurface2D([[NSOpenGLContext currentContext] CGLContextObj], tex->base.gl_target,
+                                          tex->base.gl_internal_format, tex->width, tex->height, tex->base.gl_format,
+                                          tex->base.gl_type, ref, plane);
+
+    if (err != kCGLNoError) {
+        blog(LOG_ERROR,
+             "CGLTexImageIOSurface2D: %u, %s"
+             " (device_texture_create_from_iosurface_plane)",
+             err, CGLErrorString(err));
+
+        gl_success("CGLTexImageIOSurface2D");
+        goto fail;
+    }
+
+    if (!gl_tex_param_i(tex->base.gl_target, GL_TEXTURE_MAX_LEVEL, 0))
+        goto fail;
+
+    if (!gl_bind_texture(tex->base.gl_target, 0))
+        goto fail;
+
+    return (gs_texture_t *) tex;
+
+fail:
+    gs_texture_destroy((gs_texture_t *) tex);
+    blog(LOG_ERROR, "device_texture_create_from_iosurface_plane (GL) failed");
+    return NULL;
+}
+
 gs_texture_t *device_texture_open_shared(gs_device_t *device, uint32_t handle)
 {
     gs_texture_t *texture = NULL;
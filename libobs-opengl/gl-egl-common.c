@@ -313,6 +313,76 @@ gl_egl_create_texture_from_pixmap(EGLDisplay egl_display, uint32_t width,
 	return texture;
 }
 
+bool gl_egl_export_dmabuf_image(EGLDisplay egl_display,
+				struct gs_texture *texture,
+				uint32_t *drm_format, uint32_t *n_planes,
+				int *fds, uint32_t *strides, uint32_t *offsets,
+				uint64_t *modifier)
+{
+	EGLint fourcc = 0;
+	EGLint planes = 0;
+	EGLint egl_strides[GS_DMABUF_MAX_PLANES] = {0};
+	EGLint egl_offsets[GS_DMABUF_MAX_PLANES] = {0};
+	EGLuint64KHR egl_modifier = 0;
+	bool success = false;
+
+	if (!glad_eglExportDMABUFImageQueryMESA ||
+	    !glad_eglExportDMABUFImageMESA) {
+		blog(LOG_DEBUG, "No EGL_MESA_image_dma_buf_export");
+		return false;
+	}
+	if (texture->type != GS_TEXTURE_2D ||
+	    texture->gl_target != GL_TEXTURE_2D)
+		return false;
+
+	const EGLAttrib image_attrs[] = {
+		EGL_GL_TEXTURE_LEVEL,
+		0,
+		EGL_NONE,
+	};
+
+	EGLImage image = eglCreateImage(
+		egl_display, eglGetCurrentContext(), EGL_GL_TEXTURE_2D,
+		(EGLClientBuffer)(uintptr_t)texture->texture, image_attrs);
+	if (image == EGL_NO_IMAGE) {
+		blog(LOG_ERROR, "Cannot create EGLImage for export: %s",
+		     gl_egl_error_to_string(eglGetError()));
+		return false;
+	}
+
+	if (!eglExportDMABUFImageQueryMESA(egl_display, image, &fourcc,
+					   &planes, &egl_modifier) ||
+	    planes < 1 || planes > GS_DMABUF_MAX_PLANES) {
+		blog(LOG_ERROR, "Cannot query DMA-BUF export: %s",
+		     gl_egl_error_to_string(eglGetError()));
+		goto fail;
+	}
+
+	for (EGLint i = 0; i < planes; i++)
+		fds[i] = -1;
+
+	if (!eglExportDMABUFImageMESA(egl_display, image, fds, egl_strides,
+				      egl_offsets)) {
+		blog(LOG_ERROR, "Cannot export DMA-BUF: %s",
+		     gl_egl_error_to_string(eglGetError()));
+		goto fail;
+	}
+
+	for (EGLint i = 0; i < planes; i++) {
+		strides[i] = (uint32_t)egl_strides[i];
+		offsets[i] = (uint32_t)egl_offsets[i];
+	}
+
+	*drm_format = (uint32_t)fourcc;
+	*n_planes = (uint32_t)planes;
+	*modifier = egl_modifier;
+	success = true;
+
+fail:
+	eglDestroyImage(egl_display, image);
+	return success;
+}
+
 static inline bool is_implicit_dmabuf_modifiers_supported(void)
 {
 	return EGL_EXT_image_dma_buf_import > 0;
@@ -22,6 +22,12 @@ bool gl_egl_query_dmabuf_modifiers_for_format(EGLDisplay egl_display,
 					      uint64_t **modifiers,
 					      size_t *n_modifiers);
 
+bool gl_egl_export_dmabuf_image(EGLDisplay egl_display,
+				struct gs_texture *texture,
+				uint32_t *drm_format, uint32_t *n_planes,
+				int *fds, uint32_t *strides, uint32_t *offsets,
+				uint64_t *modifier);
+
 struct gs_texture *
 gl_egl_create_texture_from_pixmap(EGLDisplay egl_display, uint32_t width,
 				  uint32_t height,
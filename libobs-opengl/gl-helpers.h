@@ -17,6 +17,24 @@
 
 #pragma once
 
+static inline uint64_t gl_hash(uint64_t hash, const void *data, size_t len)
+{
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint64_t)bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static inline uint64_t gl_hash_str(uint64_t hash, const char *str)
+{
+	return str ? gl_hash(hash, str, strlen(str)) : hash;
+}
+
+#define GL_HASH_INIT 14695981039346656037ULL
+
 static const char *gl_error_to_str(GLenum errorcode)
 {
 	static const struct {
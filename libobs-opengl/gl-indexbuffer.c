@@ -65,6 +65,8 @@ void gs_indexbuffer_destroy(gs_indexbuffer_t *ib)
 	if (ib) {
 		if (ib->buffer)
 			gl_delete_buffers(1, &ib->buffer);
+		if (ib->streamed)
+			da_erase_item(ib->device->stream.index_buffers, &ib);
 
 		bfree(ib->data);
 		bfree(ib);
@@ -79,6 +81,24 @@ static inline void gs_indexbuffer_flush_internal(gs_indexbuffer_t *ib,
 		goto fail;
 	}
 
+	struct gl_stream_buffer *stream = &ib->device->stream;
+	size_t offset;
+
+	if (gl_stream_buffer_write(stream, data, ib->size, &offset)) {
+		if (!ib->streamed)
+			da_push_back(stream->index_buffers, &ib);
+
+		ib->streamed = true;
+		ib->stream_offset = offset;
+		ib->stream_size = ib->size;
+		return;
+	}
+
+	if (ib->streamed) {
+		da_erase_item(stream->index_buffers, &ib);
+		ib->streamed = false;
+	}
+
 	if (!update_buffer(GL_ELEMENT_ARRAY_BUFFER, ib->buffer, data, ib->size))
 		goto fail;
 
@@ -17,6 +17,7 @@
 
 #include "gl-nix.h"
 #include "gl-x11-egl.h"
+#include "gl-surfaceless-egl.h"
 
 #ifdef ENABLE_WAYLAND
 #include "gl-wayland-egl.h"
@@ -40,6 +41,9 @@ static void init_winsys(void)
 	}
 #endif
 
+	if (platform == OBS_NIX_PLATFORM_SURFACELESS)
+		gl_vtable = gl_surfaceless_egl_get_winsys_vtable();
+
 	assert(gl_vtable != NULL);
 }
 
@@ -177,6 +181,18 @@ extern bool device_query_dmabuf_modifiers_for_format(gs_device_t *device,
 		device, drm_format, modifiers, n_modifiers);
 }
 
+extern bool device_texture_export_dmabuf(gs_device_t *device,
+					 gs_texture_t *tex,
+					 uint32_t *drm_format,
+					 uint32_t *n_planes, int *fds,
+					 uint32_t *strides, uint32_t *offsets,
+					 uint64_t *modifier)
+{
+	return gl_vtable->device_texture_export_dmabuf(device, tex, drm_format,
+						       n_planes, fds, strides,
+						       offsets, modifier);
+}
+
 struct gs_texture *device_texture_create_from_pixmap(
 	gs_device_t *device, uint32_t width, uint32_t height,
 	enum gs_color_format color_format, uint32_t target, void *pixmap)
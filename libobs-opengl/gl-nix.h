@@ -69,6 +69,14 @@ struct gl_winsys_vtable {
 							 uint64_t **modifiers,
 							 size_t *n_modifiers);
 
+	bool (*device_texture_export_dmabuf)(gs_device_t *device,
+					     gs_texture_t *tex,
+					     uint32_t *drm_format,
+					     uint32_t *n_planes, int *fds,
+					     uint32_t *strides,
+					     uint32_t *offsets,
+					     uint64_t *modifier);
+
 	struct gs_texture *(*device_texture_create_from_pixmap)(
 		gs_device_t *device, uint32_t width, uint32_t height,
 		enum gs_color_format color_format, uint32_t target,
@@ -17,6 +17,8 @@
 
 #include <assert.h>
 
+#include <util/platform.h>
+#include <util/dstr.h>
 #include <graphics/vec2.h>
 #include <graphics/vec3.h>
 #include <graphics/vec4.h>
@@ -79,7 +81,7 @@ static bool gl_add_param(struct gs_shader *shader, struct shader_var *var,
 		param.sampler_id = var->gl_sampler_id;
 		param.texture_id = (*texture_id)++;
 	} else {
-		param.changed = true;
+		param.version = 1;
 	}
 
 	da_move(param.def_value, var->default_val);
@@ -210,6 +212,8 @@ static bool gl_shader_init(struct gs_shader *shader,
 	if (!gl_success("glCompileShader"))
 		return false;
 
+	shader->hash = gl_hash_str(GL_HASH_INIT, glsp->gl_string.array);
+
 #if 0
 	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
 	blog(LOG_DEBUG, "  GL shader string for: %s", file);
@@ -396,20 +400,31 @@ void gs_shader_get_param_info(const gs_sparam_t *param,
 	info->name = param->name;
 }
 
+static inline void shader_setval_inline(gs_sparam_t *param, const void *data,
+					size_t size)
+{
+	if (param->cur_value.num == size &&
+	    memcmp(param->cur_value.array, data, size) == 0)
+		return;
+
+	da_copy_array(param->cur_value, data, size);
+	param->version++;
+}
+
 void gs_shader_set_bool(gs_sparam_t *param, bool val)
 {
 	int int_val = val;
-	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+	shader_setval_inline(param, &int_val, sizeof(int_val));
 }
 
 void gs_shader_set_float(gs_sparam_t *param, float val)
 {
-	da_copy_array(param->cur_value, &val, sizeof(val));
+	shader_setval_inline(param, &val, sizeof(val));
 }
 
 void gs_shader_set_int(gs_sparam_t *param, int val)
 {
-	da_copy_array(param->cur_value, &val, sizeof(val));
+	shader_setval_inline(param, &val, sizeof(val));
 }
 
 void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
@@ -417,27 +432,27 @@ void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
 	struct matrix4 mat;
 	matrix4_from_matrix3(&mat, val);
 
-	da_copy_array(param->cur_value, &mat, sizeof(mat));
+	shader_setval_inline(param, &mat, sizeof(mat));
 }
 
 void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
 {
-	da_copy_array(param->cur_value, val, sizeof(*val));
+	shader_setval_inline(param, val, sizeof(*val));
 }
 
 void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_setval_inline(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_setval_inline(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_setval_inline(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
@@ -465,6 +480,12 @@ static void program_set_param_data(struct gs_program *program,
 {
 	void *array = pp->param->cur_value.array;
 
+	if (pp->param->type != GS_SHADER_PARAM_TEXTURE) {
+		if (pp->version == pp->param->version)
+			return;
+		pp->version = pp->param->version;
+	}
+
 	if (pp->param->type == GS_SHADER_PARAM_BOOL ||
 	    pp->param->type == GS_SHADER_PARAM_INT) {
 		if (validate_param(pp, sizeof(int))) {
@@ -600,7 +621,7 @@ static inline bool assign_program_attribs(struct gs_program *program)
 static bool assign_program_param(struct gs_program *program,
 				 struct gs_shader_param *param)
 {
-	struct program_param info;
+	struct program_param info = {0};
 
 	info.obj = glGetUniformLocation(program->obj, param->name);
 	if (!gl_success("glGetUniformLocation"))
@@ -637,27 +658,135 @@ static inline bool assign_program_params(struct gs_program *program)
 	return true;
 }
 
-struct gs_program *gs_program_create(struct gs_device *device)
+static void program_get_cache_path(struct gs_program *program,
+				   struct dstr *path)
 {
-	struct gs_program *program = bzalloc(sizeof(*program));
+	uint64_t hash = program->device->driver_hash;
+	hash = gl_hash(hash, &program->vertex_shader->hash, sizeof(uint64_t));
+	hash = gl_hash(hash, &program->pixel_shader->hash, sizeof(uint64_t));
+
+	char *dir = os_get_config_path_ptr("obs-studio/shader-cache");
+	dstr_printf(path, "%s/gl-%016llx.v1", dir, (unsigned long long)hash);
+	bfree(dir);
+}
+
+/* cache file: binary format, program binary, checksum of the binary */
+static bool program_load_binary(struct gs_program *program)
+{
+	struct dstr path = {0};
+	uint8_t *binary = NULL;
+	GLenum format;
+	uint64_t checksum;
+	int64_t size;
 	int linked = false;
+	bool success = false;
+	FILE *f;
+
+	program_get_cache_path(program, &path);
+	f = os_fopen(path.array, "rb");
+	if (!f)
+		goto exit;
+
+	size = os_fgetsize(f) - (int64_t)(sizeof(format) + sizeof(checksum));
+	if (size <= 0 || size > INT32_MAX)
+		goto exit;
+
+	binary = bmalloc((size_t)size);
+	if (fread(&format, sizeof(format), 1, f) != 1 ||
+	    fread(binary, 1, (size_t)size, f) != (size_t)size ||
+	    fread(&checksum, sizeof(checksum), 1, f) != 1)
+		goto exit;
+	if (gl_hash(GL_HASH_INIT, binary, (size_t)size) != checksum)
+		goto exit;
+
+	/* drivers may reject binaries after an update that did not change
+	 * the version string, in which case the program is linked again */
+	glProgramBinary(program->obj, format, binary, (GLsizei)size);
+	if (!gl_success("glProgramBinary"))
+		goto exit;
 
-	program->device = device;
-	program->vertex_shader = device->cur_vertex_shader;
-	program->pixel_shader = device->cur_pixel_shader;
+	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+	success = gl_success("glGetProgramiv") && linked != GL_FALSE;
+
+exit:
+	if (f)
+		fclose(f);
+	if (f && !success) {
+		blog(LOG_DEBUG, "Discarding GL program cache file '%s'",
+		     path.array);
+		os_unlink(path.array);
+	}
+	bfree(binary);
+	dstr_free(&path);
+	return success;
+}
 
-	program->obj = glCreateProgram();
-	if (!gl_success("glCreateProgram"))
-		goto error_detach_neither;
+static void program_save_binary(struct gs_program *program)
+{
+	struct dstr path = {0};
+	uint8_t *binary = NULL;
+	GLint size = 0;
+	GLsizei written = 0;
+	GLenum format = 0;
+	uint64_t checksum;
+	bool success = false;
+	char *dir;
+	FILE *f;
+
+	glGetProgramiv(program->obj, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (!gl_success("glGetProgramiv") || size <= 0)
+		return;
+
+	binary = bmalloc(size);
+	glGetProgramBinary(program->obj, size, &written, &format, binary);
+	if (!gl_success("glGetProgramBinary") || written <= 0)
+		goto exit;
+
+	dir = os_get_config_path_ptr("obs-studio/shader-cache");
+	os_mkdirs(dir);
+	bfree(dir);
+
+	program_get_cache_path(program, &path);
+	f = os_fopen(path.array, "wb");
+	if (!f)
+		goto exit;
+
+	checksum = gl_hash(GL_HASH_INIT, binary, written);
+	success = fwrite(&format, sizeof(format), 1, f) == 1 &&
+		  fwrite(binary, 1, written, f) == (size_t)written &&
+		  fwrite(&checksum, sizeof(checksum), 1, f) == 1;
+	fclose(f);
+
+	if (!success) {
+		blog(LOG_WARNING, "Writing GL program cache file '%s' failed",
+		     path.array);
+		os_unlink(path.array);
+	}
+
+exit:
+	bfree(binary);
+	dstr_free(&path);
+}
+
+static bool program_link(struct gs_program *program)
+{
+	int linked = false;
 
 	glAttachShader(program->obj, program->vertex_shader->obj);
 	if (!gl_success("glAttachShader (vertex)"))
-		goto error_detach_neither;
+		return false;
 
 	glAttachShader(program->obj, program->pixel_shader->obj);
 	if (!gl_success("glAttachShader (pixel)"))
 		goto error_detach_vertex;
 
+	if (program->device->program_binary) {
+		glProgramParameteri(program->obj,
+				    GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+				    GL_TRUE);
+		gl_success("glProgramParameteri");
+	}
+
 	glLinkProgram(program->obj);
 	if (!gl_success("glLinkProgram"))
 		goto error;
@@ -671,24 +800,15 @@ struct gs_program *gs_program_create(struct gs_device *device)
 		goto error;
 	}
 
-	if (!assign_program_attribs(program))
-		goto error;
-	if (!assign_program_params(program))
-		goto error;
-
 	glDetachShader(program->obj, program->vertex_shader->obj);
 	gl_success("glDetachShader (vertex)");
 
 	glDetachShader(program->obj, program->pixel_shader->obj);
 	gl_success("glDetachShader (pixel)");
 
-	program->next = device->first_program;
-	program->prev_next = &device->first_program;
-	device->first_program = program;
-	if (program->next)
-		program->next->prev_next = &program->next;
-
-	return program;
+	if (program->device->program_binary)
+		program_save_binary(program);
+	return true;
 
 error:
 	glDetachShader(program->obj, program->pixel_shader->obj);
@@ -697,8 +817,40 @@ error:
 error_detach_vertex:
 	glDetachShader(program->obj, program->vertex_shader->obj);
 	gl_success("glDetachShader (vertex)");
+	return false;
+}
+
+struct gs_program *gs_program_create(struct gs_device *device)
+{
+	struct gs_program *program = bzalloc(sizeof(*program));
+
+	program->device = device;
+	program->vertex_shader = device->cur_vertex_shader;
+	program->pixel_shader = device->cur_pixel_shader;
 
-error_detach_neither:
+	program->obj = glCreateProgram();
+	if (!gl_success("glCreateProgram"))
+		goto error;
+
+	if (!device->program_binary || !program_load_binary(program)) {
+		if (!program_link(program))
+			goto error;
+	}
+
+	if (!assign_program_attribs(program))
+		goto error;
+	if (!assign_program_params(program))
+		goto error;
+
+	program->next = device->first_program;
+	program->prev_next = &device->first_program;
+	device->first_program = program;
+	if (program->next)
+		program->next->prev_next = &program->next;
+
+	return program;
+
+error:
 	gs_program_destroy(program);
 	return NULL;
 }
@@ -787,7 +939,7 @@ void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
 		gs_shader_set_texture(param, shader_tex.tex);
 		param->srgb = shader_tex.srgb;
 	} else {
-		da_copy_array(param->cur_value, val, size);
+		shader_setval_inline(param, val, size);
 	}
 }
 
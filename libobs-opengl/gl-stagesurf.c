@@ -71,6 +71,8 @@ void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 	if (stagesurf) {
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
+		if (stagesurf->sync)
+			glDeleteSync(stagesurf->sync);
 
 		bfree(stagesurf);
 	}
@@ -107,6 +109,16 @@ static bool can_stage(struct gs_stage_surface *dst, struct gs_texture_2d *src)
 	return true;
 }
 
+/* marks the end of the copy for gs_stagesurface_ready */
+static void set_stage_fence(struct gs_stage_surface *surf)
+{
+	if (surf->sync)
+		glDeleteSync(surf->sync);
+
+	surf->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+}
+
 #ifdef __APPLE__
 
 /* Apparently for mac, PBOs won't do an asynchronous transfer unless you use
@@ -142,6 +154,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	set_stage_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -175,6 +188,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	set_stage_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -235,3 +250,23 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 }
+
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf->sync)
+		return true;
+
+	GLenum status = glClientWaitSync(stagesurf->sync,
+					 GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	/* a failed wait would fail forever, map it and let that report it */
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+	if (status == GL_WAIT_FAILED)
+		return true;
+
+	/* signalled fences stay signalled, no need to query it again until
+	 * the next copy */
+	glDeleteSync(stagesurf->sync);
+	stagesurf->sync = NULL;
+	return true;
+}
@@ -0,0 +1,193 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "gl-subsystem.h"
+
+/* Flushes of dynamic vertex and index buffers are written to a persistently
+ * mapped ring buffer instead of remapping each buffer every time, which is
+ * the GL counterpart of D3D11_MAP_WRITE_NO_OVERWRITE.  Every scene fences
+ * the part of the ring it used, which is reused once that fence has
+ * signalled.  Buffers that are still drawn from the ring when the scene
+ * ends get their data copied back on the GPU, as they may be drawn again
+ * in any later scene. */
+
+#define STREAM_BUFFER_SIZE (4 * 1024 * 1024)
+#define STREAM_ALIGNMENT 64
+
+/* larger uploads are rare and would use up the ring too quickly */
+#define STREAM_MAX_WRITE (STREAM_BUFFER_SIZE / 4)
+
+static const GLbitfield stream_flags = GL_MAP_WRITE_BIT |
+				       GL_MAP_PERSISTENT_BIT |
+				       GL_MAP_COHERENT_BIT;
+
+bool gl_stream_buffer_init(struct gl_stream_buffer *sb)
+{
+	if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage)
+		return false;
+
+	if (!gl_gen_buffers(1, &sb->buffer))
+		return false;
+	if (!gl_bind_buffer(GL_ARRAY_BUFFER, sb->buffer))
+		goto fail;
+
+	glBufferStorage(GL_ARRAY_BUFFER, STREAM_BUFFER_SIZE, NULL,
+			stream_flags);
+	if (!gl_success("glBufferStorage"))
+		goto fail;
+
+	sb->data = glMapBufferRange(GL_ARRAY_BUFFER, 0, STREAM_BUFFER_SIZE,
+				    stream_flags);
+	if (!gl_success("glMapBufferRange") || !sb->data)
+		goto fail;
+
+	gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+	sb->size = STREAM_BUFFER_SIZE;
+	return true;
+
+fail:
+	gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+	gl_delete_buffers(1, &sb->buffer);
+	sb->buffer = 0;
+	sb->data = NULL;
+	return false;
+}
+
+void gl_stream_buffer_free(struct gl_stream_buffer *sb)
+{
+	for (size_t i = 0; i < sb->fences.num; i++)
+		glDeleteSync(sb->fences.array[i].sync);
+
+	if (sb->buffer)
+		gl_delete_buffers(1, &sb->buffer);
+
+	da_free(sb->fences);
+	da_free(sb->vertex_buffers);
+	da_free(sb->index_buffers);
+	memset(sb, 0, sizeof(*sb));
+}
+
+static void retire_fences(struct gl_stream_buffer *sb)
+{
+	size_t done = 0;
+
+	for (; done < sb->fences.num; done++) {
+		struct gl_stream_fence *fence = sb->fences.array + done;
+		GLenum status = glClientWaitSync(fence->sync, 0, 0);
+
+		if (status != GL_ALREADY_SIGNALED &&
+		    status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(fence->sync);
+		sb->used -= fence->size;
+	}
+
+	if (done)
+		da_erase_range(sb->fences, 0, done);
+}
+
+bool gl_stream_buffer_write(struct gl_stream_buffer *sb, const void *data,
+			    size_t size, size_t *offset)
+{
+	size_t pos, aligned, skip = 0;
+
+	if (!sb->data || !size || size > STREAM_MAX_WRITE)
+		return false;
+
+	aligned = (size + STREAM_ALIGNMENT - 1) &
+		  ~(size_t)(STREAM_ALIGNMENT - 1);
+
+	retire_fences(sb);
+
+	/* the end of the ring is skipped if the data doesn't fit there */
+	pos = sb->head;
+	if (pos + aligned > sb->size) {
+		skip = sb->size - pos;
+		pos = 0;
+	}
+
+	if (sb->used + skip + aligned > sb->size)
+		return false;
+
+	memcpy(sb->data + pos, data, size);
+
+	sb->used += skip + aligned;
+	sb->pending += skip + aligned;
+	sb->head = pos + aligned;
+	*offset = pos;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool copy_from_stream(struct gl_stream_buffer *sb, GLuint buffer,
+			     size_t offset, size_t size)
+{
+	if (!gl_bind_buffer(GL_COPY_WRITE_BUFFER, buffer))
+		return false;
+
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			    (GLintptr)offset, 0, (GLsizeiptr)size);
+	return gl_success("glCopyBufferSubData");
+}
+
+static void unstream_vertex_buffer(struct gl_stream_buffer *sb,
+				   struct gs_vertex_buffer *vb)
+{
+	for (size_t i = 0; i < vb->stream_regions.num; i++) {
+		struct gl_stream_region *region = vb->stream_regions.array + i;
+		copy_from_stream(sb, region->buffer, region->offset,
+				 region->size);
+	}
+
+	da_resize(vb->stream_regions, 0);
+}
+
+static void unstream_index_buffer(struct gl_stream_buffer *sb,
+				  struct gs_index_buffer *ib)
+{
+	copy_from_stream(sb, ib->buffer, ib->stream_offset, ib->stream_size);
+	ib->streamed = false;
+}
+
+void gl_stream_buffer_end_scene(struct gl_stream_buffer *sb)
+{
+	if (sb->vertex_buffers.num || sb->index_buffers.num) {
+		gl_bind_buffer(GL_COPY_READ_BUFFER, sb->buffer);
+
+		for (size_t i = 0; i < sb->vertex_buffers.num; i++)
+			unstream_vertex_buffer(sb, sb->vertex_buffers.array[i]);
+		for (size_t i = 0; i < sb->index_buffers.num; i++)
+			unstream_index_buffer(sb, sb->index_buffers.array[i]);
+
+		gl_bind_buffer(GL_COPY_READ_BUFFER, 0);
+		gl_bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+
+		da_resize(sb->vertex_buffers, 0);
+		da_resize(sb->index_buffers, 0);
+	}
+
+	if (!sb->pending)
+		return;
+
+	GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync") || !sync)
+		return;
+
+	struct gl_stream_fence fence = {sync, sb->pending};
+	da_push_back(sb->fences, &fence);
+	sb->pending = 0;
+}
@@ -157,6 +157,13 @@ static bool gl_init_extensions(struct gs_device *device)
 	else
 		device->copy_type = COPY_TYPE_FBO_BLIT;
 
+	device->program_binary = GLAD_GL_VERSION_4_1 ||
+				 GLAD_GL_ARB_get_program_binary;
+
+	if (gl_stream_buffer_init(&device->stream))
+		blog(LOG_INFO, "Streaming dynamic buffers through a "
+			       "persistently mapped buffer");
+
 	return true;
 }
 
@@ -254,6 +261,10 @@ int device_create(gs_device_t **p_device, uint32_t adapter)
 	     "language %s",
 	     glVersion, glShadingLanguage);
 
+	device->driver_hash = gl_hash_str(GL_HASH_INIT, glVendor);
+	device->driver_hash = gl_hash_str(device->driver_hash, glRenderer);
+	device->driver_hash = gl_hash_str(device->driver_hash, glVersion);
+
 	gl_enable(GL_CULL_FACE);
 	gl_gen_vertex_arrays(1, &device->empty_vao);
 
@@ -297,6 +308,7 @@ void device_destroy(gs_device_t *device)
 
 		samplerstate_release(device->raw_load_sampler);
 		gl_delete_vertex_arrays(1, &device->empty_vao);
+		gl_stream_buffer_free(&device->stream);
 
 		da_free(device->proj_stack);
 		gl_platform_destroy(device->plat);
@@ -422,6 +434,19 @@ gs_timer_range_t *device_timer_range_create(gs_device_t *device)
 	return NULL;
 }
 
+gs_sync_t *device_sync_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync"))
+		return NULL;
+
+	struct gs_sync *sync = bzalloc(sizeof(struct gs_sync));
+	sync->sync = fence;
+	return sync;
+}
+
 enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
 {
 	return texture->type;
@@ -1141,10 +1166,13 @@ void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
 	program_update_params(program);
 
 	if (ib) {
+		size_t offset = ib->streamed ? ib->stream_offset : 0;
+
 		if (num_verts == 0)
 			num_verts = (uint32_t)device->cur_index_buffer->num;
 		glDrawElements(topology, num_verts, ib->gl_type,
-			       (const GLvoid *)(start_vert * ib->width));
+			       (const GLvoid *)(offset +
+						start_vert * ib->width));
 		if (!gl_success("glDrawElements"))
 			goto fail;
 
@@ -1164,8 +1192,7 @@ fail:
 
 void device_end_scene(gs_device_t *device)
 {
-	/* does nothing */
-	UNUSED_PARAMETER(device);
+	gl_stream_buffer_end_scene(&device->stream);
 }
 
 void device_clear(gs_device_t *device, uint32_t clear_flags,
@@ -1612,6 +1639,28 @@ bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
 	return true;
 }
 
+void gs_sync_destroy(gs_sync_t *sync)
+{
+	if (!sync)
+		return;
+
+	glDeleteSync(sync->sync);
+	gl_success("glDeleteSync");
+
+	bfree(sync);
+}
+
+bool gs_sync_wait(gs_sync_t *sync, uint64_t timeout_ns)
+{
+	GLenum status = glClientWaitSync(sync->sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+					 timeout_ns);
+	if (status == GL_WAIT_FAILED)
+		gl_success("glClientWaitSync");
+
+	return status == GL_ALREADY_SIGNALED ||
+	       status == GL_CONDITION_SATISFIED;
+}
+
 void gs_timer_range_destroy(gs_timer_range_t *range)
 {
 	UNUSED_PARAMETER(range);
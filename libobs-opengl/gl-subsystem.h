@@ -443,6 +443,10 @@ struct gs_timer {
 	GLuint queries[2];
 };
 
+struct gs_sync {
+	GLsync sync;
+};
+
 struct gs_shader_param {
 	enum gs_shader_param_type type;
 
@@ -458,7 +462,9 @@ struct gs_shader_param {
 
 	DARRAY(uint8_t) cur_value;
 	DARRAY(uint8_t) def_value;
-	bool changed;
+
+	/* incremented whenever cur_value changes */
+	uint32_t version;
 };
 
 enum attrib_type {
@@ -480,6 +486,7 @@ struct gs_shader {
 	gs_device_t *device;
 	enum gs_shader_type type;
 	GLuint obj;
+	uint64_t hash;
 
 	struct gs_shader_param *viewproj;
 	struct gs_shader_param *world;
@@ -492,6 +499,10 @@ struct gs_shader {
 struct program_param {
 	GLint obj;
 	struct gs_shader_param *param;
+
+	/* version of the value last uploaded to this program, uniforms keep
+	 * their values, so unchanged ones are skipped */
+	uint32_t version;
 };
 
 struct gs_program {
@@ -511,6 +522,12 @@ extern struct gs_program *gs_program_create(struct gs_device *device);
 extern void gs_program_destroy(struct gs_program *program);
 extern void program_update_params(struct gs_program *shader);
 
+struct gl_stream_region {
+	GLuint buffer;
+	size_t offset;
+	size_t size;
+};
+
 struct gs_vertex_buffer {
 	GLuint vao;
 	GLuint vertex_buffer;
@@ -520,6 +537,9 @@ struct gs_vertex_buffer {
 	DARRAY(GLuint) uv_buffers;
 	DARRAY(size_t) uv_sizes;
 
+	/* buffers whose last flush is still in the device's stream buffer */
+	DARRAY(struct gl_stream_region) stream_regions;
+
 	gs_device_t *device;
 	size_t num;
 	bool dynamic;
@@ -541,8 +561,37 @@ struct gs_index_buffer {
 	size_t width;
 	size_t size;
 	bool dynamic;
+
+	bool streamed;
+	size_t stream_offset;
+	size_t stream_size;
 };
 
+struct gl_stream_fence {
+	GLsync sync;
+	size_t size;
+};
+
+struct gl_stream_buffer {
+	GLuint buffer;
+	uint8_t *data;
+	size_t size;
+	size_t head;
+	size_t used;
+	size_t pending;
+	DARRAY(struct gl_stream_fence) fences;
+
+	DARRAY(struct gs_vertex_buffer *) vertex_buffers;
+	DARRAY(struct gs_index_buffer *) index_buffers;
+};
+
+extern bool gl_stream_buffer_init(struct gl_stream_buffer *sb);
+extern void gl_stream_buffer_free(struct gl_stream_buffer *sb);
+extern bool gl_stream_buffer_write(struct gl_stream_buffer *sb,
+				   const void *data, size_t size,
+				   size_t *offset);
+extern void gl_stream_buffer_end_scene(struct gl_stream_buffer *sb);
+
 struct gs_texture {
 	gs_device_t *device;
 	enum gs_texture_type type;
@@ -599,6 +648,7 @@ struct gs_stage_surface {
 	GLint gl_internal_format;
 	GLenum gl_type;
 	GLuint pack_buffer;
+	GLsync sync;
 };
 
 struct gs_zstencil_buffer {
@@ -639,9 +689,17 @@ struct gs_device {
 	struct gl_platform *plat;
 	enum copy_type copy_type;
 
+	/* linked programs are cached on disk if the driver supports it,
+	 * keyed by the shader sources and the driver */
+	bool program_binary;
+	uint64_t driver_hash;
+
 	GLuint empty_vao;
 	gs_samplerstate_t *raw_load_sampler;
 
+	/* only used if the driver supports ARB_buffer_storage */
+	struct gl_stream_buffer stream;
+
 	gs_texture_t *cur_render_target;
 	gs_zstencil_t *cur_zstencil_buffer;
 	int cur_render_side;
@@ -0,0 +1,454 @@
+/* gl-surfaceless-egl.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Offscreen EGL for machines without a display server.  Mesa exposes this
+ * through EGL_MESA_platform_surfaceless, the NVIDIA driver only through
+ * EGL_EXT_platform_device, so both are tried.  There are no windows, all
+ * rendering goes to textures and the context is made current without a
+ * surface (EGL_KHR_surfaceless_context). */
+
+#include "gl-surfaceless-egl.h"
+
+#include "gl-egl-common.h"
+
+#include <glad/glad_egl.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_PLATFORM_DEVICE_EXT
+#define EGL_PLATFORM_DEVICE_EXT 0x313F
+#endif
+
+#define MAX_DEVICES 32
+
+static const EGLint config_attribs[] = {EGL_SURFACE_TYPE,
+					EGL_PBUFFER_BIT,
+					EGL_RENDERABLE_TYPE,
+					EGL_OPENGL_BIT,
+					EGL_STENCIL_SIZE,
+					0,
+					EGL_DEPTH_SIZE,
+					0,
+					EGL_BUFFER_SIZE,
+					32,
+					EGL_ALPHA_SIZE,
+					8,
+					EGL_NONE};
+
+static const EGLint ctx_attribs[] = {
+#ifdef _DEBUG
+	EGL_CONTEXT_OPENGL_DEBUG,
+	EGL_TRUE,
+#endif
+	EGL_CONTEXT_OPENGL_PROFILE_MASK,
+	EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+	EGL_CONTEXT_MAJOR_VERSION,
+	3,
+	EGL_CONTEXT_MINOR_VERSION,
+	3,
+	EGL_NONE};
+
+static const EGLint khr_ctx_attribs[] = {
+#ifdef _DEBUG
+	EGL_CONTEXT_FLAGS_KHR,
+	EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR,
+#endif
+	EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+	EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+	EGL_CONTEXT_MAJOR_VERSION_KHR,
+	3,
+	EGL_CONTEXT_MINOR_VERSION_KHR,
+	3,
+	EGL_NONE};
+
+struct gl_windowinfo {
+	int unused;
+};
+
+struct gl_platform {
+	EGLDisplay display;
+	EGLConfig config;
+	EGLContext context;
+};
+
+static bool extension_supported(const char *extensions, const char *search)
+{
+	if (!extensions)
+		return false;
+
+	const char *result = strstr(extensions, search);
+	unsigned long len = strlen(search);
+	return result != NULL &&
+	       (result == extensions || *(result - 1) == ' ') &&
+	       (result[len] == ' ' || result[len] == '\0');
+}
+
+static bool egl_make_current(EGLDisplay display, EGLContext context)
+{
+	if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE) {
+		blog(LOG_ERROR, "eglBindAPI failed");
+	}
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		blog(LOG_ERROR, "eglMakeCurrent failed: %s",
+		     gl_egl_error_to_string(eglGetError()));
+		return false;
+	}
+
+	return true;
+}
+
+/* adapter 0 is the default (Mesa) display, anything else is an index into
+ * the EGL device list, the same numbering gl_egl_enum_adapters uses */
+static EGLDisplay get_display(uint32_t adapter)
+{
+	const char *client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	const EGLAttrib plat_attribs[] = {EGL_NONE};
+	EGLDisplay display = EGL_NO_DISPLAY;
+
+	if (adapter == 0 &&
+	    extension_supported(client_exts, "EGL_MESA_platform_surfaceless")) {
+		display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+						EGL_DEFAULT_DISPLAY,
+						plat_attribs);
+		if (display != EGL_NO_DISPLAY) {
+			blog(LOG_INFO, "Using EGL/Surfaceless");
+			return display;
+		}
+	}
+
+	if (!extension_supported(client_exts, "EGL_EXT_platform_device") ||
+	    !eglQueryDevicesEXT)
+		return EGL_NO_DISPLAY;
+
+	EGLDeviceEXT devices[MAX_DEVICES];
+	EGLint num_devices = 0;
+
+	if (!eglQueryDevicesEXT(MAX_DEVICES, devices, &num_devices) ||
+	    num_devices == 0) {
+		blog(LOG_ERROR, "eglQueryDevicesEXT failed");
+		return EGL_NO_DISPLAY;
+	}
+
+	EGLint idx = adapter ? (EGLint)adapter - 1 : 0;
+	if (idx >= num_devices) {
+		blog(LOG_WARNING, "EGL device %d not found, using device 0",
+		     (int)idx);
+		idx = 0;
+	}
+
+	display = eglGetPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[idx],
+					plat_attribs);
+	if (display != EGL_NO_DISPLAY)
+		blog(LOG_INFO, "Using EGL/Device %d", (int)idx);
+
+	return display;
+}
+
+static bool egl_context_create(struct gl_platform *plat, const EGLint *attribs)
+{
+	EGLint num_config;
+
+	if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE) {
+		blog(LOG_ERROR, "eglBindAPI failed");
+	}
+
+	EGLBoolean result = eglChooseConfig(plat->display, config_attribs,
+					    &plat->config, 1, &num_config);
+	if (result != EGL_TRUE || num_config == 0) {
+		blog(LOG_ERROR, "eglChooseConfig failed");
+		return false;
+	}
+
+	plat->context = eglCreateContext(plat->display, plat->config,
+					 EGL_NO_CONTEXT, attribs);
+	if (plat->context == EGL_NO_CONTEXT) {
+		blog(LOG_ERROR, "eglCreateContext failed: %s",
+		     gl_egl_error_to_string(eglGetError()));
+		return false;
+	}
+
+	return egl_make_current(plat->display, plat->context);
+}
+
+static void egl_context_destroy(struct gl_platform *plat)
+{
+	egl_make_current(plat->display, EGL_NO_CONTEXT);
+	eglDestroyContext(plat->display, plat->context);
+}
+
+static struct gl_windowinfo *
+gl_surfaceless_egl_windowinfo_create(const struct gs_init_data *info)
+{
+	UNUSED_PARAMETER(info);
+
+	blog(LOG_ERROR, "Windows cannot be created on the surfaceless "
+			"platform");
+	return NULL;
+}
+
+static void gl_surfaceless_egl_windowinfo_destroy(struct gl_windowinfo *info)
+{
+	bfree(info);
+}
+
+static struct gl_platform *
+gl_surfaceless_egl_platform_create(gs_device_t *device, uint32_t adapter)
+{
+	struct gl_platform *plat = bzalloc(sizeof(struct gl_platform));
+
+	device->plat = plat;
+
+	/* the device enumeration entry points are needed before there is a
+	 * display, glad only resolves them through eglGetProcAddress */
+	if (!gladLoadEGL()) {
+		blog(LOG_ERROR, "Unable to load EGL entry functions.");
+		goto fail_display_init;
+	}
+
+	plat->display = get_display(adapter);
+	if (plat->display == EGL_NO_DISPLAY) {
+		blog(LOG_ERROR, "No surfaceless EGL display available");
+		goto fail_display_init;
+	}
+
+	EGLint major;
+	EGLint minor;
+
+	if (eglInitialize(plat->display, &major, &minor) == EGL_FALSE) {
+		blog(LOG_ERROR, "eglInitialize failed");
+		goto fail_display_init;
+	}
+
+	blog(LOG_INFO, "Initialized EGL %d.%d", major, minor);
+
+	const char *extensions = eglQueryString(plat->display, EGL_EXTENSIONS);
+	blog(LOG_DEBUG, "Supported EGL Extensions: %s", extensions);
+
+	if (!extension_supported(extensions, "EGL_KHR_surfaceless_context")) {
+		blog(LOG_ERROR, "EGL_KHR_surfaceless_context is required");
+		goto fail_context_create;
+	}
+
+	const EGLint *attribs = ctx_attribs;
+	if (major == 1 && minor == 4) {
+		if (extension_supported(extensions, "EGL_KHR_create_context")) {
+			attribs = khr_ctx_attribs;
+		} else {
+			blog(LOG_ERROR,
+			     "EGL_KHR_create_context extension is required to use EGL 1.4.");
+			goto fail_context_create;
+		}
+	} else if (major < 1 || (major == 1 && minor < 4)) {
+		blog(LOG_ERROR, "EGL 1.4 or higher is required.");
+		goto fail_context_create;
+	}
+
+	if (!egl_context_create(plat, attribs)) {
+		goto fail_context_create;
+	}
+
+	if (!gladLoadGL()) {
+		blog(LOG_ERROR, "Failed to load OpenGL entry functions.");
+		goto fail_load_gl;
+	}
+
+	goto success;
+
+fail_load_gl:
+	egl_context_destroy(plat);
+fail_context_create:
+	eglTerminate(plat->display);
+fail_display_init:
+	bfree(plat);
+	plat = NULL;
+success:
+	return plat;
+}
+
+static void gl_surfaceless_egl_platform_destroy(struct gl_platform *plat)
+{
+	if (plat) {
+		egl_context_destroy(plat);
+		eglTerminate(plat->display);
+		bfree(plat);
+	}
+}
+
+static bool
+gl_surfaceless_egl_platform_init_swapchain(struct gs_swap_chain *swap)
+{
+	UNUSED_PARAMETER(swap);
+	return false;
+}
+
+static void
+gl_surfaceless_egl_platform_cleanup_swapchain(struct gs_swap_chain *swap)
+{
+	UNUSED_PARAMETER(swap);
+}
+
+static void gl_surfaceless_egl_device_enter_context(gs_device_t *device)
+{
+	struct gl_platform *plat = device->plat;
+	egl_make_current(plat->display, plat->context);
+}
+
+static void gl_surfaceless_egl_device_leave_context(gs_device_t *device)
+{
+	struct gl_platform *plat = device->plat;
+	egl_make_current(plat->display, EGL_NO_CONTEXT);
+}
+
+static void *gl_surfaceless_egl_device_get_device_obj(gs_device_t *device)
+{
+	return device->plat->context;
+}
+
+static void gl_surfaceless_egl_getclientsize(const struct gs_swap_chain *swap,
+					     uint32_t *width, uint32_t *height)
+{
+	UNUSED_PARAMETER(swap);
+	*width = 0;
+	*height = 0;
+}
+
+static void gl_surfaceless_egl_clear_context(gs_device_t *device)
+{
+	struct gl_platform *plat = device->plat;
+	egl_make_current(plat->display, EGL_NO_CONTEXT);
+}
+
+static void gl_surfaceless_egl_update(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+static void gl_surfaceless_egl_device_load_swapchain(gs_device_t *device,
+						     gs_swapchain_t *swap)
+{
+	device->cur_swap = swap;
+}
+
+static void gl_surfaceless_egl_device_present(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+static struct gs_texture *gl_surfaceless_egl_device_texture_create_from_dmabuf(
+	gs_device_t *device, unsigned int width, unsigned int height,
+	uint32_t drm_format, enum gs_color_format color_format,
+	uint32_t n_planes, const int *fds, const uint32_t *strides,
+	const uint32_t *offsets, const uint64_t *modifiers)
+{
+	struct gl_platform *plat = device->plat;
+
+	return gl_egl_create_dmabuf_image(plat->display, width, height,
+					  drm_format, color_format, n_planes,
+					  fds, strides, offsets, modifiers);
+}
+
+static bool gl_surfaceless_egl_device_query_dmabuf_capabilities(
+	gs_device_t *device, enum gs_dmabuf_flags *dmabuf_flags,
+	uint32_t **drm_formats, size_t *n_formats)
+{
+	struct gl_platform *plat = device->plat;
+
+	return gl_egl_query_dmabuf_capabilities(plat->display, dmabuf_flags,
+						drm_formats, n_formats);
+}
+
+static bool gl_surfaceless_egl_device_query_dmabuf_modifiers_for_format(
+	gs_device_t *device, uint32_t drm_format, uint64_t **modifiers,
+	size_t *n_modifiers)
+{
+	struct gl_platform *plat = device->plat;
+
+	return gl_egl_query_dmabuf_modifiers_for_format(
+		plat->display, drm_format, modifiers, n_modifiers);
+}
+
+static struct gs_texture *gl_surfaceless_egl_device_texture_create_from_pixmap(
+	gs_device_t *device, uint32_t width, uint32_t height,
+	enum gs_color_format color_format, uint32_t target, void *pixmap)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(target);
+	UNUSED_PARAMETER(pixmap);
+
+	return NULL;
+}
+
+static bool gl_surfaceless_egl_device_texture_export_dmabuf(
+	gs_device_t *device, gs_texture_t *tex, uint32_t *drm_format,
+	uint32_t *n_planes, int *fds, uint32_t *strides, uint32_t *offsets,
+	uint64_t *modifier)
+{
+	struct gl_platform *plat = device->plat;
+
+	return gl_egl_export_dmabuf_image(plat->display, tex, drm_format,
+					  n_planes, fds, strides, offsets,
+					  modifier);
+}
+
+static bool gl_surfaceless_egl_enum_adapters(gs_device_t *device,
+					     bool (*callback)(void *param,
+							      const char *name,
+							      uint32_t id),
+					     void *param)
+{
+	return gl_egl_enum_adapters(device->plat->display, callback, param);
+}
+
+static const struct gl_winsys_vtable egl_surfaceless_winsys_vtable = {
+	.windowinfo_create = gl_surfaceless_egl_windowinfo_create,
+	.windowinfo_destroy = gl_surfaceless_egl_windowinfo_destroy,
+	.platform_create = gl_surfaceless_egl_platform_create,
+	.platform_destroy = gl_surfaceless_egl_platform_destroy,
+	.platform_init_swapchain = gl_surfaceless_egl_platform_init_swapchain,
+	.platform_cleanup_swapchain =
+		gl_surfaceless_egl_platform_cleanup_swapchain,
+	.device_enter_context = gl_surfaceless_egl_device_enter_context,
+	.device_leave_context = gl_surfaceless_egl_device_leave_context,
+	.device_get_device_obj = gl_surfaceless_egl_device_get_device_obj,
+	.getclientsize = gl_surfaceless_egl_getclientsize,
+	.clear_context = gl_surfaceless_egl_clear_context,
+	.update = gl_surfaceless_egl_update,
+	.device_load_swapchain = gl_surfaceless_egl_device_load_swapchain,
+	.device_present = gl_surfaceless_egl_device_present,
+	.device_texture_create_from_dmabuf =
+		gl_surfaceless_egl_device_texture_create_from_dmabuf,
+	.device_query_dmabuf_capabilities =
+		gl_surfaceless_egl_device_query_dmabuf_capabilities,
+	.device_query_dmabuf_modifiers_for_format =
+		gl_surfaceless_egl_device_query_dmabuf_modifiers_for_format,
+	.device_texture_create_from_pixmap =
+		gl_surfaceless_egl_device_texture_create_from_pixmap,
+	.device_texture_export_dmabuf =
+		gl_surfaceless_egl_device_texture_export_dmabuf,
+	.device_enum_adapters = gl_surfaceless_egl_enum_adapters,
+};
+
+const struct gl_winsys_vtable *gl_surfaceless_egl_get_winsys_vtable(void)
+{
+	return &egl_surfaceless_winsys_vtable;
+}
@@ -113,6 +113,10 @@ void gs_vertexbuffer_destroy(gs_vertbuffer_t *vb)
 		if (vb->vao)
 			gl_delete_vertex_arrays(1, &vb->vao);
 
+		if (vb->stream_regions.num)
+			da_erase_item(vb->device->stream.vertex_buffers, &vb);
+
+		da_free(vb->stream_regions);
 		da_free(vb->uv_sizes);
 		da_free(vb->uv_buffers);
 		gs_vbdata_destroy(vb->data);
@@ -121,6 +125,47 @@ void gs_vertexbuffer_destroy(gs_vertbuffer_t *vb)
 	}
 }
 
+static struct gl_stream_region *find_stream_region(struct gs_vertex_buffer *vb,
+						  GLuint buffer)
+{
+	for (size_t i = 0; i < vb->stream_regions.num; i++) {
+		if (vb->stream_regions.array[i].buffer == buffer)
+			return vb->stream_regions.array + i;
+	}
+
+	return NULL;
+}
+
+static bool flush_buffer(struct gs_vertex_buffer *vb, GLuint buffer,
+			 const void *data, size_t size)
+{
+	struct gl_stream_buffer *stream = &vb->device->stream;
+	struct gl_stream_region *region = find_stream_region(vb, buffer);
+	size_t offset;
+
+	if (gl_stream_buffer_write(stream, data, size, &offset)) {
+		if (!region) {
+			if (!vb->stream_regions.num)
+				da_push_back(stream->vertex_buffers, &vb);
+
+			region = da_push_back_new(vb->stream_regions);
+			region->buffer = buffer;
+		}
+
+		region->offset = offset;
+		region->size = size;
+		return true;
+	}
+
+	if (region) {
+		da_erase(vb->stream_regions, region - vb->stream_regions.array);
+		if (!vb->stream_regions.num)
+			da_erase_item(stream->vertex_buffers, &vb);
+	}
+
+	return update_buffer(GL_ARRAY_BUFFER, buffer, data, size);
+}
+
 static inline void gs_vertexbuffer_flush_internal(gs_vertbuffer_t *vb,
 						  const struct gs_vb_data *data)
 {
@@ -134,29 +179,26 @@ static inline void gs_vertexbuffer_flush_internal(gs_vertbuffer_t *vb,
 	}
 
 	if (data->points) {
-		if (!update_buffer(GL_ARRAY_BUFFER, vb->vertex_buffer,
-				   data->points,
-				   data->num * sizeof(struct vec3)))
+		if (!flush_buffer(vb, vb->vertex_buffer, data->points,
+				  data->num * sizeof(struct vec3)))
 			goto failed;
 	}
 
 	if (vb->normal_buffer && data->normals) {
-		if (!update_buffer(GL_ARRAY_BUFFER, vb->normal_buffer,
-				   data->normals,
-				   data->num * sizeof(struct vec3)))
+		if (!flush_buffer(vb, vb->normal_buffer, data->normals,
+				  data->num * sizeof(struct vec3)))
 			goto failed;
 	}
 
 	if (vb->tangent_buffer && data->tangents) {
-		if (!update_buffer(GL_ARRAY_BUFFER, vb->tangent_buffer,
-				   data->tangents,
-				   data->num * sizeof(struct vec3)))
+		if (!flush_buffer(vb, vb->tangent_buffer, data->tangents,
+				  data->num * sizeof(struct vec3)))
 			goto failed;
 	}
 
 	if (vb->color_buffer && data->colors) {
-		if (!update_buffer(GL_ARRAY_BUFFER, vb->color_buffer,
-				   data->colors, data->num * sizeof(uint32_t)))
+		if (!flush_buffer(vb, vb->color_buffer, data->colors,
+				  data->num * sizeof(uint32_t)))
 			goto failed;
 	}
 
@@ -165,7 +207,7 @@ static inline void gs_vertexbuffer_flush_internal(gs_vertbuffer_t *vb,
 		struct gs_tvertarray *tv = data->tvarray + i;
 		size_t size = data->num * tv->width * sizeof(float);
 
-		if (!update_buffer(GL_ARRAY_BUFFER, buffer, tv->array, size))
+		if (!flush_buffer(vb, buffer, tv->array, size))
 			goto failed;
 	}
 
@@ -221,9 +263,11 @@ static inline GLuint get_vb_buffer(struct gs_vertex_buffer *vb,
 static bool load_vb_buffer(struct shader_attrib *attrib,
 			   struct gs_vertex_buffer *vb, GLint id)
 {
+	struct gl_stream_region *region;
 	GLenum type;
 	GLint width;
 	GLuint buffer;
+	size_t offset = 0;
 	bool success = true;
 
 	buffer = get_vb_buffer(vb, attrib->type, attrib->index, &width, &type);
@@ -233,10 +277,17 @@ static bool load_vb_buffer(struct shader_attrib *attrib,
 		return false;
 	}
 
+	region = find_stream_region(vb, buffer);
+	if (region) {
+		buffer = vb->device->stream.buffer;
+		offset = region->offset;
+	}
+
 	if (!gl_bind_buffer(GL_ARRAY_BUFFER, buffer))
 		return false;
 
-	glVertexAttribPointer(id, width, type, GL_TRUE, 0, 0);
+	glVertexAttribPointer(id, width, type, GL_TRUE, 0,
+			      (const GLvoid *)offset);
 	if (!gl_success("glVertexAttribPointer"))
 		success = false;
 
@@ -265,7 +316,9 @@ bool load_vb_buffers(struct gs_program *program, struct gs_vertex_buffer *vb,
 			return false;
 	}
 
-	if (ib && !gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ib->buffer))
+	if (ib && !gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER,
+				  ib->streamed ? ib->device->stream.buffer
+					       : ib->buffer))
 		return false;
 
 	return true;
@@ -613,6 +613,18 @@ static bool gl_x11_egl_device_query_dmabuf_modifiers_for_format(
 		plat->edisplay, drm_format, modifiers, n_modifiers);
 }
 
+static bool gl_x11_egl_device_texture_export_dmabuf(
+	gs_device_t *device, gs_texture_t *tex, uint32_t *drm_format,
+	uint32_t *n_planes, int *fds, uint32_t *strides, uint32_t *offsets,
+	uint64_t *modifier)
+{
+	struct gl_platform *plat = device->plat;
+
+	return gl_egl_export_dmabuf_image(plat->edisplay, tex, drm_format,
+					  n_planes, fds, strides, offsets,
+					  modifier);
+}
+
 static bool gl_x11_egl_enum_adapters(gs_device_t *device,
 				     bool (*callback)(void *param,
 						      const char *name,
@@ -645,6 +657,7 @@ static const struct gl_winsys_vtable egl_x11_winsys_vtable = {
 		gl_x11_egl_device_query_dmabuf_modifiers_for_format,
 	.device_texture_create_from_pixmap =
 		gl_x11_egl_device_texture_create_from_pixmap,
+	.device_texture_export_dmabuf = gl_x11_egl_device_texture_export_dmabuf,
 	.device_enum_adapters = gl_x11_egl_enum_adapters,
 };
 
@@ -124,6 +124,16 @@ struct winrt_capture {
 
 	gs_texture_t *texture;
 	bool texture_written;
+
+	/* frame pool surface drawn without a copy, see draw_frame_directly */
+	gs_texture_t *frame_texture;
+	winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame held_frame{
+		nullptr};
+
+	/* only copy the dirty regions of a frame, unless the texture doesn't
+	 * match the previous frame */
+	bool dirty_regions;
+	bool full_copy;
 	winrt::Windows::Graphics::Capture::GraphicsCaptureItem item{nullptr};
 	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice device{
 		nullptr};
@@ -152,12 +162,136 @@ struct winrt_capture {
 		active = FALSE;
 	}
 
+	bool frame_unchanged(const winrt::Windows::Graphics::Capture::
+				     Direct3D11CaptureFrame &frame)
+	{
+		return dirty_regions && frame.DirtyRegions().Size() == 0;
+	}
+
+	void release_held_frame()
+	{
+		if (frame_texture) {
+			gs_texture_destroy(frame_texture);
+			frame_texture = nullptr;
+		}
+
+		held_frame = nullptr;
+	}
+
+	void copy_dirty_rect(ID3D11Texture2D *dst, ID3D11Texture2D *surface,
+			     const winrt::Windows::Graphics::RectInt32 &rect)
+	{
+		/* dirty regions are in surface coordinates */
+		uint32_t left = (uint32_t)max(rect.X, 0);
+		uint32_t top = (uint32_t)max(rect.Y, 0);
+		uint32_t right = (uint32_t)max(rect.X + rect.Width, 0);
+		uint32_t bottom = (uint32_t)max(rect.Y + rect.Height, 0);
+		uint32_t offset_x = 0;
+		uint32_t offset_y = 0;
+
+		if (client_area) {
+			left = max(left, (uint32_t)client_box.left);
+			top = max(top, (uint32_t)client_box.top);
+			right = min(right, (uint32_t)client_box.right);
+			bottom = min(bottom, (uint32_t)client_box.bottom);
+			offset_x = client_box.left;
+			offset_y = client_box.top;
+		} else {
+			right = min(right, texture_width);
+			bottom = min(bottom, texture_height);
+		}
+
+		if (left >= right || top >= bottom)
+			return;
+
+		const D3D11_BOX box = {left, top, 0, right, bottom, 1};
+		context->CopySubresourceRegion(dst, 0, left - offset_x,
+					       top - offset_y, 0, surface, 0,
+					       &box);
+	}
+
+	void copy_frame(const winrt::Windows::Graphics::Capture::
+				Direct3D11CaptureFrame &frame,
+			ID3D11Texture2D *surface, DXGI_FORMAT surface_format)
+	{
+		release_held_frame();
+
+		if (texture) {
+			if (texture_width != gs_texture_get_width(texture) ||
+			    texture_height != gs_texture_get_height(texture)) {
+				gs_texture_destroy(texture);
+				texture = nullptr;
+			}
+		}
+
+		if (!texture) {
+			const gs_color_format color_format =
+				surface_format == DXGI_FORMAT_R16G16B16A16_FLOAT
+					? GS_RGBA16F
+					: GS_BGRA;
+			texture = gs_texture_create(texture_width,
+						    texture_height,
+						    color_format, 1, NULL, 0);
+			full_copy = true;
+		}
+
+		ID3D11Texture2D *const dst =
+			(ID3D11Texture2D *)gs_texture_get_obj(texture);
+
+		if (dirty_regions && !full_copy) {
+			/* only the parts that changed since the last frame */
+			for (const winrt::Windows::Graphics::RectInt32 &rect :
+			     frame.DirtyRegions())
+				copy_dirty_rect(dst, surface, rect);
+			return;
+		}
+
+		if (client_area) {
+			context->CopySubresourceRegion(dst, 0, 0, 0, 0, surface,
+						       0, &client_box);
+		} else {
+			context->CopyResource(dst, surface);
+		}
+
+		full_copy = false;
+	}
+
+	bool draw_frame_directly(const winrt::Windows::Graphics::Capture::
+					 Direct3D11CaptureFrame &frame,
+				 ID3D11Texture2D *surface)
+	{
+		/* keep drawing the surface we already hold */
+		if (held_frame && frame_unchanged(frame))
+			return true;
+
+		release_held_frame();
+
+		frame_texture = gs_texture_wrap_obj(surface);
+		if (!frame_texture)
+			return false;
+
+		/* holding on to the frame keeps its surface out of the pool
+		 * until the next one arrives, the pool has a second buffer to
+		 * capture into meanwhile */
+		held_frame = frame;
+
+		if (texture) {
+			gs_texture_destroy(texture);
+			texture = nullptr;
+		}
+
+		return true;
+	}
+
 	void on_frame_arrived(winrt::Windows::Graphics::Capture::
 				      Direct3D11CaptureFramePool const &sender,
 			      winrt::Windows::Foundation::IInspectable const &)
 	{
 		const winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame
 			frame = sender.TryGetNextFrame();
+		if (!frame)
+			return;
+
 		const winrt::Windows::Graphics::SizeInt32 frame_content_size =
 			frame.ContentSize();
 
@@ -173,6 +307,11 @@ struct winrt_capture {
 
 		if (desc.Format ==
 		    get_pixel_format(window, monitor, force_sdr)) {
+			const bool resized =
+				frame_content_size.Width != last_size.Width ||
+				frame_content_size.Height != last_size.Height;
+			const D3D11_BOX last_client_box = client_box;
+
 			if (!client_area ||
 			    get_client_box(window, desc.Width, desc.Height,
 					   &client_box)) {
@@ -181,54 +320,35 @@ struct winrt_capture {
 							client_box.left;
 					texture_height = client_box.bottom -
 							 client_box.top;
+
+					if (memcmp(&client_box,
+						   &last_client_box,
+						   sizeof(client_box)) != 0)
+						full_copy = true;
 				} else {
 					texture_width = desc.Width;
 					texture_height = desc.Height;
 				}
 
-				if (texture) {
-					if (texture_width !=
-						    gs_texture_get_width(
-							    texture) ||
-					    texture_height !=
-						    gs_texture_get_height(
-							    texture)) {
-						gs_texture_destroy(texture);
-						texture = nullptr;
-					}
-				}
-
-				if (!texture) {
-					const gs_color_format color_format =
-						desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT
-							? GS_RGBA16F
-							: GS_BGRA;
-					texture = gs_texture_create(
-						texture_width, texture_height,
-						color_format, 1, NULL, 0);
-				}
+				/* the pool surface can't be held across
+				 * Recreate, and has no view of a sub-box */
+				const bool direct =
+					!client_area && !resized &&
+					(desc.BindFlags &
+					 D3D11_BIND_SHADER_RESOURCE) != 0;
 
-				if (client_area) {
-					context->CopySubresourceRegion(
-						(ID3D11Texture2D *)
-							gs_texture_get_obj(
-								texture),
-						0, 0, 0, 0, frame_surface.get(),
-						0, &client_box);
-				} else {
-					/* if they gave an SRV, we could avoid this copy */
-					context->CopyResource(
-						(ID3D11Texture2D *)
-							gs_texture_get_obj(
-								texture),
-						frame_surface.get());
-				}
+				if (!direct ||
+				    !draw_frame_directly(frame,
+							 frame_surface.get()))
+					copy_frame(frame, frame_surface.get(),
+						   desc.Format);
 
 				texture_written = true;
+			} else {
+				full_copy = true;
 			}
 
-			if (frame_content_size.Width != last_size.Width ||
-			    frame_content_size.Height != last_size.Height) {
+			if (resized) {
 				format = desc.Format;
 				frame_pool.Recreate(
 					device,
@@ -239,6 +359,7 @@ struct winrt_capture {
 					2, frame_content_size);
 
 				last_size = frame_content_size;
+				full_copy = true;
 			}
 		} else {
 			active = FALSE;
@@ -254,8 +375,10 @@ static void winrt_capture_device_loss_release(void *data)
 {
 	winrt_capture *capture = static_cast<winrt_capture *>(data);
 	capture->active = FALSE;
+	capture->full_copy = true;
 
 	capture->frame_arrived.revoke();
+	capture->held_frame = nullptr;
 
 	try {
 		capture->frame_pool.Close();
@@ -301,6 +424,64 @@ try {
 	return false;
 }
 
+static bool winrt_capture_dirty_region_supported()
+try {
+	return winrt::Windows::Foundation::Metadata::ApiInformation::
+		IsPropertyPresent(
+			L"Windows.Graphics.Capture.GraphicsCaptureSession",
+			L"DirtyRegionMode");
+} catch (const winrt::hresult_error &err) {
+	blog(LOG_ERROR, "winrt_capture_dirty_region_supported (0x%08X): %s",
+	     err.code().value, winrt::to_string(err.message()).c_str());
+	return false;
+} catch (...) {
+	blog(LOG_ERROR, "winrt_capture_dirty_region_supported (0x%08X)",
+	     winrt::to_hresult().value);
+	return false;
+}
+
+static bool winrt_capture_min_update_interval_supported()
+try {
+	return winrt::Windows::Foundation::Metadata::ApiInformation::
+		IsPropertyPresent(
+			L"Windows.Graphics.Capture.GraphicsCaptureSession",
+			L"MinUpdateInterval");
+} catch (const winrt::hresult_error &err) {
+	blog(LOG_ERROR,
+	     "winrt_capture_min_update_interval_supported (0x%08X): %s",
+	     err.code().value, winrt::to_string(err.message()).c_str());
+	return false;
+} catch (...) {
+	blog(LOG_ERROR, "winrt_capture_min_update_interval_supported (0x%08X)",
+	     winrt::to_hresult().value);
+	return false;
+}
+
+/* have the session report dirty regions, so unchanged frames can be skipped
+ * and changed ones copied in part, and don't let it deliver frames much
+ * faster than they can be rendered */
+static bool winrt_capture_configure_updates(
+	const winrt::Windows::Graphics::Capture::GraphicsCaptureSession &session)
+{
+	const bool dirty_regions = winrt_capture_dirty_region_supported();
+	if (dirty_regions)
+		session.DirtyRegionMode(
+			winrt::Windows::Graphics::Capture::
+				GraphicsCaptureDirtyRegionMode::ReportOnly);
+
+	struct obs_video_info ovi;
+	if (winrt_capture_min_update_interval_supported() &&
+	    obs_get_video_info(&ovi)) {
+		/* half the frame interval, in 100 ns units */
+		const int64_t interval = (int64_t)ovi.fps_den * 10000000 /
+					 ((int64_t)ovi.fps_num * 2);
+		session.MinUpdateInterval(
+			winrt::Windows::Foundation::TimeSpan(interval));
+	}
+
+	return dirty_regions;
+}
+
 static winrt::Windows::Graphics::Capture::GraphicsCaptureItem
 winrt_capture_create_item(IGraphicsCaptureItemInterop *const interop_factory,
 			  HWND window, HMONITOR monitor)
@@ -401,6 +582,7 @@ static void winrt_capture_device_loss_rebuild(void *device_void, void *data)
 		session.IsCursorCaptureEnabled(capture->capture_cursor &&
 					       capture->cursor_visible);
 
+	capture->dirty_regions = winrt_capture_configure_updates(session);
 	capture->item = item;
 	capture->device = device;
 	d3d_device->GetImmediateContext(&capture->context);
@@ -483,6 +665,8 @@ try {
 	if (cursor_toggle_supported)
 		session.IsCursorCaptureEnabled(cursor);
 
+	const bool dirty_regions = winrt_capture_configure_updates(session);
+
 	struct winrt_capture *capture = new winrt_capture{};
 	capture->window = window;
 	capture->client_area = client_area;
@@ -491,6 +675,8 @@ try {
 	capture->format = format;
 	capture->capture_cursor = cursor && cursor_toggle_supported;
 	capture->cursor_visible = cursor;
+	capture->dirty_regions = dirty_regions;
+	capture->full_copy = true;
 	capture->item = item;
 	capture->device = device;
 	d3d_device->GetImmediateContext(&capture->context);
@@ -560,6 +746,7 @@ extern "C" EXPORT void winrt_capture_free(struct winrt_capture *capture)
 		obs_enter_graphics();
 		gs_unregister_loss_callbacks(capture);
 		gs_texture_destroy(capture->texture);
+		gs_texture_destroy(capture->frame_texture);
 		obs_leave_graphics();
 
 		capture->frame_arrived.revoke();
@@ -673,7 +860,9 @@ extern "C" EXPORT void winrt_capture_render(struct winrt_capture *capture)
 		gs_blend_state_push();
 		gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
-		gs_texture_t *const texture = capture->texture;
+		gs_texture_t *const texture = capture->frame_texture
+						      ? capture->frame_texture
+						      : capture->texture;
 		gs_effect_set_texture_srgb(
 			gs_effect_get_param_by_name(effect, "image"), texture);
 		gs_effect_set_float(gs_effect_get_param_by_name(effect,
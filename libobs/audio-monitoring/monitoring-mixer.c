@@ -0,0 +1,537 @@
+#include "../media-io/audio-resampler.h"
+#include "../util/deque.h"
+#include "../util/darray.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/util_uint64.h"
+
+#include "monitoring-mixer.h"
+
+#define MIX_CHUNK_FRAMES 256
+
+struct audio_monitor {
+	obs_source_t *source;
+	audio_resampler_t *resampler;
+	struct deque queue;
+	uint32_t push_frames;
+	bool playing;
+	bool added;
+	bool ignore;
+
+	bool source_has_video;
+	uint64_t last_recv_time;
+	uint64_t prev_video_ts;
+	uint64_t time_since_prev;
+	struct deque delay_buffer;
+	DARRAY(float) buf;
+};
+
+/* device_mutex serializes opening and closing the device, mix_mutex guards
+ * what the device callback touches.  The device is never opened or closed
+ * with mix_mutex held, the backend's callback may be waiting on it. */
+static pthread_mutex_t device_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mix_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+	/* device_mutex */
+	char *device_id;
+	uint32_t device_buffer_ms;
+	size_t refs;
+	bool open;
+
+	/* mix_mutex */
+	DARRAY(struct audio_monitor *) inputs;
+	uint32_t sample_rate;
+	enum speaker_layout speakers;
+	uint32_t channels;
+	uint32_t buffer_ms;
+	uint32_t buffer_frames;
+} mixer;
+
+/* #define DEBUG_AUDIO */
+
+/* ------------------------------------------------------------------------- */
+/* source side                                                               */
+
+static void monitor_clear(struct audio_monitor *monitor)
+{
+	deque_free(&monitor->queue);
+	deque_free(&monitor->delay_buffer);
+	monitor->push_frames = 0;
+	monitor->playing = false;
+}
+
+/* called with mix_mutex held */
+static void monitor_reset_resampler(struct audio_monitor *monitor)
+{
+	const struct audio_output_info *info =
+		audio_output_get_info(obs->audio.audio);
+	struct resample_info from = {.samples_per_sec = info->samples_per_sec,
+				     .speakers = info->speakers,
+				     .format = AUDIO_FORMAT_FLOAT_PLANAR};
+	struct resample_info to = {.samples_per_sec = mixer.sample_rate,
+				   .speakers = mixer.speakers,
+				   .format = AUDIO_FORMAT_FLOAT};
+
+	audio_resampler_destroy(monitor->resampler);
+	monitor->resampler = NULL;
+	monitor_clear(monitor);
+
+	if (!mixer.channels)
+		return;
+
+	monitor->resampler = audio_resampler_create(&to, &from);
+	if (!monitor->resampler)
+		blog(LOG_WARNING, "%s: Failed to create resampler for '%s'",
+		     __FUNCTION__, obs_source_get_name(monitor->source));
+}
+
+/* holds back audio that is ahead of the source's video, and cuts audio that
+ * has fallen behind it.  pad is how much audio is already queued. */
+static bool process_audio_delay(struct audio_monitor *monitor, float **data,
+				uint32_t *frames, uint64_t ts, uint32_t pad)
+{
+	obs_source_t *s = monitor->source;
+	uint64_t last_frame_ts = s->last_frame_ts;
+	uint64_t cur_time = os_gettime_ns();
+	uint64_t front_ts;
+	uint64_t cur_ts;
+	int64_t diff;
+	uint32_t blocksize = mixer.channels * sizeof(float);
+
+	/* cut off audio if long-since leftover audio in delay buffer */
+	if (cur_time - monitor->last_recv_time > 1000000000)
+		deque_free(&monitor->delay_buffer);
+	monitor->last_recv_time = cur_time;
+
+	ts += monitor->source->sync_offset;
+
+	deque_push_back(&monitor->delay_buffer, &ts, sizeof(ts));
+	deque_push_back(&monitor->delay_buffer, frames, sizeof(*frames));
+	deque_push_back(&monitor->delay_buffer, *data, *frames * blocksize);
+
+	if (!monitor->prev_video_ts) {
+		monitor->prev_video_ts = last_frame_ts;
+
+	} else if (monitor->prev_video_ts == last_frame_ts) {
+		monitor->time_since_prev += util_mul_div64(
+			*frames, 1000000000ULL, mixer.sample_rate);
+	} else {
+		monitor->time_since_prev = 0;
+	}
+
+	while (monitor->delay_buffer.size != 0) {
+		size_t size;
+		bool bad_diff;
+
+		deque_peek_front(&monitor->delay_buffer, &cur_ts, sizeof(ts));
+		front_ts = cur_ts - util_mul_div64(pad, 1000000000ULL,
+						   mixer.sample_rate);
+		diff = (int64_t)front_ts - (int64_t)last_frame_ts;
+		bad_diff = !last_frame_ts || llabs(diff) > 5000000000 ||
+			   monitor->time_since_prev > 100000000ULL;
+
+		/* delay audio if rushing */
+		if (!bad_diff && diff > 75000000) {
+#ifdef DEBUG_AUDIO
+			blog(LOG_INFO,
+			     "audio rushing, cutting audio, "
+			     "diff: %lld, delay buffer size: %lu, "
+			     "v: %llu: a: %llu",
+			     diff, (int)monitor->delay_buffer.size,
+			     last_frame_ts, front_ts);
+#endif
+			return false;
+		}
+
+		deque_pop_front(&monitor->delay_buffer, NULL, sizeof(ts));
+		deque_pop_front(&monitor->delay_buffer, frames,
+				sizeof(*frames));
+
+		size = *frames * blocksize;
+		da_resize(monitor->buf, size);
+		deque_pop_front(&monitor->delay_buffer, monitor->buf.array,
+				size);
+
+		/* cut audio if dragging */
+		if (!bad_diff && diff < -75000000 &&
+		    monitor->delay_buffer.size > 0) {
+#ifdef DEBUG_AUDIO
+			blog(LOG_INFO,
+			     "audio dragging, cutting audio, "
+			     "diff: %lld, delay buffer size: %lu, "
+			     "v: %llu: a: %llu",
+			     diff, (int)monitor->delay_buffer.size,
+			     last_frame_ts, front_ts);
+#endif
+			continue;
+		}
+
+		*data = monitor->buf.array;
+		return true;
+	}
+
+	return false;
+}
+
+static void on_audio_playback(void *param, obs_source_t *source,
+			      const struct audio_data *audio_data, bool muted)
+{
+	struct audio_monitor *monitor = param;
+	uint8_t *resample_data[MAX_AV_PLANES];
+	float vol = source->user_volume;
+	uint32_t resample_frames;
+	uint64_t ts_offset;
+	size_t frame_size;
+	float *data;
+	bool success;
+
+	if (os_atomic_load_long(&source->activate_refs) == 0)
+		return;
+
+	pthread_mutex_lock(&mix_mutex);
+
+	if (!monitor->resampler)
+		goto unlock;
+
+	success = audio_resampler_resample(
+		monitor->resampler, resample_data, &resample_frames, &ts_offset,
+		(const uint8_t *const *)audio_data->data,
+		(uint32_t)audio_data->frames);
+	if (!success || !resample_frames)
+		goto unlock;
+
+	frame_size = mixer.channels * sizeof(float);
+	data = (float *)resample_data[0];
+
+	bool decouple_audio = async_unbuffered(source) &&
+			      source->async_decoupled;
+
+	if (monitor->source_has_video && !decouple_audio) {
+		uint64_t ts = audio_data->timestamp - ts_offset;
+		uint32_t pad = (uint32_t)(monitor->queue.size / frame_size);
+
+		if (!process_audio_delay(monitor, &data, &resample_frames, ts,
+					 pad))
+			goto unlock;
+	}
+
+	if (muted) {
+		deque_push_back_zero(&monitor->queue,
+				     resample_frames * frame_size);
+	} else {
+		/* apply volume */
+		if (!close_float(vol, 1.0f, EPSILON)) {
+			register float *cur = data;
+			register float *end =
+				cur + resample_frames * mixer.channels;
+
+			while (cur < end)
+				*(cur++) *= vol;
+		}
+		deque_push_back(&monitor->queue, data,
+				resample_frames * frame_size);
+	}
+
+	if (resample_frames > monitor->push_frames)
+		monitor->push_frames = resample_frames;
+
+unlock:
+	pthread_mutex_unlock(&mix_mutex);
+}
+
+static void on_audio_pause(void *data, calldata_t *calldata)
+{
+	UNUSED_PARAMETER(calldata);
+	struct audio_monitor *monitor = data;
+
+	pthread_mutex_lock(&mix_mutex);
+	monitor_clear(monitor);
+	pthread_mutex_unlock(&mix_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* device side                                                               */
+
+void monitoring_mixer_set_format(uint32_t sample_rate,
+				 enum speaker_layout speakers)
+{
+	pthread_mutex_lock(&mix_mutex);
+
+	mixer.sample_rate = sample_rate;
+	mixer.speakers = speakers;
+	mixer.channels = get_audio_channels(speakers);
+	mixer.buffer_frames =
+		(uint32_t)util_mul_div64(mixer.buffer_ms, sample_rate, 1000);
+
+	for (size_t i = 0; i < mixer.inputs.num; i++)
+		monitor_reset_resampler(mixer.inputs.array[i]);
+
+	pthread_mutex_unlock(&mix_mutex);
+}
+
+static void mix_input(struct audio_monitor *monitor, float *out,
+		      size_t frames, uint32_t channels)
+{
+	float chunk[MIX_CHUNK_FRAMES * MAX_AUDIO_CHANNELS];
+
+	while (frames) {
+		size_t count = frames < MIX_CHUNK_FRAMES ? frames
+							 : MIX_CHUNK_FRAMES;
+		size_t samples = count * channels;
+
+		deque_pop_front(&monitor->queue, chunk,
+				samples * sizeof(float));
+		for (size_t i = 0; i < samples; i++)
+			out[i] += chunk[i];
+
+		out += samples;
+		frames -= count;
+	}
+}
+
+void monitoring_mixer_render(float *out, uint32_t frames, uint32_t channels)
+{
+	memset(out, 0, frames * channels * sizeof(float));
+
+	pthread_mutex_lock(&mix_mutex);
+
+	if (channels != mixer.channels)
+		goto unlock;
+
+	const size_t frame_size = channels * sizeof(float);
+
+	for (size_t i = 0; i < mixer.inputs.num; i++) {
+		struct audio_monitor *monitor = mixer.inputs.array[i];
+		size_t queued = monitor->queue.size / frame_size;
+		size_t limit = mixer.buffer_frames + monitor->push_frames;
+
+		/* build up the buffer again after running dry */
+		if (!monitor->playing) {
+			if (!queued || queued < mixer.buffer_frames)
+				continue;
+			monitor->playing = true;
+		}
+
+		/* keep the latency bounded if audio comes in faster than the
+		 * device plays it */
+		if (queued > limit + frames) {
+			deque_pop_front(&monitor->queue, NULL,
+					(queued - limit) * frame_size);
+			queued = limit;
+		}
+
+		size_t count = queued < frames ? queued : frames;
+		mix_input(monitor, out, count, channels);
+
+		if (count < frames)
+			monitor->playing = false;
+	}
+
+unlock:
+	pthread_mutex_unlock(&mix_mutex);
+}
+
+/* called with device_mutex held */
+static void mixer_close_device(void)
+{
+	if (mixer.open) {
+		monitoring_device_close();
+		mixer.open = false;
+
+		blog(LOG_INFO, "audio monitoring: Stopped monitoring in '%s'",
+		     mixer.device_id);
+	}
+
+	bfree(mixer.device_id);
+	mixer.device_id = NULL;
+}
+
+/* called with device_mutex held */
+static bool mixer_open_device(void)
+{
+	const char *id = obs->audio.monitoring_device_id;
+	uint32_t buffer_ms = obs->audio.monitoring_buffer_ms;
+
+	mixer_close_device();
+
+	pthread_mutex_lock(&mix_mutex);
+	mixer.channels = 0;
+	mixer.buffer_ms = buffer_ms;
+	for (size_t i = 0; i < mixer.inputs.num; i++)
+		monitor_reset_resampler(mixer.inputs.array[i]);
+	pthread_mutex_unlock(&mix_mutex);
+
+	mixer.device_id = bstrdup(id);
+	mixer.device_buffer_ms = buffer_ms;
+	mixer.open = monitoring_device_open(id, buffer_ms);
+
+	if (mixer.open)
+		blog(LOG_INFO,
+		     "audio monitoring: Started monitoring in '%s' "
+		     "with a %" PRIu32 " ms buffer",
+		     id, buffer_ms);
+	else
+		blog(LOG_WARNING,
+		     "audio monitoring: Failed to open device '%s'", id);
+
+	return mixer.open;
+}
+
+static inline bool mixer_device_current(void)
+{
+	return mixer.open &&
+	       strcmp(mixer.device_id, obs->audio.monitoring_device_id) == 0 &&
+	       mixer.device_buffer_ms == obs->audio.monitoring_buffer_ms;
+}
+
+static bool mixer_add_input(struct audio_monitor *monitor)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&device_mutex);
+
+	if (!mixer_device_current())
+		success = mixer_open_device();
+
+	if (success) {
+		pthread_mutex_lock(&mix_mutex);
+		monitor_reset_resampler(monitor);
+		da_push_back(mixer.inputs, &monitor);
+		pthread_mutex_unlock(&mix_mutex);
+
+		monitor->added = true;
+		mixer.refs++;
+	}
+
+	pthread_mutex_unlock(&device_mutex);
+	return success;
+}
+
+static void mixer_remove_input(struct audio_monitor *monitor)
+{
+	if (!monitor->added)
+		return;
+
+	pthread_mutex_lock(&device_mutex);
+
+	pthread_mutex_lock(&mix_mutex);
+	da_erase_item(mixer.inputs, &monitor);
+	if (!mixer.inputs.num)
+		da_free(mixer.inputs);
+	pthread_mutex_unlock(&mix_mutex);
+
+	monitor->added = false;
+	if (--mixer.refs == 0)
+		mixer_close_device();
+
+	pthread_mutex_unlock(&device_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool audio_monitor_init(struct audio_monitor *monitor,
+			       obs_source_t *source)
+{
+	monitor->source = source;
+
+	const char *id = obs->audio.monitoring_device_id;
+	if (!id || !*id)
+		return false;
+
+	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
+		obs_data_t *s = obs_source_get_settings(source);
+		const char *s_dev_id = obs_data_get_string(s, "device_id");
+		bool match = devices_match(s_dev_id, id);
+		obs_data_release(s);
+
+		if (match) {
+			monitor->ignore = true;
+			blog(LOG_INFO,
+			     "audio monitoring: Prevented feedback-loop "
+			     "in '%s'",
+			     s_dev_id);
+			return true;
+		}
+	}
+
+	monitor->source_has_video =
+		(source->info.output_flags & OBS_SOURCE_VIDEO) != 0;
+
+	return mixer_add_input(monitor);
+}
+
+static void audio_monitor_init_final(struct audio_monitor *monitor)
+{
+	if (monitor->ignore)
+		return;
+
+	obs_source_add_audio_capture_callback(monitor->source,
+					      on_audio_playback, monitor);
+	obs_source_add_audio_pause_callback(monitor->source, on_audio_pause,
+					    monitor);
+}
+
+static void audio_monitor_free(struct audio_monitor *monitor)
+{
+	if (monitor->ignore)
+		return;
+
+	if (monitor->source) {
+		obs_source_remove_audio_capture_callback(
+			monitor->source, on_audio_playback, monitor);
+		obs_source_remove_audio_pause_callback(monitor->source,
+						       on_audio_pause, monitor);
+	}
+
+	mixer_remove_input(monitor);
+
+	audio_resampler_destroy(monitor->resampler);
+	deque_free(&monitor->queue);
+	deque_free(&monitor->delay_buffer);
+	da_free(monitor->buf);
+}
+
+struct audio_monitor *audio_monitor_create(obs_source_t *source)
+{
+	struct audio_monitor *monitor = bzalloc(sizeof(*monitor));
+
+	if (!audio_monitor_init(monitor, source))
+		goto fail;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	da_push_back(obs->audio.monitors, &monitor);
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+	audio_monitor_init_final(monitor);
+	return monitor;
+
+fail:
+	audio_monitor_free(monitor);
+	bfree(monitor);
+	return NULL;
+}
+
+void audio_monitor_reset(struct audio_monitor *monitor)
+{
+	obs_source_t *source = monitor->source;
+
+	audio_monitor_free(monitor);
+	memset(monitor, 0, sizeof(*monitor));
+
+	if (audio_monitor_init(monitor, source))
+		audio_monitor_init_final(monitor);
+}
+
+void audio_monitor_destroy(struct audio_monitor *monitor)
+{
+	if (monitor) {
+		audio_monitor_free(monitor);
+
+		pthread_mutex_lock(&obs->audio.monitoring_mutex);
+		da_erase_item(obs->audio.monitors, &monitor);
+		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+		bfree(monitor);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../obs-internal.h"
+
+/*
+ * Audio monitoring mixer
+ *
+ *   All monitored sources are resampled to the format of the monitoring
+ * device and queued here, and the backend's device callback pulls them out
+ * already summed into a single stream.  Each backend only has to implement
+ * the device side below.
+ */
+
+/* implemented by the backend.  open is called with no mixer locks held, and
+ * the backend reports the device format with monitoring_mixer_set_format()
+ * once it is known.  close must not return while the device callback can
+ * still be running. */
+extern bool monitoring_device_open(const char *id, uint32_t buffer_ms);
+extern void monitoring_device_close(void);
+extern bool devices_match(const char *id1, const char *id2);
+
+/* called by the backend */
+extern void monitoring_mixer_set_format(uint32_t sample_rate,
+					enum speaker_layout speakers);
+extern void monitoring_mixer_render(float *out, uint32_t frames,
+				    uint32_t channels);
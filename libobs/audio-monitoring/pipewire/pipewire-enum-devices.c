@@ -0,0 +1,142 @@
+#include <obs-internal.h>
+#include <util/darray.h>
+
+#include <pipewire/pipewire.h>
+
+struct sink_node {
+	char *name;
+	char *description;
+};
+
+struct enum_sinks {
+	struct pw_thread_loop *thread_loop;
+	DARRAY(struct sink_node) sinks;
+	int sync_id;
+	bool done;
+};
+
+static void on_global_cb(void *data, uint32_t id, uint32_t permissions,
+			 const char *type, uint32_t version,
+			 const struct spa_dict *props)
+{
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(permissions);
+	UNUSED_PARAMETER(version);
+	struct enum_sinks *es = data;
+
+	if (!props || strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+		return;
+
+	const char *media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+	const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+	const char *desc = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+
+	if (!media_class || strcmp(media_class, "Audio/Sink") != 0 || !name)
+		return;
+
+	struct sink_node *sink = da_push_back_new(es->sinks);
+	sink->name = bstrdup(name);
+	sink->description = bstrdup(desc ? desc : name);
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = on_global_cb,
+};
+
+static void on_core_done_cb(void *data, uint32_t id, int seq)
+{
+	struct enum_sinks *es = data;
+
+	if (id == PW_ID_CORE && seq == es->sync_id) {
+		es->done = true;
+		pw_thread_loop_signal(es->thread_loop, false);
+	}
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = on_core_done_cb,
+};
+
+void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void *data)
+{
+	struct enum_sinks es = {0};
+	struct pw_context *context = NULL;
+	struct pw_core *core = NULL;
+	struct pw_registry *registry = NULL;
+	struct spa_hook core_listener;
+	struct spa_hook registry_listener;
+
+	pw_init(NULL, NULL);
+
+	es.thread_loop = pw_thread_loop_new("PipeWire enum sinks", NULL);
+	if (!es.thread_loop)
+		return;
+
+	context = pw_context_new(pw_thread_loop_get_loop(es.thread_loop), NULL,
+				 0);
+	if (!context || pw_thread_loop_start(es.thread_loop) < 0)
+		goto fail;
+
+	pw_thread_loop_lock(es.thread_loop);
+
+	core = pw_context_connect(context, NULL, 0);
+	if (core) {
+		pw_core_add_listener(core, &core_listener, &core_events, &es);
+
+		registry = pw_core_get_registry(core, PW_VERSION_REGISTRY, 0);
+		pw_registry_add_listener(registry, &registry_listener,
+					 &registry_events, &es);
+
+		/* every global has been announced once the sync is done */
+		es.sync_id = pw_core_sync(core, PW_ID_CORE, 0);
+		while (!es.done)
+			pw_thread_loop_wait(es.thread_loop);
+
+		spa_hook_remove(&registry_listener);
+		spa_hook_remove(&core_listener);
+		pw_proxy_destroy((struct pw_proxy *)registry);
+		pw_core_disconnect(core);
+	}
+
+	pw_thread_loop_unlock(es.thread_loop);
+	pw_thread_loop_stop(es.thread_loop);
+
+	for (size_t i = 0; i < es.sinks.num; i++) {
+		struct sink_node *sink = &es.sinks.array[i];
+		if (!cb(data, sink->description, sink->name))
+			break;
+	}
+
+fail:
+	if (context)
+		pw_context_destroy(context);
+	pw_thread_loop_destroy(es.thread_loop);
+
+	for (size_t i = 0; i < es.sinks.num; i++) {
+		bfree(es.sinks.array[i].name);
+		bfree(es.sinks.array[i].description);
+	}
+	da_free(es.sinks);
+}
+
+/**
+ * Checks whether a sound source (id1) captures the selected monitoring
+ * output (id2), either directly or through its PulseAudio style .monitor
+ * source.
+ */
+bool devices_match(const char *id1, const char *id2)
+{
+	size_t len;
+
+	if (!id1 || !id2)
+		return false;
+
+	if (strcmp(id1, id2) == 0)
+		return true;
+
+	len = strlen(id2);
+	return strncmp(id1, id2, len) == 0 &&
+	       strcmp(id1 + len, ".monitor") == 0;
+}
@@ -0,0 +1,6 @@
+#include <obs-internal.h>
+
+bool obs_audio_monitoring_available(void)
+{
+	return true;
+}
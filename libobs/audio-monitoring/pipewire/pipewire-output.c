@@ -0,0 +1,207 @@
+#include "obs-internal.h"
+#include "../monitoring-mixer.h"
+
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+
+#if PW_CHECK_VERSION(0, 3, 64)
+#define TARGET_KEY PW_KEY_TARGET_OBJECT
+#else
+#define TARGET_KEY PW_KEY_NODE_TARGET
+#endif
+
+#define blog(level, msg, ...) blog(level, "pipewire-am: " msg, ##__VA_ARGS__)
+
+/* one playback stream that the monitoring mixer renders into from the
+ * PipeWire data thread, the node latency is the monitoring buffer size */
+struct pipewire_monitor {
+	struct pw_thread_loop *thread_loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct pw_stream *stream;
+	struct spa_hook stream_listener;
+	uint32_t channels;
+};
+
+static struct pipewire_monitor pwm;
+
+static void set_channel_positions(struct spa_audio_info_raw *info,
+				  enum speaker_layout speakers)
+{
+	static const uint32_t positions[] = {
+		SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+		SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+		SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR,
+		SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR,
+	};
+
+	for (uint32_t i = 0; i < info->channels; i++)
+		info->position[i] = positions[i];
+
+	switch (speakers) {
+	case SPEAKERS_MONO:
+		info->position[0] = SPA_AUDIO_CHANNEL_MONO;
+		break;
+	case SPEAKERS_2POINT1:
+		info->position[2] = SPA_AUDIO_CHANNEL_LFE;
+		break;
+	case SPEAKERS_4POINT0:
+		info->position[3] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	case SPEAKERS_4POINT1:
+		info->position[4] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	default:
+		break;
+	}
+}
+
+static void on_process_cb(void *data)
+{
+	UNUSED_PARAMETER(data);
+	const uint32_t stride = pwm.channels * sizeof(float);
+	struct pw_buffer *b;
+	struct spa_data *d;
+	uint32_t frames;
+
+	b = pw_stream_dequeue_buffer(pwm.stream);
+	if (!b)
+		return;
+
+	d = &b->buffer->datas[0];
+	if (!d->data)
+		goto queue;
+
+	frames = d->maxsize / stride;
+#if PW_CHECK_VERSION(0, 3, 49)
+	if (b->requested && b->requested < frames)
+		frames = (uint32_t)b->requested;
+#endif
+
+	monitoring_mixer_render(d->data, frames, pwm.channels);
+
+	d->chunk->offset = 0;
+	d->chunk->stride = stride;
+	d->chunk->size = frames * stride;
+
+queue:
+	pw_stream_queue_buffer(pwm.stream, b);
+}
+
+static const struct pw_stream_events stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.process = on_process_cb,
+};
+
+void monitoring_device_close(void)
+{
+	if (pwm.thread_loop) {
+		pw_thread_loop_lock(pwm.thread_loop);
+		if (pwm.stream) {
+			spa_hook_remove(&pwm.stream_listener);
+			pw_stream_disconnect(pwm.stream);
+			pw_stream_destroy(pwm.stream);
+		}
+		if (pwm.core)
+			pw_core_disconnect(pwm.core);
+		pw_thread_loop_unlock(pwm.thread_loop);
+
+		pw_thread_loop_stop(pwm.thread_loop);
+	}
+
+	if (pwm.context)
+		pw_context_destroy(pwm.context);
+	if (pwm.thread_loop)
+		pw_thread_loop_destroy(pwm.thread_loop);
+
+	memset(&pwm, 0, sizeof(pwm));
+}
+
+static bool pipewire_open(const char *id, uint32_t buffer_ms)
+{
+	const struct audio_output_info *info =
+		audio_output_get_info(obs->audio.audio);
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod *params[1];
+	struct pw_properties *props;
+
+	pw_init(NULL, NULL);
+
+	pwm.channels = get_audio_channels(info->speakers);
+	monitoring_mixer_set_format(info->samples_per_sec, info->speakers);
+
+	pwm.thread_loop = pw_thread_loop_new("PipeWire monitoring", NULL);
+	if (!pwm.thread_loop)
+		return false;
+
+	pwm.context = pw_context_new(pw_thread_loop_get_loop(pwm.thread_loop),
+				     NULL, 0);
+	if (!pwm.context)
+		return false;
+
+	if (pw_thread_loop_start(pwm.thread_loop) < 0) {
+		blog(LOG_ERROR, "Error starting thread loop");
+		return false;
+	}
+
+	pw_thread_loop_lock(pwm.thread_loop);
+
+	pwm.core = pw_context_connect(pwm.context, NULL, 0);
+	if (!pwm.core) {
+		blog(LOG_ERROR, "Error creating core: %m");
+		pw_thread_loop_unlock(pwm.thread_loop);
+		return false;
+	}
+
+	props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio",
+				  PW_KEY_MEDIA_CATEGORY, "Playback",
+				  PW_KEY_MEDIA_ROLE, "Production", NULL);
+	pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u",
+			   info->samples_per_sec * buffer_ms / 1000,
+			   info->samples_per_sec);
+	if (strcmp(id, "default") != 0)
+		pw_properties_set(props, TARGET_KEY, id);
+
+	pwm.stream = pw_stream_new(pwm.core, "Audio Monitoring", props);
+	if (!pwm.stream) {
+		blog(LOG_ERROR, "Unable to create stream");
+		pw_thread_loop_unlock(pwm.thread_loop);
+		return false;
+	}
+
+	pw_stream_add_listener(pwm.stream, &pwm.stream_listener,
+			       &stream_events, NULL);
+
+	struct spa_audio_info_raw raw = SPA_AUDIO_INFO_RAW_INIT(
+		.format = SPA_AUDIO_FORMAT_F32, .rate = info->samples_per_sec,
+		.channels = pwm.channels);
+	set_channel_positions(&raw, info->speakers);
+	params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &raw);
+
+	int ret = pw_stream_connect(pwm.stream, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+				    PW_STREAM_FLAG_AUTOCONNECT |
+					    PW_STREAM_FLAG_MAP_BUFFERS |
+					    PW_STREAM_FLAG_RT_PROCESS,
+				    params, 1);
+
+	pw_thread_loop_unlock(pwm.thread_loop);
+
+	if (ret < 0) {
+		blog(LOG_ERROR, "Unable to connect to stream");
+		return false;
+	}
+
+	blog(LOG_INFO, "Started Monitoring in '%s'", id);
+	return true;
+}
+
+bool monitoring_device_open(const char *id, uint32_t buffer_ms)
+{
+	if (!pipewire_open(id, buffer_ms)) {
+		monitoring_device_close();
+		return false;
+	}
+
+	return true;
+}
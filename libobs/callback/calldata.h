@@ -59,6 +59,10 @@ static inline void calldata_init(struct calldata *data)
 
 static inline void calldata_clear(struct calldata *data);
 
+/* Uses a caller-provided buffer (usually on the call stack) so that setting
+ * parameters does not allocate.  Parameters that don't fit are dropped with
+ * an error, so use calldata_init for anything of unbounded size such as
+ * strings. */
 static inline void calldata_init_fixed(struct calldata *data, uint8_t *stack,
 				       size_t size)
 {
@@ -33,6 +33,10 @@ struct signal_info {
 	pthread_mutex_t mutex;
 	bool signalling;
 
+	/* mirrors callbacks.num so that signals nobody is connected to can
+	 * be emitted without locking */
+	volatile long num_callbacks;
+
 	struct signal_info *next;
 };
 
@@ -42,6 +46,7 @@ static inline struct signal_info *signal_info_create(struct decl_info *info)
 	si->func = *info;
 	si->next = NULL;
 	si->signalling = false;
+	si->num_callbacks = 0;
 	da_init(si->callbacks);
 
 	if (pthread_mutex_init_recursive(&si->mutex) != 0) {
@@ -93,6 +98,7 @@ struct signal_handler {
 
 	DARRAY(struct global_callback_info) global_callbacks;
 	pthread_mutex_t global_callbacks_mutex;
+	volatile long num_global_callbacks;
 };
 
 static struct signal_info *getsignal(signal_handler_t *handler,
@@ -228,6 +234,7 @@ static void signal_handler_connect_internal(signal_handler_t *handler,
 	if (keep_ref || idx == DARRAY_INVALID)
 		da_push_back(sig->callbacks, &cb_data);
 
+	os_atomic_set_long(&sig->num_callbacks, (long)sig->callbacks.num);
 	pthread_mutex_unlock(&sig->mutex);
 }
 
@@ -280,6 +287,7 @@ void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
 		}
 	}
 
+	os_atomic_set_long(&sig->num_callbacks, (long)sig->callbacks.num);
 	pthread_mutex_unlock(&sig->mutex);
 
 	if (keep_ref && os_atomic_dec_long(&handler->refs) == 0) {
@@ -298,15 +306,15 @@ void signal_handler_remove_current(void)
 		current_global_cb->remove = true;
 }
 
-void signal_handler_signal(signal_handler_t *handler, const char *signal,
-			   calldata_t *params)
+signal_id_t signal_handler_get_id(signal_handler_t *handler,
+				  const char *signal)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
-	long remove_refs = 0;
-
-	if (!sig)
-		return;
+	return getsignal_locked(handler, signal);
+}
 
+static void signal_callbacks(struct signal_info *sig, calldata_t *params,
+			     long *remove_refs)
+{
 	pthread_mutex_lock(&sig->mutex);
 	sig->signalling = true;
 
@@ -323,15 +331,20 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal,
 		struct signal_callback *cb = sig->callbacks.array + i - 1;
 		if (cb->remove) {
 			if (cb->keep_ref)
-				remove_refs++;
+				(*remove_refs)++;
 
 			da_erase(sig->callbacks, i - 1);
 		}
 	}
 
+	os_atomic_set_long(&sig->num_callbacks, (long)sig->callbacks.num);
 	sig->signalling = false;
 	pthread_mutex_unlock(&sig->mutex);
+}
 
+static void signal_global_callbacks(signal_handler_t *handler,
+				    const char *signal, calldata_t *params)
+{
 	pthread_mutex_lock(&handler->global_callbacks_mutex);
 
 	if (handler->global_callbacks.num) {
@@ -357,7 +370,23 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal,
 		}
 	}
 
+	os_atomic_set_long(&handler->num_global_callbacks,
+			   (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
+}
+
+void signal_handler_signal_id(signal_handler_t *handler, signal_id_t signal,
+			      calldata_t *params)
+{
+	long remove_refs = 0;
+
+	if (!handler || !signal)
+		return;
+
+	if (os_atomic_load_long(&signal->num_callbacks))
+		signal_callbacks(signal, params, &remove_refs);
+	if (os_atomic_load_long(&handler->num_global_callbacks))
+		signal_global_callbacks(handler, signal->func.name, params);
 
 	if (remove_refs) {
 		os_atomic_set_long(&handler->refs,
@@ -366,6 +395,13 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal,
 	}
 }
 
+void signal_handler_signal(signal_handler_t *handler, const char *signal,
+			   calldata_t *params)
+{
+	signal_handler_signal_id(handler, getsignal_locked(handler, signal),
+				 params);
+}
+
 void signal_handler_connect_global(signal_handler_t *handler,
 				   global_signal_callback_t callback,
 				   void *data)
@@ -382,6 +418,8 @@ void signal_handler_connect_global(signal_handler_t *handler,
 	if (idx == DARRAY_INVALID)
 		da_push_back(handler->global_callbacks, &cb_data);
 
+	os_atomic_set_long(&handler->num_global_callbacks,
+			   (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
 }
 
@@ -408,5 +446,7 @@ void signal_handler_disconnect_global(signal_handler_t *handler,
 			da_erase(handler->global_callbacks, idx);
 	}
 
+	os_atomic_set_long(&handler->num_global_callbacks,
+			   (long)handler->global_callbacks.num);
 	pthread_mutex_unlock(&handler->global_callbacks_mutex);
 }
@@ -32,7 +32,9 @@ extern "C" {
  */
 
 struct signal_handler;
+struct signal_info;
 typedef struct signal_handler signal_handler_t;
+typedef struct signal_info *signal_id_t;
 typedef void (*global_signal_callback_t)(void *, const char *, calldata_t *);
 typedef void (*signal_callback_t)(void *, calldata_t *);
 
@@ -78,6 +80,16 @@ EXPORT void signal_handler_remove_current(void);
 EXPORT void signal_handler_signal(signal_handler_t *handler, const char *signal,
 				  calldata_t *params);
 
+/*
+ * Looks up a signal once so that it can be triggered without looking it up by
+ * name each time.  IDs are specific to the handler and stay valid for as long
+ * as it exists.
+ */
+EXPORT signal_id_t signal_handler_get_id(signal_handler_t *handler,
+					 const char *signal);
+EXPORT void signal_handler_signal_id(signal_handler_t *handler,
+				     signal_id_t signal, calldata_t *params);
+
 #ifdef __cplusplus
 }
 #endif
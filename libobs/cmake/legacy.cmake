@@ -37,6 +37,7 @@ target_sources(
           obs-av1.h
           obs-avc.c
           obs-avc.h
+          obs-clock.c
           obs-data.c
           obs-data.h
           obs-defs.h
@@ -44,9 +45,11 @@ target_sources(
           obs-encoder.c
           obs-encoder.h
           obs-ffmpeg-compat.h
+          obs-gpu-timing.c
           obs-hotkey.c
           obs-hotkey.h
           obs-hotkeys.h
+          obs-latency.c
           obs-missing-files.c
           obs-missing-files.h
           obs-nal.c
@@ -59,6 +62,8 @@ target_sources(
           obs-output.c
           obs-output.h
           obs-output-delay.c
+          obs-packet-drop.c
+          obs-packet-drop.h
           obs-properties.c
           obs-properties.h
           obs-service.c
@@ -69,6 +74,7 @@ target_sources(
           obs-source.h
           obs-source-deinterlace.c
           obs-source-transition.c
+          obs-tonemap-lut.c
           obs-video.c
           obs-video-gpu-encode.c
           obs-view.c
@@ -126,6 +132,7 @@ target_sources(
           graphics/matrix3.h
           graphics/matrix4.c
           graphics/matrix4.h
+          graphics/memory-owner.c
           graphics/plane.c
           graphics/plane.h
           graphics/quat.c
@@ -133,6 +140,7 @@ target_sources(
           graphics/shader-parser.c
           graphics/shader-parser.h
           graphics/srgb.h
+          graphics/texture-atlas.c
           graphics/texture-render.c
           graphics/vec2.c
           graphics/vec2.h
@@ -149,6 +157,8 @@ target_sources(
   PRIVATE media-io/audio-io.c
           media-io/audio-io.h
           media-io/audio-math.h
+          media-io/audio-repack.c
+          media-io/audio-repack.h
           media-io/audio-resampler.h
           media-io/audio-resampler-ffmpeg.c
           media-io/format-conversion.c
@@ -184,6 +194,8 @@ target_sources(
           util/circlebuf.h
           util/config-file.c
           util/config-file.h
+          util/congestion-control.c
+          util/congestion-control.h
           util/crc32.c
           util/crc32.h
           util/deque.h
@@ -193,6 +205,8 @@ target_sources(
           util/file-serializer.h
           util/lexer.c
           util/lexer.h
+          util/metrics.c
+          util/metrics.h
           util/platform.c
           util/platform.h
           util/profiler.c
@@ -206,6 +220,7 @@ target_sources(
           util/task.h
           util/text-lookup.c
           util/text-lookup.h
+          util/threading.c
           util/threading.h
           util/utf8.c
           util/utf8.h
@@ -307,6 +322,8 @@ if(OS_WINDOWS)
             util/windows/HRError.hpp
             util/windows/WinHandle.hpp
             libobs.rc
+            audio-monitoring/monitoring-mixer.c
+            audio-monitoring/monitoring-mixer.h
             audio-monitoring/win32/wasapi-output.c
             audio-monitoring/win32/wasapi-enum-devices.c
             audio-monitoring/win32/wasapi-output.h
@@ -378,6 +395,8 @@ elseif(OS_MACOS)
             util/threading-posix.c
             util/threading-posix.h
             util/apple/cfstring-utils.h
+            audio-monitoring/monitoring-mixer.c
+            audio-monitoring/monitoring-mixer.h
             audio-monitoring/osx/coreaudio-enum-devices.c
             audio-monitoring/osx/coreaudio-output.c
             audio-monitoring/osx/coreaudio-monitoring-available.c
@@ -418,12 +437,25 @@ elseif(OS_POSIX)
     target_compile_definitions(libobs PRIVATE USE_XDG)
   endif()
 
-  if(ENABLE_PULSEAUDIO)
+  option(ENABLE_PIPEWIRE_MONITORING "Use PipeWire instead of PulseAudio for audio monitoring" OFF)
+
+  if(ENABLE_PIPEWIRE_MONITORING)
+    find_package(PipeWire 0.3.33 REQUIRED)
+    obs_status(STATUS "-> PipeWire found - audio monitoring enabled")
+    target_sources(
+      libobs
+      PRIVATE audio-monitoring/monitoring-mixer.c audio-monitoring/monitoring-mixer.h
+              audio-monitoring/pipewire/pipewire-output.c audio-monitoring/pipewire/pipewire-enum-devices.c
+              audio-monitoring/pipewire/pipewire-monitoring-available.c)
+
+    target_link_libraries(libobs PRIVATE PipeWire::PipeWire)
+  elseif(ENABLE_PULSEAUDIO)
     find_package(PulseAudio REQUIRED)
     obs_status(STATUS "-> PulseAudio found - audio monitoring enabled")
     target_sources(
       libobs
-      PRIVATE audio-monitoring/pulse/pulseaudio-output.c audio-monitoring/pulse/pulseaudio-enum-devices.c
+      PRIVATE audio-monitoring/monitoring-mixer.c audio-monitoring/monitoring-mixer.h
+              audio-monitoring/pulse/pulseaudio-output.c audio-monitoring/pulse/pulseaudio-enum-devices.c
               audio-monitoring/pulse/pulseaudio-wrapper.c audio-monitoring/pulse/pulseaudio-wrapper.h
               audio-monitoring/pulse/pulseaudio-monitoring-available.c)
 
@@ -479,6 +511,19 @@ if(ENABLE_FFMPEG_MUX_DEBUG)
   target_compile_definitions(libobs PRIVATE SHOW_SUBPROCESSES)
 endif()
 
+option(ENABLE_MIMALLOC "Use mimalloc for libobs memory allocations" OFF)
+option(ENABLE_MEMORY_TAGS "Track libobs memory usage by subsystem" OFF)
+
+if(ENABLE_MIMALLOC)
+  find_package(mimalloc REQUIRED)
+  target_link_libraries(libobs PRIVATE mimalloc)
+  target_compile_definitions(libobs PRIVATE USE_MIMALLOC)
+endif()
+
+if(ENABLE_MEMORY_TAGS)
+  target_compile_definitions(libobs PRIVATE BMEM_TAGS)
+endif()
+
 get_target_property(_OBS_SOURCES libobs SOURCES)
 set(_OBS_HEADERS ${_OBS_SOURCES})
 set(_OBS_FILTERS ${_OBS_SOURCES})
@@ -52,6 +52,8 @@ if(ENABLE_PULSEAUDIO)
   target_sources(
     libobs
     PRIVATE # cmake-format: sortable
+            audio-monitoring/monitoring-mixer.c
+            audio-monitoring/monitoring-mixer.h
             audio-monitoring/pulse/pulseaudio-enum-devices.c
             audio-monitoring/pulse/pulseaudio-monitoring-available.c
             audio-monitoring/pulse/pulseaudio-output.c
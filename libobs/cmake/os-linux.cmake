@@ -46,12 +46,30 @@ target_link_libraries(
   libobs PRIVATE X11::x11-xcb xcb::xcb LibUUID::LibUUID ${CMAKE_DL_LIBS} $<$<NOT:$<BOOL:${HAVE_MATH_IN_STD_LIB}>>:m>
                  $<$<TARGET_EXISTS:xcb::xcb-input>:xcb::xcb-input>)
 
-if(ENABLE_PULSEAUDIO)
+option(ENABLE_PIPEWIRE_MONITORING "Use PipeWire instead of PulseAudio for audio monitoring" OFF)
+
+if(ENABLE_PIPEWIRE_MONITORING)
+  find_package(PipeWire 0.3.33 REQUIRED)
+
+  target_sources(
+    libobs
+    PRIVATE # cmake-format: sortable
+            audio-monitoring/monitoring-mixer.c
+            audio-monitoring/monitoring-mixer.h
+            audio-monitoring/pipewire/pipewire-enum-devices.c
+            audio-monitoring/pipewire/pipewire-monitoring-available.c
+            audio-monitoring/pipewire/pipewire-output.c)
+
+  target_link_libraries(libobs PRIVATE PipeWire::PipeWire)
+  target_enable_feature(libobs "PipeWire audio monitoring (Linux)")
+elseif(ENABLE_PULSEAUDIO)
   find_package(PulseAudio REQUIRED)
 
   target_sources(
     libobs
     PRIVATE # cmake-format: sortable
+            audio-monitoring/monitoring-mixer.c
+            audio-monitoring/monitoring-mixer.h
             audio-monitoring/pulse/pulseaudio-enum-devices.c
             audio-monitoring/pulse/pulseaudio-monitoring-available.c
             audio-monitoring/pulse/pulseaudio-output.c
@@ -12,6 +12,8 @@ target_link_libraries(
 target_sources(
   libobs
   PRIVATE # cmake-format: sortable
+          audio-monitoring/monitoring-mixer.c
+          audio-monitoring/monitoring-mixer.h
           audio-monitoring/osx/coreaudio-enum-devices.c
           audio-monitoring/osx/coreaudio-monitoring-available.c
           audio-monitoring/osx/coreaudio-output.c
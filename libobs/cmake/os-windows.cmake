@@ -22,6 +22,8 @@ target_include_directories(obs-winhandle INTERFACE "${CMAKE_CURRENT_SOURCE_DIR}"
 target_sources(
   libobs
   PRIVATE # cmake-format: sortable
+          audio-monitoring/monitoring-mixer.c
+          audio-monitoring/monitoring-mixer.h
           audio-monitoring/win32/wasapi-enum-devices.c
           audio-monitoring/win32/wasapi-monitoring-available.c
           audio-monitoring/win32/wasapi-output.c
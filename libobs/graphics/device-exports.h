@@ -83,6 +83,7 @@ EXPORT gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device,
 						   uint32_t flags);
 EXPORT gs_timer_t *device_timer_create(gs_device_t *device);
 EXPORT gs_timer_range_t *device_timer_range_create(gs_device_t *device);
+EXPORT gs_sync_t *device_sync_create(gs_device_t *device);
 EXPORT enum gs_texture_type
 device_get_texture_type(const gs_texture_t *texture);
 EXPORT void device_load_vertexbuffer(gs_device_t *device,
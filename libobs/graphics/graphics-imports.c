@@ -147,6 +147,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(gs_stagesurface_get_color_format);
 	GRAPHICS_IMPORT(gs_stagesurface_map);
 	GRAPHICS_IMPORT(gs_stagesurface_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(gs_stagesurface_ready);
 
 	GRAPHICS_IMPORT(gs_zstencil_destroy);
 
@@ -172,6 +173,9 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(gs_timer_range_begin);
 	GRAPHICS_IMPORT(gs_timer_range_end);
 	GRAPHICS_IMPORT(gs_timer_range_get_data);
+	GRAPHICS_IMPORT_OPTIONAL(device_sync_create);
+	GRAPHICS_IMPORT_OPTIONAL(gs_sync_destroy);
+	GRAPHICS_IMPORT_OPTIONAL(gs_sync_wait);
 
 	GRAPHICS_IMPORT(gs_shader_destroy);
 	GRAPHICS_IMPORT(gs_shader_get_num_params);
@@ -210,6 +214,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_shared_texture_available);
 	GRAPHICS_IMPORT(device_texture_open_shared);
 	GRAPHICS_IMPORT(device_texture_create_from_iosurface);
+	GRAPHICS_IMPORT_OPTIONAL(device_texture_create_from_iosurface_plane);
 	GRAPHICS_IMPORT(gs_texture_rebind_iosurface);
 
 	/* win32 specific functions */
@@ -242,6 +247,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_texture_create_from_dmabuf);
 	GRAPHICS_IMPORT(device_query_dmabuf_capabilities);
 	GRAPHICS_IMPORT(device_query_dmabuf_modifiers_for_format);
+	GRAPHICS_IMPORT_OPTIONAL(device_texture_export_dmabuf);
 	GRAPHICS_IMPORT(device_texture_create_from_pixmap);
 #endif
 
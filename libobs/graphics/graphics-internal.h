@@ -83,6 +83,7 @@ struct gs_exports {
 						       uint32_t flags);
 	gs_timer_t *(*device_timer_create)(gs_device_t *device);
 	gs_timer_range_t *(*device_timer_range_create)(gs_device_t *device);
+	gs_sync_t *(*device_sync_create)(gs_device_t *device);
 	enum gs_texture_type (*device_get_texture_type)(
 		const gs_texture_t *texture);
 	void (*device_load_vertexbuffer)(gs_device_t *device,
@@ -213,6 +214,7 @@ struct gs_exports {
 	bool (*gs_stagesurface_map)(gs_stagesurf_t *stagesurf, uint8_t **data,
 				    uint32_t *linesize);
 	void (*gs_stagesurface_unmap)(gs_stagesurf_t *stagesurf);
+	bool (*gs_stagesurface_ready)(gs_stagesurf_t *stagesurf);
 
 	void (*gs_zstencil_destroy)(gs_zstencil_t *zstencil);
 
@@ -240,6 +242,8 @@ struct gs_exports {
 	void (*gs_timer_end)(gs_timer_t *timer);
 	bool (*gs_timer_get_data)(gs_timer_t *timer, uint64_t *ticks);
 	void (*gs_timer_range_destroy)(gs_timer_range_t *range);
+	void (*gs_sync_destroy)(gs_sync_t *sync);
+	bool (*gs_sync_wait)(gs_sync_t *sync, uint64_t timeout_ns);
 	bool (*gs_timer_range_begin)(gs_timer_range_t *range);
 	bool (*gs_timer_range_end)(gs_timer_range_t *range);
 	bool (*gs_timer_range_get_data)(gs_timer_range_t *range, bool *disjoint,
@@ -298,6 +302,8 @@ struct gs_exports {
 	/* OSX/Cocoa specific functions */
 	gs_texture_t *(*device_texture_create_from_iosurface)(gs_device_t *dev,
 							      void *iosurf);
+	gs_texture_t *(*device_texture_create_from_iosurface_plane)(
+		gs_device_t *dev, void *iosurf, uint32_t plane);
 	gs_texture_t *(*device_texture_open_shared)(gs_device_t *dev,
 						    uint32_t handle);
 	bool (*gs_texture_rebind_iosurface)(gs_texture_t *texture,
@@ -367,6 +373,13 @@ struct gs_exports {
 							 uint32_t drm_format,
 							 uint64_t **modifiers,
 							 size_t *n_modifiers);
+	bool (*device_texture_export_dmabuf)(gs_device_t *device,
+					     gs_texture_t *tex,
+					     uint32_t *drm_format,
+					     uint32_t *n_planes, int *fds,
+					     uint32_t *strides,
+					     uint32_t *offsets,
+					     uint64_t *modifier);
 	struct gs_texture *(*device_texture_create_from_pixmap)(
 		gs_device_t *device, uint32_t width, uint32_t height,
 		enum gs_color_format color_format, uint32_t target,
@@ -383,6 +396,15 @@ struct blend_state {
 	enum gs_blend_op_type op;
 };
 
+struct gs_texrender_target {
+	gs_texture_t *tex;
+	gs_zstencil_t *zs;
+	uint32_t cx, cy;
+	enum gs_color_format format;
+	enum gs_zstencil_format zsformat;
+	uint64_t last_frame;
+};
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -416,4 +438,24 @@ struct graphics_subsystem {
 	DARRAY(struct blend_state) blend_state_stack;
 
 	bool linear_srgb;
+
+	/* render targets of transient texrenders, leased per frame */
+	DARRAY(struct gs_texrender_target) texrender_pool;
+	DARRAY(gs_texrender_t *) texrender_leases;
+	uint64_t frame_count;
+
+	/* GPU memory accounting, keyed by object pointer */
+	struct gs_memory_record *memory_records;
 };
+
+/* memory-owner.c, all of these must be called inside of the context */
+struct gs_memory_record;
+extern void gs_memory_track(graphics_t *graphics, void *obj, uint64_t bytes);
+extern void gs_memory_untrack(graphics_t *graphics, void *obj);
+extern void gs_memory_set_object_owner(graphics_t *graphics, void *obj,
+				       gs_memory_owner_t *owner);
+extern void gs_memory_free_records(graphics_t *graphics);
+extern uint64_t gs_memory_texture_size(uint32_t width, uint32_t height,
+				       uint32_t depth,
+				       enum gs_color_format format,
+				       uint32_t levels);
@@ -219,6 +219,8 @@ error:
 }
 
 extern void gs_effect_actually_destroy(gs_effect_t *effect);
+extern void gs_texrender_pool_free(graphics_t *graphics);
+extern void gs_texrender_pool_begin_frame(graphics_t *graphics);
 
 void gs_destroy(graphics_t *graphics)
 {
@@ -240,11 +242,14 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		gs_texrender_pool_free(graphics);
+
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->sprite_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
+		gs_memory_free_records(graphics);
 
 		thread_graphics = NULL;
 	}
@@ -1366,7 +1371,9 @@ gs_texture_t *gs_texture_create(uint32_t width, uint32_t height,
 	if (!gs_valid("gs_texture_create"))
 		return NULL;
 
-	if (uses_mipmaps && !pow2tex) {
+	/* a mip chain supplied by the caller is fine at any size, only
+	 * generating one needs a power of two */
+	if (uses_mipmaps && !pow2tex && (flags & GS_BUILD_MIPMAPS || !data)) {
 		blog(LOG_WARNING, "Cannot use mipmaps with a "
 				  "non-power-of-two texture.  Disabling "
 				  "mipmaps for this texture.");
@@ -1383,9 +1390,15 @@ gs_texture_t *gs_texture_create(uint32_t width, uint32_t height,
 		levels = 1;
 	}
 
-	return graphics->exports.device_texture_create(graphics->device, width,
-						       height, color_format,
-						       levels, data, flags);
+	gs_texture_t *tex = graphics->exports.device_texture_create(
+		graphics->device, width, height, color_format, levels, data,
+		flags);
+
+	if (tex && (flags & GS_GL_DUMMYTEX) == 0)
+		gs_memory_track(graphics, tex,
+				gs_memory_texture_size(width, height, 1,
+						       color_format, levels));
+	return tex;
 }
 
 #if defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__)
@@ -1422,6 +1435,22 @@ bool gs_query_dmabuf_modifiers_for_format(uint32_t drm_format,
 		graphics->device, drm_format, modifiers, n_modifiers);
 }
 
+bool gs_texture_export_dmabuf(gs_texture_t *tex, uint32_t *drm_format,
+			      uint32_t *n_planes, int *fds, uint32_t *strides,
+			      uint32_t *offsets, uint64_t *modifier)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_texture_export_dmabuf", tex))
+		return false;
+	if (!graphics->exports.device_texture_export_dmabuf)
+		return false;
+
+	return graphics->exports.device_texture_export_dmabuf(
+		graphics->device, tex, drm_format, n_planes, fds, strides,
+		offsets, modifier);
+}
+
 gs_texture_t *gs_texture_create_from_pixmap(uint32_t width, uint32_t height,
 					    enum gs_color_format color_format,
 					    uint32_t target, void *pixmap)
@@ -1464,8 +1493,15 @@ gs_texture_t *gs_cubetexture_create(uint32_t size,
 		data = NULL;
 	}
 
-	return graphics->exports.device_cubetexture_create(
+	gs_texture_t *tex = graphics->exports.device_cubetexture_create(
 		graphics->device, size, color_format, levels, data, flags);
+
+	if (tex)
+		gs_memory_track(graphics, tex,
+				gs_memory_texture_size(size, size, 1,
+						       color_format, levels) *
+					6);
+	return tex;
 }
 
 gs_texture_t *gs_voltexture_create(uint32_t width, uint32_t height,
@@ -1479,10 +1515,32 @@ gs_texture_t *gs_voltexture_create(uint32_t width, uint32_t height,
 	if (!gs_valid("gs_voltexture_create"))
 		return NULL;
 
-	return graphics->exports.device_voltexture_create(graphics->device,
-							  width, height, depth,
-							  color_format, levels,
-							  data, flags);
+	gs_texture_t *tex = graphics->exports.device_voltexture_create(
+		graphics->device, width, height, depth, color_format, levels,
+		data, flags);
+
+	if (tex)
+		gs_memory_track(graphics, tex,
+				gs_memory_texture_size(width, height, depth,
+						       color_format, levels));
+	return tex;
+}
+
+static inline uint64_t zstencil_bytes_per_pixel(enum gs_zstencil_format format)
+{
+	switch (format) {
+	case GS_ZS_NONE:
+		return 0;
+	case GS_Z16:
+		return 2;
+	case GS_Z24_S8:
+	case GS_Z32F:
+		return 4;
+	case GS_Z32F_S8X24:
+		return 8;
+	}
+
+	return 0;
 }
 
 gs_zstencil_t *gs_zstencil_create(uint32_t width, uint32_t height,
@@ -1493,8 +1551,14 @@ gs_zstencil_t *gs_zstencil_create(uint32_t width, uint32_t height,
 	if (!gs_valid("gs_zstencil_create"))
 		return NULL;
 
-	return graphics->exports.device_zstencil_create(graphics->device, width,
-							height, format);
+	gs_zstencil_t *zs = graphics->exports.device_zstencil_create(
+		graphics->device, width, height, format);
+
+	if (zs)
+		gs_memory_track(graphics, zs,
+				(uint64_t)width * height *
+					zstencil_bytes_per_pixel(format));
+	return zs;
 }
 
 gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
@@ -1505,8 +1569,14 @@ gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
 	if (!gs_valid("gs_stagesurface_create"))
 		return NULL;
 
-	return graphics->exports.device_stagesurface_create(
+	gs_stagesurf_t *surf = graphics->exports.device_stagesurface_create(
 		graphics->device, width, height, color_format);
+
+	if (surf)
+		gs_memory_track(graphics, surf,
+				gs_memory_texture_size(width, height, 1,
+						       color_format, 1));
+	return surf;
 }
 
 gs_samplerstate_t *gs_samplerstate_create(const struct gs_sampler_info *info)
@@ -1887,6 +1957,7 @@ void gs_begin_frame(void)
 	if (!gs_valid("gs_begin_frame"))
 		return;
 
+	gs_texrender_pool_begin_frame(graphics);
 	graphics->exports.device_begin_frame(graphics->device);
 }
 
@@ -2411,6 +2482,7 @@ void gs_texture_destroy(gs_texture_t *tex)
 	if (!tex)
 		return;
 
+	gs_memory_untrack(graphics, tex);
 	graphics->exports.gs_texture_destroy(tex);
 }
 
@@ -2496,6 +2568,7 @@ void gs_cubetexture_destroy(gs_texture_t *cubetex)
 	if (!cubetex)
 		return;
 
+	gs_memory_untrack(graphics, cubetex);
 	graphics->exports.gs_cubetexture_destroy(cubetex);
 }
 
@@ -2529,6 +2602,7 @@ void gs_voltexture_destroy(gs_texture_t *voltex)
 	if (!voltex)
 		return;
 
+	gs_memory_untrack(graphics, voltex);
 	graphics->exports.gs_voltexture_destroy(voltex);
 }
 
@@ -2581,6 +2655,7 @@ void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 	if (!stagesurf)
 		return;
 
+	gs_memory_untrack(graphics, stagesurf);
 	graphics->exports.gs_stagesurface_destroy(stagesurf);
 }
 
@@ -2626,6 +2701,21 @@ bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 	return graphics->exports.gs_stagesurface_map(stagesurf, data, linesize);
 }
 
+bool gs_stagesurface_try_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			     uint32_t *linesize)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p3("gs_stagesurface_try_map", stagesurf, data, linesize))
+		return false;
+
+	if (graphics->exports.gs_stagesurface_ready &&
+	    !graphics->exports.gs_stagesurface_ready(stagesurf))
+		return false;
+
+	return graphics->exports.gs_stagesurface_map(stagesurf, data, linesize);
+}
+
 void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2636,6 +2726,19 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 	graphics->exports.gs_stagesurface_unmap(stagesurf);
 }
 
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_stagesurface_ready", stagesurf))
+		return false;
+
+	if (graphics->exports.gs_stagesurface_ready)
+		return graphics->exports.gs_stagesurface_ready(stagesurf);
+	else
+		return true;
+}
+
 void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 {
 	if (!gs_valid("gs_zstencil_destroy"))
@@ -2643,6 +2746,7 @@ void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 	if (!zstencil)
 		return;
 
+	gs_memory_untrack(thread_graphics, zstencil);
 	thread_graphics->exports.gs_zstencil_destroy(zstencil);
 }
 
@@ -2791,6 +2895,39 @@ bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
 	return thread_graphics->exports.gs_timer_get_data(timer, ticks);
 }
 
+gs_sync_t *gs_sync_create(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sync_create"))
+		return NULL;
+
+	if (!graphics->exports.device_sync_create)
+		return NULL;
+
+	return graphics->exports.device_sync_create(graphics->device);
+}
+
+void gs_sync_destroy(gs_sync_t *sync)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sync_destroy"))
+		return;
+	if (!sync)
+		return;
+
+	graphics->exports.gs_sync_destroy(sync);
+}
+
+bool gs_sync_wait(gs_sync_t *sync, uint64_t timeout_ns)
+{
+	if (!gs_valid_p("gs_sync_wait", sync))
+		return false;
+
+	return thread_graphics->exports.gs_sync_wait(sync, timeout_ns);
+}
+
 void gs_timer_range_destroy(gs_timer_range_t *range)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2927,8 +3064,13 @@ bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv,
 	if (graphics->exports.device_texture_create_nv12) {
 		success = graphics->exports.device_texture_create_nv12(
 			graphics->device, tex_y, tex_uv, width, height, flags);
-		if (success)
+		if (success) {
+			/* both planes are views of one biplanar texture */
+			uint64_t luma = (uint64_t)width * height * 1;
+			gs_memory_track(graphics, *tex_y, luma);
+			gs_memory_track(graphics, *tex_uv, luma / 2);
 			return true;
+		}
 	}
 
 	*tex_y = gs_texture_create(width, height, GS_R8, 1, NULL, flags);
@@ -2966,8 +3108,13 @@ bool gs_texture_create_p010(gs_texture_t **tex_y, gs_texture_t **tex_uv,
 	if (graphics->exports.device_texture_create_p010) {
 		success = graphics->exports.device_texture_create_p010(
 			graphics->device, tex_y, tex_uv, width, height, flags);
-		if (success)
+		if (success) {
+			/* both planes are views of one biplanar texture */
+			uint64_t luma = (uint64_t)width * height * 2;
+			gs_memory_track(graphics, *tex_y, luma);
+			gs_memory_track(graphics, *tex_uv, luma / 2);
 			return true;
+		}
 	}
 
 	*tex_y = gs_texture_create(width, height, GS_R16, 1, NULL, flags);
@@ -3013,6 +3160,20 @@ gs_texture_t *gs_texture_create_from_iosurface(void *iosurf)
 		graphics->device, iosurf);
 }
 
+gs_texture_t *gs_texture_create_from_iosurface_plane(void *iosurf,
+						    uint32_t plane)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_texture_create_from_iosurface_plane", iosurf))
+		return NULL;
+	if (!graphics->exports.device_texture_create_from_iosurface_plane)
+		return NULL;
+
+	return graphics->exports.device_texture_create_from_iosurface_plane(
+		graphics->device, iosurf, plane);
+}
+
 bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf)
 {
 	graphics_t *graphics = thread_graphics;
@@ -3278,11 +3439,16 @@ gs_stagesurf_t *gs_stagesurface_create_nv12(uint32_t width, uint32_t height)
 		return NULL;
 	}
 
-	if (graphics->exports.device_stagesurface_create_nv12)
-		return graphics->exports.device_stagesurface_create_nv12(
-			graphics->device, width, height);
+	if (!graphics->exports.device_stagesurface_create_nv12)
+		return NULL;
 
-	return NULL;
+	gs_stagesurf_t *surf =
+		graphics->exports.device_stagesurface_create_nv12(
+			graphics->device, width, height);
+	if (surf)
+		gs_memory_track(graphics, surf,
+				(uint64_t)width * height * 3 / 2);
+	return surf;
 }
 
 gs_stagesurf_t *gs_stagesurface_create_p010(uint32_t width, uint32_t height)
@@ -3298,11 +3464,16 @@ gs_stagesurf_t *gs_stagesurface_create_p010(uint32_t width, uint32_t height)
 		return NULL;
 	}
 
-	if (graphics->exports.device_stagesurface_create_p010)
-		return graphics->exports.device_stagesurface_create_p010(
-			graphics->device, width, height);
+	if (!graphics->exports.device_stagesurface_create_p010)
+		return NULL;
 
-	return NULL;
+	gs_stagesurf_t *surf =
+		graphics->exports.device_stagesurface_create_p010(
+			graphics->device, width, height);
+	if (surf)
+		gs_memory_track(graphics, surf,
+				(uint64_t)width * height * 3);
+	return surf;
 }
 
 void gs_register_loss_callbacks(const struct gs_device_loss *callbacks)
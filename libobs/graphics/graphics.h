@@ -273,6 +273,7 @@ struct gs_sampler_state;
 struct gs_shader;
 struct gs_swap_chain;
 struct gs_timer;
+struct gs_sync;
 struct gs_texrender;
 struct gs_shader_param;
 struct gs_effect;
@@ -291,7 +292,9 @@ typedef struct gs_sampler_state gs_samplerstate_t;
 typedef struct gs_swap_chain gs_swapchain_t;
 typedef struct gs_timer gs_timer_t;
 typedef struct gs_timer_range gs_timer_range_t;
+typedef struct gs_sync gs_sync_t;
 typedef struct gs_texture_render gs_texrender_t;
+typedef struct gs_texture_atlas gs_texture_atlas_t;
 typedef struct gs_shader gs_shader_t;
 typedef struct gs_shader_param gs_sparam_t;
 typedef struct gs_effect gs_effect_t;
@@ -465,6 +468,9 @@ EXPORT void gs_effect_set_color(gs_eparam_t *param, uint32_t argb);
 
 EXPORT gs_texrender_t *gs_texrender_create(enum gs_color_format format,
 					   enum gs_zstencil_format zsformat);
+EXPORT gs_texrender_t *
+gs_texrender_create_transient(enum gs_color_format format,
+			      enum gs_zstencil_format zsformat);
 EXPORT void gs_texrender_destroy(gs_texrender_t *texrender);
 EXPORT bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx,
 			       uint32_t cy);
@@ -477,6 +483,66 @@ EXPORT gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
 EXPORT enum gs_color_format
 gs_texrender_get_format(const gs_texrender_t *texrender);
 
+/* ---------------------------------------------------
+ * texture atlas helper functions
+ * --------------------------------------------------- */
+
+struct gs_atlas_region {
+	gs_texture_t *texture;
+	uint32_t x;
+	uint32_t y;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+/**
+ * Creates an atlas of square pages that small static textures can be packed
+ * into.  Pages are allocated per color format as needed and released once
+ * their last region is freed.
+ */
+EXPORT gs_texture_atlas_t *gs_texture_atlas_create(uint32_t page_size);
+EXPORT void gs_texture_atlas_destroy(gs_texture_atlas_t *atlas);
+
+/**
+ * Copies a texture into a free region of the atlas.  Returns false if the
+ * texture does not fit into a page, in which case it should be used as is.
+ * Draw the region with gs_draw_sprite_subregion.
+ */
+EXPORT bool gs_texture_atlas_alloc(gs_texture_atlas_t *atlas,
+				   gs_texture_t *src,
+				   struct gs_atlas_region *region);
+EXPORT void gs_texture_atlas_free(gs_texture_atlas_t *atlas,
+				  const struct gs_atlas_region *region);
+
+/* ---------------------------------------------------
+ * GPU memory accounting
+ * --------------------------------------------------- */
+
+typedef struct gs_memory_owner gs_memory_owner_t;
+
+/**
+ * Creates a reference counted owner that textures, z-stencil buffers and
+ * staging surfaces can be attributed to.  Objects hold a reference to their
+ * owner, so it stays valid until both it and its objects are released.
+ */
+EXPORT gs_memory_owner_t *gs_memory_owner_create(void);
+EXPORT void gs_memory_owner_release(gs_memory_owner_t *owner);
+
+/** Gets the estimated bytes and number of objects attributed to an owner */
+EXPORT uint64_t gs_memory_owner_get_bytes(const gs_memory_owner_t *owner);
+EXPORT size_t gs_memory_owner_get_objects(const gs_memory_owner_t *owner);
+
+/**
+ * Sets the owner of objects created on the calling thread from now on and
+ * returns the previous one so it can be restored.  Does not need a graphics
+ * context.  NULL leaves new objects unattributed.
+ */
+EXPORT gs_memory_owner_t *gs_memory_set_owner(gs_memory_owner_t *owner);
+EXPORT gs_memory_owner_t *gs_memory_get_owner(void);
+
+/** Gets the estimated bytes of all tracked objects, attributed or not */
+EXPORT uint64_t gs_memory_get_total_bytes(void);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
@@ -747,6 +813,19 @@ EXPORT bool gs_is_present_ready(void);
 EXPORT void gs_present(void);
 EXPORT void gs_flush(void);
 
+/**
+ * Explicit synchronization with APIs outside of the graphics subsystem, such
+ * as hardware encoders reading a texture.  A sync object is signalled once
+ * the GPU has completed every command submitted before it was created.
+ * gs_sync_create returns NULL if the backend has no sync objects, callers
+ * should then fall back to gs_flush.
+ */
+EXPORT gs_sync_t *gs_sync_create(void);
+EXPORT void gs_sync_destroy(gs_sync_t *sync);
+
+/** Waits up to timeout_ns for the sync object, returns true if signalled */
+EXPORT bool gs_sync_wait(gs_sync_t *sync, uint64_t timeout_ns);
+
 EXPORT void gs_set_cull_mode(enum gs_cull_mode mode);
 EXPORT enum gs_cull_mode gs_get_cull_mode(void);
 
@@ -825,6 +904,19 @@ EXPORT bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 				uint32_t *linesize);
 EXPORT void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
 
+/**
+ * Returns whether the last copy into a staging surface has completed, so
+ * that mapping it will not stall.  Always true if the backend cannot tell.
+ */
+EXPORT bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf);
+
+/**
+ * Maps a staging surface only if that will not stall, returns false without
+ * waiting if the last copy into it has not completed yet.
+ */
+EXPORT bool gs_stagesurface_try_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+				    uint32_t *linesize);
+
 EXPORT void gs_zstencil_destroy(gs_zstencil_t *zstencil);
 
 EXPORT void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate);
@@ -898,6 +990,10 @@ EXPORT void gs_debug_marker_end(void);
 /** platform specific function for creating (GL_TEXTURE_RECTANGLE) textures
  * from shared surface resources */
 EXPORT gs_texture_t *gs_texture_create_from_iosurface(void *iosurf);
+/** creates a texture for one plane of an NV12 or P010 IOSurface, which can
+ * be used as the destination of gs_copy_texture */
+EXPORT gs_texture_t *gs_texture_create_from_iosurface_plane(void *iosurf,
+							    uint32_t plane);
 EXPORT bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf);
 EXPORT gs_texture_t *gs_texture_open_shared(uint32_t handle);
 EXPORT bool gs_shared_texture_available(void);
@@ -991,6 +1087,14 @@ EXPORT bool gs_query_dmabuf_modifiers_for_format(uint32_t drm_format,
 						 uint64_t **modifiers,
 						 size_t *n_modifiers);
 
+#define GS_DMABUF_MAX_PLANES 4
+
+/** Exports a 2D texture as DMA-BUF planes, the caller owns the fds */
+EXPORT bool gs_texture_export_dmabuf(gs_texture_t *tex, uint32_t *drm_format,
+				     uint32_t *n_planes, int *fds,
+				     uint32_t *strides, uint32_t *offsets,
+				     uint64_t *modifier);
+
 EXPORT gs_texture_t *
 gs_texture_create_from_pixmap(uint32_t width, uint32_t height,
 			      enum gs_color_format color_format,
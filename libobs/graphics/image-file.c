@@ -15,9 +15,14 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+#include <stddef.h>
+
 #include "image-file.h"
 #include "../util/base.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/darray.h"
 #include "../util/dstr.h"
 #include "vec4.h"
 
@@ -56,40 +61,249 @@ static void bi_def_bitmap_modified(void *bitmap)
 	UNUSED_PARAMETER(bitmap);
 }
 
-static inline int get_full_decoded_gif_size(gs_image_file_t *image)
+static inline int get_full_decoded_gif_size(gif_animation *gif)
 {
-	return image->gif.width * image->gif.height * 4 *
-	       image->gif.frame_count;
+	return gif->width * gif->height * 4 * gif->frame_count;
 }
 
-static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage,
-			      size_t size)
+/* ------------------------------------------------------------------------- */
+/*
+ *   The frames of an animated GIF are decoded once when the file is loaded,
+ * and kept as the pixels that changed since the previous frame, which is
+ * usually a small fraction of the decoded size.  Playing the animation then
+ * only has to apply those deltas.  The frames are shared by every image that
+ * loads the same file with the same alpha mode.
+ *
+ *   If the deltas of a file still exceed GIF_MAX_CACHE_SIZE, the file is
+ * kept instead and frames are decoded on demand, as they are needed.
+ */
+
+#define GIF_MAX_CACHE_SIZE (256ULL * 1024ULL * 1024ULL)
+
+/* unchanged pixels needed to end a run of changed ones */
+#define GIF_MIN_SKIP 4
+
+struct gif_frames {
+	struct gif_frames *next;
+	long refs;
+
+	char *path;
+	enum gs_image_alpha_mode alpha_mode;
+	int64_t file_size;
+	time_t file_time;
+
+	uint32_t cx;
+	uint32_t cy;
+	unsigned int frame_count;
+	int loop_count;
+	uint64_t *delays;
+	uint64_t mem_usage;
+
+	/* only used when the frames did not fit in the cache */
+	pthread_mutex_t gif_mutex;
+	gif_animation *gif;
+	uint8_t *gif_data;
+
+	/* the image's frame table points here; each entry is a word count
+	 * followed by (skip, count, pixels...) runs, or NULL if on demand */
+	uint32_t *frames[];
+};
+
+static pthread_mutex_t gif_frames_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct gif_frames *first_gif_frames = NULL;
+
+static inline struct gif_frames *get_gif_frames(gs_image_file_t *image)
 {
-	UNUSED_PARAMETER(image);
+	return (struct gif_frames *)((uint8_t *)image->animation_frame_cache -
+				     offsetof(struct gif_frames, frames));
+}
 
-	if (mem_usage)
-		*mem_usage += size;
-	return bzalloc(size);
+static void gif_frames_destroy(struct gif_frames *frames)
+{
+	for (unsigned int i = 0; i < frames->frame_count; i++)
+		bfree(frames->frames[i]);
+
+	if (frames->gif) {
+		gif_finalise(frames->gif);
+		bfree(frames->gif);
+		pthread_mutex_destroy(&frames->gif_mutex);
+	}
+
+	bfree(frames->gif_data);
+	bfree(frames->delays);
+	bfree(frames->path);
+	bfree(frames);
 }
 
-static bool init_animated_gif(gs_image_file_t *image, const char *path,
-			      uint64_t *mem_usage,
+static void gif_frames_release(struct gif_frames *frames)
+{
+	pthread_mutex_lock(&gif_frames_mutex);
+
+	if (--frames->refs == 0) {
+		struct gif_frames **prev = &first_gif_frames;
+		while (*prev != frames)
+			prev = &(*prev)->next;
+		*prev = frames->next;
+	} else {
+		frames = NULL;
+	}
+
+	pthread_mutex_unlock(&gif_frames_mutex);
+
+	if (frames)
+		gif_frames_destroy(frames);
+}
+
+/* must be called with gif_frames_mutex held */
+static struct gif_frames *find_gif_frames(const char *path,
+					  enum gs_image_alpha_mode alpha_mode,
+					  int64_t file_size, time_t file_time)
+{
+	for (struct gif_frames *f = first_gif_frames; f; f = f->next) {
+		if (f->alpha_mode == alpha_mode && f->file_size == file_size &&
+		    f->file_time == file_time && strcmp(f->path, path) == 0) {
+			f->refs++;
+			return f;
+		}
+	}
+
+	return NULL;
+}
+
+static void premultiply_frame(uint8_t *data, size_t area,
 			      enum gs_image_alpha_mode alpha_mode)
 {
-	bool is_animated_gif = true;
+	if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB)
+		gs_premultiply_xyza_srgb_loop(data, area);
+	else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY)
+		gs_premultiply_xyza_loop(data, area);
+}
+
+static uint32_t *encode_delta(const uint32_t *prev, const uint32_t *cur,
+			      size_t area, size_t *size)
+{
+	DARRAY(uint32_t) out = {0};
+	size_t i = 0;
+
+	da_push_back_new(out);
+
+	while (i < area) {
+		size_t skip_start = i;
+		while (i < area && cur[i] == prev[i])
+			i++;
+		if (i == area)
+			break;
+
+		/* extend the run until enough pixels in a row are unchanged
+		 * to be worth skipping */
+		size_t end = i + 1;
+		for (size_t j = end; j < area; j++) {
+			if (cur[j] != prev[j])
+				end = j + 1;
+			else if (j + 1 - end >= GIF_MIN_SKIP)
+				break;
+		}
+
+		uint32_t run[2] = {(uint32_t)(i - skip_start),
+				   (uint32_t)(end - i)};
+		da_push_back_array(out, run, 2);
+		da_push_back_array(out, cur + i, end - i);
+		i = end;
+	}
+
+	out.array[0] = (uint32_t)out.num;
+	*size = out.num * sizeof(uint32_t);
+	return out.array;
+}
+
+static void apply_delta(uint32_t *dst, const uint32_t *delta)
+{
+	const uint32_t words = delta[0];
+	size_t pos = 0;
+
+	for (uint32_t i = 1; i < words;) {
+		pos += delta[i++];
+		const uint32_t count = delta[i++];
+
+		memcpy(dst + pos, delta + i, count * sizeof(uint32_t));
+		pos += count;
+		i += count;
+	}
+}
+
+static void gif_set_callbacks(gif_bitmap_callback_vt *callbacks)
+{
+	callbacks->bitmap_create = bi_def_bitmap_create;
+	callbacks->bitmap_destroy = bi_def_bitmap_destroy;
+	callbacks->bitmap_get_buffer = bi_def_bitmap_get_buffer;
+	callbacks->bitmap_modified = bi_def_bitmap_modified;
+	callbacks->bitmap_set_opaque = bi_def_bitmap_set_opaque;
+	callbacks->bitmap_test_opaque = bi_def_bitmap_test_opaque;
+}
+
+/* decodes every frame into deltas, returns false if they do not fit */
+static bool gif_frames_encode(struct gif_frames *frames, gif_animation *gif,
+			      const char *path)
+{
+	const size_t area = (size_t)frames->cx * frames->cy;
+	uint32_t *prev = bzalloc(area * sizeof(uint32_t));
+	uint32_t *cur = bmalloc(area * sizeof(uint32_t));
+	uint64_t total = 0;
+
+	for (unsigned int i = 0; i < frames->frame_count; i++) {
+		size_t size;
+
+		if (gif_decode_frame(gif, i) == GIF_OK) {
+			memcpy(cur, gif->frame_image, area * sizeof(uint32_t));
+			premultiply_frame((uint8_t *)cur, area,
+					  frames->alpha_mode);
+		} else {
+			blog(LOG_WARNING, "Couldn't decode frame %u of '%s'",
+			     i, path);
+			memcpy(cur, prev, area * sizeof(uint32_t));
+		}
+
+		frames->frames[i] = encode_delta(prev, cur, area, &size);
+		total += size;
+
+		if (total > GIF_MAX_CACHE_SIZE)
+			break;
+
+		uint32_t *tmp = prev;
+		prev = cur;
+		cur = tmp;
+	}
+
+	bfree(prev);
+	bfree(cur);
+
+	if (total > GIF_MAX_CACHE_SIZE) {
+		for (unsigned int i = 0; i < frames->frame_count; i++) {
+			bfree(frames->frames[i]);
+			frames->frames[i] = NULL;
+		}
+		return false;
+	}
+
+	frames->mem_usage = total;
+	return true;
+}
+
+static struct gif_frames *gif_frames_create(const char *path,
+					    enum gs_image_alpha_mode alpha_mode,
+					    int64_t file_size, time_t file_time)
+{
+	struct gif_frames *frames = NULL;
+	gif_animation *gif = bzalloc(sizeof(*gif));
+	gif_bitmap_callback_vt callbacks;
+	uint8_t *gif_data = NULL;
 	gif_result result;
 	uint64_t max_size;
 	size_t size, size_read;
 	FILE *file;
 
-	image->bitmap_callbacks.bitmap_create = bi_def_bitmap_create;
-	image->bitmap_callbacks.bitmap_destroy = bi_def_bitmap_destroy;
-	image->bitmap_callbacks.bitmap_get_buffer = bi_def_bitmap_get_buffer;
-	image->bitmap_callbacks.bitmap_modified = bi_def_bitmap_modified;
-	image->bitmap_callbacks.bitmap_set_opaque = bi_def_bitmap_set_opaque;
-	image->bitmap_callbacks.bitmap_test_opaque = bi_def_bitmap_test_opaque;
-
-	gif_create(&image->gif, &image->bitmap_callbacks);
+	gif_set_callbacks(&callbacks);
+	gif_create(gif, &callbacks);
 
 	file = os_fopen(path, "rb");
 	if (!file) {
@@ -101,15 +315,17 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 	size = (size_t)os_ftelli64(file);
 	fseek(file, 0, SEEK_SET);
 
-	image->gif_data = bmalloc(size);
-	size_read = fread(image->gif_data, 1, size, file);
+	gif_data = bmalloc(size);
+	size_read = fread(gif_data, 1, size, file);
+	fclose(file);
+
 	if (size_read != size) {
 		blog(LOG_WARNING, "Failed to fully read gif file '%s'.", path);
 		goto fail;
 	}
 
 	do {
-		result = gif_initialise(&image->gif, size, image->gif_data);
+		result = gif_initialise(gif, size, gif_data);
 		if (result < 0) {
 			blog(LOG_WARNING,
 			     "Failed to initialize gif '%s', "
@@ -119,76 +335,203 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 		}
 	} while (result != GIF_OK);
 
-	if (image->gif.width > 4096 || image->gif.height > 4096) {
+	if (gif->width > 4096 || gif->height > 4096) {
 		blog(LOG_WARNING, "Bad texture dimensions (%dx%d) in '%s'",
-		     image->gif.width, image->gif.height, path);
+		     gif->width, gif->height, path);
 		goto fail;
 	}
 
-	max_size = (uint64_t)image->gif.width * (uint64_t)image->gif.height *
-		   (uint64_t)image->gif.frame_count * 4LLU;
+	max_size = (uint64_t)gif->width * (uint64_t)gif->height *
+		   (uint64_t)gif->frame_count * 4LLU;
 
-	if ((uint64_t)get_full_decoded_gif_size(image) != max_size) {
+	if ((uint64_t)get_full_decoded_gif_size(gif) != max_size) {
 		blog(LOG_WARNING, "Gif '%s' overflowed maximum pointer size",
 		     path);
 		goto fail;
 	}
 
-	image->is_animated_gif = (image->gif.frame_count > 1 && result >= 0);
-	if (image->is_animated_gif) {
-		gif_decode_frame(&image->gif, 0);
-
-		image->animation_frame_cache =
-			alloc_mem(image, mem_usage,
-				  image->gif.frame_count * sizeof(uint8_t *));
-		image->animation_frame_data = alloc_mem(
-			image, mem_usage, get_full_decoded_gif_size(image));
-
-		for (unsigned int i = 0; i < image->gif.frame_count; i++) {
-			if (gif_decode_frame(&image->gif, i) != GIF_OK)
-				blog(LOG_WARNING,
-				     "Couldn't decode frame %u "
-				     "of '%s'",
-				     i, path);
+	if (gif->frame_count <= 1)
+		goto fail;
+
+	frames = bzalloc(sizeof(*frames) +
+			 gif->frame_count * sizeof(frames->frames[0]));
+	frames->refs = 1;
+	frames->path = bstrdup(path);
+	frames->alpha_mode = alpha_mode;
+	frames->file_size = file_size;
+	frames->file_time = file_time;
+	frames->cx = gif->width;
+	frames->cy = gif->height;
+	frames->frame_count = gif->frame_count;
+	frames->loop_count = gif->loop_count;
+	frames->delays = bmalloc(gif->frame_count * sizeof(uint64_t));
+
+	for (unsigned int i = 0; i < gif->frame_count; i++) {
+		uint64_t val = (uint64_t)gif->frames[i].frame_delay *
+			       10000000ULL;
+		frames->delays[i] = val ? val : 100000000;
+	}
+
+	if (gif_frames_encode(frames, gif, path)) {
+		gif_finalise(gif);
+		bfree(gif);
+		bfree(gif_data);
+		return frames;
+	}
+
+	blog(LOG_INFO, "Frames of '%s' are too large to cache, decoding them "
+		       "on demand",
+	     path);
+
+	pthread_mutex_init_value(&frames->gif_mutex);
+	if (pthread_mutex_init(&frames->gif_mutex, NULL) != 0) {
+		gif_frames_destroy(frames);
+		frames = NULL;
+		goto fail;
+	}
+
+	frames->gif = gif;
+	frames->gif_data = gif_data;
+	frames->mem_usage = size + (uint64_t)frames->cx * frames->cy * 4;
+	return frames;
+
+fail:
+	gif_finalise(gif);
+	bfree(gif);
+	bfree(gif_data);
+	return NULL;
+}
+
+static struct gif_frames *
+gif_frames_acquire(const char *path, enum gs_image_alpha_mode alpha_mode)
+{
+	struct gif_frames *frames;
+	struct gif_frames *existing;
+	struct stat st;
+
+	if (os_stat(path, &st) != 0)
+		return NULL;
+
+	pthread_mutex_lock(&gif_frames_mutex);
+	frames = find_gif_frames(path, alpha_mode, (int64_t)st.st_size,
+				 st.st_mtime);
+	pthread_mutex_unlock(&gif_frames_mutex);
+
+	if (frames)
+		return frames;
+
+	/* decoding can take a while, so it is done without the lock; if the
+	 * same file was decoded in the meantime, the first one is kept */
+	frames = gif_frames_create(path, alpha_mode, (int64_t)st.st_size,
+				   st.st_mtime);
+	if (!frames)
+		return NULL;
+
+	pthread_mutex_lock(&gif_frames_mutex);
+	existing = find_gif_frames(path, alpha_mode, (int64_t)st.st_size,
+				   st.st_mtime);
+	if (!existing) {
+		frames->next = first_gif_frames;
+		first_gif_frames = frames;
+	}
+	pthread_mutex_unlock(&gif_frames_mutex);
+
+	if (existing) {
+		gif_frames_destroy(frames);
+		frames = existing;
+	}
+
+	return frames;
+}
+
+static void decode_new_frame(gs_image_file_t *image, int new_frame,
+			     enum gs_image_alpha_mode alpha_mode)
+{
+	struct gif_frames *frames = get_gif_frames(image);
+	const size_t area = (size_t)image->cx * image->cy;
+	uint32_t *data = (uint32_t *)image->animation_frame_data;
+
+	UNUSED_PARAMETER(alpha_mode);
+
+	if (new_frame == image->last_decoded_frame)
+		goto done;
+
+	if (!frames->gif) {
+		int first = image->last_decoded_frame + 1;
+
+		/* if looped, start over from frame 0 */
+		if (new_frame < image->last_decoded_frame) {
+			memset(data, 0, area * sizeof(uint32_t));
+			first = 0;
 		}
 
-		gif_decode_frame(&image->gif, 0);
+		for (int i = first; i <= new_frame; i++)
+			apply_delta(data, frames->frames[i]);
+
+	} else {
+		gif_animation *gif = frames->gif;
+		bool success = true;
 
-		image->cx = (uint32_t)image->gif.width;
-		image->cy = (uint32_t)image->gif.height;
-		image->format = GS_RGBA;
+		pthread_mutex_lock(&frames->gif_mutex);
 
-		if (mem_usage) {
-			*mem_usage += (size_t)4 * image->cx * image->cy;
-			*mem_usage += size;
+		if (new_frame != gif->decoded_frame) {
+			/* if looped, decode frame 0 */
+			int first = new_frame < gif->decoded_frame
+					    ? 0
+					    : gif->decoded_frame + 1;
+
+			/* decode missed frames */
+			for (int i = first; i <= new_frame && success; i++)
+				success = gif_decode_frame(gif, i) == GIF_OK;
 		}
 
-		if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-			gs_premultiply_xyza_srgb_loop(image->gif.frame_image,
-						      (size_t)image->cx *
-							      image->cy);
-		} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-			gs_premultiply_xyza_loop(image->gif.frame_image,
-						 (size_t)image->cx * image->cy);
+		if (success) {
+			memcpy(data, gif->frame_image, area * sizeof(uint32_t));
+			premultiply_frame((uint8_t *)data, area,
+					  frames->alpha_mode);
 		}
-	} else {
-		gif_finalise(&image->gif);
-		bfree(image->gif_data);
-		image->gif_data = NULL;
-		is_animated_gif = false;
-		goto not_animated;
+
+		pthread_mutex_unlock(&frames->gif_mutex);
+
+		if (!success)
+			goto done;
 	}
 
+	image->last_decoded_frame = new_frame;
+
+done:
+	image->cur_frame = new_frame;
+}
+
+static bool init_animated_gif(gs_image_file_t *image, const char *path,
+			      uint64_t *mem_usage,
+			      enum gs_image_alpha_mode alpha_mode)
+{
+	struct gif_frames *frames = gif_frames_acquire(path, alpha_mode);
+	size_t area;
+
+	if (!frames)
+		return false;
+
+	area = (size_t)frames->cx * frames->cy;
+
+	image->animation_frame_cache = (uint8_t **)frames->frames;
+	image->animation_frame_data = bzalloc(area * sizeof(uint32_t));
+	image->last_decoded_frame = -1;
+	image->cx = frames->cx;
+	image->cy = frames->cy;
+	image->format = GS_RGBA;
+	image->is_animated_gif = true;
 	image->loaded = true;
 
-fail:
-	if (!image->loaded)
-		gs_image_file_free(image);
-not_animated:
-	if (file)
-		fclose(file);
+	decode_new_frame(image, 0, alpha_mode);
+
+	if (mem_usage) {
+		*mem_usage += frames->mem_usage;
+		*mem_usage += area * sizeof(uint32_t);
+	}
 
-	return is_animated_gif;
+	return true;
 }
 
 static void gs_image_file_init_internal(gs_image_file_t *image,
@@ -244,8 +587,7 @@ void gs_image_file_free(gs_image_file_t *image)
 
 	if (image->loaded) {
 		if (image->is_animated_gif) {
-			gif_finalise(&image->gif);
-			bfree(image->animation_frame_cache);
+			gif_frames_release(get_gif_frames(image));
 			bfree(image->animation_frame_data);
 		}
 
@@ -291,7 +633,8 @@ void gs_image_file_init_texture(gs_image_file_t *image)
 	if (image->is_animated_gif) {
 		image->texture = gs_texture_create(
 			image->cx, image->cy, image->format, 1,
-			(const uint8_t **)&image->gif.frame_image, GS_DYNAMIC);
+			(const uint8_t **)&image->animation_frame_data,
+			GS_DYNAMIC);
 
 	} else {
 		image->texture = gs_texture_create(
@@ -302,27 +645,20 @@ void gs_image_file_init_texture(gs_image_file_t *image)
 	}
 }
 
-static inline uint64_t get_time(gs_image_file_t *image, int i)
-{
-	uint64_t val = (uint64_t)image->gif.frames[i].frame_delay * 10000000ULL;
-	if (!val)
-		val = 100000000;
-	return val;
-}
-
 static inline int calculate_new_frame(gs_image_file_t *image,
 				      uint64_t elapsed_time_ns, int loops)
 {
+	struct gif_frames *frames = get_gif_frames(image);
 	int new_frame = image->cur_frame;
 
 	image->cur_time += elapsed_time_ns;
 	for (;;) {
-		uint64_t t = get_time(image, new_frame);
+		uint64_t t = frames->delays[new_frame];
 		if (image->cur_time <= t)
 			break;
 
 		image->cur_time -= t;
-		if ((unsigned int)++new_frame == image->gif.frame_count) {
+		if ((unsigned int)++new_frame == frames->frame_count) {
 			if (!loops || ++image->cur_loop < loops) {
 				new_frame = 0;
 			} else if (image->cur_loop == loops) {
@@ -335,49 +671,6 @@ static inline int calculate_new_frame(gs_image_file_t *image,
 	return new_frame;
 }
 
-static void decode_new_frame(gs_image_file_t *image, int new_frame,
-			     enum gs_image_alpha_mode alpha_mode)
-{
-	if (!image->animation_frame_cache[new_frame]) {
-		int last_frame;
-
-		/* if looped, decode frame 0 */
-		last_frame = (new_frame < image->last_decoded_frame)
-				     ? 0
-				     : image->last_decoded_frame + 1;
-
-		/* decode missed frames */
-		for (int i = last_frame; i < new_frame; i++) {
-			if (gif_decode_frame(&image->gif, i) != GIF_OK)
-				return;
-		}
-
-		/* decode actual desired frame */
-		if (gif_decode_frame(&image->gif, new_frame) == GIF_OK) {
-			const size_t area =
-				(size_t)image->gif.width * image->gif.height;
-			size_t pos = new_frame * area * 4;
-			image->animation_frame_cache[new_frame] =
-				image->animation_frame_data + pos;
-
-			if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
-				gs_premultiply_xyza_srgb_loop(
-					image->gif.frame_image, area);
-			} else if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
-				gs_premultiply_xyza_loop(image->gif.frame_image,
-							 area);
-			}
-
-			memcpy(image->animation_frame_cache[new_frame],
-			       image->gif.frame_image, area * 4);
-
-			image->last_decoded_frame = new_frame;
-		}
-	}
-
-	image->cur_frame = new_frame;
-}
-
 static bool gs_image_file_tick_internal(gs_image_file_t *image,
 					uint64_t elapsed_time_ns,
 					enum gs_image_alpha_mode alpha_mode)
@@ -387,7 +680,7 @@ static bool gs_image_file_tick_internal(gs_image_file_t *image,
 	if (!image->is_animated_gif || !image->loaded)
 		return false;
 
-	loops = image->gif.loop_count;
+	loops = get_gif_frames(image)->loop_count;
 	if (loops >= 0xFFFF)
 		loops = 0;
 
@@ -434,12 +727,11 @@ gs_image_file_update_texture_internal(gs_image_file_t *image,
 	if (!image->is_animated_gif || !image->loaded)
 		return;
 
-	if (!image->animation_frame_cache[image->cur_frame])
+	if (image->last_decoded_frame != image->cur_frame)
 		decode_new_frame(image, image->cur_frame, alpha_mode);
 
-	gs_texture_set_image(image->texture,
-			     image->animation_frame_cache[image->cur_frame],
-			     image->gif.width * 4, false);
+	gs_texture_set_image(image->texture, image->animation_frame_data,
+			     image->cx * 4, false);
 }
 
 void gs_image_file_update_texture(gs_image_file_t *image)
@@ -230,6 +230,85 @@ void matrix4_scale_i(struct matrix4 *dst, const struct vec3 *v,
 	matrix4_mul(dst, &temp, m);
 }
 
+/* there is no vector sine/cosine, but most items aren't rotated anyway */
+static inline void get_sin_cos(float rot, float *s, float *c)
+{
+	*s = (rot != 0.0f) ? sinf(rot) : 0.0f;
+	*c = (rot != 0.0f) ? cosf(rot) : 1.0f;
+}
+
+static inline void compose_2d(struct matrix4 *dst,
+			      const struct matrix4_2d_batch *b, size_t i)
+{
+	float s, c;
+	get_sin_cos(b->rot[i], &s, &c);
+
+	vec4_set(&dst->x, b->scale_x[i] * c, b->scale_x[i] * s, 0.0f, 0.0f);
+	vec4_set(&dst->y, -b->scale_y[i] * s, b->scale_y[i] * c, 0.0f, 0.0f);
+	vec4_set(&dst->z, 0.0f, 0.0f, 1.0f, 0.0f);
+	vec4_set(&dst->t, b->pos_x[i] - b->origin_x[i] * c + b->origin_y[i] * s,
+		 b->pos_y[i] - b->origin_x[i] * s - b->origin_y[i] * c, 0.0f,
+		 1.0f);
+}
+
+void matrix4_compose_2d_batch(struct matrix4 *const *dst,
+			      const struct matrix4_2d_batch *b, size_t count)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 t_zw = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	const __m128 z = _mm_set_ps(0.0f, 1.0f, 0.0f, 0.0f);
+	size_t i = 0;
+
+	/* four transforms at a time, each lane composing one transform */
+	for (; i + 4 <= count; i += 4) {
+		float sines[4];
+		float cosines[4];
+
+		for (size_t j = 0; j < 4; j++)
+			get_sin_cos(b->rot[i + j], &sines[j], &cosines[j]);
+
+		__m128 s = _mm_loadu_ps(sines);
+		__m128 c = _mm_loadu_ps(cosines);
+		__m128 sx = _mm_loadu_ps(b->scale_x + i);
+		__m128 sy = _mm_loadu_ps(b->scale_y + i);
+		__m128 ox = _mm_loadu_ps(b->origin_x + i);
+		__m128 oy = _mm_loadu_ps(b->origin_y + i);
+
+		__m128 xx = _mm_mul_ps(sx, c);
+		__m128 xy = _mm_mul_ps(sx, s);
+		__m128 yx = _mm_sub_ps(zero, _mm_mul_ps(sy, s));
+		__m128 yy = _mm_mul_ps(sy, c);
+		__m128 tx = _mm_add_ps(_mm_loadu_ps(b->pos_x + i),
+				       _mm_sub_ps(_mm_mul_ps(oy, s),
+						  _mm_mul_ps(ox, c)));
+		__m128 ty = _mm_sub_ps(_mm_loadu_ps(b->pos_y + i),
+				       _mm_add_ps(_mm_mul_ps(ox, s),
+						  _mm_mul_ps(oy, c)));
+		__m128 tz = zero;
+		__m128 tw = zero;
+
+		/* turns the lanes into one row of {xx, xy, yx, yy} and
+		 * {tx, ty, 0, 0} per transform */
+		_MM_TRANSPOSE4_PS(xx, xy, yx, yy);
+		_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+
+		__m128 rows[4] = {xx, xy, yx, yy};
+		__m128 t_rows[4] = {tx, ty, tz, tw};
+
+		for (size_t j = 0; j < 4; j++) {
+			struct matrix4 *m = dst[i + j];
+
+			m->x.m = _mm_movelh_ps(rows[j], zero);
+			m->y.m = _mm_movehl_ps(zero, rows[j]);
+			m->z.m = z;
+			m->t.m = _mm_add_ps(t_rows[j], t_zw);
+		}
+	}
+
+	for (; i < count; i++)
+		compose_2d(dst[i], b, i);
+}
+
 bool matrix4_inv(struct matrix4 *dst, const struct matrix4 *m)
 {
 	struct vec4 *dstv;
@@ -112,6 +112,27 @@ static inline void matrix4_scale3f(struct matrix4 *dst, const struct matrix4 *m,
 	matrix4_scale(dst, m, &v);
 }
 
+/*
+ * 2D transforms in structure of arrays layout.  Each transform scales, then
+ * translates by -origin, rotates around the z axis by rot radians and finally
+ * translates by pos, the same as the equivalent chain of matrix4_scale3f,
+ * matrix4_translate3f and matrix4_rotate_aa4f calls on an identity matrix.
+ */
+struct matrix4_2d_batch {
+	const float *scale_x;
+	const float *scale_y;
+	const float *origin_x;
+	const float *origin_y;
+	const float *rot;
+	const float *pos_x;
+	const float *pos_y;
+};
+
+/* composes count transforms of batch into the matrices pointed to by dst */
+EXPORT void matrix4_compose_2d_batch(struct matrix4 *const *dst,
+				     const struct matrix4_2d_batch *batch,
+				     size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,197 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Attributes the GPU memory of textures, z-stencil buffers and staging
+ * surfaces to whoever was the current memory owner of the thread that
+ * created them.  Sizes are computed from dimensions and formats, so they do
+ * not include driver alignment or padding, and textures imported from
+ * other processes or APIs are not counted.
+ *
+ *   Records are only touched inside of the graphics context, which is
+ * locked, while owner totals are atomics so they can be read from any
+ * thread.
+ */
+
+#include "../util/bmem.h"
+#include "../util/threading.h"
+#include "../util/uthash.h"
+#include "graphics-internal.h"
+
+struct gs_memory_owner {
+	volatile long refs;
+	volatile int64_t bytes;
+	volatile long objects;
+};
+
+struct gs_memory_record {
+	void *obj;
+	uint64_t bytes;
+	gs_memory_owner_t *owner;
+	UT_hash_handle hh;
+};
+
+static THREAD_LOCAL gs_memory_owner_t *current_owner = NULL;
+static volatile int64_t total_bytes = 0;
+
+gs_memory_owner_t *gs_memory_owner_create(void)
+{
+	gs_memory_owner_t *owner = bzalloc(sizeof(*owner));
+	owner->refs = 1;
+	return owner;
+}
+
+static inline void owner_addref(gs_memory_owner_t *owner)
+{
+	if (owner)
+		os_atomic_inc_long(&owner->refs);
+}
+
+void gs_memory_owner_release(gs_memory_owner_t *owner)
+{
+	if (owner && os_atomic_dec_long(&owner->refs) == 0)
+		bfree(owner);
+}
+
+uint64_t gs_memory_owner_get_bytes(const gs_memory_owner_t *owner)
+{
+	return owner ? (uint64_t)os_atomic_load_int64(&owner->bytes) : 0;
+}
+
+size_t gs_memory_owner_get_objects(const gs_memory_owner_t *owner)
+{
+	return owner ? (size_t)os_atomic_load_long(&owner->objects) : 0;
+}
+
+gs_memory_owner_t *gs_memory_set_owner(gs_memory_owner_t *owner)
+{
+	gs_memory_owner_t *prev = current_owner;
+	current_owner = owner;
+	return prev;
+}
+
+gs_memory_owner_t *gs_memory_get_owner(void)
+{
+	return current_owner;
+}
+
+uint64_t gs_memory_get_total_bytes(void)
+{
+	return (uint64_t)os_atomic_load_int64(&total_bytes);
+}
+
+static void owner_add(gs_memory_owner_t *owner, int64_t bytes, long objects)
+{
+	if (!owner)
+		return;
+
+	os_atomic_add_int64(&owner->bytes, bytes);
+	if (objects > 0)
+		os_atomic_inc_long(&owner->objects);
+	else if (objects < 0)
+		os_atomic_dec_long(&owner->objects);
+}
+
+void gs_memory_track(graphics_t *graphics, void *obj, uint64_t bytes)
+{
+	struct gs_memory_record *record;
+
+	if (!obj)
+		return;
+
+	record = bmalloc(sizeof(*record));
+	record->obj = obj;
+	record->bytes = bytes;
+	record->owner = current_owner;
+	owner_addref(record->owner);
+	owner_add(record->owner, (int64_t)bytes, 1);
+	os_atomic_add_int64(&total_bytes, (int64_t)bytes);
+
+	HASH_ADD(hh, graphics->memory_records, obj, sizeof(void *), record);
+}
+
+static void free_record(graphics_t *graphics, struct gs_memory_record *record)
+{
+	HASH_DEL(graphics->memory_records, record);
+
+	owner_add(record->owner, -(int64_t)record->bytes, -1);
+	os_atomic_add_int64(&total_bytes, -(int64_t)record->bytes);
+	gs_memory_owner_release(record->owner);
+	bfree(record);
+}
+
+void gs_memory_untrack(graphics_t *graphics, void *obj)
+{
+	struct gs_memory_record *record;
+
+	if (!obj)
+		return;
+
+	HASH_FIND(hh, graphics->memory_records, &obj, sizeof(void *), record);
+	if (record)
+		free_record(graphics, record);
+}
+
+void gs_memory_set_object_owner(graphics_t *graphics, void *obj,
+				gs_memory_owner_t *owner)
+{
+	struct gs_memory_record *record;
+
+	if (!obj)
+		return;
+
+	HASH_FIND(hh, graphics->memory_records, &obj, sizeof(void *), record);
+	if (!record || record->owner == owner)
+		return;
+
+	owner_add(record->owner, -(int64_t)record->bytes, -1);
+	gs_memory_owner_release(record->owner);
+
+	record->owner = owner;
+	owner_addref(owner);
+	owner_add(owner, (int64_t)record->bytes, 1);
+}
+
+void gs_memory_free_records(graphics_t *graphics)
+{
+	struct gs_memory_record *record, *tmp;
+
+	HASH_ITER (hh, graphics->memory_records, record, tmp)
+		free_record(graphics, record);
+}
+
+uint64_t gs_memory_texture_size(uint32_t width, uint32_t height,
+				uint32_t depth,
+				enum gs_color_format format,
+				uint32_t levels)
+{
+	uint64_t bpp = gs_get_format_bpp(format);
+	uint64_t bits = 0;
+
+	if (!levels)
+		levels = gs_get_total_levels(width, height, depth);
+
+	for (uint32_t i = 0; i < levels; i++) {
+		bits += (uint64_t)width * height * depth * bpp;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		depth = depth > 1 ? depth / 2 : 1;
+	}
+
+	return bits / 8;
+}
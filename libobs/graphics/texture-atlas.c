@@ -0,0 +1,244 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Packs small static textures into shared pages so that many of them can
+ * live in a handful of larger textures.  Pages are split into horizontal
+ * shelves; a region is placed on the best fitting shelf, and a shelf is
+ * reclaimed once all of its regions have been freed.
+ */
+
+#include "../util/darray.h"
+#include "graphics.h"
+
+/* one texel of the region's edge is repeated around it so that linear
+ * sampling at the border never picks up a neighbour */
+#define ATLAS_PADDING 1
+
+struct atlas_shelf {
+	uint32_t y;
+	uint32_t height;
+	uint32_t x;
+	uint32_t regions;
+};
+
+struct atlas_page {
+	gs_texture_t *texture;
+	enum gs_color_format format;
+	DARRAY(struct atlas_shelf) shelves;
+	uint32_t height;
+	uint32_t regions;
+};
+
+struct gs_texture_atlas {
+	uint32_t page_size;
+	DARRAY(struct atlas_page *) pages;
+};
+
+gs_texture_atlas_t *gs_texture_atlas_create(uint32_t page_size)
+{
+	struct gs_texture_atlas *atlas;
+	atlas = bzalloc(sizeof(struct gs_texture_atlas));
+	atlas->page_size = page_size;
+
+	return atlas;
+}
+
+static void atlas_page_destroy(struct atlas_page *page)
+{
+	gs_texture_destroy(page->texture);
+	da_free(page->shelves);
+	bfree(page);
+}
+
+void gs_texture_atlas_destroy(gs_texture_atlas_t *atlas)
+{
+	if (atlas) {
+		for (size_t i = 0; i < atlas->pages.num; i++)
+			atlas_page_destroy(atlas->pages.array[i]);
+		da_free(atlas->pages);
+		bfree(atlas);
+	}
+}
+
+static struct atlas_shelf *page_find_shelf(gs_texture_atlas_t *atlas,
+					   struct atlas_page *page,
+					   uint32_t cx, uint32_t cy)
+{
+	struct atlas_shelf *best = NULL;
+
+	for (size_t i = 0; i < page->shelves.num; i++) {
+		struct atlas_shelf *shelf = page->shelves.array + i;
+
+		if (shelf->height < cy || atlas->page_size - shelf->x < cx)
+			continue;
+		if (!best || shelf->height < best->height)
+			best = shelf;
+	}
+
+	/* avoid wasting a tall shelf on a short region if there is still
+	 * room for a shelf of its own */
+	if (best && best->height <= cy * 2)
+		return best;
+	if (atlas->page_size - page->height >= cy) {
+		struct atlas_shelf *shelf = da_push_back_new(page->shelves);
+		shelf->y = page->height;
+		shelf->height = cy;
+		page->height += cy;
+		return shelf;
+	}
+
+	return best;
+}
+
+static struct atlas_page *atlas_add_page(gs_texture_atlas_t *atlas,
+					 enum gs_color_format format)
+{
+	gs_texture_t *tex = gs_texture_create(atlas->page_size,
+					      atlas->page_size, format, 1,
+					      NULL, 0);
+	if (!tex)
+		return NULL;
+
+	struct atlas_page *page = bzalloc(sizeof(struct atlas_page));
+	page->texture = tex;
+	page->format = format;
+	da_push_back(atlas->pages, &page);
+	return page;
+}
+
+static void copy_padded(gs_texture_t *dst, uint32_t x, uint32_t y,
+			gs_texture_t *src, uint32_t cx, uint32_t cy)
+{
+	const uint32_t p = ATLAS_PADDING;
+	const uint32_t r = cx - 1;
+	const uint32_t b = cy - 1;
+
+	gs_copy_texture_region(dst, x + p, y + p, src, 0, 0, cx, cy);
+
+	/* edges */
+	gs_copy_texture_region(dst, x, y + p, src, 0, 0, 1, cy);
+	gs_copy_texture_region(dst, x + p + cx, y + p, src, r, 0, 1, cy);
+	gs_copy_texture_region(dst, x + p, y, src, 0, 0, cx, 1);
+	gs_copy_texture_region(dst, x + p, y + p + cy, src, 0, b, cx, 1);
+
+	/* corners */
+	gs_copy_texture_region(dst, x, y, src, 0, 0, 1, 1);
+	gs_copy_texture_region(dst, x + p + cx, y, src, r, 0, 1, 1);
+	gs_copy_texture_region(dst, x, y + p + cy, src, 0, b, 1, 1);
+	gs_copy_texture_region(dst, x + p + cx, y + p + cy, src, r, b, 1, 1);
+}
+
+bool gs_texture_atlas_alloc(gs_texture_atlas_t *atlas, gs_texture_t *src,
+			    struct gs_atlas_region *region)
+{
+	struct atlas_shelf *shelf = NULL;
+	struct atlas_page *page = NULL;
+	enum gs_color_format format;
+	uint32_t cx, cy, padded_cx, padded_cy;
+
+	if (!atlas || !src || !region)
+		return false;
+
+	format = gs_texture_get_color_format(src);
+	cx = gs_texture_get_width(src);
+	cy = gs_texture_get_height(src);
+	padded_cx = cx + ATLAS_PADDING * 2;
+	padded_cy = cy + ATLAS_PADDING * 2;
+
+	if (!cx || !cy || gs_is_compressed_format(format))
+		return false;
+	if (padded_cx > atlas->page_size || padded_cy > atlas->page_size)
+		return false;
+
+	for (size_t i = 0; i < atlas->pages.num; i++) {
+		page = atlas->pages.array[i];
+		if (page->format != format)
+			continue;
+
+		shelf = page_find_shelf(atlas, page, padded_cx, padded_cy);
+		if (shelf)
+			break;
+	}
+
+	if (!shelf) {
+		page = atlas_add_page(atlas, format);
+		if (!page)
+			return false;
+		shelf = page_find_shelf(atlas, page, padded_cx, padded_cy);
+	}
+
+	copy_padded(page->texture, shelf->x, shelf->y, src, cx, cy);
+
+	region->texture = page->texture;
+	region->x = shelf->x + ATLAS_PADDING;
+	region->y = shelf->y + ATLAS_PADDING;
+	region->cx = cx;
+	region->cy = cy;
+
+	shelf->x += padded_cx;
+	shelf->regions++;
+	page->regions++;
+	return true;
+}
+
+static void page_trim_shelves(struct atlas_page *page)
+{
+	while (page->shelves.num) {
+		struct atlas_shelf *last = da_end(page->shelves);
+		if (last->regions)
+			break;
+
+		page->height = last->y;
+		da_pop_back(page->shelves);
+	}
+}
+
+void gs_texture_atlas_free(gs_texture_atlas_t *atlas,
+			   const struct gs_atlas_region *region)
+{
+	if (!atlas || !region || !region->texture)
+		return;
+
+	for (size_t i = 0; i < atlas->pages.num; i++) {
+		struct atlas_page *page = atlas->pages.array[i];
+		if (page->texture != region->texture)
+			continue;
+
+		for (size_t j = 0; j < page->shelves.num; j++) {
+			struct atlas_shelf *shelf = page->shelves.array + j;
+			uint32_t y = region->y - ATLAS_PADDING;
+
+			if (y < shelf->y || y >= shelf->y + shelf->height)
+				continue;
+
+			/* regions within a shelf are not reused on their
+			 * own, the whole shelf is once it is empty */
+			if (--shelf->regions == 0)
+				shelf->x = 0;
+			break;
+		}
+
+		page_trim_shelves(page);
+
+		if (--page->regions == 0) {
+			atlas_page_destroy(page);
+			da_erase(atlas->pages, i);
+		}
+		return;
+	}
+}
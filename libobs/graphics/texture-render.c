@@ -21,7 +21,10 @@
  */
 
 #include <assert.h>
-#include "graphics.h"
+#include "graphics-internal.h"
+
+/* pooled render targets that go unleased this many frames are freed */
+#define TEXRENDER_POOL_IDLE_FRAMES 60
 
 struct gs_texture_render {
 	gs_texture_t *target, *prev_target;
@@ -34,6 +37,8 @@ struct gs_texture_render {
 	enum gs_zstencil_format zsformat;
 
 	bool rendered;
+	bool transient;
+	bool leased;
 };
 
 gs_texrender_t *gs_texrender_create(enum gs_color_format format,
@@ -47,9 +52,60 @@ gs_texrender_t *gs_texrender_create(enum gs_color_format format,
 	return texrender;
 }
 
+gs_texrender_t *
+gs_texrender_create_transient(enum gs_color_format format,
+			      enum gs_zstencil_format zsformat)
+{
+	gs_texrender_t *texrender = gs_texrender_create(format, zsformat);
+	texrender->transient = true;
+
+	return texrender;
+}
+
+static void texrender_pool_return(graphics_t *graphics,
+				  gs_texrender_t *texrender)
+{
+	struct gs_texrender_target *target;
+
+	target = da_push_back_new(graphics->texrender_pool);
+	target->tex = texrender->target;
+	target->zs = texrender->zs;
+	target->cx = texrender->cx;
+	target->cy = texrender->cy;
+	target->format = texrender->format;
+	target->zsformat = texrender->zsformat;
+	target->last_frame = graphics->frame_count;
+
+	/* pooled targets belong to nobody until they are leased again */
+	gs_memory_set_object_owner(graphics, target->tex, NULL);
+	gs_memory_set_object_owner(graphics, target->zs, NULL);
+
+	texrender->target = NULL;
+	texrender->zs = NULL;
+	texrender->cx = 0;
+	texrender->cy = 0;
+	texrender->leased = false;
+
+	/* the contents are gone, so the next begin has to render again */
+	texrender->rendered = false;
+}
+
+static void texrender_release(graphics_t *graphics, gs_texrender_t *texrender)
+{
+	if (!texrender->leased)
+		return;
+
+	da_erase_item(graphics->texrender_leases, &texrender);
+	texrender_pool_return(graphics, texrender);
+}
+
 void gs_texrender_destroy(gs_texrender_t *texrender)
 {
 	if (texrender) {
+		graphics_t *graphics = gs_get_context();
+		if (texrender->leased && graphics)
+			texrender_release(graphics, texrender);
+
 		gs_texture_destroy(texrender->target);
 		gs_zstencil_destroy(texrender->zs);
 		bfree(texrender);
@@ -88,6 +144,84 @@ static bool texrender_resetbuffer(gs_texrender_t *texrender, uint32_t cx,
 	return true;
 }
 
+static bool texrender_lease(gs_texrender_t *texrender, uint32_t cx,
+			    uint32_t cy)
+{
+	graphics_t *graphics = gs_get_context();
+	if (!graphics)
+		return false;
+
+	texrender_release(graphics, texrender);
+
+	for (size_t i = 0; i < graphics->texrender_pool.num; i++) {
+		struct gs_texrender_target *target =
+			graphics->texrender_pool.array + i;
+
+		if (target->cx == cx && target->cy == cy &&
+		    target->format == texrender->format &&
+		    target->zsformat == texrender->zsformat) {
+			texrender->target = target->tex;
+			texrender->zs = target->zs;
+			texrender->cx = cx;
+			texrender->cy = cy;
+			da_erase(graphics->texrender_pool, i);
+
+			gs_memory_owner_t *owner = gs_memory_get_owner();
+			gs_memory_set_object_owner(graphics, texrender->target,
+						   owner);
+			gs_memory_set_object_owner(graphics, texrender->zs,
+						   owner);
+			goto leased;
+		}
+	}
+
+	if (!texrender_resetbuffer(texrender, cx, cy))
+		return false;
+
+leased:
+	texrender->leased = true;
+	da_push_back(graphics->texrender_leases, &texrender);
+	return true;
+}
+
+void gs_texrender_pool_begin_frame(graphics_t *graphics)
+{
+	graphics->frame_count++;
+
+	for (size_t i = 0; i < graphics->texrender_leases.num; i++)
+		texrender_pool_return(graphics,
+				      graphics->texrender_leases.array[i]);
+	da_resize(graphics->texrender_leases, 0);
+
+	for (size_t i = graphics->texrender_pool.num; i > 0; i--) {
+		struct gs_texrender_target *target =
+			graphics->texrender_pool.array + (i - 1);
+
+		if (graphics->frame_count - target->last_frame <
+		    TEXRENDER_POOL_IDLE_FRAMES)
+			continue;
+
+		gs_texture_destroy(target->tex);
+		gs_zstencil_destroy(target->zs);
+		da_erase(graphics->texrender_pool, i - 1);
+	}
+}
+
+void gs_texrender_pool_free(graphics_t *graphics)
+{
+	for (size_t i = 0; i < graphics->texrender_leases.num; i++)
+		texrender_pool_return(graphics,
+				      graphics->texrender_leases.array[i]);
+
+	for (size_t i = 0; i < graphics->texrender_pool.num; i++) {
+		gs_texture_destroy(graphics->texrender_pool.array[i].tex);
+		gs_zstencil_destroy(graphics->texrender_pool.array[i].zs);
+	}
+
+	da_free(graphics->texrender_leases);
+	da_free(graphics->texrender_pool);
+}
+
 bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
 {
 	return gs_texrender_begin_with_color_space(texrender, cx, cy,
@@ -103,9 +237,15 @@ bool gs_texrender_begin_with_color_space(gs_texrender_t *texrender, uint32_t cx,
 	if (!cx || !cy)
 		return false;
 
-	if (texrender->cx != cx || texrender->cy != cy)
+	if (texrender->transient) {
+		if (!texrender->leased || texrender->cx != cx ||
+		    texrender->cy != cy)
+			if (!texrender_lease(texrender, cx, cy))
+				return false;
+	} else if (texrender->cx != cx || texrender->cy != cy) {
 		if (!texrender_resetbuffer(texrender, cx, cy))
 			return false;
+	}
 
 	if (!texrender->target)
 		return false;
@@ -25,6 +25,8 @@
 #include "../util/profiler.h"
 #include "../util/util_uint64.h"
 
+#include "audio-math.h"
+
 #include "audio-io.h"
 #include "audio-resampler.h"
 
@@ -43,25 +45,54 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 		int invalid = 0; \
 	} while (0)
 
-struct audio_input {
+/* inputs of a mix that ask for the same conversion share one resampler, so
+ * several encoders wanting 44.1 kHz from a 48 kHz mix only resample once */
+struct audio_shared_resampler {
 	struct audio_convert_info conversion;
 	audio_resampler_t *resampler;
+	long refs;
+
+	/* output of the current tick */
+	bool success;
+	struct audio_data data;
+};
+
+struct audio_input {
+	struct audio_convert_info conversion;
+	struct audio_shared_resampler *resampler;
 
 	audio_output_callback_t callback;
 	void *param;
 };
 
-static inline void audio_input_free(struct audio_input *input)
-{
-	audio_resampler_destroy(input->resampler);
-}
-
 struct audio_mix {
 	DARRAY(struct audio_input) inputs;
+	DARRAY(struct audio_shared_resampler *) resamplers;
 	float buffer[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 	float buffer_unclamped[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 };
 
+static inline bool conversions_match(const struct audio_convert_info *a,
+				     const struct audio_convert_info *b)
+{
+	return a->format == b->format &&
+	       a->samples_per_sec == b->samples_per_sec &&
+	       a->speakers == b->speakers &&
+	       a->allow_clipping == b->allow_clipping;
+}
+
+static void audio_input_free(struct audio_mix *mix, struct audio_input *input)
+{
+	struct audio_shared_resampler *shared = input->resampler;
+
+	if (!shared || --shared->refs > 0)
+		return;
+
+	da_erase_item(mix->resamplers, &shared);
+	audio_resampler_destroy(shared->resampler);
+	bfree(shared);
+}
+
 struct audio_output {
 	struct audio_output_info info;
 	size_t block_size;
@@ -70,8 +101,10 @@ struct audio_output {
 
 	pthread_t thread;
 	os_event_t *stop_event;
+	struct os_thread_scheduling sched;
 
 	bool initialized;
+	bool catch_up;
 
 	audio_input_callback_t input_cb;
 	void *input_param;
@@ -81,29 +114,45 @@ struct audio_output {
 
 /* ------------------------------------------------------------------------- */
 
-static bool resample_audio_output(struct audio_input *input,
-				  struct audio_data *data)
+static inline void get_mix_data(struct audio_output *audio,
+				struct audio_mix *mix, bool allow_clipping,
+				struct audio_data *data, uint64_t timestamp,
+				uint32_t frames)
 {
-	bool success = true;
+	float(*buf)[AUDIO_OUTPUT_FRAMES] =
+		allow_clipping ? mix->buffer_unclamped : mix->buffer;
 
-	if (input->resampler) {
-		uint8_t *output[MAX_AV_PLANES];
-		uint32_t frames;
-		uint64_t offset;
+	memset(data->data, 0, sizeof(data->data));
+	for (size_t i = 0; i < audio->planes; i++)
+		data->data[i] = (uint8_t *)buf[i];
 
-		memset(output, 0, sizeof(output));
+	data->frames = frames;
+	data->timestamp = timestamp;
+}
 
-		success = audio_resampler_resample(
-			input->resampler, output, &frames, &offset,
-			(const uint8_t *const *)data->data, data->frames);
+static void resample_audio_output(struct audio_output *audio,
+				  struct audio_mix *mix,
+				  struct audio_shared_resampler *shared,
+				  uint64_t timestamp, uint32_t frames)
+{
+	struct audio_data *data = &shared->data;
+	uint8_t *output[MAX_AV_PLANES];
+	uint32_t out_frames;
+	uint64_t offset;
 
-		for (size_t i = 0; i < MAX_AV_PLANES; i++)
-			data->data[i] = output[i];
-		data->frames = frames;
-		data->timestamp -= offset;
-	}
+	get_mix_data(audio, mix, shared->conversion.allow_clipping, data,
+		     timestamp, frames);
 
-	return success;
+	memset(output, 0, sizeof(output));
+
+	shared->success = audio_resampler_resample(
+		shared->resampler, output, &out_frames, &offset,
+		(const uint8_t *const *)data->data, data->frames);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		data->data[i] = output[i];
+	data->frames = out_frames;
+	data->timestamp -= offset;
 }
 
 static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
@@ -114,20 +163,28 @@ static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
 
 	pthread_mutex_lock(&audio->input_mutex);
 
+	for (size_t i = 0; i < mix->resamplers.num; i++)
+		resample_audio_output(audio, mix, mix->resamplers.array[i],
+				      timestamp, frames);
+
 	for (size_t i = mix->inputs.num; i > 0; i--) {
 		struct audio_input *input = mix->inputs.array + (i - 1);
+		struct audio_shared_resampler *shared = input->resampler;
 
-		float(*buf)[AUDIO_OUTPUT_FRAMES] =
-			input->conversion.allow_clipping ? mix->buffer_unclamped
-							 : mix->buffer;
-		for (size_t i = 0; i < audio->planes; i++)
-			data.data[i] = (uint8_t *)buf[i];
+		if (shared) {
+			if (!shared->success)
+				continue;
 
-		data.frames = frames;
-		data.timestamp = timestamp;
+			/* each callback gets its own copy so none of them
+			 * can change what the next one sees */
+			data = shared->data;
+		} else {
+			get_mix_data(audio, mix,
+				     input->conversion.allow_clipping, &data,
+				     timestamp, frames);
+		}
 
-		if (resample_audio_output(input, &data))
-			input->callback(input->param, mix_idx, &data);
+		input->callback(input->param, mix_idx, &data);
 	}
 
 	pthread_mutex_unlock(&audio->input_mutex);
@@ -146,17 +203,10 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 
 		for (size_t plane = 0; plane < audio->planes; plane++) {
 			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
 			/* Unclamped mix is copied directly. */
 			memcpy(mix->buffer_unclamped[plane], mix_data, bytes);
 
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val == val) ? val : 0.0f;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
+			audio_clamp(mix_data, float_size);
 		}
 	}
 }
@@ -209,6 +259,29 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
 }
 
+static inline uint64_t audio_clock(struct audio_output *audio)
+{
+	return audio->info.clock_callback
+		       ? audio->info.clock_callback(audio->input_param)
+		       : os_gettime_ns();
+}
+
+/* returns false if the output is closing */
+static bool audio_sleepto(struct audio_output *audio, uint64_t ts)
+{
+	if (!audio->info.sleepto_callback) {
+		os_sleepto_ns_fast(ts);
+		return true;
+	}
+
+	while (!audio->info.sleepto_callback(audio->input_param, ts)) {
+		if (os_event_try(audio->stop_event) != EAGAIN)
+			return false;
+	}
+
+	return true;
+}
+
 static void *audio_thread(void *param)
 {
 #ifdef _WIN32
@@ -219,10 +292,14 @@ static void *audio_thread(void *param)
 	struct audio_output *audio = param;
 	size_t rate = audio->info.samples_per_sec;
 	uint64_t samples = 0;
-	uint64_t start_time = os_gettime_ns();
+	uint64_t start_time = audio_clock(audio);
 	uint64_t prev_time = start_time;
+	uint64_t late_total = 0;
+	uint64_t late_max = 0;
+	long sched_serial = 0;
 
 	os_set_thread_name("audio-io: audio thread");
+	bmem_set_thread_tag(BMEM_TAG_AUDIO);
 
 	const char *audio_thread_name =
 		profile_store_name(obs_get_profiler_name_store(),
@@ -233,18 +310,42 @@ static void *audio_thread(void *param)
 		uint64_t audio_time =
 			start_time + audio_frames_to_ns(rate, samples);
 
-		os_sleepto_ns_fast(audio_time);
+		if (!audio_sleepto(audio, audio_time))
+			break;
+
+		uint64_t late = audio_clock(audio) - audio_time;
+		late_total += late;
+		if (late > late_max)
+			late_max = late;
+
+		if (!os_thread_scheduling_update(&audio->sched, &sched_serial))
+			blog(LOG_WARNING, "Could not apply audio thread "
+					  "scheduling");
 
 		profile_start(audio_thread_name);
 
 		input_and_output(audio, audio_time, prev_time);
 		prev_time = audio_time;
 
+		while (audio->catch_up) {
+			audio->catch_up = false;
+			input_and_output(audio, audio_time, audio_time);
+		}
+
 		profile_end(audio_thread_name);
 
 		profile_reenable_thread();
 	}
 
+	if (samples) {
+		uint64_t ticks = samples / AUDIO_OUTPUT_FRAMES;
+		blog(LOG_INFO,
+		     "audio thread scheduling latency: avg %.3f ms, "
+		     "max %.3f ms",
+		     (double)(late_total / ticks) / 1000000.0,
+		     (double)late_max / 1000000.0);
+	}
+
 #ifdef _WIN32
 	if (handle)
 		AvRevertMmThreadCharacteristics(handle);
@@ -271,31 +372,52 @@ static size_t audio_get_input_idx(const audio_t *audio, size_t mix_idx,
 }
 
 static inline bool audio_input_init(struct audio_input *input,
-				    struct audio_output *audio)
+				    struct audio_output *audio,
+				    struct audio_mix *mix)
 {
-	if (input->conversion.format != audio->info.format ||
-	    input->conversion.samples_per_sec != audio->info.samples_per_sec ||
-	    input->conversion.speakers != audio->info.speakers) {
-		struct resample_info from = {
-			.format = audio->info.format,
-			.samples_per_sec = audio->info.samples_per_sec,
-			.speakers = audio->info.speakers};
-
-		struct resample_info to = {
-			.format = input->conversion.format,
-			.samples_per_sec = input->conversion.samples_per_sec,
-			.speakers = input->conversion.speakers};
-
-		input->resampler = audio_resampler_create(&to, &from);
-		if (!input->resampler) {
-			blog(LOG_ERROR, "audio_input_init: Failed to "
-					"create resampler");
-			return false;
+	input->resampler = NULL;
+
+	if (input->conversion.format == audio->info.format &&
+	    input->conversion.samples_per_sec == audio->info.samples_per_sec &&
+	    input->conversion.speakers == audio->info.speakers)
+		return true;
+
+	for (size_t i = 0; i < mix->resamplers.num; i++) {
+		struct audio_shared_resampler *shared =
+			mix->resamplers.array[i];
+
+		if (conversions_match(&shared->conversion,
+				      &input->conversion)) {
+			shared->refs++;
+			input->resampler = shared;
+			return true;
 		}
-	} else {
-		input->resampler = NULL;
 	}
 
+	struct resample_info from = {
+		.format = audio->info.format,
+		.samples_per_sec = audio->info.samples_per_sec,
+		.speakers = audio->info.speakers};
+
+	struct resample_info to = {
+		.format = input->conversion.format,
+		.samples_per_sec = input->conversion.samples_per_sec,
+		.speakers = input->conversion.speakers};
+
+	audio_resampler_t *resampler = audio_resampler_create(&to, &from);
+	if (!resampler) {
+		blog(LOG_ERROR, "audio_input_init: Failed to "
+				"create resampler");
+		return false;
+	}
+
+	struct audio_shared_resampler *shared = bzalloc(sizeof(*shared));
+	shared->conversion = input->conversion;
+	shared->resampler = resampler;
+	shared->refs = 1;
+	da_push_back(mix->resamplers, &shared);
+
+	input->resampler = shared;
 	return true;
 }
 
@@ -323,6 +445,7 @@ bool audio_output_connect(audio_t *audio, size_t mi,
 			input.conversion.speakers = audio->info.speakers;
 			input.conversion.samples_per_sec =
 				audio->info.samples_per_sec;
+			input.conversion.allow_clipping = false;
 		}
 
 		if (input.conversion.format == AUDIO_FORMAT_UNKNOWN)
@@ -333,7 +456,7 @@ bool audio_output_connect(audio_t *audio, size_t mi,
 			input.conversion.samples_per_sec =
 				audio->info.samples_per_sec;
 
-		success = audio_input_init(&input, audio);
+		success = audio_input_init(&input, audio, mix);
 		if (success)
 			da_push_back(mix->inputs, &input);
 	}
@@ -354,7 +477,7 @@ void audio_output_disconnect(audio_t *audio, size_t mix_idx,
 	size_t idx = audio_get_input_idx(audio, mix_idx, callback, param);
 	if (idx != DARRAY_INVALID) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
-		audio_input_free(mix->inputs.array + idx);
+		audio_input_free(mix, mix->inputs.array + idx);
 		da_erase(mix->inputs, idx);
 	}
 
@@ -407,6 +530,20 @@ fail0:
 	return AUDIO_OUTPUT_FAIL;
 }
 
+void audio_output_set_thread_scheduling(audio_t *audio,
+					enum os_thread_priority priority,
+					uint64_t affinity)
+{
+	if (audio)
+		os_thread_scheduling_set(&audio->sched, priority, affinity);
+}
+
+void audio_output_catch_up(audio_t *audio)
+{
+	if (audio)
+		audio->catch_up = true;
+}
+
 void audio_output_close(audio_t *audio)
 {
 	void *thread_ret;
@@ -425,9 +562,10 @@ void audio_output_close(audio_t *audio)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		for (size_t i = 0; i < mix->inputs.num; i++)
-			audio_input_free(mix->inputs.array + i);
+			audio_input_free(mix, mix->inputs.array + i);
 
 		da_free(mix->inputs);
+		da_free(mix->resamplers);
 	}
 	bfree(audio);
 }
@@ -19,6 +19,7 @@
 
 #include "media-io-defs.h"
 #include "../util/c99defs.h"
+#include "../util/threading.h"
 #include "../util/util_uint64.h"
 
 #ifdef __cplusplus
@@ -86,6 +87,8 @@ struct audio_output_data {
 	float *data[MAX_AUDIO_CHANNELS];
 };
 
+/* start_ts and end_ts are equal when the callback is called again right away
+ * after asking for it with audio_output_catch_up */
 typedef bool (*audio_input_callback_t)(void *param, uint64_t start_ts,
 				       uint64_t end_ts, uint64_t *new_ts,
 				       uint32_t active_mixers,
@@ -100,6 +103,13 @@ struct audio_output_info {
 
 	audio_input_callback_t input_callback;
 	void *input_param;
+
+	/* optional clock to run the audio thread on instead of the system
+	 * clock, both get input_param.  sleepto_callback may give up early
+	 * and return false, it's called again until the clock gets there or
+	 * the output closes */
+	uint64_t (*clock_callback)(void *param);
+	bool (*sleepto_callback)(void *param, uint64_t ts);
 };
 
 struct audio_convert_info {
@@ -220,6 +230,11 @@ static inline uint64_t ns_to_audio_frames(size_t sample_rate, uint64_t frames)
 EXPORT int audio_output_open(audio_t **audio, struct audio_output_info *info);
 EXPORT void audio_output_close(audio_t *audio);
 
+/* applied by the audio thread on its next iteration */
+EXPORT void audio_output_set_thread_scheduling(audio_t *audio,
+					       enum os_thread_priority priority,
+					       uint64_t affinity);
+
 typedef void (*audio_output_callback_t)(void *param, size_t mix_idx,
 					struct audio_data *data);
 
@@ -232,6 +247,10 @@ EXPORT void audio_output_disconnect(audio_t *video, size_t mix_idx,
 
 EXPORT bool audio_output_active(const audio_t *audio);
 
+/* from the input callback: calls it once more right after the current tick,
+ * so that one tick more than time allows is output */
+EXPORT void audio_output_catch_up(audio_t *audio);
+
 EXPORT size_t audio_output_get_block_size(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
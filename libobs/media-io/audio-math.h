@@ -18,7 +18,9 @@
 #pragma once
 
 #include "../util/c99defs.h"
+#include "../util/sse-intrin.h"
 #include <math.h>
+#include <string.h>
 
 #ifdef _MSC_VER
 #include <float.h>
@@ -41,3 +43,312 @@ static inline float db_to_mul(const float db)
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
+
+/* Vectorized helpers for the float planar mixing loops.  SSE2 is part of the
+ * baseline on x86_64, and SIMDe maps the same intrinsics to NEON elsewhere,
+ * so results match the scalar loops bit for bit. */
+
+/* out[i] += in[i] */
+static inline void audio_mix_add(float *out, const float *in, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 v = _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(in + i));
+		_mm_storeu_ps(out + i, v);
+	}
+
+	for (; i < count; i++)
+		out[i] += in[i];
+}
+
+/* out[i] += in[i] * vol[i] */
+static inline void audio_mix_add_mul(float *out, const float *in,
+				     const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(in + i),
+				      _mm_loadu_ps(vol + i));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), v));
+	}
+
+	for (; i < count; i++)
+		out[i] += in[i] * vol[i];
+}
+
+/* buf[i] *= vol */
+static inline void audio_mul(float *buf, float vol, size_t count)
+{
+	const __m128 v_vol = _mm_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), v_vol));
+
+	for (; i < count; i++)
+		buf[i] *= vol;
+}
+
+/* buf[i] *= vol[i] */
+static inline void audio_mul_ramp(float *buf, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(buf + i),
+				      _mm_loadu_ps(vol + i));
+		_mm_storeu_ps(buf + i, v);
+	}
+
+	for (; i < count; i++)
+		buf[i] *= vol[i];
+}
+
+/* replaces NaN with 0 and clamps to -1.0..1.0 */
+static inline void audio_clamp(float *buf, size_t count)
+{
+	const __m128 v_min = _mm_set1_ps(-1.0f);
+	const __m128 v_max = _mm_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 v = _mm_loadu_ps(buf + i);
+		v = _mm_and_ps(v, _mm_cmpord_ps(v, v));
+		v = _mm_max_ps(_mm_min_ps(v, v_max), v_min);
+		_mm_storeu_ps(buf + i, v);
+	}
+
+	for (; i < count; i++) {
+		float val = buf[i];
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		buf[i] = val;
+	}
+}
+
+/* Fast approximations of log2/exp2 for the dynamics filters.  The log2
+ * polynomial is accurate to about 6e-5 (0.0004 dB), exp2 to about 1e-7
+ * relative.  log2 returns -INFINITY for x <= 0 and exp2 returns 0 for
+ * x < -126 so silence still maps to -inf dB and back like the exact
+ * functions. */
+static inline __m128 audio_fast_log2_ps(__m128 x)
+{
+	const __m128i mant_mask = _mm_set1_epi32(0x007fffff);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 neg_inf =
+		_mm_castsi128_ps(_mm_set1_epi32((int)0xff800000));
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23),
+				  _mm_set1_epi32(127));
+	__m128 m = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, mant_mask)),
+			     one);
+	__m128 t = _mm_sub_ps(m, one);
+
+	/* log2(1 + t) ~= t * p(t) for t in [0, 1) */
+	__m128 p = _mm_set1_ps(0.05994558642f);
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.22771264237f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.44227417801f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.71706393172f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.44261568317f));
+	p = _mm_mul_ps(p, t);
+
+	__m128 result = _mm_add_ps(_mm_cvtepi32_ps(e), p);
+	__m128 silent = _mm_cmple_ps(x, _mm_setzero_ps());
+	return _mm_or_ps(_mm_andnot_ps(silent, result),
+			 _mm_and_ps(silent, neg_inf));
+}
+
+static inline __m128 audio_fast_exp2_ps(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 silent = _mm_cmplt_ps(x, _mm_set1_ps(-126.0f));
+
+	x = _mm_min_ps(x, _mm_set1_ps(127.0f));
+	x = _mm_max_ps(x, _mm_set1_ps(-126.0f));
+
+	/* floor, SSE2 only truncates towards zero */
+	__m128 fl = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	fl = _mm_sub_ps(fl, _mm_and_ps(_mm_cmpgt_ps(fl, x), one));
+	__m128 f = _mm_sub_ps(x, fl);
+
+	/* 2^f for f in [0, 1) */
+	__m128 p = _mm_set1_ps(0.00189510746f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.00894621425f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.05586328300f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.24014076998f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.69315462002f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.99999989576f));
+
+	__m128i e = _mm_add_epi32(_mm_cvttps_epi32(fl), _mm_set1_epi32(127));
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+	return _mm_andnot_ps(silent, _mm_mul_ps(p, scale));
+}
+
+#define AUDIO_DB_PER_LOG2 6.02059991328f /* 20 * log10(2) */
+#define AUDIO_LOG2_PER_DB 0.16609640474f /* log2(10) / 20 */
+
+static inline __m128 audio_fast_mul_to_db_ps(__m128 mul)
+{
+	return _mm_mul_ps(audio_fast_log2_ps(mul),
+			  _mm_set1_ps(AUDIO_DB_PER_LOG2));
+}
+
+static inline __m128 audio_fast_db_to_mul_ps(__m128 db)
+{
+	return audio_fast_exp2_ps(
+		_mm_mul_ps(db, _mm_set1_ps(AUDIO_LOG2_PER_DB)));
+}
+
+/* buf[i] = mul_to_db(buf[i]), approximated */
+static inline void audio_mul_to_db(float *buf, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(buf + i,
+			      audio_fast_mul_to_db_ps(_mm_loadu_ps(buf + i)));
+
+	if (i < count) {
+		float tail[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+		memcpy(tail, buf + i, (count - i) * sizeof(float));
+		_mm_storeu_ps(tail,
+			      audio_fast_mul_to_db_ps(_mm_loadu_ps(tail)));
+		memcpy(buf + i, tail, (count - i) * sizeof(float));
+	}
+}
+
+static inline __m128 audio_db_to_gain_ps(__m128 db, __m128 max_db, __m128 mul)
+{
+	return _mm_mul_ps(audio_fast_db_to_mul_ps(_mm_min_ps(db, max_db)),
+			  mul);
+}
+
+/* gain[i] = db_to_mul(fminf(max_db, db[i])) * mul, approximated.  gain may
+ * be the same buffer as db */
+static inline void audio_db_to_gain(float *gain, const float *db,
+				    float max_db, float mul, size_t count)
+{
+	const __m128 v_max = _mm_set1_ps(max_db);
+	const __m128 v_mul = _mm_set1_ps(mul);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(gain + i,
+			      audio_db_to_gain_ps(_mm_loadu_ps(db + i), v_max,
+						  v_mul));
+
+	if (i < count) {
+		float tail[4] = {0};
+		memcpy(tail, db + i, (count - i) * sizeof(float));
+		_mm_storeu_ps(tail, audio_db_to_gain_ps(_mm_loadu_ps(tail),
+							v_max, v_mul));
+		memcpy(gain + i, tail, (count - i) * sizeof(float));
+	}
+}
+
+static inline __m128 audio_compressor_gain_ps(__m128 env, __m128 threshold,
+					      __m128 slope, __m128 mul)
+{
+	__m128 db = _mm_sub_ps(threshold, audio_fast_mul_to_db_ps(env));
+	return audio_db_to_gain_ps(_mm_mul_ps(slope, db), _mm_setzero_ps(),
+				   mul);
+}
+
+/* gain stage of a downward compressor, approximated:
+ * gain[i] = db_to_mul(fminf(0, slope * (threshold - mul_to_db(env[i])))) *
+ *           mul
+ * gain may be the same buffer as env */
+static inline void audio_compressor_gain(float *gain, const float *env,
+					 float threshold, float slope,
+					 float mul, size_t count)
+{
+	const __m128 v_threshold = _mm_set1_ps(threshold);
+	const __m128 v_slope = _mm_set1_ps(slope);
+	const __m128 v_mul = _mm_set1_ps(mul);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(gain + i,
+			      audio_compressor_gain_ps(_mm_loadu_ps(env + i),
+						       v_threshold, v_slope,
+						       v_mul));
+
+	if (i < count) {
+		float tail[4] = {0};
+		memcpy(tail, env + i, (count - i) * sizeof(float));
+		_mm_storeu_ps(tail,
+			      audio_compressor_gain_ps(_mm_loadu_ps(tail),
+						       v_threshold, v_slope,
+						       v_mul));
+		memcpy(gain + i, tail, (count - i) * sizeof(float));
+	}
+}
+
+/* Peak envelope follower.  Every channel starts from env and follows its
+ * absolute sample values with the attack/release coefficients, and env_buf
+ * receives the highest envelope of all channels for each sample.  NULL
+ * channels are skipped.  Up to four channels run side by side in the lanes
+ * of a vector, which does the same arithmetic as the scalar loop. */
+static inline void audio_envelope_peak(float *env_buf,
+				       float *const *samples, size_t channels,
+				       size_t count, float env, float attack,
+				       float release)
+{
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 v_attack = _mm_set1_ps(attack);
+	const __m128 v_release = _mm_set1_ps(release);
+
+	memset(env_buf, 0, count * sizeof(float));
+
+	for (size_t c = 0; c < channels; c += 4) {
+		const float *src[4] = {NULL};
+		uint32_t lanes[4] = {0};
+		const float *first = NULL;
+
+		for (size_t l = 0; l < 4; l++) {
+			if (c + l < channels && samples[c + l]) {
+				src[l] = samples[c + l];
+				lanes[l] = 0xffffffff;
+				if (!first)
+					first = src[l];
+			}
+		}
+
+		if (!first)
+			continue;
+
+		/* unused lanes follow a real channel but are masked out */
+		for (size_t l = 0; l < 4; l++) {
+			if (!src[l])
+				src[l] = first;
+		}
+
+		const __m128 lane_mask = _mm_castsi128_ps(
+			_mm_set_epi32((int)lanes[3], (int)lanes[2],
+				      (int)lanes[1], (int)lanes[0]));
+		__m128 v_env = _mm_set1_ps(env);
+
+		for (size_t i = 0; i < count; i++) {
+			__m128 in = _mm_set_ps(src[3][i], src[2][i], src[1][i],
+					       src[0][i]);
+			in = _mm_and_ps(in, abs_mask);
+
+			__m128 up = _mm_cmplt_ps(v_env, in);
+			__m128 coef = _mm_or_ps(_mm_and_ps(up, v_attack),
+						_mm_andnot_ps(up, v_release));
+			v_env = _mm_add_ps(
+				in, _mm_mul_ps(coef, _mm_sub_ps(v_env, in)));
+
+			/* envelopes are never negative, so masked lanes
+			 * can't win */
+			__m128 m = _mm_and_ps(v_env, lane_mask);
+			m = _mm_max_ps(m, _mm_shuffle_ps(m, m, 0x4e));
+			m = _mm_max_ps(m, _mm_shuffle_ps(m, m, 0xb1));
+			m = _mm_max_ss(m, _mm_load_ss(env_buf + i));
+			_mm_store_ss(env_buf + i, m);
+		}
+	}
+}
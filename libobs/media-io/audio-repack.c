@@ -0,0 +1,224 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-repack.h"
+#include "../util/bmem.h"
+#include "../util/sse-intrin.h"
+
+#define NUM_CHANNELS 8 /* max until OBS supports higher channel counts */
+
+static int check_buffer(struct audio_repack *repack, uint32_t frame_count)
+{
+	const uint32_t new_size =
+		frame_count * repack->base_dst_size + repack->pad_dst_size;
+
+	if (repack->packet_size < new_size) {
+		repack->packet_buffer =
+			brealloc(repack->packet_buffer, new_size);
+		if (!repack->packet_buffer)
+			return -1;
+		repack->packet_size = new_size;
+	}
+
+	return 0;
+}
+
+/*
+ * Every frame is written whole and the next one is written over its unused
+ * channels, which is why the buffer is padded by the number of channels
+ * squashed.  For instance, 2.1:
+ *
+ * | FL | FR | LFE | emp | emp | emp | emp | emp |
+ * |    |    |
+ * | FL | FR | LFE |
+ */
+static int repack_squash16(struct audio_repack *repack, const uint8_t *bsrc,
+			   uint32_t frame_count)
+{
+	if (check_buffer(repack, frame_count) < 0)
+		return -1;
+
+	const uint32_t channels = NUM_CHANNELS - repack->squash_count;
+	const __m128i *src = (const __m128i *)bsrc;
+	const __m128i *end = src + frame_count;
+	uint16_t *dst = (uint16_t *)repack->packet_buffer;
+
+	while (src != end) {
+		__m128i target = _mm_loadu_si128(src++);
+		_mm_storeu_si128((__m128i *)dst, target);
+		dst += channels;
+	}
+
+	return 0;
+}
+
+/*
+ * Same as above, but also swaps front center with LFE:
+ *
+ * | FL | FR | FC | LFE | RL | RR | LC | RC |
+ * |    |    |
+ * | FL | FR | LFE | FC | RL | RR | LC | RC |
+ */
+static int repack_squash_swap16(struct audio_repack *repack,
+				const uint8_t *bsrc, uint32_t frame_count)
+{
+	if (check_buffer(repack, frame_count) < 0)
+		return -1;
+
+	const uint32_t channels = NUM_CHANNELS - repack->squash_count;
+	const __m128i *src = (const __m128i *)bsrc;
+	const __m128i *end = src + frame_count;
+	uint16_t *dst = (uint16_t *)repack->packet_buffer;
+
+	while (src != end) {
+		__m128i target = _mm_loadu_si128(src++);
+		__m128i buf =
+			_mm_shufflelo_epi16(target, _MM_SHUFFLE(2, 3, 1, 0));
+		_mm_storeu_si128((__m128i *)dst, buf);
+		dst += channels;
+	}
+
+	return 0;
+}
+
+/* 32-bit frames are two vectors, the upper one is only written if any of its
+ * channels are kept */
+static int repack_squash32(struct audio_repack *repack, const uint8_t *bsrc,
+			   uint32_t frame_count)
+{
+	if (check_buffer(repack, frame_count) < 0)
+		return -1;
+
+	const uint32_t channels = NUM_CHANNELS - repack->squash_count;
+	const __m128i *src = (const __m128i *)bsrc;
+	const __m128i *end = src + frame_count * 2;
+	uint32_t *dst = (uint32_t *)repack->packet_buffer;
+
+	while (src != end) {
+		__m128i tgt_lo = _mm_loadu_si128(src++);
+		__m128i tgt_hi = _mm_loadu_si128(src++);
+		_mm_storeu_si128((__m128i *)dst, tgt_lo);
+		if (channels > 4)
+			_mm_storeu_si128((__m128i *)(dst + 4), tgt_hi);
+		dst += channels;
+	}
+
+	return 0;
+}
+
+static int repack_squash_swap32(struct audio_repack *repack,
+				const uint8_t *bsrc, uint32_t frame_count)
+{
+	if (check_buffer(repack, frame_count) < 0)
+		return -1;
+
+	const uint32_t channels = NUM_CHANNELS - repack->squash_count;
+	const __m128i *src = (const __m128i *)bsrc;
+	const __m128i *end = src + frame_count * 2;
+	uint32_t *dst = (uint32_t *)repack->packet_buffer;
+
+	while (src != end) {
+		__m128i tgt_lo = _mm_shuffle_epi32(_mm_loadu_si128(src++),
+						   _MM_SHUFFLE(2, 3, 1, 0));
+		__m128i tgt_hi = _mm_loadu_si128(src++);
+		_mm_storeu_si128((__m128i *)dst, tgt_lo);
+		if (channels > 4)
+			_mm_storeu_si128((__m128i *)(dst + 4), tgt_hi);
+		dst += channels;
+	}
+
+	return 0;
+}
+
+int audio_repack_init(struct audio_repack *repack,
+		      audio_repack_mode_t repack_mode, uint8_t bits_per_sample)
+{
+	static const uint32_t repack_channels[] = {2, 3, 4, 5, 6,
+						   5, 6, 8, 8, 1};
+	bool swap;
+
+	memset(repack, 0, sizeof(*repack));
+
+	if (bits_per_sample != 16 && bits_per_sample != 32)
+		return -1;
+	if ((size_t)repack_mode >=
+	    sizeof(repack_channels) / sizeof(repack_channels[0]))
+		return -1;
+
+	const uint32_t bytes_per_sample = bits_per_sample / 8;
+	const uint32_t channels = repack_channels[repack_mode];
+	const uint32_t squash_count = NUM_CHANNELS - channels;
+
+	repack->bytes_per_sample = bytes_per_sample;
+	repack->base_src_size = NUM_CHANNELS * bytes_per_sample;
+	repack->base_dst_size = channels * bytes_per_sample;
+	repack->pad_dst_size = squash_count * bytes_per_sample;
+	repack->squash_count = squash_count;
+
+	swap = repack_mode == repack_mode_8to5ch_swap ||
+	       repack_mode == repack_mode_8to6ch_swap ||
+	       repack_mode == repack_mode_8ch_swap;
+
+	if (bits_per_sample == 16)
+		repack->repack_func = swap ? repack_squash_swap16
+					   : repack_squash16;
+	else
+		repack->repack_func = swap ? repack_squash_swap32
+					   : repack_squash32;
+
+	return 0;
+}
+
+void audio_repack_free(struct audio_repack *repack)
+{
+	if (repack->packet_buffer)
+		bfree(repack->packet_buffer);
+
+	memset(repack, 0, sizeof(*repack));
+}
+
+bool audio_repack_get_mode(enum speaker_layout layout, bool swap,
+			   audio_repack_mode_t *mode)
+{
+	switch (layout) {
+	case SPEAKERS_MONO:
+		*mode = repack_mode_8to1ch;
+		return true;
+	case SPEAKERS_STEREO:
+		*mode = repack_mode_8to2ch;
+		return true;
+	case SPEAKERS_2POINT1:
+		*mode = repack_mode_8to3ch;
+		return true;
+	case SPEAKERS_4POINT0:
+		*mode = repack_mode_8to4ch;
+		return true;
+	case SPEAKERS_4POINT1:
+		*mode = swap ? repack_mode_8to5ch_swap : repack_mode_8to5ch;
+		return true;
+	case SPEAKERS_5POINT1:
+		*mode = swap ? repack_mode_8to6ch_swap : repack_mode_8to6ch;
+		return true;
+	case SPEAKERS_7POINT1:
+		*mode = swap ? repack_mode_8ch_swap : repack_mode_8ch;
+		return true;
+	case SPEAKERS_UNKNOWN:
+		break;
+	}
+
+	return false;
+}
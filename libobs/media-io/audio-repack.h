@@ -0,0 +1,82 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+#include "audio-io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Audio repacking
+ *
+ *   Capture devices such as DeckLink and AJA cards always deliver eight
+ * channels of interleaved integer audio, whatever the speaker layout.  This
+ * squashes them down to the channel count of the layout, and can swap front
+ * center with LFE for devices that put them the other way around.
+ */
+
+struct audio_repack;
+
+typedef int (*audio_repack_func_t)(struct audio_repack *, const uint8_t *,
+				   uint32_t);
+
+struct audio_repack {
+	uint8_t *packet_buffer;
+	uint32_t packet_size;
+
+	uint32_t base_src_size;
+	uint32_t base_dst_size;
+	uint32_t pad_dst_size;
+	uint32_t squash_count;
+	uint32_t bytes_per_sample;
+
+	audio_repack_func_t repack_func;
+};
+
+enum _audio_repack_mode {
+	repack_mode_8to2ch = 0,
+	repack_mode_8to3ch,
+	repack_mode_8to4ch,
+	repack_mode_8to5ch,
+	repack_mode_8to6ch,
+	repack_mode_8to5ch_swap,
+	repack_mode_8to6ch_swap,
+	repack_mode_8ch_swap,
+	repack_mode_8ch,
+	repack_mode_8to1ch,
+};
+
+typedef enum _audio_repack_mode audio_repack_mode_t;
+
+/* bits_per_sample can be 16 or 32 */
+EXPORT int audio_repack_init(struct audio_repack *repack,
+			     audio_repack_mode_t repack_mode,
+			     uint8_t bits_per_sample);
+EXPORT void audio_repack_free(struct audio_repack *repack);
+
+/* Returns the mode that turns eight channels into the given layout, or false
+ * if there is no repack for it.  swap swaps front center with LFE. */
+EXPORT bool audio_repack_get_mode(enum speaker_layout layout, bool swap,
+				  audio_repack_mode_t *mode);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,13 +18,22 @@
 #include "../util/bmem.h"
 #include "audio-resampler.h"
 #include "audio-io.h"
+#include "audio-math.h"
 #include <libavutil/avutil.h>
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
+/* mono/stereo conversions of planar float at the same rate skip swresample */
+enum fast_remix {
+	FAST_REMIX_NONE,
+	FAST_REMIX_UPMIX,
+	FAST_REMIX_DOWNMIX,
+};
+
 struct audio_resampler {
 	struct SwrContext *context;
 	bool opened;
+	enum fast_remix fast_remix;
 
 	uint32_t input_freq;
 	enum AVSampleFormat input_format;
@@ -97,6 +106,22 @@ static inline uint64_t convert_speaker_layout(enum speaker_layout layout)
 }
 #endif
 
+static enum fast_remix get_fast_remix(const struct resample_info *dst,
+				      const struct resample_info *src)
+{
+	if (dst->samples_per_sec != src->samples_per_sec ||
+	    dst->format != AUDIO_FORMAT_FLOAT_PLANAR ||
+	    src->format != AUDIO_FORMAT_FLOAT_PLANAR)
+		return FAST_REMIX_NONE;
+
+	if (src->speakers == SPEAKERS_MONO && dst->speakers == SPEAKERS_STEREO)
+		return FAST_REMIX_UPMIX;
+	if (src->speakers == SPEAKERS_STEREO && dst->speakers == SPEAKERS_MONO)
+		return FAST_REMIX_DOWNMIX;
+
+	return FAST_REMIX_NONE;
+}
+
 audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 					  const struct resample_info *src)
 {
@@ -111,6 +136,10 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 	rs->output_freq = dst->samples_per_sec;
 	rs->output_format = convert_audio_format(dst->format);
 	rs->output_planes = is_audio_planar(dst->format) ? rs->output_ch : 1;
+	rs->fast_remix = get_fast_remix(dst, src);
+
+	if (rs->fast_remix != FAST_REMIX_NONE)
+		return rs;
 
 #if (LIBSWRESAMPLE_VERSION_INT < AV_VERSION_INT(4, 5, 100))
 	rs->input_layout = convert_speaker_layout(src->speakers);
@@ -190,6 +219,24 @@ void audio_resampler_destroy(audio_resampler_t *rs)
 	}
 }
 
+static void do_fast_remix(audio_resampler_t *rs, const uint8_t *const input[],
+			  uint32_t frames)
+{
+	float *out0 = (float *)rs->output_buffer[0];
+	const float *in0 = (const float *)input[0];
+
+	if (rs->fast_remix == FAST_REMIX_UPMIX) {
+		/* same as the mono upmix matrix given to swresample */
+		memcpy(out0, in0, frames * sizeof(float));
+		memcpy(rs->output_buffer[1], in0, frames * sizeof(float));
+	} else {
+		/* swresample's default downmix, -3 dB per channel */
+		memcpy(out0, in0, frames * sizeof(float));
+		audio_mix_add(out0, (const float *)input[1], frames);
+		audio_mul(out0, (float)M_SQRT1_2, frames);
+	}
+}
+
 bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 			      uint32_t *out_frames, uint64_t *ts_offset,
 			      const uint8_t *const input[], uint32_t in_frames)
@@ -197,6 +244,28 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 	if (!rs)
 		return false;
 
+	if (rs->fast_remix != FAST_REMIX_NONE) {
+		if ((int)in_frames > rs->output_size) {
+			if (rs->output_buffer[0])
+				av_freep(&rs->output_buffer[0]);
+
+			av_samples_alloc(rs->output_buffer, NULL,
+					 rs->output_ch, (int)in_frames,
+					 rs->output_format, 0);
+
+			rs->output_size = (int)in_frames;
+		}
+
+		do_fast_remix(rs, input, in_frames);
+
+		for (uint32_t i = 0; i < rs->output_planes; i++)
+			output[i] = rs->output_buffer[i];
+
+		*ts_offset = 0;
+		*out_frames = in_frames;
+		return true;
+	}
+
 	struct SwrContext *context = rs->context;
 	int ret;
 
@@ -17,6 +17,8 @@
 
 #include "format-conversion.h"
 
+#include <string.h>
+
 #include "../util/sse-intrin.h"
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
@@ -200,6 +202,68 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
+/* duplicates each 16-bit chroma value for two horizontally adjacent pixels
+ * and pairs them with the luma values, producing 32 bit pixels with the
+ * chroma in the low word and the luma in the high word */
+#define store_uv_lum_16(out, uv, lum, zero)                                    \
+	do {                                                                   \
+		__m128i uv_lo = _mm_unpacklo_epi16(uv, uv);                    \
+		__m128i uv_hi = _mm_unpackhi_epi16(uv, uv);                    \
+		__m128i lum_lo = _mm_unpacklo_epi8(lum, zero);                 \
+		__m128i lum_hi = _mm_unpackhi_epi8(lum, zero);                 \
+                                                                               \
+		_mm_storeu_si128((__m128i *)(out),                             \
+				 _mm_unpacklo_epi16(uv_lo, lum_lo));           \
+		_mm_storeu_si128((__m128i *)(out) + 1,                         \
+				 _mm_unpackhi_epi16(uv_lo, lum_lo));           \
+		_mm_storeu_si128((__m128i *)(out) + 2,                         \
+				 _mm_unpacklo_epi16(uv_hi, lum_hi));           \
+		_mm_storeu_si128((__m128i *)(out) + 3,                         \
+				 _mm_unpackhi_epi16(uv_hi, lum_hi));           \
+	} while (false)
+
+/* same as above, but with the luma in the low byte and the chroma shifted into
+ * the two bytes above it */
+#define store_lum_uv_4(out, uv, lum, zero)                                     \
+	_mm_storeu_si128((__m128i *)(out),                                     \
+			 _mm_or_si128(_mm_slli_epi32(                          \
+					      _mm_unpacklo_epi16(uv, zero), 8), \
+				      _mm_unpacklo_epi16(lum, zero)))
+
+#define store_lum_uv_16(out, uv, lum, zero)                                    \
+	do {                                                                   \
+		__m128i uv_lo = _mm_unpacklo_epi16(uv, uv);                    \
+		__m128i uv_hi = _mm_unpackhi_epi16(uv, uv);                    \
+		__m128i lum_lo = _mm_unpacklo_epi8(lum, zero);                 \
+		__m128i lum_hi = _mm_unpackhi_epi8(lum, zero);                 \
+                                                                               \
+		store_lum_uv_4((__m128i *)(out), uv_lo, lum_lo, zero);       \
+		store_lum_uv_4((__m128i *)(out) + 1,                           \
+			       _mm_unpackhi_epi64(uv_lo, uv_lo),               \
+			       _mm_unpackhi_epi64(lum_lo, lum_lo), zero);      \
+		store_lum_uv_4((__m128i *)(out) + 2, uv_hi, lum_hi, zero);   \
+		store_lum_uv_4((__m128i *)(out) + 3,                           \
+			       _mm_unpackhi_epi64(uv_hi, uv_hi),               \
+			       _mm_unpackhi_epi64(lum_hi, lum_hi), zero);      \
+	} while (false)
+
+/* packs the high bytes of two vectors of 16-bit samples into one vector of
+ * 8-bit samples */
+static FORCE_INLINE __m128i pack_hi_bytes(__m128i a, __m128i b)
+{
+	return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+/* reduces two vectors of 10-bit samples stored in the low bits of 16-bit
+ * words into one vector of 8-bit samples */
+static FORCE_INLINE __m128i pack_10bit(__m128i a, __m128i b)
+{
+	return _mm_packus_epi16(_mm_srli_epi16(a, 2), _mm_srli_epi16(b, 2));
+}
+
+#define load_128(ptr) _mm_loadu_si128((const __m128i *)(ptr))
+#define load_64(ptr) _mm_loadl_epi64((const __m128i *)(ptr))
+
 void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 		    uint32_t start_y, uint32_t end_y, uint8_t *output,
 		    uint32_t out_linesize)
@@ -209,19 +273,36 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	const __m128i zero = _mm_setzero_si128();
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
 		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
-		uint32_t x;
+		uint32_t x = 0;
 
 		lum0 = input[0] + y * 2 * in_linesize[0];
 		lum1 = lum0 + in_linesize[0];
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i uv = _mm_unpacklo_epi8(load_64(chroma1),
+						       load_64(chroma0));
+
+			store_uv_lum_16(output0, uv, load_128(lum0), zero);
+			store_uv_lum_16(output1, uv, load_128(lum1), zero);
+
+			chroma0 += 8;
+			chroma1 += 8;
+			lum0 += 16;
+			lum1 += 16;
+			output0 += 16;
+			output1 += 16;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out;
 			out = (*(chroma0++) << 8) | *(chroma1++);
 
@@ -234,6 +315,67 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	}
 }
 
+void decompress_i010(const uint8_t *const input[],
+		     const uint32_t in_linesize[], uint32_t start_y,
+		     uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y / 2;
+	uint32_t width_d2 = min_uint32(in_linesize[0] / 2, out_linesize / 4) / 2;
+	uint32_t height_d2 = end_y / 2;
+	uint32_t y;
+
+	const __m128i zero = _mm_setzero_si128();
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint16_t *chroma0 =
+			(const uint16_t *)(input[1] + y * in_linesize[1]);
+		const uint16_t *chroma1 =
+			(const uint16_t *)(input[2] + y * in_linesize[2]);
+		register const uint16_t *lum0, *lum1;
+		register uint32_t *output0, *output1;
+		uint32_t x = 0;
+
+		lum0 = (const uint16_t *)(input[0] + y * 2 * in_linesize[0]);
+		lum1 = (const uint16_t *)((const uint8_t *)lum0 +
+					  in_linesize[0]);
+		output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
+
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i u = pack_10bit(load_128(chroma0), zero);
+			__m128i v = pack_10bit(load_128(chroma1), zero);
+			__m128i uv = _mm_unpacklo_epi8(v, u);
+
+			store_uv_lum_16(output0, uv,
+					pack_10bit(load_128(lum0),
+						   load_128(lum0 + 8)),
+					zero);
+			store_uv_lum_16(output1, uv,
+					pack_10bit(load_128(lum1),
+						   load_128(lum1 + 8)),
+					zero);
+
+			chroma0 += 8;
+			chroma1 += 8;
+			lum0 += 16;
+			lum1 += 16;
+			output0 += 16;
+			output1 += 16;
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out;
+			out = ((*(chroma0++) >> 2) << 8) | (*(chroma1++) >> 2);
+
+			*(output0++) = ((*(lum0++) >> 2) << 16) | out;
+			*(output0++) = ((*(lum0++) >> 2) << 16) | out;
+
+			*(output1++) = ((*(lum1++) >> 2) << 16) | out;
+			*(output1++) = ((*(lum1++) >> 2) << 16) | out;
+		}
+	}
+}
+
 void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		     uint32_t start_y, uint32_t end_y, uint8_t *output,
 		     uint32_t out_linesize)
@@ -243,11 +385,13 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	const __m128i zero = _mm_setzero_si128();
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint16_t *chroma;
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
-		uint32_t x;
+		uint32_t x = 0;
 
 		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]);
 		lum0 = input[0] + y * 2 * in_linesize[0];
@@ -255,7 +399,20 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i uv = load_128(chroma);
+
+			store_lum_uv_16(output0, uv, load_128(lum0), zero);
+			store_lum_uv_16(output1, uv, load_128(lum1), zero);
+
+			chroma += 8;
+			lum0 += 16;
+			lum1 += 16;
+			output0 += 16;
+			output1 += 16;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out = *(chroma++) << 8;
 
 			*(output0++) = *(lum0++) | out;
@@ -267,23 +424,150 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	}
 }
 
+void decompress_p010(const uint8_t *const input[], const uint32_t in_linesize[],
+		     uint32_t start_y, uint32_t end_y, uint8_t *output,
+		     uint32_t out_linesize)
+{
+	uint32_t start_y_d2 = start_y / 2;
+	uint32_t width_d2 = min_uint32(in_linesize[0] / 2, out_linesize / 4) / 2;
+	uint32_t height_d2 = end_y / 2;
+	uint32_t y;
+
+	const __m128i zero = _mm_setzero_si128();
+
+	for (y = start_y_d2; y < height_d2; y++) {
+		const uint16_t *chroma;
+		register const uint16_t *lum0, *lum1;
+		register uint32_t *output0, *output1;
+		uint32_t x = 0;
+
+		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]);
+		lum0 = (const uint16_t *)(input[0] + y * 2 * in_linesize[0]);
+		lum1 = (const uint16_t *)((const uint8_t *)lum0 +
+					  in_linesize[0]);
+		output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
+
+		for (; x + 8 <= width_d2; x += 8) {
+			__m128i uv = pack_hi_bytes(load_128(chroma),
+						   load_128(chroma + 8));
+
+			store_lum_uv_16(output0, uv,
+					pack_hi_bytes(load_128(lum0),
+						      load_128(lum0 + 8)),
+					zero);
+			store_lum_uv_16(output1, uv,
+					pack_hi_bytes(load_128(lum1),
+						      load_128(lum1 + 8)),
+					zero);
+
+			chroma += 16;
+			lum0 += 16;
+			lum1 += 16;
+			output0 += 16;
+			output1 += 16;
+		}
+
+		for (; x < width_d2; x++) {
+			uint32_t out = ((uint32_t)(chroma[0] >> 8) << 8) |
+				       ((uint32_t)(chroma[1] >> 8) << 16);
+			chroma += 2;
+
+			*(output0++) = (*(lum0++) >> 8) | out;
+			*(output0++) = (*(lum0++) >> 8) | out;
+
+			*(output1++) = (*(lum1++) >> 8) | out;
+			*(output1++) = (*(lum1++) >> 8) | out;
+		}
+	}
+}
+
+void decompress_yuva444(const uint8_t *const input[],
+			const uint32_t in_linesize[], uint32_t start_y,
+			uint32_t end_y, uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width = min_uint32(in_linesize[0], out_linesize / 4);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y++) {
+		const uint8_t *lum = input[0] + y * in_linesize[0];
+		const uint8_t *u = input[1] + y * in_linesize[1];
+		const uint8_t *v = input[2] + y * in_linesize[2];
+		const uint8_t *a = input[3] + y * in_linesize[3];
+		uint32_t *output32 = (uint32_t *)(output + y * out_linesize);
+		uint32_t x = 0;
+
+		for (; x + 16 <= width; x += 16) {
+			__m128i vu_lo = _mm_unpacklo_epi8(load_128(v + x),
+							  load_128(u + x));
+			__m128i vu_hi = _mm_unpackhi_epi8(load_128(v + x),
+							  load_128(u + x));
+			__m128i ya_lo = _mm_unpacklo_epi8(load_128(lum + x),
+							  load_128(a + x));
+			__m128i ya_hi = _mm_unpackhi_epi8(load_128(lum + x),
+							  load_128(a + x));
+			__m128i *out = (__m128i *)(output32 + x);
+
+			_mm_storeu_si128(out, _mm_unpacklo_epi16(vu_lo, ya_lo));
+			_mm_storeu_si128(out + 1,
+					 _mm_unpackhi_epi16(vu_lo, ya_lo));
+			_mm_storeu_si128(out + 2,
+					 _mm_unpacklo_epi16(vu_hi, ya_hi));
+			_mm_storeu_si128(out + 3,
+					 _mm_unpackhi_epi16(vu_hi, ya_hi));
+		}
+
+		for (; x < width; x++) {
+			output32[x] = ((uint32_t)a[x] << 24) |
+				      ((uint32_t)lum[x] << 16) |
+				      ((uint32_t)u[x] << 8) | v[x];
+		}
+	}
+}
+
+#define expand_422(input32, output32, lum_mask, dup_mask, shift)               \
+	do {                                                                   \
+		__m128i dw = load_128(input32);                                \
+		__m128i dup = _mm_or_si128(                                    \
+			_mm_and_si128(dw, lum_mask),                           \
+			_mm_and_si128(_mm_srli_epi32(dw, shift), dup_mask));   \
+                                                                               \
+		_mm_storeu_si128((__m128i *)(output32),                        \
+				 _mm_unpacklo_epi32(dw, dup));                 \
+		_mm_storeu_si128((__m128i *)(output32) + 1,                    \
+				 _mm_unpackhi_epi32(dw, dup));                 \
+	} while (false)
+
 void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		    uint32_t start_y, uint32_t end_y, uint8_t *output,
 		    uint32_t out_linesize, bool leading_lum)
 {
-	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
+	uint32_t width_d2 = min_uint32(in_linesize / 2, out_linesize / 4) / 2;
 	uint32_t y;
 
 	register const uint32_t *input32;
 	register const uint32_t *input32_end;
+	register const uint32_t *input32_simd_end;
 	register uint32_t *output32;
 
 	if (leading_lum) {
+		const __m128i lum_mask = _mm_set1_epi32((int)0xFFFFFF00);
+		const __m128i dup_mask = _mm_set1_epi32(0x000000FF);
+
 		for (y = start_y; y < end_y; y++) {
 			input32 = (const uint32_t *)(input + y * in_linesize);
 			input32_end = input32 + width_d2;
+			input32_simd_end = input32 + (width_d2 & ~3);
 			output32 = (uint32_t *)(output + y * out_linesize);
 
+			while (input32 < input32_simd_end) {
+				expand_422(input32, output32, lum_mask,
+					   dup_mask, 16);
+
+				output32 += 8;
+				input32 += 4;
+			}
+
 			while (input32 < input32_end) {
 				register uint32_t dw = *input32;
 
@@ -297,11 +581,23 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 			}
 		}
 	} else {
+		const __m128i lum_mask = _mm_set1_epi32((int)0xFFFF00FF);
+		const __m128i dup_mask = _mm_set1_epi32(0x0000FF00);
+
 		for (y = start_y; y < end_y; y++) {
 			input32 = (const uint32_t *)(input + y * in_linesize);
 			input32_end = input32 + width_d2;
+			input32_simd_end = input32 + (width_d2 & ~3);
 			output32 = (uint32_t *)(output + y * out_linesize);
 
+			while (input32 < input32_simd_end) {
+				expand_422(input32, output32, lum_mask,
+					   dup_mask, 16);
+
+				output32 += 8;
+				input32 += 4;
+			}
+
 			while (input32 < input32_end) {
 				register uint32_t dw = *input32;
 
@@ -316,3 +612,268 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		}
 	}
 }
+
+/* ------------------------------------------------------------------------- */
+/* video scaler fast paths, width and rows are those of the output           */
+
+void convert_nv12_to_i420(const uint8_t *const input[],
+			  const uint32_t in_linesize[], uint32_t width,
+			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			  const uint32_t out_linesize[])
+{
+	uint32_t width_d2 = width / 2;
+	const __m128i lo_mask = _mm_set1_epi16(0x00FF);
+
+	for (uint32_t y = start_y; y < end_y; y++)
+		memcpy(output[0] + y * out_linesize[0],
+		       input[0] + y * in_linesize[0], width);
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		uint8_t *u = output[1] + y * out_linesize[1];
+		uint8_t *v = output[2] + y * out_linesize[2];
+		uint32_t x = 0;
+
+		for (; x + 16 <= width_d2; x += 16) {
+			__m128i uv0 = load_128(chroma);
+			__m128i uv1 = load_128(chroma + 16);
+
+			_mm_storeu_si128((__m128i *)(u + x),
+					 _mm_packus_epi16(
+						 _mm_and_si128(uv0, lo_mask),
+						 _mm_and_si128(uv1, lo_mask)));
+			_mm_storeu_si128((__m128i *)(v + x),
+					 pack_hi_bytes(uv0, uv1));
+			chroma += 32;
+		}
+
+		for (; x < width_d2; x++) {
+			u[x] = *(chroma++);
+			v[x] = *(chroma++);
+		}
+	}
+}
+
+/* averages 2x2 blocks of 8-bit samples given as the even and odd bytes of
+ * two rows, rounding to nearest */
+static FORCE_INLINE __m128i box_2x2(__m128i row0, __m128i row1, __m128i mask)
+{
+	__m128i sum = _mm_add_epi16(_mm_and_si128(row0, mask),
+				    _mm_srli_epi16(row0, 8));
+	sum = _mm_add_epi16(sum, _mm_and_si128(row1, mask));
+	sum = _mm_add_epi16(sum, _mm_srli_epi16(row1, 8));
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+/* sums 16-bit UV pairs that sit in adjacent 32-bit lanes, the sums end up
+ * in the low 64 bits */
+static FORCE_INLINE __m128i sum_uv_pairs(__m128i uv)
+{
+	uv = _mm_add_epi16(uv, _mm_srli_si128(uv, 4));
+	return _mm_shuffle_epi32(uv, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+void downscale_nv12_2x(const uint8_t *const input[],
+		       const uint32_t in_linesize[], uint32_t width,
+		       uint32_t start_y, uint32_t end_y, uint8_t *output[],
+		       const uint32_t out_linesize[])
+{
+	const __m128i lo_mask = _mm_set1_epi16(0x00FF);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint8_t *row0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *row1 = row0 + in_linesize[0];
+		uint8_t *out = output[0] + y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 16 <= width; x += 16) {
+			const uint8_t *in0 = row0 + x * 2;
+			const uint8_t *in1 = row1 + x * 2;
+			__m128i lo = box_2x2(load_128(in0), load_128(in1),
+					     lo_mask);
+			__m128i hi = box_2x2(load_128(in0 + 16),
+					     load_128(in1 + 16), lo_mask);
+
+			_mm_storeu_si128((__m128i *)(out + x),
+					 _mm_packus_epi16(lo, hi));
+		}
+
+		for (; x < width; x++) {
+			const uint8_t *in0 = row0 + x * 2;
+			const uint8_t *in1 = row1 + x * 2;
+			out[x] = (uint8_t)((in0[0] + in0[1] + in1[0] + in1[1] +
+					    2) >>
+					   2);
+		}
+	}
+
+	/* chroma is interleaved, so the columns being averaged are one UV
+	 * pair apart */
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *row0 = input[1] + y * 2 * in_linesize[1];
+		const uint8_t *row1 = row0 + in_linesize[1];
+		uint8_t *out = output[1] + y * out_linesize[1];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			__m128i in0 = load_128(row0 + x * 2);
+			__m128i in1 = load_128(row1 + x * 2);
+			__m128i lo =
+				_mm_add_epi16(_mm_unpacklo_epi8(in0, zero),
+					      _mm_unpacklo_epi8(in1, zero));
+			__m128i hi =
+				_mm_add_epi16(_mm_unpackhi_epi8(in0, zero),
+					      _mm_unpackhi_epi8(in1, zero));
+			__m128i sum = _mm_unpacklo_epi64(sum_uv_pairs(lo),
+							 sum_uv_pairs(hi));
+
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			_mm_storel_epi64((__m128i *)(out + x),
+					 _mm_packus_epi16(sum, sum));
+		}
+
+		for (; x < width; x++) {
+			const uint8_t *in0 = row0 + (x & ~1) * 2 + (x & 1);
+			const uint8_t *in1 = row1 + (x & ~1) * 2 + (x & 1);
+			out[x] = (uint8_t)((in0[0] + in0[2] + in1[0] + in1[2] +
+					    2) >>
+					   2);
+		}
+	}
+}
+
+/* BT.709 limited range in 8.8 fixed point, in R, G, B order */
+#define BT709_Y_R 47
+#define BT709_Y_G 157
+#define BT709_Y_B 16
+#define BT709_U_R -26
+#define BT709_U_G -87
+#define BT709_U_B 112
+#define BT709_V_R 112
+#define BT709_V_G -102
+#define BT709_V_B -10
+
+/* multiplies 16-bit RGBA pixels with coefficients and sums each pixel's
+ * products, giving one 32-bit value per pixel for two vectors of two */
+static FORCE_INLINE __m128i dot_rgba(__m128i px01, __m128i px23, __m128i coef)
+{
+	__m128 a = _mm_castsi128_ps(_mm_madd_epi16(px01, coef));
+	__m128 b = _mm_castsi128_ps(_mm_madd_epi16(px23, coef));
+	__m128i even = _mm_castps_si128(
+		_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+	__m128i odd = _mm_castps_si128(
+		_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	return _mm_add_epi32(even, odd);
+}
+
+/* sums the two 16-bit RGBA pixels of each vector of two rows, giving the
+ * 2x2 sums of both blocks */
+static FORCE_INLINE __m128i sum_rgba_2x2(__m128i row0, __m128i row1)
+{
+	__m128i sum = _mm_add_epi16(row0, row1);
+	return _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+}
+
+/* the rows of the output aren't necessarily 4 byte aligned */
+static FORCE_INLINE void store_32(uint8_t *out, __m128i val)
+{
+	int32_t low = _mm_cvtsi128_si32(val);
+	memcpy(out, &low, sizeof(low));
+}
+
+static FORCE_INLINE __m128i rgba_coef(int r, int g, int b, bool bgra)
+{
+	return bgra ? _mm_setr_epi16((short)b, (short)g, (short)r, 0,
+				     (short)b, (short)g, (short)r, 0)
+		    : _mm_setr_epi16((short)r, (short)g, (short)b, 0,
+				     (short)r, (short)g, (short)b, 0);
+}
+
+static FORCE_INLINE uint8_t rgb_to_y(const uint8_t *px, bool bgra)
+{
+	int r = px[bgra ? 2 : 0], g = px[1], b = px[bgra ? 0 : 2];
+	int val = BT709_Y_R * r + BT709_Y_G * g + BT709_Y_B * b;
+	return (uint8_t)(((val + 128) >> 8) + 16);
+}
+
+void convert_rgba_to_nv12_709(const uint8_t *input, uint32_t in_linesize,
+			      uint32_t width, uint32_t start_y, uint32_t end_y,
+			      uint8_t *output[], const uint32_t out_linesize[],
+			      bool bgra)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i coef_y = rgba_coef(BT709_Y_R, BT709_Y_G, BT709_Y_B, bgra);
+	const __m128i coef_u = rgba_coef(BT709_U_R, BT709_U_G, BT709_U_B, bgra);
+	const __m128i coef_v = rgba_coef(BT709_V_R, BT709_V_G, BT709_V_B, bgra);
+	const __m128i y_round = _mm_set1_epi32(128);
+	const __m128i y_offset = _mm_set1_epi16(16);
+	const __m128i uv_round = _mm_set1_epi32(512);
+	const __m128i uv_offset = _mm_set1_epi16(128);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		const uint8_t *row0 = input + y * in_linesize;
+		const uint8_t *row1 = row0 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *uv = output[1] + y / 2 * out_linesize[1];
+		uint32_t x = 0;
+
+		for (; x + 4 <= width; x += 4) {
+			__m128i in0 = load_128(row0 + x * 4);
+			__m128i in1 = load_128(row1 + x * 4);
+			__m128i in0_lo = _mm_unpacklo_epi8(in0, zero);
+			__m128i in0_hi = _mm_unpackhi_epi8(in0, zero);
+			__m128i in1_lo = _mm_unpacklo_epi8(in1, zero);
+			__m128i in1_hi = _mm_unpackhi_epi8(in1, zero);
+
+			__m128i y0 = dot_rgba(in0_lo, in0_hi, coef_y);
+			__m128i y1 = dot_rgba(in1_lo, in1_hi, coef_y);
+			y0 = _mm_srai_epi32(_mm_add_epi32(y0, y_round), 8);
+			y1 = _mm_srai_epi32(_mm_add_epi32(y1, y_round), 8);
+			__m128i lum = _mm_add_epi16(_mm_packs_epi32(y0, y1),
+						    y_offset);
+			lum = _mm_packus_epi16(lum, lum);
+			store_32(lum0 + x, lum);
+			store_32(lum1 + x, _mm_srli_si128(lum, 4));
+
+			/* both chroma blocks end up in the low 64 bits */
+			__m128i blocks = _mm_unpacklo_epi64(
+				sum_rgba_2x2(in0_lo, in1_lo),
+				sum_rgba_2x2(in0_hi, in1_hi));
+			__m128i u = dot_rgba(blocks, blocks, coef_u);
+			__m128i v = dot_rgba(blocks, blocks, coef_v);
+			u = _mm_srai_epi32(_mm_add_epi32(u, uv_round), 10);
+			v = _mm_srai_epi32(_mm_add_epi32(v, uv_round), 10);
+			__m128i uv16 =
+				_mm_unpacklo_epi16(_mm_packs_epi32(u, u),
+						   _mm_packs_epi32(v, v));
+			uv16 = _mm_add_epi16(uv16, uv_offset);
+			uv16 = _mm_packus_epi16(uv16, uv16);
+			store_32(uv + x, uv16);
+		}
+
+		for (; x < width; x += 2) {
+			const uint8_t *p[4] = {row0 + x * 4, row0 + x * 4 + 4,
+					       row1 + x * 4, row1 + x * 4 + 4};
+			int r = 0, g = 0, b = 0;
+
+			lum0[x] = rgb_to_y(p[0], bgra);
+			lum0[x + 1] = rgb_to_y(p[1], bgra);
+			lum1[x] = rgb_to_y(p[2], bgra);
+			lum1[x + 1] = rgb_to_y(p[3], bgra);
+
+			for (size_t i = 0; i < 4; i++) {
+				r += p[i][bgra ? 2 : 0];
+				g += p[i][1];
+				b += p[i][bgra ? 0 : 2];
+			}
+
+			int u = BT709_U_R * r + BT709_U_G * g + BT709_U_B * b;
+			int v = BT709_V_R * r + BT709_V_G * g + BT709_V_B * b;
+			uv[x] = (uint8_t)(((u + 512) >> 10) + 128);
+			uv[x + 1] = (uint8_t)(((v + 512) >> 10) + 128);
+		}
+	}
+}
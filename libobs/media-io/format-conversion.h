@@ -52,10 +52,55 @@ EXPORT void decompress_420(const uint8_t *const input[],
 			   uint32_t end_y, uint8_t *output,
 			   uint32_t out_linesize);
 
+/*
+ * 10-bit variants, only the most significant 8 bits of each sample are kept
+ */
+
+EXPORT void decompress_p010(const uint8_t *const input[],
+			    const uint32_t in_linesize[], uint32_t start_y,
+			    uint32_t end_y, uint8_t *output,
+			    uint32_t out_linesize);
+
+EXPORT void decompress_i010(const uint8_t *const input[],
+			    const uint32_t in_linesize[], uint32_t start_y,
+			    uint32_t end_y, uint8_t *output,
+			    uint32_t out_linesize);
+
+/* planar 444 with alpha, the alpha is stored in the most significant byte */
+EXPORT void decompress_yuva444(const uint8_t *const input[],
+			       const uint32_t in_linesize[], uint32_t start_y,
+			       uint32_t end_y, uint8_t *output,
+			       uint32_t out_linesize);
+
 EXPORT void decompress_422(const uint8_t *input, uint32_t in_linesize,
 			   uint32_t start_y, uint32_t end_y, uint8_t *output,
 			   uint32_t out_linesize, bool leading_lum);
 
+/*
+ * Fast paths of the video scaler.  The width and rows are those of the
+ * output, and start_y/end_y have to be even.
+ */
+
+EXPORT void convert_nv12_to_i420(const uint8_t *const input[],
+				 const uint32_t in_linesize[], uint32_t width,
+				 uint32_t start_y, uint32_t end_y,
+				 uint8_t *output[],
+				 const uint32_t out_linesize[]);
+
+/* box filter, the input is twice the size of the output */
+EXPORT void downscale_nv12_2x(const uint8_t *const input[],
+			      const uint32_t in_linesize[], uint32_t width,
+			      uint32_t start_y, uint32_t end_y,
+			      uint8_t *output[],
+			      const uint32_t out_linesize[]);
+
+/* BT.709 partial range, bgra also covers BGRX */
+EXPORT void convert_rgba_to_nv12_709(const uint8_t *input,
+				     uint32_t in_linesize, uint32_t width,
+				     uint32_t start_y, uint32_t end_y,
+				     uint8_t *output[],
+				     const uint32_t out_linesize[], bool bgra);
+
 #ifdef __cplusplus
 }
 #endif
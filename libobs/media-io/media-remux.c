@@ -19,24 +19,145 @@
 
 #include "../util/base.h"
 #include "../util/bmem.h"
+#include "../util/darray.h"
+#include "../util/dstr.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
 
 #include <libavformat/avformat.h>
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(59, 20, 100)
 #include <libavcodec/version.h>
 #endif
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <fcntl.h>
+#endif
 
 #ifndef FF_API_BUFFER_SIZE_T
 #define FF_API_BUFFER_SIZE_T (LIBAVUTIL_VERSION_MAJOR < 57)
 #endif
 
+/* large reads and writes keep the drive streaming when several jobs run at
+ * once, the default 32 KiB buffer makes them fight over the disk */
+#define AVIO_BUFFER_SIZE (1024 * 1024)
+
+/* space reserved up front for the moov atom of mp4/mov output, so faststart
+ * doesn't need to rewrite the whole file in av_write_trailer.  16 bytes per
+ * sample covers stsz, ctts and the chunk offsets with room to spare */
+#define MOOV_BASE_SIZE (64 * 1024)
+#define MOOV_BYTES_PER_SAMPLE 16
+
 struct media_remux_job {
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	char *in_filename;
+	char *out_filename;
+	FILE *in_file, *out_file;
+	AVIOContext *in_pb, *out_pb;
+
+	bool faststart;
+	bool reserve_moov;
+	int moov_size;
+	bool trailer_failed;
+	bool canceled;
 };
 
+/* ------------------------------------------------------------------------- */
+/* file I/O                                                                  */
+
+static int file_read(void *opaque, uint8_t *buf, int buf_size)
+{
+	FILE *file = opaque;
+	size_t size = fread(buf, 1, buf_size, file);
+
+	if (!size)
+		return feof(file) ? AVERROR_EOF : AVERROR(EIO);
+	return (int)size;
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int file_write(void *opaque, const uint8_t *buf, int buf_size)
+#else
+static int file_write(void *opaque, uint8_t *buf, int buf_size)
+#endif
+{
+	FILE *file = opaque;
+	size_t size = fwrite(buf, 1, buf_size, file);
+
+	return size == (size_t)buf_size ? buf_size : AVERROR(EIO);
+}
+
+static int64_t file_seek(void *opaque, int64_t offset, int whence)
+{
+	FILE *file = opaque;
+
+	if (whence == AVSEEK_SIZE)
+		return os_fgetsize(file);
+
+	whence &= ~AVSEEK_FORCE;
+	if (os_fseeki64(file, offset, whence) != 0)
+		return AVERROR(EIO);
+	return os_ftelli64(file);
+}
+
+static AVIOContext *open_file_io(FILE **file, const char *path, bool write)
+{
+	AVIOContext *pb = NULL;
+	uint8_t *buffer;
+
+#ifdef _WIN32
+	/* 'S' hints sequential access, which enables read-ahead */
+	*file = os_fopen(path, write ? "wb" : "rbS");
+#else
+	*file = os_fopen(path, write ? "wb" : "rb");
+#endif
+	if (!*file)
+		return NULL;
+
+	/* the AVIO buffer is big enough already, and faststart reads back
+	 * what was written through a separate handle */
+	if (write)
+		setvbuf(*file, NULL, _IONBF, 0);
+#ifdef __linux__
+	else
+		posix_fadvise(fileno(*file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	buffer = av_malloc(AVIO_BUFFER_SIZE);
+	if (buffer)
+		pb = avio_alloc_context(buffer, AVIO_BUFFER_SIZE, write, *file,
+					write ? NULL : file_read,
+					write ? file_write : NULL, file_seek);
+
+	if (!pb) {
+		av_free(buffer);
+		fclose(*file);
+		*file = NULL;
+	}
+
+	return pb;
+}
+
+static void close_file_io(AVIOContext **pb, FILE **file)
+{
+	if (*pb) {
+		if ((*pb)->write_flag)
+			avio_flush(*pb);
+		av_freep(&(*pb)->buffer);
+		avio_context_free(pb);
+	}
+
+	if (*file) {
+		fclose(*file);
+		*file = NULL;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 static inline void init_size(media_remux_job_t job, const char *in_filename)
 {
 #ifdef _MSC_VER
@@ -51,7 +172,21 @@ static inline void init_size(media_remux_job_t job, const char *in_filename)
 
 static inline bool init_input(media_remux_job_t job, const char *in_filename)
 {
-	int ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
+	int ret;
+
+	job->in_pb = open_file_io(&job->in_file, in_filename, false);
+	if (!job->in_pb) {
+		blog(LOG_ERROR, "media_remux: Could not open input file '%s'",
+		     in_filename);
+		return false;
+	}
+
+	job->ifmt_ctx = avformat_alloc_context();
+	if (!job->ifmt_ctx)
+		return false;
+	job->ifmt_ctx->pb = job->in_pb;
+
+	ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Could not open input file '%s'",
 		     in_filename);
@@ -184,20 +319,91 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 #endif
 
 	if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-		ret = avio_open(&job->ofmt_ctx->pb, out_filename,
-				AVIO_FLAG_WRITE);
-		if (ret < 0) {
+		job->out_pb = open_file_io(&job->out_file, out_filename, true);
+		if (!job->out_pb) {
 			blog(LOG_ERROR,
 			     "media_remux: Failed to open output"
 			     " file '%s'",
 			     out_filename);
 			return false;
 		}
+		job->ofmt_ctx->pb = job->out_pb;
 	}
 
 	return true;
 }
 
+static inline bool is_mov_format(const AVOutputFormat *format)
+{
+	return strcmp(format->name, "mp4") == 0 ||
+	       strcmp(format->name, "mov") == 0;
+}
+
+/* estimates the number of samples from the duration and frame rates, returns
+ * 0 if any stream can't be estimated */
+static int estimate_moov_size(AVFormatContext *ifmt_ctx)
+{
+	double duration, size;
+	double samples = 0.0;
+
+	if (ifmt_ctx->duration <= 0)
+		return 0;
+	duration = (double)ifmt_ctx->duration / AV_TIME_BASE;
+
+	for (unsigned i = 0; i < ifmt_ctx->nb_streams; i++) {
+		AVStream *stream = ifmt_ctx->streams[i];
+		AVCodecParameters *par = stream->codecpar;
+		double rate = 0.0;
+
+		if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+			rate = av_q2d(stream->avg_frame_rate);
+			if (rate <= 0.0)
+				rate = av_q2d(stream->r_frame_rate);
+		} else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+			int frame_size = par->frame_size > 0 ? par->frame_size
+							     : 1024;
+			rate = (double)par->sample_rate / frame_size;
+		}
+
+		if (rate <= 0.0)
+			return 0;
+		samples += duration * rate;
+	}
+
+	/* a quarter extra for variable frame rates and rough durations */
+	size = MOOV_BASE_SIZE + samples * 1.25 * MOOV_BYTES_PER_SAMPLE;
+	return size < (double)INT_MAX ? (int)size : 0;
+}
+
+static bool open_job(media_remux_job_t job)
+{
+	if (!init_input(job, job->in_filename))
+		return false;
+	if (!init_output(job, job->out_filename))
+		return false;
+
+	job->faststart = is_mov_format(job->ofmt_ctx->oformat);
+	job->moov_size = job->faststart && job->reserve_moov
+				 ? estimate_moov_size(job->ifmt_ctx)
+				 : 0;
+	job->trailer_failed = false;
+	job->canceled = false;
+	return true;
+}
+
+static void close_job(media_remux_job_t job)
+{
+	avformat_close_input(&job->ifmt_ctx);
+	close_file_io(&job->in_pb, &job->in_file);
+
+	if (job->ofmt_ctx) {
+		job->ofmt_ctx->pb = NULL;
+		avformat_free_context(job->ofmt_ctx);
+		job->ofmt_ctx = NULL;
+	}
+	close_file_io(&job->out_pb, &job->out_file);
+}
+
 bool media_remux_job_create(media_remux_job_t *job, const char *in_filename,
 			    const char *out_filename)
 {
@@ -215,12 +421,13 @@ bool media_remux_job_create(media_remux_job_t *job, const char *in_filename,
 	if (!*job)
 		return false;
 
-	init_size(*job, in_filename);
+	(*job)->in_filename = bstrdup(in_filename);
+	(*job)->out_filename = bstrdup(out_filename);
+	(*job)->reserve_moov = true;
 
-	if (!init_input(*job, in_filename))
-		goto fail;
+	init_size(*job, in_filename);
 
-	if (!init_output(*job, out_filename))
+	if (!open_job(*job))
 		goto fail;
 
 	return true;
@@ -264,8 +471,11 @@ static inline int process_packets(media_remux_job_t job,
 
 		if (callback != NULL && throttle++ > 10) {
 			float progress = pkt.pos / (float)job->in_size * 100.f;
-			if (!callback(data, progress))
+			if (!callback(data, progress)) {
+				av_packet_unref(&pkt);
+				job->canceled = true;
 				break;
+			}
 			throttle = 0;
 		}
 
@@ -291,16 +501,20 @@ static inline int process_packets(media_remux_job_t job,
 	return ret;
 }
 
-bool media_remux_job_process(media_remux_job_t job,
-			     media_remux_progress_callback callback, void *data)
+static bool remux(media_remux_job_t job, media_remux_progress_callback callback,
+		  void *data)
 {
+	AVDictionary *opts = NULL;
 	int ret;
 	bool success = false;
 
-	if (!job)
-		return success;
+	if (job->moov_size)
+		av_dict_set_int(&opts, "moov_size", job->moov_size, 0);
+	else if (job->faststart)
+		av_dict_set(&opts, "movflags", "faststart", 0);
 
-	ret = avformat_write_header(job->ofmt_ctx, NULL);
+	ret = avformat_write_header(job->ofmt_ctx, &opts);
+	av_dict_free(&opts);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Error opening output file: %s",
 		     av_err2str(ret));
@@ -317,12 +531,39 @@ bool media_remux_job_process(media_remux_job_t job,
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: av_write_trailer: %s",
 		     av_err2str(ret));
+		job->trailer_failed = true;
 		success = false;
 	}
 
 	if (callback != NULL)
 		callback(data, 100.f);
 
+	return success && !job->canceled;
+}
+
+bool media_remux_job_process(media_remux_job_t job,
+			     media_remux_progress_callback callback, void *data)
+{
+	bool success;
+
+	if (!job)
+		return false;
+
+	success = remux(job, callback, data);
+
+	/* the sample count estimate was off, which should be rare.  the
+	 * output is unusable then, so do it again the slow way */
+	if (!success && job->moov_size && job->trailer_failed) {
+		blog(LOG_WARNING,
+		     "media_remux: Reserved moov atom was too small for '%s', "
+		     "remuxing again with faststart",
+		     job->out_filename);
+
+		close_job(job);
+		job->reserve_moov = false;
+		success = open_job(job) && remux(job, callback, data);
+	}
+
 	return success;
 }
 
@@ -331,12 +572,293 @@ void media_remux_job_destroy(media_remux_job_t job)
 	if (!job)
 		return;
 
-	avformat_close_input(&job->ifmt_ctx);
+	close_job(job);
 
-	if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE))
-		avio_close(job->ofmt_ctx->pb);
+	bfree(job->in_filename);
+	bfree(job->out_filename);
+	bfree(job);
+}
 
-	avformat_free_context(job->ofmt_ctx);
+/* ------------------------------------------------------------------------- */
+/* batches                                                                   */
 
-	bfree(job);
+#define DEFAULT_MAX_JOBS 4
+#define MAX_JOBS_PER_DEVICE 2
+
+enum batch_state {
+	BATCH_PENDING,
+	BATCH_RUNNING,
+	BATCH_DONE,
+};
+
+struct batch_entry {
+	char *in_filename;
+	char *out_filename;
+	uint64_t in_device;
+	uint64_t out_device;
+
+	enum batch_state state;
+	bool success;
+};
+
+struct batch_progress {
+	struct media_remux_batch *batch;
+	size_t idx;
+};
+
+struct media_remux_batch {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	DARRAY(struct batch_entry) entries;
+	DARRAY(pthread_t) threads;
+	size_t max_jobs;
+	bool started;
+	volatile bool canceled;
+
+	media_remux_batch_progress_callback *progress;
+	media_remux_batch_finished_callback *finished;
+	void *data;
+};
+
+/* outputs don't exist yet, so they're looked up by their directory */
+static uint64_t get_device(const char *path, bool parent)
+{
+	struct stat st = {0};
+	struct dstr dir = {0};
+
+	if (parent) {
+		const char *slash = strrchr(path, '/');
+		const char *backslash = strrchr(path, '\\');
+		if (backslash > slash)
+			slash = backslash;
+
+		if (slash)
+			dstr_ncopy(&dir, path, slash - path + 1);
+		else
+			dstr_copy(&dir, ".");
+		path = dir.array;
+	}
+
+	os_stat(path, &st);
+	dstr_free(&dir);
+	return (uint64_t)st.st_dev;
+}
+
+static bool device_available(struct media_remux_batch *batch, uint64_t device)
+{
+	size_t jobs = 0;
+
+	for (size_t i = 0; i < batch->entries.num; i++) {
+		struct batch_entry *entry = &batch->entries.array[i];
+		if (entry->state == BATCH_RUNNING &&
+		    (entry->in_device == device || entry->out_device == device))
+			jobs++;
+	}
+
+	return jobs < MAX_JOBS_PER_DEVICE;
+}
+
+static size_t next_entry(struct media_remux_batch *batch, bool *pending)
+{
+	*pending = false;
+
+	for (size_t i = 0; i < batch->entries.num; i++) {
+		struct batch_entry *entry = &batch->entries.array[i];
+		if (entry->state != BATCH_PENDING)
+			continue;
+
+		*pending = true;
+		if (device_available(batch, entry->in_device) &&
+		    device_available(batch, entry->out_device))
+			return i;
+	}
+
+	return DARRAY_INVALID;
+}
+
+static bool batch_progress(void *data, float percent)
+{
+	struct batch_progress *bp = data;
+	struct media_remux_batch *batch = bp->batch;
+
+	if (os_atomic_load_bool(&batch->canceled))
+		return false;
+	return !batch->progress ||
+	       batch->progress(batch->data, bp->idx, percent);
+}
+
+static bool run_entry(struct media_remux_batch *batch, size_t idx,
+		      const char *in_filename, const char *out_filename)
+{
+	struct batch_progress bp = {batch, idx};
+	media_remux_job_t job;
+	bool success = false;
+
+	if (media_remux_job_create(&job, in_filename, out_filename)) {
+		success = media_remux_job_process(job, batch_progress, &bp);
+		media_remux_job_destroy(job);
+	}
+
+	if (!success)
+		blog(LOG_WARNING, "media_remux: Failed to remux '%s'",
+		     in_filename);
+	return success;
+}
+
+static void *batch_thread(void *data)
+{
+	struct media_remux_batch *batch = data;
+
+	os_set_thread_name("media_remux_batch");
+
+	pthread_mutex_lock(&batch->mutex);
+
+	while (!os_atomic_load_bool(&batch->canceled)) {
+		bool pending;
+		size_t idx = next_entry(batch, &pending);
+
+		if (idx == DARRAY_INVALID) {
+			if (!pending)
+				break;
+			pthread_cond_wait(&batch->cond, &batch->mutex);
+			continue;
+		}
+
+		/* entries can't be added once started, so this stays valid */
+		struct batch_entry *entry = &batch->entries.array[idx];
+		entry->state = BATCH_RUNNING;
+		pthread_mutex_unlock(&batch->mutex);
+
+		bool success = run_entry(batch, idx, entry->in_filename,
+					 entry->out_filename);
+		if (batch->finished)
+			batch->finished(batch->data, idx, success);
+
+		pthread_mutex_lock(&batch->mutex);
+		entry->state = BATCH_DONE;
+		entry->success = success;
+		pthread_cond_broadcast(&batch->cond);
+	}
+
+	pthread_mutex_unlock(&batch->mutex);
+	return NULL;
+}
+
+media_remux_batch_t media_remux_batch_create(size_t max_jobs)
+{
+	struct media_remux_batch *batch = bzalloc(sizeof(*batch));
+
+	if (pthread_mutex_init(&batch->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (pthread_cond_init(&batch->cond, NULL) != 0)
+		goto fail_cond;
+
+	if (!max_jobs) {
+		int cores = os_get_logical_cores();
+		max_jobs = cores > 0 && cores < DEFAULT_MAX_JOBS
+				   ? (size_t)cores
+				   : DEFAULT_MAX_JOBS;
+	}
+	batch->max_jobs = max_jobs;
+	return batch;
+
+fail_cond:
+	pthread_mutex_destroy(&batch->mutex);
+fail_mutex:
+	bfree(batch);
+	return NULL;
+}
+
+size_t media_remux_batch_add(media_remux_batch_t batch,
+			     const char *in_filename, const char *out_filename)
+{
+	struct batch_entry *entry;
+
+	if (!batch || batch->started || !in_filename || !out_filename)
+		return DARRAY_INVALID;
+
+	entry = da_push_back_new(batch->entries);
+	entry->in_filename = bstrdup(in_filename);
+	entry->out_filename = bstrdup(out_filename);
+	entry->in_device = get_device(in_filename, false);
+	entry->out_device = get_device(out_filename, true);
+	return batch->entries.num - 1;
+}
+
+bool media_remux_batch_start(media_remux_batch_t batch,
+			     media_remux_batch_progress_callback progress,
+			     media_remux_batch_finished_callback finished,
+			     void *data)
+{
+	size_t threads;
+
+	if (!batch || batch->started || !batch->entries.num)
+		return false;
+
+	batch->progress = progress;
+	batch->finished = finished;
+	batch->data = data;
+	batch->started = true;
+
+	threads = batch->entries.num < batch->max_jobs ? batch->entries.num
+						       : batch->max_jobs;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, batch_thread, batch) != 0) {
+			blog(LOG_WARNING, "media_remux: Failed to create "
+					  "batch thread");
+			break;
+		}
+		da_push_back(batch->threads, &thread);
+	}
+
+	return batch->threads.num > 0;
+}
+
+void media_remux_batch_cancel(media_remux_batch_t batch)
+{
+	if (!batch)
+		return;
+
+	pthread_mutex_lock(&batch->mutex);
+	os_atomic_set_bool(&batch->canceled, true);
+	pthread_cond_broadcast(&batch->cond);
+	pthread_mutex_unlock(&batch->mutex);
+}
+
+bool media_remux_batch_wait(media_remux_batch_t batch)
+{
+	bool success;
+
+	if (!batch)
+		return false;
+
+	for (size_t i = 0; i < batch->threads.num; i++)
+		pthread_join(batch->threads.array[i], NULL);
+	da_free(batch->threads);
+
+	success = batch->started;
+	for (size_t i = 0; i < batch->entries.num; i++)
+		success = success && batch->entries.array[i].success;
+	return success;
+}
+
+void media_remux_batch_destroy(media_remux_batch_t batch)
+{
+	if (!batch)
+		return;
+
+	media_remux_batch_cancel(batch);
+	media_remux_batch_wait(batch);
+
+	for (size_t i = 0; i < batch->entries.num; i++) {
+		bfree(batch->entries.array[i].in_filename);
+		bfree(batch->entries.array[i].out_filename);
+	}
+	da_free(batch->entries);
+
+	pthread_cond_destroy(&batch->cond);
+	pthread_mutex_destroy(&batch->mutex);
+	bfree(batch);
 }
@@ -36,6 +36,42 @@ EXPORT bool media_remux_job_process(media_remux_job_t job,
 				    void *data);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
+/*
+ * Batch remuxing
+ *
+ *   Runs a list of remux jobs on a few worker threads.  At most max_jobs run
+ * at once, and no more than two of them read from or write to the same
+ * drive, so a batch on a single disk doesn't end up seeking between files.
+ * The callbacks are called from the worker threads with the index returned
+ * by media_remux_batch_add.  Returning false from the progress callback
+ * stops that job.
+ */
+
+struct media_remux_batch;
+typedef struct media_remux_batch *media_remux_batch_t;
+
+typedef bool(media_remux_batch_progress_callback)(void *data, size_t job,
+						  float percent);
+typedef void(media_remux_batch_finished_callback)(void *data, size_t job,
+						  bool success);
+
+/* max_jobs 0 picks a default based on the number of cores */
+EXPORT media_remux_batch_t media_remux_batch_create(size_t max_jobs);
+/* returns (size_t)-1 if the batch was already started */
+EXPORT size_t media_remux_batch_add(media_remux_batch_t batch,
+				    const char *in_filename,
+				    const char *out_filename);
+EXPORT bool
+media_remux_batch_start(media_remux_batch_t batch,
+			media_remux_batch_progress_callback progress,
+			media_remux_batch_finished_callback finished,
+			void *data);
+/* jobs that haven't started yet are skipped and not reported */
+EXPORT void media_remux_batch_cancel(media_remux_batch_t batch);
+/* returns true if every job succeeded */
+EXPORT bool media_remux_batch_wait(media_remux_batch_t batch);
+EXPORT void media_remux_batch_destroy(media_remux_batch_t batch);
+
 #ifdef __cplusplus
 }
 #endif
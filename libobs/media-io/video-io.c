@@ -36,8 +36,8 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
-	int count;
+	volatile long skipped;
+	volatile long count;
 };
 
 struct video_input {
@@ -56,6 +56,14 @@ struct video_input {
 	uint32_t frame_rate_divisor;
 	uint32_t frame_rate_divisor_counter;
 
+	/* set when this input scaled the current frame itself, so inputs
+	 * with an identical conversion can reuse the result */
+	bool scaled;
+
+	/* connected without an explicit size, so follows the output size */
+	bool auto_width;
+	bool auto_height;
+
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
 };
@@ -71,21 +79,27 @@ struct video_output {
 	struct video_output_info info;
 
 	pthread_t thread;
-	pthread_mutex_t data_mutex;
 	bool stop;
+	struct os_thread_scheduling sched;
 
 	os_sem_t *update_semaphore;
 	uint64_t frame_time;
 	volatile long skipped_frames;
 	volatile long total_frames;
+	volatile long stalled_frames;
 
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
 
-	size_t available_frames;
-	size_t first_added;
-	size_t last_added;
+	/* single producer (video_output_lock_frame/unlock_frame) single
+	 * consumer (video_thread) ring.  first_added is only written by the
+	 * consumer, last_added only by the producer, and available_frames
+	 * hands slots back and forth between them. */
+	volatile long available_frames;
+	volatile long first_added;
+	volatile long last_added;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
+	os_event_t *slot_event;
 
 	struct video_output *parent;
 
@@ -126,20 +140,52 @@ static inline bool scale_video_output(struct video_input *input,
 	return success;
 }
 
+static inline bool same_conversion(const struct video_input *a,
+				   const struct video_input *b)
+{
+	return a->conversion.format == b->conversion.format &&
+	       a->conversion.width == b->conversion.width &&
+	       a->conversion.height == b->conversion.height &&
+	       a->conversion.range == b->conversion.range &&
+	       a->conversion.colorspace == b->conversion.colorspace &&
+	       a->frame_rate_divisor == b->frame_rate_divisor;
+}
+
+/* Inputs that only share a conversion but not the frame rate divisor are
+ * not deduplicated, as the scaled frame is kept in the buffers of the input
+ * that produced it, which are cycled at that input's rate. */
+static inline bool reuse_scaled_frame(struct video_output *video, size_t idx,
+				      struct video_data *data)
+{
+	struct video_input *input = video->inputs.array + idx;
+
+	for (size_t i = 0; i < idx; i++) {
+		struct video_input *other = video->inputs.array + i;
+		struct video_frame *frame;
+
+		if (!other->scaled || !same_conversion(input, other))
+			continue;
+
+		frame = &other->frame[other->cur_frame];
+		for (size_t p = 0; p < MAX_AV_PLANES; p++) {
+			data->data[p] = frame->data[p];
+			data->linesize[p] = frame->linesize[p];
+		}
+		return true;
+	}
+
+	return false;
+}
+
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
 	bool complete;
-	bool skipped;
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
-
 	frame_info = &video->cache[video->first_added];
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	pthread_mutex_lock(&video->input_mutex);
@@ -156,36 +202,43 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		    input->frame_rate_divisor)
 			input->frame_rate_divisor_counter = 0;
 
+		input->scaled = false;
+
 		if (skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
+		if (input->scaler && reuse_scaled_frame(video, i, &frame)) {
+			input->callback(input->param, &frame);
+		} else if (scale_video_output(input, &frame)) {
+			input->scaled = !!input->scaler;
 			input->callback(input->param, &frame);
+		}
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
-
 	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
-	skipped = frame_info->skipped > 0;
+	complete = os_atomic_dec_long(&frame_info->count) == 0;
 
 	if (complete) {
-		if (++video->first_added == video->info.cache_size)
-			video->first_added = 0;
-
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
-		--frame_info->skipped;
+		long next = video->first_added + 1;
+		if (next == (long)video->info.cache_size)
+			next = 0;
+
+		/* publish the new read position before handing the slot back
+		 * so that an empty ring is always seen at the right slot */
+		os_atomic_store_long(&video->first_added, next);
+		os_atomic_inc_long(&video->available_frames);
+		os_event_signal(video->slot_event);
+
+	} else if (os_atomic_load_long(&frame_info->skipped) > 0) {
+		/* only this thread decrements, so the slot can't underflow */
+		os_atomic_dec_long(&frame_info->skipped);
 		os_atomic_inc_long(&video->skipped_frames);
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	return complete;
@@ -194,8 +247,10 @@ static inline bool video_output_cur_frame(struct video_output *video)
 static void *video_thread(void *param)
 {
 	struct video_output *video = param;
+	long sched_serial = 0;
 
 	os_set_thread_name("video-io: video thread");
+	bmem_set_thread_tag(BMEM_TAG_VIDEO);
 
 	const char *video_thread_name =
 		profile_store_name(obs_get_profiler_name_store(),
@@ -205,6 +260,10 @@ static void *video_thread(void *param)
 		if (video->stop)
 			break;
 
+		if (!os_thread_scheduling_update(&video->sched, &sched_serial))
+			blog(LOG_WARNING, "Could not apply video thread "
+					  "scheduling");
+
 		profile_start(video_thread_name);
 		while (!video->stop && !video_output_cur_frame(video)) {
 			os_atomic_inc_long(&video->total_frames);
@@ -258,11 +317,11 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	out->frame_time =
 		util_mul_div64(1000000000ULL, info->fps_den, info->fps_num);
 
-	if (pthread_mutex_init_recursive(&out->data_mutex) != 0)
-		goto fail0;
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
-		goto fail1;
+		goto fail0;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
+		goto fail1;
+	if (os_event_init(&out->slot_event, OS_EVENT_TYPE_AUTO) != 0)
 		goto fail2;
 	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
 		goto fail3;
@@ -273,11 +332,11 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	return VIDEO_OUTPUT_SUCCESS;
 
 fail3:
-	os_sem_destroy(out->update_semaphore);
+	os_event_destroy(out->slot_event);
 fail2:
-	pthread_mutex_destroy(&out->input_mutex);
+	os_sem_destroy(out->update_semaphore);
 fail1:
-	pthread_mutex_destroy(&out->data_mutex);
+	pthread_mutex_destroy(&out->input_mutex);
 fail0:
 	bfree(out);
 	return VIDEO_OUTPUT_FAIL;
@@ -301,7 +360,7 @@ void video_output_close(video_t *video)
 
 	pthread_mutex_unlock(&video->input_mutex);
 	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
+	os_event_destroy(video->slot_event);
 	pthread_mutex_destroy(&video->input_mutex);
 
 	bfree(video);
@@ -392,6 +451,7 @@ static inline void reset_frames(video_t *video)
 {
 	os_atomic_set_long(&video->skipped_frames, 0);
 	os_atomic_set_long(&video->total_frames, 0);
+	os_atomic_set_long(&video->stalled_frames, 0);
 }
 
 static const video_t *get_const_root(const video_t *video)
@@ -448,6 +508,8 @@ bool video_output_connect2(
 			input.conversion.colorspace = video->info.colorspace;
 		}
 
+		input.auto_width = !conversion || !conversion->width;
+		input.auto_height = !conversion || !conversion->height;
 		if (input.conversion.width == 0)
 			input.conversion.width = video->info.width;
 		if (input.conversion.height == 0)
@@ -470,6 +532,80 @@ bool video_output_connect2(
 	return success;
 }
 
+/* how long video_output_set_size waits for queued frames to be output */
+#define SET_SIZE_DRAIN_TIMEOUT_MS 1000
+#define SET_SIZE_DRAIN_WAIT_MS 10
+
+static bool wait_for_empty_cache(video_t *video)
+{
+	unsigned long waited = 0;
+
+	while (os_atomic_load_long(&video->available_frames) !=
+	       (long)video->info.cache_size) {
+		if (video->stop || waited >= SET_SIZE_DRAIN_TIMEOUT_MS)
+			return false;
+
+		os_event_timedwait(video->slot_event, SET_SIZE_DRAIN_WAIT_MS);
+		waited += SET_SIZE_DRAIN_WAIT_MS;
+	}
+
+	return true;
+}
+
+bool video_output_set_size(video_t *video, uint32_t width, uint32_t height)
+{
+	if (!video || !width || !height)
+		return false;
+
+	video = get_root(video);
+
+	if (video->info.width == width && video->info.height == height)
+		return true;
+
+	if (!wait_for_empty_cache(video)) {
+		blog(LOG_WARNING, "video_output_set_size: Timed out waiting "
+				  "for queued frames");
+		return false;
+	}
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	for (size_t i = 0; i < video->info.cache_size; i++)
+		video_frame_free((struct video_frame *)&video->cache[i]);
+
+	video->info.width = width;
+	video->info.height = height;
+	init_cache(video);
+
+	for (size_t i = video->inputs.num; i > 0; i--) {
+		struct video_input *input = video->inputs.array + (i - 1);
+
+		video_input_free(input);
+		memset(input->frame, 0, sizeof(input->frame));
+		input->scaler = NULL;
+		input->cur_frame = 0;
+		input->scaled = false;
+
+		if (input->auto_width)
+			input->conversion.width = width;
+		if (input->auto_height)
+			input->conversion.height = height;
+
+		if (!video_input_init(input, video)) {
+			blog(LOG_ERROR, "video_output_set_size: Disconnecting "
+					"input that could not be rescaled");
+			da_erase(video->inputs, i - 1);
+		}
+	}
+
+	if (!video->inputs.num)
+		os_atomic_set_bool(&video->raw_active, false);
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return true;
+}
+
 static void log_skipped(video_t *video)
 {
 	long skipped = os_atomic_load_long(&video->skipped_frames);
@@ -527,43 +663,76 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+/* called when the ring is full: the most recently added frame is repeated
+ * instead, unless the video thread just finished with it */
+static inline bool repeat_last_frame(struct video_output *video, long count)
+{
+	struct cached_frame_info *cfi = &video->cache[video->last_added];
+	long cur = os_atomic_load_long(&cfi->count);
+
+	while (cur > 0) {
+		if (os_atomic_compare_exchange_long(&cfi->count, &cur,
+						    cur + count)) {
+			os_atomic_add_long(&cfi->skipped, count);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 			     int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
+	long available;
 
 	if (!video)
 		return false;
 
 	video = get_root(video);
 
-	pthread_mutex_lock(&video->data_mutex);
+	available = os_atomic_load_long(&video->available_frames);
 
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
+	if (available == 0) {
+		os_atomic_inc_long(&video->stalled_frames);
 
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
+		if (!repeat_last_frame(video, count)) {
+			/* the slot is being released right now, so there is
+			 * no frame left to carry the repeat count */
+			os_atomic_add_long(&video->skipped_frames, count);
 		}
+		return false;
+	}
 
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
+	if (available == (long)video->info.cache_size) {
+		/* ring is empty, the consumer is idle on its read position */
+		video->last_added = os_atomic_load_long(&video->first_added);
+	} else if (++video->last_added == (long)video->info.cache_size) {
+		video->last_added = 0;
+	}
 
-		memcpy(frame, &cfi->frame, sizeof(*frame));
+	cfi = &video->cache[video->last_added];
+	cfi->frame.timestamp = timestamp;
+	os_atomic_set_long(&cfi->count, count);
+	os_atomic_set_long(&cfi->skipped, 0);
 
-		locked = true;
-	}
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
+}
 
-	pthread_mutex_unlock(&video->data_mutex);
+bool video_output_wait_for_slot(video_t *video, unsigned long milliseconds)
+{
+	if (!video)
+		return false;
 
-	return locked;
+	video = get_root(video);
+
+	if (os_atomic_load_long(&video->available_frames))
+		return true;
+
+	os_event_timedwait(video->slot_event, milliseconds);
+	return os_atomic_load_long(&video->available_frames) != 0;
 }
 
 void video_output_unlock_frame(video_t *video)
@@ -573,12 +742,8 @@ void video_output_unlock_frame(video_t *video)
 
 	video = get_root(video);
 
-	pthread_mutex_lock(&video->data_mutex);
-
-	video->available_frames--;
+	os_atomic_dec_long(&video->available_frames);
 	os_sem_post(video->update_semaphore);
-
-	pthread_mutex_unlock(&video->data_mutex);
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
@@ -586,6 +751,14 @@ uint64_t video_output_get_frame_time(const video_t *video)
 	return video ? video->frame_time : 0;
 }
 
+void video_output_set_thread_scheduling(video_t *video,
+					enum os_thread_priority priority,
+					uint64_t affinity)
+{
+	if (video)
+		os_thread_scheduling_set(&video->sched, priority, affinity);
+}
+
 void video_output_stop(video_t *video)
 {
 	void *thread_ret;
@@ -647,6 +820,12 @@ uint32_t video_output_get_total_frames(const video_t *video)
 		&get_const_root(video)->total_frames);
 }
 
+uint32_t video_output_get_stalled_frames(const video_t *video)
+{
+	return (uint32_t)os_atomic_load_long(
+		&get_const_root(video)->stalled_frames);
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
@@ -19,6 +19,7 @@
 
 #include "media-io-defs.h"
 #include "../util/c99defs.h"
+#include "../util/threading.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -325,10 +326,23 @@ video_output_get_info(const video_t *video);
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 				    int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+/* waits until video_output_lock_frame has a free frame, false on timeout */
+EXPORT bool video_output_wait_for_slot(video_t *video,
+				       unsigned long milliseconds);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
+/* applied by the video thread on its next frame */
+EXPORT void video_output_set_thread_scheduling(video_t *video,
+					       enum os_thread_priority priority,
+					       uint64_t affinity);
 EXPORT bool video_output_stopped(video_t *video);
 
+/* Changes the frame size of a running video output.  Must be called by the
+ * thread that locks frames, between frames.  Inputs connected without an
+ * explicit size follow the new size, the others are scaled to their size. */
+EXPORT bool video_output_set_size(video_t *video, uint32_t width,
+				  uint32_t height);
+
 EXPORT enum video_format video_output_get_format(const video_t *video);
 EXPORT uint32_t video_output_get_width(const video_t *video);
 EXPORT uint32_t video_output_get_height(const video_t *video);
@@ -337,6 +351,9 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/* number of frames for which the graphics thread found the frame cache full */
+EXPORT uint32_t video_output_get_stalled_frames(const video_t *video);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
@@ -16,18 +16,51 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/platform.h"
+#include "../util/task.h"
 #include "video-scaler.h"
+#include "format-conversion.h"
 
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libswscale/swscale.h>
 
+/* conversions common enough to be worth doing without swscale, they write
+ * straight into the output and are split into slices for big frames */
+enum scaler_fast_path {
+	FAST_PATH_NONE,
+	FAST_PATH_NV12_TO_I420,
+	FAST_PATH_NV12_DOWNSCALE_2X,
+	FAST_PATH_RGBA_TO_NV12,
+	FAST_PATH_BGRA_TO_NV12,
+};
+
+#define MAX_SLICES 4
+#define MIN_SLICED_PIXELS (1920 * 1080)
+
+struct scaler_slice {
+	struct video_scaler *scaler;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
+	uint8_t **output;
+	const uint32_t *out_linesize;
+	uint32_t start_y;
+	uint32_t end_y;
+};
+
 struct video_scaler {
 	struct SwsContext *swscale;
 	int src_height;
 	int dst_heights[4];
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
+
+	enum scaler_fast_path fast_path;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	size_t num_slices;
+	os_task_queue_t *slice_queues[MAX_SLICES - 1];
+	struct scaler_slice slices[MAX_SLICES];
 };
 
 static inline enum AVPixelFormat
@@ -145,6 +178,77 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 
 #define FIXED_1_0 (1 << 16)
 
+static inline enum video_range_type
+collapse_range(enum video_range_type range)
+{
+	return range == VIDEO_RANGE_FULL ? VIDEO_RANGE_FULL
+					 : VIDEO_RANGE_PARTIAL;
+}
+
+static enum scaler_fast_path get_fast_path(const struct video_scale_info *dst,
+					   const struct video_scale_info *src,
+					   enum video_scale_type type)
+{
+	bool same_size = dst->width == src->width &&
+			 dst->height == src->height;
+	bool same_range = collapse_range(dst->range) ==
+			  collapse_range(src->range);
+
+	if ((dst->width & 1) || (dst->height & 1))
+		return FAST_PATH_NONE;
+
+	if (src->format == VIDEO_FORMAT_NV12) {
+		if (!same_range)
+			return FAST_PATH_NONE;
+		if (dst->format == VIDEO_FORMAT_I420 && same_size)
+			return FAST_PATH_NV12_TO_I420;
+
+		/* an exact halving filtered with anything but point
+		 * sampling comes out as the average of each 2x2 block */
+		if (dst->format == VIDEO_FORMAT_NV12 &&
+		    dst->width * 2 == src->width &&
+		    dst->height * 2 == src->height &&
+		    type != VIDEO_SCALE_POINT && type != VIDEO_SCALE_BICUBIC)
+			return FAST_PATH_NV12_DOWNSCALE_2X;
+
+		return FAST_PATH_NONE;
+	}
+
+	if (dst->format != VIDEO_FORMAT_NV12 || !same_size ||
+	    collapse_range(dst->range) != VIDEO_RANGE_PARTIAL)
+		return FAST_PATH_NONE;
+	if (dst->colorspace != VIDEO_CS_DEFAULT &&
+	    dst->colorspace != VIDEO_CS_709 && dst->colorspace != VIDEO_CS_SRGB)
+		return FAST_PATH_NONE;
+
+	if (src->format == VIDEO_FORMAT_RGBA)
+		return FAST_PATH_RGBA_TO_NV12;
+	if (src->format == VIDEO_FORMAT_BGRA ||
+	    src->format == VIDEO_FORMAT_BGRX)
+		return FAST_PATH_BGRA_TO_NV12;
+
+	return FAST_PATH_NONE;
+}
+
+static void init_slices(struct video_scaler *scaler,
+			const struct video_scale_info *src)
+{
+	size_t slices = (size_t)os_get_logical_cores();
+
+	if (slices > MAX_SLICES)
+		slices = MAX_SLICES;
+	if ((uint64_t)src->width * src->height < MIN_SLICED_PIXELS)
+		slices = 1;
+
+	scaler->num_slices = 1;
+	for (size_t i = 1; i < slices; i++) {
+		scaler->slice_queues[i - 1] = os_task_queue_create();
+		if (!scaler->slice_queues[i - 1])
+			break;
+		scaler->num_slices++;
+	}
+}
+
 int video_scaler_create(video_scaler_t **scaler_out,
 			const struct video_scale_info *dst,
 			const struct video_scale_info *src,
@@ -168,6 +272,15 @@ int video_scaler_create(video_scaler_t **scaler_out,
 
 	scaler = bzalloc(sizeof(struct video_scaler));
 	scaler->src_height = src->height;
+	scaler->dst_width = dst->width;
+	scaler->dst_height = dst->height;
+	scaler->fast_path = get_fast_path(dst, src, type);
+
+	if (scaler->fast_path != FAST_PATH_NONE) {
+		init_slices(scaler, src);
+		*scaler_out = scaler;
+		return VIDEO_SCALER_SUCCESS;
+	}
 
 	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format_dst);
 	bool has_plane[4] = {0};
@@ -231,6 +344,9 @@ fail:
 void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
+		for (size_t i = 0; i + 1 < scaler->num_slices; i++)
+			os_task_queue_destroy(scaler->slice_queues[i]);
+
 		sws_freeContext(scaler->swscale);
 
 		if (scaler->dst_pointers[0])
@@ -240,6 +356,68 @@ void video_scaler_destroy(video_scaler_t *scaler)
 	}
 }
 
+static void scale_slice(void *param)
+{
+	struct scaler_slice *slice = param;
+	struct video_scaler *scaler = slice->scaler;
+	uint32_t width = scaler->dst_width;
+
+	switch (scaler->fast_path) {
+	case FAST_PATH_NV12_TO_I420:
+		convert_nv12_to_i420(slice->input, slice->in_linesize, width,
+				     slice->start_y, slice->end_y,
+				     slice->output, slice->out_linesize);
+		break;
+	case FAST_PATH_NV12_DOWNSCALE_2X:
+		downscale_nv12_2x(slice->input, slice->in_linesize, width,
+				  slice->start_y, slice->end_y, slice->output,
+				  slice->out_linesize);
+		break;
+	case FAST_PATH_RGBA_TO_NV12:
+	case FAST_PATH_BGRA_TO_NV12:
+		convert_rgba_to_nv12_709(
+			slice->input[0], slice->in_linesize[0], width,
+			slice->start_y, slice->end_y, slice->output,
+			slice->out_linesize,
+			scaler->fast_path == FAST_PATH_BGRA_TO_NV12);
+		break;
+	case FAST_PATH_NONE:
+		break;
+	}
+}
+
+static void scale_fast_path(video_scaler_t *scaler, uint8_t *output[],
+			    const uint32_t out_linesize[],
+			    const uint8_t *const input[],
+			    const uint32_t in_linesize[])
+{
+	size_t num = scaler->num_slices;
+	uint32_t rows = (scaler->dst_height / (uint32_t)num) & ~1U;
+
+	for (size_t i = 0; i < num; i++) {
+		struct scaler_slice *slice = &scaler->slices[i];
+
+		slice->scaler = scaler;
+		slice->input = input;
+		slice->in_linesize = in_linesize;
+		slice->output = output;
+		slice->out_linesize = out_linesize;
+		slice->start_y = rows * (uint32_t)i;
+		slice->end_y = (i + 1 == num) ? scaler->dst_height
+					      : slice->start_y + rows;
+	}
+
+	/* the calling thread does the first slice itself */
+	for (size_t i = 1; i < num; i++)
+		os_task_queue_queue_task(scaler->slice_queues[i - 1],
+					 scale_slice, &scaler->slices[i]);
+
+	scale_slice(&scaler->slices[0]);
+
+	for (size_t i = 1; i < num; i++)
+		os_task_queue_wait(scaler->slice_queues[i - 1]);
+}
+
 bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 			const uint32_t out_linesize[],
 			const uint8_t *const input[],
@@ -248,6 +426,12 @@ bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 	if (!scaler)
 		return false;
 
+	if (scaler->fast_path != FAST_PATH_NONE) {
+		scale_fast_path(scaler, output, out_linesize, input,
+				in_linesize);
+		return true;
+	}
+
 	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0,
 			    scaler->src_height, scaler->dst_pointers,
 			    scaler->dst_linesizes);
@@ -78,6 +78,15 @@ struct obs_volmeter {
 
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
+
+	/* latest levels in dB for obs_volmeter_get_levels, written by the
+	 * audio thread under a sequence count so that they can be read
+	 * without locking (odd while being written) */
+	volatile long levels_seq;
+	volatile long levels_read_seq;
+	float levels_magnitude[MAX_AUDIO_CHANNELS];
+	float levels_peak[MAX_AUDIO_CHANNELS];
+	float levels_input_peak[MAX_AUDIO_CHANNELS];
 };
 
 static float cubic_def_to_db(const float def)
@@ -204,6 +213,14 @@ static void signal_levels_updated(struct obs_volmeter *volmeter,
 				  const float peak[MAX_AUDIO_CHANNELS],
 				  const float input_peak[MAX_AUDIO_CHANNELS])
 {
+	const size_t size = sizeof(float) * MAX_AUDIO_CHANNELS;
+
+	os_atomic_inc_long(&volmeter->levels_seq);
+	memcpy(volmeter->levels_magnitude, magnitude, size);
+	memcpy(volmeter->levels_peak, peak, size);
+	memcpy(volmeter->levels_input_peak, input_peak, size);
+	os_atomic_inc_long(&volmeter->levels_seq);
+
 	pthread_mutex_lock(&volmeter->callback_mutex);
 	for (size_t i = volmeter->callbacks.num; i > 0; i--) {
 		struct meter_cb cb = volmeter->callbacks.array[i - 1];
@@ -934,6 +951,41 @@ void obs_volmeter_remove_callback(obs_volmeter_t *volmeter,
 	pthread_mutex_unlock(&volmeter->callback_mutex);
 }
 
+bool obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+			     float magnitude[MAX_AUDIO_CHANNELS],
+			     float peak[MAX_AUDIO_CHANNELS],
+			     float input_peak[MAX_AUDIO_CHANNELS])
+{
+	const size_t size = sizeof(float) * MAX_AUDIO_CHANNELS;
+	long seq;
+
+	if (!volmeter)
+		return false;
+
+	seq = os_atomic_load_long(&volmeter->levels_seq);
+	if (!seq || seq == os_atomic_load_long(&volmeter->levels_read_seq))
+		return false;
+
+	for (;;) {
+		if (seq & 1) {
+			seq = os_atomic_load_long(&volmeter->levels_seq);
+			continue;
+		}
+
+		memcpy(magnitude, volmeter->levels_magnitude, size);
+		memcpy(peak, volmeter->levels_peak, size);
+		memcpy(input_peak, volmeter->levels_input_peak, size);
+
+		long end_seq = os_atomic_load_long(&volmeter->levels_seq);
+		if (end_seq == seq)
+			break;
+		seq = end_seq;
+	}
+
+	os_atomic_set_long(&volmeter->levels_read_seq, seq);
+	return true;
+}
+
 float obs_mul_to_db(float mul)
 {
 	return mul_to_db(mul);
@@ -279,6 +279,23 @@ EXPORT void obs_volmeter_remove_callback(obs_volmeter_t *volmeter,
 					 obs_volmeter_updated_t callback,
 					 void *param);
 
+/**
+ * @brief Get the most recent levels of the volume meter without locking
+ *
+ * Meant for displays that redraw at a fixed rate and would otherwise have to
+ * take a callback from the audio thread for every source on every tick.
+ *
+ * @param volmeter pointer to the volume meter object
+ * @param magnitude receives the magnitude of each channel in dB
+ * @param peak receives the peak of each channel in dB
+ * @param input_peak receives the input peak of each channel in dB
+ * @return false if no levels have been received since the last call
+ */
+EXPORT bool obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+				    float magnitude[MAX_AUDIO_CHANNELS],
+				    float peak[MAX_AUDIO_CHANNELS],
+				    float input_peak[MAX_AUDIO_CHANNELS]);
+
 EXPORT float obs_mul_to_db(float mul);
 EXPORT float obs_db_to_mul(float db);
 
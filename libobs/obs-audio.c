@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include "obs-internal.h"
 #include "util/util_uint64.h"
+#include "media-io/audio-math.h"
 
 struct ts_info {
 	uint64_t start;
@@ -27,15 +28,23 @@ struct ts_info {
 #define DEBUG_AUDIO 0
 #define DEBUG_LAGGED_AUDIO 0
 
+/* Adds a source and everything below it to the render order, children
+ * first.  A source that is already in the render order is skipped together
+ * with its tree, so a nested scene used by several parents (or mixes) is
+ * only walked once per tick. */
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
 	struct obs_core_audio *audio = p;
 
-	if (da_find(audio->render_order, &source, 0) == DARRAY_INVALID) {
-		obs_source_t *s = obs_source_get_ref(source);
-		if (s)
-			da_push_back(audio->render_order, &s);
-	}
+	if (source->audio_render_tick == audio->render_tick)
+		return;
+	source->audio_render_tick = audio->render_tick;
+
+	obs_source_enum_active_sources(source, push_audio_tree, audio);
+
+	obs_source_t *s = obs_source_get_ref(source);
+	if (s)
+		da_push_back(audio->render_order, &s);
 
 	UNUSED_PARAMETER(parent);
 }
@@ -65,17 +74,11 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
-
-			mix += start_point;
-			end = aud + total_floats;
+		float *const *buf = get_audio_output_mix(source, mix_idx);
 
-			while (aud < end)
-				*(mix++) += *(aud++);
+		for (size_t ch = 0; ch < channels; ch++) {
+			audio_mix_add(mixes[mix_idx].data[ch] + start_point,
+				      buf[ch], total_floats);
 		}
 	}
 }
@@ -316,6 +319,8 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
 		   sample_rate;
 
+	metric_set(audio->buffering_metric, (int64_t)total_ms);
+
 	blog(LOG_INFO,
 	     "Enabling fixed audio buffering, total "
 	     "audio buffering is now %d milliseconds",
@@ -347,10 +352,24 @@ static void set_fixed_audio_buffering(struct obs_core_audio *audio,
 	*ts = new_ts;
 }
 
+static void signal_audio_buffering(obs_source_t *source, int ms,
+				   int total_ms)
+{
+	uint8_t stack[128];
+	struct calldata cd;
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+	calldata_set_ptr(&cd, "source", source);
+	calldata_set_int(&cd, "ms", ms);
+	calldata_set_int(&cd, "total_ms", total_ms);
+	signal_handler_signal(obs->signals, "audio_buffering", &cd);
+}
+
 static void add_audio_buffering(struct obs_core_audio *audio,
 				size_t sample_rate, struct ts_info *ts,
-				uint64_t min_ts, const char *buffering_name)
+				uint64_t min_ts, obs_source_t *buffering_source)
 {
+	const char *buffering_name = obs_source_get_name(buffering_source);
 	struct ts_info new_ts;
 	uint64_t offset;
 	uint64_t frames;
@@ -381,11 +400,18 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
 		   sample_rate;
 
+	metric_set(audio->buffering_metric, (int64_t)total_ms);
+
 	blog(LOG_INFO,
 	     "adding %d milliseconds of audio buffering, total "
 	     "audio buffering is now %d milliseconds"
 	     " (source: %s)\n",
 	     (int)ms, (int)total_ms, buffering_name);
+
+	if (buffering_source)
+		os_atomic_add_long(&buffering_source->audio_buffering_ms,
+				   (long)ms);
+	signal_audio_buffering(buffering_source, (int)ms, (int)total_ms);
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG,
 	     "min_ts (%" PRIu64 ") < start timestamp "
@@ -451,8 +477,8 @@ static bool audio_buffer_insufficient(struct obs_source *source,
 	return false;
 }
 
-static inline const char *find_min_ts(struct obs_core_data *data,
-				      uint64_t *min_ts)
+static inline obs_source_t *find_min_ts(struct obs_core_data *data,
+					uint64_t *min_ts)
 {
 	obs_source_t *buffering_source = NULL;
 	struct obs_source *source = data->first_audio_source;
@@ -465,7 +491,7 @@ static inline const char *find_min_ts(struct obs_core_data *data,
 
 		source = (struct obs_source *)source->next_audio_source;
 	}
-	return buffering_source ? obs_source_get_name(buffering_source) : NULL;
+	return buffering_source;
 }
 
 static inline bool mark_invalid_sources(struct obs_core_data *data,
@@ -483,13 +509,91 @@ static inline bool mark_invalid_sources(struct obs_core_data *data,
 	return recalculate;
 }
 
-static inline const char *calc_min_ts(struct obs_core_data *data,
-				      size_t sample_rate, uint64_t *min_ts)
+static inline obs_source_t *calc_min_ts(struct obs_core_data *data,
+					size_t sample_rate, uint64_t *min_ts)
 {
-	const char *buffering_name = find_min_ts(data, min_ts);
+	obs_source_t *buffering_source = find_min_ts(data, min_ts);
 	if (mark_invalid_sources(data, sample_rate, *min_ts))
-		buffering_name = find_min_ts(data, min_ts);
-	return buffering_name;
+		buffering_source = find_min_ts(data, min_ts);
+	return buffering_source;
+}
+
+#define AUDIO_JITTER_WINDOW_NS 1000000000ULL
+
+/* headroom is how much audio a source has buffered past the tick being
+ * mixed.  returns false if the source would still need the buffering if it
+ * was one tick lower */
+static bool track_audio_headroom(obs_source_t *source, size_t sample_rate,
+				 const struct ts_info *ts)
+{
+	size_t frames = source->audio_input_buf[0].size / sizeof(float);
+	int64_t tick = (int64_t)(ts->end - ts->start);
+	int64_t headroom;
+
+	if (source->info.audio_render || source->audio_pending ||
+	    !source->audio_ts)
+		return true;
+
+	headroom = (int64_t)(source->audio_ts +
+			     audio_frames_to_ns(sample_rate, frames) - ts->end);
+
+	if (!source->audio_jitter_ts) {
+		source->audio_jitter_ts = ts->start;
+		source->audio_headroom_min = headroom;
+		source->audio_headroom_max = headroom;
+	} else if (headroom < source->audio_headroom_min) {
+		source->audio_headroom_min = headroom;
+	} else if (headroom > source->audio_headroom_max) {
+		source->audio_headroom_max = headroom;
+	}
+
+	if (ts->start - source->audio_jitter_ts >= AUDIO_JITTER_WINDOW_NS) {
+		os_atomic_store_int64(&source->audio_jitter,
+				      source->audio_headroom_max -
+					      source->audio_headroom_min);
+		source->audio_jitter_ts = 0;
+	}
+
+	return headroom >= tick;
+}
+
+/* once every source had a tick of headroom for buffering_reduce_ns, one tick
+ * of buffering is removed by mixing the next tick right away.  nothing is
+ * dropped, so outputs stay in sync */
+static void reduce_audio_buffering(struct obs_core_audio *audio,
+				   size_t sample_rate, const struct ts_info *ts,
+				   bool stable)
+{
+	size_t total_ms;
+
+	if (!stable || !audio->buffering_reduce_ns || audio->fixed_buffer ||
+	    !audio->total_buffering_ticks || audio->buffering_wait_ticks ||
+	    !audio->stable_ts) {
+		audio->stable_ts = ts->start;
+		return;
+	}
+
+	if (ts->start - audio->stable_ts < audio->buffering_reduce_ns)
+		return;
+
+	audio->total_buffering_ticks--;
+	audio->stable_ts = ts->start;
+
+	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
+		   sample_rate;
+
+	metric_set(audio->buffering_metric, (int64_t)total_ms);
+
+	blog(LOG_INFO,
+	     "removing %d milliseconds of audio buffering, total "
+	     "audio buffering is now %d milliseconds",
+	     (int)(AUDIO_OUTPUT_FRAMES * 1000 / sample_rate), (int)total_ms);
+
+	signal_audio_buffering(NULL,
+			       -(int)(AUDIO_OUTPUT_FRAMES * 1000 / sample_rate),
+			       (int)total_ms);
+
+	audio_output_catch_up(audio->audio);
 }
 
 static inline void release_audio_sources(struct obs_core_audio *audio)
@@ -498,6 +602,151 @@ static inline void release_audio_sources(struct obs_core_audio *audio)
 		obs_source_release(audio->render_order.array[i]);
 }
 
+struct audio_render_job {
+	struct obs_core_audio *audio;
+	obs_source_t **sources;
+	size_t num;
+	volatile long next;
+
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+	uint64_t start_ts;
+};
+
+static void render_audio_source(struct audio_render_job *job,
+				obs_source_t *source)
+{
+	obs_source_audio_render(source, job->mixers, job->channels,
+				job->sample_rate, job->audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (audio_buffering_maxed(job->audio) && source->audio_ts != 0 &&
+	    source->audio_ts < job->start_ts) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, job->channels,
+						     job->sample_rate,
+						     job->start_ts);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, job->mixers,
+							job->channels,
+							job->sample_rate,
+							job->audio_size);
+		}
+	}
+}
+
+static void render_audio_batch(void *param)
+{
+	struct audio_render_job *job = param;
+
+	for (;;) {
+		size_t idx = (size_t)os_atomic_inc_long(&job->next) - 1;
+		if (idx >= job->num)
+			break;
+
+		render_audio_source(job, job->sources[idx]);
+	}
+}
+
+static void find_child_level(obs_source_t *parent, obs_source_t *child,
+			     void *param)
+{
+	size_t *level = param;
+
+	if (child->audio_render_level >= *level)
+		*level = child->audio_render_level + 1;
+
+	UNUSED_PARAMETER(parent);
+}
+
+/* Sources are rendered in passes: first every source without an audio
+ * render callback, then every composite source whose children have all been
+ * rendered in a previous pass.  Sources within a pass do not depend on each
+ * other and are split between the audio thread and the worker threads. */
+static void render_audio_parallel(struct obs_core_audio *audio,
+				  struct audio_render_job *job)
+{
+	size_t max_level = 0;
+
+	if (!audio->num_render_workers) {
+		size_t cores = (size_t)os_get_logical_cores();
+		size_t workers = cores > 1 ? cores - 1 : 1;
+
+		if (workers > MAX_AUDIO_RENDER_WORKERS)
+			workers = MAX_AUDIO_RENDER_WORKERS;
+
+		for (size_t i = 0; i < workers; i++) {
+			audio->render_workers[i] = os_task_queue_create();
+			if (!audio->render_workers[i])
+				break;
+			audio->num_render_workers++;
+		}
+	}
+
+	/* render order already lists children before their parents */
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		size_t level = 0;
+
+		if (source->info.audio_render)
+			obs_source_enum_active_sources(source, find_child_level,
+						       &level);
+
+		source->audio_render_level = level;
+		if (level > max_level)
+			max_level = level;
+	}
+
+	for (size_t level = 0; level <= max_level; level++) {
+		size_t workers = 0;
+
+		da_resize(audio->render_batch, 0);
+		for (size_t i = 0; i < audio->render_order.num; i++) {
+			obs_source_t *source = audio->render_order.array[i];
+			if (source->audio_render_level == level)
+				da_push_back(audio->render_batch, &source);
+		}
+
+		job->sources = audio->render_batch.array;
+		job->num = audio->render_batch.num;
+		job->next = 0;
+
+		if (job->num > 1) {
+			workers = job->num - 1;
+			if (workers > audio->num_render_workers)
+				workers = audio->num_render_workers;
+		}
+
+		for (size_t i = 0; i < workers; i++)
+			os_task_queue_queue_task(audio->render_workers[i],
+						 render_audio_batch, job);
+
+		render_audio_batch(job);
+
+		for (size_t i = 0; i < workers; i++)
+			os_task_queue_wait(audio->render_workers[i]);
+	}
+}
+
 static inline void execute_audio_tasks(void)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -525,13 +774,19 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
+	bool catch_up = start_ts_in == end_ts_in;
+	bool stable = true;
 	size_t audio_size;
 	uint64_t min_ts;
 
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
+	audio->render_tick++;
 
-	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	if (!catch_up)
+		deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	else if (!audio->buffered_timestamps.size)
+		return false;
 	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
@@ -560,8 +815,6 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 			if (!obs_source_active(source))
 				continue;
 
-			obs_source_enum_active_tree(source, push_audio_tree,
-						    audio);
 			push_audio_tree(NULL, source, audio);
 
 			if (obs->video.mixes.array[j] == obs->video.main_mix)
@@ -571,7 +824,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
-	pthread_mutex_lock(&data->audio_sources_mutex);
+	os_mutex_lock(&data->audio_sources_mutex);
 
 	source = data->first_audio_source;
 	while (source) {
@@ -579,53 +832,32 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 		source = (struct obs_source *)source->next_audio_source;
 	}
 
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	os_mutex_unlock(&data->audio_sources_mutex);
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-					audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 &&
-		    source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels,
-							     sample_rate,
-							     ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers,
-								channels,
-								sample_rate,
-								audio_size);
-			}
-		}
+	struct audio_render_job job = {
+		.audio = audio,
+		.mixers = mixers,
+		.channels = channels,
+		.sample_rate = sample_rate,
+		.audio_size = audio_size,
+		.start_ts = ts.start,
+	};
+
+	if (audio->parallel_render && audio->render_order.num > 1) {
+		render_audio_parallel(audio, &job);
+	} else {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(&job, audio->render_order.array[i]);
 	}
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
-	pthread_mutex_lock(&data->audio_sources_mutex);
-	const char *buffering_name = calc_min_ts(data, sample_rate, &min_ts);
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	os_mutex_lock(&data->audio_sources_mutex);
+	obs_source_t *buffering_source =
+		calc_min_ts(data, sample_rate, &min_ts);
+	os_mutex_unlock(&data->audio_sources_mutex);
 
 	/* ------------------------------------------------ */
 	/* if a source has gone backward in time, buffer    */
@@ -635,7 +867,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 		}
 	} else if (min_ts < ts.start) {
 		add_audio_buffering(audio, sample_rate, &ts, min_ts,
-				    buffering_name);
+				    buffering_source);
 	}
 
 	/* ------------------------------------------------ */
@@ -659,18 +891,22 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	/* ------------------------------------------------ */
 	/* discard audio */
-	pthread_mutex_lock(&data->audio_sources_mutex);
+	os_mutex_lock(&data->audio_sources_mutex);
 
 	source = data->first_audio_source;
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
+		stable &= track_audio_headroom(source, sample_rate, &ts);
 		discard_audio(audio, source, channels, sample_rate, &ts);
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
 		source = (struct obs_source *)source->next_audio_source;
 	}
 
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	os_mutex_unlock(&data->audio_sources_mutex);
+
+	if (!catch_up)
+		reduce_audio_buffering(audio, sample_rate, &ts, stable);
 
 	/* ------------------------------------------------ */
 	/* release audio sources */
@@ -66,10 +66,29 @@ static int compute_avc_keyframe_priority(const uint8_t *nal_start,
 	return priority;
 }
 
-static void serialize_avc_data(struct serializer *s, const uint8_t *data,
-			       size_t size, bool *is_keyframe, int *priority)
+static void serialize_avc_data(struct serializer *s,
+			       const struct encoder_packet *src,
+			       bool *is_keyframe, int *priority)
 {
-	const uint8_t *const end = data + size;
+	const struct obs_nal_index *index = &src->nal_index;
+
+	if (obs_nal_index_valid(index, src->size)) {
+		for (size_t i = 0; i < index->num; i++) {
+			const uint8_t *const nal_start =
+				src->data + index->units[i].offset;
+			const size_t nal_size = index->units[i].size;
+
+			*priority = compute_avc_keyframe_priority(
+				nal_start, is_keyframe, *priority);
+
+			s_wb32(s, (uint32_t)nal_size);
+			s_write(s, nal_start, nal_size);
+		}
+		return;
+	}
+
+	const uint8_t *const data = src->data;
+	const uint8_t *const end = data + src->size;
 	const uint8_t *nal_start = obs_nal_find_startcode(data, end);
 	while (true) {
 		while (nal_start < end && !*(nal_start++))
@@ -101,17 +120,30 @@ void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 	*avc_packet = *src;
 
 	serialize(&s, &ref, sizeof(ref));
-	serialize_avc_data(&s, src->data, src->size, &avc_packet->keyframe,
+	serialize_avc_data(&s, src, &avc_packet->keyframe,
 			   &avc_packet->priority);
 
 	avc_packet->data = output.bytes.array + sizeof(ref);
 	avc_packet->size = output.bytes.num - sizeof(ref);
 	avc_packet->drop_priority = avc_packet->priority;
+	obs_nal_index_clear(&avc_packet->nal_index);
 }
 
 int obs_parse_avc_packet_priority(const struct encoder_packet *packet)
 {
+	const struct obs_nal_index *index = &packet->nal_index;
 	int priority = packet->priority;
+	bool unused;
+
+	if (obs_nal_index_valid(index, packet->size)) {
+		for (size_t i = 0; i < index->num; i++) {
+			const uint8_t *const nal_start =
+				packet->data + index->units[i].offset;
+			priority = compute_avc_keyframe_priority(
+				nal_start, &unused, priority);
+		}
+		return priority;
+	}
 
 	const uint8_t *const data = packet->data;
 	const uint8_t *const end = data + packet->size;
@@ -123,7 +155,6 @@ int obs_parse_avc_packet_priority(const struct encoder_packet *packet)
 		if (nal_start == end)
 			break;
 
-		bool unused;
 		priority = compute_avc_keyframe_priority(nal_start, &unused,
 							 priority);
 
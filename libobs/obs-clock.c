@@ -0,0 +1,228 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/* how long the graphics thread waits for a clock hold before it renders the
+ * frame anyway, so a stuck decoder can't stall the render forever */
+#define HOLD_TIMEOUT_MS 5000
+#define WAIT_SLICE_MS 100
+
+bool obs_clock_init(void)
+{
+	struct obs_core_clock *clock = &obs->clock;
+
+	if (pthread_mutex_init(&clock->holds_mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&clock->holds_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+	if (os_event_init(&clock->committed_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
+	uint64_t now = os_gettime_ns();
+	clock->time = (int64_t)now;
+	clock->committed = (int64_t)now;
+	return true;
+}
+
+void obs_clock_free(void)
+{
+	struct obs_core_clock *clock = &obs->clock;
+
+	if (clock->holds.num)
+		blog(LOG_WARNING, "%zu clock holds were not destroyed",
+		     clock->holds.num);
+
+	da_free(clock->holds);
+	os_event_destroy(clock->holds_event);
+	os_event_destroy(clock->committed_event);
+	pthread_mutex_destroy(&clock->holds_mutex);
+}
+
+bool obs_set_offline_rendering(bool enable)
+{
+	if (!obs)
+		return false;
+
+	if (obs->audio.audio || obs->video.graphics) {
+		blog(LOG_WARNING, "obs_set_offline_rendering: audio or video "
+				  "is already initialized");
+		return false;
+	}
+
+	if (obs->clock.offline != enable) {
+		obs->clock.offline = enable;
+		blog(LOG_INFO, "Offline rendering %s",
+		     enable ? "enabled" : "disabled");
+	}
+
+	return true;
+}
+
+bool obs_offline_rendering_enabled(void)
+{
+	return obs && obs->clock.offline;
+}
+
+uint64_t obs_get_clock_ns(void)
+{
+	if (!obs || !obs->clock.offline)
+		return os_gettime_ns();
+
+	return (uint64_t)os_atomic_load_int64(&obs->clock.time);
+}
+
+/* ------------------------------------------------------------------------- */
+/* graphics thread side                                                      */
+
+void obs_clock_advance(uint64_t ts)
+{
+	struct obs_core_clock *clock = &obs->clock;
+
+	os_atomic_store_int64(&clock->time, (int64_t)ts);
+
+	pthread_mutex_lock(&clock->holds_mutex);
+	for (size_t i = 0; i < clock->holds.num; i++)
+		os_event_signal(clock->holds.array[i]->event);
+	pthread_mutex_unlock(&clock->holds_mutex);
+}
+
+static bool holds_satisfied(struct obs_core_clock *clock, uint64_t ts)
+{
+	bool satisfied = true;
+
+	pthread_mutex_lock(&clock->holds_mutex);
+	for (size_t i = 0; i < clock->holds.num; i++) {
+		obs_clock_hold_t *hold = clock->holds.array[i];
+		uint64_t hold_ts = (uint64_t)os_atomic_load_int64(&hold->ts);
+		if (hold_ts && hold_ts <= ts) {
+			satisfied = false;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&clock->holds_mutex);
+
+	return satisfied;
+}
+
+void obs_clock_wait_holds(uint64_t ts)
+{
+	struct obs_core_clock *clock = &obs->clock;
+	uint64_t start = os_gettime_ns();
+
+	while (!holds_satisfied(clock, ts)) {
+		uint64_t waited_ms = (os_gettime_ns() - start) / 1000000;
+		if (waited_ms >= HOLD_TIMEOUT_MS) {
+			blog(LOG_WARNING,
+			     "Timed out waiting for sources to output frames "
+			     "for %" PRIu64,
+			     ts);
+			break;
+		}
+
+		os_event_timedwait(clock->holds_event, WAIT_SLICE_MS);
+	}
+}
+
+void obs_clock_commit(uint64_t ts)
+{
+	struct obs_core_clock *clock = &obs->clock;
+
+	os_atomic_store_int64(&clock->committed, (int64_t)ts);
+	os_event_signal(clock->committed_event);
+}
+
+/* ------------------------------------------------------------------------- */
+/* audio thread side, see audio_output_info::clock_callback                  */
+
+uint64_t obs_clock_audio_now(void *param)
+{
+	UNUSED_PARAMETER(param);
+	return (uint64_t)os_atomic_load_int64(&obs->clock.committed);
+}
+
+bool obs_clock_audio_sleepto(void *param, uint64_t ts)
+{
+	struct obs_core_clock *clock = &obs->clock;
+
+	if (obs_clock_audio_now(param) >= ts)
+		return true;
+
+	os_event_timedwait(clock->committed_event, WAIT_SLICE_MS);
+	return obs_clock_audio_now(param) >= ts;
+}
+
+/* ------------------------------------------------------------------------- */
+/* clock holds                                                               */
+
+obs_clock_hold_t *obs_clock_hold_create(void)
+{
+	struct obs_core_clock *clock;
+	obs_clock_hold_t *hold;
+
+	if (!obs_offline_rendering_enabled())
+		return NULL;
+
+	hold = bzalloc(sizeof(*hold));
+	if (os_event_init(&hold->event, OS_EVENT_TYPE_AUTO) != 0) {
+		bfree(hold);
+		return NULL;
+	}
+
+	clock = &obs->clock;
+	pthread_mutex_lock(&clock->holds_mutex);
+	da_push_back(clock->holds, &hold);
+	pthread_mutex_unlock(&clock->holds_mutex);
+
+	return hold;
+}
+
+void obs_clock_hold_destroy(obs_clock_hold_t *hold)
+{
+	struct obs_core_clock *clock = &obs->clock;
+
+	if (!hold)
+		return;
+
+	pthread_mutex_lock(&clock->holds_mutex);
+	da_erase_item(clock->holds, &hold);
+	pthread_mutex_unlock(&clock->holds_mutex);
+
+	os_event_signal(clock->holds_event);
+	os_event_destroy(hold->event);
+	bfree(hold);
+}
+
+void obs_clock_hold_set(obs_clock_hold_t *hold, uint64_t ts)
+{
+	if (!hold)
+		return;
+
+	os_atomic_store_int64(&hold->ts, (int64_t)ts);
+	os_event_signal(obs->clock.holds_event);
+}
+
+bool obs_clock_hold_wait(obs_clock_hold_t *hold, uint64_t ts,
+			 uint32_t timeout_ms)
+{
+	if (!hold)
+		return false;
+
+	if (obs_get_clock_ns() >= ts)
+		return true;
+
+	os_event_timedwait(hold->event, timeout_ms);
+	return obs_get_clock_ns() >= ts;
+}
@@ -21,6 +21,7 @@
 #include "util/darray.h"
 #include "util/platform.h"
 #include "util/uthash.h"
+#include "util/array-serializer.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
 #include "graphics/vec4.h"
@@ -33,6 +34,8 @@ struct obs_data_item {
 	volatile long ref;
 	const char *name;
 	struct obs_data *parent;
+	struct obs_data_item *next;
+	struct obs_data_item *prev;
 	UT_hash_handle hh;
 	enum obs_data_type type;
 	size_t name_len;
@@ -44,10 +47,20 @@ struct obs_data_item {
 	size_t capacity;
 };
 
+/* Items are kept in a list in the order they were added.  Most objects only
+ * have a handful of items, which are faster to find by comparing names than
+ * by hashing them, so the hash table is only built once an object grows past
+ * OBS_DATA_INDEX_MIN items. */
+#define OBS_DATA_INDEX_MIN 8
+
 struct obs_data {
 	volatile long ref;
 	char *json;
 	struct obs_data_item *items;
+	struct obs_data_item *last_item;
+	size_t num_items;
+	struct obs_data_item *index;
+	bool indexed;
 };
 
 struct obs_data_array {
@@ -307,21 +320,59 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 	return item;
 }
 
-static inline void obs_data_item_detach(struct obs_data_item *item)
+static void obs_data_add_item(struct obs_data *data,
+			      struct obs_data_item *item)
 {
-	if (item->parent) {
-		HASH_DEL(item->parent->items, item);
-		item->parent = NULL;
+	item->parent = data;
+	item->next = NULL;
+	item->prev = data->last_item;
+
+	if (data->last_item)
+		data->last_item->next = item;
+	else
+		data->items = item;
+	data->last_item = item;
+
+	if (data->indexed) {
+		HASH_ADD_STR(data->index, name, item);
+
+	} else if (++data->num_items > OBS_DATA_INDEX_MIN) {
+		for (item = data->items; item; item = item->next)
+			HASH_ADD_STR(data->index, name, item);
+		data->indexed = true;
 	}
 }
 
+static inline void obs_data_item_detach(struct obs_data_item *item)
+{
+	struct obs_data *data = item->parent;
+	if (!data)
+		return;
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		data->items = item->next;
+	if (item->next)
+		item->next->prev = item->prev;
+	else
+		data->last_item = item->prev;
+
+	if (data->indexed)
+		HASH_DEL(data->index, item);
+	else
+		data->num_items--;
+
+	item->parent = NULL;
+	item->next = NULL;
+	item->prev = NULL;
+}
+
 static inline void obs_data_item_reattach(struct obs_data *parent,
 					  struct obs_data_item *item)
 {
-	if (parent) {
-		HASH_ADD_STR(parent->items, name, item);
-		item->parent = parent;
-	}
+	if (parent)
+		obs_data_add_item(parent, item);
 }
 
 static struct obs_data_item *
@@ -347,9 +398,6 @@ obs_data_item_ensure_capacity(struct obs_data_item *item)
 
 static inline void obs_data_item_destroy(struct obs_data_item *item)
 {
-	if (item->parent)
-		HASH_DEL(item->parent->items, item);
-
 	item_data_release(item);
 	item_default_data_release(item);
 	item_autoselect_data_release(item);
@@ -589,7 +637,8 @@ static json_t *obs_data_to_json(obs_data_t *data)
 	obs_data_item_t *item = NULL;
 	obs_data_item_t *temp = NULL;
 
-	HASH_ITER (hh, data->items, item, temp) {
+	for (item = data->items; item; item = temp) {
+		temp = item->next;
 		enum obs_data_type type = obs_data_item_gettype(item);
 		const char *name = get_item_name(item);
 
@@ -656,29 +705,31 @@ obs_data_t *obs_data_create_from_json_file(const char *json_file)
 	return data;
 }
 
-obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
-						const char *backup_ext)
+typedef obs_data_t *(*create_from_file_t)(const char *file);
+
+static obs_data_t *create_from_file_safe(const char *file,
+					 const char *backup_ext,
+					 create_from_file_t create,
+					 const char *func)
 {
-	obs_data_t *file_data = obs_data_create_from_json_file(json_file);
+	obs_data_t *file_data = create(file);
 	if (!file_data && backup_ext && *backup_ext) {
 		struct dstr backup_file = {0};
 
-		dstr_copy(&backup_file, json_file);
+		dstr_copy(&backup_file, file);
 		if (*backup_ext != '.')
 			dstr_cat(&backup_file, ".");
 		dstr_cat(&backup_file, backup_ext);
 
 		if (os_file_exists(backup_file.array)) {
 			blog(LOG_WARNING,
-			     "obs-data.c: "
-			     "[obs_data_create_from_json_file_safe] "
-			     "attempting backup file");
+			     "obs-data.c: [%s] attempting backup file", func);
 
 			/* delete current file if corrupt to prevent it from
 			 * being backed up again */
-			os_rename(backup_file.array, json_file);
+			os_rename(backup_file.array, file);
 
-			file_data = obs_data_create_from_json_file(json_file);
+			file_data = create(file);
 		}
 
 		dstr_free(&backup_file);
@@ -687,6 +738,14 @@ obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
 	return file_data;
 }
 
+obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
+						const char *backup_ext)
+{
+	return create_from_file_safe(json_file, backup_ext,
+				     obs_data_create_from_json_file,
+				     "obs_data_create_from_json_file_safe");
+}
+
 void obs_data_addref(obs_data_t *data)
 {
 	if (data)
@@ -697,7 +756,8 @@ static inline void obs_data_destroy(struct obs_data *data)
 {
 	struct obs_data_item *item, *temp;
 
-	HASH_ITER (hh, data->items, item, temp) {
+	for (item = data->items; item; item = temp) {
+		temp = item->next;
 		obs_data_item_detach(item);
 		obs_data_item_release(&item);
 	}
@@ -792,6 +852,461 @@ bool obs_data_save_json_pretty_safe(obs_data_t *data, const char *file,
 	return false;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Binary format
+ *
+ *   header:    "OBSDBIN" and a version byte
+ *   key table: varint count, then each key as varint length, bytes and a
+ *              null terminator
+ *   root:      object
+ *
+ *   object:    varint item count, then each item as varint key index,
+ *              a type byte and its value
+ *   string:    varint length, bytes and a null terminator
+ *   int:       64-bit little endian
+ *   double:    64-bit little endian
+ *   true/false: type only
+ *   object:    object
+ *   array:     varint count, then each object
+ *
+ * Keys are stored once and referenced by index, and strings are null
+ * terminated so that they can be used straight from the buffer.  Only user
+ * values are stored, the same as with json. */
+
+#define BIN_MAGIC "OBSDBIN"
+#define BIN_VERSION 1
+#define BIN_HEADER_SIZE 8
+
+enum bin_type {
+	BIN_STRING = 1,
+	BIN_INT,
+	BIN_DOUBLE,
+	BIN_TRUE,
+	BIN_FALSE,
+	BIN_OBJECT,
+	BIN_ARRAY,
+};
+
+struct bin_key {
+	const char *name;
+	uint64_t idx;
+	UT_hash_handle hh;
+};
+
+struct bin_writer {
+	struct serializer s;
+	struct array_output_data body;
+	struct bin_key *keys;
+	DARRAY(const char *) key_list;
+};
+
+static void s_wvarint(struct serializer *s, uint64_t val)
+{
+	while (val >= 0x80) {
+		s_w8(s, (uint8_t)(val | 0x80));
+		val >>= 7;
+	}
+	s_w8(s, (uint8_t)val);
+}
+
+static uint64_t bin_key_idx(struct bin_writer *w, const char *name)
+{
+	struct bin_key *key;
+
+	HASH_FIND_STR(w->keys, name, key);
+	if (!key) {
+		key = bmalloc(sizeof(*key));
+		key->name = name;
+		key->idx = w->key_list.num;
+		HASH_ADD_KEYPTR(hh, w->keys, name, strlen(name), key);
+		da_push_back(w->key_list, &name);
+	}
+
+	return key->idx;
+}
+
+static void bin_write_obj(struct bin_writer *w, obs_data_t *data);
+
+static void bin_write_item(struct bin_writer *w, obs_data_item_t *item)
+{
+	enum obs_data_type type = obs_data_item_gettype(item);
+	struct serializer *s = &w->s;
+
+	s_wvarint(s, bin_key_idx(w, get_item_name(item)));
+
+	if (type == OBS_DATA_STRING) {
+		const char *val = obs_data_item_get_string(item);
+		size_t len = strlen(val);
+
+		s_w8(s, BIN_STRING);
+		s_wvarint(s, len);
+		s_write(s, val, len + 1);
+
+	} else if (type == OBS_DATA_NUMBER) {
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT) {
+			s_w8(s, BIN_INT);
+			s_wl64(s, (uint64_t)obs_data_item_get_int(item));
+		} else {
+			s_w8(s, BIN_DOUBLE);
+			s_wld(s, obs_data_item_get_double(item));
+		}
+
+	} else if (type == OBS_DATA_BOOLEAN) {
+		s_w8(s, obs_data_item_get_bool(item) ? BIN_TRUE : BIN_FALSE);
+
+	} else if (type == OBS_DATA_OBJECT) {
+		obs_data_t *obj = obs_data_item_get_obj(item);
+		s_w8(s, BIN_OBJECT);
+		bin_write_obj(w, obj);
+		obs_data_release(obj);
+
+	} else if (type == OBS_DATA_ARRAY) {
+		obs_data_array_t *array = obs_data_item_get_array(item);
+		size_t count = obs_data_array_count(array);
+
+		s_w8(s, BIN_ARRAY);
+		s_wvarint(s, count);
+
+		for (size_t i = 0; i < count; i++) {
+			obs_data_t *sub_item = obs_data_array_item(array, i);
+			bin_write_obj(w, sub_item);
+			obs_data_release(sub_item);
+		}
+
+		obs_data_array_release(array);
+	}
+}
+
+static inline bool bin_has_value(obs_data_item_t *item)
+{
+	enum obs_data_type type = obs_data_item_gettype(item);
+	return obs_data_item_has_user_value(item) && type != OBS_DATA_NULL;
+}
+
+static void bin_write_obj(struct bin_writer *w, obs_data_t *data)
+{
+	obs_data_item_t *item = NULL;
+	obs_data_item_t *temp = NULL;
+	size_t count = 0;
+
+	for (item = data->items; item; item = temp) {
+		temp = item->next;
+		if (bin_has_value(item))
+			count++;
+	}
+
+	s_wvarint(&w->s, count);
+
+	for (item = data->items; item; item = temp) {
+		temp = item->next;
+		if (bin_has_value(item))
+			bin_write_item(w, item);
+	}
+}
+
+static bool obs_data_to_bin(obs_data_t *data, struct array_output_data *out)
+{
+	struct bin_writer w = {0};
+	struct serializer s;
+	struct bin_key *key, *temp;
+
+	array_output_serializer_init(&w.s, &w.body);
+	bin_write_obj(&w, data);
+
+	array_output_serializer_init(&s, out);
+	s_write(&s, BIN_MAGIC, sizeof(BIN_MAGIC) - 1);
+	s_w8(&s, BIN_VERSION);
+
+	s_wvarint(&s, w.key_list.num);
+	for (size_t i = 0; i < w.key_list.num; i++) {
+		const char *name = w.key_list.array[i];
+		size_t len = strlen(name);
+
+		s_wvarint(&s, len);
+		s_write(&s, name, len + 1);
+	}
+
+	s_write(&s, w.body.bytes.array, w.body.bytes.num);
+
+	HASH_ITER (hh, w.keys, key, temp) {
+		HASH_DELETE(hh, w.keys, key);
+		bfree(key);
+	}
+	da_free(w.key_list);
+	array_output_serializer_free(&w.body);
+	return out->bytes.num > 0;
+}
+
+bool obs_data_save_bin(obs_data_t *data, const char *file)
+{
+	struct array_output_data out;
+	bool success = false;
+
+	if (data && obs_data_to_bin(data, &out)) {
+		const char *bin = (const char *)out.bytes.array;
+		success = os_quick_write_utf8_file(file, bin, out.bytes.num,
+						   false);
+	}
+
+	if (data)
+		array_output_serializer_free(&out);
+	return success;
+}
+
+bool obs_data_save_bin_safe(obs_data_t *data, const char *file,
+			    const char *temp_ext, const char *backup_ext)
+{
+	struct array_output_data out;
+	bool success = false;
+
+	if (data && obs_data_to_bin(data, &out))
+		success = os_quick_write_utf8_file_safe(
+			file, (const char *)out.bytes.array, out.bytes.num,
+			false, temp_ext, backup_ext);
+
+	if (data)
+		array_output_serializer_free(&out);
+	return success;
+}
+
+struct bin_reader {
+	const uint8_t *pos;
+	const uint8_t *end;
+	DARRAY(const char *) keys;
+	bool error;
+};
+
+static uint64_t bin_read_varint(struct bin_reader *r)
+{
+	uint64_t val = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (r->pos == r->end)
+			break;
+
+		uint8_t byte = *(r->pos++);
+		val |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return val;
+	}
+
+	r->error = true;
+	return 0;
+}
+
+static uint64_t bin_read_u64(struct bin_reader *r)
+{
+	uint64_t val = 0;
+
+	if (r->end - r->pos < 8) {
+		r->error = true;
+		return 0;
+	}
+
+	for (int i = 0; i < 8; i++)
+		val |= (uint64_t)r->pos[i] << (i * 8);
+	r->pos += 8;
+	return val;
+}
+
+/* strings are used in place, so they have to be null terminated within the
+ * buffer */
+static const char *bin_read_str(struct bin_reader *r)
+{
+	uint64_t len = bin_read_varint(r);
+	const char *str = (const char *)r->pos;
+
+	if (r->error || len >= (uint64_t)(r->end - r->pos) || str[len]) {
+		r->error = true;
+		return NULL;
+	}
+
+	r->pos += len + 1;
+	return str;
+}
+
+static void bin_read_obj(struct bin_reader *r, obs_data_t *data);
+
+static void bin_read_array(struct bin_reader *r, obs_data_t *data,
+			   const char *name)
+{
+	obs_data_array_t *array = obs_data_array_create();
+	uint64_t count = bin_read_varint(r);
+
+	/* every object takes up at least a byte */
+	if (count > (uint64_t)(r->end - r->pos))
+		r->error = true;
+
+	for (uint64_t i = 0; i < count && !r->error; i++) {
+		obs_data_t *item = obs_data_create();
+		bin_read_obj(r, item);
+		obs_data_array_push_back(array, item);
+		obs_data_release(item);
+	}
+
+	obs_data_set_array(data, name, array);
+	obs_data_array_release(array);
+}
+
+static void bin_read_item(struct bin_reader *r, obs_data_t *data)
+{
+	uint64_t key = bin_read_varint(r);
+	const char *name;
+	uint8_t type;
+
+	if (r->error || key >= r->keys.num || r->pos == r->end) {
+		r->error = true;
+		return;
+	}
+
+	name = r->keys.array[key];
+	type = *(r->pos++);
+
+	if (type == BIN_STRING) {
+		const char *val = bin_read_str(r);
+		if (val)
+			obs_data_set_string(data, name, val);
+
+	} else if (type == BIN_INT) {
+		uint64_t val = bin_read_u64(r);
+		obs_data_set_int(data, name, (long long)val);
+
+	} else if (type == BIN_DOUBLE) {
+		uint64_t bits = bin_read_u64(r);
+		double val;
+		memcpy(&val, &bits, sizeof(val));
+		obs_data_set_double(data, name, val);
+
+	} else if (type == BIN_TRUE || type == BIN_FALSE) {
+		obs_data_set_bool(data, name, type == BIN_TRUE);
+
+	} else if (type == BIN_OBJECT) {
+		obs_data_t *obj = obs_data_create();
+		bin_read_obj(r, obj);
+		obs_data_set_obj(data, name, obj);
+		obs_data_release(obj);
+
+	} else if (type == BIN_ARRAY) {
+		bin_read_array(r, data, name);
+
+	} else {
+		r->error = true;
+	}
+}
+
+static void bin_read_obj(struct bin_reader *r, obs_data_t *data)
+{
+	uint64_t count = bin_read_varint(r);
+
+	for (uint64_t i = 0; i < count && !r->error; i++)
+		bin_read_item(r, data);
+}
+
+static inline bool is_bin(const uint8_t *bin, size_t size)
+{
+	return size >= BIN_HEADER_SIZE &&
+	       memcmp(bin, BIN_MAGIC, sizeof(BIN_MAGIC) - 1) == 0;
+}
+
+obs_data_t *obs_data_create_from_bin(const uint8_t *bin, size_t size)
+{
+	struct bin_reader r = {0};
+	obs_data_t *data;
+	uint64_t num_keys;
+
+	if (!bin || !is_bin(bin, size)) {
+		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_bin] "
+				"Invalid header");
+		return NULL;
+	}
+	if (bin[BIN_HEADER_SIZE - 1] != BIN_VERSION) {
+		blog(LOG_ERROR,
+		     "obs-data.c: [obs_data_create_from_bin] "
+		     "Unsupported version %d",
+		     (int)bin[BIN_HEADER_SIZE - 1]);
+		return NULL;
+	}
+
+	r.pos = bin + BIN_HEADER_SIZE;
+	r.end = bin + size;
+
+	num_keys = bin_read_varint(&r);
+	if (num_keys > (uint64_t)(r.end - r.pos))
+		r.error = true;
+
+	for (uint64_t i = 0; i < num_keys && !r.error; i++) {
+		const char *key = bin_read_str(&r);
+		da_push_back(r.keys, &key);
+	}
+
+	data = obs_data_create();
+	if (!r.error)
+		bin_read_obj(&r, data);
+
+	da_free(r.keys);
+
+	if (r.error) {
+		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_bin] "
+				"Failed reading binary data");
+		obs_data_release(data);
+		data = NULL;
+	}
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_bin_file(const char *file)
+{
+	obs_data_t *data = NULL;
+	uint8_t *bin = NULL;
+	int64_t size;
+	FILE *f;
+
+	f = os_fopen(file, "rb");
+	if (!f)
+		return NULL;
+
+	size = os_fgetsize(f);
+	if (size > 0) {
+		bin = bmalloc((size_t)size + 1);
+		if (fread(bin, 1, (size_t)size, f) != (size_t)size)
+			size = 0;
+		bin[size] = 0;
+	}
+	fclose(f);
+
+	if (size <= 0) {
+		bfree(bin);
+		return NULL;
+	}
+
+	/* files that were saved as json are still read, so callers can switch
+	 * over to the binary format without converting anything */
+	if (is_bin(bin, (size_t)size)) {
+		data = obs_data_create_from_bin(bin, (size_t)size);
+	} else {
+		const char *json = (const char *)bin;
+
+		/* skip the utf-8 byte order mark if there is one */
+		if (size >= 3 && memcmp(bin, "\xEF\xBB\xBF", 3) == 0)
+			json += 3;
+		data = obs_data_create_from_json(json);
+	}
+
+	bfree(bin);
+	return data;
+}
+
+obs_data_t *obs_data_create_from_bin_file_safe(const char *file,
+					       const char *backup_ext)
+{
+	return create_from_file_safe(file, backup_ext,
+				     obs_data_create_from_bin_file,
+				     "obs_data_create_from_bin_file_safe");
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void get_defaults_array_cb(obs_data_t *data, void *vp)
 {
 	obs_data_array_t *defs = (obs_data_array_t *)vp;
@@ -811,7 +1326,8 @@ obs_data_t *obs_data_get_defaults(obs_data_t *data)
 
 	struct obs_data_item *item, *temp;
 
-	HASH_ITER (hh, data->items, item, temp) {
+	for (item = data->items; item; item = temp) {
+		temp = item->next;
 		const char *name = get_item_name(item);
 		switch (item->type) {
 		case OBS_DATA_NULL:
@@ -888,7 +1404,16 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 		return NULL;
 
 	struct obs_data_item *item;
-	HASH_FIND_STR(data->items, name, item);
+
+	if (data->indexed) {
+		HASH_FIND_STR(data->index, name, item);
+		return item;
+	}
+
+	for (item = data->items; item; item = item->next) {
+		if (strcmp(item->name, name) == 0)
+			break;
+	}
 	return item;
 }
 
@@ -902,8 +1427,7 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 	if ((!item || !*item) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type,
 						default_data, autoselect_data);
-		new_item->parent = data;
-		HASH_ADD_STR(data->items, name, new_item);
+		obs_data_add_item(data, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
@@ -1035,7 +1559,8 @@ void obs_data_apply(obs_data_t *target, obs_data_t *apply_data)
 
 	struct obs_data_item *item, *temp;
 
-	HASH_ITER (hh, apply_data->items, item, temp) {
+	for (item = apply_data->items; item; item = temp) {
+		temp = item->next;
 		copy_item(target, item);
 	}
 }
@@ -1084,7 +1609,8 @@ void obs_data_clear(obs_data_t *target)
 		return;
 
 	struct obs_data_item *item, *temp;
-	HASH_ITER (hh, target->items, item, temp) {
+	for (item = target->items; item; item = temp) {
+		temp = item->next;
 		clear_item(item);
 	}
 }
@@ -1565,7 +2091,7 @@ obs_data_item_t *obs_data_item_byname(obs_data_t *data, const char *name)
 bool obs_data_item_next(obs_data_item_t **item)
 {
 	if (item && *item) {
-		obs_data_item_t *next = (*item)->hh.next;
+		obs_data_item_t *next = (*item)->next;
 		obs_data_item_release(item);
 
 		*item = next;
@@ -80,6 +80,15 @@ EXPORT bool obs_data_save_json_pretty_safe(obs_data_t *data, const char *file,
 					   const char *temp_ext,
 					   const char *backup_ext);
 
+EXPORT obs_data_t *obs_data_create_from_bin(const uint8_t *bin, size_t size);
+EXPORT obs_data_t *obs_data_create_from_bin_file(const char *file);
+EXPORT obs_data_t *obs_data_create_from_bin_file_safe(const char *file,
+						      const char *backup_ext);
+EXPORT bool obs_data_save_bin(obs_data_t *data, const char *file);
+EXPORT bool obs_data_save_bin_safe(obs_data_t *data, const char *file,
+				   const char *temp_ext,
+				   const char *backup_ext);
+
 EXPORT void obs_data_apply(obs_data_t *target, obs_data_t *apply_data);
 
 EXPORT void obs_data_erase(obs_data_t *data, const char *name);
@@ -19,6 +19,8 @@
 #include "obs.h"
 #include "obs-internal.h"
 
+static void stop_present_thread(struct obs_display *display);
+
 bool obs_display_init(struct obs_display *display,
 		      const struct gs_init_data *graphics_data)
 {
@@ -62,6 +64,8 @@ bool obs_display_init(struct obs_display *display,
 	}
 
 	display->enabled = true;
+	display->visible = true;
+	display->render_divisor = 1;
 	return true;
 }
 
@@ -98,6 +102,9 @@ void obs_display_free(obs_display_t *display)
 	pthread_mutex_destroy(&display->draw_info_mutex);
 	da_free(display->draw_callbacks);
 
+	gs_texrender_destroy(display->present_target);
+	display->present_target = NULL;
+
 	if (display->swap) {
 		gs_swapchain_destroy(display->swap);
 		display->swap = NULL;
@@ -114,6 +121,8 @@ void obs_display_destroy(obs_display_t *display)
 			display->next->prev_next = display->prev_next;
 		pthread_mutex_unlock(&obs->data.displays_mutex);
 
+		stop_present_thread(display);
+
 		obs_enter_graphics();
 		obs_display_free(display);
 		obs_leave_graphics();
@@ -177,12 +186,10 @@ void obs_display_remove_draw_callback(obs_display_t *display,
 	pthread_mutex_unlock(&display->draw_callbacks_mutex);
 }
 
-static inline bool render_display_begin(struct obs_display *display,
-					uint32_t cx, uint32_t cy,
-					bool update_color_space)
+static inline void render_display_load(struct obs_display *display,
+				       uint32_t cx, uint32_t cy,
+				       bool update_color_space)
 {
-	struct vec4 clear_color;
-
 	gs_load_swapchain(display->swap);
 
 	if ((display->cx != cx) || (display->cy != cy)) {
@@ -192,41 +199,53 @@ static inline bool render_display_begin(struct obs_display *display,
 	} else if (update_color_space) {
 		gs_update_color_space();
 	}
+}
+
+static void render_display_clear(struct obs_display *display, uint32_t cx,
+				 uint32_t cy)
+{
+	struct vec4 clear_color;
+
+	if (gs_get_color_space() == GS_CS_SRGB)
+		vec4_from_rgba(&clear_color, display->background_color);
+	else
+		vec4_from_rgba_srgb(&clear_color, display->background_color);
+	clear_color.w = 1.0f;
+
+	const bool use_clear_workaround = display->use_clear_workaround;
+
+	uint32_t clear_flags = GS_CLEAR_DEPTH | GS_CLEAR_STENCIL;
+	if (!use_clear_workaround)
+		clear_flags |= GS_CLEAR_COLOR;
+	gs_clear(clear_flags, &clear_color, 1.0f, 0);
+
+	gs_enable_depth_test(false);
+	/* gs_enable_blending(false); */
+	gs_set_cull_mode(GS_NEITHER);
+
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+	gs_set_viewport(0, 0, cx, cy);
+
+	if (use_clear_workaround) {
+		gs_effect_t *const solid_effect = obs->video.solid_effect;
+		gs_effect_set_vec4(gs_effect_get_param_by_name(solid_effect,
+							       "color"),
+				   &clear_color);
+		while (gs_effect_loop(solid_effect, "Solid"))
+			gs_draw_sprite(NULL, 0, cx, cy);
+	}
+}
+
+static inline bool render_display_begin(struct obs_display *display,
+					uint32_t cx, uint32_t cy,
+					bool update_color_space)
+{
+	render_display_load(display, cx, cy, update_color_space);
 
 	const bool success = gs_is_present_ready();
 	if (success) {
 		gs_begin_scene();
-
-		if (gs_get_color_space() == GS_CS_SRGB)
-			vec4_from_rgba(&clear_color, display->background_color);
-		else
-			vec4_from_rgba_srgb(&clear_color,
-					    display->background_color);
-		clear_color.w = 1.0f;
-
-		const bool use_clear_workaround = display->use_clear_workaround;
-
-		uint32_t clear_flags = GS_CLEAR_DEPTH | GS_CLEAR_STENCIL;
-		if (!use_clear_workaround)
-			clear_flags |= GS_CLEAR_COLOR;
-		gs_clear(clear_flags, &clear_color, 1.0f, 0);
-
-		gs_enable_depth_test(false);
-		/* gs_enable_blending(false); */
-		gs_set_cull_mode(GS_NEITHER);
-
-		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
-		gs_set_viewport(0, 0, cx, cy);
-
-		if (use_clear_workaround) {
-			gs_effect_t *const solid_effect =
-				obs->video.solid_effect;
-			gs_effect_set_vec4(gs_effect_get_param_by_name(
-						   solid_effect, "color"),
-					   &clear_color);
-			while (gs_effect_loop(solid_effect, "Solid"))
-				gs_draw_sprite(NULL, 0, cx, cy);
-		}
+		render_display_clear(display, cx, cy);
 	}
 
 	return success;
@@ -237,12 +256,72 @@ static inline void render_display_end()
 	gs_end_scene();
 }
 
+static void render_display_callbacks(struct obs_display *display, uint32_t cx,
+				     uint32_t cy)
+{
+	pthread_mutex_lock(&display->draw_callbacks_mutex);
+
+	for (size_t i = 0; i < display->draw_callbacks.num; i++) {
+		struct draw_callback *callback;
+		callback = display->draw_callbacks.array + i;
+
+		callback->draw(callback->param, cx, cy);
+	}
+
+	pthread_mutex_unlock(&display->draw_callbacks_mutex);
+}
+
+/* records the display into its present target instead of the swap chain.
+ * the swap chain is still loaded so that resizes and the color space follow
+ * the window, but presenting is left to the display's present thread */
+static void record_display(struct obs_display *display, uint32_t cx,
+			   uint32_t cy, bool update_color_space)
+{
+	render_display_load(display, cx, cy, update_color_space);
+
+	const enum gs_color_space space = gs_get_color_space();
+	const enum gs_color_format format = gs_get_format_from_space(space);
+
+	if (display->present_target &&
+	    gs_texrender_get_format(display->present_target) != format) {
+		gs_texrender_destroy(display->present_target);
+		display->present_target = NULL;
+	}
+	if (!display->present_target)
+		display->present_target =
+			gs_texrender_create(format, GS_ZS_NONE);
+
+	gs_texrender_reset(display->present_target);
+	if (!gs_texrender_begin_with_color_space(display->present_target, cx,
+						 cy, space))
+		return;
+
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DISPLAY, "obs_display");
+
+	gs_begin_scene();
+	render_display_clear(display, cx, cy);
+	render_display_callbacks(display, cx, cy);
+	gs_end_scene();
+
+	GS_DEBUG_MARKER_END();
+
+	gs_texrender_end(display->present_target);
+
+	os_atomic_set_bool(&display->present_pending, true);
+	os_event_signal(display->present_event);
+}
+
 void render_display(struct obs_display *display)
 {
 	uint32_t cx, cy;
 	bool update_color_space;
 
-	if (!display || !display->enabled)
+	if (!display || !display->enabled || !display->visible)
+		return;
+
+	/* only every nth frame is drawn, the swap chain keeps showing the last
+	 * one in between */
+	if (display->render_frame++ % display->render_divisor != 0)
 		return;
 
 	/* -------------------------------------------- */
@@ -259,26 +338,158 @@ void render_display(struct obs_display *display)
 
 	/* -------------------------------------------- */
 
-	if (render_display_begin(display, cx, cy, update_color_space)) {
+	if (display->async_present) {
+		record_display(display, cx, cy, update_color_space);
+
+	} else if (render_display_begin(display, cx, cy, update_color_space)) {
 		GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DISPLAY, "obs_display");
 
-		pthread_mutex_lock(&display->draw_callbacks_mutex);
+		render_display_callbacks(display, cx, cy);
+		render_display_end();
 
-		for (size_t i = 0; i < display->draw_callbacks.num; i++) {
-			struct draw_callback *callback;
-			callback = display->draw_callbacks.array + i;
+		GS_DEBUG_MARKER_END();
 
-			callback->draw(callback->param, cx, cy);
-		}
+		gs_present();
+	}
+}
 
-		pthread_mutex_unlock(&display->draw_callbacks_mutex);
+/* copies the last recorded frame onto the swap chain and presents it.  if
+ * the swap chain is not ready yet the frame stays pending, the graphics
+ * thread never waits for it either way and simply records over it */
+static void present_display(struct obs_display *display)
+{
+	gs_texture_t *tex;
+	uint32_t cx, cy;
 
-		render_display_end();
+	if (!os_atomic_set_bool(&display->present_pending, false))
+		return;
 
-		GS_DEBUG_MARKER_END();
+	tex = gs_texrender_get_texture(display->present_target);
+	if (!tex)
+		return;
 
-		gs_present();
+	gs_load_swapchain(display->swap);
+
+	if (!gs_is_present_ready()) {
+		os_atomic_set_bool(&display->present_pending, true);
+		return;
 	}
+
+	cx = gs_texture_get_width(tex);
+	cy = gs_texture_get_height(tex);
+
+	gs_begin_scene();
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(false);
+	gs_blend_state_push();
+	gs_enable_blending(false);
+	gs_enable_depth_test(false);
+	gs_set_cull_mode(GS_NEITHER);
+
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+	gs_set_viewport(0, 0, cx, cy);
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
+			      tex);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, cx, cy);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+
+	gs_end_scene();
+	gs_present();
+}
+
+static void *display_present_thread(void *param)
+{
+	struct obs_display *display = param;
+
+	os_set_thread_name("libobs: display present thread");
+
+	while (os_event_wait(display->present_event) == 0) {
+		if (os_atomic_load_bool(&display->present_stop))
+			break;
+
+		gs_enter_context(obs->video.graphics);
+		present_display(display);
+		gs_leave_context();
+	}
+
+	return NULL;
+}
+
+static bool start_present_thread(struct obs_display *display)
+{
+	if (os_event_init(&display->present_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
+	display->present_stop = false;
+	display->present_pending = false;
+
+	if (pthread_create(&display->present_thread, NULL,
+			   display_present_thread, display) != 0) {
+		os_event_destroy(display->present_event);
+		display->present_event = NULL;
+		return false;
+	}
+
+	display->present_thread_active = true;
+	return true;
+}
+
+/* must not be called from within the graphics context, the present thread
+ * may be waiting to enter it */
+static void stop_present_thread(struct obs_display *display)
+{
+	if (!display->present_thread_active)
+		return;
+
+	os_atomic_set_bool(&display->present_stop, true);
+	os_event_signal(display->present_event);
+	pthread_join(display->present_thread, NULL);
+
+	os_event_destroy(display->present_event);
+	display->present_event = NULL;
+	display->present_thread_active = false;
+}
+
+void obs_display_set_async_present(obs_display_t *display, bool async)
+{
+	if (!display || !display->swap || display->async_present == async)
+		return;
+
+	if (async) {
+		if (!start_present_thread(display)) {
+			blog(LOG_WARNING, "obs_display_set_async_present: "
+					  "Failed to create present thread");
+			return;
+		}
+
+		/* render_displays holds the graphics context, so this switches
+		 * the display between frames */
+		obs_enter_graphics();
+		display->async_present = true;
+		obs_leave_graphics();
+	} else {
+		obs_enter_graphics();
+		display->async_present = false;
+		obs_leave_graphics();
+
+		stop_present_thread(display);
+
+		obs_enter_graphics();
+		gs_texrender_destroy(display->present_target);
+		display->present_target = NULL;
+		obs_leave_graphics();
+	}
+}
+
+bool obs_display_async_present(obs_display_t *display)
+{
+	return display ? display->async_present : false;
 }
 
 void obs_display_set_enabled(obs_display_t *display, bool enable)
@@ -292,6 +503,30 @@ bool obs_display_enabled(obs_display_t *display)
 	return display ? display->enabled : false;
 }
 
+void obs_display_set_visible(obs_display_t *display, bool visible)
+{
+	if (display)
+		display->visible = visible;
+}
+
+bool obs_display_visible(obs_display_t *display)
+{
+	return display ? display->visible : false;
+}
+
+void obs_display_set_render_divisor(obs_display_t *display, uint32_t divisor)
+{
+	if (display) {
+		display->render_divisor = divisor ? divisor : 1;
+		display->render_frame = 0;
+	}
+}
+
+uint32_t obs_display_get_render_divisor(obs_display_t *display)
+{
+	return display ? display->render_divisor : 0;
+}
+
 void obs_display_set_background_color(obs_display_t *display, uint32_t color)
 {
 	if (display)
@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
+
 #include "obs.h"
 #include "obs-internal.h"
 #include "util/util_uint64.h"
@@ -29,14 +31,12 @@ static void encoder_set_video(obs_encoder_t *encoder, video_t *video);
 
 struct obs_encoder_info *find_encoder(const char *id)
 {
-	for (size_t i = 0; i < obs->encoder_types.num; i++) {
-		struct obs_encoder_info *info = obs->encoder_types.array + i;
+	size_t idx;
 
-		if (strcmp(info->id, id) == 0)
-			return info;
-	}
+	if (!obs_type_index_find(obs->encoder_type_index, id, &idx))
+		return NULL;
 
-	return NULL;
+	return obs->encoder_types.array + idx;
 }
 
 const char *obs_encoder_get_display_name(const char *id)
@@ -49,24 +49,31 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 			 obs_data_t *settings, obs_data_t *hotkey_data)
 {
 	pthread_mutex_init_value(&encoder->init_mutex);
+	pthread_mutex_init_value(&encoder->impl_mutex);
 	pthread_mutex_init_value(&encoder->callbacks_mutex);
-	pthread_mutex_init_value(&encoder->outputs_mutex);
+	os_mutex_init_value(&encoder->outputs_mutex);
 	pthread_mutex_init_value(&encoder->pause.mutex);
 	pthread_mutex_init_value(&encoder->roi_mutex);
+	pthread_mutex_init_value(&encoder->stats_mutex);
 
 	if (!obs_context_data_init(&encoder->context, OBS_OBJ_TYPE_ENCODER,
 				   settings, name, NULL, hotkey_data, false))
 		return false;
 	if (pthread_mutex_init_recursive(&encoder->init_mutex) != 0)
 		return false;
+	if (pthread_mutex_init_recursive(&encoder->impl_mutex) != 0)
+		return false;
 	if (pthread_mutex_init_recursive(&encoder->callbacks_mutex) != 0)
 		return false;
-	if (pthread_mutex_init(&encoder->outputs_mutex, NULL) != 0)
+	if (os_mutex_init(&encoder->outputs_mutex,
+			  "encoder_outputs_mutex") != 0)
 		return false;
 	if (pthread_mutex_init(&encoder->pause.mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&encoder->roi_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->stats_mutex, NULL) != 0)
+		return false;
 
 	if (encoder->orig_info.get_defaults) {
 		encoder->orig_info.get_defaults(encoder->context.settings);
@@ -303,14 +310,309 @@ static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
+static bool do_encode_raw(struct obs_encoder *encoder, uint8_t **data,
+			  uint32_t *linesize);
+
+static void *async_encode_thread(void *param)
+{
+	struct obs_encoder *encoder = param;
+	struct dstr name = {0};
+	long sched_serial = 0;
+
+	dstr_printf(&name, "obs-encoder: %s", encoder->context.name);
+	os_set_thread_name(name.array);
+	dstr_free(&name);
+	bmem_set_thread_tag(BMEM_TAG_ENCODER);
+
+	for (;;) {
+		os_sem_wait(encoder->async_queued);
+
+		/* woken up without a frame: the queue has been drained and
+		 * the encoder is being stopped */
+		if (!os_atomic_load_long(&encoder->async_count))
+			break;
+
+		obs_update_thread_scheduling(OBS_THREAD_ROLE_ENCODER,
+					     &sched_serial);
+
+		struct video_frame *frame =
+			&encoder->async_frames[encoder->async_read];
+
+		/* on failure the encoder has either been fully stopped or is
+		 * being switched to its fallback, which stops this thread */
+		if (!do_encode_raw(encoder, frame->data, frame->linesize) &&
+		    !os_atomic_load_bool(&encoder->fallback_pending))
+			break;
+
+		encoder->async_read = (encoder->async_read + 1) %
+				      ASYNC_ENCODE_DEPTH;
+		os_atomic_dec_long(&encoder->async_count);
+		os_sem_post(encoder->async_free);
+	}
+
+	return NULL;
+}
+
+static void stop_async_encode(struct obs_encoder *encoder)
+{
+	if (!encoder->async_thread_active)
+		return;
+
+	/* full_stop on an encode error gets here from the thread itself, it
+	 * exits on its own and is cleaned up on the next start or destroy */
+	if (pthread_equal(pthread_self(), encoder->async_thread))
+		return;
+
+	os_sem_post(encoder->async_queued);
+	pthread_join(encoder->async_thread, NULL);
+	encoder->async_thread_active = false;
+
+	for (size_t i = 0; i < ASYNC_ENCODE_DEPTH; i++)
+		video_frame_free(&encoder->async_frames[i]);
+	os_sem_destroy(encoder->async_queued);
+	os_sem_destroy(encoder->async_free);
+	encoder->async_queued = NULL;
+	encoder->async_free = NULL;
+}
+
+static bool start_async_encode(struct obs_encoder *encoder,
+			       const struct video_scale_info *info)
+{
+	stop_async_encode(encoder);
+
+	if (os_sem_init(&encoder->async_queued, 0) != 0)
+		return false;
+	if (os_sem_init(&encoder->async_free, ASYNC_ENCODE_DEPTH) != 0) {
+		os_sem_destroy(encoder->async_queued);
+		encoder->async_queued = NULL;
+		return false;
+	}
+
+	for (size_t i = 0; i < ASYNC_ENCODE_DEPTH; i++)
+		video_frame_init(&encoder->async_frames[i], info->format,
+				 info->width, info->height);
+
+	encoder->async_format = info->format;
+	encoder->async_height = info->height;
+	encoder->async_read = 0;
+	encoder->async_write = 0;
+	encoder->async_count = 0;
+	encoder->async_failed = false;
+
+	if (pthread_create(&encoder->async_thread, NULL, async_encode_thread,
+			   encoder) != 0) {
+		for (size_t i = 0; i < ASYNC_ENCODE_DEPTH; i++)
+			video_frame_free(&encoder->async_frames[i]);
+		os_sem_destroy(encoder->async_queued);
+		os_sem_destroy(encoder->async_free);
+		encoder->async_queued = NULL;
+		encoder->async_free = NULL;
+		return false;
+	}
+
+	encoder->async_thread_active = true;
+	return true;
+}
+
+/* pausing is per encoder, so encoders of pausable outputs aren't shared */
+static bool audio_encoder_shareable(struct obs_encoder *encoder)
+{
+	bool shareable = true;
+
+	os_mutex_lock(&encoder->outputs_mutex);
+	for (size_t i = 0; i < encoder->outputs.num; i++) {
+		struct obs_output *output = encoder->outputs.array[i];
+		if (output->info.flags & OBS_OUTPUT_CAN_PAUSE) {
+			shareable = false;
+			break;
+		}
+	}
+	os_mutex_unlock(&encoder->outputs_mutex);
+
+	return shareable;
+}
+
+static inline bool audio_encoders_identical(struct obs_encoder *a,
+					    struct obs_encoder *b)
+{
+	return a->media == b->media && a->mixer_idx == b->mixer_idx &&
+	       a->samplerate == b->samplerate &&
+	       strcmp(a->info.id, b->info.id) == 0 &&
+	       strcmp(obs_data_get_json(a->context.settings),
+		      obs_data_get_json(b->context.settings)) == 0;
+}
+
+static bool follow_audio_leader(struct obs_encoder *encoder,
+				struct obs_encoder *leader)
+{
+	bool running;
+
+	/* a leader whose last output just stopped is about to disconnect */
+	pthread_mutex_lock(&leader->callbacks_mutex);
+	running = leader->callbacks.num || leader->audio_headless;
+	if (running)
+		da_push_back(leader->audio_followers, &encoder);
+	pthread_mutex_unlock(&leader->callbacks_mutex);
+
+	if (running)
+		encoder->audio_leader = leader;
+	return running;
+}
+
+/*
+ * Audio encoders paired to a video encoder start exactly at its first frame,
+ * which the packets of an encoder that is already running would not, so only
+ * unpaired encoders (e.g. of outputs joining an active video encoder) follow
+ * another one.
+ */
+static bool find_audio_leader(struct obs_encoder *encoder)
+{
+	struct obs_encoder *other;
+	bool found = false;
+
+	if (encoder->paired_encoders.num || !audio_encoder_shareable(encoder))
+		return false;
+
+	os_mutex_lock(&obs->data.encoders_mutex);
+
+	other = obs->data.first_encoder;
+	while (other && !found) {
+		if (other != encoder && other->info.type == OBS_ENCODER_AUDIO &&
+		    !other->audio_leader &&
+		    os_atomic_load_bool(&other->active) &&
+		    audio_encoders_identical(encoder, other) &&
+		    audio_encoder_shareable(other) &&
+		    obs_encoder_get_ref(other)) {
+			found = follow_audio_leader(encoder, other);
+			if (!found)
+				obs_encoder_release(other);
+		}
+
+		other = (struct obs_encoder *)other->context.next;
+	}
+
+	os_mutex_unlock(&obs->data.encoders_mutex);
+
+	if (found)
+		blog(LOG_INFO,
+		     "encoder '%s': Sharing packets of identical encoder '%s'",
+		     encoder->context.name,
+		     encoder->audio_leader->context.name);
+	return found;
+}
+
+static void remove_connection(struct obs_encoder *encoder, bool shutdown);
+
+static inline bool audio_leader_unused(struct obs_encoder *leader)
+{
+	bool unused;
+
+	pthread_mutex_lock(&leader->callbacks_mutex);
+	unused = leader->audio_headless && !leader->audio_followers.num;
+	pthread_mutex_unlock(&leader->callbacks_mutex);
+
+	return unused;
+}
+
+static void stop_following_audio_leader(struct obs_encoder *encoder)
+{
+	struct obs_encoder *leader = encoder->audio_leader;
+
+	pthread_mutex_lock(&leader->callbacks_mutex);
+	da_erase_item(leader->audio_followers, &encoder);
+	pthread_mutex_unlock(&leader->callbacks_mutex);
+
+	encoder->audio_leader = NULL;
+
+	/* stop the leader if it was only still running for its followers,
+	 * checking again once locked in case an output has started it */
+	if (audio_leader_unused(leader)) {
+		pthread_mutex_lock(&leader->init_mutex);
+		if (audio_leader_unused(leader)) {
+			leader->audio_headless = false;
+			remove_connection(leader, true);
+			leader->initialized = false;
+		}
+		pthread_mutex_unlock(&leader->init_mutex);
+	}
+
+	obs_encoder_release(leader);
+}
+
+static os_task_queue_t *get_audio_encode_worker(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	os_task_queue_t *worker = NULL;
+
+	os_mutex_lock(&obs->data.encoders_mutex);
+
+	if (!audio->num_encode_workers) {
+		size_t cores = (size_t)os_get_logical_cores();
+		size_t workers = cores > 2 ? cores / 2 : 1;
+
+		if (workers > MAX_AUDIO_ENCODE_WORKERS)
+			workers = MAX_AUDIO_ENCODE_WORKERS;
+
+		for (size_t i = 0; i < workers; i++) {
+			audio->encode_workers[i] = os_task_queue_create();
+			if (!audio->encode_workers[i])
+				break;
+			audio->num_encode_workers++;
+		}
+	}
+
+	/* an encoder always stays on one worker, which keeps its frames in
+	 * order */
+	if (audio->num_encode_workers) {
+		size_t idx = audio->next_encode_worker++ %
+			     audio->num_encode_workers;
+		worker = audio->encode_workers[idx];
+	}
+
+	os_mutex_unlock(&obs->data.encoders_mutex);
+	return worker;
+}
+
+static void start_audio_encode_worker(struct obs_encoder *encoder)
+{
+	encoder->audio_worker = NULL;
+	os_atomic_set_bool(&encoder->audio_failed, false);
+	os_atomic_inc_long(&encoder->audio_session);
+
+	if (!os_atomic_load_bool(&obs->audio.parallel_encode))
+		return;
+	if (!encoder->audio_slots &&
+	    os_sem_init(&encoder->audio_slots, AUDIO_ENCODE_QUEUE_DEPTH) != 0)
+		return;
+
+	encoder->audio_worker = get_audio_encode_worker();
+}
+
+/* waits for the frames queued on the worker, unless called from a frame */
+static void wait_audio_encode_worker(struct obs_encoder *encoder)
+{
+	if (!encoder->audio_worker ||
+	    os_task_queue_inside(encoder->audio_worker))
+		return;
+
+	for (size_t i = 0; i < AUDIO_ENCODE_QUEUE_DEPTH; i++)
+		os_sem_wait(encoder->audio_slots);
+	for (size_t i = 0; i < AUDIO_ENCODE_QUEUE_DEPTH; i++)
+		os_sem_post(encoder->audio_slots);
+}
+
 static void add_connection(struct obs_encoder *encoder)
 {
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		struct audio_convert_info audio_info = {0};
 		get_audio_info(encoder, &audio_info);
 
-		audio_output_connect(encoder->media, encoder->mixer_idx,
-				     &audio_info, receive_audio, encoder);
+		if (!find_audio_leader(encoder)) {
+			start_audio_encode_worker(encoder);
+			audio_output_connect(encoder->media, encoder->mixer_idx,
+					     &audio_info, receive_audio,
+					     encoder);
+		}
 	} else {
 		struct video_scale_info info = {0};
 		get_video_info(encoder, &info);
@@ -318,9 +620,18 @@ static void add_connection(struct obs_encoder *encoder)
 		if (gpu_encode_available(encoder)) {
 			start_gpu_encode(encoder);
 		} else {
+			if (encoder->info.caps & OBS_ENCODER_CAP_ASYNC_ENCODE &&
+			    !start_async_encode(encoder, &info))
+				blog(LOG_WARNING,
+				     "encoder '%s': Failed to start async "
+				     "encoding, encoding synchronously",
+				     encoder->context.name);
+
 			start_raw_video(encoder->media, &info,
 					encoder->frame_rate_divisor,
 					receive_video, encoder);
+			encoder->connected_width = info.width;
+			encoder->connected_height = info.height;
 		}
 	}
 
@@ -341,13 +652,22 @@ static void add_connection(struct obs_encoder *encoder)
 static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 {
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
-		audio_output_disconnect(encoder->media, encoder->mixer_idx,
-					receive_audio, encoder);
+		if (encoder->audio_leader) {
+			stop_following_audio_leader(encoder);
+		} else {
+			audio_output_disconnect(encoder->media,
+						encoder->mixer_idx,
+						receive_audio, encoder);
+			wait_audio_encode_worker(encoder);
+		}
 	} else {
 		if (gpu_encode_available(encoder)) {
 			stop_gpu_encode(encoder);
 		} else {
 			stop_raw_video(encoder->media, receive_video, encoder);
+			stop_async_encode(encoder);
+			encoder->connected_width = 0;
+			encoder->connected_height = 0;
 		}
 	}
 
@@ -382,7 +702,7 @@ static inline void free_audio_buffers(struct obs_encoder *encoder)
 static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 {
 	if (encoder) {
-		pthread_mutex_lock(&encoder->outputs_mutex);
+		os_mutex_lock(&encoder->outputs_mutex);
 		for (size_t i = 0; i < encoder->outputs.num; i++) {
 			struct obs_output *output = encoder->outputs.array[i];
 			// This happens while the output is still "active", so
@@ -390,7 +710,7 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 			obs_output_remove_encoder_internal(output, encoder);
 		}
 		da_free(encoder->outputs);
-		pthread_mutex_unlock(&encoder->outputs_mutex);
+		os_mutex_unlock(&encoder->outputs_mutex);
 
 		blog(LOG_DEBUG, "encoder '%s' destroyed",
 		     encoder->context.name);
@@ -414,15 +734,28 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 
 		free_audio_buffers(encoder);
 
+		stop_async_encode(encoder);
+		wait_audio_encode_worker(encoder);
+
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
 		da_free(encoder->callbacks);
 		da_free(encoder->roi);
+		da_free(encoder->scene_roi_list);
+		da_free(encoder->fallback_packet);
+		da_free(encoder->audio_followers);
+		os_sem_destroy(encoder->audio_slots);
+		bfree(encoder->fallback_id);
+		obs_data_release(encoder->fallback_settings);
+		if (encoder->scene_roi)
+			os_atomic_dec_long(&obs->data.scene_roi_encoders);
 		pthread_mutex_destroy(&encoder->init_mutex);
+		pthread_mutex_destroy(&encoder->impl_mutex);
 		pthread_mutex_destroy(&encoder->callbacks_mutex);
-		pthread_mutex_destroy(&encoder->outputs_mutex);
+		os_mutex_destroy(&encoder->outputs_mutex);
 		pthread_mutex_destroy(&encoder->pause.mutex);
 		pthread_mutex_destroy(&encoder->roi_mutex);
+		pthread_mutex_destroy(&encoder->stats_mutex);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void *)encoder->info.id);
@@ -431,6 +764,9 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 		if (encoder->fps_override)
 			video_output_free_frame_rate_divisor(
 				encoder->fps_override);
+		metric_release(encoder->encode_time_metric);
+		metric_release(encoder->latency_metrics[0]);
+		metric_release(encoder->latency_metrics[1]);
 		bfree(encoder);
 	}
 }
@@ -564,22 +900,30 @@ void obs_encoder_update(obs_encoder_t *encoder, obs_data_t *settings)
 	if (encoder_active(encoder)) {
 		encoder->reconfigure_requested = true;
 	} else {
-		encoder->info.update(encoder->context.data,
-				     encoder->context.settings);
+		pthread_mutex_lock(&encoder->impl_mutex);
+		if (encoder->context.data)
+			encoder->info.update(encoder->context.data,
+					     encoder->context.settings);
+		pthread_mutex_unlock(&encoder->impl_mutex);
 	}
 }
 
 bool obs_encoder_get_extra_data(const obs_encoder_t *encoder,
 				uint8_t **extra_data, size_t *size)
 {
+	struct obs_encoder *enc = (struct obs_encoder *)encoder;
+	bool success = false;
+
 	if (!obs_encoder_valid(encoder, "obs_encoder_get_extra_data"))
 		return false;
 
+	pthread_mutex_lock(&enc->impl_mutex);
 	if (encoder->info.get_extra_data && encoder->context.data)
-		return encoder->info.get_extra_data(encoder->context.data,
-						    extra_data, size);
+		success = encoder->info.get_extra_data(encoder->context.data,
+						       extra_data, size);
+	pthread_mutex_unlock(&enc->impl_mutex);
 
-	return false;
+	return success;
 }
 
 obs_data_t *obs_encoder_get_settings(const obs_encoder_t *encoder)
@@ -635,6 +979,14 @@ static inline bool obs_encoder_initialize_internal(obs_encoder_t *encoder)
 
 	maybe_set_up_gpu_rescale(encoder);
 
+	encoder->fallback_active = false;
+	encoder->fallback_headers = false;
+
+	pthread_mutex_lock(&encoder->stats_mutex);
+	encoder->stats_pos = 0;
+	encoder->stats_num = 0;
+	pthread_mutex_unlock(&encoder->stats_mutex);
+
 	if (encoder->orig_info.create) {
 		can_reroute = true;
 		encoder->info = encoder->orig_info;
@@ -718,6 +1070,9 @@ void obs_encoder_shutdown(obs_encoder_t *encoder)
 {
 	pthread_mutex_lock(&encoder->init_mutex);
 	if (encoder->context.data) {
+		wait_audio_encode_worker(encoder);
+		encoder->audio_worker = NULL;
+
 		encoder->info.destroy(encoder->context.data);
 		encoder->context.data = NULL;
 		da_free(encoder->paired_encoders);
@@ -771,6 +1126,12 @@ static inline void obs_encoder_start_internal(
 
 	first = (encoder->callbacks.num == 0);
 
+	/* still running for the encoders following it */
+	if (first && encoder->audio_headless) {
+		encoder->audio_headless = false;
+		first = false;
+	}
+
 	size_t idx = get_callback_idx(encoder, new_packet, param);
 	if (idx == DARRAY_INVALID)
 		da_push_back(encoder->callbacks, &cb);
@@ -817,6 +1178,12 @@ static inline bool obs_encoder_stop_internal(
 		last = (encoder->callbacks.num == 0);
 	}
 
+	/* keep encoding for the followers, the last of them stops it */
+	if (last && encoder->audio_followers.num) {
+		encoder->audio_headless = true;
+		last = false;
+	}
+
 	pthread_mutex_unlock(&encoder->callbacks_mutex);
 
 	if (last) {
@@ -1026,6 +1393,9 @@ uint32_t obs_encoder_get_width(const obs_encoder_t *encoder)
 	if (!encoder->media)
 		return 0;
 
+	if (encoder->connected_width)
+		return encoder->connected_width;
+
 	return encoder->scaled_width != 0
 		       ? encoder->scaled_width
 		       : video_output_get_width(encoder->media);
@@ -1045,6 +1415,9 @@ uint32_t obs_encoder_get_height(const obs_encoder_t *encoder)
 	if (!encoder->media)
 		return 0;
 
+	if (encoder->connected_height)
+		return encoder->connected_height;
+
 	return encoder->scaled_height != 0
 		       ? encoder->scaled_height
 		       : video_output_get_height(encoder->media);
@@ -1306,6 +1679,10 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	first_packet.data = data.array;
 	first_packet.size = data.num;
 
+	if (obs_nal_index_valid(&packet->nal_index, packet->size))
+		obs_nal_index_build(&first_packet.nal_index, first_packet.data,
+				    first_packet.size);
+
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
@@ -1326,24 +1703,250 @@ static inline void send_packet(struct obs_encoder *encoder,
 	profile_end(send_packet_name);
 }
 
-void full_stop(struct obs_encoder *encoder)
+void encoder_stats_submit(struct obs_encoder *encoder, int64_t pts)
 {
-	if (encoder) {
-		pthread_mutex_lock(&encoder->outputs_mutex);
-		for (size_t i = 0; i < encoder->outputs.num; i++) {
-			struct obs_output *output = encoder->outputs.array[i];
-			obs_output_force_stop(output);
+	struct encoder_stats_submit *submit;
+	uint64_t ts = os_gettime_ns();
+
+	submit = &encoder->stats_submits[encoder->stats_submit_pos];
+	submit->pts = pts;
+	submit->ts = ts;
 
-			pthread_mutex_lock(&output->interleaved_mutex);
-			output->info.encoded_packet(output->context.data, NULL);
-			pthread_mutex_unlock(&output->interleaved_mutex);
+	encoder->stats_submit_pos =
+		(encoder->stats_submit_pos + 1) % ENCODER_STATS_SUBMITS;
+	encoder->stats_encode_start = ts;
+}
+
+static void encoder_stats_add_packet(struct obs_encoder *encoder,
+				     const struct encoder_packet *pkt)
+{
+	struct obs_encoder_frame_stats *frame;
+	uint64_t ts = os_gettime_ns();
+	uint64_t submit_ts = encoder->stats_encode_start;
+
+	/* encoders with lookahead or b-frames return packets for frames
+	 * submitted earlier than the last one */
+	for (size_t i = 0; i < ENCODER_STATS_SUBMITS; i++) {
+		if (encoder->stats_submits[i].pts == pkt->pts &&
+		    encoder->stats_submits[i].ts) {
+			submit_ts = encoder->stats_submits[i].ts;
+			break;
 		}
-		pthread_mutex_unlock(&encoder->outputs_mutex);
+	}
 
-		pthread_mutex_lock(&encoder->callbacks_mutex);
-		da_free(encoder->callbacks);
-		pthread_mutex_unlock(&encoder->callbacks_mutex);
+	pthread_mutex_lock(&encoder->stats_mutex);
+
+	frame = &encoder->stats[encoder->stats_pos];
+	frame->submit_ts = submit_ts;
+	frame->output_ts = ts;
+	frame->encode_ns = ts - encoder->stats_encode_start;
+	frame->size = pkt->size;
+	frame->keyframe = pkt->keyframe;
+	frame->qp = pkt->qp;
+
+	encoder->stats_pos = (encoder->stats_pos + 1) % ENCODER_STATS_FRAMES;
+	if (encoder->stats_num < ENCODER_STATS_FRAMES)
+		encoder->stats_num++;
+
+	pthread_mutex_unlock(&encoder->stats_mutex);
+
+	obs_latency_encoder_packet(encoder, pkt, submit_ts);
+}
+
+static void force_stop_outputs(struct obs_encoder *encoder)
+{
+	os_mutex_lock(&encoder->outputs_mutex);
+	for (size_t i = 0; i < encoder->outputs.num; i++) {
+		struct obs_output *output = encoder->outputs.array[i];
+		obs_output_force_stop(output);
+
+		os_mutex_lock(&output->interleaved_mutex);
+		output->info.encoded_packet(output->context.data, NULL);
+		os_mutex_unlock(&output->interleaved_mutex);
+	}
+	os_mutex_unlock(&encoder->outputs_mutex);
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	da_free(encoder->callbacks);
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+}
+
+void full_stop(struct obs_encoder *encoder);
+
+static void full_stop_audio_followers(struct obs_encoder *encoder)
+{
+	DARRAY(struct obs_encoder *) followers;
+
+	pthread_mutex_lock(&encoder->callbacks_mutex);
+	encoder->audio_headless = false;
+	da_init(followers);
+	da_copy(followers, encoder->audio_followers);
+	pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+	for (size_t i = 0; i < followers.num; i++)
+		full_stop(followers.array[i]);
+
+	da_free(followers);
+}
+
+static void send_to_audio_followers(struct obs_encoder *encoder,
+				    struct encoder_packet *pkt)
+{
+	for (size_t i = 0; i < encoder->audio_followers.num; i++) {
+		struct obs_encoder *follower;
+		follower = encoder->audio_followers.array[i];
+
+		struct encoder_packet follower_pkt = *pkt;
+		follower_pkt.encoder = follower;
+
+		pthread_mutex_lock(&follower->callbacks_mutex);
+		for (size_t j = follower->callbacks.num; j > 0; j--) {
+			struct encoder_callback *cb;
+			cb = follower->callbacks.array + (j - 1);
+			send_packet(follower, cb, &follower_pkt);
+		}
+		pthread_mutex_unlock(&follower->callbacks_mutex);
+	}
+}
+
+static void *encoder_fallback_thread(void *param)
+{
+	struct obs_encoder *encoder = param;
+	const struct obs_encoder_info *ei;
+	struct obs_encoder_info old_info;
+	void *old_data;
+	void *data;
+
+	os_set_thread_name("obs-encoder: fallback");
+
+	pthread_mutex_lock(&encoder->init_mutex);
+
+	/* the outputs may have stopped the encoder in the meantime */
+	if (!os_atomic_load_bool(&encoder->active)) {
+		os_atomic_set_bool(&encoder->fallback_pending, false);
+		pthread_mutex_unlock(&encoder->init_mutex);
+		obs_encoder_release(encoder);
+		return NULL;
+	}
+
+	remove_connection(encoder, false);
+
+	/* the encode thread is disconnected now, other threads only call into
+	 * the implementation while holding impl_mutex */
+	ei = find_encoder(encoder->fallback_id);
+
+	pthread_mutex_lock(&encoder->impl_mutex);
+	old_info = encoder->info;
+	old_data = encoder->context.data;
+	encoder->context.data = NULL;
+	if (ei)
+		encoder->info = *ei;
+	pthread_mutex_unlock(&encoder->impl_mutex);
+
+	old_info.destroy(old_data);
+
+	data = ei ? ei->create(encoder->fallback_settings, encoder) : NULL;
+
+	pthread_mutex_lock(&encoder->impl_mutex);
+	encoder->context.data = data;
+	if (!data)
+		encoder->info = encoder->orig_info;
+	pthread_mutex_unlock(&encoder->impl_mutex);
+
+	if (encoder->context.data) {
+		blog(LOG_WARNING, "encoder '%s': Switched to fallback '%s'",
+		     encoder->context.name, encoder->fallback_id);
+
+		encoder->fallback_active = true;
+		encoder->fallback_headers = true;
+		os_atomic_set_bool(&encoder->fallback_pending, false);
+		add_connection(encoder);
+		pthread_mutex_unlock(&encoder->init_mutex);
+	} else {
+		blog(LOG_ERROR, "encoder '%s': Failed to create fallback '%s'",
+		     encoder->context.name, encoder->fallback_id);
+
+		encoder->initialized = false;
+		os_atomic_set_bool(&encoder->fallback_pending, false);
+		pthread_mutex_unlock(&encoder->init_mutex);
+		force_stop_outputs(encoder);
+	}
+
+	obs_encoder_release(encoder);
+	return NULL;
+}
+
+/* swaps the failed implementation out on a separate thread, as the encode
+ * thread can't disconnect itself */
+static bool start_encoder_fallback(struct obs_encoder *encoder)
+{
+	pthread_t thread;
+
+	if (os_atomic_load_bool(&encoder->fallback_pending))
+		return true;
+	if (!encoder->fallback_id || encoder->fallback_active)
+		return false;
+	if (!obs_encoder_get_ref(encoder))
+		return false;
+
+	os_atomic_set_bool(&encoder->fallback_pending, true);
+
+	if (pthread_create(&thread, NULL, encoder_fallback_thread, encoder) !=
+	    0) {
+		os_atomic_set_bool(&encoder->fallback_pending, false);
+		obs_encoder_release(encoder);
+		return false;
+	}
+
+	pthread_detach(thread);
+	return true;
+}
+
+/* the first keyframe of a fallback implementation carries its headers, as
+ * outputs only send the ones of the original implementation */
+static void add_fallback_headers(struct obs_encoder *encoder,
+				 struct encoder_packet *pkt)
+{
+	uint8_t *header;
+	size_t size;
+
+	if (!pkt->keyframe)
+		return;
 
+	encoder->fallback_headers = false;
+
+	if (!encoder->info.get_extra_data ||
+	    !encoder->info.get_extra_data(encoder->context.data, &header,
+					  &size) ||
+	    !size)
+		return;
+
+	da_resize(encoder->fallback_packet, 0);
+	da_push_back_array(encoder->fallback_packet, header, size);
+	da_push_back_array(encoder->fallback_packet, pkt->data, pkt->size);
+
+	pkt->data = encoder->fallback_packet.array;
+	pkt->size = encoder->fallback_packet.num;
+}
+
+/* index the NAL units once here so that outputs, muxers and caption insertion
+ * don't all have to scan the packet for start codes again */
+static void index_encoder_packet(struct obs_encoder *encoder,
+				 struct encoder_packet *pkt)
+{
+	const char *codec = encoder->info.codec;
+
+	if (strcmp(codec, "h264") == 0 || strcmp(codec, "hevc") == 0)
+		obs_nal_index_build(&pkt->nal_index, pkt->data, pkt->size);
+	else
+		obs_nal_index_clear(&pkt->nal_index);
+}
+
+void full_stop(struct obs_encoder *encoder)
+{
+	if (encoder) {
+		force_stop_outputs(encoder);
+		full_stop_audio_followers(encoder);
 		remove_connection(encoder, false);
 		encoder->initialized = false;
 	}
@@ -1355,11 +1958,40 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 	if (!success) {
 		blog(LOG_ERROR, "Error encoding with encoder '%s'",
 		     encoder->context.name);
+
+		if (start_encoder_fallback(encoder))
+			return;
+
+		/* stop_raw_video in full_stop waits for the video output
+		 * thread, which may be waiting for a free async slot */
+		if (encoder->async_thread_active) {
+			os_atomic_set_bool(&encoder->async_failed, true);
+			os_sem_post(encoder->async_free);
+		}
+
+		/* same for the audio thread waiting for a free queue slot,
+		 * the frame that failed hands its slot back early */
+		if (encoder->audio_worker &&
+		    os_task_queue_inside(encoder->audio_worker)) {
+			os_atomic_set_bool(&encoder->audio_failed, true);
+			encoder->audio_slot_released = true;
+			os_sem_post(encoder->audio_slots);
+		}
+
 		full_stop(encoder);
 		return;
 	}
 
 	if (received) {
+		if (encoder->info.type == OBS_ENCODER_VIDEO)
+			encoder_stats_add_packet(encoder, pkt);
+
+		if (encoder->fallback_headers)
+			add_fallback_headers(encoder, pkt);
+
+		if (encoder->info.type == OBS_ENCODER_VIDEO)
+			index_encoder_packet(encoder, pkt);
+
 		if (!encoder->first_received) {
 			encoder->offset_usec = packet_dts_usec(pkt);
 			encoder->first_received = true;
@@ -1383,10 +2015,27 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 			send_packet(encoder, cb, pkt);
 		}
 
+		send_to_audio_followers(encoder, pkt);
+
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 	}
 }
 
+static metric_t *get_encode_time_metric(struct obs_encoder *encoder)
+{
+	struct dstr labels = {0};
+	metric_t *metric;
+
+	metric_label_cat(&labels, "encoder", encoder->context.name);
+	metric_label_cat(&labels, "type",
+			 encoder->info.type == OBS_ENCODER_VIDEO ? "video"
+								 : "audio");
+	metric = metric_get(METRIC_HISTOGRAM, "obs_encode_time_seconds",
+			    labels.array, "Time spent encoding each frame");
+	dstr_free(&labels);
+	return metric;
+}
+
 static const char *do_encode_name = "do_encode";
 bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 {
@@ -1395,24 +2044,34 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 		encoder->profile_encoder_encode_name =
 			profile_store_name(obs_get_profiler_name_store(),
 					   "encode(%s)", encoder->context.name);
+	if (!encoder->encode_time_metric)
+		encoder->encode_time_metric = get_encode_time_metric(encoder);
 
 	struct encoder_packet pkt = {0};
 	bool received = false;
+	uint64_t start_ns;
 	bool success;
 
 	if (encoder->reconfigure_requested) {
 		encoder->reconfigure_requested = false;
 		encoder->info.update(encoder->context.data,
-				     encoder->context.settings);
+				     encoder->fallback_active
+					     ? encoder->fallback_settings
+					     : encoder->context.settings);
 	}
 
 	pkt.timebase_num = encoder->timebase_num * encoder->frame_rate_divisor;
 	pkt.timebase_den = encoder->timebase_den;
 	pkt.encoder = encoder;
 
+	if (encoder->info.type == OBS_ENCODER_VIDEO)
+		encoder_stats_submit(encoder, frame->pts);
+
 	profile_start(encoder->profile_encoder_encode_name);
+	start_ns = os_gettime_ns();
 	success = encoder->info.encode(encoder->context.data, frame, &pkt,
 				       &received);
+	metric_record(encoder->encode_time_metric, os_gettime_ns() - start_ns);
 	profile_end(encoder->profile_encoder_encode_name);
 	send_off_encoder_packet(encoder, success, received, &pkt);
 
@@ -1451,14 +2110,60 @@ bool video_pause_check(struct pause_data *pause, uint64_t timestamp)
 	return ignore_frame;
 }
 
-static const char *receive_video_name = "receive_video";
-static void receive_video(void *param, struct video_data *frame)
+static bool do_encode_raw(struct obs_encoder *encoder, uint8_t **data,
+			  uint32_t *linesize)
+{
+	struct encoder_frame enc_frame;
+
+	memset(&enc_frame, 0, sizeof(struct encoder_frame));
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		enc_frame.data[i] = data[i];
+		enc_frame.linesize[i] = linesize[i];
+	}
+
+	enc_frame.frames = 1;
+	enc_frame.pts = encoder->cur_pts;
+
+	if (!do_encode(encoder, &enc_frame))
+		return false;
+
+	encoder->cur_pts += encoder->timebase_num * encoder->frame_rate_divisor;
+	return true;
+}
+
+static void queue_async_frame(struct obs_encoder *encoder,
+			      struct video_data *frame)
+{
+	struct video_frame src;
+
+	if (os_atomic_load_bool(&encoder->async_failed))
+		return;
+
+	/* waits if the encoder is already ASYNC_ENCODE_DEPTH frames behind,
+	 * the video output then skips frames as it would when encoding
+	 * synchronously */
+	os_sem_wait(encoder->async_free);
+	if (os_atomic_load_bool(&encoder->async_failed))
+		return;
+
+	memcpy(src.data, frame->data, sizeof(src.data));
+	memcpy(src.linesize, frame->linesize, sizeof(src.linesize));
+	video_frame_copy(&encoder->async_frames[encoder->async_write], &src,
+			 encoder->async_format, encoder->async_height);
+
+	encoder->async_write = (encoder->async_write + 1) % ASYNC_ENCODE_DEPTH;
+	os_atomic_inc_long(&encoder->async_count);
+	os_sem_post(encoder->async_queued);
+}
+
+static const char *receive_video_name = "receive_video";
+static void receive_video(void *param, struct video_data *frame)
 {
 	profile_start(receive_video_name);
 
 	struct obs_encoder *encoder = param;
 	struct obs_encoder **paired = encoder->paired_encoders.array;
-	struct encoder_frame enc_frame;
 
 	if (encoder->encoder_group && !encoder->start_ts) {
 		struct encoder_group *group = encoder->encoder_group;
@@ -1482,22 +2187,18 @@ static void receive_video(void *param, struct video_data *frame)
 	if (video_pause_check(&encoder->pause, frame->timestamp))
 		goto wait_for_audio;
 
-	memset(&enc_frame, 0, sizeof(struct encoder_frame));
-
-	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-		enc_frame.data[i] = frame->data[i];
-		enc_frame.linesize[i] = frame->linesize[i];
-	}
+	if (os_atomic_load_bool(&encoder->fallback_pending))
+		goto wait_for_audio;
 
 	if (!encoder->start_ts)
 		encoder->start_ts = frame->timestamp;
 
-	enc_frame.frames = 1;
-	enc_frame.pts = encoder->cur_pts;
+	obs_latency_encoder_receive(encoder, frame->timestamp);
 
-	if (do_encode(encoder, &enc_frame))
-		encoder->cur_pts +=
-			encoder->timebase_num * encoder->frame_rate_divisor;
+	if (encoder->async_thread_active)
+		queue_async_frame(encoder, frame);
+	else
+		do_encode_raw(encoder, frame->data, frame->linesize);
 
 wait_for_audio:
 	profile_end(receive_video_name);
@@ -1612,25 +2313,111 @@ fail:
 	return success;
 }
 
+struct audio_encode_task {
+	struct obs_encoder *encoder;
+	long session;
+	struct encoder_frame frame;
+};
+
+static void audio_encode_task(void *param)
+{
+	struct audio_encode_task *task = param;
+	struct obs_encoder *encoder = task->encoder;
+	bool current = os_atomic_load_long(&encoder->audio_session) ==
+		       task->session;
+	bool released = false;
+
+	/* skip the frames still queued after an error stopped the encoder,
+	 * even if it has been started again since */
+	if (current && os_atomic_load_bool(&encoder->active)) {
+		encoder->audio_slot_released = false;
+		do_encode(encoder, &task->frame);
+		released = encoder->audio_slot_released;
+	}
+
+	/* every frame releases its slot exactly once, however the state was
+	 * reset while it was encoding */
+	if (!released)
+		os_sem_post(encoder->audio_slots);
+	bfree(task);
+}
+
+static void queue_audio_data(struct obs_encoder *encoder)
+{
+	size_t size = encoder->framesize_bytes;
+	struct audio_encode_task *task;
+	uint8_t *data;
+
+	/* bounds the queue, waits if the worker is falling behind */
+	os_sem_wait(encoder->audio_slots);
+
+	if (os_atomic_load_bool(&encoder->audio_failed)) {
+		for (size_t i = 0; i < encoder->planes; i++)
+			deque_pop_front(&encoder->audio_input_buffer[i], NULL,
+					size);
+		os_sem_post(encoder->audio_slots);
+		return;
+	}
+
+	task = bzalloc(sizeof(*task) + size * encoder->planes);
+	task->encoder = encoder;
+	task->session = os_atomic_load_long(&encoder->audio_session);
+	data = (uint8_t *)(task + 1);
+
+	for (size_t i = 0; i < encoder->planes; i++) {
+		deque_pop_front(&encoder->audio_input_buffer[i], data, size);
+
+		task->frame.data[i] = data;
+		task->frame.linesize[i] = (uint32_t)size;
+		data += size;
+	}
+
+	task->frame.frames = (uint32_t)encoder->framesize;
+	task->frame.pts = encoder->cur_pts;
+	encoder->cur_pts += encoder->framesize;
+
+	os_task_queue_queue_task(encoder->audio_worker, audio_encode_task,
+				 task);
+}
+
 static bool send_audio_data(struct obs_encoder *encoder)
 {
 	struct encoder_frame enc_frame;
 
+	if (encoder->audio_worker) {
+		queue_audio_data(encoder);
+		return true;
+	}
+
 	memset(&enc_frame, 0, sizeof(struct encoder_frame));
 
+	/* the input buffers are only modified by this thread, so the frame
+	 * can be encoded straight from them unless it wraps around */
 	for (size_t i = 0; i < encoder->planes; i++) {
-		deque_pop_front(&encoder->audio_input_buffer[i],
-				encoder->audio_output_buffer[i],
-				encoder->framesize_bytes);
+		struct deque *buf = &encoder->audio_input_buffer[i];
+		const void *data = deque_peek_front_contiguous(
+			buf, encoder->framesize_bytes);
+
+		if (!data) {
+			deque_peek_front(buf, encoder->audio_output_buffer[i],
+					 encoder->framesize_bytes);
+			data = encoder->audio_output_buffer[i];
+		}
 
-		enc_frame.data[i] = encoder->audio_output_buffer[i];
+		enc_frame.data[i] = (uint8_t *)data;
 		enc_frame.linesize[i] = (uint32_t)encoder->framesize_bytes;
 	}
 
 	enc_frame.frames = (uint32_t)encoder->framesize;
 	enc_frame.pts = encoder->cur_pts;
 
-	if (!do_encode(encoder, &enc_frame))
+	bool success = do_encode(encoder, &enc_frame);
+
+	for (size_t i = 0; i < encoder->planes; i++)
+		deque_pop_front(&encoder->audio_input_buffer[i], NULL,
+				encoder->framesize_bytes);
+
+	if (!success)
 		return false;
 
 	encoder->cur_pts += encoder->framesize;
@@ -1748,9 +2535,9 @@ void obs_encoder_add_output(struct obs_encoder *encoder,
 	if (!encoder || !output)
 		return;
 
-	pthread_mutex_lock(&encoder->outputs_mutex);
+	os_mutex_lock(&encoder->outputs_mutex);
 	da_push_back(encoder->outputs, &output);
-	pthread_mutex_unlock(&encoder->outputs_mutex);
+	os_mutex_unlock(&encoder->outputs_mutex);
 }
 
 void obs_encoder_remove_output(struct obs_encoder *encoder,
@@ -1759,9 +2546,185 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 	if (!encoder || !output)
 		return;
 
-	pthread_mutex_lock(&encoder->outputs_mutex);
+	os_mutex_lock(&encoder->outputs_mutex);
 	da_erase_item(encoder->outputs, &output);
-	pthread_mutex_unlock(&encoder->outputs_mutex);
+	os_mutex_unlock(&encoder->outputs_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Packet pool
+ *
+ * Packet payloads are allocated from power of two size classes, and freed
+ * blocks are cached per class instead of going back to the allocator.
+ * Pooled blocks carry a flag in their reference count, which keeps them
+ * compatible with packets allocated the old way (a bmalloc block starting
+ * with the reference count) that some parsers still create. */
+
+#define PACKET_POOL_MIN_SHIFT 8
+#define PACKET_POOL_MAX_SHIFT 22
+#define PACKET_POOL_CLASSES (PACKET_POOL_MAX_SHIFT - PACKET_POOL_MIN_SHIFT + 1)
+#define PACKET_POOL_MAX_CACHED (16 * 1024 * 1024)
+#define PACKET_POOL_REF_FLAG (1L << 30)
+
+struct pool_block {
+	struct pool_block *next;
+	size_t size_class;
+};
+
+struct pool_class {
+	pthread_mutex_t mutex;
+	struct pool_block *free_blocks;
+	size_t num_free;
+	uint64_t allocations;
+	uint64_t reused;
+	size_t in_use;
+};
+
+static struct {
+	volatile bool enabled;
+	struct pool_class classes[PACKET_POOL_CLASSES];
+	volatile long oversized;
+} packet_pool;
+
+static inline size_t pool_block_size(size_t size_class)
+{
+	return (size_t)1 << (size_class + PACKET_POOL_MIN_SHIFT);
+}
+
+static inline size_t pool_max_free(size_t size_class)
+{
+	size_t max = PACKET_POOL_MAX_CACHED / pool_block_size(size_class);
+	return max < 4 ? 4 : max;
+}
+
+void obs_encoder_packet_pool_init(void)
+{
+	memset(&packet_pool, 0, sizeof(packet_pool));
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++)
+		pthread_mutex_init(&packet_pool.classes[i].mutex, NULL);
+	os_atomic_set_bool(&packet_pool.enabled, true);
+}
+
+void obs_encoder_packet_pool_free(void)
+{
+	struct obs_encoder_packet_pool_stats stats;
+
+	if (!os_atomic_load_bool(&packet_pool.enabled))
+		return;
+
+	obs_encoder_packet_pool_get_stats(&stats);
+	blog(LOG_INFO,
+	     "Encoder packet pool: %" PRIu64 " allocations, %" PRIu64
+	     " reused, %" PRIu64 " oversized, %" PRIu64 " bytes cached",
+	     stats.allocations, stats.reused, stats.oversized,
+	     stats.cached_bytes);
+
+	/* blocks still in use at this point are freed on release */
+	os_atomic_set_bool(&packet_pool.enabled, false);
+
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++) {
+		struct pool_class *pc = &packet_pool.classes[i];
+
+		pthread_mutex_lock(&pc->mutex);
+		while (pc->free_blocks) {
+			struct pool_block *block = pc->free_blocks;
+			pc->free_blocks = block->next;
+			bfree(block);
+		}
+		pc->num_free = 0;
+		pthread_mutex_unlock(&pc->mutex);
+		pthread_mutex_destroy(&pc->mutex);
+	}
+}
+
+void obs_encoder_packet_pool_get_stats(
+	struct obs_encoder_packet_pool_stats *stats)
+{
+	if (!stats)
+		return;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!os_atomic_load_bool(&packet_pool.enabled))
+		return;
+
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++) {
+		struct pool_class *pc = &packet_pool.classes[i];
+		size_t size = pool_block_size(i);
+
+		pthread_mutex_lock(&pc->mutex);
+		stats->allocations += pc->allocations;
+		stats->reused += pc->reused;
+		stats->cached_bytes += (uint64_t)(pc->num_free * size);
+		stats->in_use_bytes += (uint64_t)(pc->in_use * size);
+		pthread_mutex_unlock(&pc->mutex);
+	}
+
+	stats->oversized =
+		(uint64_t)os_atomic_load_long(&packet_pool.oversized);
+}
+
+/* returns the reference count of a new block, NULL if the packet has to be
+ * allocated directly */
+static long *packet_pool_alloc(size_t size)
+{
+	size_t total = sizeof(struct pool_block) + sizeof(long) + size;
+	size_t size_class = 0;
+	struct pool_block *block;
+	struct pool_class *pc;
+
+	if (!os_atomic_load_bool(&packet_pool.enabled))
+		return NULL;
+
+	while (pool_block_size(size_class) < total) {
+		if (++size_class == PACKET_POOL_CLASSES) {
+			os_atomic_inc_long(&packet_pool.oversized);
+			return NULL;
+		}
+	}
+
+	pc = &packet_pool.classes[size_class];
+
+	pthread_mutex_lock(&pc->mutex);
+	block = pc->free_blocks;
+	if (block) {
+		pc->free_blocks = block->next;
+		pc->num_free--;
+		pc->reused++;
+	}
+	pc->allocations++;
+	pc->in_use++;
+	pthread_mutex_unlock(&pc->mutex);
+
+	if (!block)
+		block = bmalloc(pool_block_size(size_class));
+
+	block->next = NULL;
+	block->size_class = size_class;
+	return (long *)(block + 1);
+}
+
+static void packet_pool_release(long *p_refs)
+{
+	struct pool_block *block = ((struct pool_block *)p_refs) - 1;
+	struct pool_class *pc = &packet_pool.classes[block->size_class];
+
+	if (!os_atomic_load_bool(&packet_pool.enabled)) {
+		bfree(block);
+		return;
+	}
+
+	pthread_mutex_lock(&pc->mutex);
+	pc->in_use--;
+	if (pc->num_free < pool_max_free(block->size_class)) {
+		block->next = pc->free_blocks;
+		pc->free_blocks = block;
+		pc->num_free++;
+		block = NULL;
+	}
+	pthread_mutex_unlock(&pc->mutex);
+
+	bfree(block);
 }
 
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
@@ -1770,9 +2733,14 @@ void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 	long *p_refs;
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
+	p_refs = packet_pool_alloc(src->size);
+	if (p_refs) {
+		*p_refs = PACKET_POOL_REF_FLAG | 1;
+	} else {
+		p_refs = bmalloc(src->size + sizeof(long));
+		*p_refs = 1;
+	}
 	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1810,8 +2778,12 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 
 	if (pkt->data) {
 		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
+		long refs = os_atomic_dec_long(p_refs);
+
+		if (refs == 0)
 			bfree(p_refs);
+		else if (refs == PACKET_POOL_REF_FLAG)
+			packet_pool_release(p_refs);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
@@ -1973,7 +2945,7 @@ uint64_t obs_encoder_get_pause_offset(const obs_encoder_t *encoder)
 
 bool obs_encoder_has_roi(const obs_encoder_t *encoder)
 {
-	return encoder->roi.num > 0;
+	return encoder->roi.num > 0 || encoder->scene_roi_list.num > 0;
 }
 
 bool obs_encoder_add_roi(obs_encoder_t *encoder,
@@ -2008,6 +2980,26 @@ void obs_encoder_clear_roi(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&encoder->roi_mutex);
 }
 
+static inline void
+enum_roi_scaled(struct obs_encoder_roi *roi, float scale_x, float scale_y,
+		void (*enum_proc)(void *, struct obs_encoder_roi *),
+		void *param)
+{
+	if (scale_x > 0 && scale_y > 0) {
+		struct obs_encoder_roi scaled_roi = {
+			.top = (uint32_t)((float)roi->top * scale_y),
+			.bottom = (uint32_t)((float)roi->bottom * scale_y),
+			.left = (uint32_t)((float)roi->left * scale_x),
+			.right = (uint32_t)((float)roi->right * scale_x),
+			.priority = roi->priority,
+		};
+
+		enum_proc(param, &scaled_roi);
+	} else {
+		enum_proc(param, roi);
+	}
+}
+
 void obs_encoder_enum_roi(obs_encoder_t *encoder,
 			  void (*enum_proc)(void *, struct obs_encoder_roi *),
 			  void *param)
@@ -2029,26 +3021,16 @@ void obs_encoder_enum_roi(obs_encoder_t *encoder,
 
 	pthread_mutex_lock(&encoder->roi_mutex);
 
+	/* later regions overwrite earlier ones, so the scene regions go first
+	 * and the manually added ones last */
+	for (size_t i = 0; i < encoder->scene_roi_list.num; i++)
+		enum_roi_scaled(&encoder->scene_roi_list.array[i], scale_x,
+				scale_y, enum_proc, param);
+
 	size_t idx = encoder->roi.num;
-	while (idx) {
-		struct obs_encoder_roi *roi = &encoder->roi.array[--idx];
-
-		if (scale_x > 0 && scale_y > 0) {
-			struct obs_encoder_roi scaled_roi = {
-				.top = (uint32_t)((float)roi->top * scale_y),
-				.bottom = (uint32_t)((float)roi->bottom *
-						     scale_y),
-				.left = (uint32_t)((float)roi->left * scale_x),
-				.right =
-					(uint32_t)((float)roi->right * scale_x),
-				.priority = roi->priority,
-			};
-
-			enum_proc(param, &scaled_roi);
-		} else {
-			enum_proc(param, roi);
-		}
-	}
+	while (idx)
+		enum_roi_scaled(&encoder->roi.array[--idx], scale_x, scale_y,
+				enum_proc, param);
 
 	pthread_mutex_unlock(&encoder->roi_mutex);
 }
@@ -2058,6 +3040,293 @@ uint32_t obs_encoder_get_roi_increment(const obs_encoder_t *encoder)
 	return encoder->roi_increment;
 }
 
+void obs_encoder_set_scene_roi(obs_encoder_t *encoder, bool enable)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_scene_roi"))
+		return;
+	if (!(encoder->info.caps & OBS_ENCODER_CAP_ROI))
+		return;
+	if (encoder->scene_roi == enable)
+		return;
+
+	os_atomic_set_bool(&encoder->scene_roi, enable);
+
+	if (enable) {
+		os_atomic_inc_long(&obs->data.scene_roi_encoders);
+	} else {
+		os_atomic_dec_long(&obs->data.scene_roi_encoders);
+
+		pthread_mutex_lock(&encoder->roi_mutex);
+		if (encoder->scene_roi_list.num) {
+			da_free(encoder->scene_roi_list);
+			encoder->roi_increment++;
+		}
+		pthread_mutex_unlock(&encoder->roi_mutex);
+	}
+}
+
+bool obs_encoder_scene_roi_enabled(const obs_encoder_t *encoder)
+{
+	return encoder ? os_atomic_load_bool(&encoder->scene_roi) : false;
+}
+
+bool obs_encoder_get_stats(const obs_encoder_t *encoder,
+			   struct obs_encoder_stats *stats)
+{
+	uint64_t latency_total = 0;
+	uint64_t encode_total = 0;
+	double qp_total = 0.0;
+	uint32_t qp_frames = 0;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_encoder_get_stats"))
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (encoder->info.type != OBS_ENCODER_VIDEO)
+		return false;
+
+	pthread_mutex_lock((pthread_mutex_t *)&encoder->stats_mutex);
+
+	for (size_t i = 0; i < encoder->stats_num; i++) {
+		const struct obs_encoder_frame_stats *frame =
+			&encoder->stats[i];
+		uint64_t latency = frame->output_ts - frame->submit_ts;
+
+		if (frame->keyframe)
+			stats->keyframes++;
+		if (frame->qp) {
+			qp_total += frame->qp;
+			qp_frames++;
+		}
+		if (latency > stats->latency_max_ns)
+			stats->latency_max_ns = latency;
+		if (frame->encode_ns > stats->encode_max_ns)
+			stats->encode_max_ns = frame->encode_ns;
+
+		stats->bytes += frame->size;
+		latency_total += latency;
+		encode_total += frame->encode_ns;
+	}
+
+	stats->frames = (uint32_t)encoder->stats_num;
+
+	pthread_mutex_unlock((pthread_mutex_t *)&encoder->stats_mutex);
+
+	if (!stats->frames)
+		return false;
+
+	stats->latency_avg_ns = latency_total / stats->frames;
+	stats->encode_avg_ns = encode_total / stats->frames;
+	if (qp_frames)
+		stats->qp_avg = (float)(qp_total / qp_frames);
+	return true;
+}
+
+void obs_encoder_enum_frame_stats(
+	const obs_encoder_t *encoder,
+	void (*enum_proc)(void *, const struct obs_encoder_frame_stats *),
+	void *param)
+{
+	struct obs_encoder *enc = (struct obs_encoder *)encoder;
+	size_t first;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_enum_frame_stats"))
+		return;
+	if (!obs_ptr_valid(enum_proc, "obs_encoder_enum_frame_stats"))
+		return;
+
+	pthread_mutex_lock(&enc->stats_mutex);
+
+	first = enc->stats_num < ENCODER_STATS_FRAMES ? 0 : enc->stats_pos;
+	for (size_t i = 0; i < enc->stats_num; i++)
+		enum_proc(param,
+			  &enc->stats[(first + i) % ENCODER_STATS_FRAMES]);
+
+	pthread_mutex_unlock(&enc->stats_mutex);
+}
+
+void obs_encoder_set_fallback(obs_encoder_t *encoder, const char *id,
+			      obs_data_t *settings)
+{
+	const struct obs_encoder_info *ei;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_fallback"))
+		return;
+
+	if (id) {
+		ei = find_encoder(id);
+		if (!ei) {
+			blog(LOG_WARNING,
+			     "encoder '%s': Fallback '%s' does not exist",
+			     obs_encoder_get_name(encoder), id);
+			return;
+		}
+		if (ei->type != encoder->info.type ||
+		    strcmp(ei->codec, encoder->info.codec) != 0) {
+			blog(LOG_WARNING,
+			     "encoder '%s': Fallback '%s' does not match the "
+			     "encoder's type or codec",
+			     obs_encoder_get_name(encoder), id);
+			return;
+		}
+	}
+
+	if (obs_encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot set fallback while active",
+		     obs_encoder_get_name(encoder));
+		return;
+	}
+
+	bfree(encoder->fallback_id);
+	obs_data_release(encoder->fallback_settings);
+
+	encoder->fallback_id = id ? bstrdup(id) : NULL;
+	encoder->fallback_settings = NULL;
+
+	if (id) {
+		encoder->fallback_settings =
+			obs_encoder_defaults(encoder->fallback_id);
+		if (settings)
+			obs_data_apply(encoder->fallback_settings, settings);
+	}
+}
+
+struct scene_roi_data {
+	DARRAY(struct obs_encoder_roi) roi;
+	struct matrix4 to_output;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+static bool add_item_roi(obs_scene_t *scene, obs_sceneitem_t *item,
+			 void *param)
+{
+	struct scene_roi_data *data = param;
+	const float priority = obs_sceneitem_get_roi_priority(item);
+	struct matrix4 transform;
+	float left = (float)data->cx;
+	float top = (float)data->cy;
+	float right = 0.0f;
+	float bottom = 0.0f;
+
+	if (priority == 0.0f || !obs_sceneitem_visible(item))
+		return true;
+
+	obs_sceneitem_get_box_transform(item, &transform);
+	matrix4_mul(&transform, &transform, &data->to_output);
+
+	for (int i = 0; i < 4; i++) {
+		struct vec3 corner;
+		vec3_set(&corner, (float)(i & 1), (float)(i >> 1), 0.0f);
+		vec3_transform(&corner, &corner, &transform);
+
+		left = fminf(left, corner.x);
+		top = fminf(top, corner.y);
+		right = fmaxf(right, corner.x);
+		bottom = fmaxf(bottom, corner.y);
+	}
+
+	left = fmaxf(left, 0.0f);
+	top = fmaxf(top, 0.0f);
+	right = fminf(right, (float)data->cx);
+	bottom = fminf(bottom, (float)data->cy);
+
+	/* same minimum size obs_encoder_add_roi enforces */
+	if (right - left < 16.0f || bottom - top < 16.0f)
+		return true;
+
+	struct obs_encoder_roi *roi = da_push_back_new(data->roi);
+	roi->left = (uint32_t)left;
+	roi->top = (uint32_t)top;
+	roi->right = (uint32_t)right;
+	roi->bottom = (uint32_t)bottom;
+	roi->priority = priority;
+
+	UNUSED_PARAMETER(scene);
+	return true;
+}
+
+static void get_program_scene_roi(struct scene_roi_data *data)
+{
+	struct obs_video_info ovi;
+	obs_source_t *source;
+	obs_scene_t *scene;
+
+	if (!obs_get_video_info(&ovi) || !ovi.base_width || !ovi.base_height)
+		return;
+
+	data->cx = ovi.output_width;
+	data->cy = ovi.output_height;
+	matrix4_identity(&data->to_output);
+	matrix4_scale3f(&data->to_output, &data->to_output,
+			(float)ovi.output_width / (float)ovi.base_width,
+			(float)ovi.output_height / (float)ovi.base_height,
+			1.0f);
+
+	source = obs_get_output_source(0);
+	if (source && source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
+		obs_source_t *active = obs_transition_get_active_source(source);
+		obs_source_release(source);
+		source = active;
+	}
+
+	scene = obs_scene_from_source(source);
+	if (scene)
+		obs_scene_enum_items(scene, add_item_roi, data);
+
+	obs_source_release(source);
+}
+
+static bool scene_roi_changed(obs_encoder_t *encoder,
+			      const struct scene_roi_data *data)
+{
+	if (encoder->scene_roi_list.num != data->roi.num)
+		return true;
+	if (!data->roi.num)
+		return false;
+
+	return memcmp(encoder->scene_roi_list.array, data->roi.array,
+		      data->roi.num * sizeof(struct obs_encoder_roi)) != 0;
+}
+
+/* called once per frame from the graphics thread */
+void update_scene_roi(void)
+{
+	struct scene_roi_data data = {0};
+	video_t *video;
+
+	if (!os_atomic_load_long(&obs->data.scene_roi_encoders))
+		return;
+
+	get_program_scene_roi(&data);
+	video = obs_get_video();
+
+	os_mutex_lock(&obs->data.encoders_mutex);
+
+	obs_encoder_t *encoder = obs->data.first_encoder;
+	while (encoder) {
+		if (os_atomic_load_bool(&encoder->scene_roi) &&
+		    encoder->media == video) {
+			pthread_mutex_lock(&encoder->roi_mutex);
+			if (scene_roi_changed(encoder, &data)) {
+				da_copy(encoder->scene_roi_list, data.roi);
+				encoder->roi_increment++;
+			}
+			pthread_mutex_unlock(&encoder->roi_mutex);
+		}
+
+		encoder = (obs_encoder_t *)encoder->context.next;
+	}
+
+	os_mutex_unlock(&obs->data.encoders_mutex);
+
+	da_free(data.roi);
+}
+
 bool obs_encoder_group_keyframe_aligned_encoders(
 	obs_encoder_t *encoder, obs_encoder_t *encoder_to_be_grouped)
 {
@@ -2187,3 +3456,76 @@ bool obs_encoder_group_remove_keyframe_aligned_encoder(
 
 	return true;
 }
+
+static void release_ladder(obs_encoder_t *base, obs_encoder_t **encoders,
+			   size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		obs_encoder_group_remove_keyframe_aligned_encoder(base,
+								  encoders[i]);
+		obs_encoder_release(encoders[i]);
+		encoders[i] = NULL;
+	}
+}
+
+bool obs_video_encoder_create_ladder(
+	obs_encoder_t *base, const struct obs_encoder_ladder_rung *rungs,
+	size_t num_rungs, obs_encoder_t **encoders)
+{
+	if (!obs_encoder_valid(base, "obs_video_encoder_create_ladder"))
+		return false;
+	if (!obs_ptr_valid(rungs, "obs_video_encoder_create_ladder") ||
+	    !obs_ptr_valid(encoders, "obs_video_encoder_create_ladder"))
+		return false;
+	if (base->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING,
+		     "obs_video_encoder_create_ladder: "
+		     "encoder '%s' is not a video encoder",
+		     obs_encoder_get_name(base));
+		return false;
+	}
+
+	/* Every rung is rescaled from the same mix render texture, so GPU
+	 * scaling is required even if the base encoder does not use it */
+	enum obs_scale_type scale_type = base->gpu_scale_type;
+	if (scale_type == OBS_SCALE_DISABLE)
+		scale_type = OBS_SCALE_BICUBIC;
+
+	for (size_t i = 0; i < num_rungs; i++) {
+		const struct obs_encoder_ladder_rung *rung = &rungs[i];
+		obs_data_t *settings = obs_data_create();
+		obs_encoder_t *encoder;
+
+		obs_data_apply(settings, base->context.settings);
+		if (rung->settings)
+			obs_data_apply(settings, rung->settings);
+
+		encoder = obs_video_encoder_create(base->info.id, rung->name,
+						   settings, NULL);
+		obs_data_release(settings);
+
+		if (!encoder) {
+			release_ladder(base, encoders, i);
+			return false;
+		}
+
+		encoders[i] = encoder;
+
+		if (base->media)
+			obs_encoder_set_video(encoder, base->media);
+		obs_encoder_set_frame_rate_divisor(encoder,
+						   base->frame_rate_divisor);
+		obs_encoder_set_gpu_scale_type(encoder, scale_type);
+		obs_encoder_set_scaled_size(encoder, rung->width, rung->height);
+
+		if (!obs_encoder_group_keyframe_aligned_encoders(base,
+								 encoder)) {
+			obs_encoder_release(encoder);
+			encoders[i] = NULL;
+			release_ladder(base, encoders, i);
+			return false;
+		}
+	}
+
+	return true;
+}
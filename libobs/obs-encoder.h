@@ -25,6 +25,8 @@
  * to process output data.
  */
 
+#include "obs-nal.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +39,7 @@ typedef struct obs_encoder obs_encoder_t;
 #define OBS_ENCODER_CAP_DYN_BITRATE (1 << 2)
 #define OBS_ENCODER_CAP_INTERNAL (1 << 3)
 #define OBS_ENCODER_CAP_ROI (1 << 4)
+#define OBS_ENCODER_CAP_ASYNC_ENCODE (1 << 5)
 
 /** Specifies the encoder type */
 enum obs_encoder_type {
@@ -89,6 +92,16 @@ struct encoder_packet {
 
 	/** Encoder from which the track originated from */
 	obs_encoder_t *encoder;
+
+	/** Average quantizer of a video frame, or 0 if not reported */
+	int qp;
+
+	/**
+	 * NAL unit index of AVC/HEVC packets, built by libobs when a packet
+	 * is received from the encoder.  Use obs_nal_index_valid() before
+	 * relying on it, and clear it when replacing the packet data.
+	 */
+	struct obs_nal_index nal_index;
 };
 
 /** Encoder input frame */
@@ -123,6 +136,40 @@ struct obs_encoder_roi {
 	float priority;
 };
 
+/** Telemetry of an encoded video frame */
+struct obs_encoder_frame_stats {
+	/* System times in nanoseconds at which the frame was submitted to
+	 * the encoder and at which its packet was received */
+	uint64_t submit_ts;
+	uint64_t output_ts;
+
+	/* Time spent in the encode call that returned the packet */
+	uint64_t encode_ns;
+
+	size_t size;
+	bool keyframe;
+
+	/* Average quantizer, or 0 if not reported by the encoder */
+	int qp;
+};
+
+/** Telemetry summary over the most recently encoded video frames */
+struct obs_encoder_stats {
+	uint32_t frames;
+	uint32_t keyframes;
+	uint64_t bytes;
+
+	/* From submission to packet output */
+	uint64_t latency_avg_ns;
+	uint64_t latency_max_ns;
+
+	uint64_t encode_avg_ns;
+	uint64_t encode_max_ns;
+
+	/* Over the frames with a reported quantizer, 0 if there were none */
+	float qp_avg;
+};
+
 struct gs_texture;
 
 /** Encoder input texture */
@@ -0,0 +1,237 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+#include "util/util_uint64.h"
+
+/* Every source render on the graphics thread is wrapped in a pair of GPU
+ * timestamps.  Records of a frame are resolved NUM_GPU_TIMING_FRAMES - 1
+ * frames later so that reading the queries rarely has to wait on the GPU.
+ * Each record remembers the record it was nested in, which lets filters,
+ * scenes and transitions report their own cost without the cost of the
+ * sources they render. */
+
+#define NO_RECORD DARRAY_INVALID
+
+static inline bool timing_enabled(void)
+{
+	return os_atomic_load_bool(&obs->video.gpu_timing.enabled);
+}
+
+static void release_records(struct obs_gpu_timing_frame *frame)
+{
+	for (size_t i = 0; i < frame->records.num; i++)
+		obs_weak_source_release(frame->records.array[i].source);
+	da_resize(frame->records, 0);
+}
+
+static void resolve_frame(struct obs_gpu_timing_frame *frame)
+{
+	uint64_t frequency = 1000000000;
+	bool disjoint = false;
+
+	if (frame->range &&
+	    !gs_timer_range_get_data(frame->range, &disjoint, &frequency))
+		disjoint = true;
+
+	if (disjoint || !frequency)
+		goto release;
+
+	for (size_t i = 0; i < frame->records.num; i++) {
+		struct obs_gpu_timer_record *record =
+			&frame->records.array[i];
+		uint64_t ticks = 0;
+
+		gs_timer_get_data(frame->timers.array[i], &ticks);
+		record->time_ns = util_mul_div64(ticks, 1000000000, frequency);
+	}
+
+	/* records are in begin order, so children always come after their
+	 * parent and can be subtracted from it in one pass */
+	for (size_t i = 0; i < frame->records.num; i++) {
+		struct obs_gpu_timer_record *record =
+			&frame->records.array[i];
+		if (record->parent == NO_RECORD)
+			continue;
+
+		struct obs_gpu_timer_record *parent =
+			&frame->records.array[record->parent];
+		parent->time_ns = parent->time_ns > record->time_ns
+					  ? parent->time_ns - record->time_ns
+					  : 0;
+	}
+
+	for (size_t i = 0; i < frame->records.num; i++) {
+		struct obs_gpu_timer_record *record =
+			&frame->records.array[i];
+		obs_source_t *source =
+			obs_weak_source_get_source(record->source);
+		if (!source)
+			continue;
+
+		if (source->gpu_time_frame != frame->frame) {
+			source->gpu_time_frame = frame->frame;
+			source->gpu_time_accum = 0;
+		}
+		source->gpu_time_accum += record->time_ns;
+		source->gpu_time_ns = source->gpu_time_accum;
+
+		obs_source_release(source);
+	}
+
+release:
+	release_records(frame);
+}
+
+void obs_gpu_timing_begin_frame(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct obs_gpu_timing_frame *frame;
+
+	timing->active = timing_enabled();
+	if (!timing->active) {
+		for (size_t i = 0; i < NUM_GPU_TIMING_FRAMES; i++) {
+			if (timing->frames[i].pending) {
+				release_records(&timing->frames[i]);
+				timing->frames[i].pending = false;
+			}
+		}
+		return;
+	}
+
+	timing->cur = (timing->cur + 1) % NUM_GPU_TIMING_FRAMES;
+	timing->cur_record = NO_RECORD;
+	frame = &timing->frames[timing->cur];
+
+	if (frame->pending) {
+		resolve_frame(frame);
+		frame->pending = false;
+	}
+
+	if (!frame->range)
+		frame->range = gs_timer_range_create();
+	if (frame->range)
+		gs_timer_range_begin(frame->range);
+
+	frame->frame = ++timing->frame;
+}
+
+void obs_gpu_timing_end_frame(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct obs_gpu_timing_frame *frame;
+
+	if (!timing->active)
+		return;
+
+	frame = &timing->frames[timing->cur];
+	if (frame->range)
+		gs_timer_range_end(frame->range);
+
+	frame->pending = true;
+	timing->active = false;
+}
+
+size_t obs_gpu_timing_begin_source(obs_source_t *source)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct obs_gpu_timing_frame *frame;
+	struct obs_gpu_timer_record *record;
+	size_t idx;
+
+	if (!timing->active || !obs_in_task_thread(OBS_TASK_GRAPHICS))
+		return NO_RECORD;
+
+	frame = &timing->frames[timing->cur];
+	idx = frame->records.num;
+
+	if (idx == frame->timers.num) {
+		gs_timer_t *timer = gs_timer_create();
+		if (!timer)
+			return NO_RECORD;
+		da_push_back(frame->timers, &timer);
+	}
+
+	record = da_push_back_new(frame->records);
+	record->source = obs_source_get_weak_source(source);
+	record->parent = timing->cur_record;
+	timing->cur_record = idx;
+
+	gs_timer_begin(frame->timers.array[idx]);
+	return idx;
+}
+
+void obs_gpu_timing_end_source(size_t idx)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct obs_gpu_timing_frame *frame;
+
+	if (idx == NO_RECORD || !timing->active)
+		return;
+
+	frame = &timing->frames[timing->cur];
+	gs_timer_end(frame->timers.array[idx]);
+	timing->cur_record = frame->records.array[idx].parent;
+}
+
+void obs_gpu_timing_free(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+
+	for (size_t i = 0; i < NUM_GPU_TIMING_FRAMES; i++) {
+		struct obs_gpu_timing_frame *frame = &timing->frames[i];
+
+		release_records(frame);
+		for (size_t j = 0; j < frame->timers.num; j++)
+			gs_timer_destroy(frame->timers.array[j]);
+		gs_timer_range_destroy(frame->range);
+
+		da_free(frame->timers);
+		da_free(frame->records);
+		frame->range = NULL;
+		frame->pending = false;
+	}
+
+	timing->active = false;
+}
+
+void obs_set_gpu_source_timing(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->video.gpu_timing.enabled, enable);
+}
+
+bool obs_gpu_source_timing_enabled(void)
+{
+	return obs ? timing_enabled() : false;
+}
+
+uint64_t obs_source_get_gpu_render_time_ns(const obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_get_gpu_render_time_ns"))
+		return 0;
+
+	/* a source that was not rendered lately costs nothing */
+	if (!timing_enabled() ||
+	    source->gpu_time_frame + NUM_GPU_TIMING_FRAMES <
+		    obs->video.gpu_timing.frame)
+		return 0;
+
+	return source->gpu_time_ns;
+}
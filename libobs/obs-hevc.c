@@ -55,24 +55,49 @@ static int compute_hevc_keyframe_priority(const uint8_t *nal_start,
 
 	// Mark IDR slices as key-frames and set them to highest
 	// priority if needed. Assume other slices are non-key
-	// frames and set their priority as high
+	// frames and set their priority as high, unless they belong
+	// to a temporal enhancement layer, which lower layers never
+	// reference
 	if (type >= OBS_HEVC_NAL_BLA_W_LP &&
 	    type <= OBS_HEVC_NAL_RSV_IRAP_VCL23) {
 		*is_keyframe = 1;
 		priority = OBS_NAL_PRIORITY_HIGHEST;
 	} else if (type >= OBS_HEVC_NAL_TRAIL_N &&
 		   type <= OBS_HEVC_NAL_RASL_R) {
-		if (priority < OBS_NAL_PRIORITY_HIGH)
-			priority = OBS_NAL_PRIORITY_HIGH;
+		const int temporal_id = (nal_start[1] & 0x7) - 1;
+		const int slice_priority = temporal_id > 0
+						   ? OBS_NAL_PRIORITY_LOW
+						   : OBS_NAL_PRIORITY_HIGH;
+		if (priority < slice_priority)
+			priority = slice_priority;
 	}
 
 	return priority;
 }
 
-static void serialize_hevc_data(struct serializer *s, const uint8_t *data,
-				size_t size, bool *is_keyframe, int *priority)
+static void serialize_hevc_data(struct serializer *s,
+				const struct encoder_packet *src,
+				bool *is_keyframe, int *priority)
 {
-	const uint8_t *const end = data + size;
+	const struct obs_nal_index *index = &src->nal_index;
+
+	if (obs_nal_index_valid(index, src->size)) {
+		for (size_t i = 0; i < index->num; i++) {
+			const uint8_t *const nal_start =
+				src->data + index->units[i].offset;
+			const size_t nal_size = index->units[i].size;
+
+			*priority = compute_hevc_keyframe_priority(
+				nal_start, is_keyframe, *priority);
+
+			s_wb32(s, (uint32_t)nal_size);
+			s_write(s, nal_start, nal_size);
+		}
+		return;
+	}
+
+	const uint8_t *const data = src->data;
+	const uint8_t *const end = data + src->size;
 	const uint8_t *nal_start = obs_nal_find_startcode(data, end);
 	while (true) {
 		while (nal_start < end && !*(nal_start++))
@@ -104,17 +129,30 @@ void obs_parse_hevc_packet(struct encoder_packet *hevc_packet,
 	*hevc_packet = *src;
 
 	serialize(&s, &ref, sizeof(ref));
-	serialize_hevc_data(&s, src->data, src->size, &hevc_packet->keyframe,
+	serialize_hevc_data(&s, src, &hevc_packet->keyframe,
 			    &hevc_packet->priority);
 
 	hevc_packet->data = output.bytes.array + sizeof(ref);
 	hevc_packet->size = output.bytes.num - sizeof(ref);
 	hevc_packet->drop_priority = hevc_packet->priority;
+	obs_nal_index_clear(&hevc_packet->nal_index);
 }
 
 int obs_parse_hevc_packet_priority(const struct encoder_packet *packet)
 {
+	const struct obs_nal_index *index = &packet->nal_index;
 	int priority = packet->priority;
+	bool unused;
+
+	if (obs_nal_index_valid(index, packet->size)) {
+		for (size_t i = 0; i < index->num; i++) {
+			const uint8_t *const nal_start =
+				packet->data + index->units[i].offset;
+			priority = compute_hevc_keyframe_priority(
+				nal_start, &unused, priority);
+		}
+		return priority;
+	}
 
 	const uint8_t *const data = packet->data;
 	const uint8_t *const end = data + packet->size;
@@ -126,7 +164,6 @@ int obs_parse_hevc_packet_priority(const struct encoder_packet *packet)
 		if (nal_start == end)
 			break;
 
-		bool unused;
 		priority = compute_hevc_keyframe_priority(nal_start, &unused,
 							  priority);
 
@@ -142,7 +142,9 @@ void obs_hotkey_pair_set_descriptions(obs_hotkey_pair_id id, const char *desc0,
 static void hotkey_signal(const char *signal, obs_hotkey_t *hotkey)
 {
 	calldata_t data;
-	calldata_init(&data);
+	uint8_t stack[128];
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "key", hotkey);
 
 	signal_handler_signal(obs->hotkeys.signals, signal, &data);
@@ -1062,10 +1064,29 @@ static inline bool modifiers_match(obs_hotkey_binding_t *binding,
 		return modifiers == modifiers_;
 }
 
+enum key_state {
+	KEY_STATE_UNKNOWN,
+	KEY_STATE_RELEASED,
+	KEY_STATE_PRESSED,
+};
+
+/* many bindings share the same keys, and asking the platform can be costly
+ * (a server round trip on X11), so each key is only queried once per pass
+ * over the bindings.  the cache is reset by query_hotkeys. */
 static inline bool is_pressed(obs_key_t key)
 {
-	return obs_hotkeys_platform_is_pressed(obs->hotkeys.platform_context,
-					       key);
+	if ((size_t)key >= OBS_KEY_LAST_VALUE)
+		return obs_hotkeys_platform_is_pressed(
+			obs->hotkeys.platform_context, key);
+
+	uint8_t *state = &obs->hotkeys.key_state[key];
+	if (*state == KEY_STATE_UNKNOWN)
+		*state = obs_hotkeys_platform_is_pressed(
+				 obs->hotkeys.platform_context, key)
+				 ? KEY_STATE_PRESSED
+				 : KEY_STATE_RELEASED;
+
+	return *state == KEY_STATE_PRESSED;
 }
 
 static inline void press_released_binding(obs_hotkey_binding_t *binding)
@@ -1219,6 +1240,10 @@ static inline bool query_hotkey(void *data, size_t idx,
 static inline void query_hotkeys()
 {
 	uint32_t modifiers = 0;
+
+	memset(obs->hotkeys.key_state, KEY_STATE_UNKNOWN,
+	       sizeof(obs->hotkeys.key_state));
+
 	if (is_pressed(OBS_KEY_SHIFT))
 		modifiers |= INTERACT_SHIFT_KEY;
 	if (is_pressed(OBS_KEY_CONTROL))
@@ -1236,20 +1261,43 @@ static inline void query_hotkeys()
 	enum_bindings(query_hotkey, &param);
 }
 
+void obs_hotkeys_platform_key_event(void)
+{
+	if (obs && obs->hotkeys.wake_event)
+		os_event_signal(obs->hotkeys.wake_event);
+}
+
 #define NBSP "\xC2\xA0"
 
+#define HOTKEY_POLL_MS 25
+/* with key events the bindings are still polled now and then, in case an
+ * event got lost, e.g. while another application held a grab */
+#define HOTKEY_EVENT_POLL_MS 500
+
 void *obs_hotkey_thread(void *arg)
 {
 	UNUSED_PARAMETER(arg);
 
 	os_set_thread_name("libobs: hotkey thread");
 
-	const char *hotkey_thread_name =
-		profile_store_name(obs_get_profiler_name_store(),
-				   "obs_hotkey_thread(%g" NBSP "ms)", 25.);
-	profile_register_root(hotkey_thread_name, (uint64_t)25000000);
+	unsigned long interval = obs->hotkeys.platform_events
+					 ? HOTKEY_EVENT_POLL_MS
+					 : HOTKEY_POLL_MS;
+
+	const char *hotkey_thread_name = profile_store_name(
+		obs_get_profiler_name_store(),
+		"obs_hotkey_thread(%g" NBSP "ms)", (double)interval);
+	profile_register_root(hotkey_thread_name,
+			      (uint64_t)interval * 1000000);
+
+	blog(LOG_DEBUG, "hotkey thread: %s",
+	     obs->hotkeys.platform_events ? "using key events" : "polling");
+
+	for (;;) {
+		os_event_timedwait(obs->hotkeys.wake_event, interval);
+		if (os_event_try(obs->hotkeys.stop_event) != EAGAIN)
+			break;
 
-	while (os_event_timedwait(obs->hotkeys.stop_event, 25) == ETIMEDOUT) {
 		if (!lock())
 			continue;
 
@@ -24,6 +24,7 @@
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
+#include "util/metrics.h"
 #include "util/task.h"
 #include "util/uthash.h"
 #include "callback/signal.h"
@@ -34,6 +35,7 @@
 
 #include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
+#include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
 
 #include "obs.h"
@@ -47,7 +49,11 @@
 #define HASH_ADD_UUID(head, uuid_field, add) \
 	HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
-#define NUM_TEXTURES 2
+/* maximum raw readback depth, see obs_set_video_readback_depth */
+#define NUM_TEXTURES 8
+#define DEFAULT_READBACK_DEPTH 2
+/* see obs_set_video_conversion_idle_time */
+#define DEFAULT_CONVERSION_IDLE_MS 10000
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
@@ -187,6 +193,10 @@ void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys);
 bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context,
 				     obs_key_t key);
 
+/* called by platforms that set platform_events, from any thread, whenever a
+ * key or mouse button may have changed state */
+void obs_hotkeys_platform_key_event(void);
+
 const char *obs_get_hotkey_translation(obs_key_t key, const char *def);
 
 struct obs_context_data;
@@ -223,6 +233,9 @@ extern void obs_view_free(struct obs_view *view);
 struct obs_display {
 	bool update_color_space;
 	bool enabled;
+	bool visible;
+	uint32_t render_divisor;
+	uint32_t render_frame;
 	uint32_t cx, cy;
 	uint32_t next_cx, next_cy;
 	uint32_t background_color;
@@ -232,6 +245,16 @@ struct obs_display {
 	DARRAY(struct draw_callback) draw_callbacks;
 	bool use_clear_workaround;
 
+	/* async presentation: the graphics thread records into present_target
+	 * and the present thread puts it on the swap chain */
+	bool async_present;
+	bool present_thread_active;
+	volatile bool present_stop;
+	volatile bool present_pending;
+	gs_texrender_t *present_target;
+	os_event_t *present_event;
+	pthread_t present_thread;
+
 	struct obs_display *next;
 	struct obs_display **prev_next;
 };
@@ -276,6 +299,18 @@ struct obs_core_video_mix {
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	enum gs_color_space render_space;
+
+	/* copy surfaces, conversion and output textures only exist while the
+	 * mix is (or recently was) raw or GPU encode active */
+	bool conversion_allocated;
+	bool conversion_failed;
+	uint64_t conversion_idle_since;
+	volatile int64_t vram_usage;
+
+	/* see obs_reset_video_output_size, protected by mixes_mutex */
+	bool output_size_pending;
+	uint32_t pending_output_width;
+	uint32_t pending_output_height;
 	bool texture_rendered;
 	bool textures_copied[NUM_TEXTURES];
 	bool texture_converted;
@@ -285,12 +320,21 @@ struct obs_core_video_mix {
 	struct deque vframe_info_buffer_gpu;
 	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
 	int cur_texture;
+
+	/* staged frames waiting to be downloaded, oldest first */
+	int readback_depth;
+	int readback_queue[NUM_TEXTURES];
+	int readback_head;
+	int readback_count;
+	uint64_t readback_frame;
+	uint64_t readback_staged[NUM_TEXTURES];
+	volatile long readback_latency;
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
 	bool gpu_was_active;
 	bool raw_was_active;
 	bool was_active;
-	pthread_mutex_t gpu_encoder_mutex;
+	os_mutex_t gpu_encoder_mutex;
 	struct deque gpu_encoder_queue;
 	struct deque gpu_encoder_avail_queue;
 	DARRAY(obs_encoder_t *) gpu_encoders;
@@ -306,6 +350,9 @@ struct obs_core_video_mix {
 	bool gpu_conversion;
 	const char *conversion_techs[NUM_CHANNELS];
 	bool conversion_needed;
+	/* all planes rendered to and staged from convert_textures[0] */
+	bool conversion_packed;
+	float conversion_height;
 	float conversion_width_i;
 	float conversion_height_i;
 
@@ -313,11 +360,76 @@ struct obs_core_video_mix {
 
 	bool encoder_only_mix;
 	long encoder_refs;
+
+	/* parallel output of downloaded frames (see obs_set_parallel_mix_output) */
+	os_task_queue_t *output_task_queue;
+	struct video_data output_data;
+	int output_count;
+	bool output_ready;
+
+	/* frame clock, mixes with a frame rate other than the main one keep
+	 * their own deadlines (see video_sleep) */
+	uint64_t frame_interval_ns;
+	uint64_t next_frame_time;
+	uint64_t frame_time;
+	bool frame_pending;
+	bool frame_due;
 };
 
 extern struct obs_core_video_mix *
 obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
+extern bool obs_video_mix_init_conversion(struct obs_core_video_mix *video);
+extern void obs_video_mix_free_conversion(struct obs_core_video_mix *video);
+extern bool obs_video_mix_set_output_size(struct obs_core_video_mix *video,
+					  uint32_t width, uint32_t height);
+
+/* GPU render time measurement (see obs_set_gpu_source_timing) */
+#define NUM_GPU_TIMING_FRAMES 4
+
+struct obs_gpu_timer_record {
+	obs_weak_source_t *source;
+	size_t parent;
+	uint64_t time_ns;
+};
+
+struct obs_gpu_timing_frame {
+	gs_timer_range_t *range;
+	DARRAY(gs_timer_t *) timers;
+	DARRAY(struct obs_gpu_timer_record) records;
+	uint64_t frame;
+	bool pending;
+};
+
+struct obs_gpu_timing {
+	volatile bool enabled;
+	bool active;
+	uint64_t frame;
+	size_t cur;
+	size_t cur_record;
+	struct obs_gpu_timing_frame frames[NUM_GPU_TIMING_FRAMES];
+};
+
+extern void obs_gpu_timing_begin_frame(void);
+extern void obs_gpu_timing_end_frame(void);
+extern size_t obs_gpu_timing_begin_source(obs_source_t *source);
+extern void obs_gpu_timing_end_source(size_t record);
+extern void obs_gpu_timing_free(void);
+
+struct obs_tonemap_lut_entry {
+	enum obs_tonemap_lut type;
+	float input_nits;
+	float output_nits;
+	uint64_t last_used;
+	gs_texture_t *texture;
+};
+
+extern void obs_tonemap_luts_free(void);
+
+#define MAX_UPLOAD_WORKERS 4
+
+struct async_frame_upload;
+struct async_upload_chunk;
 
 struct obs_core_video {
 	graphics_t *graphics;
@@ -335,6 +447,9 @@ struct obs_core_video {
 	gs_samplerstate_t *point_sampler;
 
 	uint64_t video_time;
+	uint64_t main_frame_time;
+	uint64_t next_main_frame_time;
+	bool main_frame_due;
 	uint64_t video_frame_interval_ns;
 	uint64_t video_half_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
@@ -344,6 +459,10 @@ struct obs_core_video {
 	uint32_t lagged_frames;
 	bool thread_initialized;
 
+	metric_t *render_time_metric;
+	metric_t *frames_metric;
+	metric_t *lagged_frames_metric;
+
 	gs_texture_t *transparent_texture;
 
 	gs_effect_t *deinterlace_discard_effect;
@@ -367,17 +486,50 @@ struct obs_core_video {
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
 	struct obs_core_video_mix *main_mix;
+
+	volatile bool parallel_mix_output;
+	uint32_t readback_depth;
+	uint32_t conversion_idle_ms;
+
+	struct obs_gpu_timing gpu_timing;
+
+	DARRAY(struct obs_tonemap_lut_entry) tonemap_luts;
+	uint64_t tonemap_lut_clock;
+
+	os_task_queue_t *upload_workers[MAX_UPLOAD_WORKERS];
+	size_t num_upload_workers;
+	DARRAY(struct async_frame_upload) async_uploads;
+	DARRAY(struct async_upload_chunk) async_upload_chunks;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
 
 struct audio_monitor;
 
+#define MONITORING_BUFFER_MS_MIN 10
+#define MONITORING_BUFFER_MS_MAX 1000
+#define MONITORING_BUFFER_MS_DEFAULT 30
+
+#define MAX_AUDIO_RENDER_WORKERS 4
+#define MAX_AUDIO_ENCODE_WORKERS 4
+
 struct obs_core_audio {
 	audio_t *audio;
 
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
+	/* incremented each time the render order is built */
+	uint64_t render_tick;
+
+	volatile bool parallel_render;
+	os_task_queue_t *render_workers[MAX_AUDIO_RENDER_WORKERS];
+	size_t num_render_workers;
+	DARRAY(struct obs_source *) render_batch;
+
+	volatile bool parallel_encode;
+	os_task_queue_t *encode_workers[MAX_AUDIO_ENCODE_WORKERS];
+	size_t num_encode_workers;
+	size_t next_encode_worker;
 
 	uint64_t buffered_ts;
 	struct deque buffered_timestamps;
@@ -385,16 +537,31 @@ struct obs_core_audio {
 	int total_buffering_ticks;
 	int max_buffering_ticks;
 	bool fixed_buffer;
+	metric_t *buffering_metric;
+
+	/* audio buffering is reduced after every source was stable for this
+	 * long, 0 when it's never reduced */
+	uint64_t buffering_reduce_ns;
+	uint64_t stable_ts;
 
 	pthread_mutex_t monitoring_mutex;
 	DARRAY(struct audio_monitor *) monitors;
 	char *monitoring_device_name;
 	char *monitoring_device_id;
+	uint32_t monitoring_buffer_ms;
 
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
 };
 
+struct obs_source_preload {
+	obs_source_t *source;
+	gs_texrender_t *texrender;
+	uint64_t deadline;
+	bool ready;
+	bool timed_out;
+};
+
 /* user sources, output channels, and displays */
 struct obs_core_data {
 	/* Hash tables (uthash) */
@@ -408,12 +575,13 @@ struct obs_core_data {
 	struct obs_encoder *first_encoder;
 	struct obs_service *first_service;
 
-	pthread_mutex_t sources_mutex;
+	os_mutex_t sources_mutex;
 	pthread_mutex_t displays_mutex;
-	pthread_mutex_t outputs_mutex;
-	pthread_mutex_t encoders_mutex;
-	pthread_mutex_t services_mutex;
-	pthread_mutex_t audio_sources_mutex;
+	os_mutex_t outputs_mutex;
+	os_mutex_t encoders_mutex;
+	os_mutex_t services_mutex;
+	volatile long scene_roi_encoders;
+	os_mutex_t audio_sources_mutex;
 	pthread_mutex_t draw_callbacks_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
 	DARRAY(struct rendered_callback) rendered_callbacks;
@@ -429,6 +597,29 @@ struct obs_core_data {
 
 	DARRAY(char *) protocols;
 	DARRAY(obs_source_t *) sources_to_tick;
+
+	/* sources that currently need to be ticked.  the list is only touched
+	 * by the graphics thread, other threads add sources to tick_pending
+	 * with obs_source_request_tick, and the graphics thread drops
+	 * sources once they are neither showing nor active */
+	DARRAY(obs_weak_source_t *) tick_list;
+	pthread_mutex_t tick_mutex;
+	DARRAY(obs_weak_source_t *) tick_pending;
+
+	volatile bool parallel_tick;
+	DARRAY(obs_source_t *) parallel_ticks;
+
+	/* sources being warmed up with obs_source_preload, primed by the
+	 * graphics thread until they are ready or their deadline passes */
+	pthread_mutex_t preloads_mutex;
+	DARRAY(struct obs_source_preload) preloads;
+
+	/* inputs loaded by obs_load_sources_deferred that have not been
+	 * created yet */
+	pthread_mutex_t deferred_sources_mutex;
+	DARRAY(obs_weak_source_t *) deferred_sources;
+	long deferred_sources_loaded;
+	long deferred_sources_total;
 };
 
 /* user hotkeys */
@@ -442,6 +633,9 @@ struct obs_core_hotkeys {
 	pthread_t hotkey_thread;
 	bool hotkey_thread_initialized;
 	os_event_t *stop_event;
+	os_event_t *wake_event;
+	bool platform_events;
+	uint8_t key_state[OBS_KEY_LAST_VALUE];
 	bool thread_disable_press;
 	bool strict_modifiers;
 	bool reroute_hotkeys;
@@ -466,13 +660,108 @@ struct obs_core_hotkeys {
 	char *sceneitem_hide;
 };
 
+/* offline rendering clock */
+struct obs_clock_hold {
+	/* everything before this has been output, 0 when not holding */
+	volatile int64_t ts;
+	os_event_t *event;
+};
+
+struct obs_core_clock {
+	bool offline;
+
+	/* tick the graphics thread is collecting frames for */
+	volatile int64_t time;
+	/* every clock hold got past this, the audio thread follows it */
+	volatile int64_t committed;
+	os_event_t *committed_event;
+
+	/* graphics thread only, paces the clock while nothing is output */
+	uint64_t idle_time;
+
+	pthread_mutex_t holds_mutex;
+	DARRAY(obs_clock_hold_t *) holds;
+	os_event_t *holds_event;
+};
+
+extern bool obs_clock_init(void);
+extern void obs_clock_free(void);
+extern void obs_clock_advance(uint64_t ts);
+extern void obs_clock_wait_holds(uint64_t ts);
+extern void obs_clock_commit(uint64_t ts);
+extern uint64_t obs_clock_audio_now(void *param);
+extern bool obs_clock_audio_sleepto(void *param, uint64_t ts);
+
+/* ------------------------------------------------------------------------- */
+/* latency tracing */
+
+#define NUM_LATENCY_FRAMES 256
+
+struct obs_latency_frame {
+	uint64_t video_ts;
+	/* 0 when the frame carries no probe frame */
+	uint64_t capture_ns;
+	uint64_t render_ns;
+	uint64_t output_ns;
+};
+
+struct obs_core_latency {
+	/* number of latency probe sources, tracing is off while 0 */
+	volatile long probes;
+
+	pthread_mutex_t mutex;
+	uint64_t pending_capture_ns;
+	struct obs_latency_frame frames[NUM_LATENCY_FRAMES];
+
+	metric_t *capture_to_render;
+	metric_t *render_to_output;
+};
+
+struct obs_encoder;
+struct obs_output;
+
+extern bool obs_latency_init(void);
+extern void obs_latency_free(void);
+extern void obs_latency_capture(uint64_t capture_ns);
+extern void obs_latency_render(uint64_t video_ts);
+extern void obs_latency_output(uint64_t video_ts);
+extern void obs_latency_encoder_receive(struct obs_encoder *encoder,
+					uint64_t video_ts);
+extern void obs_latency_encoder_packet(struct obs_encoder *encoder,
+				       const struct encoder_packet *pkt,
+				       uint64_t submit_ns);
+extern void obs_latency_output_send(struct obs_output *output,
+				    const struct encoder_packet *pkt,
+				    int64_t pts_offset);
+
 typedef DARRAY(struct obs_source_info) obs_source_info_array_t;
 
+/* maps the id of a registered type to its index in the type array, the id
+ * string is owned by the registered info */
+struct obs_type_index {
+	const char *id;
+	size_t idx;
+	UT_hash_handle hh;
+};
+
+extern void obs_type_index_add(struct obs_type_index **index, const char *id,
+			       size_t idx);
+extern bool obs_type_index_find(struct obs_type_index *index, const char *id,
+				size_t *idx);
+extern void obs_type_index_free(struct obs_type_index **index);
+
+#define OBS_THREAD_ROLE_COUNT (OBS_THREAD_ROLE_ENCODER + 1)
+
 struct obs_core {
 	struct obs_module *first_module;
 	DARRAY(struct obs_module_path) module_paths;
 	DARRAY(char *) safe_modules;
 
+	/* module whose load function is running, and the module of each
+	 * entry of source_types */
+	struct obs_module *loading_module;
+	DARRAY(struct obs_module *) source_type_modules;
+
 	obs_source_info_array_t source_types;
 	obs_source_info_array_t input_types;
 	obs_source_info_array_t filter_types;
@@ -481,6 +770,12 @@ struct obs_core {
 	DARRAY(struct obs_encoder_info) encoder_types;
 	DARRAY(struct obs_service_info) service_types;
 
+	/* Hash tables (uthash) */
+	struct obs_type_index *source_type_index;
+	struct obs_type_index *output_type_index;
+	struct obs_type_index *encoder_type_index;
+	struct obs_type_index *service_type_index;
+
 	signal_handler_t *signals;
 	proc_handler_t *procs;
 
@@ -495,14 +790,30 @@ struct obs_core {
 	struct obs_core_audio audio;
 	struct obs_core_data data;
 	struct obs_core_hotkeys hotkeys;
+	struct obs_core_clock clock;
+	struct obs_core_latency latency;
 
 	os_task_queue_t *destruction_task_thread;
+	os_task_queue_t *source_load_thread;
+	os_task_pool_t *task_pool;
+
+	struct os_thread_scheduling thread_scheduling[OBS_THREAD_ROLE_COUNT];
 
 	obs_task_handler_t ui_task_handler;
 };
 
 extern struct obs_core *obs;
 
+static inline void obs_update_thread_scheduling(enum obs_thread_role role,
+						long *applied)
+{
+	if (!os_thread_scheduling_update(&obs->thread_scheduling[role],
+					 applied))
+		blog(LOG_WARNING, "Could not apply thread scheduling for "
+				  "thread role %d",
+		     (int)role);
+}
+
 struct obs_graphics_context {
 	uint64_t last_time;
 	uint64_t interval;
@@ -510,6 +821,10 @@ struct obs_graphics_context {
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
 	const char *video_thread_name;
+	long sched_serial;
+	uint64_t sched_late_total_ns;
+	uint64_t sched_late_max_ns;
+	uint64_t sched_late_count;
 };
 
 extern void *obs_graphics_thread(void *param);
@@ -572,7 +887,7 @@ struct obs_context_data {
 	DARRAY(char *) rename_cache;
 	pthread_mutex_t rename_cache_mutex;
 
-	pthread_mutex_t *mutex;
+	os_mutex_t *mutex;
 	struct obs_context_data *next;
 	struct obs_context_data **prev_next;
 
@@ -591,12 +906,11 @@ extern void obs_context_init_control(struct obs_context_data *context,
 extern void obs_context_data_free(struct obs_context_data *context);
 
 extern void obs_context_data_insert(struct obs_context_data *context,
-				    pthread_mutex_t *mutex, void *first);
+				    os_mutex_t *mutex, void *first);
 extern void obs_context_data_insert_name(struct obs_context_data *context,
-					 pthread_mutex_t *mutex, void *first);
+					 os_mutex_t *mutex, void *first);
 extern void obs_context_data_insert_uuid(struct obs_context_data *context,
-					 pthread_mutex_t *mutex,
-					 void *first_uuid);
+					 os_mutex_t *mutex, void *first_uuid);
 
 extern void obs_context_data_remove(struct obs_context_data *context);
 extern void obs_context_data_remove_name(struct obs_context_data *context,
@@ -660,6 +974,18 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+
+	/* frame data owned by the source (see obs_source_output_video2_nocopy),
+	 * dropped from the cache as soon as it is no longer used */
+	bool external;
+};
+
+struct async_external_frame {
+	struct obs_source_frame *frame;
+	obs_source_frame_release_t release;
+	/* GPU frames only (see obs_source_output_video_gpu) */
+	obs_source_frame_import_t import;
+	void *param;
 };
 
 enum audio_action_type {
@@ -711,6 +1037,18 @@ struct media_action {
 	};
 };
 
+/* state a transition child was last rendered with, the child's texture is
+ * reused as long as it matches */
+struct transition_snapshot {
+	obs_source_t *source;
+	long generation;
+	uint64_t start_time;
+	struct matrix4 matrix;
+	uint32_t cx;
+	uint32_t cy;
+	enum gs_color_space space;
+};
+
 struct obs_source {
 	struct obs_context_data context;
 	struct obs_source_info info;
@@ -723,15 +1061,29 @@ struct obs_source {
 	/* indicates ownership of the info.id buffer */
 	bool owns_info_id;
 
+	/* creation is deferred to the source load thread, see
+	 * obs_load_sources_deferred */
+	volatile long create_state;
+
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* whether the source is in the tick list or waiting to be added */
+	volatile bool tick_registered;
+
+	/* incremented whenever the video of a static source changes */
+	volatile long video_generation;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
 	/* ensures activate/deactivate are only called once */
 	volatile long activate_refs;
 
+	/* references from obs_source_preload, which call activate/deactivate
+	 * without the source being considered active */
+	volatile long preload_refs;
+
 	/* source is in the process of being destroyed */
 	volatile long destroying;
 
@@ -746,12 +1098,28 @@ struct obs_source {
 	bool active;
 	bool showing;
 
+	/* activate has been called, the source is either active or preloaded */
+	bool primed;
+
 	/* used to temporarily disable sources if needed */
 	bool enabled;
 
 	/* hint to allow sources to render more quickly */
 	bool texcoords_centered;
 
+	/* GPU render time of the last measured frame, excluding the nested
+	 * sources and filters that were measured separately */
+	uint64_t gpu_time_frame;
+	uint64_t gpu_time_accum;
+	volatile uint64_t gpu_time_ns;
+
+	/* GPU memory created while creating, updating, ticking or rendering
+	 * the source, and the module that registered its type */
+	gs_memory_owner_t *gpu_memory;
+	volatile int64_t gpu_memory_budget;
+	bool gpu_memory_exceeded;
+	obs_module_t *module;
+
 	/* timing (if video is present, is based upon video) */
 	volatile bool timing_set;
 	volatile uint64_t timing_adjust;
@@ -766,6 +1134,7 @@ struct obs_source {
 	bool audio_failed;
 	bool audio_pending;
 	bool pending_stop;
+	size_t audio_render_level;
 	bool audio_active;
 	bool user_muted;
 	bool muted;
@@ -775,7 +1144,23 @@ struct obs_source {
 	struct deque audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t last_audio_input_buf_size;
 	DARRAY(struct audio_action) audio_actions;
+
+	/* audio thread only, render_tick of the last time this source was
+	 * added to the audio render order */
+	uint64_t audio_render_tick;
+
+	/* audio thread only, headroom range over the current jitter window */
+	uint64_t audio_jitter_ts;
+	int64_t audio_headroom_min;
+	int64_t audio_headroom_max;
+	volatile int64_t audio_jitter;
+	/* audio buffering that was added to wait for this source */
+	volatile long audio_buffering_ms;
+
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
+	/* mixes with identical output share one buffer, this is the mix
+	 * whose audio_output_buf holds the output of each mix */
+	size_t audio_output_mix[MAX_AUDIO_MIXES];
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
@@ -811,12 +1196,28 @@ struct obs_source {
 	bool async_linear_alpha;
 	bool async_active;
 	bool async_update_texture;
-	bool async_unbuffered;
+	enum obs_async_timing async_timing;
+	uint64_t async_latency_target;
+	size_t async_max_frames;
 	bool async_decoupled;
+	bool latency_probe;
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
+	DARRAY(struct async_external_frame) async_external;
 	DARRAY(struct obs_source_frame *) async_frames;
-	pthread_mutex_t async_mutex;
+
+	/* lowest difference of the system time to the frame timestamps as
+	 * frames arrive, the fixed latency timing shows frames relative to
+	 * it.  the lowest of each window replaces it */
+	bool async_ts_offset_set;
+	int64_t async_ts_offset;
+	int64_t async_ts_offset_min;
+	uint64_t async_ts_offset_window;
+
+	metric_t *async_depth_metric;
+	metric_t *async_late_metric;
+	metric_t *async_dropped_metric;
+	os_mutex_t async_mutex;
 	uint32_t async_width;
 	uint32_t async_height;
 	uint32_t async_cache_width;
@@ -839,6 +1240,12 @@ struct obs_source {
 	bool deinterlace_top_first;
 	bool deinterlace_rendered;
 
+	/* deinterlaced output of the current textures, so that a source
+	 * drawn more than once per frame only deinterlaces each field once */
+	gs_texrender_t *deinterlace_texrender;
+	bool deinterlace_cached_frame2;
+	bool deinterlace_cache_valid;
+
 	/* filters */
 	struct obs_source *filter_parent;
 	struct obs_source *filter_target;
@@ -848,6 +1255,13 @@ struct obs_source {
 	enum obs_allow_direct_render allow_direct;
 	bool rendering_filter;
 	bool filter_bypass_active;
+	bool filter_fused_active;
+	struct matrix4 filter_fused_matrix;
+
+	/* audio delay added by this filter, and by all enabled filters of this
+	 * source as of the last filtered audio packet (nanoseconds) */
+	uint64_t filter_latency;
+	uint64_t audio_filter_latency;
 
 	/* sources specific hotkeys */
 	obs_hotkey_pair_id mute_unmute_key;
@@ -888,10 +1302,21 @@ struct obs_source {
 	enum obs_transition_mode transition_mode;
 	enum obs_transition_scale_type transition_scale_type;
 	struct matrix4 transition_matrices[2];
+	struct transition_snapshot transition_snapshots[2];
+	uint64_t transition_freeze_duration;
+	bool transition_freeze_outgoing;
 
 	/* color space */
 	gs_texrender_t *color_space_texrender;
 
+	/* render divisor (see obs_source_set_render_divisor) */
+	uint32_t render_divisor;
+	gs_texrender_t *divisor_texrender;
+	enum gs_color_space divisor_space;
+	uint32_t divisor_frame;
+	long divisor_generation;
+	bool divisor_valid;
+
 	/* audio monitoring */
 	struct audio_monitor *monitor;
 	enum obs_monitoring_type monitoring_type;
@@ -932,6 +1357,15 @@ obs_source_create_set_last_ver(const char *id, const char *name,
 			       bool is_private);
 extern void obs_source_destroy(struct obs_source *source);
 
+enum deferred_create_state {
+	DEFERRED_CREATE_NONE,
+	DEFERRED_CREATE_PENDING,
+	DEFERRED_CREATE_RUNNING,
+};
+
+extern THREAD_LOCAL bool defer_source_create;
+extern bool obs_source_create_deferred(obs_source_t *source);
+
 enum view_type {
 	MAIN_VIEW,
 	AUX_VIEW,
@@ -1018,9 +1452,24 @@ static inline enum gs_color_space convert_video_space(enum video_format format,
 
 extern void obs_source_set_texcoords_centered(obs_source_t *source,
 					      bool centered);
+/* plain sources can be drawn one after another inside a single pass of the
+ * default effect's Draw technique, see obs_source_batch_render */
+extern bool obs_source_can_batch_render(obs_source_t *source);
+extern void obs_source_batch_render(obs_source_t *source,
+				    gs_effect_t *effect);
+/* whether a scene's output only changes along with its video generation */
+extern bool obs_scene_video_static(obs_source_t *source);
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+/* runs the libobs side of a tick and returns true if the video_tick callback
+ * was left for the caller to run on a worker thread */
+extern bool obs_source_video_tick_parallel(obs_source_t *source,
+					   float seconds);
+/* adds the source to the tick list if it isn't in it already, must be called
+ * whenever something changes that the next tick has to act on */
+extern void obs_source_request_tick(obs_source_t *source);
+extern bool obs_source_needs_tick(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
@@ -1028,6 +1477,12 @@ extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 				    size_t channels, size_t sample_rate,
 				    size_t size);
 
+static inline float *const *get_audio_output_mix(const obs_source_t *source,
+						 size_t mix)
+{
+	return source->audio_output_buf[source->audio_output_mix[mix]];
+}
+
 extern void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy);
 
 extern struct obs_source_frame *filter_async_video(obs_source_t *source,
@@ -1041,9 +1496,18 @@ extern bool update_async_textures(struct obs_source *source,
 				  gs_texrender_t *texrender);
 extern bool set_async_texture_size(struct obs_source *source,
 				   const struct obs_source_frame *frame);
+extern void upload_async_frames(obs_source_t *const *sources, size_t num);
+/* the worker queues are shared by async uploads and parallel source ticks,
+ * both of which only run on the graphics thread */
+extern size_t create_upload_workers(struct obs_core_video *video);
 extern void remove_async_frame(obs_source_t *source,
 			       struct obs_source_frame *frame);
 
+static inline bool async_unbuffered(const struct obs_source *source)
+{
+	return source->async_timing == OBS_ASYNC_TIMING_LATEST;
+}
+
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source,
 					   uint64_t sys_time);
@@ -1063,8 +1527,14 @@ struct delay_data {
 	enum delay_msg msg;
 	uint64_t ts;
 	struct encoder_packet packet;
+
+	/* packet data is in the disk store until it's read ahead */
+	bool on_disk;
+	uint64_t disk_pos;
 };
 
+struct delay_store;
+
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet);
 
 struct obs_weak_output {
@@ -1074,9 +1544,29 @@ struct obs_weak_output {
 
 #define CAPTION_LINE_CHARS (32)
 #define CAPTION_LINE_BYTES (4 * CAPTION_LINE_CHARS)
+
+/* captions are rendered when they are queued so that the interleave path only
+ * has to splice the finished NAL/OBU into the packet */
+struct caption_payload {
+	/* AVC SEI NAL unit, without the start code */
+	uint8_t *sei;
+	size_t sei_size;
+	/* AV1 metadata OBU carrying the same ITU-T T.35 message */
+	uint8_t *obu;
+	size_t obu_size;
+};
+
+static inline void caption_payload_free(struct caption_payload *payload)
+{
+	bfree(payload->sei);
+	bfree(payload->obu);
+	memset(payload, 0, sizeof(*payload));
+}
+
 struct caption_text {
 	char text[CAPTION_LINE_BYTES + 1];
 	double display_duration;
+	struct caption_payload payload;
 	struct caption_text *next;
 };
 
@@ -1086,6 +1576,7 @@ struct caption_track_data {
 	pthread_mutex_t caption_mutex;
 	double caption_timestamp;
 	double last_caption_timestamp;
+	/* struct caption_payload */
 	struct deque caption_data;
 };
 
@@ -1116,6 +1607,16 @@ struct keyframe_group_data {
 		seen_on_track[MAX_OUTPUT_VIDEO_ENCODERS];
 };
 
+/* FIFO of one encoder track's packets waiting to be interleaved.  packets
+ * before head have already been sent and are compacted away lazily. */
+struct interleave_queue {
+	DARRAY(struct encoder_packet) packets;
+	size_t head;
+};
+
+#define MAX_INTERLEAVE_QUEUES \
+	(MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
 struct obs_output {
 	struct obs_context_data context;
 	struct obs_output_info info;
@@ -1134,8 +1635,13 @@ struct obs_output {
 	int64_t highest_video_ts[MAX_OUTPUT_VIDEO_ENCODERS];
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
-	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	os_mutex_t interleaved_mutex;
+	struct interleave_queue interleaved_video[MAX_OUTPUT_VIDEO_ENCODERS];
+	struct interleave_queue interleaved_audio[MAX_OUTPUT_AUDIO_ENCODERS];
+	/* min-heap of the non-empty queues, ordered by their first packet */
+	struct interleave_queue *interleave_heap[MAX_INTERLEAVE_QUEUES];
+	size_t interleave_heap_size;
+	size_t interleaved_count;
 	int stop_code;
 
 	int reconnect_retry_sec;
@@ -1153,6 +1659,11 @@ struct obs_output {
 
 	int total_frames;
 
+	metric_t *send_time_metric;
+	metric_t *interleave_depth_metric;
+	/* render_to_send, capture_to_send */
+	metric_t *latency_metrics[2];
+
 	volatile bool active;
 	volatile bool paused;
 	video_t *video;
@@ -1177,6 +1688,7 @@ struct obs_output {
 
 	bool video_conversion_set;
 	bool audio_conversion_set;
+	bool raw_video_disabled;
 	struct video_scale_info video_conversion;
 	struct audio_convert_info audio_conversion;
 
@@ -1188,6 +1700,8 @@ struct obs_output {
 	uint64_t active_delay_ns;
 	encoded_callback_t delay_callback;
 	struct deque delay_data; /* struct delay_data */
+	struct delay_store *delay_store;
+	size_t delay_loaded; /* entries at the front not on disk */
 	pthread_mutex_t delay_mutex;
 	uint32_t delay_sec;
 	uint32_t delay_flags;
@@ -1199,12 +1713,22 @@ struct obs_output {
 	char *last_error_message;
 
 	float audio_data[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
+
+	/* outputs following a leader receive its interleaved packets instead
+	 * of interleaving the encoder packets themselves */
+	obs_weak_output_t *interleave_leader;
+	struct obs_output *following;
+	DARRAY(struct obs_output *) followers; /* protected by interleaved_mutex */
+	bool shared_audio_started[MAX_OUTPUT_AUDIO_ENCODERS];
 };
 
 static inline void do_output_signal(struct obs_output *output,
 				    const char *signal)
 {
-	struct calldata params = {0};
+	struct calldata params;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
 	calldata_set_ptr(&params, "output", output);
 	signal_handler_signal(output->context.signals, signal, &params);
 	calldata_free(&params);
@@ -1226,6 +1750,8 @@ extern void obs_output_remove_encoder(struct obs_output *output,
 extern void
 obs_encoder_packet_create_instance(struct encoder_packet *dst,
 				   const struct encoder_packet *src);
+extern void obs_encoder_packet_pool_init(void);
+extern void obs_encoder_packet_pool_free(void);
 void obs_output_destroy(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -1242,6 +1768,24 @@ struct encoder_callback {
 	void *param;
 };
 
+/* number of raw frames an async encoder can fall behind by before the video
+ * output thread waits for it */
+#define ASYNC_ENCODE_DEPTH 3
+
+/* audio frames an encoder may have queued on its worker before the audio
+ * thread waits for it */
+#define AUDIO_ENCODE_QUEUE_DEPTH 8
+
+/* frames kept for obs_encoder_get_stats, and frames that can be in flight
+ * in an encoder for their submit times to be matched to packets */
+#define ENCODER_STATS_FRAMES 256
+#define ENCODER_STATS_SUBMITS 64
+
+struct encoder_stats_submit {
+	int64_t pts;
+	uint64_t ts;
+};
+
 struct encoder_group {
 	pthread_mutex_t mutex;
 	uint32_t encoders_added;
@@ -1257,6 +1801,10 @@ struct obs_encoder {
 	struct obs_encoder_info orig_info;
 
 	pthread_mutex_t init_mutex;
+	/* held around calls into the implementation from outside of the
+	 * encode thread, and while the fallback thread swaps info and
+	 * context.data */
+	pthread_mutex_t impl_mutex;
 
 	uint32_t samplerate;
 	size_t planes;
@@ -1271,6 +1819,10 @@ struct obs_encoder {
 
 	uint32_t scaled_width;
 	uint32_t scaled_height;
+	/* size of the raw frames received while connected, which stays the
+	 * same if the video output is resized (obs_reset_video_output_size) */
+	uint32_t connected_width;
+	uint32_t connected_height;
 	enum video_format preferred_format;
 
 	volatile bool active;
@@ -1294,11 +1846,71 @@ struct obs_encoder {
 	uint32_t frame_rate_divisor_counter; // only used for GPU encoders
 	video_t *fps_override;
 
+	/* Telemetry of the most recent video frames; submissions are only
+	 * touched by the encode thread and matched to packets by pts */
+	pthread_mutex_t stats_mutex;
+	struct obs_encoder_frame_stats stats[ENCODER_STATS_FRAMES];
+	size_t stats_pos;
+	size_t stats_num;
+	struct encoder_stats_submit stats_submits[ENCODER_STATS_SUBMITS];
+	size_t stats_submit_pos;
+	uint64_t stats_encode_start;
+
 	/* Regions of interest to prioritize during encoding */
 	pthread_mutex_t roi_mutex;
 	DARRAY(struct obs_encoder_roi) roi;
 	uint32_t roi_increment;
 
+	/* Regions generated from the items of the program scene, these are
+	 * enumerated before the ones above so that those take precedence */
+	volatile bool scene_roi;
+	DARRAY(struct obs_encoder_roi) scene_roi_list;
+
+	/* Raw frames queued for encoders with OBS_ENCODER_CAP_ASYNC_ENCODE,
+	 * written by the video output thread and encoded by async_thread */
+	pthread_t async_thread;
+	bool async_thread_active;
+	os_sem_t *async_queued;
+	os_sem_t *async_free;
+	struct video_frame async_frames[ASYNC_ENCODE_DEPTH];
+	size_t async_read;
+	size_t async_write;
+	volatile long async_count;
+	volatile bool async_failed;
+	enum video_format async_format;
+	uint32_t async_height;
+
+	/* Implementation that takes over if encoding fails while active, see
+	 * obs_encoder_set_fallback */
+	char *fallback_id;
+	obs_data_t *fallback_settings;
+	volatile bool fallback_pending;
+	bool fallback_active;
+	bool fallback_headers;
+	DARRAY(uint8_t) fallback_packet;
+
+	/* An identical active audio encoder this one receives its packets
+	 * from instead of encoding the same audio itself, and the encoders
+	 * receiving this one's packets.  The followers are guarded by
+	 * callbacks_mutex; while there are any, the encoder keeps running
+	 * headless after its own outputs have stopped. */
+	struct obs_encoder *audio_leader;
+	DARRAY(struct obs_encoder *) audio_followers;
+	bool audio_headless;
+
+	/* Worker encoding this audio encoder's frames instead of the audio
+	 * thread, see obs_set_parallel_audio_encode.  Each slot is a frame
+	 * that may be waiting for or being encoded. */
+	os_task_queue_t *audio_worker;
+	os_sem_t *audio_slots;
+	volatile bool audio_failed;
+	/* set when the frame being encoded released its slot early because
+	 * it failed, only used on the worker thread */
+	bool audio_slot_released;
+	/* incremented on every start, frames of older sessions that are
+	 * still queued are not encoded */
+	volatile long audio_session;
+
 	int64_t cur_pts;
 
 	struct deque audio_input_buffer[MAX_AV_PLANES];
@@ -1316,7 +1928,7 @@ struct obs_encoder {
 	/* track encoders that are part of a gop-aligned multi track group */
 	struct encoder_group *encoder_group;
 
-	pthread_mutex_t outputs_mutex;
+	os_mutex_t outputs_mutex;
 	DARRAY(obs_output_t *) outputs;
 
 	bool destroy_on_stop;
@@ -1330,6 +1942,9 @@ struct obs_encoder {
 	struct pause_data pause;
 
 	const char *profile_encoder_encode_name;
+	metric_t *encode_time_metric;
+	/* output_to_encode, encode */
+	metric_t *latency_metrics[2];
 	char *last_error_message;
 
 	/* reconfigure encoder at next possible opportunity */
@@ -1341,6 +1956,9 @@ extern struct obs_encoder_info *find_encoder(const char *id);
 extern bool obs_encoder_initialize(obs_encoder_t *encoder);
 extern void obs_encoder_shutdown(obs_encoder_t *encoder);
 
+/* records the submit time of a video frame for obs_encoder_get_stats */
+extern void encoder_stats_submit(struct obs_encoder *encoder, int64_t pts);
+
 extern void obs_encoder_start(obs_encoder_t *encoder,
 			      void (*new_packet)(void *param,
 						 struct encoder_packet *packet),
@@ -1364,6 +1982,8 @@ extern void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 
 void obs_encoder_destroy(obs_encoder_t *encoder);
 
+extern void update_scene_roi(void);
+
 /* ------------------------------------------------------------------------- */
 /* services */
 
@@ -0,0 +1,287 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+#include "util/util_uint64.h"
+
+/* Latency tracing.  When a frame of a latency probe source is shown for the
+ * first time, its capture time is attached to the video frame it is rendered
+ * in.  That frame is then followed by its timestamp: through the video
+ * output to each encoder, and as packets to each output.  Only frames that
+ * carry a probe frame are recorded, so that every stage histogram covers
+ * the same frames. */
+
+#define METRIC_NAME "obs_latency_seconds"
+#define METRIC_HELP "Time between the stages of the probe frames"
+
+static inline bool tracing(void)
+{
+	return os_atomic_load_long(&obs->latency.probes) > 0;
+}
+
+static metric_t *get_metric(const char *stage, const char *key,
+			    const char *name)
+{
+	struct dstr labels = {0};
+	metric_t *metric;
+
+	metric_label_cat(&labels, "stage", stage);
+	if (key)
+		metric_label_cat(&labels, key, name);
+	metric = metric_get(METRIC_HISTOGRAM, METRIC_NAME, labels.array,
+			    METRIC_HELP);
+	dstr_free(&labels);
+	return metric;
+}
+
+bool obs_latency_init(void)
+{
+	struct obs_core_latency *latency = &obs->latency;
+
+	if (pthread_mutex_init(&latency->mutex, NULL) != 0)
+		return false;
+
+	latency->capture_to_render = get_metric("capture_to_render", NULL,
+						NULL);
+	latency->render_to_output = get_metric("render_to_output", NULL, NULL);
+	return true;
+}
+
+void obs_latency_free(void)
+{
+	struct obs_core_latency *latency = &obs->latency;
+
+	metric_release(latency->capture_to_render);
+	metric_release(latency->render_to_output);
+	pthread_mutex_destroy(&latency->mutex);
+}
+
+/* frames are stored by their position on the frame grid, rounded so that
+ * timestamps computed back from packets still find their frame */
+static struct obs_latency_frame *find_frame(uint64_t video_ts)
+{
+	uint64_t interval = obs->video.video_frame_interval_ns;
+	struct obs_latency_frame *frame;
+	uint64_t idx;
+
+	if (!interval)
+		return NULL;
+
+	idx = (video_ts + interval / 2) / interval;
+	frame = &obs->latency.frames[idx % NUM_LATENCY_FRAMES];
+
+	if (!frame->capture_ns || frame->video_ts + interval / 2 < video_ts ||
+	    video_ts + interval / 2 < frame->video_ts)
+		return NULL;
+
+	return frame;
+}
+
+static inline uint64_t elapsed_since(uint64_t now, uint64_t ts)
+{
+	return now > ts ? now - ts : 0;
+}
+
+/* video timestamp of the frame a video packet was encoded from, pts is in
+ * the packet's timebase and counts the frames since the encoder started */
+static uint64_t encoder_video_ts(struct obs_encoder *encoder,
+				 const struct encoder_packet *pkt, int64_t pts)
+{
+	uint64_t offset;
+
+	if (pts < 0 || !pkt->timebase_den)
+		return 0;
+
+	pthread_mutex_lock(&encoder->pause.mutex);
+	offset = encoder->pause.ts_offset;
+	pthread_mutex_unlock(&encoder->pause.mutex);
+
+	return encoder->start_ts + offset +
+	       util_mul_div64((uint64_t)pts,
+			      1000000000ULL * (uint64_t)pkt->timebase_num,
+			      (uint64_t)pkt->timebase_den);
+}
+
+void obs_source_set_latency_probe(obs_source_t *source, bool probe)
+{
+	if (!obs_source_valid(source, "obs_source_set_latency_probe"))
+		return;
+	if (source->latency_probe == probe)
+		return;
+
+	source->latency_probe = probe;
+	if (probe)
+		os_atomic_inc_long(&obs->latency.probes);
+	else
+		os_atomic_dec_long(&obs->latency.probes);
+}
+
+/* ------------------------------------------------------------------------- */
+/* graphics thread side                                                      */
+
+void obs_latency_capture(uint64_t capture_ns)
+{
+	struct obs_core_latency *latency = &obs->latency;
+
+	pthread_mutex_lock(&latency->mutex);
+	latency->pending_capture_ns = capture_ns;
+	pthread_mutex_unlock(&latency->mutex);
+}
+
+void obs_latency_render(uint64_t video_ts)
+{
+	struct obs_core_latency *latency = &obs->latency;
+	uint64_t interval = obs->video.video_frame_interval_ns;
+	struct obs_latency_frame *frame;
+	uint64_t capture_ns;
+	uint64_t now;
+
+	if (!tracing() || !interval)
+		return;
+
+	pthread_mutex_lock(&latency->mutex);
+	capture_ns = latency->pending_capture_ns;
+	latency->pending_capture_ns = 0;
+
+	frame = &latency->frames[(video_ts + interval / 2) / interval %
+				 NUM_LATENCY_FRAMES];
+	memset(frame, 0, sizeof(*frame));
+
+	if (capture_ns) {
+		now = os_gettime_ns();
+		frame->video_ts = video_ts;
+		frame->capture_ns = capture_ns;
+		frame->render_ns = now;
+		metric_record(latency->capture_to_render,
+			      elapsed_since(now, capture_ns));
+	}
+	pthread_mutex_unlock(&latency->mutex);
+}
+
+void obs_latency_output(uint64_t video_ts)
+{
+	struct obs_core_latency *latency = &obs->latency;
+	struct obs_latency_frame *frame;
+
+	if (!tracing())
+		return;
+
+	pthread_mutex_lock(&latency->mutex);
+	frame = find_frame(video_ts);
+	if (frame && !frame->output_ns) {
+		frame->output_ns = os_gettime_ns();
+		metric_record(latency->render_to_output,
+			      elapsed_since(frame->output_ns,
+					    frame->render_ns));
+	}
+	pthread_mutex_unlock(&latency->mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* encoders and outputs                                                      */
+
+void obs_latency_encoder_receive(struct obs_encoder *encoder,
+				 uint64_t video_ts)
+{
+	struct obs_core_latency *latency = &obs->latency;
+	struct obs_latency_frame *frame;
+	uint64_t output_ns = 0;
+
+	if (!tracing())
+		return;
+
+	pthread_mutex_lock(&latency->mutex);
+	frame = find_frame(video_ts);
+	if (frame)
+		output_ns = frame->output_ns;
+	pthread_mutex_unlock(&latency->mutex);
+
+	if (!output_ns)
+		return;
+
+	if (!encoder->latency_metrics[0])
+		encoder->latency_metrics[0] = get_metric(
+			"output_to_encode", "encoder", encoder->context.name);
+	metric_record(encoder->latency_metrics[0],
+		      elapsed_since(os_gettime_ns(), output_ns));
+}
+
+void obs_latency_encoder_packet(struct obs_encoder *encoder,
+				const struct encoder_packet *pkt,
+				uint64_t submit_ns)
+{
+	struct obs_core_latency *latency = &obs->latency;
+	uint64_t video_ts;
+	bool probe;
+
+	if (!tracing() || !submit_ns)
+		return;
+
+	video_ts = encoder_video_ts(encoder, pkt, pkt->pts);
+
+	pthread_mutex_lock(&latency->mutex);
+	probe = find_frame(video_ts) != NULL;
+	pthread_mutex_unlock(&latency->mutex);
+
+	if (!probe)
+		return;
+
+	if (!encoder->latency_metrics[1])
+		encoder->latency_metrics[1] =
+			get_metric("encode", "encoder", encoder->context.name);
+	metric_record(encoder->latency_metrics[1],
+		      elapsed_since(os_gettime_ns(), submit_ns));
+}
+
+void obs_latency_output_send(struct obs_output *output,
+			     const struct encoder_packet *pkt,
+			     int64_t pts_offset)
+{
+	struct obs_core_latency *latency = &obs->latency;
+	struct obs_latency_frame *frame;
+	uint64_t capture_ns = 0;
+	uint64_t render_ns = 0;
+	uint64_t video_ts;
+	uint64_t now;
+
+	if (!tracing() || pkt->type != OBS_ENCODER_VIDEO || !pkt->encoder)
+		return;
+
+	video_ts = encoder_video_ts(pkt->encoder, pkt, pkt->pts + pts_offset);
+
+	pthread_mutex_lock(&latency->mutex);
+	frame = find_frame(video_ts);
+	if (frame) {
+		capture_ns = frame->capture_ns;
+		render_ns = frame->render_ns;
+	}
+	pthread_mutex_unlock(&latency->mutex);
+
+	if (!capture_ns)
+		return;
+
+	if (!output->latency_metrics[0]) {
+		output->latency_metrics[0] = get_metric(
+			"render_to_send", "output", output->context.name);
+		output->latency_metrics[1] = get_metric(
+			"capture_to_send", "output", output->context.name);
+	}
+
+	now = os_gettime_ns();
+	metric_record(output->latency_metrics[0],
+		      elapsed_since(now, render_ns));
+	metric_record(output->latency_metrics[1],
+		      elapsed_since(now, capture_ns));
+}
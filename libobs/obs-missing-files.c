@@ -149,3 +149,197 @@ const char *obs_missing_file_get_source_name(obs_missing_file_t *file)
 {
 	return file->src_name;
 }
+
+/* ------------------------------------------------------------------------- */
+
+#define MISSING_FILES_CHECK_THREADS 8
+
+struct obs_missing_files_check {
+	volatile long refs;
+
+	obs_weak_source_t **sources;
+	bool *checked;
+	size_t count;
+	volatile long next;
+	volatile long done;
+
+	pthread_mutex_t mutex;
+	obs_missing_files_t *files;
+	bool reported;
+	os_event_t *finished;
+	uint32_t timeout_ms;
+
+	pthread_mutex_t callback_mutex;
+	obs_missing_files_check_cb callback;
+	void *param;
+	bool cancelled;
+};
+
+static void check_release(struct obs_missing_files_check *check)
+{
+	if (os_atomic_dec_long(&check->refs) != 0)
+		return;
+
+	for (size_t i = 0; i < check->count; i++)
+		obs_weak_source_release(check->sources[i]);
+
+	if (check->files)
+		obs_missing_files_destroy(check->files);
+
+	os_event_destroy(check->finished);
+	pthread_mutex_destroy(&check->callback_mutex);
+	pthread_mutex_destroy(&check->mutex);
+	bfree(check->checked);
+	bfree(check->sources);
+	bfree(check);
+}
+
+static void *check_worker_thread(void *data)
+{
+	struct obs_missing_files_check *check = data;
+	size_t idx;
+
+	os_set_thread_name("missing files check");
+
+	while ((idx = (size_t)os_atomic_inc_long(&check->next) - 1) <
+	       check->count) {
+		obs_source_t *source =
+			obs_weak_source_get_source(check->sources[idx]);
+		obs_missing_files_t *files =
+			source ? obs_source_get_missing_files(source) : NULL;
+
+		pthread_mutex_lock(&check->mutex);
+		if (files && !check->reported)
+			obs_missing_files_append(check->files, files);
+		check->checked[idx] = true;
+		pthread_mutex_unlock(&check->mutex);
+
+		if (files)
+			obs_missing_files_destroy(files);
+		obs_source_release(source);
+
+		if ((size_t)os_atomic_inc_long(&check->done) == check->count)
+			os_event_signal(check->finished);
+	}
+
+	check_release(check);
+	return NULL;
+}
+
+static void *check_report_thread(void *data)
+{
+	struct obs_missing_files_check *check = data;
+	obs_missing_files_t *files;
+
+	os_set_thread_name("missing files check");
+
+	if (check->count)
+		os_event_timedwait(check->finished, check->timeout_ms);
+
+	pthread_mutex_lock(&check->mutex);
+	for (size_t i = 0; i < check->count; i++) {
+		if (check->checked[i])
+			continue;
+
+		obs_source_t *source =
+			obs_weak_source_get_source(check->sources[i]);
+		if (source)
+			blog(LOG_WARNING,
+			     "Timed out checking the files of source '%s'",
+			     obs_source_get_name(source));
+		obs_source_release(source);
+	}
+
+	files = check->files;
+	check->files = NULL;
+	check->reported = true;
+	pthread_mutex_unlock(&check->mutex);
+
+	pthread_mutex_lock(&check->callback_mutex);
+	if (!check->cancelled)
+		check->callback(check->param, files);
+	else
+		obs_missing_files_destroy(files);
+	pthread_mutex_unlock(&check->callback_mutex);
+
+	check_release(check);
+	return NULL;
+}
+
+static bool start_check_thread(struct obs_missing_files_check *check,
+			       void *(*thread_proc)(void *))
+{
+	pthread_t thread;
+
+	os_atomic_inc_long(&check->refs);
+
+	if (pthread_create(&thread, NULL, thread_proc, check) != 0) {
+		os_atomic_dec_long(&check->refs);
+		return false;
+	}
+
+	pthread_detach(thread);
+	return true;
+}
+
+obs_missing_files_check_t *
+obs_missing_files_check_sources(obs_source_t *const *sources, size_t count,
+				uint32_t timeout_ms,
+				obs_missing_files_check_cb callback,
+				void *param)
+{
+	struct obs_missing_files_check *check;
+	size_t threads = count < MISSING_FILES_CHECK_THREADS
+				 ? count
+				 : MISSING_FILES_CHECK_THREADS;
+
+	if (!callback)
+		return NULL;
+
+	check = bzalloc(sizeof(*check));
+	check->refs = 1;
+	check->count = count;
+	check->timeout_ms = timeout_ms;
+	check->callback = callback;
+	check->param = param;
+	check->files = obs_missing_files_create();
+
+	if (count) {
+		check->sources = bmalloc(sizeof(*check->sources) * count);
+		check->checked = bzalloc(sizeof(*check->checked) * count);
+
+		for (size_t i = 0; i < count; i++)
+			check->sources[i] = obs_source_get_weak_source(
+				sources[i]);
+	}
+
+	pthread_mutex_init(&check->mutex, NULL);
+	pthread_mutex_init(&check->callback_mutex, NULL);
+	os_event_init(&check->finished, OS_EVENT_TYPE_MANUAL);
+
+	/* if no worker could be started, the remaining sources are simply
+	 * reported as timed out */
+	for (size_t i = 0; i < threads; i++) {
+		if (!start_check_thread(check, check_worker_thread))
+			break;
+	}
+
+	if (!start_check_thread(check, check_report_thread)) {
+		check_release(check);
+		return NULL;
+	}
+
+	return check;
+}
+
+void obs_missing_files_check_destroy(obs_missing_files_check_t *check)
+{
+	if (!check)
+		return;
+
+	pthread_mutex_lock(&check->callback_mutex);
+	check->cancelled = true;
+	pthread_mutex_unlock(&check->callback_mutex);
+
+	check_release(check);
+}
@@ -55,6 +55,26 @@ EXPORT const char *obs_missing_file_get_source_name(obs_missing_file_t *file);
 EXPORT void obs_missing_file_release(obs_missing_file_t *file);
 EXPORT void obs_missing_file_destroy(obs_missing_file_t *file);
 
+/* Gathers the missing files of a list of sources on worker threads, so slow
+ * (network) storage does not hold up the caller.  The callback is called
+ * once from a worker thread and takes ownership of the files.  Sources that
+ * are still being checked when the timeout runs out are left out of the
+ * result.  Destroying the check before the callback happened cancels it,
+ * otherwise it waits for the callback to return. */
+struct obs_source;
+struct obs_missing_files_check;
+typedef struct obs_missing_files_check obs_missing_files_check_t;
+
+typedef void (*obs_missing_files_check_cb)(void *param,
+					   obs_missing_files_t *files);
+
+EXPORT obs_missing_files_check_t *
+obs_missing_files_check_sources(struct obs_source *const *sources,
+				size_t count, uint32_t timeout_ms,
+				obs_missing_files_check_cb callback,
+				void *param);
+EXPORT void obs_missing_files_check_destroy(obs_missing_files_check_t *check);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+
 #include "util/platform.h"
 #include "util/dstr.h"
 
@@ -162,7 +164,11 @@ bool obs_init_module(obs_module_t *module)
 				   "obs_init_module(%s)", module->file);
 	profile_start(profile_name);
 
+	enum bmem_tag prev_tag = bmem_set_thread_tag(BMEM_TAG_MODULE);
+	obs->loading_module = module;
 	module->loaded = module->load();
+	obs->loading_module = NULL;
+	bmem_set_thread_tag(prev_tag);
 	if (!module->loaded)
 		blog(LOG_WARNING, "Failed to initialize module '%s'",
 		     module->file);
@@ -304,56 +310,282 @@ static bool is_safe_module(const char *name)
 	return false;
 }
 
-static void load_all_callback(void *param, const struct obs_module_info2 *info)
-{
-	struct fail_info *fail_info = param;
-	obs_module_t *module;
+/* Results of checking module files that are deterministic for a given file,
+ * kept between runs so that files that are not OBS plugins or can't be
+ * loaded don't have to be inspected or opened again on every startup. */
+#define MODULE_CACHE_FILE "module-cache.json"
+
+struct module_scan;
 
+struct module_candidate {
+	char *name;
+	char *bin_path;
+	char *data_path;
+
+	int64_t size;
+	int64_t mtime;
 	bool is_obs_plugin;
-	bool can_load_obs_plugin;
+	bool can_load;
+	bool has_exports;
+
+	/* the fields above came from the cache and still match the file */
+	bool cached;
+
+	struct module_scan *scan;
+};
+
+struct module_scan {
+	DARRAY(struct module_candidate) modules;
+	volatile long remaining;
+	os_event_t *done;
+	bool dirty;
+};
+
+static void add_module_candidate(void *param,
+				 const struct obs_module_info2 *info)
+{
+	struct module_scan *scan = param;
+	struct module_candidate *mc = da_push_back_new(scan->modules);
+
+	mc->name = bstrdup(info->name);
+	mc->bin_path = bstrdup(info->bin_path);
+	mc->data_path = bstrdup(info->data_path);
+	mc->scan = scan;
+}
+
+static char *get_module_cache_path(void)
+{
+	struct dstr path = {0};
+
+	if (!obs->module_config_path)
+		return NULL;
+
+	dstr_copy(&path, obs->module_config_path);
+	if (!dstr_is_empty(&path) && dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, MODULE_CACHE_FILE);
+	return path.array;
+}
+
+static struct module_candidate *find_candidate(struct module_scan *scan,
+					       const char *bin_path)
+{
+	for (size_t i = 0; i < scan->modules.num; i++) {
+		struct module_candidate *mc = scan->modules.array + i;
+		if (strcmp(mc->bin_path, bin_path) == 0)
+			return mc;
+	}
+
+	return NULL;
+}
+
+static void load_module_cache(struct module_scan *scan)
+{
+	char *path = get_module_cache_path();
+	obs_data_t *data;
+	obs_data_array_t *modules;
+	size_t count;
+
+	data = path ? obs_data_create_from_json_file(path) : NULL;
+	bfree(path);
+	if (!data) {
+		scan->dirty = true;
+		return;
+	}
+
+	if (obs_data_get_int(data, "version") != LIBOBS_API_VER) {
+		scan->dirty = true;
+		obs_data_release(data);
+		return;
+	}
+
+	modules = obs_data_get_array(data, "modules");
+	count = obs_data_array_count(modules);
+	if (count != scan->modules.num)
+		scan->dirty = true;
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(modules, i);
+		const char *bin_path = obs_data_get_string(item, "path");
+		struct module_candidate *mc = find_candidate(scan, bin_path);
+
+		if (mc) {
+			mc->size = obs_data_get_int(item, "size");
+			mc->mtime = obs_data_get_int(item, "mtime");
+			mc->is_obs_plugin =
+				obs_data_get_bool(item, "obs_plugin");
+			mc->can_load = obs_data_get_bool(item, "can_load");
+			mc->has_exports = obs_data_get_bool(item, "exports");
+			mc->cached = true;
+		} else {
+			scan->dirty = true;
+		}
+
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(modules);
+	obs_data_release(data);
+}
+
+static void save_module_cache(struct module_scan *scan)
+{
+	char *path = get_module_cache_path();
+	obs_data_t *data;
+	obs_data_array_t *modules;
+
+	if (!path)
+		return;
+
+	data = obs_data_create();
+	modules = obs_data_array_create();
+
+	for (size_t i = 0; i < scan->modules.num; i++) {
+		struct module_candidate *mc = scan->modules.array + i;
+		obs_data_t *item;
+
+		if (mc->size < 0)
+			continue;
+
+		item = obs_data_create();
+		obs_data_set_string(item, "path", mc->bin_path);
+		obs_data_set_int(item, "size", mc->size);
+		obs_data_set_int(item, "mtime", mc->mtime);
+		obs_data_set_bool(item, "obs_plugin", mc->is_obs_plugin);
+		obs_data_set_bool(item, "can_load", mc->can_load);
+		obs_data_set_bool(item, "exports", mc->has_exports);
+		obs_data_array_push_back(modules, item);
+		obs_data_release(item);
+	}
+
+	obs_data_set_int(data, "version", LIBOBS_API_VER);
+	obs_data_set_array(data, "modules", modules);
+
+	os_mkdirs(obs->module_config_path);
+	if (!obs_data_save_json_safe(data, path, "tmp", "bak"))
+		blog(LOG_DEBUG, "Failed to save module cache '%s'", path);
+
+	obs_data_array_release(modules);
+	obs_data_release(data);
+	bfree(path);
+}
+
+/* Runs on the task pool.  On Windows get_plugin_info reads through the
+ * imports of each file, which adds up to a good part of startup with many
+ * plugins installed, so all files are inspected in parallel before they are
+ * loaded one by one. */
+static void scan_module(void *param)
+{
+	struct module_candidate *mc = param;
+	struct stat st;
+	int64_t size = -1;
+	int64_t mtime = 0;
+
+	if (os_stat(mc->bin_path, &st) == 0) {
+		size = (int64_t)st.st_size;
+		mtime = (int64_t)st.st_mtime;
+	}
+
+	if (!mc->cached || size < 0 || mc->size != size ||
+	    mc->mtime != mtime) {
+		mc->cached = false;
+		mc->size = size;
+		mc->mtime = mtime;
+		mc->has_exports = true;
+		get_plugin_info(mc->bin_path, &mc->is_obs_plugin,
+				&mc->can_load);
+	}
+
+	if (os_atomic_dec_long(&mc->scan->remaining) == 0)
+		os_event_signal(mc->scan->done);
+}
+
+static void scan_modules(struct module_scan *scan)
+{
+	size_t num = scan->modules.num;
+
+	if (!num)
+		return;
+
+	scan->remaining = (long)num;
+	if (os_event_init(&scan->done, OS_EVENT_TYPE_MANUAL) != 0) {
+		for (size_t i = 0; i < num; i++)
+			scan_module(scan->modules.array + i);
+		return;
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		struct module_candidate *mc = scan->modules.array + i;
+		if (!os_task_pool_queue_task(obs->task_pool,
+					     OS_TASK_PRIORITY_INTERACTIVE,
+					     scan_module, mc))
+			scan_module(mc);
+	}
+
+	os_event_wait(scan->done);
+	os_event_destroy(scan->done);
+	scan->done = NULL;
 
-	get_plugin_info(info->bin_path, &is_obs_plugin, &can_load_obs_plugin);
+	for (size_t i = 0; i < num; i++) {
+		if (!scan->modules.array[i].cached)
+			scan->dirty = true;
+	}
+}
+
+static void load_candidate(struct module_candidate *mc,
+			   struct fail_info *fail_info)
+{
+	obs_module_t *module;
 
-	if (!is_obs_plugin) {
+	if (!mc->is_obs_plugin) {
 		blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin",
-		     info->bin_path);
+		     mc->bin_path);
 		return;
 	}
 
-	if (!is_safe_module(info->name)) {
+	if (!is_safe_module(mc->name)) {
 		blog(LOG_WARNING, "Skipping module '%s', not on safe list",
-		     info->name);
+		     mc->name);
 		return;
 	}
 
-	if (!can_load_obs_plugin) {
+	if (!mc->can_load) {
 		blog(LOG_WARNING,
 		     "Skipping module '%s' due to possible "
 		     "import conflicts",
-		     info->bin_path);
+		     mc->bin_path);
 		goto load_failure;
 	}
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
+	if (!mc->has_exports) {
+		blog(LOG_DEBUG,
+		     "Skipping module file '%s', not an OBS plugin (cached)",
+		     mc->bin_path);
+		return;
+	}
+
+	int code = obs_open_module(&module, mc->bin_path, mc->data_path);
 	switch (code) {
 	case MODULE_MISSING_EXPORTS:
 		blog(LOG_DEBUG,
 		     "Failed to load module file '%s', not an OBS plugin",
-		     info->bin_path);
+		     mc->bin_path);
+		mc->has_exports = false;
+		mc->scan->dirty = true;
 		return;
 	case MODULE_FILE_NOT_FOUND:
 		blog(LOG_DEBUG,
 		     "Failed to load module file '%s', file not found",
-		     info->bin_path);
+		     mc->bin_path);
 		return;
 	case MODULE_ERROR:
 		blog(LOG_DEBUG, "Failed to load module file '%s'",
-		     info->bin_path);
+		     mc->bin_path);
 		goto load_failure;
 	case MODULE_INCOMPATIBLE_VER:
 		blog(LOG_DEBUG,
 		     "Failed to load module file '%s', incompatible version",
-		     info->bin_path);
+		     mc->bin_path);
 		goto load_failure;
 	case MODULE_HARDCODED_SKIP:
 		return;
@@ -361,18 +593,41 @@ static void load_all_callback(void *param, const struct obs_module_info2 *info)
 
 	if (!obs_init_module(module))
 		free_module(module);
-
-	UNUSED_PARAMETER(param);
 	return;
 
 load_failure:
 	if (fail_info) {
-		dstr_cat(&fail_info->fail_modules, info->name);
+		dstr_cat(&fail_info->fail_modules, mc->name);
 		dstr_cat(&fail_info->fail_modules, ";");
 		fail_info->fail_count++;
 	}
 }
 
+static void load_all_modules(struct fail_info *fail_info)
+{
+	struct module_scan scan = {0};
+
+	obs_find_modules2(add_module_candidate, &scan);
+	load_module_cache(&scan);
+	scan_modules(&scan);
+
+	/* module loads register types and may touch the graphics context or
+	 * the UI, so they stay on this thread and in discovery order */
+	for (size_t i = 0; i < scan.modules.num; i++)
+		load_candidate(scan.modules.array + i, fail_info);
+
+	if (scan.dirty)
+		save_module_cache(&scan);
+
+	for (size_t i = 0; i < scan.modules.num; i++) {
+		struct module_candidate *mc = scan.modules.array + i;
+		bfree(mc->name);
+		bfree(mc->bin_path);
+		bfree(mc->data_path);
+	}
+	da_free(scan.modules);
+}
+
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
 #ifdef _WIN32
 static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
@@ -381,7 +636,7 @@ static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 void obs_load_all_modules(void)
 {
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules2(load_all_callback, NULL);
+	load_all_modules(NULL);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -398,7 +653,7 @@ void obs_load_all_modules2(struct obs_module_failure_info *mfi)
 	memset(mfi, 0, sizeof(*mfi));
 
 	profile_start(obs_load_all_modules2_name);
-	obs_find_modules2(load_all_callback, &fail_info);
+	load_all_modules(&fail_info);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -613,8 +868,12 @@ void free_module(struct obs_module *mod)
 		if (mod->free_locale)
 			mod->free_locale();
 
-		if (mod->loaded && mod->unload)
+		if (mod->loaded && mod->unload) {
+			enum bmem_tag prev_tag =
+				bmem_set_thread_tag(BMEM_TAG_MODULE);
 			mod->unload();
+			bmem_set_thread_tag(prev_tag);
+		}
 
 		/* there is no real reason to close the dynamic libraries,
 		 * and sometimes this can cause issues. */
@@ -683,7 +942,43 @@ cleanup:
 	return lookup;
 }
 
-#define REGISTER_OBS_DEF(size_var, structure, dest, info)               \
+void obs_type_index_add(struct obs_type_index **index, const char *id,
+			size_t idx)
+{
+	struct obs_type_index *entry = bzalloc(sizeof(*entry));
+	entry->id = id;
+	entry->idx = idx;
+
+	HASH_ADD_KEYPTR(hh, *index, entry->id, strlen(entry->id), entry);
+}
+
+bool obs_type_index_find(struct obs_type_index *index, const char *id,
+			 size_t *idx)
+{
+	struct obs_type_index *entry;
+
+	if (!id)
+		return false;
+
+	HASH_FIND_STR(index, id, entry);
+	if (!entry)
+		return false;
+
+	*idx = entry->idx;
+	return true;
+}
+
+void obs_type_index_free(struct obs_type_index **index)
+{
+	struct obs_type_index *entry, *tmp;
+
+	HASH_ITER (hh, *index, entry, tmp) {
+		HASH_DELETE(hh, *index, entry);
+		bfree(entry);
+	}
+}
+
+#define REGISTER_OBS_DEF(size_var, structure, dest, info, index)        \
 	do {                                                            \
 		struct structure data = {0};                            \
 		if (!size_var) {                                        \
@@ -704,6 +999,7 @@ cleanup:
 		}                                                       \
                                                                         \
 		memcpy(&data, info, size_var);                          \
+		obs_type_index_add(index, data.id, dest.num);           \
 		da_push_back(dest, &data);                              \
 	} while (false)
 
@@ -854,7 +1150,10 @@ void obs_register_source_s(const struct obs_source_info *info, size_t size)
 
 	if (array)
 		da_push_back(*array, &data);
+	obs_type_index_add(&obs->source_type_index, data.id,
+			   obs->source_types.num);
 	da_push_back(obs->source_types, &data);
+	da_push_back(obs->source_type_modules, &obs->loading_module);
 	return;
 
 error:
@@ -900,7 +1199,8 @@ void obs_register_output_s(const struct obs_output_info *info, size_t size)
 	}
 #undef CHECK_REQUIRED_VAL_
 
-	REGISTER_OBS_DEF(size, obs_output_info, obs->output_types, info);
+	REGISTER_OBS_DEF(size, obs_output_info, obs->output_types, info,
+			 &obs->output_type_index);
 
 	if (info->flags & OBS_OUTPUT_SERVICE) {
 		char **protocols = strlist_split(info->protocols, ';', false);
@@ -951,7 +1251,8 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 		CHECK_REQUIRED_VAL_(info, get_frame_size, obs_register_encoder);
 #undef CHECK_REQUIRED_VAL_
 
-	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info);
+	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info,
+			 &obs->encoder_type_index);
 	return;
 
 error:
@@ -975,7 +1276,8 @@ void obs_register_service_s(const struct obs_service_info *info, size_t size)
 	CHECK_REQUIRED_VAL_(info, get_protocol, obs_register_service);
 #undef CHECK_REQUIRED_VAL_
 
-	REGISTER_OBS_DEF(size, obs_service_info, obs->service_types, info);
+	REGISTER_OBS_DEF(size, obs_service_info, obs->service_types, info,
+			 &obs->service_type_index);
 	return;
 
 error:
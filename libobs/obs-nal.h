@@ -33,6 +33,44 @@ enum {
 EXPORT const uint8_t *obs_nal_find_startcode(const uint8_t *p,
 					     const uint8_t *end);
 
+#define OBS_NAL_INDEX_MAX 16
+
+struct obs_nal_unit {
+	uint32_t offset; /**< Offset of the NAL unit header in the packet */
+	uint32_t size;   /**< Size of the NAL unit, without the start code */
+};
+
+/**
+ * Positions of the NAL units of an Annex B packet, so that the packet only
+ * has to be scanned for start codes once no matter how many consumers parse
+ * it.  The index is only valid for as long as the packet data it was built
+ * for is unchanged.
+ */
+struct obs_nal_index {
+	size_t packet_size; /**< Size of the indexed data, 0 if not indexed */
+	size_t num;
+	struct obs_nal_unit units[OBS_NAL_INDEX_MAX];
+};
+
+/**
+ * Builds the NAL unit index of the given data.  Returns false and leaves the
+ * index unset if the data has more than OBS_NAL_INDEX_MAX NAL units.
+ */
+EXPORT bool obs_nal_index_build(struct obs_nal_index *index,
+				const uint8_t *data, size_t size);
+
+static inline void obs_nal_index_clear(struct obs_nal_index *index)
+{
+	index->packet_size = 0;
+	index->num = 0;
+}
+
+static inline bool obs_nal_index_valid(const struct obs_nal_index *index,
+				       size_t size)
+{
+	return index->packet_size != 0 && index->packet_size == size;
+}
+
 #ifdef __cplusplus
 }
 #endif
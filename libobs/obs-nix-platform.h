@@ -27,6 +27,8 @@ enum obs_nix_platform_type {
 	OBS_NIX_PLATFORM_X11_GLX OBS_DEPRECATED,
 	OBS_NIX_PLATFORM_X11_EGL,
 	OBS_NIX_PLATFORM_WAYLAND,
+	/* no display server, offscreen rendering only */
+	OBS_NIX_PLATFORM_SURFACELESS,
 };
 
 /**
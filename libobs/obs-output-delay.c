@@ -18,6 +18,14 @@
 #include <inttypes.h>
 #include "obs-internal.h"
 
+/* delays at least this long keep packet data in temporary segment files
+ * instead of memory, and read it back shortly before it's sent */
+#define DISK_DELAY_MIN_NS (60ULL * 1000000000ULL)
+#define DISK_READ_AHEAD_NS (2ULL * 1000000000ULL)
+
+#define SEGMENT_SIZE (64ULL * 1024ULL * 1024ULL)
+#define MAX_FREE_SEGMENTS 2
+
 static inline bool delay_active(const struct obs_output *output)
 {
 	return os_atomic_load_bool(&output->delay_active);
@@ -44,16 +52,231 @@ static inline bool log_flag_encoded(const struct obs_output *output,
 	return ret;
 }
 
+/* ------------------------------------------------------------------------- */
+/* disk store                                                                */
+
+/* Packets are appended to a ring of fixed size segments.  Segments are
+ * recycled once every packet in them has been read back, which happens in
+ * the order they were written. */
+
+struct delay_segment {
+	FILE *file;
+	uint64_t size;
+	size_t packets; /* not read back yet */
+	bool reading;
+};
+
+struct delay_store {
+	DARRAY(struct delay_segment) segments; /* oldest first */
+	DARRAY(struct delay_segment) free_segments;
+	uint64_t first_segment;
+	DARRAY(uint8_t) buffer;
+	bool failed;
+};
+
+static void delay_store_destroy(struct delay_store *store)
+{
+	if (!store)
+		return;
+
+	for (size_t i = 0; i < store->segments.num; i++)
+		fclose(store->segments.array[i].file);
+	for (size_t i = 0; i < store->free_segments.num; i++)
+		fclose(store->free_segments.array[i].file);
+
+	da_free(store->segments);
+	da_free(store->free_segments);
+	da_free(store->buffer);
+	bfree(store);
+}
+
+static struct delay_segment *new_segment(struct delay_store *store)
+{
+	struct delay_segment segment = {0};
+
+	if (store->free_segments.num) {
+		segment = *(struct delay_segment *)da_end(store->free_segments);
+		da_pop_back(store->free_segments);
+	} else {
+		/* removed automatically when closed */
+		segment.file = tmpfile();
+		if (!segment.file)
+			return NULL;
+	}
+
+	segment.size = 0;
+	segment.packets = 0;
+	segment.reading = true;
+
+	da_push_back(store->segments, &segment);
+	return da_end(store->segments);
+}
+
+static void release_segments(struct delay_store *store)
+{
+	while (store->segments.num > 1 && !store->segments.array[0].packets) {
+		struct delay_segment segment = store->segments.array[0];
+
+		if (store->free_segments.num < MAX_FREE_SEGMENTS)
+			da_push_back(store->free_segments, &segment);
+		else
+			fclose(segment.file);
+
+		da_erase(store->segments, 0);
+		store->first_segment++;
+	}
+}
+
+static bool delay_store_write(struct delay_store *store,
+			      const struct encoder_packet *packet,
+			      uint64_t *pos)
+{
+	struct delay_segment *segment = da_end(store->segments);
+
+	if (store->failed || packet->size > SEGMENT_SIZE)
+		return false;
+
+	if (!segment || segment->size + packet->size > SEGMENT_SIZE) {
+		segment = new_segment(store);
+		if (!segment)
+			goto fail;
+	}
+
+	if (segment->reading) {
+		if (os_fseeki64(segment->file, (int64_t)segment->size,
+				SEEK_SET) != 0)
+			goto fail;
+		segment->reading = false;
+	}
+
+	if (fwrite(packet->data, 1, packet->size, segment->file) !=
+	    packet->size)
+		goto fail;
+
+	*pos = (store->first_segment + store->segments.num - 1) *
+		       SEGMENT_SIZE +
+	       segment->size;
+	segment->size += packet->size;
+	segment->packets++;
+	return true;
+
+fail:
+	blog(LOG_WARNING, "Failed to write a delayed packet to disk, keeping "
+			  "the rest in memory");
+	store->failed = true;
+	return false;
+}
+
+static bool delay_store_read(struct delay_store *store, struct delay_data *dd)
+{
+	uint64_t number = dd->disk_pos / SEGMENT_SIZE;
+	uint64_t offset = dd->disk_pos % SEGMENT_SIZE;
+	struct encoder_packet packet = dd->packet;
+	struct delay_segment *segment;
+	bool success;
+
+	if (number < store->first_segment ||
+	    number - store->first_segment >= store->segments.num)
+		return false;
+
+	segment = &store->segments.array[number - store->first_segment];
+	segment->reading = true;
+
+	da_resize(store->buffer, packet.size);
+	success = os_fseeki64(segment->file, (int64_t)offset, SEEK_SET) == 0 &&
+		  fread(store->buffer.array, 1, packet.size, segment->file) ==
+			  packet.size;
+
+	if (success) {
+		packet.data = store->buffer.array;
+		obs_encoder_packet_create_instance(&dd->packet, &packet);
+	}
+
+	segment->packets--;
+	release_segments(store);
+	return success;
+}
+
+/* call with delay_mutex held */
+static bool store_packet(struct obs_output *output,
+			 struct encoder_packet *packet, struct delay_data *dd)
+{
+	if (!output->delay_store) {
+		output->delay_store = bzalloc(sizeof(struct delay_store));
+		blog(LOG_INFO, "Output '%s': keeping delayed packets on disk",
+		     output->context.name);
+	}
+
+	dd->packet = *packet;
+	dd->packet.data = NULL;
+	dd->on_disk = delay_store_write(output->delay_store, packet,
+					&dd->disk_pos);
+	return dd->on_disk;
+}
+
+/* call with delay_mutex held, packets that can't be read back are left
+ * without data and dropped */
+static void load_packet(struct obs_output *output, struct delay_data *dd)
+{
+	if (!dd->on_disk)
+		return;
+
+	if (!delay_store_read(output->delay_store, dd))
+		blog(LOG_WARNING,
+		     "Output '%s': Failed to read a delayed packet from disk",
+		     output->context.name);
+
+	dd->on_disk = false;
+}
+
+static void read_ahead(struct obs_output *output, uint64_t t)
+{
+	size_t count;
+
+	pthread_mutex_lock(&output->delay_mutex);
+
+	count = output->delay_data.size / sizeof(struct delay_data);
+
+	while (output->delay_store && output->delay_loaded < count) {
+		size_t pos = output->delay_loaded * sizeof(struct delay_data);
+		struct delay_data dd;
+
+		deque_peek_at(&output->delay_data, pos, &dd, sizeof(dd));
+		if (dd.ts + output->active_delay_ns > t + DISK_READ_AHEAD_NS)
+			break;
+
+		if (dd.on_disk) {
+			load_packet(output, &dd);
+			deque_place(&output->delay_data, pos, &dd, sizeof(dd));
+		}
+
+		output->delay_loaded++;
+	}
+
+	pthread_mutex_unlock(&output->delay_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool use_disk_store(const struct obs_output *output)
+{
+	return output->active_delay_ns >= DISK_DELAY_MIN_NS;
+}
+
 static inline void push_packet(struct obs_output *output,
 			       struct encoder_packet *packet, uint64_t t)
 {
-	struct delay_data dd;
+	struct delay_data dd = {0};
+	bool disk = use_disk_store(output);
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts = t;
-	obs_encoder_packet_create_instance(&dd.packet, packet);
+	if (!disk)
+		obs_encoder_packet_create_instance(&dd.packet, packet);
 
 	pthread_mutex_lock(&output->delay_mutex);
+	if (disk && !store_packet(output, packet, &dd))
+		obs_encoder_packet_create_instance(&dd.packet, packet);
 	deque_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
 }
@@ -63,6 +286,8 @@ static inline void process_delay_data(struct obs_output *output,
 {
 	switch (dd->msg) {
 	case DELAY_MSG_PACKET:
+		if (!dd->packet.data)
+			break;
 		if (!delay_active(output) || !delay_capturing(output))
 			obs_encoder_packet_release(&dd->packet);
 		else
@@ -88,6 +313,10 @@ void obs_output_cleanup_delay(obs_output_t *output)
 		}
 	}
 
+	delay_store_destroy(output->delay_store);
+	output->delay_store = NULL;
+	output->delay_loaded = 0;
+
 	output->active_delay_ns = 0;
 	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
@@ -114,6 +343,9 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 
 		} else if (elapsed_time > output->active_delay_ns) {
 			deque_pop_front(&output->delay_data, NULL, sizeof(dd));
+			if (output->delay_loaded)
+				output->delay_loaded--;
+			load_packet(output, &dd);
 			popped = true;
 		}
 	}
@@ -135,6 +367,8 @@ void process_delay(void *data, struct encoder_packet *packet)
 	push_packet(output, packet, t);
 	while (pop_packet(output, t))
 		;
+	if (output->delay_store)
+		read_ahead(output, t);
 }
 
 void obs_output_signal_delay(obs_output_t *output, const char *signal)
@@ -127,12 +127,12 @@ static inline bool log_flag_service(const struct obs_output *output,
 
 const struct obs_output_info *find_output(const char *id)
 {
-	size_t i;
-	for (i = 0; i < obs->output_types.num; i++)
-		if (strcmp(obs->output_types.array[i].id, id) == 0)
-			return obs->output_types.array + i;
+	size_t idx;
 
-	return NULL;
+	if (!obs_type_index_find(obs->output_type_index, id, &idx))
+		return NULL;
+
+	return obs->output_types.array + idx;
 }
 
 const char *obs_output_get_display_name(const char *id)
@@ -174,11 +174,11 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	int ret;
 
 	output = bzalloc(sizeof(struct obs_output));
-	pthread_mutex_init_value(&output->interleaved_mutex);
+	os_mutex_init_value(&output->interleaved_mutex);
 	pthread_mutex_init_value(&output->delay_mutex);
 	pthread_mutex_init_value(&output->pause.mutex);
 
-	if (pthread_mutex_init(&output->interleaved_mutex, NULL) != 0)
+	if (os_mutex_init(&output->interleaved_mutex, "interleaved_mutex") != 0)
 		goto fail;
 	if (pthread_mutex_init(&output->delay_mutex, NULL) != 0)
 		goto fail;
@@ -236,12 +236,58 @@ fail:
 	return NULL;
 }
 
+static inline bool interleave_queue_empty(struct interleave_queue *q)
+{
+	return q->head == q->packets.num;
+}
+
+static inline struct encoder_packet *
+interleave_queue_front(struct interleave_queue *q)
+{
+	return interleave_queue_empty(q) ? NULL : q->packets.array + q->head;
+}
+
+static inline struct encoder_packet *
+interleave_queue_back(struct interleave_queue *q)
+{
+	if (interleave_queue_empty(q))
+		return NULL;
+	return q->packets.array + q->packets.num - 1;
+}
+
+static inline void interleave_queue_pop(struct interleave_queue *q,
+					struct encoder_packet *out)
+{
+	*out = q->packets.array[q->head++];
+
+	/* only move the remaining packets down once at least half of the
+	 * array has been consumed, so popping stays amortized O(1) */
+	if (q->head == q->packets.num) {
+		da_resize(q->packets, 0);
+		q->head = 0;
+	} else if (q->head * 2 >= q->packets.num) {
+		da_erase_range(q->packets, 0, q->head);
+		q->head = 0;
+	}
+}
+
+static void interleave_queue_free(struct interleave_queue *q)
+{
+	for (size_t i = q->head; i < q->packets.num; i++)
+		obs_encoder_packet_release(q->packets.array + i);
+	da_free(q->packets);
+	q->head = 0;
+}
+
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array +
-					   i);
-	da_free(output->interleaved_packets);
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		interleave_queue_free(&output->interleaved_video[i]);
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+		interleave_queue_free(&output->interleaved_audio[i]);
+
+	output->interleave_heap_size = 0;
+	output->interleaved_count = 0;
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -253,6 +299,17 @@ static inline void clear_raw_audio_buffers(obs_output_t *output)
 	}
 }
 
+static void clear_caption_data(struct caption_track_data *ctrack)
+{
+	struct caption_payload payload;
+
+	while (ctrack->caption_data.size) {
+		deque_pop_front(&ctrack->caption_data, &payload,
+				sizeof(payload));
+		caption_payload_free(&payload);
+	}
+}
+
 static void destroy_caption_track(struct caption_track_data **ctrack_ptr)
 {
 	if (!ctrack_ptr || !*ctrack_ptr) {
@@ -260,6 +317,7 @@ static void destroy_caption_track(struct caption_track_data **ctrack_ptr)
 	}
 	struct caption_track_data *ctrack = *ctrack_ptr;
 	pthread_mutex_destroy(&ctrack->caption_mutex);
+	clear_caption_data(ctrack);
 	deque_free(&ctrack->caption_data);
 	bfree(ctrack);
 	*ctrack_ptr = NULL;
@@ -305,12 +363,14 @@ void obs_output_destroy(obs_output_t *output)
 		}
 
 		da_free(output->keyframe_group_tracking);
+		da_free(output->followers);
+		obs_weak_output_release(output->interleave_leader);
 
 		clear_raw_audio_buffers(output);
 
 		os_event_destroy(output->stopping_event);
 		pthread_mutex_destroy(&output->pause.mutex);
-		pthread_mutex_destroy(&output->interleaved_mutex);
+		os_mutex_destroy(&output->interleaved_mutex);
 		pthread_mutex_destroy(&output->delay_mutex);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
@@ -319,10 +379,32 @@ void obs_output_destroy(obs_output_t *output)
 			bfree((void *)output->info.id);
 		if (output->last_error_message)
 			bfree(output->last_error_message);
+		metric_release(output->send_time_metric);
+		metric_release(output->latency_metrics[0]);
+		metric_release(output->latency_metrics[1]);
+		metric_release(output->interleave_depth_metric);
 		bfree(output);
 	}
 }
 
+static void create_output_metrics(obs_output_t *output)
+{
+	struct dstr labels = {0};
+
+	if (output->send_time_metric)
+		return;
+
+	metric_label_cat(&labels, "output", output->context.name);
+	output->send_time_metric =
+		metric_get(METRIC_HISTOGRAM, "obs_output_send_time_seconds",
+			   labels.array,
+			   "Time spent handing packets to outputs");
+	output->interleave_depth_metric =
+		metric_get(METRIC_GAUGE, "obs_output_interleaved_packets",
+			   labels.array, "Packets waiting to be interleaved");
+	dstr_free(&labels);
+}
+
 const char *obs_output_get_name(const obs_output_t *output)
 {
 	return obs_output_valid(output, "obs_output_get_name")
@@ -341,6 +423,8 @@ bool obs_output_actual_start(obs_output_t *output)
 		output->last_error_message = NULL;
 	}
 
+	create_output_metrics(output);
+
 	if (output->context.data)
 		success = output->info.start(output->context.data);
 
@@ -359,6 +443,7 @@ bool obs_output_actual_start(obs_output_t *output)
 		}
 		pthread_mutex_lock(&ctrack->caption_mutex);
 		ctrack->caption_timestamp = 0;
+		clear_caption_data(ctrack);
 		deque_free(&ctrack->caption_data);
 		deque_init(&ctrack->caption_data);
 		pthread_mutex_unlock(&ctrack->caption_mutex);
@@ -497,6 +582,7 @@ void obs_output_actual_stop(obs_output_t *output, bool force, uint64_t ts)
 		}
 		while (ctrack->caption_head) {
 			ctrack->caption_tail = ctrack->caption_head->next;
+			caption_payload_free(&ctrack->caption_head->payload);
 			bfree(ctrack->caption_head);
 			ctrack->caption_head = ctrack->caption_tail;
 		}
@@ -522,7 +608,7 @@ void obs_output_stop(obs_output_t *output)
 		obs_output_delay_stop(output);
 	} else if (!stopping(output)) {
 		do_output_signal(output, "stopping");
-		obs_output_actual_stop(output, false, os_gettime_ns());
+		obs_output_actual_stop(output, false, obs_get_clock_ns());
 	}
 }
 
@@ -538,6 +624,25 @@ void obs_output_force_stop(obs_output_t *output)
 	obs_output_actual_stop(output, true, 0);
 }
 
+void obs_output_set_interleave_leader(obs_output_t *output,
+				      obs_output_t *leader)
+{
+	if (!obs_output_valid(output, "obs_output_set_interleave_leader"))
+		return;
+	if (leader == output)
+		return;
+
+	obs_weak_output_release(output->interleave_leader);
+	output->interleave_leader = obs_output_get_weak_output(leader);
+}
+
+obs_output_t *obs_output_get_interleave_leader(const obs_output_t *output)
+{
+	return obs_output_valid(output, "obs_output_get_interleave_leader")
+		       ? obs_weak_output_get_output(output->interleave_leader)
+		       : NULL;
+}
+
 bool obs_output_active(const obs_output_t *output)
 {
 	return (output != NULL) ? (active(output) || reconnecting(output))
@@ -641,7 +746,7 @@ static inline uint64_t get_closest_v_ts(struct pause_data *pause)
 {
 	uint64_t interval = obs->video.video_frame_interval_ns;
 	uint64_t i2 = interval * 2;
-	uint64_t ts = os_gettime_ns();
+	uint64_t ts = obs_get_clock_ns();
 
 	return pause->last_video_ts +
 	       ((ts - pause->last_video_ts + i2) / interval) * interval;
@@ -1325,6 +1430,23 @@ void obs_output_set_video_conversion(obs_output_t *output,
 	output->video_conversion_set = true;
 }
 
+void obs_output_set_raw_video_enabled(obs_output_t *output, bool enabled)
+{
+	if (!obs_output_valid(output, "obs_output_set_raw_video_enabled"))
+		return;
+	if (log_flag_encoded(output, __FUNCTION__, true) ||
+	    !log_flag_video(output, __FUNCTION__))
+		return;
+	if (active(output)) {
+		blog(LOG_WARNING, "%s: tried to change raw video of active "
+				  "output '%s'",
+		     __FUNCTION__, output->context.name);
+		return;
+	}
+
+	output->raw_video_disabled = !enabled;
+}
+
 void obs_output_set_audio_conversion(
 	obs_output_t *output, const struct audio_convert_info *conversion)
 {
@@ -1527,33 +1649,193 @@ static size_t extract_itut_t35_buffer_from_sei(sei_t *sei, uint8_t **data_out)
 	return payload_size;
 }
 
-static const uint8_t nal_start[4] = {0, 0, 0, 1};
-static bool add_caption(struct obs_output *output, struct encoder_packet *out)
+static void caption_payload_init(struct caption_payload *payload, sei_t *sei)
 {
-	struct encoder_packet backup = *out;
+	uint8_t *t35 = NULL;
+	size_t t35_size;
+
+	payload->sei = bmalloc(sei_render_size(sei));
+	payload->sei_size = sei_render(sei, payload->sei);
+
+	/* In each of these specs there is an identical structure that carries
+	 * caption information. It is named slightly differently in each one.
+	 * The metadata_itut_t35 in AV1 or the user_data_registered_itu_t_t35
+	 * in HEVC/AVC. The AVC SEI is kept as is (HEVC only needs a different
+	 * NAL unit header), and the T.35 message is repackaged into a metadata
+	 * OBU for AV1. */
+	t35_size = extract_itut_t35_buffer_from_sei(sei, &t35);
+	if (t35) {
+		metadata_obu_itu_t35(t35, t35_size, &payload->obu,
+				     &payload->obu_size);
+		bfree(t35);
+	}
+}
+
+static bool caption_payload_from_cea708(struct caption_payload *payload,
+					const struct obs_source_cea_708 *cc)
+{
+	cea708_t cea708;
 	sei_t sei;
-	uint8_t *data = NULL;
-	size_t size;
-	long ref = 1;
-	bool avc = false;
-	bool hevc = false;
-	bool av1 = false;
 
-	/* Instead of exiting early for unsupported codecs, we will continue
-	 * processing to allow the freeing of caption data even if the captions
-	 * will not be included in the bitstream due to being unimplemented in
-	 * the given codec. */
-	if (strcmp(out->encoder->info.codec, "h264") == 0) {
-		avc = true;
-	} else if (strcmp(out->encoder->info.codec, "av1") == 0) {
-		av1 = true;
-#ifdef ENABLE_HEVC
-	} else if (strcmp(out->encoder->info.codec, "hevc") == 0) {
-		hevc = true;
-#endif
+	cea708_init(&cea708, 0); // set up a new popon frame
+
+	for (size_t i = 0; i < cc->packets; i++) {
+		const uint8_t *cc_data = cc->data + (i * 3);
+
+		if ((cc_data[0] & 0x3) != 0) {
+			// only send cea 608
+			continue;
+		}
+
+		uint16_t captionData = cc_data[1];
+		captionData = captionData << 8;
+		captionData += cc_data[2];
+
+		// padding
+		if (captionData == 0x8080) {
+			continue;
+		}
+
+		if (captionData == 0) {
+			continue;
+		}
+
+		if (!eia608_parity_varify(captionData)) {
+			continue;
+		}
+
+		cea708_add_cc_data(&cea708, 1, cc_data[0] & 0x3, captionData);
 	}
 
-	DARRAY(uint8_t) out_data;
+	sei_init(&sei, 0.0);
+
+	sei_message_t *msg = sei_message_new(
+		sei_type_user_data_registered_itu_t_t35, 0, CEA608_MAX_SIZE);
+	msg->size = cea708_render(&cea708, sei_message_data(msg),
+				  sei_message_size(msg));
+	sei_message_append(&sei, msg);
+
+	caption_payload_init(payload, &sei);
+	sei_free(&sei);
+	return payload->sei_size > 0;
+}
+
+static void caption_payload_from_text(struct caption_payload *payload,
+				      const char *text)
+{
+	caption_frame_t cf;
+	sei_t sei;
+
+	caption_frame_init(&cf);
+	caption_frame_from_text(&cf, text);
+
+	sei_init(&sei, 0.0);
+	sei_from_caption_frame(&sei, &cf);
+
+	caption_payload_init(payload, &sei);
+	sei_free(&sei);
+}
+
+static void caption_payload_copy(struct caption_payload *dst,
+				 const struct caption_payload *src)
+{
+	dst->sei = src->sei ? bmemdup(src->sei, src->sei_size) : NULL;
+	dst->sei_size = src->sei_size;
+	dst->obu = src->obu ? bmemdup(src->obu, src->obu_size) : NULL;
+	dst->obu_size = src->obu_size;
+}
+
+enum caption_codec {
+	CAPTION_CODEC_NONE,
+	CAPTION_CODEC_AVC,
+	CAPTION_CODEC_HEVC,
+	CAPTION_CODEC_AV1,
+};
+
+static const uint8_t nal_start[4] = {0, 0, 0, 1};
+
+static size_t caption_payload_size(enum caption_codec codec,
+				   const struct caption_payload *payload)
+{
+	switch (codec) {
+	case CAPTION_CODEC_AVC:
+		return payload->sei_size ? 4 + payload->sei_size : 0;
+	case CAPTION_CODEC_HEVC:
+		/* 3 byte start code and 2 byte NAL unit header replacing the
+		 * 1 byte AVC one */
+		return payload->sei_size ? 3 + 2 + payload->sei_size - 1 : 0;
+	case CAPTION_CODEC_AV1:
+		return payload->obu_size;
+	case CAPTION_CODEC_NONE:
+		break;
+	}
+	return 0;
+}
+
+/* keeps the packet's NAL index in sync with the SEI NALs appended to it */
+static void index_caption_nal(struct obs_nal_index *index, size_t offset,
+			      size_t size)
+{
+	if (!index || !index->packet_size)
+		return;
+
+	if (index->num == OBS_NAL_INDEX_MAX) {
+		obs_nal_index_clear(index);
+		return;
+	}
+
+	index->units[index->num].offset = (uint32_t)offset;
+	index->units[index->num].size = (uint32_t)size;
+	index->num++;
+}
+
+static uint8_t *write_caption_payload(uint8_t *dst, const uint8_t *base,
+				      enum caption_codec codec,
+				      const uint8_t *hevc_nal_header,
+				      const struct caption_payload *payload,
+				      struct obs_nal_index *index)
+{
+	if (!caption_payload_size(codec, payload))
+		return dst;
+
+	if (codec == CAPTION_CODEC_AVC) {
+		/* TODO: SEI should come after AUD/SPS/PPS,
+		 * but before any VCL */
+		memcpy(dst, nal_start, 4);
+		memcpy(dst + 4, payload->sei, payload->sei_size);
+		index_caption_nal(index, dst + 4 - base, payload->sei_size);
+		return dst + 4 + payload->sei_size;
+
+	} else if (codec == CAPTION_CODEC_HEVC) {
+		/* Only first NAL (VPS/PPS/SPS) should use the 4 byte
+		 * start code. SEIs use 3 byte version */
+		memcpy(dst, nal_start + 1, 3);
+		/* The HEVC NAL unit header is 2 byte instead of one,
+		 * otherwise everything else is the same. */
+		memcpy(dst + 3, hevc_nal_header, 2);
+		memcpy(dst + 5, payload->sei + 1, payload->sei_size - 1);
+		index_caption_nal(index, dst + 3 - base,
+				  2 + payload->sei_size - 1);
+		return dst + 5 + payload->sei_size - 1;
+	}
+
+	memcpy(dst, payload->obu, payload->obu_size);
+	return dst + payload->obu_size;
+}
+
+/* Splices the pending text caption and/or all queued CEA-708 captions of the
+ * packet's track into a single new packet allocation. The captions were
+ * already rendered when they were queued, so this only has to copy. */
+static bool add_caption(struct obs_output *output, struct encoder_packet *out,
+			bool send_text, bool send_cc)
+{
+	struct caption_payload text = {0};
+	struct caption_payload payload;
+	enum caption_codec codec = CAPTION_CODEC_NONE;
+	uint8_t hevc_nal_header[2] = {0};
+	size_t cc_count;
+	size_t size;
+	long ref = 1;
 
 	if (out->priority > 1)
 		return false;
@@ -1567,12 +1849,30 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 		return false;
 	}
 
+	/* Instead of exiting early for unsupported codecs, we will continue
+	 * processing to allow the freeing of caption data even if the captions
+	 * will not be included in the bitstream due to being unimplemented in
+	 * the given codec. */
+	if (strcmp(out->encoder->info.codec, "h264") == 0) {
+		codec = CAPTION_CODEC_AVC;
+	} else if (strcmp(out->encoder->info.codec, "av1") == 0) {
+		codec = CAPTION_CODEC_AV1;
 #ifdef ENABLE_HEVC
-	uint8_t hevc_nal_header[2];
-	if (hevc) {
+	} else if (strcmp(out->encoder->info.codec, "hevc") == 0) {
+		codec = CAPTION_CODEC_HEVC;
+#endif
+	}
+
+	struct obs_nal_index *index = NULL;
+	if (obs_nal_index_valid(&out->nal_index, out->size))
+		index = &out->nal_index;
+
+	if (codec == CAPTION_CODEC_HEVC) {
 		size_t nal_header_index_start = 4;
 		// Skip past the annex-b start code
-		if (memcmp(out->data, nal_start + 1, 3) == 0) {
+		if (index && index->num) {
+			nal_header_index_start = index->units[0].offset;
+		} else if (memcmp(out->data, nal_start + 1, 3) == 0) {
 			nal_header_index_start = 3;
 		} else if (memcmp(out->data, nal_start, 4) == 0) {
 			nal_header_index_start = 4;
@@ -1587,156 +1887,277 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 			return false;
 		}
 		/* We will use the same 2 byte NAL unit header for the CC SEI,
-		 * but swap the NAL types out. */
-		hevc_nal_header[0] = out->data[nal_header_index_start];
+		 * but swap the NAL types out.
+		 *
+		 * nal_unit_header( ) {
+		 * forbidden_zero_bit       f(1)
+		 * nal_unit_type            u(6)
+		 * nuh_layer_id             u(6)
+		 * nuh_temporal_id_plus1    u(3)
+		 * }
+		 *
+		 * The first bit is always 0, so we just need to save the last
+		 * bit off the original header and add the SEI NAL type. */
+		const uint8_t prefix_sei_nal_type = 39;
+		hevc_nal_header[0] = (prefix_sei_nal_type << 1) |
+				     (0x01 & out->data[nal_header_index_start]);
 		hevc_nal_header[1] = out->data[nal_header_index_start + 1];
 	}
-#endif
-	sei_init(&sei, 0.0);
 
-	da_init(out_data);
-	da_push_back_array(out_data, (uint8_t *)&ref, sizeof(ref));
-	da_push_back_array(out_data, out->data, out->size);
+	if (send_text && ctrack->caption_head) {
+		struct caption_text *next = ctrack->caption_head->next;
+		text = ctrack->caption_head->payload;
+		bfree(ctrack->caption_head);
+		ctrack->caption_head = next;
+	}
 
-	if (ctrack->caption_data.size > 0) {
+	cc_count = send_cc ? ctrack->caption_data.size / sizeof(payload) : 0;
 
-		cea708_t cea708;
-		cea708_init(&cea708, 0); // set up a new popon frame
-		void *caption_buf = bzalloc(3 * sizeof(uint8_t));
+	/* work out the exact size up front so the packet and all of its
+	 * captions are copied into a single allocation */
+	size = sizeof(ref) + out->size + caption_payload_size(codec, &text);
+	for (size_t i = 0; i < cc_count; i++) {
+		deque_peek_at(&ctrack->caption_data, i * sizeof(payload),
+			      &payload, sizeof(payload));
+		size += caption_payload_size(codec, &payload);
+	}
 
-		while (ctrack->caption_data.size > 0) {
-			deque_pop_front(&ctrack->caption_data, caption_buf,
-					3 * sizeof(uint8_t));
+	struct encoder_packet backup = *out;
+	uint8_t *data = NULL;
+	uint8_t *base = NULL;
+	uint8_t *pos = NULL;
 
-			if ((((uint8_t *)caption_buf)[0] & 0x3) != 0) {
-				// only send cea 608
-				continue;
-			}
+	if (codec != CAPTION_CODEC_NONE) {
+		data = bmalloc(size);
+		memcpy(data, &ref, sizeof(ref));
+		base = data + sizeof(ref);
+		memcpy(base, out->data, out->size);
+		index = index ? &backup.nal_index : NULL;
+		pos = base + out->size;
+		pos = write_caption_payload(pos, base, codec, hevc_nal_header,
+					    &text, index);
+	}
 
-			uint16_t captionData = ((uint8_t *)caption_buf)[1];
-			captionData = captionData << 8;
-			captionData += ((uint8_t *)caption_buf)[2];
+	caption_payload_free(&text);
 
-			// padding
-			if (captionData == 0x8080) {
-				continue;
-			}
+	for (size_t i = 0; i < cc_count; i++) {
+		deque_pop_front(&ctrack->caption_data, &payload,
+				sizeof(payload));
+		if (pos)
+			pos = write_caption_payload(pos, base, codec,
+						    hevc_nal_header, &payload,
+						    index);
+		caption_payload_free(&payload);
+	}
 
-			if (captionData == 0) {
-				continue;
-			}
+	if (!data)
+		return false;
 
-			if (!eia608_parity_varify(captionData)) {
-				continue;
-			}
+	if (index && index->packet_size)
+		index->packet_size = size - sizeof(ref);
+	else
+		obs_nal_index_clear(&backup.nal_index);
 
-			cea708_add_cc_data(&cea708, 1,
-					   ((uint8_t *)caption_buf)[0] & 0x3,
-					   captionData);
-		}
+	obs_encoder_packet_release(out);
 
-		bfree(caption_buf);
+	*out = backup;
+	out->data = base;
+	out->size = size - sizeof(ref);
+	return true;
+}
 
-		sei_message_t *msg =
-			sei_message_new(sei_type_user_data_registered_itu_t_t35,
-					0, CEA608_MAX_SIZE);
-		msg->size = cea708_render(&cea708, sei_message_data(msg),
-					  sei_message_size(msg));
-		sei_message_append(&sei, msg);
-	} else if (ctrack->caption_head) {
-		caption_frame_t cf;
-		caption_frame_init(&cf);
-		caption_frame_from_text(&cf, &ctrack->caption_head->text[0]);
+/* pts_offset is what was subtracted from the encoder's pts */
+static inline void send_encoded_packet(struct obs_output *output,
+				       struct encoder_packet *packet,
+				       int64_t pts_offset)
+{
+	uint64_t start_ns = os_gettime_ns();
 
-		sei_from_caption_frame(&sei, &cf);
+	output->info.encoded_packet(output->context.data, packet);
+	metric_record(output->send_time_metric, os_gettime_ns() - start_ns);
+	obs_latency_output_send(output, packet, pts_offset);
+}
 
-		struct caption_text *next = ctrack->caption_head->next;
-		bfree(ctrack->caption_head);
-		ctrack->caption_head = next;
-	}
+/* a follower joins the leader's stream at the next keyframe, and offsets the
+ * timestamps again so that its own output still starts at 0 */
+static void send_shared_packet(struct obs_output *output,
+			       const struct encoder_packet *in,
+			       int64_t pts_offset)
+{
+	struct encoder_packet out = *in;
+	size_t idx = out.track_idx;
 
-	if (avc || hevc || av1) {
-		if (avc || hevc) {
-			data = bmalloc(sei_render_size(&sei));
-			size = sei_render(&sei, data);
-		}
-		/* In each of these specs there is an identical structure that
-		 * carries caption information. It is named slightly differently
-		 * in each one. The metadata_itut_t35 in AV1 or the
-		 * user_data_registered_itu_t_t35 in HEVC/AVC. We have an AVC
-		 * SEI wrapped version of that here. We will strip it out and
-		 * repackage it slightly to fit the different codec carrying
-		 * mechanisms. A slightly modified SEI for HEVC and a metadata
-		 * OBU for AV1. */
-		if (avc) {
-			/* TODO: SEI should come after AUD/SPS/PPS,
-			 * but before any VCL */
-			da_push_back_array(out_data, nal_start, 4);
-			da_push_back_array(out_data, data, size);
-#ifdef ENABLE_HEVC
-		} else if (hevc) {
-			/* Only first NAL (VPS/PPS/SPS) should use the 4 byte
-			 * start code. SEIs use 3 byte version */
-			da_push_back_array(out_data, nal_start + 1, 3);
-			/* nal_unit_header( ) {
-			 * forbidden_zero_bit       f(1)
-			 * nal_unit_type            u(6)
-			 * nuh_layer_id             u(6)
-			 * nuh_temporal_id_plus1    u(3)
-			 * }
-			 */
-			const uint8_t prefix_sei_nal_type = 39;
-			/* The first bit is always 0, so we just need to
-			 * save the last bit off the original header and
-			 * add the SEI NAL type. */
-			uint8_t first_byte = (prefix_sei_nal_type << 1) |
-					     (0x01 & hevc_nal_header[0]);
-			hevc_nal_header[0] = first_byte;
-			/* The HEVC NAL unit header is 2 byte instead of
-			 * one, otherwise everything else is the
-			 * same. */
-			da_push_back_array(out_data, hevc_nal_header, 2);
-			da_push_back_array(out_data, &data[1], size - 1);
-#endif
-		} else if (av1) {
-			uint8_t *obu_buffer = NULL;
-			size_t obu_buffer_size = 0;
-			size = extract_itut_t35_buffer_from_sei(&sei, &data);
-			metadata_obu_itu_t35(data, size, &obu_buffer,
-					     &obu_buffer_size);
-			if (obu_buffer) {
-				da_push_back_array(out_data, obu_buffer,
-						   obu_buffer_size);
-				bfree(obu_buffer);
-			}
+	if (!data_active(output))
+		return;
+
+	if (out.type == OBS_ENCODER_VIDEO) {
+		if (!output->received_video[idx]) {
+			if (!out.keyframe || (idx && !output->received_video[0]))
+				return;
+
+			output->received_video[idx] = true;
+			output->video_offsets[idx] = out.dts;
 		}
-		if (data) {
-			bfree(data);
+
+		out.dts -= output->video_offsets[idx];
+		out.pts -= output->video_offsets[idx];
+		pts_offset += output->video_offsets[idx];
+		output->total_frames++;
+	} else {
+		if (!output->received_video[0])
+			return;
+
+		if (!output->shared_audio_started[idx]) {
+			output->shared_audio_started[idx] = true;
+			output->audio_offsets[idx] = out.dts;
 		}
-		obs_encoder_packet_release(out);
 
-		*out = backup;
-		out->data = (uint8_t *)out_data.array + sizeof(ref);
-		out->size = out_data.num - sizeof(ref);
+		out.dts -= output->audio_offsets[idx];
+		out.pts -= output->audio_offsets[idx];
 	}
-	sei_free(&sei);
-	return avc || hevc || av1;
+
+	out.dts_usec = packet_dts_usec(&out);
+	send_encoded_packet(output, &out, pts_offset);
+}
+
+/* interleaving order: by dts, video before audio at the same dts, and video
+ * tracks with the same dts by track index to prevent the pruning logic from
+ * removing additional video tracks */
+static inline bool interleaved_packet_before(const struct encoder_packet *a,
+					     const struct encoder_packet *b)
+{
+	if (a->dts_usec != b->dts_usec)
+		return a->dts_usec < b->dts_usec;
+	if (a->type != b->type)
+		return a->type == OBS_ENCODER_VIDEO;
+	return a->track_idx < b->track_idx;
+}
+
+static inline bool interleave_heap_less(struct obs_output *output, size_t a,
+					size_t b)
+{
+	return interleaved_packet_before(
+		interleave_queue_front(output->interleave_heap[a]),
+		interleave_queue_front(output->interleave_heap[b]));
+}
+
+static inline void interleave_heap_swap(struct obs_output *output, size_t a,
+					size_t b)
+{
+	struct interleave_queue *q = output->interleave_heap[a];
+	output->interleave_heap[a] = output->interleave_heap[b];
+	output->interleave_heap[b] = q;
+}
+
+static void interleave_heap_sift_up(struct obs_output *output, size_t idx)
+{
+	while (idx) {
+		size_t parent = (idx - 1) / 2;
+		if (!interleave_heap_less(output, idx, parent))
+			break;
+
+		interleave_heap_swap(output, idx, parent);
+		idx = parent;
+	}
+}
+
+static void interleave_heap_sift_down(struct obs_output *output, size_t idx)
+{
+	size_t size = output->interleave_heap_size;
+
+	for (;;) {
+		size_t left = idx * 2 + 1;
+		size_t right = left + 1;
+		size_t min = idx;
+
+		if (left < size && interleave_heap_less(output, left, min))
+			min = left;
+		if (right < size && interleave_heap_less(output, right, min))
+			min = right;
+		if (min == idx)
+			break;
+
+		interleave_heap_swap(output, idx, min);
+		idx = min;
+	}
+}
+
+static inline struct interleave_queue *
+get_interleave_queue(struct obs_output *output, enum obs_encoder_type type,
+		     size_t track_idx)
+{
+	if (type == OBS_ENCODER_VIDEO)
+		return &output->interleaved_video[track_idx];
+	return &output->interleaved_audio[track_idx];
+}
+
+/* video queues first, then audio queues */
+static inline struct interleave_queue *
+get_interleave_queue_at(struct obs_output *output, size_t idx)
+{
+	return idx < MAX_OUTPUT_VIDEO_ENCODERS
+		       ? &output->interleaved_video[idx]
+		       : &output->interleaved_audio[idx -
+						    MAX_OUTPUT_VIDEO_ENCODERS];
+}
+
+/* rebuilds the heap from scratch, used after packets have been discarded
+ * from or retimed in arbitrary queues */
+static void rebuild_interleave_heap(struct obs_output *output)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < MAX_INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *q = get_interleave_queue_at(output, i);
+		if (!interleave_queue_empty(q))
+			output->interleave_heap[size++] = q;
+	}
+
+	output->interleave_heap_size = size;
+	for (size_t i = size / 2; i > 0; i--)
+		interleave_heap_sift_down(output, i - 1);
+}
+
+static inline struct encoder_packet *
+first_interleaved_packet(struct obs_output *output)
+{
+	return output->interleave_heap_size
+		       ? interleave_queue_front(output->interleave_heap[0])
+		       : NULL;
+}
+
+static void pop_interleaved_packet(struct obs_output *output,
+				   struct encoder_packet *out)
+{
+	struct interleave_queue *q = output->interleave_heap[0];
+
+	interleave_queue_pop(q, out);
+	output->interleaved_count--;
+
+	if (interleave_queue_empty(q))
+		output->interleave_heap[0] =
+			output->interleave_heap[--output->interleave_heap_size];
+	if (output->interleave_heap_size)
+		interleave_heap_sift_down(output, 0);
 }
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet *first = first_interleaved_packet(output);
+	struct encoder_packet out;
+	int64_t pts_offset = 0;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
 	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
+	if (!first || !has_higher_opposing_ts(output, first))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	pop_interleaved_packet(output, &out);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
+		pts_offset = output->video_offsets[out.track_idx];
 
 		pthread_mutex_lock(
 			&output->caption_tracks[out.track_idx]->caption_mutex);
@@ -1747,31 +2168,36 @@ static inline void send_interleaved(struct obs_output *output)
 		struct caption_track_data *ctrack =
 			output->caption_tracks[out.track_idx];
 
-		if (ctrack->caption_head &&
-		    ctrack->caption_timestamp <= frame_timestamp) {
+		bool send_text = ctrack->caption_head &&
+				 ctrack->caption_timestamp <= frame_timestamp;
+		bool send_cc = ctrack->caption_data.size > 0 &&
+			       ctrack->last_caption_timestamp < frame_timestamp;
+		double display_duration = 0.0;
+
+		if (send_text) {
 			blog(LOG_DEBUG, "Sending caption: %f \"%s\"",
 			     frame_timestamp, &ctrack->caption_head->text[0]);
-
-			double display_duration =
+			display_duration =
 				ctrack->caption_head->display_duration;
-
-			if (add_caption(output, &out)) {
-				ctrack->caption_timestamp =
-					frame_timestamp + display_duration;
-			}
 		}
+		if (send_cc)
+			ctrack->last_caption_timestamp = frame_timestamp;
 
-		if (ctrack->caption_data.size > 0) {
-			if (ctrack->last_caption_timestamp < frame_timestamp) {
-				ctrack->last_caption_timestamp =
-					frame_timestamp;
-				add_caption(output, &out);
-			}
+		if ((send_text || send_cc) &&
+		    add_caption(output, &out, send_text, send_cc) &&
+		    send_text) {
+			ctrack->caption_timestamp =
+				frame_timestamp + display_duration;
 		}
 		pthread_mutex_unlock(&ctrack->caption_mutex);
 	}
 
-	output->info.encoded_packet(output->context.data, &out);
+	send_encoded_packet(output, &out, pts_offset);
+
+	for (size_t i = 0; i < output->followers.num; i++)
+		send_shared_packet(output->followers.array[i], &out,
+				   pts_offset);
+
 	obs_encoder_packet_release(&out);
 }
 
@@ -1791,39 +2217,53 @@ static inline void set_higher_ts(struct obs_output *output,
 
 static inline struct encoder_packet *
 find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		       size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-				      enum obs_encoder_type type,
-				      size_t audio_idx);
+		       size_t idx)
+{
+	return interleave_queue_front(get_interleave_queue(output, type, idx));
+}
+
+static inline struct encoder_packet *
+find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
+		      size_t idx)
+{
+	return interleave_queue_back(get_interleave_queue(output, type, idx));
+}
 
-/* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
+/* gets the point where audio and video are closest together, or NULL if
+ * nothing needs to be discarded */
+static struct encoder_packet *
+get_interleaved_start_packet(struct obs_output *output)
 {
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
 	struct encoder_packet *first_video =
 		find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
-
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
+	struct encoder_packet *closest = NULL;
 
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
+	if (!first_video)
+		return NULL;
 
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		struct interleave_queue *q = &output->interleaved_audio[i];
+
+		for (size_t j = q->head; j < q->packets.num; j++) {
+			struct encoder_packet *packet = q->packets.array + j;
+			int64_t diff =
+				llabs(packet->dts_usec - first_video->dts_usec);
+
+			if (diff < closest_diff ||
+			    (diff == closest_diff &&
+			     interleaved_packet_before(packet, closest))) {
+				closest_diff = diff;
+				closest = packet;
+			}
 		}
 	}
 
-	return video_idx < idx ? video_idx : idx;
+	if (!closest)
+		return NULL;
+
+	return interleaved_packet_before(first_video, closest) ? first_video
+							       : closest;
 }
 
 static int64_t get_encoder_duration(struct obs_encoder *encoder)
@@ -1832,43 +2272,41 @@ static int64_t get_encoder_duration(struct obs_encoder *encoder)
 	       encoder->framesize;
 }
 
-static int prune_premature_packets(struct obs_output *output)
+/* returns -1 if a track has no packets yet, 1 if everything up to and
+ * including *last should be pruned, and 0 otherwise */
+static int prune_premature_packets(struct obs_output *output,
+				   struct encoder_packet **last)
 {
 	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
+	struct encoder_packet *latest;
 	int64_t duration_usec, max_audio_duration_usec = 0;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 	int audio_encoders = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1)
+	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	if (!video)
 		return -1;
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	latest = video;
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 		struct encoder_packet *audio;
-		int audio_idx;
 		int64_t audio_duration_usec = 0;
 
 		if (!output->audio_encoders[i])
 			continue;
 		audio_encoders++;
 
-		audio_idx = find_first_packet_type_idx(output,
-						       OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		audio = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
+		if (interleaved_packet_before(latest, audio))
+			latest = audio;
 
 		diff = audio->dts_usec - video->dts_usec;
 		if (diff > max_diff)
@@ -1890,97 +2328,81 @@ static int prune_premature_packets(struct obs_output *output)
 		duration_usec = max_audio_duration_usec;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
+	if (diff > duration_usec) {
+		*last = latest;
+		return 1;
+	}
+
+	return 0;
 }
 
-static void discard_to_idx(struct obs_output *output, size_t idx)
+/* discards every packet that is interleaved before the given packet (and
+ * the packet itself if inclusive is set) */
+static void discard_interleaved_packets(struct obs_output *output,
+					const struct encoder_packet *packet,
+					bool inclusive)
 {
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_encoder_packet_release(packet);
+	/* the packet may live in one of the queues being popped */
+	struct encoder_packet boundary = *packet;
+
+	for (size_t i = 0; i < MAX_INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *q = get_interleave_queue_at(output, i);
+		struct encoder_packet *front;
+
+		while ((front = interleave_queue_front(q)) != NULL) {
+			struct encoder_packet discarded;
+
+			if (!interleaved_packet_before(front, &boundary) &&
+			    (!inclusive ||
+			     interleaved_packet_before(&boundary, front)))
+				break;
+
+			interleave_queue_pop(q, &discarded);
+			obs_encoder_packet_release(&discarded);
+			output->interleaved_count--;
+		}
 	}
 
-	da_erase_range(output->interleaved_packets, 0, idx);
+	rebuild_interleave_heap(output);
 }
 
 #define DEBUG_STARTING_PACKETS 0
 
 static bool prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
+	struct encoder_packet *start = NULL;
+	int prune = prune_premature_packets(output, &start);
 
 #if DEBUG_STARTING_PACKETS == 1
-	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video",
-		     (int)packet->track_idx, packet->dts_usec,
-		     (int)i < prune_start ? "true" : "false");
+	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune);
+	for (size_t i = 0; i < MAX_INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *q = get_interleave_queue_at(output, i);
+
+		for (size_t j = q->head; j < q->packets.num; j++) {
+			struct encoder_packet *packet = q->packets.array + j;
+			bool pruned = prune == 1 &&
+				      !interleaved_packet_before(start, packet);
+
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
+			     packet->type == OBS_ENCODER_AUDIO ? "audio"
+							       : "video",
+			     (int)packet->track_idx, packet->dts_usec,
+			     pruned ? "true" : "false");
+		}
 	}
 #endif
 
 	/* prunes the first video packet if it's too far away from audio */
-	if (prune_start == -1)
+	if (prune == -1)
 		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
-	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
+	else if (prune == 1)
+		discard_interleaved_packets(output, start, true);
+	else if ((start = get_interleaved_start_packet(output)) != NULL)
+		discard_interleaved_packets(output, start, false);
 
 	return true;
 }
 
-static int find_first_packet_type_idx(struct obs_output *output,
-				      enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)i;
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-				     enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)(i - 1);
-	}
-
-	return -1;
-}
-
-static inline struct encoder_packet *
-find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		       size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *
-find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		      size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
 static bool get_audio_and_video_packets(struct obs_output *output,
 					struct encoder_packet **video,
 					struct encoder_packet **audio)
@@ -2018,7 +2440,7 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	struct encoder_packet *video[MAX_OUTPUT_VIDEO_ENCODERS] = {0};
 	struct encoder_packet *audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
 	struct encoder_packet *last_audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
-	size_t start_idx;
+	struct encoder_packet *start;
 	size_t first_audio_idx;
 	size_t first_video_idx;
 
@@ -2049,9 +2471,9 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	}
 
 	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
+	start = get_interleaved_start_packet(output);
+	if (start) {
+		discard_interleaved_packets(output, start, false);
 		if (!get_audio_and_video_packets(output, video, audio))
 			return false;
 	}
@@ -2082,75 +2504,72 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_audio_ts -= audio[first_audio_idx]->dts_usec;
 
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
+	for (size_t i = 0; i < MAX_INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *q = get_interleave_queue_at(output, i);
+
+		for (size_t j = q->head; j < q->packets.num; j++)
+			apply_interleaved_packet_offset(output,
+							q->packets.array + j);
 	}
 
 	return true;
 }
 
+/* encoders emit packets in decode order, so the packets of a single track
+ * are already sorted and only the heads of the track queues need merging */
 static inline void insert_interleaved_packet(struct obs_output *output,
 					     struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		// sort video packets with same DTS by track index,
-		// to prevent the pruning logic from removing additional
-		// video tracks
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO &&
-		    cur_packet->type == OBS_ENCODER_VIDEO &&
-		    out->track_idx > cur_packet->track_idx)
-			continue;
+	struct interleave_queue *q =
+		get_interleave_queue(output, out->type, out->track_idx);
+	bool was_empty = interleave_queue_empty(q);
 
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
-	}
+	da_push_back(q->packets, out);
+	output->interleaved_count++;
 
-	da_insert(output->interleaved_packets, idx, out);
+	if (was_empty) {
+		size_t idx = output->interleave_heap_size++;
+		output->interleave_heap[idx] = q;
+		interleave_heap_sift_up(output, idx);
+	}
 }
 
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
+	/* the last packet of each track has its highest timestamp */
+	for (size_t i = 0; i < MAX_INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *q = get_interleave_queue_at(output, i);
+		struct encoder_packet *last = interleave_queue_back(q);
 
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-	       sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++) {
-		set_higher_ts(output, &old_array.array[i]);
-
-		insert_interleaved_packet(output, &old_array.array[i]);
+		if (last)
+			set_higher_ts(output, last);
 	}
 
-	da_free(old_array);
+	rebuild_interleave_heap(output);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output,
 					 int64_t dts_usec)
 {
-	size_t idx = 0;
+	bool discarded = false;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
+	for (size_t i = 0; i < MAX_INTERLEAVE_QUEUES; i++) {
+		struct interleave_queue *q = get_interleave_queue_at(output, i);
+		struct encoder_packet *front;
 
-		if (p->dts_usec >= dts_usec)
-			break;
+		while ((front = interleave_queue_front(q)) != NULL &&
+		       front->dts_usec < dts_usec) {
+			struct encoder_packet packet;
+
+			interleave_queue_pop(q, &packet);
+			obs_encoder_packet_release(&packet);
+			output->interleaved_count--;
+			discarded = true;
+		}
 	}
 
-	if (idx)
-		discard_to_idx(output, idx);
+	if (discarded)
+		rebuild_interleave_heap(output);
 }
 
 static bool purge_encoder_group_keyframe_data(obs_output_t *output, size_t idx)
@@ -2244,13 +2663,13 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 
 	packet->track_idx = get_encoder_index(output, packet);
 
-	pthread_mutex_lock(&output->interleaved_mutex);
+	os_mutex_lock(&output->interleaved_mutex);
 
 	/* if first video frame is not a keyframe, discard until received */
 	if (packet->type == OBS_ENCODER_VIDEO &&
 	    !output->received_video[packet->track_idx] && !packet->keyframe) {
 		discard_unused_audio_packets(output, packet->dts_usec);
-		pthread_mutex_unlock(&output->interleaved_mutex);
+		os_mutex_unlock(&output->interleaved_mutex);
 
 		if (output->active_delay_ns)
 			obs_encoder_packet_release(packet);
@@ -2304,7 +2723,9 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	pthread_mutex_unlock(&output->interleaved_mutex);
+	metric_set(output->interleave_depth_metric,
+		   (int64_t)output->interleaved_count);
+	os_mutex_unlock(&output->interleaved_mutex);
 }
 
 static void default_encoded_callback(void *param, struct encoder_packet *packet)
@@ -2314,7 +2735,7 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet)
 	if (data_active(output)) {
 		packet->track_idx = get_encoder_index(output, packet);
 
-		output->info.encoded_packet(output->context.data, packet);
+		send_encoded_packet(output, packet, 0);
 
 		if (packet->type == OBS_ENCODER_VIDEO)
 			output->total_frames++;
@@ -2496,6 +2917,95 @@ static inline bool preserve_active(struct obs_output *output)
 	return (output->delay_flags & OBS_OUTPUT_DELAY_PRESERVE) != 0;
 }
 
+static bool can_follow(const struct obs_output *output,
+		       const struct obs_output *leader)
+{
+	if (output->delay_sec || leader->active_delay_ns)
+		return false;
+	if (!flag_video(leader) || !flag_audio(leader) ||
+	    !flag_encoded(leader))
+		return false;
+
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (output->video_encoders[i] != leader->video_encoders[i])
+			return false;
+	}
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (output->audio_encoders[i] != leader->audio_encoders[i])
+			return false;
+	}
+
+	return true;
+}
+
+static bool follow_leader(struct obs_output *output)
+{
+	obs_output_t *leader =
+		obs_weak_output_get_output(output->interleave_leader);
+	bool success = false;
+
+	if (!leader)
+		return false;
+
+	os_mutex_lock(&leader->interleaved_mutex);
+	if (data_active(leader) && can_follow(output, leader)) {
+		memset(output->shared_audio_started, 0,
+		       sizeof(output->shared_audio_started));
+		da_push_back(leader->followers, &output);
+		success = true;
+	}
+	os_mutex_unlock(&leader->interleaved_mutex);
+
+	if (success) {
+		output->following = leader;
+		blog(LOG_INFO, "Output '%s': using interleaved packets of '%s'",
+		     output->context.name, leader->context.name);
+	} else {
+		blog(LOG_INFO,
+		     "Output '%s': cannot follow '%s', it is inactive or "
+		     "uses different encoders",
+		     output->context.name, leader->context.name);
+		obs_output_release(leader);
+	}
+
+	return success;
+}
+
+static void unfollow_leader(struct obs_output *output)
+{
+	obs_output_t *leader = output->following;
+
+	os_mutex_lock(&leader->interleaved_mutex);
+	da_erase_item(leader->followers, &output);
+	os_mutex_unlock(&leader->interleaved_mutex);
+
+	output->following = NULL;
+	obs_output_release(leader);
+}
+
+/* the followers would no longer receive anything, so stop them too */
+static void stop_followers(struct obs_output *output)
+{
+	DARRAY(struct obs_output *) followers;
+	da_init(followers);
+
+	os_mutex_lock(&output->interleaved_mutex);
+	for (size_t i = 0; i < output->followers.num; i++) {
+		obs_output_t *follower =
+			obs_output_get_ref(output->followers.array[i]);
+		if (follower)
+			da_push_back(followers, &follower);
+	}
+	da_resize(output->followers, 0);
+	os_mutex_unlock(&output->interleaved_mutex);
+
+	for (size_t i = 0; i < followers.num; i++) {
+		obs_output_force_stop(followers.array[i]);
+		obs_output_release(followers.array[i]);
+	}
+	da_free(followers);
+}
+
 static void hook_data_capture(struct obs_output *output)
 {
 	encoded_callback_t encoded_callback;
@@ -2503,9 +3013,13 @@ static void hook_data_capture(struct obs_output *output)
 	bool has_audio = flag_audio(output);
 
 	if (flag_encoded(output)) {
-		pthread_mutex_lock(&output->interleaved_mutex);
+		os_mutex_lock(&output->interleaved_mutex);
 		reset_packet_data(output);
-		pthread_mutex_unlock(&output->interleaved_mutex);
+		os_mutex_unlock(&output->interleaved_mutex);
+
+		if (has_video && has_audio && output->interleave_leader &&
+		    follow_leader(output))
+			return;
 
 		encoded_callback = (has_video && has_audio)
 					   ? interleave_packets
@@ -2531,7 +3045,7 @@ static void hook_data_capture(struct obs_output *output)
 		if (has_video)
 			start_video_encoders(output, encoded_callback);
 	} else {
-		if (has_video)
+		if (has_video && !output->raw_video_disabled)
 			start_raw_video(output->video,
 					obs_output_get_video_conversion(output),
 					1, default_raw_video_callback, output);
@@ -2678,10 +3192,10 @@ static bool begin_delayed_capture(obs_output_t *output)
 	if (delay_capturing(output))
 		return false;
 
-	pthread_mutex_lock(&output->interleaved_mutex);
+	os_mutex_lock(&output->interleaved_mutex);
 	reset_packet_data(output);
 	os_atomic_set_bool(&output->delay_capturing, true);
-	pthread_mutex_unlock(&output->interleaved_mutex);
+	os_mutex_unlock(&output->interleaved_mutex);
 
 	if (reconnecting(output)) {
 		signal_reconnect_success(output);
@@ -2818,7 +3332,9 @@ static void *end_data_capture_thread(void *data)
 	bool has_video = flag_video(output);
 	bool has_audio = flag_audio(output);
 
-	if (flag_encoded(output)) {
+	if (output->following) {
+		unfollow_leader(output);
+	} else if (flag_encoded(output)) {
 		if (output->active_delay_ns)
 			encoded_callback = process_delay;
 		else
@@ -2830,8 +3346,10 @@ static void *end_data_capture_thread(void *data)
 			stop_video_encoders(output, encoded_callback);
 		if (has_audio)
 			stop_audio_encoders(output, encoded_callback);
+
+		stop_followers(output);
 	} else {
-		if (has_video)
+		if (has_video && !output->raw_video_disabled)
 			stop_raw_video(output->video,
 				       default_raw_video_callback, output);
 		if (has_audio)
@@ -3099,30 +3617,46 @@ const char *obs_output_get_id(const obs_output_t *output)
 void obs_output_caption(obs_output_t *output,
 			const struct obs_source_cea_708 *captions)
 {
+	struct caption_payload rendered = {0};
+	bool rendered_valid = false;
+
 	for (int i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
 		struct caption_track_data *ctrack = output->caption_tracks[i];
+		struct caption_payload payload;
+
 		if (!ctrack) {
 			continue;
 		}
-		pthread_mutex_lock(&ctrack->caption_mutex);
-		for (size_t i = 0; i < captions->packets; i++) {
-			deque_push_back(&ctrack->caption_data,
-					captions->data + (i * 3),
-					3 * sizeof(uint8_t));
+
+		/* render once on the caller's thread rather than for every
+		 * track while interleaving */
+		if (!rendered_valid) {
+			if (!caption_payload_from_cea708(&rendered, captions))
+				break;
+			rendered_valid = true;
 		}
+
+		caption_payload_copy(&payload, &rendered);
+
+		pthread_mutex_lock(&ctrack->caption_mutex);
+		deque_push_back(&ctrack->caption_data, &payload,
+				sizeof(payload));
 		pthread_mutex_unlock(&ctrack->caption_mutex);
 	}
+
+	caption_payload_free(&rendered);
 }
 
-static struct caption_text *caption_text_new(const char *text, size_t bytes,
-					     struct caption_text *tail,
-					     struct caption_text **head,
-					     double display_duration)
+static struct caption_text *
+caption_text_new(const char *text, size_t bytes, struct caption_text *tail,
+		 struct caption_text **head, double display_duration,
+		 const struct caption_payload *payload)
 {
 	struct caption_text *next = bzalloc(sizeof(struct caption_text));
 	snprintf(&next->text[0], CAPTION_LINE_BYTES + 1, "%.*s", (int)bytes,
 		 text);
 	next->display_duration = display_duration;
+	caption_payload_copy(&next->payload, payload);
 
 	if (!*head) {
 		*head = next;
@@ -3150,6 +3684,9 @@ void obs_output_output_caption_text2(obs_output_t *output, const char *text,
 
 	// split text into 32 character strings
 	int size = (int)strlen(text);
+	struct caption_payload payload = {0};
+	bool rendered = false;
+
 	blog(LOG_DEBUG, "Caption text: %s", text);
 
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
@@ -3157,15 +3694,25 @@ void obs_output_output_caption_text2(obs_output_t *output, const char *text,
 		if (!ctrack) {
 			continue;
 		}
+
+		/* render the caption frame once, not once per track */
+		if (!rendered) {
+			char line[CAPTION_LINE_BYTES + 1];
+			snprintf(line, sizeof(line), "%.*s", size, text);
+			caption_payload_from_text(&payload, line);
+			rendered = true;
+		}
+
 		pthread_mutex_lock(&ctrack->caption_mutex);
 
-		ctrack->caption_tail = caption_text_new(text, size,
-							ctrack->caption_tail,
-							&ctrack->caption_head,
-							display_duration);
+		ctrack->caption_tail = caption_text_new(
+			text, size, ctrack->caption_tail, &ctrack->caption_head,
+			display_duration, &payload);
 
 		pthread_mutex_unlock(&ctrack->caption_mutex);
 	}
+
+	caption_payload_free(&payload);
 }
 
 float obs_output_get_congestion(obs_output_t *output)
@@ -0,0 +1,212 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-packet-drop.h"
+#include "obs-nal.h"
+#include "obs.h"
+
+struct drop_queue {
+	struct encoder_packet *packets;
+	bool *drop;
+	size_t count;
+
+	uint64_t needed;
+	uint64_t dropped;
+	int min_priority;
+};
+
+static inline bool droppable(const struct drop_queue *q, size_t i)
+{
+	const struct encoder_packet *packet = q->packets + i;
+	return !q->drop[i] && packet->type == OBS_ENCODER_VIDEO &&
+	       !packet->keyframe;
+}
+
+static inline void mark_dropped(struct drop_queue *q, size_t i)
+{
+	q->drop[i] = true;
+	q->dropped += q->packets[i].size;
+}
+
+/* nothing references these, so any subset of them can go */
+static void drop_disposable(struct drop_queue *q)
+{
+	for (size_t i = 0; i < q->count && q->dropped < q->needed; i++) {
+		if (droppable(q, i) &&
+		    q->packets[i].drop_priority < OBS_NAL_PRIORITY_LOW)
+			mark_dropped(q, i);
+	}
+}
+
+/* frames of a priority level may reference each other, so a level is only
+ * ever dropped as a whole */
+static void drop_below(struct drop_queue *q, int priority)
+{
+	for (size_t i = 0; i < q->count; i++) {
+		if (droppable(q, i) && q->packets[i].drop_priority < priority)
+			mark_dropped(q, i);
+	}
+
+	if (q->min_priority < priority)
+		q->min_priority = priority;
+}
+
+static inline bool is_keyframe(const struct drop_queue *q, size_t i)
+{
+	const struct encoder_packet *packet = q->packets + i;
+	return packet->type == OBS_ENCODER_VIDEO && packet->keyframe;
+}
+
+static uint64_t gop_droppable_bytes(const struct drop_queue *q, size_t start,
+				    size_t end)
+{
+	uint64_t bytes = 0;
+	for (size_t i = start; i < end; i++) {
+		if (droppable(q, i))
+			bytes += q->packets[i].size;
+	}
+	return bytes;
+}
+
+/* Every frame of a GOP after a given point in decode order only references
+ * frames before it or each other, so cutting off the end of a GOP always
+ * leaves a decodable stream.  The GOP after the last keyframe is still being
+ * encoded and is left alone, cutting it would mean dropping new frames until
+ * the next keyframe. */
+static void drop_gop_tails(struct drop_queue *q)
+{
+	uint64_t total = 0;
+	size_t last_key = q->count;
+	size_t start = 0;
+
+	for (size_t i = 0; i < q->count; i++) {
+		if (!is_keyframe(q, i))
+			continue;
+		total += gop_droppable_bytes(q, start, i);
+		last_key = i;
+		start = i;
+	}
+
+	if (!total || last_key == q->count)
+		return;
+
+	double ratio = (double)(q->needed - q->dropped) / (double)total;
+	if (ratio > 1.0)
+		ratio = 1.0;
+
+	start = 0;
+	for (size_t i = 0; i <= last_key; i++) {
+		if (!is_keyframe(q, i))
+			continue;
+
+		uint64_t gop_bytes = gop_droppable_bytes(q, start, i);
+		uint64_t cut = (uint64_t)((double)gop_bytes * ratio + 0.5);
+		uint64_t gop_dropped = 0;
+
+		for (size_t j = i; j > start && gop_dropped < cut; j--) {
+			if (!droppable(q, j - 1))
+				continue;
+			gop_dropped += q->packets[j - 1].size;
+			mark_dropped(q, j - 1);
+		}
+
+		start = i;
+	}
+}
+
+size_t obs_packet_queue_drop(struct deque *packets, int64_t duration_usec,
+			     int64_t target_usec, bool ref_frames,
+			     int *min_priority)
+{
+	const size_t size = sizeof(struct encoder_packet);
+	struct drop_queue q = {0};
+	uint64_t total = 0;
+	size_t num_dropped = 0;
+
+	q.count = packets->size / size;
+	if (!q.count || duration_usec <= 0 || duration_usec <= target_usec)
+		return 0;
+	if (target_usec < 0)
+		target_usec = 0;
+
+	q.packets = bmalloc(q.count * size);
+	q.drop = bzalloc(q.count * sizeof(bool));
+	deque_pop_front(packets, q.packets, q.count * size);
+
+	for (size_t i = 0; i < q.count; i++)
+		total += q.packets[i].size;
+
+	/* the queue drains at a roughly constant rate, so the share of bytes
+	 * to drop is the share of time it is over the target */
+	q.needed = (uint64_t)((double)total *
+			      (double)(duration_usec - target_usec) /
+			      (double)duration_usec);
+
+	drop_disposable(&q);
+	if (q.dropped < q.needed)
+		drop_below(&q, OBS_NAL_PRIORITY_HIGH);
+	if (ref_frames && q.dropped < q.needed)
+		drop_gop_tails(&q);
+	if (ref_frames && q.dropped < q.needed)
+		drop_below(&q, OBS_NAL_PRIORITY_HIGHEST);
+
+	for (size_t i = 0; i < q.count; i++) {
+		if (q.drop[i]) {
+			obs_encoder_packet_release(q.packets + i);
+			num_dropped++;
+		} else {
+			deque_push_back(packets, q.packets + i, size);
+		}
+	}
+
+	if (*min_priority < q.min_priority)
+		*min_priority = q.min_priority;
+
+	bfree(q.packets);
+	bfree(q.drop);
+	return num_dropped;
+}
+
+bool obs_packet_queue_first_video(struct deque *packets,
+				  struct encoder_packet *first)
+{
+	size_t count = packets->size / sizeof(*first);
+
+	for (size_t i = 0; i < count; i++) {
+		struct encoder_packet *cur =
+			deque_data(packets, i * sizeof(*first));
+		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
+			*first = *cur;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool obs_packet_queue_drop_held(int64_t first_dts_usec, int64_t last_dts_usec,
+				int64_t hold_dts_usec, int64_t threshold_usec)
+{
+	int64_t buffer_duration_usec = last_dts_usec - first_dts_usec;
+
+	if (first_dts_usec > hold_dts_usec)
+		return false;
+	if (buffer_duration_usec > threshold_usec + threshold_usec / 2)
+		return false;
+
+	return last_dts_usec - hold_dts_usec <= threshold_usec;
+}
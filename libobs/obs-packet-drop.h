@@ -0,0 +1,79 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/c99defs.h"
+#include "util/deque.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct encoder_packet;
+
+/*
+ * Frame dropping for network outputs that buffer encoder packets in a deque
+ * of struct encoder_packet while waiting for them to be sent.
+ *
+ * Instead of throwing away every buffered frame up to the next keyframe, only
+ * as much video is dropped as is needed to bring the queue back to the
+ * target duration.  Frames are dropped cheapest first:
+ *
+ *   1. disposable (non-reference) frames, oldest first
+ *   2. low priority frames such as temporal enhancement layers, as a whole
+ *   3. if ref_frames is set, the tail of each complete GOP in the queue, so
+ *      the loss is spread over several short freezes instead of one long one
+ *   4. if ref_frames is set and that was still not enough, every frame that
+ *      is not a keyframe, which was the previous behavior
+ *
+ * Audio packets are never dropped.  *min_priority is raised to the priority
+ * new video packets need before they can be queued again, and should be reset
+ * by the caller once such a packet arrives.
+ *
+ * Returns the number of video frames dropped.
+ */
+EXPORT size_t obs_packet_queue_drop(struct deque *packets,
+				    int64_t duration_usec, int64_t target_usec,
+				    bool ref_frames, int *min_priority);
+
+/*
+ * Copies the first video packet in the queue that is not a keyframe to
+ * *first.  Its timestamp is where the buffered duration is measured from.
+ *
+ * Returns false if there is no such packet.
+ */
+EXPORT bool obs_packet_queue_first_video(struct deque *packets,
+					 struct encoder_packet *first);
+
+/*
+ * The buffered duration only shrinks once the packets that were queued before
+ * a drop have been sent, so after dropping at hold_dts_usec an output should
+ * wait for that before dropping again.  The wait ends early if the link is so
+ * slow that the buffer keeps growing well past the threshold, or if it takes
+ * longer than the threshold itself.
+ *
+ * Returns true while dropping should still wait.
+ */
+EXPORT bool obs_packet_queue_drop_held(int64_t first_dts_usec,
+				       int64_t last_dts_usec,
+				       int64_t hold_dts_usec,
+				       int64_t threshold_usec);
+
+#ifdef __cplusplus
+}
+#endif
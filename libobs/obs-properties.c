@@ -65,6 +65,14 @@ struct list_data {
 	DARRAY(struct list_item) items;
 	enum obs_combo_type type;
 	enum obs_combo_format format;
+	obs_property_list_populate_t populate;
+	bool populating;
+};
+
+struct obs_property_list_job {
+	obs_property_list_populate_t populate;
+	void *data;
+	struct obs_property *staging;
 };
 
 struct editable_list_data {
@@ -1324,6 +1332,93 @@ bool obs_property_list_item_bool(obs_property_t *p, size_t idx)
 					       : false;
 }
 
+void obs_property_list_set_populate_callback(
+	obs_property_t *p, obs_property_list_populate_t populate)
+{
+	struct list_data *data = get_list_data(p);
+	if (!data)
+		return;
+
+	data->populate = populate;
+	data->populating = !!populate;
+}
+
+bool obs_property_list_populating(obs_property_t *p)
+{
+	struct list_data *data = get_list_data(p);
+	return data ? data->populating : false;
+}
+
+obs_property_list_job_t *obs_property_list_populate_begin(obs_property_t *p,
+							  void *obj)
+{
+	struct obs_context_data *context = obj;
+	struct list_data *data = get_list_data(p);
+	struct list_data *staging_data;
+	struct obs_property_list_job *job;
+
+	if (!data || !data->populating || !data->populate)
+		return NULL;
+
+	job = bzalloc(sizeof(*job));
+	job->populate = data->populate;
+	job->data = p->priv ? p->priv : (context ? context->data : NULL);
+
+	/* the callback fills a detached copy of the list so the original
+	 * can keep being read while the worker runs */
+	job->staging =
+		bzalloc(sizeof(struct obs_property) + sizeof(struct list_data));
+	job->staging->type = OBS_PROPERTY_LIST;
+	job->staging->enabled = true;
+	job->staging->visible = true;
+	job->staging->name = bstrdup(p->name);
+	job->staging->desc = bstrdup(p->desc);
+
+	staging_data = get_property_data(job->staging);
+	staging_data->type = data->type;
+	staging_data->format = data->format;
+	return job;
+}
+
+void obs_property_list_populate_run(obs_property_list_job_t *job)
+{
+	if (job)
+		job->populate(job->data, job->staging);
+}
+
+void obs_property_list_populate_end(obs_property_list_job_t *job,
+				    obs_property_t *p)
+{
+	struct list_data *data = get_list_data(p);
+	struct list_data *staging_data;
+
+	if (!job)
+		return;
+
+	staging_data = get_property_data(job->staging);
+
+	if (data && data->populate == job->populate &&
+	    data->format == staging_data->format) {
+		list_data_free(data);
+		da_move(data->items, staging_data->items);
+		data->populating = false;
+	}
+
+	obs_property_destroy(job->staging);
+	bfree(job);
+}
+
+bool obs_property_list_populate(obs_property_t *p, void *obj)
+{
+	obs_property_list_job_t *job = obs_property_list_populate_begin(p, obj);
+	if (!job)
+		return false;
+
+	obs_property_list_populate_run(job);
+	obs_property_list_populate_end(job, p);
+	return true;
+}
+
 enum obs_editable_list_type obs_property_editable_list_type(obs_property_t *p)
 {
 	struct editable_list_data *data =
@@ -124,6 +124,7 @@ struct obs_properties;
 struct obs_property;
 typedef struct obs_properties obs_properties_t;
 typedef struct obs_property obs_property_t;
+typedef struct obs_property_list_job obs_property_list_job_t;
 
 /* ------------------------------------------------------------------------- */
 
@@ -176,6 +177,15 @@ EXPORT void obs_properties_apply_settings(obs_properties_t *props,
 typedef bool (*obs_property_clicked_t)(obs_properties_t *props,
 				       obs_property_t *property, void *data);
 
+/**
+ * Callback that fills a list property whose items are slow to enumerate,
+ * such as capture devices or windows.  It may be called from a worker
+ * thread, and receives a detached copy of the list that only it may touch;
+ * add items to it with the regular obs_property_list_add_* functions.
+ */
+typedef void (*obs_property_list_populate_t)(void *data,
+					     obs_property_t *list);
+
 EXPORT obs_property_t *obs_properties_add_bool(obs_properties_t *props,
 					       const char *name,
 					       const char *description);
@@ -391,6 +401,34 @@ EXPORT long long obs_property_list_item_int(obs_property_t *p, size_t idx);
 EXPORT double obs_property_list_item_float(obs_property_t *p, size_t idx);
 EXPORT bool obs_property_list_item_bool(obs_property_t *p, size_t idx);
 
+/**
+ * Marks a list as populating: its items are filled by the populate callback
+ * once the frontend runs it instead of in get_properties or in a modified
+ * callback.  Setting it again from a modified callback marks the list as
+ * populating again.
+ */
+EXPORT void
+obs_property_list_set_populate_callback(obs_property_t *p,
+					obs_property_list_populate_t populate);
+EXPORT bool obs_property_list_populating(obs_property_t *p);
+
+/**
+ * Asynchronous list population.  _begin captures the callback and a detached
+ * copy of the list, _run calls the callback (on any thread), and _end moves
+ * the items into the list and clears its populating state.  Passing a NULL
+ * property to _end discards the items, for when the properties were
+ * destroyed in the meantime.  _begin returns NULL if the list is not
+ * populating.
+ */
+EXPORT obs_property_list_job_t *
+obs_property_list_populate_begin(obs_property_t *p, void *obj);
+EXPORT void obs_property_list_populate_run(obs_property_list_job_t *job);
+EXPORT void obs_property_list_populate_end(obs_property_list_job_t *job,
+					   obs_property_t *p);
+
+/** Populates a list synchronously, returns false if it was not populating */
+EXPORT bool obs_property_list_populate(obs_property_t *p, void *obj);
+
 EXPORT enum obs_editable_list_type
 obs_property_editable_list_type(obs_property_t *p);
 EXPORT const char *obs_property_editable_list_filter(obs_property_t *p);
@@ -19,6 +19,7 @@
 #include "util/threading.h"
 #include "util/util_uint64.h"
 #include "graphics/math-defs.h"
+#include "media-io/audio-math.h"
 #include "obs-scene.h"
 #include "obs-internal.h"
 
@@ -32,6 +33,7 @@ static void get_ungrouped_transform(obs_sceneitem_t *group, struct vec2 *pos,
 				    struct vec2 *scale, float *rot);
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop);
 static inline bool item_texture_enabled(const struct obs_scene_item *item);
+static bool scene_update_cache_state(struct obs_scene *scene);
 static void init_hotkeys(obs_scene_t *scene, obs_sceneitem_t *item,
 			 const char *name);
 
@@ -57,6 +59,7 @@ static const char *obs_scene_signals[] = {
 	"void item_select(ptr scene, ptr item)",
 	"void item_deselect(ptr scene, ptr item)",
 	"void item_transform(ptr scene, ptr item)",
+	"void items_transformed(ptr scene)",
 	"void item_locked(ptr scene, ptr item, bool locked)",
 	NULL,
 };
@@ -231,12 +234,34 @@ static void remove_all_items(struct obs_scene *scene)
 	da_free(items);
 }
 
+static void transform_batch_free(struct scene_transform_batch *batch)
+{
+	da_free(batch->items);
+	da_free(batch->dst);
+	da_free(batch->scale_x);
+	da_free(batch->scale_y);
+	da_free(batch->origin_x);
+	da_free(batch->origin_y);
+	da_free(batch->rot);
+	da_free(batch->pos_x);
+	da_free(batch->pos_y);
+}
+
 static void scene_destroy(void *data)
 {
 	struct obs_scene *scene = data;
 
 	remove_all_items(scene);
 
+	if (scene->cache_render) {
+		obs_enter_graphics();
+		gs_texrender_destroy(scene->cache_render);
+		obs_leave_graphics();
+	}
+	da_free(scene->cache_state);
+	da_free(scene->cache_prev_state);
+	transform_batch_free(&scene->transform_batch);
+
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
 	bfree(scene);
@@ -489,7 +514,18 @@ static inline uint32_t calc_cy(const struct obs_scene_item *item,
 	return (crop_cy > height) ? 2 : (height - crop_cy);
 }
 
-static void update_item_transform(struct obs_scene_item *item, bool update_tex)
+static inline bool in_scene_update(const struct obs_scene *scene)
+{
+	return scene && os_atomic_load_long(&scene->update_depth) > 0;
+}
+
+/* computes the scale and origin of the draw and box transforms of an item, and
+ * updates its output size and bounds crop along the way */
+static void calc_item_transform(struct obs_scene_item *item,
+				struct vec2 *draw_scale,
+				struct vec2 *draw_origin,
+				struct vec2 *box_scale,
+				struct vec2 *box_origin)
 {
 	uint32_t width;
 	uint32_t height;
@@ -498,11 +534,6 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	struct vec2 base_origin;
 	struct vec2 origin;
 	struct vec2 scale;
-	struct calldata params;
-	uint8_t stack[128];
-
-	if (os_atomic_load_long(&item->defer_update) > 0)
-		return;
 
 	/* Reset bounds crop */
 	memset(&item->bounds_crop, 0, sizeof(item->bounds_crop));
@@ -532,15 +563,8 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	add_alignment(&origin, item->align, (int)cx, (int)cy);
 
-	matrix4_identity(&item->draw_transform);
-	matrix4_scale3f(&item->draw_transform, &item->draw_transform, scale.x,
-			scale.y, 1.0f);
-	matrix4_translate3f(&item->draw_transform, &item->draw_transform,
-			    -origin.x, -origin.y, 0.0f);
-	matrix4_rotate_aa4f(&item->draw_transform, &item->draw_transform, 0.0f,
-			    0.0f, 1.0f, RAD(item->rot));
-	matrix4_translate3f(&item->draw_transform, &item->draw_transform,
-			    item->pos.x, item->pos.y, 0.0f);
+	*draw_scale = scale;
+	*draw_origin = origin;
 
 	item->output_scale = scale;
 
@@ -557,21 +581,23 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	add_alignment(&base_origin, item->align, (int)scale.x, (int)scale.y);
 
-	matrix4_identity(&item->box_transform);
-	matrix4_scale3f(&item->box_transform, &item->box_transform, scale.x,
-			scale.y, 1.0f);
-	matrix4_translate3f(&item->box_transform, &item->box_transform,
-			    -base_origin.x, -base_origin.y, 0.0f);
-	matrix4_rotate_aa4f(&item->box_transform, &item->box_transform, 0.0f,
-			    0.0f, 1.0f, RAD(item->rot));
-	matrix4_translate3f(&item->box_transform, &item->box_transform,
-			    item->pos.x, item->pos.y, 0.0f);
+	*box_scale = scale;
+	*box_origin = base_origin;
+}
 
-	/* ----------------------- */
+static void finish_item_transform(struct obs_scene_item *item,
+				  bool update_tex)
+{
+	struct calldata params;
+	uint8_t stack[128];
 
-	calldata_init_fixed(&params, stack, sizeof(stack));
-	calldata_set_ptr(&params, "item", item);
-	signal_parent(item->parent, "item_transform", &params);
+	/* updates made inside of a scene update are signalled once, as
+	 * items_transformed, by obs_scene_commit_update */
+	if (!in_scene_update(item->parent)) {
+		calldata_init_fixed(&params, stack, sizeof(stack));
+		calldata_set_ptr(&params, "item", item);
+		signal_parent(item->parent, "item_transform", &params);
+	}
 
 	if (!update_tex)
 		return;
@@ -579,6 +605,110 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	os_atomic_set_bool(&item->update_transform, false);
 }
 
+static void update_item_transform(struct obs_scene_item *item, bool update_tex)
+{
+	struct vec2 draw_scale, draw_origin;
+	struct vec2 box_scale, box_origin;
+
+	if (os_atomic_load_long(&item->defer_update) > 0)
+		return;
+
+	calc_item_transform(item, &draw_scale, &draw_origin, &box_scale,
+			    &box_origin);
+
+	struct matrix4 *dst[2] = {&item->draw_transform, &item->box_transform};
+	const float scale_x[2] = {draw_scale.x, box_scale.x};
+	const float scale_y[2] = {draw_scale.y, box_scale.y};
+	const float origin_x[2] = {draw_origin.x, box_origin.x};
+	const float origin_y[2] = {draw_origin.y, box_origin.y};
+	const float rot[2] = {RAD(item->rot), RAD(item->rot)};
+	const float pos_x[2] = {item->pos.x, item->pos.x};
+	const float pos_y[2] = {item->pos.y, item->pos.y};
+	const struct matrix4_2d_batch batch = {scale_x,  scale_y, origin_x,
+					       origin_y, rot,     pos_x,
+					       pos_y};
+
+	matrix4_compose_2d_batch(dst, &batch, 2);
+	finish_item_transform(item, update_tex);
+}
+
+static void transform_batch_push(struct scene_transform_batch *batch,
+				 struct matrix4 *dst,
+				 const struct obs_scene_item *item,
+				 const struct vec2 *scale,
+				 const struct vec2 *origin)
+{
+	float rot = RAD(item->rot);
+
+	da_push_back(batch->dst, &dst);
+	da_push_back(batch->scale_x, &scale->x);
+	da_push_back(batch->scale_y, &scale->y);
+	da_push_back(batch->origin_x, &origin->x);
+	da_push_back(batch->origin_y, &origin->y);
+	da_push_back(batch->rot, &rot);
+	da_push_back(batch->pos_x, &item->pos.x);
+	da_push_back(batch->pos_y, &item->pos.y);
+}
+
+/* same as update_item_transform, except that the matrices are only composed
+ * once the whole batch is flushed */
+static void transform_batch_add(struct scene_transform_batch *batch,
+				struct obs_scene_item *item)
+{
+	struct vec2 draw_scale, draw_origin;
+	struct vec2 box_scale, box_origin;
+
+	if (os_atomic_load_long(&item->defer_update) > 0)
+		return;
+
+	calc_item_transform(item, &draw_scale, &draw_origin, &box_scale,
+			    &box_origin);
+
+	da_push_back(batch->items, &item);
+	transform_batch_push(batch, &item->draw_transform, item, &draw_scale,
+			     &draw_origin);
+	transform_batch_push(batch, &item->box_transform, item, &box_scale,
+			     &box_origin);
+}
+
+static void transform_batch_flush(struct scene_transform_batch *batch)
+{
+	const struct matrix4_2d_batch math = {
+		batch->scale_x.array, batch->scale_y.array,
+		batch->origin_x.array, batch->origin_y.array,
+		batch->rot.array, batch->pos_x.array,
+		batch->pos_y.array};
+	obs_scene_item_ptr_array_t items;
+
+	if (!batch->items.num)
+		return;
+
+	matrix4_compose_2d_batch(batch->dst.array, &math, batch->dst.num);
+
+	/* signal handlers may update the scene again, which reuses the batch */
+	da_init(items);
+	da_move(items, batch->items);
+	da_resize(batch->dst, 0);
+	da_resize(batch->scale_x, 0);
+	da_resize(batch->scale_y, 0);
+	da_resize(batch->origin_x, 0);
+	da_resize(batch->origin_y, 0);
+	da_resize(batch->rot, 0);
+	da_resize(batch->pos_x, 0);
+	da_resize(batch->pos_y, 0);
+
+	for (size_t i = 0; i < items.num; i++)
+		finish_item_transform(items.array[i], true);
+
+	/* keeps the allocation for the next pass */
+	if (!batch->items.array) {
+		da_resize(items, 0);
+		da_move(batch->items, items);
+	} else {
+		da_free(items);
+	}
+}
+
 static inline bool source_size_changed(struct obs_scene_item *item)
 {
 	uint32_t width = obs_source_get_width(item->source);
@@ -612,8 +742,7 @@ static inline bool item_texture_enabled(const struct obs_scene_item *item)
 	return crop_enabled(&item->crop) || crop_enabled(&item->bounds_crop) ||
 	       scale_filter_enabled(item) ||
 	       (item->blend_method == OBS_BLEND_METHOD_SRGB_OFF) ||
-	       !default_blending_enabled(item) ||
-	       (item_is_scene(item) && !item->is_group);
+	       !default_blending_enabled(item);
 }
 
 static void render_item_texture(struct obs_scene_item *item,
@@ -787,13 +916,138 @@ static bool are_texcoords_centered(struct matrix4 *m)
 	return memcmp(m, &copy, sizeof(*m)) == 0;
 }
 
+static inline bool is_sdr_space(enum gs_color_space space)
+{
+	return space == GS_CS_SRGB || space == GS_CS_SRGB_16F;
+}
+
+static inline bool item_inside_bounds(struct obs_scene_item *item,
+				      float width, float height)
+{
+	const float cx =
+		(float)calc_cx(item, obs_source_get_width(item->source));
+	const float cy =
+		(float)calc_cy(item, obs_source_get_height(item->source));
+	const float corners[4][2] = {
+		{0.0f, 0.0f}, {cx, 0.0f}, {0.0f, cy}, {cx, cy}};
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 v;
+		vec3_set(&v, corners[i][0], corners[i][1], 0.0f);
+		vec3_transform(&v, &v, &item->draw_transform);
+
+		if (v.x < -EPSILON || v.y < -EPSILON ||
+		    v.x > width + EPSILON || v.y > height + EPSILON)
+			return false;
+	}
+
+	return true;
+}
+
+/* assumes video lock.  Whether blending the visible items one by one onto
+ * the target gives the same result as blending them into a transparent
+ * texture first and drawing that, and, if width and height are given,
+ * whether they all stay within those bounds. */
+static bool items_render_direct(struct obs_scene *scene, float width,
+				float height)
+{
+	for (struct obs_scene_item *item = scene->first_item; item;
+	     item = item->next) {
+		if (!item->user_visible &&
+		    !transition_active(item->hide_transition))
+			continue;
+
+		if (!default_blending_enabled(item) ||
+		    item->blend_method == OBS_BLEND_METHOD_SRGB_OFF)
+			return false;
+
+		/* the transform is only updated once the scene renders */
+		if (os_atomic_load_bool(&item->update_transform) ||
+		    source_size_changed(item))
+			return false;
+		if (width > 0.0f && !item_inside_bounds(item, width, height))
+			return false;
+
+		/* the children of groups are drawn onto the target as well,
+		 * but never leave the group's bounds */
+		if (item->is_group) {
+			obs_scene_t *group = item->source->context.data;
+			bool direct;
+
+			video_lock(group);
+			direct = items_render_direct(group, 0.0f, 0.0f);
+			video_unlock(group);
+
+			if (!direct)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool has_video_filters(obs_source_t *source)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		if (filter->enabled &&
+		    (filter->info.output_flags & OBS_SOURCE_VIDEO) != 0) {
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return found;
+}
+
+/* assumes video lock.  Nested scenes are drawn through an item texture by
+ * default, which clips them to their size and converts their color space as
+ * a whole.  When neither is needed they are drawn straight into the parent
+ * under the concatenated transform, which saves a canvas sized texture and a
+ * pass per level of nesting. */
+static bool nested_scene_renders_direct(struct obs_scene_item *item,
+					enum gs_color_space current_space,
+					enum gs_color_space source_space)
+{
+	obs_source_t *source = item->source;
+	obs_scene_t *scene = source->context.data;
+	bool direct;
+
+	if (!scene)
+		return false;
+	if (source_space != current_space &&
+	    !(is_sdr_space(source_space) && is_sdr_space(current_space)))
+		return false;
+
+	/* scenes are custom drawn, so an enabled video filter always renders
+	 * the scene into a texture of its own that clips it already */
+	if (has_video_filters(source))
+		return true;
+
+	const uint32_t width = obs_source_get_width(source);
+	const uint32_t height = obs_source_get_height(source);
+	if (!width || !height)
+		return false;
+
+	/* static scenes draw from their cache, which needs the item texture
+	 * to map one to one onto the scene */
+	video_lock(scene);
+	direct = !scene_update_cache_state(scene) &&
+		 items_render_direct(scene, (float)width, (float)height);
+	video_unlock(scene);
+
+	return direct;
+}
+
 static inline void render_item(struct obs_scene_item *item)
 {
 	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item: %s",
 				     obs_source_get_name(item->source));
 
-	const bool use_texrender = item_texture_enabled(item);
-
 	obs_source_t *const source = item->source;
 	const enum gs_color_space current_space = gs_get_color_space();
 	const enum gs_color_space source_space =
@@ -801,6 +1055,12 @@ static inline void render_item(struct obs_scene_item *item)
 	const enum gs_color_format format =
 		gs_get_format_from_space(source_space);
 
+	const bool use_texrender =
+		item_texture_enabled(item) ||
+		(item_is_scene(item) && !item->is_group &&
+		 !nested_scene_renders_direct(item, current_space,
+					      source_space));
+
 	if (item->item_render &&
 	    (!use_texrender ||
 	     (gs_texrender_get_format(item->item_render) != format))) {
@@ -809,7 +1069,8 @@ static inline void render_item(struct obs_scene_item *item)
 	}
 
 	if (!item->item_render && use_texrender) {
-		item->item_render = gs_texrender_create(format, GS_ZS_NONE);
+		item->item_render =
+			gs_texrender_create_transient(format, GS_ZS_NONE);
 	}
 
 	if (item->item_render) {
@@ -923,6 +1184,148 @@ static void scene_video_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 }
 
+static inline bool static_video_source(const obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+	return (flags & OBS_SOURCE_STATIC_VIDEO) != 0 &&
+	       (flags & OBS_SOURCE_ASYNC) == 0;
+}
+
+static bool push_filter_cache_state(struct obs_scene *scene,
+				    obs_source_t *source)
+{
+	bool usable = true;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		struct scene_cache_entry *entry;
+
+		if (filter->enabled && !static_video_source(filter)) {
+			usable = false;
+			break;
+		}
+
+		entry = da_push_back_new(scene->cache_state);
+		entry->source = filter;
+		entry->generation =
+			os_atomic_load_long(&filter->video_generation);
+		entry->enabled = filter->enabled;
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return usable;
+}
+
+/* assumes video lock */
+static bool push_item_cache_state(struct obs_scene *scene,
+				  struct obs_scene_item *item)
+{
+	obs_source_t *source = item->source;
+	struct scene_cache_entry *entry;
+
+	if (transition_active(item->show_transition) ||
+	    transition_active(item->hide_transition))
+		return false;
+	if (obs_source_removed(source))
+		return false;
+
+	if (item_is_scene(item)) {
+		obs_scene_t *sub_scene = source->context.data;
+		bool usable;
+
+		video_lock(sub_scene);
+		usable = scene_update_cache_state(sub_scene);
+		video_unlock(sub_scene);
+
+		if (!usable)
+			return false;
+	} else if (!static_video_source(source)) {
+		return false;
+	}
+
+	entry = da_push_back_new(scene->cache_state);
+	entry->source = source;
+	entry->generation = os_atomic_load_long(&source->video_generation);
+	entry->enabled = source->enabled;
+	entry->width = obs_source_get_width(source);
+	entry->height = obs_source_get_height(source);
+	entry->draw_transform = item->draw_transform;
+	entry->crop = item->crop;
+	entry->bounds_crop = item->bounds_crop;
+	entry->scale_filter = item->scale_filter;
+	entry->blend_method = item->blend_method;
+	entry->blend_type = item->blend_type;
+
+	/* a pending transform change is only applied when the item is
+	 * actually rendered, so treat it as a change of its own */
+	if (os_atomic_load_bool(&item->update_transform) ||
+	    source_size_changed(item))
+		scene->cache_changed = true;
+
+	return push_filter_cache_state(scene, source);
+}
+
+/* assumes video lock.  Collects the render state of every visible item once
+ * per frame and compares it with the previous frame, bumping the scene's video
+ * generation on changes so that parent scenes notice them as well.  Returns
+ * whether the scene is made only of static sources. */
+static bool scene_update_cache_state(struct obs_scene *scene)
+{
+	struct obs_scene_item *item;
+
+	if (scene->cache_checked &&
+	    scene->cache_frame == obs->video.total_frames)
+		return scene->cache_usable;
+
+	scene->cache_checked = true;
+	scene->cache_frame = obs->video.total_frames;
+	scene->cache_usable = true;
+	scene->cache_changed = false;
+
+	da_move(scene->cache_prev_state, scene->cache_state);
+	da_init(scene->cache_state);
+	da_reserve(scene->cache_state, scene->cache_prev_state.num);
+
+	for (item = scene->first_item; item; item = item->next) {
+		if (!item->user_visible &&
+		    !transition_active(item->hide_transition))
+			continue;
+
+		if (!push_item_cache_state(scene, item)) {
+			scene->cache_usable = false;
+			break;
+		}
+	}
+
+	if (scene->cache_state.num != scene->cache_prev_state.num ||
+	    memcmp(scene->cache_state.array, scene->cache_prev_state.array,
+		   scene->cache_state.num * sizeof(struct scene_cache_entry)))
+		scene->cache_changed = true;
+
+	if (!scene->cache_usable || scene->cache_changed) {
+		scene->cache_valid = false;
+		os_atomic_inc_long(&scene->source->video_generation);
+	}
+
+	return scene->cache_usable;
+}
+
+bool obs_scene_video_static(obs_source_t *source)
+{
+	obs_scene_t *scene = source->context.data;
+	bool usable;
+
+	if (!scene)
+		return false;
+
+	video_lock(scene);
+	usable = scene_update_cache_state(scene);
+	video_unlock(scene);
+
+	return usable;
+}
+
 /* assumes video lock */
 static void
 update_transforms_and_prune_sources(obs_scene_t *scene,
@@ -957,36 +1360,92 @@ update_transforms_and_prune_sources(obs_scene_t *scene,
 		if (os_atomic_load_bool(&item->update_transform) ||
 		    source_size_changed(item)) {
 
-			update_item_transform(item, true);
+			transform_batch_add(&scene->transform_batch, item);
 			rebuild_group = true;
 		}
 
 		item = item->next;
 	}
 
+	/* composes the matrices of all dirty items in one pass, which is also
+	 * when their item_transform signals are sent */
+	transform_batch_flush(&scene->transform_batch);
+
 	if (rebuild_group && group_sceneitem)
 		resize_group(group_sceneitem);
 }
 
-static void scene_video_render(void *data, gs_effect_t *effect)
+/* items that render_item would draw straight from their source with the
+ * default effect, without an item texture or a transition */
+static inline bool item_can_batch(struct obs_scene_item *item)
 {
-	obs_scene_item_ptr_array_t remove_items;
-	struct obs_scene *scene = data;
-	struct obs_scene_item *item;
-
-	da_init(remove_items);
+	return item->user_visible && !item->item_render &&
+	       !transition_active(item->show_transition) &&
+	       !item_texture_enabled(item) &&
+	       obs_source_can_batch_render(item->source);
+}
 
-	video_lock(scene);
+/* draws a run of batchable items inside a single pass of the default effect,
+ * instead of beginning and ending the technique once per item */
+static void render_item_batch(struct obs_scene_item *first,
+			      struct obs_scene_item *end)
+{
+	gs_effect_t *effect = obs->video.default_effect;
+	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
+	const bool previous = gs_set_linear_srgb(true);
+
+	size_t passes = gs_technique_begin(tech);
+	for (size_t i = 0; i < passes; i++) {
+		gs_technique_begin_pass(tech, i);
+
+		for (struct obs_scene_item *item = first; item != end;
+		     item = item->next) {
+			GS_DEBUG_MARKER_BEGIN_FORMAT(
+				GS_DEBUG_COLOR_ITEM, "Item: %s",
+				obs_source_get_name(item->source));
+
+			const bool centered =
+				are_texcoords_centered(&item->draw_transform);
+
+			gs_matrix_push();
+			gs_matrix_mul(&item->draw_transform);
+			obs_source_set_texcoords_centered(item->source,
+							  centered);
+			obs_source_batch_render(item->source, effect);
+			obs_source_set_texcoords_centered(item->source, false);
+			gs_matrix_pop();
+
+			GS_DEBUG_MARKER_END();
+		}
 
-	if (!scene->is_group) {
-		update_transforms_and_prune_sources(scene, &remove_items, NULL);
+		gs_technique_end_pass(tech);
 	}
+	gs_technique_end(tech);
+
+	gs_set_linear_srgb(previous);
+}
+
+static void render_scene_items(struct obs_scene *scene)
+{
+	struct obs_scene_item *item;
 
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
 	item = scene->first_item;
 	while (item) {
+		if (item_can_batch(item)) {
+			struct obs_scene_item *end = item->next;
+			while (end && item_can_batch(end))
+				end = end->next;
+
+			if (end != item->next) {
+				render_item_batch(item, end);
+				item = end;
+				continue;
+			}
+		}
+
 		if (item->user_visible ||
 		    transition_active(item->hide_transition))
 			render_item(item);
@@ -995,9 +1454,106 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 	}
 
 	gs_blend_state_pop();
+}
+
+/* assumes video lock.  The cache is only drawn when the current target maps
+ * one to one onto the scene, otherwise items outside of the scene bounds or
+ * the sampling of the cache would differ from rendering the items directly. */
+static bool render_scene_from_cache(struct obs_scene *scene)
+{
+	const enum gs_color_space space = gs_get_color_space();
+	const uint32_t cx = obs_source_get_width(scene->source);
+	const uint32_t cy = obs_source_get_height(scene->source);
+	struct gs_rect viewport;
+
+	gs_get_viewport(&viewport);
+	if (!cx || !cy || viewport.cx != (int)cx || viewport.cy != (int)cy)
+		return false;
+
+	if (scene->cache_render && scene->cache_space != space) {
+		gs_texrender_destroy(scene->cache_render);
+		scene->cache_render = NULL;
+		scene->cache_valid = false;
+	}
+
+	if (!scene->cache_render) {
+		scene->cache_render = gs_texrender_create(
+			gs_get_format_from_space(space), GS_ZS_NONE);
+		scene->cache_space = space;
+		if (!scene->cache_render)
+			return false;
+	}
+
+	gs_texture_t *tex = gs_texrender_get_texture(scene->cache_render);
+	if (tex && (gs_texture_get_width(tex) != cx ||
+		    gs_texture_get_height(tex) != cy))
+		scene->cache_valid = false;
+
+	if (!scene->cache_valid) {
+		struct vec4 clear_color;
+
+		gs_texrender_reset(scene->cache_render);
+		if (!gs_texrender_begin_with_color_space(scene->cache_render,
+							 cx, cy, space))
+			return false;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		render_scene_items(scene);
+
+		gs_texrender_end(scene->cache_render);
+		scene->cache_valid = true;
+
+		tex = gs_texrender_get_texture(scene->cache_render);
+		if (!tex)
+			return false;
+	}
+
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE,
+			      "render_scene_from_cache");
+
+	const bool previous = gs_set_linear_srgb(true);
+	gs_blend_state_push();
+	gs_blend_function_separate(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA,
+				   GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	gs_effect_t *effect = obs->video.default_effect;
+	while (gs_effect_loop(effect, "Draw"))
+		obs_source_draw(tex, 0, 0, 0, 0, 0);
+
+	gs_blend_state_pop();
+	gs_set_linear_srgb(previous);
+
+	GS_DEBUG_MARKER_END();
+	return true;
+}
+
+static void scene_video_render(void *data, gs_effect_t *effect)
+{
+	obs_scene_item_ptr_array_t remove_items;
+	struct obs_scene *scene = data;
+
+	da_init(remove_items);
+
+	video_lock(scene);
+
+	if (!scene->is_group) {
+		update_transforms_and_prune_sources(scene, &remove_items, NULL);
+	}
+
+	if (scene_update_cache_state(scene) && !scene->cache_changed &&
+	    render_scene_from_cache(scene)) {
+		video_unlock(scene);
+		goto cleanup;
+	}
+
+	render_scene_items(scene);
 
 	video_unlock(scene);
 
+cleanup:
 	for (size_t i = 0; i < remove_items.num; i++)
 		obs_sceneitem_release(remove_items.array[i]);
 	da_free(remove_items);
@@ -1101,6 +1657,8 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
 
 	set_visibility(item, visible);
 	obs_sceneitem_set_locked(item, lock);
+	obs_sceneitem_set_roi_priority(
+		item, (float)obs_data_get_double(item_data, "roi_priority"));
 
 	item->bounds_type = (enum obs_bounds_type)obs_data_get_int(
 		item_data, "bounds_type");
@@ -1229,6 +1787,7 @@ static void scene_save_item(obs_data_array_t *array,
 	obs_data_set_string(item_data, "source_uuid", src_uuid);
 	obs_data_set_bool(item_data, "visible", item->user_visible);
 	obs_data_set_bool(item_data, "locked", item->locked);
+	obs_data_set_double(item_data, "roi_priority", item->roi_priority);
 	obs_data_set_double(item_data, "rot", rot);
 	obs_data_set_vec2(item_data, "pos", &pos);
 	obs_data_set_vec2(item_data, "scale", &scale);
@@ -1455,24 +2014,13 @@ static void process_all_audio_actions(struct obs_scene_item *item,
 static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in,
 			       size_t pos, size_t count)
 {
-	register float *out = p_out + pos;
-	register float *buf = buf_in;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
+	audio_mix_add_mul(p_out + pos, p_in, buf_in, count);
 }
 
 static inline void mix_audio(float *p_out, float *p_in, size_t pos,
 			     size_t count)
 {
-	register float *out = p_out + pos;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
+	audio_mix_add(p_out + pos, p_in, count);
 }
 
 static bool scene_audio_render(void *data, uint64_t *ts_out,
@@ -1760,6 +2308,7 @@ static inline void duplicate_item_data(struct obs_scene_item *dst,
 	}
 	dst->show_transition_duration = src->show_transition_duration;
 	dst->hide_transition_duration = src->hide_transition_duration;
+	dst->roi_priority = src->roi_priority;
 
 	if (duplicate_hotkeys && !dst_scene->source->context.private) {
 		struct dstr show = {0};
@@ -2591,10 +3140,14 @@ bool obs_sceneitem_selected(const obs_sceneitem_t *item)
 
 #define do_update_transform(item)                                          \
 	do {                                                               \
-		if (!item->parent || item->parent->is_group)               \
+		if (!item->parent || item->parent->is_group) {             \
 			os_atomic_set_bool(&item->update_transform, true); \
-		else                                                       \
+		} else if (in_scene_update(item->parent)) {                \
+			item->update_pending = true;                       \
+			item->parent->update_pending = true;               \
+		} else {                                                   \
 			update_item_transform(item, false);                \
+		}                                                          \
 	} while (false)
 
 void obs_sceneitem_set_pos(obs_sceneitem_t *item, const struct vec2 *pos)
@@ -2892,6 +3445,34 @@ void obs_sceneitem_set_info2(obs_sceneitem_t *item,
 	}
 }
 
+void obs_sceneitems_set_info2(obs_sceneitem_t *const *items,
+			      const struct obs_transform_info *infos,
+			      size_t count)
+{
+	size_t i = 0;
+
+	if (!items || !infos)
+		return;
+
+	while (i < count) {
+		struct obs_scene *scene = items[i] ? items[i]->parent : NULL;
+
+		/* one update for every run of items sharing a scene so the
+		 * scene is never rendered with only part of the batch */
+		if (scene)
+			obs_scene_begin_update(scene);
+
+		do {
+			obs_sceneitem_set_info2(items[i], &infos[i]);
+			i++;
+		} while (i < count && items[i] &&
+			 items[i]->parent == scene);
+
+		if (scene)
+			obs_scene_commit_update(scene);
+	}
+}
+
 void obs_sceneitem_get_draw_transform(const obs_sceneitem_t *item,
 				      struct matrix4 *transform)
 {
@@ -3096,6 +3677,63 @@ void obs_scene_atomic_update(obs_scene_t *scene,
 	obs_scene_release(scene);
 }
 
+void obs_scene_begin_update(obs_scene_t *scene)
+{
+	if (!obs_ptr_valid(scene, "obs_scene_begin_update"))
+		return;
+
+	scene = obs_scene_get_ref(scene);
+	if (!scene)
+		return;
+
+	full_lock(scene);
+	os_atomic_inc_long(&scene->update_depth);
+}
+
+void obs_scene_commit_update(obs_scene_t *scene)
+{
+	struct obs_scene_item *item;
+	bool transformed = false;
+
+	if (!obs_ptr_valid(scene, "obs_scene_commit_update"))
+		return;
+	if (!in_scene_update(scene)) {
+		blog(LOG_WARNING, "obs_scene_commit_update: scene update was "
+				  "not begun");
+		return;
+	}
+
+	/* still inside of the update, so the items don't signal on their
+	 * own */
+	if (os_atomic_load_long(&scene->update_depth) == 1 &&
+	    scene->update_pending) {
+		item = scene->first_item;
+		while (item) {
+			if (item->update_pending) {
+				item->update_pending = false;
+				update_item_transform(item, false);
+				transformed = true;
+			}
+			item = item->next;
+		}
+
+		scene->update_pending = false;
+	}
+
+	os_atomic_dec_long(&scene->update_depth);
+	full_unlock(scene);
+
+	if (transformed) {
+		struct calldata params;
+		uint8_t stack[128];
+
+		calldata_init_fixed(&params, stack, sizeof(stack));
+		signal_parent(scene, "items_transformed", &params);
+	}
+
+	obs_scene_release(scene);
+}
+
 static inline bool crop_equal(const struct obs_sceneitem_crop *crop1,
 			      const struct obs_sceneitem_crop *crop2)
 {
@@ -3926,6 +4564,23 @@ void obs_sceneitem_set_show_transition(obs_sceneitem_t *item,
 	item->show_transition = obs_source_get_ref(transition);
 }
 
+void obs_sceneitem_set_roi_priority(obs_sceneitem_t *item, float priority)
+{
+	if (!item)
+		return;
+
+	if (priority < -1.0f)
+		priority = -1.0f;
+	else if (priority > 1.0f)
+		priority = 1.0f;
+	item->roi_priority = priority;
+}
+
+float obs_sceneitem_get_roi_priority(const obs_sceneitem_t *item)
+{
+	return item ? item->roi_priority : 0.0f;
+}
+
 void obs_sceneitem_set_show_transition_duration(obs_sceneitem_t *item,
 						uint32_t duration_ms)
 {
@@ -34,6 +34,8 @@ struct obs_scene_item {
 	bool is_group;
 	bool update_transform;
 	bool update_group_resize;
+	/* transform changed inside of obs_scene_begin_update */
+	bool update_pending;
 
 	int64_t id;
 
@@ -46,6 +48,7 @@ struct obs_scene_item {
 	bool visible;
 	bool selected;
 	bool locked;
+	float roi_priority;
 
 	gs_texrender_t *item_render;
 	struct obs_sceneitem_crop crop;
@@ -93,6 +96,35 @@ struct obs_scene_item {
 	struct obs_scene_item *next;
 };
 
+struct scene_cache_entry {
+	struct obs_source *source;
+	long generation;
+	bool enabled;
+	uint32_t width;
+	uint32_t height;
+	struct matrix4 draw_transform;
+	struct obs_sceneitem_crop crop;
+	struct obs_sceneitem_crop bounds_crop;
+	enum obs_scale_type scale_filter;
+	enum obs_blending_method blend_method;
+	enum obs_blending_type blend_type;
+};
+
+/* dirty item transforms of one update pass, in the structure of arrays layout
+ * of matrix4_compose_2d_batch.  Each item adds its draw transform, followed by
+ * its box transform. */
+struct scene_transform_batch {
+	DARRAY(struct obs_scene_item *) items;
+	DARRAY(struct matrix4 *) dst;
+	DARRAY(float) scale_x;
+	DARRAY(float) scale_y;
+	DARRAY(float) origin_x;
+	DARRAY(float) origin_y;
+	DARRAY(float) rot;
+	DARRAY(float) pos_x;
+	DARRAY(float) pos_y;
+};
+
 struct obs_scene {
 	struct obs_source *source;
 
@@ -103,7 +135,26 @@ struct obs_scene {
 
 	int64_t id_counter;
 
+	/* obs_scene_begin_update nesting, the scene mutexes stay locked
+	 * until the matching commit */
+	volatile long update_depth;
+	bool update_pending;
+
 	pthread_mutex_t video_mutex;
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
+
+	/* composition cache, used while every visible item is static */
+	gs_texrender_t *cache_render;
+	enum gs_color_space cache_space;
+	DARRAY(struct scene_cache_entry) cache_state;
+	DARRAY(struct scene_cache_entry) cache_prev_state;
+	uint32_t cache_frame;
+	bool cache_checked;
+	bool cache_usable;
+	bool cache_changed;
+	bool cache_valid;
+
+	/* scratch space of update_transforms_and_prune_sources */
+	struct scene_transform_batch transform_batch;
 };
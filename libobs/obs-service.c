@@ -21,12 +21,12 @@
 
 const struct obs_service_info *find_service(const char *id)
 {
-	size_t i;
-	for (i = 0; i < obs->service_types.num; i++)
-		if (strcmp(obs->service_types.array[i].id, id) == 0)
-			return obs->service_types.array + i;
+	size_t idx;
 
-	return NULL;
+	if (!obs_type_index_find(obs->service_type_index, id, &idx))
+		return NULL;
+
+	return obs->service_types.array + idx;
 }
 
 const char *obs_service_get_display_name(const char *id)
@@ -27,7 +27,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 	uint64_t frame_offset = 0;
 	size_t idx = 1;
 
-	if (source->async_unbuffered) {
+	if (async_unbuffered(source)) {
 		while (source->async_frames.num > 2) {
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, next_frame);
@@ -36,7 +36,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 
 		if (source->async_frames.num == 2) {
 			bool prev_frame = true;
-			if (source->async_unbuffered &&
+			if (async_unbuffered(source) &&
 			    source->deinterlace_offset) {
 				const uint64_t timestamp =
 					source->async_frames.array[0]->timestamp;
@@ -150,7 +150,7 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 {
 	uint64_t half_interval;
 
-	if (s->async_unbuffered && s->deinterlace_offset) {
+	if (async_unbuffered(s) && s->deinterlace_offset) {
 		// Want to keep frame if it has not elapsed.
 		const uint64_t frame_end =
 			s->deinterlace_frame_ts + s->deinterlace_offset +
@@ -257,13 +257,16 @@ void deinterlace_update_async_video(obs_source_t *source)
 
 	source->deinterlace_rendered = true;
 
-	pthread_mutex_lock(&source->async_mutex);
+	os_mutex_lock(&source->async_mutex);
 
 	const bool updated = source->cur_async_frame != NULL;
 	struct obs_source_frame *frame = source->prev_async_frame;
 	source->prev_async_frame = NULL;
 
-	pthread_mutex_unlock(&source->async_mutex);
+	os_mutex_unlock(&source->async_mutex);
+
+	if (frame || updated)
+		source->deinterlace_cache_valid = false;
 
 	if (frame) {
 		os_atomic_inc_long(&frame->refs);
@@ -346,9 +349,38 @@ static bool deinterlace_linear_required(enum obs_deinterlace_mode mode)
 	return false;
 }
 
-void deinterlace_render(obs_source_t *s)
+/* deinterlaces the current and previous textures into the cache, in the
+ * source's color space and without flipping, so it can be drawn like any
+ * other texture as often as needed */
+static gs_texture_t *render_deinterlaced(obs_source_t *s,
+					 gs_texture_t *cur_tex,
+					 gs_texture_t *prev_tex,
+					 enum gs_color_space source_space,
+					 bool frame2)
 {
 	gs_effect_t *effect = s->deinterlace_effect;
+	const uint32_t cx = s->async_width;
+	const uint32_t cy = s->async_height;
+
+	if (s->deinterlace_cache_valid &&
+	    s->deinterlace_cached_frame2 == frame2)
+		return gs_texrender_get_texture(s->deinterlace_texrender);
+
+	const enum gs_color_format format =
+		convert_video_format(s->async_format, s->async_trc);
+	if (s->deinterlace_texrender &&
+	    gs_texrender_get_format(s->deinterlace_texrender) != format) {
+		gs_texrender_destroy(s->deinterlace_texrender);
+		s->deinterlace_texrender = NULL;
+	}
+	if (!s->deinterlace_texrender)
+		s->deinterlace_texrender =
+			gs_texrender_create(format, GS_ZS_NONE);
+
+	gs_texrender_reset(s->deinterlace_texrender);
+	if (!gs_texrender_begin_with_color_space(s->deinterlace_texrender, cx,
+						 cy, source_space))
+		return NULL;
 
 	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
 	gs_eparam_t *prev =
@@ -356,10 +388,44 @@ void deinterlace_render(obs_source_t *s)
 	gs_eparam_t *multiplier_param =
 		gs_effect_get_param_by_name(effect, "multiplier");
 	gs_eparam_t *field = gs_effect_get_param_by_name(effect, "field_order");
-	gs_eparam_t *frame2 = gs_effect_get_param_by_name(effect, "frame2");
+	gs_eparam_t *frame2_param =
+		gs_effect_get_param_by_name(effect, "frame2");
 	gs_eparam_t *dimensions =
 		gs_effect_get_param_by_name(effect, "dimensions");
-	struct vec2 size = {(float)s->async_width, (float)s->async_height};
+	struct vec2 size = {(float)cx, (float)cy};
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	gs_effect_set_texture_srgb(image, cur_tex);
+	gs_effect_set_texture_srgb(prev, prev_tex);
+	gs_effect_set_float(multiplier_param, 1.0f);
+	gs_effect_set_int(field, s->deinterlace_top_first);
+	gs_effect_set_vec2(dimensions, &size);
+	gs_effect_set_bool(frame2_param, frame2);
+
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(NULL, 0, cx, cy);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+	gs_texrender_end(s->deinterlace_texrender);
+
+	s->deinterlace_cached_frame2 = frame2;
+	s->deinterlace_cache_valid = true;
+	return gs_texrender_get_texture(s->deinterlace_texrender);
+}
+
+void deinterlace_render(obs_source_t *s)
+{
+	gs_effect_t *effect = obs->video.default_effect;
+
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *multiplier_param =
+		gs_effect_get_param_by_name(effect, "multiplier");
 
 	gs_texture_t *cur_tex =
 		s->async_texrender
@@ -370,12 +436,23 @@ void deinterlace_render(obs_source_t *s)
 			? gs_texrender_get_texture(s->async_prev_texrender)
 			: s->async_prev_textures[0];
 
-	if (!cur_tex || !prev_tex || !s->async_width || !s->async_height)
+	if (!cur_tex || !prev_tex || !s->async_width || !s->async_height ||
+	    !s->deinterlace_effect)
 		return;
 
 	const enum gs_color_space source_space =
 		convert_video_space(s->async_format, s->async_trc);
 
+	const uint64_t frame2_ts =
+		s->deinterlace_frame_ts + s->deinterlace_offset +
+		s->deinterlace_half_duration - TWOX_TOLERANCE;
+	const bool frame2 = obs->video.video_time >= frame2_ts;
+
+	gs_texture_t *tex = render_deinterlaced(s, cur_tex, prev_tex,
+						source_space, frame2);
+	if (!tex)
+		return;
+
 	const bool linear_srgb =
 		(source_space != GS_CS_SRGB) || gs_get_linear_srgb() ||
 		deinterlace_linear_required(s->deinterlace_mode);
@@ -424,25 +501,15 @@ void deinterlace_render(obs_source_t *s)
 	const bool previous = gs_framebuffer_srgb_enabled();
 	gs_enable_framebuffer_srgb(linear_srgb);
 
-	if (linear_srgb) {
-		gs_effect_set_texture_srgb(image, cur_tex);
-		gs_effect_set_texture_srgb(prev, prev_tex);
-	} else {
-		gs_effect_set_texture(image, cur_tex);
-		gs_effect_set_texture(prev, prev_tex);
-	}
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
+		gs_effect_set_texture(image, tex);
 
 	gs_effect_set_float(multiplier_param, multiplier);
-	gs_effect_set_int(field, s->deinterlace_top_first);
-	gs_effect_set_vec2(dimensions, &size);
-
-	const uint64_t frame2_ts =
-		s->deinterlace_frame_ts + s->deinterlace_offset +
-		s->deinterlace_half_duration - TWOX_TOLERANCE;
-	gs_effect_set_bool(frame2, obs->video.video_time >= frame2_ts);
 
 	while (gs_effect_loop(effect, tech_name))
-		gs_draw_sprite(NULL, s->async_flip ? GS_FLIP_V : 0,
+		gs_draw_sprite(tex, s->async_flip ? GS_FLIP_V : 0,
 			       s->async_width, s->async_height);
 
 	gs_enable_framebuffer_srgb(previous);
@@ -459,13 +526,14 @@ static void enable_deinterlacing(obs_source_t *source,
 
 	source->deinterlace_mode = mode;
 	source->deinterlace_effect = get_effect(mode);
+	source->deinterlace_cache_valid = false;
 
-	pthread_mutex_lock(&source->async_mutex);
+	os_mutex_lock(&source->async_mutex);
 	if (source->prev_async_frame) {
 		remove_async_frame(source, source->prev_async_frame);
 		source->prev_async_frame = NULL;
 	}
-	pthread_mutex_unlock(&source->async_mutex);
+	os_mutex_unlock(&source->async_mutex);
 
 	obs_leave_graphics();
 }
@@ -477,11 +545,14 @@ static void disable_deinterlacing(obs_source_t *source)
 	gs_texture_destroy(source->async_prev_textures[1]);
 	gs_texture_destroy(source->async_prev_textures[2]);
 	gs_texrender_destroy(source->async_prev_texrender);
+	gs_texrender_destroy(source->deinterlace_texrender);
 	source->deinterlace_mode = OBS_DEINTERLACE_MODE_DISABLE;
 	source->async_prev_textures[0] = NULL;
 	source->async_prev_textures[1] = NULL;
 	source->async_prev_textures[2] = NULL;
 	source->async_prev_texrender = NULL;
+	source->deinterlace_texrender = NULL;
+	source->deinterlace_cache_valid = false;
 	obs_leave_graphics();
 }
 
@@ -501,6 +572,7 @@ void obs_source_set_deinterlace_mode(obs_source_t *source,
 		obs_enter_graphics();
 		source->deinterlace_mode = mode;
 		source->deinterlace_effect = get_effect(mode);
+		source->deinterlace_cache_valid = false;
 		obs_leave_graphics();
 	}
 }
@@ -521,6 +593,7 @@ void obs_source_set_deinterlace_field_order(
 
 	source->deinterlace_top_first = field_order ==
 					OBS_DEINTERLACE_FIELD_ORDER_TOP;
+	source->deinterlace_cache_valid = false;
 }
 
 enum obs_deinterlace_field_order
@@ -664,15 +664,64 @@ void obs_transition_enum_sources(obs_source_t *transition,
 	unlock_transition(transition);
 }
 
+static bool child_video_static(obs_source_t *child, long *generation)
+{
+	bool is_static;
+
+	if (child->info.type != OBS_SOURCE_TYPE_SCENE)
+		return false;
+
+	pthread_mutex_lock(&child->filter_mutex);
+	is_static = !child->filters.num;
+	pthread_mutex_unlock(&child->filter_mutex);
+
+	if (!is_static || !obs_scene_video_static(child))
+		return false;
+
+	*generation = os_atomic_load_long(&child->video_generation);
+	return true;
+}
+
+static bool snapshot_usable(obs_source_t *transition, obs_source_t *child,
+			    size_t idx, uint32_t cx, uint32_t cy,
+			    enum gs_color_space space, bool frozen,
+			    long *generation)
+{
+	const struct transition_snapshot *snapshot =
+		&transition->transition_snapshots[idx];
+	bool is_static = child_video_static(child, generation);
+
+	if (snapshot->source != child || snapshot->cx != cx ||
+	    snapshot->cy != cy || snapshot->space != space)
+		return false;
+	if (memcmp(&snapshot->matrix, &transition->transition_matrices[idx],
+		   sizeof(struct matrix4)) != 0)
+		return false;
+
+	if (frozen && snapshot->start_time == transition->transition_start_time)
+		return true;
+	return is_static && snapshot->generation == *generation;
+}
+
 static inline void render_child(obs_source_t *transition, obs_source_t *child,
-				size_t idx, enum gs_color_space space)
+				size_t idx, enum gs_color_space space,
+				bool frozen)
 {
+	struct transition_snapshot *snapshot =
+		&transition->transition_snapshots[idx];
 	uint32_t cx = get_cx(transition);
 	uint32_t cy = get_cy(transition);
+	long generation = 0;
 	struct vec4 blank;
 	if (!child)
 		return;
 
+	/* static scenes and frozen sources keep the texture they were last
+	 * rendered to */
+	if (snapshot_usable(transition, child, idx, cx, cy, space, frozen,
+			    &generation))
+		return;
+
 	enum gs_color_format format = gs_get_format_from_space(space);
 	if (gs_texrender_get_format(transition->transition_texrender[idx]) !=
 	    format) {
@@ -693,9 +742,32 @@ static inline void render_child(obs_source_t *transition, obs_source_t *child,
 		gs_matrix_pop();
 
 		gs_texrender_end(transition->transition_texrender[idx]);
+
+		snapshot->source = child;
+		snapshot->generation = generation;
+		snapshot->start_time = transition->transition_start_time;
+		snapshot->matrix = transition->transition_matrices[idx];
+		snapshot->cx = cx;
+		snapshot->cy = cy;
+		snapshot->space = space;
+	} else {
+		snapshot->source = NULL;
 	}
 }
 
+static inline bool outgoing_frozen(obs_source_t *transition)
+{
+	uint64_t elapsed;
+
+	if (!transition->transition_freeze_outgoing)
+		return false;
+	if (!transition->transition_freeze_duration)
+		return true;
+
+	elapsed = obs->video.video_time - transition->transition_start_time;
+	return elapsed < transition->transition_freeze_duration;
+}
+
 static void obs_transition_stop(obs_source_t *transition)
 {
 	obs_source_t *old_child = transition->transition_sources[0];
@@ -776,10 +848,11 @@ void obs_transition_video_render2(
 		const enum gs_color_space source_space =
 			obs_source_get_color_space(transition, 1,
 						   &current_space);
+		const bool frozen = outgoing_frozen(transition);
 		for (size_t i = 0; i < 2; i++) {
 			if (state.s[i]) {
 				render_child(transition, state.s[i], i,
-					     source_space);
+					     source_space, frozen && i == 0);
 				tex[i] = get_texture(transition, i);
 				if (!tex[i])
 					tex[i] = placeholder_texture;
@@ -1067,9 +1140,11 @@ bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
 					      min_ts, mixers, channels,
 					      sample_rate, mix_b);
 		} else if (state.s[0]) {
-			memcpy(audio->output[0].data[0],
-			       state.s[0]->audio_output_buf[0][0],
-			       TOTAL_AUDIO_SIZE);
+			for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+				memcpy(audio->output[mix].data[0],
+				       get_audio_output_mix(state.s[0], mix)[0],
+				       AUDIO_OUTPUT_FRAMES * sizeof(float) *
+					       MAX_AUDIO_CHANNELS);
 		}
 
 		obs_source_release(state.s[0]);
@@ -1100,6 +1175,17 @@ bool obs_transition_fixed(obs_source_t *transition)
 		       : false;
 }
 
+void obs_transition_freeze_outgoing(obs_source_t *transition, bool enable,
+				    uint32_t duration_ms)
+{
+	if (!transition_valid(transition, "obs_transition_freeze_outgoing"))
+		return;
+
+	transition->transition_freeze_duration =
+		(uint64_t)duration_ms * 1000000ULL;
+	transition->transition_freeze_outgoing = enable;
+}
+
 static inline obs_source_t *
 copy_source_state(obs_source_t *tr_dest, obs_source_t *tr_source, size_t idx)
 {
@@ -1156,6 +1242,9 @@ void obs_transition_swap_end(obs_source_t *tr_dest, obs_source_t *tr_source)
 
 		tr_dest->transition_texrender[i] = source;
 		tr_source->transition_texrender[i] = dest;
+
+		tr_dest->transition_snapshots[i].source = NULL;
+		tr_source->transition_snapshots[i].source = NULL;
 	}
 
 	unlock_textures(tr_dest);
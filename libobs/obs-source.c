@@ -21,6 +21,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-math.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/util_uint64.h"
@@ -52,13 +53,20 @@ static inline bool destroying(const struct obs_source *source)
 
 struct obs_source_info *get_source_info(const char *id)
 {
-	for (size_t i = 0; i < obs->source_types.num; i++) {
-		struct obs_source_info *info = &obs->source_types.array[i];
-		if (strcmp(info->id, id) == 0)
-			return info;
-	}
+	size_t idx;
 
-	return NULL;
+	if (!obs_type_index_find(obs->source_type_index, id, &idx))
+		return NULL;
+
+	return &obs->source_types.array[idx];
+}
+
+static obs_module_t *get_source_info_module(const struct obs_source_info *info)
+{
+	size_t idx = (size_t)(info - obs->source_types.array);
+	return idx < obs->source_type_modules.num
+		       ? obs->source_type_modules.array[idx]
+		       : NULL;
 }
 
 struct obs_source_info *get_source_info2(const char *unversioned_id,
@@ -95,6 +103,7 @@ static const char *source_signals[] = {
 	"void update_properties(ptr source)",
 	"void update_flags(ptr source, int flags)",
 	"void audio_sync(ptr source, int out int offset)",
+	"void audio_filter_latency(ptr source, int latency)",
 	"void audio_balance(ptr source, in out float balance)",
 	"void audio_mixers(ptr source, in out int mixers)",
 	"void audio_monitoring(ptr source, int type)",
@@ -114,6 +123,9 @@ static const char *source_signals[] = {
 	"void media_previous(ptr source)",
 	"void media_started(ptr source)",
 	"void media_ended(ptr source)",
+	"void preload_ready(ptr source)",
+	"void preload_timeout(ptr source)",
+	"void gpu_memory_exceeded(ptr source, int bytes, int budget)",
 	NULL,
 };
 
@@ -144,6 +156,7 @@ static void allocate_audio_output_buffer(struct obs_source *source)
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		size_t mix_pos = mix * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
 
+		source->audio_output_mix[mix] = mix;
 		for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 			source->audio_output_buf[mix][i] =
 				ptr + mix_pos + AUDIO_OUTPUT_FRAMES * i;
@@ -188,7 +201,7 @@ static bool obs_source_init(struct obs_source *source)
 	source->balance = 0.5f;
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
-	pthread_mutex_init_value(&source->async_mutex);
+	os_mutex_init_value(&source->async_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
@@ -205,10 +218,12 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->audio_mutex, NULL) != 0)
 		return false;
-	if (pthread_mutex_init_recursive(&source->async_mutex) != 0)
+	if (os_mutex_init_recursive(&source->async_mutex, "async_mutex") != 0)
 		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
+
+	source->gpu_memory = gs_memory_owner_create();
 	if (pthread_mutex_init(&source->media_actions_mutex, NULL) != 0)
 		return false;
 
@@ -235,7 +250,7 @@ static bool obs_source_init(struct obs_source *source)
 static void obs_source_init_finalize(struct obs_source *source)
 {
 	if (is_audio_source(source)) {
-		pthread_mutex_lock(&obs->data.audio_sources_mutex);
+		os_mutex_lock(&obs->data.audio_sources_mutex);
 
 		source->next_audio_source = obs->data.first_audio_source;
 		source->prev_next_audio_source = &obs->data.first_audio_source;
@@ -244,7 +259,7 @@ static void obs_source_init_finalize(struct obs_source *source)
 				&source->next_audio_source;
 		obs->data.first_audio_source = source;
 
-		pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+		os_mutex_unlock(&obs->data.audio_sources_mutex);
 	}
 
 	if (!source->context.private) {
@@ -254,6 +269,10 @@ static void obs_source_init_finalize(struct obs_source *source)
 	}
 	obs_context_data_insert_uuid(&source->context, &obs->data.sources_mutex,
 				     &obs->data.sources);
+
+	/* every source gets at least one tick, which drops it from the tick
+	 * list again if it is neither showing nor active */
+	obs_source_request_tick(source);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id,
@@ -289,7 +308,7 @@ static bool obs_source_hotkey_unmute(void *data, obs_hotkey_pair_id id,
 static void obs_source_hotkey_push_to_mute(void *data, obs_hotkey_id id,
 					   obs_hotkey_t *key, bool pressed)
 {
-	struct audio_action action = {.timestamp = os_gettime_ns(),
+	struct audio_action action = {.timestamp = obs_get_clock_ns(),
 				      .type = AUDIO_ACTION_PTM,
 				      .set = pressed};
 
@@ -308,7 +327,7 @@ static void obs_source_hotkey_push_to_mute(void *data, obs_hotkey_id id,
 static void obs_source_hotkey_push_to_talk(void *data, obs_hotkey_id id,
 					   obs_hotkey_t *key, bool pressed)
 {
-	struct audio_action action = {.timestamp = os_gettime_ns(),
+	struct audio_action action = {.timestamp = obs_get_clock_ns(),
 				      .type = AUDIO_ACTION_PTT,
 				      .set = pressed};
 
@@ -363,6 +382,7 @@ obs_source_create_internal(const char *id, const char *name, const char *uuid,
 		source->info.unversioned_id = bstrdup(source->info.id);
 	} else {
 		source->info = *info;
+		source->module = get_source_info_module(info);
 
 		/* Always mark filters as private so they aren't found by
 		 * source enum/search functions.
@@ -399,10 +419,20 @@ obs_source_create_internal(const char *id, const char *name, const char *uuid,
 
 	/* allow the source to be created even if creation fails so that the
 	 * user's data doesn't become lost */
-	if (info && info->create)
-		source->context.data =
-			info->create(source->context.settings, source);
-	if ((!info || info->create) && !source->context.data)
+	if (info && info->create) {
+		if (defer_source_create &&
+		    info->type == OBS_SOURCE_TYPE_INPUT) {
+			source->create_state = DEFERRED_CREATE_PENDING;
+		} else {
+			gs_memory_owner_t *prev_owner =
+				gs_memory_set_owner(source->gpu_memory);
+			source->context.data =
+				info->create(source->context.settings, source);
+			gs_memory_set_owner(prev_owner);
+		}
+	}
+	if ((!info || info->create) && !source->context.data &&
+	    !source->create_state)
 		blog(LOG_ERROR, "Failed to create source '%s'!", name);
 
 	blog(LOG_DEBUG, "%ssource '%s' (%s) created", private ? "private " : "",
@@ -410,6 +440,7 @@ obs_source_create_internal(const char *id, const char *name, const char *uuid,
 
 	source->flags = source->default_flags;
 	source->enabled = true;
+	source->render_divisor = 1;
 
 	obs_source_init_finalize(source);
 	if (!private) {
@@ -424,6 +455,33 @@ fail:
 	return NULL;
 }
 
+/* returns false if the source was not deferred or is already being created
+ * on another thread */
+bool obs_source_create_deferred(obs_source_t *source)
+{
+	if (!os_atomic_compare_swap_long(&source->create_state,
+					 DEFERRED_CREATE_PENDING,
+					 DEFERRED_CREATE_RUNNING))
+		return false;
+
+	gs_memory_owner_t *prev_owner = gs_memory_set_owner(source->gpu_memory);
+	source->context.data =
+		source->info.create(source->context.settings, source);
+	gs_memory_set_owner(prev_owner);
+	if (source->context.data)
+		obs_source_load2(source);
+	else
+		blog(LOG_ERROR, "Failed to create source '%s'!",
+		     source->context.name);
+
+	blog(LOG_DEBUG, "deferred source '%s' (%s) created",
+	     source->context.name, source->info.id);
+
+	/* show/activate are called on the next tick */
+	os_atomic_set_long(&source->create_state, DEFERRED_CREATE_NONE);
+	return true;
+}
+
 obs_source_t *obs_source_create(const char *id, const char *name,
 				obs_data_t *settings, obs_data_t *hotkey_data)
 {
@@ -618,10 +676,35 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
-static inline void obs_source_frame_decref(struct obs_source_frame *frame)
+static void async_frame_destroy(obs_source_t *source,
+				struct obs_source_frame *frame)
+{
+	for (size_t i = 0; i < source->async_external.num; i++) {
+		struct async_external_frame ef = source->async_external.array[i];
+		if (ef.frame != frame)
+			continue;
+
+		/* make sure no stale pointer to the frame is left behind */
+		if (source->cur_async_frame == frame)
+			source->cur_async_frame = NULL;
+		if (source->prev_async_frame == frame)
+			source->prev_async_frame = NULL;
+		da_erase_item(source->async_frames, &frame);
+
+		da_erase(source->async_external, i);
+		ef.release(ef.param);
+		bfree(frame);
+		return;
+	}
+
+	obs_source_frame_destroy(frame);
+}
+
+static inline void obs_source_frame_decref(obs_source_t *source,
+					   struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(source, frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -654,14 +737,16 @@ void obs_source_destroy(struct obs_source *source)
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_clear(source);
 
-	pthread_mutex_lock(&obs->data.audio_sources_mutex);
+	obs_source_set_latency_probe(source, false);
+
+	os_mutex_lock(&obs->data.audio_sources_mutex);
 	if (source->prev_next_audio_source) {
 		*source->prev_next_audio_source = source->next_audio_source;
 		if (source->next_audio_source)
 			source->next_audio_source->prev_next_audio_source =
 				source->prev_next_audio_source;
 	}
-	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+	os_mutex_unlock(&obs->data.audio_sources_mutex);
 
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
@@ -704,13 +789,21 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
 	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+		obs_source_frame_decref(source,
+					source->async_cache.array[i].frame);
+	for (i = 0; i < source->async_external.num; i++) {
+		struct async_external_frame *ef =
+			&source->async_external.array[i];
+		ef->release(ef->param);
+		bfree(ef->frame);
+	}
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
 		gs_texrender_destroy(source->async_texrender);
 	if (source->async_prev_texrender)
 		gs_texrender_destroy(source->async_prev_texrender);
+	gs_texrender_destroy(source->deinterlace_texrender);
 	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
 		gs_texture_destroy(source->async_textures[c]);
 		gs_texture_destroy(source->async_prev_textures[c]);
@@ -719,8 +812,11 @@ static void obs_source_destroy_defer(struct obs_source *source)
 		gs_texrender_destroy(source->filter_texrender);
 	if (source->color_space_texrender)
 		gs_texrender_destroy(source->color_space_texrender);
+	gs_texrender_destroy(source->divisor_texrender);
 	gs_leave_context();
 
+	gs_memory_owner_release(source->gpu_memory);
+
 	for (i = 0; i < MAX_AV_PLANES; i++)
 		bfree(source->audio_data.data[i]);
 	for (i = 0; i < MAX_AUDIO_CHANNELS; i++)
@@ -738,8 +834,12 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->audio_cb_list);
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
+	da_free(source->async_external);
 	da_free(source->async_frames);
 	da_free(source->filters);
+	metric_release(source->async_depth_metric);
+	metric_release(source->async_late_metric);
+	metric_release(source->async_dropped_metric);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
 	pthread_mutex_destroy(&source->audio_actions_mutex);
@@ -747,7 +847,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_cb_mutex);
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
-	pthread_mutex_destroy(&source->async_mutex);
+	os_mutex_destroy(&source->async_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
@@ -941,6 +1041,10 @@ bool obs_source_configurable(const obs_source_t *source)
 
 obs_properties_t *obs_source_properties(const obs_source_t *source)
 {
+	/* the properties need the source's data, so create it now */
+	if (source && os_atomic_load_long(&source->create_state))
+		obs_source_create_deferred((obs_source_t *)source);
+
 	if (!data_valid(source, "obs_source_properties"))
 		return NULL;
 
@@ -978,10 +1082,14 @@ static void obs_source_deferred_update(obs_source_t *source)
 {
 	if (source->context.data && source->info.update) {
 		long count = os_atomic_load_long(&source->defer_update_count);
+		gs_memory_owner_t *prev_owner =
+			gs_memory_set_owner(source->gpu_memory);
 		source->info.update(source->context.data,
 				    source->context.settings);
+		gs_memory_set_owner(prev_owner);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
+		os_atomic_inc_long(&source->video_generation);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -997,9 +1105,13 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 
 	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
 		os_atomic_inc_long(&source->defer_update_count);
+		obs_source_request_tick(source);
 	} else if (source->context.data && source->info.update) {
+		gs_memory_owner_t *prev_owner =
+			gs_memory_set_owner(source->gpu_memory);
 		source->info.update(source->context.data,
 				    source->context.settings);
+		gs_memory_set_owner(prev_owner);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -1103,17 +1215,97 @@ void obs_source_set_texcoords_centered(obs_source_t *source, bool centered)
 	source->texcoords_centered = centered;
 }
 
-static void activate_source(obs_source_t *source)
+void obs_source_mark_video_dirty(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_mark_video_dirty"))
+		return;
+
+	os_atomic_inc_long(&source->video_generation);
+}
+
+void obs_source_set_render_divisor(obs_source_t *source, uint32_t divisor)
+{
+	if (!obs_source_valid(source, "obs_source_set_render_divisor"))
+		return;
+
+	source->render_divisor = divisor ? divisor : 1;
+	os_atomic_inc_long(&source->video_generation);
+}
+
+uint32_t obs_source_get_render_divisor(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_render_divisor")
+		       ? source->render_divisor
+		       : 1;
+}
+
+uint64_t obs_source_get_gpu_memory(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_gpu_memory")
+		       ? gs_memory_owner_get_bytes(source->gpu_memory)
+		       : 0;
+}
+
+void obs_source_set_gpu_memory_budget(obs_source_t *source, uint64_t bytes)
+{
+	if (!obs_source_valid(source, "obs_source_set_gpu_memory_budget"))
+		return;
+
+	os_atomic_store_int64(&source->gpu_memory_budget, (int64_t)bytes);
+}
+
+uint64_t obs_source_get_gpu_memory_budget(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_gpu_memory_budget")
+		       ? (uint64_t)os_atomic_load_int64(
+				 &source->gpu_memory_budget)
+		       : 0;
+}
+
+struct module_gpu_memory {
+	obs_module_t *module;
+	uint64_t bytes;
+};
+
+static bool add_module_gpu_memory(void *param, obs_source_t *source)
+{
+	struct module_gpu_memory *data = param;
+	if (source->module == data->module)
+		data->bytes += gs_memory_owner_get_bytes(source->gpu_memory);
+	return true;
+}
+
+uint64_t obs_module_get_gpu_memory(obs_module_t *module)
+{
+	struct module_gpu_memory data = {module, 0};
+	obs_enum_all_sources(add_module_gpu_memory, &data);
+	return data.bytes;
+}
+
+uint64_t obs_get_gpu_memory_total(void)
+{
+	return gs_memory_get_total_bytes();
+}
+
+static void prime_source(obs_source_t *source)
 {
 	if (source->context.data && source->info.activate)
 		source->info.activate(source->context.data);
-	obs_source_dosignal(source, "source_activate", "activate");
 }
 
-static void deactivate_source(obs_source_t *source)
+static void unprime_source(obs_source_t *source)
 {
 	if (source->context.data && source->info.deactivate)
 		source->info.deactivate(source->context.data);
+}
+
+static void activate_source(obs_source_t *source)
+{
+	obs_source_dosignal(source, "source_activate", "activate");
+}
+
+static void deactivate_source(obs_source_t *source)
+{
 	obs_source_dosignal(source, "source_deactivate", "deactivate");
 }
 
@@ -1135,6 +1327,7 @@ static void activate_tree(obs_source_t *parent, obs_source_t *child,
 			  void *param)
 {
 	os_atomic_inc_long(&child->activate_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1144,6 +1337,27 @@ static void deactivate_tree(obs_source_t *parent, obs_source_t *child,
 			    void *param)
 {
 	os_atomic_dec_long(&child->activate_refs);
+	obs_source_request_tick(child);
+
+	UNUSED_PARAMETER(parent);
+	UNUSED_PARAMETER(param);
+}
+
+static void preload_tree(obs_source_t *parent, obs_source_t *child,
+			 void *param)
+{
+	os_atomic_inc_long(&child->preload_refs);
+	obs_source_request_tick(child);
+
+	UNUSED_PARAMETER(parent);
+	UNUSED_PARAMETER(param);
+}
+
+static void unpreload_tree(obs_source_t *parent, obs_source_t *child,
+			   void *param)
+{
+	os_atomic_dec_long(&child->preload_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1152,6 +1366,7 @@ static void deactivate_tree(obs_source_t *parent, obs_source_t *child,
 static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_inc_long(&child->show_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1160,6 +1375,7 @@ static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 static void hide_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_dec_long(&child->show_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1171,6 +1387,7 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		return;
 
 	os_atomic_inc_long(&source->show_refs);
+	obs_source_request_tick(source);
 	obs_source_enum_active_tree(source, show_tree, NULL);
 
 	if (type == MAIN_VIEW) {
@@ -1179,6 +1396,22 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 	}
 }
 
+static void add_preload_ref(obs_source_t *source)
+{
+	os_atomic_inc_long(&source->preload_refs);
+	obs_source_request_tick(source);
+	obs_source_enum_active_tree(source, preload_tree, NULL);
+}
+
+static void remove_preload_ref(obs_source_t *source)
+{
+	if (os_atomic_load_long(&source->preload_refs) > 0) {
+		os_atomic_dec_long(&source->preload_refs);
+		obs_source_request_tick(source);
+		obs_source_enum_active_tree(source, unpreload_tree, NULL);
+	}
+}
+
 void obs_source_deactivate(obs_source_t *source, enum view_type type)
 {
 	if (!obs_source_valid(source, "obs_source_deactivate"))
@@ -1186,6 +1419,7 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 
 	if (os_atomic_load_long(&source->show_refs) > 0) {
 		os_atomic_dec_long(&source->show_refs);
+		obs_source_request_tick(source);
 		obs_source_enum_active_tree(source, hide_tree, NULL);
 	}
 
@@ -1205,7 +1439,7 @@ static void filter_frame(obs_source_t *source,
 			 struct obs_source_frame **ref_frame)
 {
 	struct obs_source_frame *frame = *ref_frame;
-	if (frame) {
+	if (frame && !frame->gpu) {
 		os_atomic_inc_long(&frame->refs);
 		frame = filter_async_video(source, frame);
 		if (frame)
@@ -1272,7 +1506,7 @@ static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
-	pthread_mutex_lock(&source->async_mutex);
+	os_mutex_lock(&source->async_mutex);
 
 	if (deinterlacing_enabled(source)) {
 		deinterlace_process_last_frame(source, sys_time);
@@ -1283,9 +1517,13 @@ static void async_tick(obs_source_t *source)
 		}
 
 		source->cur_async_frame = get_closest_frame(source, sys_time);
+		if (source->latency_probe && source->cur_async_frame)
+			obs_latency_capture(source->cur_async_frame->timestamp);
 	}
 
 	source->last_sys_timestamp = sys_time;
+	metric_set(source->async_depth_metric,
+		   (int64_t)source->async_frames.num);
 
 	if (deinterlacing_enabled(source))
 		filter_frame(source, &source->prev_async_frame);
@@ -1295,16 +1533,104 @@ static void async_tick(obs_source_t *source)
 		source->async_update_texture =
 			set_async_texture_size(source, source->cur_async_frame);
 
-	pthread_mutex_unlock(&source->async_mutex);
+	os_mutex_unlock(&source->async_mutex);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+void obs_source_request_tick(obs_source_t *source)
 {
-	bool now_showing, now_active;
+	struct obs_core_data *data = &obs->data;
+	obs_weak_source_t *weak;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
+	if (os_atomic_set_bool(&source->tick_registered, true))
+		return;
+
+	weak = obs_source_get_weak_source(source);
+
+	pthread_mutex_lock(&data->tick_mutex);
+	da_push_back(data->tick_pending, &weak);
+	pthread_mutex_unlock(&data->tick_mutex);
+}
+
+static inline bool showing_or_active(obs_source_t *source)
+{
+	return source->showing || source->active || source->primed ||
+	       os_atomic_load_long(&source->show_refs) > 0 ||
+	       os_atomic_load_long(&source->activate_refs) > 0 ||
+	       os_atomic_load_long(&source->preload_refs) > 0;
+}
+
+static bool has_media_actions(obs_source_t *source)
+{
+	bool pending;
+
+	if ((source->info.output_flags & OBS_SOURCE_CONTROLLABLE_MEDIA) == 0)
+		return false;
+
+	pthread_mutex_lock(&source->media_actions_mutex);
+	pending = source->media_actions.num > 0;
+	pthread_mutex_unlock(&source->media_actions_mutex);
+	return pending;
+}
+
+/* async sources keep their frame queue drained and transitions keep their
+ * timing going even while nobody looks at them, everything else only needs
+ * to be ticked while it's shown, active, or has something pending */
+bool obs_source_needs_tick(obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+
+	if ((flags & (OBS_SOURCE_ALWAYS_TICK | OBS_SOURCE_ASYNC)) != 0)
+		return true;
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return true;
+	if (showing_or_active(source))
+		return true;
+	if (os_atomic_load_long(&source->defer_update_count) > 0)
+		return true;
+	if (has_media_actions(source))
+		return true;
+
+	/* filters are shown and activated along with their parent */
+	obs_source_t *parent = source->filter_parent;
+	return parent && showing_or_active(parent);
+}
+
+static void check_gpu_memory_budget(obs_source_t *source)
+{
+	int64_t budget = os_atomic_load_int64(&source->gpu_memory_budget);
+	uint64_t bytes = gs_memory_owner_get_bytes(source->gpu_memory);
+	bool exceeded = budget > 0 && bytes > (uint64_t)budget;
+
+	if (exceeded == source->gpu_memory_exceeded)
+		return;
+
+	source->gpu_memory_exceeded = exceeded;
+	if (!exceeded)
 		return;
 
+	struct calldata data;
+	uint8_t stack[128];
+
+	blog(LOG_WARNING,
+	     "Source '%s' is using %" PRIu64 " bytes of GPU memory, "
+	     "over its budget of %" PRId64 " bytes",
+	     source->context.name, bytes, budget);
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
+	calldata_set_ptr(&data, "source", source);
+	calldata_set_int(&data, "bytes", (long long)bytes);
+	calldata_set_int(&data, "budget", (long long)budget);
+
+	signal_handler_signal(source->context.signals, "gpu_memory_exceeded",
+			      &data);
+}
+
+static bool source_video_tick(obs_source_t *source, float seconds,
+			      bool parallel)
+{
+	bool now_showing, now_active, now_primed, created;
+	bool deferred = false;
+
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
 
@@ -1321,8 +1647,13 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	if (source->filter_texrender)
 		gs_texrender_reset(source->filter_texrender);
 
+	/* sources waiting for deferred creation are shown and activated once
+	 * they have been created */
+	created = os_atomic_load_long(&source->create_state) ==
+		  DEFERRED_CREATE_NONE;
+
 	/* call show/hide if the reference changed */
-	now_showing = !!source->show_refs;
+	now_showing = created ? !!source->show_refs : source->showing;
 	if (now_showing != source->showing) {
 		if (now_showing) {
 			show_source(source);
@@ -1336,6 +1667,7 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 					source->filters.array[i - 1];
 				if (now_showing) {
 					show_source(filter);
+					obs_source_request_tick(filter);
 				} else {
 					hide_source(filter);
 				}
@@ -1345,8 +1677,34 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->showing = now_showing;
 	}
 
-	/* call activate/deactivate if the reference changed */
-	now_active = !!source->activate_refs;
+	/* call activate/deactivate if the reference changed.  preloaded
+	 * sources get the callbacks without being signalled as active */
+	now_active = created ? !!source->activate_refs : source->active;
+	now_primed = created ? now_active || !!source->preload_refs
+			     : source->primed;
+	if (now_primed != source->primed) {
+		if (now_primed) {
+			prime_source(source);
+		} else {
+			unprime_source(source);
+		}
+
+		if (source->filters.num) {
+			for (size_t i = source->filters.num; i > 0; i--) {
+				obs_source_t *filter =
+					source->filters.array[i - 1];
+				if (now_primed) {
+					prime_source(filter);
+					obs_source_request_tick(filter);
+				} else {
+					unprime_source(filter);
+				}
+			}
+		}
+
+		source->primed = now_primed;
+	}
+
 	if (now_active != source->active) {
 		if (now_active) {
 			activate_source(source);
@@ -1360,6 +1718,7 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 					source->filters.array[i - 1];
 				if (now_active) {
 					activate_source(filter);
+					obs_source_request_tick(filter);
 				} else {
 					deactivate_source(filter);
 				}
@@ -1369,11 +1728,39 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
-		source->info.video_tick(source->context.data, seconds);
+	if (source->context.data && source->info.video_tick) {
+		if (parallel && (source->info.output_flags &
+				 OBS_SOURCE_PARALLEL_TICK) != 0) {
+			deferred = true;
+		} else {
+			gs_memory_owner_t *prev_owner =
+				gs_memory_set_owner(source->gpu_memory);
+			source->info.video_tick(source->context.data, seconds);
+			gs_memory_set_owner(prev_owner);
+		}
+	}
+
+	check_gpu_memory_budget(source);
 
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
+	return deferred;
+}
+
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	source_video_tick(source, seconds, false);
+}
+
+bool obs_source_video_tick_parallel(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick_parallel"))
+		return false;
+
+	return source_video_tick(source, seconds, true);
 }
 
 /* unless the value is 3+ hours worth of frames, this won't overflow */
@@ -1540,7 +1927,7 @@ static void source_output_audio_data(obs_source_t *source,
 	size_t sample_rate = audio_output_get_sample_rate(obs->audio.audio);
 	struct audio_data in = *data;
 	uint64_t diff;
-	uint64_t os_time = os_gettime_ns();
+	uint64_t os_time = obs_get_clock_ns();
 	int64_t sync_offset;
 	bool using_direct_ts = false;
 	bool push_back = false;
@@ -1564,7 +1951,7 @@ static void source_output_audio_data(obs_source_t *source,
 			handle_ts_jump(source, source->next_audio_ts_min,
 				       in.timestamp, diff, os_time);
 		else if (diff < TS_SMOOTHING_THRESHOLD) {
-			if (source->async_unbuffered && source->async_decoupled)
+			if (async_unbuffered(source) && source->async_decoupled)
 				source->timing_adjust = os_time - in.timestamp;
 			in.timestamp = source->next_audio_ts_min;
 		} else {
@@ -1604,7 +1991,10 @@ static void source_output_audio_data(obs_source_t *source,
 		}
 	}
 
-	sync_offset = source->sync_offset;
+	/* audio that comes out of the filters late is moved back to where it
+	 * was captured, the same way a negative sync offset would */
+	sync_offset = source->sync_offset -
+		      (int64_t)source->audio_filter_latency;
 	in.timestamp += sync_offset;
 	in.timestamp -= source->resample_offset;
 
@@ -2121,6 +2511,7 @@ bool set_async_texture_size(struct obs_source *source,
 	source->async_trc = frame->trc;
 
 	gs_enter_context(obs->video.graphics);
+	gs_memory_owner_t *prev_owner = gs_memory_set_owner(source->gpu_memory);
 
 	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
 		gs_texture_destroy(source->async_textures[c]);
@@ -2131,8 +2522,11 @@ bool set_async_texture_size(struct obs_source *source,
 
 	gs_texrender_destroy(source->async_texrender);
 	gs_texrender_destroy(source->async_prev_texrender);
+	gs_texrender_destroy(source->deinterlace_texrender);
 	source->async_texrender = NULL;
 	source->async_prev_texrender = NULL;
+	source->deinterlace_texrender = NULL;
+	source->deinterlace_cache_valid = false;
 
 	const enum gs_color_format format =
 		convert_video_format(frame->format, frame->trc);
@@ -2158,6 +2552,7 @@ bool set_async_texture_size(struct obs_source *source,
 	if (deinterlacing_enabled(source))
 		set_deinterlace_texture_size(source);
 
+	gs_memory_set_owner(prev_owner);
 	gs_leave_context();
 
 	return source->async_textures[0] != NULL;
@@ -2375,13 +2770,16 @@ static inline void set_eparami(gs_effect_t *effect, const char *name, int val)
 static bool update_async_texrender(struct obs_source *source,
 				   const struct obs_source_frame *frame,
 				   gs_texture_t *tex[MAX_AV_PLANES],
-				   gs_texrender_t *texrender)
+				   gs_texrender_t *texrender, bool upload)
 {
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_CONVERT_FORMAT, "Convert Format");
 
 	gs_texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
+	/* GPU frames are converted straight from the imported planes, and
+	 * batched uploads have already been copied into the textures */
+	if (upload)
+		upload_raw_frame(tex, frame);
 
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
@@ -2492,6 +2890,49 @@ bool update_async_texture(struct obs_source *source,
 	return update_async_textures(source, frame, tex3, texrender);
 }
 
+static bool update_async_gpu_textures(struct obs_source *source,
+				      const struct obs_source_frame *frame,
+				      gs_texture_t *tex[MAX_AV_PLANES],
+				      gs_texrender_t *texrender)
+{
+	gs_texture_t *planes[MAX_AV_PLANES] = {0};
+	obs_source_frame_import_t import = NULL;
+	void *param = NULL;
+	bool success = false;
+
+	os_mutex_lock(&source->async_mutex);
+	for (size_t i = 0; i < source->async_external.num; i++) {
+		struct async_external_frame *ef =
+			&source->async_external.array[i];
+		if (ef->frame == frame) {
+			import = ef->import;
+			param = ef->param;
+			break;
+		}
+	}
+	os_mutex_unlock(&source->async_mutex);
+
+	/* the frame stays referenced while it is being rendered, so the
+	 * import parameter remains valid after unlocking */
+	if (!import || !import(param, planes))
+		return false;
+
+	if (source->async_gpu_conversion && texrender) {
+		success = update_async_texrender(source, frame, planes,
+						 texrender, false);
+	} else if (get_convert_type(frame->format, frame->full_range,
+				    frame->trc) == CONVERT_NONE &&
+		   planes[0]) {
+		gs_copy_texture(tex[0], planes[0]);
+		success = true;
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		gs_texture_destroy(planes[i]);
+
+	return success;
+}
+
 bool update_async_textures(struct obs_source *source,
 			   const struct obs_source_frame *frame,
 			   gs_texture_t *tex[MAX_AV_PLANES],
@@ -2503,8 +2944,13 @@ bool update_async_textures(struct obs_source *source,
 	source->async_linear_alpha =
 		(frame->flags & OBS_SOURCE_FRAME_LINEAR_ALPHA) != 0;
 
+	if (frame->gpu)
+		return update_async_gpu_textures(source, frame, tex,
+						 texrender);
+
 	if (source->async_gpu_conversion && texrender)
-		return update_async_texrender(source, frame, tex, texrender);
+		return update_async_texrender(source, frame, tex, texrender,
+					      true);
 
 	type = get_convert_type(frame->format, frame->full_range, frame->trc);
 	if (type == CONVERT_NONE) {
@@ -2568,22 +3014,31 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source,
 	}
 }
 
-static void obs_source_update_async_video(obs_source_t *source)
+static struct obs_source_frame *begin_async_video(obs_source_t *source)
 {
-	if (!source->async_rendered) {
-		source->async_rendered = true;
+	struct obs_source_frame *frame;
 
-		struct obs_source_frame *frame = obs_source_get_frame(source);
-		if (frame) {
-			check_to_swap_bgrx_bgra(source, frame);
+	source->async_rendered = true;
 
-			if (!source->async_decoupled ||
-			    !source->async_unbuffered) {
-				source->timing_adjust = obs->video.video_time -
-							frame->timestamp;
-				source->timing_set = true;
-			}
+	frame = obs_source_get_frame(source);
+	if (frame) {
+		check_to_swap_bgrx_bgra(source, frame);
+
+		if (!source->async_decoupled || !async_unbuffered(source)) {
+			source->timing_adjust =
+				obs->video.video_time - frame->timestamp;
+			source->timing_set = true;
+		}
+	}
+
+	return frame;
+}
 
+static void obs_source_update_async_video(obs_source_t *source)
+{
+	if (!source->async_rendered) {
+		struct obs_source_frame *frame = begin_async_video(source);
+		if (frame) {
 			if (source->async_update_texture) {
 				update_async_textures(source, frame,
 						      source->async_textures,
@@ -2596,38 +3051,293 @@ static void obs_source_update_async_video(obs_source_t *source)
 	}
 }
 
-static void rotate_async_video(obs_source_t *source, long rotation)
+/* ------------------------------------------------------------------------- */
+/* Batched async frame uploads
+ *
+ * Rather than mapping, copying and unmapping the textures of each async
+ * source in turn as it is rendered, all textures that receive a new frame
+ * are mapped up front, the frame data is copied into them in row chunks
+ * split between the graphics thread and a few worker threads, and all of
+ * them are unmapped together before any source is rendered. */
+
+#define ASYNC_UPLOAD_CHUNK_ROWS 256
+
+struct async_frame_upload {
+	obs_source_t *source;
+	struct obs_source_frame *frame;
+	gs_texture_t *mapped[MAX_AV_PLANES];
+};
+
+struct async_upload_chunk {
+	uint8_t *dst;
+	const uint8_t *src;
+	uint32_t dst_linesize;
+	uint32_t src_linesize;
+	uint32_t rows;
+};
+
+struct async_upload_job {
+	struct async_upload_chunk *chunks;
+	size_t num;
+	volatile long next;
+};
+
+static inline bool can_batch_async_upload(const obs_source_t *source)
 {
-	float x = 0;
-	float y = 0;
+	return source->info.type == OBS_SOURCE_TYPE_INPUT &&
+	       (source->info.output_flags & OBS_SOURCE_ASYNC) != 0 &&
+	       source->show_refs && source->async_update_texture &&
+	       !source->async_rendered && !deinterlacing_enabled(source);
+}
 
-	switch (rotation) {
-	case 90:
-		y = (float)source->async_width;
-		break;
-	case 270:
-	case -90:
-		x = (float)source->async_height;
-		break;
-	case 180:
-		x = (float)source->async_width;
-		y = (float)source->async_height;
+/* drops the planes mapped so far, finish_async_upload then uploads the frame
+ * the regular way */
+static void cancel_async_upload(struct async_frame_upload *upload,
+				size_t first_chunk)
+{
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		if (upload->mapped[c]) {
+			gs_texture_unmap(upload->mapped[c]);
+			upload->mapped[c] = NULL;
+		}
 	}
 
-	gs_matrix_translate3f(x, y, 0);
-	gs_matrix_rotaa4f(0.0f, 0.0f, -1.0f, RAD((float)rotation));
+	da_resize(obs->video.async_upload_chunks, first_chunk);
 }
 
-static inline void obs_source_render_async_video(obs_source_t *source)
+static void map_async_upload(struct async_frame_upload *upload)
 {
-	if (source->async_textures[0] && source->async_active) {
-		const enum gs_color_space source_space = convert_video_space(
-			source->async_format, source->async_trc);
+	obs_source_t *source = upload->source;
+	const struct obs_source_frame *frame = upload->frame;
+	const size_t first_chunk = obs->video.async_upload_chunks.num;
+	size_t planes = MAX_AV_PLANES;
 
-		gs_effect_t *const effect =
-			obs_get_base_effect(OBS_EFFECT_DEFAULT);
-		const char *tech_name = "Draw";
-		float multiplier = 1.0;
+	if (frame->gpu)
+		return;
+
+	if (!source->async_gpu_conversion || !source->async_texrender) {
+		if (get_convert_type(frame->format, frame->full_range,
+				     frame->trc) != CONVERT_NONE)
+			return;
+		planes = 1;
+	}
+
+	for (size_t c = 0; c < planes; c++) {
+		struct obs_core_video *video = &obs->video;
+		gs_texture_t *tex = source->async_textures[c];
+		uint32_t linesize;
+		uint8_t *ptr;
+
+		if (!tex || !frame->data[c])
+			continue;
+		if (!gs_texture_map(tex, &ptr, &linesize)) {
+			/* the other planes would keep the previous frame */
+			cancel_async_upload(upload, first_chunk);
+			return;
+		}
+
+		upload->mapped[c] = tex;
+
+		const uint32_t height = gs_texture_get_height(tex);
+		for (uint32_t y = 0; y < height; y += ASYNC_UPLOAD_CHUNK_ROWS) {
+			struct async_upload_chunk *chunk =
+				da_push_back_new(video->async_upload_chunks);
+
+			chunk->dst = ptr + (size_t)y * linesize;
+			chunk->src = frame->data[c] +
+				     (size_t)y * frame->linesize[c];
+			chunk->dst_linesize = linesize;
+			chunk->src_linesize = frame->linesize[c];
+			chunk->rows = height - y;
+			if (chunk->rows > ASYNC_UPLOAD_CHUNK_ROWS)
+				chunk->rows = ASYNC_UPLOAD_CHUNK_ROWS;
+		}
+	}
+}
+
+static void copy_async_upload_chunks(void *param)
+{
+	struct async_upload_job *job = param;
+
+	for (;;) {
+		size_t idx = (size_t)os_atomic_inc_long(&job->next) - 1;
+		if (idx >= job->num)
+			break;
+
+		const struct async_upload_chunk *chunk = &job->chunks[idx];
+		const uint32_t row_copy =
+			chunk->src_linesize < chunk->dst_linesize
+				? chunk->src_linesize
+				: chunk->dst_linesize;
+
+		if (chunk->src_linesize == chunk->dst_linesize) {
+			memcpy(chunk->dst, chunk->src,
+			       (size_t)row_copy * chunk->rows);
+			continue;
+		}
+
+		uint8_t *dst = chunk->dst;
+		const uint8_t *src = chunk->src;
+		for (uint32_t y = 0; y < chunk->rows; y++) {
+			memcpy(dst, src, row_copy);
+			dst += chunk->dst_linesize;
+			src += chunk->src_linesize;
+		}
+	}
+}
+
+size_t create_upload_workers(struct obs_core_video *video)
+{
+	if (!video->num_upload_workers) {
+		size_t cores = (size_t)os_get_logical_cores();
+		size_t count = cores > 1 ? cores - 1 : 1;
+
+		if (count > MAX_UPLOAD_WORKERS)
+			count = MAX_UPLOAD_WORKERS;
+
+		for (size_t i = 0; i < count; i++) {
+			video->upload_workers[i] = os_task_queue_create();
+			if (!video->upload_workers[i])
+				break;
+			video->num_upload_workers++;
+		}
+	}
+
+	return video->num_upload_workers;
+}
+
+static void copy_async_uploads(struct obs_core_video *video)
+{
+	struct async_upload_job job = {
+		.chunks = video->async_upload_chunks.array,
+		.num = video->async_upload_chunks.num,
+	};
+	size_t workers = 0;
+
+	if (job.num > 1)
+		create_upload_workers(video);
+
+	if (job.num > 1) {
+		workers = job.num - 1;
+		if (workers > video->num_upload_workers)
+			workers = video->num_upload_workers;
+	}
+
+	for (size_t i = 0; i < workers; i++)
+		os_task_queue_queue_task(video->upload_workers[i],
+					 copy_async_upload_chunks, &job);
+
+	copy_async_upload_chunks(&job);
+
+	for (size_t i = 0; i < workers; i++)
+		os_task_queue_wait(video->upload_workers[i]);
+}
+
+static void finish_async_upload(struct async_frame_upload *upload)
+{
+	obs_source_t *source = upload->source;
+	struct obs_source_frame *frame = upload->frame;
+	bool uploaded = false;
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		if (upload->mapped[c]) {
+			gs_texture_unmap(upload->mapped[c]);
+			uploaded = true;
+		}
+	}
+
+	if (!uploaded) {
+		update_async_textures(source, frame, source->async_textures,
+				      source->async_texrender);
+	} else {
+		source->async_flip = frame->flip;
+		source->async_linear_alpha =
+			(frame->flags & OBS_SOURCE_FRAME_LINEAR_ALPHA) != 0;
+
+		if (source->async_gpu_conversion && source->async_texrender)
+			update_async_texrender(source, frame,
+					       source->async_textures,
+					       source->async_texrender, false);
+	}
+
+	source->async_update_texture = false;
+	obs_source_release_frame(source, frame);
+}
+
+void upload_async_frames(obs_source_t *const *sources, size_t num)
+{
+	struct obs_core_video *video = &obs->video;
+
+	da_resize(video->async_uploads, 0);
+	da_resize(video->async_upload_chunks, 0);
+
+	for (size_t i = 0; i < num; i++) {
+		if (can_batch_async_upload(sources[i])) {
+			struct async_frame_upload *upload =
+				da_push_back_new(video->async_uploads);
+			upload->source = sources[i];
+		}
+	}
+
+	if (!video->async_uploads.num)
+		return;
+
+	gs_enter_context(video->graphics);
+
+	for (size_t i = 0; i < video->async_uploads.num; i++) {
+		struct async_frame_upload *upload =
+			&video->async_uploads.array[i];
+
+		upload->frame = begin_async_video(upload->source);
+		if (upload->frame)
+			map_async_upload(upload);
+	}
+
+	if (video->async_upload_chunks.num)
+		copy_async_uploads(video);
+
+	for (size_t i = 0; i < video->async_uploads.num; i++) {
+		struct async_frame_upload *upload =
+			&video->async_uploads.array[i];
+		if (upload->frame)
+			finish_async_upload(upload);
+	}
+
+	gs_leave_context();
+}
+
+static void rotate_async_video(obs_source_t *source, long rotation)
+{
+	float x = 0;
+	float y = 0;
+
+	switch (rotation) {
+	case 90:
+		y = (float)source->async_width;
+		break;
+	case 270:
+	case -90:
+		x = (float)source->async_height;
+		break;
+	case 180:
+		x = (float)source->async_width;
+		y = (float)source->async_height;
+	}
+
+	gs_matrix_translate3f(x, y, 0);
+	gs_matrix_rotaa4f(0.0f, 0.0f, -1.0f, RAD((float)rotation));
+}
+
+static inline void obs_source_render_async_video(obs_source_t *source)
+{
+	if (source->async_textures[0] && source->async_active) {
+		const enum gs_color_space source_space = convert_video_space(
+			source->async_format, source->async_trc);
+
+		gs_effect_t *const effect =
+			obs_get_base_effect(OBS_EFFECT_DEFAULT);
+		const char *tech_name = "Draw";
+		float multiplier = 1.0;
 		const enum gs_color_space current_space = gs_get_color_space();
 		bool linear_srgb = gs_get_linear_srgb();
 		bool nonlinear_alpha = false;
@@ -2865,7 +3575,8 @@ static void source_render(obs_source_t *source, gs_effect_t *effect)
 
 		if (!source->color_space_texrender) {
 			source->color_space_texrender =
-				gs_texrender_create(format, GS_ZS_NONE);
+				gs_texrender_create_transient(format,
+							      GS_ZS_NONE);
 		}
 
 		gs_texrender_reset(source->color_space_texrender);
@@ -2987,7 +3698,7 @@ static const char *get_type_format(enum obs_source_type type)
 }
 #endif
 
-static inline void render_video(obs_source_t *source)
+static inline void render_video_internal(obs_source_t *source)
 {
 	if (source->info.type != OBS_SOURCE_TYPE_FILTER &&
 	    (source->info.output_flags & OBS_SOURCE_VIDEO) == 0) {
@@ -3014,6 +3725,8 @@ static inline void render_video(obs_source_t *source)
 				     get_type_format(source->info.type),
 				     obs_source_get_name(source));
 
+	size_t gpu_timer = obs_gpu_timing_begin_source(source);
+
 	if (source->filters.num && !source->rendering_filter)
 		obs_source_render_filters(source);
 
@@ -3029,9 +3742,170 @@ static inline void render_video(obs_source_t *source)
 	else
 		obs_source_render_async_video(source);
 
+	obs_gpu_timing_end_source(gpu_timer);
+
+	GS_DEBUG_MARKER_END();
+}
+
+/* textures created while rendering belong to the source being rendered,
+ * nested sources and filters set themselves as the owner in turn */
+static inline void render_video(obs_source_t *source)
+{
+	gs_memory_owner_t *prev_owner = gs_memory_set_owner(source->gpu_memory);
+	render_video_internal(source);
+	gs_memory_set_owner(prev_owner);
+}
+
+static inline bool is_sdr_space(enum gs_color_space space)
+{
+	return space == GS_CS_SRGB || space == GS_CS_SRGB_16F;
+}
+
+/* true if the source would be drawn by obs_source_default_render without a
+ * color space conversion, which would need a technique of its own */
+bool obs_source_can_batch_render(obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT ||
+	    (flags & OBS_SOURCE_VIDEO) == 0 ||
+	    (flags & (OBS_SOURCE_CUSTOM_DRAW | OBS_SOURCE_ASYNC)) != 0 ||
+	    !source->context.data || !source->enabled ||
+	    !source->info.video_render || source->filters.num ||
+	    source->render_divisor > 1)
+		return false;
+
+	const enum gs_color_space current_space = gs_get_color_space();
+	const enum gs_color_space source_space =
+		obs_source_get_color_space(source, 1, &current_space);
+
+	return source_space == current_space ||
+	       (is_sdr_space(source_space) && is_sdr_space(current_space));
+}
+
+/* draws a source that passed obs_source_can_batch_render while a pass of the
+ * default effect's Draw technique is already active */
+void obs_source_batch_render(obs_source_t *source, gs_effect_t *effect)
+{
+	const bool srgb_aware =
+		(source->info.output_flags & OBS_SOURCE_SRGB) != 0;
+	bool previous_srgb = false;
+
+	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_SOURCE,
+				     get_type_format(source->info.type),
+				     obs_source_get_name(source));
+
+	size_t gpu_timer = obs_gpu_timing_begin_source(source);
+
+	if (!srgb_aware) {
+		previous_srgb = gs_get_linear_srgb();
+		gs_set_linear_srgb(false);
+	}
+
+	source->info.video_render(source->context.data, effect);
+
+	if (!srgb_aware)
+		gs_set_linear_srgb(previous_srgb);
+
+	obs_gpu_timing_end_source(gpu_timer);
+
 	GS_DEBUG_MARKER_END();
 }
 
+static inline bool use_render_divisor(const obs_source_t *source)
+{
+	return source->render_divisor > 1 &&
+	       source->info.type != OBS_SOURCE_TYPE_FILTER &&
+	       (source->info.output_flags & OBS_SOURCE_VIDEO) != 0 &&
+	       !source->rendering_filter && source->context.data &&
+	       source->enabled;
+}
+
+/* draws a source with a render divisor from its last rendered texture, and
+ * renders it again once every divisor frames, when its video generation
+ * changed or when the size or color space no longer match */
+static bool render_video_divided(obs_source_t *source)
+{
+	const enum gs_color_space space = gs_get_color_space();
+	const uint32_t cx = obs_source_get_width(source);
+	const uint32_t cy = obs_source_get_height(source);
+	const uint32_t frame = obs->video.total_frames;
+	const long generation = os_atomic_load_long(&source->video_generation);
+
+	if (!cx || !cy)
+		return false;
+
+	if (source->divisor_texrender && source->divisor_space != space) {
+		gs_texrender_destroy(source->divisor_texrender);
+		source->divisor_texrender = NULL;
+	}
+
+	if (!source->divisor_texrender) {
+		source->divisor_texrender = gs_texrender_create(
+			gs_get_format_from_space(space), GS_ZS_NONE);
+		source->divisor_space = space;
+		source->divisor_valid = false;
+		if (!source->divisor_texrender)
+			return false;
+	}
+
+	gs_texture_t *tex = gs_texrender_get_texture(source->divisor_texrender);
+	if (!tex || gs_texture_get_width(tex) != cx ||
+	    gs_texture_get_height(tex) != cy ||
+	    source->divisor_generation != generation ||
+	    frame - source->divisor_frame >= source->render_divisor)
+		source->divisor_valid = false;
+
+	if (!source->divisor_valid) {
+		struct vec4 clear_color;
+
+		gs_texrender_reset(source->divisor_texrender);
+		if (!gs_texrender_begin_with_color_space(
+			    source->divisor_texrender, cx, cy, space))
+			return false;
+
+		gs_blend_state_push();
+		gs_blend_function_separate(GS_BLEND_SRCALPHA,
+					   GS_BLEND_INVSRCALPHA, GS_BLEND_ONE,
+					   GS_BLEND_INVSRCALPHA);
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		render_video(source);
+
+		gs_blend_state_pop();
+		gs_texrender_end(source->divisor_texrender);
+
+		source->divisor_valid = true;
+		source->divisor_frame = frame;
+		source->divisor_generation = generation;
+
+		tex = gs_texrender_get_texture(source->divisor_texrender);
+		if (!tex)
+			return false;
+	}
+
+	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_SOURCE, "Divided: %s",
+				     obs_source_get_name(source));
+
+	const bool previous = gs_set_linear_srgb(true);
+	gs_blend_state_push();
+	gs_blend_function_separate(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA,
+				   GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	gs_effect_t *effect = obs->video.default_effect;
+	while (gs_effect_loop(effect, "Draw"))
+		obs_source_draw(tex, 0, 0, 0, 0, 0);
+
+	gs_blend_state_pop();
+	gs_set_linear_srgb(previous);
+
+	GS_DEBUG_MARKER_END();
+	return true;
+}
+
 void obs_source_video_render(obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_video_render"))
@@ -3039,7 +3913,9 @@ void obs_source_video_render(obs_source_t *source)
 
 	source = obs_source_get_ref(source);
 	if (source) {
-		render_video(source);
+		if (!use_render_divisor(source) ||
+		    !render_video_divided(source))
+			render_video(source);
 		obs_source_release(source);
 	}
 }
@@ -3214,6 +4090,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_request_tick(filter);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3603,13 +4481,15 @@ static inline bool async_texture_changed(struct obs_source *source,
 
 static inline void free_async_cache(struct obs_source *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
-
-	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
 	source->cur_async_frame = NULL;
 	source->prev_async_frame = NULL;
+
+	for (size_t i = 0; i < source->async_cache.num; i++)
+		obs_source_frame_decref(source,
+					source->async_cache.array[i].frame);
+
+	da_resize(source->async_cache, 0);
 }
 
 #define MAX_UNUSED_FRAME_DURATION 5
@@ -3622,7 +4502,7 @@ static void clean_cache(obs_source_t *source)
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				async_frame_destroy(source, af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
@@ -3636,12 +4516,14 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 {
 	struct obs_source_frame *new_frame = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	os_mutex_lock(&source->async_mutex);
 
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		metric_add(source->async_dropped_metric,
+			   (int64_t)source->async_frames.num);
 		free_async_cache(source);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
+		os_mutex_unlock(&source->async_mutex);
 		return NULL;
 	}
 
@@ -3658,7 +4540,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && !af->external) {
 			new_frame = af->frame;
 			new_frame->format = format;
 			af->used = true;
@@ -3677,6 +4559,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.external = false;
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -3684,99 +4567,326 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 
 	os_atomic_inc_long(&new_frame->refs);
 
-	pthread_mutex_unlock(&source->async_mutex);
+	os_mutex_unlock(&source->async_mutex);
 
 	copy_frame_data(new_frame, frame);
 
 	return new_frame;
 }
 
+/* wraps frame data owned by the source instead of copying it, the returned
+ * frame takes the same references as one returned by cache_video */
+static inline struct obs_source_frame *
+cache_external_video(struct obs_source *source,
+		     const struct obs_source_frame *frame,
+		     obs_source_frame_import_t import,
+		     obs_source_frame_release_t release, void *param)
+{
+	struct obs_source_frame *new_frame;
+	struct async_external_frame ef;
+	struct async_frame new_af;
+
+	os_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		metric_add(source->async_dropped_metric,
+			   (int64_t)source->async_frames.num);
+		free_async_cache(source);
+		source->last_frame_ts = 0;
+		os_mutex_unlock(&source->async_mutex);
+		return NULL;
+	}
+
+	if (async_texture_changed(source, frame)) {
+		free_async_cache(source);
+		source->async_cache_width = frame->width;
+		source->async_cache_height = frame->height;
+	}
+
+	source->async_cache_format = frame->format;
+	source->async_cache_full_range = frame->full_range;
+	source->async_cache_trc = frame->trc;
+
+	clean_cache(source);
+
+	new_frame = bmalloc(sizeof(*new_frame));
+	*new_frame = *frame;
+	new_frame->refs = 2;
+	new_frame->prev_frame = false;
+	new_frame->gpu = import != NULL;
+	new_frame->external = true;
+
+	new_af.frame = new_frame;
+	new_af.used = true;
+	new_af.unused_count = 0;
+	new_af.external = true;
+	da_push_back(source->async_cache, &new_af);
+
+	ef.frame = new_frame;
+	ef.release = release;
+	ef.import = import;
+	ef.param = param;
+	da_push_back(source->async_external, &ef);
+
+	os_mutex_unlock(&source->async_mutex);
+
+	return new_frame;
+}
+
+#define ASYNC_TS_OFFSET_WINDOW 10000000000ULL
+
+static void update_async_ts_offset(obs_source_t *source, uint64_t timestamp)
+{
+	uint64_t now = os_gettime_ns();
+	int64_t offset = (int64_t)(now - timestamp);
+
+	/* new offsets that are lower are taken right away, higher ones only
+	 * once they have been the lowest for a whole window */
+	if (!source->async_ts_offset_set ||
+	    offset < source->async_ts_offset ||
+	    offset - source->async_ts_offset > (int64_t)MAX_TS_VAR) {
+		source->async_ts_offset = offset;
+		source->async_ts_offset_set = true;
+	}
+
+	if (!source->async_ts_offset_window ||
+	    offset < source->async_ts_offset_min)
+		source->async_ts_offset_min = offset;
+
+	if (!source->async_ts_offset_window) {
+		source->async_ts_offset_window = now;
+	} else if (now - source->async_ts_offset_window >=
+		   ASYNC_TS_OFFSET_WINDOW) {
+		source->async_ts_offset = source->async_ts_offset_min;
+		source->async_ts_offset_window = 0;
+	}
+}
+
+static void init_async_metrics(obs_source_t *source)
+{
+	struct dstr labels = {0};
+
+	metric_label_cat(&labels, "source", source->context.name);
+	source->async_depth_metric =
+		metric_get(METRIC_GAUGE, "obs_source_async_queue_depth",
+			   labels.array, "Async video frames queued");
+	source->async_late_metric = metric_get(
+		METRIC_COUNTER, "obs_source_async_late_frames_total",
+		labels.array, "Async video frames skipped for a newer frame");
+	source->async_dropped_metric = metric_get(
+		METRIC_COUNTER, "obs_source_async_dropped_frames_total",
+		labels.array, "Async video frames dropped from a full queue");
+	dstr_free(&labels);
+}
+
+static inline size_t async_max_frames(const obs_source_t *source)
+{
+	return source->async_max_frames ? source->async_max_frames
+					: MAX_ASYNC_FRAMES;
+}
+
+static void queue_async_frame(obs_source_t *source,
+			      struct obs_source_frame *output)
+{
+	os_mutex_lock(&source->async_mutex);
+	if (output) {
+		if (os_atomic_dec_long(&output->refs) == 0) {
+			async_frame_destroy(source, output);
+			output = NULL;
+		} else {
+			if (!source->async_depth_metric)
+				init_async_metrics(source);
+
+			update_async_ts_offset(source, output->timestamp);
+			da_push_back(source->async_frames, &output);
+			source->async_active = true;
+		}
+	}
+
+	/* with a lower maximum depth, the oldest frames make room for new
+	 * ones instead of the whole queue being reset */
+	while (source->async_frames.num > async_max_frames(source)) {
+		struct obs_source_frame *frame = source->async_frames.array[0];
+		da_erase(source->async_frames, 0);
+		remove_async_frame(source, frame);
+		metric_add(source->async_dropped_metric, 1);
+	}
+	os_mutex_unlock(&source->async_mutex);
+}
+
 static void
 obs_source_output_video_internal(obs_source_t *source,
 				 const struct obs_source_frame *frame)
 {
-	if (!obs_source_valid(source, "obs_source_output_video"))
-		return;
+	if (!obs_source_valid(source, "obs_source_output_video"))
+		return;
+
+	if (!frame) {
+		os_mutex_lock(&source->async_mutex);
+		source->async_active = false;
+		source->last_frame_ts = 0;
+		free_async_cache(source);
+		os_mutex_unlock(&source->async_mutex);
+		return;
+	}
+
+	struct obs_source_frame *output = cache_video(source, frame);
+	queue_async_frame(source, output);
+}
+
+void obs_source_output_video(obs_source_t *source,
+			     const struct obs_source_frame *frame)
+{
+	if (destroying(source))
+		return;
+	if (!frame) {
+		obs_source_output_video_internal(source, NULL);
+		return;
+	}
+
+	struct obs_source_frame new_frame = *frame;
+	new_frame.full_range =
+		format_is_yuv(frame->format) ? new_frame.full_range : true;
+
+	obs_source_output_video_internal(source, &new_frame);
+}
+
+static void convert_frame2(struct obs_source_frame *new_frame,
+			   const struct obs_source_frame2 *frame)
+{
+	enum video_range_type range =
+		resolve_video_range(frame->format, frame->range);
+
+	memset(new_frame, 0, sizeof(*new_frame));
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		new_frame->data[i] = frame->data[i];
+		new_frame->linesize[i] = frame->linesize[i];
+	}
+
+	new_frame->width = frame->width;
+	new_frame->height = frame->height;
+	new_frame->timestamp = frame->timestamp;
+	new_frame->format = frame->format;
+	new_frame->full_range = range == VIDEO_RANGE_FULL;
+	new_frame->max_luminance = 0;
+	new_frame->flip = frame->flip;
+	new_frame->flags = frame->flags;
+	new_frame->trc = frame->trc;
+
+	memcpy(&new_frame->color_matrix, &frame->color_matrix,
+	       sizeof(frame->color_matrix));
+	memcpy(&new_frame->color_range_min, &frame->color_range_min,
+	       sizeof(frame->color_range_min));
+	memcpy(&new_frame->color_range_max, &frame->color_range_max,
+	       sizeof(frame->color_range_max));
+}
+
+void obs_source_output_video2(obs_source_t *source,
+			      const struct obs_source_frame2 *frame)
+{
+	if (destroying(source))
+		return;
+	if (!frame) {
+		obs_source_output_video_internal(source, NULL);
+		return;
+	}
+
+	struct obs_source_frame new_frame;
+	convert_frame2(&new_frame, frame);
+
+	obs_source_output_video_internal(source, &new_frame);
+}
+
+void obs_source_output_video2_nocopy(obs_source_t *source,
+				     const struct obs_source_frame2 *frame,
+				     obs_source_frame_release_t release,
+				     void *param)
+{
+	struct obs_source_frame new_frame;
+	struct obs_source_frame *output;
 
-	if (!frame) {
-		pthread_mutex_lock(&source->async_mutex);
-		source->async_active = false;
-		source->last_frame_ts = 0;
-		free_async_cache(source);
-		pthread_mutex_unlock(&source->async_mutex);
+	if (!obs_ptr_valid(release, "obs_source_output_video2_nocopy"))
+		return;
+	if (!obs_source_valid(source, "obs_source_output_video2_nocopy") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video2_nocopy") ||
+	    destroying(source)) {
+		release(param);
 		return;
 	}
 
-	struct obs_source_frame *output = cache_video(source, frame);
+	convert_frame2(&new_frame, frame);
 
-	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
-	if (output) {
-		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
-			source->async_active = true;
-		}
-	}
-	pthread_mutex_unlock(&source->async_mutex);
+	output = cache_external_video(source, &new_frame, NULL, release,
+				      param);
+	if (output)
+		queue_async_frame(source, output);
+	else
+		release(param);
 }
 
-void obs_source_output_video(obs_source_t *source,
-			     const struct obs_source_frame *frame)
+void obs_source_output_video_nocopy(obs_source_t *source,
+				    const struct obs_source_frame *frame,
+				    obs_source_frame_release_t release,
+				    void *param)
 {
-	if (destroying(source))
+	struct obs_source_frame new_frame;
+	struct obs_source_frame *output;
+
+	if (!obs_ptr_valid(release, "obs_source_output_video_nocopy"))
 		return;
-	if (!frame) {
-		obs_source_output_video_internal(source, NULL);
+	if (!obs_source_valid(source, "obs_source_output_video_nocopy") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_nocopy") ||
+	    destroying(source)) {
+		release(param);
 		return;
 	}
 
-	struct obs_source_frame new_frame = *frame;
+	new_frame = *frame;
 	new_frame.full_range =
 		format_is_yuv(frame->format) ? new_frame.full_range : true;
 
-	obs_source_output_video_internal(source, &new_frame);
+	output = cache_external_video(source, &new_frame, NULL, release,
+				      param);
+	if (output)
+		queue_async_frame(source, output);
+	else
+		release(param);
 }
 
-void obs_source_output_video2(obs_source_t *source,
-			      const struct obs_source_frame2 *frame)
+void obs_source_output_video_gpu(obs_source_t *source,
+				 const struct obs_source_frame *frame,
+				 obs_source_frame_import_t import,
+				 obs_source_frame_release_t release,
+				 void *param)
 {
-	if (destroying(source))
+	struct obs_source_frame new_frame;
+	struct obs_source_frame *output;
+
+	if (!obs_ptr_valid(release, "obs_source_output_video_gpu"))
 		return;
-	if (!frame) {
-		obs_source_output_video_internal(source, NULL);
+	if (!obs_source_valid(source, "obs_source_output_video_gpu") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_gpu") ||
+	    !obs_ptr_valid(import, "obs_source_output_video_gpu") ||
+	    destroying(source)) {
+		release(param);
 		return;
 	}
 
-	struct obs_source_frame new_frame = {0};
-	enum video_range_type range =
-		resolve_video_range(frame->format, frame->range);
-
+	new_frame = *frame;
+	new_frame.full_range =
+		format_is_yuv(frame->format) ? new_frame.full_range : true;
 	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-		new_frame.data[i] = frame->data[i];
-		new_frame.linesize[i] = frame->linesize[i];
+		new_frame.data[i] = NULL;
+		new_frame.linesize[i] = 0;
 	}
 
-	new_frame.width = frame->width;
-	new_frame.height = frame->height;
-	new_frame.timestamp = frame->timestamp;
-	new_frame.format = frame->format;
-	new_frame.full_range = range == VIDEO_RANGE_FULL;
-	new_frame.max_luminance = 0;
-	new_frame.flip = frame->flip;
-	new_frame.flags = frame->flags;
-	new_frame.trc = frame->trc;
-
-	memcpy(&new_frame.color_matrix, &frame->color_matrix,
-	       sizeof(frame->color_matrix));
-	memcpy(&new_frame.color_range_min, &frame->color_range_min,
-	       sizeof(frame->color_range_min));
-	memcpy(&new_frame.color_range_max, &frame->color_range_max,
-	       sizeof(frame->color_range_max));
-
-	obs_source_output_video_internal(source, &new_frame);
+	output = cache_external_video(source, &new_frame, import, release,
+				      param);
+	if (output)
+		queue_async_frame(source, output);
+	else
+		release(param);
 }
 
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
@@ -3943,7 +5053,7 @@ void obs_source_show_preloaded_video(obs_source_t *source)
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 	sys_ts = (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY)
-			 ? os_gettime_ns()
+			 ? obs_get_clock_ns()
 			 : 0;
 	reset_audio_timing(source, source->last_frame_ts, sys_ts);
 	reset_audio_data(source, sys_ts);
@@ -4036,7 +5146,9 @@ void obs_source_set_video_frame2(obs_source_t *source,
 static inline struct obs_audio_data *
 filter_async_audio(obs_source_t *source, struct obs_audio_data *in)
 {
+	uint64_t latency = 0;
 	size_t i;
+
 	for (i = source->filters.num; i > 0; i--) {
 		struct obs_source *filter = source->filters.array[i - 1];
 
@@ -4048,9 +5160,25 @@ filter_async_audio(obs_source_t *source, struct obs_audio_data *in)
 						       in);
 			if (!in)
 				return NULL;
+
+			latency += filter->filter_latency;
 		}
 	}
 
+	if (source->audio_filter_latency != latency) {
+		struct calldata data;
+		uint8_t stack[128];
+
+		source->audio_filter_latency = latency;
+
+		calldata_init_fixed(&data, stack, sizeof(stack));
+		calldata_set_ptr(&data, "source", source);
+		calldata_set_int(&data, "latency", (long long)latency);
+
+		signal_handler_signal(source->context.signals,
+				      "audio_filter_latency", &data);
+	}
+
 	return in;
 }
 
@@ -4114,56 +5242,46 @@ static void copy_audio_data(obs_source_t *source, const uint8_t *const data[],
 		source->audio_storage_size = size;
 }
 
-/* TODO: SSE optimization */
 static void downmix_to_mono_planar(struct obs_source *source, uint32_t frames)
 {
 	size_t channels = audio_output_get_channels(obs->audio.audio);
 	const float channels_i = 1.0f / (float)channels;
 	float **data = (float **)source->audio_data.data;
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[0][frame] += data[channel][frame];
-	}
+	for (size_t channel = 1; channel < channels; channel++)
+		audio_mix_add(data[0], data[channel], frames);
 
-	for (uint32_t frame = 0; frame < frames; frame++)
-		data[0][frame] *= channels_i;
+	audio_mul(data[0], channels_i, frames);
 
-	for (size_t channel = 1; channel < channels; channel++) {
-		for (uint32_t frame = 0; frame < frames; frame++)
-			data[channel][frame] = data[0][frame];
-	}
+	for (size_t channel = 1; channel < channels; channel++)
+		memcpy(data[channel], data[0], frames * sizeof(float));
 }
 
 static void process_audio_balancing(struct obs_source *source, uint32_t frames,
 				    float balance, enum obs_balance_type type)
 {
 	float **data = (float **)source->audio_data.data;
+	float left, right;
 
 	switch (type) {
 	case OBS_BALANCE_TYPE_SINE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] *
-					 sinf((1.0f - balance) * (M_PI / 2.0f));
-			data[1][frame] =
-				data[1][frame] * sinf(balance * (M_PI / 2.0f));
-		}
+		left = sinf((1.0f - balance) * (M_PI / 2.0f));
+		right = sinf(balance * (M_PI / 2.0f));
 		break;
 	case OBS_BALANCE_TYPE_SQUARE_LAW:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * sqrtf(1.0f - balance);
-			data[1][frame] = data[1][frame] * sqrtf(balance);
-		}
+		left = sqrtf(1.0f - balance);
+		right = sqrtf(balance);
 		break;
 	case OBS_BALANCE_TYPE_LINEAR:
-		for (uint32_t frame = 0; frame < frames; frame++) {
-			data[0][frame] = data[0][frame] * (1.0f - balance);
-			data[1][frame] = data[1][frame] * balance;
-		}
+		left = 1.0f - balance;
+		right = balance;
 		break;
 	default:
-		break;
+		return;
 	}
+
+	audio_mul(data[0], left, frames);
+	audio_mul(data[1], right, frames);
 }
 
 /* resamples/remixes new audio to the designated main audio output format */
@@ -4260,7 +5378,14 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			if (f->external) {
+				/* hand the data back right away, the source
+				 * may only have a few buffers to work with */
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(source, frame);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -4268,6 +5393,36 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
 
+static inline bool async_frame_due(const obs_source_t *source,
+				   const struct obs_source_frame *frame,
+				   uint64_t sys_time)
+{
+	uint64_t due = frame->timestamp + (uint64_t)source->async_ts_offset +
+		       source->async_latency_target;
+	return due <= sys_time;
+}
+
+/* shows the newest frame that is at least the latency target old */
+static bool ready_async_frame_fixed(obs_source_t *source, uint64_t sys_time)
+{
+	struct obs_source_frame *next_frame = source->async_frames.array[0];
+
+	if (!async_frame_due(source, next_frame, sys_time))
+		return false;
+
+	while (source->async_frames.num > 1 &&
+	       async_frame_due(source, source->async_frames.array[1],
+			       sys_time)) {
+		da_erase(source->async_frames, 0);
+		remove_async_frame(source, next_frame);
+		metric_add(source->async_late_metric, 1);
+		next_frame = source->async_frames.array[0];
+	}
+
+	source->last_frame_ts = next_frame->timestamp;
+	return true;
+}
+
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 {
 	struct obs_source_frame *next_frame = source->async_frames.array[0];
@@ -4276,10 +5431,11 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 	uint64_t frame_time = next_frame->timestamp;
 	uint64_t frame_offset = 0;
 
-	if (source->async_unbuffered) {
+	if (async_unbuffered(source)) {
 		while (source->async_frames.num > 1) {
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, next_frame);
+			metric_add(source->async_late_metric, 1);
 			next_frame = source->async_frames.array[0];
 		}
 
@@ -4287,6 +5443,9 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		return true;
 	}
 
+	if (source->async_timing == OBS_ASYNC_TIMING_FIXED_LATENCY)
+		return ready_async_frame_fixed(source, sys_time);
+
 #if DEBUG_ASYNC_FRAMES
 	blog(LOG_DEBUG,
 	     "source->last_frame_ts: %llu, frame_time: %llu, "
@@ -4319,8 +5478,10 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		    (source->last_frame_ts - next_frame->timestamp) < 2000000)
 			break;
 
-		if (frame)
+		if (frame) {
 			da_erase(source->async_frames, 0);
+			metric_add(source->async_late_metric, 1);
+		}
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG,
@@ -4365,7 +5526,9 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 	if (!source->async_frames.num)
 		return NULL;
 
-	if (!source->last_frame_ts || ready_async_frame(source, sys_time)) {
+	if ((!source->last_frame_ts &&
+	     source->async_timing != OBS_ASYNC_TIMING_FIXED_LATENCY) ||
+	    ready_async_frame(source, sys_time)) {
 		struct obs_source_frame *frame = source->async_frames.array[0];
 		da_erase(source->async_frames, 0);
 
@@ -4391,7 +5554,7 @@ struct obs_source_frame *obs_source_get_frame(obs_source_t *source)
 	if (!obs_source_valid(source, "obs_source_get_frame"))
 		return NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	os_mutex_lock(&source->async_mutex);
 
 	frame = source->cur_async_frame;
 	source->cur_async_frame = NULL;
@@ -4400,7 +5563,7 @@ struct obs_source_frame *obs_source_get_frame(obs_source_t *source)
 		os_atomic_inc_long(&frame->refs);
 	}
 
-	pthread_mutex_unlock(&source->async_mutex);
+	os_mutex_unlock(&source->async_mutex);
 
 	return frame;
 }
@@ -4414,14 +5577,14 @@ void obs_source_release_frame(obs_source_t *source,
 	if (!source) {
 		obs_source_frame_destroy(frame);
 	} else {
-		pthread_mutex_lock(&source->async_mutex);
+		os_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			async_frame_destroy(source, frame);
 		else
 			remove_async_frame(source, frame);
 
-		pthread_mutex_unlock(&source->async_mutex);
+		os_mutex_unlock(&source->async_mutex);
 	}
 }
 
@@ -4534,6 +5697,60 @@ static inline void render_filter_tex(gs_texture_t *tex, gs_effect_t *effect,
 	gs_enable_framebuffer_srgb(previous);
 }
 
+static inline bool get_filter_color_matrix(obs_source_t *filter,
+					   uint32_t srgb_flag,
+					   struct matrix4 *matrix)
+{
+	uint32_t flags = filter->info.output_flags;
+
+	if ((flags & OBS_SOURCE_COLOR_MATRIX) == 0 ||
+	    (flags & OBS_SOURCE_SRGB) != srgb_flag ||
+	    !filter->info.get_color_matrix || !filter->context.data)
+		return false;
+
+	return filter->info.get_color_matrix(filter->context.data, matrix);
+}
+
+/* if this filter and the filters below it are only color matrices, combine
+ * them and render the first other target directly, so the whole run takes a
+ * single pass instead of one texrender per filter */
+static obs_source_t *fuse_color_matrix_filters(obs_source_t *filter,
+					       obs_source_t *target,
+					       obs_source_t *parent)
+{
+	const uint32_t srgb_flag = filter->info.output_flags & OBS_SOURCE_SRGB;
+	obs_source_t *fused_target = target;
+	struct matrix4 fused;
+	struct matrix4 matrix;
+	size_t count = 0;
+
+	if (!get_filter_color_matrix(filter, srgb_flag, &fused))
+		return target;
+
+	while (fused_target && fused_target != parent) {
+		/* disabled filters pass their target through unchanged */
+		if (!fused_target->enabled) {
+			fused_target = fused_target->filter_target;
+			continue;
+		}
+
+		if (!get_filter_color_matrix(fused_target, srgb_flag, &matrix))
+			break;
+
+		/* the lower filter is applied first */
+		matrix4_mul(&fused, &matrix, &fused);
+		fused_target = fused_target->filter_target;
+		count++;
+	}
+
+	if (!count || !fused_target)
+		return target;
+
+	filter->filter_fused_active = true;
+	matrix4_copy(&filter->filter_fused_matrix, &fused);
+	return fused_target;
+}
+
 static inline bool can_bypass(obs_source_t *target, obs_source_t *parent,
 			      uint32_t filter_flags, uint32_t parent_flags,
 			      enum obs_allow_direct_render allow_direct,
@@ -4569,6 +5786,7 @@ bool obs_source_process_filter_begin_with_color_space(
 		return false;
 
 	filter->filter_bypass_active = false;
+	filter->filter_fused_active = false;
 
 	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
@@ -4584,6 +5802,8 @@ bool obs_source_process_filter_begin_with_color_space(
 		return false;
 	}
 
+	target = fuse_color_matrix_filters(filter, target, parent);
+
 	filter_flags = filter->info.output_flags;
 	parent_flags = parent->info.output_flags;
 	cx = get_base_width(target);
@@ -4614,7 +5834,7 @@ bool obs_source_process_filter_begin_with_color_space(
 
 	if (!filter->filter_texrender) {
 		filter->filter_texrender =
-			gs_texrender_create(format, GS_ZS_NONE);
+			gs_texrender_create_transient(format, GS_ZS_NONE);
 	}
 
 	if (gs_texrender_begin_with_color_space(filter->filter_texrender, cx,
@@ -4656,7 +5876,9 @@ void obs_source_process_filter_tech_end(obs_source_t *filter,
 		return;
 
 	const bool filter_bypass_active = filter->filter_bypass_active;
+	const bool filter_fused_active = filter->filter_fused_active;
 	filter->filter_bypass_active = false;
+	filter->filter_fused_active = false;
 
 	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
@@ -4671,8 +5893,18 @@ void obs_source_process_filter_tech_end(obs_source_t *filter,
 
 	const char *tech = tech_name ? tech_name : "Draw";
 
+	if (filter_fused_active) {
+		effect = obs->video.default_effect;
+		tech = "DrawColorMatrix";
+		gs_effect_set_matrix4(
+			gs_effect_get_param_by_name(effect, "color_matrix"),
+			&filter->filter_fused_matrix);
+	}
+
 	if (filter_bypass_active) {
-		render_filter_bypass(target, effect, tech);
+		/* a fused run can only be bypassed if it reaches the parent */
+		render_filter_bypass(filter_fused_active ? parent : target,
+				     effect, tech);
 	} else {
 		texture = gs_texrender_get_texture(filter->filter_texrender);
 		if (texture) {
@@ -4723,6 +5955,28 @@ void obs_source_skip_video_filter(obs_source_t *filter)
 	}
 }
 
+void obs_source_set_filter_latency(obs_source_t *filter, uint64_t latency)
+{
+	if (!obs_ptr_valid(filter, "obs_source_set_filter_latency"))
+		return;
+
+	filter->filter_latency = latency;
+}
+
+uint64_t obs_source_get_filter_latency(const obs_source_t *filter)
+{
+	return obs_ptr_valid(filter, "obs_source_get_filter_latency")
+		       ? filter->filter_latency
+		       : 0;
+}
+
+uint64_t obs_source_get_audio_filter_latency(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_audio_filter_latency")
+		       ? source->audio_filter_latency
+		       : 0;
+}
+
 signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_get_signal_handler")
@@ -4740,7 +5994,7 @@ proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
 void obs_source_set_volume(obs_source_t *source, float volume)
 {
 	if (obs_source_valid(source, "obs_source_set_volume")) {
-		struct audio_action action = {.timestamp = os_gettime_ns(),
+		struct audio_action action = {.timestamp = obs_get_clock_ns(),
 					      .type = AUDIO_ACTION_VOL,
 					      .vol = volume};
 
@@ -4975,6 +6229,9 @@ bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
 		obs_source_activate(child, type);
 	}
 
+	for (long i = 0; i < parent->preload_refs; i++)
+		add_preload_ref(child);
+
 	return true;
 }
 
@@ -4990,6 +6247,9 @@ void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
 		type = (i < parent->activate_refs) ? MAIN_VIEW : AUX_VIEW;
 		obs_source_deactivate(child, type);
 	}
+
+	for (long i = 0; i < parent->preload_refs; i++)
+		remove_preload_ref(child);
 }
 
 void obs_source_save(obs_source_t *source)
@@ -5214,6 +6474,96 @@ void obs_source_dec_active(obs_source_t *source)
 		obs_source_deactivate(source, MAIN_VIEW);
 }
 
+void obs_source_preload(obs_source_t *source, uint32_t timeout_ms)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_source_preload preload = {0};
+
+	if (!obs_source_valid(source, "obs_source_preload"))
+		return;
+
+	preload.source = obs_source_get_ref(source);
+	if (!preload.source)
+		return;
+
+	preload.deadline = os_gettime_ns() + (uint64_t)timeout_ms * 1000000ULL;
+	add_preload_ref(source);
+
+	pthread_mutex_lock(&data->preloads_mutex);
+	da_push_back(data->preloads, &preload);
+	pthread_mutex_unlock(&data->preloads_mutex);
+}
+
+void obs_source_release_preload(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_source_preload preload = {0};
+
+	if (!obs_source_valid(source, "obs_source_release_preload"))
+		return;
+
+	pthread_mutex_lock(&data->preloads_mutex);
+	for (size_t i = 0; i < data->preloads.num; i++) {
+		if (data->preloads.array[i].source == source) {
+			preload = data->preloads.array[i];
+			da_erase(data->preloads, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&data->preloads_mutex);
+
+	if (!preload.source)
+		return;
+
+	if (preload.texrender) {
+		obs_enter_graphics();
+		gs_texrender_destroy(preload.texrender);
+		obs_leave_graphics();
+	}
+
+	remove_preload_ref(source);
+	obs_source_release(preload.source);
+}
+
+static bool source_ready(obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+
+	if (os_atomic_load_long(&source->create_state) != DEFERRED_CREATE_NONE)
+		return false;
+	if (!source->primed)
+		return false;
+	if ((flags & OBS_SOURCE_VIDEO) == 0)
+		return true;
+	if ((flags & OBS_SOURCE_ASYNC) != 0 && !source->async_textures[0])
+		return false;
+
+	return obs_source_get_width(source) && obs_source_get_height(source);
+}
+
+static void check_ready(obs_source_t *parent, obs_source_t *child, void *param)
+{
+	bool *ready = param;
+
+	if (*ready && !source_ready(child))
+		*ready = false;
+
+	UNUSED_PARAMETER(parent);
+}
+
+bool obs_source_preload_ready(obs_source_t *source)
+{
+	bool ready;
+
+	if (!obs_source_valid(source, "obs_source_preload_ready"))
+		return false;
+
+	ready = source_ready(source);
+	if (ready)
+		obs_source_enum_active_tree(source, check_ready, &ready);
+	return ready;
+}
+
 void obs_source_enum_filters(obs_source_t *source,
 			     obs_source_enum_proc_t callback, void *param)
 {
@@ -5307,7 +6657,7 @@ void obs_source_set_muted(obs_source_t *source, bool muted)
 {
 	struct calldata data;
 	uint8_t stack[128];
-	struct audio_action action = {.timestamp = os_gettime_ns(),
+	struct audio_action action = {.timestamp = obs_get_clock_ns(),
 				      .type = AUDIO_ACTION_MUTE,
 				      .set = muted};
 
@@ -5506,24 +6856,16 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 					 size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	audio_mul(source->audio_output_buf[mix][0], vol,
+		  AUDIO_OUTPUT_FRAMES * channels);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 				     size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_mul_ramp(source->audio_output_buf[mix][ch], vol_data,
+			       AUDIO_OUTPUT_FRAMES);
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -5586,7 +6928,8 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((source->audio_mixers & (1 << mix)) != 0 &&
+		    source->audio_output_mix[mix] == mix)
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 }
@@ -5630,11 +6973,18 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		uint32_t mix_and_val = (1 << mix);
 		if ((source->audio_mixers & mix_and_val) != 0 &&
-		    (mixers & mix_and_val) != 0)
+		    (mixers & mix_and_val) != 0 &&
+		    source->audio_output_mix[mix] == mix)
 			multiply_output_audio(source, mix, channels, vol);
 	}
 }
 
+static inline void reset_audio_output_mixes(obs_source_t *source)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+		source->audio_output_mix[mix] = mix;
+}
+
 static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 				size_t channels, size_t sample_rate)
 {
@@ -5642,6 +6992,8 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 	bool success;
 	uint64_t ts;
 
+	reset_audio_output_mixes(source);
+
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		for (size_t ch = 0; ch < channels; ch++) {
 			audio_data.output[mix].data[ch] =
@@ -5716,6 +7068,16 @@ static inline void process_audio_source_tick(obs_source_t *source,
 					     size_t sample_rate, size_t size)
 {
 	bool audio_submix = !!(source->info.output_flags & OBS_SOURCE_SUBMIX);
+	uint32_t enabled = audio_submix ? 0 : source->audio_mixers & mixers;
+	size_t out_mix = 0;
+
+	/* every mix the source goes to gets the same audio, so it is only
+	 * copied into the buffer of the first of them and the other mixes
+	 * read from that buffer */
+	if (enabled) {
+		while ((enabled & (1 << out_mix)) == 0)
+			out_mix++;
+	}
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 
@@ -5727,40 +7089,32 @@ static inline void process_audio_source_tick(obs_source_t *source,
 
 	for (size_t ch = 0; ch < channels; ch++)
 		deque_peek_front(&source->audio_input_buf[ch],
-				 source->audio_output_buf[0][ch], size);
+				 source->audio_output_buf[out_mix][ch], size);
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
-	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_and_val = (1 << mix);
-
-		if (audio_submix) {
-			if (mix > 1)
-				break;
-
-			mixers = 1;
-			mix_and_val = 1;
-		}
+	if (audio_submix) {
+		reset_audio_output_mixes(source);
 
-		if ((source->audio_mixers & mix_and_val) == 0 ||
-		    (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0], 0,
+		if ((source->audio_mixers & 1) != 0)
+			source->audio_output_mix[1] = 0;
+		else
+			memset(source->audio_output_buf[1][0], 0,
 			       size * channels);
-			continue;
-		}
-
-		for (size_t ch = 0; ch < channels; ch++)
-			memcpy(source->audio_output_buf[mix][ch],
-			       source->audio_output_buf[0][ch], size);
-	}
 
-	if (audio_submix) {
 		source->audio_pending = false;
 		return;
 	}
 
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0, size * channels);
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((enabled & (1 << mix)) != 0) {
+			source->audio_output_mix[mix] = out_mix;
+			continue;
+		}
+
+		source->audio_output_mix[mix] = mix;
+		memset(source->audio_output_buf[mix][0], 0, size * channels);
+	}
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
@@ -5812,6 +7166,21 @@ uint64_t obs_source_get_audio_timestamp(const obs_source_t *source)
 		       : 0;
 }
 
+uint32_t obs_source_get_audio_buffering_ms(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_audio_buffering_ms")
+		       ? (uint32_t)os_atomic_load_long(
+				 &source->audio_buffering_ms)
+		       : 0;
+}
+
+uint64_t obs_source_get_audio_jitter(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_audio_jitter")
+		       ? (uint64_t)os_atomic_load_int64(&source->audio_jitter)
+		       : 0;
+}
+
 void obs_source_get_audio_mix(const obs_source_t *source,
 			      struct obs_source_audio_mix *audio)
 {
@@ -5821,10 +7190,10 @@ void obs_source_get_audio_mix(const obs_source_t *source,
 		return;
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++) {
-			audio->output[mix].data[ch] =
-				source->audio_output_buf[mix][ch];
-		}
+		float *const *buf = get_audio_output_mix(source, mix);
+
+		for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+			audio->output[mix].data[ch] = buf[ch];
 	}
 }
 
@@ -5930,16 +7299,69 @@ void obs_source_set_async_unbuffered(obs_source_t *source, bool unbuffered)
 	if (!obs_source_valid(source, "obs_source_set_async_unbuffered"))
 		return;
 
-	source->async_unbuffered = unbuffered;
+	source->async_timing = unbuffered ? OBS_ASYNC_TIMING_LATEST
+					  : OBS_ASYNC_TIMING_SMOOTHED;
 }
 
 bool obs_source_async_unbuffered(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_async_unbuffered")
-		       ? source->async_unbuffered
+		       ? async_unbuffered(source)
 		       : false;
 }
 
+void obs_source_set_async_timing(obs_source_t *source,
+				 enum obs_async_timing timing)
+{
+	if (!obs_source_valid(source, "obs_source_set_async_timing"))
+		return;
+
+	os_mutex_lock(&source->async_mutex);
+	source->async_timing = timing;
+	source->last_frame_ts = 0;
+	os_mutex_unlock(&source->async_mutex);
+}
+
+enum obs_async_timing obs_source_get_async_timing(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_timing")
+		       ? source->async_timing
+		       : OBS_ASYNC_TIMING_SMOOTHED;
+}
+
+void obs_source_set_async_latency_target(obs_source_t *source,
+					 uint64_t latency_ns)
+{
+	if (!obs_source_valid(source, "obs_source_set_async_latency_target"))
+		return;
+
+	source->async_latency_target = latency_ns;
+}
+
+uint64_t obs_source_get_async_latency_target(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_latency_target")
+		       ? source->async_latency_target
+		       : 0;
+}
+
+void obs_source_set_async_max_frames(obs_source_t *source, size_t frames)
+{
+	if (!obs_source_valid(source, "obs_source_set_async_max_frames"))
+		return;
+
+	if (frames > MAX_ASYNC_FRAMES)
+		frames = MAX_ASYNC_FRAMES;
+	source->async_max_frames = frames;
+}
+
+size_t obs_source_get_async_max_frames(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_max_frames")
+		       ? async_max_frames(source)
+		       : 0;
+}
+
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
@@ -6069,6 +7491,8 @@ void obs_source_media_play_pause(obs_source_t *source, bool pause)
 	pthread_mutex_lock(&source->media_actions_mutex);
 	da_push_back(source->media_actions, &action);
 	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
 }
 
 void obs_source_media_restart(obs_source_t *source)
@@ -6088,6 +7512,8 @@ void obs_source_media_restart(obs_source_t *source)
 	pthread_mutex_lock(&source->media_actions_mutex);
 	da_push_back(source->media_actions, &action);
 	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
 }
 
 void obs_source_media_stop(obs_source_t *source)
@@ -6107,6 +7533,8 @@ void obs_source_media_stop(obs_source_t *source)
 	pthread_mutex_lock(&source->media_actions_mutex);
 	da_push_back(source->media_actions, &action);
 	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
 }
 
 void obs_source_media_next(obs_source_t *source)
@@ -6126,6 +7554,8 @@ void obs_source_media_next(obs_source_t *source)
 	pthread_mutex_lock(&source->media_actions_mutex);
 	da_push_back(source->media_actions, &action);
 	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
 }
 
 void obs_source_media_previous(obs_source_t *source)
@@ -6145,6 +7575,8 @@ void obs_source_media_previous(obs_source_t *source)
 	pthread_mutex_lock(&source->media_actions_mutex);
 	da_push_back(source->media_actions, &action);
 	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
 }
 
 int64_t obs_source_media_get_duration(obs_source_t *source)
@@ -6190,6 +7622,8 @@ void obs_source_media_set_time(obs_source_t *source, int64_t ms)
 	pthread_mutex_lock(&source->media_actions_mutex);
 	da_push_back(source->media_actions, &action);
 	pthread_mutex_unlock(&source->media_actions_mutex);
+
+	obs_source_request_tick(source);
 }
 
 enum obs_media_state obs_source_media_get_state(obs_source_t *source)
@@ -6299,6 +7733,7 @@ void obs_source_restore_filters(obs_source_t *source, obs_data_array_t *array)
 		prev = filter;
 		filter->filter_parent = source;
 		da_push_back(new_filters, &filter);
+		obs_source_request_tick(filter);
 
 		obs_data_release(data);
 	}
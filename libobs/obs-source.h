@@ -203,6 +203,34 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source video only changes when its settings are updated or when it calls
+ * obs_source_mark_video_dirty, which allows scenes to reuse the previously
+ * rendered composition while nothing has changed
+ */
+#define OBS_SOURCE_STATIC_VIDEO (1 << 17)
+
+/**
+ * Filter only applies a per-pixel color matrix (see get_color_matrix), which
+ * allows consecutive filters with this flag to be drawn in a single pass
+ */
+#define OBS_SOURCE_COLOR_MATRIX (1 << 18)
+
+/**
+ * Source needs video_tick to be called every frame even while it is neither
+ * showing nor active.  Without this flag, sources that aren't shown or
+ * active anywhere are not ticked.  Async sources and transitions are always
+ * ticked.
+ */
+#define OBS_SOURCE_ALWAYS_TICK (1 << 19)
+
+/**
+ * Source's video_tick only touches its own data and may be called from a
+ * worker thread at the same time as the ticks of other sources, when
+ * parallel source ticks are enabled (see obs_set_parallel_source_tick)
+ */
+#define OBS_SOURCE_PARALLEL_TICK (1 << 20)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -560,6 +588,18 @@ struct obs_source_info {
 	 * @param  source  Source that the filter is being added to
 	 */
 	void (*filter_add)(void *data, obs_source_t *source);
+
+	/**
+	 * Gets the color matrix of a filter with OBS_SOURCE_COLOR_MATRIX.
+	 * The matrix is applied to unpremultiplied RGBA, and the result is
+	 * premultiplied again.
+	 *
+	 * @param  data    Filter data
+	 * @param  matrix  Receives the color matrix
+	 * @return         false if the filter currently cannot be expressed
+	 *                 as a color matrix alone
+	 */
+	bool (*get_color_matrix)(void *data, struct matrix4 *matrix);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info,
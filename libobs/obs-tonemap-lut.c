@@ -0,0 +1,168 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include "obs-internal.h"
+
+/* Tone mapping curves are evaluated once per setting on the CPU and shared
+ * by everything that renders with the same setting, so shaders only have
+ * to sample them.  The math matches color.effect. */
+
+#define MAX_TONEMAP_LUTS 16
+
+static double linear_to_st2084(double x)
+{
+	double c = pow(fabs(x), 0.1593017578);
+	return pow((0.8359375 + 18.8515625 * c) / (1. + 18.6875 * c),
+		   78.84375);
+}
+
+static double st2084_to_linear(double u)
+{
+	double c = pow(fabs(u), 1. / 78.84375);
+	double n = c - 0.8359375;
+	if (n < 0.)
+		n = 0.;
+	return pow(fabs(n / (18.8515625 - 18.6875 * c)), 1. / 0.1593017578);
+}
+
+static double saturate(double x)
+{
+	return x < 0. ? 0. : (x > 1. ? 1. : x);
+}
+
+static double eetf_0_Lmax(double maxRGB1_pq, double Lw, double Lmax)
+{
+	double Lw_pq = linear_to_st2084(Lw / 10000.);
+	double E1 = saturate(maxRGB1_pq / Lw_pq);
+	double maxLum = linear_to_st2084(Lmax / 10000.) / Lw_pq;
+	double KS = (1.5 * maxLum) - 0.5;
+	double E2 = E1;
+
+	if (E1 > KS) {
+		double T = (E1 - KS) / (1. - KS);
+		double T2 = T * T;
+		double T3 = T2 * T;
+		E2 = (2. * T3 - 3. * T2 + 1.) * KS +
+		     (T3 - 2. * T2 + T) * (1. - KS) +
+		     (-2. * T3 + 3. * T2) * maxLum;
+	}
+
+	return E2 * Lw_pq;
+}
+
+static double srgb_nonlinear_to_linear(double u)
+{
+	return (u <= 0.04045) ? (u / 12.92) : pow((u + 0.055) / 1.055, 2.4);
+}
+
+/* x / (x + 1) to the tone mapped value */
+static float reinhard_entry(double t)
+{
+	return (float)srgb_nonlinear_to_linear(pow(saturate(t), 1. / 2.4));
+}
+
+/* sqrt(maxRGB / Lw) to the tone mapped maxRGB, in units of 10000 nits */
+static float maxrgb_entry(double t, double Lw, double Lmax)
+{
+	double maxRGB1 = t * t * (Lw / 10000.);
+	return (float)st2084_to_linear(
+		eetf_0_Lmax(linear_to_st2084(maxRGB1), Lw, Lmax));
+}
+
+static gs_texture_t *create_lut(enum obs_tonemap_lut type, float input_nits,
+				float output_nits)
+{
+	float *data = bmalloc(sizeof(float) * OBS_TONEMAP_LUT_SIZE);
+	gs_texture_t *texture;
+
+	for (size_t i = 0; i < OBS_TONEMAP_LUT_SIZE; i++) {
+		double t = (double)i / (OBS_TONEMAP_LUT_SIZE - 1);
+
+		data[i] = (type == OBS_TONEMAP_LUT_REINHARD)
+				  ? reinhard_entry(t)
+				  : maxrgb_entry(t, input_nits, output_nits);
+	}
+
+	texture = gs_texture_create(OBS_TONEMAP_LUT_SIZE, 1, GS_R32F, 1,
+				    (const uint8_t **)&data, 0);
+	bfree(data);
+	return texture;
+}
+
+gs_texture_t *obs_get_tonemap_lut(enum obs_tonemap_lut type,
+				  float input_maximum_nits,
+				  float output_maximum_nits)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_tonemap_lut_entry *lru = NULL;
+	struct obs_tonemap_lut_entry *entry;
+
+	if (!gs_get_context()) {
+		blog(LOG_WARNING, "obs_get_tonemap_lut: not in graphics "
+				  "context");
+		return NULL;
+	}
+
+	if (type == OBS_TONEMAP_LUT_REINHARD) {
+		input_maximum_nits = 0.0f;
+		output_maximum_nits = 0.0f;
+	} else if (input_maximum_nits <= 0.0f || output_maximum_nits <= 0.0f) {
+		return NULL;
+	}
+
+	video->tonemap_lut_clock++;
+
+	for (size_t i = 0; i < video->tonemap_luts.num; i++) {
+		entry = &video->tonemap_luts.array[i];
+		if (entry->type == type &&
+		    entry->input_nits == input_maximum_nits &&
+		    entry->output_nits == output_maximum_nits) {
+			entry->last_used = video->tonemap_lut_clock;
+			return entry->texture;
+		}
+
+		if (!lru || entry->last_used < lru->last_used)
+			lru = entry;
+	}
+
+	gs_texture_t *texture =
+		create_lut(type, input_maximum_nits, output_maximum_nits);
+	if (!texture)
+		return NULL;
+
+	if (video->tonemap_luts.num < MAX_TONEMAP_LUTS) {
+		entry = da_push_back_new(video->tonemap_luts);
+	} else {
+		entry = lru;
+		gs_texture_destroy(entry->texture);
+	}
+
+	entry->type = type;
+	entry->input_nits = input_maximum_nits;
+	entry->output_nits = output_maximum_nits;
+	entry->last_used = video->tonemap_lut_clock;
+	entry->texture = texture;
+	return texture;
+}
+
+void obs_tonemap_luts_free(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = 0; i < video->tonemap_luts.num; i++)
+		gs_texture_destroy(video->tonemap_luts.array[i].texture);
+	da_free(video->tonemap_luts);
+}
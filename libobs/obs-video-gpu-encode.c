@@ -25,10 +25,12 @@ static void *gpu_encode_thread(void *data)
 	uint64_t interval = video_output_get_frame_time(video->video);
 	DARRAY(obs_encoder_t *) encoders;
 	int wait_frames = NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT;
+	long sched_serial = 0;
 
 	da_init(encoders);
 
 	os_set_thread_name("obs gpu encode thread");
+	bmem_set_thread_tag(BMEM_TAG_ENCODER);
 	const char *gpu_encode_thread_name = profile_store_name(
 		obs_get_profiler_name_store(),
 		"obs_gpu_encode_thread(%g" NBSP "ms)", interval / 1000000.);
@@ -44,6 +46,9 @@ static void *gpu_encode_thread(void *data)
 		if (os_atomic_load_bool(&video->gpu_encode_stop))
 			break;
 
+		obs_update_thread_scheduling(OBS_THREAD_ROLE_ENCODER,
+					     &sched_serial);
+
 		if (wait_frames) {
 			wait_frames--;
 			continue;
@@ -55,7 +60,7 @@ static void *gpu_encode_thread(void *data)
 
 		/* -------------- */
 
-		pthread_mutex_lock(&video->gpu_encoder_mutex);
+		os_mutex_lock(&video->gpu_encoder_mutex);
 
 		deque_pop_front(&video->gpu_encoder_queue, &tf, sizeof(tf));
 		timestamp = tf.timestamp;
@@ -71,7 +76,7 @@ static void *gpu_encode_thread(void *data)
 				da_push_back(encoders, &encoder);
 		}
 
-		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+		os_mutex_unlock(&video->gpu_encoder_mutex);
 
 		/* -------------- */
 
@@ -121,6 +126,9 @@ static void *gpu_encode_thread(void *data)
 			if (video_pause_check(&encoder->pause, timestamp))
 				continue;
 
+			if (os_atomic_load_bool(&encoder->fallback_pending))
+				continue;
+
 			if (encoder->reconfigure_requested) {
 				encoder->reconfigure_requested = false;
 				encoder->info.update(encoder->context.data,
@@ -145,6 +153,8 @@ static void *gpu_encode_thread(void *data)
 			else
 				next_key++;
 
+			encoder_stats_submit(encoder, encoder->cur_pts);
+
 			profile_start(gpu_encode_frame_name);
 			if (encoder->info.encode_texture2) {
 				struct encoder_texture tex = {0};
@@ -176,7 +186,7 @@ static void *gpu_encode_thread(void *data)
 
 		/* -------------- */
 
-		pthread_mutex_lock(&video->gpu_encoder_mutex);
+		os_mutex_lock(&video->gpu_encoder_mutex);
 
 		tf.lock_key = next_key;
 
@@ -191,7 +201,7 @@ static void *gpu_encode_thread(void *data)
 					sizeof(tf));
 		}
 
-		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+		os_mutex_unlock(&video->gpu_encoder_mutex);
 
 		/* -------------- */
 
@@ -29,10 +29,118 @@
 #include <windows.h>
 #endif
 
+/* pulls in the sources registered by other threads since the last frame, and
+ * takes a reference on every source in the tick list.  sources that have been
+ * destroyed in the meantime are dropped */
+static void collect_sources_to_tick(struct obs_core_data *data)
+{
+	size_t num = 0;
+
+	pthread_mutex_lock(&data->tick_mutex);
+	da_push_back_da(data->tick_list, data->tick_pending);
+	da_clear(data->tick_pending);
+	pthread_mutex_unlock(&data->tick_mutex);
+
+	da_clear(data->sources_to_tick);
+
+	for (size_t i = 0; i < data->tick_list.num; i++) {
+		obs_weak_source_t *weak = data->tick_list.array[i];
+		obs_source_t *s = obs_weak_source_get_source(weak);
+
+		if (!s) {
+			obs_weak_source_release(weak);
+			continue;
+		}
+
+		data->tick_list.array[num++] = weak;
+		da_push_back(data->sources_to_tick, &s);
+	}
+
+	data->tick_list.num = num;
+}
+
+/* drops sources that no longer need to be ticked from the tick list.  the
+ * registered flag is cleared before checking again, so a request made by
+ * another thread in between is either seen here or adds the source back */
+static void update_tick_list(struct obs_core_data *data)
+{
+	size_t num = 0;
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+		obs_source_t *s = data->sources_to_tick.array[i];
+		obs_weak_source_t *weak = data->tick_list.array[i];
+		bool keep = obs_source_needs_tick(s);
+
+		if (!keep) {
+			os_atomic_set_bool(&s->tick_registered, false);
+			keep = obs_source_needs_tick(s) &&
+			       !os_atomic_set_bool(&s->tick_registered, true);
+		}
+
+		if (keep)
+			data->tick_list.array[num++] = weak;
+		else
+			obs_weak_source_release(weak);
+	}
+
+	data->tick_list.num = num;
+}
+
+struct parallel_tick_job {
+	obs_source_t *const *sources;
+	size_t num;
+	volatile long next;
+	float seconds;
+};
+
+static void parallel_tick_task(void *param)
+{
+	struct parallel_tick_job *job = param;
+
+	for (;;) {
+		size_t idx = (size_t)os_atomic_inc_long(&job->next) - 1;
+		if (idx >= job->num)
+			break;
+
+		obs_source_t *source = job->sources[idx];
+		gs_memory_owner_t *prev_owner =
+			gs_memory_set_owner(source->gpu_memory);
+		source->info.video_tick(source->context.data, job->seconds);
+		gs_memory_set_owner(prev_owner);
+	}
+}
+
+/* the graphics thread works through the job along with the workers, so this
+ * returns once every deferred video_tick has been called */
+static void run_parallel_ticks(struct obs_core_data *data, float seconds)
+{
+	struct obs_core_video *video = &obs->video;
+	struct parallel_tick_job job = {
+		.sources = data->parallel_ticks.array,
+		.num = data->parallel_ticks.num,
+		.seconds = seconds,
+	};
+	size_t workers = 0;
+
+	if (job.num > 1) {
+		workers = create_upload_workers(video);
+		if (workers > job.num - 1)
+			workers = job.num - 1;
+	}
+
+	for (size_t i = 0; i < workers; i++)
+		os_task_queue_queue_task(video->upload_workers[i],
+					 parallel_tick_task, &job);
+
+	parallel_tick_task(&job);
+
+	for (size_t i = 0; i < workers; i++)
+		os_task_queue_wait(video->upload_workers[i]);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
-	struct obs_source *source;
 	uint64_t delta_time;
 	float seconds;
 
@@ -58,28 +166,38 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* ------------------------------------- */
 	/* get an array of all sources to tick   */
 
-	da_clear(data->sources_to_tick);
+	collect_sources_to_tick(data);
+
+	/* ------------------------------------- */
+	/* call the tick function of each source */
 
-	pthread_mutex_lock(&data->sources_mutex);
+	if (os_atomic_load_bool(&data->parallel_tick)) {
+		da_clear(data->parallel_ticks);
 
-	source = data->sources;
-	while (source) {
-		obs_source_t *s = obs_source_get_ref(source);
-		if (s)
-			da_push_back(data->sources_to_tick, &s);
-		source = (struct obs_source *)source->context.hh_uuid.next;
+		for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+			obs_source_t *s = data->sources_to_tick.array[i];
+			if (obs_source_video_tick_parallel(s, seconds))
+				da_push_back(data->parallel_ticks, &s);
+		}
+
+		if (data->parallel_ticks.num)
+			run_parallel_ticks(data, seconds);
+	} else {
+		for (size_t i = 0; i < data->sources_to_tick.num; i++)
+			obs_source_video_tick(data->sources_to_tick.array[i],
+					      seconds);
 	}
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	update_tick_list(data);
 
 	/* ------------------------------------- */
-	/* call the tick function of each source */
+	/* upload new async frames in one pass   */
 
-	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
-		obs_source_t *s = data->sources_to_tick.array[i];
-		obs_source_video_tick(s, seconds);
-		obs_source_release(s);
-	}
+	upload_async_frames(data->sources_to_tick.array,
+			    data->sources_to_tick.num);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_source_release(data->sources_to_tick.array[i]);
 
 	return cur_time;
 }
@@ -94,6 +212,12 @@ static inline void render_displays(void)
 	if (!obs->data.valid)
 		return;
 
+	/* headless front ends have no displays at all, don't bother entering
+	 * the graphics context. a display added right now just gets rendered
+	 * on the next frame */
+	if (!obs->data.first_display)
+		return;
+
 	gs_enter_context(obs->video.graphics);
 
 	/* render extra displays/swaps */
@@ -278,10 +402,9 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video_mix *mix,
 
 static const char *render_output_texture_name = "render_output_texture";
 static inline gs_texture_t *
-render_output_texture(struct obs_core_video_mix *mix)
+render_output_texture(struct obs_core_video_mix *mix, gs_texture_t *texture)
 {
 	struct obs_video_info *const ovi = &mix->ovi;
-	gs_texture_t *texture = mix->render_texture;
 	gs_texture_t *target = mix->output_texture;
 	const uint32_t width = gs_texture_get_width(target);
 	const uint32_t height = gs_texture_get_height(target);
@@ -371,6 +494,7 @@ static void render_convert_texture(struct obs_core_video_mix *video,
 	gs_eparam_t *color_vec2 =
 		gs_effect_get_param_by_name(effect, "color_vec2");
 	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *height = gs_effect_get_param_by_name(effect, "height");
 	gs_eparam_t *width_i = gs_effect_get_param_by_name(effect, "width_i");
 	gs_eparam_t *height_i = gs_effect_get_param_by_name(effect, "height_i");
 	gs_eparam_t *sdr_white_nits_over_maximum = gs_effect_get_param_by_name(
@@ -387,6 +511,8 @@ static void render_convert_texture(struct obs_core_video_mix *video,
 
 	gs_enable_blending(false);
 
+	/* parameters are shared by every plane, so they are only set once; a
+	 * packed conversion renders all planes in the first pass */
 	if (convert_textures[0]) {
 		const float hdr_nominal_peak_level =
 			obs->video.hdr_nominal_peak_level;
@@ -394,40 +520,19 @@ static void render_convert_texture(struct obs_core_video_mix *video,
 			obs_get_video_sdr_white_level() / 10000.f;
 		gs_effect_set_texture(image, texture);
 		gs_effect_set_vec4(color_vec0, &vec0);
+		gs_effect_set_vec4(color_vec1, &vec1);
+		gs_effect_set_vec4(color_vec2, &vec2);
+		gs_effect_set_float(height, video->conversion_height);
+		gs_effect_set_float(width_i, video->conversion_width_i);
+		gs_effect_set_float(height_i, video->conversion_height_i);
 		gs_effect_set_float(sdr_white_nits_over_maximum, multiplier);
 		gs_effect_set_float(hdr_lw, hdr_nominal_peak_level);
-		render_convert_plane(effect, convert_textures[0],
-				     video->conversion_techs[0]);
-
-		if (convert_textures[1]) {
-			gs_effect_set_texture(image, texture);
-			gs_effect_set_vec4(color_vec1, &vec1);
-			if (!convert_textures[2])
-				gs_effect_set_vec4(color_vec2, &vec2);
-			gs_effect_set_float(width_i, video->conversion_width_i);
-			gs_effect_set_float(height_i,
-					    video->conversion_height_i);
-			gs_effect_set_float(sdr_white_nits_over_maximum,
-					    multiplier);
-			gs_effect_set_float(hdr_lw, hdr_nominal_peak_level);
-			render_convert_plane(effect, convert_textures[1],
-					     video->conversion_techs[1]);
-
-			if (convert_textures[2]) {
-				gs_effect_set_texture(image, texture);
-				gs_effect_set_vec4(color_vec2, &vec2);
-				gs_effect_set_float(width_i,
-						    video->conversion_width_i);
-				gs_effect_set_float(height_i,
-						    video->conversion_height_i);
-				gs_effect_set_float(sdr_white_nits_over_maximum,
-						    multiplier);
-				gs_effect_set_float(hdr_lw,
-						    hdr_nominal_peak_level);
-				render_convert_plane(
-					effect, convert_textures[2],
-					video->conversion_techs[2]);
-			}
+
+		for (size_t i = 0; i < NUM_CHANNELS; i++) {
+			if (!convert_textures[i] || !video->conversion_techs[i])
+				break;
+			render_convert_plane(effect, convert_textures[i],
+					     video->conversion_techs[i]);
 		}
 	}
 
@@ -438,6 +543,16 @@ static void render_convert_texture(struct obs_core_video_mix *video,
 	profile_end(render_convert_texture_name);
 }
 
+static inline void push_readback(struct obs_core_video_mix *video, int slot)
+{
+	int idx = (video->readback_head + video->readback_count) %
+		  video->readback_depth;
+
+	video->readback_queue[idx] = slot;
+	video->readback_staged[slot] = video->readback_frame;
+	video->readback_count++;
+}
+
 static const char *stage_output_texture_name = "stage_output_texture";
 static inline void
 stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
@@ -460,6 +575,7 @@ stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 			video->active_copy_surfaces[cur_texture][i] = NULL;
 
 		video->textures_copied[cur_texture] = true;
+		push_readback(video, cur_texture);
 	} else if (video->texture_converted) {
 		for (size_t i = 0; i < channel_count; i++) {
 			gs_stagesurf_t *copy = copy_surfaces[i];
@@ -472,6 +588,7 @@ stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 			video->active_copy_surfaces[cur_texture][i] = NULL;
 
 		video->textures_copied[cur_texture] = true;
+		push_readback(video, cur_texture);
 	}
 
 	profile_end(stage_output_texture_name);
@@ -573,9 +690,9 @@ static void output_gpu_encoders(struct obs_core_video_mix *video,
 	deque_pop_front(&video->vframe_info_buffer_gpu, &vframe_info,
 			sizeof(vframe_info));
 
-	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	os_mutex_lock(&video->gpu_encoder_mutex);
 	encode_gpu(video, raw_active, &vframe_info);
-	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+	os_mutex_unlock(&video->gpu_encoder_mutex);
 
 end:
 	profile_end(output_gpu_encoders_name);
@@ -590,14 +707,24 @@ static inline void render_video(struct obs_core_video_mix *video,
 	gs_enable_depth_test(false);
 	gs_set_cull_mode(GS_NEITHER);
 
-	render_main_texture(video);
+	/* Encoder-only mixes (e.g. bitrate ladder rungs) scale straight from
+	 * the texture of the mix they were created from, rather than
+	 * compositing or copying the whole frame again */
+	gs_texture_t *render_texture = video->render_texture;
+	size_t reuse_idx;
+	if (video->encoder_only_mix && can_reuse_mix_texture(video, &reuse_idx))
+		render_texture =
+			obs->video.mixes.array[reuse_idx]->render_texture;
+	else
+		render_main_texture(video);
 
-	if (raw_active || gpu_active) {
+	if ((raw_active || gpu_active) && video->conversion_allocated) {
 		gs_texture_t *const *convert_textures = video->convert_textures;
 		gs_stagesurf_t *const *copy_surfaces =
 			video->copy_surfaces[cur_texture];
 		size_t channel_count = NUM_CHANNELS;
-		gs_texture_t *output_texture = render_output_texture(video);
+		gs_texture_t *output_texture =
+			render_output_texture(video, render_texture);
 
 		if (gpu_active) {
 			convert_textures = video->convert_textures_encode;
@@ -631,26 +758,81 @@ static inline void render_video(struct obs_core_video_mix *video,
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video_mix *video,
-				  int prev_texture, struct video_data *frame)
+/* The oldest staged frame is only waited on when its slot is the one the
+ * next frame will be staged to, otherwise it stays queued until the GPU has
+ * finished copying it so that mapping it does not stall. */
+static inline int peek_readback(struct obs_core_video_mix *video, bool *wait)
 {
-	if (!video->textures_copied[prev_texture])
-		return false;
+	if (!video->readback_count)
+		return -1;
+
+	const int next = (video->cur_texture + 1) % video->readback_depth;
+	const int oldest = video->readback_queue[video->readback_head];
+
+	if (video->readback_staged[oldest] == video->readback_frame)
+		return -1;
+
+	*wait = oldest == next;
+	return oldest;
+}
+
+static inline void pop_readback(struct obs_core_video_mix *video, int slot)
+{
+	video->readback_head =
+		(video->readback_head + 1) % video->readback_depth;
+	video->readback_count--;
+
+	os_atomic_set_long(&video->readback_latency,
+			   (long)(video->readback_frame -
+				  video->readback_staged[slot]));
+}
 
+static inline bool map_readback(struct obs_core_video_mix *video, int slot,
+				struct video_data *frame, bool wait)
+{
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
 		gs_stagesurf_t *surface =
-			video->active_copy_surfaces[prev_texture][channel];
-		if (surface) {
-			if (!gs_stagesurface_map(surface, &frame->data[channel],
-						 &frame->linesize[channel]))
-				return false;
+			video->active_copy_surfaces[slot][channel];
+		if (!surface)
+			continue;
 
-			video->mapped_surfaces[channel] = surface;
+		bool mapped = wait ? gs_stagesurface_map(
+					     surface, &frame->data[channel],
+					     &frame->linesize[channel])
+				   : gs_stagesurface_try_map(
+					     surface, &frame->data[channel],
+					     &frame->linesize[channel]);
+		if (!mapped) {
+			unmap_last_surface(video);
+			return false;
 		}
+
+		video->mapped_surfaces[channel] = surface;
 	}
+
 	return true;
 }
 
+static inline bool download_frame(struct obs_core_video_mix *video,
+				  struct video_data *frame)
+{
+	bool wait = false;
+	const int prev_texture = peek_readback(video, &wait);
+	if (prev_texture < 0)
+		return false;
+
+	if (!video->textures_copied[prev_texture]) {
+		pop_readback(video, prev_texture);
+		return false;
+	}
+
+	/* a frame that isn't ready yet is deferred to the next tick */
+	bool mapped = map_readback(video, prev_texture, frame, wait);
+	if (mapped || wait)
+		pop_readback(video, prev_texture);
+	return mapped;
+}
+
 static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
 					      uint32_t linesize_input,
 					      uint32_t linesize_output,
@@ -884,6 +1066,7 @@ static inline void output_video_data(struct obs_core_video_mix *video,
 		}
 
 		video_output_unlock_frame(video->video);
+		obs_latency_output(input_frame->timestamp);
 	}
 }
 
@@ -895,34 +1078,211 @@ void add_ready_encoder_group(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&obs->video.encoder_group_mutex);
 }
 
+#define OFFLINE_WAIT_MS 10
+
+static inline bool gpu_texture_available(struct obs_core_video_mix *mix)
+{
+	os_mutex_lock(&mix->gpu_encoder_mutex);
+	bool available = mix->gpu_encoder_avail_queue.size != 0;
+	os_mutex_unlock(&mix->gpu_encoder_mutex);
+	return available;
+}
+
+/* waits a bit for the first output that can't take a frame yet, returns
+ * true once all of them can.  the wait is short because mixes_mutex is held
+ * while waiting. */
+static bool wait_for_outputs(struct obs_core_video *video, bool *active)
+{
+	bool ready = true;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num && ready; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+
+		if (video_output_stopped(mix->video))
+			continue;
+
+		if (mix->raw_was_active) {
+			*active = true;
+			ready = video_output_wait_for_slot(mix->video,
+							   OFFLINE_WAIT_MS);
+		}
+		if (ready && mix->gpu_was_active) {
+			*active = true;
+			if (!gpu_texture_available(mix)) {
+				os_event_timedwait(mix->gpu_encode_inactive,
+						   OFFLINE_WAIT_MS);
+				ready = gpu_texture_available(mix);
+			}
+		}
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return ready;
+}
+
+/* offline rendering, the outputs clock the frames instead of the system
+ * clock, and sources with clock holds get to output their frames for a tick
+ * before it's rendered */
+static void offline_sleep(struct obs_core_video *video, uint64_t *p_time,
+			  uint64_t interval_ns)
+{
+	struct obs_core_clock *clock = &obs->clock;
+	uint64_t t = *p_time + interval_ns;
+	bool active = false;
+
+	while (!wait_for_outputs(video, &active))
+		;
+
+	if (!active) {
+		/* nothing to render for, don't spin */
+		if (!clock->idle_time || !os_sleepto_ns(clock->idle_time))
+			clock->idle_time = os_gettime_ns();
+		clock->idle_time += interval_ns;
+	} else {
+		clock->idle_time = 0;
+	}
+
+	*p_time = t;
+
+	obs_clock_advance(t);
+	obs_clock_wait_holds(t);
+	obs_clock_commit(t);
+}
+
+static inline bool own_frame_rate(const struct obs_core_video_mix *mix)
+{
+	return mix->frame_interval_ns != obs->video.video_frame_interval_ns;
+}
+
+/* earliest deadline of the main frame clock and the clocks of mixes with a
+ * frame rate of their own.  mixes added since the last frame start their
+ * clock now. */
+static uint64_t next_frame_deadline(struct obs_core_video *video,
+				    uint64_t cur_time)
+{
+	uint64_t t = video->next_main_frame_time;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0, num = video->mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+		if (!own_frame_rate(mix))
+			continue;
+
+		if (!mix->next_frame_time)
+			mix->next_frame_time =
+				cur_time + mix->frame_interval_ns;
+		if (mix->next_frame_time < t)
+			t = mix->next_frame_time;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return t;
+}
+
+/* moves a frame clock past time t, returns the number of frames that fell
+ * due (more than one if frames were missed) */
+static inline int advance_frame_clock(uint64_t *next, uint64_t interval_ns,
+				      uint64_t t)
+{
+	if (t < *next)
+		return 0;
+
+	const int count = (int)((t - *next) / interval_ns) + 1;
+	*next += interval_ns * count;
+	return count;
+}
+
+static inline bool mix_frame_due(const struct obs_core_video_mix *mix)
+{
+	return own_frame_rate(mix) ? mix->frame_due : obs->video.main_frame_due;
+}
+
+static inline void push_vframe_info(struct obs_core_video_mix *mix,
+				    const struct obs_vframe_info *info)
+{
+	if (mix->raw_was_active)
+		deque_push_back(&mix->vframe_info_buffer, info, sizeof(*info));
+	if (mix->gpu_was_active)
+		deque_push_back(&mix->vframe_info_buffer_gpu, info,
+				sizeof(*info));
+}
+
+/* sleeps until the next main frame or the next frame of a mix with a frame
+ * rate of its own, whichever comes first.  sources are ticked on every wake
+ * up while each mix is only rendered when its own frame is due, so a 30 fps
+ * or 29.97 fps mix shares its sources with a 60 fps main mix instead of
+ * rendering at the main frame rate. */
 static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 			       uint64_t interval_ns)
 {
 	struct obs_vframe_info vframe_info;
 	uint64_t cur_time = *p_time;
-	uint64_t t = cur_time + interval_ns;
+	uint64_t t = next_frame_deadline(video, cur_time);
+	uint64_t wake_time;
 	int count;
 
-	if (os_sleepto_ns(t)) {
-		*p_time = t;
-		count = 1;
+	if (obs->clock.offline) {
+		offline_sleep(video, p_time, t - cur_time);
+		wake_time = t;
+	} else if (os_sleepto_ns(t)) {
+		wake_time = t;
 	} else {
-		const uint64_t udiff = os_gettime_ns() - cur_time;
-		int64_t diff;
-		memcpy(&diff, &udiff, sizeof(diff));
-		const uint64_t clamped_diff = (diff > (int64_t)interval_ns)
-						      ? (uint64_t)diff
-						      : interval_ns;
-		count = (int)(clamped_diff / interval_ns);
-		*p_time = cur_time + interval_ns * count;
+		wake_time = os_gettime_ns();
 	}
 
-	video->total_frames += count;
-	video->lagged_frames += count - 1;
+	/* the frame time is the latest deadline that just passed, the main
+	 * one takes precedence when it's due */
+	*p_time = 0;
+	count = advance_frame_clock(&video->next_main_frame_time, interval_ns,
+				    wake_time);
+	video->main_frame_due = count > 0;
+	if (count) {
+		*p_time = video->next_main_frame_time - interval_ns;
+
+		video->total_frames += count;
+		video->lagged_frames += count - 1;
+		metric_add(video->frames_metric, count);
+		metric_add(video->lagged_frames_metric, count - 1);
+	}
 
-	vframe_info.timestamp = cur_time;
+	vframe_info.timestamp = video->main_frame_time;
 	vframe_info.count = count;
 
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0, num = video->mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+
+		if (!own_frame_rate(mix)) {
+			if (video->main_frame_due)
+				push_vframe_info(mix, &vframe_info);
+			continue;
+		}
+
+		count = advance_frame_clock(&mix->next_frame_time,
+					    mix->frame_interval_ns, wake_time);
+		mix->frame_due = count > 0;
+		if (!count)
+			continue;
+
+		/* the frame rendered last is shown until this one */
+		if (mix->frame_pending) {
+			struct obs_vframe_info info = {mix->frame_time, count};
+			push_vframe_info(mix, &info);
+			mix->frame_pending = false;
+		}
+
+		mix->frame_time = mix->next_frame_time - mix->frame_interval_ns;
+		if (!video->main_frame_due && mix->frame_time > *p_time)
+			*p_time = mix->frame_time;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	if (video->main_frame_due)
+		video->main_frame_time = *p_time;
+	else if (!*p_time)
+		*p_time = wake_time;
+
 	pthread_mutex_lock(&video->encoder_group_mutex);
 	for (size_t i = 0; i < video->ready_encoder_groups.num; i++) {
 		obs_encoder_t *encoder = obs_weak_encoder_get_encoder(
@@ -944,21 +1304,6 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 	}
 	da_clear(video->ready_encoder_groups);
 	pthread_mutex_unlock(&video->encoder_group_mutex);
-
-	pthread_mutex_lock(&obs->video.mixes_mutex);
-	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
-		struct obs_core_video_mix *video = obs->video.mixes.array[i];
-		bool raw_active = video->raw_was_active;
-		bool gpu_active = video->gpu_was_active;
-
-		if (raw_active)
-			deque_push_back(&video->vframe_info_buffer,
-					&vframe_info, sizeof(vframe_info));
-		if (gpu_active)
-			deque_push_back(&video->vframe_info_buffer_gpu,
-					&vframe_info, sizeof(vframe_info));
-	}
-	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
 static const char *output_frame_gs_context_name = "gs_context(video->graphics)";
@@ -966,21 +1311,17 @@ static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
-static inline void output_frame(struct obs_core_video_mix *video)
+static inline void render_frame(struct obs_core_video_mix *video)
 {
 	const bool raw_active = video->raw_was_active;
 	const bool gpu_active = video->gpu_was_active;
 
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
-					    : cur_texture - 1;
-	struct video_data frame;
+	struct video_data *frame = &video->output_data;
 	bool frame_ready = 0;
 
-	memset(&frame, 0, sizeof(struct video_data));
-
-	profile_start(output_frame_gs_context_name);
-	gs_enter_context(obs->video.graphics);
+	memset(frame, 0, sizeof(struct video_data));
+	video->output_ready = false;
 
 	profile_start(output_frame_render_video_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO,
@@ -991,40 +1332,52 @@ static inline void output_frame(struct obs_core_video_mix *video)
 
 	if (raw_active) {
 		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
+		frame_ready = download_frame(video, frame);
 		profile_end(output_frame_download_frame_name);
 	}
 
-	profile_start(output_frame_gs_flush_name);
-	gs_flush();
-	profile_end(output_frame_gs_flush_name);
-
-	gs_leave_context();
-	profile_end(output_frame_gs_context_name);
-
 	if (raw_active && frame_ready) {
 		struct obs_vframe_info vframe_info;
 		deque_pop_front(&video->vframe_info_buffer, &vframe_info,
 				sizeof(vframe_info));
 
-		frame.timestamp = vframe_info.timestamp;
-		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
-		profile_end(output_frame_output_video_data_name);
+		frame->timestamp = vframe_info.timestamp;
+		video->output_count = vframe_info.count;
+		video->output_ready = true;
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	video->readback_frame++;
+	if (++video->cur_texture == video->readback_depth)
 		video->cur_texture = 0;
 }
 
+static void output_frame_task(void *param)
+{
+	struct obs_core_video_mix *video = param;
+	output_video_data(video, &video->output_data, video->output_count);
+}
+
+static inline bool queue_output_frame(struct obs_core_video_mix *video)
+{
+	if (!video->output_task_queue) {
+		video->output_task_queue = os_task_queue_create();
+		if (!video->output_task_queue)
+			return false;
+	}
+
+	return os_task_queue_queue_task(video->output_task_queue,
+					output_frame_task, video);
+}
+
 static inline void output_frames(void)
 {
+	const bool parallel = obs->video.parallel_mix_output;
+	size_t ready_count = 0;
+
 	pthread_mutex_lock(&obs->video.mixes_mutex);
 	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
 		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
-		if (mix->view) {
-			output_frame(mix);
-		} else {
+		if (!mix->view) {
 			obs->video.mixes.array[i] = NULL;
 			obs_free_video_mix(mix);
 			da_erase(obs->video.mixes, i);
@@ -1032,23 +1385,95 @@ static inline void output_frames(void)
 			num--;
 		}
 	}
+
+	/* all mixes share the one graphics context, so GPU submission stays
+	 * serial; only the CPU-side copy of downloaded frames into the video
+	 * outputs can be spread over worker threads */
+	profile_start(output_frame_gs_context_name);
+	gs_enter_context(obs->video.graphics);
+
+	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
+		if (!mix_frame_due(mix)) {
+			mix->output_ready = false;
+			continue;
+		}
+
+		render_frame(mix);
+		mix->frame_pending = true;
+		if (mix->output_ready)
+			ready_count++;
+	}
+
+	profile_start(output_frame_gs_flush_name);
+	gs_flush();
+	profile_end(output_frame_gs_flush_name);
+
+	gs_leave_context();
+	profile_end(output_frame_gs_context_name);
+
+	profile_start(output_frame_output_video_data_name);
+	if (parallel && ready_count > 1) {
+		struct obs_core_video_mix *local = NULL;
+
+		for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+			struct obs_core_video_mix *mix =
+				obs->video.mixes.array[i];
+			if (!mix->output_ready)
+				continue;
+
+			/* the first ready mix is output on this thread */
+			if (!local)
+				local = mix;
+			else if (!queue_output_frame(mix))
+				output_frame_task(mix);
+		}
+
+		output_frame_task(local);
+
+		for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+			struct obs_core_video_mix *mix =
+				obs->video.mixes.array[i];
+			if (mix->output_ready && mix != local &&
+			    mix->output_task_queue)
+				os_task_queue_wait(mix->output_task_queue);
+		}
+	} else {
+		for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+			struct obs_core_video_mix *mix =
+				obs->video.mixes.array[i];
+			if (mix->output_ready)
+				output_frame_task(mix);
+		}
+	}
+	profile_end(output_frame_output_video_data_name);
+
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
 #define NBSP "\xC2\xA0"
 
+static inline void clear_readback(struct obs_core_video_mix *video)
+{
+	video->readback_head = 0;
+	video->readback_count = 0;
+	os_atomic_set_long(&video->readback_latency, 0);
+}
+
 static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
 	video->texture_converted = false;
 	deque_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
+	clear_readback(video);
 }
 
 static void clear_raw_frame_data(struct obs_core_video_mix *video)
 {
 	memset(video->textures_copied, 0, sizeof(video->textures_copied));
 	deque_free(&video->vframe_info_buffer);
+	clear_readback(video);
 }
 
 static void clear_gpu_frame_data(struct obs_core_video_mix *video)
@@ -1156,9 +1581,156 @@ static void uninit_winrt_state(struct winrt_state *winrt)
 
 #endif // #ifdef _WIN32
 
+static void render_preload(struct obs_source_preload *preload)
+{
+	obs_source_t *source = preload->source;
+	const uint32_t cx = obs_source_get_width(source);
+	const uint32_t cy = obs_source_get_height(source);
+
+	if (!cx || !cy)
+		return;
+
+	if (!preload->texrender)
+		preload->texrender =
+			gs_texrender_create_transient(GS_RGBA, GS_ZS_NONE);
+
+	gs_texrender_reset(preload->texrender);
+	if (gs_texrender_begin(preload->texrender, cx, cy)) {
+		struct vec4 clear_color;
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		obs_source_video_render(source);
+		gs_texrender_end(preload->texrender);
+	}
+}
+
+static void signal_preloads(obs_source_t **sources, size_t num,
+			    const char *signal)
+{
+	for (size_t i = 0; i < num; i++) {
+		struct calldata data;
+		uint8_t stack[128];
+
+		calldata_init_fixed(&data, stack, sizeof(stack));
+		calldata_set_ptr(&data, "source", sources[i]);
+		signal_handler_signal(sources[i]->context.signals, signal,
+				      &data);
+		obs_source_release(sources[i]);
+	}
+}
+
+/* renders sources that are being preloaded off screen until every source in
+ * their tree has video, so that the first frame shown has nothing left to
+ * initialize */
+static const char *prime_preloads_name = "prime_preloads";
+static void prime_preloads(void)
+{
+	struct obs_core_data *data = &obs->data;
+	DARRAY(obs_source_t *) ready;
+	DARRAY(obs_source_t *) timed_out;
+
+	da_init(ready);
+	da_init(timed_out);
+
+	profile_start(prime_preloads_name);
+	pthread_mutex_lock(&data->preloads_mutex);
+
+	if (data->preloads.num) {
+		const uint64_t now = os_gettime_ns();
+
+		gs_enter_context(obs->video.graphics);
+
+		for (size_t i = 0; i < data->preloads.num; i++) {
+			struct obs_source_preload *preload =
+				data->preloads.array + i;
+			if (preload->ready || preload->timed_out)
+				continue;
+
+			render_preload(preload);
+
+			if (obs_source_preload_ready(preload->source)) {
+				preload->ready = true;
+				da_push_back(ready, &preload->source);
+			} else if (now >= preload->deadline) {
+				preload->timed_out = true;
+				da_push_back(timed_out, &preload->source);
+				blog(LOG_WARNING,
+				     "Source '%s' was not ready before its "
+				     "preload deadline",
+				     obs_source_get_name(preload->source));
+			}
+		}
+
+		gs_leave_context();
+	}
+
+	for (size_t i = 0; i < ready.num; i++)
+		obs_source_get_ref(ready.array[i]);
+	for (size_t i = 0; i < timed_out.num; i++)
+		obs_source_get_ref(timed_out.array[i]);
+
+	pthread_mutex_unlock(&data->preloads_mutex);
+
+	signal_preloads(ready.array, ready.num, "preload_ready");
+	signal_preloads(timed_out.array, timed_out.num, "preload_timeout");
+	da_free(ready);
+	da_free(timed_out);
+	profile_end(prime_preloads_name);
+}
+
 static const char *tick_sources_name = "tick_sources";
 static const char *render_displays_name = "render_displays";
 static const char *output_frame_name = "output_frame";
+
+/* Returns false if the mix can't be made active because its conversion
+ * resources could not be allocated */
+static bool update_conversion_resources(struct obs_core_video_mix *video,
+					bool active)
+{
+	if (active) {
+		video->conversion_idle_since = 0;
+		if (video->conversion_allocated)
+			return true;
+		if (video->conversion_failed)
+			return false;
+
+		gs_enter_context(obs->video.graphics);
+		if (!obs_video_mix_init_conversion(video)) {
+			blog(LOG_ERROR, "Failed to allocate video conversion "
+					"resources, mix output disabled");
+			video->conversion_failed = true;
+		}
+		gs_leave_context();
+
+		return !video->conversion_failed;
+	}
+
+	video->conversion_failed = false;
+	if (!video->conversion_allocated)
+		return true;
+
+	const uint64_t now = os_gettime_ns();
+	if (!video->conversion_idle_since) {
+		video->conversion_idle_since = now;
+		return true;
+	}
+
+	const uint32_t idle_ms = obs->video.conversion_idle_ms
+					 ? obs->video.conversion_idle_ms
+					 : DEFAULT_CONVERSION_IDLE_MS;
+	if (now - video->conversion_idle_since < (uint64_t)idle_ms * 1000000ULL)
+		return true;
+
+	gs_enter_context(obs->video.graphics);
+	obs_video_mix_free_conversion(video);
+	gs_leave_context();
+
+	video->conversion_idle_since = 0;
+	return true;
+}
+
 static inline void update_active_state(struct obs_core_video_mix *video)
 {
 	const bool raw_was_active = video->raw_was_active;
@@ -1166,8 +1738,13 @@ static inline void update_active_state(struct obs_core_video_mix *video)
 	const bool was_active = video->was_active;
 
 	bool raw_active = os_atomic_load_long(&video->raw_active) > 0;
-	const bool gpu_active =
-		os_atomic_load_long(&video->gpu_encoder_active) > 0;
+	bool gpu_active = os_atomic_load_long(&video->gpu_encoder_active) > 0;
+
+	if (!update_conversion_resources(video, raw_active || gpu_active)) {
+		raw_active = false;
+		gpu_active = false;
+	}
+
 	const bool active = raw_active || gpu_active;
 
 	if (!was_active && active)
@@ -1182,11 +1759,47 @@ static inline void update_active_state(struct obs_core_video_mix *video)
 	video->was_active = active;
 }
 
+static void apply_output_size(struct obs_core_video_mix *video)
+{
+	bool success = false;
+	bool gpu_encoding;
+
+	video->output_size_pending = false;
+
+	/* init_gpu_encoding runs in the graphics context too, so no texture
+	 * encoder can start while the size is being changed */
+	gs_enter_context(obs->video.graphics);
+
+	/* texture encoders take the conversion textures at the mix size */
+	os_mutex_lock(&video->gpu_encoder_mutex);
+	gpu_encoding = video->gpu_encoders.num > 0;
+	os_mutex_unlock(&video->gpu_encoder_mutex);
+
+	if (!gpu_encoding)
+		success = obs_video_mix_set_output_size(
+			video, video->pending_output_width,
+			video->pending_output_height);
+
+	gs_leave_context();
+
+	if (success)
+		clear_base_frame_data(video);
+	else
+		blog(LOG_WARNING, "Could not change video output size to "
+				  "%ux%u%s",
+		     video->pending_output_width, video->pending_output_height,
+		     gpu_encoding ? ", a texture encoder is active" : "");
+}
+
 static inline void update_active_states(void)
 {
 	pthread_mutex_lock(&obs->video.mixes_mutex);
-	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++)
-		update_active_state(obs->video.mixes.array[i]);
+	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
+		if (mix->output_size_pending)
+			apply_output_size(mix);
+		update_active_state(mix);
+	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
@@ -1205,6 +1818,7 @@ static inline bool stop_requested(void)
 
 bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 {
+	const bool main_frame = obs->video.main_frame_due;
 	uint64_t frame_start = os_gettime_ns();
 	uint64_t frame_time_ns;
 
@@ -1214,6 +1828,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	obs_gpu_timing_begin_frame();
 	gs_leave_context();
 
 	profile_start(tick_sources_name);
@@ -1221,6 +1836,10 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 		tick_sources(obs->video.video_time, context->last_time);
 	profile_end(tick_sources_name);
 
+	obs_latency_render(obs->video.video_time);
+
+	update_scene_roi();
+
 #ifdef _WIN32
 	MSG msg;
 	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
@@ -1233,13 +1852,25 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	output_frames();
 	profile_end(output_frame_name);
 
-	profile_start(render_displays_name);
-	render_displays();
-	profile_end(render_displays_name);
+	/* displays follow the main frame rate */
+	if (main_frame) {
+		profile_start(render_displays_name);
+		render_displays();
+		profile_end(render_displays_name);
+	}
+
+	prime_preloads();
+
+	if (obs->video.gpu_timing.active) {
+		gs_enter_context(obs->video.graphics);
+		obs_gpu_timing_end_frame();
+		gs_leave_context();
+	}
 
 	execute_graphics_tasks();
 
 	frame_time_ns = os_gettime_ns() - frame_start;
+	metric_record(obs->video.render_time_metric, frame_time_ns);
 
 	profile_end(context->video_thread_name);
 
@@ -1247,11 +1878,31 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	video_sleep(&obs->video, &obs->video.video_time, context->interval);
 
+	/* video_time is the time the thread should have woken up at */
+	if (!obs->clock.offline) {
+		uint64_t late = os_gettime_ns() - obs->video.video_time;
+		context->sched_late_total_ns += late;
+		context->sched_late_count++;
+		if (late > context->sched_late_max_ns)
+			context->sched_late_max_ns = late;
+	}
+
+	obs_update_thread_scheduling(OBS_THREAD_ROLE_GRAPHICS,
+				     &context->sched_serial);
+
 	context->frame_time_total_ns += frame_time_ns;
-	context->fps_total_ns += (obs->video.video_time - context->last_time);
-	context->fps_total_frames++;
+	/* the virtual clock always advances at the nominal rate, report the
+	 * rate frames are actually rendered at instead */
+	if (obs->clock.offline)
+		context->fps_total_ns += os_gettime_ns() - frame_start;
+	else
+		context->fps_total_ns +=
+			(obs->video.video_time - context->last_time);
+	if (main_frame)
+		context->fps_total_frames++;
 
-	if (context->fps_total_ns >= 1000000000ULL) {
+	if (context->fps_total_ns >= 1000000000ULL &&
+	    context->fps_total_frames) {
 		obs->video.video_fps =
 			(double)context->fps_total_frames /
 			((double)context->fps_total_ns / 1000000000.0);
@@ -1278,9 +1929,13 @@ void *obs_graphics_thread(void *param)
 
 	const uint64_t interval = obs->video.video_frame_interval_ns;
 
-	obs->video.video_time = os_gettime_ns();
+	obs->video.video_time = obs_get_clock_ns();
+	obs->video.main_frame_time = obs->video.video_time;
+	obs->video.next_main_frame_time = obs->video.video_time + interval;
+	obs->video.main_frame_due = true;
 
 	os_set_thread_name("libobs: graphics thread");
+	bmem_set_thread_tag(BMEM_TAG_GRAPHICS);
 
 	const char *video_thread_name = profile_store_name(
 		obs_get_profiler_name_store(),
@@ -1296,6 +1951,13 @@ void *obs_graphics_thread(void *param)
 	context.fps_total_frames = 0;
 	context.last_time = 0;
 	context.video_thread_name = video_thread_name;
+	context.sched_serial = 0;
+	context.sched_late_total_ns = 0;
+	context.sched_late_max_ns = 0;
+	context.sched_late_count = 0;
+
+	obs_update_thread_scheduling(OBS_THREAD_ROLE_GRAPHICS,
+				     &context.sched_serial);
 
 #ifdef __APPLE__
 	while (obs_graphics_thread_loop_autorelease(&context))
@@ -1304,6 +1966,16 @@ void *obs_graphics_thread(void *param)
 #endif
 		;
 
+	if (context.sched_late_count) {
+		blog(LOG_INFO,
+		     "graphics thread scheduling latency: avg %.3f ms, "
+		     "max %.3f ms",
+		     (double)(context.sched_late_total_ns /
+			      context.sched_late_count) /
+			     1000000.0,
+		     (double)context.sched_late_max_ns / 1000000.0);
+	}
+
 #ifdef _WIN32
 	uninit_winrt_state(&winrt);
 #endif
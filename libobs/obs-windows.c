@@ -404,6 +404,13 @@ void log_system_info(void)
 
 struct obs_hotkeys_platform {
 	int vk_codes[OBS_KEY_LAST_VALUE];
+
+	/* raw input is received on a message-only window owned by this
+	 * thread, even while OBS is in the background */
+	HANDLE input_thread;
+	DWORD input_thread_id;
+	HANDLE input_ready;
+	bool input_registered;
 };
 
 static int get_virtual_key(obs_key_t key)
@@ -1005,6 +1012,97 @@ static int get_virtual_key(obs_key_t key)
 	return 0;
 }
 
+static bool is_input_event(HRAWINPUT handle)
+{
+	RAWINPUT input;
+	UINT size = sizeof(input);
+
+	if (GetRawInputData(handle, RID_INPUT, &input, &size,
+			    sizeof(RAWINPUTHEADER)) == (UINT)-1)
+		return true;
+
+	/* mouse movement arrives here as well, only buttons matter */
+	if (input.header.dwType == RIM_TYPEMOUSE)
+		return input.data.mouse.usButtonFlags != 0;
+
+	return input.header.dwType == RIM_TYPEKEYBOARD;
+}
+
+static DWORD WINAPI raw_input_thread(LPVOID param)
+{
+	obs_hotkeys_platform_t *plat = param;
+	MSG msg;
+
+	os_set_thread_name("libobs: hotkey raw input");
+
+	HWND hwnd = CreateWindowExW(0, L"STATIC", NULL, 0, 0, 0, 0, 0,
+				    HWND_MESSAGE, NULL, NULL, NULL);
+	if (hwnd) {
+		RAWINPUTDEVICE devices[2] = {
+			{0x01, 0x06, RIDEV_INPUTSINK, hwnd}, /* keyboard */
+			{0x01, 0x02, RIDEV_INPUTSINK, hwnd}, /* mouse */
+		};
+
+		plat->input_registered =
+			!!RegisterRawInputDevices(devices, 2,
+						  sizeof(devices[0]));
+	}
+
+	/* creating the window also created the message queue, so the quit
+	 * message can't get lost from here on */
+	SetEvent(plat->input_ready);
+
+	if (plat->input_registered) {
+		while (GetMessageW(&msg, NULL, 0, 0) > 0) {
+			if (msg.message == WM_INPUT &&
+			    is_input_event((HRAWINPUT)msg.lParam))
+				obs_hotkeys_platform_key_event();
+
+			DispatchMessageW(&msg);
+		}
+
+		RAWINPUTDEVICE devices[2] = {
+			{0x01, 0x06, RIDEV_REMOVE, NULL},
+			{0x01, 0x02, RIDEV_REMOVE, NULL},
+		};
+		RegisterRawInputDevices(devices, 2, sizeof(devices[0]));
+	}
+
+	if (hwnd)
+		DestroyWindow(hwnd);
+	return 0;
+}
+
+static bool start_raw_input(obs_hotkeys_platform_t *plat)
+{
+	plat->input_ready = CreateEvent(NULL, false, false, NULL);
+	if (!plat->input_ready)
+		return false;
+
+	plat->input_thread = CreateThread(NULL, 0, raw_input_thread, plat, 0,
+					  &plat->input_thread_id);
+	if (!plat->input_thread)
+		return false;
+
+	WaitForSingleObject(plat->input_ready, INFINITE);
+
+	if (!plat->input_registered)
+		blog(LOG_WARNING, "Failed to register raw input, hotkeys "
+				  "fall back to polling");
+	return plat->input_registered;
+}
+
+static void stop_raw_input(obs_hotkeys_platform_t *plat)
+{
+	if (plat->input_thread) {
+		PostThreadMessage(plat->input_thread_id, WM_QUIT, 0, 0);
+		WaitForSingleObject(plat->input_thread, INFINITE);
+		CloseHandle(plat->input_thread);
+	}
+	if (plat->input_ready)
+		CloseHandle(plat->input_ready);
+}
+
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 {
 	hotkeys->platform_context = bzalloc(sizeof(obs_hotkeys_platform_t));
@@ -1012,11 +1110,13 @@ bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		hotkeys->platform_context->vk_codes[i] = get_virtual_key(i);
 
+	hotkeys->platform_events = start_raw_input(hotkeys->platform_context);
 	return true;
 }
 
 void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 {
+	stop_raw_input(hotkeys->platform_context);
 	bfree(hotkeys->platform_context);
 	hotkeys->platform_context = NULL;
 }
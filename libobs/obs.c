@@ -26,6 +26,7 @@
 struct obs_core *obs = NULL;
 
 static THREAD_LOCAL bool is_ui_thread = false;
+THREAD_LOCAL bool defer_source_create = false;
 
 extern void add_default_module_paths(void);
 extern char *find_libobs_data_file(const char *file);
@@ -50,9 +51,11 @@ static inline void calc_gpu_conversion_sizes(struct obs_core_video_mix *video)
 		video_output_get_info(video->video);
 
 	video->conversion_needed = false;
+	video->conversion_packed = false;
 	video->conversion_techs[0] = NULL;
 	video->conversion_techs[1] = NULL;
 	video->conversion_techs[2] = NULL;
+	video->conversion_height = (float)info->height;
 	video->conversion_width_i = 0.f;
 	video->conversion_height_i = 0.f;
 
@@ -144,6 +147,38 @@ static inline void calc_gpu_conversion_sizes(struct obs_core_video_mix *video)
 	}
 }
 
+/* Without the NV12/P010 texture path, the Y and UV planes are rendered in a
+ * single pass to one texture laid out like the frame itself (Y rows followed
+ * by interleaved UV rows), so readback needs one staging copy and one map. */
+static void set_packed_conversion(struct obs_core_video_mix *video,
+				  const struct video_output_info *info)
+{
+	if (video->using_nv12_tex || video->using_p010_tex)
+		return;
+
+	if (info->format == VIDEO_FORMAT_NV12) {
+		video->conversion_techs[0] = "NV12_Packed";
+	} else if (info->format == VIDEO_FORMAT_P010) {
+		if (info->colorspace == VIDEO_CS_2100_PQ)
+			video->conversion_techs[0] = "P010_PQ_Packed";
+		else if (info->colorspace == VIDEO_CS_2100_HLG)
+			video->conversion_techs[0] = "P010_HLG_Packed";
+		else
+			video->conversion_techs[0] = "P010_SRGB_Packed";
+	} else {
+		return;
+	}
+
+	video->conversion_techs[1] = NULL;
+	video->conversion_packed = true;
+	video->conversion_height_i = 1.f / (float)info->height;
+}
+
+static inline uint32_t packed_conversion_height(uint32_t height)
+{
+	return height + height / 2;
+}
+
 static bool obs_init_gpu_conversion(struct obs_core_video_mix *video)
 {
 	const struct video_output_info *info =
@@ -176,6 +211,15 @@ static bool obs_init_gpu_conversion(struct obs_core_video_mix *video)
 	else
 		blog(LOG_INFO, "P010 texture support not available");
 
+	set_packed_conversion(video, info);
+	return true;
+}
+
+static bool obs_init_gpu_conversion_textures(struct obs_core_video_mix *video)
+{
+	const struct video_output_info *info =
+		video_output_get_info(video->video);
+
 	video->convert_textures[0] = NULL;
 	video->convert_textures[1] = NULL;
 	video->convert_textures[2] = NULL;
@@ -218,6 +262,14 @@ static bool obs_init_gpu_conversion(struct obs_core_video_mix *video)
 			success = false;
 		break;
 	case VIDEO_FORMAT_NV12:
+		if (video->conversion_packed) {
+			video->convert_textures[0] = gs_texture_create(
+				info->width,
+				packed_conversion_height(info->height), GS_R8,
+				1, NULL, GS_RENDER_TARGET);
+			success = !!video->convert_textures[0];
+			break;
+		}
 		video->convert_textures[0] =
 			gs_texture_create(info->width, info->height, GS_R8, 1,
 					  NULL, GS_RENDER_TARGET);
@@ -256,6 +308,14 @@ static bool obs_init_gpu_conversion(struct obs_core_video_mix *video)
 			success = false;
 		break;
 	case VIDEO_FORMAT_P010:
+		if (video->conversion_packed) {
+			video->convert_textures[0] = gs_texture_create(
+				info->width,
+				packed_conversion_height(info->height), GS_R16,
+				1, NULL, GS_RENDER_TARGET);
+			success = !!video->convert_textures[0];
+			break;
+		}
 		video->convert_textures[0] =
 			gs_texture_create(info->width, info->height, GS_R16, 1,
 					  NULL, GS_RENDER_TARGET);
@@ -327,6 +387,12 @@ static bool obs_init_gpu_copy_surfaces(struct obs_core_video_mix *video,
 			return false;
 		break;
 	case VIDEO_FORMAT_NV12:
+		if (video->conversion_packed) {
+			video->copy_surfaces[i][0] = gs_stagesurface_create(
+				info->width,
+				packed_conversion_height(info->height), GS_R8);
+			return !!video->copy_surfaces[i][0];
+		}
 		video->copy_surfaces[i][0] = gs_stagesurface_create(
 			info->width, info->height, GS_R8);
 		if (!video->copy_surfaces[i][0])
@@ -365,6 +431,13 @@ static bool obs_init_gpu_copy_surfaces(struct obs_core_video_mix *video,
 			return false;
 		break;
 	case VIDEO_FORMAT_P010:
+		if (video->conversion_packed) {
+			video->copy_surfaces[i][0] = gs_stagesurface_create(
+				info->width,
+				packed_conversion_height(info->height),
+				GS_R16);
+			return !!video->copy_surfaces[i][0];
+		}
 		video->copy_surfaces[i][0] = gs_stagesurface_create(
 			info->width, info->height, GS_R16);
 		if (!video->copy_surfaces[i][0])
@@ -401,14 +474,9 @@ static bool obs_init_gpu_copy_surfaces(struct obs_core_video_mix *video,
 	return true;
 }
 
-static bool obs_init_textures(struct obs_core_video_mix *video)
+static enum gs_color_format
+get_mix_texture_format(const struct video_output_info *info)
 {
-	const struct video_output_info *info =
-		video_output_get_info(video->video);
-
-	bool success = true;
-
-	enum gs_color_format format = GS_BGRA;
 	switch (info->format) {
 	case VIDEO_FORMAT_I010:
 	case VIDEO_FORMAT_P010:
@@ -417,13 +485,105 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 	case VIDEO_FORMAT_YA2L:
 	case VIDEO_FORMAT_P216:
 	case VIDEO_FORMAT_P416:
-		format = GS_RGBA16F;
+		return GS_RGBA16F;
+	default:
+		return GS_BGRA;
+	}
+}
+
+static bool obs_init_textures(struct obs_core_video_mix *video)
+{
+	const struct video_output_info *info =
+		video_output_get_info(video->video);
+	enum gs_color_format format = get_mix_texture_format(info);
+
+	enum gs_color_space space = GS_CS_SRGB;
+	switch (info->colorspace) {
+	case VIDEO_CS_2100_PQ:
+	case VIDEO_CS_2100_HLG:
+		space = GS_CS_709_EXTENDED;
 		break;
 	default:
+		switch (info->format) {
+		case VIDEO_FORMAT_I010:
+		case VIDEO_FORMAT_P010:
+		case VIDEO_FORMAT_P216:
+		case VIDEO_FORMAT_P416:
+			space = GS_CS_SRGB_16F;
+			break;
+		default:
+			space = GS_CS_SRGB;
+			break;
+		}
 		break;
 	}
 
+	video->render_texture =
+		gs_texture_create(video->ovi.base_width, video->ovi.base_height,
+				  format, 1, NULL, GS_RENDER_TARGET);
+	if (!video->render_texture)
+		return false;
+
+	video->render_space = space;
+	return true;
+}
+
+static void obs_free_gpu_conversion_textures(struct obs_core_video_mix *video)
+{
+	for (size_t c = 0; c < NUM_CHANNELS; c++) {
+		if (video->convert_textures[c]) {
+			gs_texture_destroy(video->convert_textures[c]);
+			video->convert_textures[c] = NULL;
+		}
+		if (video->convert_textures_encode[c]) {
+			gs_texture_destroy(video->convert_textures_encode[c]);
+			video->convert_textures_encode[c] = NULL;
+		}
+	}
+}
+
+static void obs_free_output_textures(struct obs_core_video_mix *video)
+{
+	for (size_t c = 0; c < NUM_CHANNELS; c++) {
+		if (video->mapped_surfaces[c]) {
+			gs_stagesurface_unmap(video->mapped_surfaces[c]);
+			video->mapped_surfaces[c] = NULL;
+		}
+	}
+
 	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->copy_surfaces[i][c]) {
+				gs_stagesurface_destroy(
+					video->copy_surfaces[i][c]);
+				video->copy_surfaces[i][c] = NULL;
+			}
+
+			video->active_copy_surfaces[i][c] = NULL;
+		}
+#ifdef _WIN32
+		if (video->copy_surfaces_encode[i]) {
+			gs_stagesurface_destroy(video->copy_surfaces_encode[i]);
+			video->copy_surfaces_encode[i] = NULL;
+		}
+#endif
+	}
+
+	if (video->output_texture) {
+		gs_texture_destroy(video->output_texture);
+		video->output_texture = NULL;
+	}
+}
+
+static bool obs_init_output_textures(struct obs_core_video_mix *video)
+{
+	const struct video_output_info *info =
+		video_output_get_info(video->video);
+	enum gs_color_format format = get_mix_texture_format(info);
+
+	bool success = true;
+
+	for (size_t i = 0; i < (size_t)video->readback_depth; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] =
@@ -459,70 +619,116 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		}
 	}
 
-	enum gs_color_space space = GS_CS_SRGB;
-	switch (info->colorspace) {
-	case VIDEO_CS_2100_PQ:
-	case VIDEO_CS_2100_HLG:
-		space = GS_CS_709_EXTENDED;
-		break;
-	default:
-		switch (info->format) {
-		case VIDEO_FORMAT_I010:
-		case VIDEO_FORMAT_P010:
-		case VIDEO_FORMAT_P216:
-		case VIDEO_FORMAT_P416:
-			space = GS_CS_SRGB_16F;
-			break;
-		default:
-			space = GS_CS_SRGB;
-			break;
-		}
-		break;
-	}
-
-	video->render_texture =
-		gs_texture_create(video->ovi.base_width, video->ovi.base_height,
-				  format, 1, NULL, GS_RENDER_TARGET);
-	if (!video->render_texture)
-		success = false;
-
 	video->output_texture = gs_texture_create(
 		info->width, info->height, format, 1, NULL, GS_RENDER_TARGET);
 	if (!video->output_texture)
 		success = false;
 
-	if (success) {
-		video->render_space = space;
-	} else {
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
-			for (size_t c = 0; c < NUM_CHANNELS; c++) {
-				if (video->copy_surfaces[i][c]) {
-					gs_stagesurface_destroy(
-						video->copy_surfaces[i][c]);
-					video->copy_surfaces[i][c] = NULL;
-				}
-			}
+	if (!success)
+		obs_free_output_textures(video);
+
+	return success;
+}
+
+static inline uint64_t texture_vram(gs_texture_t *tex)
+{
+	if (!tex)
+		return 0;
+
+	return (uint64_t)gs_texture_get_width(tex) *
+	       gs_texture_get_height(tex) *
+	       gs_get_format_bpp(gs_texture_get_color_format(tex)) / 8;
+}
+
+static inline uint64_t stagesurface_vram(gs_stagesurf_t *surf)
+{
+	if (!surf)
+		return 0;
+
+	return (uint64_t)gs_stagesurface_get_width(surf) *
+	       gs_stagesurface_get_height(surf) *
+	       gs_get_format_bpp(gs_stagesurface_get_color_format(surf)) / 8;
+}
+
+static void update_mix_vram_usage(struct obs_core_video_mix *video)
+{
+	uint64_t size = texture_vram(video->render_texture) +
+			texture_vram(video->output_texture);
+
+	for (size_t c = 0; c < NUM_CHANNELS; c++) {
+		size += texture_vram(video->convert_textures[c]);
+		size += texture_vram(video->convert_textures_encode[c]);
+	}
+
+	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t c = 0; c < NUM_CHANNELS; c++)
+			size += stagesurface_vram(video->copy_surfaces[i][c]);
 #ifdef _WIN32
-			if (video->copy_surfaces_encode[i]) {
-				gs_stagesurface_destroy(
-					video->copy_surfaces_encode[i]);
-				video->copy_surfaces_encode[i] = NULL;
-			}
-#endif
+		/* biplanar surfaces have no single color format */
+		if (video->copy_surfaces_encode[i]) {
+			gs_stagesurf_t *surf = video->copy_surfaces_encode[i];
+			uint64_t luma =
+				(uint64_t)gs_stagesurface_get_width(surf) *
+				gs_stagesurface_get_height(surf);
+			size += luma * 3 / 2 * (video->using_p010_tex ? 2 : 1);
 		}
+#endif
+	}
 
-		if (video->render_texture) {
-			gs_texture_destroy(video->render_texture);
-			video->render_texture = NULL;
-		}
+	os_atomic_store_int64(&video->vram_usage, (int64_t)size);
+}
 
-		if (video->output_texture) {
-			gs_texture_destroy(video->output_texture);
-			video->output_texture = NULL;
-		}
+bool obs_video_mix_init_conversion(struct obs_core_video_mix *video)
+{
+	if (video->conversion_allocated)
+		return true;
+
+	if (video->gpu_conversion &&
+	    !obs_init_gpu_conversion_textures(video))
+		return false;
+
+	if (!obs_init_output_textures(video)) {
+		obs_free_gpu_conversion_textures(video);
+		return false;
 	}
 
-	return success;
+	video->conversion_allocated = true;
+	update_mix_vram_usage(video);
+	return true;
+}
+
+void obs_video_mix_free_conversion(struct obs_core_video_mix *video)
+{
+	if (!video->conversion_allocated)
+		return;
+
+	obs_free_output_textures(video);
+	obs_free_gpu_conversion_textures(video);
+
+	memset(video->textures_copied, 0, sizeof(video->textures_copied));
+	video->texture_converted = false;
+	video->conversion_allocated = false;
+	update_mix_vram_usage(video);
+}
+
+bool obs_video_mix_set_output_size(struct obs_core_video_mix *video,
+				   uint32_t width, uint32_t height)
+{
+	if (!video_output_set_size(video->video, width, height))
+		return false;
+
+	obs_video_mix_free_conversion(video);
+	video->ovi.output_width = width;
+	video->ovi.output_height = height;
+
+	if (video->gpu_conversion) {
+		calc_gpu_conversion_sizes(video);
+		set_packed_conversion(video,
+				      video_output_get_info(video->video));
+	}
+
+	blog(LOG_INFO, "video output size changed to %ux%u", width, height);
+	return true;
 }
 
 gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
@@ -676,23 +882,32 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 {
 	struct video_output_info vi;
 
-	pthread_mutex_init_value(&video->gpu_encoder_mutex);
+	os_mutex_init_value(&video->gpu_encoder_mutex);
 
-	make_video_info(&vi, ovi);
 	video->ovi = *ovi;
 
-	/* main view graphics thread drives all frame output,
-	 * so share FPS settings for aux views */
+	/* mixes without a frame rate of their own follow the main mix, the
+	 * others are rendered on deadlines of their own by the graphics
+	 * thread */
 	pthread_mutex_lock(&obs->video.mixes_mutex);
-	size_t num = obs->video.mixes.num;
-	if (num && obs->video.main_mix) {
+	if ((!ovi->fps_num || !ovi->fps_den) && obs->video.main_mix) {
 		struct obs_video_info main_ovi = obs->video.main_mix->ovi;
 		video->ovi.fps_num = main_ovi.fps_num;
 		video->ovi.fps_den = main_ovi.fps_den;
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
+	if (!video->ovi.fps_num || !video->ovi.fps_den)
+		return OBS_VIDEO_INVALID_PARAM;
+
+	make_video_info(&vi, &video->ovi);
+	video->frame_interval_ns = util_mul_div64(
+		1000000000ULL, video->ovi.fps_den, video->ovi.fps_num);
+
 	video->gpu_conversion = ovi->gpu_conversion;
+	video->readback_depth = obs->video.readback_depth
+					? (int)obs->video.readback_depth
+					: DEFAULT_READBACK_DEPTH;
 	video->gpu_was_active = false;
 	video->raw_was_active = false;
 	video->was_active = false;
@@ -710,7 +925,7 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 		return OBS_VIDEO_FAIL;
 	}
 
-	if (pthread_mutex_init(&video->gpu_encoder_mutex, NULL) < 0)
+	if (os_mutex_init(&video->gpu_encoder_mutex, "gpu_encoder_mutex") < 0)
 		return OBS_VIDEO_FAIL;
 
 	gs_enter_context(obs->video.graphics);
@@ -719,6 +934,7 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 		return OBS_VIDEO_FAIL;
 	if (!obs_init_textures(video))
 		return OBS_VIDEO_FAIL;
+	update_mix_vram_usage(video);
 
 	gs_leave_context();
 
@@ -731,8 +947,14 @@ struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi)
 		bzalloc(sizeof(struct obs_core_video_mix));
 	if (obs_init_video_mix(ovi, video) != OBS_VIDEO_SUCCESS) {
 		bfree(video);
-		video = NULL;
+		return NULL;
 	}
+
+	struct os_thread_scheduling *sched =
+		&obs->thread_scheduling[OBS_THREAD_ROLE_VIDEO_OUTPUT];
+	if (os_atomic_load_long(&sched->serial))
+		video_output_set_thread_scheduling(
+			video->video, sched->priority, sched->affinity);
 	return video;
 }
 
@@ -751,6 +973,15 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (pthread_mutex_init(&video->mixes_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
 
+	video->render_time_metric =
+		metric_get(METRIC_HISTOGRAM, "obs_render_time_seconds", NULL,
+			   "Time spent rendering each frame");
+	video->frames_metric = metric_get(METRIC_COUNTER, "obs_frames_total",
+					  NULL, "Frames output by libobs");
+	video->lagged_frames_metric =
+		metric_get(METRIC_COUNTER, "obs_frames_lagged_total", NULL,
+			   "Frames missed due to rendering lag");
+
 	if (!obs_view_add2(&obs->data.main_view, ovi))
 		return OBS_VIDEO_FAIL;
 
@@ -796,47 +1027,10 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 
 	gs_enter_context(obs->video.graphics);
 
-	for (size_t c = 0; c < NUM_CHANNELS; c++) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
-		}
-	}
-
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
-		for (size_t c = 0; c < NUM_CHANNELS; c++) {
-			if (video->copy_surfaces[i][c]) {
-				gs_stagesurface_destroy(
-					video->copy_surfaces[i][c]);
-				video->copy_surfaces[i][c] = NULL;
-			}
-
-			video->active_copy_surfaces[i][c] = NULL;
-		}
-#ifdef _WIN32
-		if (video->copy_surfaces_encode[i]) {
-			gs_stagesurface_destroy(video->copy_surfaces_encode[i]);
-			video->copy_surfaces_encode[i] = NULL;
-		}
-#endif
-	}
+	obs_video_mix_free_conversion(video);
 
 	gs_texture_destroy(video->render_texture);
-
-	for (size_t c = 0; c < NUM_CHANNELS; c++) {
-		if (video->convert_textures[c]) {
-			gs_texture_destroy(video->convert_textures[c]);
-			video->convert_textures[c] = NULL;
-		}
-		if (video->convert_textures_encode[c]) {
-			gs_texture_destroy(video->convert_textures_encode[c]);
-			video->convert_textures_encode[c] = NULL;
-		}
-	}
-
-	gs_texture_destroy(video->output_texture);
 	video->render_texture = NULL;
-	video->output_texture = NULL;
 
 	gs_leave_context();
 }
@@ -857,13 +1051,14 @@ void obs_free_video_mix(struct obs_core_video_mix *video)
 		       sizeof(video->textures_copied));
 		video->texture_converted = false;
 
-		pthread_mutex_destroy(&video->gpu_encoder_mutex);
-		pthread_mutex_init_value(&video->gpu_encoder_mutex);
+		os_mutex_destroy(&video->gpu_encoder_mutex);
+		os_mutex_init_value(&video->gpu_encoder_mutex);
 		da_free(video->gpu_encoders);
 
 		video->gpu_encoder_active = 0;
 		video->cur_texture = 0;
 	}
+	os_task_queue_destroy(video->output_task_queue);
 	bfree(video);
 }
 
@@ -898,6 +1093,19 @@ static void obs_free_video(void)
 	pthread_mutex_destroy(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	deque_free(&obs->video.tasks);
+
+	for (size_t i = 0; i < obs->video.num_upload_workers; i++)
+		os_task_queue_destroy(obs->video.upload_workers[i]);
+	obs->video.num_upload_workers = 0;
+	da_free(obs->video.async_uploads);
+	da_free(obs->video.async_upload_chunks);
+
+	metric_release(obs->video.render_time_metric);
+	metric_release(obs->video.frames_metric);
+	metric_release(obs->video.lagged_frames_metric);
+	obs->video.render_time_metric = NULL;
+	obs->video.frames_metric = NULL;
+	obs->video.lagged_frames_metric = NULL;
 }
 
 static void obs_free_graphics(void)
@@ -911,6 +1119,9 @@ static void obs_free_graphics(void)
 
 		gs_samplerstate_destroy(video->point_sampler);
 
+		obs_gpu_timing_free();
+		obs_tonemap_luts_free();
+
 		gs_effect_destroy(video->default_effect);
 		gs_effect_destroy(video->default_rect_effect);
 		gs_effect_destroy(video->opaque_effect);
@@ -949,11 +1160,22 @@ static bool obs_init_audio(struct audio_output_info *ai)
 
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
+	audio->monitoring_buffer_ms = MONITORING_BUFFER_MS_DEFAULT;
+
+	audio->buffering_metric =
+		metric_get(METRIC_GAUGE, "obs_audio_buffering_milliseconds",
+			   NULL, "Total audio buffering");
 
 	errorcode = audio_output_open(&audio->audio, ai);
-	if (errorcode == AUDIO_OUTPUT_SUCCESS)
+	if (errorcode == AUDIO_OUTPUT_SUCCESS) {
+		struct os_thread_scheduling *sched =
+			&obs->thread_scheduling[OBS_THREAD_ROLE_AUDIO];
+		if (os_atomic_load_long(&sched->serial))
+			audio_output_set_thread_scheduling(audio->audio,
+							   sched->priority,
+							   sched->affinity);
 		return true;
-	else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
+	} else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
 		blog(LOG_ERROR, "Invalid audio parameters specified");
 	else
 		blog(LOG_ERROR, "Could not open audio output");
@@ -980,6 +1202,12 @@ static void obs_free_audio(void)
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
+	da_free(audio->render_batch);
+
+	for (size_t i = 0; i < audio->num_render_workers; i++)
+		os_task_queue_destroy(audio->render_workers[i]);
+	for (size_t i = 0; i < audio->num_encode_workers; i++)
+		os_task_queue_destroy(audio->encode_workers[i]);
 
 	da_free(audio->monitors);
 	bfree(audio->monitoring_device_name);
@@ -987,6 +1215,7 @@ static void obs_free_audio(void)
 	deque_free(&audio->tasks);
 	pthread_mutex_destroy(&audio->task_mutex);
 	pthread_mutex_destroy(&audio->monitoring_mutex);
+	metric_release(audio->buffering_metric);
 
 	memset(audio, 0, sizeof(struct obs_core_audio));
 }
@@ -999,21 +1228,33 @@ static bool obs_init_data(void)
 
 	pthread_mutex_init_value(&obs->data.displays_mutex);
 	pthread_mutex_init_value(&obs->data.draw_callbacks_mutex);
+	pthread_mutex_init_value(&obs->data.deferred_sources_mutex);
+	pthread_mutex_init_value(&obs->data.tick_mutex);
+	pthread_mutex_init_value(&obs->data.preloads_mutex);
 
-	if (pthread_mutex_init_recursive(&data->sources_mutex) != 0)
+	if (os_mutex_init_recursive(&data->sources_mutex, "sources_mutex") != 0)
 		goto fail;
-	if (pthread_mutex_init_recursive(&data->audio_sources_mutex) != 0)
+	if (os_mutex_init_recursive(&data->audio_sources_mutex,
+				    "audio_sources_mutex") != 0)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->displays_mutex) != 0)
 		goto fail;
-	if (pthread_mutex_init_recursive(&data->outputs_mutex) != 0)
+	if (os_mutex_init_recursive(&data->outputs_mutex, "outputs_mutex") != 0)
 		goto fail;
-	if (pthread_mutex_init_recursive(&data->encoders_mutex) != 0)
+	if (os_mutex_init_recursive(&data->encoders_mutex,
+				    "encoders_mutex") != 0)
 		goto fail;
-	if (pthread_mutex_init_recursive(&data->services_mutex) != 0)
+	if (os_mutex_init_recursive(&data->services_mutex,
+				    "services_mutex") != 0)
 		goto fail;
 	if (pthread_mutex_init_recursive(&obs->data.draw_callbacks_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&data->deferred_sources_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&data->tick_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&data->preloads_mutex, NULL) != 0)
+		goto fail;
 
 	if (!obs_view_init(&data->main_view))
 		goto fail;
@@ -1076,6 +1317,10 @@ static void obs_free_data(void)
 
 	blog(LOG_INFO, "Freeing OBS context data");
 
+	while (data->preloads.num)
+		obs_source_release_preload(data->preloads.array[0].source);
+	da_free(data->preloads);
+
 	FREE_OBS_LINKED_LIST(output);
 	FREE_OBS_LINKED_LIST(encoder);
 	FREE_OBS_LINKED_LIST(display);
@@ -1086,13 +1331,17 @@ static void obs_free_data(void)
 
 	os_task_queue_wait(obs->destruction_task_thread);
 
-	pthread_mutex_destroy(&data->sources_mutex);
-	pthread_mutex_destroy(&data->audio_sources_mutex);
+	os_mutex_destroy(&data->sources_mutex);
+	os_mutex_destroy(&data->audio_sources_mutex);
 	pthread_mutex_destroy(&data->displays_mutex);
-	pthread_mutex_destroy(&data->outputs_mutex);
-	pthread_mutex_destroy(&data->encoders_mutex);
-	pthread_mutex_destroy(&data->services_mutex);
+	os_mutex_destroy(&data->outputs_mutex);
+	os_mutex_destroy(&data->encoders_mutex);
+	os_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
+	pthread_mutex_destroy(&data->deferred_sources_mutex);
+	pthread_mutex_destroy(&data->tick_mutex);
+	pthread_mutex_destroy(&data->preloads_mutex);
+	da_free(data->deferred_sources);
 	da_free(data->draw_callbacks);
 	da_free(data->rendered_callbacks);
 	da_free(data->tick_callbacks);
@@ -1102,6 +1351,15 @@ static void obs_free_data(void)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
 	da_free(data->sources_to_tick);
+	da_free(data->parallel_ticks);
+
+	for (size_t i = 0; i < data->tick_list.num; i++)
+		obs_weak_source_release(data->tick_list.array[i]);
+	da_free(data->tick_list);
+
+	for (size_t i = 0; i < data->tick_pending.num; i++)
+		obs_weak_source_release(data->tick_pending.array[i]);
+	da_free(data->tick_pending);
 }
 
 static const char *obs_signals[] = {
@@ -1124,6 +1382,8 @@ static const char *obs_signals[] = {
 	"void source_transition_start(ptr source)",
 	"void source_transition_video_stop(ptr source)",
 	"void source_transition_stop(ptr source)",
+	"void source_load_progress(int loaded, int total)",
+	"void audio_buffering(ptr source, int ms, int total_ms)",
 
 	"void channel_change(int channel, in out ptr source, ptr prev_source)",
 
@@ -1167,6 +1427,9 @@ static inline bool obs_init_hotkeys(void)
 	hotkeys->sceneitem_show = bstrdup("Show '%1'");
 	hotkeys->sceneitem_hide = bstrdup("Hide '%1'");
 
+	/* the platform may start delivering key events right away */
+	if (os_event_init(&hotkeys->wake_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
 	if (!obs_hotkeys_platform_init(hotkeys))
 		return false;
 
@@ -1195,6 +1458,7 @@ static inline void stop_hotkeys(void)
 
 	if (hotkeys->hotkey_thread_initialized) {
 		os_event_signal(hotkeys->stop_event);
+		os_event_signal(hotkeys->wake_event);
 		pthread_join(hotkeys->hotkey_thread, &thread_ret);
 		hotkeys->hotkey_thread_initialized = false;
 	}
@@ -1217,6 +1481,8 @@ static inline void obs_free_hotkeys(void)
 	obs_hotkey_name_map_free();
 
 	obs_hotkeys_platform_free(hotkeys);
+	os_event_destroy(hotkeys->wake_event);
+	hotkeys->wake_event = NULL;
 	pthread_mutex_destroy(&hotkeys->mutex);
 }
 
@@ -1249,6 +1515,7 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
+	pthread_mutex_init_value(&obs->clock.holds_mutex);
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -1261,15 +1528,28 @@ static bool obs_init(const char *locale, const char *module_config_path,
 
 	if (!obs_init_data())
 		return false;
+	obs_encoder_packet_pool_init();
 	if (!obs_init_handlers())
 		return false;
 	if (!obs_init_hotkeys())
 		return false;
+	if (!obs_clock_init())
+		return false;
+	if (!obs_latency_init())
+		return false;
 
 	obs->destruction_task_thread = os_task_queue_create();
 	if (!obs->destruction_task_thread)
 		return false;
 
+	obs->source_load_thread = os_task_queue_create();
+	if (!obs->source_load_thread)
+		return false;
+
+	obs->task_pool = os_task_pool_create(0);
+	if (!obs->task_pool)
+		return false;
+
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
 	obs->locale = bstrdup(locale);
@@ -1393,10 +1673,24 @@ struct obs_cmdline_args obs_get_cmdline_args(void)
 	return cmdline_args;
 }
 
+static void free_deferred_sources(void)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_lock(&data->deferred_sources_mutex);
+	for (size_t i = 0; i < data->deferred_sources.num; i++)
+		obs_weak_source_release(data->deferred_sources.array[i]);
+	da_free(data->deferred_sources);
+	pthread_mutex_unlock(&data->deferred_sources_mutex);
+}
+
 void obs_shutdown(void)
 {
 	struct obs_module *module;
 
+	free_deferred_sources();
+	os_task_queue_wait(obs->source_load_thread);
+
 	obs_wait_for_destroy_queue();
 
 	for (size_t i = 0; i < obs->source_types.num; i++) {
@@ -1407,6 +1701,8 @@ void obs_shutdown(void)
 			bfree((void *)item->id);
 	}
 	da_free(obs->source_types);
+	da_free(obs->source_type_modules);
+	obs_type_index_free(&obs->source_type_index);
 
 #define FREE_REGISTERED_TYPES(structure, list)                         \
 	do {                                                           \
@@ -1422,6 +1718,10 @@ void obs_shutdown(void)
 	FREE_REGISTERED_TYPES(obs_encoder_info, obs->encoder_types);
 	FREE_REGISTERED_TYPES(obs_service_info, obs->service_types);
 
+	obs_type_index_free(&obs->output_type_index);
+	obs_type_index_free(&obs->encoder_type_index);
+	obs_type_index_free(&obs->service_type_index);
+
 #undef FREE_REGISTERED_TYPES
 
 	da_free(obs->input_types);
@@ -1432,6 +1732,9 @@ void obs_shutdown(void)
 	stop_audio();
 	stop_hotkeys();
 
+	/* background tasks may still be running module code */
+	os_task_pool_wait(obs->task_pool);
+
 	module = obs->first_module;
 	while (module) {
 		struct obs_module *next = module->next;
@@ -1443,8 +1746,13 @@ void obs_shutdown(void)
 	obs_free_data();
 	obs_free_audio();
 	obs_free_video();
+	obs_encoder_packet_pool_free();
 	os_task_queue_destroy(obs->destruction_task_thread);
+	os_task_queue_destroy(obs->source_load_thread);
+	os_task_pool_destroy(obs->task_pool);
 	obs_free_hotkeys();
+	obs_clock_free();
+	obs_latency_free();
 	obs_free_graphics();
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
@@ -1592,6 +1900,42 @@ int obs_reset_video(struct obs_video_info *ovi)
 	return obs_init_video(ovi);
 }
 
+int obs_reset_video_output_size(video_t *video, uint32_t width,
+				uint32_t height)
+{
+	int ret = OBS_VIDEO_FAIL;
+
+	if (!obs || !video)
+		return OBS_VIDEO_FAIL;
+
+	if (!size_valid(width, height))
+		return OBS_VIDEO_INVALID_PARAM;
+
+	/* align to multiple-of-two and SSE alignment sizes */
+	width &= 0xFFFFFFFC;
+	height &= 0xFFFFFFFE;
+
+	pthread_mutex_lock(&obs->video.mixes_mutex);
+	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
+		if (mix->video != video)
+			continue;
+
+		if (os_atomic_load_long(&mix->gpu_encoder_active) > 0) {
+			ret = OBS_VIDEO_CURRENTLY_ACTIVE;
+		} else {
+			mix->pending_output_width = width;
+			mix->pending_output_height = height;
+			mix->output_size_pending = true;
+			ret = OBS_VIDEO_SUCCESS;
+		}
+		break;
+	}
+	pthread_mutex_unlock(&obs->video.mixes_mutex);
+
+	return ret;
+}
+
 #ifndef SEC_TO_MSEC
 #define SEC_TO_MSEC 1000
 #endif
@@ -1599,7 +1943,7 @@ int obs_reset_video(struct obs_video_info *ovi)
 bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
-	struct audio_output_info ai;
+	struct audio_output_info ai = {0};
 
 	/* don't allow changing of audio settings if active. */
 	if (!obs || (audio->audio && audio_output_active(audio->audio)))
@@ -1618,6 +1962,8 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 		audio->max_buffering_ticks = 45;
 	}
 	audio->fixed_buffer = oai->fixed_buffering;
+	audio->buffering_reduce_ns =
+		(uint64_t)oai->buffering_reduce_ms * 1000000ULL;
 
 	int max_buffering_ms = audio->max_buffering_ticks *
 			       AUDIO_OUTPUT_FRAMES * SEC_TO_MSEC /
@@ -1628,6 +1974,10 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 	ai.format = AUDIO_FORMAT_FLOAT_PLANAR;
 	ai.speakers = oai->speakers;
 	ai.input_callback = audio_callback;
+	if (obs->clock.offline) {
+		ai.clock_callback = obs_clock_audio_now;
+		ai.sleepto_callback = obs_clock_audio_sleepto;
+	}
 
 	blog(LOG_INFO, "---------------------------------");
 	blog(LOG_INFO,
@@ -1682,6 +2032,108 @@ void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level)
 	video->hdr_nominal_peak_level = hdr_nominal_peak_level;
 }
 
+void obs_set_parallel_mix_output(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->video.parallel_mix_output = enable;
+}
+
+bool obs_parallel_mix_output_enabled(void)
+{
+	return obs ? obs->video.parallel_mix_output : false;
+}
+
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (!obs)
+		return;
+
+	if (depth < DEFAULT_READBACK_DEPTH)
+		depth = DEFAULT_READBACK_DEPTH;
+	else if (depth > NUM_TEXTURES)
+		depth = NUM_TEXTURES;
+
+	obs->video.readback_depth = depth;
+}
+
+uint32_t obs_get_video_readback_depth(void)
+{
+	if (!obs || !obs->video.readback_depth)
+		return DEFAULT_READBACK_DEPTH;
+
+	return obs->video.readback_depth;
+}
+
+uint32_t obs_get_video_readback_latency(video_t *video)
+{
+	struct obs_core_video_mix *mix = get_mix_for_video(video);
+	return mix ? (uint32_t)os_atomic_load_long(&mix->readback_latency)
+		   : 0;
+}
+
+void obs_set_video_conversion_idle_time(uint32_t idle_ms)
+{
+	if (!obs)
+		return;
+
+	obs->video.conversion_idle_ms = idle_ms ? idle_ms : 1;
+}
+
+uint32_t obs_get_video_conversion_idle_time(void)
+{
+	if (!obs || !obs->video.conversion_idle_ms)
+		return DEFAULT_CONVERSION_IDLE_MS;
+
+	return obs->video.conversion_idle_ms;
+}
+
+uint64_t obs_get_video_vram_usage(video_t *video)
+{
+	struct obs_core_video_mix *mix = get_mix_for_video(video);
+	return mix ? (uint64_t)os_atomic_load_int64(&mix->vram_usage) : 0;
+}
+
+void obs_set_parallel_audio_render(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->audio.parallel_render = enable;
+}
+
+bool obs_parallel_audio_render_enabled(void)
+{
+	return obs ? obs->audio.parallel_render : false;
+}
+
+void obs_set_parallel_source_tick(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->data.parallel_tick, enable);
+}
+
+bool obs_parallel_source_tick_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->data.parallel_tick) : false;
+}
+
+void obs_set_parallel_audio_encode(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->audio.parallel_encode, enable);
+}
+
+bool obs_parallel_audio_encode_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->audio.parallel_encode) : false;
+}
+
 bool obs_get_audio_info(struct obs_audio_info *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -1697,6 +2149,17 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 	return true;
 }
 
+uint32_t obs_get_audio_buffering_ms(void)
+{
+	struct obs_core_audio *audio = &obs->audio;
+
+	if (!audio->audio)
+		return 0;
+
+	return (uint32_t)audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES *
+	       1000 / audio_output_get_sample_rate(audio->audio);
+}
+
 bool obs_enum_source_types(size_t idx, const char **id)
 {
 	if (idx >= obs->source_types.num)
@@ -1825,7 +2288,10 @@ void obs_set_output_source(uint32_t channel, obs_source_t *source)
 
 	struct obs_source *prev_source;
 	struct obs_view *view = &obs->data.main_view;
-	struct calldata params = {0};
+	struct calldata params;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
 
 	pthread_mutex_lock(&view->channels_mutex);
 
@@ -1853,59 +2319,65 @@ void obs_set_output_source(uint32_t channel, obs_source_t *source)
 	}
 }
 
-void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param)
+/* Enumerates a snapshot of the public sources.  References are taken while
+ * sources_mutex is held, and the callbacks are called after it has been
+ * released, so that slow callbacks don't hold up the graphics thread or
+ * sources being created and destroyed. */
+static void enum_public_sources(bool (*filter)(obs_source_t *),
+				bool (*enum_proc)(void *, obs_source_t *),
+				void *param)
 {
+	DARRAY(obs_source_t *) sources = {0};
 	obs_source_t *source;
+	size_t i;
 
-	pthread_mutex_lock(&obs->data.sources_mutex);
-	source = obs->data.public_sources;
+	os_mutex_lock(&obs->data.sources_mutex);
 
+	source = obs->data.public_sources;
 	while (source) {
-		obs_source_t *s = obs_source_get_ref(source);
-		if (s) {
-			if (s->info.type == OBS_SOURCE_TYPE_INPUT &&
-			    !enum_proc(param, s)) {
-				obs_source_release(s);
-				break;
-			} else if (strcmp(s->info.id, group_info.id) == 0 &&
-				   !enum_proc(param, s)) {
-				obs_source_release(s);
-				break;
-			}
-			obs_source_release(s);
+		if (filter(source)) {
+			obs_source_t *s = obs_source_get_ref(source);
+			if (s)
+				da_push_back(sources, &s);
 		}
 
 		source = (obs_source_t *)source->context.hh.next;
 	}
 
-	pthread_mutex_unlock(&obs->data.sources_mutex);
+	os_mutex_unlock(&obs->data.sources_mutex);
+
+	for (i = 0; i < sources.num; i++) {
+		if (!enum_proc(param, sources.array[i]))
+			break;
+	}
+
+	for (i = 0; i < sources.num; i++)
+		obs_source_release(sources.array[i]);
+	da_free(sources);
 }
 
-void obs_enum_scenes(bool (*enum_proc)(void *, obs_source_t *), void *param)
+static bool is_input_or_group(obs_source_t *source)
 {
-	obs_source_t *source;
-
-	pthread_mutex_lock(&obs->data.sources_mutex);
+	return source->info.type == OBS_SOURCE_TYPE_INPUT ||
+	       strcmp(source->info.id, group_info.id) == 0;
+}
 
-	source = obs->data.public_sources;
-	while (source) {
-		obs_source_t *s = obs_source_get_ref(source);
-		if (s) {
-			if (source->info.type == OBS_SOURCE_TYPE_SCENE &&
-			    !enum_proc(param, s)) {
-				obs_source_release(s);
-				break;
-			}
-			obs_source_release(s);
-		}
+static bool is_scene(obs_source_t *source)
+{
+	return source->info.type == OBS_SOURCE_TYPE_SCENE;
+}
 
-		source = (obs_source_t *)source->context.hh.next;
-	}
+void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param)
+{
+	enum_public_sources(is_input_or_group, enum_proc, param);
+}
 
-	pthread_mutex_unlock(&obs->data.sources_mutex);
+void obs_enum_scenes(bool (*enum_proc)(void *, obs_source_t *), void *param)
+{
+	enum_public_sources(is_scene, enum_proc, param);
 }
 
-static inline void obs_enum(void *pstart, pthread_mutex_t *mutex, void *proc,
+static inline void obs_enum(void *pstart, os_mutex_t *mutex, void *proc,
 			    void *param)
 {
 	struct obs_context_data **start = pstart, *context;
@@ -1915,7 +2387,7 @@ static inline void obs_enum(void *pstart, pthread_mutex_t *mutex, void *proc,
 	assert(mutex);
 	assert(enum_proc);
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 
 	context = *start;
 	while (context) {
@@ -1925,11 +2397,11 @@ static inline void obs_enum(void *pstart, pthread_mutex_t *mutex, void *proc,
 		context = context->next;
 	}
 
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 }
 
-static inline void obs_enum_uuid(void *pstart, pthread_mutex_t *mutex,
-				 void *proc, void *param)
+static inline void obs_enum_uuid(void *pstart, os_mutex_t *mutex, void *proc,
+				 void *param)
 {
 	struct obs_context_data **start = pstart, *context, *tmp;
 	bool (*enum_proc)(void *, void *) = proc;
@@ -1938,14 +2410,14 @@ static inline void obs_enum_uuid(void *pstart, pthread_mutex_t *mutex,
 	assert(mutex);
 	assert(enum_proc);
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 
 	HASH_ITER (hh_uuid, *start, context, tmp) {
 		if (!enum_proc(param, context))
 			break;
 	}
 
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 }
 
 void obs_enum_all_sources(bool (*enum_proc)(void *, obs_source_t *),
@@ -1974,13 +2446,13 @@ void obs_enum_services(bool (*enum_proc)(void *, obs_service_t *), void *param)
 }
 
 static inline void *get_context_by_name(void *vfirst, const char *name,
-					pthread_mutex_t *mutex,
+					os_mutex_t *mutex,
 					void *(*addref)(void *))
 {
 	struct obs_context_data **first = vfirst;
 	struct obs_context_data *context;
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 
 	/* If context list head has a hash table, look the name up in there */
 	if (*first && (*first)->hh.tbl) {
@@ -2000,24 +2472,23 @@ static inline void *get_context_by_name(void *vfirst, const char *name,
 	if (context)
 		addref(context);
 
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 	return context;
 }
 
 static void *get_context_by_uuid(void *ptable, const char *uuid,
-				 pthread_mutex_t *mutex,
-				 void *(*addref)(void *))
+				 os_mutex_t *mutex, void *(*addref)(void *))
 {
 	struct obs_context_data **ht = ptable;
 	struct obs_context_data *context;
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 
 	HASH_FIND_UUID(*ht, uuid, context);
 	if (context)
 		addref(context);
 
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 	return context;
 }
 
@@ -2065,7 +2536,7 @@ obs_source_t *obs_get_transition_by_name(const char *name)
 	struct obs_source **first = &obs->data.sources;
 	struct obs_source *source;
 
-	pthread_mutex_lock(&obs->data.sources_mutex);
+	os_mutex_lock(&obs->data.sources_mutex);
 
 	/* Transitions are private but can be found via this method, so we
 	 * can't look them up by name in the public_sources hash table. */
@@ -2079,7 +2550,7 @@ obs_source_t *obs_get_transition_by_name(const char *name)
 		source = (void *)source->context.hh_uuid.next;
 	}
 
-	pthread_mutex_unlock(&obs->data.sources_mutex);
+	os_mutex_unlock(&obs->data.sources_mutex);
 	return source;
 }
 
@@ -2333,6 +2804,11 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data,
 	obs_source_set_push_to_talk_delay(
 		source, obs_data_get_int(source_data, "push-to-talk-delay"));
 
+	obs_data_set_default_int(source_data, "render_divisor", 1);
+	obs_source_set_render_divisor(
+		source,
+		(uint32_t)obs_data_get_int(source_data, "render_divisor"));
+
 	di_mode = (int)obs_data_get_int(source_data, "deinterlace_mode");
 	obs_source_set_deinterlace_mode(source,
 					(enum obs_deinterlace_mode)di_mode);
@@ -2342,6 +2818,19 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data,
 	obs_source_set_deinterlace_field_order(
 		source, (enum obs_deinterlace_field_order)di_order);
 
+	/* only when saved, sources may pick their own timing on creation */
+	if (obs_data_has_user_value(source_data, "async_timing")) {
+		int timing = (int)obs_data_get_int(source_data, "async_timing");
+		obs_source_set_async_timing(source,
+					    (enum obs_async_timing)timing);
+		obs_source_set_async_latency_target(
+			source, (uint64_t)obs_data_get_int(
+					source_data, "async_latency_target"));
+		obs_source_set_async_max_frames(
+			source, (size_t)obs_data_get_int(source_data,
+							 "async_max_frames"));
+	}
+
 	monitoring_type = (int)obs_data_get_int(source_data, "monitoring_type");
 	if (prev_ver < MAKE_SEMANTIC_VERSION(23, 2, 2)) {
 		if ((caps & OBS_SOURCE_MONITOR_BY_DEFAULT) != 0) {
@@ -2396,8 +2885,107 @@ obs_source_t *obs_load_private_source(obs_data_t *source_data)
 	return obs_load_source_type(source_data, true);
 }
 
-void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
-		      void *private_data)
+/* shown and active sources are created first */
+static size_t deferred_source_priority(obs_weak_source_t *weak)
+{
+	obs_source_t *source = obs_weak_source_get_source(weak);
+	size_t priority = 0;
+
+	if (!source)
+		return 0;
+
+	if (os_atomic_load_long(&source->activate_refs))
+		priority = 2;
+	else if (os_atomic_load_long(&source->show_refs))
+		priority = 1;
+
+	obs_source_release(source);
+	return priority;
+}
+
+static obs_weak_source_t *pop_deferred_source(void)
+{
+	struct obs_core_data *data = &obs->data;
+	obs_weak_source_t *weak;
+	size_t best = 0;
+	size_t best_priority = 0;
+
+	if (!data->deferred_sources.num)
+		return NULL;
+
+	for (size_t i = 0; i < data->deferred_sources.num; i++) {
+		weak = data->deferred_sources.array[i];
+		size_t priority = deferred_source_priority(weak);
+		if (priority > best_priority) {
+			best_priority = priority;
+			best = i;
+		}
+	}
+
+	weak = data->deferred_sources.array[best];
+	da_erase(data->deferred_sources, best);
+	return weak;
+}
+
+static void load_deferred_source(void *unused)
+{
+	struct obs_core_data *data = &obs->data;
+	obs_weak_source_t *weak;
+	obs_source_t *source;
+	long loaded, total;
+
+	pthread_mutex_lock(&data->deferred_sources_mutex);
+	weak = pop_deferred_source();
+	pthread_mutex_unlock(&data->deferred_sources_mutex);
+
+	if (!weak)
+		return;
+
+	/* the source may have been removed in the meantime */
+	source = obs_weak_source_get_source(weak);
+	obs_weak_source_release(weak);
+	if (source) {
+		obs_source_create_deferred(source);
+		obs_source_release(source);
+	}
+
+	pthread_mutex_lock(&data->deferred_sources_mutex);
+	loaded = ++data->deferred_sources_loaded;
+	total = data->deferred_sources_total;
+	if (loaded == total) {
+		data->deferred_sources_loaded = 0;
+		data->deferred_sources_total = 0;
+	}
+	pthread_mutex_unlock(&data->deferred_sources_mutex);
+
+	struct calldata params;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_int(&params, "loaded", loaded);
+	calldata_set_int(&params, "total", total);
+	signal_handler_signal(obs->signals, "source_load_progress", &params);
+	calldata_free(&params);
+
+	UNUSED_PARAMETER(unused);
+}
+
+static void queue_deferred_source(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+	obs_weak_source_t *weak = obs_source_get_weak_source(source);
+
+	pthread_mutex_lock(&data->deferred_sources_mutex);
+	da_push_back(data->deferred_sources, &weak);
+	data->deferred_sources_total++;
+	pthread_mutex_unlock(&data->deferred_sources_mutex);
+
+	os_task_queue_queue_task(obs->source_load_thread, load_deferred_source,
+				 NULL);
+}
+
+static void load_sources(obs_data_array_t *array, obs_load_source_cb cb,
+			 void *private_data, bool deferred)
 {
 	struct obs_core_data *data = &obs->data;
 	DARRAY(obs_source_t *) sources;
@@ -2409,7 +2997,9 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 	count = obs_data_array_count(array);
 	da_reserve(sources, count);
 
-	pthread_mutex_lock(&data->sources_mutex);
+	os_mutex_lock(&data->sources_mutex);
+
+	defer_source_create = deferred;
 
 	for (i = 0; i < count; i++) {
 		obs_data_t *source_data = obs_data_array_item(array, i);
@@ -2420,6 +3010,8 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 		obs_data_release(source_data);
 	}
 
+	defer_source_create = false;
+
 	/* tell sources that we want to load */
 	for (i = 0; i < sources.num; i++) {
 		obs_source_t *source = sources.array[i];
@@ -2434,14 +3026,32 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 		obs_data_release(source_data);
 	}
 
+	for (i = 0; i < sources.num; i++) {
+		obs_source_t *source = sources.array[i];
+		if (source && source->create_state)
+			queue_deferred_source(source);
+	}
+
 	for (i = 0; i < sources.num; i++)
 		obs_source_release(sources.array[i]);
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	os_mutex_unlock(&data->sources_mutex);
 
 	da_free(sources);
 }
 
+void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
+		      void *private_data)
+{
+	load_sources(array, cb, private_data, false);
+}
+
+void obs_load_sources_deferred(obs_data_array_t *array, obs_load_source_cb cb,
+			       void *private_data)
+{
+	load_sources(array, cb, private_data, true);
+}
+
 obs_data_t *obs_save_source(obs_source_t *source)
 {
 	obs_data_array_t *filters = obs_data_array_create();
@@ -2467,6 +3077,7 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	int m_type = (int)obs_source_get_monitoring_type(source);
 	int di_mode = (int)obs_source_get_deinterlace_mode(source);
 	int di_order = (int)obs_source_get_deinterlace_field_order(source);
+	int async_timing = (int)source->async_timing;
 	DARRAY(obs_source_t *) filters_copy;
 
 	obs_source_save(source);
@@ -2500,6 +3111,15 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	obs_data_set_int(source_data, "deinterlace_mode", di_mode);
 	obs_data_set_int(source_data, "deinterlace_field_order", di_order);
 	obs_data_set_int(source_data, "monitoring_type", m_type);
+	obs_data_set_int(source_data, "render_divisor", source->render_divisor);
+
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) != 0) {
+		obs_data_set_int(source_data, "async_timing", async_timing);
+		obs_data_set_int(source_data, "async_latency_target",
+				 (long long)source->async_latency_target);
+		obs_data_set_int(source_data, "async_max_frames",
+				 (long long)source->async_max_frames);
+	}
 
 	obs_data_set_obj(source_data, "private_settings",
 			 source->private_settings);
@@ -2549,7 +3169,7 @@ obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb,
 
 	array = obs_data_array_create();
 
-	pthread_mutex_lock(&data->sources_mutex);
+	os_mutex_lock(&data->sources_mutex);
 
 	source = data->public_sources;
 
@@ -2566,7 +3186,7 @@ obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb,
 		source = (obs_source_t *)source->context.hh.next;
 	}
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	os_mutex_unlock(&data->sources_mutex);
 
 	return array;
 }
@@ -2585,7 +3205,7 @@ obs_data_array_t *obs_save_sources(void)
 
 void obs_reset_source_uuids()
 {
-	pthread_mutex_lock(&obs->data.sources_mutex);
+	os_mutex_lock(&obs->data.sources_mutex);
 
 	/* Move all sources to a new hash table */
 	struct obs_context_data *ht =
@@ -2606,7 +3226,7 @@ void obs_reset_source_uuids()
 	 * been removed, so we can simply overwrite the pointer. */
 	obs->data.sources = (struct obs_source *)new_ht;
 
-	pthread_mutex_unlock(&obs->data.sources_mutex);
+	os_mutex_unlock(&obs->data.sources_mutex);
 }
 
 /* ensures that names are never blank */
@@ -2702,7 +3322,7 @@ void obs_context_init_control(struct obs_context_data *context, void *object,
 }
 
 void obs_context_data_insert(struct obs_context_data *context,
-			     pthread_mutex_t *mutex, void *pfirst)
+			     os_mutex_t *mutex, void *pfirst)
 {
 	struct obs_context_data **first = pfirst;
 
@@ -2712,13 +3332,13 @@ void obs_context_data_insert(struct obs_context_data *context,
 
 	context->mutex = mutex;
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 	context->prev_next = first;
 	context->next = *first;
 	*first = context;
 	if (context->next)
 		context->next->prev_next = &context->next;
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 }
 
 static inline char *obs_context_deduplicate_name(void *phash, const char *name)
@@ -2742,7 +3362,7 @@ static inline char *obs_context_deduplicate_name(void *phash, const char *name)
 }
 
 void obs_context_data_insert_name(struct obs_context_data *context,
-				  pthread_mutex_t *mutex, void *pfirst)
+				  os_mutex_t *mutex, void *pfirst)
 {
 	struct obs_context_data **first = pfirst;
 	char *new_name;
@@ -2753,7 +3373,7 @@ void obs_context_data_insert_name(struct obs_context_data *context,
 
 	context->mutex = mutex;
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 
 	/* Ensure name is not a duplicate. */
 	new_name = obs_context_deduplicate_name(*first, context->name);
@@ -2770,11 +3390,11 @@ void obs_context_data_insert_name(struct obs_context_data *context,
 
 	HASH_ADD_STR(*first, name, context);
 
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 }
 
 void obs_context_data_insert_uuid(struct obs_context_data *context,
-				  pthread_mutex_t *mutex, void *pfirst_uuid)
+				  os_mutex_t *mutex, void *pfirst_uuid)
 {
 	struct obs_context_data **first_uuid = pfirst_uuid;
 	struct obs_context_data *item = NULL;
@@ -2785,7 +3405,7 @@ void obs_context_data_insert_uuid(struct obs_context_data *context,
 
 	context->mutex = mutex;
 
-	pthread_mutex_lock(mutex);
+	os_mutex_lock(mutex);
 
 	/* Ensure UUID is not a duplicate.
 	 * This should only ever happen if a scene collection file has been
@@ -2803,18 +3423,18 @@ void obs_context_data_insert_uuid(struct obs_context_data *context,
 	}
 
 	HASH_ADD_UUID(*first_uuid, uuid, context);
-	pthread_mutex_unlock(mutex);
+	os_mutex_unlock(mutex);
 }
 
 void obs_context_data_remove(struct obs_context_data *context)
 {
 	if (context && context->prev_next) {
-		pthread_mutex_lock(context->mutex);
+		os_mutex_lock(context->mutex);
 		*context->prev_next = context->next;
 		if (context->next)
 			context->next->prev_next = context->prev_next;
 		context->prev_next = NULL;
-		pthread_mutex_unlock(context->mutex);
+		os_mutex_unlock(context->mutex);
 	}
 }
 
@@ -2827,9 +3447,9 @@ void obs_context_data_remove_name(struct obs_context_data *context, void *phead)
 	if (!context)
 		return;
 
-	pthread_mutex_lock(context->mutex);
+	os_mutex_lock(context->mutex);
 	HASH_DELETE(hh, *head, context);
-	pthread_mutex_unlock(context->mutex);
+	os_mutex_unlock(context->mutex);
 }
 
 void obs_context_data_remove_uuid(struct obs_context_data *context,
@@ -2842,15 +3462,15 @@ void obs_context_data_remove_uuid(struct obs_context_data *context,
 	if (!context || !context->uuid || !uuid_head)
 		return;
 
-	pthread_mutex_lock(context->mutex);
+	os_mutex_lock(context->mutex);
 	HASH_DELETE(hh_uuid, *uuid_head, context);
-	pthread_mutex_unlock(context->mutex);
+	os_mutex_unlock(context->mutex);
 }
 
 void obs_context_wait(struct obs_context_data *context)
 {
-	pthread_mutex_lock(context->mutex);
-	pthread_mutex_unlock(context->mutex);
+	os_mutex_lock(context->mutex);
+	os_mutex_unlock(context->mutex);
 }
 
 void obs_context_data_setname(struct obs_context_data *context,
@@ -2871,7 +3491,7 @@ void obs_context_data_setname_ht(struct obs_context_data *context,
 	struct obs_context_data **head = phead;
 	char *new_name;
 
-	pthread_mutex_lock(context->mutex);
+	os_mutex_lock(context->mutex);
 	pthread_mutex_lock(&context->rename_cache_mutex);
 
 	HASH_DEL(*head, context);
@@ -2893,7 +3513,7 @@ void obs_context_data_setname_ht(struct obs_context_data *context,
 	HASH_ADD_STR(*head, name, context);
 
 	pthread_mutex_unlock(&context->rename_cache_mutex);
-	pthread_mutex_unlock(context->mutex);
+	os_mutex_unlock(context->mutex);
 }
 
 profiler_name_store_t *obs_get_profiler_name_store(void)
@@ -2901,6 +3521,30 @@ profiler_name_store_t *obs_get_profiler_name_store(void)
 	return obs->name_store;
 }
 
+void obs_set_thread_scheduling(enum obs_thread_role role,
+			       enum os_thread_priority priority,
+			       uint64_t affinity)
+{
+	if (!obs || role < 0 || role >= OBS_THREAD_ROLE_COUNT)
+		return;
+
+	os_thread_scheduling_set(&obs->thread_scheduling[role], priority,
+				 affinity);
+
+	if (role == OBS_THREAD_ROLE_VIDEO_OUTPUT) {
+		pthread_mutex_lock(&obs->video.mixes_mutex);
+		for (size_t i = 0; i < obs->video.mixes.num; i++)
+			video_output_set_thread_scheduling(
+				obs->video.mixes.array[i]->video, priority,
+				affinity);
+		pthread_mutex_unlock(&obs->video.mixes_mutex);
+
+	} else if (role == OBS_THREAD_ROLE_AUDIO) {
+		audio_output_set_thread_scheduling(obs->audio.audio, priority,
+						   affinity);
+	}
+}
+
 uint64_t obs_get_video_frame_time(void)
 {
 	return obs->video.video_time;
@@ -3025,6 +3669,28 @@ void obs_get_audio_monitoring_device(const char **name, const char **id)
 		*id = obs->audio.monitoring_device_id;
 }
 
+void obs_set_audio_monitoring_buffer_ms(uint32_t buffer_ms)
+{
+	if (buffer_ms < MONITORING_BUFFER_MS_MIN)
+		buffer_ms = MONITORING_BUFFER_MS_MIN;
+	else if (buffer_ms > MONITORING_BUFFER_MS_MAX)
+		buffer_ms = MONITORING_BUFFER_MS_MAX;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+
+	if (obs->audio.monitoring_buffer_ms != buffer_ms) {
+		obs->audio.monitoring_buffer_ms = buffer_ms;
+		obs_reset_audio_monitoring();
+	}
+
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+}
+
+uint32_t obs_get_audio_monitoring_buffer_ms(void)
+{
+	return obs->audio.monitoring_buffer_ms;
+}
+
 void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 			   void *param)
 {
@@ -3210,7 +3876,7 @@ bool start_gpu_encode(obs_encoder_t *encoder)
 	bool success = true;
 
 	obs_enter_graphics();
-	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	os_mutex_lock(&video->gpu_encoder_mutex);
 
 	if (!video->gpu_encoders.num)
 		success = init_gpu_encoding(video);
@@ -3219,7 +3885,7 @@ bool start_gpu_encode(obs_encoder_t *encoder)
 	else
 		free_gpu_encoding(video);
 
-	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+	os_mutex_unlock(&video->gpu_encoder_mutex);
 	obs_leave_graphics();
 
 	if (success) {
@@ -3238,11 +3904,11 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 	os_atomic_dec_long(&video->gpu_encoder_active);
 	video_output_dec_texture_encoders(video->video);
 
-	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	os_mutex_lock(&video->gpu_encoder_mutex);
 	da_erase_item(video->gpu_encoders, &encoder);
 	if (!video->gpu_encoders.num)
 		call_free = true;
-	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+	os_mutex_unlock(&video->gpu_encoder_mutex);
 
 	os_event_wait(video->gpu_encode_inactive);
 
@@ -3250,9 +3916,9 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 		stop_gpu_encoding_thread(video);
 
 		obs_enter_graphics();
-		pthread_mutex_lock(&video->gpu_encoder_mutex);
+		os_mutex_lock(&video->gpu_encoder_mutex);
 		free_gpu_encoding(video);
-		pthread_mutex_unlock(&video->gpu_encoder_mutex);
+		os_mutex_unlock(&video->gpu_encoder_mutex);
 		obs_leave_graphics();
 	}
 }
@@ -3324,6 +3990,8 @@ bool obs_in_task_thread(enum obs_task_type type)
 		return is_ui_thread;
 	else if (type == OBS_TASK_DESTROY)
 		return os_task_queue_inside(obs->destruction_task_thread);
+	else if (type == OBS_TASK_BACKGROUND)
+		return os_task_pool_inside(obs->task_pool);
 
 	assert(false);
 	return false;
@@ -3374,6 +4042,12 @@ void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param,
 			os_task_t os_task = (os_task_t)task;
 			os_task_queue_queue_task(obs->destruction_task_thread,
 						 os_task, param);
+
+		} else if (type == OBS_TASK_BACKGROUND) {
+			os_task_t os_task = (os_task_t)task;
+			os_task_pool_queue_task(obs->task_pool,
+						OS_TASK_PRIORITY_BACKGROUND,
+						os_task, param);
 		}
 	}
 }
@@ -212,6 +212,10 @@ struct obs_audio_info2 {
 
 	uint32_t max_buffering_ms;
 	bool fixed_buffering;
+
+	/* buffering is reduced again after every source was stable for this
+	 * long, 0 to never reduce it */
+	uint32_t buffering_reduce_ms;
 };
 
 /**
@@ -280,6 +284,8 @@ struct obs_source_frame {
 	/* used internally by libobs */
 	volatile long refs;
 	bool prev_frame;
+	bool gpu; /* planes are imported, see obs_source_output_video_gpu */
+	bool external; /* planes are owned by the source, see *_nocopy */
 };
 
 struct obs_source_frame2 {
@@ -427,6 +433,65 @@ EXPORT bool obs_reset_audio2(const struct obs_audio_info2 *oai);
 /** Gets the current video settings, returns false if no video */
 EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 
+/**
+ * Enables offline rendering, where frames are rendered as fast as the active
+ * outputs take them instead of in real time.  The graphics and audio threads
+ * then run on a virtual clock that advances by one frame interval per
+ * rendered frame.  Without active outputs the clock still advances in real
+ * time.
+ *
+ *   Sources that produce frames on their own threads follow the clock with an
+ * obs_clock_hold_t, which also holds it back until they have output their
+ * frames for the next tick, so the result doesn't depend on how fast they
+ * can decode.
+ *
+ * @note Can only be changed before audio and video are initialized.
+ */
+EXPORT bool obs_set_offline_rendering(bool enable);
+EXPORT bool obs_offline_rendering_enabled(void);
+
+/** The clock libobs renders with, the system clock unless rendering offline */
+EXPORT uint64_t obs_get_clock_ns(void);
+
+typedef struct obs_clock_hold obs_clock_hold_t;
+
+/** Returns NULL unless rendering offline */
+EXPORT obs_clock_hold_t *obs_clock_hold_create(void);
+EXPORT void obs_clock_hold_destroy(obs_clock_hold_t *hold);
+
+/**
+ * Tells the graphics thread that everything before ts has been output, it
+ * waits for this before rendering a frame at or after ts.  A ts of 0 stops
+ * holding the clock, e.g. while paused.
+ */
+EXPORT void obs_clock_hold_set(obs_clock_hold_t *hold, uint64_t ts);
+
+/**
+ * Waits until the clock reaches ts.  Gives up after timeout_ms and returns
+ * false, so that callers can check for shutdown.
+ */
+EXPORT bool obs_clock_hold_wait(obs_clock_hold_t *hold, uint64_t ts,
+				uint32_t timeout_ms);
+
+enum obs_thread_role {
+	OBS_THREAD_ROLE_GRAPHICS,
+	OBS_THREAD_ROLE_VIDEO_OUTPUT,
+	OBS_THREAD_ROLE_AUDIO,
+	OBS_THREAD_ROLE_ENCODER,
+};
+
+/**
+ * Sets the OS priority and core affinity of the libobs threads of a role.
+ * Threads apply it on their next frame, including threads that are already
+ * running.  Threads keep the default OS scheduling until this is called.
+ *
+ * @param  affinity  Mask of logical cores the threads may run on, or 0 for
+ *                   all cores
+ */
+EXPORT void obs_set_thread_scheduling(enum obs_thread_role role,
+				      enum os_thread_priority priority,
+				      uint64_t affinity);
+
 /** Gets the SDR white level, returns 300.f if no video */
 EXPORT float obs_get_video_sdr_white_level(void);
 
@@ -437,9 +502,101 @@ EXPORT float obs_get_video_hdr_nominal_peak_level(void);
 EXPORT void obs_set_video_levels(float sdr_white_level,
 				 float hdr_nominal_peak_level);
 
+enum obs_tonemap_lut {
+	OBS_TONEMAP_LUT_REINHARD,
+	OBS_TONEMAP_LUT_MAXRGB,
+};
+
+#define OBS_TONEMAP_LUT_SIZE 1024
+
+/**
+ * Gets a cached 1D lookup texture of a tone mapping curve, creating it if
+ * needed.  Must be called in the graphics context, the texture is owned by
+ * libobs and is only valid for the current frame.
+ */
+EXPORT gs_texture_t *obs_get_tonemap_lut(enum obs_tonemap_lut lut,
+					 float input_maximum_nits,
+					 float output_maximum_nits);
+
+/**
+ * Enables copying the downloaded frames of multiple video mixes into their
+ * outputs on worker threads instead of serially on the graphics thread
+ */
+EXPORT void obs_set_parallel_mix_output(bool enable);
+EXPORT bool obs_parallel_mix_output_enabled(void);
+
+/**
+ * Sets how many raw video frames may be waiting to be downloaded from the
+ * GPU (2 to 8).  Takes effect for video mixes created afterwards.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+EXPORT uint32_t obs_get_video_readback_depth(void);
+
+/**
+ * Changes the output resolution of a video mix while it is running.  The
+ * change is applied by the graphics thread between frames and only the
+ * copy surfaces, conversion textures and scalers of that mix are recreated.
+ * Raw encoders keep their resolution and are fed scaled frames, raw outputs
+ * connected without a size receive the new size.  Fails with
+ * OBS_VIDEO_CURRENTLY_ACTIVE while a texture encoder uses the mix.
+ */
+EXPORT int obs_reset_video_output_size(video_t *video, uint32_t width,
+				       uint32_t height);
+
+/** Gets how many frames behind rendering the last downloaded frame was */
+EXPORT uint32_t obs_get_video_readback_latency(video_t *video);
+
+/**
+ * Sets how long (in milliseconds) the copy surfaces and conversion textures
+ * of a video mix are kept after its last raw output or GPU encoder stops.
+ * They are allocated again when the mix becomes active.
+ */
+EXPORT void obs_set_video_conversion_idle_time(uint32_t idle_ms);
+EXPORT uint32_t obs_get_video_conversion_idle_time(void);
+
+/** Gets the approximate GPU memory held by a video mix, in bytes */
+EXPORT uint64_t obs_get_video_vram_usage(video_t *video);
+
+/**
+ * Gets the estimated GPU memory of every texture, z-stencil buffer and
+ * staging surface, including ones not attributed to a source, in bytes
+ */
+EXPORT uint64_t obs_get_gpu_memory_total(void);
+
+/**
+ * Enables rendering independent audio sources on worker threads, with only
+ * the final mix of the root sources happening on the audio thread
+ */
+EXPORT void obs_set_parallel_audio_render(bool enable);
+EXPORT bool obs_parallel_audio_render_enabled(void);
+
+/**
+ * Enables calling the video_tick of sources flagged with
+ * OBS_SOURCE_PARALLEL_TICK on worker threads before a frame is rendered
+ */
+EXPORT void obs_set_parallel_source_tick(bool enable);
+EXPORT bool obs_parallel_source_tick_enabled(void);
+
+/**
+ * Enables encoding audio on worker threads instead of the audio thread.
+ * Takes effect for audio encoders started afterwards.
+ */
+EXPORT void obs_set_parallel_audio_encode(bool enable);
+EXPORT bool obs_parallel_audio_encode_enabled(void);
+
+/**
+ * Enables measuring the GPU time spent rendering each source and filter
+ * with GPU timestamp queries
+ */
+EXPORT void obs_set_gpu_source_timing(bool enable);
+EXPORT bool obs_gpu_source_timing_enabled(void);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
+/** Gets the current total audio buffering */
+EXPORT uint32_t obs_get_audio_buffering_ms(void);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -477,6 +634,13 @@ EXPORT obs_module_t *obs_get_module(const char *name);
 /** Gets library of module */
 EXPORT void *obs_get_module_lib(obs_module_t *module);
 
+/**
+ * Gets the estimated GPU memory in bytes held by all sources and filters of
+ * the types registered by a module.  NULL gets the memory of types that were
+ * registered outside of a module load, such as scenes.
+ */
+EXPORT uint64_t obs_module_get_gpu_memory(obs_module_t *module);
+
 /** Returns locale text from a specific module */
 EXPORT bool obs_module_get_locale_string(const obs_module_t *mod,
 					 const char *lookup_string,
@@ -802,6 +966,14 @@ typedef void (*obs_load_source_cb)(void *private_data, obs_source_t *source);
 EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 			     void *private_data);
 
+/**
+ * Loads sources from a data array, but defers the creation of inputs to a
+ * background thread.  Inputs that are shown or active are created first.
+ */
+EXPORT void obs_load_sources_deferred(obs_data_array_t *array,
+				      obs_load_source_cb cb,
+				      void *private_data);
+
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
@@ -840,6 +1012,11 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb,
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/** Sets how much audio is buffered ahead of the monitoring device, clamped
+ * to 10-1000 ms.  Lower values reduce latency at the risk of dropouts. */
+EXPORT void obs_set_audio_monitoring_buffer_ms(uint32_t buffer_ms);
+EXPORT uint32_t obs_get_audio_monitoring_buffer_ms(void);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 				  void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds),
@@ -896,6 +1073,7 @@ enum obs_task_type {
 	OBS_TASK_GRAPHICS,
 	OBS_TASK_AUDIO,
 	OBS_TASK_DESTROY,
+	OBS_TASK_BACKGROUND,
 };
 
 EXPORT void obs_queue_task(enum obs_task_type type, obs_task_t task,
@@ -945,7 +1123,11 @@ EXPORT void obs_view_render(obs_view_t *view);
 /** Adds a view to the main render loop, with current obs_get_video_info state */
 EXPORT video_t *obs_view_add(obs_view_t *view);
 
-/** Adds a view to the main render loop, with custom video settings */
+/**
+ * Adds a view to the main render loop, with custom video settings.  Views
+ * with a frame rate other than the main one are rendered at their own rate,
+ * a frame rate of 0 follows the main view.
+ */
 EXPORT video_t *obs_view_add2(obs_view_t *view, struct obs_video_info *ovi);
 
 /** Removes a view from the main render loop */
@@ -1006,6 +1188,30 @@ EXPORT void obs_display_remove_draw_callback(
 EXPORT void obs_display_set_enabled(obs_display_t *display, bool enable);
 EXPORT bool obs_display_enabled(obs_display_t *display);
 
+/**
+ * Tells the display whether its window can currently be seen.  Hidden
+ * displays are not rendered, independently of whether they are enabled.
+ */
+EXPORT void obs_display_set_visible(obs_display_t *display, bool visible);
+EXPORT bool obs_display_visible(obs_display_t *display);
+
+/**
+ * Only renders the display every nth output frame.  A divisor of 1 (the
+ * default) renders every frame.
+ */
+EXPORT void obs_display_set_render_divisor(obs_display_t *display,
+					   uint32_t divisor);
+EXPORT uint32_t obs_display_get_render_divisor(obs_display_t *display);
+
+/**
+ * Moves presentation of the display onto a thread of its own.  The graphics
+ * thread then only records the display into a display-owned texture, and the
+ * display's present thread copies it to the swap chain and presents it when
+ * the swap chain is ready, dropping frames rather than holding up rendering.
+ */
+EXPORT void obs_display_set_async_present(obs_display_t *display, bool async);
+EXPORT bool obs_display_async_present(obs_display_t *display);
+
 EXPORT void obs_display_set_background_color(obs_display_t *display,
 					     uint32_t color);
 
@@ -1120,6 +1326,44 @@ obs_source_get_color_space(obs_source_t *source, size_t count,
 /** Hints whether or not the source will blend texels */
 EXPORT bool obs_source_get_texcoords_centered(obs_source_t *source);
 
+/**
+ * Notifies libobs that the video of a source with the OBS_SOURCE_STATIC_VIDEO
+ * flag has changed and must be rendered again
+ */
+EXPORT void obs_source_mark_video_dirty(obs_source_t *source);
+
+/**
+ * Only renders the source every nth frame and draws the previous result in
+ * between, or sooner when the source is updated or resized.  A divisor of 1
+ * (the default) renders every frame.
+ */
+EXPORT void obs_source_set_render_divisor(obs_source_t *source,
+					  uint32_t divisor);
+EXPORT uint32_t obs_source_get_render_divisor(const obs_source_t *source);
+
+/**
+ * Gets the GPU time in nanoseconds the source took to render in the last
+ * measured frame, not counting nested sources and filters.  Returns 0 unless
+ * enabled with obs_set_gpu_source_timing.
+ */
+EXPORT uint64_t obs_source_get_gpu_render_time_ns(const obs_source_t *source);
+
+/**
+ * Gets the estimated GPU memory in bytes held by textures the source created
+ * while being created, updated, ticked or rendered, not counting nested
+ * sources and filters.
+ */
+EXPORT uint64_t obs_source_get_gpu_memory(const obs_source_t *source);
+
+/**
+ * Sets a soft GPU memory budget in bytes for the source, 0 to disable.
+ * Nothing is freed, but a warning is logged and the gpu_memory_exceeded
+ * signal is emitted each time the source goes over it.
+ */
+EXPORT void obs_source_set_gpu_memory_budget(obs_source_t *source,
+					     uint64_t bytes);
+EXPORT uint64_t obs_source_get_gpu_memory_budget(const obs_source_t *source);
+
 /**
  * If the source is a filter, returns the parent source of the filter.  Only
  * guaranteed to be valid inside of the video_render, filter_audio,
@@ -1287,6 +1531,23 @@ EXPORT void obs_source_dec_showing(obs_source_t *source);
  */
 EXPORT void obs_source_dec_active(obs_source_t *source);
 
+/**
+ * Warms up a source and its active children before they are shown, such as
+ * the scene that will be transitioned to next.  The 'activate' callbacks are
+ * called without the sources being signalled or considered active, and the
+ * graphics thread renders the source off screen until it is ready, so that
+ * media is opened, first frames are decoded and textures and effects exist.
+ *
+ * Signals 'preload_ready' once every source has video, or 'preload_timeout'
+ * if that hasn't happened within timeout_ms.  The sources stay warmed up
+ * until obs_source_release_preload is called.
+ */
+EXPORT void obs_source_preload(obs_source_t *source, uint32_t timeout_ms);
+EXPORT void obs_source_release_preload(obs_source_t *source);
+
+/** Returns true if a source and its active children can be shown at once */
+EXPORT bool obs_source_preload_ready(obs_source_t *source);
+
 /** Enumerates filters assigned to the source */
 EXPORT void obs_source_enum_filters(obs_source_t *source,
 				    obs_source_enum_proc_t callback,
@@ -1441,6 +1702,47 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  libobs uses the frame
+ * data in place until it calls release, which happens exactly once and may
+ * happen on any thread, including before this function returns.
+ */
+EXPORT void
+obs_source_output_video2_nocopy(obs_source_t *source,
+				const struct obs_source_frame2 *frame,
+				obs_source_frame_release_t release,
+				void *param);
+EXPORT void obs_source_output_video_nocopy(obs_source_t *source,
+					   const struct obs_source_frame *frame,
+					   obs_source_frame_release_t release,
+					   void *param);
+
+/**
+ * Imports the planes of a frame that lives in GPU memory as textures.  Called
+ * on the graphics thread, returns false if the frame can't be imported.  The
+ * textures are destroyed by libobs once the frame has been converted.
+ */
+typedef bool (*obs_source_frame_import_t)(
+	void *param, gs_texture_t *textures[MAX_AV_PLANES]);
+
+/**
+ * Outputs asynchronous video data that lives in GPU memory, such as hardware
+ * decoder surfaces.  The data and linesize members of the frame are ignored:
+ * libobs imports the planes with import when the frame is displayed, which
+ * avoids any round trip through system memory.  release is called exactly
+ * once, the same way as with obs_source_output_video2_nocopy.
+ *
+ * Async video filters are skipped for these frames, since they don't have
+ * any plane data in system memory.
+ */
+EXPORT void obs_source_output_video_gpu(obs_source_t *source,
+					const struct obs_source_frame *frame,
+					obs_source_frame_import_t import,
+					obs_source_frame_release_t release,
+					void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source,
@@ -1533,6 +1835,19 @@ EXPORT void obs_source_process_filter_tech_end(obs_source_t *filter,
 /** Skips the filter if the filter is invalid and cannot be rendered */
 EXPORT void obs_source_skip_video_filter(obs_source_t *filter);
 
+/**
+ * Sets how far (in nanoseconds) an audio filter delays the audio passing
+ * through it.  The delay of all enabled filters is subtracted from the
+ * timestamps of the filtered audio to keep the source in sync.
+ */
+EXPORT void obs_source_set_filter_latency(obs_source_t *filter,
+					  uint64_t latency);
+EXPORT uint64_t obs_source_get_filter_latency(const obs_source_t *filter);
+
+/** Gets the total delay added by the enabled audio filters of a source */
+EXPORT uint64_t
+obs_source_get_audio_filter_latency(const obs_source_t *source);
+
 /**
  * Adds an active child source.  Must be called by parent sources on child
  * sources when the child is added and active.  This ensures that the source is
@@ -1586,6 +1901,11 @@ EXPORT uint32_t obs_source_get_base_height(obs_source_t *source);
 
 EXPORT bool obs_source_audio_pending(const obs_source_t *source);
 EXPORT uint64_t obs_source_get_audio_timestamp(const obs_source_t *source);
+
+/** Audio buffering that was added to wait for the source, in total */
+EXPORT uint32_t obs_source_get_audio_buffering_ms(const obs_source_t *source);
+/** Variation of how far ahead of the mix the source's audio is, in ns */
+EXPORT uint64_t obs_source_get_audio_jitter(const obs_source_t *source);
 EXPORT void obs_source_get_audio_mix(const obs_source_t *source,
 				     struct obs_source_audio_mix *audio);
 
@@ -1593,12 +1913,43 @@ EXPORT void obs_source_set_async_unbuffered(obs_source_t *source,
 					    bool unbuffered);
 EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 
+enum obs_async_timing {
+	/* frames are shown at the pace of their timestamps */
+	OBS_ASYNC_TIMING_SMOOTHED,
+	/* the newest frame is always shown, same as unbuffered */
+	OBS_ASYNC_TIMING_LATEST,
+	/* frames are shown the latency target after they arrived */
+	OBS_ASYNC_TIMING_FIXED_LATENCY,
+};
+
+/** Sets how async video frames are picked for display */
+EXPORT void obs_source_set_async_timing(obs_source_t *source,
+					enum obs_async_timing timing);
+EXPORT enum obs_async_timing
+obs_source_get_async_timing(const obs_source_t *source);
+
+/** Latency of OBS_ASYNC_TIMING_FIXED_LATENCY in nanoseconds */
+EXPORT void obs_source_set_async_latency_target(obs_source_t *source,
+						uint64_t latency_ns);
+EXPORT uint64_t
+obs_source_get_async_latency_target(const obs_source_t *source);
+
+/** Maximum number of queued async video frames, 0 for the default */
+EXPORT void obs_source_set_async_max_frames(obs_source_t *source,
+					    size_t frames);
+EXPORT size_t obs_source_get_async_max_frames(const obs_source_t *source);
+
 /** Used to decouple audio from video so that audio doesn't attempt to sync up
  * with video.  I.E. Audio acts independently.  Only works when in unbuffered
  * mode. */
 EXPORT void obs_source_set_async_decoupled(obs_source_t *source, bool decouple);
 EXPORT bool obs_source_async_decoupled(const obs_source_t *source);
 
+/** Follows the frames of an async source through the pipeline, and records
+ * the latency of each stage.  Frame timestamps must be os_gettime_ns() times
+ * of capture. */
+EXPORT void obs_source_set_latency_probe(obs_source_t *source, bool probe);
+
 EXPORT void obs_source_set_audio_active(obs_source_t *source, bool show);
 EXPORT bool obs_source_audio_active(const obs_source_t *source);
 
@@ -1676,6 +2027,13 @@ EXPORT void obs_transition_enable_fixed(obs_source_t *transition, bool enable,
 					uint32_t duration_ms);
 EXPORT bool obs_transition_fixed(obs_source_t *transition);
 
+/**
+ * Keeps the outgoing source's video frozen at its first transition frame for
+ * the given time, or for the whole transition if duration_ms is 0
+ */
+EXPORT void obs_transition_freeze_outgoing(obs_source_t *transition,
+					   bool enable, uint32_t duration_ms);
+
 typedef void (*obs_transition_video_render_callback_t)(void *data,
 						       gs_texture_t *a,
 						       gs_texture_t *b, float t,
@@ -1808,6 +2166,16 @@ EXPORT void obs_scene_atomic_update(obs_scene_t *scene,
 				    obs_scene_atomic_update_func func,
 				    void *data);
 
+/**
+ * Begins a batch of changes to the items of a scene.  The scene stays locked
+ * until the matching commit, so it is not rendered with only part of the
+ * changes.  Transforms changed in between are recomputed once on commit,
+ * and instead of an item_transform signal for every item a single
+ * items_transformed signal is emitted.  Can be nested.
+ */
+EXPORT void obs_scene_begin_update(obs_scene_t *scene);
+EXPORT void obs_scene_commit_update(obs_scene_t *scene);
+
 EXPORT void obs_sceneitem_addref(obs_sceneitem_t *item);
 EXPORT void obs_sceneitem_release(obs_sceneitem_t *item);
 
@@ -1850,6 +2218,16 @@ EXPORT bool obs_sceneitem_selected(const obs_sceneitem_t *item);
 EXPORT bool obs_sceneitem_locked(const obs_sceneitem_t *item);
 EXPORT bool obs_sceneitem_set_locked(obs_sceneitem_t *item, bool lock);
 
+/**
+ * Sets the encoding priority of the area covered by the item, from -1 to 1.
+ * Encoders with scene ROI enabled raise the quality of items with positive
+ * values (e.g. a face cam or text) and lower it for items with negative
+ * values (e.g. a static background).  0, the default, leaves it unchanged.
+ */
+EXPORT void obs_sceneitem_set_roi_priority(obs_sceneitem_t *item,
+					   float priority);
+EXPORT float obs_sceneitem_get_roi_priority(const obs_sceneitem_t *item);
+
 /* Functions for getting/setting specific orientation of a scene item */
 EXPORT void obs_sceneitem_set_pos(obs_sceneitem_t *item,
 				  const struct vec2 *pos);
@@ -1896,6 +2274,12 @@ EXPORT void obs_sceneitem_get_info2(const obs_sceneitem_t *item,
 EXPORT void obs_sceneitem_set_info2(obs_sceneitem_t *item,
 				    const struct obs_transform_info *info);
 
+/** Sets the transforms of several scene items at once, the changes to each
+ * scene are applied atomically */
+EXPORT void obs_sceneitems_set_info2(obs_sceneitem_t *const *items,
+				     const struct obs_transform_info *infos,
+				     size_t count);
+
 EXPORT void obs_sceneitem_get_draw_transform(const obs_sceneitem_t *item,
 					     struct matrix4 *transform);
 EXPORT void obs_sceneitem_get_box_transform(const obs_sceneitem_t *item,
@@ -2097,6 +2481,23 @@ EXPORT uint32_t obs_output_get_active_delay(const obs_output_t *output);
 /** Forces the output to stop.  Usually only used with delay. */
 EXPORT void obs_output_force_stop(obs_output_t *output);
 
+/**
+ * Makes the output use the interleaved packets of another output instead of
+ * interleaving its encoder packets itself, so that interleaving and caption
+ * insertion only happen once for every output sharing the same encoders.
+ *
+ * Takes effect the next time the output starts.  If the leader is not active
+ * at that point or uses different encoders, the output interleaves on its own
+ * as usual.  Outputs still following the leader when it stops are stopped as
+ * well.  Set to NULL to stop following.
+ */
+EXPORT void obs_output_set_interleave_leader(obs_output_t *output,
+					     obs_output_t *leader);
+
+/** Returns a new reference to the interleave leader of the output, if any */
+EXPORT obs_output_t *
+obs_output_get_interleave_leader(const obs_output_t *output);
+
 /** Returns whether the output is active */
 EXPORT bool obs_output_active(const obs_output_t *output);
 
@@ -2338,6 +2739,15 @@ EXPORT void
 obs_output_set_video_conversion(obs_output_t *output,
 				const struct video_scale_info *conversion);
 
+/**
+ * Sets whether a raw output receives frames from its video output.  An output
+ * that gets its video some other way, e.g. by drawing the main texture itself,
+ * can disable it so that no frames are downloaded and converted for it.  Can
+ * only be changed while the output is inactive.
+ */
+EXPORT void obs_output_set_raw_video_enabled(obs_output_t *output,
+					     bool enabled);
+
 /** Optionally sets the audio conversion info.  Used only for raw output */
 EXPORT void
 obs_output_set_audio_conversion(obs_output_t *output,
@@ -2482,6 +2892,31 @@ EXPORT void obs_encoder_enum_roi(obs_encoder_t *encoder,
 				 void *param);
 /** Get ROI increment, encoders must rebuild their ROI map if it has changed */
 EXPORT uint32_t obs_encoder_get_roi_increment(const obs_encoder_t *encoder);
+/**
+ * Automatically adds regions for the items of the program scene that have an
+ * ROI priority set.  Regions added with obs_encoder_add_roi take precedence.
+ */
+EXPORT void obs_encoder_set_scene_roi(obs_encoder_t *encoder, bool enable);
+EXPORT bool obs_encoder_scene_roi_enabled(const obs_encoder_t *encoder);
+
+/**
+ * Gets a summary of the telemetry of the most recently encoded video frames.
+ * Returns false if the encoder is not a video encoder or has no frames yet.
+ */
+EXPORT bool obs_encoder_get_stats(const obs_encoder_t *encoder,
+				  struct obs_encoder_stats *stats);
+/** Enumerate the telemetry of the most recent video frames, oldest first */
+EXPORT void obs_encoder_enum_frame_stats(
+	const obs_encoder_t *encoder,
+	void (*enum_proc)(void *, const struct obs_encoder_frame_stats *),
+	void *param);
+
+/**
+ * Sets an encoder implementation to switch to if encoding fails while the
+ * encoder is active, instead of stopping its outputs.  Pass NULL to clear.
+ */
+EXPORT void obs_encoder_set_fallback(obs_encoder_t *encoder, const char *id,
+				     obs_data_t *settings);
 
 /** For video encoders, returns true if pre-encode scaling is enabled */
 EXPORT bool obs_encoder_scaling_enabled(const obs_encoder_t *encoder);
@@ -2595,6 +3030,20 @@ EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst,
 				   struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+struct obs_encoder_packet_pool_stats {
+	/** Packets allocated from the pool */
+	uint64_t allocations;
+	/** Allocations served from a cached block */
+	uint64_t reused;
+	/** Packets too large for the pool, allocated directly */
+	uint64_t oversized;
+	uint64_t cached_bytes;
+	uint64_t in_use_bytes;
+};
+
+EXPORT void obs_encoder_packet_pool_get_stats(
+	struct obs_encoder_packet_pool_stats *stats);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder,
 					 const char *reroute_id);
 
@@ -2612,6 +3061,28 @@ EXPORT bool obs_encoder_group_keyframe_aligned_encoders(
 EXPORT bool obs_encoder_group_remove_keyframe_aligned_encoder(
 	obs_encoder_t *encoder, obs_encoder_t *encoder_to_be_ungrouped);
 
+/** Describes one rung of a bitrate ladder */
+struct obs_encoder_ladder_rung {
+	const char *name;
+	uint32_t width;
+	uint32_t height;
+	/** Settings applied on top of the base encoder's settings, may be
+	 * NULL */
+	obs_data_t *settings;
+};
+
+/**
+ * Creates one video encoder per rung with the same type and video output as
+ * the base encoder, each GPU-scaled to the rung's resolution and grouped
+ * keyframe aligned with the base encoder.
+ *
+ * On success encoders[0..num_rungs-1] receive new references that must be
+ * released by the caller.  On failure nothing is created.
+ */
+EXPORT bool obs_video_encoder_create_ladder(
+	obs_encoder_t *base, const struct obs_encoder_ladder_rung *rungs,
+	size_t num_rungs, obs_encoder_t **encoders);
+
 /* ------------------------------------------------------------------------- */
 /* Stream Services */
 
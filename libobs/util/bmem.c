@@ -21,6 +21,10 @@
 #include "platform.h"
 #include "threading.h"
 
+#ifdef USE_MIMALLOC
+#include <mimalloc.h>
+#endif
+
 /*
  * NOTE: totally jacked the mem alignment trick from ffmpeg, credit to them:
  *   http://www.ffmpeg.org/
@@ -38,7 +42,9 @@
  * change, it would also ruin our memory alignment for some reallocated memory
  * on those platforms.
  */
-#if defined(_WIN32)
+#if defined(USE_MIMALLOC)
+/* mimalloc keeps per-thread free lists and has an aligned realloc */
+#elif defined(_WIN32)
 #define ALIGNED_MALLOC 1
 #else
 #define ALIGNMENT_HACK 1
@@ -46,7 +52,9 @@
 
 static void *a_malloc(size_t size)
 {
-#ifdef ALIGNED_MALLOC
+#ifdef USE_MIMALLOC
+	return mi_malloc_aligned(size, ALIGNMENT);
+#elif defined(ALIGNED_MALLOC)
 	return _aligned_malloc(size, ALIGNMENT);
 #elif ALIGNMENT_HACK
 	void *ptr = NULL;
@@ -67,7 +75,9 @@ static void *a_malloc(size_t size)
 
 static void *a_realloc(void *ptr, size_t size)
 {
-#ifdef ALIGNED_MALLOC
+#ifdef USE_MIMALLOC
+	return mi_realloc_aligned(ptr, size, ALIGNMENT);
+#elif defined(ALIGNED_MALLOC)
 	return _aligned_realloc(ptr, size, ALIGNMENT);
 #elif ALIGNMENT_HACK
 	long diff;
@@ -86,7 +96,9 @@ static void *a_realloc(void *ptr, size_t size)
 
 static void a_free(void *ptr)
 {
-#ifdef ALIGNED_MALLOC
+#ifdef USE_MIMALLOC
+	mi_free(ptr);
+#elif defined(ALIGNED_MALLOC)
 	_aligned_free(ptr);
 #elif ALIGNMENT_HACK
 	if (ptr)
@@ -96,8 +108,100 @@ static void a_free(void *ptr)
 #endif
 }
 
+#ifdef BMEM_TAGS
+/*
+ * With memory tags enabled, every allocation is prefixed by a header which
+ * records the size and the tag it was allocated under, padded to keep the
+ * returned memory aligned.
+ */
+struct bmem_header {
+	size_t size;
+	enum bmem_tag tag;
+};
+
+#define HEADER_SIZE ALIGNMENT
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define atomic_add_64(ptr, val) _InterlockedExchangeAdd64(ptr, val)
+#else
+#define atomic_add_64(ptr, val) __atomic_fetch_add(ptr, val, __ATOMIC_RELAXED)
+#endif
+
+static volatile int64_t tag_bytes[BMEM_TAG_COUNT] = {0};
+static volatile long tag_allocs[BMEM_TAG_COUNT] = {0};
+
+static inline struct bmem_header *get_header(void *ptr)
+{
+	return (struct bmem_header *)((char *)ptr - HEADER_SIZE);
+}
+
+static inline void *tag_alloc(void *mem, size_t size, enum bmem_tag tag)
+{
+	struct bmem_header *header = mem;
+	if (!mem)
+		return NULL;
+
+	header->size = size;
+	header->tag = tag;
+	atomic_add_64(&tag_bytes[tag], (int64_t)size);
+	os_atomic_inc_long(&tag_allocs[tag]);
+	return (char *)mem + HEADER_SIZE;
+}
+#endif
+
+static THREAD_LOCAL enum bmem_tag thread_tag = BMEM_TAG_NONE;
+
 static long num_allocs = 0;
 
+static void *do_malloc(size_t size)
+{
+#ifdef BMEM_TAGS
+	return tag_alloc(a_malloc(size + HEADER_SIZE), size, thread_tag);
+#else
+	return a_malloc(size);
+#endif
+}
+
+static void *do_realloc(void *ptr, size_t size)
+{
+#ifdef BMEM_TAGS
+	struct bmem_header *header;
+	enum bmem_tag tag;
+	size_t old_size;
+
+	if (!ptr)
+		return do_malloc(size);
+
+	header = get_header(ptr);
+	tag = header->tag;
+	old_size = header->size;
+
+	header = a_realloc(header, size + HEADER_SIZE);
+	if (!header)
+		return NULL;
+
+	header->size = size;
+	atomic_add_64(&tag_bytes[tag], (int64_t)size - (int64_t)old_size);
+	return (char *)header + HEADER_SIZE;
+#else
+	return a_realloc(ptr, size);
+#endif
+}
+
+static void do_free(void *ptr)
+{
+#ifdef BMEM_TAGS
+	struct bmem_header *header = get_header(ptr);
+
+	atomic_add_64(&tag_bytes[header->tag], -(int64_t)header->size);
+	os_atomic_dec_long(&tag_allocs[header->tag]);
+	a_free(header);
+#else
+	a_free(ptr);
+#endif
+}
+
 void *bmalloc(size_t size)
 {
 	if (!size) {
@@ -108,7 +212,7 @@ void *bmalloc(size_t size)
 		size = 1;
 	}
 
-	void *ptr = a_malloc(size);
+	void *ptr = do_malloc(size);
 
 	if (!ptr) {
 		os_breakpoint();
@@ -133,7 +237,7 @@ void *brealloc(void *ptr, size_t size)
 		size = 1;
 	}
 
-	ptr = a_realloc(ptr, size);
+	ptr = do_realloc(ptr, size);
 
 	if (!ptr) {
 		os_breakpoint();
@@ -148,7 +252,7 @@ void bfree(void *ptr)
 {
 	if (ptr) {
 		os_atomic_dec_long(&num_allocs);
-		a_free(ptr);
+		do_free(ptr);
 	}
 }
 
@@ -157,6 +261,62 @@ long bnum_allocs(void)
 	return num_allocs;
 }
 
+enum bmem_tag bmem_set_thread_tag(enum bmem_tag tag)
+{
+	enum bmem_tag prev = thread_tag;
+
+	if (tag >= 0 && tag < BMEM_TAG_COUNT)
+		thread_tag = tag;
+	return prev;
+}
+
+bool bmem_tags_enabled(void)
+{
+#ifdef BMEM_TAGS
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool bmem_get_tag_usage(enum bmem_tag tag, struct bmem_tag_usage *usage)
+{
+#ifdef BMEM_TAGS
+	if (tag < 0 || tag >= BMEM_TAG_COUNT || !usage)
+		return false;
+
+	usage->bytes = atomic_add_64(&tag_bytes[tag], 0);
+	usage->allocs = os_atomic_load_long(&tag_allocs[tag]);
+	return true;
+#else
+	UNUSED_PARAMETER(tag);
+	UNUSED_PARAMETER(usage);
+	return false;
+#endif
+}
+
+const char *bmem_tag_name(enum bmem_tag tag)
+{
+	switch (tag) {
+	case BMEM_TAG_NONE:
+		return "none";
+	case BMEM_TAG_GRAPHICS:
+		return "graphics";
+	case BMEM_TAG_VIDEO:
+		return "video";
+	case BMEM_TAG_AUDIO:
+		return "audio";
+	case BMEM_TAG_ENCODER:
+		return "encoder";
+	case BMEM_TAG_MODULE:
+		return "module";
+	case BMEM_TAG_COUNT:
+		break;
+	}
+
+	return "unknown";
+}
+
 int base_get_alignment(void)
 {
 	return ALIGNMENT;
@@ -43,6 +43,33 @@ EXPORT long bnum_allocs(void);
 
 EXPORT void *bmemdup(const void *ptr, size_t size);
 
+/*
+ * Allocations are attributed to the tag of the thread making them.  The
+ * usage of each tag is only tracked if libobs was built with
+ * ENABLE_MEMORY_TAGS, which adds a small header to every allocation.
+ */
+enum bmem_tag {
+	BMEM_TAG_NONE,
+	BMEM_TAG_GRAPHICS,
+	BMEM_TAG_VIDEO,
+	BMEM_TAG_AUDIO,
+	BMEM_TAG_ENCODER,
+	BMEM_TAG_MODULE,
+	BMEM_TAG_COUNT,
+};
+
+struct bmem_tag_usage {
+	int64_t bytes;
+	long allocs;
+};
+
+/* returns the previous tag of the thread, so that it can be restored */
+EXPORT enum bmem_tag bmem_set_thread_tag(enum bmem_tag tag);
+EXPORT bool bmem_tags_enabled(void);
+EXPORT bool bmem_get_tag_usage(enum bmem_tag tag,
+			       struct bmem_tag_usage *usage);
+EXPORT const char *bmem_tag_name(enum bmem_tag tag);
+
 static inline void *bzalloc(size_t size)
 {
 	void *mem = bmalloc(size);
@@ -25,6 +25,7 @@
 #include "bmem.h"
 #include "lexer.h"
 #include "dstr.h"
+#include "darray.h"
 #include "uthash.h"
 
 struct config_item {
@@ -64,8 +65,35 @@ struct config_data {
 	struct config_section *sections;
 	struct config_section *defaults;
 	pthread_mutex_t mutex;
+
+	/* held while writing the file, so writes land in snapshot order */
+	pthread_mutex_t write_mutex;
+
+	/* deferred saves, protected by the main mutex */
+	uint64_t save_first_time;
+	uint64_t save_time;
+	char *save_temp_ext;
+	char *save_backup_ext;
 };
 
+static config_t *config_alloc(void)
+{
+	struct config_data *config = bzalloc(sizeof(struct config_data));
+
+	if (pthread_mutex_init_recursive(&config->mutex) != 0) {
+		bfree(config);
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&config->write_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&config->mutex);
+		bfree(config);
+		return NULL;
+	}
+
+	return config;
+}
+
 config_t *config_create(const char *file)
 {
 	struct config_data *config;
@@ -76,12 +104,9 @@ config_t *config_create(const char *file)
 		return NULL;
 	fclose(f);
 
-	config = bzalloc(sizeof(struct config_data));
-
-	if (pthread_mutex_init_recursive(&config->mutex) != 0) {
-		bfree(config);
+	config = config_alloc();
+	if (!config)
 		return NULL;
-	}
 
 	config->file = bstrdup(file);
 	return config;
@@ -294,15 +319,10 @@ int config_open(config_t **config, const char *file,
 	if (!config)
 		return CONFIG_ERROR;
 
-	*config = bzalloc(sizeof(struct config_data));
+	*config = config_alloc();
 	if (!*config)
 		return CONFIG_ERROR;
 
-	if (pthread_mutex_init_recursive(&(*config)->mutex) != 0) {
-		bfree(*config);
-		return CONFIG_ERROR;
-	}
-
 	(*config)->file = bstrdup(file);
 
 	errorcode = config_parse_file(&(*config)->sections, file, always_open);
@@ -322,15 +342,10 @@ int config_open_string(config_t **config, const char *str)
 	if (!config)
 		return CONFIG_ERROR;
 
-	*config = bzalloc(sizeof(struct config_data));
+	*config = config_alloc();
 	if (!*config)
 		return CONFIG_ERROR;
 
-	if (pthread_mutex_init_recursive(&(*config)->mutex) != 0) {
-		bfree(*config);
-		return CONFIG_ERROR;
-	}
-
 	(*config)->file = NULL;
 
 	lexer_init(&lex);
@@ -349,39 +364,20 @@ int config_open_defaults(config_t *config, const char *file)
 	return config_parse_file(&config->defaults, file, false);
 }
 
-int config_save(config_t *config)
+static void config_serialize(config_t *config, struct dstr *str)
 {
-	FILE *f;
-	struct dstr str, tmp;
-	int ret = CONFIG_ERROR;
-
-	if (!config)
-		return CONFIG_ERROR;
-	if (!config->file)
-		return CONFIG_ERROR;
-
-	dstr_init(&str);
-	dstr_init(&tmp);
-
-	pthread_mutex_lock(&config->mutex);
-
-	f = os_fopen(config->file, "wb");
-	if (!f) {
-		pthread_mutex_unlock(&config->mutex);
-		return CONFIG_FILENOTFOUND;
-	}
-
 	struct config_section *section, *stmp;
 	struct config_item *item, *itmp;
+	struct dstr tmp = {0};
 
 	int idx = 0;
 	HASH_ITER (hh, config->sections, section, stmp) {
 		if (idx++)
-			dstr_cat(&str, "\n");
+			dstr_cat(str, "\n");
 
-		dstr_cat(&str, "[");
-		dstr_cat(&str, section->name);
-		dstr_cat(&str, "]\n");
+		dstr_cat(str, "[");
+		dstr_cat(str, section->name);
+		dstr_cat(str, "]\n");
 
 		HASH_ITER (hh, section->items, item, itmp) {
 			dstr_copy(&tmp, item->value ? item->value : "");
@@ -389,39 +385,111 @@ int config_save(config_t *config)
 			dstr_replace(&tmp, "\r", "\\r");
 			dstr_replace(&tmp, "\n", "\\n");
 
-			dstr_cat(&str, item->name);
-			dstr_cat(&str, "=");
-			dstr_cat(&str, tmp.array);
-			dstr_cat(&str, "\n");
+			dstr_cat(str, item->name);
+			dstr_cat(str, "=");
+			dstr_cat(str, tmp.array);
+			dstr_cat(str, "\n");
 		}
 	}
 
+	dstr_free(&tmp);
+}
+
+/* takes a snapshot of the current values, which supersedes any pending
+ * deferred save */
+static void config_snapshot(config_t *config, struct dstr *str)
+{
+	pthread_mutex_lock(&config->mutex);
+	config_serialize(config, str);
+	config->save_time = 0;
+	pthread_mutex_unlock(&config->mutex);
+}
+
+static int config_write(const char *file, const struct dstr *str)
+{
+	int ret = CONFIG_ERROR;
+	FILE *f;
+
+	f = os_fopen(file, "wb");
+	if (!f)
+		return CONFIG_FILENOTFOUND;
+
 #ifdef _WIN32
 	if (fwrite("\xEF\xBB\xBF", 3, 1, f) != 1)
 		goto cleanup;
 #endif
-	if (fwrite(str.array, str.len, 1, f) != 1)
+	if (str->len && fwrite(str->array, str->len, 1, f) != 1)
 		goto cleanup;
 
 	ret = CONFIG_SUCCESS;
 
 cleanup:
 	fclose(f);
+	return ret;
+}
 
-	pthread_mutex_unlock(&config->mutex);
+static inline void get_ext_path(struct dstr *path, const char *file,
+				const char *ext)
+{
+	dstr_copy(path, file);
+	if (*ext != '.')
+		dstr_cat(path, ".");
+	dstr_cat(path, ext);
+}
 
-	dstr_free(&tmp);
-	dstr_free(&str);
+static int config_write_safe(const char *file, const struct dstr *str,
+			     const char *temp_ext, const char *backup_ext)
+{
+	struct dstr temp_file = {0};
+	struct dstr backup_file = {0};
+	int ret;
+
+	get_ext_path(&temp_file, file, temp_ext);
+
+	ret = config_write(temp_file.array, str);
+	if (ret != CONFIG_SUCCESS) {
+		blog(LOG_ERROR,
+		     "config_save_safe: failed to "
+		     "write to %s",
+		     temp_file.array);
+		goto cleanup;
+	}
 
+	if (backup_ext && *backup_ext)
+		get_ext_path(&backup_file, file, backup_ext);
+
+	if (os_safe_replace(file, temp_file.array, backup_file.array) != 0)
+		ret = CONFIG_ERROR;
+
+cleanup:
+	dstr_free(&temp_file);
+	dstr_free(&backup_file);
+	return ret;
+}
+
+int config_save(config_t *config)
+{
+	struct dstr str = {0};
+	int ret;
+
+	if (!config)
+		return CONFIG_ERROR;
+	if (!config->file)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->write_mutex);
+	config_snapshot(config, &str);
+	ret = config_write(config->file, &str);
+	pthread_mutex_unlock(&config->write_mutex);
+
+	dstr_free(&str);
 	return ret;
 }
 
 int config_save_safe(config_t *config, const char *temp_ext,
 		     const char *backup_ext)
 {
-	struct dstr temp_file = {0};
-	struct dstr backup_file = {0};
-	char *file = config->file;
+	struct dstr str = {0};
 	int ret;
 
 	if (!temp_ext || !*temp_ext) {
@@ -430,40 +498,240 @@ int config_save_safe(config_t *config, const char *temp_ext,
 		return CONFIG_ERROR;
 	}
 
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+
+	/* the write lock keeps a deferred save of older values from
+	 * replacing the file after this one */
+	pthread_mutex_lock(&config->write_mutex);
+	config_snapshot(config, &str);
+	ret = config_write_safe(config->file, &str, temp_ext, backup_ext);
+	pthread_mutex_unlock(&config->write_mutex);
+
+	dstr_free(&str);
+	return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+/* deferred saves */
+
+/* how long to wait for further changes, and how long changes can be
+ * postponed at most if they keep coming in */
+#define SAVE_DELAY_NS 1000000000ULL
+#define SAVE_MAX_DELAY_NS 5000000000ULL
+
+/* one thread writes the deferred saves of every config, and exits again
+ * once nothing is pending.  the list, the event and the active flag are
+ * protected by flusher_mutex, which is never taken while holding the mutex
+ * or the write mutex of a config. */
+static pthread_mutex_t flusher_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(config_t *) flusher_configs;
+static os_event_t *flusher_event = NULL;
+static bool flusher_active = false;
+
+/* writes pending changes, write_mutex must be held */
+static int config_write_pending(config_t *config)
+{
+	struct dstr str = {0};
+	char *temp_ext = NULL;
+	char *backup_ext = NULL;
+	int ret = CONFIG_SUCCESS;
+	bool pending;
+
 	pthread_mutex_lock(&config->mutex);
+	pending = config->save_time != 0;
+	if (pending) {
+		config_serialize(config, &str);
+		temp_ext = bstrdup(config->save_temp_ext);
+		backup_ext = bstrdup(config->save_backup_ext);
+		config->save_time = 0;
+	}
+	pthread_mutex_unlock(&config->mutex);
 
-	dstr_copy(&temp_file, config->file);
-	if (*temp_ext != '.')
-		dstr_cat(&temp_file, ".");
-	dstr_cat(&temp_file, temp_ext);
+	if (pending)
+		ret = config_write_safe(config->file, &str, temp_ext,
+					backup_ext);
 
-	config->file = temp_file.array;
-	ret = config_save(config);
-	config->file = file;
+	bfree(temp_ext);
+	bfree(backup_ext);
+	dstr_free(&str);
+	return ret;
+}
 
-	if (ret != CONFIG_SUCCESS) {
-		blog(LOG_ERROR,
-		     "config_save_safe: failed to "
-		     "write to %s",
-		     temp_file.array);
-		goto cleanup;
+static int config_save_pending(config_t *config)
+{
+	int ret;
+
+	pthread_mutex_lock(&config->write_mutex);
+	ret = config_write_pending(config);
+	pthread_mutex_unlock(&config->write_mutex);
+	return ret;
+}
+
+/* removes configs that no longer have anything pending, and returns the
+ * first one that is due or the next time one will be */
+static config_t *config_flusher_next(uint64_t now, uint64_t *next_time)
+{
+	*next_time = 0;
+
+	for (size_t i = 0; i < flusher_configs.num;) {
+		config_t *config = flusher_configs.array[i];
+		uint64_t save_time;
+
+		pthread_mutex_lock(&config->mutex);
+		save_time = config->save_time;
+		pthread_mutex_unlock(&config->mutex);
+
+		if (!save_time) {
+			da_erase(flusher_configs, i);
+			continue;
+		}
+
+		if (save_time <= now) {
+			da_erase(flusher_configs, i);
+			return config;
+		}
+
+		if (!*next_time || save_time < *next_time)
+			*next_time = save_time;
+		i++;
+	}
+
+	return NULL;
+}
+
+static void *config_flusher_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	os_set_thread_name("config: deferred save");
+
+	pthread_mutex_lock(&flusher_mutex);
+
+	while (flusher_configs.num) {
+		uint64_t now = os_gettime_ns();
+		uint64_t next_time;
+		config_t *config = config_flusher_next(now, &next_time);
+
+		if (config) {
+			/* once the write mutex is taken, config_close waits
+			 * for the write before freeing the config */
+			pthread_mutex_lock(&config->write_mutex);
+			pthread_mutex_unlock(&flusher_mutex);
+
+			config_write_pending(config);
+			pthread_mutex_unlock(&config->write_mutex);
+
+			pthread_mutex_lock(&flusher_mutex);
+
+		} else if (next_time) {
+			uint64_t wait_ms = (next_time - now + 999999) / 1000000;
+
+			pthread_mutex_unlock(&flusher_mutex);
+			os_event_timedwait(flusher_event,
+					   (unsigned long)wait_ms);
+			pthread_mutex_lock(&flusher_mutex);
+		}
 	}
 
-	if (backup_ext && *backup_ext) {
-		dstr_copy(&backup_file, config->file);
-		if (*backup_ext != '.')
-			dstr_cat(&backup_file, ".");
-		dstr_cat(&backup_file, backup_ext);
+	da_free(flusher_configs);
+	os_event_destroy(flusher_event);
+	flusher_event = NULL;
+	flusher_active = false;
+
+	pthread_mutex_unlock(&flusher_mutex);
+	return NULL;
+}
+
+/* queues a config on the flusher, starting it if it isn't running */
+static bool config_flusher_add(config_t *config)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&flusher_mutex);
+
+	if (!flusher_active) {
+		pthread_t thread;
+
+		if (os_event_init(&flusher_event, OS_EVENT_TYPE_AUTO) != 0) {
+			success = false;
+			goto finish;
+		}
+
+		if (pthread_create(&thread, NULL, config_flusher_thread,
+				   NULL) != 0) {
+			os_event_destroy(flusher_event);
+			flusher_event = NULL;
+			success = false;
+			goto finish;
+		}
+
+		pthread_detach(thread);
+		flusher_active = true;
 	}
 
-	if (os_safe_replace(file, temp_file.array, backup_file.array) != 0)
-		ret = CONFIG_ERROR;
+	if (da_find(flusher_configs, &config, 0) == DARRAY_INVALID)
+		da_push_back(flusher_configs, &config);
+
+	os_event_signal(flusher_event);
+
+finish:
+	pthread_mutex_unlock(&flusher_mutex);
+	return success;
+}
+
+static void config_flusher_remove(config_t *config)
+{
+	pthread_mutex_lock(&flusher_mutex);
+	da_erase_item(flusher_configs, &config);
+	pthread_mutex_unlock(&flusher_mutex);
+}
+
+int config_save_safe_deferred(config_t *config, const char *temp_ext,
+			      const char *backup_ext)
+{
+	uint64_t now = os_gettime_ns();
+
+	if (!temp_ext || !*temp_ext) {
+		blog(LOG_ERROR, "config_save_safe_deferred: invalid "
+				"temporary extension specified");
+		return CONFIG_ERROR;
+	}
+
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->mutex);
+
+	if (!config->save_time)
+		config->save_first_time = now;
+
+	config->save_time = now + SAVE_DELAY_NS;
+	if (config->save_time > config->save_first_time + SAVE_MAX_DELAY_NS)
+		config->save_time = config->save_first_time + SAVE_MAX_DELAY_NS;
+
+	bfree(config->save_temp_ext);
+	bfree(config->save_backup_ext);
+	config->save_temp_ext = bstrdup(temp_ext);
+	config->save_backup_ext = bstrdup(backup_ext);
 
-cleanup:
 	pthread_mutex_unlock(&config->mutex);
-	dstr_free(&temp_file);
-	dstr_free(&backup_file);
-	return ret;
+
+	if (!config_flusher_add(config)) {
+		blog(LOG_WARNING, "config_save_safe_deferred: failed to start "
+				  "save thread, saving immediately");
+		return config_save_pending(config);
+	}
+
+	return CONFIG_SUCCESS;
+}
+
+int config_flush(config_t *config)
+{
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+
+	return config_save_pending(config);
 }
 
 void config_close(config_t *config)
@@ -473,6 +741,11 @@ void config_close(config_t *config)
 	if (!config)
 		return;
 
+	/* anything still pending is written before the values are gone */
+	config_flusher_remove(config);
+	if (config->file)
+		config_save_pending(config);
+
 	HASH_ITER (hh, config->sections, section, temp) {
 		HASH_DELETE(hh, config->sections, section);
 		config_section_free(section);
@@ -484,6 +757,9 @@ void config_close(config_t *config)
 	}
 
 	bfree(config->file);
+	bfree(config->save_temp_ext);
+	bfree(config->save_backup_ext);
+	pthread_mutex_destroy(&config->write_mutex);
 	pthread_mutex_destroy(&config->mutex);
 	bfree(config);
 }
@@ -50,6 +50,19 @@ EXPORT int config_save_safe(config_t *config, const char *temp_ext,
 			    const char *backup_ext);
 EXPORT void config_close(config_t *config);
 
+/*
+ * Deferred saving
+ *
+ * config_save_safe_deferred schedules a config_save_safe on a background
+ * thread, to be written once no further changes were requested for a moment.
+ * Repeated calls are coalesced into a single write.  config_flush and
+ * config_close write a pending deferred save immediately, and config_save or
+ * config_save_safe supersede it.
+ */
+EXPORT int config_save_safe_deferred(config_t *config, const char *temp_ext,
+				     const char *backup_ext);
+EXPORT int config_flush(config_t *config);
+
 EXPORT size_t config_num_sections(config_t *config);
 EXPORT const char *config_get_section(config_t *config, size_t idx);
 
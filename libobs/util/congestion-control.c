@@ -0,0 +1,289 @@
+#include "congestion-control.h"
+#include "bmem.h"
+
+#define KBPS_STEP 10
+#define MIN_DECREASE_INTERVAL_NS 500000000ULL
+#define MIN_INCREASE_INTERVAL_NS 1000000000ULL
+
+struct congestion_control {
+	const struct congestion_control_info *info;
+	void *data;
+
+	struct congestion_control_config config;
+	uint32_t kbps;
+	uint64_t last_change_ns;
+};
+
+congestion_control_t *
+congestion_control_create(const struct congestion_control_info *info,
+			  const struct congestion_control_config *config)
+{
+	struct congestion_control *cc;
+
+	if (!info || !config || !config->max_kbps)
+		return NULL;
+
+	cc = bzalloc(sizeof(*cc));
+	cc->info = info;
+	cc->config = *config;
+	if (cc->config.min_kbps > cc->config.max_kbps)
+		cc->config.min_kbps = cc->config.max_kbps;
+	cc->kbps = config->max_kbps;
+
+	cc->data = info->create(&cc->config);
+	if (!cc->data) {
+		bfree(cc);
+		return NULL;
+	}
+
+	return cc;
+}
+
+void congestion_control_destroy(congestion_control_t *cc)
+{
+	if (cc) {
+		cc->info->destroy(cc->data);
+		bfree(cc);
+	}
+}
+
+bool congestion_control_update(congestion_control_t *cc, uint64_t ts_ns,
+			       const struct congestion_sample *sample,
+			       uint32_t *new_kbps)
+{
+	uint32_t total = cc->info->update(cc->data, ts_ns, sample);
+	uint32_t kbps = total > cc->config.overhead_kbps
+				? total - cc->config.overhead_kbps
+				: 0;
+	uint64_t elapsed = ts_ns - cc->last_change_ns;
+
+	kbps = kbps / KBPS_STEP * KBPS_STEP;
+	if (kbps < cc->config.min_kbps)
+		kbps = cc->config.min_kbps;
+	if (kbps > cc->config.max_kbps)
+		kbps = cc->config.max_kbps;
+
+	if (kbps < cc->kbps) {
+		if ((uint64_t)kbps * 100 > (uint64_t)cc->kbps * 95)
+			return false;
+		if (elapsed < MIN_DECREASE_INTERVAL_NS)
+			return false;
+	} else if (kbps > cc->kbps) {
+		if ((uint64_t)kbps * 100 < (uint64_t)cc->kbps * 105 &&
+		    kbps != cc->config.max_kbps)
+			return false;
+		if (elapsed < MIN_INCREASE_INTERVAL_NS)
+			return false;
+	} else {
+		return false;
+	}
+
+	cc->kbps = kbps;
+	cc->last_change_ns = ts_ns;
+	*new_kbps = kbps;
+	return true;
+}
+
+uint32_t congestion_control_get_bitrate(const congestion_control_t *cc)
+{
+	return cc->kbps;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Model based controller
+ *
+ * The bottleneck bandwidth is the highest delivery rate seen over the last
+ * few seconds, and the minimum RTT the lowest round trip time.  Data that
+ * queues up beyond what the path holds on its own means the connection is
+ * sending faster than the bottleneck: the rate then drops below the
+ * measured delivery rate until the queue has drained, and the rate it was
+ * congested at becomes a ceiling that is only approached, not crossed.
+ * While nothing queues, the rate is probed upwards in small steps; the
+ * ceiling is forgotten after a while without congestion so that the
+ * output finds its way back up when the path recovers. */
+
+#define WINDOW_SLOTS 10
+#define SLOT_NS 1000000000ULL
+#define SAMPLE_INTERVAL_NS 200000000ULL
+
+#define LOW_QUEUE_US 50000ULL
+#define HIGH_QUEUE_US 250000ULL
+
+#define DRAIN_GAIN 0.85
+#define PROBE_GAIN 1.1
+#define PROBE_LIMIT_GAIN 1.25
+#define PROBE_INTERVAL_NS 2000000000ULL
+#define PROBE_HOLD_NS 5000000000ULL
+#define CRUISE_GAIN 0.95
+#define CEILING_HOLD_NS 30000000000ULL
+
+struct model_cc {
+	uint32_t max_kbps;
+	uint32_t target_kbps;
+
+	uint64_t last_ns;
+	uint64_t last_delivered;
+	uint64_t probe_ns;
+
+	uint32_t ceiling_kbps;
+	uint64_t ceiling_ns;
+
+	/* per second maximum delivery rate and minimum RTT */
+	uint32_t bw_slots[WINDOW_SLOTS];
+	uint32_t rtt_slots[WINDOW_SLOTS];
+	uint64_t slot_ns;
+	size_t slot;
+};
+
+static void *model_create(const struct congestion_control_config *config)
+{
+	struct model_cc *m = bzalloc(sizeof(*m));
+	m->max_kbps = config->max_kbps + config->overhead_kbps;
+	m->target_kbps = m->max_kbps;
+
+	for (size_t i = 0; i < WINDOW_SLOTS; i++)
+		m->rtt_slots[i] = UINT32_MAX;
+	return m;
+}
+
+static void model_destroy(void *data)
+{
+	bfree(data);
+}
+
+static void model_advance_slots(struct model_cc *m, uint64_t ts)
+{
+	size_t advanced = 0;
+
+	while (ts - m->slot_ns >= SLOT_NS && advanced < WINDOW_SLOTS) {
+		m->slot = (m->slot + 1) % WINDOW_SLOTS;
+		m->bw_slots[m->slot] = 0;
+		m->rtt_slots[m->slot] = UINT32_MAX;
+		m->slot_ns += SLOT_NS;
+		advanced++;
+	}
+
+	if (ts - m->slot_ns >= SLOT_NS)
+		m->slot_ns = ts;
+}
+
+static uint32_t model_bottleneck_bw(const struct model_cc *m)
+{
+	uint32_t bw = 0;
+	for (size_t i = 0; i < WINDOW_SLOTS; i++)
+		if (m->bw_slots[i] > bw)
+			bw = m->bw_slots[i];
+	return bw;
+}
+
+static uint32_t model_min_rtt(const struct model_cc *m)
+{
+	uint32_t rtt = UINT32_MAX;
+	for (size_t i = 0; i < WINDOW_SLOTS; i++)
+		if (m->rtt_slots[i] < rtt)
+			rtt = m->rtt_slots[i];
+	return rtt == UINT32_MAX ? 0 : rtt;
+}
+
+static uint32_t model_update(void *data, uint64_t ts,
+			     const struct congestion_sample *sample)
+{
+	struct model_cc *m = data;
+
+	if (!m->last_ns) {
+		m->last_ns = ts;
+		m->last_delivered = sample->bytes_delivered;
+		m->slot_ns = ts;
+		m->probe_ns = ts + PROBE_INTERVAL_NS;
+		return m->target_kbps;
+	}
+
+	uint64_t elapsed = ts - m->last_ns;
+	if (elapsed < SAMPLE_INTERVAL_NS)
+		return m->target_kbps;
+
+	uint64_t delivered = sample->bytes_delivered > m->last_delivered
+				     ? sample->bytes_delivered -
+					       m->last_delivered
+				     : 0;
+	uint32_t rate = (uint32_t)(delivered * 8000000ULL / elapsed);
+
+	m->last_ns = ts;
+	m->last_delivered = sample->bytes_delivered;
+
+	model_advance_slots(m, ts);
+
+	if (sample->rtt_us && sample->rtt_us < m->rtt_slots[m->slot])
+		m->rtt_slots[m->slot] = sample->rtt_us;
+
+	uint32_t btl_bw = model_bottleneck_bw(m);
+	uint32_t min_rtt = model_min_rtt(m);
+
+	/* queueing beyond the output's own buffer, either seen as RTT
+	 * growth or as data in flight beyond the bandwidth-delay product */
+	uint64_t path_queue_us = 0;
+	if (sample->rtt_us > min_rtt)
+		path_queue_us = sample->rtt_us - min_rtt;
+	if (btl_bw) {
+		uint64_t bdp = (uint64_t)btl_bw * min_rtt / 8000;
+		if (sample->bytes_in_flight > bdp) {
+			uint64_t excess = sample->bytes_in_flight - bdp;
+			uint64_t excess_us = excess * 8000 / btl_bw;
+			if (excess_us > path_queue_us)
+				path_queue_us = excess_us;
+		}
+	}
+
+	uint64_t queue_us = sample->queue_delay_us + path_queue_us;
+
+	/* samples taken while nothing queues only show how much was sent, so
+	 * they can raise the estimate but never lower it */
+	bool app_limited = queue_us < LOW_QUEUE_US;
+	if ((!app_limited || rate > btl_bw) && rate > m->bw_slots[m->slot])
+		m->bw_slots[m->slot] = rate;
+	btl_bw = model_bottleneck_bw(m);
+
+	if (queue_us > HIGH_QUEUE_US) {
+		/* the bandwidth window can still remember a faster path, the
+		 * current delivery rate is what the path takes right now */
+		uint32_t bw = rate && rate < btl_bw ? rate : btl_bw;
+		uint32_t drain = (uint32_t)((double)bw * DRAIN_GAIN);
+
+		if (drain && drain < m->target_kbps)
+			m->target_kbps = drain;
+		if (bw) {
+			m->ceiling_kbps = bw;
+			m->ceiling_ns = ts;
+		}
+		m->probe_ns = ts + PROBE_HOLD_NS;
+
+	} else if (queue_us < LOW_QUEUE_US && ts >= m->probe_ns) {
+		uint32_t probe =
+			(uint32_t)((double)m->target_kbps * PROBE_GAIN);
+		uint32_t limit =
+			(uint32_t)((double)btl_bw * PROBE_LIMIT_GAIN);
+
+		if (m->ceiling_kbps && ts - m->ceiling_ns >= CEILING_HOLD_NS)
+			m->ceiling_kbps = 0;
+		if (m->ceiling_kbps)
+			limit = (uint32_t)((double)m->ceiling_kbps *
+					   CRUISE_GAIN);
+
+		if ((btl_bw || m->ceiling_kbps) && probe > limit)
+			probe = limit;
+		if (probe > m->max_kbps)
+			probe = m->max_kbps;
+		if (probe > m->target_kbps)
+			m->target_kbps = probe;
+		m->probe_ns = ts + PROBE_INTERVAL_NS;
+	}
+
+	return m->target_kbps;
+}
+
+const struct congestion_control_info congestion_control_model = {
+	.id = "model",
+	.create = model_create,
+	.destroy = model_destroy,
+	.update = model_update,
+};
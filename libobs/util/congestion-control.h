@@ -0,0 +1,71 @@
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Bitrate control for network outputs.
+ *
+ * Outputs feed periodic samples of their transport state in and get back
+ * the video bitrate to use.  The controller itself is pluggable through
+ * struct congestion_control_info; the common part only smooths its
+ * decisions, so that encoders aren't reconfigured for every small change:
+ * decreases are applied right away, increases at most once a second, and
+ * either only if the bitrate changes by at least 5%.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct congestion_sample {
+	/* total bytes the network has taken so far */
+	uint64_t bytes_delivered;
+	/* bytes handed to the transport that it has not delivered yet */
+	uint64_t bytes_in_flight;
+	/* age of the oldest data in the output's own queue */
+	uint64_t queue_delay_us;
+	/* smoothed round trip time, 0 if unknown */
+	uint32_t rtt_us;
+};
+
+struct congestion_control_config {
+	/* video bitrate range, the output starts at max_kbps */
+	uint32_t max_kbps;
+	uint32_t min_kbps;
+	/* other data on the same connection, audio mostly */
+	uint32_t overhead_kbps;
+};
+
+struct congestion_control_info {
+	const char *id;
+
+	void *(*create)(const struct congestion_control_config *config);
+	void (*destroy)(void *data);
+
+	/* returns the total rate the connection should carry, in kbps */
+	uint32_t (*update)(void *data, uint64_t ts_ns,
+			   const struct congestion_sample *sample);
+};
+
+/* model based controller that tracks the bottleneck bandwidth and minimum
+ * RTT of the path, similar to BBR */
+EXPORT extern const struct congestion_control_info congestion_control_model;
+
+struct congestion_control;
+typedef struct congestion_control congestion_control_t;
+
+EXPORT congestion_control_t *
+congestion_control_create(const struct congestion_control_info *info,
+			  const struct congestion_control_config *config);
+EXPORT void congestion_control_destroy(congestion_control_t *cc);
+
+/* returns true and sets new_kbps if the video bitrate should change */
+EXPORT bool congestion_control_update(congestion_control_t *cc,
+				      uint64_t ts_ns,
+				      const struct congestion_sample *sample,
+				      uint32_t *new_kbps);
+EXPORT uint32_t congestion_control_get_bitrate(const congestion_control_t *cc);
+
+#ifdef __cplusplus
+}
+#endif
@@ -141,6 +141,30 @@ static inline void deque_place(struct deque *dq, size_t position,
 	}
 }
 
+/** Copies data out from a specific point in the buffer (relative).  */
+static inline void deque_peek_at(struct deque *dq, size_t position,
+				 void *data, size_t size)
+{
+	size_t data_end_pos;
+
+	assert(position + size <= dq->size);
+
+	position += dq->start_pos;
+	if (position >= dq->capacity)
+		position -= dq->capacity;
+
+	data_end_pos = position + size;
+	if (data_end_pos > dq->capacity) {
+		size_t back_size = data_end_pos - dq->capacity;
+		size_t loop_size = size - back_size;
+
+		memcpy(data, (uint8_t *)dq->data + position, loop_size);
+		memcpy((uint8_t *)data + loop_size, dq->data, back_size);
+	} else {
+		memcpy(data, (uint8_t *)dq->data + position, size);
+	}
+}
+
 static inline void deque_push_back(struct deque *dq, const void *data,
 				   size_t size)
 {
@@ -310,6 +334,44 @@ static inline void deque_pop_back(struct deque *dq, void *data, size_t size)
 		dq->end_pos -= size;
 }
 
+/**
+ * Gets the first size bytes in place instead of copying them out.  If they
+ * wrap around the end of the buffer, they are split over two spans, and
+ * *size2 is 0 otherwise.  The spans stay valid until the deque is modified;
+ * release the bytes with deque_pop_front(dq, NULL, size) once done.
+ */
+static inline void deque_peek_front_spans(struct deque *dq, size_t size,
+					  const void **data1, size_t *size1,
+					  const void **data2, size_t *size2)
+{
+	size_t start_size = dq->capacity - dq->start_pos;
+
+	assert(size <= dq->size);
+
+	*data1 = (uint8_t *)dq->data + dq->start_pos;
+
+	if (start_size < size) {
+		*size1 = start_size;
+		*data2 = dq->data;
+		*size2 = size - start_size;
+	} else {
+		*size1 = size;
+		*data2 = NULL;
+		*size2 = 0;
+	}
+}
+
+/** Gets the first size bytes in place if they are contiguous, else NULL */
+static inline const void *deque_peek_front_contiguous(struct deque *dq,
+						      size_t size)
+{
+	const void *data1, *data2;
+	size_t size1, size2;
+
+	deque_peek_front_spans(dq, size, &data1, &size1, &data2, &size2);
+	return size2 ? NULL : data1;
+}
+
 static inline void *deque_data(struct deque *dq, size_t idx)
 {
 	uint8_t *ptr = (uint8_t *)dq->data;
@@ -0,0 +1,420 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metrics.h"
+
+#include "base.h"
+#include "bmem.h"
+#include "darray.h"
+#include "dstr.h"
+#include "threading.h"
+
+struct metric {
+	enum metric_type type;
+	char *name;
+	char *labels;
+	char *help;
+	long refs;
+
+	/* counter/gauge value, histogram sum */
+	volatile int64_t value;
+	volatile long *buckets;
+};
+
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(metric_t *) metrics;
+
+/* ------------------------------------------------------------------------- */
+/* histogram buckets                                                         */
+
+#define SUB_BUCKET_BITS 3
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define LINEAR_BUCKETS (SUB_BUCKETS * 2)
+#define MAX_MSB 39
+
+static inline unsigned msb64(uint64_t val)
+{
+#if defined(_MSC_VER)
+	unsigned long idx;
+#if defined(_M_X64) || defined(_M_ARM64)
+	_BitScanReverse64(&idx, val);
+	return (unsigned)idx;
+#else
+	if (val >> 32) {
+		_BitScanReverse(&idx, (unsigned long)(val >> 32));
+		return (unsigned)idx + 32;
+	}
+	_BitScanReverse(&idx, (unsigned long)val);
+	return (unsigned)idx;
+#endif
+#else
+	return 63 - (unsigned)__builtin_clzll(val);
+#endif
+}
+
+/* values below 16 get a bucket each, above that every power of two is split
+ * into eight buckets, up to 2^40 ns (about 18 minutes) */
+static inline size_t bucket_index(uint64_t val)
+{
+	if (val < LINEAR_BUCKETS)
+		return (size_t)val;
+
+	unsigned msb = msb64(val);
+	if (msb > MAX_MSB)
+		return METRIC_HISTOGRAM_BUCKETS - 1;
+
+	unsigned shift = msb - SUB_BUCKET_BITS;
+	size_t sub = (size_t)(val >> shift) - SUB_BUCKETS;
+	return LINEAR_BUCKETS + (shift - 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t metric_histogram_bucket_max(size_t bucket)
+{
+	if (bucket < LINEAR_BUCKETS)
+		return bucket;
+	if (bucket >= METRIC_HISTOGRAM_BUCKETS)
+		return UINT64_MAX;
+
+	size_t idx = bucket - LINEAR_BUCKETS;
+	unsigned shift = (unsigned)(idx / SUB_BUCKETS) + 1;
+	uint64_t sub = idx % SUB_BUCKETS + SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void metric_label_cat(struct dstr *labels, const char *key, const char *value)
+{
+	if (!labels || !key)
+		return;
+
+	if (!dstr_is_empty(labels))
+		dstr_cat_ch(labels, ',');
+	dstr_catf(labels, "%s=\"", key);
+
+	for (const char *p = value ? value : ""; *p; p++) {
+		if (*p == '\\' || *p == '"') {
+			dstr_cat_ch(labels, '\\');
+			dstr_cat_ch(labels, *p);
+		} else if (*p == '\n') {
+			dstr_cat(labels, "\\n");
+		} else {
+			dstr_cat_ch(labels, *p);
+		}
+	}
+
+	dstr_cat_ch(labels, '"');
+}
+
+static void metric_free(metric_t *metric)
+{
+	bfree(metric->name);
+	bfree(metric->labels);
+	bfree(metric->help);
+	bfree((void *)metric->buckets);
+	bfree(metric);
+}
+
+metric_t *metric_get(enum metric_type type, const char *name,
+		     const char *labels, const char *help)
+{
+	metric_t *metric = NULL;
+
+	if (!name || !*name)
+		return NULL;
+	if (!labels)
+		labels = "";
+
+	pthread_mutex_lock(&metrics_mutex);
+
+	for (size_t i = 0; i < metrics.num; i++) {
+		metric_t *cur = metrics.array[i];
+
+		if (strcmp(cur->name, name) != 0 ||
+		    strcmp(cur->labels, labels) != 0)
+			continue;
+
+		if (cur->type == type) {
+			cur->refs++;
+			metric = cur;
+		} else {
+			blog(LOG_WARNING,
+			     "metric_get: '%s' already exists with a "
+			     "different type",
+			     name);
+		}
+		goto unlock;
+	}
+
+	metric = bzalloc(sizeof(*metric));
+	metric->type = type;
+	metric->name = bstrdup(name);
+	metric->labels = bstrdup(labels);
+	metric->help = bstrdup(help ? help : "");
+	metric->refs = 1;
+	if (type == METRIC_HISTOGRAM)
+		metric->buckets = bzalloc(sizeof(long) *
+					  METRIC_HISTOGRAM_BUCKETS);
+
+	da_push_back(metrics, &metric);
+
+unlock:
+	pthread_mutex_unlock(&metrics_mutex);
+	return metric;
+}
+
+void metric_release(metric_t *metric)
+{
+	if (!metric)
+		return;
+
+	pthread_mutex_lock(&metrics_mutex);
+
+	if (--metric->refs == 0) {
+		da_erase_item(metrics, &metric);
+		if (!metrics.num)
+			da_free(metrics);
+		metric_free(metric);
+	}
+
+	pthread_mutex_unlock(&metrics_mutex);
+}
+
+enum metric_type metric_get_type(const metric_t *metric)
+{
+	return metric ? metric->type : METRIC_COUNTER;
+}
+
+const char *metric_get_name(const metric_t *metric)
+{
+	return metric ? metric->name : NULL;
+}
+
+const char *metric_get_labels(const metric_t *metric)
+{
+	return metric ? metric->labels : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void metric_add(metric_t *metric, int64_t val)
+{
+	if (metric)
+		os_atomic_add_int64(&metric->value, val);
+}
+
+void metric_set(metric_t *metric, int64_t val)
+{
+	if (metric)
+		os_atomic_store_int64(&metric->value, val);
+}
+
+int64_t metric_get_value(const metric_t *metric)
+{
+	return metric ? os_atomic_load_int64(&metric->value) : 0;
+}
+
+void metric_record(metric_t *metric, uint64_t ns)
+{
+	if (!metric || !metric->buckets)
+		return;
+
+	os_atomic_inc_long(&metric->buckets[bucket_index(ns)]);
+	os_atomic_add_int64(&metric->value, (int64_t)ns);
+}
+
+void metric_histogram_get_counts(const metric_t *metric,
+				 uint64_t counts[METRIC_HISTOGRAM_BUCKETS])
+{
+	for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+		counts[i] = (metric && metric->buckets)
+				    ? (uint64_t)(unsigned long)
+					      os_atomic_load_long(
+						      &metric->buckets[i])
+				    : 0;
+}
+
+uint64_t metric_histogram_count(const metric_t *metric)
+{
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+	uint64_t total = 0;
+
+	metric_histogram_get_counts(metric, counts);
+	for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+		total += counts[i];
+	return total;
+}
+
+uint64_t metric_histogram_sum(const metric_t *metric)
+{
+	return (uint64_t)metric_get_value(metric);
+}
+
+uint64_t
+metric_histogram_percentile(const uint64_t counts[METRIC_HISTOGRAM_BUCKETS],
+			    double percentile)
+{
+	uint64_t total = 0;
+	uint64_t target;
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+		total += counts[i];
+	if (!total)
+		return 0;
+
+	if (percentile < 0.0)
+		percentile = 0.0;
+	if (percentile > 100.0)
+		percentile = 100.0;
+
+	target = (uint64_t)((double)total * percentile / 100.0 + 0.5);
+	if (!target)
+		target = 1;
+
+	for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+		sum += counts[i];
+		if (sum >= target)
+			return metric_histogram_bucket_max(i);
+	}
+
+	return metric_histogram_bucket_max(METRIC_HISTOGRAM_BUCKETS - 1);
+}
+
+void metrics_enum(metrics_enum_proc_t enum_proc, void *param)
+{
+	pthread_mutex_lock(&metrics_mutex);
+
+	for (size_t i = 0; i < metrics.num; i++) {
+		if (!enum_proc(param, metrics.array[i]))
+			break;
+	}
+
+	pthread_mutex_unlock(&metrics_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Prometheus export                                                         */
+
+/* powers of two from about 1 us to about 68 s are exported as buckets, they
+ * fall exactly on bucket boundaries */
+#define EXPORT_MIN_SHIFT 10
+#define EXPORT_MAX_SHIFT 36
+
+static int compare_metrics(const void *a, const void *b)
+{
+	const metric_t *ma = *(const metric_t *const *)a;
+	const metric_t *mb = *(const metric_t *const *)b;
+	int ret = strcmp(ma->name, mb->name);
+
+	return ret ? ret : strcmp(ma->labels, mb->labels);
+}
+
+static const char *type_name(enum metric_type type)
+{
+	switch (type) {
+	case METRIC_COUNTER:
+		return "counter";
+	case METRIC_GAUGE:
+		return "gauge";
+	case METRIC_HISTOGRAM:
+		return "histogram";
+	}
+
+	return "untyped";
+}
+
+static void write_labels(struct dstr *out, const char *labels,
+			 const char *extra)
+{
+	if (!*labels && !extra)
+		return;
+
+	dstr_cat(out, "{");
+	dstr_cat(out, labels);
+	if (extra) {
+		if (*labels)
+			dstr_cat(out, ",");
+		dstr_cat(out, extra);
+	}
+	dstr_cat(out, "}");
+}
+
+static void write_histogram(struct dstr *out, const metric_t *metric)
+{
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+	uint64_t cumulative = 0;
+	size_t bucket = 0;
+	char le[32];
+
+	metric_histogram_get_counts(metric, counts);
+
+	for (unsigned shift = EXPORT_MIN_SHIFT; shift <= EXPORT_MAX_SHIFT;
+	     shift++) {
+		uint64_t limit = 1ULL << shift;
+
+		while (bucket < METRIC_HISTOGRAM_BUCKETS &&
+		       metric_histogram_bucket_max(bucket) < limit)
+			cumulative += counts[bucket++];
+
+		snprintf(le, sizeof(le), "le=\"%g\"", (double)limit / 1e9);
+		dstr_catf(out, "%s_bucket", metric->name);
+		write_labels(out, metric->labels, le);
+		dstr_catf(out, " %" PRIu64 "\n", cumulative);
+	}
+
+	while (bucket < METRIC_HISTOGRAM_BUCKETS)
+		cumulative += counts[bucket++];
+
+	dstr_catf(out, "%s_bucket", metric->name);
+	write_labels(out, metric->labels, "le=\"+Inf\"");
+	dstr_catf(out, " %" PRIu64 "\n", cumulative);
+
+	dstr_catf(out, "%s_sum", metric->name);
+	write_labels(out, metric->labels, NULL);
+	dstr_catf(out, " %g\n", (double)metric_histogram_sum(metric) / 1e9);
+
+	dstr_catf(out, "%s_count", metric->name);
+	write_labels(out, metric->labels, NULL);
+	dstr_catf(out, " %" PRIu64 "\n", cumulative);
+}
+
+void metrics_write_prometheus(struct dstr *out)
+{
+	DARRAY(metric_t *) sorted = {0};
+	const char *last_name = NULL;
+
+	pthread_mutex_lock(&metrics_mutex);
+
+	da_copy(sorted, metrics);
+	if (sorted.num)
+		qsort(sorted.array, sorted.num, sizeof(metric_t *),
+		      compare_metrics);
+
+	for (size_t i = 0; i < sorted.num; i++) {
+		const metric_t *metric = sorted.array[i];
+
+		if (!last_name || strcmp(last_name, metric->name) != 0) {
+			if (*metric->help)
+				dstr_catf(out, "# HELP %s %s\n", metric->name,
+					  metric->help);
+			dstr_catf(out, "# TYPE %s %s\n", metric->name,
+				  type_name(metric->type));
+			last_name = metric->name;
+		}
+
+		if (metric->type == METRIC_HISTOGRAM) {
+			write_histogram(out, metric);
+		} else {
+			dstr_cat(out, metric->name);
+			write_labels(out, metric->labels, NULL);
+			dstr_catf(out, " %" PRId64 "\n",
+				  metric_get_value(metric));
+		}
+	}
+
+	pthread_mutex_unlock(&metrics_mutex);
+
+	da_free(sorted);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Process-wide metrics registry
+ *
+ *   Metrics are identified by their name and an optional set of labels in
+ * Prometheus syntax, e.g. 'output="adv_stream"'.  Getting a metric that
+ * already exists returns the existing one with another reference, so
+ * independent users of the same metric share it.  Updates are lock-free and
+ * can be made from any thread, only creating, releasing and enumerating
+ * metrics takes the registry lock.
+ *
+ *   Histograms record durations in nanoseconds in log-linear buckets with
+ * eight buckets per power of two, so any percentile is accurate to within
+ * 12.5%.
+ */
+
+struct metric;
+typedef struct metric metric_t;
+
+struct dstr;
+
+enum metric_type {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM,
+};
+
+#define METRIC_HISTOGRAM_BUCKETS 304
+
+/* appends key="value" to a label set, escaping the value */
+EXPORT void metric_label_cat(struct dstr *labels, const char *key,
+			     const char *value);
+
+EXPORT metric_t *metric_get(enum metric_type type, const char *name,
+			    const char *labels, const char *help);
+EXPORT void metric_release(metric_t *metric);
+
+EXPORT enum metric_type metric_get_type(const metric_t *metric);
+EXPORT const char *metric_get_name(const metric_t *metric);
+EXPORT const char *metric_get_labels(const metric_t *metric);
+
+/* counters only go up, gauges can be set to anything */
+EXPORT void metric_add(metric_t *metric, int64_t val);
+EXPORT void metric_set(metric_t *metric, int64_t val);
+EXPORT int64_t metric_get_value(const metric_t *metric);
+
+EXPORT void metric_record(metric_t *metric, uint64_t ns);
+EXPORT uint64_t metric_histogram_count(const metric_t *metric);
+EXPORT uint64_t metric_histogram_sum(const metric_t *metric);
+
+/* bucket counts can be subtracted from an earlier copy to get the
+ * percentiles of a time window */
+EXPORT void
+metric_histogram_get_counts(const metric_t *metric,
+			    uint64_t counts[METRIC_HISTOGRAM_BUCKETS]);
+EXPORT uint64_t
+metric_histogram_percentile(const uint64_t counts[METRIC_HISTOGRAM_BUCKETS],
+			    double percentile);
+/* highest value that ends up in the bucket */
+EXPORT uint64_t metric_histogram_bucket_max(size_t bucket);
+
+/* the metrics passed to the callback are only valid inside of it, unless
+ * the caller holds its own reference */
+typedef bool (*metrics_enum_proc_t)(void *param, metric_t *metric);
+EXPORT void metrics_enum(metrics_enum_proc_t enum_proc, void *param);
+
+/* Prometheus text exposition format, histograms in seconds */
+EXPORT void metrics_write_prometheus(struct dstr *out);
+
+#ifdef __cplusplus
+}
+#endif
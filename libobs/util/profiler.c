@@ -263,6 +263,123 @@ static DARRAY(profile_root_entry) root_entries;
 static THREAD_LOCAL profile_call *thread_context = NULL;
 static THREAD_LOCAL bool thread_enabled = true;
 
+/* ------------------------------------------------------------------------- */
+/* Trace recording */
+
+struct trace_event {
+	const char *name;
+	uint64_t start_time;
+	uint64_t end_time;
+};
+
+/* Single writer ring, written only by its owning thread.  The head counter
+ * is allowed to wrap, the capacity is a power of two so masking stays
+ * consistent across the wrap. */
+struct trace_buffer {
+	const char *thread_name;
+	unsigned long id;
+	long generation;
+	unsigned long mask;
+	volatile long head;
+	struct trace_event *events;
+};
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct trace_buffer *) trace_buffers;
+static size_t trace_capacity = 0;
+static long last_trace_generation = 0;
+static volatile long trace_generation = 0;
+
+static THREAD_LOCAL struct trace_buffer *thread_trace = NULL;
+static THREAD_LOCAL long thread_trace_generation = 0;
+static THREAD_LOCAL bool thread_tracing = false;
+
+static bool trace_thread_begin(void)
+{
+	long generation = os_atomic_load_long(&trace_generation);
+	if (!generation)
+		return false;
+	if (generation == thread_trace_generation)
+		return true;
+
+	pthread_mutex_lock(&trace_mutex);
+	generation = os_atomic_load_long(&trace_generation);
+	if (generation) {
+		struct trace_buffer *buf = bzalloc(sizeof(*buf));
+		buf->id = (unsigned long)trace_buffers.num + 1;
+		buf->generation = generation;
+		buf->mask = (unsigned long)trace_capacity - 1;
+		buf->events =
+			bzalloc(sizeof(struct trace_event) * trace_capacity);
+		da_push_back(trace_buffers, &buf);
+
+		thread_trace = buf;
+	}
+	thread_trace_generation = generation;
+	pthread_mutex_unlock(&trace_mutex);
+
+	return !!generation;
+}
+
+static inline void trace_record(const char *name, uint64_t start,
+				uint64_t end)
+{
+	struct trace_buffer *buf = thread_trace;
+	unsigned long head = (unsigned long)buf->head;
+	struct trace_event *event = &buf->events[head & buf->mask];
+
+	event->name = name;
+	event->start_time = start;
+	event->end_time = end;
+	os_atomic_store_long(&buf->head, (long)(head + 1));
+}
+
+bool profiler_trace_start(size_t events_per_thread)
+{
+	size_t capacity = 1;
+
+	if (!events_per_thread)
+		return false;
+	while (capacity < events_per_thread)
+		capacity <<= 1;
+
+	pthread_mutex_lock(&trace_mutex);
+	trace_capacity = capacity;
+	if (++last_trace_generation <= 0)
+		last_trace_generation = 1;
+	os_atomic_store_long(&trace_generation, last_trace_generation);
+	pthread_mutex_unlock(&trace_mutex);
+	return true;
+}
+
+void profiler_trace_stop(void)
+{
+	os_atomic_store_long(&trace_generation, 0);
+}
+
+bool profiler_trace_active(void)
+{
+	return os_atomic_load_long(&trace_generation) != 0;
+}
+
+void profile_trace_event(const char *name, uint64_t start, uint64_t end)
+{
+	if (trace_thread_begin())
+		trace_record(name, start, end);
+}
+
+static void free_trace_buffers(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	os_atomic_store_long(&trace_generation, 0);
+	for (size_t i = 0; i < trace_buffers.num; i++) {
+		bfree(trace_buffers.array[i]->events);
+		bfree(trace_buffers.array[i]);
+	}
+	da_free(trace_buffers);
+	pthread_mutex_unlock(&trace_mutex);
+}
+
 void profiler_start(void)
 {
 	pthread_mutex_lock(&root_mutex);
@@ -279,6 +396,9 @@ void profiler_stop(void)
 
 void profile_reenable_thread(void)
 {
+	if (!thread_context)
+		thread_tracing = trace_thread_begin();
+
 	if (thread_enabled)
 		return;
 
@@ -367,8 +487,14 @@ static void merge_context(profile_call *context)
 
 void profile_start(const char *name)
 {
-	if (!thread_enabled)
+	/* without an active call stack only a root call can tell whether
+	 * tracing may start, otherwise wait for profile_reenable_thread */
+	if (!thread_context && (thread_enabled || thread_tracing))
+		thread_tracing = trace_thread_begin();
+	if (!thread_enabled && !thread_tracing)
 		return;
+	if (thread_tracing && !thread_context && !thread_trace->thread_name)
+		thread_trace->thread_name = name;
 
 	profile_call new_call = {
 		.name = name,
@@ -395,7 +521,7 @@ void profile_start(const char *name)
 void profile_end(const char *name)
 {
 	uint64_t end = os_gettime_ns();
-	if (!thread_enabled)
+	if (!thread_enabled && !thread_tracing)
 		return;
 
 	profile_call *call = thread_context;
@@ -433,6 +559,9 @@ void profile_end(const char *name)
 	call->overhead_end = os_gettime_ns();
 #endif
 
+	if (thread_tracing)
+		trace_record(call->name, call->start_time, end);
+
 	if (call->parent)
 		return;
 
@@ -826,6 +955,8 @@ void profiler_free(void)
 
 	da_free(old_root_entries);
 
+	free_trace_buffers();
+
 	pthread_mutex_destroy(&root_mutex);
 }
 
@@ -1071,6 +1202,117 @@ bool profiler_snapshot_dump_csv_gz(const profiler_snapshot_t *snap,
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Trace export */
+
+static void dstr_cat_json_string(struct dstr *buffer, const char *str)
+{
+	dstr_cat_ch(buffer, '"');
+	for (; str && *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(buffer, '\\');
+			dstr_cat_ch(buffer, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(buffer, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(buffer, (char)ch);
+		}
+	}
+	dstr_cat_ch(buffer, '"');
+}
+
+static void dstr_cat_trace_time(struct dstr *buffer, uint64_t ns)
+{
+	dstr_catf(buffer, "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+}
+
+static void dump_trace_buffer(FILE *f, struct dstr *buffer,
+			      struct trace_buffer *buf, uint64_t min_time,
+			      bool *first)
+{
+	size_t capacity = (size_t)buf->mask + 1;
+	struct trace_event *events =
+		bmalloc(sizeof(struct trace_event) * capacity);
+	unsigned long head = (unsigned long)os_atomic_load_long(&buf->head);
+	unsigned long count = (unsigned long)capacity - 1;
+
+	memcpy(events, buf->events, sizeof(struct trace_event) * capacity);
+
+	/* anything the writer may have overwritten while copying is dropped,
+	 * including the slot it might be in the middle of writing */
+	unsigned long lost =
+		(unsigned long)os_atomic_load_long(&buf->head) - head;
+	count = lost < count ? count - lost : 0;
+
+	dstr_printf(buffer,
+		    "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+		    "\"tid\":%lu,\"args\":{\"name\":",
+		    *first ? "" : ",\n", buf->id);
+	dstr_cat_json_string(buffer, buf->thread_name);
+	dstr_cat(buffer, "}}");
+	fwrite(buffer->array, 1, buffer->len, f);
+	*first = false;
+
+	for (unsigned long i = head - count; i != head; i++) {
+		struct trace_event *event = &events[i & buf->mask];
+
+		/* slots that were never written are still zeroed */
+		if (!event->name || event->end_time < min_time)
+			continue;
+
+		dstr_copy(buffer, ",\n{\"name\":");
+		dstr_cat_json_string(buffer, event->name);
+		dstr_catf(buffer, ",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":",
+			  buf->id);
+		dstr_cat_trace_time(buffer, event->start_time);
+		dstr_cat(buffer, ",\"dur\":");
+		dstr_cat_trace_time(buffer,
+				    event->end_time - event->start_time);
+		dstr_cat_ch(buffer, '}');
+		fwrite(buffer->array, 1, buffer->len, f);
+	}
+
+	bfree(events);
+}
+
+bool profiler_trace_dump_json(const char *filename, uint64_t duration_ns)
+{
+	struct dstr buffer = {0};
+	uint64_t now = os_gettime_ns();
+	uint64_t min_time = 0;
+	bool first = true;
+
+	if (duration_ns && duration_ns < now)
+		min_time = now - duration_ns;
+
+	FILE *f = os_fopen(filename, "wb+");
+	if (!f)
+		return false;
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+
+	pthread_mutex_lock(&trace_mutex);
+	for (size_t i = 0; i < trace_buffers.num; i++) {
+		struct trace_buffer *buf = trace_buffers.array[i];
+
+		/* buffers of earlier trace sessions are kept alive for the
+		 * threads still holding them, but are not part of the dump */
+		if (buf->generation != last_trace_generation)
+			continue;
+
+		dump_trace_buffer(f, &buffer, buf, min_time, &first);
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	fputs("\n]}\n", f);
+
+	dstr_free(&buffer);
+	fclose(f);
+	return true;
+}
+
 size_t profiler_snapshot_num_roots(profiler_snapshot_t *snap)
 {
 	return snap ? snap->roots.num : 0;
@@ -33,6 +33,19 @@ EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
 EXPORT void profiler_free(void);
 
+/* ------------------------------------------------------------------------- */
+/* Trace recording */
+
+EXPORT bool profiler_trace_start(size_t events_per_thread);
+EXPORT void profiler_trace_stop(void);
+EXPORT bool profiler_trace_active(void);
+
+EXPORT void profile_trace_event(const char *name, uint64_t start,
+				uint64_t end);
+
+EXPORT bool profiler_trace_dump_json(const char *filename,
+				     uint64_t duration_ns);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler name storage */
 
@@ -1,5 +1,6 @@
 #include "task.h"
 #include "bmem.h"
+#include "platform.h"
 #include "threading.h"
 #include "deque.h"
 
@@ -163,3 +164,218 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+/* Task pool
+ *
+ * Each worker has its own queue per priority.  Tasks queued from a worker go
+ * to that worker's own queue, other tasks are spread over the workers.  A
+ * worker takes the highest priority task it can find, looking in its own
+ * queue before taking from the others, so that a worker never idles while
+ * another one has a backlog. */
+
+struct os_task_pool_worker {
+	struct os_task_pool *pool;
+	pthread_t thread;
+	bool thread_created;
+
+	pthread_mutex_t mutex;
+	struct deque tasks[OS_TASK_PRIORITY_COUNT];
+};
+
+struct os_task_pool {
+	struct os_task_pool_worker *workers;
+	size_t num_workers;
+	volatile long next_worker;
+
+	/* posted once for every queued task */
+	os_sem_t *sem;
+	volatile bool stop;
+
+	pthread_mutex_t pending_mutex;
+	long pending;
+	os_event_t *idle_event;
+};
+
+static THREAD_LOCAL struct os_task_pool_worker *current_worker = NULL;
+
+static bool take_task(struct os_task_pool_worker *worker,
+		      struct os_task_info *ti)
+{
+	struct os_task_pool *pool = worker->pool;
+	size_t idx = (size_t)(worker - pool->workers);
+
+	for (size_t prio = 0; prio < OS_TASK_PRIORITY_COUNT; prio++) {
+		for (size_t i = 0; i < pool->num_workers; i++) {
+			struct os_task_pool_worker *w =
+				&pool->workers[(idx + i) % pool->num_workers];
+			bool found = false;
+
+			pthread_mutex_lock(&w->mutex);
+			if (w->tasks[prio].size) {
+				deque_pop_front(&w->tasks[prio], ti,
+						sizeof(*ti));
+				found = true;
+			}
+			pthread_mutex_unlock(&w->mutex);
+
+			if (found)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static void *task_pool_thread(void *param)
+{
+	struct os_task_pool_worker *worker = param;
+	struct os_task_pool *pool = worker->pool;
+
+	current_worker = worker;
+	os_set_thread_name("os_task_pool worker");
+
+	while (os_sem_wait(pool->sem) == 0) {
+		struct os_task_info ti;
+
+		if (!take_task(worker, &ti)) {
+			if (os_atomic_load_bool(&pool->stop))
+				break;
+			continue;
+		}
+
+		ti.task(ti.param);
+
+		pthread_mutex_lock(&pool->pending_mutex);
+		if (--pool->pending == 0)
+			os_event_signal(pool->idle_event);
+		pthread_mutex_unlock(&pool->pending_mutex);
+	}
+
+	return NULL;
+}
+
+os_task_pool_t *os_task_pool_create(size_t threads)
+{
+	struct os_task_pool *pool = bzalloc(sizeof(*pool));
+
+	if (!threads) {
+		int cores = os_get_logical_cores();
+		threads = cores > 0 ? (size_t)cores : 1;
+	}
+
+	pthread_mutex_init_value(&pool->pending_mutex);
+	if (pthread_mutex_init(&pool->pending_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&pool->sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&pool->idle_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+	os_event_signal(pool->idle_event);
+
+	pool->workers = bzalloc(sizeof(*pool->workers) * threads);
+	for (size_t i = 0; i < threads; i++) {
+		struct os_task_pool_worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		pthread_mutex_init_value(&worker->mutex);
+		if (pthread_mutex_init(&worker->mutex, NULL) != 0)
+			goto fail;
+		pool->num_workers++;
+	}
+
+	for (size_t i = 0; i < threads; i++) {
+		struct os_task_pool_worker *worker = &pool->workers[i];
+		if (pthread_create(&worker->thread, NULL, task_pool_thread,
+				   worker) != 0)
+			goto fail;
+		worker->thread_created = true;
+	}
+
+	return pool;
+
+fail:
+	os_task_pool_destroy(pool);
+	return NULL;
+}
+
+void os_task_pool_destroy(os_task_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_task_pool_wait(pool);
+
+	os_atomic_set_bool(&pool->stop, true);
+	for (size_t i = 0; i < pool->num_workers; i++)
+		os_sem_post(pool->sem);
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct os_task_pool_worker *worker = &pool->workers[i];
+
+		if (worker->thread_created)
+			pthread_join(worker->thread, NULL);
+		for (size_t prio = 0; prio < OS_TASK_PRIORITY_COUNT; prio++)
+			deque_free(&worker->tasks[prio]);
+		pthread_mutex_destroy(&worker->mutex);
+	}
+
+	bfree(pool->workers);
+	os_event_destroy(pool->idle_event);
+	os_sem_destroy(pool->sem);
+	pthread_mutex_destroy(&pool->pending_mutex);
+	bfree(pool);
+}
+
+bool os_task_pool_queue_task(os_task_pool_t *pool,
+			     enum os_task_priority priority, os_task_t task,
+			     void *param)
+{
+	struct os_task_info ti = {
+		task,
+		param,
+	};
+	struct os_task_pool_worker *worker;
+
+	if (!pool || !task || os_atomic_load_bool(&pool->stop))
+		return false;
+	if (priority < 0 || priority >= OS_TASK_PRIORITY_COUNT)
+		priority = OS_TASK_PRIORITY_BACKGROUND;
+
+	if (current_worker && current_worker->pool == pool) {
+		worker = current_worker;
+	} else {
+		size_t idx = (size_t)os_atomic_inc_long(&pool->next_worker);
+		worker = &pool->workers[idx % pool->num_workers];
+	}
+
+	pthread_mutex_lock(&pool->pending_mutex);
+	if (pool->pending++ == 0)
+		os_event_reset(pool->idle_event);
+	pthread_mutex_unlock(&pool->pending_mutex);
+
+	pthread_mutex_lock(&worker->mutex);
+	deque_push_back(&worker->tasks[priority], &ti, sizeof(ti));
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(pool->sem);
+	return true;
+}
+
+bool os_task_pool_wait(os_task_pool_t *pool)
+{
+	if (!pool || os_task_pool_inside(pool))
+		return false;
+
+	os_event_wait(pool->idle_event);
+	return true;
+}
+
+bool os_task_pool_inside(os_task_pool_t *pool)
+{
+	return pool && current_worker && current_worker->pool == pool;
+}
+
+size_t os_task_pool_get_threads(os_task_pool_t *pool)
+{
+	return pool ? pool->num_workers : 0;
+}
@@ -18,6 +18,34 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/*
+ * Pool of worker threads shared by many users, for tasks that don't have to
+ * run in any particular order.  Higher priority tasks are always taken
+ * first.  Tasks should not block for long, since they hold up a worker that
+ * others are waiting on.
+ */
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
+enum os_task_priority {
+	OS_TASK_PRIORITY_REALTIME,
+	OS_TASK_PRIORITY_INTERACTIVE,
+	OS_TASK_PRIORITY_BACKGROUND,
+	OS_TASK_PRIORITY_COUNT,
+};
+
+/* 0 threads creates one per logical core */
+EXPORT os_task_pool_t *os_task_pool_create(size_t threads);
+/* runs all remaining tasks before returning */
+EXPORT void os_task_pool_destroy(os_task_pool_t *pool);
+EXPORT bool os_task_pool_queue_task(os_task_pool_t *pool,
+				    enum os_task_priority priority,
+				    os_task_t task, void *param);
+/* waits until no tasks are queued or running, fails inside the pool */
+EXPORT bool os_task_pool_wait(os_task_pool_t *pool);
+EXPORT bool os_task_pool_inside(os_task_pool_t *pool);
+EXPORT size_t os_task_pool_get_threads(os_task_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,30 +16,49 @@
 
 #include <ctype.h>
 
+#include "darray.h"
 #include "dstr.h"
 #include "text-lookup.h"
 #include "lexer.h"
 #include "platform.h"
-#include "uthash.h"
+#include "threading.h"
 
 /* ------------------------------------------------------------------------- */
 
-struct text_item {
-	char *lookup, *value;
-	UT_hash_handle hh;
+/*
+ *   Each file is parsed into a table of its own: every name and value is
+ * stored back to back in a single string block, and the entries that point
+ * into it are sorted by name so they can be binary searched.  That takes two
+ * allocations per file instead of three per string.
+ *
+ *   Files are only read on the first lookup, since most modules never have
+ * their strings looked up at all unless their sources are used.  Tables are
+ * never modified once built, so returned strings stay valid until the lookup
+ * is destroyed.  Files added later are searched before earlier ones.
+ */
+
+struct text_entry {
+	const char *name;
+	const char *value;
+	size_t order;
 };
 
-static inline void text_item_destroy(struct text_item *item)
-{
-	bfree(item->lookup);
-	bfree(item->value);
-	bfree(item);
-}
+struct text_offsets {
+	uint32_t name;
+	uint32_t value;
+};
 
-/* ------------------------------------------------------------------------- */
+struct text_table {
+	char *strings;
+	struct text_entry *entries;
+	size_t num;
+};
 
 struct text_lookup {
-	struct text_item *items;
+	DARRAY(struct text_table) tables;
+	DARRAY(char *) pending;
+	volatile bool loaded;
+	pthread_mutex_t mutex;
 };
 
 static void lookup_getstringtoken(struct lexer *lex, struct strref *token)
@@ -140,24 +159,87 @@ static inline bool lookup_goto_nextline(struct lexer *p)
 	return success;
 }
 
-static char *convert_string(const char *str, size_t len)
+static uint32_t add_string(struct darray *strings, const char *str,
+			   size_t len, bool unescape)
 {
-	struct dstr out;
-	out.array = bstrdup_n(str, len);
-	out.capacity = len + 1;
-	out.len = len;
+	DARRAY(char) arena;
+	uint32_t offset;
+
+	arena.da = *strings;
+	offset = (uint32_t)arena.num;
+
+	for (size_t i = 0; i < len; i++) {
+		char ch = str[i];
+
+		if (unescape && ch == '\\' && i + 1 < len) {
+			char next = str[i + 1];
+			if (next == 'n')
+				ch = '\n';
+			else if (next == 't')
+				ch = '\t';
+			else if (next == 'r')
+				ch = '\r';
+			else if (next == '"')
+				ch = '"';
+
+			if (ch != '\\')
+				i++;
+		}
+
+		da_push_back(arena, &ch);
+	}
+
+	da_push_back(arena, "");
+	*strings = arena.da;
+	return offset;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const struct text_entry *ea = a;
+	const struct text_entry *eb = b;
+	int cmp = strcmp(ea->name, eb->name);
+
+	if (cmp)
+		return cmp;
+	return ea->order < eb->order ? -1 : (ea->order > eb->order);
+}
+
+/* sorts the entries by name, and keeps only the last value of names that
+ * are defined more than once */
+static void build_table(struct text_table *table, char *strings,
+			const struct text_offsets *offsets, size_t count)
+{
+	struct text_entry *entries;
+	size_t num = 0;
+
+	entries = bmalloc(count * sizeof(struct text_entry));
+	for (size_t i = 0; i < count; i++) {
+		entries[i].name = strings + offsets[i].name;
+		entries[i].value = strings + offsets[i].value;
+		entries[i].order = i;
+	}
 
-	dstr_replace(&out, "\\n", "\n");
-	dstr_replace(&out, "\\t", "\t");
-	dstr_replace(&out, "\\r", "\r");
-	dstr_replace(&out, "\\\"", "\"");
+	qsort(entries, count, sizeof(struct text_entry), compare_entries);
 
-	return out.array;
+	for (size_t i = 0; i < count; i++) {
+		if (i + 1 < count &&
+		    strcmp(entries[i].name, entries[i + 1].name) == 0)
+			continue;
+
+		entries[num++] = entries[i];
+	}
+
+	table->strings = strings;
+	table->entries = entries;
+	table->num = num;
 }
 
-static void lookup_addfiledata(struct text_lookup *lookup,
+static void lookup_addfiledata(struct text_table *table,
 			       const char *file_data)
 {
+	DARRAY(char) strings = {0};
+	DARRAY(struct text_offsets) offsets = {0};
 	struct lexer lex;
 	struct strref name, value;
 
@@ -167,8 +249,7 @@ static void lookup_addfiledata(struct text_lookup *lookup,
 	strref_clear(&value);
 
 	while (lookup_gettoken(&lex, &name)) {
-		struct text_item *item;
-		struct text_item *old;
+		struct text_offsets *entry;
 		bool got_eq = false;
 
 		if (*name.array == '\n')
@@ -183,37 +264,101 @@ static void lookup_addfiledata(struct text_lookup *lookup,
 			goto getval;
 		}
 
-		item = bzalloc(sizeof(struct text_item));
-		item->lookup = bstrdup_n(name.array, name.len);
-		item->value = convert_string(value.array, value.len);
-
-		HASH_REPLACE_STR(lookup->items, lookup, item, old);
-
-		if (old)
-			text_item_destroy(old);
+		entry = da_push_back_new(offsets);
+		entry->name =
+			add_string(&strings.da, name.array, name.len, false);
+		entry->value =
+			add_string(&strings.da, value.array, value.len, true);
 
 		if (!lookup_goto_nextline(&lex))
 			break;
 	}
 
 	lexer_free(&lex);
+
+	build_table(table, strings.array, offsets.array, offsets.num);
+	da_free(offsets);
 }
 
-static inline bool lookup_getstring(const char *lookup_val, const char **out,
-				    struct text_lookup *lookup)
+static void load_file(struct text_lookup *lookup, const char *path)
 {
-	struct text_item *item;
+	struct text_table *table;
+	struct dstr file_str;
+	char *temp = NULL;
+	FILE *file;
 
-	if (!lookup->items)
-		return false;
+	file = os_fopen(path, "rb");
+	if (!file)
+		return;
 
-	HASH_FIND_STR(lookup->items, lookup_val, item);
+	os_fread_utf8(file, &temp);
+	dstr_init_move_array(&file_str, temp);
+	fclose(file);
 
-	if (!item)
-		return false;
+	if (!file_str.array)
+		return;
 
-	*out = item->value;
-	return true;
+	dstr_replace(&file_str, "\r", " ");
+
+	table = da_push_back_new(lookup->tables);
+	lookup_addfiledata(table, file_str.array);
+	dstr_free(&file_str);
+}
+
+static void load_pending(struct text_lookup *lookup)
+{
+	pthread_mutex_lock(&lookup->mutex);
+
+	if (!lookup->loaded) {
+		for (size_t i = 0; i < lookup->pending.num; i++) {
+			load_file(lookup, lookup->pending.array[i]);
+			bfree(lookup->pending.array[i]);
+		}
+		da_free(lookup->pending);
+		os_atomic_set_bool(&lookup->loaded, true);
+	}
+
+	pthread_mutex_unlock(&lookup->mutex);
+}
+
+static const char *table_find(const struct text_table *table,
+			      const char *name)
+{
+	size_t lo = 0;
+	size_t hi = table->num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		const struct text_entry *entry = table->entries + mid;
+		int cmp = strcmp(name, entry->name);
+
+		if (cmp == 0)
+			return entry->value;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+static inline bool lookup_getstring(const char *lookup_val, const char **out,
+				    struct text_lookup *lookup)
+{
+	if (!os_atomic_load_bool(&lookup->loaded))
+		load_pending(lookup);
+
+	for (size_t i = lookup->tables.num; i > 0; i--) {
+		const char *value =
+			table_find(lookup->tables.array + i - 1, lookup_val);
+		if (value) {
+			*out = value;
+			return true;
+		}
+	}
+
+	return false;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -222,8 +367,13 @@ lookup_t *text_lookup_create(const char *path)
 {
 	struct text_lookup *lookup = bzalloc(sizeof(struct text_lookup));
 
-	if (!text_lookup_add(lookup, path)) {
+	if (pthread_mutex_init(&lookup->mutex, NULL) != 0) {
 		bfree(lookup);
+		return NULL;
+	}
+
+	if (!text_lookup_add(lookup, path)) {
+		text_lookup_destroy(lookup);
 		lookup = NULL;
 	}
 
@@ -232,24 +382,17 @@ lookup_t *text_lookup_create(const char *path)
 
 bool text_lookup_add(lookup_t *lookup, const char *path)
 {
-	struct dstr file_str;
-	char *temp = NULL;
-	FILE *file;
+	char *item;
 
-	file = os_fopen(path, "rb");
-	if (!file)
+	if (!lookup || !path || !os_file_exists(path))
 		return false;
 
-	os_fread_utf8(file, &temp);
-	dstr_init_move_array(&file_str, temp);
-	fclose(file);
-
-	if (!file_str.array)
-		return false;
+	item = bstrdup(path);
 
-	dstr_replace(&file_str, "\r", " ");
-	lookup_addfiledata(lookup, file_str.array);
-	dstr_free(&file_str);
+	pthread_mutex_lock(&lookup->mutex);
+	da_push_back(lookup->pending, &item);
+	os_atomic_set_bool(&lookup->loaded, false);
+	pthread_mutex_unlock(&lookup->mutex);
 
 	return true;
 }
@@ -257,11 +400,16 @@ bool text_lookup_add(lookup_t *lookup, const char *path)
 void text_lookup_destroy(lookup_t *lookup)
 {
 	if (lookup) {
-		struct text_item *item, *tmp;
-		HASH_ITER (hh, lookup->items, item, tmp) {
-			HASH_DELETE(hh, lookup->items, item);
-			text_item_destroy(item);
+		for (size_t i = 0; i < lookup->tables.num; i++) {
+			bfree(lookup->tables.array[i].strings);
+			bfree(lookup->tables.array[i].entries);
 		}
+		for (size_t i = 0; i < lookup->pending.num; i++)
+			bfree(lookup->pending.array[i]);
+
+		da_free(lookup->tables);
+		da_free(lookup->pending);
+		pthread_mutex_destroy(&lookup->mutex);
 		bfree(lookup);
 	}
 }
@@ -20,8 +20,8 @@
  * Text Lookup interface
  *
  *   Used for storing and looking up localized strings.  Stores localization
- *   strings in a hashmap to efficiently look up associated strings via a
- *   unique string identifier name.
+ *   strings in sorted tables to efficiently look up associated strings via
+ *   a unique string identifier name.  Files are read on the first lookup.
  */
 
 #include "c99defs.h"
@@ -30,6 +30,13 @@
 #include <pthread_np.h>
 #endif
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "bmem.h"
 #include "threading.h"
 
@@ -255,8 +262,12 @@ int os_sem_wait(os_sem_t *sem)
 
 #endif
 
+static THREAD_LOCAL char current_thread_name[32];
+
 void os_set_thread_name(const char *name)
 {
+	strncpy(current_thread_name, name, sizeof(current_thread_name) - 1);
+
 #if defined(__APPLE__)
 	pthread_setname_np(name);
 #elif defined(__FreeBSD__)
@@ -271,3 +282,75 @@ void os_set_thread_name(const char *name)
 	}
 #endif
 }
+
+const char *os_get_thread_name(void)
+{
+	return *current_thread_name ? current_thread_name : NULL;
+}
+
+#ifdef __linux__
+static bool set_thread_nice(int nice)
+{
+	pid_t tid = (pid_t)syscall(SYS_gettid);
+	return setpriority(PRIO_PROCESS, (id_t)tid, nice) == 0;
+}
+#endif
+
+bool os_set_thread_priority(enum os_thread_priority priority)
+{
+#if defined(__APPLE__)
+	qos_class_t qos = QOS_CLASS_DEFAULT;
+
+	if (priority == OS_THREAD_PRIORITY_ABOVE_NORMAL)
+		qos = QOS_CLASS_USER_INITIATED;
+	else if (priority >= OS_THREAD_PRIORITY_HIGH)
+		qos = QOS_CLASS_USER_INTERACTIVE;
+
+	return pthread_set_qos_class_self_np(qos, 0) == 0;
+#else
+	struct sched_param param = {0};
+	int policy = SCHED_OTHER;
+
+	if (priority == OS_THREAD_PRIORITY_REALTIME) {
+		policy = SCHED_FIFO;
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+	}
+
+	if (pthread_setschedparam(pthread_self(), policy, &param) != 0)
+		return false;
+
+#ifdef __linux__
+	/* SCHED_OTHER threads can only be prioritized with their nice value */
+	if (priority == OS_THREAD_PRIORITY_ABOVE_NORMAL)
+		return set_thread_nice(-5);
+	else if (priority == OS_THREAD_PRIORITY_HIGH)
+		return set_thread_nice(-10);
+	else if (priority == OS_THREAD_PRIORITY_NORMAL)
+		return set_thread_nice(0);
+#else
+	if (priority == OS_THREAD_PRIORITY_ABOVE_NORMAL ||
+	    priority == OS_THREAD_PRIORITY_HIGH)
+		return false;
+#endif
+	return true;
+#endif
+}
+
+bool os_set_thread_affinity(uint64_t mask)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for (int i = 0; i < CPU_SETSIZE; i++) {
+		if (!mask || (i < 64 && (mask & (1ULL << i))))
+			CPU_SET(i, &set);
+	}
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	/* thread affinity is only a hint on macOS, and not exposed by
+	 * pthreads on the BSDs */
+	return !mask;
+#endif
+}
@@ -166,8 +166,12 @@ struct vs_threadname_info {
 #define THREADNAME_INFO_SIZE \
 	(sizeof(struct vs_threadname_info) / sizeof(ULONG_PTR))
 
+static THREAD_LOCAL char current_thread_name[32];
+
 void os_set_thread_name(const char *name)
 {
+	strncpy(current_thread_name, name, sizeof(current_thread_name) - 1);
+
 #ifdef __MINGW32__
 	UNUSED_PARAMETER(name);
 #else
@@ -214,3 +218,38 @@ void os_set_thread_name(const char *name)
 		FreeLibrary(hModule);
 	}
 }
+
+const char *os_get_thread_name(void)
+{
+	return *current_thread_name ? current_thread_name : NULL;
+}
+
+bool os_set_thread_priority(enum os_thread_priority priority)
+{
+	int win_priority = THREAD_PRIORITY_NORMAL;
+
+	if (priority == OS_THREAD_PRIORITY_ABOVE_NORMAL)
+		win_priority = THREAD_PRIORITY_ABOVE_NORMAL;
+	else if (priority == OS_THREAD_PRIORITY_HIGH)
+		win_priority = THREAD_PRIORITY_HIGHEST;
+	else if (priority == OS_THREAD_PRIORITY_REALTIME)
+		win_priority = THREAD_PRIORITY_TIME_CRITICAL;
+
+	return !!SetThreadPriority(GetCurrentThread(), win_priority);
+}
+
+bool os_set_thread_affinity(uint64_t mask)
+{
+	DWORD_PTR process_mask;
+	DWORD_PTR system_mask;
+
+	if (!mask) {
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask,
+					    &system_mask))
+			return false;
+	} else {
+		process_mask = (DWORD_PTR)mask;
+	}
+
+	return SetThreadAffinityMask(GetCurrentThread(), process_mask) != 0;
+}
@@ -34,6 +34,11 @@ static inline long os_atomic_dec_long(volatile long *val)
 	return _InterlockedDecrement(val);
 }
 
+static inline long os_atomic_add_long(volatile long *val, long add)
+{
+	return _InterlockedExchangeAdd(val, add) + add;
+}
+
 static inline void os_atomic_store_long(volatile long *ptr, long val)
 {
 #if defined(_M_ARM64)
@@ -144,3 +149,35 @@ static inline bool os_atomic_load_bool(const volatile bool *ptr)
 
 	return b;
 }
+
+/* 32-bit x86 has no 64-bit exchange intrinsics besides compare exchange */
+static inline int64_t os_atomic_add_int64(volatile int64_t *val, int64_t add)
+{
+#if defined(_M_IX86)
+	int64_t old_val;
+	do {
+		old_val = *val;
+	} while (_InterlockedCompareExchange64(val, old_val + add, old_val) !=
+		 old_val);
+	return old_val + add;
+#else
+	return _InterlockedExchangeAdd64(val, add) + add;
+#endif
+}
+
+static inline void os_atomic_store_int64(volatile int64_t *ptr, int64_t val)
+{
+#if defined(_M_IX86)
+	int64_t old_val;
+	do {
+		old_val = *ptr;
+	} while (_InterlockedCompareExchange64(ptr, val, old_val) != old_val);
+#else
+	_InterlockedExchange64(ptr, val);
+#endif
+}
+
+static inline int64_t os_atomic_load_int64(const volatile int64_t *ptr)
+{
+	return _InterlockedCompareExchange64((volatile int64_t *)ptr, 0, 0);
+}
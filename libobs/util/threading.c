@@ -0,0 +1,272 @@
+#include <inttypes.h>
+#include <string.h>
+#include "threading.h"
+
+#include "base.h"
+#include "bmem.h"
+#include "darray.h"
+#include "dstr.h"
+#include "metrics.h"
+#include "platform.h"
+#include "profiler.h"
+
+#define THREAD_NAME_SIZE 32
+
+/* shared by all mutexes with the same name */
+struct os_mutex_stats {
+	const char *name;
+	long refs;
+
+	metric_t *locks;
+	metric_t *wait;
+	metric_t *hold;
+
+	pthread_mutex_t max_wait_mutex;
+	volatile int64_t max_wait;
+	char max_wait_owner[THREAD_NAME_SIZE];
+};
+
+struct os_mutex_profile {
+	struct os_mutex_stats *stats;
+
+	/* only touched while holding the mutex */
+	uint64_t lock_time;
+	long depth;
+	char owner[THREAD_NAME_SIZE];
+};
+
+static volatile bool profiling_enabled = false;
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct os_mutex_stats *) all_stats;
+
+void os_mutex_profiling_set_enabled(bool enabled)
+{
+	os_atomic_store_bool(&profiling_enabled, enabled);
+}
+
+bool os_mutex_profiling_enabled(void)
+{
+	return os_atomic_load_bool(&profiling_enabled);
+}
+
+/* ------------------------------------------------------------------------- */
+/* statistics                                                                */
+
+static metric_t *get_mutex_metric(enum metric_type type, const char *name,
+				  const char *mutex_name, const char *help)
+{
+	struct dstr labels = {0};
+	metric_t *metric;
+
+	metric_label_cat(&labels, "mutex", mutex_name);
+	metric = metric_get(type, name, labels.array, help);
+	dstr_free(&labels);
+	return metric;
+}
+
+static struct os_mutex_stats *get_stats(const char *name)
+{
+	struct os_mutex_stats *stats = NULL;
+
+	pthread_mutex_lock(&stats_mutex);
+
+	for (size_t i = 0; i < all_stats.num; i++) {
+		if (strcmp(all_stats.array[i]->name, name) == 0) {
+			stats = all_stats.array[i];
+			break;
+		}
+	}
+
+	if (!stats) {
+		stats = bzalloc(sizeof(*stats));
+		stats->name = name;
+		stats->locks = get_mutex_metric(METRIC_COUNTER,
+						"obs_mutex_locks_total", name,
+						"Times the mutex was locked");
+		stats->wait = get_mutex_metric(
+			METRIC_HISTOGRAM, "obs_mutex_wait_seconds", name,
+			"Time spent waiting for the mutex while it was held");
+		stats->hold = get_mutex_metric(METRIC_HISTOGRAM,
+					       "obs_mutex_hold_seconds", name,
+					       "Time the mutex was held");
+		pthread_mutex_init(&stats->max_wait_mutex, NULL);
+		da_push_back(all_stats, &stats);
+	}
+
+	stats->refs++;
+
+	pthread_mutex_unlock(&stats_mutex);
+	return stats;
+}
+
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+static void log_stats(struct os_mutex_stats *stats)
+{
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+	uint64_t contended = metric_histogram_count(stats->wait);
+	uint64_t wait_p99;
+	uint64_t hold_p99;
+
+	if (!contended)
+		return;
+
+	metric_histogram_get_counts(stats->wait, counts);
+	wait_p99 = metric_histogram_percentile(counts, 99.0);
+	metric_histogram_get_counts(stats->hold, counts);
+	hold_p99 = metric_histogram_percentile(counts, 99.0);
+
+	blog(LOG_INFO,
+	     "mutex '%s': %" PRId64 " locks, %" PRIu64 " contended, "
+	     "wait p99 %.3f ms, longest %.3f ms (held by '%s'), "
+	     "hold p99 %.3f ms",
+	     stats->name, metric_get_value(stats->locks), contended,
+	     ns_to_ms(wait_p99), ns_to_ms((uint64_t)stats->max_wait),
+	     stats->max_wait_owner, ns_to_ms(hold_p99));
+}
+
+static void release_stats(struct os_mutex_stats *stats)
+{
+	pthread_mutex_lock(&stats_mutex);
+
+	if (--stats->refs == 0) {
+		da_erase_item(all_stats, &stats);
+		if (!all_stats.num)
+			da_free(all_stats);
+	} else {
+		stats = NULL;
+	}
+
+	pthread_mutex_unlock(&stats_mutex);
+
+	if (!stats)
+		return;
+
+	log_stats(stats);
+	metric_release(stats->locks);
+	metric_release(stats->wait);
+	metric_release(stats->hold);
+	pthread_mutex_destroy(&stats->max_wait_mutex);
+	bfree(stats);
+}
+
+static void record_wait(struct os_mutex_profile *profile, uint64_t start,
+			uint64_t end)
+{
+	struct os_mutex_stats *stats = profile->stats;
+	int64_t wait = (int64_t)(end - start);
+
+	metric_record(stats->wait, (uint64_t)wait);
+	profile_trace_event(stats->name, start, end);
+
+	/* the owner is still the thread that held the mutex while waiting */
+	if (wait <= os_atomic_load_int64(&stats->max_wait))
+		return;
+
+	pthread_mutex_lock(&stats->max_wait_mutex);
+	if (wait > stats->max_wait) {
+		os_atomic_store_int64(&stats->max_wait, wait);
+		memcpy(stats->max_wait_owner, profile->owner,
+		       sizeof(stats->max_wait_owner));
+	}
+	pthread_mutex_unlock(&stats->max_wait_mutex);
+}
+
+static void locked(struct os_mutex_profile *profile)
+{
+	const char *thread_name;
+
+	metric_add(profile->stats->locks, 1);
+
+	/* recursive locks only count as held once */
+	if (profile->depth++)
+		return;
+
+	thread_name = os_get_thread_name();
+	strncpy(profile->owner, thread_name ? thread_name : "unnamed",
+		sizeof(profile->owner) - 1);
+	profile->lock_time = os_gettime_ns();
+}
+
+/* ------------------------------------------------------------------------- */
+/* mutex                                                                     */
+
+static int mutex_init(os_mutex_t *mutex, const char *name, bool recursive)
+{
+	int ret = recursive ? pthread_mutex_init_recursive(&mutex->mutex)
+			    : pthread_mutex_init(&mutex->mutex, NULL);
+
+	mutex->profile = NULL;
+
+	if (ret == 0 && name && os_mutex_profiling_enabled()) {
+		mutex->profile = bzalloc(sizeof(struct os_mutex_profile));
+		mutex->profile->stats = get_stats(name);
+	}
+
+	return ret;
+}
+
+int os_mutex_init(os_mutex_t *mutex, const char *name)
+{
+	return mutex_init(mutex, name, false);
+}
+
+int os_mutex_init_recursive(os_mutex_t *mutex, const char *name)
+{
+	return mutex_init(mutex, name, true);
+}
+
+void os_mutex_destroy(os_mutex_t *mutex)
+{
+	if (!mutex)
+		return;
+
+	if (mutex->profile) {
+		release_stats(mutex->profile->stats);
+		bfree(mutex->profile);
+		mutex->profile = NULL;
+	}
+
+	pthread_mutex_destroy(&mutex->mutex);
+}
+
+int os_mutex_profiled_lock(os_mutex_t *mutex)
+{
+	struct os_mutex_profile *profile = mutex->profile;
+	int ret = pthread_mutex_trylock(&mutex->mutex);
+
+	if (ret == EBUSY) {
+		uint64_t start = os_gettime_ns();
+
+		ret = pthread_mutex_lock(&mutex->mutex);
+		if (ret == 0)
+			record_wait(profile, start, os_gettime_ns());
+	}
+
+	if (ret == 0)
+		locked(profile);
+	return ret;
+}
+
+int os_mutex_profiled_trylock(os_mutex_t *mutex)
+{
+	int ret = pthread_mutex_trylock(&mutex->mutex);
+	if (ret == 0)
+		locked(mutex->profile);
+	return ret;
+}
+
+int os_mutex_profiled_unlock(os_mutex_t *mutex)
+{
+	struct os_mutex_profile *profile = mutex->profile;
+
+	if (profile->depth && --profile->depth == 0)
+		metric_record(profile->stats->hold,
+			      os_gettime_ns() - profile->lock_time);
+
+	return pthread_mutex_unlock(&mutex->mutex);
+}
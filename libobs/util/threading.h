@@ -67,6 +67,72 @@ static inline int pthread_mutex_init_recursive(pthread_mutex_t *mutex)
 	return ret;
 }
 
+/*
+ * Mutex that can report where real-time threads wait
+ *
+ *   Works like a pthread mutex unless lock profiling was enabled with
+ * os_mutex_profiling_set_enabled() before the mutex got initialized.  In
+ * that case every mutex with the same name shares these metrics, labelled
+ * mutex="<name>":
+ *
+ *   obs_mutex_locks_total     times the mutex was locked
+ *   obs_mutex_wait_seconds    time spent waiting when it was already held
+ *   obs_mutex_hold_seconds    time between lock and unlock
+ *
+ *   Waits also show up in profiler traces under the name of the mutex.  Once
+ * the last mutex with a name is destroyed, a summary including the longest
+ * wait and the thread that held the mutex during it is logged.  The name has
+ * to stay valid for as long as the process runs, a string literal usually.
+ */
+
+struct os_mutex_profile;
+
+typedef struct os_mutex {
+	pthread_mutex_t mutex;
+	struct os_mutex_profile *profile;
+} os_mutex_t;
+
+EXPORT void os_mutex_profiling_set_enabled(bool enabled);
+EXPORT bool os_mutex_profiling_enabled(void);
+
+EXPORT int os_mutex_init(os_mutex_t *mutex, const char *name);
+EXPORT int os_mutex_init_recursive(os_mutex_t *mutex, const char *name);
+EXPORT void os_mutex_destroy(os_mutex_t *mutex);
+
+EXPORT int os_mutex_profiled_lock(os_mutex_t *mutex);
+EXPORT int os_mutex_profiled_trylock(os_mutex_t *mutex);
+EXPORT int os_mutex_profiled_unlock(os_mutex_t *mutex);
+
+static inline void os_mutex_init_value(os_mutex_t *mutex)
+{
+	if (!mutex)
+		return;
+
+	pthread_mutex_init_value(&mutex->mutex);
+	mutex->profile = NULL;
+}
+
+static inline int os_mutex_lock(os_mutex_t *mutex)
+{
+	if (mutex->profile)
+		return os_mutex_profiled_lock(mutex);
+	return pthread_mutex_lock(&mutex->mutex);
+}
+
+static inline int os_mutex_trylock(os_mutex_t *mutex)
+{
+	if (mutex->profile)
+		return os_mutex_profiled_trylock(mutex);
+	return pthread_mutex_trylock(&mutex->mutex);
+}
+
+static inline int os_mutex_unlock(os_mutex_t *mutex)
+{
+	if (mutex->profile)
+		return os_mutex_profiled_unlock(mutex);
+	return pthread_mutex_unlock(&mutex->mutex);
+}
+
 enum os_event_type {
 	OS_EVENT_TYPE_AUTO,
 	OS_EVENT_TYPE_MANUAL,
@@ -91,6 +157,56 @@ EXPORT int os_sem_post(os_sem_t *sem);
 EXPORT int os_sem_wait(os_sem_t *sem);
 
 EXPORT void os_set_thread_name(const char *name);
+/* name last set with os_set_thread_name() on the calling thread, or NULL */
+EXPORT const char *os_get_thread_name(void);
+
+enum os_thread_priority {
+	OS_THREAD_PRIORITY_NORMAL,
+	OS_THREAD_PRIORITY_ABOVE_NORMAL,
+	OS_THREAD_PRIORITY_HIGH,
+	OS_THREAD_PRIORITY_REALTIME,
+};
+
+/* Sets the scheduling of the calling thread.  Realtime uses SCHED_FIFO on
+ * Linux and usually needs extra privileges; returns false if the OS refused
+ * or does not support the requested priority. */
+EXPORT bool os_set_thread_priority(enum os_thread_priority priority);
+
+/* Restricts the calling thread to the logical cores set in mask, bit n
+ * being core n.  A mask of 0 allows all cores again. */
+EXPORT bool os_set_thread_affinity(uint64_t mask);
+
+/* Scheduling requested for a thread by another one.  The thread applies it
+ * itself by calling os_thread_scheduling_update() from its loop. */
+struct os_thread_scheduling {
+	enum os_thread_priority priority;
+	uint64_t affinity;
+	volatile long serial;
+};
+
+static inline void
+os_thread_scheduling_set(struct os_thread_scheduling *sched,
+			 enum os_thread_priority priority, uint64_t affinity)
+{
+	sched->priority = priority;
+	sched->affinity = affinity;
+	os_atomic_inc_long(&sched->serial);
+}
+
+/* returns false if the scheduling changed but could not be applied */
+static inline bool
+os_thread_scheduling_update(struct os_thread_scheduling *sched, long *applied)
+{
+	long serial = os_atomic_load_long(&sched->serial);
+	bool success;
+
+	if (serial == *applied)
+		return true;
+	*applied = serial;
+
+	success = os_set_thread_priority(sched->priority);
+	return os_set_thread_affinity(sched->affinity) && success;
+}
 
 #ifdef _MSC_VER
 #define THREAD_LOCAL __declspec(thread)
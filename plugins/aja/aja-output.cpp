@@ -47,24 +47,6 @@ static void free_audio_data(struct audio_data *frames)
 	memset(frames, 0, sizeof(*frames));
 }
 
-static void copy_video_data(struct video_data *src, struct video_data *dst,
-			    size_t size)
-{
-	if (src->data[0]) {
-		dst->data[0] = (uint8_t *)bmemdup(src->data[0], size);
-	}
-}
-
-static void free_video_frame(struct video_data *frame)
-{
-	if (frame->data[0]) {
-		bfree(frame->data[0]);
-		frame->data[0] = NULL;
-	}
-
-	memset(frame, 0, sizeof(*frame));
-}
-
 static void update_sdi_transport_and_sdi_transport_4k(obs_properties_t *props,
 						      NTV2DeviceID device_id,
 						      IOSelection io,
@@ -139,7 +121,9 @@ AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID,
 	  mVideoQueue{},
 	  mAudioQueue{},
 	  mOBSOutput{nullptr},
-	  mCrosspoints{}
+	  mCrosspoints{},
+	  mVideoBufferPool{},
+	  mVideoBufferSize{0}
 {
 	mVideoQueue = std::make_unique<VideoQueue>();
 	mAudioQueue = std::make_unique<AudioQueue>();
@@ -147,6 +131,7 @@ AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID,
 
 AJAOutput::~AJAOutput()
 {
+	free_video_buffers();
 	if (mVideoQueue)
 		mVideoQueue.reset();
 	if (mAudioQueue)
@@ -286,11 +271,14 @@ void AJAOutput::QueueVideoFrame(struct video_data *frame, size_t size)
 
 	if (mVideoQueue->size() > kVideoQueueMaxSize) {
 		auto &front = mVideoQueue->front();
-		free_video_frame(&front.frame);
+		release_video_frame(&front.frame);
 		mVideoQueue->pop_front();
 	}
 
-	copy_video_data(frame, &vf.frame, size);
+	if (frame->data[0]) {
+		vf.frame.data[0] = get_video_buffer(size);
+		memcpy(vf.frame.data[0], frame->data[0], size);
+	}
 
 	mVideoQueue->push_back(vf);
 	mVideoQueueFrames++;
@@ -322,9 +310,48 @@ void AJAOutput::ClearVideoQueue()
 	const std::lock_guard<std::mutex> lock(mVideoLock);
 	while (mVideoQueue->size() > 0) {
 		auto &vf = mVideoQueue->front();
-		free_video_frame(&vf.frame);
+		release_video_frame(&vf.frame);
 		mVideoQueue->pop_front();
 	}
+	free_video_buffers();
+}
+
+// lock video queue before calling
+uint8_t *AJAOutput::get_video_buffer(size_t size)
+{
+	if (size != mVideoBufferSize) {
+		free_video_buffers();
+		mVideoBufferSize = size;
+	}
+
+	if (mVideoBufferPool.empty())
+		return (uint8_t *)bmalloc(size);
+
+	uint8_t *buffer = mVideoBufferPool.back();
+	mVideoBufferPool.pop_back();
+	return buffer;
+}
+
+// lock video queue before calling
+void AJAOutput::release_video_frame(struct video_data *frame)
+{
+	if (frame->data[0]) {
+		// one more than the queue can hold, for the frame being
+		// written while the queue is full
+		if (mVideoBufferPool.size() <= kVideoQueueMaxSize + 1)
+			mVideoBufferPool.push_back(frame->data[0]);
+		else
+			bfree(frame->data[0]);
+	}
+
+	memset(frame, 0, sizeof(*frame));
+}
+
+void AJAOutput::free_video_buffers()
+{
+	for (uint8_t *buffer : mVideoBufferPool)
+		bfree(buffer);
+	mVideoBufferPool.clear();
 }
 
 void AJAOutput::ClearAudioQueue()
@@ -491,7 +518,7 @@ void AJAOutput::DMAVideoFromQueue()
 	}
 
 	if (freeFrame) {
-		free_video_frame(&vf.frame);
+		release_video_frame(&vf.frame);
 		mVideoQueue->pop_front();
 	}
 }
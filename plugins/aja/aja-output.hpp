@@ -15,6 +15,7 @@
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 struct VideoFrame {
 	struct video_data frame;
@@ -156,4 +157,13 @@ private:
 	obs_output_t *mOBSOutput;
 
 	NTV2XptConnections mCrosspoints;
+
+	// frame buffers are reused rather than allocated for every frame,
+	// guarded by mVideoLock
+	std::vector<uint8_t *> mVideoBufferPool;
+	size_t mVideoBufferSize;
+
+	uint8_t *get_video_buffer(size_t size);
+	void release_video_frame(struct video_data *frame);
+	void free_video_buffers();
 };
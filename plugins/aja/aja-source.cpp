@@ -19,31 +19,94 @@
 #define NTV2_AUDIOSIZE_MAX (401 * 1024)
 
 static constexpr int kDefaultAudioCaptureChannels = 2;
+// frames that may be waiting in libobs on top of the one being captured
+static constexpr size_t kFramePoolMaxSize = 8;
 
 static inline audio_repack_mode_t ConvertRepackFormat(speaker_layout format,
 						      bool swap = false)
 {
-	switch (format) {
-	case SPEAKERS_STEREO:
-		return repack_mode_8to2ch;
-	case SPEAKERS_2POINT1:
-		return repack_mode_8to3ch;
-	case SPEAKERS_4POINT0:
-		return repack_mode_8to4ch;
-	case SPEAKERS_4POINT1:
-		return swap ? repack_mode_8to5ch_swap : repack_mode_8to5ch;
-	case SPEAKERS_5POINT1:
-		return swap ? repack_mode_8to6ch_swap : repack_mode_8to6ch;
-	case SPEAKERS_7POINT1:
-		return swap ? repack_mode_8ch_swap : repack_mode_8ch;
-	default:
+	audio_repack_mode_t mode = repack_mode_8to2ch;
+	if (!audio_repack_get_mode(format, swap, &mode))
 		assert(false && "No repack requested");
-		return (audio_repack_mode_t)-1;
+	return mode;
+}
+
+struct AJAPooledFrame {
+	std::shared_ptr<AJAFramePool> pool;
+	NTV2_POINTER *buffer;
+};
+
+AJAFramePool::AJAFramePool(CNTV2Card *card, ULWord frameSize)
+	: mCard{card},
+	  mFrameSize{frameSize},
+	  mBuffers{},
+	  mFree{},
+	  mMutex{}
+{
+}
+
+AJAFramePool::~AJAFramePool()
+{
+	for (auto &buffer : mBuffers) {
+		if (mCard)
+			mCard->DMABufferUnlock(*buffer);
+		buffer->Deallocate();
 	}
 }
 
+// Returns nullptr if libobs still holds every frame the pool may allocate
+NTV2_POINTER *AJAFramePool::Acquire()
+{
+	const std::lock_guard<std::mutex> lock(mMutex);
+
+	if (!mFree.empty()) {
+		NTV2_POINTER *buffer = mFree.back();
+		mFree.pop_back();
+		return buffer;
+	}
+
+	if (mBuffers.size() >= kFramePoolMaxSize)
+		return nullptr;
+
+	auto buffer = std::make_unique<NTV2_POINTER>();
+	if (!buffer->Allocate(mFrameSize, true))
+		return nullptr;
+
+	// Locking the pages once spares the driver from locking them again
+	// for every transfer
+	if (mCard && !mCard->DMABufferLock(*buffer, true))
+		blog(LOG_DEBUG,
+		     "AJAFramePool::Acquire: Could not lock frame buffer for DMA");
+
+	mBuffers.push_back(std::move(buffer));
+	return mBuffers.back().get();
+}
+
+void AJAFramePool::Release(NTV2_POINTER *buffer)
+{
+	const std::lock_guard<std::mutex> lock(mMutex);
+	mFree.push_back(buffer);
+}
+
+static void ReleasePooledFrame(void *param)
+{
+	auto frame = static_cast<AJAPooledFrame *>(param);
+	frame->pool->Release(frame->buffer);
+	delete frame;
+}
+
+void AJAFramePool::Output(obs_source_t *source, struct obs_source_frame2 *frame,
+			  NTV2_POINTER *buffer)
+{
+	frame->data[0] = reinterpret_cast<uint8_t *>(buffer->GetHostPointer());
+
+	auto pooled = new AJAPooledFrame{shared_from_this(), buffer};
+	obs_source_output_video2_nocopy(source, frame, ReleasePooledFrame,
+					pooled);
+}
+
 AJASource::AJASource(obs_source_t *source)
-	: mVideoBuffer{},
+	: mFramePool{},
 	  mAudioBuffer{},
 	  mCard{nullptr},
 	  mSourceName{""},
@@ -64,9 +127,8 @@ AJASource::~AJASource()
 {
 	Deactivate();
 	mTestPattern.clear();
-	mVideoBuffer.Deallocate();
+	mFramePool.reset();
 	mAudioBuffer.Deallocate();
-	mVideoBuffer = 0;
 	mAudioBuffer = 0;
 }
 
@@ -293,6 +355,7 @@ void AJASource::CaptureThread(AJAThread *thread, void *data)
 	auto sourceProps = ajaSource->GetSourceProps();
 	ajaSource->ResetVideoBuffer(sourceProps.videoFormat,
 				    sourceProps.pixelFormat);
+	auto framePool = ajaSource->mFramePool;
 	auto inputSource = sourceProps.InitialInputSource();
 	auto channel = sourceProps.Channel();
 	auto framestore = sourceProps.Framestore();
@@ -401,14 +464,23 @@ void AJASource::CaptureThread(AJAThread *thread, void *data)
 						&audioPacket);
 		}
 
-		if (ajaSource->mVideoBuffer.GetByteCount() == 0) {
+		if (!framePool || framePool->FrameSize() == 0) {
 			blog(LOG_DEBUG,
 			     "AJASource::CaptureThread: 0 bytes in video buffer! Something went wrong!");
 			continue;
 		}
 
-		card->DMAReadFrame(currentCardFrame, ajaSource->mVideoBuffer,
-				   ajaSource->mVideoBuffer.GetByteCount());
+		// The frame is DMAed straight into a buffer that libobs
+		// uploads from, without another copy into its frame cache
+		NTV2_POINTER *videoBuffer = framePool->Acquire();
+		if (!videoBuffer) {
+			blog(LOG_DEBUG,
+			     "AJASource::CaptureThread: No free video buffer, dropping frame");
+			continue;
+		}
+
+		card->DMAReadFrame(currentCardFrame, *videoBuffer,
+				   framePool->FrameSize());
 
 		auto actualVideoFormat = videoFormat;
 		if (aja::Is3GLevelB(card, channel))
@@ -426,8 +498,6 @@ void AJASource::CaptureThread(AJAThread *thread, void *data)
 		obsFrame.width = fd.GetRasterWidth();
 		obsFrame.height = fd.GetRasterHeight();
 		obsFrame.format = obs_vid_fmt;
-		obsFrame.data[0] = reinterpret_cast<uint8_t *>(
-			(ULWord *)ajaSource->mVideoBuffer.GetHostPointer());
 		obsFrame.linesize[0] = fd.GetBytesPerRow();
 		video_colorspace colorspace = VIDEO_CS_709;
 		if (NTV2_IS_SD_VIDEO_FORMAT(actualVideoFormat))
@@ -437,7 +507,7 @@ void AJASource::CaptureThread(AJAThread *thread, void *data)
 			obsFrame.color_matrix, obsFrame.color_range_min,
 			obsFrame.color_range_max);
 
-		obs_source_output_video2(ajaSource->mSource, &obsFrame);
+		framePool->Output(ajaSource->mSource, &obsFrame, videoBuffer);
 
 		card->SetInputFrame(framestore, currentCardFrame);
 	}
@@ -642,10 +712,9 @@ void AJASource::ResetVideoBuffer(NTV2VideoFormat vf, NTV2PixelFormat pf)
 	if (vf != NTV2_FORMAT_UNKNOWN) {
 		auto videoBufferSize = GetVideoWriteSize(vf, pf);
 
-		if (mVideoBuffer)
-			mVideoBuffer.Deallocate();
-
-		mVideoBuffer.Allocate(videoBufferSize, true);
+		// Frames still held by libobs keep the previous pool alive
+		mFramePool = std::make_shared<AJAFramePool>(mCard,
+							    videoBufferSize);
 
 		blog(LOG_INFO,
 		     "AJASource::ResetVideoBuffer: Video Format: %s | Pixel Format: %s | Buffer Size: %d",
@@ -875,9 +944,8 @@ void aja_source_destroy(void *data)
 					      card);
 	}
 
-	ajaSource->mVideoBuffer.Deallocate();
+	ajaSource->mFramePool.reset();
 	ajaSource->mAudioBuffer.Deallocate();
-	ajaSource->mVideoBuffer = 0;
 	ajaSource->mAudioBuffer = 0;
 
 	auto &cardManager = aja::CardManager::Instance();
@@ -11,10 +11,35 @@
 #include <ajabase/common/types.h>
 #include <ajabase/system/thread.h>
 
+#include <memory>
 #include <mutex>
+#include <vector>
 
 class CNTV2Card;
 
+// Page-locked host buffers that the capture thread DMAs frames into, which
+// are then handed to libobs without a copy and return to the pool once libobs
+// releases them. The pool only goes away after its last frame is released.
+class AJAFramePool : public std::enable_shared_from_this<AJAFramePool> {
+public:
+	AJAFramePool(CNTV2Card *card, ULWord frameSize);
+	~AJAFramePool();
+
+	NTV2_POINTER *Acquire();
+	void Release(NTV2_POINTER *buffer);
+	void Output(obs_source_t *source, struct obs_source_frame2 *frame,
+		    NTV2_POINTER *buffer);
+
+	ULWord FrameSize() const { return mFrameSize; }
+
+private:
+	CNTV2Card *mCard;
+	ULWord mFrameSize;
+	std::vector<std::unique_ptr<NTV2_POINTER>> mBuffers;
+	std::vector<NTV2_POINTER *> mFree;
+	std::mutex mMutex;
+};
+
 class AJASource {
 public:
 	explicit AJASource(obs_source_t *source);
@@ -62,7 +87,7 @@ public:
 
 	void ResetAudioBuffer(size_t size);
 
-	NTV2_POINTER mVideoBuffer;
+	std::shared_ptr<AJAFramePool> mFramePool;
 	NTV2_POINTER mAudioBuffer;
 
 private:
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "audio-repack.h"
+#include <media-io/audio-repack.h>
 
 class AudioRepacker {
 	struct audio_repack arepack;
@@ -1,14 +1,15 @@
 #pragma once
 
-#include "audio-repack.h"
+#include <media-io/audio-repack.h>
 
 class AudioRepacker {
 	struct audio_repack arepack;
 
 public:
-	inline AudioRepacker(audio_repack_mode_t repack_mode)
+	inline AudioRepacker(audio_repack_mode_t repack_mode,
+			     int bits_per_sample = 16)
 	{
-		audio_repack_init(&arepack, repack_mode, 16);
+		audio_repack_init(&arepack, repack_mode, bits_per_sample);
 	}
 	inline ~AudioRepacker() { audio_repack_free(&arepack); }
 
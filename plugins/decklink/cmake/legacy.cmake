@@ -21,8 +21,6 @@ target_sources(
   decklink
   PRIVATE OBSVideoFrame.cpp
           OBSVideoFrame.h
-          audio-repack.c
-          audio-repack.h
           audio-repack.hpp
           const.h
           decklink-device.cpp
@@ -92,26 +92,6 @@ static inline int ConvertChannelFormat(speaker_layout format)
 	}
 }
 
-static inline audio_repack_mode_t ConvertRepackFormat(speaker_layout format,
-						      bool swap)
-{
-	switch (format) {
-	case SPEAKERS_2POINT1:
-		return repack_mode_8to3ch;
-	case SPEAKERS_4POINT0:
-		return repack_mode_8to4ch;
-	case SPEAKERS_4POINT1:
-		return swap ? repack_mode_8to5ch_swap : repack_mode_8to5ch;
-	case SPEAKERS_5POINT1:
-		return swap ? repack_mode_8to6ch_swap : repack_mode_8to6ch;
-	case SPEAKERS_7POINT1:
-		return swap ? repack_mode_8ch_swap : repack_mode_8ch;
-	default:
-		assert(false && "No repack requested");
-		return (audio_repack_mode_t)-1;
-	}
-}
-
 DeckLinkDeviceInstance::DeckLinkDeviceInstance(DecklinkBase *decklink_,
 					       DeckLinkDevice *device_)
 	: currentFrame(),
@@ -524,16 +504,14 @@ bool DeckLinkDeviceInstance::StartCapture(DeckLinkDeviceMode *mode_,
 			LOG(LOG_WARNING,
 			    "Failed to enable audio input; continuing...");
 
-		if (channelFormat != SPEAKERS_UNKNOWN &&
-		    channelFormat != SPEAKERS_MONO &&
+		audio_repack_mode_t repack_mode;
+
+		if (channelFormat != SPEAKERS_MONO &&
 		    channelFormat != SPEAKERS_STEREO &&
 		    (channelFormat != SPEAKERS_7POINT1 || swap) &&
-		    maxdevicechannel >= 8) {
-
-			const audio_repack_mode_t repack_mode =
-				ConvertRepackFormat(channelFormat, swap);
+		    maxdevicechannel >= 8 &&
+		    audio_repack_get_mode(channelFormat, swap, &repack_mode))
 			audioRepacker = new AudioRepacker(repack_mode);
-		}
 	}
 
 	if (input->SetCallback(this) != S_OK) {
@@ -617,14 +595,10 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 
 	frameQueueDecklinkToObs.reset();
 	frameQueueObsToDecklink.reset();
+	outputFrames.clear();
+	latestFrame = nullptr;
 
 	const int rowSize = decklinkOutput->GetWidth() * 4;
-	const int frameSize = rowSize * decklinkOutput->GetHeight();
-	for (std::vector<uint8_t> &blob : frameBlobs) {
-		blob.assign(frameSize, 0);
-		frameQueueDecklinkToObs.push(blob.data());
-	}
-	activeBlob = nullptr;
 
 	struct obs_video_info ovi;
 	const enum video_colorspace colorspace =
@@ -639,7 +613,13 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 						: bmdFormat8BitBGRA;
 	const int64_t minimumPrerollFrames =
 		std::max(device->GetMinimumPrerollFrames(), INT64_C(3));
-	for (int64_t i = 0; i < minimumPrerollFrames; ++i) {
+
+	/* OBS writes straight into frames allocated by the device: the
+	 * preroll frames are always in flight, and the extra ones cycle
+	 * between being filled by OBS and being scheduled */
+	const int64_t totalFrames =
+		minimumPrerollFrames + (int64_t)FrameQueueFrameCount;
+	for (int64_t i = 0; i < totalFrames; ++i) {
 		ComPtr<IDeckLinkMutableVideoFrame> decklinkOutputFrame;
 		HRESULT result = output_->CreateVideoFrame(
 			decklinkOutput->GetWidth(), decklinkOutput->GetHeight(),
@@ -659,6 +639,17 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 			theFrame = decklinkOutputHDRFrame.Get();
 		}
 
+		void *bytes;
+		if (SUCCEEDED(theFrame->GetBytes(&bytes)))
+			memset(bytes, 0,
+			       (size_t)rowSize * decklinkOutput->GetHeight());
+
+		outputFrames.emplace_back(theFrame);
+		if (i >= minimumPrerollFrames) {
+			frameQueueDecklinkToObs.push(theFrame);
+			continue;
+		}
+
 		result = output_->ScheduleVideoFrame(theFrame,
 						     i * frameDuration,
 						     frameDuration,
@@ -699,6 +690,8 @@ bool DeckLinkDeviceInstance::StopOutput()
 	renderDelegate.Clear();
 	frameQueueDecklinkToObs.reset();
 	frameQueueObsToDecklink.reset();
+	outputFrames.clear();
+	latestFrame = nullptr;
 
 	return true;
 }
@@ -709,38 +702,54 @@ void DeckLinkDeviceInstance::UpdateVideoFrame(video_data *frame)
 	if (decklinkOutput == nullptr)
 		return;
 
-	uint8_t *const blob = frameQueueDecklinkToObs.pop();
-	if (blob) {
-		memcpy(blob, frame->data[0],
-		       frame->linesize[0] * decklinkOutput->GetHeight());
-		frameQueueObsToDecklink.push(blob);
-	}
-}
+	/* if every frame is queued or in flight, drop this one */
+	IDeckLinkVideoFrame *const outputFrame = frameQueueDecklinkToObs.pop();
+	if (!outputFrame)
+		return;
 
-void DeckLinkDeviceInstance::ScheduleVideoFrame(IDeckLinkVideoFrame *frame)
-{
 	void *bytes;
-	if (SUCCEEDED(frame->GetBytes(&bytes))) {
-		uint8_t *blob = frameQueueObsToDecklink.pop();
-		if (blob) {
-			if (activeBlob)
-				frameQueueDecklinkToObs.push(activeBlob);
-			activeBlob = blob;
+	if (SUCCEEDED(outputFrame->GetBytes(&bytes))) {
+		const size_t rowBytes = (size_t)outputFrame->GetRowBytes();
+		const size_t height = (size_t)outputFrame->GetHeight();
+		const size_t linesize = frame->linesize[0];
+		uint8_t *dst = (uint8_t *)bytes;
+
+		if (rowBytes == linesize) {
+			memcpy(dst, frame->data[0], rowBytes * height);
 		} else {
-			blob = activeBlob;
+			const size_t copy = std::min(rowBytes, linesize);
+			for (size_t y = 0; y < height; y++)
+				memcpy(dst + y * rowBytes,
+				       frame->data[0] + y * linesize, copy);
 		}
+	}
 
-		const int frameSize = frame->GetRowBytes() * frame->GetHeight();
-		if (blob)
-			memcpy(bytes, blob, frameSize);
-		else
-			memset(bytes, 0, frameSize);
+	frameQueueObsToDecklink.push(outputFrame);
+}
 
-		output->ScheduleVideoFrame(frame,
-					   totalFramesScheduled * frameDuration,
-					   frameDuration, frameTimescale);
-		++totalFramesScheduled;
-	}
+void DeckLinkDeviceInstance::ScheduleVideoFrame(IDeckLinkVideoFrame *frame)
+{
+	IDeckLinkVideoFrame *next = frameQueueObsToDecklink.pop();
+	if (next) {
+		frameQueueDecklinkToObs.push(frame);
+	} else {
+		/* no new frame from OBS in time, so show the last one again
+		 * using the frame that just completed */
+		void *src;
+		void *dst;
+		next = frame;
+		if (latestFrame && latestFrame != frame &&
+		    SUCCEEDED(latestFrame->GetBytes(&src)) &&
+		    SUCCEEDED(frame->GetBytes(&dst)))
+			memcpy(dst, src,
+			       (size_t)frame->GetRowBytes() *
+				       frame->GetHeight());
+	}
+
+	latestFrame = next;
+	output->ScheduleVideoFrame(next, totalFramesScheduled * frameDuration,
+				   frameDuration, frameTimescale);
+	++totalFramesScheduled;
 }
 
 void DeckLinkDeviceInstance::WriteAudio(audio_data *frames)
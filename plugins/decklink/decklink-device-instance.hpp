@@ -74,7 +74,7 @@ private:
 
 	struct Node {
 		std::atomic<Node *> next = nullptr;
-		uint8_t *frame = nullptr;
+		IDeckLinkVideoFrame *frame = nullptr;
 	};
 
 	struct alignas(FalseSharingSize) PaddedNode {
@@ -107,7 +107,7 @@ public:
 		cache_list = &cache[0].node;
 	}
 
-	void push(uint8_t *v)
+	void push(IDeckLinkVideoFrame *v)
 	{
 		Node *const n = cache_list;
 		cache_list = cache_list->next.load(std::memory_order_relaxed);
@@ -120,9 +120,9 @@ public:
 		back = n;
 	}
 
-	uint8_t *pop()
+	IDeckLinkVideoFrame *pop()
 	{
-		uint8_t *frame = nullptr;
+		IDeckLinkVideoFrame *frame = nullptr;
 
 		Node *const n_front =
 			front->next.load(std::memory_order_consume);
@@ -163,10 +163,10 @@ protected:
 	bool allow10Bit;
 
 	OBSVideoFrame *convertFrame = nullptr;
-	std::vector<uint8_t> frameBlobs[FrameQueueFrameCount];
+	std::vector<ComPtr<IDeckLinkVideoFrame>> outputFrames;
 	FrameQueue frameQueueObsToDecklink;
 	FrameQueue frameQueueDecklinkToObs;
-	uint8_t *activeBlob = nullptr;
+	IDeckLinkVideoFrame *latestFrame = nullptr;
 	BMDTimeValue frameDuration;
 	BMDTimeScale frameTimescale;
 	BMDTimeScale totalFramesScheduled;
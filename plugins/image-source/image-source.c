@@ -13,6 +13,26 @@
 #define info(format, ...) blog(LOG_INFO, format, ##__VA_ARGS__)
 #define warn(format, ...) blog(LOG_WARNING, format, ##__VA_ARGS__)
 
+/* small static images share the pages of this atlas */
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_MAX_IMAGE_SIZE 256
+
+static gs_texture_atlas_t *image_atlas = NULL;
+
+/* enough for a 16384x16384 image */
+#define MAX_MIP_LEVELS 15
+
+/* an image decoded on a worker thread, waiting for its texture */
+struct image_decode {
+	long serial;
+	time_t file_timestamp;
+	gs_image_file4_t if4;
+
+	uint32_t num_levels;
+	uint8_t *mip_data;
+	const uint8_t *levels[MAX_MIP_LEVELS];
+};
+
 struct image_source {
 	obs_source_t *source;
 
@@ -20,6 +40,7 @@ struct image_source {
 	bool persistent;
 	bool is_slide;
 	bool linear_alpha;
+	bool mipmaps;
 	time_t file_timestamp;
 	float update_time_elapsed;
 	uint64_t last_time;
@@ -27,8 +48,17 @@ struct image_source {
 	bool restart_gif;
 	volatile bool file_decoded;
 	volatile bool texture_loaded;
+	volatile bool decode_pending;
 
 	gs_image_file4_t if4;
+
+	/* guards file, serial and pending against the decode tasks */
+	pthread_mutex_t mutex;
+	long serial;
+	struct image_decode *pending;
+
+	bool in_atlas;
+	struct gs_atlas_region region;
 };
 
 static time_t get_modified_timestamp(const char *filename)
@@ -45,57 +75,281 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
+static bool can_build_mipmaps(const struct gs_image_file *image)
+{
+	if (!image->loaded || image->is_animated_gif || !image->texture_data)
+		return false;
+
+	return image->format == GS_RGBA || image->format == GS_BGRA ||
+	       image->format == GS_BGRX;
+}
+
+/* Builds the mip chain on the decoding thread with a 2x2 box filter.  The
+ * pixels are premultiplied, so all four channels can be averaged alike. */
+static void build_mipmaps(struct image_decode *decode)
+{
+	const struct gs_image_file *image = &decode->if4.image3.image2.image;
+	uint32_t cx = image->cx;
+	uint32_t cy = image->cy;
+	size_t offsets[MAX_MIP_LEVELS];
+	size_t size = 0;
+	uint32_t levels = 1;
+
+	if (!can_build_mipmaps(image))
+		return;
+
+	while ((cx > 1 || cy > 1) && levels < MAX_MIP_LEVELS) {
+		cx = cx > 1 ? cx / 2 : 1;
+		cy = cy > 1 ? cy / 2 : 1;
+		offsets[levels++] = size;
+		size += (size_t)cx * cy * 4;
+	}
+
+	if (levels == 1)
+		return;
+
+	decode->mip_data = bmalloc(size);
+	decode->levels[0] = image->texture_data;
+
+	cx = image->cx;
+	cy = image->cy;
+
+	for (uint32_t i = 1; i < levels; i++) {
+		const uint8_t *src = decode->levels[i - 1];
+		uint8_t *dst = decode->mip_data + offsets[i];
+		const uint32_t src_cx = cx;
+		const uint32_t src_cy = cy;
+
+		cx = cx > 1 ? cx / 2 : 1;
+		cy = cy > 1 ? cy / 2 : 1;
+
+		for (uint32_t y = 0; y < cy; y++) {
+			const uint32_t y1 = y * 2 + 1 < src_cy ? y * 2 + 1
+							       : y * 2;
+			const uint8_t *row0 = src + (size_t)y * 2 * src_cx * 4;
+			const uint8_t *row1 = src + (size_t)y1 * src_cx * 4;
+
+			for (uint32_t x = 0; x < cx; x++) {
+				const uint32_t x0 = x * 2 * 4;
+				const uint32_t x1 =
+					(x * 2 + 1 < src_cx ? x * 2 + 1
+							    : x * 2) *
+					4;
+
+				for (uint32_t c = 0; c < 4; c++) {
+					*(dst++) = (uint8_t)((row0[x0 + c] +
+							      row0[x1 + c] +
+							      row1[x0 + c] +
+							      row1[x1 + c] +
+							      2) /
+							     4);
+				}
+			}
+		}
+
+		decode->levels[i] = decode->mip_data + offsets[i];
+	}
+
+	decode->num_levels = levels;
+}
+
+static void image_decode_free(struct image_decode *decode)
+{
+	if (!decode)
+		return;
+
+	obs_enter_graphics();
+	gs_image_file4_free(&decode->if4);
+	obs_leave_graphics();
+
+	bfree(decode->mip_data);
+	bfree(decode);
+}
+
+/* Decodes the current file and leaves it for the next tick to upload.  This
+ * is called from worker threads, so only the mutex-guarded state is used. */
 void image_source_preload_image(void *data)
 {
 	struct image_source *context = data;
-	if (os_atomic_load_bool(&context->file_decoded))
+	struct image_decode *decode;
+	enum gs_image_alpha_mode alpha_mode;
+	bool mipmaps;
+	char *file;
+
+	pthread_mutex_lock(&context->mutex);
+	if (os_atomic_load_bool(&context->file_decoded) || !context->file ||
+	    !*context->file) {
+		pthread_mutex_unlock(&context->mutex);
 		return;
+	}
+
+	decode = bzalloc(sizeof(*decode));
+	decode->serial = context->serial;
+	file = bstrdup(context->file);
+	mipmaps = context->mipmaps;
+	alpha_mode = context->linear_alpha ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
+					   : GS_IMAGE_ALPHA_PREMULTIPLY;
+	pthread_mutex_unlock(&context->mutex);
+
+	decode->file_timestamp = get_modified_timestamp(file);
+	gs_image_file4_init(&decode->if4, file, alpha_mode);
+	if (mipmaps)
+		build_mipmaps(decode);
+	bfree(file);
+
+	pthread_mutex_lock(&context->mutex);
+	if (decode->serial == context->serial &&
+	    !os_atomic_load_bool(&context->file_decoded)) {
+		image_decode_free(context->pending);
+		context->pending = decode;
+		decode = NULL;
+		os_atomic_set_bool(&context->file_decoded, true);
+		os_atomic_set_bool(&context->decode_pending, true);
+	}
+	pthread_mutex_unlock(&context->mutex);
+
+	/* superseded by a newer load or an unload while decoding */
+	image_decode_free(decode);
+}
+
+static void decode_task(void *param)
+{
+	obs_weak_source_t *weak = param;
+	obs_source_t *source = obs_weak_source_get_source(weak);
+
+	if (source) {
+		image_source_preload_image(obs_obj_get_data(source));
+		obs_source_release(source);
+	}
 
-	context->file_timestamp = get_modified_timestamp(context->file);
-	gs_image_file4_init(&context->if4, context->file,
-			    context->linear_alpha
-				    ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
-				    : GS_IMAGE_ALPHA_PREMULTIPLY);
-	os_atomic_set_bool(&context->file_decoded, true);
+	obs_weak_source_release(weak);
+}
+
+static void image_source_pack_texture(struct image_source *context)
+{
+	struct gs_image_file *const image = &context->if4.image3.image2.image;
+
+	if (!image->texture || image->is_animated_gif || context->is_slide)
+		return;
+	if (image->cx > ATLAS_MAX_IMAGE_SIZE ||
+	    image->cy > ATLAS_MAX_IMAGE_SIZE)
+		return;
+
+	if (!image_atlas)
+		image_atlas = gs_texture_atlas_create(ATLAS_PAGE_SIZE);
+	if (!gs_texture_atlas_alloc(image_atlas, image->texture,
+				    &context->region))
+		return;
+
+	gs_texture_destroy(image->texture);
+	image->texture = NULL;
+	context->in_atlas = true;
+}
+
+static void free_image(struct image_source *context)
+{
+	if (context->in_atlas) {
+		gs_texture_atlas_free(image_atlas, &context->region);
+		context->in_atlas = false;
+	}
+	gs_image_file4_free(&context->if4);
+}
+
+static void init_texture(struct image_source *context,
+			 struct image_decode *decode)
+{
+	struct gs_image_file *const image = &context->if4.image3.image2.image;
+
+	if (decode->num_levels <= 1 || !image->loaded) {
+		gs_image_file4_init_texture(&context->if4);
+		image_source_pack_texture(context);
+		return;
+	}
+
+	/* mipmapped textures are kept out of the atlas, which only copies
+	 * the top level */
+	image->texture = gs_texture_create(image->cx, image->cy, image->format,
+					   decode->num_levels, decode->levels,
+					   0);
+	bfree(image->texture_data);
+	image->texture_data = NULL;
 }
 
 static void image_source_load_texture(void *data)
 {
 	struct image_source *context = data;
-	if (os_atomic_load_bool(&context->texture_loaded))
+	struct image_decode *decode;
+
+	pthread_mutex_lock(&context->mutex);
+	decode = context->pending;
+	context->pending = NULL;
+	os_atomic_set_bool(&context->decode_pending, false);
+	pthread_mutex_unlock(&context->mutex);
+
+	if (!decode)
 		return;
 
 	debug("loading texture '%s'", context->file);
 
 	obs_enter_graphics();
-	gs_image_file4_init_texture(&context->if4);
+	free_image(context);
+	context->if4 = decode->if4;
+	context->file_timestamp = decode->file_timestamp;
+	init_texture(context, decode);
 	obs_leave_graphics();
 
+	bfree(decode->mip_data);
+	bfree(decode);
+
 	if (!context->if4.image3.image2.image.loaded)
 		warn("failed to load texture '%s'", context->file);
 	context->update_time_elapsed = 0;
 	os_atomic_set_bool(&context->texture_loaded, true);
+	obs_source_mark_video_dirty(context->source);
 }
 
 static void image_source_unload(void *data)
 {
 	struct image_source *context = data;
+	struct image_decode *decode;
+
+	pthread_mutex_lock(&context->mutex);
+	context->serial++;
+	decode = context->pending;
+	context->pending = NULL;
+	os_atomic_set_bool(&context->decode_pending, false);
 	os_atomic_set_bool(&context->file_decoded, false);
 	os_atomic_set_bool(&context->texture_loaded, false);
+	pthread_mutex_unlock(&context->mutex);
+
+	image_decode_free(decode);
 
 	obs_enter_graphics();
-	gs_image_file4_free(&context->if4);
+	free_image(context);
 	obs_leave_graphics();
+
+	obs_source_mark_video_dirty(context->source);
+}
+
+/* Decodes the file on the task pool.  The image that is shown now, if any,
+ * stays until the new one has been decoded. */
+static void queue_decode(struct image_source *context)
+{
+	pthread_mutex_lock(&context->mutex);
+	context->serial++;
+	os_atomic_set_bool(&context->file_decoded, false);
+	pthread_mutex_unlock(&context->mutex);
+
+	obs_queue_task(OBS_TASK_BACKGROUND, decode_task,
+		       obs_source_get_weak_source(context->source), false);
 }
 
 static void image_source_load(struct image_source *context)
 {
 	image_source_unload(context);
 
-	if (context->file && *context->file) {
-		image_source_preload_image(context);
-		image_source_load_texture(context);
-	}
+	if (context->file && *context->file)
+		queue_decode(context);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -105,12 +359,17 @@ static void image_source_update(void *data, obs_data_t *settings)
 	const bool unload = obs_data_get_bool(settings, "unload");
 	const bool linear_alpha = obs_data_get_bool(settings, "linear_alpha");
 	const bool is_slide = obs_data_get_bool(settings, "is_slide");
+	const bool mipmaps = obs_data_get_bool(settings, "mipmaps");
 
+	pthread_mutex_lock(&context->mutex);
 	if (context->file)
 		bfree(context->file);
 	context->file = bstrdup(file);
-	context->persistent = !unload;
 	context->linear_alpha = linear_alpha;
+	context->mipmaps = mipmaps;
+	pthread_mutex_unlock(&context->mutex);
+
+	context->persistent = !unload;
 	context->is_slide = is_slide;
 
 	if (is_slide)
@@ -127,6 +386,7 @@ static void image_source_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "unload", false);
 	obs_data_set_default_bool(settings, "linear_alpha", false);
+	obs_data_set_default_bool(settings, "mipmaps", false);
 }
 
 static void image_source_show(void *data)
@@ -158,6 +418,7 @@ static void restart_gif(void *data)
 		gs_image_file4_update_texture(&context->if4);
 		obs_leave_graphics();
 
+		obs_source_mark_video_dirty(context->source);
 		context->restart_gif = false;
 	}
 }
@@ -172,6 +433,11 @@ static void *image_source_create(obs_data_t *settings, obs_source_t *source)
 {
 	struct image_source *context = bzalloc(sizeof(struct image_source));
 	context->source = source;
+	pthread_mutex_init_value(&context->mutex);
+	if (pthread_mutex_init(&context->mutex, NULL) != 0) {
+		bfree(context);
+		return NULL;
+	}
 
 	image_source_update(context, settings);
 	return context;
@@ -183,6 +449,7 @@ static void image_source_destroy(void *data)
 
 	image_source_unload(context);
 
+	pthread_mutex_destroy(&context->mutex);
 	if (context->file)
 		bfree(context->file);
 	bfree(context);
@@ -207,7 +474,9 @@ static void image_source_render(void *data, gs_effect_t *effect)
 		return;
 
 	struct gs_image_file *const image = &context->if4.image3.image2.image;
-	gs_texture_t *const texture = image->texture;
+	gs_texture_t *const texture = context->in_atlas
+					      ? context->region.texture
+					      : image->texture;
 	if (!texture)
 		return;
 
@@ -220,7 +489,13 @@ static void image_source_render(void *data, gs_effect_t *effect)
 	gs_eparam_t *const param = gs_effect_get_param_by_name(effect, "image");
 	gs_effect_set_texture_srgb(param, texture);
 
-	gs_draw_sprite(texture, 0, image->cx, image->cy);
+	if (context->in_atlas) {
+		const struct gs_atlas_region *region = &context->region;
+		gs_draw_sprite_subregion(texture, 0, region->x, region->y,
+					 region->cx, region->cy);
+	} else {
+		gs_draw_sprite(texture, 0, image->cx, image->cy);
+	}
 
 	gs_blend_state_pop();
 
@@ -230,12 +505,10 @@ static void image_source_render(void *data, gs_effect_t *effect)
 static void image_source_tick(void *data, float seconds)
 {
 	struct image_source *context = data;
-	if (!os_atomic_load_bool(&context->texture_loaded)) {
-		if (os_atomic_load_bool(&context->file_decoded))
-			image_source_load_texture(context);
-		else
-			return;
-	}
+	if (os_atomic_load_bool(&context->decode_pending))
+		image_source_load_texture(context);
+	if (!os_atomic_load_bool(&context->texture_loaded))
+		return;
 
 	uint64_t frame_time = obs_get_video_frame_time();
 
@@ -247,7 +520,8 @@ static void image_source_tick(void *data, float seconds)
 			context->update_time_elapsed = 0.0f;
 
 			if (context->file_timestamp != t) {
-				image_source_load(context);
+				context->file_timestamp = t;
+				queue_decode(context);
 			}
 		}
 	}
@@ -280,6 +554,8 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file4_update_texture(&context->if4);
 			obs_leave_graphics();
+
+			obs_source_mark_video_dirty(context->source);
 		}
 	}
 
@@ -316,10 +592,18 @@ static obs_properties_t *image_source_properties(void *data)
 				obs_module_text("UnloadWhenNotShowing"));
 	obs_properties_add_bool(props, "linear_alpha",
 				obs_module_text("LinearAlpha"));
+	obs_properties_add_bool(props, "mipmaps", obs_module_text("Mipmaps"));
 
 	return props;
 }
 
+/* whether a slide is still waiting for its image to be decoded */
+bool image_source_decoding(void *data)
+{
+	struct image_source *s = data;
+	return !os_atomic_load_bool(&s->file_decoded);
+}
+
 uint64_t image_source_get_memory_usage(void *data)
 {
 	struct image_source *s = data;
@@ -366,13 +650,15 @@ image_source_get_color_space(void *data, size_t count,
 
 	struct image_source *const s = data;
 	gs_image_file4_t *const if4 = &s->if4;
-	return if4->image3.image2.image.texture ? if4->space : GS_CS_SRGB;
+	return (if4->image3.image2.image.texture || s->in_atlas) ? if4->space
+								 : GS_CS_SRGB;
 }
 
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
@@ -414,3 +700,13 @@ bool obs_module_load(void)
 	obs_register_source(&slideshow_info_mk2);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	if (image_atlas) {
+		obs_enter_graphics();
+		gs_texture_atlas_destroy(image_atlas);
+		obs_leave_graphics();
+		image_atlas = NULL;
+	}
+}
@@ -4,7 +4,6 @@
 #include <util/platform.h>
 #include <util/darray.h>
 #include <util/dstr.h>
-#include <util/task.h>
 
 #include <inttypes.h>
 
@@ -31,6 +30,8 @@ static const char *S_BEHAVIOR_ALWAYS_PLAY    = "always_play";
 static const char *S_MODE                    = "slide_mode";
 static const char *S_MODE_AUTO               = "mode_auto";
 static const char *S_MODE_MANUAL             = "mode_manual";
+static const char *S_PRELOAD                 = "preload_count";
+static const char *S_MEMORY_LIMIT            = "memory_limit";
 
 static const char *TR_CUT                    = "cut";
 static const char *TR_FADE                   = "fade";
@@ -53,6 +54,8 @@ static const char *TR_SLIDE                  = "slide";
 #define T_MODE                               T_("SlideMode")
 #define T_MODE_AUTO                          T_("SlideMode.Auto")
 #define T_MODE_MANUAL                        T_("SlideMode.Manual")
+#define T_PRELOAD                            T_("PreloadCount")
+#define T_MEMORY_LIMIT                       T_("MemoryLimit")
 
 #define T_TR_(text) obs_module_text("SlideShow.Transition." text)
 #define T_TR_CUT                             T_TR_("Cut")
@@ -63,6 +66,8 @@ static const char *TR_SLIDE                  = "slide";
 /* clang-format on */
 
 extern void image_source_preload_image(void *data);
+extern bool image_source_decoding(void *data);
+extern uint64_t image_source_get_memory_usage(void *data);
 
 /* ------------------------------------------------------------------------- */
 
@@ -85,6 +90,7 @@ enum behavior {
 };
 
 #define SLIDE_BUFFER_COUNT 5
+#define MAX_SLIDE_BUFFER_COUNT 50
 
 struct active_slides {
 	struct deque prev;
@@ -94,6 +100,8 @@ struct active_slides {
 
 struct slideshow_data {
 	struct active_slides slides;
+	size_t buffer_count;
+	uint64_t memory_limit;
 	image_file_array_t files;
 	float slide_time;
 	uint32_t tr_speed;
@@ -119,7 +127,6 @@ struct slideshow {
 	obs_source_t *source;
 
 	struct slideshow_data data;
-	os_task_queue_t *queue;
 	obs_source_t *transition;
 	uint32_t cx;
 	uint32_t cy;
@@ -307,8 +314,8 @@ static inline obs_source_t *create_source_from_file(struct slideshow *ss,
 
 	obs_data_release(settings);
 
-	os_task_queue_queue_task(ss->queue, decode_image,
-				 obs_source_get_weak_source(source));
+	obs_queue_task(OBS_TASK_BACKGROUND, decode_image,
+		       obs_source_get_weak_source(source), false);
 
 	return source;
 }
@@ -392,14 +399,14 @@ static void restart_slides(struct slideshow *ss)
 		new_slides.cur = get_new_source(ss, &new_slides, start_idx);
 
 		idx = start_idx;
-		for (size_t i = 0; i < SLIDE_BUFFER_COUNT; i++) {
+		for (size_t i = 0; i < ssd->buffer_count; i++) {
 			idx = get_new_file(ssd, idx, true);
 			sd = get_new_source(ss, &new_slides, idx);
 			deque_push_back(&new_slides.next, &sd, sizeof(sd));
 		}
 
 		idx = start_idx;
-		for (size_t i = 0; i < SLIDE_BUFFER_COUNT; i++) {
+		for (size_t i = 0; i < ssd->buffer_count; i++) {
 			idx = get_new_file(ssd, idx, false);
 			sd = get_new_source(ss, &new_slides, idx);
 			deque_push_front(&new_slides.prev, &sd, sizeof(sd));
@@ -410,6 +417,71 @@ static void restart_slides(struct slideshow *ss)
 	ssd->slides = new_slides;
 }
 
+static inline uint64_t slide_memory_usage(obs_source_t *source)
+{
+	return source ? image_source_get_memory_usage(obs_obj_get_data(source))
+		      : 0;
+}
+
+static inline bool slide_decoding(obs_source_t *source)
+{
+	return source && image_source_decoding(obs_obj_get_data(source));
+}
+
+static inline void load_slide(struct slideshow *ss, struct source_data *sd)
+{
+	if (!sd->source)
+		sd->source = create_source_from_file(ss, sd->path, false);
+}
+
+static inline void unload_slide(struct source_data *sd)
+{
+	free_source_data(sd);
+	sd->source = NULL;
+}
+
+/* Keeps the preloaded slides within the memory limit.  Slides are loaded
+ * nearest first, alternating between the next and the previous ones, and
+ * one at a time, since their size is only known once they are decoded.
+ * Everything past the limit is unloaded again.  The current slide is always
+ * kept, whatever its size. */
+static void update_preload_window(struct slideshow *ss)
+{
+	struct slideshow_data *ssd = &ss->data;
+	struct active_slides *slides = &ssd->slides;
+	const size_t sd_size = sizeof(struct source_data);
+	const size_t count = slides->next.size / sd_size;
+	bool loading = slide_decoding(slides->cur.source);
+	uint64_t used = slide_memory_usage(slides->cur.source);
+
+	if (!ssd->memory_limit || !ssd->files.num)
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		struct source_data *window[2] = {
+			deque_data(&slides->next, i * sd_size),
+			deque_data(&slides->prev, (count - 1 - i) * sd_size),
+		};
+
+		for (size_t j = 0; j < 2; j++) {
+			struct source_data *sd = window[j];
+
+			if (used >= ssd->memory_limit) {
+				unload_slide(sd);
+				continue;
+			}
+			if (!sd->source) {
+				if (loading)
+					continue;
+				load_slide(ss, sd);
+			}
+
+			loading = loading || slide_decoding(sd->source);
+			used += slide_memory_usage(sd->source);
+		}
+	}
+}
+
 static void ss_update(void *data, obs_data_t *settings)
 {
 	struct slideshow *ss = data;
@@ -456,6 +528,16 @@ static void ss_update(void *data, obs_data_t *settings)
 	new_data.loop = obs_data_get_bool(settings, S_LOOP);
 	new_data.hide = obs_data_get_bool(settings, S_HIDE);
 
+	new_data.buffer_count = (size_t)obs_data_get_int(settings, S_PRELOAD);
+	if (new_data.buffer_count < 1)
+		new_data.buffer_count = 1;
+	else if (new_data.buffer_count > MAX_SLIDE_BUFFER_COUNT)
+		new_data.buffer_count = MAX_SLIDE_BUFFER_COUNT;
+
+	new_data.memory_limit =
+		(uint64_t)obs_data_get_int(settings, S_MEMORY_LIMIT) * 1024 *
+		1024;
+
 	if (!old_data.tr_name || strcmp(tr_name, old_data.tr_name) != 0)
 		new_tr = obs_source_create_private(tr_name, NULL, NULL);
 
@@ -638,8 +720,8 @@ static void ss_next_slide(void *data)
 	if (!ssd->files.num || obs_transition_get_time(ss->transition) < 1.0f)
 		return;
 
-	struct source_data *last = deque_data(
-		&slides->next, (SLIDE_BUFFER_COUNT - 1) * sizeof(sd));
+	struct source_data *last =
+		deque_data(&slides->next, (ssd->buffer_count - 1) * sizeof(sd));
 
 	size_t slide_idx = last->slide_idx;
 	if (ss->data.randomize)
@@ -653,6 +735,7 @@ static void ss_next_slide(void *data)
 	deque_pop_front(&slides->next, &slides->cur, sizeof(sd));
 	deque_pop_front(&slides->prev, &sd, sizeof(sd));
 	free_source_data(&sd);
+	load_slide(ss, &slides->cur);
 
 	do_transition(ss, false);
 }
@@ -683,6 +766,7 @@ static void ss_previous_slide(void *data)
 	deque_pop_back(&slides->prev, &slides->cur, sizeof(sd));
 	deque_pop_back(&slides->next, &sd, sizeof(sd));
 	free_source_data(&sd);
+	load_slide(ss, &slides->cur);
 
 	do_transition(ss, false);
 }
@@ -769,7 +853,6 @@ static void ss_destroy(void *data)
 {
 	struct slideshow *ss = data;
 
-	os_task_queue_destroy(ss->queue);
 	obs_source_release(ss->transition);
 	free_slideshow_data(&ss->data);
 	bfree(ss);
@@ -786,8 +869,6 @@ static void *ss_create(obs_data_t *settings, obs_source_t *source)
 	ss->data.paused = false;
 	ss->data.stop = false;
 
-	ss->queue = os_task_queue_create();
-
 	ss->play_pause_hotkey = obs_hotkey_register_source(
 		source, "SlideShow.PlayPause",
 		obs_module_text("SlideShow.PlayPause"), play_pause_hotkey, ss);
@@ -844,6 +925,8 @@ static void ss_video_tick(void *data, float seconds)
 	if (!ss->transition || !ssd->slide_time)
 		return;
 
+	update_preload_window(ss);
+
 	if (ssd->restart_on_activate && ssd->use_cut) {
 		ssd->elapsed = 0.0f;
 		restart_slides(ss);
@@ -973,6 +1056,8 @@ static void ss_defaults(obs_data_t *settings)
 				    S_BEHAVIOR_ALWAYS_PLAY);
 	obs_data_set_default_string(settings, S_MODE, S_MODE_AUTO);
 	obs_data_set_default_bool(settings, S_LOOP, true);
+	obs_data_set_default_int(settings, S_PRELOAD, SLIDE_BUFFER_COUNT);
+	obs_data_set_default_int(settings, S_MEMORY_LIMIT, 0);
 }
 
 static const char *file_filter = "Image files (*.bmp *.tga *.png *.jpeg *.jpg"
@@ -1034,6 +1119,13 @@ static obs_properties_t *ss_properties(void *data)
 	obs_properties_add_bool(ppts, S_HIDE, T_HIDE);
 	obs_properties_add_bool(ppts, S_RANDOMIZE, T_RANDOMIZE);
 
+	obs_properties_add_int(ppts, S_PRELOAD, T_PRELOAD, 1,
+			       MAX_SLIDE_BUFFER_COUNT, 1);
+
+	p = obs_properties_add_int(ppts, S_MEMORY_LIMIT, T_MEMORY_LIMIT, 0,
+				   65536, 64);
+	obs_property_int_set_suffix(p, " MB");
+
 	p = obs_properties_add_list(ppts, S_CUSTOM_SIZE, T_CUSTOM_SIZE,
 				    OBS_COMBO_TYPE_EDITABLE,
 				    OBS_COMBO_FORMAT_STRING);
@@ -1177,7 +1269,8 @@ struct obs_source_info slideshow_info_mk2 = {
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA,
+			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA |
+			OBS_SOURCE_ALWAYS_TICK,
 	.get_name = ss_getname,
 	.create = ss_create,
 	.destroy = ss_destroy,
@@ -1092,7 +1092,7 @@ struct obs_source_info slideshow_info = {
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
 			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA |
-			OBS_SOURCE_CAP_OBSOLETE,
+			OBS_SOURCE_ALWAYS_TICK | OBS_SOURCE_CAP_OBSOLETE,
 	.get_name = ss_getname,
 	.create = ss_create,
 	.destroy = ss_destroy,
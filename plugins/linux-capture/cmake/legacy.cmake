@@ -1,7 +1,7 @@
 project(linux-capture)
 
 find_package(X11 REQUIRED)
-find_package(XCB COMPONENTS XCB XFIXES RANDR SHM XINERAMA COMPOSITE)
+find_package(XCB COMPONENTS XCB XFIXES RANDR SHM XINERAMA COMPOSITE DAMAGE)
 if(NOT TARGET XCB::COMPOSITE)
   obs_status(FATAL_ERROR "xcb composite library not found")
 endif()
@@ -30,7 +30,8 @@ target_link_libraries(
           XCB::RANDR
           XCB::SHM
           XCB::XINERAMA
-          XCB::COMPOSITE)
+          XCB::COMPOSITE
+          XCB::DAMAGE)
 
 set_target_properties(linux-capture PROPERTIES FOLDER "plugins")
 
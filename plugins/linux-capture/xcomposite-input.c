@@ -6,6 +6,7 @@
 #include <X11/Xlib-xcb.h>
 #include <xcb/xcb.h>
 #include <xcb/composite.h>
+#include <xcb/damage.h>
 #include <pthread.h>
 
 #include <stdlib.h>
@@ -27,6 +28,9 @@
 
 static Display *disp = NULL;
 static xcb_connection_t *conn = NULL;
+// Damage events tell which captured windows repainted since the last tick
+static bool damage_supported = false;
+static uint8_t damage_event_base = 0;
 // Atoms used throughout our plugin
 xcb_atom_t ATOM_UTF8_STRING;
 xcb_atom_t ATOM_STRING;
@@ -60,6 +64,8 @@ struct xcompcap {
 
 	Pixmap pixmap;
 	gs_texture_t *gltex;
+	xcb_damage_damage_t damage;
+	bool damaged;
 
 	pthread_mutex_t lock;
 
@@ -349,6 +355,11 @@ cleanup1:
 
 void xcomp_cleanup_pixmap(Display *disp, struct xcompcap *s)
 {
+	if (s->damage) {
+		xcb_damage_destroy(XGetXCBConnection(disp), s->damage);
+		s->damage = 0;
+	}
+
 	if (s->gltex) {
 		gs_texture_destroy(s->gltex);
 		s->gltex = 0;
@@ -414,6 +425,15 @@ void xcomp_create_pixmap(xcb_connection_t *conn, struct xcompcap *s,
 						 GS_BGRA_UNORM, GL_TEXTURE_2D,
 						 (void *)s->pixmap);
 	XSetErrorHandler(prev);
+
+	// The texture samples the pixmap directly, so only repaints of the
+	// window need the source to be drawn again
+	if (s->gltex && damage_supported) {
+		s->damage = xcb_generate_id(conn);
+		xcb_damage_create(conn, s->damage, s->win,
+				  XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+	}
+	s->damaged = true;
 }
 
 struct reg_item {
@@ -492,8 +512,26 @@ void watcher_process(xcb_generic_event_t *ev)
 
 	pthread_mutex_lock(&watcher_lock);
 	xcb_window_t win = 0;
+	uint8_t type = ev->response_type & ~0x80;
+
+	if (damage_supported &&
+	    type == damage_event_base + XCB_DAMAGE_NOTIFY) {
+		xcb_damage_damage_t damage =
+			((xcb_damage_notify_event_t *)ev)->damage;
+
+		for (size_t i = 0; i < watcher_registry.num; i++) {
+			struct reg_item *item = (struct reg_item *)darray_item(
+				sizeof(struct reg_item), &watcher_registry.da,
+				i);
+			if (item->src->damage == damage)
+				item->src->damaged = true;
+		}
 
-	switch (ev->response_type & ~0x80) {
+		pthread_mutex_unlock(&watcher_lock);
+		return;
+	}
+
+	switch (type) {
 	case XCB_CONFIGURE_NOTIFY:
 		win = ((xcb_configure_notify_event_t *)ev)->event;
 		break;
@@ -686,6 +724,15 @@ static void xcompcap_video_tick(void *data, float seconds)
 				   s->cursor->y_org + s->crop_top);
 	}
 
+	// Without XDamage every tick has to be treated as a repaint
+	if (s->damaged || !s->damage) {
+		if (s->damage)
+			xcb_damage_subtract(conn, s->damage, XCB_NONE,
+					    XCB_NONE);
+		s->damaged = false;
+		obs_source_mark_video_dirty(s->source);
+	}
+
 	if (!s->gltex)
 		goto done;
 
@@ -693,11 +740,21 @@ static void xcompcap_video_tick(void *data, float seconds)
 		goto done;
 
 	if (s->show_cursor) {
+		const int x = s->cursor->x;
+		const int y = s->cursor->y;
+		const unsigned int serial = s->cursor->last_serial;
+		const bool outside = s->cursor_outside;
+
 		xcb_xcursor_update(conn, s->cursor);
 
 		s->cursor_outside = s->cursor->x < 0 || s->cursor->y < 0 ||
 				    s->cursor->x > (int)xcompcap_get_width(s) ||
 				    s->cursor->y > (int)xcompcap_get_height(s);
+
+		if (x != s->cursor->x || y != s->cursor->y ||
+		    serial != s->cursor->last_serial ||
+		    outside != s->cursor_outside)
+			obs_source_mark_video_dirty(s->source);
 	}
 
 done:
@@ -946,6 +1003,24 @@ void xcomposite_load(void)
 	}
 	free(version);
 
+	const xcb_query_extension_reply_t *damage_ext =
+		xcb_get_extension_data(conn, &xcb_damage_id);
+	if (damage_ext && damage_ext->present) {
+		xcb_damage_query_version_cookie_t damage_cookie =
+			xcb_damage_query_version(conn, 1, 1);
+		xcb_damage_query_version_reply_t *damage_version =
+			xcb_damage_query_version_reply(conn, damage_cookie,
+						       NULL);
+		if (damage_version) {
+			damage_supported = true;
+			damage_event_base = damage_ext->first_event;
+			free(damage_version);
+		}
+	}
+	if (!damage_supported)
+		blog(LOG_INFO, "XDamage extension not supported, captured "
+			       "windows are redrawn every frame");
+
 	// Must be done before other helpers called.
 	xcomp_gather_atoms(conn);
 
@@ -960,7 +1035,9 @@ void xcomposite_load(void)
 	struct obs_source_info sinfo = {
 		.id = "xcomposite_input",
 		.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-				OBS_SOURCE_DO_NOT_DUPLICATE,
+				OBS_SOURCE_DO_NOT_DUPLICATE |
+				(damage_supported ? OBS_SOURCE_STATIC_VIDEO
+						  : 0),
 		.get_name = xcompcap_getname,
 		.create = xcompcap_create,
 		.destroy = xcompcap_destroy,
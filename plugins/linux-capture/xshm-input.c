@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -32,6 +33,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "xshm-input: " msg, ##__VA_ARGS__)
 
+/* above this many damaged rectangles the whole area is fetched at once */
+#define XSHM_MAX_DAMAGE_RECTS 64
+
 struct xshm_data {
 	obs_source_t *source;
 
@@ -62,7 +66,15 @@ struct xshm_data {
 	bool show_cursor;
 	bool use_xinerama;
 	bool use_randr;
+	bool use_damage;
 	bool advanced;
+
+	/* damage tracking, the shm segment then holds the last captured
+	 * frame followed by scratch space for the damaged rectangles */
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	uint8_t damage_event;
+	bool damage_full;
 };
 
 /**
@@ -174,6 +186,227 @@ static int_fast32_t xshm_update_geometry(struct xshm_data *data)
 	return 1;
 }
 
+/**
+ * Start tracking damage on the root window
+ *
+ * @note requires xfixes to be initialized, which the cursor does
+ */
+static bool xshm_init_damage(struct xshm_data *data)
+{
+	const xcb_query_extension_reply_t *ext;
+	xcb_damage_query_version_cookie_t ver_c;
+	xcb_damage_query_version_reply_t *ver_r;
+
+	ext = xcb_get_extension_data(data->xcb, &xcb_damage_id);
+	if (!ext || !ext->present) {
+		blog(LOG_INFO, "Missing Damage extension !");
+		return false;
+	}
+
+	ver_c = xcb_damage_query_version_unchecked(data->xcb,
+						   XCB_DAMAGE_MAJOR_VERSION,
+						   XCB_DAMAGE_MINOR_VERSION);
+	ver_r = xcb_damage_query_version_reply(data->xcb, ver_c, NULL);
+	if (!ver_r)
+		return false;
+	free(ver_r);
+
+	data->damage = xcb_generate_id(data->xcb);
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root,
+			  XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+	data->damage_region = xcb_generate_id(data->xcb);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+	data->damage_event = ext->first_event;
+	data->damage_full = true;
+	return true;
+}
+
+/**
+ * Fetch the whole capture area into the start of the shm segment
+ */
+static bool xshm_get_full_image(struct xshm_data *data)
+{
+	xcb_shm_get_image_cookie_t img_c;
+	xcb_shm_get_image_reply_t *img_r;
+
+	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
+					    data->adj_x_org, data->adj_y_org,
+					    data->adj_width, data->adj_height,
+					    ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+					    data->xshm->seg, 0);
+
+	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
+	free(img_r);
+	return !!img_r;
+}
+
+/**
+ * Check whether the root window was damaged since the last frame
+ */
+static bool xshm_damage_pending(struct xshm_data *data)
+{
+	const uint8_t notify = data->damage_event + XCB_DAMAGE_NOTIFY;
+	xcb_generic_event_t *event;
+	bool pending = false;
+
+	while ((event = xcb_poll_for_event(data->xcb))) {
+		if ((event->response_type & ~0x80) == notify)
+			pending = true;
+		free(event);
+	}
+
+	return pending;
+}
+
+/**
+ * Clip a damaged rectangle to the capture area
+ *
+ * @return false if the rectangle lies outside of the capture area
+ */
+static bool xshm_clip_rect(struct xshm_data *data, xcb_rectangle_t *rect)
+{
+	int_fast32_t x1 = rect->x - data->adj_x_org;
+	int_fast32_t y1 = rect->y - data->adj_y_org;
+	int_fast32_t x2 = x1 + rect->width;
+	int_fast32_t y2 = y1 + rect->height;
+
+	if (x1 < 0)
+		x1 = 0;
+	if (y1 < 0)
+		y1 = 0;
+	if (x2 > data->adj_width)
+		x2 = data->adj_width;
+	if (y2 > data->adj_height)
+		y2 = data->adj_height;
+
+	if (x1 >= x2 || y1 >= y2)
+		return false;
+
+	rect->x = (int16_t)x1;
+	rect->y = (int16_t)y1;
+	rect->width = (uint16_t)(x2 - x1);
+	rect->height = (uint16_t)(y2 - y1);
+	return true;
+}
+
+/**
+ * Fetch the damaged rectangles into the scratch space of the shm segment
+ * and copy them into the last frame
+ *
+ * @return false if the frame could not be updated
+ */
+static bool xshm_get_damaged_rects(struct xshm_data *data,
+				   xcb_rectangle_t *rects, int count)
+{
+	xcb_shm_get_image_cookie_t cookies[XSHM_MAX_DAMAGE_RECTS];
+	const uint32_t frame_size = data->adj_width * data->adj_height * 4;
+	const uint32_t linesize = data->adj_width * 4;
+	uint32_t offset = frame_size;
+	bool success = true;
+
+	for (int i = 0; i < count; i++) {
+		cookies[i] = xcb_shm_get_image_unchecked(
+			data->xcb, data->xcb_screen->root,
+			data->adj_x_org + rects[i].x,
+			data->adj_y_org + rects[i].y, rects[i].width,
+			rects[i].height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+			data->xshm->seg, offset);
+		offset += rects[i].width * rects[i].height * 4;
+	}
+
+	for (int i = 0; i < count; i++) {
+		xcb_shm_get_image_reply_t *img_r;
+		img_r = xcb_shm_get_image_reply(data->xcb, cookies[i], NULL);
+		if (!img_r)
+			success = false;
+		free(img_r);
+	}
+
+	if (!success)
+		return false;
+
+	offset = frame_size;
+
+	for (int i = 0; i < count; i++) {
+		const uint32_t rect_linesize = rects[i].width * 4;
+		uint8_t *dst = data->xshm->data + rects[i].y * linesize +
+			       rects[i].x * 4;
+		const uint8_t *src = data->xshm->data + offset;
+
+		for (uint16_t y = 0; y < rects[i].height; y++) {
+			memcpy(dst, src, rect_linesize);
+			dst += linesize;
+			src += rect_linesize;
+		}
+
+		offset += rect_linesize * rects[i].height;
+	}
+
+	return true;
+}
+
+/**
+ * Update the last frame with the areas that changed since the previous one
+ *
+ * @return true if the frame changed
+ */
+static bool xshm_update_damage(struct xshm_data *data)
+{
+	xcb_xfixes_fetch_region_cookie_t region_c;
+	xcb_xfixes_fetch_region_reply_t *region_r;
+	xcb_rectangle_t rects[XSHM_MAX_DAMAGE_RECTS];
+	uint64_t area = 0;
+	int count = 0;
+	bool full;
+
+	if (!xshm_damage_pending(data) && !data->damage_full)
+		return false;
+
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE,
+			    data->damage_region);
+
+	region_c = xcb_xfixes_fetch_region_unchecked(data->xcb,
+						     data->damage_region);
+	region_r = xcb_xfixes_fetch_region_reply(data->xcb, region_c, NULL);
+	if (!region_r) {
+		data->damage_full = true;
+		return false;
+	}
+
+	xcb_rectangle_t *damaged = xcb_xfixes_fetch_region_rectangles(region_r);
+	int damaged_count =
+		xcb_xfixes_fetch_region_rectangles_length(region_r);
+
+	full = data->damage_full || damaged_count > XSHM_MAX_DAMAGE_RECTS;
+
+	for (int i = 0; !full && i < damaged_count; i++) {
+		rects[count] = damaged[i];
+		if (!xshm_clip_rect(data, &rects[count]))
+			continue;
+
+		area += (uint64_t)rects[count].width * rects[count].height;
+		count++;
+	}
+
+	free(region_r);
+
+	/* one request is cheaper once most of the area changed */
+	if (area * 2 > (uint64_t)data->adj_width * data->adj_height)
+		full = true;
+
+	if (full) {
+		data->damage_full = !xshm_get_full_image(data);
+		return !data->damage_full;
+	}
+	if (!count)
+		return false;
+
+	data->damage_full = !xshm_get_damaged_rects(data, rects, count);
+	return !data->damage_full;
+}
+
 /**
  * Returns the name of the plugin
  */
@@ -201,6 +434,13 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	if (data->damage) {
+		xcb_damage_destroy(data->xcb, data->damage);
+		xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+		data->damage = 0;
+		data->damage_region = 0;
+	}
+
 	if (data->xshm) {
 		xshm_xcb_detach(data->xshm);
 		data->xshm = NULL;
@@ -242,8 +482,10 @@ static void xshm_capture_start(struct xshm_data *data)
 		goto fail;
 	}
 
-	data->xshm =
-		xshm_xcb_attach(data->xcb, data->adj_width, data->adj_height);
+	/* the damaged rectangles are fetched behind the frame */
+	int_fast32_t shm_height = data->adj_height * (data->use_damage ? 2 : 1);
+
+	data->xshm = xshm_xcb_attach(data->xcb, data->adj_width, shm_height);
 	if (!data->xshm) {
 		blog(LOG_ERROR, "failed to attach shm !");
 		goto fail;
@@ -252,6 +494,9 @@ static void xshm_capture_start(struct xshm_data *data)
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
+	if (data->use_damage && !xshm_init_damage(data))
+		blog(LOG_WARNING, "failed to init damage tracking !");
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
@@ -274,6 +519,7 @@ static void xshm_update(void *vptr, obs_data_t *settings)
 
 	data->screen_id = obs_data_get_int(settings, "screen");
 	data->show_cursor = obs_data_get_bool(settings, "show_cursor");
+	data->use_damage = obs_data_get_bool(settings, "use_damage");
 	data->advanced = obs_data_get_bool(settings, "advanced");
 	data->server = bstrdup(obs_data_get_string(settings, "server"));
 
@@ -292,6 +538,7 @@ static void xshm_defaults(obs_data_t *defaults)
 {
 	obs_data_set_default_int(defaults, "screen", 0);
 	obs_data_set_default_bool(defaults, "show_cursor", true);
+	obs_data_set_default_bool(defaults, "use_damage", false);
 	obs_data_set_default_bool(defaults, "advanced", false);
 	obs_data_set_default_int(defaults, "cut_top", 0);
 	obs_data_set_default_int(defaults, "cut_left", 0);
@@ -419,6 +666,8 @@ static obs_properties_t *xshm_properties(void *vptr)
 				OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_properties_add_bool(props, "show_cursor",
 				obs_module_text("CaptureCursor"));
+	obs_properties_add_bool(props, "use_damage",
+				obs_module_text("CaptureDamage"));
 	obs_property_t *advanced = obs_properties_add_bool(
 		props, "advanced", obs_module_text("AdvancedSettings"));
 
@@ -493,30 +742,23 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
-
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
-					    data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height,
-					    ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
-
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
+	bool updated;
 
-	if (!img_r)
-		goto exit;
+	if (data->damage)
+		updated = xshm_update_damage(data);
+	else if (!xshm_get_full_image(data))
+		return;
+	else
+		updated = true;
 
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data,
-			     data->adj_width * 4, false);
+	if (updated)
+		gs_texture_set_image(data->texture, (void *)data->xshm->data,
+				     data->adj_width * 4, false);
 	xcb_xcursor_update(data->xcb, data->cursor);
 
 	obs_leave_graphics();
-
-exit:
-	free(img_r);
 }
 
 /**
@@ -26,6 +26,8 @@ target_sources(
   PRIVATE formats.c
           formats.h
           linux-pipewire.c
+          pipewire-audio.c
+          pipewire-audio.h
           pipewire.c
           pipewire.h
           portal.c
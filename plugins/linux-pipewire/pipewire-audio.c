@@ -0,0 +1,474 @@
+/* pipewire-audio.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "pipewire-audio.h"
+
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/util_uint64.h>
+
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+
+/* The stream asks for float planar at the rate and layout OBS mixes at, so
+ * the PipeWire adapter does any conversion and buffers can be handed to
+ * obs_source_output_audio() as they are.  The node latency is a request
+ * for the graph quantum, which is what the buffers are sized to. */
+#define QUANTUM_FRAMES 256
+
+#if PW_CHECK_VERSION(0, 3, 64)
+#define TARGET_KEY PW_KEY_TARGET_OBJECT
+#else
+#define TARGET_KEY PW_KEY_NODE_TARGET
+#endif
+
+struct pw_audio_node {
+	uint32_t id;
+	char *name;
+	char *description;
+};
+
+struct pw_audio_source {
+	obs_source_t *source;
+	bool output;
+	char *target;
+
+	uint32_t sample_rate;
+	uint32_t channels;
+	enum speaker_layout speakers;
+
+	struct pw_thread_loop *thread_loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+	struct pw_stream *stream;
+	struct spa_hook stream_listener;
+
+	/* only touched with the thread loop locked */
+	DARRAY(struct pw_audio_node) nodes;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void set_channel_positions(struct spa_audio_info_raw *info,
+				  enum speaker_layout speakers)
+{
+	static const uint32_t positions[] = {
+		SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+		SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+		SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR,
+		SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR,
+	};
+
+	for (uint32_t i = 0; i < info->channels; i++)
+		info->position[i] = positions[i];
+
+	switch (speakers) {
+	case SPEAKERS_MONO:
+		info->position[0] = SPA_AUDIO_CHANNEL_MONO;
+		break;
+	case SPEAKERS_2POINT1:
+		info->position[2] = SPA_AUDIO_CHANNEL_LFE;
+		break;
+	case SPEAKERS_4POINT0:
+		info->position[3] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	case SPEAKERS_4POINT1:
+		info->position[4] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	default:
+		break;
+	}
+}
+
+static void on_process_cb(void *data)
+{
+	struct pw_audio_source *pwa = data;
+	struct obs_source_audio out = {0};
+	struct pw_buffer *b;
+	struct spa_buffer *buf;
+	uint32_t frames;
+
+	b = pw_stream_dequeue_buffer(pwa->stream);
+	if (!b)
+		return;
+
+	buf = b->buffer;
+	if (buf->n_datas < pwa->channels || !buf->datas[0].chunk)
+		goto queue;
+
+	frames = buf->datas[0].chunk->size / sizeof(float);
+	if (!frames)
+		goto queue;
+
+	for (uint32_t i = 0; i < pwa->channels; i++) {
+		struct spa_data *d = &buf->datas[i];
+		if (!d->data)
+			goto queue;
+
+		out.data[i] = SPA_PTROFF(d->data, d->chunk->offset, uint8_t);
+	}
+
+	out.frames = frames;
+	out.speakers = pwa->speakers;
+	out.format = AUDIO_FORMAT_FLOAT_PLANAR;
+	out.samples_per_sec = pwa->sample_rate;
+	out.timestamp = os_gettime_ns() -
+			util_mul_div64(frames, 1000000000ULL, pwa->sample_rate);
+
+	obs_source_output_audio(pwa->source, &out);
+
+queue:
+	pw_stream_queue_buffer(pwa->stream, b);
+}
+
+static void on_state_changed_cb(void *data, enum pw_stream_state old,
+				enum pw_stream_state state, const char *error)
+{
+	UNUSED_PARAMETER(old);
+	struct pw_audio_source *pwa = data;
+
+	blog(LOG_DEBUG, "[pipewire-audio] '%s' stream %p: %s",
+	     obs_source_get_name(pwa->source), pwa->stream,
+	     pw_stream_state_as_string(state));
+
+	if (state == PW_STREAM_STATE_ERROR)
+		blog(LOG_WARNING, "[pipewire-audio] '%s' stream error: %s",
+		     obs_source_get_name(pwa->source), error);
+}
+
+static const struct pw_stream_events stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.state_changed = on_state_changed_cb,
+	.process = on_process_cb,
+};
+
+/* called with the thread loop locked */
+static void destroy_stream(struct pw_audio_source *pwa)
+{
+	if (pwa->stream) {
+		spa_hook_remove(&pwa->stream_listener);
+		pw_stream_disconnect(pwa->stream);
+		pw_stream_destroy(pwa->stream);
+		pwa->stream = NULL;
+	}
+}
+
+/* called with the thread loop locked */
+static void create_stream(struct pw_audio_source *pwa)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod *params[1];
+	struct pw_properties *props;
+
+	destroy_stream(pwa);
+
+	props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio",
+				  PW_KEY_MEDIA_CATEGORY, "Capture",
+				  PW_KEY_MEDIA_ROLE, "Production", NULL);
+	pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", QUANTUM_FRAMES,
+			   pwa->sample_rate);
+	if (pwa->output)
+		pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+	if (pwa->target)
+		pw_properties_set(props, TARGET_KEY, pwa->target);
+
+	pwa->stream = pw_stream_new(pwa->core,
+				    obs_source_get_name(pwa->source), props);
+	if (!pwa->stream) {
+		blog(LOG_WARNING, "[pipewire-audio] Failed to create stream");
+		return;
+	}
+
+	pw_stream_add_listener(pwa->stream, &pwa->stream_listener,
+			       &stream_events, pwa);
+
+	struct spa_audio_info_raw info = SPA_AUDIO_INFO_RAW_INIT(
+		.format = SPA_AUDIO_FORMAT_F32P, .rate = pwa->sample_rate,
+		.channels = pwa->channels);
+	set_channel_positions(&info, pwa->speakers);
+	params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info);
+
+	pw_stream_connect(pwa->stream, PW_DIRECTION_INPUT, PW_ID_ANY,
+			  PW_STREAM_FLAG_AUTOCONNECT |
+				  PW_STREAM_FLAG_MAP_BUFFERS |
+				  PW_STREAM_FLAG_RT_PROCESS,
+			  params, 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void on_global_cb(void *data, uint32_t id, uint32_t permissions,
+			 const char *type, uint32_t version,
+			 const struct spa_dict *props)
+{
+	UNUSED_PARAMETER(permissions);
+	UNUSED_PARAMETER(version);
+	struct pw_audio_source *pwa = data;
+	const char *media_class;
+	const char *name;
+	const char *description;
+
+	if (!props || strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+		return;
+
+	media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+	if (!media_class ||
+	    strcmp(media_class, pwa->output ? "Audio/Sink" : "Audio/Source"))
+		return;
+
+	name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+	if (!name)
+		return;
+
+	description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+
+	struct pw_audio_node *node = da_push_back_new(pwa->nodes);
+	node->id = id;
+	node->name = bstrdup(name);
+	node->description = bstrdup(description ? description : name);
+}
+
+static void on_global_remove_cb(void *data, uint32_t id)
+{
+	struct pw_audio_source *pwa = data;
+
+	for (size_t i = 0; i < pwa->nodes.num; i++) {
+		struct pw_audio_node *node = &pwa->nodes.array[i];
+		if (node->id == id) {
+			bfree(node->name);
+			bfree(node->description);
+			da_erase(pwa->nodes, i);
+			break;
+		}
+	}
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = on_global_cb,
+	.global_remove = on_global_remove_cb,
+};
+
+static void pipewire_audio_teardown(struct pw_audio_source *pwa)
+{
+	if (pwa->thread_loop) {
+		pw_thread_loop_lock(pwa->thread_loop);
+		destroy_stream(pwa);
+		if (pwa->registry) {
+			spa_hook_remove(&pwa->registry_listener);
+			pw_proxy_destroy((struct pw_proxy *)pwa->registry);
+		}
+		if (pwa->core)
+			pw_core_disconnect(pwa->core);
+		pw_thread_loop_unlock(pwa->thread_loop);
+
+		pw_thread_loop_stop(pwa->thread_loop);
+	}
+
+	if (pwa->context)
+		pw_context_destroy(pwa->context);
+	if (pwa->thread_loop)
+		pw_thread_loop_destroy(pwa->thread_loop);
+
+	for (size_t i = 0; i < pwa->nodes.num; i++) {
+		bfree(pwa->nodes.array[i].name);
+		bfree(pwa->nodes.array[i].description);
+	}
+	da_free(pwa->nodes);
+}
+
+static bool pipewire_audio_connect(struct pw_audio_source *pwa)
+{
+	pwa->thread_loop = pw_thread_loop_new("PipeWire audio", NULL);
+	if (!pwa->thread_loop)
+		return false;
+
+	pwa->context = pw_context_new(pw_thread_loop_get_loop(pwa->thread_loop),
+				      NULL, 0);
+	if (!pwa->context)
+		return false;
+
+	if (pw_thread_loop_start(pwa->thread_loop) < 0) {
+		blog(LOG_WARNING,
+		     "[pipewire-audio] Error starting thread loop");
+		return false;
+	}
+
+	pw_thread_loop_lock(pwa->thread_loop);
+
+	pwa->core = pw_context_connect(pwa->context, NULL, 0);
+	if (!pwa->core) {
+		blog(LOG_WARNING, "[pipewire-audio] Error creating core: %m");
+		pw_thread_loop_unlock(pwa->thread_loop);
+		return false;
+	}
+
+	pwa->registry =
+		pw_core_get_registry(pwa->core, PW_VERSION_REGISTRY, 0);
+	pw_registry_add_listener(pwa->registry, &pwa->registry_listener,
+				 &registry_events, pwa);
+
+	create_stream(pwa);
+
+	pw_thread_loop_unlock(pwa->thread_loop);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *pipewire_audio_input_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return obs_module_text("PipeWireAudioInput");
+}
+
+static const char *pipewire_audio_output_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return obs_module_text("PipeWireAudioOutput");
+}
+
+static char *get_target(obs_data_t *settings)
+{
+	const char *id = obs_data_get_string(settings, "device_id");
+	return (!*id || strcmp(id, "default") == 0) ? NULL : bstrdup(id);
+}
+
+static void *pipewire_audio_create(obs_data_t *settings, obs_source_t *source,
+				   bool output)
+{
+	struct pw_audio_source *pwa = bzalloc(sizeof(*pwa));
+	struct obs_audio_info oai;
+
+	obs_get_audio_info(&oai);
+
+	pwa->source = source;
+	pwa->output = output;
+	pwa->target = get_target(settings);
+	pwa->sample_rate = oai.samples_per_sec;
+	pwa->speakers = oai.speakers;
+	pwa->channels = get_audio_channels(oai.speakers);
+
+	if (!pipewire_audio_connect(pwa))
+		blog(LOG_WARNING, "[pipewire-audio] Failed to connect '%s'",
+		     obs_source_get_name(source));
+
+	return pwa;
+}
+
+static void *pipewire_audio_input_create(obs_data_t *settings,
+					 obs_source_t *source)
+{
+	return pipewire_audio_create(settings, source, false);
+}
+
+static void *pipewire_audio_output_create(obs_data_t *settings,
+					  obs_source_t *source)
+{
+	return pipewire_audio_create(settings, source, true);
+}
+
+static void pipewire_audio_destroy(void *data)
+{
+	struct pw_audio_source *pwa = data;
+
+	pipewire_audio_teardown(pwa);
+	bfree(pwa->target);
+	bfree(pwa);
+}
+
+static void pipewire_audio_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_string(settings, "device_id", "default");
+}
+
+static obs_properties_t *pipewire_audio_properties(void *data)
+{
+	struct pw_audio_source *pwa = data;
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *devices;
+
+	devices = obs_properties_add_list(props, "device_id",
+					  obs_module_text("Device"),
+					  OBS_COMBO_TYPE_LIST,
+					  OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(devices, obs_module_text("Default"),
+				     "default");
+
+	if (pwa && pwa->thread_loop) {
+		pw_thread_loop_lock(pwa->thread_loop);
+		for (size_t i = 0; i < pwa->nodes.num; i++) {
+			struct pw_audio_node *node = &pwa->nodes.array[i];
+			obs_property_list_add_string(devices, node->description,
+						     node->name);
+		}
+		pw_thread_loop_unlock(pwa->thread_loop);
+	}
+
+	return props;
+}
+
+static void pipewire_audio_update(void *data, obs_data_t *settings)
+{
+	struct pw_audio_source *pwa = data;
+	char *target = get_target(settings);
+
+	if ((!target && !pwa->target) ||
+	    (target && pwa->target && strcmp(target, pwa->target) == 0)) {
+		bfree(target);
+		return;
+	}
+
+	bfree(pwa->target);
+	pwa->target = target;
+
+	if (pwa->core) {
+		pw_thread_loop_lock(pwa->thread_loop);
+		create_stream(pwa);
+		pw_thread_loop_unlock(pwa->thread_loop);
+	}
+}
+
+void pipewire_audio_load(void)
+{
+	struct obs_source_info input_info = {
+		.id = "pipewire_audio_input_capture",
+		.type = OBS_SOURCE_TYPE_INPUT,
+		.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE,
+		.get_name = pipewire_audio_input_get_name,
+		.create = pipewire_audio_input_create,
+		.destroy = pipewire_audio_destroy,
+		.get_defaults = pipewire_audio_defaults,
+		.get_properties = pipewire_audio_properties,
+		.update = pipewire_audio_update,
+		.icon_type = OBS_ICON_TYPE_AUDIO_INPUT,
+	};
+	obs_register_source(&input_info);
+
+	struct obs_source_info output_info = input_info;
+	output_info.id = "pipewire_audio_output_capture";
+	output_info.output_flags |= OBS_SOURCE_DO_NOT_SELF_MONITOR;
+	output_info.get_name = pipewire_audio_output_get_name;
+	output_info.create = pipewire_audio_output_create;
+	output_info.icon_type = OBS_ICON_TYPE_AUDIO_OUTPUT;
+	obs_register_source(&output_info);
+}
@@ -65,6 +65,8 @@ struct spa_meta_videotransform {
 	(sizeof(struct spa_meta_cursor) + sizeof(struct spa_meta_bitmap) + \
 	 width * height * 4)
 
+#define DAMAGE_META_SIZE(regions) (sizeof(struct spa_meta_region) * regions)
+
 struct obs_pw_version {
 	int major;
 	int minor;
@@ -100,6 +102,7 @@ struct _obs_pipewire_stream {
 	obs_source_t *source;
 
 	gs_texture_t *texture;
+	bool shm_texture;
 
 	struct pw_stream *stream;
 	struct spa_hook stream_listener;
@@ -717,6 +720,105 @@ done:
 	pw_stream_queue_buffer(obs_pw_stream->stream, b);
 }
 
+/* Buffers without damage metadata are treated as fully damaged */
+static bool buffer_has_damage(struct spa_meta *damage)
+{
+	struct spa_meta_region *region;
+
+	if (!damage)
+		return true;
+
+	/* the list of damaged regions ends at the first invalid one */
+	spa_meta_for_each(region, damage)
+	{
+		return spa_meta_region_is_valid(region);
+	}
+
+	return false;
+}
+
+static inline void copy_shm_rect(uint8_t *dst, uint32_t dst_linesize,
+				 const uint8_t *src, uint32_t src_linesize,
+				 uint32_t bpp, uint32_t x, uint32_t y,
+				 uint32_t width, uint32_t height)
+{
+	dst += y * dst_linesize + x * bpp;
+	src += y * src_linesize + x * bpp;
+
+	for (uint32_t row = 0; row < height; row++) {
+		memcpy(dst, src, width * bpp);
+		dst += dst_linesize;
+		src += src_linesize;
+	}
+}
+
+/* The texture's upload buffer keeps the previous frame, so only the damaged
+ * regions have to be copied into it */
+static void update_shm_texture(obs_pipewire_stream *obs_pw_stream,
+			       struct spa_buffer *buffer,
+			       struct spa_meta *damage, uint32_t bpp)
+{
+	const uint32_t width = obs_pw_stream->format.info.raw.size.width;
+	const uint32_t height = obs_pw_stream->format.info.raw.size.height;
+	const uint8_t *src = buffer->datas[0].data;
+	struct spa_meta_region *region;
+	uint32_t src_linesize;
+	uint32_t linesize;
+	uint8_t *ptr;
+
+	src_linesize = buffer->datas[0].chunk->stride;
+	if (src_linesize == 0)
+		src_linesize = SPA_ROUND_UP_N(width * bpp, 4);
+
+	if (!gs_texture_map(obs_pw_stream->texture, &ptr, &linesize))
+		return;
+
+	if (!damage) {
+		copy_shm_rect(ptr, linesize, src, src_linesize, bpp, 0, 0,
+			      width, height);
+		gs_texture_unmap(obs_pw_stream->texture);
+		return;
+	}
+
+	spa_meta_for_each(region, damage)
+	{
+		if (!spa_meta_region_is_valid(region))
+			break;
+
+		const struct spa_region *rect = &region->region;
+		int64_t x = SPA_MAX(rect->position.x, 0);
+		int64_t y = SPA_MAX(rect->position.y, 0);
+		int64_t x2 = SPA_MIN((int64_t)rect->position.x +
+					     rect->size.width,
+				     (int64_t)width);
+		int64_t y2 = SPA_MIN((int64_t)rect->position.y +
+					     rect->size.height,
+				     (int64_t)height);
+
+		if (x >= x2 || y >= y2)
+			continue;
+
+		copy_shm_rect(ptr, linesize, src, src_linesize, bpp,
+			      (uint32_t)x, (uint32_t)y, (uint32_t)(x2 - x),
+			      (uint32_t)(y2 - y));
+	}
+
+	gs_texture_unmap(obs_pw_stream->texture);
+}
+
+static bool can_update_shm_texture(obs_pipewire_stream *obs_pw_stream,
+				   enum gs_color_format format)
+{
+	gs_texture_t *texture = obs_pw_stream->texture;
+
+	return texture && obs_pw_stream->shm_texture &&
+	       gs_texture_get_width(texture) ==
+		       obs_pw_stream->format.info.raw.size.width &&
+	       gs_texture_get_height(texture) ==
+		       obs_pw_stream->format.info.raw.size.height &&
+	       gs_texture_get_color_format(texture) == format;
+}
+
 static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 {
 	obs_pipewire *obs_pw = obs_pw_stream->obs_pw;
@@ -724,10 +826,14 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 	struct spa_meta_header *header;
 	struct spa_meta_region *region;
 	struct spa_meta_videotransform *video_transform;
+	enum spa_meta_videotransform_value transform;
 	struct obs_pw_video_format obs_pw_video_format;
+	struct spa_meta *damage;
 	struct spa_buffer *buffer;
 	struct pw_buffer *b;
 	bool has_buffer = true;
+	bool cursor_valid;
+	bool changed = false;
 
 	b = find_latest_buffer(obs_pw_stream->stream);
 	if (!b) {
@@ -753,6 +859,11 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 	if (!has_buffer)
 		goto read_metadata;
 
+	/* Nothing changed, keep showing the current texture */
+	damage = spa_buffer_find_meta(buffer, SPA_META_VideoDamage);
+	if (obs_pw_stream->texture && !buffer_has_damage(damage))
+		goto read_metadata;
+
 	if (buffer->datas[0].type == SPA_DATA_DmaBuf) {
 		uint32_t planes = buffer->n_datas;
 		uint32_t *offsets = alloca(sizeof(uint32_t) * planes);
@@ -807,6 +918,9 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 			obs_pw_video_format.drm_format, GS_BGRX, planes, fds,
 			strides, offsets, use_modifiers ? modifiers : NULL);
 
+		obs_pw_stream->shm_texture = false;
+		changed = true;
+
 		if (obs_pw_stream->texture == NULL) {
 			remove_modifier_from_format(
 				obs_pw_stream,
@@ -843,12 +957,24 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 			goto read_metadata;
 		}
 
-		g_clear_pointer(&obs_pw_stream->texture, gs_texture_destroy);
-		obs_pw_stream->texture = gs_texture_create(
-			obs_pw_stream->format.info.raw.size.width,
-			obs_pw_stream->format.info.raw.size.height,
-			obs_pw_video_format.gs_format, 1,
-			(const uint8_t **)&buffer->datas[0].data, GS_DYNAMIC);
+		/* a new texture's upload buffer has to be filled completely */
+		if (!can_update_shm_texture(obs_pw_stream,
+					    obs_pw_video_format.gs_format)) {
+			g_clear_pointer(&obs_pw_stream->texture,
+					gs_texture_destroy);
+			obs_pw_stream->texture = gs_texture_create(
+				obs_pw_stream->format.info.raw.size.width,
+				obs_pw_stream->format.info.raw.size.height,
+				obs_pw_video_format.gs_format, 1, NULL,
+				GS_DYNAMIC);
+			obs_pw_stream->shm_texture = true;
+			damage = NULL;
+		}
+
+		if (obs_pw_stream->texture)
+			update_shm_texture(obs_pw_stream, buffer, damage,
+					   obs_pw_video_format.bpp);
+		changed = true;
 	}
 
 	if (obs_pw_video_format.swap_red_blue)
@@ -865,30 +991,41 @@ static void process_video_sync(obs_pipewire_stream *obs_pw_stream)
 		     region->region.size.width, region->region.size.height);
 #endif
 
+		changed |= !obs_pw_stream->crop.valid ||
+			   obs_pw_stream->crop.x != region->region.position.x ||
+			   obs_pw_stream->crop.y != region->region.position.y ||
+			   obs_pw_stream->crop.width !=
+				   region->region.size.width ||
+			   obs_pw_stream->crop.height !=
+				   region->region.size.height;
+
 		obs_pw_stream->crop.x = region->region.position.x;
 		obs_pw_stream->crop.y = region->region.position.y;
 		obs_pw_stream->crop.width = region->region.size.width;
 		obs_pw_stream->crop.height = region->region.size.height;
 		obs_pw_stream->crop.valid = true;
 	} else {
+		changed |= obs_pw_stream->crop.valid;
 		obs_pw_stream->crop.valid = false;
 	}
 
 	/* Video Transform */
 	video_transform = spa_buffer_find_meta_data(
 		buffer, SPA_META_VideoTransform, sizeof(*video_transform));
-	if (video_transform)
-		obs_pw_stream->transform = video_transform->transform;
-	else
-		obs_pw_stream->transform = SPA_META_TRANSFORMATION_None;
+	transform = video_transform ? video_transform->transform
+				    : SPA_META_TRANSFORMATION_None;
+	changed |= obs_pw_stream->transform != transform;
+	obs_pw_stream->transform = transform;
 
 read_metadata:
 
 	/* Cursor */
 	cursor = spa_buffer_find_meta_data(buffer, SPA_META_Cursor,
 					   sizeof(*cursor));
-	obs_pw_stream->cursor.valid = cursor &&
-				      spa_meta_cursor_is_valid(cursor);
+	cursor_valid = cursor && spa_meta_cursor_is_valid(cursor);
+	changed |= obs_pw_stream->cursor.visible &&
+		   obs_pw_stream->cursor.valid != cursor_valid;
+	obs_pw_stream->cursor.valid = cursor_valid;
 	if (obs_pw_stream->cursor.visible && obs_pw_stream->cursor.valid) {
 		struct spa_meta_bitmap *bitmap = NULL;
 
@@ -896,9 +1033,11 @@ read_metadata:
 			bitmap = SPA_MEMBER(cursor, cursor->bitmap_offset,
 					    struct spa_meta_bitmap);
 
-		if (bitmap)
+		if (bitmap) {
 			g_clear_pointer(&obs_pw_stream->cursor.texture,
 					gs_texture_destroy);
+			changed = true;
+		}
 
 		if (bitmap && bitmap->size.width > 0 &&
 		    bitmap->size.height > 0 &&
@@ -926,6 +1065,8 @@ read_metadata:
 					obs_pw_stream->cursor.texture);
 		}
 
+		changed |= obs_pw_stream->cursor.x != cursor->position.x ||
+			   obs_pw_stream->cursor.y != cursor->position.y;
 		obs_pw_stream->cursor.x = cursor->position.x;
 		obs_pw_stream->cursor.y = cursor->position.y;
 	}
@@ -933,6 +1074,9 @@ read_metadata:
 	pw_stream_queue_buffer(obs_pw_stream->stream, b);
 
 	obs_leave_graphics();
+
+	if (changed)
+		obs_source_mark_video_dirty(obs_pw_stream->source);
 }
 
 static void on_process_cb(void *user_data)
@@ -956,7 +1100,7 @@ static void on_param_changed_cb(void *user_data, uint32_t id,
 	obs_pipewire_stream *obs_pw_stream = user_data;
 	obs_pipewire *obs_pw = obs_pw_stream->obs_pw;
 	struct spa_pod_builder pod_builder;
-	const struct spa_pod *params[5];
+	const struct spa_pod *params[6];
 	const char *format_name;
 	uint32_t n_params = 0;
 	uint32_t buffer_types;
@@ -1028,6 +1172,15 @@ static void on_param_changed_cb(void *user_data, uint32_t id,
 					 CURSOR_META_SIZE(1, 1),
 					 CURSOR_META_SIZE(1024, 1024)));
 
+	/* Video damage */
+	params[n_params++] = spa_pod_builder_add_object(
+		&pod_builder, SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+		SPA_PARAM_META_type, SPA_POD_Id(SPA_META_VideoDamage),
+		SPA_PARAM_META_size,
+		SPA_POD_CHOICE_RANGE_Int(DAMAGE_META_SIZE(16),
+					 DAMAGE_META_SIZE(1),
+					 DAMAGE_META_SIZE(16)));
+
 	/* Buffer options */
 	params[n_params++] = spa_pod_builder_add_object(
 		&pod_builder, SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
@@ -1410,6 +1563,8 @@ void obs_pipewire_stream_video_render(obs_pipewire_stream *obs_pw_stream,
 void obs_pipewire_stream_set_cursor_visible(obs_pipewire_stream *obs_pw_stream,
 					    bool cursor_visible)
 {
+	if (obs_pw_stream->cursor.visible != cursor_visible)
+		obs_source_mark_video_dirty(obs_pw_stream->source);
 	obs_pw_stream->cursor.visible = cursor_visible;
 }
 
@@ -1431,6 +1586,8 @@ void obs_pipewire_stream_destroy(obs_pipewire_stream *obs_pw_stream)
 	g_clear_pointer(&obs_pw_stream->texture, gs_texture_destroy);
 	obs_leave_graphics();
 
+	obs_source_mark_video_dirty(obs_pw_stream->source);
+
 	pw_thread_loop_lock(obs_pw_stream->obs_pw->thread_loop);
 	if (obs_pw_stream->stream)
 		pw_stream_disconnect(obs_pw_stream->stream);
@@ -10,13 +10,14 @@ option(ENABLE_UDEV "Build linux-v4l2 with UDEV support" ON)
 
 find_package(Libv4l2 REQUIRED)
 find_package(FFmpeg REQUIRED COMPONENTS avcodec avutil avformat)
+find_package(Libdrm REQUIRED) # we require libdrm/drm_fourcc.h to build
 
 add_library(linux-v4l2 MODULE)
 add_library(OBS::v4l2 ALIAS linux-v4l2)
 
 target_sources(linux-v4l2 PRIVATE linux-v4l2.c v4l2-controls.c v4l2-input.c v4l2-helpers.c v4l2-output.c v4l2-decoder.c)
 
-target_link_libraries(linux-v4l2 PRIVATE OBS::libobs LIB4L2::LIB4L2 FFmpeg::avcodec FFmpeg::avformat FFmpeg::avutil)
+target_link_libraries(linux-v4l2 PRIVATE OBS::libobs LIB4L2::LIB4L2 FFmpeg::avcodec FFmpeg::avformat FFmpeg::avutil Libdrm::Libdrm)
 
 set_target_properties(linux-v4l2 PROPERTIES FOLDER "plugins")
 
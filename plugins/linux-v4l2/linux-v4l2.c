@@ -25,12 +25,14 @@ MODULE_EXPORT const char *obs_module_description(void)
 }
 
 extern struct obs_source_info v4l2_input;
+extern struct obs_source_info v4l2_dmabuf_input;
 extern struct obs_output_info virtualcam_info;
 extern bool loopback_module_available();
 
 bool obs_module_load(void)
 {
 	obs_register_source(&v4l2_input);
+	obs_register_source(&v4l2_dmabuf_input);
 
 	if (loopback_module_available()) {
 		obs_register_output(&virtualcam_info);
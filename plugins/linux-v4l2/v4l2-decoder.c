@@ -23,7 +23,40 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define blog(level, msg, ...) \
 	blog(level, "v4l2-input: decoder: " msg, ##__VA_ARGS__)
 
-int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt)
+static enum AVPixelFormat get_hw_format(AVCodecContext *ctx,
+					const enum AVPixelFormat *fmts)
+{
+	for (const enum AVPixelFormat *fmt = fmts; *fmt != AV_PIX_FMT_NONE;
+	     fmt++) {
+		if (*fmt == AV_PIX_FMT_VAAPI)
+			return *fmt;
+	}
+
+	blog(LOG_WARNING, "VA-API not available for this stream, "
+			  "falling back to software decoding");
+	return avcodec_default_get_format(ctx, fmts);
+}
+
+static void init_hw_decoder(struct v4l2_decoder *decoder)
+{
+	if (av_hwdevice_ctx_create(&decoder->hw_device,
+				   AV_HWDEVICE_TYPE_VAAPI, NULL, NULL,
+				   0) < 0) {
+		blog(LOG_WARNING, "failed to open VA-API device, "
+				  "falling back to software decoding");
+		decoder->hw_device = NULL;
+		return;
+	}
+
+	decoder->sw_frame = av_frame_alloc();
+	decoder->context->hw_device_ctx = av_buffer_ref(decoder->hw_device);
+	decoder->context->get_format = get_hw_format;
+
+	blog(LOG_INFO, "using VA-API hardware decoding");
+}
+
+int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt,
+		      bool hw_decode)
 {
 	if (pixfmt == V4L2_PIX_FMT_MJPEG) {
 		decoder->codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
@@ -56,6 +89,9 @@ int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt)
 
 	decoder->context->flags2 |= AV_CODEC_FLAG2_FAST;
 
+	if (hw_decode)
+		init_hw_decoder(decoder);
+
 	if (avcodec_open2(decoder->context, decoder->codec, NULL) < 0) {
 		blog(LOG_ERROR, "failed to open codec");
 		return -1;
@@ -73,6 +109,10 @@ void v4l2_destroy_decoder(struct v4l2_decoder *decoder)
 		av_frame_free(&decoder->frame);
 	}
 
+	if (decoder->sw_frame) {
+		av_frame_free(&decoder->sw_frame);
+	}
+
 	if (decoder->packet) {
 		av_packet_free(&decoder->packet);
 	}
@@ -83,6 +123,10 @@ void v4l2_destroy_decoder(struct v4l2_decoder *decoder)
 #endif
 		avcodec_free_context(&decoder->context);
 	}
+
+	if (decoder->hw_device) {
+		av_buffer_unref(&decoder->hw_device);
+	}
 }
 
 int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data,
@@ -100,12 +144,22 @@ int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data,
 		return -1;
 	}
 
+	AVFrame *frame = decoder->frame;
+	if (frame->format == AV_PIX_FMT_VAAPI) {
+		av_frame_unref(decoder->sw_frame);
+		if (av_hwframe_transfer_data(decoder->sw_frame, frame, 0) < 0) {
+			blog(LOG_ERROR, "failed to download decoded frame");
+			return -1;
+		}
+		frame = decoder->sw_frame;
+	}
+
 	for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i) {
-		out->data[i] = decoder->frame->data[i];
-		out->linesize[i] = decoder->frame->linesize[i];
+		out->data[i] = frame->data[i];
+		out->linesize[i] = frame->linesize[i];
 	}
 
-	switch (decoder->context->pix_fmt) {
+	switch (frame->format) {
 	case AV_PIX_FMT_GRAY8:
 		out->format = VIDEO_FORMAT_Y800;
 		break;
@@ -121,6 +175,12 @@ int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data,
 	case AV_PIX_FMT_YUV444P:
 		out->format = VIDEO_FORMAT_I444;
 		break;
+	case AV_PIX_FMT_NV12:
+		out->format = VIDEO_FORMAT_NV12;
+		break;
+	case AV_PIX_FMT_YUYV422:
+		out->format = VIDEO_FORMAT_YUY2;
+		break;
 	default:
 		break;
 	}
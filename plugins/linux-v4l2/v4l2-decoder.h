@@ -24,6 +24,8 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/pixfmt.h>
+#include <libavutil/hwcontext.h>
+#include <stdbool.h>
 
 /**
  * Data structure for decoder
@@ -33,17 +35,26 @@ struct v4l2_decoder {
 	AVCodecContext *context;
 	AVPacket *packet;
 	AVFrame *frame;
+	/** VA-API device, NULL when decoding in software */
+	AVBufferRef *hw_device;
+	/** system memory copy of hardware decoded frames */
+	AVFrame *sw_frame;
 };
 
 /**
  * Initialize the decoder.
  * The decoder must be destroyed on failure.
  *
+ * If hardware decoding is requested but no VA-API device can be opened, the
+ * decoder silently falls back to software decoding.
+ *
  * @param decoder the decoder structure
  * @param pixfmt which codec is used
+ * @param hw_decode try to decode with VA-API
  * @return non-zero on failure
  */
-int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt);
+int v4l2_init_decoder(struct v4l2_decoder *decoder, int pixfmt,
+		      bool hw_decode);
 
 /**
  * Free any data associated with the decoder.
@@ -16,6 +16,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <util/bmem.h>
 
@@ -122,6 +124,8 @@ int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
 
 	buf->count = req.count;
 	buf->info = bzalloc(req.count * sizeof(struct v4l2_mmap_info));
+	for (uint_fast32_t i = 0; i < req.count; ++i)
+		buf->info[i].fd = -1;
 
 	memset(&map, 0, sizeof(map));
 	map.type = req.type;
@@ -147,9 +151,44 @@ int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
 	return 0;
 }
 
+int_fast32_t v4l2_export_dmabuf(int_fast32_t dev, struct v4l2_buffer_data *buf)
+{
+	struct v4l2_exportbuffer expbuf;
+
+	for (uint_fast32_t i = 0; i < buf->count; ++i) {
+		memset(&expbuf, 0, sizeof(expbuf));
+		expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		expbuf.index = i;
+		expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+		if (v4l2_ioctl(dev, VIDIOC_EXPBUF, &expbuf) < 0) {
+			blog(LOG_ERROR, "Failed to export buffer as dma-buf");
+			return -1;
+		}
+
+		buf->info[i].fd = expbuf.fd;
+	}
+
+	return 0;
+}
+
+int_fast32_t v4l2_queue_buffer(int_fast32_t dev, uint32_t index)
+{
+	struct v4l2_buffer enq;
+
+	memset(&enq, 0, sizeof(enq));
+	enq.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	enq.memory = V4L2_MEMORY_MMAP;
+	enq.index = index;
+
+	return v4l2_ioctl(dev, VIDIOC_QBUF, &enq);
+}
+
 int_fast32_t v4l2_destroy_mmap(struct v4l2_buffer_data *buf)
 {
 	for (uint_fast32_t i = 0; i < buf->count; ++i) {
+		if (buf->info[i].fd != -1)
+			close(buf->info[i].fd);
 		if (buf->info[i].start != MAP_FAILED && buf->info[i].start != 0)
 			v4l2_munmap(buf->info[i].start, buf->info[i].length);
 	}
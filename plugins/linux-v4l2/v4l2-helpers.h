@@ -38,6 +38,8 @@ struct v4l2_mmap_info {
 	size_t length;
 	/** start address of the mapped buffer */
 	void *start;
+	/** exported dma-buf file descriptor, -1 if not exported */
+	int fd;
 };
 
 /**
@@ -233,9 +235,34 @@ int_fast32_t v4l2_query_all_buffers(int_fast32_t dev,
  */
 int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf);
 
+/**
+ * Export the mapped buffers as dma-bufs
+ *
+ * The file descriptors are stored with the buffer info and are closed when
+ * the memory mapping is destroyed.
+ *
+ * @param dev handle for the v4l2 device
+ * @param buf buffer data
+ *
+ * @return negative on failure
+ */
+int_fast32_t v4l2_export_dmabuf(int_fast32_t dev, struct v4l2_buffer_data *buf);
+
+/**
+ * Queue a single buffer back to the device
+ *
+ * @param dev handle for the v4l2 device
+ * @param index index of the buffer
+ *
+ * @return negative on failure
+ */
+int_fast32_t v4l2_queue_buffer(int_fast32_t dev, uint32_t index);
+
 /**
  * Destroy the memory mapping for buffers
  *
+ * This also closes the exported dma-buf file descriptors.
+ *
  * @param buf buffer data
  *
  * @return negative on failure
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <linux/videodev2.h>
 #include <libv4l2.h>
+#include <libdrm/drm_fourcc.h>
 
 #include <util/threading.h>
 #include <util/bmem.h>
@@ -78,6 +79,7 @@ struct v4l2_data {
 	int64_t resolution;
 	int64_t framerate;
 	int color_range;
+	bool hw_decode;
 
 	/* internal data */
 	obs_source_t *source;
@@ -95,8 +97,71 @@ struct v4l2_data {
 
 	bool auto_reset;
 	int timeout_frames;
+
+	/* dma-buf import, see v4l2_dmabuf_input */
+	bool dmabuf;
+	pthread_mutex_t dmabuf_mutex;
+	gs_effect_t *dmabuf_effect;
+	gs_texture_t **textures;
+	int pending_buf;
+	int current_buf;
+};
+
+/**
+ * Data structure for the dma-buf import of a pixel format
+ */
+struct v4l2_dmabuf_format {
+	/** fourcc the buffer is imported as */
+	uint32_t drm_format;
+	enum gs_color_format gs_format;
+	/** horizontal pixels per texel, 2 for packed 4:2:2 */
+	int texel_width;
+	/** technique of the import effect, NULL for the default effect */
+	const char *technique;
 };
 
+/**
+ * Get the dma-buf import parameters for a v4l2 pixel format
+ *
+ * Packed 4:2:2 formats are imported as half width BGRA textures and
+ * converted to RGB in v4l2-dmabuf.effect, the same way libobs uploads them.
+ * Planar formats are not supported.
+ *
+ * @return false if the format can not be imported
+ */
+static bool v4l2_to_dmabuf_format(uint_fast32_t format,
+				  struct v4l2_dmabuf_format *out)
+{
+	switch (format) {
+	case V4L2_PIX_FMT_YUYV:
+		*out = (struct v4l2_dmabuf_format){DRM_FORMAT_ARGB8888,
+						   GS_BGRA, 2, "YUYV"};
+		return true;
+	case V4L2_PIX_FMT_YVYU:
+		*out = (struct v4l2_dmabuf_format){DRM_FORMAT_ARGB8888,
+						   GS_BGRA, 2, "YVYU"};
+		return true;
+	case V4L2_PIX_FMT_UYVY:
+		*out = (struct v4l2_dmabuf_format){DRM_FORMAT_ARGB8888,
+						   GS_BGRA, 2, "UYVY"};
+		return true;
+#ifdef V4L2_PIX_FMT_XBGR32
+	case V4L2_PIX_FMT_XBGR32:
+		*out = (struct v4l2_dmabuf_format){DRM_FORMAT_XRGB8888,
+						   GS_BGRX, 1, NULL};
+		return true;
+#endif
+#ifdef V4L2_PIX_FMT_ABGR32
+	case V4L2_PIX_FMT_ABGR32:
+		*out = (struct v4l2_dmabuf_format){DRM_FORMAT_ARGB8888,
+						   GS_BGRA, 1, NULL};
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
 /* forward declarations */
 static void v4l2_init(struct v4l2_data *data);
 static void v4l2_terminate(struct v4l2_data *data);
@@ -161,6 +226,42 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+/**
+ * Forget about the buffers held for rendering
+ *
+ * Must be called whenever the capture is (re)started, since starting the
+ * capture queues all buffers.
+ */
+static void v4l2_dmabuf_reset(struct v4l2_data *data)
+{
+	if (!data->dmabuf)
+		return;
+
+	pthread_mutex_lock(&data->dmabuf_mutex);
+	data->pending_buf = -1;
+	data->current_buf = -1;
+	pthread_mutex_unlock(&data->dmabuf_mutex);
+}
+
+/**
+ * Hand a dequeued buffer over to the render callback
+ *
+ * A buffer that was dequeued but not rendered yet is dropped and queued
+ * again, so at most two buffers are held: the one currently displayed and
+ * the newest one.
+ */
+static void v4l2_dmabuf_present(struct v4l2_data *data, uint32_t index)
+{
+	pthread_mutex_lock(&data->dmabuf_mutex);
+	int dropped = data->pending_buf;
+	data->pending_buf = (int)index;
+	pthread_mutex_unlock(&data->dmabuf_mutex);
+
+	if (dropped != -1 && v4l2_queue_buffer(data->dev, dropped) < 0)
+		blog(LOG_ERROR, "%s: failed to enqueue buffer",
+		     data->device_id);
+}
+
 /*
  * Worker thread to get video data
  */
@@ -201,6 +302,7 @@ static void *v4l2_thread(void *vptr)
 	frames = 0;
 	first_ts = 0;
 	v4l2_prep_obs_frame(data, &out, plane_offsets);
+	v4l2_dmabuf_reset(data);
 
 	blog(LOG_DEBUG, "%s: obs frame prepared", data->device_id);
 
@@ -232,6 +334,7 @@ static void *v4l2_thread(void *vptr)
 			}
 
 			if (data->auto_reset) {
+				v4l2_dmabuf_reset(data);
 				if (v4l2_reset_capture(data->dev,
 						       &data->buffers) == 0)
 					blog(LOG_INFO,
@@ -264,6 +367,12 @@ static void *v4l2_thread(void *vptr)
 		     data->device_id, buf.timestamp.tv_usec, buf.index,
 		     buf.flags, buf.sequence, buf.length, buf.bytesused);
 
+		if (data->dmabuf) {
+			v4l2_dmabuf_present(data, buf.index);
+			frames++;
+			continue;
+		}
+
 		out.timestamp = timeval2ns(buf.timestamp);
 		if (!frames)
 			first_ts = out.timestamp;
@@ -308,6 +417,12 @@ static const char *v4l2_getname(void *unused)
 	return obs_module_text("V4L2Input");
 }
 
+static const char *v4l2_dmabuf_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("V4L2InputDMABuf");
+}
+
 static void v4l2_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_int(settings, "input", -1);
@@ -320,6 +435,7 @@ static void v4l2_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "buffering", true);
 	obs_data_set_default_bool(settings, "auto_reset", false);
 	obs_data_set_default_int(settings, "timeout_frames", 5);
+	obs_data_set_default_bool(settings, "hw_decode", false);
 }
 
 /**
@@ -450,6 +566,20 @@ static void v4l2_device_list(obs_property_t *prop, obs_data_t *settings)
 	dstr_free(&device);
 }
 
+/*
+ * Populate the device list, probing every device can take a while so the
+ * frontend may call this from a worker thread
+ */
+static void v4l2_device_list_populate(void *vptr, obs_property_t *prop)
+{
+	V4L2_DATA(vptr);
+
+	obs_data_t *settings = data ? obs_source_get_settings(data->source)
+				    : NULL;
+	v4l2_device_list(prop, settings);
+	obs_data_release(settings);
+}
+
 /*
  * List inputs for device
  */
@@ -471,8 +601,9 @@ static void v4l2_input_list(int_fast32_t dev, obs_property_t *prop)
 /*
  * List formats for device
  */
-static void v4l2_format_list(int dev, obs_property_t *prop)
+static void v4l2_format_list(int dev, obs_property_t *prop, bool dmabuf)
 {
+	struct v4l2_dmabuf_format dmabuf_format;
 	struct v4l2_fmtdesc fmt;
 	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	fmt.index = 0;
@@ -486,10 +617,22 @@ static void v4l2_format_list(int dev, obs_property_t *prop)
 		if (fmt.flags & V4L2_FMT_FLAG_EMULATED)
 			dstr_cat(&buffer, " (Emulated)");
 
-		if (v4l2_to_obs_video_format(fmt.pixelformat) !=
-			    VIDEO_FORMAT_NONE ||
-		    fmt.pixelformat == V4L2_PIX_FMT_MJPEG ||
-		    fmt.pixelformat == V4L2_PIX_FMT_H264) {
+		bool available;
+		if (dmabuf) {
+			/* emulated formats are converted by libv4l2 into
+			 * its own memory, they can't be exported */
+			available = !(fmt.flags & V4L2_FMT_FLAG_EMULATED) &&
+				    v4l2_to_dmabuf_format(fmt.pixelformat,
+							  &dmabuf_format);
+		} else {
+			available = v4l2_to_obs_video_format(
+					    fmt.pixelformat) !=
+					    VIDEO_FORMAT_NONE ||
+				    fmt.pixelformat == V4L2_PIX_FMT_MJPEG ||
+				    fmt.pixelformat == V4L2_PIX_FMT_H264;
+		}
+
+		if (available) {
 			obs_property_list_add_int(prop, buffer.array,
 						  fmt.pixelformat);
 			blog(LOG_INFO, "Pixelformat: %s (available)",
@@ -699,13 +842,14 @@ static bool input_selected(obs_properties_t *props, obs_property_t *p,
 			   obs_data_t *settings)
 {
 	UNUSED_PARAMETER(p);
+	struct v4l2_data *data = obs_properties_get_param(props);
 	int dev = v4l2_open(obs_data_get_string(settings, "device_id"),
 			    O_RDWR | O_NONBLOCK);
 	if (dev == -1)
 		return false;
 
 	obs_property_t *prop = obs_properties_get(props, "pixelformat");
-	v4l2_format_list(dev, prop);
+	v4l2_format_list(dev, prop, data && data->dmabuf);
 	v4l2_close(dev);
 
 	obs_property_modified(prop, settings);
@@ -842,6 +986,7 @@ static obs_properties_t *v4l2_properties(void *vptr)
 	V4L2_DATA(vptr);
 
 	obs_properties_t *props = obs_properties_create();
+	obs_properties_set_param(props, data, NULL);
 
 	obs_property_t *device_list = obs_properties_add_list(
 		props, "device_id", obs_module_text("Device"),
@@ -886,8 +1031,12 @@ static obs_properties_t *v4l2_properties(void *vptr)
 				  obs_module_text("ColorRange.Full"),
 				  VIDEO_RANGE_FULL);
 
-	obs_properties_add_bool(props, "buffering",
-				obs_module_text("UseBuffering"));
+	if (!data->dmabuf) {
+		obs_properties_add_bool(props, "buffering",
+					obs_module_text("UseBuffering"));
+		obs_properties_add_bool(props, "hw_decode",
+					obs_module_text("HardwareDecode"));
+	}
 
 	obs_properties_add_bool(props, "auto_reset",
 				obs_module_text("AutoresetOnTimeout"));
@@ -902,9 +1051,8 @@ static obs_properties_t *v4l2_properties(void *vptr)
 				 obs_module_text("CameraCtrls"),
 				 OBS_GROUP_NORMAL, ctrl_props);
 
-	obs_data_t *settings = obs_source_get_settings(data->source);
-	v4l2_device_list(device_list, settings);
-	obs_data_release(settings);
+	obs_property_list_set_populate_callback(device_list,
+						v4l2_device_list_populate);
 
 	obs_property_set_modified_callback(device_list, device_selected);
 	obs_property_set_modified_callback(input_list, input_selected);
@@ -928,6 +1076,21 @@ static void v4l2_terminate(struct v4l2_data *data)
 	    data->pixfmt == V4L2_PIX_FMT_H264) {
 		v4l2_destroy_decoder(&data->decoder);
 	}
+
+	if (data->textures) {
+		/* the render callback locks the mutex inside the graphics
+		 * context, so the graphics context has to be entered first */
+		obs_enter_graphics();
+		pthread_mutex_lock(&data->dmabuf_mutex);
+		for (uint_fast32_t i = 0; i < data->buffers.count; ++i)
+			gs_texture_destroy(data->textures[i]);
+		bfree(data->textures);
+		data->textures = NULL;
+		data->pending_buf = -1;
+		data->current_buf = -1;
+		pthread_mutex_unlock(&data->dmabuf_mutex);
+		obs_leave_graphics();
+	}
 	v4l2_destroy_mmap(&data->buffers);
 
 	if (data->dev != -1) {
@@ -957,6 +1120,13 @@ static void v4l2_destroy(void *vptr)
 	v4l2_unref_udev();
 #endif
 
+	if (data->dmabuf) {
+		obs_enter_graphics();
+		gs_effect_destroy(data->dmabuf_effect);
+		obs_leave_graphics();
+		pthread_mutex_destroy(&data->dmabuf_mutex);
+	}
+
 	bfree(data);
 }
 
@@ -972,6 +1142,7 @@ static void v4l2_destroy(void *vptr)
  */
 static void v4l2_init(struct v4l2_data *data)
 {
+	struct v4l2_dmabuf_format dmabuf_format;
 	uint32_t input_caps;
 	int fps_num, fps_denom;
 
@@ -1024,6 +1195,12 @@ static void v4l2_init(struct v4l2_data *data)
 		blog(LOG_ERROR, "Selected video format not supported");
 		goto fail;
 	}
+	if (data->dmabuf &&
+	    !v4l2_to_dmabuf_format(data->pixfmt, &dmabuf_format)) {
+		blog(LOG_ERROR, "Selected video format can't be imported as "
+				"dma-buf");
+		goto fail;
+	}
 	v4l2_unpack_tuple(&data->width, &data->height, data->resolution);
 	blog(LOG_INFO, "Resolution: %dx%d", data->width, data->height);
 	blog(LOG_INFO, "Pixelformat: %s", V4L2_FOURCC_STR(data->pixfmt));
@@ -1048,9 +1225,19 @@ static void v4l2_init(struct v4l2_data *data)
 		goto fail;
 	}
 
+	if (data->dmabuf) {
+		if (v4l2_export_dmabuf(data->dev, &data->buffers) < 0) {
+			blog(LOG_ERROR, "Failed to export buffers");
+			goto fail;
+		}
+		data->textures = bzalloc(data->buffers.count *
+					 sizeof(gs_texture_t *));
+	}
+
 	if (data->pixfmt == V4L2_PIX_FMT_MJPEG ||
 	    data->pixfmt == V4L2_PIX_FMT_H264) {
-		if (v4l2_init_decoder(&data->decoder, data->pixfmt) < 0) {
+		if (v4l2_init_decoder(&data->decoder, data->pixfmt,
+				      data->hw_decode) < 0) {
 			blog(LOG_ERROR, "Failed to initialize decoder");
 			goto fail;
 		}
@@ -1071,6 +1258,9 @@ fail:
 static void v4l2_update_source_flags(struct v4l2_data *data,
 				     obs_data_t *settings)
 {
+	if (data->dmabuf)
+		return;
+
 	obs_source_set_async_unbuffered(
 		data->source, !obs_data_get_bool(settings, "buffering"));
 }
@@ -1124,6 +1314,8 @@ static bool v4l2_settings_changed(struct v4l2_data *data, obs_data_t *settings)
 
 		res |= data->color_range !=
 		       obs_data_get_int(settings, "color_range");
+		res |= data->hw_decode !=
+		       obs_data_get_bool(settings, "hw_decode");
 	} else {
 		res = true;
 	}
@@ -1161,6 +1353,8 @@ static void v4l2_update(void *vptr, obs_data_t *settings)
 	data->color_range = obs_data_get_int(settings, "color_range");
 	data->auto_reset = obs_data_get_bool(settings, "auto_reset");
 	data->timeout_frames = obs_data_get_int(settings, "timeout_frames");
+	data->hw_decode = !data->dmabuf &&
+			  obs_data_get_bool(settings, "hw_decode");
 
 	v4l2_update_source_flags(data, settings);
 
@@ -1168,7 +1362,8 @@ static void v4l2_update(void *vptr, obs_data_t *settings)
 		v4l2_init(data);
 }
 
-static void *v4l2_create(obs_data_t *settings, obs_source_t *source)
+static void *v4l2_create_internal(obs_data_t *settings, obs_source_t *source,
+				  bool dmabuf)
 {
 	struct v4l2_data *data = bzalloc(sizeof(struct v4l2_data));
 	data->dev = -1;
@@ -1176,6 +1371,22 @@ static void *v4l2_create(obs_data_t *settings, obs_source_t *source)
 	data->resolution_unchanged = false;
 	data->framerate_unchanged = false;
 
+	if (dmabuf) {
+		data->dmabuf = true;
+		data->pending_buf = -1;
+		data->current_buf = -1;
+		pthread_mutex_init(&data->dmabuf_mutex, NULL);
+
+		char *file = obs_module_file("v4l2-dmabuf.effect");
+		obs_enter_graphics();
+		data->dmabuf_effect = gs_effect_create_from_file(file, NULL);
+		obs_leave_graphics();
+		bfree(file);
+
+		if (!data->dmabuf_effect)
+			blog(LOG_ERROR, "Failed to load dma-buf import effect");
+	}
+
 	/* Bitch about build problems ... */
 #ifndef V4L2_CAP_DEVICE_CAPS
 	blog(LOG_WARNING, "Plugin built without device caps support!");
@@ -1199,6 +1410,146 @@ static void *v4l2_create(obs_data_t *settings, obs_source_t *source)
 	return data;
 }
 
+static void *v4l2_create(obs_data_t *settings, obs_source_t *source)
+{
+	return v4l2_create_internal(settings, source, false);
+}
+
+static void *v4l2_dmabuf_create(obs_data_t *settings, obs_source_t *source)
+{
+	return v4l2_create_internal(settings, source, true);
+}
+
+/**
+ * Get the texture for a buffer, importing it on first use
+ *
+ * The dma-bufs stay valid until the capture is terminated, so each buffer
+ * only has to be imported once.
+ */
+static gs_texture_t *v4l2_dmabuf_texture(struct v4l2_data *data, int index,
+					 struct v4l2_dmabuf_format *format)
+{
+	if (data->textures[index])
+		return data->textures[index];
+
+	const int fd = data->buffers.info[index].fd;
+	const uint32_t stride = data->linesize;
+	const uint32_t offset = 0;
+	const uint64_t modifier = DRM_FORMAT_MOD_LINEAR;
+
+	data->textures[index] = gs_texture_create_from_dmabuf(
+		data->width / format->texel_width, data->height,
+		format->drm_format, format->gs_format, 1, &fd, &stride, &offset,
+		&modifier);
+
+	if (!data->textures[index])
+		blog(LOG_ERROR, "%s: failed to import buffer #%d",
+		     data->device_id, index);
+
+	return data->textures[index];
+}
+
+static void v4l2_dmabuf_draw(struct v4l2_data *data, gs_texture_t *tex,
+			     struct v4l2_dmabuf_format *format)
+{
+	gs_effect_t *effect = data->dmabuf_effect;
+	const char *technique = format->technique;
+
+	if (!technique) {
+		effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+		technique = "Draw";
+	} else if (!effect) {
+		return;
+	}
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
+			      tex);
+
+	if (format->technique) {
+		struct vec2 size;
+		struct vec3 range_min, range_max;
+		struct vec4 vec0, vec1, vec2;
+		float matrix[16];
+
+		video_format_get_parameters_for_format(
+			VIDEO_CS_DEFAULT, data->color_range,
+			v4l2_to_obs_video_format(data->pixfmt), matrix,
+			range_min.ptr, range_max.ptr);
+
+		vec2_set(&size, (float)data->width, (float)data->height);
+		vec4_set(&vec0, matrix[0], matrix[1], matrix[2], matrix[3]);
+		vec4_set(&vec1, matrix[4], matrix[5], matrix[6], matrix[7]);
+		vec4_set(&vec2, matrix[8], matrix[9], matrix[10], matrix[11]);
+
+		gs_effect_set_vec2(gs_effect_get_param_by_name(effect, "size"),
+				   &size);
+		gs_effect_set_vec4(
+			gs_effect_get_param_by_name(effect, "color_vec0"),
+			&vec0);
+		gs_effect_set_vec4(
+			gs_effect_get_param_by_name(effect, "color_vec1"),
+			&vec1);
+		gs_effect_set_vec4(
+			gs_effect_get_param_by_name(effect, "color_vec2"),
+			&vec2);
+		gs_effect_set_vec3(
+			gs_effect_get_param_by_name(effect, "color_range_min"),
+			&range_min);
+		gs_effect_set_vec3(
+			gs_effect_get_param_by_name(effect, "color_range_max"),
+			&range_max);
+	}
+
+	while (gs_effect_loop(effect, technique))
+		gs_draw_sprite(tex, 0, data->width, data->height);
+}
+
+/**
+ * Render the most recent buffer
+ *
+ * The previously displayed buffer is handed back to the device once a newer
+ * one is available.
+ */
+static void v4l2_dmabuf_render(void *vptr, gs_effect_t *effect)
+{
+	V4L2_DATA(vptr);
+	UNUSED_PARAMETER(effect);
+	struct v4l2_dmabuf_format format;
+
+	pthread_mutex_lock(&data->dmabuf_mutex);
+
+	if (data->pending_buf != -1) {
+		if (data->current_buf != -1 &&
+		    v4l2_queue_buffer(data->dev, data->current_buf) < 0)
+			blog(LOG_ERROR, "%s: failed to enqueue buffer",
+			     data->device_id);
+		data->current_buf = data->pending_buf;
+		data->pending_buf = -1;
+	}
+
+	if (data->textures && data->current_buf != -1 &&
+	    v4l2_to_dmabuf_format(data->pixfmt, &format)) {
+		gs_texture_t *tex =
+			v4l2_dmabuf_texture(data, data->current_buf, &format);
+		if (tex)
+			v4l2_dmabuf_draw(data, tex, &format);
+	}
+
+	pthread_mutex_unlock(&data->dmabuf_mutex);
+}
+
+static uint32_t v4l2_dmabuf_get_width(void *vptr)
+{
+	V4L2_DATA(vptr);
+	return data->textures ? data->width : 0;
+}
+
+static uint32_t v4l2_dmabuf_get_height(void *vptr)
+{
+	V4L2_DATA(vptr);
+	return data->textures ? data->height : 0;
+}
+
 struct obs_source_info v4l2_input = {
 	.id = "v4l2_input",
 	.type = OBS_SOURCE_TYPE_INPUT,
@@ -1211,3 +1562,24 @@ struct obs_source_info v4l2_input = {
 	.get_properties = v4l2_properties,
 	.icon_type = OBS_ICON_TYPE_CAMERA,
 };
+
+/**
+ * Same device source, but the captured buffers are exported as dma-bufs and
+ * imported as textures instead of being copied into async frames.
+ */
+struct obs_source_info v4l2_dmabuf_input = {
+	.id = "v4l2_input_dmabuf",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
+			OBS_SOURCE_DO_NOT_DUPLICATE,
+	.get_name = v4l2_dmabuf_getname,
+	.create = v4l2_dmabuf_create,
+	.destroy = v4l2_destroy,
+	.update = v4l2_update,
+	.get_defaults = v4l2_defaults,
+	.get_properties = v4l2_properties,
+	.video_render = v4l2_dmabuf_render,
+	.get_width = v4l2_dmabuf_get_width,
+	.get_height = v4l2_dmabuf_get_height,
+	.icon_type = OBS_ICON_TYPE_CAMERA,
+};
@@ -5,16 +5,33 @@
 #include <util/platform.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
 #include <string.h>
 
+#define VIRTUALCAM_MAX_BUFFERS 4
+
+struct virtualcam_buffer {
+	void *data;
+	size_t size;
+};
+
 struct virtualcam_data {
 	obs_output_t *output;
 	int device;
+	uint32_t width;
+	uint32_t height;
 	uint32_t frame_size;
+
+	/* mmap streaming: frames are copied straight into the driver's
+	 * buffers instead of being passed through write() */
+	struct virtualcam_buffer buffers[VIRTUALCAM_MAX_BUFFERS];
+	uint32_t num_buffers;
+	uint32_t unqueued_buffers;
 };
 
 static const char *virtualcam_name(void *unused)
@@ -111,6 +128,62 @@ static void *virtualcam_create(obs_data_t *settings, obs_output_t *output)
 	return vcam;
 }
 
+static void unmap_buffers(struct virtualcam_data *vcam)
+{
+	struct v4l2_requestbuffers req = {0};
+
+	for (uint32_t i = 0; i < vcam->num_buffers; i++)
+		munmap(vcam->buffers[i].data, vcam->buffers[i].size);
+
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+	ioctl(vcam->device, VIDIOC_REQBUFS, &req);
+
+	vcam->num_buffers = 0;
+	vcam->unqueued_buffers = 0;
+}
+
+static bool map_buffers(struct virtualcam_data *vcam)
+{
+	struct v4l2_requestbuffers req = {0};
+
+	req.count = VIRTUALCAM_MAX_BUFFERS;
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+
+	if (ioctl(vcam->device, VIDIOC_REQBUFS, &req) < 0 || !req.count)
+		return false;
+	if (req.count > VIRTUALCAM_MAX_BUFFERS)
+		req.count = VIRTUALCAM_MAX_BUFFERS;
+
+	for (uint32_t i = 0; i < req.count; i++) {
+		struct v4l2_buffer buf = {0};
+		buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+
+		if (ioctl(vcam->device, VIDIOC_QUERYBUF, &buf) < 0 ||
+		    buf.length < vcam->frame_size)
+			goto fail;
+
+		void *data = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+				  MAP_SHARED, vcam->device, buf.m.offset);
+		if (data == MAP_FAILED)
+			goto fail;
+
+		vcam->buffers[i].data = data;
+		vcam->buffers[i].size = buf.length;
+		vcam->num_buffers++;
+	}
+
+	vcam->unqueued_buffers = vcam->num_buffers;
+	return true;
+
+fail:
+	unmap_buffers(vcam);
+	return false;
+}
+
 static bool try_connect(void *data, const char *device)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
@@ -121,6 +194,8 @@ static bool try_connect(void *data, const char *device)
 	uint32_t width = obs_output_get_width(vcam->output);
 	uint32_t height = obs_output_get_height(vcam->output);
 
+	vcam->width = width;
+	vcam->height = height;
 	vcam->frame_size = width * height * 2;
 
 	vcam->device = open(device, O_RDWR);
@@ -163,13 +238,19 @@ static bool try_connect(void *data, const char *device)
 	vsi.height = height;
 	obs_output_set_video_conversion(vcam->output, &vsi);
 
+	if ((capability.capabilities & V4L2_CAP_STREAMING) == 0 ||
+	    !map_buffers(vcam))
+		blog(LOG_INFO, "Memory mapped buffers are not available on "
+			       "'%s', writing frames to the device",
+		     device);
+
 	memset(&parm, 0, sizeof(parm));
 	parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
 	if (ioctl(vcam->device, VIDIOC_STREAMON, &parm) < 0) {
 		blog(LOG_ERROR, "Failed to start streaming on '%s' (%s)",
 		     device, strerror(errno));
-		goto fail_close_device;
+		goto fail_unmap_buffers;
 	}
 
 	blog(LOG_INFO, "Virtual camera started");
@@ -177,6 +258,9 @@ static bool try_connect(void *data, const char *device)
 
 	return true;
 
+fail_unmap_buffers:
+	if (vcam->num_buffers)
+		unmap_buffers(vcam);
 fail_close_device:
 	close(vcam->device);
 	return false;
@@ -250,16 +334,65 @@ static void virtualcam_stop(void *data, uint64_t ts)
 		     vcam->device, strerror(errno));
 	}
 
+	if (vcam->num_buffers)
+		unmap_buffers(vcam);
+
 	close(vcam->device);
 	blog(LOG_INFO, "Virtual camera stopped");
 
 	UNUSED_PARAMETER(ts);
 }
 
+static void copy_frame(struct virtualcam_data *vcam, uint8_t *dst,
+		       struct video_data *frame)
+{
+	uint32_t linesize = vcam->width * 2;
+
+	if (frame->linesize[0] == linesize) {
+		memcpy(dst, frame->data[0], vcam->frame_size);
+		return;
+	}
+
+	for (uint32_t y = 0; y < vcam->height; y++)
+		memcpy(dst + y * linesize,
+		       frame->data[0] + y * frame->linesize[0], linesize);
+}
+
+static void queue_frame(struct virtualcam_data *vcam, struct video_data *frame)
+{
+	struct v4l2_buffer buf = {0};
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	buf.memory = V4L2_MEMORY_MMAP;
+
+	if (vcam->unqueued_buffers) {
+		buf.index = vcam->num_buffers - vcam->unqueued_buffers--;
+	} else {
+		/* drop the frame rather than stall the video thread when
+		 * no buffer has been given back yet */
+		struct pollfd pfd = {.fd = vcam->device, .events = POLLOUT};
+		if (poll(&pfd, 1, 0) <= 0)
+			return;
+		if (ioctl(vcam->device, VIDIOC_DQBUF, &buf) < 0)
+			return;
+	}
+
+	copy_frame(vcam, vcam->buffers[buf.index].data, frame);
+
+	buf.bytesused = vcam->frame_size;
+	buf.field = V4L2_FIELD_NONE;
+	ioctl(vcam->device, VIDIOC_QBUF, &buf);
+}
+
 static void virtual_video(void *param, struct video_data *frame)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)param;
 	uint32_t frame_size = vcam->frame_size;
+
+	if (vcam->num_buffers) {
+		queue_frame(vcam, frame);
+		return;
+	}
+
 	while (frame_size > 0) {
 		ssize_t written =
 			write(vcam->device, frame->data[0], vcam->frame_size);
@@ -217,6 +217,11 @@ typedef struct av_capture_info {
 /// - Returns: `YES` if provided pixel format has full video range, `NO` otherwise
 + (BOOL)isFullRangeFormat:(FourCharCode)pixelFormat;
 
+/// Checks whether [IOSurface](https://developer.apple.com/documentation/iosurface?language=objc)-backed pixel buffers of the provided FourCC-based pixel format can be shared with ``libobs`` as textures.
+/// - Parameter pixelFormat: FourCC code of the pixel format in big-endian format
+/// - Returns: `YES` if pixel buffers of the provided pixel format can be imported as textures, `NO` otherwise
++ (BOOL)isTextureImportableFormat:(FourCharCode)pixelFormat;
+
 /// Converts a FourCC-based media subtype in big-endian format to a video format understood by ``libobs``.
 /// - Parameter subtype: FourCC code of the media subtype in big-endian format
 /// - Returns: Video format identifier understood by ``libobs``
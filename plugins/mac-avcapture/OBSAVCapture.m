@@ -7,6 +7,65 @@
 
 #import "OBSAVCapture.h"
 
+#pragma mark - IOSurface Frame Callbacks
+
+static void av_capture_release_frame(void *param)
+{
+    CVPixelBufferRef pixelBuffer = (CVPixelBufferRef) param;
+
+    IOSurfaceDecrementUseCount(CVPixelBufferGetIOSurface(pixelBuffer));
+    CVPixelBufferRelease(pixelBuffer);
+}
+
+static bool av_capture_import_frame(void *param, gs_texture_t *textures[MAX_AV_PLANES])
+{
+    IOSurfaceRef surface = CVPixelBufferGetIOSurface((CVPixelBufferRef) param);
+    size_t planeCount = IOSurfaceGetPlaneCount(surface);
+
+    // Packed surfaces are only ever copied into the async texture as-is, which works with rectangle textures.
+    if (planeCount == 0) {
+        textures[0] = gs_texture_create_from_iosurface(surface);
+        return textures[0] != NULL;
+    }
+
+    // Planes need to be sampled by the format conversion shaders, which do not support rectangle textures, so they
+    // are copied into regular textures on the GPU first.
+    for (size_t i = 0; i < planeCount && i < MAX_AV_PLANES; i++) {
+        gs_texture_t *plane = gs_texture_create_from_iosurface_plane(surface, (uint32_t) i);
+
+        if (plane) {
+            textures[i] = gs_texture_create(gs_texture_get_width(plane), gs_texture_get_height(plane),
+                                            gs_texture_get_color_format(plane), 1, NULL, 0);
+
+            if (textures[i]) {
+                gs_copy_texture(textures[i], plane);
+            }
+
+            gs_texture_destroy(plane);
+        }
+
+        if (!textures[i]) {
+            for (size_t j = 0; j < i; j++) {
+                gs_texture_destroy(textures[j]);
+                textures[j] = NULL;
+            }
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void av_capture_check_async_filter(obs_source_t *parent __unused, obs_source_t *filter, void *param)
+{
+    bool *hasAsyncFilter = param;
+
+    if (obs_source_enabled(filter) && (obs_source_get_output_flags(filter) & OBS_SOURCE_ASYNC)) {
+        *hasAsyncFilter = true;
+    }
+}
+
 @implementation OBSAVCapture
 
 - (instancetype)init
@@ -895,6 +954,20 @@
     }
 }
 
++ (BOOL)isTextureImportableFormat:(FourCharCode)pixelFormat
+{
+    switch (pixelFormat) {
+        case kCVPixelFormatType_32BGRA:
+        case kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange:
+        case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
+        case kCVPixelFormatType_420YpCbCr10BiPlanarVideoRange:
+        case kCVPixelFormatType_420YpCbCr10BiPlanarFullRange:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
 + (OBSAVCaptureVideoFormat)formatFromSubtype:(FourCharCode)subtype
 {
     switch (subtype) {
@@ -1248,7 +1321,25 @@
 
                 _videoInfo = newInfo;
 
-                if (newInfo.isValid) {
+                IOSurfaceRef frameSurface = newInfo.isValid ? CVPixelBufferGetIOSurface(imageBuffer) : NULL;
+                BOOL useSurface = frameSurface && [OBSAVCapture isTextureImportableFormat:mediaSubType];
+
+                if (useSurface) {
+                    // Async video filters need the frame in system memory, so only share the surface without them
+                    bool hasAsyncFilter = false;
+                    obs_source_enum_filters(_captureInfo->source, av_capture_check_async_filter, &hasAsyncFilter);
+                    useSurface = !hasAsyncFilter;
+                }
+
+                if (useSurface) {
+                    // The retained pixel buffer is not handed back to the capture session's buffer pool, so the
+                    // surface stays valid until libobs releases the frame.
+                    CVPixelBufferRetain(imageBuffer);
+                    IOSurfaceIncrementUseCount(frameSurface);
+
+                    obs_source_output_video_gpu(_captureInfo->source, frame, av_capture_import_frame,
+                                                av_capture_release_frame, (void *) imageBuffer);
+                } else if (newInfo.isValid) {
                     CVPixelBufferLockBaseAddress(imageBuffer, kCVPixelBufferLock_ReadOnly);
 
                     if (!CVPixelBufferIsPlanar(imageBuffer)) {
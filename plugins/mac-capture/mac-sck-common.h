@@ -48,6 +48,11 @@ struct screen_capture {
     bool show_hidden_windows;
     bool show_empty_names;
     bool audio_only;
+    bool match_rendered_size;
+
+    uint32_t fps_num, fps_den;
+    size_t native_width, native_height;
+    float config_check_time;
 
     SCStream *disp;
     SCStreamConfiguration *stream_properties;
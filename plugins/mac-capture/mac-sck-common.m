@@ -255,7 +255,9 @@ void screen_stream_video_update(struct screen_capture *sc, CMSampleBufferRef sam
         bool needs_to_update_properties = false;
 
         if (!frame_detail_errored) {
-            if (sc->capture_type == ScreenCaptureWindowStream) {
+            if (sc->match_rendered_size && sc->capture_type != ScreenCaptureWindowStream) {
+                // The stream is scaled to what is rendered, the source keeps the size of the display
+            } else if (sc->capture_type == ScreenCaptureWindowStream) {
                 if ((sc->frame.size.width != window_rect.size.width) ||
                     (sc->frame.size.height != window_rect.size.height)) {
                     sc->frame.size.width = window_rect.size.width;
@@ -1,6 +1,9 @@
 #include "mac-sck-common.h"
 #include "window-utils.h"
 
+#define CONFIG_CHECK_INTERVAL 1.0f
+#define MIN_CAPTURE_SIZE      64
+
 static void destroy_screen_stream(struct screen_capture *sc)
 {
     if (sc->disp && !sc->capture_failed) {
@@ -98,9 +101,16 @@ static bool init_screen_stream(struct screen_capture *sc)
     void (^set_display_mode)(struct screen_capture *, SCDisplay *) =
         ^void(struct screen_capture *capture_data, SCDisplay *target_display) {
             CGDisplayModeRef display_mode = CGDisplayCopyDisplayMode(target_display.displayID);
-            [capture_data->stream_properties setWidth:CGDisplayModeGetPixelWidth(display_mode)];
-            [capture_data->stream_properties setHeight:CGDisplayModeGetPixelHeight(display_mode)];
+            capture_data->native_width = CGDisplayModeGetPixelWidth(display_mode);
+            capture_data->native_height = CGDisplayModeGetPixelHeight(display_mode);
+            [capture_data->stream_properties setWidth:capture_data->native_width];
+            [capture_data->stream_properties setHeight:capture_data->native_height];
             CGDisplayModeRelease(display_mode);
+
+            if (capture_data->match_rendered_size) {
+                capture_data->frame.size.width = capture_data->native_width;
+                capture_data->frame.size.height = capture_data->native_height;
+            }
         };
 
     switch (sc->capture_type) {
@@ -200,6 +210,13 @@ static bool init_screen_stream(struct screen_capture *sc)
     }
     os_sem_post(sc->shareable_content_available);
 
+    struct obs_video_info ovi;
+    if (obs_get_video_info(&ovi)) {
+        sc->fps_num = ovi.fps_num;
+        sc->fps_den = ovi.fps_den;
+        [sc->stream_properties setMinimumFrameInterval:CMTimeMake(ovi.fps_den, ovi.fps_num)];
+    }
+
     CGColorRef background = CGColorGetConstantColor(kCGColorClear);
     [sc->stream_properties setQueueDepth:8];
     [sc->stream_properties setShowsCursor:!sc->hide_cursor];
@@ -281,6 +298,7 @@ static void *sck_video_capture_create(obs_data_t *settings, obs_source_t *source
     sc->show_hidden_windows = obs_data_get_bool(settings, "show_hidden_windows");
     sc->window = (CGWindowID) obs_data_get_int(settings, "window");
     sc->capture_type = (unsigned int) obs_data_get_int(settings, "type");
+    sc->match_rendered_size = obs_data_get_bool(settings, "match_rendered_size");
     sc->audio_only = false;
 
     os_sem_init(&sc->shareable_content_available, 1);
@@ -309,10 +327,133 @@ fail:
     return NULL;
 }
 
-static void sck_video_capture_tick(void *data, float seconds __unused)
+struct rendered_size {
+    obs_source_t *source;
+    float cx;
+    float cy;
+};
+
+static bool find_rendered_item(obs_scene_t *scene __unused, obs_sceneitem_t *item, void *param)
+{
+    struct rendered_size *size = param;
+
+    if (obs_sceneitem_is_group(item)) {
+        obs_sceneitem_group_enum_items(item, find_rendered_item, param);
+        return true;
+    }
+
+    if (obs_sceneitem_get_source(item) != size->source || !obs_sceneitem_visible(item))
+        return true;
+
+    struct vec2 box;
+    obs_sceneitem_get_box_scale(item, &box);
+    size->cx = fmaxf(size->cx, fabsf(box.x));
+    size->cy = fmaxf(size->cy, fabsf(box.y));
+    return true;
+}
+
+static bool find_rendered_scene(void *param, obs_source_t *scene_source)
+{
+    obs_scene_enum_items(obs_scene_from_source(scene_source), find_rendered_item, param);
+    return true;
+}
+
+/* Largest size any scene item draws the source at, in output pixels. The
+ * transform of a group an item is in is not taken into account. */
+static bool get_rendered_size(struct screen_capture *sc, size_t *width, size_t *height)
+{
+    struct rendered_size size = {.source = sc->source};
+    struct obs_video_info ovi;
+
+    if (!sc->native_width || !sc->native_height || !obs_get_video_info(&ovi))
+        return false;
+
+    obs_enum_scenes(find_rendered_scene, &size);
+    if (size.cx <= 0.0f || size.cy <= 0.0f)
+        return false;
+
+    float output_scale = fmaxf((float) ovi.output_width / (float) ovi.base_width,
+                               (float) ovi.output_height / (float) ovi.base_height);
+    float scale = fmaxf(size.cx / (float) sc->native_width, size.cy / (float) sc->native_height) * output_scale;
+    scale = fminf(scale, 1.0f);
+
+    *width = (size_t) ceilf((float) sc->native_width * scale) & ~(size_t) 1;
+    *height = (size_t) ceilf((float) sc->native_height * scale) & ~(size_t) 1;
+    *width = *width < MIN_CAPTURE_SIZE ? MIN_CAPTURE_SIZE : *width;
+    *height = *height < MIN_CAPTURE_SIZE ? MIN_CAPTURE_SIZE : *height;
+    return true;
+}
+
+/* differences of a few percent aren't worth restarting the stream for while
+ * an item is being resized */
+static inline bool size_changed(size_t cur, size_t next)
+{
+    return next > cur + cur / 20 || next + next / 20 < cur;
+}
+
+static void update_stream_config(struct screen_capture *sc)
+{
+    struct obs_video_info ovi;
+    bool changed = false;
+    bool scaled = sc->match_rendered_size && sc->capture_type != ScreenCaptureWindowStream;
+    size_t width = sc->native_width;
+    size_t height = sc->native_height;
+
+    if (!obs_get_video_info(&ovi))
+        return;
+
+    /* scenes are enumerated before taking the graphics lock, which
+     * destroy_screen_stream is called with */
+    if (scaled && !get_rendered_size(sc, &width, &height)) {
+        width = sc->native_width;
+        height = sc->native_height;
+    }
+
+    obs_enter_graphics();
+
+    if (!sc->disp || sc->capture_failed || pthread_mutex_lock(&sc->mutex)) {
+        obs_leave_graphics();
+        return;
+    }
+
+    if (ovi.fps_num != sc->fps_num || ovi.fps_den != sc->fps_den) {
+        sc->fps_num = ovi.fps_num;
+        sc->fps_den = ovi.fps_den;
+        [sc->stream_properties setMinimumFrameInterval:CMTimeMake(ovi.fps_den, ovi.fps_num)];
+        changed = true;
+    }
+
+    if (scaled && width && height) {
+        if (size_changed(sc->stream_properties.width, width) || size_changed(sc->stream_properties.height, height)) {
+            [sc->stream_properties setWidth:width];
+            [sc->stream_properties setHeight:height];
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        [sc->disp updateConfiguration:sc->stream_properties completionHandler:^(NSError *_Nullable error) {
+            if (error) {
+                MACCAP_ERR("update_stream_config: Failed to update stream properties with error %s\n",
+                           [[error localizedFailureReason] cStringUsingEncoding:NSUTF8StringEncoding]);
+            }
+        }];
+    }
+
+    pthread_mutex_unlock(&sc->mutex);
+    obs_leave_graphics();
+}
+
+static void sck_video_capture_tick(void *data, float seconds)
 {
     struct screen_capture *sc = data;
 
+    sc->config_check_time += seconds;
+    if (sc->config_check_time >= CONFIG_CHECK_INTERVAL) {
+        sc->config_check_time = 0.0f;
+        update_stream_config(sc);
+    }
+
     if (!sc->current)
         return;
     if (!obs_source_showing(sc->source))
@@ -354,8 +495,14 @@ static void sck_video_capture_render(void *data, gs_effect_t *effect __unused)
     gs_eparam_t *param = gs_effect_get_param_by_name(sc->effect, "image");
     gs_effect_set_texture(param, sc->tex);
 
+    /* a stream scaled to the rendered size is stretched back to the size of
+     * the display, the scene item scales it down again */
+    const bool scaled = sc->match_rendered_size && sc->capture_type != ScreenCaptureWindowStream;
+    const uint32_t cx = scaled ? (uint32_t) sc->frame.size.width : 0;
+    const uint32_t cy = scaled ? (uint32_t) sc->frame.size.height : 0;
+
     while (gs_effect_loop(sc->effect, "DrawD65P3"))
-        gs_draw_sprite(sc->tex, 0, 0, 0);
+        gs_draw_sprite(sc->tex, 0, cx, cy);
 
     gs_enable_framebuffer_srgb(previous);
 }
@@ -408,6 +555,7 @@ static void sck_video_capture_defaults(obs_data_t *settings)
     obs_data_set_default_bool(settings, "hide_obs", false);
     obs_data_set_default_bool(settings, "show_empty_names", false);
     obs_data_set_default_bool(settings, "show_hidden_windows", false);
+    obs_data_set_default_bool(settings, "match_rendered_size", false);
 }
 
 static void sck_video_capture_update(void *data, obs_data_t *settings)
@@ -429,8 +577,9 @@ static void sck_video_capture_update(void *data, obs_data_t *settings)
     bool hide_obs = obs_data_get_bool(settings, "hide_obs");
     bool show_empty_names = obs_data_get_bool(settings, "show_empty_names");
     bool show_hidden_windows = obs_data_get_bool(settings, "show_hidden_windows");
+    bool match_rendered_size = obs_data_get_bool(settings, "match_rendered_size");
 
-    if (capture_type == sc->capture_type) {
+    if (capture_type == sc->capture_type && match_rendered_size == sc->match_rendered_size) {
         switch (sc->capture_type) {
             case ScreenCaptureDisplayStream: {
                 if (sc->display == display && sc->hide_cursor != show_cursor && sc->hide_obs == hide_obs) {
@@ -465,6 +614,7 @@ static void sck_video_capture_update(void *data, obs_data_t *settings)
     sc->hide_obs = hide_obs;
     sc->show_empty_names = show_empty_names;
     sc->show_hidden_windows = show_hidden_windows;
+    sc->match_rendered_size = match_rendered_size;
     init_screen_stream(sc);
 
     obs_leave_graphics();
@@ -591,6 +741,9 @@ static obs_properties_t *sck_video_capture_properties(void *data)
     obs_properties_add_bool(props, "show_cursor", obs_module_text("DisplayCapture.ShowCursor"));
 
     obs_property_t *hide_obs = obs_properties_add_bool(props, "hide_obs", obs_module_text("DisplayCapture.HideOBS"));
+    obs_property_t *match_size =
+        obs_properties_add_bool(props, "match_rendered_size", obs_module_text("SCK.MatchRenderedSize"));
+    obs_property_set_long_description(match_size, obs_module_text("SCK.MatchRenderedSize.Description"));
     obs_property_t *reactivate =
         obs_properties_add_button2(props, "reactivate_capture", obs_module_text("SCK.Restart"), reactivate_capture, sc);
     obs_property_set_enabled(reactivate, sc->capture_failed);
@@ -42,6 +42,13 @@ bool is_apple_silicon = true;
 bool is_apple_silicon = false;
 #endif
 
+/* textures of a pool IOSurface, so frames from the GPU encoder can be
+ * copied into it */
+struct vt_surface_textures {
+	IOSurfaceRef surface;
+	gs_texture_t *tex[2];
+};
+
 struct vt_encoder {
 	obs_encoder_t *encoder;
 
@@ -69,6 +76,7 @@ struct vt_encoder {
 	bool hw_enc;
 	DARRAY(uint8_t) packet_data;
 	DARRAY(uint8_t) extra_data;
+	DARRAY(struct vt_surface_textures) surface_textures;
 };
 
 static const char *codec_type_to_print_fmt(CMVideoCodecType codec_type)
@@ -521,18 +529,26 @@ static inline CFDictionaryRef create_pixbuf_spec(struct vt_encoder *enc)
 	CFNumberRef Height = CFNumberCreate(kCFAllocatorDefault,
 					    kCFNumberSInt32Type, &enc->height);
 
-	CFTypeRef keys[3] = {kCVPixelBufferPixelFormatTypeKey,
-			     kCVPixelBufferWidthKey, kCVPixelBufferHeightKey};
-	CFTypeRef values[3] = {PixelFormat, Width, Height};
+	/* pool buffers need to be IOSurface backed for texture input */
+	CFDictionaryRef IOSurfaceProperties = CFDictionaryCreate(
+		kCFAllocatorDefault, NULL, NULL, 0,
+		&kCFTypeDictionaryKeyCallBacks,
+		&kCFTypeDictionaryValueCallBacks);
+
+	CFTypeRef keys[4] = {kCVPixelBufferPixelFormatTypeKey,
+			     kCVPixelBufferWidthKey, kCVPixelBufferHeightKey,
+			     kCVPixelBufferIOSurfacePropertiesKey};
+	CFTypeRef values[4] = {PixelFormat, Width, Height, IOSurfaceProperties};
 
 	CFDictionaryRef pixbuf_spec =
-		CFDictionaryCreate(kCFAllocatorDefault, keys, values, 3,
+		CFDictionaryCreate(kCFAllocatorDefault, keys, values, 4,
 				   &kCFTypeDictionaryKeyCallBacks,
 				   &kCFTypeDictionaryValueCallBacks);
 
 	CFRelease(PixelFormat);
 	CFRelease(Width);
 	CFRelease(Height);
+	CFRelease(IOSurfaceProperties);
 
 	return pixbuf_spec;
 }
@@ -690,6 +706,19 @@ static void vt_destroy(void *data)
 			VTCompressionSessionInvalidate(enc->session);
 			CFRelease(enc->session);
 		}
+
+		if (enc->surface_textures.num) {
+			obs_enter_graphics();
+			for (size_t i = 0; i < enc->surface_textures.num; i++) {
+				struct vt_surface_textures *st =
+					&enc->surface_textures.array[i];
+				gs_texture_destroy(st->tex[0]);
+				gs_texture_destroy(st->tex[1]);
+				CFRelease(st->surface);
+			}
+			obs_leave_graphics();
+		}
+		da_free(enc->surface_textures);
 		da_free(enc->packet_data);
 		da_free(enc->extra_data);
 		bfree(enc);
@@ -1230,6 +1259,31 @@ fail:
 	return false;
 }
 
+/* sample_encoded_callback releases pixbuf once the frame is encoded */
+static bool encode_pixbuf(struct vt_encoder *enc, CVPixelBufferRef pixbuf,
+			  int64_t frame_pts, struct encoder_packet *packet,
+			  bool *received_packet)
+{
+	CMTime dur = CMTimeMake(enc->fps_den, enc->fps_num);
+	CMTime off = CMTimeMultiply(dur, 2);
+	CMTime pts = CMTimeMake(frame_pts, enc->fps_num);
+
+	OSStatus code = VTCompressionSessionEncodeFrame(
+		enc->session, pixbuf, pts, dur, NULL, pixbuf, NULL);
+	if (code != noErr)
+		return false;
+
+	CMSampleBufferRef buffer =
+		(CMSampleBufferRef)CMSimpleQueueDequeue(enc->queue);
+
+	// No samples waiting in the queue
+	if (buffer == NULL)
+		return true;
+
+	*received_packet = true;
+	return parse_sample(enc, buffer, packet, off);
+}
+
 static bool vt_encode(void *data, struct encoder_frame *frame,
 		      struct encoder_packet *packet, bool *received_packet)
 {
@@ -1237,10 +1291,6 @@ static bool vt_encode(void *data, struct encoder_frame *frame,
 
 	OSStatus code;
 
-	CMTime dur = CMTimeMake(enc->fps_den, enc->fps_num);
-	CMTime off = CMTimeMultiply(dur, 2);
-	CMTime pts = CMTimeMake(frame->pts, enc->fps_num);
-
 	CVPixelBufferRef pixbuf = NULL;
 
 	if (!get_cached_pixel_buffer(enc, &pixbuf)) {
@@ -1275,24 +1325,92 @@ static bool vt_encode(void *data, struct encoder_frame *frame,
 		goto fail;
 	}
 
-	code = VTCompressionSessionEncodeFrame(enc->session, pixbuf, pts, dur,
-					       NULL, pixbuf, NULL);
-	if (code != noErr) {
-		goto fail;
+	return encode_pixbuf(enc, pixbuf, frame->pts, packet, received_packet);
+
+fail:
+	if (pixbuf)
+		CFRelease(pixbuf);
+	return false;
+}
+
+static struct vt_surface_textures *
+get_surface_textures(struct vt_encoder *enc, IOSurfaceRef surface)
+{
+	for (size_t i = 0; i < enc->surface_textures.num; i++) {
+		if (enc->surface_textures.array[i].surface == surface)
+			return &enc->surface_textures.array[i];
 	}
 
-	CMSampleBufferRef buffer =
-		(CMSampleBufferRef)CMSimpleQueueDequeue(enc->queue);
+	gs_texture_t *tex_y =
+		gs_texture_create_from_iosurface_plane(surface, 0);
+	gs_texture_t *tex_uv =
+		gs_texture_create_from_iosurface_plane(surface, 1);
+	if (!tex_y || !tex_uv) {
+		if (tex_y)
+			gs_texture_destroy(tex_y);
+		if (tex_uv)
+			gs_texture_destroy(tex_uv);
+		return NULL;
+	}
 
-	// No samples waiting in the queue
-	if (buffer == NULL)
-		return true;
+	struct vt_surface_textures *st =
+		da_push_back_new(enc->surface_textures);
+	st->surface = (IOSurfaceRef)CFRetain(surface);
+	st->tex[0] = tex_y;
+	st->tex[1] = tex_uv;
+	return st;
+}
 
-	*received_packet = true;
-	return parse_sample(enc, buffer, packet, off);
+/* The frame is copied on the GPU into a buffer of the session's pool. VT
+ * keeps the buffers it still needs out of the pool, which the textures
+ * libobs reuses for the next frames can't do. */
+static bool vt_encode_texture(void *data, struct encoder_texture *texture,
+			      int64_t pts, uint64_t lock_key,
+			      uint64_t *next_key, struct encoder_packet *packet,
+			      bool *received_packet)
+{
+	struct vt_encoder *enc = data;
+	CVPixelBufferRef pixbuf = NULL;
+	bool success = false;
 
-fail:
-	return false;
+	UNUSED_PARAMETER(lock_key);
+	UNUSED_PARAMETER(next_key);
+
+	if (!texture->tex[0] || !texture->tex[1]) {
+		VT_BLOG(LOG_ERROR, "Texture input requires NV12 or P010");
+		return false;
+	}
+
+	if (!get_cached_pixel_buffer(enc, &pixbuf)) {
+		VT_BLOG(LOG_ERROR, "Unable to create pixel buffer");
+		return false;
+	}
+
+	IOSurfaceRef surface = CVPixelBufferGetIOSurface(pixbuf);
+	if (!surface) {
+		VT_BLOG(LOG_ERROR, "Pixel buffer is not IOSurface backed");
+		CFRelease(pixbuf);
+		return false;
+	}
+
+	obs_enter_graphics();
+	struct vt_surface_textures *st = get_surface_textures(enc, surface);
+	if (st) {
+		gs_copy_texture(st->tex[0], texture->tex[0]);
+		gs_copy_texture(st->tex[1], texture->tex[1]);
+		/* the copy has to be submitted before VT reads the surface */
+		gs_flush();
+		success = true;
+	}
+	obs_leave_graphics();
+
+	if (!success) {
+		VT_BLOG(LOG_ERROR, "Unable to map pixel buffer to textures");
+		CFRelease(pixbuf);
+		return false;
+	}
+
+	return encode_pixbuf(enc, pixbuf, pts, packet, received_packet);
 }
 
 static bool vt_extra_data(void *data, uint8_t **extra_data, size_t *size)
@@ -1600,11 +1718,13 @@ void obs_module_post_load(void)
 		.create = vt_create,
 		.destroy = vt_destroy,
 		.encode = vt_encode,
+		.encode_texture2 = vt_encode_texture,
 		.update = vt_update,
 		.get_defaults2 = vt_defaults,
 		.get_extra_data = vt_extra_data,
 		.free_type_data = vt_free_type_data,
-		.caps = OBS_ENCODER_CAP_DYN_BITRATE,
+		.caps = OBS_ENCODER_CAP_DYN_BITRATE |
+			OBS_ENCODER_CAP_PASS_TEXTURE,
 	};
 
 	da_init(vt_prores_hardware_encoder_list);
@@ -1,4 +1,5 @@
 @import CoreMediaIO;
+@import IOSurface;
 @import SystemExtensions;
 
 #include <obs-module.h>
@@ -24,6 +25,10 @@ static bool cmio_extension_supported()
     }
 }
 
+// Number of IOSurfaces the program output is rendered into, frames are dropped when the extension and its clients
+// still hold all of them
+#define NUM_GPU_SURFACES 4
+
 struct virtualcam_data {
     obs_output_t *output;
     obs_video_info videoInfo;
@@ -36,6 +41,13 @@ struct virtualcam_data {
     CMFormatDescriptionRef formatDescription;
     id extensionDelegate;
 
+    // GPU path, the main texture is copied into IOSurfaces shared with the extension
+    bool gpu;
+    gs_texrender_t *texrender;
+    CVPixelBufferRef surfaces[NUM_GPU_SURFACES];
+    gs_texture_t *textures[NUM_GPU_SURFACES];
+    size_t surfaceIndex;
+
     // Legacy DAL (deprecated since macOS 12.3)
     OBSDALMachServer *machServer;
 };
@@ -245,6 +257,156 @@ FourCharCode convert_video_format_to_mac(enum video_format format, enum video_ra
     }
 }
 
+static bool virtualcam_gpu_supported(struct virtualcam_data *vcam)
+{
+    if (!cmio_extension_supported() || obs_output_video(vcam->output) != obs_get_video()) {
+        return false;
+    }
+
+    switch (vcam->videoInfo.colorspace) {
+        case VIDEO_CS_2100_PQ:
+        case VIDEO_CS_2100_HLG:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static void virtualcam_gpu_free(struct virtualcam_data *vcam)
+{
+    if (!vcam->texrender && !vcam->surfaces[0]) {
+        return;
+    }
+
+    obs_enter_graphics();
+    for (size_t i = 0; i < NUM_GPU_SURFACES; i++) {
+        gs_texture_destroy(vcam->textures[i]);
+        vcam->textures[i] = NULL;
+    }
+    gs_texrender_destroy(vcam->texrender);
+    vcam->texrender = NULL;
+    obs_leave_graphics();
+
+    for (size_t i = 0; i < NUM_GPU_SURFACES; i++) {
+        if (vcam->surfaces[i]) {
+            CVPixelBufferRelease(vcam->surfaces[i]);
+            vcam->surfaces[i] = NULL;
+        }
+    }
+}
+
+static bool virtualcam_gpu_init(struct virtualcam_data *vcam)
+{
+    // Left over when the previous start failed
+    virtualcam_gpu_free(vcam);
+
+    NSDictionary *pbAttr = @{
+        (id) kCVPixelBufferPixelFormatTypeKey: @(kCVPixelFormatType_32BGRA),
+        (id) kCVPixelBufferWidthKey: @(vcam->videoInfo.output_width),
+        (id) kCVPixelBufferHeightKey: @(vcam->videoInfo.output_height),
+        (id) kCVPixelBufferIOSurfacePropertiesKey: @ {}
+    };
+
+    for (size_t i = 0; i < NUM_GPU_SURFACES; i++) {
+        CVReturn status = CVPixelBufferCreate(kCFAllocatorDefault, vcam->videoInfo.output_width,
+                                              vcam->videoInfo.output_height, kCVPixelFormatType_32BGRA,
+                                              (__bridge CFDictionaryRef) pbAttr, &vcam->surfaces[i]);
+
+        if (status != kCVReturnSuccess) {
+            blog(LOG_ERROR, "unable to allocate shared pixel buffer (error %d)", status);
+            virtualcam_gpu_free(vcam);
+            return false;
+        }
+    }
+
+    obs_enter_graphics();
+    vcam->texrender = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+    bool success = vcam->texrender != NULL;
+    for (size_t i = 0; success && i < NUM_GPU_SURFACES; i++) {
+        vcam->textures[i] = gs_texture_create_from_iosurface(CVPixelBufferGetIOSurface(vcam->surfaces[i]));
+        success = vcam->textures[i] != NULL;
+    }
+    obs_leave_graphics();
+
+    if (!success) {
+        blog(LOG_WARNING, "unable to create textures for shared pixel buffers");
+        virtualcam_gpu_free(vcam);
+        return false;
+    }
+
+    vcam->surfaceIndex = 0;
+    return true;
+}
+
+// Surfaces are reused round-robin, skipping the ones the extension or its clients still hold
+static ssize_t virtualcam_gpu_next_surface(struct virtualcam_data *vcam)
+{
+    for (size_t i = 0; i < NUM_GPU_SURFACES; i++) {
+        size_t idx = (vcam->surfaceIndex + i) % NUM_GPU_SURFACES;
+
+        if (!IOSurfaceIsInUse(CVPixelBufferGetIOSurface(vcam->surfaces[idx]))) {
+            vcam->surfaceIndex = (idx + 1) % NUM_GPU_SURFACES;
+            return (ssize_t) idx;
+        }
+    }
+
+    return -1;
+}
+
+// Called on the graphics thread after the main texture was rendered
+static void virtualcam_output_render(void *data)
+{
+    struct virtualcam_data *vcam = (struct virtualcam_data *) data;
+
+    gs_texture_t *tex = obs_get_main_texture();
+    if (!tex) {
+        return;
+    }
+
+    ssize_t idx = virtualcam_gpu_next_surface(vcam);
+    if (idx < 0) {
+        blog(LOG_DEBUG, "all shared pixel buffers are in use, dropping frame");
+        return;
+    }
+
+    uint32_t width = vcam->videoInfo.output_width;
+    uint32_t height = vcam->videoInfo.output_height;
+
+    gs_texrender_reset(vcam->texrender);
+    if (!gs_texrender_begin(vcam->texrender, width, height)) {
+        return;
+    }
+
+    gs_ortho(0.0f, (float) vcam->videoInfo.base_width, 0.0f, (float) vcam->videoInfo.base_height, -100.0f, 100.0f);
+
+    gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+    gs_eparam_t *param = gs_effect_get_param_by_name(effect, "image");
+    gs_effect_set_texture_srgb(param, tex);
+
+    gs_blend_state_push();
+    gs_enable_blending(false);
+    gs_enable_framebuffer_srgb(true);
+    while (gs_effect_loop(effect, "Draw")) {
+        gs_draw_sprite(tex, 0, 0, 0);
+    }
+    gs_enable_framebuffer_srgb(false);
+    gs_blend_state_pop();
+
+    gs_texrender_end(vcam->texrender);
+
+    gs_copy_texture(vcam->textures[idx], gs_texrender_get_texture(vcam->texrender));
+    gs_flush();
+
+    CMSampleBufferRef sampleBuffer;
+    CMSampleTimingInfo timingInfo {.presentationTimeStamp = CMTimeMake(obs_get_video_frame_time(), NSEC_PER_SEC)};
+
+    OSStatus result = CMSampleBufferCreateForImageBuffer(kCFAllocatorDefault, vcam->surfaces[idx], true, NULL, NULL,
+                                                         vcam->formatDescription, &timingInfo, &sampleBuffer);
+    if (result == noErr) {
+        CMSimpleQueueEnqueue(vcam->queue, sampleBuffer);
+    }
+}
+
 static const char *virtualcam_output_get_name(void *type_data)
 {
     (void) type_data;
@@ -279,6 +441,7 @@ static void virtualcam_output_destroy(void *data)
         vcam->machServer = nil;
     }
 
+    virtualcam_gpu_free(vcam);
     bfree(vcam);
 }
 
@@ -329,7 +492,14 @@ static bool virtualcam_output_start(void *data)
 
     obs_get_video_info(&vcam->videoInfo);
 
-    FourCharCode video_format = convert_video_format_to_mac(vcam->videoInfo.output_format, vcam->videoInfo.range);
+    // The program output does not need to be downloaded when the extension is used, it is drawn into IOSurfaces
+    // directly instead
+    vcam->gpu = virtualcam_gpu_supported(vcam) && virtualcam_gpu_init(vcam);
+    obs_output_set_raw_video_enabled(vcam->output, !vcam->gpu);
+
+    FourCharCode video_format = vcam->gpu ? kCVPixelFormatType_32BGRA
+                                          : convert_video_format_to_mac(vcam->videoInfo.output_format,
+                                                                        vcam->videoInfo.range);
 
     struct video_scale_info conversion = {};
     conversion.width = vcam->videoInfo.output_width;
@@ -337,7 +507,9 @@ static bool virtualcam_output_start(void *data)
     conversion.colorspace = vcam->videoInfo.colorspace;
     conversion.range = vcam->videoInfo.range;
 
-    if (!video_format) {
+    if (vcam->gpu) {
+        blog(LOG_INFO, "Sharing program output with the camera extension on the GPU");
+    } else if (!video_format) {
         // Selected output format is not supported natively by CoreVideo, CPU conversion necessary
         blog(LOG_WARNING, "Selected output format (%s) not supported by CoreVideo, enabling CPU transcoding...",
              get_video_format_name(vcam->videoInfo.output_format));
@@ -347,21 +519,23 @@ static bool virtualcam_output_start(void *data)
     } else {
         conversion.format = vcam->videoInfo.output_format;
     }
-    obs_output_set_video_conversion(vcam->output, &conversion);
-
-    NSDictionary *pAttr = @ {};
-    NSDictionary *pbAttr = @{
-        (id) kCVPixelBufferPixelFormatTypeKey: @(video_format),
-        (id) kCVPixelBufferWidthKey: @(vcam->videoInfo.output_width),
-        (id) kCVPixelBufferHeightKey: @(vcam->videoInfo.output_height),
-        (id) kCVPixelBufferIOSurfacePropertiesKey: @ {}
-    };
-    CVReturn status = CVPixelBufferPoolCreate(kCFAllocatorDefault, (__bridge CFDictionaryRef) pAttr,
-                                              (__bridge CFDictionaryRef) pbAttr, &vcam->pool);
-
-    if (status != kCVReturnSuccess) {
-        blog(LOG_ERROR, "unable to allocate pixel buffer pool (error %d)", status);
-        return false;
+    if (!vcam->gpu) {
+        obs_output_set_video_conversion(vcam->output, &conversion);
+
+        NSDictionary *pAttr = @ {};
+        NSDictionary *pbAttr = @{
+            (id) kCVPixelBufferPixelFormatTypeKey: @(video_format),
+            (id) kCVPixelBufferWidthKey: @(vcam->videoInfo.output_width),
+            (id) kCVPixelBufferHeightKey: @(vcam->videoInfo.output_height),
+            (id) kCVPixelBufferIOSurfacePropertiesKey: @ {}
+        };
+        CVReturn status = CVPixelBufferPoolCreate(kCFAllocatorDefault, (__bridge CFDictionaryRef) pAttr,
+                                                  (__bridge CFDictionaryRef) pbAttr, &vcam->pool);
+
+        if (status != kCVReturnSuccess) {
+            blog(LOG_ERROR, "unable to allocate pixel buffer pool (error %d)", status);
+            return false;
+        }
     }
 
     if (cmio_extension_supported()) {
@@ -437,6 +611,10 @@ static bool virtualcam_output_start(void *data)
         return false;
     }
 
+    if (vcam->gpu) {
+        obs_add_main_rendered_callback(virtualcam_output_render, vcam);
+    }
+
     return true;
 }
 
@@ -446,6 +624,10 @@ static void virtualcam_output_stop(void *data, uint64_t ts)
 
     struct virtualcam_data *vcam = (struct virtualcam_data *) data;
 
+    if (vcam->gpu) {
+        obs_remove_main_rendered_callback(virtualcam_output_render, vcam);
+    }
+
     obs_output_end_data_capture(vcam->output);
     if (cmio_extension_supported()) {
         CMIODeviceStopStream(vcam->deviceID, vcam->streamID);
@@ -454,6 +636,8 @@ static void virtualcam_output_stop(void *data, uint64_t ts)
         [vcam->machServer stop];
     }
     CVPixelBufferPoolRelease(vcam->pool);
+    vcam->pool = NULL;
+    virtualcam_gpu_free(vcam);
 }
 
 static void virtualcam_output_raw_video(void *data, struct video_data *frame)
@@ -46,7 +46,10 @@ target_sources(
           obs-ffmpeg-output.h
           obs-ffmpeg-mux.c
           obs-ffmpeg-mux.h
+          obs-ffmpeg-replay-spill.c
+          obs-ffmpeg-replay-spill.h
           obs-ffmpeg-hls-mux.c
+          obs-ffmpeg-cmaf.c
           obs-ffmpeg-source.c
           obs-ffmpeg-compat.h
           obs-ffmpeg-formats.h
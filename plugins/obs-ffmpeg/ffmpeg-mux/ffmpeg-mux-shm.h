@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2023 Lain Bailey <lain@obsproject.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Shared memory packet ring between obs-ffmpeg and ffmpeg-mux.
+ *
+ * The pipe stays the control channel: every packet still sends its
+ * ffm_packet_info through it, in order.  For packets with in_shm set, the
+ * payload was written into the ring at shm_offset instead of following the
+ * info on the pipe, and the muxer reads it in place.  The writer falls back
+ * to the pipe whenever the ring is full, too small for a packet, or was
+ * never opened by the muxer, so the pipe alone is always sufficient.
+ *
+ * Packets are stored contiguously.  If a packet does not fit between the
+ * write offset and the end of the ring, the writer skips to the start; the
+ * reader infers the skipped bytes from the offset it receives.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <util/threading.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define FFM_SHM_SIZE (32 * 1024 * 1024)
+#define FFM_SHM_DATA_OFFSET 64
+
+struct ffm_shm_header {
+	/* set by the muxer once it has mapped the ring */
+	volatile bool ready;
+	/* bytes held by the writer and not yet released by the muxer,
+	 * including bytes skipped at the end of the ring */
+	volatile long used;
+	uint32_t capacity;
+
+	/* write-behind buffer occupancy of ffmpeg-mux, for stats */
+	volatile long io_buffered_kb;
+	volatile long io_buffer_max_kb;
+};
+
+struct ffm_shm {
+	char name[64];
+	struct ffm_shm_header *header;
+	uint8_t *data;
+	uint32_t offset;
+	bool owner;
+#ifdef _WIN32
+	HANDLE handle;
+#endif
+};
+
+static inline void ffm_shm_close(struct ffm_shm *shm)
+{
+	if (!shm->header)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(shm->header);
+	CloseHandle(shm->handle);
+	shm->handle = NULL;
+#else
+	munmap(shm->header, FFM_SHM_DATA_OFFSET + shm->header->capacity);
+	if (shm->owner)
+		shm_unlink(shm->name);
+#endif
+	shm->header = NULL;
+	shm->data = NULL;
+}
+
+static inline bool ffm_shm_map(struct ffm_shm *shm, bool create)
+{
+	const size_t size = FFM_SHM_DATA_OFFSET + FFM_SHM_SIZE;
+	void *ptr;
+
+#ifdef _WIN32
+	wchar_t wname[64];
+	MultiByteToWideChar(CP_UTF8, 0, shm->name, -1, wname, 64);
+
+	if (create)
+		shm->handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL,
+						 PAGE_READWRITE, 0,
+						 (DWORD)size, wname);
+	else
+		shm->handle = OpenFileMappingW(FILE_MAP_ALL_ACCESS, false,
+					       wname);
+	if (!shm->handle)
+		return false;
+
+	ptr = MapViewOfFile(shm->handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!ptr) {
+		CloseHandle(shm->handle);
+		shm->handle = NULL;
+		return false;
+	}
+#else
+	int flags = create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR;
+	int fd = shm_open(shm->name, flags, 0600);
+	if (fd == -1)
+		return false;
+
+	if (create && ftruncate(fd, (off_t)size) != 0) {
+		close(fd);
+		shm_unlink(shm->name);
+		return false;
+	}
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED) {
+		if (create)
+			shm_unlink(shm->name);
+		return false;
+	}
+#endif
+
+	shm->header = ptr;
+	shm->data = (uint8_t *)ptr + FFM_SHM_DATA_OFFSET;
+	shm->offset = 0;
+	shm->owner = create;
+
+	if (create) {
+		shm->header->ready = false;
+		shm->header->used = 0;
+		shm->header->capacity = FFM_SHM_SIZE;
+	}
+	return true;
+}
+
+static inline bool ffm_shm_create(struct ffm_shm *shm, const char *name)
+{
+#ifdef _WIN32
+	snprintf(shm->name, sizeof(shm->name), "Local\\%s", name);
+#else
+	snprintf(shm->name, sizeof(shm->name), "/%s", name);
+#endif
+	return ffm_shm_map(shm, true);
+}
+
+static inline bool ffm_shm_open(struct ffm_shm *shm, const char *name)
+{
+	snprintf(shm->name, sizeof(shm->name), "%s", name);
+	if (!ffm_shm_map(shm, false))
+		return false;
+
+	os_atomic_set_bool(&shm->header->ready, true);
+	return true;
+}
+
+/* Writer side: copies the payload into the ring and returns its offset in
+ * *offset, or returns false if the payload has to go through the pipe. */
+static inline bool ffm_shm_write(struct ffm_shm *shm, const uint8_t *data,
+				 uint32_t size, uint32_t *offset)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint32_t off = shm->offset;
+	uint32_t skip = 0;
+
+	if (!header || !os_atomic_load_bool(&header->ready))
+		return false;
+	if (size > header->capacity)
+		return false;
+
+	if (header->capacity - off < size) {
+		skip = header->capacity - off;
+		off = 0;
+	}
+
+	long used = os_atomic_load_long(&header->used);
+	if ((uint64_t)used + skip + size > header->capacity)
+		return false;
+
+	memcpy(shm->data + off, data, size);
+	os_atomic_add_long(&header->used, (long)(skip + size));
+
+	shm->offset = off + size;
+	*offset = off;
+	return true;
+}
+
+/* Reader side: releases a packet received at offset once it has been used */
+static inline void ffm_shm_release(struct ffm_shm *shm, uint32_t offset,
+				   uint32_t size)
+{
+	struct ffm_shm_header *header = shm->header;
+	uint32_t consumed = size;
+
+	if (offset < shm->offset)
+		consumed += header->capacity - shm->offset;
+
+	shm->offset = offset + size;
+	os_atomic_add_long(&header->used, -(long)consumed);
+}
@@ -14,17 +14,25 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
 #include <windows.h>
 #define inline __inline
 
+#else
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
+#include "ffmpeg-mux-shm.h"
 
 #include <util/threading.h>
 #include <util/platform.h>
@@ -40,10 +48,13 @@
 #define ANSI_COLOR_RESET "\x1b[0m"
 
 #define AVIO_BUFFER_SIZE 65536
+#define IO_BUFFER_DEFAULT_MAX (256 * 1048576)
+#define IO_DIRECT_ALIGN 4096
 
 /* ------------------------------------------------------------------------- */
 
 static char *global_stream_key = "";
+static struct ffm_shm global_shm = {0};
 
 struct resize_buf {
 	uint8_t *buf;
@@ -134,6 +145,21 @@ struct io_buffer {
 	FILE *output_file;
 	struct deque data;
 	uint64_t next_pos;
+	size_t max_buffer;
+
+	/* direct (unbuffered) I/O, block aligned writes bypass the page
+	 * cache while unaligned heads/tails go through output_file */
+	bool direct;
+#ifdef _WIN32
+	HANDLE direct_handle;
+#else
+	int direct_fd;
+#endif
+	uint64_t prealloc_step;
+	uint64_t prealloc_end;
+
+	/* flush the file to disk before closing it */
+	bool sync_on_close;
 };
 
 struct ffmpeg_mux {
@@ -149,6 +175,9 @@ struct ffmpeg_mux {
 	int num_audio_streams;
 	bool initialized;
 	struct io_buffer io;
+
+	/* output path of split files, params.file points to it */
+	char *filename;
 };
 
 #define SRT_PROTO "srt"
@@ -247,6 +276,8 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 
 	av_packet_free(&ffm->packet);
 
+	free(ffm->filename);
+
 	memset(ffm, 0, sizeof(*ffm));
 }
 
@@ -425,6 +456,17 @@ static bool init_params(int *argc, char ***argv, struct main_params *params,
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+	/* optional, packets only go through the pipe without it */
+	char *shm_name;
+	if (*argc && !global_shm.header &&
+	    get_opt_str(argc, argv, &shm_name, "shared memory name")) {
+		if (!ffm_shm_open(&global_shm, shm_name))
+			fprintf(stderr,
+				"Couldn't open shared memory '%s', "
+				"falling back to the pipe\n",
+				shm_name);
+	}
+
 	return true;
 }
 
@@ -671,21 +713,44 @@ static size_t safe_read(void *vdata, size_t size)
 	return total;
 }
 
+static uint8_t *read_payload(struct ffm_packet_info *info,
+			     struct resize_buf *rb)
+{
+	if (info->in_shm) {
+		if (!global_shm.data ||
+		    (uint64_t)info->shm_offset + info->size >
+			    global_shm.header->capacity)
+			return NULL;
+		return global_shm.data + info->shm_offset;
+	}
+
+	resize_buf_resize(rb, info->size);
+	return safe_read(rb->buf, info->size) == info->size ? rb->buf : NULL;
+}
+
+static inline void release_payload(struct ffm_packet_info *info)
+{
+	if (info->in_shm)
+		ffm_shm_release(&global_shm, info->shm_offset, info->size);
+}
+
 static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
 
 	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
 	if (success) {
-		uint8_t *data = malloc(info.size);
+		struct resize_buf rb = {0};
+		uint8_t *data = read_payload(&info, &rb);
 
-		if (safe_read(data, info.size) == info.size) {
+		if (data) {
 			ffmpeg_mux_header(ffm, data, &info);
+			release_payload(&info);
 		} else {
 			success = false;
 		}
 
-		free(data);
+		resize_buf_free(&rb);
 	}
 
 	return success;
@@ -714,6 +779,204 @@ static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
 
 #define CHUNK_SIZE 1048576
 
+static inline void update_io_stats(struct ffmpeg_mux *ffm)
+{
+	if (global_shm.header)
+		os_atomic_set_long(&global_shm.header->io_buffered_kb,
+				   (long)(ffm->io.data.size / 1024));
+}
+
+static void *alloc_chunk(bool aligned)
+{
+	if (!aligned)
+		return malloc(CHUNK_SIZE);
+#ifdef _WIN32
+	return _aligned_malloc(CHUNK_SIZE, IO_DIRECT_ALIGN);
+#else
+	void *ptr;
+	return posix_memalign(&ptr, IO_DIRECT_ALIGN, CHUNK_SIZE) == 0 ? ptr
+								       : NULL;
+#endif
+}
+
+static void free_chunk(void *chunk, bool aligned)
+{
+#ifdef _WIN32
+	if (aligned) {
+		_aligned_free(chunk);
+		return;
+	}
+#endif
+	UNUSED_PARAMETER(aligned);
+	free(chunk);
+}
+
+static void sync_output_file(struct ffmpeg_mux *ffm)
+{
+	fflush(ffm->io.output_file);
+#ifdef _WIN32
+	_commit(_fileno(ffm->io.output_file));
+	if (ffm->io.direct)
+		FlushFileBuffers(ffm->io.direct_handle);
+#else
+	fsync(fileno(ffm->io.output_file));
+	if (ffm->io.direct)
+		fsync(ffm->io.direct_fd);
+#endif
+}
+
+static bool open_direct_io(struct ffmpeg_mux *ffm)
+{
+#ifdef _WIN32
+	wchar_t *wpath = NULL;
+	os_utf8_to_wcs_ptr(ffm->params.file, 0, &wpath);
+	ffm->io.direct_handle = CreateFileW(wpath, GENERIC_WRITE,
+					    FILE_SHARE_READ | FILE_SHARE_WRITE,
+					    NULL, OPEN_EXISTING,
+					    FILE_FLAG_NO_BUFFERING, NULL);
+	bfree(wpath);
+	return ffm->io.direct_handle != INVALID_HANDLE_VALUE;
+#elif defined(__APPLE__)
+	ffm->io.direct_fd = open(ffm->params.file, O_WRONLY);
+	if (ffm->io.direct_fd == -1)
+		return false;
+	fcntl(ffm->io.direct_fd, F_NOCACHE, 1);
+	return true;
+#elif defined(O_DIRECT)
+	ffm->io.direct_fd = open(ffm->params.file, O_WRONLY | O_DIRECT);
+	return ffm->io.direct_fd != -1;
+#else
+	return false;
+#endif
+}
+
+static void close_direct_io(struct ffmpeg_mux *ffm)
+{
+#ifdef _WIN32
+	CloseHandle(ffm->io.direct_handle);
+#else
+	close(ffm->io.direct_fd);
+#endif
+}
+
+/* Reserves disk space ahead of the write position so the file system does
+ * not have to allocate blocks on every write.  The file size is not
+ * changed. */
+static void preallocate(struct ffmpeg_mux *ffm, uint64_t end)
+{
+	if (!ffm->io.prealloc_step || end <= ffm->io.prealloc_end)
+		return;
+
+	uint64_t new_end = end + ffm->io.prealloc_step;
+
+#ifdef _WIN32
+	HANDLE handle = ffm->io.direct ? ffm->io.direct_handle
+				       : (HANDLE)_get_osfhandle(
+						 _fileno(ffm->io.output_file));
+	FILE_ALLOCATION_INFO alloc = {0};
+	alloc.AllocationSize.QuadPart = (LONGLONG)new_end;
+	SetFileInformationByHandle(handle, FileAllocationInfo, &alloc,
+				   sizeof(alloc));
+#else
+	int fd = ffm->io.direct ? ffm->io.direct_fd
+				: fileno(ffm->io.output_file);
+#if defined(__APPLE__)
+	fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0,
+			  (off_t)(new_end - ffm->io.prealloc_end)};
+	if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+		store.fst_flags = F_ALLOCATEALL;
+		fcntl(fd, F_PREALLOCATE, &store);
+	}
+#elif defined(__linux__)
+	fallocate(fd, FALLOC_FL_KEEP_SIZE,
+		  (off_t)ffm->io.prealloc_end,
+		  (off_t)(new_end - ffm->io.prealloc_end));
+#else
+	UNUSED_PARAMETER(fd);
+#endif
+#endif
+
+	ffm->io.prealloc_end = new_end;
+}
+
+static bool write_buffered(struct ffmpeg_mux *ffm, const uint8_t *data,
+			   size_t size, uint64_t pos)
+{
+	os_fseeki64(ffm->io.output_file, pos, SEEK_SET);
+	if (fwrite(data, size, 1, ffm->io.output_file) != 1)
+		return false;
+
+	/* must reach the file before any later direct write */
+	return fflush(ffm->io.output_file) == 0;
+}
+
+static bool write_direct(struct ffmpeg_mux *ffm, const uint8_t *data,
+			 size_t size, uint64_t pos)
+{
+	preallocate(ffm, pos + size);
+
+#ifdef _WIN32
+	OVERLAPPED ov = {0};
+	DWORD written = 0;
+	ov.Offset = (DWORD)pos;
+	ov.OffsetHigh = (DWORD)(pos >> 32);
+	return WriteFile(ffm->io.direct_handle, data, (DWORD)size, &written,
+			 &ov) &&
+	       written == size;
+#else
+	while (size) {
+		ssize_t ret = pwrite(ffm->io.direct_fd, data, size, (off_t)pos);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+
+		data += ret;
+		size -= (size_t)ret;
+		pos += (uint64_t)ret;
+	}
+	return true;
+#endif
+}
+
+/* Writes as much of the chunk as direct I/O allows: block aligned runs go
+ * unbuffered, anything up to the next block boundary goes through the
+ * buffered file.  A partial block at the end is kept in the chunk for the
+ * next call unless flush_all is set. */
+static bool write_chunk_direct(struct ffmpeg_mux *ffm, uint8_t *chunk,
+			       size_t *used, uint64_t *pos, bool flush_all)
+{
+	while (*used) {
+		size_t head = (size_t)(*pos % IO_DIRECT_ALIGN);
+		size_t size;
+		bool success;
+
+		if (head) {
+			size = IO_DIRECT_ALIGN - head;
+			if (size > *used)
+				size = *used;
+			success = write_buffered(ffm, chunk, size, *pos);
+		} else if (*used >= IO_DIRECT_ALIGN) {
+			size = *used & ~((size_t)IO_DIRECT_ALIGN - 1);
+			success = write_direct(ffm, chunk, size, *pos);
+		} else if (flush_all) {
+			size = *used;
+			success = write_buffered(ffm, chunk, size, *pos);
+		} else {
+			break;
+		}
+
+		if (!success)
+			return false;
+
+		*used -= size;
+		*pos += size;
+		memmove(chunk, chunk + size, *used);
+	}
+
+	return true;
+}
+
 static void *ffmpeg_mux_io_thread(void *data)
 {
 	struct ffmpeg_mux *ffm = data;
@@ -721,7 +984,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 	// Chunk collects the writes into a larger batch
 	size_t chunk_used = 0;
 
-	unsigned char *chunk = malloc(CHUNK_SIZE);
+	unsigned char *chunk = alloc_chunk(ffm->io.direct);
 	if (!chunk) {
 		os_atomic_set_bool(&ffm->io.output_error, true);
 		fprintf(stderr, "Error allocating memory for output\n");
@@ -731,6 +994,11 @@ static void *ffmpeg_mux_io_thread(void *data)
 	bool shutting_down;
 	bool want_seek = false;
 	bool force_flush_chunk = false;
+	bool flush_all = false;
+
+	// File offset of the start of the chunk, only tracked for direct I/O
+	// which may keep a partial block in the chunk between writes
+	uint64_t chunk_pos = 0;
 
 	// current_seek_position is a virtual position updated as we read from
 	// the buffer, if it becomes discontinuous due to a seek request from
@@ -775,6 +1043,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 					// if we already plan to seek, then seek.
 					if (chunk_used || want_seek) {
 						force_flush_chunk = true;
+						flush_all = true;
 						break;
 					}
 
@@ -811,6 +1080,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 
 			// Signal that there is more room in the buffer
 			os_event_signal(ffm->io.buffer_space_available_event);
+			update_io_stats(ffm);
 
 			// Try to avoid lots of small writes unless this was the final
 			// data left in the buffer. The buffer might be entirely empty
@@ -826,6 +1096,32 @@ static void *ffmpeg_mux_io_thread(void *data)
 
 			pthread_mutex_unlock(&ffm->io.data_mutex);
 
+			if (ffm->io.direct) {
+				if (want_seek) {
+					chunk_pos = next_seek_position;
+					current_seek_position =
+						next_seek_position + chunk_used;
+					want_seek = false;
+				}
+
+				bool all = flush_all || shutting_down;
+				if (!write_chunk_direct(ffm, chunk, &chunk_used,
+							&chunk_pos, all)) {
+					os_atomic_set_bool(
+						&ffm->io.output_error, true);
+					fprintf(stderr,
+						"Error writing to '%s', %s\n",
+						ffm->params.printable_file
+							.array,
+						strerror(errno));
+					goto error;
+				}
+
+				force_flush_chunk = false;
+				flush_all = false;
+				continue;
+			}
+
 			// Seek if we need to
 			if (want_seek) {
 				os_fseeki64(ffm->io.output_file,
@@ -839,6 +1135,8 @@ static void *ffmpeg_mux_io_thread(void *data)
 				want_seek = false;
 			}
 
+			preallocate(ffm, current_seek_position);
+
 			// Write the current chunk to the output file
 			if (fwrite(chunk, chunk_used, 1, ffm->io.output_file) !=
 			    1) {
@@ -860,8 +1158,12 @@ static void *ffmpeg_mux_io_thread(void *data)
 
 error:
 	if (chunk)
-		free(chunk);
+		free_chunk(chunk, ffm->io.direct);
 
+	if (ffm->io.sync_on_close)
+		sync_output_file(ffm);
+	if (ffm->io.direct)
+		close_direct_io(ffm);
 	fclose(ffm->io.output_file);
 	return NULL;
 }
@@ -902,8 +1204,9 @@ static int ffmpeg_mux_write_av_buffer(void *opaque, uint8_t *buf, int buf_size)
 	for (;;) {
 		pthread_mutex_lock(&ffm->io.data_mutex);
 
-		// Avoid unbounded growth of the deque, cap to 256 MB
-		if (ffm->io.data.capacity >= 256 * 1048576 &&
+		// Avoid unbounded growth of the deque, cap to the configured
+		// maximum (256 MB by default)
+		if (ffm->io.data.capacity >= ffm->io.max_buffer &&
 		    ffm->io.data.capacity - ffm->io.data.size <
 			    buf_size + sizeof(struct io_header)) {
 			// No space, wait for the I/O thread to make space
@@ -929,12 +1232,39 @@ static int ffmpeg_mux_write_av_buffer(void *opaque, uint8_t *buf, int buf_size)
 
 	// Tell the I/O thread that there's new data to be written
 	os_event_signal(ffm->io.new_data_available_event);
+	update_io_stats(ffm);
 
 	pthread_mutex_unlock(&ffm->io.data_mutex);
 
 	return buf_size;
 }
 
+/* Removes the obs_* write options from the muxer settings, they configure
+ * our own file writer and are not meant for libavformat */
+static int64_t take_io_option(AVDictionary **dict, const char *name,
+			      int64_t def)
+{
+	AVDictionaryEntry *entry = av_dict_get(*dict, name, NULL, 0);
+	if (!entry)
+		return def;
+
+	int64_t val = strtoll(entry->value, NULL, 10);
+	av_dict_set(dict, name, NULL, 0);
+	return val;
+}
+
+static void take_io_options(struct ffmpeg_mux *ffm, AVDictionary **dict)
+{
+	int64_t buffer_mb = take_io_option(dict, "obs_write_buffer_mb", 0);
+	int64_t prealloc_mb = take_io_option(dict, "obs_preallocate_mb", 0);
+
+	ffm->io.direct = take_io_option(dict, "obs_direct_io", 0) != 0;
+	ffm->io.max_buffer = buffer_mb > 0 ? (size_t)buffer_mb * 1048576
+					   : IO_BUFFER_DEFAULT_MAX;
+	ffm->io.prealloc_step =
+		prealloc_mb > 0 ? (uint64_t)prealloc_mb * 1048576 : 0;
+}
+
 static inline int open_output_file(struct ffmpeg_mux *ffm)
 {
 #if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(59, 0, 100)
@@ -944,6 +1274,17 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 #endif
 	int ret;
 
+	AVDictionary *dict = NULL;
+	if ((ret = av_dict_parse_string(&dict, ffm->params.muxer_settings, "=",
+					" ", 0))) {
+		fprintf(stderr, "Failed to parse muxer settings: %s\n%s\n",
+			av_err2str(ret), ffm->params.muxer_settings);
+
+		av_dict_free(&dict);
+	}
+
+	take_io_options(ffm, &dict);
+
 	if ((format->flags & AVFMT_NOFILE) == 0) {
 		if (!ffmpeg_mux_is_network(ffm)) {
 			// If not outputting to a network, write to a deque
@@ -957,12 +1298,20 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 				fprintf(stderr, "Couldn't open '%s', %s\n",
 					ffm->params.printable_file.array,
 					strerror(errno));
+				av_dict_free(&dict);
 				return FFM_ERROR;
 			}
 
-			// Start at 1MB, this can grow up to 256 MB depending
-			// how fast data is going in and out (limited in
-			// ffmpeg_mux_write_av_buffer)
+			if (ffm->io.direct && !open_direct_io(ffm)) {
+				printf("Direct I/O is not available for '%s', "
+				       "using buffered writes\n",
+				       ffm->params.printable_file.array);
+				ffm->io.direct = false;
+			}
+
+			// Start at 1MB, this can grow up to the configured
+			// maximum depending how fast data is going in and out
+			// (limited in ffmpeg_mux_write_av_buffer)
 			deque_reserve(&ffm->io.data, 1048576);
 
 			pthread_mutex_init(&ffm->io.data_mutex, NULL);
@@ -984,6 +1333,11 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 				ffmpeg_mux_seek_av_buffer);
 
 			ffm->io.active = true;
+
+			if (global_shm.header)
+				os_atomic_set_long(
+					&global_shm.header->io_buffer_max_kb,
+					(long)(ffm->io.max_buffer / 1024));
 		} else {
 			ret = avio_open(&ffm->output->pb, ffm->params.file,
 					AVIO_FLAG_WRITE);
@@ -991,20 +1345,12 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 				fprintf(stderr, "Couldn't open '%s', %s\n",
 					ffm->params.printable_file.array,
 					av_err2str(ret));
+				av_dict_free(&dict);
 				return FFM_ERROR;
 			}
 		}
 	}
 
-	AVDictionary *dict = NULL;
-	if ((ret = av_dict_parse_string(&dict, ffm->params.muxer_settings, "=",
-					" ", 0))) {
-		fprintf(stderr, "Failed to parse muxer settings: %s\n%s\n",
-			av_err2str(ret), ffm->params.muxer_settings);
-
-		av_dict_free(&dict);
-	}
-
 	if (av_dict_count(dict) > 0) {
 		printf("Using muxer settings:");
 
@@ -1098,13 +1444,13 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 	return FFM_SUCCESS;
 }
 
-static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
-				    char *argv[])
+static bool ffmpeg_mux_read_params(struct ffmpeg_mux *ffm, int argc,
+				   char *argv[])
 {
 	argc--;
 	argv++;
 	if (!init_params(&argc, &argv, &ffm->params, &ffm->audio))
-		return FFM_ERROR;
+		return false;
 
 	if (ffm->params.tracks) {
 		ffm->audio_header =
@@ -1112,9 +1458,17 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 	}
 
 	if (!ffmpeg_mux_get_extra_data(ffm))
-		return FFM_ERROR;
+		return false;
 
 	ffm->packet = av_packet_alloc();
+	return true;
+}
+
+static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
+				    char *argv[])
+{
+	if (!ffmpeg_mux_read_params(ffm, argc, argv))
+		return FFM_ERROR;
 
 	/* ffmpeg does not have a way of telling what's supported
 	 * for a given output format, so we try each possibility */
@@ -1218,34 +1572,188 @@ static inline bool ffmpeg_mux_packet(struct ffmpeg_mux *ffm, uint8_t *buf,
 	return ret >= 0;
 }
 
-static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size,
-				    struct resize_buf *filename, int argc,
-				    char **argv)
+/* Split files: the parent announces the next file ahead of the split, which
+ * is then opened and has its header written on open_thread while the current
+ * file is still being written.  At the split the muxers are only swapped, and
+ * the previous file gets its trailer and is synced to disk on finish_thread. */
+struct split_files {
+	struct ffmpeg_mux *next;
+	pthread_t open_thread;
+	bool opening;
+	int open_ret;
+
+	pthread_t finish_thread;
+	bool finishing;
+};
+
+static char *read_file_name(uint32_t size)
 {
-	resize_buf_resize(filename, size + 1);
-	if (safe_read(filename->buf, size) != size) {
-		return false;
+	char *filename = malloc(size + 1);
+	if (safe_read(filename, size) != size) {
+		free(filename);
+		return NULL;
+	}
+
+	filename[size] = 0;
+	return filename;
+}
+
+static void destroy_file(struct ffmpeg_mux *ffm)
+{
+	ffmpeg_mux_free(ffm);
+	free(ffm);
+}
+
+/* Reads the file name of a change/prepare packet along with the codec headers
+ * that follow it, the file itself is not opened yet */
+static struct ffmpeg_mux *read_new_file(uint32_t size, int argc, char **argv)
+{
+	struct ffmpeg_mux *ffm = calloc(1, sizeof(*ffm));
+
+	ffm->filename = read_file_name(size);
+	if (!ffm->filename) {
+		free(ffm);
+		return NULL;
 	}
-	filename->buf[size] = 0;
 
 #ifdef ENABLE_FFMPEG_MUX_DEBUG
-	fprintf(stderr, "info: New output file name: %s\n", filename->buf);
+	fprintf(stderr, "info: New output file name: %s\n", ffm->filename);
 #endif
 
-	int ret;
 	char *argv1_backup = argv[1];
-	argv[1] = (char *)filename->buf;
+	argv[1] = ffm->filename;
+	bool success = ffmpeg_mux_read_params(ffm, argc, argv);
+	argv[1] = argv1_backup;
 
-	ffmpeg_mux_free(ffm);
+	if (!success) {
+		destroy_file(ffm);
+		return NULL;
+	}
 
-	ret = ffmpeg_mux_init(ffm, argc, argv);
-	if (ret != FFM_SUCCESS) {
-		fprintf(stderr, "Couldn't initialize muxer\n");
-		return false;
+	return ffm;
+}
+
+static void *open_file_thread(void *data)
+{
+	struct split_files *split = data;
+	split->open_ret = ffmpeg_mux_init_context(split->next);
+	return NULL;
+}
+
+/* Waits for the prepared file, returns NULL if it could not be opened */
+static struct ffmpeg_mux *take_next_file(struct split_files *split)
+{
+	struct ffmpeg_mux *next = split->next;
+	if (!next)
+		return NULL;
+
+	if (split->opening) {
+		pthread_join(split->open_thread, NULL);
+		split->opening = false;
 	}
 
-	argv[1] = argv1_backup;
+	split->next = NULL;
+
+	if (split->open_ret != FFM_SUCCESS) {
+		fprintf(stderr, "Couldn't open next file '%s'\n",
+			next->params.printable_file.array);
+		destroy_file(next);
+		return NULL;
+	}
+
+	next->initialized = true;
+	return next;
+}
+
+/* Removes a prepared file that did not end up being used */
+static void discard_next_file(struct split_files *split)
+{
+	struct ffmpeg_mux *next = take_next_file(split);
+	if (!next)
+		return;
+
+	char *filename = next->filename;
+	next->filename = NULL;
+
+	destroy_file(next);
+	os_unlink(filename);
+	free(filename);
+}
+
+static void *finish_file_thread(void *data)
+{
+	destroy_file(data);
+	return NULL;
+}
+
+static void wait_finished_file(struct split_files *split)
+{
+	if (split->finishing) {
+		pthread_join(split->finish_thread, NULL);
+		split->finishing = false;
+	}
+}
 
+static void finish_file(struct split_files *split, struct ffmpeg_mux *ffm)
+{
+	wait_finished_file(split);
+
+	ffm->io.sync_on_close = true;
+
+	split->finishing = pthread_create(&split->finish_thread, NULL,
+					  finish_file_thread, ffm) == 0;
+	if (!split->finishing)
+		finish_file_thread(ffm);
+}
+
+static bool read_prepare_file(struct split_files *split, uint32_t size,
+			      int argc, char **argv)
+{
+	discard_next_file(split);
+
+	split->next = read_new_file(size, argc, argv);
+	if (!split->next)
+		return false;
+
+	split->opening = pthread_create(&split->open_thread, NULL,
+					open_file_thread, split) == 0;
+	if (!split->opening)
+		open_file_thread(split);
+
+	return true;
+}
+
+static bool read_change_file(struct split_files *split,
+			     struct ffmpeg_mux **p_ffm, uint32_t size,
+			     int argc, char **argv)
+{
+	struct ffmpeg_mux *file = read_new_file(size, argc, argv);
+	struct ffmpeg_mux *next = NULL;
+
+	if (!file)
+		return false;
+
+	if (split->next && strcmp(split->next->filename, file->filename) == 0)
+		next = take_next_file(split);
+	else
+		discard_next_file(split);
+
+	if (next) {
+		destroy_file(file);
+	} else {
+		int ret = ffmpeg_mux_init_context(file);
+		if (ret != FFM_SUCCESS) {
+			fprintf(stderr, "Couldn't initialize muxer\n");
+			destroy_file(file);
+			return false;
+		}
+
+		file->initialized = true;
+		next = file;
+	}
+
+	finish_file(split, *p_ffm);
+	*p_ffm = next;
 	return true;
 }
 
@@ -1258,9 +1766,9 @@ int main(int argc, char *argv[])
 #endif
 {
 	struct ffm_packet_info info = {0};
-	struct ffmpeg_mux ffm = {0};
+	struct ffmpeg_mux *ffm = calloc(1, sizeof(*ffm));
+	struct split_files split = {0};
 	struct resize_buf rb = {0};
-	struct resize_buf rb_filename = {0};
 	bool fail = false;
 	int ret;
 
@@ -1286,31 +1794,40 @@ int main(int argc, char *argv[])
 #endif
 	setvbuf(stderr, NULL, _IONBF, 0);
 
-	ret = ffmpeg_mux_init(&ffm, argc, argv);
+	ret = ffmpeg_mux_init(ffm, argc, argv);
 	if (ret != FFM_SUCCESS) {
 		fprintf(stderr, "Couldn't initialize muxer\n");
+		free(ffm);
 		return ret;
 	}
 
 	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
+		if (info.type == FFM_PACKET_PREPARE_FILE) {
+			fail = !read_prepare_file(&split, info.size, argc,
+						  argv);
+			continue;
+		}
 		if (info.type == FFM_PACKET_CHANGE_FILE) {
-			fail = !read_change_file(&ffm, info.size, &rb_filename,
-						 argc, argv);
+			fail = !read_change_file(&split, &ffm, info.size, argc,
+						 argv);
 			continue;
 		}
 
-		resize_buf_resize(&rb, info.size);
+		uint8_t *data = read_payload(&info, &rb);
 
-		if (safe_read(rb.buf, info.size) == info.size) {
-			fail = !ffmpeg_mux_packet(&ffm, rb.buf, &info);
+		if (data) {
+			fail = !ffmpeg_mux_packet(ffm, data, &info);
+			release_payload(&info);
 		} else {
 			fail = true;
 		}
 	}
 
-	ffmpeg_mux_free(&ffm);
+	discard_next_file(&split);
+	wait_finished_file(&split);
+	destroy_file(ffm);
+	ffm_shm_close(&global_shm);
 	resize_buf_free(&rb);
-	resize_buf_free(&rb_filename);
 
 #ifdef _WIN32
 	for (int i = 0; i < argc; i++)
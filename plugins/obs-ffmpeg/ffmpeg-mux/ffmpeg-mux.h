@@ -23,6 +23,7 @@ enum ffm_packet_type {
 	FFM_PACKET_VIDEO,
 	FFM_PACKET_AUDIO,
 	FFM_PACKET_CHANGE_FILE,
+	FFM_PACKET_PREPARE_FILE,
 };
 
 #define FFM_SUCCESS 0
@@ -36,4 +37,7 @@ struct ffm_packet_info {
 	uint32_t index;
 	enum ffm_packet_type type;
 	bool keyframe;
+	/* payload is in the shared memory ring, see ffmpeg-mux-shm.h */
+	bool in_shm;
+	uint32_t shm_offset;
 };
@@ -372,6 +372,7 @@ struct obs_encoder_info svt_av1_encoder_info = {
 	.get_properties = svt_av1_properties,
 	.get_extra_data = av1_extra_data,
 	.get_video_info = av1_video_info,
+	.caps = OBS_ENCODER_CAP_ASYNC_ENCODE,
 };
 
 struct obs_encoder_info aom_av1_encoder_info = {
@@ -386,4 +387,5 @@ struct obs_encoder_info aom_av1_encoder_info = {
 	.get_properties = aom_av1_properties,
 	.get_extra_data = av1_extra_data,
 	.get_video_info = av1_video_info,
+	.caps = OBS_ENCODER_CAP_ASYNC_ENCODE,
 };
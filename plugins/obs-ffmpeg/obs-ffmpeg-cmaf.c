@@ -0,0 +1,625 @@
+#include <obs-module.h>
+#include <util/threading.h>
+#include <util/platform.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+
+#include <libavutil/opt.h>
+#include <libavutil/channel_layout.h>
+#include <libavformat/avformat.h>
+
+#include "obs-ffmpeg-compat.h"
+
+/* In-process CMAF segmenter.  Packets go straight from the encoders into
+ * libavformat's dash muxer in low latency mode, which writes fMP4 chunks and
+ * both a DASH manifest and LL-HLS playlists with partial segments, and
+ * uploads them over persistent HTTP connections.  Unlike ffmpeg_hls_muxer
+ * there is no ffmpeg-mux helper process and no pipe in between. */
+
+#define do_log(level, format, ...)                       \
+	blog(level, "[ffmpeg cmaf muxer: '%s'] " format, \
+	     obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define PART_DURATION_MIN 200
+#define PART_DURATION_DEFAULT 500
+
+struct cmaf_output {
+	obs_output_t *output;
+
+	volatile bool active;
+	volatile bool stopping;
+	volatile bool write_error;
+	uint64_t stop_ts;
+	uint64_t total_bytes;
+
+	AVFormatContext *ctx;
+	AVStream *video;
+	AVStream *audio[MAX_OUTPUT_AUDIO_ENCODERS];
+	size_t num_audio;
+	bool sent_headers;
+
+	struct dstr url;
+	struct dstr muxer_settings;
+
+	bool write_thread_active;
+	pthread_mutex_t write_mutex;
+	pthread_t write_thread;
+	os_sem_t *write_sem;
+	os_event_t *stop_event;
+
+	DARRAY(AVPacket *) packets;
+};
+
+static inline bool active(struct cmaf_output *stream)
+{
+	return os_atomic_load_bool(&stream->active);
+}
+
+static inline bool stopping(struct cmaf_output *stream)
+{
+	return os_atomic_load_bool(&stream->stopping);
+}
+
+static const char *cmaf_getname(void *type)
+{
+	UNUSED_PARAMETER(type);
+	return obs_module_text("FFmpegCmafMuxer");
+}
+
+static void free_packets(struct cmaf_output *stream)
+{
+	pthread_mutex_lock(&stream->write_mutex);
+	for (size_t i = 0; i < stream->packets.num; i++)
+		av_packet_free(stream->packets.array + i);
+	da_free(stream->packets);
+	pthread_mutex_unlock(&stream->write_mutex);
+}
+
+static void close_context(struct cmaf_output *stream)
+{
+	if (!stream->ctx)
+		return;
+
+	if (stream->sent_headers)
+		av_write_trailer(stream->ctx);
+
+	avformat_free_context(stream->ctx);
+	stream->ctx = NULL;
+	stream->video = NULL;
+	memset(stream->audio, 0, sizeof(stream->audio));
+	stream->num_audio = 0;
+	stream->sent_headers = false;
+}
+
+static void deactivate(struct cmaf_output *stream)
+{
+	if (stream->write_thread_active) {
+		os_event_signal(stream->stop_event);
+		os_sem_post(stream->write_sem);
+		pthread_join(stream->write_thread, NULL);
+		stream->write_thread_active = false;
+	}
+
+	free_packets(stream);
+	close_context(stream);
+	os_atomic_set_bool(&stream->active, false);
+}
+
+static void cmaf_destroy(void *data)
+{
+	struct cmaf_output *stream = data;
+
+	if (stream) {
+		if (active(stream)) {
+			obs_output_end_data_capture(stream->output);
+			deactivate(stream);
+		}
+
+		pthread_mutex_destroy(&stream->write_mutex);
+		os_sem_destroy(stream->write_sem);
+		os_event_destroy(stream->stop_event);
+
+		dstr_free(&stream->url);
+		dstr_free(&stream->muxer_settings);
+		bfree(stream);
+	}
+}
+
+static void *cmaf_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct cmaf_output *stream = bzalloc(sizeof(*stream));
+	pthread_mutex_init_value(&stream->write_mutex);
+	stream->output = output;
+
+	if (pthread_mutex_init(&stream->write_mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (os_sem_init(&stream->write_sem, 0) != 0)
+		goto fail;
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+
+fail:
+	cmaf_destroy(stream);
+	return NULL;
+}
+
+static enum AVCodecID get_codec_id(const char *codec)
+{
+	if (strcmp(codec, "h264") == 0)
+		return AV_CODEC_ID_H264;
+#ifdef ENABLE_HEVC
+	if (strcmp(codec, "hevc") == 0)
+		return AV_CODEC_ID_HEVC;
+#endif
+	if (strcmp(codec, "av1") == 0)
+		return AV_CODEC_ID_AV1;
+	if (strcmp(codec, "aac") == 0)
+		return AV_CODEC_ID_AAC;
+	if (strcmp(codec, "opus") == 0)
+		return AV_CODEC_ID_OPUS;
+	return AV_CODEC_ID_NONE;
+}
+
+static bool set_extra_data(AVCodecParameters *par, obs_encoder_t *encoder)
+{
+	uint8_t *extra_data;
+	size_t size;
+
+	if (!obs_encoder_get_extra_data(encoder, &extra_data, &size))
+		return false;
+
+	par->extradata = av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+	if (!par->extradata)
+		return false;
+
+	memcpy(par->extradata, extra_data, size);
+	par->extradata_size = (int)size;
+	return true;
+}
+
+static bool add_video_stream(struct cmaf_output *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	video_t *video = obs_encoder_video(vencoder);
+	const struct video_output_info *voi = video_output_get_info(video);
+	AVCodecParameters *par;
+
+	stream->video = avformat_new_stream(stream->ctx, NULL);
+	if (!stream->video)
+		return false;
+
+	par = stream->video->codecpar;
+	par->codec_type = AVMEDIA_TYPE_VIDEO;
+	par->codec_id = get_codec_id(obs_encoder_get_codec(vencoder));
+	par->width = (int)obs_encoder_get_width(vencoder);
+	par->height = (int)obs_encoder_get_height(vencoder);
+	par->bit_rate = 0;
+
+	stream->video->time_base = (AVRational){
+		(int)(voi->fps_den * obs_encoder_get_frame_rate_divisor(
+					     vencoder)),
+		(int)voi->fps_num};
+	stream->video->avg_frame_rate = av_inv_q(stream->video->time_base);
+
+	return set_extra_data(par, vencoder);
+}
+
+static bool add_audio_stream(struct cmaf_output *stream, size_t idx)
+{
+	obs_encoder_t *aencoder =
+		obs_output_get_audio_encoder(stream->output, idx);
+	audio_t *audio = obs_encoder_audio(aencoder);
+	const struct audio_output_info *aoi = audio_output_get_info(audio);
+	int channels = (int)get_audio_channels(aoi->speakers);
+	AVCodecParameters *par;
+	AVStream *avstream;
+
+	avstream = avformat_new_stream(stream->ctx, NULL);
+	if (!avstream)
+		return false;
+
+	par = avstream->codecpar;
+	par->codec_type = AVMEDIA_TYPE_AUDIO;
+	par->codec_id = get_codec_id(obs_encoder_get_codec(aencoder));
+	par->sample_rate = (int)obs_encoder_get_sample_rate(aencoder);
+	par->frame_size = (int)obs_encoder_get_frame_size(aencoder);
+#if LIBAVUTIL_VERSION_INT < AV_VERSION_INT(57, 24, 100)
+	par->channels = channels;
+	par->channel_layout = av_get_default_channel_layout(channels);
+#else
+	av_channel_layout_default(&par->ch_layout, channels);
+	if (aoi->speakers == SPEAKERS_4POINT1)
+		par->ch_layout = (AVChannelLayout)AV_CHANNEL_LAYOUT_4POINT1;
+#endif
+
+	avstream->time_base = (AVRational){1, par->sample_rate};
+	stream->audio[idx] = avstream;
+
+	return set_extra_data(par, aencoder);
+}
+
+static bool send_headers(struct cmaf_output *stream)
+{
+	AVDictionary *dict = NULL;
+	int ret;
+
+	if (!add_video_stream(stream)) {
+		warn("Failed to create video stream");
+		return false;
+	}
+
+	for (size_t i = 0; i < stream->num_audio; i++) {
+		if (!add_audio_stream(stream, i)) {
+			warn("Failed to create audio stream %zu", i);
+			return false;
+		}
+	}
+
+	ret = av_dict_parse_string(&dict, stream->muxer_settings.array, "=",
+				   " ", 0);
+	if (ret < 0) {
+		warn("Failed to parse muxer settings '%s': %s",
+		     stream->muxer_settings.array, av_err2str(ret));
+		av_dict_free(&dict);
+		return false;
+	}
+
+	ret = avformat_write_header(stream->ctx, &dict);
+	if (ret < 0) {
+		warn("Error writing header for '%s': %s", stream->url.array,
+		     av_err2str(ret));
+		av_dict_free(&dict);
+		return false;
+	}
+
+	if (av_dict_count(dict) > 0) {
+		struct dstr str = {0};
+		AVDictionaryEntry *entry = NULL;
+
+		while ((entry = av_dict_get(dict, "", entry,
+					    AV_DICT_IGNORE_SUFFIX)))
+			dstr_catf(&str, "\n\t%s=%s", entry->key, entry->value);
+
+		info("Invalid muxer settings: %s", str.array);
+		dstr_free(&str);
+	}
+
+	av_dict_free(&dict);
+	stream->sent_headers = true;
+	return true;
+}
+
+static int process_packet(struct cmaf_output *stream)
+{
+	AVPacket *packet = NULL;
+	int ret;
+
+	pthread_mutex_lock(&stream->write_mutex);
+	if (stream->packets.num) {
+		packet = stream->packets.array[0];
+		da_erase(stream->packets, 0);
+	}
+	pthread_mutex_unlock(&stream->write_mutex);
+
+	if (!packet)
+		return 0;
+
+	stream->total_bytes += packet->size;
+	ret = av_interleaved_write_frame(stream->ctx, packet);
+	av_packet_free(&packet);
+
+	if (ret < 0) {
+		warn("Error writing packet: %s", av_err2str(ret));
+
+		/* a single bad packet is not a reason to stop the stream */
+		if (ret == AVERROR_INVALIDDATA || ret == AVERROR(EINVAL))
+			ret = 0;
+	}
+
+	return ret;
+}
+
+static int write_remaining_packets(struct cmaf_output *stream)
+{
+	for (;;) {
+		bool empty;
+		int ret;
+
+		pthread_mutex_lock(&stream->write_mutex);
+		empty = stream->packets.num == 0;
+		pthread_mutex_unlock(&stream->write_mutex);
+
+		if (empty)
+			return 0;
+
+		ret = process_packet(stream);
+		if (ret != 0)
+			return ret;
+	}
+}
+
+/* the writer never tears the output down itself: on errors it only flags
+ * them, and cmaf_data, cmaf_stop or cmaf_destroy join it and deactivate */
+static void *write_thread(void *data)
+{
+	struct cmaf_output *stream = data;
+
+	os_set_thread_name("cmaf-muxer: write_thread");
+
+	while (os_sem_wait(stream->write_sem) == 0) {
+		/* packets queued before the stop still belong in the stream,
+		 * so they are written out before the trailer */
+		if (os_event_try(stream->stop_event) == 0) {
+			if (write_remaining_packets(stream) != 0)
+				os_atomic_set_bool(&stream->write_error, true);
+			break;
+		}
+
+		if (process_packet(stream) != 0) {
+			os_atomic_set_bool(&stream->write_error, true);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void build_muxer_settings(struct cmaf_output *stream,
+				 obs_data_t *settings, int keyint_sec)
+{
+	int part_ms = (int)obs_data_get_int(settings, "part_duration");
+	if (part_ms < PART_DURATION_MIN)
+		part_ms = PART_DURATION_MIN;
+
+	dstr_copy(&stream->muxer_settings,
+		  "dash_segment_type=mp4 streaming=1 ldash=1 lhls=1 "
+		  "hls_playlist=1 use_template=1 use_timeline=0 "
+		  "frag_type=duration method=PUT http_persistent=1 ");
+	dstr_catf(&stream->muxer_settings, "frag_duration=%d.%03d ",
+		  part_ms / 1000, part_ms % 1000);
+	dstr_catf(&stream->muxer_settings, "target_latency=%d.%03d ",
+		  part_ms * 3 / 1000, part_ms * 3 % 1000);
+	if (keyint_sec)
+		dstr_catf(&stream->muxer_settings, "seg_duration=%d ",
+			  keyint_sec);
+	dstr_catf(&stream->muxer_settings, "http_user_agent=libobs/%s",
+		  obs_get_version_string());
+}
+
+static bool cmaf_start(void *data)
+{
+	struct cmaf_output *stream = data;
+	obs_service_t *service;
+	obs_encoder_t *vencoder;
+	obs_data_t *settings;
+	const char *url;
+	const char *stream_key;
+	int keyint_sec;
+	int ret;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	service = obs_output_get_service(stream->output);
+	if (!service)
+		return false;
+
+	url = obs_service_get_connect_info(service,
+					   OBS_SERVICE_CONNECT_INFO_SERVER_URL);
+	stream_key = obs_service_get_connect_info(
+		service, OBS_SERVICE_CONNECT_INFO_STREAM_KEY);
+	if (!url || !*url) {
+		warn("No URL set");
+		return false;
+	}
+
+	dstr_copy(&stream->url, url);
+	dstr_replace(&stream->url, "{stream_key}",
+		     stream_key ? stream_key : "");
+
+	vencoder = obs_output_get_video_encoder(stream->output);
+	settings = obs_encoder_get_settings(vencoder);
+	keyint_sec = (int)obs_data_get_int(settings, "keyint_sec");
+	obs_data_release(settings);
+
+	settings = obs_output_get_settings(stream->output);
+	build_muxer_settings(stream, settings, keyint_sec);
+	obs_data_release(settings);
+
+	stream->num_audio = 0;
+	while (stream->num_audio < MAX_OUTPUT_AUDIO_ENCODERS &&
+	       obs_output_get_audio_encoder(stream->output, stream->num_audio))
+		stream->num_audio++;
+
+	avformat_network_init();
+
+	ret = avformat_alloc_output_context2(&stream->ctx, NULL, "dash",
+					     stream->url.array);
+	if (ret < 0 || !stream->ctx) {
+		warn("Couldn't create dash muxer: %s", av_err2str(ret));
+		return false;
+	}
+
+	stream->total_bytes = 0;
+	stream->sent_headers = false;
+	os_atomic_set_bool(&stream->stopping, false);
+	os_atomic_set_bool(&stream->write_error, false);
+
+	/* a writer that exited on an error never consumed its stop event */
+	os_event_reset(stream->stop_event);
+
+	stream->write_thread_active = pthread_create(&stream->write_thread,
+						     NULL, write_thread,
+						     stream) == 0;
+	if (!stream->write_thread_active) {
+		close_context(stream);
+		return false;
+	}
+
+	os_atomic_set_bool(&stream->active, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+	info("Writing to '%s'...", url);
+	return true;
+}
+
+static void cmaf_stop(void *data, uint64_t ts)
+{
+	struct cmaf_output *stream = data;
+
+	if (!active(stream)) {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_SUCCESS);
+		return;
+	}
+
+	if (ts > 0) {
+		stream->stop_ts = ts;
+		os_atomic_set_bool(&stream->stopping, true);
+		return;
+	}
+
+	obs_output_end_data_capture(stream->output);
+	deactivate(stream);
+}
+
+static AVPacket *make_packet(struct cmaf_output *stream,
+			     struct encoder_packet *encpacket)
+{
+	bool is_video = encpacket->type == OBS_ENCODER_VIDEO;
+	AVStream *avstream = is_video ? stream->video
+				      : stream->audio[encpacket->track_idx];
+	AVRational timebase = {(int)encpacket->timebase_num,
+			       (int)encpacket->timebase_den};
+	AVPacket *packet;
+
+	if (!avstream)
+		return NULL;
+
+	packet = av_packet_alloc();
+	if (!packet)
+		return NULL;
+
+	/* one copy into a padded, refcounted buffer so the muxer never has to
+	 * duplicate the payload again */
+	if (av_new_packet(packet, (int)encpacket->size) < 0) {
+		av_packet_free(&packet);
+		return NULL;
+	}
+
+	memcpy(packet->data, encpacket->data, encpacket->size);
+	packet->stream_index = avstream->index;
+	packet->pts = av_rescale_q(encpacket->pts, timebase,
+				   avstream->time_base);
+	packet->dts = av_rescale_q(encpacket->dts, timebase,
+				   avstream->time_base);
+	if (encpacket->keyframe)
+		packet->flags |= AV_PKT_FLAG_KEY;
+
+	return packet;
+}
+
+static void cmaf_data(void *data, struct encoder_packet *packet)
+{
+	struct cmaf_output *stream = data;
+	AVPacket *avpacket;
+
+	if (!active(stream))
+		return;
+
+	/* encoder failure */
+	if (!packet) {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_ENCODE_ERROR);
+		deactivate(stream);
+		return;
+	}
+
+	/* write failure, the writer has already exited */
+	if (os_atomic_load_bool(&stream->write_error)) {
+		deactivate(stream);
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_DISCONNECTED);
+		return;
+	}
+
+	if (stopping(stream) &&
+	    packet->sys_dts_usec >= (int64_t)stream->stop_ts) {
+		obs_output_end_data_capture(stream->output);
+		deactivate(stream);
+		return;
+	}
+
+	/* the encoders' extra data is only reliably available once they have
+	 * produced their first packet */
+	if (!stream->sent_headers) {
+		if (!send_headers(stream)) {
+			obs_output_signal_stop(stream->output,
+					       OBS_OUTPUT_INVALID_STREAM);
+			deactivate(stream);
+			return;
+		}
+	}
+
+	avpacket = make_packet(stream, packet);
+	if (!avpacket)
+		return;
+
+	pthread_mutex_lock(&stream->write_mutex);
+	da_push_back(stream->packets, &avpacket);
+	pthread_mutex_unlock(&stream->write_mutex);
+	os_sem_post(stream->write_sem);
+}
+
+static uint64_t cmaf_total_bytes(void *data)
+{
+	struct cmaf_output *stream = data;
+	return stream->total_bytes;
+}
+
+static void cmaf_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "part_duration",
+				 PART_DURATION_DEFAULT);
+}
+
+static obs_properties_t *cmaf_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *p;
+
+	p = obs_properties_add_int(props, "part_duration",
+				   obs_module_text("CmafPartDuration"),
+				   PART_DURATION_MIN, 2000, 50);
+	obs_property_int_set_suffix(p, " ms");
+	return props;
+}
+
+struct obs_output_info ffmpeg_cmaf_muxer = {
+	.id = "ffmpeg_cmaf_muxer",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK |
+		 OBS_OUTPUT_SERVICE,
+	.protocols = "HLS;DASH",
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc;av1",
+#else
+	.encoded_video_codecs = "h264;av1",
+#endif
+	.encoded_audio_codecs = "aac;opus",
+	.get_name = cmaf_getname,
+	.create = cmaf_create,
+	.destroy = cmaf_destroy,
+	.start = cmaf_start,
+	.stop = cmaf_stop,
+	.encoded_packet = cmaf_data,
+	.get_total_bytes = cmaf_total_bytes,
+	.get_defaults = cmaf_defaults,
+	.get_properties = cmaf_properties,
+};
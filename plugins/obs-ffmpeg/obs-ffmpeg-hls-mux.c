@@ -1,5 +1,6 @@
 #include "obs-ffmpeg-mux.h"
 #include <obs-avc.h>
+#include <obs-packet-drop.h>
 #ifdef ENABLE_HEVC
 #include <obs-hevc.h>
 #endif
@@ -37,7 +38,7 @@ void ffmpeg_hls_mux_destroy(void *data)
 		da_free(stream->mux_packets);
 		deque_free(&stream->packets);
 
-		os_process_pipe_destroy(stream->pipe);
+		stop_pipe(stream);
 		dstr_free(&stream->path);
 		dstr_free(&stream->printable_path);
 		dstr_free(&stream->stream_key);
@@ -169,6 +170,7 @@ bool ffmpeg_hls_mux_start(void *data)
 	stream->total_bytes = 0;
 	stream->dropped_frames = 0;
 	stream->min_priority = 0;
+	stream->drop_hold_dts_usec = 0;
 
 	obs_output_begin_data_capture(stream->output, 0);
 
@@ -185,75 +187,42 @@ static bool write_packet_to_buf(struct ffmpeg_muxer *stream,
 	return true;
 }
 
-static void drop_frames(struct ffmpeg_muxer *stream, int highest_priority)
+static void drop_frames(struct ffmpeg_muxer *stream,
+			int64_t buffer_duration_usec, int64_t drop_threshold)
 {
-	struct deque new_buf = {0};
-	int num_frames_dropped = 0;
+	stream->dropped_frames += (int)obs_packet_queue_drop(
+		&stream->packets, buffer_duration_usec, drop_threshold / 2,
+		true, &stream->min_priority);
 
-	deque_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		deque_pop_front(&stream->packets, &packet, sizeof(packet));
-
-		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority >= highest_priority) {
-			deque_push_back(&new_buf, &packet, sizeof(packet));
-		} else {
-			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
-		}
-	}
-
-	deque_free(&stream->packets);
-	stream->packets = new_buf;
-
-	if (stream->min_priority < highest_priority)
-		stream->min_priority = highest_priority;
-
-	stream->dropped_frames += num_frames_dropped;
-}
-
-static bool find_first_video_packet(struct ffmpeg_muxer *stream,
-				    struct encoder_packet *first)
-{
-	size_t count = stream->packets.size / sizeof(*first);
-
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur =
-			deque_data(&stream->packets, i * sizeof(*first));
-		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
-			*first = *cur;
-			return true;
-		}
-	}
-	return false;
+	/* the buffered duration does not shrink until the packets that were
+	 * queued before the drop have been written, so wait for that */
+	stream->drop_hold_dts_usec = stream->last_dts_usec;
 }
 
-void check_to_drop_frames(struct ffmpeg_muxer *stream, bool pframes)
+void check_to_drop_frames(struct ffmpeg_muxer *stream)
 {
 	struct encoder_packet first;
 	int64_t buffer_duration_usec;
-	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST
-			       : OBS_NAL_PRIORITY_HIGH;
 	int keyint_sec = stream->keyint_sec;
 	int64_t drop_threshold_sec = keyint_sec ? 2 * keyint_sec : 10;
+	int64_t drop_threshold = drop_threshold_sec * 1000000;
 
-	if (!find_first_video_packet(stream, &first))
+	if (!obs_packet_queue_first_video(&stream->packets, &first))
 		return;
 
 	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
 
-	if (buffer_duration_usec > drop_threshold_sec * 1000000)
-		drop_frames(stream, priority);
+	if (buffer_duration_usec > drop_threshold &&
+	    !obs_packet_queue_drop_held(first.dts_usec, stream->last_dts_usec,
+					stream->drop_hold_dts_usec,
+					drop_threshold))
+		drop_frames(stream, buffer_duration_usec, drop_threshold);
 }
 
 static bool add_video_packet(struct ffmpeg_muxer *stream,
 			     struct encoder_packet *packet)
 {
-	check_to_drop_frames(stream, false);
-	check_to_drop_frames(stream, true);
+	check_to_drop_frames(stream);
 
 	/* if currently dropping frames, drop packets until it reaches the
 	 * desired priority */
@@ -603,6 +603,12 @@ static void close_mpegts_url(struct ffmpeg_output *stream, bool is_rist)
 		err = librist_close(h);
 	} else {
 		err = libsrt_close(h);
+
+		os_atomic_set_long(&stream->srt_rtt_us, 0);
+		os_atomic_set_long(&stream->srt_retransmitted, 0);
+		os_atomic_set_long(&stream->srt_send_buffer_bytes, 0);
+		os_atomic_set_long(&stream->srt_send_buffer_ms, 0);
+		os_atomic_set_long(&stream->srt_latency_ms, 0);
 	}
 	av_freep(&h->priv_data);
 	av_freep(h);
@@ -724,6 +730,23 @@ static void ffmpeg_mpegts_log_callback(void *param, int level,
 	UNUSED_PARAMETER(param);
 }
 
+static void get_srt_stats_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_output *stream = data;
+
+	calldata_set_float(cd, "rtt_ms",
+			   (double)os_atomic_load_long(&stream->srt_rtt_us) /
+				   1000.0);
+	calldata_set_int(cd, "packets_retransmitted",
+			 os_atomic_load_long(&stream->srt_retransmitted));
+	calldata_set_int(cd, "send_buffer_bytes",
+			 os_atomic_load_long(&stream->srt_send_buffer_bytes));
+	calldata_set_int(cd, "send_buffer_ms",
+			 os_atomic_load_long(&stream->srt_send_buffer_ms));
+	calldata_set_int(cd, "latency_ms",
+			 os_atomic_load_long(&stream->srt_latency_ms));
+}
+
 static void *ffmpeg_mpegts_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_output *data = bzalloc(sizeof(struct ffmpeg_output));
@@ -739,6 +762,14 @@ static void *ffmpeg_mpegts_create(obs_data_t *settings, obs_output_t *output)
 
 	av_log_set_callback(ffmpeg_mpegts_log_callback);
 
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_srt_stats(out float rtt_ms, "
+			 "out int packets_retransmitted, "
+			 "out int send_buffer_bytes, out int send_buffer_ms, "
+			 "out int latency_ms)",
+			 get_srt_stats_proc, data);
+
 	UNUSED_PARAMETER(settings);
 	return data;
 
@@ -791,6 +822,28 @@ static uint64_t get_packet_sys_dts(struct ffmpeg_output *output,
 				      (AVRational){1, 1000000000});
 }
 
+#define SRT_STATS_INTERVAL_NS 1000000000ULL
+
+static void update_srt_stats(struct ffmpeg_output *output)
+{
+	uint64_t now = os_gettime_ns();
+	struct libsrt_stats stats;
+
+	if (!output->h || now - output->srt_stats_ts < SRT_STATS_INTERVAL_NS)
+		return;
+
+	libsrt_get_stats(output->h, &stats);
+	output->srt_stats_ts = now;
+
+	os_atomic_set_long(&output->srt_rtt_us, (long)(stats.rtt_ms * 1000.0));
+	os_atomic_set_long(&output->srt_retransmitted,
+			   (long)stats.packets_retransmitted);
+	os_atomic_set_long(&output->srt_send_buffer_bytes,
+			   stats.send_buffer_bytes);
+	os_atomic_set_long(&output->srt_send_buffer_ms, stats.send_buffer_ms);
+	os_atomic_set_long(&output->srt_latency_ms, stats.latency_ms);
+}
+
 static int mpegts_process_packet(struct ffmpeg_output *output)
 {
 	AVPacket *packet = NULL;
@@ -824,6 +877,9 @@ static int mpegts_process_packet(struct ffmpeg_output *output)
 	ret = av_interleaved_write_frame(output->ff_data.output, packet);
 	av_freep(&buf);
 
+	if (ret >= 0 && is_srt(output))
+		update_srt_stats(output);
+
 	if (ret < 0) {
 		ffmpeg_mpegts_log_error(
 			LOG_WARNING, &output->ff_data,
@@ -1314,6 +1370,21 @@ fail:
 	ffmpeg_mpegts_full_stop(stream);
 }
 
+/* packets that wait in the SRT send buffer for longer than the latency are
+ * dropped by the sender, so report how much of that window is used */
+static float ffmpeg_mpegts_congestion(void *data)
+{
+	struct ffmpeg_output *output = data;
+	long latency = os_atomic_load_long(&output->srt_latency_ms);
+	long buffered = os_atomic_load_long(&output->srt_send_buffer_ms);
+
+	if (latency <= 0)
+		return 0.0f;
+
+	float congestion = (float)buffered / (float)latency;
+	return congestion > 1.0f ? 1.0f : congestion;
+}
+
 static obs_properties_t *ffmpeg_mpegts_properties(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -1343,5 +1414,6 @@ struct obs_output_info ffmpeg_mpegts_muxer = {
 	.stop = ffmpeg_mpegts_stop,
 	.encoded_packet = ffmpeg_mpegts_data,
 	.get_total_bytes = ffmpeg_mpegts_total_bytes,
+	.get_congestion = ffmpeg_mpegts_congestion,
 	.get_properties = ffmpeg_mpegts_properties,
 };
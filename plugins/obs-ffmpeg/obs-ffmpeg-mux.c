@@ -23,6 +23,7 @@
 #endif
 
 #include <libavformat/avformat.h>
+#include <inttypes.h>
 
 #define do_log(level, format, ...)                  \
 	blog(level, "[ffmpeg muxer: '%s'] " format, \
@@ -45,15 +46,111 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 }
 #endif
 
+/* spilled packets do not hold a reference, their payload lives in the
+ * replay buffer spill file */
+static inline void release_packet(struct ffmpeg_muxer *stream,
+				  struct encoder_packet *pkt)
+{
+	if (!replay_spill_contains(&stream->spill, pkt->data))
+		obs_encoder_packet_release(pkt);
+}
+
+struct replay_segment {
+	volatile long refs;
+	/* referenced by this segment */
+	struct replay_segment *next;
+	mux_packets_t packets;
+	int64_t size;
+	int keyframes;
+	size_t spilled;
+	bool sealed;
+};
+
+struct replay_save {
+	/* pipe, shared memory and path of this save */
+	struct ffmpeg_muxer mux;
+	struct ffmpeg_muxer *stream;
+	/* referenced by the save, keeps the rest of the segments alive */
+	struct replay_segment *first;
+	struct replay_segment *last;
+	/* signaled once the save task no longer touches the save */
+	os_event_t *done_event;
+};
+
+static inline bool segment_starts_with_keyframe(struct replay_segment *seg)
+{
+	struct encoder_packet *pkt = seg->packets.array;
+	return pkt->type == OBS_ENCODER_VIDEO && pkt->keyframe;
+}
+
+/* may be called from save tasks, drops segments iteratively so that
+ * releasing a long buffer does not recurse */
+static void segment_release(struct ffmpeg_muxer *stream,
+			    struct replay_segment *seg)
+{
+	while (seg && os_atomic_dec_long(&seg->refs) == 0) {
+		struct replay_segment *next = seg->next;
+
+		for (size_t i = 0; i < seg->packets.num; i++)
+			release_packet(stream, &seg->packets.array[i]);
+		da_free(seg->packets);
+		bfree(seg);
+
+		seg = next;
+	}
+}
+
+static inline void free_replay_save(struct replay_save *save)
+{
+	dstr_free(&save->mux.path);
+	os_event_destroy(save->done_event);
+	bfree(save);
+}
+
+static void join_replay_saves(struct ffmpeg_muxer *stream, bool all)
+{
+	DARRAY(struct replay_save *) saves = {0};
+
+	pthread_mutex_lock(&stream->saves_mutex);
+
+	if (all) {
+		/* save tasks lock saves_mutex, so wait for them without it */
+		da_move(saves, stream->saves);
+	} else {
+		for (size_t i = stream->saves.num; i > 0; i--) {
+			struct replay_save *save = stream->saves.array[i - 1];
+			if (os_event_try(save->done_event) != 0)
+				continue;
+
+			da_erase(stream->saves, i - 1);
+			free_replay_save(save);
+		}
+	}
+
+	pthread_mutex_unlock(&stream->saves_mutex);
+
+	for (size_t i = 0; i < saves.num; i++) {
+		os_event_wait(saves.array[i]->done_event);
+		free_replay_save(saves.array[i]);
+	}
+	da_free(saves);
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
 		struct encoder_packet pkt;
 		deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
-		obs_encoder_packet_release(&pkt);
+		release_packet(stream, &pkt);
 	}
 
 	deque_free(&stream->packets);
+	segment_release(stream, stream->first_segment);
+	stream->first_segment = NULL;
+	stream->last_segment = NULL;
+	stream->spill_segment = NULL;
+	replay_spill_reset(&stream->spill);
+	stream->mem_time = 0;
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -70,12 +167,14 @@ static void ffmpeg_mux_destroy(void *data)
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
 	for (size_t i = 0; i < stream->mux_packets.num; i++)
-		obs_encoder_packet_release(&stream->mux_packets.array[i]);
+		release_packet(stream, &stream->mux_packets.array[i]);
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
+	replay_spill_free(&stream->spill);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
+	dstr_free(&stream->next_path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
 	dstr_free(&stream->muxer_settings);
@@ -93,6 +192,16 @@ static void split_file_proc(void *data, calldata_t *cd)
 	os_atomic_set_bool(&stream->manual_split, true);
 }
 
+static void get_write_buffer_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	calldata_set_int(cd, "used_kb",
+			 os_atomic_load_long(&stream->io_buffered_kb));
+	calldata_set_int(cd, "max_kb",
+			 os_atomic_load_long(&stream->io_buffer_max_kb));
+}
+
 static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
@@ -107,6 +216,9 @@ static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void split_file(out bool split_file_enabled)",
 			 split_file_proc, stream);
+	proc_handler_add(
+		ph, "void get_write_buffer(out int used_kb, out int max_kb)",
+		get_write_buffer_proc, stream);
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -265,20 +377,41 @@ static void add_stream_key(os_process_args_t *args, struct ffmpeg_muxer *stream)
 					      : stream->stream_key.array);
 }
 
+/* options for the file writer of ffmpeg-mux, which removes them from the
+ * muxer settings before they reach libavformat */
+static void add_write_options(struct dstr *mux, obs_data_t *settings)
+{
+	bool direct_io = obs_data_get_bool(settings, "direct_io");
+	int buffer_mb = (int)obs_data_get_int(settings, "write_buffer_size");
+	int prealloc_mb = (int)obs_data_get_int(settings, "preallocate_size");
+
+	if (direct_io)
+		dstr_cat(mux, " obs_direct_io=1");
+	if (buffer_mb > 0)
+		dstr_catf(mux, " obs_write_buffer_mb=%d", buffer_mb);
+	if (prealloc_mb > 0)
+		dstr_catf(mux, " obs_preallocate_mb=%d", prealloc_mb);
+
+	dstr_depad(mux);
+}
+
 static void add_muxer_params(os_process_args_t *args,
 			     struct ffmpeg_muxer *stream)
 {
+	obs_data_t *settings = obs_output_get_settings(stream->output);
 	struct dstr mux = {0};
 
 	if (dstr_is_empty(&stream->muxer_settings)) {
-		obs_data_t *settings = obs_output_get_settings(stream->output);
 		dstr_copy(&mux,
 			  obs_data_get_string(settings, "muxer_settings"));
-		obs_data_release(settings);
 	} else {
 		dstr_copy(&mux, stream->muxer_settings.array);
 	}
 
+	if (!stream->is_network)
+		add_write_options(&mux, settings);
+	obs_data_release(settings);
+
 	log_muxer_params(stream, mux.array);
 	os_process_args_add_arg(args, mux.array ? mux.array : "");
 
@@ -327,12 +460,43 @@ static void build_command_line(struct ffmpeg_muxer *stream,
 	add_muxer_params(*args, stream);
 }
 
+static bool create_shm(struct ffmpeg_muxer *stream)
+{
+	static volatile long counter = 0;
+	char name[48];
+
+	snprintf(name, sizeof(name), "obs-ffmpeg-mux-%" PRIx64 "-%ld",
+		 os_gettime_ns(), os_atomic_inc_long(&counter));
+
+	if (!ffm_shm_create(&stream->shm, name)) {
+		warn("Failed to create shared memory, packets will only be "
+		     "sent through the pipe");
+		return false;
+	}
+	return true;
+}
+
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
 	build_command_line(stream, &args, path);
+	if (create_shm(stream))
+		os_process_args_add_arg(args, stream->shm.name);
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
+
+	if (!stream->pipe)
+		ffm_shm_close(&stream->shm);
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	int ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+	/* the mux process has exited at this point */
+	ffm_shm_close(&stream->shm);
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
@@ -436,6 +600,7 @@ static inline bool ffmpeg_mux_start_internal(struct ffmpeg_muxer *stream,
 			obs_data_get_bool(settings, "allow_overwrite");
 		stream->cur_size = 0;
 		stream->sent_headers = false;
+		stream->next_file_prepared = false;
 	}
 
 	ts_offset_clear(stream);
@@ -501,8 +666,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -663,6 +827,10 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
+	info.in_shm = packet->size &&
+		      ffm_shm_write(&stream->shm, packet->data, info.size,
+				    &info.shm_offset);
+
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
 				    sizeof(info));
 	if (ret != sizeof(info)) {
@@ -671,11 +839,21 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
-		return false;
+	if (!info.in_shm) {
+		ret = os_process_pipe_write(stream->pipe, packet->data,
+					    packet->size);
+		if (ret != packet->size) {
+			warn("os_process_pipe_write for packet data failed");
+			signal_failure(stream);
+			return false;
+		}
+	}
+
+	if (stream->shm.header) {
+		os_atomic_set_long(&stream->io_buffered_kb,
+				   stream->shm.header->io_buffered_kb);
+		os_atomic_set_long(&stream->io_buffer_max_kb,
+				   stream->shm.header->io_buffer_max_kb);
 	}
 
 	stream->total_bytes += packet->size;
@@ -758,12 +936,38 @@ static inline bool should_split(struct ffmpeg_muxer *stream,
 	return false;
 }
 
-static bool send_new_filename(struct ffmpeg_muxer *stream, const char *filename)
+/* the next file is announced this long before an expected split, so that
+ * ffmpeg-mux can open it and write its header in the background */
+#define SPLIT_PREPARE_LEAD_USEC (3 * 1000000LL)
+
+static inline bool should_prepare_split(struct ffmpeg_muxer *stream,
+					struct encoder_packet *packet)
+{
+	int64_t elapsed = packet->dts_usec - stream->cur_time;
+
+	if (packet->type != OBS_ENCODER_VIDEO || stream->next_file_prepared)
+		return false;
+
+	if (stream->max_time > 0 &&
+	    elapsed >= stream->max_time - SPLIT_PREPARE_LEAD_USEC)
+		return true;
+
+	/* estimated from the average bitrate of the current file */
+	if (stream->max_size > 0 && elapsed > 0 &&
+	    stream->cur_size + stream->cur_size * SPLIT_PREPARE_LEAD_USEC /
+					  elapsed >=
+		    stream->max_size)
+		return true;
+
+	return false;
+}
+
+static bool send_filename(struct ffmpeg_muxer *stream,
+			  enum ffm_packet_type type, const char *filename)
 {
 	size_t ret;
 	uint32_t size = (uint32_t)strlen(filename);
-	struct ffm_packet_info info = {.type = FFM_PACKET_CHANGE_FILE,
-				       .size = size};
+	struct ffm_packet_info info = {.type = type, .size = size};
 
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
 				    sizeof(info));
@@ -784,13 +988,41 @@ static bool send_new_filename(struct ffmpeg_muxer *stream, const char *filename)
 	return true;
 }
 
+static bool prepare_next_file(struct ffmpeg_muxer *stream)
+{
+	int64_t cur_size = stream->cur_size;
+
+	generate_filename(stream, &stream->next_path, stream->allow_overwrite);
+
+	if (!send_filename(stream, FFM_PACKET_PREPARE_FILE,
+			   stream->next_path.array)) {
+		warn("Failed to send next file name");
+		return false;
+	}
+
+	if (!send_headers(stream))
+		return false;
+
+	/* headers of the next file don't count towards the current one */
+	stream->cur_size = cur_size;
+	stream->next_file_prepared = true;
+	return true;
+}
+
 static bool prepare_split_file(struct ffmpeg_muxer *stream,
 			       struct encoder_packet *packet)
 {
-	generate_filename(stream, &stream->path, stream->allow_overwrite);
+	if (stream->next_file_prepared) {
+		dstr_copy_dstr(&stream->path, &stream->next_path);
+		stream->next_file_prepared = false;
+	} else {
+		generate_filename(stream, &stream->path,
+				  stream->allow_overwrite);
+	}
 	info("Changing output file to '%s'", stream->path.array);
 
-	if (!send_new_filename(stream, stream->path.array)) {
+	if (!send_filename(stream, FFM_PACKET_CHANGE_FILE,
+			   stream->path.array)) {
 		warn("Failed to send new file name");
 		return false;
 	}
@@ -893,8 +1125,13 @@ static void ffmpeg_mux_data(void *data, struct encoder_packet *packet)
 		os_atomic_set_bool(&stream->manual_split, false);
 	}
 
-	if (stream->split_file)
+	if (stream->split_file) {
+		if (should_prepare_split(stream, packet) &&
+		    !prepare_next_file(stream))
+			return;
+
 		ts_offset_update(stream, packet);
+	}
 
 	write_packet(stream, packet);
 }
@@ -1003,8 +1240,10 @@ static void save_replay_proc(void *data, calldata_t *cd)
 static void get_last_replay(void *data, calldata_t *cd)
 {
 	struct ffmpeg_muxer *stream = data;
-	if (!os_atomic_load_bool(&stream->muxing))
-		calldata_set_string(cd, "path", stream->path.array);
+
+	pthread_mutex_lock(&stream->saves_mutex);
+	calldata_set_string(cd, "path", stream->path.array);
+	pthread_mutex_unlock(&stream->saves_mutex);
 }
 
 static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
@@ -1012,6 +1251,7 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	UNUSED_PARAMETER(settings);
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
+	pthread_mutex_init(&stream->saves_mutex, NULL);
 
 	stream->hotkey =
 		obs_hotkey_register_output(output, "ReplayBuffer.Save",
@@ -1034,6 +1274,10 @@ static void replay_buffer_destroy(void *data)
 	struct ffmpeg_muxer *stream = data;
 	if (stream->hotkey)
 		obs_hotkey_unregister(stream->hotkey);
+
+	join_replay_saves(stream, true);
+	da_free(stream->saves);
+	pthread_mutex_destroy(&stream->saves_mutex);
 	ffmpeg_mux_destroy(data);
 }
 
@@ -1049,6 +1293,21 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	stream->mem_time = obs_data_get_int(s, "memory_time_sec") * 1000000LL;
+
+	/* a spill file still being read by a save is kept as is */
+	if (!os_atomic_load_long(&stream->saving) || !stream->spill.data) {
+		int64_t spill_mb = obs_data_get_int(s, "spill_size_mb");
+		size_t spill_size = (size_t)spill_mb * (1024 * 1024);
+
+		replay_spill_free(&stream->spill);
+		if (stream->mem_time && spill_size &&
+		    !replay_spill_init(&stream->spill,
+				       obs_data_get_string(s, "directory"),
+				       spill_size))
+			warn("Failed to create the replay buffer spill file, "
+			     "all packets will be kept in memory");
+	}
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1061,47 +1320,49 @@ static bool replay_buffer_start(void *data)
 
 static bool purge_front(struct ffmpeg_muxer *stream)
 {
-	struct encoder_packet pkt;
+	struct replay_segment *seg = stream->first_segment;
 	bool keyframe;
 
-	if (!stream->packets.size)
+	if (!seg)
 		return false;
 
-	deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
-
-	keyframe = pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe;
+	stream->first_segment = seg->next;
+	if (seg->next)
+		os_atomic_inc_long(&seg->next->refs);
+	else
+		stream->last_segment = NULL;
+
+	if (stream->spill_segment == seg)
+		stream->spill_segment = NULL;
+	for (size_t i = 0; i < seg->spilled; i++) {
+		struct encoder_packet *pkt = &seg->packets.array[i];
+		if (replay_spill_contains(&stream->spill, pkt->data))
+			replay_spill_pop(&stream->spill, pkt->data, pkt->size);
+	}
 
-	if (keyframe)
-		stream->keyframes--;
+	keyframe = segment_starts_with_keyframe(seg);
+	stream->keyframes -= seg->keyframes;
 
-	if (!stream->packets.size) {
+	if (!stream->first_segment) {
 		stream->cur_size = 0;
 		stream->cur_time = 0;
 	} else {
-		struct encoder_packet first;
-		deque_peek_front(&stream->packets, &first, sizeof(first));
-		stream->cur_time = first.dts_usec;
-		stream->cur_size -= (int64_t)pkt.size;
+		struct encoder_packet *first =
+			stream->first_segment->packets.array;
+		stream->cur_time = first->dts_usec;
+		stream->cur_size -= seg->size;
 	}
 
-	obs_encoder_packet_release(&pkt);
+	segment_release(stream, seg);
 	return keyframe;
 }
 
 static inline void purge(struct ffmpeg_muxer *stream)
 {
 	if (purge_front(stream)) {
-		struct encoder_packet pkt;
-
-		for (;;) {
-			if (!stream->packets.size)
-				return;
-			deque_peek_front(&stream->packets, &pkt, sizeof(pkt));
-			if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
-				return;
-
+		while (stream->first_segment &&
+		       !segment_starts_with_keyframe(stream->first_segment))
 			purge_front(stream);
-		}
 	}
 }
 
@@ -1109,7 +1370,7 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 				       struct encoder_packet *pkt)
 {
 	if (stream->max_size) {
-		if (!stream->packets.size || stream->keyframes <= 2)
+		if (!stream->first_segment || stream->keyframes <= 2)
 			return;
 
 		while ((stream->cur_size + (int64_t)pkt->size) >
@@ -1117,22 +1378,107 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 			purge(stream);
 	}
 
-	if (!stream->packets.size || stream->keyframes <= 2)
+	if (!stream->first_segment || stream->keyframes <= 2)
 		return;
 
 	while ((pkt->dts_usec - stream->cur_time) > stream->max_time)
 		purge(stream);
 }
 
+/* Appends a referenced packet.  A new segment is started on every video
+ * keyframe, and after a save sealed the current one. */
+static void replay_buffer_append(struct ffmpeg_muxer *stream,
+				 struct encoder_packet *pkt)
+{
+	struct replay_segment *seg = stream->last_segment;
+	bool keyframe = pkt->type == OBS_ENCODER_VIDEO && pkt->keyframe;
+
+	if (!seg || seg->sealed || (keyframe && seg->packets.num)) {
+		struct replay_segment *new_seg = bzalloc(sizeof(*new_seg));
+		new_seg->refs = 1;
+
+		if (seg)
+			seg->next = new_seg;
+		else
+			stream->first_segment = new_seg;
+
+		stream->last_segment = new_seg;
+		seg = new_seg;
+	}
+
+	da_push_back(seg->packets, pkt);
+	seg->size += (int64_t)pkt->size;
+
+	if (keyframe) {
+		seg->keyframes++;
+		stream->keyframes++;
+	}
+}
+
+#define SPILL_MAX_PER_PACKET 8
+
+/* Moves the payloads of packets that fell out of the in-memory window to
+ * the spill file.  This is bounded per incoming packet so that catching up
+ * after a save does not stall the packet path. */
+static void replay_buffer_spill(struct ffmpeg_muxer *stream, int64_t dts_usec)
+{
+	struct replay_segment *seg = stream->spill_segment;
+	int count = 0;
+
+	/* saves in progress may read payloads from the spill file */
+	if (!stream->spill.data || os_atomic_load_long(&stream->saving))
+		return;
+
+	if (!seg)
+		seg = stream->first_segment;
+	if (!seg)
+		return;
+
+	while (count < SPILL_MAX_PER_PACKET) {
+		struct encoder_packet *pkt;
+		uint8_t *data;
+
+		if (seg->spilled == seg->packets.num) {
+			if (!seg->next)
+				break;
+			seg = seg->next;
+			continue;
+		}
+
+		pkt = &seg->packets.array[seg->spilled];
+		if (dts_usec - pkt->dts_usec <= stream->mem_time)
+			break;
+
+		/* empty packets have no payload to move, and would otherwise
+		 * keep anything behind them from spilling */
+		if (!pkt->size) {
+			seg->spilled++;
+			continue;
+		}
+
+		data = replay_spill_push(&stream->spill, pkt->data, pkt->size);
+		if (!data)
+			break;
+
+		struct encoder_packet spilled = *pkt;
+		obs_encoder_packet_release(pkt);
+		spilled.data = data;
+		*pkt = spilled;
+
+		seg->spilled++;
+		count++;
+	}
+
+	stream->spill_segment = seg;
+}
+
 static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 			  int64_t video_offset, int64_t *audio_offsets,
 			  int64_t video_pts_offset, int64_t *audio_dts_offsets)
 {
-	struct encoder_packet pkt;
+	struct encoder_packet pkt = *packet;
 	size_t idx;
 
-	obs_encoder_packet_ref(&pkt, packet);
-
 	if (pkt.type == OBS_ENCODER_VIDEO) {
 		pkt.dts_usec -= video_offset;
 		pkt.dts -= video_pts_offset;
@@ -1152,49 +1498,96 @@ static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 	da_insert(*packets, idx, &pkt);
 }
 
-static void *replay_buffer_mux_thread(void *data)
+/* The packets stay owned by the segments of the save, so the reordered
+ * list only holds copies of the packet structures. */
+static void reorder_packets(struct replay_save *save, mux_packets_t *packets)
 {
-	struct ffmpeg_muxer *stream = data;
+	bool found_video = false;
+	bool found_audio[MAX_AUDIO_MIXES] = {0};
+	int64_t video_offset = 0;
+	int64_t video_pts_offset = 0;
+	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
+	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+
+	for (struct replay_segment *seg = save->first; seg; seg = seg->next) {
+		for (size_t i = 0; i < seg->packets.num; i++) {
+			struct encoder_packet *pkt = &seg->packets.array[i];
+
+			if (pkt->type == OBS_ENCODER_VIDEO) {
+				if (!found_video) {
+					video_pts_offset = pkt->pts;
+					video_offset = video_pts_offset *
+						       1000000 /
+						       pkt->timebase_den;
+					found_video = true;
+				}
+			} else {
+				if (!found_audio[pkt->track_idx]) {
+					found_audio[pkt->track_idx] = true;
+					audio_offsets[pkt->track_idx] =
+						pkt->dts_usec;
+					audio_dts_offsets[pkt->track_idx] =
+						pkt->dts;
+				}
+			}
+
+			insert_packet(packets, pkt, video_offset,
+				      audio_offsets, video_pts_offset,
+				      audio_dts_offsets);
+		}
+
+		if (seg == save->last)
+			break;
+	}
+}
+
+static void replay_buffer_mux_task(void *data)
+{
+	struct replay_save *save = data;
+	struct ffmpeg_muxer *stream = save->stream;
+	struct ffmpeg_muxer *mux = &save->mux;
+	mux_packets_t packets = {0};
 	bool error = false;
 
-	start_pipe(stream, stream->path.array);
+	reorder_packets(save, &packets);
 
-	if (!stream->pipe) {
+	start_pipe(mux, mux->path.array);
+
+	if (!mux->pipe) {
 		warn("Failed to create process pipe");
 		error = true;
 		goto error;
 	}
 
-	if (!send_headers(stream)) {
-		warn("Could not write headers for file '%s'",
-		     stream->path.array);
+	if (!send_headers(mux)) {
+		warn("Could not write headers for file '%s'", mux->path.array);
 		error = true;
 		goto error;
 	}
 
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		if (!write_packet(stream, pkt)) {
+	for (size_t i = 0; i < packets.num; i++) {
+		if (!write_packet(mux, &packets.array[i])) {
 			warn("Could not write packet for file '%s'",
-			     stream->path.array);
+			     mux->path.array);
 			error = true;
 			goto error;
 		}
-		obs_encoder_packet_release(pkt);
 	}
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
+	info("Wrote replay buffer to '%s'", mux->path.array);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	if (error) {
-		for (size_t i = 0; i < stream->mux_packets.num; i++)
-			obs_encoder_packet_release(
-				&stream->mux_packets.array[i]);
+	stop_pipe(mux);
+	da_free(packets);
+	segment_release(stream, save->first);
+
+	if (!error) {
+		pthread_mutex_lock(&stream->saves_mutex);
+		dstr_copy_dstr(&stream->path, &mux->path);
+		pthread_mutex_unlock(&stream->saves_mutex);
 	}
-	da_free(stream->mux_packets);
-	os_atomic_set_bool(&stream->muxing, false);
+
+	os_atomic_dec_long(&stream->saving);
 
 	if (!error) {
 		calldata_t cd = {0};
@@ -1203,60 +1596,90 @@ error:
 		signal_handler_signal(sh, "saved", &cd);
 	}
 
-	return NULL;
+	os_event_signal(save->done_event);
 }
 
-static void replay_buffer_save(struct ffmpeg_muxer *stream)
+static bool replay_path_in_use(struct ffmpeg_muxer *stream, const char *path)
 {
-	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
+	for (size_t i = 0; i < stream->saves.num; i++) {
+		if (dstr_cmp(&stream->saves.array[i]->mux.path, path) == 0)
+			return true;
+	}
 
-	da_reserve(stream->mux_packets, num_packets);
+	return false;
+}
 
-	/* ---------------------------- */
-	/* reorder packets */
+/* The file name format usually only resolves to the second, so saves that
+ * overlap can end up with the same name.  Those get a number appended like
+ * find_best_filename does, so that two muxer processes never write the same
+ * file.  saves_mutex must be held. */
+static void make_replay_path_unique(struct ffmpeg_muxer *stream,
+				    struct dstr *path)
+{
+	int num = 2;
 
-	bool found_video = false;
-	bool found_audio[MAX_AUDIO_MIXES] = {0};
-	int64_t video_offset = 0;
-	int64_t video_pts_offset = 0;
-	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
-	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+	if (!replay_path_in_use(stream, path->array))
+		return;
 
-	for (size_t i = 0; i < num_packets; i++) {
-		struct encoder_packet *pkt;
-		pkt = deque_data(&stream->packets, i * size);
-
-		if (pkt->type == OBS_ENCODER_VIDEO) {
-			if (!found_video) {
-				video_pts_offset = pkt->pts;
-				video_offset = video_pts_offset * 1000000 /
-					       pkt->timebase_den;
-				found_video = true;
-			}
-		} else {
-			if (!found_audio[pkt->track_idx]) {
-				found_audio[pkt->track_idx] = true;
-				audio_offsets[pkt->track_idx] = pkt->dts_usec;
-				audio_dts_offsets[pkt->track_idx] = pkt->dts;
-			}
-		}
+	const char *ext = strrchr(path->array, '.');
+	size_t extstart = ext ? (size_t)(ext - path->array) : path->len;
 
-		insert_packet(&stream->mux_packets, pkt, video_offset,
-			      audio_offsets, video_pts_offset,
-			      audio_dts_offsets);
-	}
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	bool space = obs_data_get_bool(settings, "allow_spaces");
+	obs_data_release(settings);
+
+	struct dstr testpath;
+	dstr_init(&testpath);
+	do {
+		dstr_ncopy_dstr(&testpath, path, extstart);
+		dstr_catf(&testpath, space ? " (%d)" : "_%d", num++);
+		dstr_cat(&testpath, path->array + extstart);
+	} while (replay_path_in_use(stream, testpath.array));
+
+	dstr_free(path);
+	dstr_init_move(path, &testpath);
+}
+
+/* Takes a snapshot of the buffer, which is a reference to its first segment
+ * and a pointer to its last one.  The last segment is sealed so that later
+ * packets go to a new one, after that the segments of the snapshot never
+ * change and the save task can read them while the buffer moves on.
+ * Reordering and muxing are both done in the save task, which runs on the
+ * shared background task pool. */
+static void replay_buffer_save(struct ffmpeg_muxer *stream)
+{
+	struct replay_save *save;
 
-	generate_filename(stream, &stream->path, true);
+	join_replay_saves(stream, false);
 
-	os_atomic_set_bool(&stream->muxing, true);
-	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL,
-						     replay_buffer_mux_thread,
-						     stream) == 0;
-	if (!stream->mux_thread_joinable) {
-		warn("Failed to create muxer thread");
-		os_atomic_set_bool(&stream->muxing, false);
+	if (!stream->first_segment)
+		return;
+
+	save = bzalloc(sizeof(*save));
+	if (os_event_init(&save->done_event, OS_EVENT_TYPE_MANUAL) != 0) {
+		warn("Failed to create replay save event");
+		bfree(save);
+		return;
 	}
+
+	save->stream = stream;
+	save->mux.output = stream->output;
+	save->first = stream->first_segment;
+	save->last = stream->last_segment;
+	save->last->sealed = true;
+	os_atomic_inc_long(&save->first->refs);
+
+	os_atomic_inc_long(&stream->saving);
+
+	generate_filename(stream, &save->mux.path, true);
+
+	pthread_mutex_lock(&stream->saves_mutex);
+	make_replay_path_unique(stream, &save->mux.path);
+	da_push_back(stream->saves, &save);
+	pthread_mutex_unlock(&stream->saves_mutex);
+
+	obs_queue_task(OBS_TASK_BACKGROUND, replay_buffer_mux_task, save,
+		       false);
 }
 
 static void deactivate_replay_buffer(struct ffmpeg_muxer *stream, int code)
@@ -1297,24 +1720,16 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 	obs_encoder_packet_ref(&pkt, packet);
 	replay_buffer_purge(stream, &pkt);
 
-	if (!stream->packets.size)
+	if (!stream->first_segment)
 		stream->cur_time = pkt.dts_usec;
 	stream->cur_size += pkt.size;
 
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
+	replay_buffer_append(stream, &pkt);
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+	if (stream->mem_time)
+		replay_buffer_spill(stream, packet->dts_usec);
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
-		if (os_atomic_load_bool(&stream->muxing))
-			return;
-
-		if (stream->mux_thread_joinable) {
-			pthread_join(stream->mux_thread, NULL);
-			stream->mux_thread_joinable = false;
-		}
-
 		stream->save_ts = 0;
 		replay_buffer_save(stream);
 	}
@@ -1324,6 +1739,8 @@ static void replay_buffer_defaults(obs_data_t *s)
 {
 	obs_data_set_default_int(s, "max_time_sec", 15);
 	obs_data_set_default_int(s, "max_size_mb", 500);
+	obs_data_set_default_int(s, "memory_time_sec", 0);
+	obs_data_set_default_int(s, "spill_size_mb", 2048);
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
@@ -9,11 +9,20 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include "ffmpeg-mux/ffmpeg-mux-shm.h"
+#include "obs-ffmpeg-replay-spill.h"
+
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
+struct replay_segment;
+struct replay_save;
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	struct ffm_shm shm;
+	volatile long io_buffered_kb;
+	volatile long io_buffer_max_kb;
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	bool sent_headers;
@@ -35,9 +44,23 @@ struct ffmpeg_muxer {
 	int64_t save_ts;
 	int keyframes;
 	obs_hotkey_id hotkey;
-	volatile bool muxing;
 	mux_packets_t mux_packets;
 
+	/* replay buffer packets, in a list of refcounted segments that saves
+	 * can hold on to without copying them */
+	struct replay_segment *first_segment;
+	struct replay_segment *last_segment;
+	volatile long saving;
+	pthread_mutex_t saves_mutex;
+	DARRAY(struct replay_save *) saves;
+
+	/* replay buffer spill file: packets older than mem_time have their
+	 * payload moved to the spill file, spilled packets always come
+	 * before the others and spill_segment is where spilling continues */
+	struct replay_spill spill;
+	int64_t mem_time;
+	struct replay_segment *spill_segment;
+
 	/* split file */
 	bool found_video;
 	bool found_audio[MAX_AUDIO_MIXES];
@@ -45,6 +68,8 @@ struct ffmpeg_muxer {
 	int64_t audio_dts_offsets[MAX_AUDIO_MIXES];
 	bool split_file_ready;
 	volatile bool manual_split;
+	struct dstr next_path;
+	bool next_file_prepared;
 
 	/* these are accessed both by replay buffer and by HLS */
 	pthread_t mux_thread;
@@ -59,6 +84,7 @@ struct ffmpeg_muxer {
 	bool is_hls;
 	int dropped_frames;
 	int min_priority;
+	int64_t drop_hold_dts_usec;
 	int64_t last_dts_usec;
 
 	bool is_network;
@@ -69,6 +95,7 @@ struct ffmpeg_muxer {
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
@@ -453,6 +453,7 @@ static void nvenc_defaults_base(enum codec_type codec, obs_data_t *settings)
 				    codec != CODEC_H264 ? "main" : "high");
 	obs_data_set_default_bool(settings, "psycho_aq", true);
 	obs_data_set_default_int(settings, "gpu", 0);
+	obs_data_set_default_bool(settings, "gpu_auto", false);
 	obs_data_set_default_int(settings, "bf", 2);
 	obs_data_set_default_bool(settings, "repeat_headers", false);
 }
@@ -604,6 +605,13 @@ obs_properties_t *nvenc_properties_internal(enum codec_type codec, bool ffmpeg)
 
 	obs_properties_add_int(props, "gpu", obs_module_text("GPU"), 0, 8, 1);
 
+	if (!ffmpeg) {
+		p = obs_properties_add_bool(props, "gpu_auto",
+					    obs_module_text("NVENC.GPUAuto"));
+		obs_property_set_long_description(
+			p, obs_module_text("NVENC.GPUAuto.ToolTip"));
+	}
+
 	obs_properties_add_int(props, "bf", obs_module_text("BFrames"), 0, 4,
 			       1);
 
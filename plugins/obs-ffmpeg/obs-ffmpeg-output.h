@@ -112,6 +112,14 @@ struct ffmpeg_output {
 	URLContext *h;
 	AVIOContext *s;
 	bool got_headers;
+
+	/* SRT statistics, refreshed by the write thread */
+	uint64_t srt_stats_ts;
+	volatile long srt_rtt_us;
+	volatile long srt_retransmitted;
+	volatile long srt_send_buffer_bytes;
+	volatile long srt_send_buffer_ms;
+	volatile long srt_latency_ms;
 #endif
 };
 bool ffmpeg_data_init(struct ffmpeg_data *data, struct ffmpeg_cfg *config);
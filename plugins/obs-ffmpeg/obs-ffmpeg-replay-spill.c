@@ -0,0 +1,163 @@
+#include "obs-ffmpeg-replay-spill.h"
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static bool map_spill_file(struct replay_spill *spill, const char *dir,
+			   size_t size)
+{
+	wchar_t *wdir = NULL;
+	wchar_t path[MAX_PATH];
+	UINT ret;
+
+	os_utf8_to_wcs_ptr(dir, 0, &wdir);
+	ret = wdir ? GetTempFileNameW(wdir, L"obs", 0, path) : 0;
+	bfree(wdir);
+	if (!ret)
+		return false;
+
+	spill->file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+				  CREATE_ALWAYS,
+				  FILE_ATTRIBUTE_HIDDEN |
+					  FILE_FLAG_DELETE_ON_CLOSE,
+				  NULL);
+	if (spill->file == INVALID_HANDLE_VALUE) {
+		DeleteFileW(path);
+		spill->file = NULL;
+		return false;
+	}
+
+	spill->mapping = CreateFileMappingW(spill->file, NULL, PAGE_READWRITE,
+					    (DWORD)((uint64_t)size >> 32),
+					    (DWORD)size, NULL);
+	if (!spill->mapping)
+		return false;
+
+	spill->data = MapViewOfFile(spill->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+				    size);
+	return !!spill->data;
+}
+#else
+static bool map_spill_file(struct replay_spill *spill, const char *dir,
+			   size_t size)
+{
+	struct dstr path = {0};
+	void *ptr;
+	int fd;
+
+	dstr_copy(&path, dir);
+	dstr_replace(&path, "\\", "/");
+	if (dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, ".obs-replay-spill-XXXXXX");
+
+	fd = mkstemp(path.array);
+	if (fd != -1)
+		unlink(path.array);
+	dstr_free(&path);
+
+	if (fd == -1)
+		return false;
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		close(fd);
+		return false;
+	}
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+		return false;
+
+	spill->data = ptr;
+	return true;
+}
+#endif
+
+bool replay_spill_init(struct replay_spill *spill, const char *dir,
+		       size_t size)
+{
+	memset(spill, 0, sizeof(*spill));
+
+	if (!dir || !*dir || !size)
+		return false;
+
+	if (!map_spill_file(spill, dir, size)) {
+		replay_spill_free(spill);
+		return false;
+	}
+
+	spill->capacity = size;
+	return true;
+}
+
+void replay_spill_free(struct replay_spill *spill)
+{
+#ifdef _WIN32
+	if (spill->data)
+		UnmapViewOfFile(spill->data);
+	if (spill->mapping)
+		CloseHandle(spill->mapping);
+	if (spill->file)
+		CloseHandle(spill->file);
+#else
+	if (spill->data)
+		munmap(spill->data, spill->capacity);
+#endif
+	memset(spill, 0, sizeof(*spill));
+}
+
+void replay_spill_reset(struct replay_spill *spill)
+{
+	spill->head = 0;
+	spill->tail = 0;
+	spill->used = 0;
+}
+
+uint8_t *replay_spill_push(struct replay_spill *spill, const uint8_t *data,
+			   size_t size)
+{
+	size_t off = spill->head;
+	size_t skip = 0;
+
+	if (!spill->data || !size || size > spill->capacity)
+		return NULL;
+
+	if (spill->capacity - off < size) {
+		skip = spill->capacity - off;
+		off = 0;
+	}
+
+	if (spill->used + skip + size > spill->capacity)
+		return NULL;
+
+	memcpy(spill->data + off, data, size);
+	spill->used += skip + size;
+	spill->head = off + size;
+	return spill->data + off;
+}
+
+void replay_spill_pop(struct replay_spill *spill, const uint8_t *data,
+		      size_t size)
+{
+	size_t off = (size_t)(data - spill->data);
+	size_t consumed = size;
+
+	if (off < spill->tail)
+		consumed += spill->capacity - spill->tail;
+
+	spill->tail = off + size;
+	spill->used -= consumed;
+
+	if (!spill->used)
+		replay_spill_reset(spill);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/*
+ * Circular, memory-mapped spill file for the replay buffer.
+ *
+ * The replay buffer moves the payloads of its oldest packets in here so
+ * that only the most recent part of the buffer is kept on the heap.  The
+ * mapping is file backed, so the kernel can write the pages out and
+ * reclaim them under memory pressure.
+ *
+ * Payloads are pushed and popped in FIFO order and are always stored
+ * contiguously.  If a payload does not fit between the write offset and the
+ * end of the file it is placed at the start, and the skipped bytes are
+ * accounted for when it is popped.
+ */
+
+struct replay_spill {
+	uint8_t *data;
+	size_t capacity;
+	size_t head;
+	size_t tail;
+	size_t used;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+extern bool replay_spill_init(struct replay_spill *spill, const char *dir,
+			      size_t size);
+extern void replay_spill_free(struct replay_spill *spill);
+extern void replay_spill_reset(struct replay_spill *spill);
+
+/* copies a payload into the spill file, returns NULL if it is full */
+extern uint8_t *replay_spill_push(struct replay_spill *spill,
+				  const uint8_t *data, size_t size);
+/* releases the oldest payload, which must be the one at data */
+extern void replay_spill_pop(struct replay_spill *spill, const uint8_t *data,
+			     size_t size);
+
+static inline bool replay_spill_contains(const struct replay_spill *spill,
+					 const uint8_t *data)
+{
+	return spill->data && data >= spill->data &&
+	       data < spill->data + spill->capacity;
+}
@@ -18,6 +18,7 @@
 #include <util/threading.h>
 #include <util/platform.h>
 #include <util/dstr.h>
+#include <util/metrics.h>
 
 #include "obs-ffmpeg-compat.h"
 #include "obs-ffmpeg-formats.h"
@@ -43,14 +44,17 @@ struct ffmpeg_source {
 	char *input_format;
 	char *ffmpeg_options;
 	int buffering_mb;
+	int network_buffer_ms;
 	int speed_percent;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
+	bool is_gpu_frames;
 	bool full_decode;
 	bool is_clear_on_media_end;
 	bool restart_on_activate;
 	bool close_when_inactive;
+	bool share_decoder;
 	bool seekable;
 	bool is_stinger;
 	bool is_track_matte;
@@ -66,6 +70,10 @@ struct ffmpeg_source {
 	enum obs_media_state state;
 	obs_hotkey_pair_id play_pause_hotkey;
 	obs_hotkey_id stop_hotkey;
+
+	metric_t *buffer_metric;
+	metric_t *underrun_metric;
+	long underruns;
 };
 
 // Used to safely cancel and join any active reconnect threads
@@ -103,6 +111,8 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_t *local_file = obs_properties_get(props, "local_file");
 	obs_property_t *looping = obs_properties_get(props, "looping");
 	obs_property_t *buffering = obs_properties_get(props, "buffering_mb");
+	obs_property_t *network_buffer =
+		obs_properties_get(props, "network_buffer_ms");
 	obs_property_t *seekable = obs_properties_get(props, "seekable");
 	obs_property_t *speed = obs_properties_get(props, "speed_percent");
 	obs_property_t *reconnect_delay_sec =
@@ -110,6 +120,7 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_set_visible(input, !enabled);
 	obs_property_set_visible(input_format, !enabled);
 	obs_property_set_visible(buffering, !enabled);
+	obs_property_set_visible(network_buffer, !enabled);
 	obs_property_set_visible(local_file, enabled);
 	obs_property_set_visible(looping, enabled);
 	obs_property_set_visible(speed, enabled);
@@ -128,6 +139,7 @@ static void ffmpeg_source_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "linear_alpha", false);
 	obs_data_set_default_int(settings, "reconnect_delay_sec", 10);
 	obs_data_set_default_int(settings, "buffering_mb", 2);
+	obs_data_set_default_int(settings, "network_buffer_ms", 2000);
 	obs_data_set_default_int(settings, "speed_percent", 100);
 	obs_data_set_default_bool(settings, "log_changes", true);
 }
@@ -190,6 +202,13 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 					     16, 1);
 	obs_property_int_set_suffix(prop, " MB");
 
+	prop = obs_properties_add_int_slider(props, "network_buffer_ms",
+					     obs_module_text("NetworkBuffer"),
+					     0, 10000, 100);
+	obs_property_int_set_suffix(prop, " ms");
+	obs_property_set_long_description(
+		prop, obs_module_text("NetworkBuffer.ToolTip"));
+
 	obs_properties_add_text(props, "input", obs_module_text("Input"),
 				OBS_TEXT_DEFAULT);
 
@@ -205,6 +224,11 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 	obs_properties_add_bool(props, "hw_decode",
 				obs_module_text("HardwareDecode"));
 
+#ifdef __linux__
+	obs_properties_add_bool(props, "hw_gpu_frames",
+				obs_module_text("HardwareDecodeGPUFrames"));
+#endif
+
 	obs_properties_add_bool(props, "clear_on_media_end",
 				obs_module_text("ClearOnMediaEnd"));
 
@@ -215,6 +239,11 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 	obs_property_set_long_description(
 		prop, obs_module_text("CloseFileWhenInactive.ToolTip"));
 
+	prop = obs_properties_add_bool(props, "share_decoder",
+				       obs_module_text("ShareDecoder"));
+	obs_property_set_long_description(
+		prop, obs_module_text("ShareDecoder.ToolTip"));
+
 	prop = obs_properties_add_int_slider(props, "speed_percent",
 					     obs_module_text("SpeedPercentage"),
 					     1, 200, 1);
@@ -258,6 +287,7 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tis_looping:              %s\n"
 		"\tis_linear_alpha:         %s\n"
 		"\tis_hw_decoding:          %s\n"
+		"\tis_gpu_frames:           %s\n"
 		"\tis_clear_on_media_end:   %s\n"
 		"\trestart_on_activate:     %s\n"
 		"\tclose_when_inactive:     %s\n"
@@ -267,6 +297,7 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		input_format ? input_format : "(null)", s->speed_percent,
 		s->is_looping ? "yes" : "no", s->is_linear_alpha ? "yes" : "no",
 		s->is_hw_decoding ? "yes" : "no",
+		s->is_gpu_frames ? "yes" : "no",
 		s->is_clear_on_media_end ? "yes" : "no",
 		s->restart_on_activate ? "yes" : "no",
 		s->close_when_inactive ? "yes" : "no",
@@ -279,6 +310,22 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static void get_shared_frame(void *opaque, struct obs_source_frame *f,
+			     void *shared_frame)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_output_video_nocopy(s->source, f, mp_shared_frame_release,
+				       shared_frame);
+}
+
+static void get_gpu_frame(void *opaque, struct obs_source_frame *f,
+			  void *gpu_frame)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_output_video_gpu(s->source, f, mp_gpu_frame_import,
+				    mp_gpu_frame_release, gpu_frame);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -326,9 +373,14 @@ static void media_stopped(void *opaque)
 static void ffmpeg_source_open(struct ffmpeg_source *s)
 {
 	if (s->input && *s->input) {
+		char *index_dir = s->is_local_file
+					  ? obs_module_config_path("seek-index")
+					  : NULL;
 		struct mp_media_info info = {
 			.opaque = s,
 			.v_cb = get_frame,
+			.v_gpu_cb = s->is_gpu_frames ? get_gpu_frame : NULL,
+			.v_shared_cb = get_shared_frame,
 			.v_preload_cb = preload_frame,
 			.v_seek_cb = seek_frame,
 			.a_cb = get_audio,
@@ -336,6 +388,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.path = s->input,
 			.format = s->input_format,
 			.buffering = s->buffering_mb * 1024 * 1024,
+			.prebuffer_ms = s->network_buffer_ms,
 			.speed = s->speed_percent,
 			.force_range = s->range,
 			.is_linear_alpha = s->is_linear_alpha,
@@ -345,9 +398,12 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.reconnecting = s->reconnecting,
 			.request_preload = s->is_stinger,
 			.full_decode = s->full_decode,
+			.share_decoder = s->share_decoder,
+			.index_dir = index_dir,
 		};
 
 		s->media = media_playback_create(&info);
+		bfree(index_dir);
 	}
 }
 
@@ -388,11 +444,45 @@ static void *ffmpeg_source_reconnect(void *data)
 	return NULL;
 }
 
+static void update_buffer_metrics(struct ffmpeg_source *s)
+{
+	struct mp_buffer_stats stats;
+
+	if (!s->buffer_metric) {
+		struct dstr labels = {0};
+
+		metric_label_cat(&labels, "source",
+				 obs_source_get_name(s->source));
+		s->buffer_metric = metric_get(
+			METRIC_GAUGE, "obs_media_buffer_milliseconds",
+			labels.array, "Network input read ahead of playback");
+		s->underrun_metric = metric_get(
+			METRIC_COUNTER, "obs_media_buffer_underruns_total",
+			labels.array,
+			"Times playback of a network input waited for data");
+		dstr_free(&labels);
+	}
+
+	/* the count restarts when the media is reopened */
+	media_playback_get_buffer_stats(s->media, &stats);
+	if (stats.underruns != s->underruns)
+		metric_add(s->underrun_metric,
+			   stats.underruns > s->underruns
+				   ? stats.underruns - s->underruns
+				   : stats.underruns);
+	s->underruns = stats.underruns;
+
+	metric_set(s->buffer_metric, stats.buffered_ns / 1000000);
+}
+
 static void ffmpeg_source_tick(void *data, float seconds)
 {
 	UNUSED_PARAMETER(seconds);
 
 	struct ffmpeg_source *s = data;
+	if (s->media && !s->is_local_file)
+		update_buffer_metrics(s);
+
 	if (s->destroy_media) {
 		if (s->media) {
 			media_playback_destroy(s->media);
@@ -443,8 +533,10 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	const char *ffmpeg_options;
 
 	bool is_hw_decoding;
+	bool is_gpu_frames;
 	enum video_range_type range;
 	bool is_linear_alpha;
+	bool share_decoder;
 	int speed_percent;
 	bool is_looping;
 
@@ -472,14 +564,22 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	stop_reconnect_thread(s);
 
 	is_hw_decoding = obs_data_get_bool(settings, "hw_decode");
+	is_gpu_frames = is_hw_decoding &&
+			obs_data_get_bool(settings, "hw_gpu_frames");
 	range = obs_data_get_int(settings, "color_range");
 	speed_percent = (int)obs_data_get_int(settings, "speed_percent");
 	if (speed_percent < 1 || speed_percent > 200)
 		speed_percent = 100;
 	ffmpeg_options = obs_data_get_string(settings, "ffmpeg_options");
+	share_decoder = obs_data_get_bool(settings, "share_decoder");
+	is_linear_alpha = obs_data_get_bool(settings, "linear_alpha");
 
-	/* Restart media source if these properties are changed */
-	if (s->is_hw_decoding != is_hw_decoding || s->range != range ||
+	/* Restart media source if these properties are changed, a shared
+	 * decoder can't change the alpha mode of the other sources */
+	if (s->share_decoder != share_decoder ||
+	    (share_decoder && s->is_linear_alpha != is_linear_alpha) ||
+	    s->is_hw_decoding != is_hw_decoding ||
+	    s->is_gpu_frames != is_gpu_frames || s->range != range ||
 	    s->speed_percent != speed_percent ||
 	    (s->ffmpeg_options &&
 	     strcmp(s->ffmpeg_options, ffmpeg_options) != 0))
@@ -502,6 +602,7 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	s->input = input ? bstrdup(input) : NULL;
 	s->input_format = input_format ? bstrdup(input_format) : NULL;
 	s->is_hw_decoding = is_hw_decoding;
+	s->is_gpu_frames = is_gpu_frames;
 	s->full_decode = obs_data_get_bool(settings, "full_decode");
 	s->is_clear_on_media_end =
 		obs_data_get_bool(settings, "clear_on_media_end");
@@ -510,9 +611,11 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 			? false
 			: obs_data_get_bool(settings, "restart_on_activate");
 	s->range = range;
-	is_linear_alpha = obs_data_get_bool(settings, "linear_alpha");
 	s->is_linear_alpha = is_linear_alpha;
+	s->share_decoder = share_decoder;
 	s->buffering_mb = (int)obs_data_get_int(settings, "buffering_mb");
+	s->network_buffer_ms =
+		(int)obs_data_get_int(settings, "network_buffer_ms");
 	s->speed_percent = speed_percent;
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
@@ -704,6 +807,8 @@ static void ffmpeg_source_destroy(void *data)
 	if (s->media)
 		media_playback_destroy(s->media);
 
+	metric_release(s->buffer_metric);
+	metric_release(s->underrun_metric);
 	pthread_mutex_destroy(&s->reconnect_mutex);
 	os_event_destroy(s->reconnect_stop_event);
 	bfree(s->input);
@@ -31,6 +31,9 @@
 #define SRT_LIVE_DEFAULT_PAYLOAD_SIZE 1316
 #endif
 
+/* Maximum number of local addresses a bonded caller connects from */
+#define SRT_MAX_BOND_LINKS 8
+
 enum SRTMode {
 	SRT_MODE_CALLER = 0,
 	SRT_MODE_LISTENER = 1,
@@ -80,6 +83,11 @@ typedef struct SRTContext {
 	char *localport;
 	int linger;
 	int tsbpd;
+#if SRT_VERSION_VALUE >= 0x010500
+	char *bondip;
+	SRT_GROUP_TYPE bondmode;
+	int bonded;
+#endif
 	double time; // time in s in order to post logs at definite intervals
 } SRTContext;
 
@@ -450,6 +458,107 @@ static int libsrt_set_options_pre(URLContext *h, SRTSOCKET fd)
 	return 0;
 }
 
+#if SRT_VERSION_VALUE >= 0x010500
+/* Bonded caller: connects a socket group with one member link bound to each
+ * local address listed in "bondip".  A broadcast group sends every packet
+ * over all links and the receiver keeps whichever copy arrives first; a
+ * backup group sends over one link and fails over to the next, preferring
+ * addresses in the order they are listed. */
+static int libsrt_setup_group(URLContext *h, const struct addrinfo *target)
+{
+	SRTContext *s = (SRTContext *)h->priv_data;
+	SRT_SOCKGROUPCONFIG links[SRT_MAX_BOND_LINKS];
+	char *list = av_strdup(s->bondip);
+	char *save = NULL;
+	int count = 0;
+	int connected = 0;
+	SRTSOCKET grp;
+	int ret, eid;
+
+	if (!list)
+		return AVERROR(ENOMEM);
+
+	char *ip = av_strtok(list, ",", &save);
+	for (; ip && count < SRT_MAX_BOND_LINKS;
+	     ip = av_strtok(NULL, ",", &save)) {
+		struct addrinfo hints = {0}, *ai;
+
+		hints.ai_family = target->ai_family;
+		hints.ai_socktype = SOCK_DGRAM;
+		hints.ai_flags = AI_NUMERICHOST | AI_PASSIVE;
+		if (getaddrinfo(ip, "0", &hints, &ai)) {
+			blog(LOG_WARNING,
+			     "[obs-ffmpeg mpegts muxer / libsrt]: Ignoring invalid bond address %s",
+			     ip);
+			continue;
+		}
+
+		links[count] = srt_prepare_endpoint(ai->ai_addr,
+						    target->ai_addr,
+						    (int)target->ai_addrlen);
+		links[count].weight = (uint16_t)(SRT_MAX_BOND_LINKS - count);
+		freeaddrinfo(ai);
+		count++;
+	}
+	av_free(list);
+
+	if (!count) {
+		blog(LOG_ERROR,
+		     "[obs-ffmpeg mpegts muxer / libsrt]: No usable bond address");
+		return OBS_OUTPUT_CONNECT_FAILED;
+	}
+
+	grp = srt_create_group(s->bondmode);
+	if (grp == SRT_INVALID_SOCK)
+		return libsrt_neterrno(h);
+
+	if ((ret = libsrt_set_options_pre(h, grp)) < 0)
+		goto fail;
+
+	/* A blocking group connect returns as soon as the first link is up,
+	 * the remaining links keep connecting in the background. */
+	if (libsrt_socket_nonblock(grp, 0) < 0)
+		blog(LOG_DEBUG,
+		     "[obs-ffmpeg mpegts muxer / libsrt]: libsrt_socket_nonblock failed");
+	if (srt_connect_group(grp, links, count) < 0) {
+		ret = libsrt_neterrno(h);
+		goto fail;
+	}
+	if (libsrt_socket_nonblock(grp, 1) < 0)
+		blog(LOG_DEBUG,
+		     "[obs-ffmpeg mpegts muxer / libsrt]: libsrt_socket_nonblock failed");
+
+	for (int i = 0; i < count; i++) {
+		if (links[i].errorcode == SRT_SUCCESS)
+			connected++;
+	}
+	blog(LOG_INFO,
+	     "[obs-ffmpeg mpegts muxer / libsrt]: %s group connected, %d of %d links up",
+	     s->bondmode == SRT_GTYPE_BACKUP ? "Backup" : "Broadcast",
+	     connected, count);
+
+	if ((ret = libsrt_set_options_post(h, grp)) < 0)
+		goto fail;
+
+	h->max_packet_size = s->payload_size > 0
+				     ? s->payload_size
+				     : SRT_LIVE_DEFAULT_PAYLOAD_SIZE;
+
+	ret = eid = libsrt_epoll_create(h, grp, 1);
+	if (eid < 0)
+		goto fail;
+
+	s->fd = grp;
+	s->eid = eid;
+	s->bonded = 1;
+	return 0;
+
+fail:
+	srt_close(grp);
+	return ret;
+}
+#endif
+
 static int libsrt_setup(URLContext *h, const char *uri)
 {
 	struct addrinfo hints = {0}, *ai, *cur_ai;
@@ -524,6 +633,13 @@ static int libsrt_setup(URLContext *h, const char *uri)
 		la.sin_port = htons(port);
 		inet_pton(AF_INET, s->localip, &la.sin_addr.s_addr);
 	}
+#if SRT_VERSION_VALUE >= 0x010500
+	if (s->bondip && s->mode == SRT_MODE_CALLER) {
+		ret = libsrt_setup_group(h, ai);
+		freeaddrinfo(ai);
+		return ret;
+	}
+#endif
 restart:
 
 	fd = srt_create_socket();
@@ -656,6 +772,9 @@ static void libsrt_set_defaults(SRTContext *s)
 	s->transtype = SRTT_LIVE;
 	s->linger = -1;
 	s->tsbpd = -1;
+#if SRT_VERSION_VALUE >= 0x010500
+	s->bondmode = SRT_GTYPE_BROADCAST;
+#endif
 }
 
 static int libsrt_open(URLContext *h, const char *uri)
@@ -809,6 +928,26 @@ static int libsrt_open(URLContext *h, const char *uri)
 		if (av_find_info_tag(buf, sizeof(buf), "localport", p)) {
 			s->localport = av_strndup(buf, strlen(buf));
 		}
+#if SRT_VERSION_VALUE >= 0x010500
+		if (av_find_info_tag(buf, sizeof(buf), "bondip", p)) {
+			av_freep(&s->bondip);
+			s->bondip = av_strdup(buf);
+			if (!s->bondip) {
+				ret = AVERROR(ENOMEM);
+				goto err;
+			}
+		}
+		if (av_find_info_tag(buf, sizeof(buf), "bondmode", p)) {
+			if (!strcmp(buf, "broadcast")) {
+				s->bondmode = SRT_GTYPE_BROADCAST;
+			} else if (!strcmp(buf, "backup")) {
+				s->bondmode = SRT_GTYPE_BACKUP;
+			} else {
+				ret = AVERROR(EINVAL);
+				goto err;
+			}
+		}
+#endif
 	}
 	ret = libsrt_setup(h, uri);
 	if (ret < 0)
@@ -829,6 +968,9 @@ static int libsrt_open(URLContext *h, const char *uri)
 err:
 	av_freep(&s->smoother);
 	av_freep(&s->streamid);
+#if SRT_VERSION_VALUE >= 0x010500
+	av_freep(&s->bondip);
+#endif
 	srt_cleanup();
 	return ret;
 }
@@ -875,6 +1017,82 @@ static int libsrt_write(URLContext *h, const uint8_t *buf, int size)
 	return ret;
 }
 
+struct libsrt_stats {
+	double rtt_ms;
+	int64_t packets_retransmitted;
+	int send_buffer_bytes;
+	int send_buffer_ms;
+	int latency_ms;
+};
+
+#if SRT_VERSION_VALUE >= 0x010500
+/* A broadcast group keeps delivering as long as one link keeps up, so the
+ * link with the least data queued is what limits the stream.  A backup
+ * group only sends over its active links, idle ones are skipped. */
+static void libsrt_get_group_stats(SRTContext *s, struct libsrt_stats *stats)
+{
+	SRT_SOCKGROUPDATA links[SRT_MAX_BOND_LINKS];
+	size_t count = SRT_MAX_BOND_LINKS;
+	int64_t retransmitted = 0;
+	bool found = false;
+
+	memset(stats, 0, sizeof(*stats));
+	if (srt_group_data(s->fd, links, &count) < 0)
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		SRT_TRACEBSTATS perf = {0};
+		int latency = 0;
+		int len = sizeof(latency);
+
+		if (links[i].sockstate != SRTS_CONNECTED)
+			continue;
+		if (s->bondmode == SRT_GTYPE_BACKUP &&
+		    links[i].memberstate != SRT_GST_RUNNING)
+			continue;
+		if (srt_bstats(links[i].id, &perf, 0) < 0)
+			continue;
+
+		retransmitted += perf.pktRetransTotal;
+		if (found && perf.msSndBuf >= stats->send_buffer_ms)
+			continue;
+
+		srt_getsockflag(links[i].id, SRTO_PEERLATENCY, &latency, &len);
+		stats->rtt_ms = perf.msRTT;
+		stats->send_buffer_bytes = perf.byteSndBuf;
+		stats->send_buffer_ms = perf.msSndBuf;
+		stats->latency_ms = latency;
+		found = true;
+	}
+
+	stats->packets_retransmitted = retransmitted;
+}
+#endif
+
+/* cumulative statistics of the connection, call from the writing thread */
+static void libsrt_get_stats(URLContext *h, struct libsrt_stats *stats)
+{
+	SRTContext *s = (SRTContext *)h->priv_data;
+	SRT_TRACEBSTATS perf = {0};
+	int latency = 0;
+	int len = sizeof(latency);
+
+#if SRT_VERSION_VALUE >= 0x010500
+	if (s->bonded) {
+		libsrt_get_group_stats(s, stats);
+		return;
+	}
+#endif
+	srt_bstats(s->fd, &perf, 0);
+	srt_getsockflag(s->fd, SRTO_PEERLATENCY, &latency, &len);
+
+	stats->rtt_ms = perf.msRTT;
+	stats->packets_retransmitted = perf.pktRetransTotal;
+	stats->send_buffer_bytes = perf.byteSndBuf;
+	stats->send_buffer_ms = perf.msSndBuf;
+	stats->latency_ms = latency;
+}
+
 static int libsrt_close(URLContext *h)
 {
 	SRTContext *s = (SRTContext *)h->priv_data;
@@ -882,6 +1100,10 @@ static int libsrt_close(URLContext *h)
 		av_freep(&s->streamid);
 	if (s->passphrase)
 		av_freep(&s->passphrase);
+#if SRT_VERSION_VALUE >= 0x010500
+	if (s->bondip)
+		av_freep(&s->bondip);
+#endif
 	/* Log stream stats. */
 	SRT_TRACEBSTATS perf = {0};
 	srt_bstats(s->fd, &perf, 1);
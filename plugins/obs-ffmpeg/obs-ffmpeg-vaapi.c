@@ -56,6 +56,9 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
+/* a texture copy that takes longer than this means the GPU is hung */
+#define VAAPI_COPY_TIMEOUT_NS 1000000000ULL
+
 enum codec_type {
 	CODEC_H264,
 	CODEC_HEVC,
@@ -851,7 +854,18 @@ static bool vaapi_encode_tex(void *data, struct encoder_texture *texture,
 		gs_texture_destroy(surface.textures[i]);
 	}
 
-	gs_flush();
+	/* VA-API reads the surfaces outside of the graphics API, so wait for
+	 * the copies explicitly instead of relying on implicit dmabuf sync,
+	 * which not every driver provides */
+	gs_sync_t *sync = gs_sync_create();
+	if (sync) {
+		if (!gs_sync_wait(sync, VAAPI_COPY_TIMEOUT_NS))
+			warn("vaapi_encode_tex: timed out waiting for the "
+			     "texture copy");
+		gs_sync_destroy(sync);
+	} else {
+		gs_flush();
+	}
 
 	obs_leave_graphics();
 
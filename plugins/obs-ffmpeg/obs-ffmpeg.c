@@ -3,6 +3,7 @@
 #include <libavutil/avutil.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <media-playback/media-playback.h>
 
 #ifdef _WIN32
 #include <dxgi.h>
@@ -34,6 +35,7 @@ extern struct obs_output_info ffmpeg_muxer;
 extern struct obs_output_info ffmpeg_mpegts_muxer;
 extern struct obs_output_info replay_buffer;
 extern struct obs_output_info ffmpeg_hls_muxer;
+extern struct obs_output_info ffmpeg_cmaf_muxer;
 extern struct obs_encoder_info aac_encoder_info;
 extern struct obs_encoder_info opus_encoder_info;
 extern struct obs_encoder_info pcm_encoder_info;
@@ -365,6 +367,7 @@ bool obs_module_load(void)
 	obs_register_output(&ffmpeg_muxer);
 	obs_register_output(&ffmpeg_mpegts_muxer);
 	obs_register_output(&ffmpeg_hls_muxer);
+	obs_register_output(&ffmpeg_cmaf_muxer);
 	obs_register_output(&replay_buffer);
 	obs_register_encoder(&aac_encoder_info);
 	register_encoder_if_available(&svt_av1_encoder_info, "libsvtav1");
@@ -440,6 +443,8 @@ bool obs_module_load(void)
 
 void obs_module_unload(void)
 {
+	media_playback_purge_cache();
+
 #if ENABLE_FFMPEG_LOGGING
 	obs_ffmpeg_unload_logging();
 #endif
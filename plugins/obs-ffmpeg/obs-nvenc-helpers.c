@@ -275,6 +275,8 @@ static const cuda_function cuda_functions[] = {
 	{offsetof(CudaFunctions, cuArray3DCreate), "cuArray3DCreate_v2"},
 	{offsetof(CudaFunctions, cuArrayDestroy), "cuArrayDestroy"},
 	{offsetof(CudaFunctions, cuMemcpy2D), "cuMemcpy2D_v2"},
+	{offsetof(CudaFunctions, cuMemcpy2DAsync), "cuMemcpy2DAsync_v2"},
+	{offsetof(CudaFunctions, cuStreamSynchronize), "cuStreamSynchronize"},
 
 	{offsetof(CudaFunctions, cuGetErrorName), "cuGetErrorName"},
 	{offsetof(CudaFunctions, cuGetErrorString), "cuGetErrorString"},
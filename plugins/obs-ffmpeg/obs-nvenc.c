@@ -3,6 +3,7 @@
 #include <util/deque.h>
 #include <util/darray.h>
 #include <util/dstr.h>
+#include <util/threading.h>
 #include <obs-avc.h>
 #include <obs-hevc.h>
 
@@ -157,6 +158,10 @@ struct nvenc_data {
 	uint32_t roi_increment;
 
 	CUcontext cu_ctx;
+
+	/* CUDA device the session counts towards, see gpu_sessions */
+	int gpu;
+	bool gpu_counted;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -1252,6 +1257,44 @@ static bool init_cuda_surfaces(struct nvenc_data *enc)
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* GPU Load Balancing                                                        */
+
+#define MAX_GPUS 8
+
+/* sessions opened by this module per CUDA device, encoders with "gpu_auto"
+ * set are created on the device with the fewest of them */
+static volatile long gpu_sessions[MAX_GPUS];
+
+static int get_least_loaded_gpu(obs_encoder_t *encoder)
+{
+	int count = 0;
+	int gpu = 0;
+
+	if (!init_cuda(encoder) || cu->cuInit(0) != CUDA_SUCCESS ||
+	    cu->cuDeviceGetCount(&count) != CUDA_SUCCESS)
+		return 0;
+	if (count > MAX_GPUS)
+		count = MAX_GPUS;
+
+	/* ties go to the lower index, so that the GPU OBS renders on and that
+	 * can take textures directly is preferred */
+	for (int i = 1; i < count; i++) {
+		if (os_atomic_load_long(&gpu_sessions[i]) <
+		    os_atomic_load_long(&gpu_sessions[gpu]))
+			gpu = i;
+	}
+
+	return gpu;
+}
+
+static inline int get_gpu_setting(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	if (obs_data_get_bool(settings, "gpu_auto"))
+		return get_least_loaded_gpu(encoder);
+	return (int)obs_data_get_int(settings, "gpu");
+}
+
 static bool init_cuda_ctx(struct nvenc_data *enc, obs_data_t *settings,
 			  const bool texture)
 {
@@ -1264,7 +1307,7 @@ static bool init_cuda_ctx(struct nvenc_data *enc, obs_data_t *settings,
 		gpu = (int)obs_data_get_int(settings, "cuda_device");
 		cuda_override = true;
 	} else {
-		gpu = (int)obs_data_get_int(settings, "gpu");
+		gpu = get_gpu_setting(settings, enc->encoder);
 		cuda_override = false;
 	}
 
@@ -1318,6 +1361,8 @@ static bool init_cuda_ctx(struct nvenc_data *enc, obs_data_t *settings,
 	CU_FAILED(cu->cuCtxCreate(&enc->cu_ctx, 0, device))
 	CU_FAILED(cu->cuCtxPopCurrent(NULL))
 
+	if (!texture || cuda_override)
+		enc->gpu = gpu;
 	return true;
 }
 
@@ -1493,6 +1538,11 @@ static void *nvenc_create_internal(enum codec_type codec, obs_data_t *settings,
 	if (enc->cu_ctx)
 		cu->cuCtxPopCurrent(NULL);
 
+	if (enc->gpu >= 0 && enc->gpu < MAX_GPUS) {
+		os_atomic_inc_long(&gpu_sessions[enc->gpu]);
+		enc->gpu_counted = true;
+	}
+
 	return enc;
 
 fail:
@@ -1505,11 +1555,14 @@ static void *nvenc_create_base(enum codec_type codec, obs_data_t *settings,
 {
 	/* this encoder requires shared textures, this cannot be used on a
 	 * gpu other than the one OBS is currently running on. */
-	const int gpu = (int)obs_data_get_int(settings, "gpu");
+	const int gpu = get_gpu_setting(settings, encoder);
 	if (gpu != 0 && texture) {
 		blog(LOG_INFO,
-		     "[obs-nvenc] different GPU selected by user, falling back "
-		     "to non-texture encoder");
+		     "[obs-nvenc] different GPU %s, falling back to "
+		     "non-texture encoder",
+		     obs_data_get_bool(settings, "gpu_auto")
+			     ? "is less loaded"
+			     : "selected by user");
 		goto reroute;
 	}
 
@@ -1602,6 +1655,9 @@ static void nvenc_destroy(void *data)
 {
 	struct nvenc_data *enc = data;
 
+	if (enc->gpu_counted)
+		os_atomic_dec_long(&gpu_sessions[enc->gpu]);
+
 	if (enc->cu_ctx)
 		cu->cuCtxPushCurrent(enc->cu_ctx);
 
@@ -2096,11 +2152,14 @@ static inline bool copy_tex_cuda(struct nvenc_data *enc, const bool p010,
 	m.WidthInBytes = p010 ? enc->cx * 2 : enc->cx;
 	m.Height = enc->cy;
 
+	/* Both planes are queued device-to-device and waited on once, the
+	 * frame never leaves GPU memory */
+
 	// Map and copy Y texture
 	CU_CHECK(cu->cuGraphicsSubResourceGetMappedArray(&mapped_cuda,
 							 mapped_tex[0], 0, 0));
 	m.srcArray = mapped_cuda;
-	CU_CHECK(cu->cuMemcpy2D(&m))
+	CU_CHECK(cu->cuMemcpy2DAsync(&m, NULL))
 
 	// Map and copy UV texture
 	CU_CHECK(cu->cuGraphicsSubResourceGetMappedArray(&mapped_cuda,
@@ -2109,7 +2168,8 @@ static inline bool copy_tex_cuda(struct nvenc_data *enc, const bool p010,
 	m.dstY += enc->cy;
 	m.Height = enc->cy / 2;
 
-	CU_CHECK(cu->cuMemcpy2D(&m))
+	CU_CHECK(cu->cuMemcpy2DAsync(&m, NULL))
+	CU_CHECK(cu->cuStreamSynchronize(NULL))
 
 unmap:
 	cu->cuGraphicsUnmapResources(2, mapped_tex, 0);
@@ -3,11 +3,14 @@
 #include <obs-module.h>
 #include <obs-avc.h>
 
+#include <condition_variable>
 #include <unordered_map>
 #include <cstdlib>
 #include <memory>
 #include <sstream>
 #include <vector>
+#include <thread>
+#include <chrono>
 #include <mutex>
 #include <deque>
 #include <map>
@@ -97,7 +100,16 @@ struct amf_base {
 	AMFBufferPtr header;
 	AMFSurfacePtr roi_map;
 
+	/* packets are retrieved on a separate thread, so encode only ever
+	 * has to submit frames and pick up whatever is ready */
+	std::thread output_thread;
+	std::mutex output_mutex;
+	std::condition_variable output_cv;
 	std::deque<AMFDataPtr> queued_packets;
+	AMF_RESULT output_error = AMF_OK;
+	uint32_t frames_in_flight = 0;
+	uint32_t max_in_flight = 0;
+	bool stop_output = false;
 
 	AMF_VIDEO_CONVERTER_COLOR_PROFILE_ENUM amf_color_profile;
 	AMF_COLOR_TRANSFER_CHARACTERISTIC_ENUM amf_characteristic;
@@ -120,8 +132,21 @@ struct amf_base {
 	bool roi_supported = false;
 
 	inline amf_base(bool fallback) : fallback(fallback) {}
-	virtual ~amf_base() = default;
+	virtual ~amf_base() { stop_output_thread(); }
 	virtual void init() = 0;
+
+	inline void stop_output_thread()
+	{
+		if (!output_thread.joinable())
+			return;
+
+		{
+			std::scoped_lock lock(output_mutex);
+			stop_output = true;
+		}
+		output_cv.notify_all();
+		output_thread.join();
+	}
 };
 
 using d3dtex_t = ComPtr<ID3D11Texture2D>;
@@ -135,12 +160,17 @@ struct amf_texencode : amf_base, public AMFSurfaceObserver {
 	std::mutex textures_mutex;
 	std::vector<d3dtex_t> available_textures;
 	std::unordered_map<AMFSurface *, d3dtex_t> active_textures;
+	bool textures_allocated = false;
 
 	ComPtr<ID3D11Device> device;
 	ComPtr<ID3D11DeviceContext> context;
 
 	inline amf_texencode() : amf_base(false) {}
-	~amf_texencode() { os_atomic_set_bool(&destroying, true); }
+	~amf_texencode()
+	{
+		stop_output_thread();
+		os_atomic_set_bool(&destroying, true);
+	}
 
 	void AMF_STD_CALL OnSurfaceDataRelease(amf::AMFSurface *surf) override
 	{
@@ -172,7 +202,11 @@ struct amf_fallback : amf_base, public AMFSurfaceObserver {
 	std::unordered_map<AMFSurface *, buf_t> active_buffers;
 
 	inline amf_fallback() : amf_base(true) {}
-	~amf_fallback() { os_atomic_set_bool(&destroying, true); }
+	~amf_fallback()
+	{
+		stop_output_thread();
+		os_atomic_set_bool(&destroying, true);
+	}
 
 	void AMF_STD_CALL OnSurfaceDataRelease(amf::AMFSurface *surf) override
 	{
@@ -354,10 +388,35 @@ static inline bool get_available_tex(amf_texencode *enc,
 	return false;
 }
 
+/* without an in-flight limit, this is about how many frames the encoder
+ * holds on to at once */
+static constexpr uint32_t default_pool_size = 8;
+
+static void alloc_output_textures(amf_texencode *enc, ID3D11Texture2D *from)
+{
+	uint32_t count = enc->max_in_flight ? enc->max_in_flight + 1
+					    : default_pool_size;
+	std::vector<d3dtex_t> textures(count);
+
+	for (d3dtex_t &tex : textures)
+		add_output_tex(enc, tex, from);
+
+	std::scoped_lock lock(enc->textures_mutex);
+	enc->available_textures.insert(enc->available_textures.end(),
+				       textures.begin(), textures.end());
+}
+
 static inline void get_output_tex(amf_texencode *enc,
 				  ComPtr<ID3D11Texture2D> &output_tex,
 				  ID3D11Texture2D *from)
 {
+	/* allocate the whole pool up front, so the graphics thread doesn't
+	 * have to create textures while frames are in flight */
+	if (!enc->textures_allocated) {
+		alloc_output_textures(enc, from);
+		enc->textures_allocated = true;
+	}
+
 	if (!get_available_tex(enc, output_tex))
 		add_output_tex(enc, output_tex, from);
 }
@@ -677,56 +736,109 @@ static void add_roi(amf_base *enc, AMFSurface *amf_surf)
 				      enc->roi_map);
 }
 
+static void amf_output_thread(amf_base *enc)
+{
+	using namespace std::chrono_literals;
+	std::unique_lock lock(enc->output_mutex);
+
+	os_set_thread_name("amf: output");
+
+	while (!enc->stop_output) {
+		if (!enc->frames_in_flight) {
+			enc->output_cv.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+
+		AMFDataPtr new_packet;
+		AMF_RESULT res = enc->amf_encoder->QueryOutput(&new_packet);
+
+		lock.lock();
+
+		if (new_packet) {
+			enc->queued_packets.push_back(new_packet);
+			enc->frames_in_flight--;
+			enc->output_cv.notify_all();
+
+		} else if (res == AMF_REPEAT || res == AMF_OK) {
+			enc->output_cv.wait_for(lock, 1ms);
+
+		} else {
+			enc->output_error = res;
+			enc->output_cv.notify_all();
+			break;
+		}
+	}
+}
+
+static void amf_start_output_thread(amf_base *enc, obs_data_t *settings)
+{
+	enc->max_in_flight = (uint32_t)obs_data_get_int(settings, "in_flight");
+	enc->output_thread = std::thread(amf_output_thread, enc);
+}
+
 static void amf_encode_base(amf_base *enc, AMFSurface *amf_surf,
 			    encoder_packet *packet, bool *received_packet)
 {
+	using namespace std::chrono_literals;
 	auto &queued_packets = enc->queued_packets;
-	uint64_t ts_start = os_gettime_ns();
+	constexpr auto timeout = 5s;
 	AMF_RESULT res;
 
 	*received_packet = false;
 
-	bool waiting = true;
-	while (waiting) {
-		/* ----------------------------------- */
-		/* add ROI data (if any)               */
-		if (enc->roi_supported && obs_encoder_has_roi(enc->encoder))
-			add_roi(enc, amf_surf);
+	/* ----------------------------------- */
+	/* add ROI data (if any)               */
 
-		/* ----------------------------------- */
-		/* submit frame                        */
+	if (enc->roi_supported && obs_encoder_has_roi(enc->encoder))
+		add_roi(enc, amf_surf);
 
-		res = enc->amf_encoder->SubmitInput(amf_surf);
+	/* ----------------------------------- */
+	/* wait for room in the encoder        */
 
-		if (res == AMF_OK || res == AMF_NEED_MORE_INPUT) {
-			waiting = false;
+	auto can_submit = [enc]() {
+		return enc->output_error != AMF_OK || !enc->max_in_flight ||
+		       enc->frames_in_flight < enc->max_in_flight;
+	};
 
-		} else if (res == AMF_INPUT_FULL) {
-			os_sleep_ms(1);
+	std::unique_lock lock(enc->output_mutex);
+	if (!enc->output_cv.wait_for(lock, timeout, can_submit))
+		throw amf_error("Timed out waiting for output", AMF_INPUT_FULL);
 
-			uint64_t duration = os_gettime_ns() - ts_start;
-			constexpr uint64_t timeout = 5 * SEC_TO_NSEC;
+	/* ----------------------------------- */
+	/* submit frame                        */
 
-			if (duration >= timeout) {
-				throw amf_error("SubmitInput timed out", res);
-			}
-		} else {
-			throw amf_error("SubmitInput failed", res);
+	auto start = std::chrono::steady_clock::now();
+
+	for (;;) {
+		if (enc->output_error != AMF_OK)
+			throw amf_error("QueryOutput failed",
+					enc->output_error);
+
+		/* counted before submitting so the output thread never sees
+		 * a packet it isn't expecting */
+		enc->frames_in_flight++;
+		lock.unlock();
+
+		res = enc->amf_encoder->SubmitInput(amf_surf);
+
+		lock.lock();
+
+		if (res == AMF_OK || res == AMF_NEED_MORE_INPUT) {
+			enc->output_cv.notify_all();
+			break;
 		}
 
-		/* ----------------------------------- */
-		/* query as many packets as possible   */
+		enc->frames_in_flight--;
 
-		AMFDataPtr new_packet;
-		do {
-			res = enc->amf_encoder->QueryOutput(&new_packet);
-			if (new_packet)
-				queued_packets.push_back(new_packet);
+		if (res != AMF_INPUT_FULL)
+			throw amf_error("SubmitInput failed", res);
+		if (std::chrono::steady_clock::now() - start >= timeout)
+			throw amf_error("SubmitInput timed out", res);
 
-			if (res != AMF_REPEAT && res != AMF_OK) {
-				throw amf_error("QueryOutput failed", res);
-			}
-		} while (!!new_packet);
+		/* the output thread signals whenever it takes out a packet */
+		enc->output_cv.wait_for(lock, 1ms);
 	}
 
 	/* ----------------------------------- */
@@ -737,6 +849,7 @@ static void amf_encode_base(amf_base *enc, AMFSurface *amf_surf,
 
 		amf_out = queued_packets.front();
 		queued_packets.pop_front();
+		lock.unlock();
 
 		*received_packet = true;
 		convert_to_encoder_packet(enc, amf_out, packet);
@@ -1168,6 +1281,7 @@ static void amf_defaults(obs_data_t *settings)
 	obs_data_set_default_string(settings, "preset", "quality");
 	obs_data_set_default_string(settings, "profile", "high");
 	obs_data_set_default_int(settings, "bf", 3);
+	obs_data_set_default_int(settings, "in_flight", 0);
 }
 
 static bool rate_control_modified(obs_properties_t *ppts, obs_property_t *p,
@@ -1249,6 +1363,11 @@ static obs_properties_t *amf_properties_internal(amf_codec_type codec)
 				       0, 5, 1);
 	}
 
+	p = obs_properties_add_int(props, "in_flight",
+				   obs_module_text("AMF.InFlight"), 0, 64, 1);
+	obs_property_set_long_description(
+		p, obs_module_text("AMF.InFlight.ToolTip"));
+
 	p = obs_properties_add_text(props, "ffmpeg_opts",
 				    obs_module_text("AMFOpts"),
 				    OBS_TEXT_DEFAULT);
@@ -1513,6 +1632,8 @@ static void amf_avc_create_internal(amf_base *enc, obs_data_t *settings)
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::Init failed", res);
 
+	amf_start_output_thread(enc, settings);
+
 	res = enc->amf_encoder->GetProperty(AMF_VIDEO_ENCODER_EXTRADATA, &p);
 	if (res == AMF_OK && p.type == AMF_VARIANT_INTERFACE)
 		enc->header = AMFBufferPtr(p.pInterface);
@@ -1884,6 +2005,8 @@ static void amf_hevc_create_internal(amf_base *enc, obs_data_t *settings)
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::Init failed", res);
 
+	amf_start_output_thread(enc, settings);
+
 	res = enc->amf_encoder->GetProperty(AMF_VIDEO_ENCODER_HEVC_EXTRADATA,
 					    &p);
 	if (res == AMF_OK && p.type == AMF_VARIANT_INTERFACE)
@@ -2202,6 +2325,8 @@ static void amf_av1_create_internal(amf_base *enc, obs_data_t *settings)
 	if (res != AMF_OK)
 		throw amf_error("AMFComponent::Init failed", res);
 
+	amf_start_output_thread(enc, settings);
+
 	AMFVariant p;
 	res = enc->amf_encoder->GetProperty(AMF_VIDEO_ENCODER_AV1_EXTRA_DATA,
 					    &p);
@@ -2287,6 +2412,7 @@ static void amf_av1_defaults(obs_data_t *settings)
 	obs_data_set_default_string(settings, "rate_control", "CBR");
 	obs_data_set_default_string(settings, "preset", "quality");
 	obs_data_set_default_string(settings, "profile", "high");
+	obs_data_set_default_int(settings, "in_flight", 0);
 }
 
 static void register_av1()
@@ -1,5 +1,8 @@
 #include <obs-module.h>
+#include <util/darray.h>
 #include <util/deque.h>
+#include <util/dstr.h>
+#include <util/threading.h>
 #include <util/util_uint64.h>
 
 /* NOTE: Delaying audio shouldn't be necessary because the audio subsystem will
@@ -15,8 +18,32 @@
 #endif
 
 #define SETTING_DELAY_MS "delay_ms"
+#define SETTING_COMPRESS "compress"
+#define SETTING_MEMORY_LIMIT "memory_limit"
+#define SETTING_MEMORY_USAGE "memory_usage"
 
 #define TEXT_DELAY_MS obs_module_text("DelayMs")
+#define TEXT_COMPRESS obs_module_text("AsyncDelay.Compress")
+#define TEXT_MEMORY_LIMIT obs_module_text("AsyncDelay.MemoryLimit")
+#define TEXT_MEMORY_USAGE obs_module_text("AsyncDelay.MemoryUsage")
+
+#define MAX_SPARE_BUFFERS 8
+#define BUFFER_ALIGN (256 * 1024)
+
+/* A frame copied out of the source's frame cache. The planes are stored one
+ * after another in data, each either raw or run-length coded. */
+struct packed_frame {
+	struct obs_source_frame info;
+	uint8_t *data;
+	size_t capacity;
+	size_t plane_size[MAX_AV_PLANES];
+	bool plane_coded[MAX_AV_PLANES];
+};
+
+struct packed_buffer {
+	uint8_t *data;
+	size_t capacity;
+};
 
 struct async_delay_data {
 	obs_source_t *context;
@@ -24,6 +51,19 @@ struct async_delay_data {
 	/* contains struct obs_source_frame* */
 	struct deque video_frames;
 
+	/* contains struct packed_frame, used instead of video_frames when
+	 * compression is enabled and the source owns its frames */
+	struct deque packed_frames;
+	DARRAY(struct packed_buffer) spare_buffers;
+	uint8_t *scratch;
+	size_t scratch_size;
+
+	bool compress;
+	uint64_t memory_limit;
+	uint64_t memory_used;
+	volatile long memory_kb;
+	bool limit_reached;
+
 #ifdef DELAY_AUDIO
 	/* stores the audio data */
 	struct deque audio_frames;
@@ -46,6 +86,95 @@ static const char *async_delay_filter_name(void *unused)
 	return obs_module_text("AsyncDelayFilter");
 }
 
+static uint32_t plane_height(enum video_format format, size_t plane,
+			     uint32_t height)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I40A:
+		return (plane == 1 || plane == 2) ? (height + 1) / 2 : height;
+	default:
+		return height;
+	}
+}
+
+static uint64_t frame_size(const struct obs_source_frame *frame)
+{
+	uint64_t size = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++)
+		size += (uint64_t)frame->linesize[i] *
+			plane_height(frame->format, i, frame->height);
+	return size;
+}
+
+static inline void update_memory_usage(struct async_delay_data *filter)
+{
+	os_atomic_set_long(&filter->memory_kb,
+			   (long)(filter->memory_used / 1024));
+}
+
+static uint8_t *get_buffer(struct async_delay_data *filter, size_t size,
+			   size_t *capacity)
+{
+	size_t best = DARRAY_INVALID;
+
+	for (size_t i = 0; i < filter->spare_buffers.num; i++) {
+		size_t cap = filter->spare_buffers.array[i].capacity;
+		if (cap < size || cap > size * 2)
+			continue;
+		if (best == DARRAY_INVALID ||
+		    cap < filter->spare_buffers.array[best].capacity)
+			best = i;
+	}
+
+	if (best != DARRAY_INVALID) {
+		struct packed_buffer buf = filter->spare_buffers.array[best];
+		da_erase(filter->spare_buffers, best);
+		filter->memory_used -= buf.capacity;
+		*capacity = buf.capacity;
+		return buf.data;
+	}
+
+	*capacity = (size + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+	return bmalloc(*capacity);
+}
+
+static void release_buffer(struct async_delay_data *filter, uint8_t *data,
+			   size_t capacity)
+{
+	if (filter->spare_buffers.num == MAX_SPARE_BUFFERS) {
+		struct packed_buffer oldest = filter->spare_buffers.array[0];
+		da_erase(filter->spare_buffers, 0);
+		filter->memory_used -= oldest.capacity;
+		bfree(oldest.data);
+	}
+
+	struct packed_buffer buf = {data, capacity};
+	da_push_back(filter->spare_buffers, &buf);
+}
+
+static void pop_packed_frame(struct async_delay_data *filter,
+			     struct packed_frame *packed)
+{
+	deque_pop_front(&filter->packed_frames, packed, sizeof(*packed));
+
+	/* the buffer stays accounted for while it is kept as a spare */
+	release_buffer(filter, packed->data, packed->capacity);
+}
+
+static void free_spare_buffers(struct async_delay_data *filter)
+{
+	for (size_t i = 0; i < filter->spare_buffers.num; i++) {
+		filter->memory_used -= filter->spare_buffers.array[i].capacity;
+		bfree(filter->spare_buffers.array[i].data);
+	}
+	da_free(filter->spare_buffers);
+}
+
 static void free_video_data(struct async_delay_data *filter,
 			    obs_source_t *parent)
 {
@@ -54,8 +183,17 @@ static void free_video_data(struct async_delay_data *filter,
 
 		deque_pop_front(&filter->video_frames, &frame,
 				sizeof(struct obs_source_frame *));
+		filter->memory_used -= frame_size(frame);
 		obs_source_release_frame(parent, frame);
 	}
+
+	while (filter->packed_frames.size) {
+		struct packed_frame packed;
+		pop_packed_frame(filter, &packed);
+	}
+
+	filter->limit_reached = false;
+	update_memory_usage(filter);
 }
 
 #ifdef DELAY_AUDIO
@@ -88,6 +226,11 @@ static void async_delay_filter_update(void *data, obs_data_t *settings)
 	if (new_interval < filter->interval)
 		free_video_data(filter, obs_filter_get_parent(filter->context));
 
+	filter->compress = obs_data_get_bool(settings, SETTING_COMPRESS);
+	filter->memory_limit =
+		(uint64_t)obs_data_get_int(settings, SETTING_MEMORY_LIMIT) *
+		1024 * 1024;
+
 	filter->reset_audio = true;
 	filter->reset_video = true;
 	filter->interval = new_interval;
@@ -114,7 +257,15 @@ static void async_delay_filter_destroy(void *data)
 {
 	struct async_delay_data *filter = data;
 
+	while (filter->packed_frames.size) {
+		struct packed_frame packed;
+		pop_packed_frame(filter, &packed);
+	}
+
 	deque_free(&filter->video_frames);
+	deque_free(&filter->packed_frames);
+	free_spare_buffers(filter);
+	bfree(filter->scratch);
 #ifdef DELAY_AUDIO
 	free_audio_packet(&filter->audio_output);
 	deque_free(&filter->audio_frames);
@@ -124,16 +275,38 @@ static void async_delay_filter_destroy(void *data)
 
 static obs_properties_t *async_delay_filter_properties(void *data)
 {
+	struct async_delay_data *filter = data;
 	obs_properties_t *props = obs_properties_create();
 
 	obs_property_t *p = obs_properties_add_int(props, SETTING_DELAY_MS,
 						   TEXT_DELAY_MS, 0, 20000, 1);
 	obs_property_int_set_suffix(p, " ms");
 
-	UNUSED_PARAMETER(data);
+	obs_properties_add_bool(props, SETTING_COMPRESS, TEXT_COMPRESS);
+
+	p = obs_properties_add_int(props, SETTING_MEMORY_LIMIT,
+				   TEXT_MEMORY_LIMIT, 0, 65536, 64);
+	obs_property_int_set_suffix(p, " MB");
+
+	if (filter) {
+		struct dstr text = {0};
+		long kb = os_atomic_load_long(&filter->memory_kb);
+
+		dstr_printf(&text, TEXT_MEMORY_USAGE, (double)kb / 1024.0);
+		obs_properties_add_text(props, SETTING_MEMORY_USAGE,
+					text.array, OBS_TEXT_INFO);
+		dstr_free(&text);
+	}
+
 	return props;
 }
 
+static void async_delay_filter_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_bool(settings, SETTING_COMPRESS, false);
+	obs_data_set_default_int(settings, SETTING_MEMORY_LIMIT, 0);
+}
+
 static void async_delay_filter_remove(void *data, obs_source_t *parent)
 {
 	struct async_delay_data *filter = data;
@@ -153,6 +326,260 @@ static inline bool is_timestamp_jump(uint64_t ts, uint64_t prev_ts)
 	return ts < prev_ts || (ts - prev_ts) > SEC_TO_NSEC;
 }
 
+/* Run-length coding on 32-bit words: every token is a header word with a
+ * count, followed either by one word repeated count times (RLE_RUN set) or by
+ * count literal words.  Runs shorter than RLE_MIN_RUN stay in literals. */
+#define RLE_RUN 0x80000000U
+#define RLE_MIN_RUN 3
+
+/* returns the coded size in words, or 0 if it would not be smaller */
+static size_t rle_encode(uint32_t *dst, const uint32_t *src, size_t words)
+{
+	size_t out = 0;
+	size_t i = 0;
+
+	while (i < words) {
+		size_t start = i;
+		size_t run = 0;
+
+		while (i < words) {
+			run = 1;
+			while (i + run < words && src[i + run] == src[i] &&
+			       run < RLE_RUN - 1)
+				run++;
+			if (run >= RLE_MIN_RUN)
+				break;
+			i += run;
+		}
+
+		size_t literals = i - start;
+		if (literals) {
+			if (out + 1 + literals >= words)
+				return 0;
+			dst[out++] = (uint32_t)literals;
+			memcpy(dst + out, src + start, literals * 4);
+			out += literals;
+		}
+
+		if (i < words) {
+			if (out + 2 >= words)
+				return 0;
+			dst[out++] = RLE_RUN | (uint32_t)run;
+			dst[out++] = src[i];
+			i += run;
+		}
+	}
+
+	return out;
+}
+
+static bool rle_decode(uint32_t *dst, size_t words, const uint32_t *src,
+		       size_t src_words)
+{
+	size_t out = 0;
+	size_t in = 0;
+
+	while (in < src_words) {
+		uint32_t header = src[in++];
+		size_t count = header & ~RLE_RUN;
+
+		if (count > words - out)
+			return false;
+
+		if (header & RLE_RUN) {
+			if (in == src_words)
+				return false;
+			uint32_t value = src[in++];
+			for (size_t i = 0; i < count; i++)
+				dst[out++] = value;
+		} else {
+			if (count > src_words - in)
+				return false;
+			memcpy(dst + out, src + in, count * 4);
+			in += count;
+			out += count;
+		}
+	}
+
+	return out == words;
+}
+
+static inline size_t plane_bytes(const struct obs_source_frame *frame,
+				 size_t plane)
+{
+	return (size_t)frame->linesize[plane] *
+	       plane_height(frame->format, plane, frame->height);
+}
+
+static void pack_frame(struct async_delay_data *filter,
+		       const struct obs_source_frame *frame)
+{
+	struct packed_frame packed = {0};
+	size_t total = (size_t)frame_size(frame);
+	size_t offset = 0;
+
+	if (filter->scratch_size < total) {
+		bfree(filter->scratch);
+		filter->scratch = bmalloc(total);
+		filter->scratch_size = total;
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i]; i++) {
+		size_t size = plane_bytes(frame, i);
+		uint8_t *dst = filter->scratch + offset;
+		size_t words = 0;
+
+		/* planes start on a word boundary as long as they are a
+		 * whole number of words, which the cache always allocates */
+		if (size % 4 == 0)
+			words = rle_encode((uint32_t *)dst,
+					   (const uint32_t *)frame->data[i],
+					   size / 4);
+
+		if (words) {
+			packed.plane_coded[i] = true;
+			size = words * 4;
+		} else {
+			memcpy(dst, frame->data[i], size);
+		}
+
+		packed.plane_size[i] = size;
+		offset += size;
+	}
+
+	packed.info = *frame;
+	memset(packed.info.data, 0, sizeof(packed.info.data));
+	packed.data = get_buffer(filter, offset, &packed.capacity);
+	memcpy(packed.data, filter->scratch, offset);
+
+	filter->memory_used += packed.capacity;
+	deque_push_back(&filter->packed_frames, &packed, sizeof(packed));
+}
+
+static bool unpack_frame(struct obs_source_frame *dst,
+			 const struct packed_frame *packed)
+{
+	const uint8_t *src = packed->data;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && dst->data[i]; i++) {
+		size_t size = plane_bytes(dst, i);
+
+		if (!packed->plane_coded[i])
+			memcpy(dst->data[i], src, size);
+		else if (!rle_decode((uint32_t *)dst->data[i], size / 4,
+				     (const uint32_t *)src,
+				     packed->plane_size[i] / 4))
+			return false;
+
+		src += packed->plane_size[i];
+	}
+
+	dst->timestamp = packed->info.timestamp;
+	dst->full_range = packed->info.full_range;
+	dst->max_luminance = packed->info.max_luminance;
+	dst->flip = packed->info.flip;
+	dst->flags = packed->info.flags;
+	dst->trc = packed->info.trc;
+	memcpy(dst->color_matrix, packed->info.color_matrix,
+	       sizeof(dst->color_matrix));
+	memcpy(dst->color_range_min, packed->info.color_range_min,
+	       sizeof(dst->color_range_min));
+	memcpy(dst->color_range_max, packed->info.color_range_max,
+	       sizeof(dst->color_range_max));
+	return true;
+}
+
+static inline bool same_layout(const struct obs_source_frame *a,
+			       const struct obs_source_frame *b)
+{
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height &&
+	       memcmp(a->linesize, b->linesize, sizeof(a->linesize)) == 0;
+}
+
+static void check_memory_limit(struct async_delay_data *filter,
+			       obs_source_t *parent)
+{
+	if (!filter->memory_limit)
+		return;
+
+	while (filter->memory_used > filter->memory_limit) {
+		if (filter->spare_buffers.num) {
+			free_spare_buffers(filter);
+			continue;
+		}
+
+		/* drop the oldest frames, which shortens the delay to what
+		 * fits into the limit */
+		if (filter->packed_frames.size > sizeof(struct packed_frame)) {
+			struct packed_frame packed;
+			pop_packed_frame(filter, &packed);
+		} else if (filter->video_frames.size >
+			   sizeof(struct obs_source_frame *)) {
+			struct obs_source_frame *frame;
+			deque_pop_front(&filter->video_frames, &frame,
+					sizeof(frame));
+			filter->memory_used -= frame_size(frame);
+			obs_source_release_frame(parent, frame);
+		} else {
+			break;
+		}
+
+		if (!filter->limit_reached) {
+			blog(LOG_WARNING,
+			     "[Video Delay: '%s'] Memory limit reached, "
+			     "the delay will be shorter than configured",
+			     obs_source_get_name(filter->context));
+			filter->limit_reached = true;
+		}
+	}
+}
+
+static struct obs_source_frame *
+async_delay_filter_video_packed(struct async_delay_data *filter,
+				obs_source_t *parent,
+				struct obs_source_frame *frame)
+{
+	struct packed_frame *front;
+	uint64_t cur_interval;
+
+	if (filter->packed_frames.size) {
+		front = deque_data(&filter->packed_frames, 0);
+		if (!same_layout(&front->info, frame)) {
+			free_video_data(filter, NULL);
+			filter->video_delay_reached = false;
+		}
+	}
+
+	pack_frame(filter, frame);
+	check_memory_limit(filter, NULL);
+
+	front = deque_data(&filter->packed_frames, 0);
+	cur_interval = frame->timestamp - front->info.timestamp;
+	if (!filter->video_delay_reached && cur_interval < filter->interval) {
+		/* the data has been copied, hand the frame back right away */
+		obs_source_release_frame(parent, frame);
+		update_memory_usage(filter);
+		return NULL;
+	}
+
+	/* the incoming frame belongs to the source's frame cache, so the
+	 * delayed frame is written back into it */
+	bool success = unpack_frame(frame, front);
+
+	struct packed_frame packed;
+	pop_packed_frame(filter, &packed);
+	update_memory_usage(filter);
+
+	filter->video_delay_reached = true;
+
+	if (!success) {
+		obs_source_release_frame(parent, frame);
+		return NULL;
+	}
+	return frame;
+}
+
 static struct obs_source_frame *
 async_delay_filter_video(void *data, struct obs_source_frame *frame)
 {
@@ -160,9 +587,13 @@ async_delay_filter_video(void *data, struct obs_source_frame *frame)
 	obs_source_t *parent = obs_filter_get_parent(filter->context);
 	struct obs_source_frame *output;
 	uint64_t cur_interval;
+	bool packed = filter->compress && !frame->external;
 
+	/* switching between held and packed frames starts over */
 	if (filter->reset_video ||
-	    is_timestamp_jump(frame->timestamp, filter->last_video_ts)) {
+	    is_timestamp_jump(frame->timestamp, filter->last_video_ts) ||
+	    (packed ? filter->video_frames.size
+		    : filter->packed_frames.size)) {
 		free_video_data(filter, parent);
 		filter->video_delay_reached = false;
 		filter->reset_video = false;
@@ -170,17 +601,27 @@ async_delay_filter_video(void *data, struct obs_source_frame *frame)
 
 	filter->last_video_ts = frame->timestamp;
 
+	if (packed)
+		return async_delay_filter_video_packed(filter, parent, frame);
+
+	filter->memory_used += frame_size(frame);
 	deque_push_back(&filter->video_frames, &frame,
 			sizeof(struct obs_source_frame *));
 	deque_peek_front(&filter->video_frames, &output,
 			 sizeof(struct obs_source_frame *));
 
 	cur_interval = frame->timestamp - output->timestamp;
-	if (!filter->video_delay_reached && cur_interval < filter->interval)
+	if (!filter->video_delay_reached && cur_interval < filter->interval) {
+		check_memory_limit(filter, parent);
+		update_memory_usage(filter);
 		return NULL;
+	}
 
 	deque_pop_front(&filter->video_frames, NULL,
 			sizeof(struct obs_source_frame *));
+	filter->memory_used -= frame_size(output);
+	check_memory_limit(filter, parent);
+	update_memory_usage(filter);
 
 	if (!filter->video_delay_reached)
 		filter->video_delay_reached = true;
@@ -247,6 +688,7 @@ struct obs_source_info async_delay_filter = {
 	.destroy = async_delay_filter_destroy,
 	.update = async_delay_filter_update,
 	.get_properties = async_delay_filter_properties,
+	.get_defaults = async_delay_filter_defaults,
 	.filter_video = async_delay_filter_video,
 #ifdef DELAY_AUDIO
 	.filter_audio = async_delay_filter_audio,
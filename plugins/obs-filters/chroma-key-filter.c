@@ -3,6 +3,8 @@
 #include <graphics/vec2.h>
 #include <graphics/vec4.h>
 
+#include "key-matte.h"
+
 /* clang-format off */
 
 #define SETTING_SDR_ONLY_INFO          "sdr_only_info"
@@ -81,6 +83,8 @@ struct chroma_key_filter_data_v2 {
 	float similarity;
 	float smoothness;
 	float spill;
+
+	struct key_matte matte;
 };
 
 static const char *chroma_key_name(void *unused)
@@ -218,6 +222,7 @@ static void chroma_key_update_v2(void *data, obs_data_t *settings)
 
 	color_settings_update_v2(filter, settings);
 	chroma_settings_update_v2(filter, settings);
+	key_matte_update(&filter->matte, settings);
 }
 
 static void chroma_key_destroy_v1(void *data)
@@ -243,6 +248,8 @@ static void chroma_key_destroy_v2(void *data)
 		obs_leave_graphics();
 	}
 
+	key_matte_free(&filter->matte);
+
 	bfree(data);
 }
 
@@ -412,11 +419,32 @@ static void chroma_key_render_v2(void *data, gs_effect_t *effect)
 					    filter->smoothness);
 			gs_effect_set_float(filter->spill_param, filter->spill);
 
+			/* the matte is box filtered at its own resolution */
+			const char *tech_name = "Draw";
+			if (filter->matte.scale > 1) {
+				struct vec2 matte_pixel_size;
+				vec2_mulf(&matte_pixel_size, &pixel_size,
+					  (float)filter->matte.scale);
+				gs_effect_set_vec2(filter->pixel_size_param,
+						   &matte_pixel_size);
+
+				if (key_matte_render(&filter->matte,
+						     filter->context,
+						     filter->effect,
+						     source_space))
+					tech_name = "DrawRefined";
+				else
+					gs_effect_set_vec2(
+						filter->pixel_size_param,
+						&pixel_size);
+			}
+
 			gs_blend_state_push();
 			gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
-			obs_source_process_filter_end(filter->context,
-						      filter->effect, 0, 0);
+			obs_source_process_filter_tech_end(filter->context,
+							   filter->effect, 0, 0,
+							   tech_name);
 
 			gs_blend_state_pop();
 		}
@@ -509,6 +537,8 @@ static obs_properties_t *chroma_key_properties_v2(void *data)
 	obs_properties_add_float_slider(props, SETTING_GAMMA, TEXT_GAMMA, -1.0,
 					1.0, 0.01);
 
+	key_matte_properties(props);
+
 	UNUSED_PARAMETER(data);
 	return props;
 }
@@ -537,6 +567,7 @@ static void chroma_key_defaults_v2(obs_data_t *settings)
 	obs_data_set_default_int(settings, SETTING_SIMILARITY, 400);
 	obs_data_set_default_int(settings, SETTING_SMOOTHNESS, 80);
 	obs_data_set_default_int(settings, SETTING_SPILL, 100);
+	key_matte_defaults(settings);
 }
 
 static enum gs_color_space
@@ -563,7 +594,8 @@ chroma_key_get_color_space(void *data, size_t count,
 struct obs_source_info chroma_key_filter = {
 	.id = "chroma_key_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = chroma_key_name,
 	.create = chroma_key_create_v1,
 	.destroy = chroma_key_destroy_v1,
@@ -577,7 +609,8 @@ struct obs_source_info chroma_key_filter_v2 = {
 	.id = "chroma_key_filter",
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = chroma_key_name,
 	.create = chroma_key_create_v2,
 	.destroy = chroma_key_destroy_v2,
@@ -129,7 +129,9 @@ target_sources(
           compressor-filter.c
           limiter-filter.c
           expander-filter.c
-          luma-key-filter.c)
+          luma-key-filter.c
+          key-matte.c
+          key-matte.h)
 
 if(NOT OS_MACOS)
   target_sources(
@@ -145,7 +147,9 @@ if(NOT OS_MACOS)
             data/color_key_filter.effect
             data/color_key_filter_v2.effect
             data/crop_filter.effect
+            data/gpu_delay.effect
             data/hdr_tonemap_filter.effect
+            data/key_matte.effect
             data/luma_key_filter.effect
             data/luma_key_filter_v2.effect
             data/mask_alpha_filter.effect
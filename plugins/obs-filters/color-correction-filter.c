@@ -638,6 +638,47 @@ static void color_correction_filter_render_v2(void *data, gs_effect_t *effect)
 	}
 }
 
+/*
+ * Without gamma, the filter is nothing but its final matrix, which lets
+ * libobs fold it together with neighbouring color matrix filters.
+ */
+static bool color_correction_filter_get_color_matrix_v1(void *data,
+							struct matrix4 *matrix)
+{
+	struct color_correction_filter_data *filter = data;
+
+	if (filter->gamma != 1.0f)
+		return false;
+
+	matrix4_copy(matrix, &filter->final_matrix);
+	return true;
+}
+
+static bool color_correction_filter_get_color_matrix_v2(void *data,
+							struct matrix4 *matrix)
+{
+	struct color_correction_filter_data_v2 *filter = data;
+
+	if (filter->gamma != 1.0f)
+		return false;
+
+	const enum gs_color_space preferred_spaces[] = {
+		GS_CS_SRGB,
+		GS_CS_SRGB_16F,
+		GS_CS_709_EXTENDED,
+	};
+
+	/* the filter skips itself for HDR sources */
+	const enum gs_color_space source_space = obs_source_get_color_space(
+		obs_filter_get_target(filter->context),
+		OBS_COUNTOF(preferred_spaces), preferred_spaces);
+	if (source_space == GS_CS_709_EXTENDED)
+		matrix4_identity(matrix);
+	else
+		matrix4_copy(matrix, &filter->final_matrix);
+	return true;
+}
+
 /*
  * This function sets the interface. the types (add_*_Slider), the type of
  * data collected (int), the internal name, user-facing name, minimum,
@@ -760,7 +801,8 @@ static enum gs_color_space color_correction_filter_get_color_space(
 struct obs_source_info color_filter = {
 	.id = "color_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE |
+			OBS_SOURCE_STATIC_VIDEO | OBS_SOURCE_COLOR_MATRIX,
 	.get_name = color_correction_filter_name,
 	.create = color_correction_filter_create_v1,
 	.destroy = color_correction_filter_destroy_v1,
@@ -768,13 +810,15 @@ struct obs_source_info color_filter = {
 	.update = color_correction_filter_update_v1,
 	.get_properties = color_correction_filter_properties_v1,
 	.get_defaults = color_correction_filter_defaults_v1,
+	.get_color_matrix = color_correction_filter_get_color_matrix_v1,
 };
 
 struct obs_source_info color_filter_v2 = {
 	.id = "color_filter",
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO | OBS_SOURCE_COLOR_MATRIX,
 	.get_name = color_correction_filter_name,
 	.create = color_correction_filter_create_v2,
 	.destroy = color_correction_filter_destroy_v2,
@@ -783,4 +827,5 @@ struct obs_source_info color_filter_v2 = {
 	.get_properties = color_correction_filter_properties_v2,
 	.get_defaults = color_correction_filter_defaults_v2,
 	.video_get_color_space = color_correction_filter_get_color_space,
+	.get_color_matrix = color_correction_filter_get_color_matrix_v2,
 };
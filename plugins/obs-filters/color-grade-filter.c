@@ -3,6 +3,9 @@
 #include <graphics/image-file.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/task.h>
+#include <util/threading.h>
+#include <sys/stat.h>
 
 /* clang-format off */
 
@@ -25,24 +28,41 @@ enum clut_dimension {
 	CLUT_3D,
 };
 
-struct lut_filter_data {
-	obs_source_t *context;
-	gs_effect_t *effect;
-	gs_texture_t *target;
+/* LUTs are shared by every filter using the same file, keyed by path and
+ * modification time.  Files are parsed on a background thread, the texture
+ * is created by the first filter that renders after that and the parsed
+ * data is freed again. */
+struct clut_entry {
+	char *path;
+	time_t mtime;
+	long refs;
 
-	gs_image_file_t image;
+	volatile bool loaded;
+	bool valid;
 
-	uint32_t cube_width;
-	void *cube_data;
-
-	char *file;
-	float clut_amount;
+	enum clut_dimension dim;
+	uint32_t width;
 	struct vec3 clut_scale;
 	struct vec3 clut_offset;
 	struct vec3 domain_min;
 	struct vec3 domain_max;
-	const char *clut_texture_name;
-	const char *tech_name;
+
+	void *cube_data;
+	gs_image_file_t image;
+	gs_texture_t *texture;
+};
+
+static pthread_mutex_t clut_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct clut_entry *) clut_cache;
+static os_task_queue_t *clut_load_queue;
+
+struct lut_filter_data {
+	obs_source_t *context;
+	gs_effect_t *effect;
+	struct clut_entry *clut;
+
+	float clut_amount;
+	bool passthrough_alpha;
 };
 
 static const char *color_grade_filter_get_name(void *unused)
@@ -51,10 +71,10 @@ static const char *color_grade_filter_get_name(void *unused)
 	return obs_module_text("ColorGradeFilter");
 }
 
-static gs_texture_t *make_clut_texture_png(const enum gs_color_format format,
-					   const uint32_t image_width,
-					   const uint32_t image_height,
-					   const uint8_t *data)
+static uint8_t *make_clut_data_png(const enum gs_color_format format,
+				   const uint32_t image_width,
+				   const uint32_t image_height,
+				   const uint8_t *data)
 {
 	if (image_width % LUT_WIDTH != 0)
 		return NULL;
@@ -91,12 +111,7 @@ static gs_texture_t *make_clut_texture_png(const enum gs_color_format format,
 		}
 	}
 
-	gs_texture_t *const texture =
-		gs_voltexture_create(LUT_WIDTH, LUT_WIDTH, LUT_WIDTH, format, 1,
-				     (const uint8_t **)&buffer, 0);
-	bfree(buffer);
-
-	return texture;
+	return buffer;
 }
 
 static bool get_cube_entry(FILE *const file, float *const red,
@@ -248,130 +263,225 @@ static void *load_cube_file(const char *const path, uint32_t *const width,
 	return data;
 }
 
-static void color_grade_filter_update(void *data, obs_data_t *settings)
+static time_t get_modified_timestamp(const char *path)
 {
-	struct lut_filter_data *filter = data;
-
-	const char *path = obs_data_get_string(settings, SETTING_IMAGE_PATH);
-	if (path && (*path == '\0'))
-		path = NULL;
+	struct stat stats;
+	if (os_stat(path, &stats) != 0)
+		return -1;
+	return stats.st_mtime;
+}
 
-	const double clut_amount =
-		obs_data_get_double(settings, SETTING_CLUT_AMOUNT);
-	const bool passthrough_alpha =
-		obs_data_get_bool(settings, SETTING_PASSTHROUGH_ALPHA);
+static void clut_entry_release(struct clut_entry *entry)
+{
+	if (!entry)
+		return;
 
-	bfree(filter->file);
-	if (path)
-		filter->file = bstrdup(path);
-	else
-		filter->file = NULL;
+	pthread_mutex_lock(&clut_cache_mutex);
+	bool destroy = --entry->refs == 0;
+	if (destroy)
+		da_erase_item(clut_cache, &entry);
+	pthread_mutex_unlock(&clut_cache_mutex);
 
-	bfree(filter->cube_data);
-	filter->cube_data = NULL;
+	if (!destroy)
+		return;
 
 	obs_enter_graphics();
-	gs_image_file_free(&filter->image);
-	gs_voltexture_destroy(filter->target);
-	filter->target = NULL;
+	gs_texture_destroy(entry->texture);
+	gs_image_file_free(&entry->image);
 	obs_leave_graphics();
 
-	enum clut_dimension clut_dim = CLUT_3D;
-	const char *clut_texture_name = "clut_3d";
-	const char *tech_name = "Draw3D";
+	bfree(entry->cube_data);
+	bfree(entry->path);
+	bfree(entry);
+}
 
-	if (path) {
-		vec3_set(&filter->domain_min, 0.0f, 0.0f, 0.0f);
-		vec3_set(&filter->domain_max, 1.0f, 1.0f, 1.0f);
-
-		const char *const ext = os_get_path_extension(path);
-		if (ext && astrcmpi(ext, ".cube") == 0) {
-			filter->cube_data = load_cube_file(
-				path, &filter->cube_width, &filter->domain_min,
-				&filter->domain_max, &clut_dim);
-		} else {
-			gs_image_file_init(&filter->image, path);
-			filter->cube_width = LUT_WIDTH;
-		}
+static void clut_entry_load_png(struct clut_entry *entry)
+{
+	gs_image_file_init(&entry->image, entry->path);
+	if (!entry->image.loaded)
+		return;
+
+	entry->cube_data = make_clut_data_png(entry->image.format,
+					      entry->image.cx, entry->image.cy,
+					      entry->image.texture_data);
+	entry->width = LUT_WIDTH;
+
+	const float width_i = 1.0f / (float)LUT_WIDTH;
+	const float clut_scale = 1.0f - width_i;
+	const float offset = 0.5f * width_i;
+	vec3_set(&entry->clut_scale, clut_scale, clut_scale, clut_scale);
+	vec3_set(&entry->clut_offset, offset, offset, offset);
+
+	/* only the rearranged data is needed from here on */
+	bfree(entry->image.texture_data);
+	entry->image.texture_data = NULL;
+}
+
+static void clut_entry_load_cube(struct clut_entry *entry)
+{
+	entry->cube_data = load_cube_file(entry->path, &entry->width,
+					  &entry->domain_min,
+					  &entry->domain_max, &entry->dim);
+	if (!entry->cube_data)
+		return;
+
+	const uint32_t width = entry->width;
+
+	struct vec3 domain_scale;
+	vec3_sub(&domain_scale, &entry->domain_max, &entry->domain_min);
+
+	const float width_minus_one = (float)(width - 1);
+	vec3_set(&entry->clut_scale, width_minus_one, width_minus_one,
+		 width_minus_one);
+	vec3_div(&entry->clut_scale, &entry->clut_scale, &domain_scale);
+
+	vec3_neg(&entry->clut_offset, &entry->domain_min);
+	vec3_mul(&entry->clut_offset, &entry->clut_offset, &entry->clut_scale);
+
+	/* want normalized UVW */
+	vec3_divf(&entry->clut_scale, &entry->clut_scale, (float)width);
+	vec3_addf(&entry->clut_offset, &entry->clut_offset, 0.5f);
+	vec3_divf(&entry->clut_offset, &entry->clut_offset, (float)width);
+}
+
+static void clut_entry_load(void *param)
+{
+	struct clut_entry *entry = param;
+	const char *const ext = os_get_path_extension(entry->path);
 
-		if (clut_dim == CLUT_1D) {
-			clut_texture_name = "clut_1d";
-			tech_name = "Draw1D";
-		} else if ((filter->domain_min.x > 0.f) ||
-			   (filter->domain_min.y > 0.f) ||
-			   (filter->domain_min.z > 0.f) ||
-			   (filter->domain_max.x < 1.f) ||
-			   (filter->domain_max.y < 1.f) ||
-			   (filter->domain_max.z < 1.f)) {
-			tech_name = "DrawDomain3D";
-		} else if (clut_amount < 1.0) {
-			tech_name = "DrawAmount3D";
-		} else if (!passthrough_alpha) {
-			tech_name = "DrawAlpha3D";
+	if (ext && astrcmpi(ext, ".cube") == 0)
+		clut_entry_load_cube(entry);
+	else
+		clut_entry_load_png(entry);
+
+	entry->valid = entry->cube_data != NULL;
+	if (!entry->valid)
+		blog(LOG_WARNING, "Failed to load LUT '%s'", entry->path);
+
+	os_atomic_set_bool(&entry->loaded, true);
+	clut_entry_release(entry);
+}
+
+static struct clut_entry *clut_entry_get(const char *path)
+{
+	struct clut_entry *entry = NULL;
+	time_t mtime = get_modified_timestamp(path);
+
+	pthread_mutex_lock(&clut_cache_mutex);
+
+	for (size_t i = 0; i < clut_cache.num; i++) {
+		struct clut_entry *cur = clut_cache.array[i];
+		if (cur->mtime == mtime && strcmp(cur->path, path) == 0) {
+			cur->refs++;
+			entry = cur;
+			goto unlock;
 		}
 	}
 
-	obs_enter_graphics();
+	if (!clut_load_queue)
+		clut_load_queue = os_task_queue_create();
 
-	if (path) {
-		if (filter->image.loaded) {
-			filter->target = make_clut_texture_png(
-				filter->image.format, filter->image.cx,
-				filter->image.cy, filter->image.texture_data);
-			const float width_i = 1.0f / (float)LUT_WIDTH;
-			const float clut_scale = 1.0f - width_i;
-			const float offset = 0.5f * width_i;
-			vec3_set(&filter->clut_scale, clut_scale, clut_scale,
-				 clut_scale);
-			vec3_set(&filter->clut_offset, offset, offset, offset);
-		} else if (filter->cube_data) {
-			const uint32_t width = filter->cube_width;
-			if (clut_dim == CLUT_1D) {
-				filter->target = gs_texture_create(
-					width, 1, GS_RGBA16F, 1,
-					(const uint8_t **)&filter->cube_data,
-					0);
-			} else {
-				filter->target = gs_voltexture_create(
-					width, width, width, GS_RGBA16F, 1,
-					(const uint8_t **)&filter->cube_data,
-					0);
-			}
+	entry = bzalloc(sizeof(*entry));
+	entry->path = bstrdup(path);
+	entry->mtime = mtime;
+	entry->dim = CLUT_3D;
+	vec3_set(&entry->domain_min, 0.0f, 0.0f, 0.0f);
+	vec3_set(&entry->domain_max, 1.0f, 1.0f, 1.0f);
+
+	/* one reference for the caller, one for the load task */
+	entry->refs = 2;
+	da_push_back(clut_cache, &entry);
+
+	if (!os_task_queue_queue_task(clut_load_queue, clut_entry_load,
+				      entry)) {
+		entry->refs--;
+		os_atomic_set_bool(&entry->loaded, true);
+	}
 
-			struct vec3 domain_scale;
-			vec3_sub(&domain_scale, &filter->domain_max,
-				 &filter->domain_min);
-
-			const float width_minus_one = (float)(width - 1);
-			vec3_set(&filter->clut_scale, width_minus_one,
-				 width_minus_one, width_minus_one);
-			vec3_div(&filter->clut_scale, &filter->clut_scale,
-				 &domain_scale);
-
-			vec3_neg(&filter->clut_offset, &filter->domain_min);
-			vec3_mul(&filter->clut_offset, &filter->clut_offset,
-				 &filter->clut_scale);
-
-			/* want normalized UVW */
-			vec3_divf(&filter->clut_scale, &filter->clut_scale,
-				  (float)width);
-			vec3_addf(&filter->clut_offset, &filter->clut_offset,
-				  0.5f);
-			vec3_divf(&filter->clut_offset, &filter->clut_offset,
-				  (float)width);
+unlock:
+	pthread_mutex_unlock(&clut_cache_mutex);
+	return entry;
+}
+
+/* graphics thread only */
+static gs_texture_t *clut_entry_get_texture(struct clut_entry *entry)
+{
+	if (!entry || !os_atomic_load_bool(&entry->loaded) || !entry->valid)
+		return NULL;
+	if (entry->texture)
+		return entry->texture;
+
+	const uint32_t width = entry->width;
+	const uint8_t *data = entry->cube_data;
+
+	if (entry->dim == CLUT_1D)
+		entry->texture = gs_texture_create(width, 1, GS_RGBA16F, 1,
+						   &data, 0);
+	else if (entry->image.loaded)
+		entry->texture = gs_voltexture_create(width, width, width,
+						      entry->image.format, 1,
+						      &data, 0);
+	else
+		entry->texture = gs_voltexture_create(width, width, width,
+						      GS_RGBA16F, 1, &data, 0);
+
+	bfree(entry->cube_data);
+	entry->cube_data = NULL;
+	entry->valid = entry->texture != NULL;
+	return entry->texture;
+}
+
+void color_grade_filter_free_cache(void)
+{
+	os_task_queue_destroy(clut_load_queue);
+	clut_load_queue = NULL;
+
+	if (clut_cache.num)
+		blog(LOG_WARNING, "%zu color grade LUTs were not released",
+		     clut_cache.num);
+	da_free(clut_cache);
+}
+
+static void color_grade_filter_update(void *data, obs_data_t *settings)
+{
+	struct lut_filter_data *filter = data;
+
+	const char *path = obs_data_get_string(settings, SETTING_IMAGE_PATH);
+	if (path && (*path == '\0'))
+		path = NULL;
+
+	struct clut_entry *old = filter->clut;
+	struct clut_entry *clut = NULL;
+
+	if (path) {
+		/* settings changes that keep the same file don't reparse it */
+		if (old && strcmp(old->path, path) == 0 &&
+		    old->mtime == get_modified_timestamp(path)) {
+			clut = old;
+			old = NULL;
+		} else {
+			clut = clut_entry_get(path);
 		}
 	}
 
-	filter->clut_amount = (float)clut_amount;
-	filter->clut_texture_name = clut_texture_name;
-	filter->tech_name = tech_name;
+	obs_enter_graphics();
 
-	char *effect_path = obs_module_file("color_grade_filter.effect");
-	gs_effect_destroy(filter->effect);
-	filter->effect = gs_effect_create_from_file(effect_path, NULL);
-	bfree(effect_path);
+	filter->clut = clut;
+	filter->clut_amount =
+		(float)obs_data_get_double(settings, SETTING_CLUT_AMOUNT);
+	filter->passthrough_alpha =
+		obs_data_get_bool(settings, SETTING_PASSTHROUGH_ALPHA);
+
+	if (!filter->effect) {
+		char *effect_path =
+			obs_module_file("color_grade_filter.effect");
+		filter->effect = gs_effect_create_from_file(effect_path, NULL);
+		bfree(effect_path);
+	}
 
 	obs_leave_graphics();
+
+	clut_entry_release(old);
 }
 
 static void color_grade_filter_defaults(obs_data_t *settings)
@@ -433,12 +543,9 @@ static void color_grade_filter_destroy(void *data)
 
 	obs_enter_graphics();
 	gs_effect_destroy(filter->effect);
-	gs_voltexture_destroy(filter->target);
-	gs_image_file_free(&filter->image);
 	obs_leave_graphics();
 
-	bfree(filter->cube_data);
-	bfree(filter->file);
+	clut_entry_release(filter->clut);
 	bfree(filter);
 }
 
@@ -447,13 +554,31 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 
 	struct lut_filter_data *filter = data;
+	struct clut_entry *clut = filter->clut;
 	obs_source_t *target = obs_filter_get_target(filter->context);
+	gs_texture_t *texture = clut_entry_get_texture(clut);
 
-	if (!target || !filter->target || !filter->effect) {
+	if (!target || !texture || !filter->effect) {
 		obs_source_skip_video_filter(filter->context);
 		return;
 	}
 
+	const char *clut_texture_name = "clut_3d";
+	const char *tech_name = "Draw3D";
+
+	if (clut->dim == CLUT_1D) {
+		clut_texture_name = "clut_1d";
+		tech_name = "Draw1D";
+	} else if ((clut->domain_min.x > 0.f) || (clut->domain_min.y > 0.f) ||
+		   (clut->domain_min.z > 0.f) || (clut->domain_max.x < 1.f) ||
+		   (clut->domain_max.y < 1.f) || (clut->domain_max.z < 1.f)) {
+		tech_name = "DrawDomain3D";
+	} else if (filter->clut_amount < 1.0f) {
+		tech_name = "DrawAmount3D";
+	} else if (!filter->passthrough_alpha) {
+		tech_name = "DrawAlpha3D";
+	}
+
 	const enum gs_color_space preferred_spaces[] = {
 		GS_CS_SRGB,
 		GS_CS_SRGB_16F,
@@ -472,8 +597,8 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 			    filter->context, format, source_space,
 			    OBS_ALLOW_DIRECT_RENDERING)) {
 			gs_eparam_t *param = gs_effect_get_param_by_name(
-				filter->effect, filter->clut_texture_name);
-			gs_effect_set_texture_srgb(param, filter->target);
+				filter->effect, clut_texture_name);
+			gs_effect_set_texture_srgb(param, texture);
 
 			param = gs_effect_get_param_by_name(filter->effect,
 							    "clut_amount");
@@ -481,26 +606,26 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 
 			param = gs_effect_get_param_by_name(filter->effect,
 							    "clut_scale");
-			gs_effect_set_vec3(param, &filter->clut_scale);
+			gs_effect_set_vec3(param, &clut->clut_scale);
 
 			param = gs_effect_get_param_by_name(filter->effect,
 							    "clut_offset");
-			gs_effect_set_vec3(param, &filter->clut_offset);
+			gs_effect_set_vec3(param, &clut->clut_offset);
 
 			param = gs_effect_get_param_by_name(filter->effect,
 							    "domain_min");
-			gs_effect_set_vec3(param, &filter->domain_min);
+			gs_effect_set_vec3(param, &clut->domain_min);
 
 			param = gs_effect_get_param_by_name(filter->effect,
 							    "domain_max");
-			gs_effect_set_vec3(param, &filter->domain_max);
+			gs_effect_set_vec3(param, &clut->domain_max);
 
 			gs_blend_state_push();
 			gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
 			obs_source_process_filter_tech_end(filter->context,
 							   filter->effect, 0, 0,
-							   filter->tech_name);
+							   tech_name);
 
 			gs_blend_state_pop();
 		}
@@ -531,7 +656,8 @@ color_grade_filter_get_color_space(void *data, size_t count,
 struct obs_source_info color_grade_filter = {
 	.id = "clut_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = color_grade_filter_get_name,
 	.create = color_grade_filter_create,
 	.destroy = color_grade_filter_destroy,
@@ -3,6 +3,8 @@
 #include <graphics/vec2.h>
 #include <graphics/vec4.h>
 
+#include "key-matte.h"
+
 /* clang-format off */
 
 #define SETTING_SDR_ONLY_INFO          "sdr_only_info"
@@ -73,6 +75,8 @@ struct color_key_filter_data_v2 {
 	struct vec4 key_color;
 	float similarity;
 	float smoothness;
+
+	struct key_matte matte;
 };
 
 static const char *color_key_name(void *unused)
@@ -190,6 +194,7 @@ static void color_key_update_v2(void *data, obs_data_t *settings)
 
 	color_settings_update_v2(filter, settings);
 	key_settings_update_v2(filter, settings);
+	key_matte_update(&filter->matte, settings);
 }
 
 static void color_key_destroy_v1(void *data)
@@ -215,6 +220,8 @@ static void color_key_destroy_v2(void *data)
 		obs_leave_graphics();
 	}
 
+	key_matte_free(&filter->matte);
+
 	bfree(data);
 }
 
@@ -358,11 +365,19 @@ static void color_key_render_v2(void *data, gs_effect_t *effect)
 			gs_effect_set_float(filter->smoothness_param,
 					    filter->smoothness);
 
+			const char *tech_name =
+				key_matte_render(&filter->matte,
+						 filter->context,
+						 filter->effect, source_space)
+					? "DrawRefined"
+					: "Draw";
+
 			gs_blend_state_push();
 			gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
-			obs_source_process_filter_end(filter->context,
-						      filter->effect, 0, 0);
+			obs_source_process_filter_tech_end(filter->context,
+							   filter->effect, 0, 0,
+							   tech_name);
 
 			gs_blend_state_pop();
 		}
@@ -453,6 +468,8 @@ static obs_properties_t *color_key_properties_v2(void *data)
 	obs_properties_add_float_slider(props, SETTING_GAMMA, TEXT_GAMMA, -1.0,
 					1.0, 0.01);
 
+	key_matte_properties(props);
+
 	UNUSED_PARAMETER(data);
 	return props;
 }
@@ -479,6 +496,7 @@ static void color_key_defaults_v2(obs_data_t *settings)
 	obs_data_set_default_string(settings, SETTING_COLOR_TYPE, "green");
 	obs_data_set_default_int(settings, SETTING_SIMILARITY, 80);
 	obs_data_set_default_int(settings, SETTING_SMOOTHNESS, 50);
+	key_matte_defaults(settings);
 }
 
 static enum gs_color_space
@@ -505,7 +523,8 @@ color_key_get_color_space(void *data, size_t count,
 struct obs_source_info color_key_filter = {
 	.id = "color_key_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = color_key_name,
 	.create = color_key_create_v1,
 	.destroy = color_key_destroy_v1,
@@ -519,7 +538,8 @@ struct obs_source_info color_key_filter_v2 = {
 	.id = "color_key_filter",
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = color_key_name,
 	.create = color_key_create_v2,
 	.destroy = color_key_destroy_v2,
@@ -319,20 +319,19 @@ static void analyze_envelope(struct expander_data *cd, float **samples,
 		float *env_in = cd->env_in;
 
 		if (cd->detector == RMS_DETECT) {
-			runave[0] =
-				rmscoef * cd->runave[chan] +
-				(1 - rmscoef) * powf(samples[chan][0], 2.0f);
+			runave[0] = rmscoef * cd->runave[chan] +
+				    (1 - rmscoef) * samples[chan][0] *
+					    samples[chan][0];
 			env_in[0] = sqrtf(fmaxf(runave[0], 0));
 			for (uint32_t i = 1; i < num_samples; ++i) {
-				runave[i] =
-					rmscoef * runave[i - 1] +
-					(1 - rmscoef) *
-						powf(samples[chan][i], 2.0f);
+				runave[i] = rmscoef * runave[i - 1] +
+					    (1 - rmscoef) * samples[chan][i] *
+						    samples[chan][i];
 				env_in[i] = sqrtf(runave[i]);
 			}
 		} else if (cd->detector == PEAK_DETECT) {
 			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
+				runave[i] = samples[chan][i] * samples[chan][i];
 				env_in[i] = fabsf(samples[chan][i]);
 			}
 		}
@@ -344,18 +343,17 @@ static void analyze_envelope(struct expander_data *cd, float **samples,
 	}
 }
 
-static inline void process_sample(size_t idx, float *samples, float *env_buf,
+static inline void process_sample(size_t idx, const float *env_db_buf,
 				  float *gain_db, bool is_upwcomp,
 				  float channel_gain, float threshold,
 				  float slope, float attack_gain,
 				  float inv_attack_gain, float release_gain,
-				  float inv_release_gain, float output_gain,
-				  float knee)
+				  float inv_release_gain, float knee)
 {
 	/* --------------------------------- */
 	/* gain stage of expansion           */
 
-	float env_db = mul_to_db(env_buf[idx]);
+	float env_db = env_db_buf[idx];
 	float diff = threshold - env_db;
 
 	if (is_upwcomp && env_db <= (threshold - 60.0f) / 2)
@@ -377,7 +375,8 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf,
 		// gain in knee:
 		if (env_db > threshold - knee / 2 &&
 		    threshold + knee / 2 > env_db)
-			gain = slope * powf(diff + knee / 2, 2) / (2.0f * knee);
+			gain = slope * (diff + knee / 2) * (diff + knee / 2) /
+			       (2.0f * knee);
 	} else {
 		prev_gain = idx > 0 ? gain_db[idx - 1] : channel_gain;
 		gain = diff > 0.0f ? fmaxf(slope * diff, -60.0f) : 0.0f;
@@ -391,17 +390,6 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf,
 	else
 		gain_db[idx] =
 			release_gain * prev_gain + inv_release_gain * gain;
-
-	/* --------------------------------- */
-	/* output                            */
-
-	if (!is_upwcomp) {
-		gain = db_to_mul(fminf(0, gain_db[idx]));
-	} else {
-		gain = db_to_mul(gain_db[idx]);
-	}
-
-	samples[idx] *= gain * output_gain;
 }
 
 // gain stage and ballistics in dB domain
@@ -431,13 +419,23 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 		float *gain_db = cd->gain_db[chan];
 		float channel_gain = cd->gain_db_buf[chan];
 
+		/* only the ballistics depend on the previous sample, the
+		 * conversions to and from dB run vectorized around them */
+		audio_mul_to_db(env_buf, num_samples);
+
 		for (size_t i = 0; i < num_samples; ++i) {
-			process_sample(i, channel_samples, env_buf, gain_db,
-				       is_upwcomp, channel_gain, threshold,
-				       slope, attack_gain, inv_attack_gain,
-				       release_gain, inv_release_gain,
-				       output_gain, knee);
+			process_sample(i, env_buf, gain_db, is_upwcomp,
+				       channel_gain, threshold, slope,
+				       attack_gain, inv_attack_gain,
+				       release_gain, inv_release_gain, knee);
 		}
+
+		/* the upward compressor's gain is never clipped at 0 dB */
+		audio_db_to_gain(env_buf, gain_db,
+				 is_upwcomp ? INFINITY : 0.0f, output_gain,
+				 num_samples);
+		if (channel_samples)
+			audio_mul_ramp(channel_samples, env_buf, num_samples);
 		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
 	}
 }
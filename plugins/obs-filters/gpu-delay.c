@@ -1,14 +1,26 @@
 #include <obs-module.h>
 #include <util/deque.h>
+#include <util/dstr.h>
+#include <util/threading.h>
 #include <util/util_uint64.h>
 
 #define S_DELAY_MS "delay_ms"
+#define S_COMPACT "compact"
+#define S_MEMORY_USAGE "memory_usage"
 #define T_DELAY_MS obs_module_text("DelayMs")
+#define T_COMPACT obs_module_text("GPUDelay.Compact")
+#define T_MEMORY_USAGE obs_module_text("GPUDelay.MemoryUsage")
 
+/* Compact frames keep luma and alpha in one two channel texture at full
+ * resolution and chroma in another at half resolution in each direction,
+ * which takes 2.5 bytes per pixel instead of 4.  Only SDR frames are stored
+ * this way; anything else still gets a full texture. */
 struct frame {
 	gs_texrender_t *render;
+	gs_texrender_t *chroma;
 	enum gs_color_space space;
 	uint64_t ts;
+	bool compact;
 };
 
 struct gpu_delay_filter_data {
@@ -20,6 +32,11 @@ struct gpu_delay_filter_data {
 	uint32_t cy;
 	bool target_valid;
 	bool processed_frame;
+
+	bool compact;
+	gs_effect_t *effect;
+	gs_texrender_t *scratch;
+	volatile long memory_kb;
 };
 
 static const char *gpu_delay_filter_get_name(void *unused)
@@ -35,9 +52,14 @@ static void free_textures(struct gpu_delay_filter_data *f)
 		struct frame frame;
 		deque_pop_front(&f->frames, &frame, sizeof(frame));
 		gs_texrender_destroy(frame.render);
+		gs_texrender_destroy(frame.chroma);
 	}
 	deque_free(&f->frames);
+	gs_texrender_destroy(f->scratch);
+	f->scratch = NULL;
 	obs_leave_graphics();
+
+	os_atomic_set_long(&f->memory_kb, 0);
 }
 
 static size_t num_frames(struct deque *buf)
@@ -79,6 +101,7 @@ static void update_interval(struct gpu_delay_filter_data *f,
 			struct frame frame;
 			deque_pop_front(&f->frames, &frame, sizeof(frame));
 			gs_texrender_destroy(frame.render);
+			gs_texrender_destroy(frame.chroma);
 		}
 
 		obs_leave_graphics();
@@ -137,6 +160,7 @@ static void gpu_delay_filter_update(void *data, obs_data_t *s)
 	struct gpu_delay_filter_data *f = data;
 
 	f->delay_ns = (uint64_t)obs_data_get_int(s, S_DELAY_MS) * 1000000ULL;
+	f->compact = obs_data_get_bool(s, S_COMPACT);
 
 	/* full reset */
 	f->cx = 0;
@@ -147,22 +171,45 @@ static void gpu_delay_filter_update(void *data, obs_data_t *s)
 
 static obs_properties_t *gpu_delay_filter_properties(void *data)
 {
+	struct gpu_delay_filter_data *f = data;
 	obs_properties_t *props = obs_properties_create();
 
 	obs_property_t *p = obs_properties_add_int(props, S_DELAY_MS,
 						   T_DELAY_MS, 0, 500, 1);
 	obs_property_int_set_suffix(p, " ms");
 
-	UNUSED_PARAMETER(data);
+	obs_properties_add_bool(props, S_COMPACT, T_COMPACT);
+
+	if (f) {
+		struct dstr text = {0};
+		long kb = os_atomic_load_long(&f->memory_kb);
+
+		dstr_printf(&text, T_MEMORY_USAGE, (double)kb / 1024.0);
+		obs_properties_add_text(props, S_MEMORY_USAGE, text.array,
+					OBS_TEXT_INFO);
+		dstr_free(&text);
+	}
+
 	return props;
 }
 
+static void gpu_delay_filter_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_bool(settings, S_COMPACT, false);
+}
+
 static void *gpu_delay_filter_create(obs_data_t *settings,
 				     obs_source_t *context)
 {
 	struct gpu_delay_filter_data *f = bzalloc(sizeof(*f));
 	f->context = context;
 
+	char *effect_path = obs_module_file("gpu_delay.effect");
+	obs_enter_graphics();
+	f->effect = gs_effect_create_from_file(effect_path, NULL);
+	obs_leave_graphics();
+	bfree(effect_path);
+
 	obs_source_update(context, settings);
 	return f;
 }
@@ -172,6 +219,11 @@ static void gpu_delay_filter_destroy(void *data)
 	struct gpu_delay_filter_data *f = data;
 
 	free_textures(f);
+
+	obs_enter_graphics();
+	gs_effect_destroy(f->effect);
+	obs_leave_graphics();
+
 	bfree(f);
 }
 
@@ -237,6 +289,31 @@ get_tech_name_and_multiplier(enum gs_color_space current_space,
 	return tech_name;
 }
 
+static void draw_compact_frame(struct gpu_delay_filter_data *f,
+			       const struct frame *frame, float multiplier)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(frame->render);
+	gs_texture_t *uv = gs_texrender_get_texture(frame->chroma);
+	if (!tex || !uv)
+		return;
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(f->effect, "image"),
+			      tex);
+	gs_effect_set_texture(
+		gs_effect_get_param_by_name(f->effect, "image_uv"), uv);
+	gs_effect_set_float(gs_effect_get_param_by_name(f->effect,
+							"multiplier"),
+			    multiplier);
+
+	while (gs_effect_loop(f->effect, "Unpack"))
+		gs_draw_sprite(tex, 0, f->cx, f->cy);
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
 static void draw_frame(struct gpu_delay_filter_data *f)
 {
 	struct frame frame;
@@ -247,6 +324,11 @@ static void draw_frame(struct gpu_delay_filter_data *f)
 	const char *technique = get_tech_name_and_multiplier(
 		current_space, frame.space, &multiplier);
 
+	if (frame.compact) {
+		draw_compact_frame(f, &frame, multiplier);
+		return;
+	}
+
 	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
 	gs_texture_t *tex = gs_texrender_get_texture(frame.render);
 	if (tex) {
@@ -266,6 +348,74 @@ static void draw_frame(struct gpu_delay_filter_data *f)
 	}
 }
 
+static void pack_plane(struct gpu_delay_filter_data *f, gs_texrender_t *dst,
+		       gs_texture_t *src, uint32_t cx, uint32_t cy,
+		       const char *technique)
+{
+	gs_texrender_reset(dst);
+	if (!gs_texrender_begin(dst, cx, cy))
+		return;
+
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+	gs_effect_set_texture(gs_effect_get_param_by_name(f->effect, "image"),
+			      src);
+
+	while (gs_effect_loop(f->effect, technique))
+		gs_draw_sprite(src, 0, cx, cy);
+
+	gs_texrender_end(dst);
+}
+
+static void pack_frame(struct gpu_delay_filter_data *f, struct frame *frame)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(f->scratch);
+	if (!tex)
+		return;
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(false);
+
+	pack_plane(f, frame->render, tex, f->cx, f->cy, "PackY");
+	pack_plane(f, frame->chroma, tex, (f->cx + 1) / 2, (f->cy + 1) / 2,
+		   "PackUV");
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
+static inline void replace_texrender(gs_texrender_t **render,
+				     enum gs_color_format format)
+{
+	if (!*render || gs_texrender_get_format(*render) != format) {
+		gs_texrender_destroy(*render);
+		*render = gs_texrender_create(format, GS_ZS_NONE);
+	}
+}
+
+static uint64_t texrender_size(gs_texrender_t *render)
+{
+	gs_texture_t *tex = render ? gs_texrender_get_texture(render) : NULL;
+	if (!tex)
+		return 0;
+
+	uint64_t bpp = gs_get_format_bpp(gs_texture_get_color_format(tex));
+	return (uint64_t)gs_texture_get_width(tex) *
+	       gs_texture_get_height(tex) * bpp / 8;
+}
+
+static void update_memory_usage(struct gpu_delay_filter_data *f)
+{
+	uint64_t size = texrender_size(f->scratch);
+
+	for (size_t i = 0; i < num_frames(&f->frames); i++) {
+		struct frame *frame =
+			deque_data(&f->frames, i * sizeof(*frame));
+		size += texrender_size(frame->render);
+		size += texrender_size(frame->chroma);
+	}
+
+	os_atomic_set_long(&f->memory_kb, (long)(size / 1024));
+}
+
 static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 {
 	struct gpu_delay_filter_data *f = data;
@@ -293,18 +443,27 @@ static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 	const enum gs_color_space space = obs_source_get_color_space(
 		target, OBS_COUNTOF(preferred_spaces), preferred_spaces);
 	const enum gs_color_format format = gs_get_format_from_space(space);
-	if (gs_texrender_get_format(frame.render) != format) {
-		gs_texrender_destroy(frame.render);
-		frame.render = gs_texrender_create(format, GS_ZS_NONE);
+	const bool compact = f->compact && f->effect && space == GS_CS_SRGB;
+	gs_texrender_t *render;
+
+	if (compact) {
+		replace_texrender(&frame.render, GS_R8G8);
+		replace_texrender(&frame.chroma, GS_R8G8);
+		replace_texrender(&f->scratch, format);
+		render = f->scratch;
+	} else {
+		replace_texrender(&frame.render, format);
+		gs_texrender_destroy(frame.chroma);
+		frame.chroma = NULL;
+		render = frame.render;
 	}
 
-	gs_texrender_reset(frame.render);
+	gs_texrender_reset(render);
 
 	gs_blend_state_push();
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
 
-	if (gs_texrender_begin_with_color_space(frame.render, f->cx, f->cy,
-						space)) {
+	if (gs_texrender_begin_with_color_space(render, f->cx, f->cy, space)) {
 		uint32_t parent_flags = obs_source_get_output_flags(target);
 		bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
 		bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
@@ -320,9 +479,13 @@ static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 		else
 			obs_source_video_render(target);
 
-		gs_texrender_end(frame.render);
+		gs_texrender_end(render);
+
+		if (compact)
+			pack_frame(f, &frame);
 
 		frame.space = space;
+		frame.compact = compact;
 	}
 
 	gs_blend_state_pop();
@@ -331,6 +494,8 @@ static void gpu_delay_filter_render(void *data, gs_effect_t *effect)
 	draw_frame(f);
 	f->processed_frame = true;
 
+	update_memory_usage(f);
+
 	UNUSED_PARAMETER(effect);
 }
 
@@ -367,6 +532,7 @@ struct obs_source_info gpu_delay_filter = {
 	.destroy = gpu_delay_filter_destroy,
 	.update = gpu_delay_filter_update,
 	.get_properties = gpu_delay_filter_properties,
+	.get_defaults = gpu_delay_filter_defaults,
 	.video_tick = gpu_delay_filter_tick,
 	.video_render = gpu_delay_filter_render,
 	.video_get_color_space = gpu_delay_filter_get_color_space,
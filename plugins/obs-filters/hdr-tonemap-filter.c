@@ -13,6 +13,9 @@ struct hdr_tonemap_filter_data {
 	gs_eparam_t *param_multiplier;
 	gs_eparam_t *param_input_maximum_nits;
 	gs_eparam_t *param_output_maximum_nits;
+	gs_eparam_t *param_lut;
+	gs_eparam_t *param_lut_input_scale;
+	gs_eparam_t *param_lut_scale_offset;
 
 	enum hdr_tonemap_transform transform;
 	float sdr_white_level_nits_i;
@@ -53,6 +56,11 @@ static void *hdr_tonemap_filter_create(obs_data_t *settings,
 		filter->effect, "input_maximum_nits");
 	filter->param_output_maximum_nits = gs_effect_get_param_by_name(
 		filter->effect, "output_maximum_nits");
+	filter->param_lut = gs_effect_get_param_by_name(filter->effect, "lut");
+	filter->param_lut_input_scale = gs_effect_get_param_by_name(
+		filter->effect, "lut_input_scale");
+	filter->param_lut_scale_offset = gs_effect_get_param_by_name(
+		filter->effect, "lut_scale_offset");
 
 	obs_source_update(context, settings);
 	return filter;
@@ -168,6 +176,30 @@ static void hdr_tonemap_filter_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "sdr_output_maximum_nits", 300);
 }
 
+/* the curves come from libobs' shared lookup textures, the techniques
+ * without them are only used if the texture can't be created */
+static bool set_lut(struct hdr_tonemap_filter_data *filter,
+		    float input_maximum_nits, float output_maximum_nits)
+{
+	const bool reinhard = filter->transform == TRANSFORM_SDR_REINHARD;
+	gs_texture_t *lut = obs_get_tonemap_lut(
+		reinhard ? OBS_TONEMAP_LUT_REINHARD : OBS_TONEMAP_LUT_MAXRGB,
+		input_maximum_nits, output_maximum_nits);
+	if (!lut)
+		return false;
+
+	struct vec2 scale_offset;
+	vec2_set(&scale_offset,
+		 (float)(OBS_TONEMAP_LUT_SIZE - 1) / OBS_TONEMAP_LUT_SIZE,
+		 0.5f / OBS_TONEMAP_LUT_SIZE);
+
+	gs_effect_set_texture(filter->param_lut, lut);
+	gs_effect_set_float(filter->param_lut_input_scale,
+			    reinhard ? 1.0f : 10000.f / input_maximum_nits);
+	gs_effect_set_vec2(filter->param_lut_scale_offset, &scale_offset);
+	return true;
+}
+
 static void hdr_tonemap_filter_render(void *data, gs_effect_t *effect)
 {
 	UNUSED_PARAMETER(effect);
@@ -198,29 +230,37 @@ static void hdr_tonemap_filter_render(void *data, gs_effect_t *effect)
 		if (obs_source_process_filter_begin_with_color_space(
 			    filter->context, format, source_space,
 			    OBS_NO_DIRECT_RENDERING)) {
-			gs_effect_set_float(filter->param_multiplier,
-					    multiplier);
-			gs_effect_set_float(
-				filter->param_input_maximum_nits,
+			const float input_maximum_nits =
 				(filter->transform == TRANSFORM_SDR_MAXRGB)
 					? filter->sdr_input_maximum_nits
-					: filter->hdr_input_maximum_nits);
-			gs_effect_set_float(
-				filter->param_output_maximum_nits,
+					: filter->hdr_input_maximum_nits;
+			const float output_maximum_nits =
 				(filter->transform == TRANSFORM_SDR_MAXRGB)
 					? filter->sdr_output_maximum_nits
-					: filter->hdr_output_maximum_nits);
+					: filter->hdr_output_maximum_nits;
+			const bool use_lut = set_lut(filter,
+						     input_maximum_nits,
+						     output_maximum_nits);
+
+			gs_effect_set_float(filter->param_multiplier,
+					    multiplier);
+			gs_effect_set_float(filter->param_input_maximum_nits,
+					    input_maximum_nits);
+			gs_effect_set_float(filter->param_output_maximum_nits,
+					    output_maximum_nits);
 
 			gs_blend_state_push();
 			gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
-			const char *const tech_name =
-				(filter->transform == TRANSFORM_SDR_REINHARD)
-					? "Reinhard"
-					: ((filter->transform ==
-					    TRANSFORM_HDR_MAXRGB)
-						   ? "MaxRGB"
-						   : "MaxRGBSDR");
+			const char *tech_name;
+			if (filter->transform == TRANSFORM_SDR_REINHARD)
+				tech_name = use_lut ? "ReinhardLut"
+						    : "Reinhard";
+			else if (filter->transform == TRANSFORM_HDR_MAXRGB)
+				tech_name = use_lut ? "MaxRGBLut" : "MaxRGB";
+			else
+				tech_name = use_lut ? "MaxRGBSDRLut"
+						    : "MaxRGBSDR";
 			obs_source_process_filter_tech_end(filter->context,
 							   filter->effect, 0, 0,
 							   tech_name);
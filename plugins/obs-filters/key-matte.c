@@ -0,0 +1,162 @@
+#include "key-matte.h"
+
+#include <graphics/vec2.h>
+
+#define TEXT_MATTE_SCALE obs_module_text("KeyMatte.Resolution")
+#define TEXT_MATTE_FULL obs_module_text("KeyMatte.Full")
+#define TEXT_MATTE_HALF obs_module_text("KeyMatte.Half")
+#define TEXT_MATTE_QUARTER obs_module_text("KeyMatte.Quarter")
+
+void key_matte_properties(obs_properties_t *props)
+{
+	obs_property_t *p = obs_properties_add_list(props, SETTING_MATTE_SCALE,
+						    TEXT_MATTE_SCALE,
+						    OBS_COMBO_TYPE_LIST,
+						    OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, TEXT_MATTE_FULL, 1);
+	obs_property_list_add_int(p, TEXT_MATTE_HALF, 2);
+	obs_property_list_add_int(p, TEXT_MATTE_QUARTER, 4);
+}
+
+void key_matte_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, SETTING_MATTE_SCALE, 1);
+}
+
+void key_matte_update(struct key_matte *km, obs_data_t *settings)
+{
+	long long scale = obs_data_get_int(settings, SETTING_MATTE_SCALE);
+
+	km->scale = (scale == 2 || scale == 4) ? (uint32_t)scale : 1;
+}
+
+void key_matte_free(struct key_matte *km)
+{
+	if (!km->downscaled && !km->matte)
+		return;
+
+	obs_enter_graphics();
+	gs_texrender_destroy(km->downscaled);
+	gs_texrender_destroy(km->matte);
+	obs_leave_graphics();
+
+	km->downscaled = NULL;
+	km->matte = NULL;
+}
+
+static bool render_downscaled(struct key_matte *km, obs_source_t *target,
+			      obs_source_t *parent, uint32_t cx, uint32_t cy,
+			      uint32_t matte_cx, uint32_t matte_cy,
+			      enum gs_color_space space)
+{
+	const enum gs_color_format format = gs_get_format_from_space(space);
+	bool success = false;
+
+	if (km->downscaled &&
+	    gs_texrender_get_format(km->downscaled) != format) {
+		gs_texrender_destroy(km->downscaled);
+		km->downscaled = NULL;
+	}
+	if (!km->downscaled)
+		km->downscaled = gs_texrender_create(format, GS_ZS_NONE);
+
+	const uint32_t parent_flags = obs_source_get_output_flags(parent);
+	const bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+	const bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
+
+	gs_texrender_reset(km->downscaled);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	/* drawing the full size source into the smaller target lets the
+	 * sampler do the downscaling */
+	if (gs_texrender_begin_with_color_space(km->downscaled, matte_cx,
+						matte_cy, space)) {
+		struct vec4 clear_color;
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		if (target == parent && !custom_draw && !async)
+			obs_source_default_render(target);
+		else
+			obs_source_video_render(target);
+
+		gs_texrender_end(km->downscaled);
+		success = true;
+	}
+
+	gs_blend_state_pop();
+	return success;
+}
+
+static bool render_matte(struct key_matte *km, gs_effect_t *effect,
+			 uint32_t matte_cx, uint32_t matte_cy)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(km->downscaled);
+	bool success = false;
+
+	if (!tex)
+		return false;
+
+	/* rgb is the downscaled image used as the guide, alpha the matte
+	 * before smoothing, which can be negative */
+	if (!km->matte)
+		km->matte = gs_texrender_create(GS_RGBA16F, GS_ZS_NONE);
+
+	gs_texrender_reset(km->matte);
+	if (gs_texrender_begin(km->matte, matte_cx, matte_cy)) {
+		const bool previous = gs_set_linear_srgb(true);
+
+		gs_enable_blending(false);
+		gs_ortho(0.0f, (float)matte_cx, 0.0f, (float)matte_cy, -100.0f,
+			 100.0f);
+
+		gs_effect_set_texture_srgb(
+			gs_effect_get_param_by_name(effect, "image"), tex);
+		while (gs_effect_loop(effect, "Matte"))
+			gs_draw_sprite(tex, 0, matte_cx, matte_cy);
+
+		gs_enable_blending(true);
+		gs_set_linear_srgb(previous);
+
+		gs_texrender_end(km->matte);
+		success = true;
+	}
+
+	return success;
+}
+
+bool key_matte_render(struct key_matte *km, obs_source_t *context,
+		      gs_effect_t *effect, enum gs_color_space space)
+{
+	if (km->scale <= 1 || !gs_effect_get_technique(effect, "Matte"))
+		return false;
+
+	obs_source_t *target = obs_filter_get_target(context);
+	obs_source_t *parent = obs_filter_get_parent(context);
+	if (!target || !parent)
+		return false;
+
+	const uint32_t cx = obs_source_get_base_width(target);
+	const uint32_t cy = obs_source_get_base_height(target);
+	if (cx < km->scale || cy < km->scale)
+		return false;
+
+	const uint32_t matte_cx = (cx + km->scale - 1) / km->scale;
+	const uint32_t matte_cy = (cy + km->scale - 1) / km->scale;
+
+	if (!render_downscaled(km, target, parent, cx, cy, matte_cx, matte_cy,
+			       space) ||
+	    !render_matte(km, effect, matte_cx, matte_cy))
+		return false;
+
+	struct vec2 matte_size;
+	vec2_set(&matte_size, (float)matte_cx, (float)matte_cy);
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "matte"),
+			      gs_texrender_get_texture(km->matte));
+	gs_effect_set_vec2(gs_effect_get_param_by_name(effect, "matte_size"),
+			   &matte_size);
+	return true;
+}
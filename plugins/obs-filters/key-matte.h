@@ -0,0 +1,32 @@
+#pragma once
+
+#include <obs-module.h>
+
+/*
+ * Reduced resolution mattes for the keying filters
+ *
+ *   The source is drawn at half or quarter size, the key effect's "Matte"
+ * technique turns that into a matte, and the "DrawRefined" technique then
+ * upsamples it at full size, using the full-size image as a guide so the
+ * edges follow the image instead of the low resolution matte.  Effects that
+ * support this include key_matte.effect.
+ */
+
+#define SETTING_MATTE_SCALE "matte_scale"
+
+struct key_matte {
+	gs_texrender_t *downscaled;
+	gs_texrender_t *matte;
+	uint32_t scale;
+};
+
+extern void key_matte_properties(obs_properties_t *props);
+extern void key_matte_defaults(obs_data_t *settings);
+extern void key_matte_update(struct key_matte *km, obs_data_t *settings);
+extern void key_matte_free(struct key_matte *km);
+
+/* renders the matte for the filter's target with the key parameters that are
+ * currently set on the effect.  on success the matte is set on the effect and
+ * the filter is drawn with the "DrawRefined" technique instead of "Draw". */
+extern bool key_matte_render(struct key_matte *km, obs_source_t *context,
+			     gs_effect_t *effect, enum gs_color_space space);
@@ -133,42 +133,23 @@ static void analyze_envelope(struct limiter_data *cd, float **samples,
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
+	audio_envelope_peak(cd->envelope_buf, samples, cd->num_channels,
+			    num_samples, cd->envelope, cd->attack_gain,
+			    cd->release_gain);
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
 
 static inline void process_compression(const struct limiter_data *cd,
 				       float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
+	/* the envelope is no longer needed, so turn it into the gain */
+	float *gain = cd->envelope_buf;
+	audio_compressor_gain(gain, gain, cd->threshold, cd->slope,
+			      cd->output_gain, num_samples);
+
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		if (samples[c])
+			audio_mul_ramp(samples[c], gain, num_samples);
 	}
 }
 
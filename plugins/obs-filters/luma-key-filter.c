@@ -1,5 +1,7 @@
 #include <obs-module.h>
 
+#include "key-matte.h"
+
 /* clang-format off */
 
 #define SETTING_SDR_ONLY_INFO      "sdr_only_info"
@@ -30,6 +32,8 @@ struct luma_key_filter_data {
 	float luma_min;
 	float luma_max_smooth;
 	float luma_min_smooth;
+
+	struct key_matte matte;
 };
 
 static const char *luma_key_name(void *unused)
@@ -53,6 +57,8 @@ static void luma_key_update(void *data, obs_data_t *settings)
 	filter->luma_min = (float)lumaMin;
 	filter->luma_max_smooth = (float)lumaMaxSmooth;
 	filter->luma_min_smooth = (float)lumaMinSmooth;
+
+	key_matte_update(&filter->matte, settings);
 }
 
 static void luma_key_destroy(void *data)
@@ -65,6 +71,8 @@ static void luma_key_destroy(void *data)
 		obs_leave_graphics();
 	}
 
+	key_matte_free(&filter->matte);
+
 	bfree(data);
 }
 
@@ -147,14 +155,23 @@ static void luma_key_render_internal(void *data, bool premultiplied)
 			gs_effect_set_float(filter->luma_min_smooth_param,
 					    filter->luma_min_smooth);
 
+			/* only the premultiplied version has a matte
+			 * technique */
+			const bool refined =
+				premultiplied &&
+				key_matte_render(&filter->matte,
+						 filter->context,
+						 filter->effect, source_space);
+
 			if (premultiplied) {
 				gs_blend_state_push();
 				gs_blend_function(GS_BLEND_ONE,
 						  GS_BLEND_INVSRCALPHA);
 			}
 
-			obs_source_process_filter_end(filter->context,
-						      filter->effect, 0, 0);
+			obs_source_process_filter_tech_end(
+				filter->context, filter->effect, 0, 0,
+				refined ? "DrawRefined" : "Draw");
 
 			if (premultiplied) {
 				gs_blend_state_pop();
@@ -191,6 +208,7 @@ static obs_properties_t *luma_key_properties(void *data)
 					0, 1, 0.0001);
 	obs_properties_add_float_slider(props, SETTING_LUMA_MIN_SMOOTH,
 					TEXT_LUMA_MIN_SMOOTH, 0, 1, 0.0001);
+	key_matte_properties(props);
 
 	UNUSED_PARAMETER(data);
 	return props;
@@ -202,6 +220,7 @@ static void luma_key_defaults(obs_data_t *settings)
 	obs_data_set_default_double(settings, SETTING_LUMA_MIN, 0.0);
 	obs_data_set_default_double(settings, SETTING_LUMA_MAX_SMOOTH, 0.0);
 	obs_data_set_default_double(settings, SETTING_LUMA_MIN_SMOOTH, 0.0);
+	key_matte_defaults(settings);
 }
 
 static enum gs_color_space
@@ -228,7 +247,8 @@ luma_key_get_color_space(void *data, size_t count,
 struct obs_source_info luma_key_filter = {
 	.id = "luma_key_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = luma_key_name,
 	.create = luma_key_create_v1,
 	.destroy = luma_key_destroy,
@@ -242,7 +262,8 @@ struct obs_source_info luma_key_filter_v2 = {
 	.id = "luma_key_filter",
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = luma_key_name,
 	.create = luma_key_create_v2,
 	.destroy = luma_key_destroy,
@@ -21,6 +21,9 @@ bool nvafx_loaded = false;
 #ifdef LIBNVAFX_ENABLED
 #include "nvafx-load.h"
 #include <pthread.h>
+#include <errno.h>
+#include <util/darray.h>
+#include <util/platform.h>
 #endif
 
 /* -------------------------------------------------------- */
@@ -112,12 +115,11 @@ struct noise_suppress_data {
 #endif
 
 #ifdef LIBNVAFX_ENABLED
-	/* NVAFX handle, one per audio channel */
-	NvAFX_Handle handle[MAX_PREPROC_CHANNELS];
+	/* NVAFX stream of a shared effect, one per audio channel */
+	struct nvafx_stream *nvafx_streams[MAX_PREPROC_CHANNELS];
 
 	uint32_t sample_rate;
 	float intensity_ratio;
-	unsigned int num_samples_per_frame, num_channels;
 	char *model;
 	bool nvafx_initialized;
 	const char *fx;
@@ -127,9 +129,6 @@ struct noise_suppress_data {
 	audio_resampler_t *nvafx_resampler;
 	audio_resampler_t *nvafx_resampler_back;
 
-	/* Initialization */
-	bool nvafx_loading;
-	pthread_t nvafx_thread;
 	pthread_mutex_t nvafx_mutex;
 #endif
 	/* PCM buffers */
@@ -155,6 +154,538 @@ bool nvafx_initializer_mutex_initialized;
 pthread_mutex_t nvafx_initializer_mutex;
 #endif
 
+#ifdef LIBNVAFX_ENABLED
+/* -------------------------------------------------------- */
+/* Batched NVAFX effects
+ *
+ *   Rather than every channel of every filter running an effect of its own,
+ * all channels using the same effect share a single effect that was loaded
+ * with one stream per channel.  A service thread runs each effect once per
+ * 10 ms frame on whatever the streams queued since the last run, so there is
+ * one GPU launch per effect and tick instead of one per channel.  Processed
+ * frames come back NVAFX_BATCH_DELAY frames later. */
+
+#define NVAFX_BATCH_DELAY 2
+#define NVAFX_MIN_STREAMS 2
+#define NVAFX_FRAME_BYTES (NVAFX_FRAME_SIZE * sizeof(float))
+#define NVAFX_TICK_NS (1000000000ULL / (1000 / BUFFER_SIZE_MSEC))
+
+struct nvafx_batch;
+
+struct nvafx_stream {
+	struct nvafx_batch *batch;
+	uint64_t id;
+	size_t slot;
+	float intensity;
+
+	struct deque input;
+	struct deque output;
+
+	/* frames the service has taken but not given back yet */
+	size_t in_flight;
+	/* results to throw away because the frame was already played */
+	size_t skip;
+};
+
+struct nvafx_batch {
+	char *fx;
+	char *model;
+
+	NvAFX_Handle handle;
+	uint32_t num_streams;
+	bool intensity_dirty;
+	bool run_failed;
+
+	/* streams by slot, NULL for free slots.  only slots below num_streams
+	 * are processed, the others wait for a handle with more streams */
+	DARRAY(struct nvafx_stream *) slots;
+
+	/* bigger handle being loaded on load_thread */
+	bool loading;
+	bool load_done;
+	bool load_failed;
+	pthread_t load_thread;
+	NvAFX_Handle new_handle;
+	uint32_t new_num_streams;
+
+	/* per slot frame buffers for NvAFX_Run */
+	float *buffer;
+	const float **in;
+	float **out;
+	uint64_t *ids;
+	float *intensities;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	DARRAY(struct nvafx_batch *) batches;
+	uint64_t next_id;
+
+	os_event_t *stop_event;
+	pthread_t thread;
+	bool thread_active;
+} nvafx_service = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static size_t nvafx_batch_used_slots(struct nvafx_batch *batch)
+{
+	size_t used = 0;
+	for (size_t i = 0; i < batch->slots.num; i++) {
+		if (batch->slots.array[i])
+			used = i + 1;
+	}
+	return used;
+}
+
+static NvAFX_Handle nvafx_batch_create_handle(const char *fx,
+					      const char *model,
+					      uint32_t num_streams)
+{
+	NvAFX_Handle handle = NULL;
+	NvAFX_Status err;
+	uint32_t value;
+	CUcontext old = {0};
+	CUcontext curr = {0};
+
+	pthread_mutex_lock(&nvafx_initializer_mutex);
+
+	if (cuCtxGetCurrent(&old) != CUDA_SUCCESS)
+		goto failure;
+
+	err = NvAFX_CreateEffect(fx, &handle);
+	if (err != NVAFX_STATUS_SUCCESS) {
+		blog(LOG_ERROR, "[noise suppress]: %s FX creation failed, "
+				"error %i",
+		     fx, err);
+		goto failure;
+	}
+	if (cuCtxGetCurrent(&curr) != CUDA_SUCCESS)
+		goto failure;
+	if (curr != old)
+		cuCtxPopCurrent(NULL);
+
+	err = NvAFX_SetU32(handle, NVAFX_PARAM_INPUT_SAMPLE_RATE,
+			   NVAFX_SAMPLE_RATE);
+	if (err != NVAFX_STATUS_SUCCESS) {
+		blog(LOG_ERROR,
+		     "[noise suppress]: NvAFX_SetU32(Sample Rate: %u) failed, "
+		     "error %i",
+		     NVAFX_SAMPLE_RATE, err);
+		goto failure;
+	}
+
+	err = NvAFX_SetU32(handle, NVAFX_PARAM_NUM_STREAMS, num_streams);
+	if (err != NVAFX_STATUS_SUCCESS) {
+		blog(LOG_ERROR,
+		     "[noise suppress]: NvAFX_SetU32(Streams: %u) failed, "
+		     "error %i",
+		     num_streams, err);
+		goto failure;
+	}
+
+	err = NvAFX_SetString(handle, NVAFX_PARAM_MODEL_PATH, model);
+	if (err != NVAFX_STATUS_SUCCESS) {
+		blog(LOG_ERROR,
+		     "[noise suppress]: NvAFX_SetString() failed, error %i",
+		     err);
+		goto failure;
+	}
+
+	err = NvAFX_Load(handle);
+	if (err != NVAFX_STATUS_SUCCESS) {
+		blog(LOG_ERROR,
+		     "[noise suppress]: NvAFX_Load() failed with error %i",
+		     err);
+		goto failure;
+	}
+
+	err = NvAFX_GetU32(handle, NVAFX_PARAM_NUM_INPUT_CHANNELS, &value);
+	if (err != NVAFX_STATUS_SUCCESS || value != 1) {
+		blog(LOG_ERROR, "[noise suppress]: The number of channels is "
+				"not 1 in the sdk any more ==> update code");
+		goto failure;
+	}
+
+	err = NvAFX_GetU32(handle, NVAFX_PARAM_NUM_INPUT_SAMPLES_PER_FRAME,
+			   &value);
+	if (err != NVAFX_STATUS_SUCCESS || value != NVAFX_FRAME_SIZE) {
+		blog(LOG_ERROR,
+		     "[noise suppress]: The number of samples per frame has "
+		     "changed from 480 (= 10 ms) ==> update code");
+		goto failure;
+	}
+
+	pthread_mutex_unlock(&nvafx_initializer_mutex);
+	return handle;
+
+failure:
+	if (handle)
+		NvAFX_DestroyEffect(handle);
+	pthread_mutex_unlock(&nvafx_initializer_mutex);
+	return NULL;
+}
+
+static void *nvafx_batch_load_thread(void *data)
+{
+	struct nvafx_batch *batch = data;
+	NvAFX_Handle handle;
+
+	os_set_thread_name("nvafx: load");
+
+	/* fx, model and new_num_streams don't change while loading */
+	handle = nvafx_batch_create_handle(batch->fx, batch->model,
+					   batch->new_num_streams);
+
+	pthread_mutex_lock(&nvafx_service.mutex);
+	batch->new_handle = handle;
+	batch->load_failed = !handle;
+	batch->load_done = true;
+	pthread_mutex_unlock(&nvafx_service.mutex);
+	return NULL;
+}
+
+static void nvafx_batch_start_load(struct nvafx_batch *batch, size_t needed)
+{
+	uint32_t num_streams = NVAFX_MIN_STREAMS;
+	while (num_streams < needed)
+		num_streams *= 2;
+
+	batch->new_num_streams = num_streams;
+	batch->loading = pthread_create(&batch->load_thread, NULL,
+					nvafx_batch_load_thread, batch) == 0;
+	if (!batch->loading)
+		batch->load_failed = true;
+}
+
+/* swaps in a newly loaded handle, called from the service thread */
+static void nvafx_batch_finish_load(struct nvafx_batch *batch)
+{
+	uint32_t num_streams = batch->new_num_streams;
+
+	pthread_join(batch->load_thread, NULL);
+	batch->loading = false;
+	batch->load_done = false;
+
+	if (!batch->new_handle) {
+		blog(LOG_WARNING, "[noise suppress]: Failed to load %s with "
+				  "%u streams, leaving the audio unprocessed",
+		     batch->fx, num_streams);
+		return;
+	}
+
+	if (batch->handle)
+		NvAFX_DestroyEffect(batch->handle);
+
+	batch->handle = batch->new_handle;
+	batch->num_streams = num_streams;
+	batch->new_handle = NULL;
+	batch->intensity_dirty = true;
+	batch->run_failed = false;
+
+	bfree(batch->buffer);
+	bfree(batch->in);
+	bfree(batch->out);
+	bfree(batch->ids);
+	bfree(batch->intensities);
+	batch->buffer = bzalloc(num_streams * NVAFX_FRAME_BYTES);
+	batch->in = bzalloc(num_streams * sizeof(*batch->in));
+	batch->out = bzalloc(num_streams * sizeof(*batch->out));
+	batch->ids = bzalloc(num_streams * sizeof(*batch->ids));
+	batch->intensities =
+		bzalloc(num_streams * sizeof(*batch->intensities));
+
+	for (uint32_t i = 0; i < num_streams; i++) {
+		batch->out[i] = batch->buffer + i * NVAFX_FRAME_SIZE;
+		batch->in[i] = batch->out[i];
+	}
+
+	blog(LOG_INFO, "[noise suppress]: Loaded %s with %u streams",
+	     batch->fx, num_streams);
+}
+
+static void nvafx_batch_free(struct nvafx_batch *batch)
+{
+	if (batch->loading)
+		pthread_join(batch->load_thread, NULL);
+	if (batch->new_handle)
+		NvAFX_DestroyEffect(batch->new_handle);
+	if (batch->handle)
+		NvAFX_DestroyEffect(batch->handle);
+
+	da_free(batch->slots);
+	bfree(batch->fx);
+	bfree(batch->model);
+	bfree(batch->buffer);
+	bfree(batch->in);
+	bfree(batch->out);
+	bfree(batch->ids);
+	bfree(batch->intensities);
+	bfree(batch);
+}
+
+static void nvafx_batch_update_intensity(struct nvafx_batch *batch)
+{
+	NvAFX_Status err;
+
+	for (uint32_t i = 0; i < batch->num_streams; i++) {
+		struct nvafx_stream *stream =
+			i < batch->slots.num ? batch->slots.array[i] : NULL;
+		batch->intensities[i] = stream ? stream->intensity : 1.0f;
+	}
+
+	err = NvAFX_SetFloatList(batch->handle, NVAFX_PARAM_INTENSITY_RATIO,
+				 batch->intensities, batch->num_streams);
+	if (err != NVAFX_STATUS_SUCCESS)
+		blog(LOG_ERROR,
+		     "[noise suppress]: NvAFX_SetFloatList(Intensity Ratio) "
+		     "failed, error %i",
+		     err);
+
+	batch->intensity_dirty = false;
+}
+
+/* called with the service mutex held, which is released during the run */
+static void nvafx_batch_tick(struct nvafx_batch *batch)
+{
+	size_t used = nvafx_batch_used_slots(batch);
+	size_t count = 0;
+
+	if (batch->load_done)
+		nvafx_batch_finish_load(batch);
+
+	if (used > batch->num_streams && !batch->loading &&
+	    !batch->load_failed)
+		nvafx_batch_start_load(batch, used);
+
+	if (batch->handle && batch->intensity_dirty)
+		nvafx_batch_update_intensity(batch);
+
+	for (uint32_t i = 0; i < batch->num_streams; i++) {
+		batch->ids[i] = 0;
+		memset(batch->out[i], 0, NVAFX_FRAME_BYTES);
+	}
+
+	for (size_t i = 0; i < used; i++) {
+		struct nvafx_stream *stream = batch->slots.array[i];
+
+		if (!stream || stream->input.size < NVAFX_FRAME_BYTES)
+			continue;
+
+		/* no stream for this slot in the effect (yet), pass the
+		 * frame through unprocessed */
+		if (i >= batch->num_streams || batch->run_failed) {
+			float frame[NVAFX_FRAME_SIZE];
+			deque_pop_front(&stream->input, frame,
+					NVAFX_FRAME_BYTES);
+			deque_push_back(&stream->output, frame,
+					NVAFX_FRAME_BYTES);
+			continue;
+		}
+
+		deque_pop_front(&stream->input, batch->out[i],
+				NVAFX_FRAME_BYTES);
+		batch->ids[i] = stream->id;
+		stream->in_flight++;
+		count++;
+	}
+
+	if (!count)
+		return;
+
+	/* only the service thread frees batches or touches their buffers */
+	pthread_mutex_unlock(&nvafx_service.mutex);
+	NvAFX_Status err = NvAFX_Run(batch->handle, batch->in,
+				     batch->out, NVAFX_FRAME_SIZE, 1);
+	pthread_mutex_lock(&nvafx_service.mutex);
+
+	if (err != NVAFX_STATUS_SUCCESS) {
+		blog(LOG_ERROR,
+		     "[noise suppress]: NvAFX_Run() failed, error %i, "
+		     "leaving the audio unprocessed",
+		     err);
+		batch->run_failed = true;
+	}
+
+	/* streams destroyed in the meantime are gone from their slots */
+	for (size_t i = 0; i < batch->num_streams && i < batch->slots.num;
+	     i++) {
+		struct nvafx_stream *stream = batch->slots.array[i];
+
+		if (!batch->ids[i] || !stream || stream->id != batch->ids[i])
+			continue;
+
+		stream->in_flight--;
+		if (stream->skip)
+			stream->skip--;
+		else
+			deque_push_back(&stream->output, batch->out[i],
+					NVAFX_FRAME_BYTES);
+	}
+}
+
+static void *nvafx_service_thread(void *unused)
+{
+	uint64_t tick = os_gettime_ns();
+
+	os_set_thread_name("nvafx: service");
+
+	while (os_event_try(nvafx_service.stop_event) == EAGAIN) {
+		uint64_t now = os_gettime_ns();
+
+		tick += NVAFX_TICK_NS;
+		if (tick < now)
+			tick = now;
+		else
+			os_sleepto_ns(tick);
+
+		pthread_mutex_lock(&nvafx_service.mutex);
+
+		for (size_t i = nvafx_service.batches.num; i > 0; i--) {
+			struct nvafx_batch *batch =
+				nvafx_service.batches.array[i - 1];
+
+			if (!nvafx_batch_used_slots(batch) && !batch->loading) {
+				da_erase(nvafx_service.batches, i - 1);
+				nvafx_batch_free(batch);
+				continue;
+			}
+
+			nvafx_batch_tick(batch);
+		}
+
+		pthread_mutex_unlock(&nvafx_service.mutex);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static struct nvafx_stream *nvafx_stream_create(const char *fx,
+						const char *model,
+						float intensity)
+{
+	struct nvafx_stream *stream = bzalloc(sizeof(*stream));
+	struct nvafx_batch *batch = NULL;
+
+	stream->intensity = intensity;
+	deque_push_back_zero(&stream->output,
+			     NVAFX_BATCH_DELAY * NVAFX_FRAME_BYTES);
+
+	pthread_mutex_lock(&nvafx_service.mutex);
+
+	if (!nvafx_service.thread_active) {
+		if (os_event_init(&nvafx_service.stop_event,
+				  OS_EVENT_TYPE_MANUAL) == 0)
+			nvafx_service.thread_active =
+				pthread_create(&nvafx_service.thread, NULL,
+					       nvafx_service_thread,
+					       NULL) == 0;
+		if (!nvafx_service.thread_active)
+			blog(LOG_ERROR, "[noise suppress]: Failed to start "
+					"the NVIDIA AUDIO FX thread");
+	}
+
+	for (size_t i = 0; i < nvafx_service.batches.num; i++) {
+		struct nvafx_batch *cur = nvafx_service.batches.array[i];
+		if (strcmp(cur->fx, fx) == 0 &&
+		    strcmp(cur->model, model) == 0) {
+			batch = cur;
+			break;
+		}
+	}
+
+	if (!batch) {
+		batch = bzalloc(sizeof(*batch));
+		batch->fx = bstrdup(fx);
+		batch->model = bstrdup(model);
+		da_push_back(nvafx_service.batches, &batch);
+	}
+
+	stream->batch = batch;
+	stream->id = ++nvafx_service.next_id;
+	stream->slot = batch->slots.num;
+	for (size_t i = 0; i < batch->slots.num; i++) {
+		if (!batch->slots.array[i]) {
+			stream->slot = i;
+			break;
+		}
+	}
+
+	if (stream->slot == batch->slots.num)
+		da_push_back(batch->slots, &stream);
+	else
+		batch->slots.array[stream->slot] = stream;
+
+	batch->intensity_dirty = true;
+
+	pthread_mutex_unlock(&nvafx_service.mutex);
+	return stream;
+}
+
+static void nvafx_stream_destroy(struct nvafx_stream *stream)
+{
+	if (!stream)
+		return;
+
+	pthread_mutex_lock(&nvafx_service.mutex);
+	stream->batch->slots.array[stream->slot] = NULL;
+	pthread_mutex_unlock(&nvafx_service.mutex);
+
+	deque_free(&stream->input);
+	deque_free(&stream->output);
+	bfree(stream);
+}
+
+static void nvafx_stream_set_intensity(struct nvafx_stream *stream,
+				       float intensity)
+{
+	pthread_mutex_lock(&nvafx_service.mutex);
+	stream->intensity = intensity;
+	stream->batch->intensity_dirty = true;
+	pthread_mutex_unlock(&nvafx_service.mutex);
+}
+
+/* queues a frame and replaces it with the one processed NVAFX_BATCH_DELAY
+ * frames ago */
+static void nvafx_stream_process(struct nvafx_stream *stream, float *frame)
+{
+	pthread_mutex_lock(&nvafx_service.mutex);
+
+	deque_push_back(&stream->input, frame, NVAFX_FRAME_BYTES);
+
+	if (stream->output.size >= NVAFX_FRAME_BYTES) {
+		deque_pop_front(&stream->output, frame, NVAFX_FRAME_BYTES);
+
+	} else if (stream->in_flight) {
+		/* the frame that's due is still being processed */
+		memset(frame, 0, NVAFX_FRAME_BYTES);
+		stream->skip++;
+
+	} else {
+		/* the service fell behind, keep the delay constant by
+		 * playing the frame that's due unprocessed */
+		deque_pop_front(&stream->input, frame, NVAFX_FRAME_BYTES);
+	}
+
+	pthread_mutex_unlock(&nvafx_service.mutex);
+}
+
+static void nvafx_service_stop(void)
+{
+	if (nvafx_service.thread_active) {
+		os_event_signal(nvafx_service.stop_event);
+		pthread_join(nvafx_service.thread, NULL);
+		nvafx_service.thread_active = false;
+	}
+
+	os_event_destroy(nvafx_service.stop_event);
+	nvafx_service.stop_event = NULL;
+
+	for (size_t i = 0; i < nvafx_service.batches.num; i++)
+		nvafx_batch_free(nvafx_service.batches.array[i]);
+	da_free(nvafx_service.batches);
+}
+#endif
+
 /* -------------------------------------------------------- */
 
 #define SUP_MIN -60
@@ -190,12 +721,7 @@ static void noise_suppress_destroy(void *data)
 		rnnoise_destroy(ng->rnn_states[i]);
 #endif
 #ifdef LIBNVAFX_ENABLED
-		if (ng->handle[0]) {
-			if (NvAFX_DestroyEffect(ng->handle[i]) !=
-			    NVAFX_STATUS_SUCCESS) {
-				do_log(LOG_ERROR, "NvAFX_Release() failed");
-			}
-		}
+		nvafx_stream_destroy(ng->nvafx_streams[i]);
 #endif
 		deque_free(&ng->input_buffers[i]);
 		deque_free(&ng->output_buffers[i]);
@@ -223,8 +749,6 @@ static void noise_suppress_destroy(void *data)
 	bfree(ng->sdk_path);
 	bfree((void *)ng->fx);
 	if (ng->nvafx_enabled) {
-		if (ng->use_nvafx)
-			pthread_join(ng->nvafx_thread, NULL);
 		pthread_mutex_unlock(&ng->nvafx_mutex);
 		pthread_mutex_destroy(&ng->nvafx_mutex);
 	}
@@ -240,86 +764,27 @@ static bool nvafx_initialize_internal(void *data)
 {
 #ifdef LIBNVAFX_ENABLED
 	struct noise_suppress_data *ng = data;
-	NvAFX_Status err;
 
-	if (!ng->handle[0]) {
-		ng->sample_rate = NVAFX_SAMPLE_RATE;
-		for (size_t i = 0; i < ng->channels; i++) {
-			// Create FX
-			CUcontext old = {0};
-			CUcontext curr = {0};
-			if (cuCtxGetCurrent(&old) != CUDA_SUCCESS) {
-				goto failure;
-			}
-			// if initialization was with rnnoise or speex
-			if (strcmp(ng->fx, S_METHOD_NVAFX_DENOISER) != 0 &&
-			    strcmp(ng->fx, S_METHOD_NVAFX_DEREVERB) != 0 &&
-			    strcmp(ng->fx, S_METHOD_NVAFX_DEREVERB_DENOISER) !=
-				    0) {
-				ng->fx = bstrdup(S_METHOD_NVAFX_DENOISER);
-			}
-			err = NvAFX_CreateEffect(ng->fx, &ng->handle[i]);
-			if (err != NVAFX_STATUS_SUCCESS) {
-				do_log(LOG_ERROR,
-				       "%s FX creation failed, error %i",
-				       ng->fx, err);
-				goto failure;
-			}
-			if (cuCtxGetCurrent(&curr) != CUDA_SUCCESS) {
-				goto failure;
-			}
-			if (curr != old) {
-				cuCtxPopCurrent(NULL);
-			}
-			// Set sample rate of FX
-			err = NvAFX_SetU32(ng->handle[i],
-					   NVAFX_PARAM_INPUT_SAMPLE_RATE,
-					   ng->sample_rate);
-			if (err != NVAFX_STATUS_SUCCESS) {
-				do_log(LOG_ERROR,
-				       "NvAFX_SetU32(Sample Rate: %u) failed, error %i",
-				       ng->sample_rate, err);
-				goto failure;
-			}
-
-			// Set intensity of FX
-			err = NvAFX_SetFloat(ng->handle[i],
-					     NVAFX_PARAM_INTENSITY_RATIO,
-					     ng->intensity_ratio);
-			if (err != NVAFX_STATUS_SUCCESS) {
-				do_log(LOG_ERROR,
-				       "NvAFX_SetFloat(Intensity Ratio: %f) failed, error %i",
-				       ng->intensity_ratio, err);
-				goto failure;
-			}
+	ng->sample_rate = NVAFX_SAMPLE_RATE;
 
-			// Set AI models path
-			err = NvAFX_SetString(ng->handle[i],
-					      NVAFX_PARAM_MODEL_PATH,
-					      ng->model);
-			if (err != NVAFX_STATUS_SUCCESS) {
-				do_log(LOG_ERROR,
-				       "NvAFX_SetString() failed, error %i",
-				       err);
-				goto failure;
-			}
+	// if initialization was with rnnoise or speex
+	if (strcmp(ng->fx, S_METHOD_NVAFX_DENOISER) != 0 &&
+	    strcmp(ng->fx, S_METHOD_NVAFX_DEREVERB) != 0 &&
+	    strcmp(ng->fx, S_METHOD_NVAFX_DEREVERB_DENOISER) != 0) {
+		bfree((void *)ng->fx);
+		ng->fx = bstrdup(S_METHOD_NVAFX_DENOISER);
+	}
 
-			// Load FX
-			err = NvAFX_Load(ng->handle[i]);
-			if (err != NVAFX_STATUS_SUCCESS) {
-				do_log(LOG_ERROR,
-				       "NvAFX_Load() failed with error %i",
-				       err);
-				goto failure;
-			}
-			os_atomic_set_bool(&ng->reinit_done, true);
-		}
+	/* the effects themselves are loaded by the service in the
+	 * background, until then the audio passes through unprocessed */
+	for (size_t i = 0; i < ng->channels; i++) {
+		nvafx_stream_destroy(ng->nvafx_streams[i]);
+		ng->nvafx_streams[i] = nvafx_stream_create(
+			ng->fx, ng->model, ng->intensity_ratio);
 	}
-	return true;
 
-failure:
-	ng->use_nvafx = false;
-	return false;
+	os_atomic_set_bool(&ng->reinit_done, true);
+	return true;
 
 #else
 	UNUSED_PARAMETER(data);
@@ -327,65 +792,20 @@ failure:
 #endif
 }
 
-static void *nvafx_initialize(void *data)
+static void nvafx_initialize(void *data)
 {
 #ifdef LIBNVAFX_ENABLED
 	struct noise_suppress_data *ng = data;
-	NvAFX_Status err;
 
 	if (!ng->use_nvafx || !nvafx_loaded) {
-		return NULL;
+		return;
 	}
 	pthread_mutex_lock(&ng->nvafx_mutex);
-	pthread_mutex_lock(&nvafx_initializer_mutex);
-	if (!nvafx_initialize_internal(data)) {
-		goto failure;
-	}
-	if (ng->use_nvafx) {
-		err = NvAFX_GetU32(ng->handle[0],
-				   NVAFX_PARAM_NUM_INPUT_CHANNELS,
-				   &ng->num_channels);
-		if (err != NVAFX_STATUS_SUCCESS) {
-			do_log(LOG_ERROR,
-			       "NvAFX_GetU32() failed to get the number of channels, error %i",
-			       err);
-			goto failure;
-		}
-		if (ng->num_channels != 1) {
-			do_log(LOG_ERROR,
-			       "The number of channels is not 1 in the sdk any more ==> update code");
-			goto failure;
-		}
-		NvAFX_Status err = NvAFX_GetU32(
-			ng->handle[0], NVAFX_PARAM_NUM_INPUT_SAMPLES_PER_FRAME,
-			&ng->num_samples_per_frame);
-		if (err != NVAFX_STATUS_SUCCESS) {
-			do_log(LOG_ERROR,
-			       "NvAFX_GetU32() failed to get the number of samples per frame, error %i",
-			       err);
-			goto failure;
-		}
-		if (ng->num_samples_per_frame != NVAFX_FRAME_SIZE) {
-			do_log(LOG_ERROR,
-			       "The number of samples per frame has changed from 480 (= 10 ms) ==> update code");
-			goto failure;
-		}
-	}
-	ng->nvafx_initialized = true;
-	ng->nvafx_loading = false;
-	pthread_mutex_unlock(&nvafx_initializer_mutex);
+	ng->nvafx_initialized = nvafx_initialize_internal(data);
 	pthread_mutex_unlock(&ng->nvafx_mutex);
-	return NULL;
-
-failure:
-	ng->use_nvafx = false;
-	pthread_mutex_unlock(&nvafx_initializer_mutex);
-	pthread_mutex_unlock(&ng->nvafx_mutex);
-	return NULL;
 
 #else
 	UNUSED_PARAMETER(data);
-	return NULL;
 #endif
 }
 
@@ -445,6 +865,7 @@ static void set_model(void *data, const char *method)
 
 	strcpy(buffer, ng->sdk_path);
 	strcat(buffer, file);
+	bfree(ng->model);
 	ng->model = buffer;
 }
 #endif
@@ -472,51 +893,34 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 	if (ng->use_nvafx && ng->nvafx_initialized) {
 		if (intensity != ng->intensity_ratio &&
 		    (strcmp(ng->fx, method) == 0)) {
-			NvAFX_Status err;
 			ng->intensity_ratio = intensity;
 			pthread_mutex_lock(&ng->nvafx_mutex);
-			for (size_t i = 0; i < ng->channels; i++) {
-				err = NvAFX_SetFloat(
-					ng->handle[i],
-					NVAFX_PARAM_INTENSITY_RATIO,
-					ng->intensity_ratio);
-				if (err != NVAFX_STATUS_SUCCESS) {
-					do_log(LOG_ERROR,
-					       "NvAFX_SetFloat(Intensity Ratio: %f) failed, error %i",
-					       ng->intensity_ratio, err);
-					ng->use_nvafx = false;
-				}
-			}
+			for (size_t i = 0; i < ng->channels; i++)
+				nvafx_stream_set_intensity(ng->nvafx_streams[i],
+							   intensity);
 			pthread_mutex_unlock(&ng->nvafx_mutex);
 		}
 		if ((strcmp(ng->fx, method) != 0)) {
+			/* move the channels to the effect of the new method */
 			pthread_mutex_lock(&ng->nvafx_mutex);
 			bfree((void *)ng->fx);
 			ng->fx = bstrdup(method);
 			ng->intensity_ratio = intensity;
 			set_model(ng, method);
-			os_atomic_set_bool(&ng->reinit_done, false);
-			for (int i = 0; i < (int)ng->channels; i++) {
-				/* Destroy previous FX */
-				if (NvAFX_DestroyEffect(ng->handle[i]) !=
-				    NVAFX_STATUS_SUCCESS) {
-					do_log(LOG_ERROR,
-					       "FX failed to be destroyed.");
-					ng->use_nvafx = false;
-				} else
-					ng->handle[i] = NULL;
-			}
-			if (ng->use_nvafx) {
-				nvafx_initialize_internal(data);
-			}
+			nvafx_initialize_internal(data);
 			pthread_mutex_unlock(&ng->nvafx_mutex);
 		}
 	} else {
+		bfree((void *)ng->fx);
 		ng->fx = bstrdup(method);
 	}
 
 #endif
 	ng->use_nvafx = ng->nvafx_enabled && nvafx_requested;
+#ifdef LIBNVAFX_ENABLED
+	if (ng->use_nvafx)
+		ng->latency += NVAFX_BATCH_DELAY * NVAFX_TICK_NS;
+#endif
 
 	/* Process 10 millisecond segments to keep latency low. */
 	/* Also RNNoise only supports buffers of this exact size. */
@@ -533,7 +937,7 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 		return;
 #endif
 #ifdef LIBNVAFX_ENABLED
-	if (ng->use_nvafx && (ng->nvafx_initialized || ng->nvafx_loading))
+	if (ng->use_nvafx && ng->nvafx_initialized)
 		return;
 #endif
 #ifdef LIBRNNOISE_ENABLED
@@ -571,10 +975,9 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 	}
 
 #ifdef LIBNVAFX_ENABLED
-	if (!ng->nvafx_initialized && ng->use_nvafx && !ng->nvafx_loading) {
+	if (!ng->nvafx_initialized && ng->use_nvafx) {
 		ng->intensity_ratio = intensity;
-		ng->nvafx_loading = true;
-		pthread_create(&ng->nvafx_thread, NULL, nvafx_initialize, ng);
+		nvafx_initialize(ng);
 	}
 #endif
 	for (size_t i = 0; i < channels; i++)
@@ -752,6 +1155,7 @@ unload_everything:
 #ifdef LIBNVAFX_ENABLED
 void unload_nvafx(void)
 {
+	nvafx_service_stop();
 	release_lib();
 
 	if (nvafx_initializer_mutex_initialized) {
@@ -780,7 +1184,6 @@ static void *noise_suppress_create(obs_data_t *settings, obs_source_t *filter)
 		strcpy(ng->sdk_path, sdk_path);
 		ng->nvafx_enabled = true;
 		ng->nvafx_initialized = false;
-		ng->nvafx_loading = false;
 		ng->fx = NULL;
 
 		pthread_mutex_init(&ng->nvafx_mutex, NULL);
@@ -943,32 +1346,14 @@ static inline void process_nvafx(struct noise_suppress_data *ng)
 			}
 		}
 
-		/* Execute */
+		/* Execute, batched with the other filters using the effect */
 		size_t runs = ng->has_mono_src ? 1 : ng->channels;
 		if (ng->reinit_done) {
 			pthread_mutex_lock(&ng->nvafx_mutex);
-			for (size_t i = 0; i < runs; i++) {
-				NvAFX_Status err =
-					NvAFX_Run(ng->handle[i],
-						  &ng->nvafx_segment_buffers[i],
-						  &ng->nvafx_segment_buffers[i],
-						  ng->num_samples_per_frame,
-						  ng->num_channels);
-				if (err != NVAFX_STATUS_SUCCESS) {
-					if (err == NVAFX_STATUS_FAILED) {
-						do_log(LOG_DEBUG,
-						       "NvAFX_Run() failed, error NVAFX_STATUS_FAILED.\n"
-						       "This can occur when changing the FX and is not consequential.");
-						os_atomic_set_bool(
-							&ng->reinit_done,
-							false); // stop all processing; this will be reset at new init
-					} else {
-						do_log(LOG_ERROR,
-						       "NvAFX_Run() failed, error %i.\n",
-						       err);
-					}
-				}
-			}
+			for (size_t i = 0; i < runs; i++)
+				nvafx_stream_process(
+					ng->nvafx_streams[i],
+					ng->nvafx_segment_buffers[i]);
 			pthread_mutex_unlock(&ng->nvafx_mutex);
 		}
 		if (ng->has_mono_src) {
@@ -1068,12 +1453,16 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 	ng->has_mono_src = layout == SPEAKERS_MONO && ng->channels == 2;
 
 #ifdef LIBSPEEXDSP_ENABLED
-	if (!ng->spx_states[0])
+	if (!ng->spx_states[0]) {
+		obs_source_set_filter_latency(ng->context, 0);
 		return audio;
+	}
 #endif
 #ifdef LIBRNNOISE_ENABLED
-	if (!ng->rnn_states[0])
+	if (!ng->rnn_states[0]) {
+		obs_source_set_filter_latency(ng->context, 0);
 		return audio;
+	}
 #endif
 
 	/* -----------------------------------------------
@@ -1131,8 +1520,11 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 				ng->output_audio.data[i], out_size);
 	}
 
+	/* libobs moves the timestamps back by the reported latency */
+	obs_source_set_filter_latency(ng->context, ng->latency);
+
 	ng->output_audio.frames = info.frames;
-	ng->output_audio.timestamp = info.timestamp - ng->latency;
+	ng->output_audio.timestamp = info.timestamp;
 	return &ng->output_audio;
 }
 
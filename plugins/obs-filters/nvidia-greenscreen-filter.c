@@ -28,6 +28,7 @@
 #define S_THRESHOLDFX "threshold"
 #define S_THRESHOLDFX_DEFAULT 1.0
 #define S_PROCESSING "processing_interval"
+#define S_LATENCY "mask_latency"
 
 #define MT_ obs_module_text
 #define TEXT_MODE MT_("Greenscreen.Mode")
@@ -37,9 +38,26 @@
 #define TEXT_DEPRECATION MT_("Greenscreen.Deprecation")
 #define TEXT_PROCESSING MT_("Greenscreen.Processing")
 #define TEXT_PROCESSING_HINT MT_("Greenscreen.Processing.Hint")
+#define TEXT_LATENCY MT_("Greenscreen.Latency")
+#define TEXT_LATENCY_NONE MT_("Greenscreen.Latency.None")
+#define TEXT_LATENCY_ONE_FRAME MT_("Greenscreen.Latency.OneFrame")
+#define TEXT_LATENCY_HINT MT_("Greenscreen.Latency.Hint")
 
 bool nvvfx_loaded = false;
 bool nvvfx_new_sdk = false;
+
+/* All filters share one CUDA stream.  With state objects (newer SDKs) they
+ * also share one loaded effect per mode, every filter then only has its own
+ * state and images, which are bound before each run. */
+struct nv_greenscreen_shared {
+	long refs;
+	CUstream stream;
+	NvVFX_Handle handles[2];
+};
+
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct nv_greenscreen_shared shared = {0};
+
 struct nv_greenscreen_data {
 	obs_source_t *context;
 	bool images_allocated;
@@ -52,12 +70,14 @@ struct nv_greenscreen_data {
 
 	/* RTX SDK vars */
 	NvVFX_Handle handle;
-	CUstream stream;        // CUDA stream
+	CUstream stream;        // CUDA stream, shared by all filters
+	bool stream_acquired;
+	bool shared_fx;         // handle is shared, only the state is ours
 	int mode;               // 0 = quality, 1 = performance
 	NvCVImage *src_img;     // src img in obs format (RGBA ?) on GPU
 	NvCVImage *BGR_src_img; // src img in BGR on GPU
 	NvCVImage *A_dst_img;   // mask img on GPU
-	NvCVImage *dst_img;     // mask texture
+	NvCVImage *dst_img[2];  // mask textures
 	NvCVImage *stage;       // planar stage img used for transfer to texture
 	unsigned int version;
 	NvVFX_StateObjectHandle stateObjectHandle;
@@ -66,7 +86,7 @@ struct nv_greenscreen_data {
 	gs_effect_t *effect;
 	gs_texrender_t *render;
 	gs_texrender_t *render_unorm;
-	gs_texture_t *alpha_texture;
+	gs_texture_t *alpha_texture[2];
 	uint32_t width;  // width of texture
 	uint32_t height; // height of texture
 	enum gs_color_space space;
@@ -82,6 +102,13 @@ struct nv_greenscreen_data {
 	 */
 	int processing_interval;
 	int processing_counter;
+
+	/* With a latency of one frame the mask for a frame is drawn on the
+	 * next one, so the FX runs while the rest of the frame renders instead
+	 * of the draw waiting for it.  The two mask textures alternate. */
+	int latency;
+	uint32_t mask_index;
+	bool mask_valid;
 };
 
 static const char *nv_greenscreen_filter_name(void *unused)
@@ -90,21 +117,184 @@ static const char *nv_greenscreen_filter_name(void *unused)
 	return obs_module_text("NvidiaGreenscreenFilter");
 }
 
+static NvVFX_Handle create_fx(struct nv_greenscreen_data *filter, int mode)
+{
+	NvVFX_Handle handle = NULL;
+	NvCV_Status vfxErr;
+
+	vfxErr = NvVFX_CreateEffect(NVVFX_FX_GREEN_SCREEN, &handle);
+	if (NVCV_SUCCESS != vfxErr) {
+		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
+		error("Error creating AI Greenscreen FX; error %i: %s", vfxErr,
+		      errString);
+		return NULL;
+	}
+
+	char buffer[MAX_PATH];
+	char modelDir[MAX_PATH];
+	nvvfx_get_sdk_path(buffer, MAX_PATH);
+	size_t max_len = sizeof(buffer) / sizeof(char);
+	snprintf(modelDir, max_len, "%s\\models", buffer);
+	vfxErr = NvVFX_SetString(handle, NVVFX_MODEL_DIRECTORY, modelDir);
+	vfxErr = NvVFX_SetCudaStream(handle, NVVFX_CUDA_STREAM,
+				     filter->stream);
+	if (NVCV_SUCCESS != vfxErr) {
+		error("Error setting CUDA Stream %i", vfxErr);
+		NvVFX_DestroyEffect(handle);
+		return NULL;
+	}
+
+	/* the mode is set and the FX loaded by the first update otherwise */
+	if (mode >= 0) {
+		vfxErr = NvVFX_SetU32(handle, NVVFX_MODE, mode);
+		vfxErr = NvVFX_Load(handle);
+		if (NVCV_SUCCESS != vfxErr)
+			error("Error loading AI Greenscreen FX %i", vfxErr);
+	}
+
+	return handle;
+}
+
+static bool shared_acquire(struct nv_greenscreen_data *filter)
+{
+	NvCV_Status vfxErr = NVCV_SUCCESS;
+
+	pthread_mutex_lock(&shared_mutex);
+	if (!shared.refs)
+		vfxErr = NvVFX_CudaStreamCreate(&shared.stream);
+	if (NVCV_SUCCESS == vfxErr) {
+		shared.refs++;
+		filter->stream = shared.stream;
+		filter->stream_acquired = true;
+	}
+	pthread_mutex_unlock(&shared_mutex);
+
+	if (NVCV_SUCCESS != vfxErr) {
+		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
+		error("Error creating CUDA Stream; error %i: %s", vfxErr,
+		      errString);
+		return false;
+	}
+
+	return true;
+}
+
+static void shared_release(struct nv_greenscreen_data *filter)
+{
+	if (!filter->stream_acquired)
+		return;
+
+	pthread_mutex_lock(&shared_mutex);
+	if (--shared.refs == 0) {
+		for (size_t i = 0; i < OBS_COUNTOF(shared.handles); i++) {
+			if (shared.handles[i]) {
+				NvVFX_DestroyEffect(shared.handles[i]);
+				shared.handles[i] = NULL;
+			}
+		}
+		NvVFX_CudaStreamDestroy(shared.stream);
+		shared.stream = NULL;
+	}
+	pthread_mutex_unlock(&shared_mutex);
+
+	filter->stream = NULL;
+	filter->stream_acquired = false;
+}
+
+static NvVFX_Handle shared_get_fx(struct nv_greenscreen_data *filter,
+				  int mode)
+{
+	NvVFX_Handle handle;
+
+	pthread_mutex_lock(&shared_mutex);
+	if (!shared.handles[mode])
+		shared.handles[mode] = create_fx(filter, mode);
+	handle = shared.handles[mode];
+	pthread_mutex_unlock(&shared_mutex);
+
+	return handle;
+}
+
+static void free_fx_state(struct nv_greenscreen_data *filter)
+{
+	if (filter->handle && filter->stateObjectHandle)
+		NvVFX_DeallocateState(filter->handle,
+				      filter->stateObjectHandle);
+	filter->stateObjectHandle = NULL;
+}
+
+static bool alloc_fx_state(struct nv_greenscreen_data *filter)
+{
+	NvCV_Status vfxErr = NvVFX_AllocateState(filter->handle,
+						 &filter->stateObjectHandle);
+	if (NVCV_SUCCESS != vfxErr) {
+		error("Error allocating FX state %i", vfxErr);
+		return false;
+	}
+
+	if (filter->shared_fx)
+		return true;
+
+	vfxErr = NvVFX_SetStateObjectHandleArray(
+		filter->handle, NVVFX_STATE, &filter->stateObjectHandle);
+	if (NVCV_SUCCESS != vfxErr) {
+		error("Error setting FX state %i", vfxErr);
+		return false;
+	}
+
+	return true;
+}
+
+/* switches a filter using the shared effects over to the one loaded for the
+ * mode, its state is allocated from that effect */
+static void set_shared_fx(struct nv_greenscreen_data *filter, int mode)
+{
+	obs_enter_graphics();
+
+	free_fx_state(filter);
+	filter->handle = shared_get_fx(filter, mode);
+	if (!filter->handle || !alloc_fx_state(filter))
+		os_atomic_set_bool(&filter->processing_stop, true);
+
+	obs_leave_graphics();
+}
+
+static bool bind_shared_fx(struct nv_greenscreen_data *filter)
+{
+	if (NvVFX_SetImage(filter->handle, NVVFX_INPUT_IMAGE,
+			   filter->BGR_src_img) != NVCV_SUCCESS)
+		return false;
+	if (NvVFX_SetImage(filter->handle, NVVFX_OUTPUT_IMAGE,
+			   filter->A_dst_img) != NVCV_SUCCESS)
+		return false;
+	return NvVFX_SetStateObjectHandleArray(filter->handle, NVVFX_STATE,
+					       &filter->stateObjectHandle) ==
+	       NVCV_SUCCESS;
+}
+
 static void nv_greenscreen_filter_update(void *data, obs_data_t *settings)
 {
 	struct nv_greenscreen_data *filter = (struct nv_greenscreen_data *)data;
 	NvCV_Status vfxErr;
 	int mode = (int)obs_data_get_int(settings, S_MODE);
+	if (mode != S_MODE_PERF)
+		mode = S_MODE_QUALITY;
 	if (filter->mode != mode) {
 		filter->mode = mode;
-		vfxErr = NvVFX_SetU32(filter->handle, NVVFX_MODE, mode);
-		vfxErr = NvVFX_Load(filter->handle);
-		if (NVCV_SUCCESS != vfxErr)
-			error("Error loading AI Greenscreen FX %i", vfxErr);
+		if (filter->shared_fx) {
+			set_shared_fx(filter, mode);
+		} else {
+			vfxErr = NvVFX_SetU32(filter->handle, NVVFX_MODE, mode);
+			vfxErr = NvVFX_Load(filter->handle);
+			if (NVCV_SUCCESS != vfxErr)
+				error("Error loading AI Greenscreen FX %i",
+				      vfxErr);
+		}
 	}
 	filter->threshold = (float)obs_data_get_double(settings, S_THRESHOLDFX);
 	filter->processing_interval =
 		(int)obs_data_get_int(settings, S_PROCESSING);
+	filter->latency = (int)obs_data_get_int(settings, S_LATENCY);
 }
 
 static void nv_greenscreen_filter_actual_destroy(void *data)
@@ -119,26 +309,24 @@ static void nv_greenscreen_filter_actual_destroy(void *data)
 
 	if (filter->images_allocated) {
 		obs_enter_graphics();
-		gs_texture_destroy(filter->alpha_texture);
+		gs_texture_destroy(filter->alpha_texture[0]);
+		gs_texture_destroy(filter->alpha_texture[1]);
 		gs_texrender_destroy(filter->render);
 		gs_texrender_destroy(filter->render_unorm);
 		obs_leave_graphics();
 		NvCVImage_Destroy(filter->src_img);
 		NvCVImage_Destroy(filter->BGR_src_img);
 		NvCVImage_Destroy(filter->A_dst_img);
-		NvCVImage_Destroy(filter->dst_img);
+		NvCVImage_Destroy(filter->dst_img[0]);
+		NvCVImage_Destroy(filter->dst_img[1]);
 		NvCVImage_Destroy(filter->stage);
 	}
-	if (filter->stream) {
-		NvVFX_CudaStreamDestroy(filter->stream);
-	}
 	if (filter->handle) {
-		if (filter->stateObjectHandle) {
-			NvVFX_DeallocateState(filter->handle,
-					      filter->stateObjectHandle);
-		}
-		NvVFX_DestroyEffect(filter->handle);
+		free_fx_state(filter);
+		if (!filter->shared_fx)
+			NvVFX_DestroyEffect(filter->handle);
 	}
+	shared_release(filter);
 
 	if (filter->effect) {
 		obs_enter_graphics();
@@ -158,61 +346,32 @@ static void nv_greenscreen_filter_destroy(void *data)
 static void nv_greenscreen_filter_reset(void *data, calldata_t *calldata)
 {
 	struct nv_greenscreen_data *filter = (struct nv_greenscreen_data *)data;
-	NvCV_Status vfxErr;
 
 	os_atomic_set_bool(&filter->processing_stop, true);
-	// first destroy
-	if (filter->stream) {
-		NvVFX_CudaStreamDestroy(filter->stream);
-	}
-	if (filter->handle) {
-		if (filter->stateObjectHandle) {
-			NvVFX_DeallocateState(filter->handle,
-					      filter->stateObjectHandle);
-		}
-		NvVFX_DestroyEffect(filter->handle);
-	}
-	// recreate
-	/* 1. Create FX */
-	vfxErr = NvVFX_CreateEffect(NVVFX_FX_GREEN_SCREEN, &filter->handle);
-	if (NVCV_SUCCESS != vfxErr) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error recreating AI Greenscreen FX; error %i: %s",
-		      vfxErr, errString);
-		nv_greenscreen_filter_destroy(filter);
-	}
 
-	/* 2. Set models path & initialize CudaStream */
-	char buffer[MAX_PATH];
-	char modelDir[MAX_PATH];
-	nvvfx_get_sdk_path(buffer, MAX_PATH);
-	size_t max_len = sizeof(buffer) / sizeof(char);
-	snprintf(modelDir, max_len, "%s\\models", buffer);
-	vfxErr = NvVFX_SetString(filter->handle, NVVFX_MODEL_DIRECTORY,
-				 modelDir);
-	vfxErr = NvVFX_CudaStreamCreate(&filter->stream);
-	if (NVCV_SUCCESS != vfxErr) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error creating CUDA Stream; error %i: %s", vfxErr,
-		      errString);
-		nv_greenscreen_filter_destroy(filter);
-	}
-	vfxErr = NvVFX_SetCudaStream(filter->handle, NVVFX_CUDA_STREAM,
-				     filter->stream);
-	if (NVCV_SUCCESS != vfxErr) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error setting CUDA Stream %i", vfxErr);
-		nv_greenscreen_filter_destroy(filter);
-	}
+	if (filter->shared_fx) {
+		/* the effect is shared with other filters, only start over
+		 * with a new state of our own */
+		free_fx_state(filter);
+		filter->handle = shared_get_fx(filter, filter->mode);
+		if (!filter->handle || !alloc_fx_state(filter))
+			return;
+	} else {
+		free_fx_state(filter);
+		if (filter->handle)
+			NvVFX_DestroyEffect(filter->handle);
 
-	/* 3. load FX */
-	vfxErr = NvVFX_SetU32(filter->handle, NVVFX_MODE, filter->mode);
-	vfxErr = NvVFX_Load(filter->handle);
-	if (NVCV_SUCCESS != vfxErr)
-		error("Error loading AI Greenscreen FX %i", vfxErr);
+		filter->handle = create_fx(filter, filter->mode);
+		if (!filter->handle)
+			return;
+		if (nvvfx_new_sdk && !alloc_fx_state(filter))
+			return;
+	}
 
 	filter->images_allocated = false;
 	os_atomic_set_bool(&filter->processing_stop, false);
+
+	UNUSED_PARAMETER(calldata);
 }
 
 static void init_images_greenscreen(struct nv_greenscreen_data *filter)
@@ -221,33 +380,41 @@ static void init_images_greenscreen(struct nv_greenscreen_data *filter)
 	uint32_t width = filter->width;
 	uint32_t height = filter->height;
 
-	/* 1. create alpha texture */
-	if (filter->alpha_texture) {
-		gs_texture_destroy(filter->alpha_texture);
-	}
-	filter->alpha_texture =
-		gs_texture_create(width, height, GS_A8, 1, NULL, 0);
-	if (filter->alpha_texture == NULL) {
-		error("Alpha texture couldn't be created");
-		goto fail;
-	}
-	struct ID3D11Texture2D *d11texture =
-		(struct ID3D11Texture2D *)gs_texture_get_obj(
-			filter->alpha_texture);
-
-	/* 2. Create NvCVImage which will hold final alpha texture. */
-	if (!filter->dst_img &&
-	    (NvCVImage_Create(width, height, NVCV_A, NVCV_U8, NVCV_CHUNKY,
-			      NVCV_GPU, 1, &filter->dst_img) != NVCV_SUCCESS)) {
-		goto fail;
-	}
+	filter->mask_index = 0;
+	filter->mask_valid = false;
 
-	vfxErr = NvCVImage_InitFromD3D11Texture(filter->dst_img, d11texture);
-	if (vfxErr != NVCV_SUCCESS) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error passing dst ID3D11Texture to img; error %i: %s",
-		      vfxErr, errString);
-		goto fail;
+	for (size_t i = 0; i < OBS_COUNTOF(filter->alpha_texture); i++) {
+		/* 1. create alpha texture */
+		if (filter->alpha_texture[i]) {
+			gs_texture_destroy(filter->alpha_texture[i]);
+		}
+		filter->alpha_texture[i] =
+			gs_texture_create(width, height, GS_A8, 1, NULL, 0);
+		if (filter->alpha_texture[i] == NULL) {
+			error("Alpha texture couldn't be created");
+			goto fail;
+		}
+		struct ID3D11Texture2D *d11texture =
+			(struct ID3D11Texture2D *)gs_texture_get_obj(
+				filter->alpha_texture[i]);
+
+		/* 2. Create NvCVImage which will hold final alpha texture. */
+		if (!filter->dst_img[i] &&
+		    (NvCVImage_Create(width, height, NVCV_A, NVCV_U8,
+				      NVCV_CHUNKY, NVCV_GPU, 1,
+				      &filter->dst_img[i]) != NVCV_SUCCESS)) {
+			goto fail;
+		}
+
+		vfxErr = NvCVImage_InitFromD3D11Texture(filter->dst_img[i],
+							d11texture);
+		if (vfxErr != NVCV_SUCCESS) {
+			const char *errString =
+				NvCV_GetErrorStringFromCode(vfxErr);
+			error("Error passing dst ID3D11Texture to img; error %i: %s",
+			      vfxErr, errString);
+			goto fail;
+		}
 	}
 
 	/* 3. create texrenders */
@@ -327,12 +494,15 @@ static void init_images_greenscreen(struct nv_greenscreen_data *filter)
 		}
 	}
 
-	/* 7. Set input & output images for nv FX. */
-	if (NvVFX_SetImage(filter->handle, NVVFX_INPUT_IMAGE,
+	/* 7. Set input & output images for nv FX, shared FX get them bound
+	 * before every run instead. */
+	if (!filter->shared_fx &&
+	    NvVFX_SetImage(filter->handle, NVVFX_INPUT_IMAGE,
 			   filter->BGR_src_img) != NVCV_SUCCESS) {
 		goto fail;
 	}
-	if (NvVFX_SetImage(filter->handle, NVVFX_OUTPUT_IMAGE,
+	if (!filter->shared_fx &&
+	    NvVFX_SetImage(filter->handle, NVVFX_OUTPUT_IMAGE,
 			   filter->A_dst_img) != NVCV_SUCCESS) {
 		goto fail;
 	}
@@ -345,8 +515,11 @@ fail:
 	return;
 }
 
-static bool process_texture_greenscreen(struct nv_greenscreen_data *filter)
+static bool process_texture_greenscreen(struct nv_greenscreen_data *filter,
+					uint32_t mask_index)
 {
+	NvCVImage *dst_img = filter->dst_img[mask_index];
+
 	/* 1. Map src img holding texture. */
 	NvCV_Status vfxErr =
 		NvCVImage_MapResource(filter->src_img, filter->stream);
@@ -375,6 +548,10 @@ static bool process_texture_greenscreen(struct nv_greenscreen_data *filter)
 	}
 
 	/*  3. run RTX fx */
+	if (filter->shared_fx && !bind_shared_fx(filter)) {
+		error("Error binding images and state to the shared FX");
+		goto fail;
+	}
 	vfxErr = NvVFX_Run(filter->handle, 1);
 	if (vfxErr != NVCV_SUCCESS) {
 		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
@@ -384,7 +561,7 @@ static bool process_texture_greenscreen(struct nv_greenscreen_data *filter)
 	}
 
 	/* 4. Map dst texture before transfer from dst img provided by FX */
-	vfxErr = NvCVImage_MapResource(filter->dst_img, filter->stream);
+	vfxErr = NvCVImage_MapResource(dst_img, filter->stream);
 	if (vfxErr != NVCV_SUCCESS) {
 		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
 		error("Error mapping resource for dst texture; error %i: %s",
@@ -392,7 +569,7 @@ static bool process_texture_greenscreen(struct nv_greenscreen_data *filter)
 		goto fail;
 	}
 
-	vfxErr = NvCVImage_Transfer(filter->A_dst_img, filter->dst_img, 1.0f,
+	vfxErr = NvCVImage_Transfer(filter->A_dst_img, dst_img, 1.0f,
 				    filter->stream, filter->stage);
 	if (vfxErr != NVCV_SUCCESS) {
 		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
@@ -401,7 +578,7 @@ static bool process_texture_greenscreen(struct nv_greenscreen_data *filter)
 		goto fail;
 	}
 
-	vfxErr = NvCVImage_UnmapResource(filter->dst_img, filter->stream);
+	vfxErr = NvCVImage_UnmapResource(dst_img, filter->stream);
 	if (vfxErr != NVCV_SUCCESS) {
 		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
 		error("Error unmapping resource for dst texture; error %i: %s",
@@ -425,7 +602,6 @@ static void *nv_greenscreen_filter_create(obs_data_t *settings,
 		return NULL;
 	}
 
-	NvCV_Status vfxErr;
 	filter->context = context;
 	filter->mode = -1; // should be 0 or 1; -1 triggers an update
 	filter->images_allocated = false;
@@ -438,40 +614,12 @@ static void *nv_greenscreen_filter_create(obs_data_t *settings,
 	filter->processing_interval = 1;
 	filter->processing_counter = 0;
 
-	/* 1. Create FX */
-	vfxErr = NvVFX_CreateEffect(NVVFX_FX_GREEN_SCREEN, &filter->handle);
-	if (NVCV_SUCCESS != vfxErr) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error creating AI Greenscreen FX; error %i: %s", vfxErr,
-		      errString);
+	/* 1. Get the shared CUDA stream */
+	if (!shared_acquire(filter)) {
 		nv_greenscreen_filter_destroy(filter);
 		return NULL;
 	}
 
-	/* 2. Set models path & initialize CudaStream */
-	char buffer[MAX_PATH];
-	char modelDir[MAX_PATH];
-	nvvfx_get_sdk_path(buffer, MAX_PATH);
-	size_t max_len = sizeof(buffer) / sizeof(char);
-	snprintf(modelDir, max_len, "%s\\models", buffer);
-	vfxErr = NvVFX_SetString(filter->handle, NVVFX_MODEL_DIRECTORY,
-				 modelDir);
-	vfxErr = NvVFX_CudaStreamCreate(&filter->stream);
-	if (NVCV_SUCCESS != vfxErr) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error creating CUDA Stream; error %i: %s", vfxErr,
-		      errString);
-		nv_greenscreen_filter_destroy(filter);
-		return NULL;
-	}
-	vfxErr = NvVFX_SetCudaStream(filter->handle, NVVFX_CUDA_STREAM,
-				     filter->stream);
-	if (NVCV_SUCCESS != vfxErr) {
-		const char *errString = NvCV_GetErrorStringFromCode(vfxErr);
-		error("Error setting CUDA Stream %i", vfxErr);
-		nv_greenscreen_filter_destroy(filter);
-		return NULL;
-	}
 	/* check sdk version */
 	if (NvVFX_GetVersion(&filter->version) == NVCV_SUCCESS) {
 		uint8_t major = (filter->version >> 24) & 0xff;
@@ -483,7 +631,7 @@ static void *nv_greenscreen_filter_create(obs_data_t *settings,
 				nvvfx_new_sdk;
 	}
 
-	/* 3. Load alpha mask effect. */
+	/* 2. Load alpha mask effect. */
 	char *effect_path = obs_module_file("rtx_greenscreen.effect");
 
 	obs_enter_graphics();
@@ -501,24 +649,12 @@ static void *nv_greenscreen_filter_create(obs_data_t *settings,
 	}
 	obs_leave_graphics();
 
-	/* 4. Allocate state for the effect */
-	if (nvvfx_new_sdk) {
-		vfxErr = NvVFX_AllocateState(filter->handle,
-					     &filter->stateObjectHandle);
-		if (NVCV_SUCCESS != vfxErr) {
-			const char *errString =
-				NvCV_GetErrorStringFromCode(vfxErr);
-			error("Error allocating FX state %i", vfxErr);
-			nv_greenscreen_filter_destroy(filter);
-			return NULL;
-		}
-		vfxErr = NvVFX_SetStateObjectHandleArray(
-			filter->handle, NVVFX_STATE,
-			&filter->stateObjectHandle);
-		if (NVCV_SUCCESS != vfxErr) {
-			const char *errString =
-				NvCV_GetErrorStringFromCode(vfxErr);
-			error("Error setting FX state %i", vfxErr);
+	/* 3. Create FX, with state objects the FX loaded for the mode is
+	 * shared and the state is allocated on the first update */
+	filter->shared_fx = nvvfx_new_sdk;
+	if (!filter->shared_fx) {
+		filter->handle = create_fx(filter, -1);
+		if (!filter->handle) {
 			nv_greenscreen_filter_destroy(filter);
 			return NULL;
 		}
@@ -550,6 +686,12 @@ static obs_properties_t *nv_greenscreen_filter_properties(void *data)
 	obs_property_t *partial = obs_properties_add_int_slider(
 		props, S_PROCESSING, TEXT_PROCESSING, 1, 4, 1);
 	obs_property_set_long_description(partial, TEXT_PROCESSING_HINT);
+	obs_property_t *latency = obs_properties_add_list(
+		props, S_LATENCY, TEXT_LATENCY, OBS_COMBO_TYPE_LIST,
+		OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(latency, TEXT_LATENCY_NONE, 0);
+	obs_property_list_add_int(latency, TEXT_LATENCY_ONE_FRAME, 1);
+	obs_property_set_long_description(latency, TEXT_LATENCY_HINT);
 	unsigned int version = get_lib_version();
 	if (version && version < MIN_VFX_SDK_VERSION) {
 		obs_property_t *warning = obs_properties_add_text(
@@ -567,6 +709,7 @@ static void nv_greenscreen_filter_defaults(obs_data_t *settings)
 	obs_data_set_default_double(settings, S_THRESHOLDFX,
 				    S_THRESHOLDFX_DEFAULT);
 	obs_data_set_default_int(settings, S_PROCESSING, 1);
+	obs_data_set_default_int(settings, S_LATENCY, 0);
 }
 
 static struct obs_source_frame *
@@ -678,8 +821,9 @@ static void draw_greenscreen(struct nv_greenscreen_data *filter)
 	if (obs_source_process_filter_begin_with_color_space(
 		    filter->context, format, source_space,
 		    OBS_ALLOW_DIRECT_RENDERING)) {
-		gs_effect_set_texture(filter->mask_param,
-				      filter->alpha_texture);
+		gs_effect_set_texture(
+			filter->mask_param,
+			filter->alpha_texture[filter->mask_index]);
 		gs_effect_set_texture_srgb(
 			filter->image_param,
 			gs_texrender_get_texture(filter->render));
@@ -860,12 +1004,13 @@ static void nv_greenscreen_filter_render(void *data, gs_effect_t *effect)
 
 	/* 3. Process FX (outputs a mask) & draw. */
 	if (filter->initial_render && filter->images_allocated) {
+		bool process = false;
 		bool draw = true;
 		if (!async || filter->got_new_frame) {
 			if (filter->processing_counter %
 				    filter->processing_interval ==
 			    0) {
-				draw = process_texture_greenscreen(filter);
+				process = true;
 				filter->processing_counter = 1;
 			} else {
 				filter->processing_counter++;
@@ -873,10 +1018,25 @@ static void nv_greenscreen_filter_render(void *data, gs_effect_t *effect)
 			filter->got_new_frame = false;
 		}
 
+		/* without latency, or until there's a mask to draw, the mask
+		 * for this frame has to be done before drawing */
+		if (process && (!filter->latency || !filter->mask_valid)) {
+			draw = process_texture_greenscreen(filter,
+							   filter->mask_index);
+			filter->mask_valid = draw;
+			process = false;
+		}
+
 		if (draw) {
 			draw_greenscreen(filter);
 			filter->processed_frame = true;
 		}
+
+		if (process) {
+			const uint32_t next = filter->mask_index ^ 1;
+			if (process_texture_greenscreen(filter, next))
+				filter->mask_index = next;
+		}
 	} else {
 		obs_source_skip_video_filter(filter->context);
 	}
@@ -90,8 +90,11 @@ bool obs_module_load(void)
 	return true;
 }
 
+extern void color_grade_filter_free_cache(void);
+
 void obs_module_unload(void)
 {
+	color_grade_filter_free_cache();
 #ifdef LIBNVAFX_ENABLED
 	unload_nvafx();
 #endif
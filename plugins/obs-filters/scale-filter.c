@@ -608,7 +608,8 @@ scale_filter_get_color_space(void *data, size_t count,
 struct obs_source_info scale_filter = {
 	.id = "scale_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = scale_filter_name,
 	.create = scale_filter_create,
 	.destroy = scale_filter_destroy,
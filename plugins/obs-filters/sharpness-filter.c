@@ -162,7 +162,8 @@ sharpness_get_color_space(void *data, size_t count,
 struct obs_source_info sharpness_filter = {
 	.id = "sharpness_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CAP_OBSOLETE |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = sharpness_getname,
 	.create = sharpness_create,
 	.destroy = sharpness_destroy,
@@ -176,7 +177,8 @@ struct obs_source_info sharpness_filter_v2 = {
 	.id = "sharpness_filter",
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = sharpness_getname,
 	.create = sharpness_create,
 	.destroy = sharpness_destroy,
@@ -20,10 +20,14 @@ target_sources(
           flv-mux.c
           flv-mux.h
           flv-output.c
+          mp4-mux.c
+          mp4-mux.h
+          mp4-output.c
           net-if.c
           net-if.h
           null-output.c
           rtmp-helpers.h
+          rtmp-posix.c
           rtmp-stream.c
           rtmp-stream.h
           rtmp-windows.c
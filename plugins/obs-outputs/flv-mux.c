@@ -293,15 +293,49 @@ void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 static int32_t last_time = 0;
 #endif
 
-static void flv_video(struct serializer *s, int32_t dts_offset,
-		      struct encoder_packet *packet, bool is_header)
+/* fixed size output for tag headers, so that they can be built without any
+ * allocation when the payload is sent separately */
+struct head_output_data {
+	uint8_t *bytes;
+	size_t size;
+	size_t pos;
+};
+
+static size_t head_output_write(void *param, const void *data, size_t size)
+{
+	struct head_output_data *output = param;
+	if (output->pos + size > output->size)
+		size = output->size - output->pos;
+	memcpy(output->bytes + output->pos, data, size);
+	output->pos += size;
+	return size;
+}
+
+static int64_t head_output_get_pos(void *param)
+{
+	struct head_output_data *output = param;
+	return (int64_t)output->pos;
+}
+
+static void head_output_serializer_init(struct serializer *s,
+					struct head_output_data *data,
+					uint8_t *head)
+{
+	memset(s, 0, sizeof(struct serializer));
+	data->bytes = head;
+	data->size = FLV_PACKET_HEAD_MAX;
+	data->pos = 0;
+	s->data = data;
+	s->write = head_output_write;
+	s->get_pos = head_output_get_pos;
+}
+
+static void flv_video_head(struct serializer *s, int32_t dts_offset,
+			   struct encoder_packet *packet, bool is_header)
 {
 	int64_t offset = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
-	if (!packet->data || !packet->size)
-		return;
-
 	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
 
 #ifdef DEBUG_TIMESTAMPS
@@ -322,19 +356,25 @@ static void flv_video(struct serializer *s, int32_t dts_offset,
 	s_w8(s, packet->keyframe ? 0x17 : 0x27);
 	s_w8(s, is_header ? 0 : 1);
 	s_wb24(s, get_ms_time(packet, offset));
+}
+
+static void flv_video(struct serializer *s, int32_t dts_offset,
+		      struct encoder_packet *packet, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return;
+
+	flv_video_head(s, dts_offset, packet, is_header);
 	s_write(s, packet->data, packet->size);
 
 	write_previous_tag_size(s);
 }
 
-static void flv_audio(struct serializer *s, int32_t dts_offset,
-		      struct encoder_packet *packet, bool is_header)
+static void flv_audio_head(struct serializer *s, int32_t dts_offset,
+			   struct encoder_packet *packet, bool is_header)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
-	if (!packet->data || !packet->size)
-		return;
-
 	s_w8(s, RTMP_PACKET_TYPE_AUDIO);
 
 #ifdef DEBUG_TIMESTAMPS
@@ -354,6 +394,15 @@ static void flv_audio(struct serializer *s, int32_t dts_offset,
 	/* these are the two extra bytes mentioned above */
 	s_w8(s, 0xaf);
 	s_w8(s, is_header ? 0 : 1);
+}
+
+static void flv_audio(struct serializer *s, int32_t dts_offset,
+		      struct encoder_packet *packet, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return;
+
+	flv_audio_head(s, dts_offset, packet, is_header);
 	s_write(s, packet->data, packet->size);
 
 	write_previous_tag_size(s);
@@ -376,15 +425,28 @@ void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 	*size = data.bytes.num;
 }
 
-// Y2023 spec
-void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
-		   int32_t dts_offset, uint8_t **output, size_t *size, int type,
-		   size_t idx)
+size_t flv_packet_mux_head(struct encoder_packet *packet, int32_t dts_offset,
+			   uint8_t *head, bool is_header)
 {
-	struct array_output_data data;
+	struct head_output_data data;
 	struct serializer s;
-	array_output_serializer_init(&s, &data);
 
+	head_output_serializer_init(&s, &data, head);
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		flv_video_head(&s, dts_offset, packet, is_header);
+	else
+		flv_audio_head(&s, dts_offset, packet, is_header);
+
+	return data.pos;
+}
+
+// Y2023 spec
+static void flv_packet_ex_head(struct serializer *s,
+			       struct encoder_packet *packet,
+			       enum video_id_t codec_id, int32_t dts_offset,
+			       int type, size_t idx)
+{
 	assert(packet->type == OBS_ENCODER_VIDEO);
 
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
@@ -401,10 +463,10 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
 	if (is_multitrack)
 		header_metadata_size += 2; // w8+w8
 
-	s_w8(&s, RTMP_PACKET_TYPE_VIDEO);
-	s_wb24(&s, (uint32_t)packet->size + header_metadata_size);
-	s_wtimestamp(&s, time_ms);
-	s_wb24(&s, 0); // always 0
+	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
+	s_wb24(s, (uint32_t)packet->size + header_metadata_size);
+	s_wtimestamp(s, time_ms);
+	s_wb24(s, 0); // always 0
 
 	uint8_t frame_type = packet->keyframe ? FT_KEY : FT_INTER;
 
@@ -413,21 +475,32 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
 	 * The default trackId is 0.
 	 */
 	if (is_multitrack) {
-		s_w8(&s, FRAME_HEADER_EX | PACKETTYPE_MULTITRACK | frame_type);
-		s_w8(&s, MULTITRACKTYPE_ONE_TRACK | type);
-		s_w4cc(&s, codec_id);
+		s_w8(s, FRAME_HEADER_EX | PACKETTYPE_MULTITRACK | frame_type);
+		s_w8(s, MULTITRACKTYPE_ONE_TRACK | type);
+		s_w4cc(s, codec_id);
 		// trackId
-		s_w8(&s, (uint8_t)idx);
+		s_w8(s, (uint8_t)idx);
 	} else {
-		s_w8(&s, FRAME_HEADER_EX | type | frame_type);
-		s_w4cc(&s, codec_id);
+		s_w8(s, FRAME_HEADER_EX | type | frame_type);
+		s_w4cc(s, codec_id);
 	}
 
 	// H.264/HEVC composition time offset
 	if ((codec_id == CODEC_H264 || codec_id == CODEC_HEVC) &&
 	    type == PACKETTYPE_FRAMES) {
-		s_wb24(&s, get_ms_time(packet, packet->pts - packet->dts));
+		s_wb24(s, get_ms_time(packet, packet->pts - packet->dts));
 	}
+}
+
+void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
+		   int32_t dts_offset, uint8_t **output, size_t *size, int type,
+		   size_t idx)
+{
+	struct array_output_data data;
+	struct serializer s;
+	array_output_serializer_init(&s, &data);
+
+	flv_packet_ex_head(&s, packet, codec_id, dts_offset, type, idx);
 
 	// packet data
 	s_write(&s, packet->data, packet->size);
@@ -446,18 +519,36 @@ void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec,
 		      idx);
 }
 
-void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec,
-		       int32_t dts_offset, uint8_t **output, size_t *size,
-		       size_t idx)
+static inline int frames_packet_type(struct encoder_packet *packet,
+				     enum video_id_t codec)
 {
-	int packet_type = PACKETTYPE_FRAMES;
 	// PACKETTYPE_FRAMESX is an optimization to avoid sending composition
 	// time offsets of 0. See Enhanced RTMP spec.
 	if ((codec == CODEC_H264 || codec == CODEC_HEVC) &&
 	    packet->dts == packet->pts)
-		packet_type = PACKETTYPE_FRAMESX;
-	flv_packet_ex(packet, codec, dts_offset, output, size, packet_type,
-		      idx);
+		return PACKETTYPE_FRAMESX;
+	return PACKETTYPE_FRAMES;
+}
+
+void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec,
+		       int32_t dts_offset, uint8_t **output, size_t *size,
+		       size_t idx)
+{
+	flv_packet_ex(packet, codec, dts_offset, output, size,
+		      frames_packet_type(packet, codec), idx);
+}
+
+size_t flv_packet_frames_head(struct encoder_packet *packet,
+			      enum video_id_t codec, int32_t dts_offset,
+			      uint8_t *head, size_t idx)
+{
+	struct head_output_data data;
+	struct serializer s;
+
+	head_output_serializer_init(&s, &data, head);
+	flv_packet_ex_head(&s, packet, codec, dts_offset,
+			   frames_packet_type(packet, codec), idx);
+	return data.pos;
 }
 
 void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec,
@@ -58,6 +58,20 @@ extern void flv_additional_packet_mux(struct encoder_packet *packet,
 				      int32_t dts_offset, uint8_t **output,
 				      size_t *size, bool is_header,
 				      size_t index);
+
+/* Largest tag header written by the *_head functions: the 11 byte FLV tag
+ * header plus the codec specific bytes that precede the packet data.  The
+ * packet data follows the head directly and the previous tag size is not
+ * included. */
+#define FLV_PACKET_HEAD_MAX 32
+
+extern size_t flv_packet_mux_head(struct encoder_packet *packet,
+				  int32_t dts_offset, uint8_t *head,
+				  bool is_header);
+extern size_t flv_packet_frames_head(struct encoder_packet *packet,
+				     enum video_id_t codec, int32_t dts_offset,
+				     uint8_t *head, size_t idx);
+
 // Y2023 spec
 extern void flv_packet_start(struct encoder_packet *packet,
 			     enum video_id_t codec, uint8_t **output,
@@ -17,6 +17,7 @@
 
 #include <obs-module.h>
 #include <obs-avc.h>
+#include <obs-packet-drop.h>
 #include <util/platform.h>
 #include <util/deque.h>
 #include <util/dstr.h>
@@ -94,6 +95,7 @@ struct ftl_stream {
 	int64_t drop_threshold_usec;
 	int64_t pframe_drop_threshold_usec;
 	int min_priority;
+	int64_t drop_hold_dts_usec;
 	float congestion;
 
 	int64_t last_dts_usec;
@@ -668,109 +670,72 @@ static inline size_t num_buffered_packets(struct ftl_stream *stream)
 	return stream->packets.size / sizeof(struct encoder_packet);
 }
 
-static void drop_frames(struct ftl_stream *stream, const char *name,
-			int highest_priority, bool pframes)
+static void drop_frames(struct ftl_stream *stream,
+			int64_t buffer_duration_usec)
 {
-	UNUSED_PARAMETER(pframes);
-
-	struct deque new_buf = {0};
-	int num_frames_dropped = 0;
+	bool pframes = buffer_duration_usec >
+		       stream->pframe_drop_threshold_usec;
+	size_t num_frames_dropped;
 
 #ifdef _DEBUG
 	int start_packets = (int)num_buffered_packets(stream);
-#else
-	UNUSED_PARAMETER(name);
 #endif
 
-	deque_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		deque_pop_front(&stream->packets, &packet, sizeof(packet));
-
-		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority >= highest_priority) {
-			deque_push_back(&new_buf, &packet, sizeof(packet));
-
-		} else {
-			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
-		}
-	}
+	num_frames_dropped = obs_packet_queue_drop(
+		&stream->packets, buffer_duration_usec,
+		stream->drop_threshold_usec / 2, pframes,
+		&stream->min_priority);
 
-	deque_free(&stream->packets);
-	stream->packets = new_buf;
+	/* the buffered duration does not shrink until the packets that were
+	 * queued before the drop have been sent, so wait for that */
+	stream->drop_hold_dts_usec = stream->last_dts_usec;
 
-	if (stream->min_priority < highest_priority)
-		stream->min_priority = highest_priority;
 	if (!num_frames_dropped)
 		return;
 
 	stream->dropped_frames += num_frames_dropped;
 #ifdef _DEBUG
-	debug("Dropped %s, prev packet count: %d, new packet count: %d", name,
+	debug("Dropped %d %s, prev packet count: %d, new packet count: %d",
+	      (int)num_frames_dropped, pframes ? "p-frames" : "b-frames",
 	      start_packets, (int)num_buffered_packets(stream));
 #endif
 }
 
-static bool find_first_video_packet(struct ftl_stream *stream,
-				    struct encoder_packet *first)
-{
-	size_t count = stream->packets.size / sizeof(*first);
-
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur =
-			deque_data(&stream->packets, i * sizeof(*first));
-		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
-			*first = *cur;
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static void check_to_drop_frames(struct ftl_stream *stream, bool pframes)
+static void check_to_drop_frames(struct ftl_stream *stream)
 {
 	struct encoder_packet first;
 	int64_t buffer_duration_usec;
 	size_t num_packets = num_buffered_packets(stream);
-	const char *name = pframes ? "p-frames" : "b-frames";
-	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST
-			       : OBS_NAL_PRIORITY_HIGH;
-	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec
-					 : stream->drop_threshold_usec;
+	int64_t drop_threshold = stream->drop_threshold_usec;
 
 	if (num_packets < 5) {
-		if (!pframes)
-			stream->congestion = 0.0f;
+		stream->congestion = 0.0f;
 		return;
 	}
 
-	if (!find_first_video_packet(stream, &first))
+	if (!obs_packet_queue_first_video(&stream->packets, &first))
 		return;
 
 	/* if the amount of time stored in the buffered packets waiting to be
 	 * sent is higher than threshold, drop frames */
 	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
 
-	if (!pframes) {
-		stream->congestion =
-			(float)buffer_duration_usec / (float)drop_threshold;
-	}
+	stream->congestion =
+		(float)buffer_duration_usec / (float)drop_threshold;
 
-	if (buffer_duration_usec > drop_threshold) {
+	if (buffer_duration_usec > drop_threshold &&
+	    !obs_packet_queue_drop_held(first.dts_usec, stream->last_dts_usec,
+					stream->drop_hold_dts_usec,
+					drop_threshold)) {
 		debug("buffer_duration_usec: %" PRId64, buffer_duration_usec);
-		drop_frames(stream, name, priority, pframes);
+		drop_frames(stream, buffer_duration_usec);
 	}
 }
 
 static bool add_video_packet(struct ftl_stream *stream,
 			     struct encoder_packet *packet)
 {
-	check_to_drop_frames(stream, false);
-	check_to_drop_frames(stream, true);
+	check_to_drop_frames(stream);
 
 	/* if currently dropping frames, drop packets until it reaches the
 	 * desired priority */
@@ -1028,6 +993,7 @@ static int init_connect(struct ftl_stream *stream)
 	stream->total_bytes_sent = 0;
 	stream->dropped_frames = 0;
 	stream->min_priority = 0;
+	stream->drop_hold_dts_usec = 0;
 
 	settings = obs_output_get_settings(stream->output);
 	obs_encoder_t *video_encoder =
@@ -1090,6 +1056,8 @@ static int init_connect(struct ftl_stream *stream)
 
 	stream->drop_threshold_usec =
 		(int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD) * 1000;
+	stream->pframe_drop_threshold_usec =
+		stream->drop_threshold_usec + 200000;
 	stream->max_shutdown_time_sec =
 		(int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
 
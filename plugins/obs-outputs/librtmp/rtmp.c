@@ -39,6 +39,22 @@
 #define MSG_NOSIGNAL 0
 #endif
 
+#ifdef _WIN32
+typedef WSABUF RTMPIOVec;
+#define IOVEC_SET(v, p, n) ((v)->buf = (CHAR *)(p), (v)->len = (ULONG)(n))
+#define IOVEC_BASE(v) ((v)->buf)
+#define IOVEC_LEN(v) ((int)(v)->len)
+#else
+#include <sys/uio.h>
+typedef struct iovec RTMPIOVec;
+#define IOVEC_SET(v, p, n) ((v)->iov_base = (void *)(p), (v)->iov_len = (size_t)(n))
+#define IOVEC_BASE(v) ((char *)(v)->iov_base)
+#define IOVEC_LEN(v) ((int)(v)->iov_len)
+#endif
+
+/* enough for a few chunks per send call, well below any IOV_MAX */
+#define RTMP_MAX_IOVECS 64
+
 #ifdef CRYPTO
 
 #ifdef __APPLE__
@@ -5383,3 +5399,387 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+static int
+SockBuf_SendV(RTMPSockBuf *sb, RTMPIOVec *vecs, int count)
+{
+#ifdef _WIN32
+    DWORD sent = 0;
+
+    if (WSASend(sb->sb_socket, vecs, count, &sent, 0, NULL, NULL) != 0)
+        return -1;
+    return (int)sent;
+#else
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vecs;
+    msg.msg_iovlen = count;
+    return (int)sendmsg(sb->sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+}
+
+/* TLS and custom send functions need contiguous data, so gather into a
+ * small buffer for them instead of sending each piece on its own */
+static int
+WriteGathered(RTMP *r, const RTMPIOVec *vecs, int count)
+{
+    char buf[16384];
+    int len = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        const char *ptr = IOVEC_BASE(&vecs[i]);
+        int n = IOVEC_LEN(&vecs[i]);
+
+        while (n > 0)
+        {
+            int num = n;
+            if (num > (int)sizeof(buf) - len)
+                num = (int)sizeof(buf) - len;
+
+            memcpy(buf + len, ptr, num);
+            len += num;
+            ptr += num;
+            n -= num;
+
+            if (len == sizeof(buf))
+            {
+                if (!WriteN(r, buf, len))
+                    return FALSE;
+                len = 0;
+            }
+        }
+    }
+
+    return len ? WriteN(r, buf, len) : TRUE;
+}
+
+static int
+WriteV(RTMP *r, RTMPIOVec *vecs, int count)
+{
+    struct linger l;
+
+#if defined(CRYPTO) && !defined(NO_SSL)
+    if (r->m_sb.sb_ssl)
+        return WriteGathered(r, vecs, count);
+#endif
+    if (r->m_bCustomSend && r->m_customSendFunc)
+        return WriteGathered(r, vecs, count);
+
+    while (count > 0)
+    {
+        int nBytes = SockBuf_SendV(&r->m_sb, vecs, count);
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d", __FUNCTION__,
+                     sockerr);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            r->last_error_code = sockerr;
+
+            /* same abortive shutdown as WriteN */
+            l.l_onoff = 1;
+            l.l_linger = 0;
+            setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
+            RTMPSockBuf_Close(&r->m_sb);
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        while (count > 0 && nBytes >= IOVEC_LEN(vecs))
+        {
+            nBytes -= IOVEC_LEN(vecs);
+            vecs++;
+            count--;
+        }
+
+        if (count > 0 && nBytes)
+            IOVEC_SET(vecs, IOVEC_BASE(vecs) + nBytes, IOVEC_LEN(vecs) - nBytes);
+    }
+
+    return TRUE;
+}
+
+/* Same as RTMP_SendPacket, but the body is given as a list of buffers that
+ * are never modified.  Chunk headers are built separately and sent together
+ * with the body through a single scatter/gather call per batch of chunks. */
+static int
+SendPacketV(RTMP *r, RTMPPacket *packet, const AVal *bufs, int nbufs)
+{
+    const RTMPPacket *prevPacket;
+    uint32_t last = 0;
+    int nSize, hSize, cSize, t3Size;
+    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], t3buf[7], c;
+    RTMPIOVec vecs[RTMP_MAX_IOVECS];
+    int count = 0;
+    int buf_idx = 0, buf_offset = 0;
+    uint32_t t;
+    int nChunkSize;
+
+    if (packet->m_nChannel >= r->m_channelsAllocatedOut)
+    {
+        int n = packet->m_nChannel + 10;
+        RTMPPacket **packets = realloc(r->m_vecChannelsOut, sizeof(RTMPPacket*) * n);
+        if (!packets)
+        {
+            free(r->m_vecChannelsOut);
+            r->m_vecChannelsOut = NULL;
+            r->m_channelsAllocatedOut = 0;
+            return FALSE;
+        }
+        r->m_vecChannelsOut = packets;
+        memset(r->m_vecChannelsOut + r->m_channelsAllocatedOut, 0, sizeof(RTMPPacket*) * (n - r->m_channelsAllocatedOut));
+        r->m_channelsAllocatedOut = n;
+    }
+
+    prevPacket = r->m_vecChannelsOut[packet->m_nChannel];
+    if (prevPacket && packet->m_headerType != RTMP_PACKET_SIZE_LARGE)
+    {
+        /* compress a bit by using the prev packet's attributes */
+        if (prevPacket->m_nBodySize == packet->m_nBodySize
+                && prevPacket->m_packetType == packet->m_packetType
+                && packet->m_headerType == RTMP_PACKET_SIZE_MEDIUM)
+            packet->m_headerType = RTMP_PACKET_SIZE_SMALL;
+
+        if (prevPacket->m_nTimeStamp == packet->m_nTimeStamp
+                && packet->m_headerType == RTMP_PACKET_SIZE_SMALL)
+            packet->m_headerType = RTMP_PACKET_SIZE_MINIMUM;
+        last = prevPacket->m_nTimeStamp;
+    }
+
+    if (packet->m_headerType > 3)	/* sanity */
+    {
+        RTMP_Log(RTMP_LOGERROR, "sanity failed!! trying to send header of type: 0x%02x.",
+                 (unsigned char)packet->m_headerType);
+        return FALSE;
+    }
+
+    nSize = packetSize[packet->m_headerType];
+    hSize = nSize;
+    cSize = 0;
+    t = packet->m_nTimeStamp - last;
+
+    header = hbuf + 6;
+    hend = hbuf + sizeof(hbuf);
+
+    if (packet->m_nChannel > 319)
+        cSize = 2;
+    else if (packet->m_nChannel > 63)
+        cSize = 1;
+    if (cSize)
+    {
+        header -= cSize;
+        hSize += cSize;
+    }
+
+    if (nSize > 1 && t >= 0xffffff)
+    {
+        header -= 4;
+        hSize += 4;
+    }
+
+    hptr = header;
+    c = packet->m_headerType << 6;
+    switch (cSize)
+    {
+    case 0:
+        c |= packet->m_nChannel;
+        break;
+    case 1:
+        break;
+    case 2:
+        c |= 1;
+        break;
+    }
+    *hptr++ = c;
+    if (cSize)
+    {
+        int tmp = packet->m_nChannel - 64;
+        *hptr++ = tmp & 0xff;
+        if (cSize == 2)
+            *hptr++ = tmp >> 8;
+    }
+
+    if (nSize > 1)
+    {
+        hptr = AMF_EncodeInt24(hptr, hend, t > 0xffffff ? 0xffffff : t);
+    }
+
+    if (nSize > 4)
+    {
+        hptr = AMF_EncodeInt24(hptr, hend, packet->m_nBodySize);
+        *hptr++ = packet->m_packetType;
+    }
+
+    if (nSize > 8)
+        hptr += EncodeInt32LE(hptr, packet->m_nInfoField2);
+
+    if (nSize > 1 && t >= 0xffffff)
+        hptr = AMF_EncodeInt32(hptr, hend, t);
+
+    /* the type 3 header is the same for every continuation chunk */
+    t3Size = 1;
+    t3buf[0] = (0xc0 | c);
+    if (cSize)
+    {
+        int tmp = packet->m_nChannel - 64;
+        t3buf[1] = tmp & 0xff;
+        if (cSize == 2)
+            t3buf[2] = tmp >> 8;
+        t3Size += cSize;
+    }
+    if (t >= 0xffffff)
+    {
+        AMF_EncodeInt32(t3buf + t3Size, t3buf + sizeof(t3buf), t);
+        t3Size += 4;
+    }
+
+    nSize = packet->m_nBodySize;
+    nChunkSize = r->m_outChunkSize;
+
+    RTMP_Log(RTMP_LOGDEBUG2, "%s: fd=%d, size=%d", __FUNCTION__, (int)r->m_sb.sb_socket,
+             nSize);
+
+    IOVEC_SET(&vecs[count], header, hSize);
+    count++;
+
+    while (nSize > 0)
+    {
+        int remaining = nSize < nChunkSize ? nSize : nChunkSize;
+        nSize -= remaining;
+
+        while (remaining > 0)
+        {
+            const AVal *buf = &bufs[buf_idx];
+            int num = buf->av_len - buf_offset;
+            if (num > remaining)
+                num = remaining;
+
+            if (num > 0)
+            {
+                if (count == RTMP_MAX_IOVECS)
+                {
+                    if (!WriteV(r, vecs, count))
+                        return FALSE;
+                    count = 0;
+                }
+
+                IOVEC_SET(&vecs[count], buf->av_val + buf_offset, num);
+                count++;
+            }
+
+            remaining -= num;
+            buf_offset += num;
+            if (buf_offset == buf->av_len)
+            {
+                if (++buf_idx == nbufs && remaining)
+                    return FALSE;
+                buf_offset = 0;
+            }
+        }
+
+        if (nSize > 0)
+        {
+            if (count == RTMP_MAX_IOVECS)
+            {
+                if (!WriteV(r, vecs, count))
+                    return FALSE;
+                count = 0;
+            }
+
+            IOVEC_SET(&vecs[count], t3buf, t3Size);
+            count++;
+        }
+    }
+
+    if (count && !WriteV(r, vecs, count))
+        return FALSE;
+
+    packet->m_body = NULL;
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    return TRUE;
+}
+
+int
+RTMP_WriteV(RTMP *r, const char *head, int head_size, const char *body,
+            int body_size, int streamIdx)
+{
+    RTMPPacket packet;
+    AVal bufs[2];
+    const char *buf = head;
+
+    if (head_size < 11)
+    {
+        /* FLV pkt too small */
+        return 0;
+    }
+
+    /* RTMPT posts each send separately, keep those in one request */
+    if (r->Link.protocol & RTMP_FEATURE_HTTP)
+    {
+        char *tmp = malloc(head_size + body_size + 4);
+        int ret;
+
+        if (!tmp)
+            return FALSE;
+
+        memcpy(tmp, head, head_size);
+        memcpy(tmp + head_size, body, body_size);
+        AMF_EncodeInt32(tmp + head_size + body_size,
+                        tmp + head_size + body_size + 4,
+                        head_size + body_size);
+        ret = RTMP_Write(r, tmp, head_size + body_size + 4, streamIdx);
+        free(tmp);
+        return ret;
+    }
+
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+
+    packet.m_packetType = *buf++;
+    packet.m_nBodySize = AMF_DecodeInt24(buf);
+    buf += 3;
+    packet.m_nTimeStamp = AMF_DecodeInt24(buf);
+    buf += 3;
+    packet.m_nTimeStamp |= *buf++ << 24;
+
+    if (packet.m_nBodySize != (uint32_t)(head_size - 11 + body_size))
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, FLV tag size mismatch", __FUNCTION__);
+        return 0;
+    }
+
+    if (((packet.m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !packet.m_nTimeStamp) || packet.m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    bufs[0].av_val = (char *)head + 11;
+    bufs[0].av_len = head_size - 11;
+    bufs[1].av_val = (char *)body;
+    bufs[1].av_len = body_size;
+
+    if (!SendPacketV(r, &packet, bufs, 2))
+        return -1;
+
+    return head_size + body_size;
+}
@@ -542,6 +542,10 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    /* writes one FLV tag given as its tag header (plus any codec prefix) and
+     * the packet data, without copying the data */
+    int RTMP_WriteV(RTMP *r, const char *head, int head_size,
+                    const char *body, int body_size, int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
@@ -0,0 +1,1207 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include <obs.h>
+#include <obs-avc.h>
+#ifdef ENABLE_HEVC
+#include "rtmp-hevc.h"
+#include <obs-hevc.h>
+#endif
+#include <util/array-serializer.h>
+#include <util/platform.h>
+#include <util/darray.h>
+#include "mp4-mux.h"
+
+#define do_log(level, format, ...)                \
+	blog(level, "[mp4 output: '%s'] " format, \
+	     obs_output_get_name(mux->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+
+#define MAX_TRACKS (1 + MAX_OUTPUT_AUDIO_ENCODERS)
+
+/* larger moof boxes than this are taken as corruption when repairing */
+#define MAX_REPAIR_MOOF_SIZE (64 * 1024 * 1024)
+
+/* trun flags */
+#define TRUN_DATA_OFFSET 0x000001
+#define TRUN_SAMPLE_DURATION 0x000100
+#define TRUN_SAMPLE_SIZE 0x000200
+#define TRUN_SAMPLE_FLAGS 0x000400
+#define TRUN_SAMPLE_CTS 0x000800
+
+/* tfhd flags */
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000
+
+/* sample flags */
+#define SAMPLE_FLAGS_SYNC 0x02000000
+#define SAMPLE_FLAGS_NON_SYNC 0x01010000
+
+enum mp4_codec {
+	MP4_CODEC_H264,
+	MP4_CODEC_HEVC,
+	MP4_CODEC_AAC,
+};
+
+struct mp4_sample {
+	size_t offset;
+	uint32_t size;
+	int64_t dts;
+	int32_t cts_offset;
+	bool keyframe;
+};
+
+struct mp4_fragment_entry {
+	uint64_t time;
+	uint64_t moof_offset;
+	uint8_t traf_number;
+};
+
+struct mp4_track_index {
+	uint32_t track_id;
+	DARRAY(struct mp4_fragment_entry) entries;
+};
+
+struct mp4_track {
+	enum mp4_codec codec;
+	obs_encoder_t *encoder;
+	uint32_t timescale;
+	uint32_t default_duration;
+
+	bool got_first;
+	int64_t first_dts;
+	int64_t start_offset;
+	int32_t first_cts_offset;
+
+	DARRAY(struct mp4_sample) samples;
+	DARRAY(uint8_t) data;
+
+	struct mp4_track_index index;
+};
+
+struct mp4_mux {
+	obs_output_t *output;
+	FILE *file;
+	uint32_t fragment_ms;
+
+	struct mp4_track tracks[MAX_TRACKS];
+	size_t num_tracks;
+
+	/* the first video track, or the first audio track if there is no
+	 * video.  fragments are cut on its keyframes */
+	struct mp4_track *primary;
+	struct mp4_track *video;
+	struct mp4_track *audio[MAX_OUTPUT_AUDIO_ENCODERS];
+
+	bool started;
+	int64_t start_usec;
+	bool wrote_init;
+	uint32_t sequence;
+};
+
+/* ------------------------------------------------------------------------- */
+/* box helpers */
+
+static inline void put_be32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)(val >> 24);
+	p[1] = (uint8_t)(val >> 16);
+	p[2] = (uint8_t)(val >> 8);
+	p[3] = (uint8_t)val;
+}
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t get_be64(const uint8_t *p)
+{
+	return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+static inline size_t box_start(struct serializer *s, const char *type)
+{
+	size_t start = (size_t)serializer_get_pos(s);
+	s_wb32(s, 0);
+	s_write(s, type, 4);
+	return start;
+}
+
+static inline size_t fullbox_start(struct serializer *s, const char *type,
+				   uint8_t version, uint32_t flags)
+{
+	size_t start = box_start(s, type);
+	s_w8(s, version);
+	s_wb24(s, flags);
+	return start;
+}
+
+static inline void box_end(struct serializer *s, size_t start)
+{
+	struct array_output_data *out = s->data;
+	put_be32(out->bytes.array + start, (uint32_t)(out->bytes.num - start));
+}
+
+static inline void write_zeros(struct serializer *s, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		s_w8(s, 0);
+}
+
+static inline void write_matrix(struct serializer *s)
+{
+	s_wb32(s, 0x00010000);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0x00010000);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0x40000000);
+}
+
+static inline bool write_output(FILE *file, struct array_output_data *out)
+{
+	return fwrite(out->bytes.array, 1, out->bytes.num, file) ==
+	       out->bytes.num;
+}
+
+/* ------------------------------------------------------------------------- */
+/* init segment */
+
+static void write_ftyp(struct serializer *s)
+{
+	size_t start = box_start(s, "ftyp");
+	s_write(s, "isom", 4);
+	s_wb32(s, 0x200);
+	s_write(s, "isom", 4);
+	s_write(s, "iso6", 4);
+	s_write(s, "mp41", 4);
+	box_end(s, start);
+}
+
+static void write_mvhd(struct mp4_mux *mux, struct serializer *s)
+{
+	size_t start = fullbox_start(s, "mvhd", 0, 0);
+	s_wb32(s, 0);          /* creation time */
+	s_wb32(s, 0);          /* modification time */
+	s_wb32(s, 1000);       /* timescale */
+	s_wb32(s, 0);          /* duration, unknown when fragmented */
+	s_wb32(s, 0x00010000); /* rate */
+	s_wb16(s, 0x0100);     /* volume */
+	write_zeros(s, 10);
+	write_matrix(s);
+	write_zeros(s, 24);
+	s_wb32(s, (uint32_t)mux->num_tracks + 1); /* next track id */
+	box_end(s, start);
+}
+
+static void write_tkhd(struct mp4_track *track, struct serializer *s)
+{
+	bool video = track->codec != MP4_CODEC_AAC;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	if (video) {
+		width = obs_encoder_get_width(track->encoder);
+		height = obs_encoder_get_height(track->encoder);
+	}
+
+	/* enabled and in movie */
+	size_t start = fullbox_start(s, "tkhd", 0, 0x3);
+	s_wb32(s, 0); /* creation time */
+	s_wb32(s, 0); /* modification time */
+	s_wb32(s, track->index.track_id);
+	s_wb32(s, 0);
+	s_wb32(s, 0); /* duration */
+	write_zeros(s, 8);
+	s_wb16(s, 0);                   /* layer */
+	s_wb16(s, video ? 0 : 1);       /* alternate group */
+	s_wb16(s, video ? 0 : 0x0100);  /* volume */
+	s_wb16(s, 0);
+	write_matrix(s);
+	s_wb32(s, width << 16);
+	s_wb32(s, height << 16);
+	box_end(s, start);
+}
+
+/* shifts the presentation of video with b-frames back to zero */
+static void write_edts(struct mp4_track *track, struct serializer *s)
+{
+	if (track->first_cts_offset <= 0)
+		return;
+
+	size_t edts = box_start(s, "edts");
+	size_t elst = fullbox_start(s, "elst", 0, 0);
+	s_wb32(s, 1);
+	s_wb32(s, 0); /* segment duration, whole track */
+	s_wb32(s, (uint32_t)track->first_cts_offset);
+	s_wb32(s, 0x00010000);
+	box_end(s, elst);
+	box_end(s, edts);
+}
+
+static void write_mdhd(struct mp4_track *track, struct serializer *s)
+{
+	size_t start = fullbox_start(s, "mdhd", 0, 0);
+	s_wb32(s, 0); /* creation time */
+	s_wb32(s, 0); /* modification time */
+	s_wb32(s, track->timescale);
+	s_wb32(s, 0);      /* duration */
+	s_wb16(s, 0x55c4); /* 'und' */
+	s_wb16(s, 0);
+	box_end(s, start);
+}
+
+static void write_hdlr(struct mp4_track *track, struct serializer *s)
+{
+	bool video = track->codec != MP4_CODEC_AAC;
+	const char *name = video ? "OBS Video Handler" : "OBS Audio Handler";
+
+	size_t start = fullbox_start(s, "hdlr", 0, 0);
+	s_wb32(s, 0);
+	s_write(s, video ? "vide" : "soun", 4);
+	write_zeros(s, 12);
+	s_write(s, name, strlen(name) + 1);
+	box_end(s, start);
+}
+
+static void write_dinf(struct serializer *s)
+{
+	size_t dinf = box_start(s, "dinf");
+	size_t dref = fullbox_start(s, "dref", 0, 0);
+	s_wb32(s, 1);
+	size_t url = fullbox_start(s, "url ", 0, 0x1); /* self-contained */
+	box_end(s, url);
+	box_end(s, dref);
+	box_end(s, dinf);
+}
+
+static void write_visual_sample_entry(struct mp4_track *track,
+				      struct serializer *s,
+				      const uint8_t *config, size_t config_size)
+{
+	bool hevc = track->codec == MP4_CODEC_HEVC;
+
+	size_t start = box_start(s, hevc ? "hvc1" : "avc1");
+	write_zeros(s, 6);
+	s_wb16(s, 1); /* data reference index */
+	write_zeros(s, 16);
+	s_wb16(s, (uint16_t)obs_encoder_get_width(track->encoder));
+	s_wb16(s, (uint16_t)obs_encoder_get_height(track->encoder));
+	s_wb32(s, 0x00480000); /* 72 dpi */
+	s_wb32(s, 0x00480000);
+	s_wb32(s, 0);
+	s_wb16(s, 1); /* frame count */
+	write_zeros(s, 32);
+	s_wb16(s, 0x0018);
+	s_wb16(s, 0xffff);
+
+	size_t cfg = box_start(s, hevc ? "hvcC" : "avcC");
+	s_write(s, config, config_size);
+	box_end(s, cfg);
+
+	box_end(s, start);
+}
+
+static inline void write_descriptor(struct serializer *s, uint8_t tag,
+				    size_t size)
+{
+	s_w8(s, tag);
+	s_w8(s, (uint8_t)size);
+}
+
+static void write_audio_sample_entry(struct mp4_track *track,
+				     struct serializer *s,
+				     const uint8_t *config, size_t config_size)
+{
+	audio_t *audio = obs_encoder_audio(track->encoder);
+	uint32_t channels = (uint32_t)audio_output_get_channels(audio);
+	uint32_t bitrate = 0;
+
+	obs_data_t *settings = obs_encoder_get_settings(track->encoder);
+	bitrate = (uint32_t)obs_data_get_int(settings, "bitrate") * 1000;
+	obs_data_release(settings);
+
+	size_t start = box_start(s, "mp4a");
+	write_zeros(s, 6);
+	s_wb16(s, 1); /* data reference index */
+	write_zeros(s, 8);
+	s_wb16(s, (uint16_t)channels);
+	s_wb16(s, 16);
+	s_wb16(s, 0);
+	s_wb16(s, 0);
+	s_wb32(s, track->timescale < 0x10000 ? track->timescale << 16 : 0);
+
+	/* descriptor sizes stay well below 128, so single byte sizes do */
+	size_t dsi_size = 2 + config_size;
+	size_t dcd_size = 2 + 13 + dsi_size;
+	size_t es_size = 3 + dcd_size + 3;
+
+	size_t esds = fullbox_start(s, "esds", 0, 0);
+	write_descriptor(s, 0x03, es_size);
+	s_wb16(s, 0); /* es id */
+	s_w8(s, 0);
+	write_descriptor(s, 0x04, dcd_size - 2);
+	s_w8(s, 0x40); /* mpeg-4 audio */
+	s_w8(s, 0x15); /* audio stream */
+	s_wb24(s, 0);  /* buffer size */
+	s_wb32(s, bitrate);
+	s_wb32(s, bitrate);
+	write_descriptor(s, 0x05, config_size);
+	s_write(s, config, config_size);
+	write_descriptor(s, 0x06, 1);
+	s_w8(s, 0x02);
+	box_end(s, esds);
+
+	box_end(s, start);
+}
+
+static bool get_codec_config(struct mp4_mux *mux, struct mp4_track *track,
+			     uint8_t **config, size_t *config_size)
+{
+	uint8_t *extra_data;
+	size_t extra_size;
+
+	if (!obs_encoder_get_extra_data(track->encoder, &extra_data,
+					&extra_size)) {
+		warn("Encoder '%s' has no codec header",
+		     obs_encoder_get_name(track->encoder));
+		return false;
+	}
+
+	switch (track->codec) {
+	case MP4_CODEC_H264:
+		*config_size = obs_parse_avc_header(config, extra_data,
+						    extra_size);
+		break;
+	case MP4_CODEC_HEVC:
+#ifdef ENABLE_HEVC
+		*config_size = obs_parse_hevc_header(config, extra_data,
+						     extra_size);
+		break;
+#else
+		return false;
+#endif
+	case MP4_CODEC_AAC:
+		*config = bmemdup(extra_data, extra_size);
+		*config_size = extra_size;
+		break;
+	}
+
+	if (!*config_size) {
+		warn("Failed to parse codec header of encoder '%s'",
+		     obs_encoder_get_name(track->encoder));
+		bfree(*config);
+		*config = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static bool write_stbl(struct mp4_mux *mux, struct mp4_track *track,
+		       struct serializer *s)
+{
+	uint8_t *config = NULL;
+	size_t config_size = 0;
+
+	if (!get_codec_config(mux, track, &config, &config_size))
+		return false;
+
+	size_t stbl = box_start(s, "stbl");
+
+	size_t stsd = fullbox_start(s, "stsd", 0, 0);
+	s_wb32(s, 1);
+	if (track->codec == MP4_CODEC_AAC)
+		write_audio_sample_entry(track, s, config, config_size);
+	else
+		write_visual_sample_entry(track, s, config, config_size);
+	box_end(s, stsd);
+
+	/* samples all live in the fragments, the tables stay empty */
+	size_t stts = fullbox_start(s, "stts", 0, 0);
+	s_wb32(s, 0);
+	box_end(s, stts);
+
+	size_t stsc = fullbox_start(s, "stsc", 0, 0);
+	s_wb32(s, 0);
+	box_end(s, stsc);
+
+	size_t stsz = fullbox_start(s, "stsz", 0, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	box_end(s, stsz);
+
+	size_t stco = fullbox_start(s, "stco", 0, 0);
+	s_wb32(s, 0);
+	box_end(s, stco);
+
+	box_end(s, stbl);
+
+	bfree(config);
+	return true;
+}
+
+static bool write_trak(struct mp4_mux *mux, struct mp4_track *track,
+		       struct serializer *s)
+{
+	bool video = track->codec != MP4_CODEC_AAC;
+
+	size_t trak = box_start(s, "trak");
+	write_tkhd(track, s);
+	if (video)
+		write_edts(track, s);
+
+	size_t mdia = box_start(s, "mdia");
+	write_mdhd(track, s);
+	write_hdlr(track, s);
+
+	size_t minf = box_start(s, "minf");
+	if (video) {
+		size_t vmhd = fullbox_start(s, "vmhd", 0, 0x1);
+		write_zeros(s, 8);
+		box_end(s, vmhd);
+	} else {
+		size_t smhd = fullbox_start(s, "smhd", 0, 0);
+		write_zeros(s, 4);
+		box_end(s, smhd);
+	}
+	write_dinf(s);
+	if (!write_stbl(mux, track, s))
+		return false;
+	box_end(s, minf);
+
+	box_end(s, mdia);
+	box_end(s, trak);
+	return true;
+}
+
+static bool write_init_segment(struct mp4_mux *mux)
+{
+	struct array_output_data out;
+	struct serializer s;
+	bool success = false;
+
+	array_output_serializer_init(&s, &out);
+
+	write_ftyp(&s);
+
+	size_t moov = box_start(&s, "moov");
+	write_mvhd(mux, &s);
+
+	for (size_t i = 0; i < mux->num_tracks; i++) {
+		if (!write_trak(mux, &mux->tracks[i], &s))
+			goto fail;
+	}
+
+	size_t mvex = box_start(&s, "mvex");
+	for (size_t i = 0; i < mux->num_tracks; i++) {
+		size_t trex = fullbox_start(&s, "trex", 0, 0);
+		s_wb32(&s, mux->tracks[i].index.track_id);
+		s_wb32(&s, 1); /* sample description index */
+		s_wb32(&s, 0);
+		s_wb32(&s, 0);
+		s_wb32(&s, 0);
+		box_end(&s, trex);
+	}
+	box_end(&s, mvex);
+
+	box_end(&s, moov);
+
+	success = write_output(mux->file, &out);
+	if (!success)
+		warn("Failed to write the init segment");
+
+fail:
+	array_output_serializer_free(&out);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* fragments */
+
+static inline bool is_video(const struct mp4_track *track)
+{
+	return track->codec != MP4_CODEC_AAC;
+}
+
+static uint32_t sample_duration(const struct mp4_track *track, size_t idx,
+				int64_t next_dts)
+{
+	const struct mp4_sample *sample = &track->samples.array[idx];
+	int64_t duration;
+
+	if (idx + 1 < track->samples.num)
+		duration = track->samples.array[idx + 1].dts - sample->dts;
+	else if (next_dts >= 0)
+		duration = next_dts - sample->dts;
+	else
+		duration = track->default_duration;
+
+	return duration > 0 ? (uint32_t)duration : 0;
+}
+
+static void write_traf(struct mp4_track *track, struct serializer *s,
+		       int64_t next_dts, size_t *data_offset_pos)
+{
+	bool video = is_video(track);
+	uint32_t flags = TRUN_DATA_OFFSET | TRUN_SAMPLE_DURATION |
+			 TRUN_SAMPLE_SIZE | TRUN_SAMPLE_FLAGS;
+	if (video)
+		flags |= TRUN_SAMPLE_CTS;
+
+	size_t traf = box_start(s, "traf");
+
+	size_t tfhd = fullbox_start(s, "tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+	s_wb32(s, track->index.track_id);
+	box_end(s, tfhd);
+
+	size_t tfdt = fullbox_start(s, "tfdt", 1, 0);
+	s_wb64(s, (uint64_t)track->samples.array[0].dts);
+	box_end(s, tfdt);
+
+	size_t trun = fullbox_start(s, "trun", 1, flags);
+	s_wb32(s, (uint32_t)track->samples.num);
+	*data_offset_pos = (size_t)serializer_get_pos(s);
+	s_wb32(s, 0);
+
+	for (size_t i = 0; i < track->samples.num; i++) {
+		struct mp4_sample *sample = &track->samples.array[i];
+
+		s_wb32(s, sample_duration(track, i, next_dts));
+		s_wb32(s, sample->size);
+		s_wb32(s, sample->keyframe ? SAMPLE_FLAGS_SYNC
+					   : SAMPLE_FLAGS_NON_SYNC);
+		if (video)
+			s_wb32(s, (uint32_t)sample->cts_offset);
+	}
+	box_end(s, trun);
+
+	box_end(s, traf);
+}
+
+/* writes everything buffered as one moof/mdat pair.  next_dts is the decode
+ * time of the primary track's next sample, or -1 if there is none */
+static bool flush_fragment(struct mp4_mux *mux, int64_t next_dts)
+{
+	struct array_output_data out;
+	struct serializer s;
+	size_t data_offset_pos[MAX_TRACKS];
+	uint8_t traf_number[MAX_TRACKS];
+	uint64_t data_size = 0;
+	uint8_t traf_count = 0;
+	bool success = true;
+
+	for (size_t i = 0; i < mux->num_tracks; i++)
+		data_size += mux->tracks[i].data.num;
+	if (!data_size)
+		return true;
+
+	if (!mux->wrote_init) {
+		if (!write_init_segment(mux))
+			return false;
+		mux->wrote_init = true;
+	}
+
+	const bool large_mdat = data_size + 8 > UINT32_MAX;
+	const uint64_t mdat_header = large_mdat ? 16 : 8;
+
+	array_output_serializer_init(&s, &out);
+
+	size_t moof = box_start(&s, "moof");
+	size_t mfhd = fullbox_start(&s, "mfhd", 0, 0);
+	s_wb32(&s, ++mux->sequence);
+	box_end(&s, mfhd);
+
+	for (size_t i = 0; i < mux->num_tracks; i++) {
+		struct mp4_track *track = &mux->tracks[i];
+		if (!track->samples.num)
+			continue;
+
+		write_traf(track, &s, track == mux->primary ? next_dts : -1,
+			   &data_offset_pos[i]);
+		traf_number[i] = ++traf_count;
+	}
+	box_end(&s, moof);
+
+	/* sample data of each track follows the previous one in the mdat */
+	uint64_t data_offset = out.bytes.num + mdat_header;
+	for (size_t i = 0; i < mux->num_tracks; i++) {
+		struct mp4_track *track = &mux->tracks[i];
+		if (!track->samples.num)
+			continue;
+
+		put_be32(out.bytes.array + data_offset_pos[i],
+			 (uint32_t)data_offset);
+		data_offset += track->data.num;
+	}
+
+	if (large_mdat) {
+		s_wb32(&s, 1);
+		s_write(&s, "mdat", 4);
+		s_wb64(&s, data_size + 16);
+	} else {
+		s_wb32(&s, (uint32_t)(data_size + 8));
+		s_write(&s, "mdat", 4);
+	}
+
+	const int64_t moof_offset = os_ftelli64(mux->file);
+
+	success = write_output(mux->file, &out);
+	for (size_t i = 0; success && i < mux->num_tracks; i++) {
+		struct mp4_track *track = &mux->tracks[i];
+		success = fwrite(track->data.array, 1, track->data.num,
+				 mux->file) == track->data.num;
+	}
+
+	array_output_serializer_free(&out);
+
+	if (!success || fflush(mux->file) != 0) {
+		warn("Failed to write fragment %" PRIu32, mux->sequence);
+		return false;
+	}
+
+	for (size_t i = 0; i < mux->num_tracks; i++) {
+		struct mp4_track *track = &mux->tracks[i];
+		if (!track->samples.num)
+			continue;
+
+		struct mp4_fragment_entry *entry =
+			da_push_back_new(track->index.entries);
+		entry->time = (uint64_t)track->samples.array[0].dts;
+		entry->moof_offset = (uint64_t)moof_offset;
+		entry->traf_number = traf_number[i];
+
+		da_resize(track->samples, 0);
+		da_resize(track->data, 0);
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* fragment index */
+
+static void write_tfra(struct serializer *s,
+		       const struct mp4_track_index *index)
+{
+	size_t tfra = fullbox_start(s, "tfra", 1, 0);
+	s_wb32(s, index->track_id);
+	s_wb32(s, 0); /* traf/trun/sample numbers are one byte each */
+	s_wb32(s, (uint32_t)index->entries.num);
+
+	for (size_t i = 0; i < index->entries.num; i++) {
+		const struct mp4_fragment_entry *entry =
+			&index->entries.array[i];
+
+		s_wb64(s, entry->time);
+		s_wb64(s, entry->moof_offset);
+		s_w8(s, entry->traf_number);
+		s_w8(s, 1);
+		s_w8(s, 1);
+	}
+	box_end(s, tfra);
+}
+
+static void write_mfra_end(struct serializer *s, size_t mfra)
+{
+	size_t mfro = fullbox_start(s, "mfro", 0, 0);
+	s_wb32(s, (uint32_t)(serializer_get_pos(s) + 4 - mfra));
+	box_end(s, mfro);
+	box_end(s, mfra);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool init_track(struct mp4_mux *mux, struct mp4_track *track,
+		       obs_encoder_t *encoder)
+{
+	const char *codec = obs_encoder_get_codec(encoder);
+
+	if (strcmp(codec, "h264") == 0) {
+		track->codec = MP4_CODEC_H264;
+#ifdef ENABLE_HEVC
+	} else if (strcmp(codec, "hevc") == 0) {
+		track->codec = MP4_CODEC_HEVC;
+#endif
+	} else if (strcmp(codec, "aac") == 0) {
+		track->codec = MP4_CODEC_AAC;
+	} else {
+		warn("Unsupported codec '%s'", codec);
+		return false;
+	}
+
+	track->encoder = encoder;
+	track->index.track_id = (uint32_t)mux->num_tracks + 1;
+
+	if (is_video(track)) {
+		video_t *video = obs_encoder_video(encoder);
+		const struct video_output_info *voi =
+			video_output_get_info(video);
+
+		track->timescale = voi->fps_num;
+		track->default_duration =
+			voi->fps_den * obs_encoder_get_frame_rate_divisor(
+					       encoder);
+	} else {
+		track->timescale = obs_encoder_get_sample_rate(encoder);
+		track->default_duration =
+			(uint32_t)obs_encoder_get_frame_size(encoder);
+	}
+
+	return track->timescale != 0;
+}
+
+struct mp4_mux *mp4_mux_create(obs_output_t *output, FILE *file,
+			       uint32_t fragment_ms)
+{
+	struct mp4_mux *mux = bzalloc(sizeof(struct mp4_mux));
+	obs_encoder_t *encoder;
+
+	mux->output = output;
+	mux->file = file;
+	mux->fragment_ms = fragment_ms ? fragment_ms : MP4_DEFAULT_FRAGMENT_MS;
+
+	encoder = obs_output_get_video_encoder(output);
+	if (encoder) {
+		mux->video = &mux->tracks[mux->num_tracks];
+		if (!init_track(mux, mux->video, encoder))
+			goto fail;
+		mux->num_tracks++;
+	}
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		encoder = obs_output_get_audio_encoder(output, i);
+		if (!encoder)
+			break;
+
+		mux->audio[i] = &mux->tracks[mux->num_tracks];
+		if (!init_track(mux, mux->audio[i], encoder))
+			goto fail;
+		mux->num_tracks++;
+	}
+
+	if (!mux->num_tracks)
+		goto fail;
+
+	mux->primary = mux->video ? mux->video : mux->audio[0];
+	return mux;
+
+fail:
+	mp4_mux_destroy(mux);
+	return NULL;
+}
+
+void mp4_mux_destroy(struct mp4_mux *mux)
+{
+	if (!mux)
+		return;
+
+	for (size_t i = 0; i < MAX_TRACKS; i++) {
+		struct mp4_track *track = &mux->tracks[i];
+		da_free(track->samples);
+		da_free(track->data);
+		da_free(track->index.entries);
+	}
+
+	bfree(mux);
+}
+
+static inline int64_t to_track_time(const struct mp4_track *track,
+				    const struct encoder_packet *packet,
+				    int64_t val)
+{
+	return val * packet->timebase_num * (int64_t)track->timescale /
+	       packet->timebase_den;
+}
+
+static void append_sample_data(struct mp4_track *track,
+			       struct encoder_packet *packet)
+{
+	struct encoder_packet parsed;
+
+	/* annex b start codes become the length prefixes mp4 expects */
+	switch (track->codec) {
+	case MP4_CODEC_H264:
+		obs_parse_avc_packet(&parsed, packet);
+		break;
+	case MP4_CODEC_HEVC:
+#ifdef ENABLE_HEVC
+		obs_parse_hevc_packet(&parsed, packet);
+		break;
+#else
+		return;
+#endif
+	case MP4_CODEC_AAC:
+		da_push_back_array(track->data, packet->data, packet->size);
+		return;
+	}
+
+	da_push_back_array(track->data, parsed.data, parsed.size);
+	obs_encoder_packet_release(&parsed);
+}
+
+bool mp4_mux_add_packet(struct mp4_mux *mux, struct encoder_packet *packet)
+{
+	struct mp4_track *track = NULL;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (packet->track_idx == 0)
+			track = mux->video;
+	} else if (packet->track_idx < MAX_OUTPUT_AUDIO_ENCODERS) {
+		track = mux->audio[packet->track_idx];
+	}
+
+	if (!track || !packet->size)
+		return true;
+
+	/* every audio packet is a sync sample */
+	const bool keyframe = is_video(track) ? packet->keyframe : true;
+
+	if (!mux->started) {
+		/* the file starts on the first keyframe of the primary track,
+		 * anything earlier has nothing to play against */
+		if (track != mux->primary || !keyframe)
+			return true;
+
+		/* other tracks line up with the first presented frame, which
+		 * the edit list moves to zero */
+		mux->start_usec = packet->dts_usec +
+				  (packet->pts - packet->dts) * 1000000 *
+					  packet->timebase_num /
+					  packet->timebase_den;
+		mux->started = true;
+	}
+
+	const int64_t dts = to_track_time(track, packet, packet->dts);
+	const int64_t pts = to_track_time(track, packet, packet->pts);
+
+	if (!track->got_first) {
+		int64_t offset_usec = packet->dts_usec - mux->start_usec;
+
+		track->first_dts = dts;
+		track->start_offset =
+			offset_usec > 0 ? offset_usec * track->timescale /
+						  1000000
+					: 0;
+		track->first_cts_offset = (int32_t)(pts - dts);
+		track->got_first = true;
+	}
+
+	const int64_t decode_time =
+		dts - track->first_dts + track->start_offset;
+
+	if (track == mux->primary && keyframe && track->samples.num) {
+		const int64_t duration = decode_time -
+					 track->samples.array[0].dts;
+		const int64_t fragment = (int64_t)mux->fragment_ms *
+					 track->timescale / 1000;
+
+		if (duration >= fragment && !flush_fragment(mux, decode_time))
+			return false;
+	}
+
+	struct mp4_sample *sample = da_push_back_new(track->samples);
+	sample->offset = track->data.num;
+	sample->dts = decode_time;
+	sample->cts_offset = (int32_t)(pts - dts);
+	sample->keyframe = keyframe;
+
+	append_sample_data(track, packet);
+	sample->size = (uint32_t)(track->data.num - sample->offset);
+
+	return true;
+}
+
+bool mp4_mux_finalize(struct mp4_mux *mux)
+{
+	struct array_output_data out;
+	struct serializer s;
+	bool success;
+
+	if (!flush_fragment(mux, -1))
+		return false;
+	if (!mux->wrote_init)
+		return true;
+
+	array_output_serializer_init(&s, &out);
+
+	size_t mfra = box_start(&s, "mfra");
+	for (size_t i = 0; i < mux->num_tracks; i++)
+		write_tfra(&s, &mux->tracks[i].index);
+	write_mfra_end(&s, mfra);
+
+	success = write_output(mux->file, &out);
+	array_output_serializer_free(&out);
+
+	if (!success)
+		warn("Failed to write the fragment index");
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* crash repair */
+
+struct repair_entry {
+	uint32_t track_id;
+	struct mp4_fragment_entry entry;
+};
+
+typedef DARRAY(struct repair_entry) repair_entries_t;
+typedef DARRAY(struct mp4_track_index) repair_indexes_t;
+
+static void parse_traf(const uint8_t *data, size_t size, uint64_t moof_offset,
+		       uint8_t traf_number, repair_entries_t *pending)
+{
+	struct repair_entry entry = {0};
+	bool got_track = false;
+	bool got_time = false;
+
+	entry.entry.moof_offset = moof_offset;
+	entry.entry.traf_number = traf_number;
+
+	while (size >= 8) {
+		size_t box_size = get_be32(data);
+		if (box_size < 8 || box_size > size)
+			return;
+
+		if (memcmp(data + 4, "tfhd", 4) == 0 && box_size >= 16) {
+			entry.track_id = get_be32(data + 12);
+			got_track = true;
+
+		} else if (memcmp(data + 4, "tfdt", 4) == 0 && box_size >= 16) {
+			if (data[8] == 1 && box_size >= 20)
+				entry.entry.time = get_be64(data + 12);
+			else
+				entry.entry.time = get_be32(data + 12);
+			got_time = true;
+		}
+
+		data += box_size;
+		size -= box_size;
+	}
+
+	if (got_track && got_time)
+		da_push_back(*pending, &entry);
+}
+
+static void parse_moof(const uint8_t *data, size_t size, uint64_t moof_offset,
+		       repair_entries_t *pending)
+{
+	uint8_t traf_number = 0;
+
+	while (size >= 8) {
+		size_t box_size = get_be32(data);
+		if (box_size < 8 || box_size > size)
+			return;
+
+		if (memcmp(data + 4, "traf", 4) == 0)
+			parse_traf(data + 8, box_size - 8, moof_offset,
+				   ++traf_number, pending);
+
+		data += box_size;
+		size -= box_size;
+	}
+}
+
+static void commit_entries(repair_indexes_t *indexes,
+			   repair_entries_t *pending)
+{
+	for (size_t i = 0; i < pending->num; i++) {
+		struct repair_entry *entry = &pending->array[i];
+		struct mp4_track_index *index = NULL;
+
+		for (size_t j = 0; j < indexes->num; j++) {
+			if (indexes->array[j].track_id == entry->track_id) {
+				index = &indexes->array[j];
+				break;
+			}
+		}
+
+		if (!index) {
+			index = da_push_back_new(*indexes);
+			index->track_id = entry->track_id;
+		}
+
+		da_push_back(index->entries, &entry->entry);
+	}
+
+	da_resize(*pending, 0);
+}
+
+/* covers a trailing partial fragment with a free box so that readers skip
+ * it, and returns where the index can be appended */
+static bool cover_partial_data(FILE *file, int64_t cut, int64_t file_size,
+			       int64_t *end)
+{
+	const int64_t remaining = file_size - cut;
+	struct array_output_data out;
+	struct serializer s;
+	bool success;
+
+	array_output_serializer_init(&s, &out);
+
+	if (remaining > UINT32_MAX) {
+		s_wb32(&s, 1);
+		s_write(&s, "free", 4);
+		s_wb64(&s, (uint64_t)remaining);
+		*end = file_size;
+	} else if (remaining >= 8) {
+		s_wb32(&s, (uint32_t)remaining);
+		s_write(&s, "free", 4);
+		*end = file_size;
+	} else {
+		s_wb32(&s, 8);
+		s_write(&s, "free", 4);
+		*end = cut + 8;
+	}
+
+	success = os_fseeki64(file, cut, SEEK_SET) == 0 &&
+		  write_output(file, &out);
+
+	array_output_serializer_free(&out);
+	return success;
+}
+
+bool mp4_mux_repair_index(const char *path)
+{
+	repair_indexes_t indexes = {0};
+	repair_entries_t pending = {0};
+	DARRAY(uint8_t) moof = {0};
+	struct array_output_data out;
+	struct serializer s;
+	bool found_moov = false;
+	bool indexed = false;
+	bool success = false;
+	int64_t file_size;
+	int64_t pos = 0;
+	int64_t end = 0;
+
+	FILE *file = os_fopen(path, "r+b");
+	if (!file) {
+		blog(LOG_WARNING, "mp4_mux_repair_index: Could not open '%s'",
+		     path);
+		return false;
+	}
+
+	os_fseeki64(file, 0, SEEK_END);
+	file_size = os_ftelli64(file);
+
+	/* walk the top level boxes, reading nothing but box headers and the
+	 * (small) moof boxes.  a fragment only counts once its mdat is
+	 * complete */
+	while (pos + 8 <= file_size) {
+		uint8_t header[16];
+		uint64_t box_size;
+		size_t header_size = 8;
+
+		if (os_fseeki64(file, pos, SEEK_SET) != 0 ||
+		    fread(header, 1, 8, file) != 8)
+			break;
+
+		box_size = get_be32(header);
+		if (box_size == 1) {
+			if (fread(header + 8, 1, 8, file) != 8)
+				break;
+			box_size = get_be64(header + 8);
+			header_size = 16;
+		} else if (box_size == 0) {
+			box_size = (uint64_t)(file_size - pos);
+		}
+
+		if (box_size < header_size ||
+		    box_size > (uint64_t)(file_size - pos))
+			break;
+
+		if (memcmp(header + 4, "mfra", 4) == 0) {
+			indexed = true;
+			break;
+		}
+
+		if (memcmp(header + 4, "moof", 4) == 0) {
+			size_t body_size = (size_t)box_size - header_size;
+			if (box_size > MAX_REPAIR_MOOF_SIZE)
+				break;
+
+			da_resize(moof, body_size);
+			if (fread(moof.array, 1, body_size, file) != body_size)
+				break;
+
+			da_resize(pending, 0);
+			parse_moof(moof.array, body_size, (uint64_t)pos,
+				   &pending);
+		} else {
+			if (memcmp(header + 4, "moov", 4) == 0)
+				found_moov = true;
+			else if (memcmp(header + 4, "mdat", 4) == 0)
+				commit_entries(&indexes, &pending);
+
+			end = pos + (int64_t)box_size;
+		}
+
+		pos += (int64_t)box_size;
+	}
+
+	if (indexed) {
+		blog(LOG_INFO, "mp4_mux_repair_index: '%s' already has a "
+			       "fragment index",
+		     path);
+		success = true;
+		goto done;
+	}
+
+	if (!found_moov) {
+		blog(LOG_WARNING, "mp4_mux_repair_index: '%s' has no moov box",
+		     path);
+		goto done;
+	}
+
+	if (end < file_size) {
+		if (!cover_partial_data(file, end, file_size, &end))
+			goto done;
+	}
+
+	array_output_serializer_init(&s, &out);
+
+	size_t mfra = box_start(&s, "mfra");
+	for (size_t i = 0; i < indexes.num; i++)
+		write_tfra(&s, &indexes.array[i]);
+	write_mfra_end(&s, mfra);
+
+	success = os_fseeki64(file, end, SEEK_SET) == 0 &&
+		  write_output(file, &out);
+
+	array_output_serializer_free(&out);
+
+	blog(success ? LOG_INFO : LOG_WARNING,
+	     "mp4_mux_repair_index: %s fragment index of '%s'",
+	     success ? "Rebuilt" : "Failed to rebuild", path);
+
+done:
+	for (size_t i = 0; i < indexes.num; i++)
+		da_free(indexes.array[i].entries);
+	da_free(indexes);
+	da_free(pending);
+	da_free(moof);
+	fclose(file);
+	return success;
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+#include <obs.h>
+
+/*
+ * Fragmented MP4 writer
+ *
+ *   Writes an init segment (ftyp + moov without samples) followed by
+ * moof/mdat fragments that each start on a video keyframe.  Every fragment
+ * is flushed to disk once written, so a file cut short by a crash still
+ * plays up to its last complete fragment.  A clean finish appends a fragment
+ * index (mfra) for fast seeking; mp4_mux_repair_index rebuilds that index for
+ * files that never got one.
+ */
+
+struct mp4_mux;
+
+#define MP4_DEFAULT_FRAGMENT_MS 2000
+
+extern struct mp4_mux *mp4_mux_create(obs_output_t *output, FILE *file,
+				      uint32_t fragment_ms);
+extern void mp4_mux_destroy(struct mp4_mux *mux);
+
+extern bool mp4_mux_add_packet(struct mp4_mux *mux,
+			       struct encoder_packet *packet);
+extern bool mp4_mux_finalize(struct mp4_mux *mux);
+
+extern bool mp4_mux_repair_index(const char *path);
@@ -0,0 +1,231 @@
+/******************************************************************************
+    Copyright (C) 2023 by Lain Bailey <lain@obsproject.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdio.h>
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include "mp4-mux.h"
+
+#define do_log(level, format, ...)                \
+	blog(level, "[mp4 output: '%s'] " format, \
+	     obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+struct mp4_output {
+	obs_output_t *output;
+	struct dstr path;
+	FILE *file;
+	struct mp4_mux *mux;
+	volatile bool active;
+	volatile bool stopping;
+	uint64_t stop_ts;
+
+	pthread_mutex_t mutex;
+};
+
+static inline bool stopping(struct mp4_output *stream)
+{
+	return os_atomic_load_bool(&stream->stopping);
+}
+
+static inline bool active(struct mp4_output *stream)
+{
+	return os_atomic_load_bool(&stream->active);
+}
+
+static const char *mp4_output_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("MP4Output");
+}
+
+static void mp4_output_destroy(void *data)
+{
+	struct mp4_output *stream = data;
+
+	pthread_mutex_destroy(&stream->mutex);
+	dstr_free(&stream->path);
+	bfree(stream);
+}
+
+static void repair_index_proc(void *data, calldata_t *cd)
+{
+	const char *path = calldata_string(cd, "path");
+	bool success = path && *path && mp4_mux_repair_index(path);
+
+	calldata_set_bool(cd, "success", success);
+	UNUSED_PARAMETER(data);
+}
+
+static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct mp4_output *stream = bzalloc(sizeof(struct mp4_output));
+	stream->output = output;
+	pthread_mutex_init(&stream->mutex, NULL);
+
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void repair_index(in string path, out bool success)",
+			 repair_index_proc, stream);
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+}
+
+static bool mp4_output_start(void *data)
+{
+	struct mp4_output *stream = data;
+	obs_data_t *settings;
+	uint32_t fragment_ms;
+	const char *path;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	os_atomic_set_bool(&stream->stopping, false);
+
+	/* get path */
+	settings = obs_output_get_settings(stream->output);
+	path = obs_data_get_string(settings, "path");
+	fragment_ms = (uint32_t)obs_data_get_int(settings, "fragment_ms");
+	dstr_copy(&stream->path, path);
+	obs_data_release(settings);
+
+	stream->file = os_fopen(stream->path.array, "wb");
+	if (!stream->file) {
+		warn("Unable to open MP4 file '%s'", stream->path.array);
+		return false;
+	}
+
+	stream->mux = mp4_mux_create(stream->output, stream->file, fragment_ms);
+	if (!stream->mux) {
+		fclose(stream->file);
+		stream->file = NULL;
+		return false;
+	}
+
+	os_atomic_set_bool(&stream->active, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+	info("Writing MP4 file '%s'...", stream->path.array);
+	return true;
+}
+
+static void mp4_output_stop(void *data, uint64_t ts)
+{
+	struct mp4_output *stream = data;
+	stream->stop_ts = ts / 1000;
+	os_atomic_set_bool(&stream->stopping, true);
+}
+
+static void mp4_output_actual_stop(struct mp4_output *stream, int code)
+{
+	os_atomic_set_bool(&stream->active, false);
+
+	if (stream->mux) {
+		if (!code && !mp4_mux_finalize(stream->mux))
+			code = OBS_OUTPUT_ERROR;
+
+		mp4_mux_destroy(stream->mux);
+		stream->mux = NULL;
+	}
+	if (stream->file) {
+		fclose(stream->file);
+		stream->file = NULL;
+	}
+	if (code) {
+		obs_output_signal_stop(stream->output, code);
+	} else {
+		obs_output_end_data_capture(stream->output);
+	}
+
+	info("MP4 file output complete");
+}
+
+static void mp4_output_data(void *data, struct encoder_packet *packet)
+{
+	struct mp4_output *stream = data;
+
+	pthread_mutex_lock(&stream->mutex);
+
+	if (!active(stream))
+		goto unlock;
+
+	if (!packet) {
+		mp4_output_actual_stop(stream, OBS_OUTPUT_ENCODE_ERROR);
+		goto unlock;
+	}
+
+	if (stopping(stream)) {
+		if (packet->sys_dts_usec >= (int64_t)stream->stop_ts) {
+			mp4_output_actual_stop(stream, 0);
+			goto unlock;
+		}
+	}
+
+	if (!mp4_mux_add_packet(stream->mux, packet))
+		mp4_output_actual_stop(stream, OBS_OUTPUT_ERROR);
+
+unlock:
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+static void mp4_output_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "fragment_ms",
+				 MP4_DEFAULT_FRAGMENT_MS);
+}
+
+static obs_properties_t *mp4_output_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_text(props, "path",
+				obs_module_text("MP4Output.FilePath"),
+				OBS_TEXT_DEFAULT);
+	obs_properties_add_int(props, "fragment_ms",
+			       obs_module_text("MP4Output.FragmentDuration"),
+			       250, 60000, 250);
+	return props;
+}
+
+struct obs_output_info mp4_output_info = {
+	.id = "mp4_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK,
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc",
+#else
+	.encoded_video_codecs = "h264",
+#endif
+	.encoded_audio_codecs = "aac",
+	.get_name = mp4_output_getname,
+	.create = mp4_output_create,
+	.destroy = mp4_output_destroy,
+	.start = mp4_output_start,
+	.stop = mp4_output_stop,
+	.encoded_packet = mp4_output_data,
+	.get_defaults = mp4_output_defaults,
+	.get_properties = mp4_output_properties,
+};
@@ -0,0 +1,411 @@
+#ifndef _WIN32
+#include "rtmp-stream.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+	defined(__NetBSD__) || defined(__DragonFly__)
+#include <sys/event.h>
+#define USE_KQUEUE
+#else
+#include <poll.h>
+#endif
+
+/* how long to block before checking for incoming data or a closed
+ * connection while there is nothing to send */
+#define POLL_INTERVAL_MS 50
+
+enum sock_event {
+	SOCK_EVENT_READ = 1 << 0,
+	SOCK_EVENT_WRITE = 1 << 1,
+	SOCK_EVENT_CLOSE = 1 << 2,
+};
+
+struct sock_poller {
+	int fd;
+	int sock;
+	bool want_write;
+};
+
+static bool poller_init(struct sock_poller *poller, int sock)
+{
+	poller->sock = sock;
+	poller->want_write = false;
+
+#if defined(USE_EPOLL)
+	struct epoll_event ev = {0};
+
+	poller->fd = epoll_create1(EPOLL_CLOEXEC);
+	if (poller->fd == -1)
+		return false;
+
+	ev.events = EPOLLIN | EPOLLRDHUP;
+	ev.data.fd = sock;
+	if (epoll_ctl(poller->fd, EPOLL_CTL_ADD, sock, &ev) == -1) {
+		close(poller->fd);
+		poller->fd = -1;
+		return false;
+	}
+#elif defined(USE_KQUEUE)
+	struct kevent ev[2];
+
+	poller->fd = kqueue();
+	if (poller->fd == -1)
+		return false;
+
+	EV_SET(&ev[0], sock, EVFILT_READ, EV_ADD, 0, 0, NULL);
+	EV_SET(&ev[1], sock, EVFILT_WRITE, EV_ADD | EV_DISABLE, 0, 0, NULL);
+	if (kevent(poller->fd, ev, 2, NULL, 0, NULL) == -1) {
+		close(poller->fd);
+		poller->fd = -1;
+		return false;
+	}
+#else
+	poller->fd = -1;
+#endif
+	return true;
+}
+
+static void poller_free(struct sock_poller *poller)
+{
+	if (poller->fd != -1)
+		close(poller->fd);
+	poller->fd = -1;
+}
+
+/* writability is only watched while the kernel send buffer is full,
+ * otherwise a level-triggered wait would never block */
+static bool poller_set_write(struct sock_poller *poller, bool want_write)
+{
+	if (poller->want_write == want_write)
+		return true;
+
+#if defined(USE_EPOLL)
+	struct epoll_event ev = {0};
+	ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+	ev.data.fd = poller->sock;
+	if (epoll_ctl(poller->fd, EPOLL_CTL_MOD, poller->sock, &ev) == -1)
+		return false;
+#elif defined(USE_KQUEUE)
+	struct kevent ev;
+	EV_SET(&ev, poller->sock, EVFILT_WRITE,
+	       want_write ? EV_ENABLE : EV_DISABLE, 0, 0, NULL);
+	if (kevent(poller->fd, &ev, 1, NULL, 0, NULL) == -1)
+		return false;
+#endif
+
+	poller->want_write = want_write;
+	return true;
+}
+
+/* returns a mask of sock_event values, or -1 on failure */
+static int poller_wait(struct sock_poller *poller, int timeout_ms)
+{
+	int events = 0;
+
+#if defined(USE_EPOLL)
+	struct epoll_event ev[2];
+	int count = epoll_wait(poller->fd, ev, 2, timeout_ms);
+	if (count == -1)
+		return errno == EINTR ? 0 : -1;
+
+	for (int i = 0; i < count; i++) {
+		if (ev[i].events & EPOLLIN)
+			events |= SOCK_EVENT_READ;
+		if (ev[i].events & EPOLLOUT)
+			events |= SOCK_EVENT_WRITE;
+		if (ev[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+			events |= SOCK_EVENT_CLOSE;
+	}
+#elif defined(USE_KQUEUE)
+	struct kevent ev[2];
+	struct timespec timeout = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (long)(timeout_ms % 1000) * 1000000,
+	};
+	int count = kevent(poller->fd, NULL, 0, ev, 2, &timeout);
+	if (count == -1)
+		return errno == EINTR ? 0 : -1;
+
+	for (int i = 0; i < count; i++) {
+		if (ev[i].flags & (EV_ERROR | EV_EOF))
+			events |= SOCK_EVENT_CLOSE;
+		else if (ev[i].filter == EVFILT_READ)
+			events |= SOCK_EVENT_READ;
+		else if (ev[i].filter == EVFILT_WRITE)
+			events |= SOCK_EVENT_WRITE;
+	}
+#else
+	struct pollfd pfd = {
+		.fd = poller->sock,
+		.events = POLLIN | (poller->want_write ? POLLOUT : 0),
+	};
+	int count = poll(&pfd, 1, timeout_ms);
+	if (count == -1)
+		return errno == EINTR ? 0 : -1;
+
+	if (pfd.revents & POLLIN)
+		events |= SOCK_EVENT_READ;
+	if (pfd.revents & POLLOUT)
+		events |= SOCK_EVENT_WRITE;
+	if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+		events |= SOCK_EVENT_CLOSE;
+#endif
+
+	return events;
+}
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+static int get_socket_error(struct rtmp_stream *stream)
+{
+	int err_code = 0;
+	socklen_t size = sizeof(err_code);
+
+	if (getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR,
+		       &err_code, &size) != 0)
+		err_code = errno;
+	return err_code;
+}
+
+static bool socket_closed(struct rtmp_stream *stream, uint64_t last_send_time)
+{
+	int err_code = get_socket_error(stream);
+
+	if (last_send_time) {
+		uint32_t diff = (os_gettime_ns() / 1000000) - last_send_time;
+
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Connection closed, "
+		     "%u ms since last send (buffer: %zu / %zu)",
+		     diff, stream->write_buf_len, stream->write_buf_size);
+	}
+
+	if (os_event_try(stream->stop_event) != EAGAIN)
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Aborting due to connection "
+		     "close during shutdown, %zu bytes lost, error %d",
+		     stream->write_buf_len, err_code);
+	else
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Aborting due to connection "
+		     "close, error %d",
+		     err_code);
+
+	stream->rtmp.last_error_code = err_code;
+	fatal_sock_shutdown(stream);
+	return false;
+}
+
+static bool discard_recv_data(struct rtmp_stream *stream)
+{
+	char discard[16384];
+
+	for (;;) {
+		ssize_t ret = recv(stream->rtmp.m_sb.sb_socket, discard,
+				   sizeof(discard), 0);
+		if (ret > 0)
+			continue;
+
+		int err_code = ret == 0 ? 0 : errno;
+		if (ret == -1 && (err_code == EAGAIN ||
+				  err_code == EWOULDBLOCK || err_code == EINTR))
+			return true;
+
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Socket error, recv() returned "
+		     "%zd, errno %d",
+		     ret, err_code);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+}
+
+enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write,
+				uint64_t *last_send_time,
+				size_t latency_packet_size, int delay_time)
+{
+	bool exit_loop = false;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	size_t send_len = stream->write_buf_len;
+	if (stream->low_latency_mode && latency_packet_size < send_len)
+		send_len = latency_packet_size;
+
+	int ret = RTMPSockBuf_Send(&stream->rtmp.m_sb,
+				   (const char *)stream->write_buf,
+				   (int)send_len);
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf, stream->write_buf + ret,
+				stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+
+		*last_send_time = os_gettime_ns() / 1000000;
+
+		os_event_signal(stream->buffer_space_available_event);
+	} else {
+		int err_code = ret == 0 ? 0 : errno;
+
+		if (ret == -1 && (err_code == EAGAIN ||
+				  err_code == EWOULDBLOCK || err_code == EINTR)) {
+			*can_write = err_code == EINTR;
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return err_code == EINTR ? RET_CONTINUE : RET_BREAK;
+		}
+
+		/* connection closed, or connection was aborted /
+		 * socket closed / etc, that's a fatal error. */
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Socket error, send() returned "
+		     "%d, errno %d",
+		     ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	/* finish writing for now */
+	if (stream->write_buf_len <= 1000)
+		exit_loop = true;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return exit_loop ? RET_BREAK : RET_CONTINUE;
+}
+
+static inline bool write_buf_empty(struct rtmp_stream *stream)
+{
+	pthread_mutex_lock(&stream->write_buf_mutex);
+	bool empty = stream->write_buf_len == 0;
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+	return empty;
+}
+
+#define LATENCY_FACTOR 20
+
+static inline void socket_thread_posix_internal(struct rtmp_stream *stream)
+{
+	struct sock_poller poller;
+	bool can_write = true;
+
+	int delay_time;
+	size_t latency_packet_size;
+	uint64_t last_send_time = 0;
+
+	if (!poller_init(&poller, stream->rtmp.m_sb.sb_socket)) {
+		blog(LOG_ERROR,
+		     "socket_thread_posix: Failed to create poller, "
+		     "errno %d",
+		     errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size =
+			stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	for (;;) {
+		bool empty = write_buf_empty(stream);
+
+		if (empty &&
+		    os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			os_event_reset(stream->send_thread_signaled_exit);
+			break;
+		}
+
+		/* while the socket can take more data the send thread is the
+		 * one that wakes us up, otherwise wait on the socket itself */
+		if (empty && can_write)
+			os_event_timedwait(stream->buffer_has_data_event,
+					   POLL_INTERVAL_MS);
+
+		if (!poller_set_write(&poller, !can_write)) {
+			blog(LOG_ERROR,
+			     "socket_thread_posix: Aborting due to poller "
+			     "failure, errno %d",
+			     errno);
+			fatal_sock_shutdown(stream);
+			break;
+		}
+
+		int events = poller_wait(&poller,
+					 can_write ? 0 : POLL_INTERVAL_MS);
+		if (events == -1) {
+			blog(LOG_ERROR,
+			     "socket_thread_posix: Aborting due to poller "
+			     "failure, errno %d",
+			     errno);
+			fatal_sock_shutdown(stream);
+			break;
+		}
+
+		if (events & SOCK_EVENT_READ) {
+			if (!discard_recv_data(stream))
+				break;
+		}
+		if (events & SOCK_EVENT_CLOSE) {
+			socket_closed(stream, last_send_time);
+			break;
+		}
+		if (events & SOCK_EVENT_WRITE)
+			can_write = true;
+
+		if (!can_write)
+			continue;
+
+		enum data_ret ret;
+		do {
+			ret = write_data(stream, &can_write, &last_send_time,
+					 latency_packet_size, delay_time);
+		} while (ret == RET_CONTINUE);
+
+		if (ret == RET_FATAL)
+			break;
+	}
+
+	poller_free(&poller);
+
+	if (stream->rtmp.m_sb.sb_socket != -1)
+		blog(LOG_INFO, "socket_thread_posix: Normal exit");
+}
+
+void *socket_thread_posix(void *data)
+{
+	struct rtmp_stream *stream = data;
+	os_set_thread_name("rtmp-stream: socket_thread");
+	socket_thread_posix_internal(stream);
+	return NULL;
+}
+#endif
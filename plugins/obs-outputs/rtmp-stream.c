@@ -21,9 +21,18 @@
 
 #include <obs-avc.h>
 #include <obs-hevc.h>
+#include <obs-packet-drop.h>
 
 #ifdef _WIN32
 #include <util/windows/win-version.h>
+#include <mstcpip.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#ifdef __linux__
+#include <linux/sockios.h>
 #endif
 
 #ifndef SEC_TO_NSEC
@@ -98,6 +107,13 @@ static inline bool disconnected(struct rtmp_stream *stream)
 	return os_atomic_load_bool(&stream->disconnected);
 }
 
+static inline void free_gop_packets(struct rtmp_stream *stream)
+{
+	for (size_t i = 0; i < stream->gop_packets.num; i++)
+		obs_encoder_packet_release(&stream->gop_packets.array[i]);
+	stream->gop_packets.num = 0;
+}
+
 static void rtmp_stream_destroy(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -121,6 +137,12 @@ static void rtmp_stream_destroy(void *data)
 
 	RTMP_TLS_Free(&stream->rtmp);
 	free_packets(stream);
+	free_gop_packets(stream);
+	da_free(stream->gop_packets);
+	dstr_free(&stream->primary_url);
+	dstr_free(&stream->backup_url);
+	os_event_destroy(stream->standby_stop_event);
+	pthread_mutex_destroy(&stream->standby_mutex);
 	dstr_free(&stream->path);
 	dstr_free(&stream->key);
 	dstr_free(&stream->username);
@@ -135,6 +157,7 @@ static void rtmp_stream_destroy(void *data)
 	deque_free(&stream->droptest_info);
 #endif
 	deque_free(&stream->dbr_frames);
+	congestion_control_destroy(stream->dbr_model);
 	pthread_mutex_destroy(&stream->dbr_mutex);
 
 	os_event_destroy(stream->buffer_space_available_event);
@@ -153,6 +176,7 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+	pthread_mutex_init_value(&stream->standby_mutex);
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_LogSetLevel(RTMP_LOGWARNING);
@@ -172,6 +196,16 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	if (pthread_mutex_init(&stream->standby_mutex, NULL) != 0) {
+		warn("Failed to initialize standby mutex");
+		goto fail;
+	}
+	if (os_event_init(&stream->standby_stop_event, OS_EVENT_TYPE_MANUAL) !=
+	    0) {
+		warn("Failed to initialize standby event");
+		goto fail;
+	}
+
 	if (os_event_init(&stream->buffer_space_available_event,
 			  OS_EVENT_TYPE_AUTO) != 0) {
 		warn("Failed to initialize write buffer event");
@@ -405,12 +439,30 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
+/* sends the tag head followed by the packet data as a single RTMP message,
+ * the packet data is sent straight from the encoder packet */
+static int write_packet_data(struct rtmp_stream *stream,
+			     struct encoder_packet *packet,
+			     const uint8_t *head, size_t head_size,
+			     size_t *size)
+{
+	*size = head_size + packet->size;
+
+#ifdef TEST_FRAMEDROPS
+	droptest_cap_data_rate(stream, *size);
+#endif
+
+	return RTMP_WriteV(&stream->rtmp, (const char *)head, (int)head_size,
+			   (const char *)packet->data, (int)packet->size, 0);
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		       struct encoder_packet *packet, bool is_header,
 		       size_t idx)
 {
+	uint8_t head[FLV_PACKET_HEAD_MAX];
 	uint8_t *data;
-	size_t size;
+	size_t size = 0;
 	int ret = 0;
 
 	assert(idx < RTMP_MAX_STREAMS);
@@ -421,17 +473,19 @@ static int send_packet(struct rtmp_stream *stream,
 		flv_additional_packet_mux(
 			packet, is_header ? 0 : stream->start_dts_offset, &data,
 			&size, is_header, idx);
-	} else {
-		flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
-			       &data, &size, is_header);
-	}
 
 #ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
+		droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+		ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+		bfree(data);
+	} else if (packet->data && packet->size) {
+		size_t head_size = flv_packet_mux_head(
+			packet, is_header ? 0 : stream->start_dts_offset, head,
+			is_header);
+		ret = write_packet_data(stream, packet, head, head_size, &size);
+	}
 
 	if (is_header)
 		bfree(packet->data);
@@ -446,6 +500,7 @@ static int send_packet_ex(struct rtmp_stream *stream,
 			  struct encoder_packet *packet, bool is_header,
 			  bool is_footer, size_t idx)
 {
+	uint8_t head[FLV_PACKET_HEAD_MAX];
 	uint8_t *data;
 	size_t size = 0;
 	int ret = 0;
@@ -453,23 +508,26 @@ static int send_packet_ex(struct rtmp_stream *stream,
 	if (handle_socket_read(stream))
 		return -1;
 
-	if (is_header) {
-		flv_packet_start(packet, stream->video_codec[idx], &data, &size,
-				 idx);
-	} else if (is_footer) {
-		flv_packet_end(packet, stream->video_codec[idx], &data, &size,
-			       idx);
-	} else {
-		flv_packet_frames(packet, stream->video_codec[idx],
-				  stream->start_dts_offset, &data, &size, idx);
-	}
+	if (is_header || is_footer) {
+		if (is_header)
+			flv_packet_start(packet, stream->video_codec[idx],
+					 &data, &size, idx);
+		else
+			flv_packet_end(packet, stream->video_codec[idx], &data,
+				       &size, idx);
 
 #ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
+		droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+		ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+		bfree(data);
+	} else {
+		size_t head_size = flv_packet_frames_head(
+			packet, stream->video_codec[idx],
+			stream->start_dts_offset, head, idx);
+		ret = write_packet_data(stream, packet, head, head_size, &size);
+	}
 
 	if (is_header || is_footer) // manually created packets
 		bfree(packet->data);
@@ -613,6 +671,7 @@ static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
 }
 
 static void dbr_set_bitrate(struct rtmp_stream *stream);
+static void dbr_model_update(struct rtmp_stream *stream);
 
 #ifdef _WIN32
 #define socklen_t int
@@ -629,15 +688,149 @@ static void log_sndbuf_size(struct rtmp_stream *stream)
 	}
 }
 
+static int send_stream_packet(struct rtmp_stream *stream,
+			      struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO &&
+	    (stream->video_codec[packet->track_idx] != CODEC_H264 ||
+	     (stream->video_codec[packet->track_idx] == CODEC_H264 &&
+	      packet->track_idx != 0))) {
+		return send_packet_ex(stream, packet, false, false,
+				      packet->track_idx);
+	} else {
+		return send_packet(stream, packet, false, packet->track_idx);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* warm standby                                                              */
+
+static bool send_meta_data(struct rtmp_stream *stream);
+static bool send_additional_meta_data(struct rtmp_stream *stream);
+static void start_standby(struct rtmp_stream *stream);
+
+static void free_standby(struct rtmp_standby *standby)
+{
+	if (!standby)
+		return;
+
+	RTMP_Close(&standby->rtmp);
+	RTMP_TLS_Free(&standby->rtmp);
+	dstr_free(&standby->url);
+	bfree(standby);
+}
+
+static void stop_standby(struct rtmp_stream *stream)
+{
+	if (stream->standby_thread_active) {
+		os_event_signal(stream->standby_stop_event);
+		pthread_join(stream->standby_thread, NULL);
+		stream->standby_thread_active = false;
+	}
+
+	pthread_mutex_lock(&stream->standby_mutex);
+	free_standby(stream->standby);
+	stream->standby = NULL;
+	pthread_mutex_unlock(&stream->standby_mutex);
+
+	free_gop_packets(stream);
+}
+
+/* everything sent since the last keyframe is kept so a standby connection
+ * can pick up without waiting for the next one */
+static void cache_gop_packet(struct rtmp_stream *stream,
+			     struct encoder_packet *packet)
+{
+	struct encoder_packet ref;
+
+	if (packet->type == OBS_ENCODER_VIDEO && packet->track_idx == 0 &&
+	    packet->keyframe)
+		free_gop_packets(stream);
+
+	obs_encoder_packet_ref(&ref, packet);
+	da_push_back(stream->gop_packets, &ref);
+}
+
+/* RTMPSockBuf::sb_start points into the struct itself */
+static void move_rtmp(RTMP *dst, RTMP *src)
+{
+	char *start = src->m_sb.sb_start;
+
+	*dst = *src;
+	if (start)
+		dst->m_sb.sb_start =
+			dst->m_sb.sb_buf + (start - src->m_sb.sb_buf);
+	memset(src, 0, sizeof(*src));
+}
+
+static bool switch_to_standby(struct rtmp_stream *stream)
+{
+	struct rtmp_standby *standby;
+
+	if (!stream->standby_enabled || stopping(stream))
+		return false;
+
+	pthread_mutex_lock(&stream->standby_mutex);
+	standby = stream->standby;
+	stream->standby = NULL;
+	if (standby) {
+		struct dstr url = stream->path;
+
+		RTMP_Close(&stream->rtmp);
+		RTMP_TLS_Free(&stream->rtmp);
+		move_rtmp(&stream->rtmp, &standby->rtmp);
+
+		stream->path = standby->url;
+		standby->url = url;
+	}
+	pthread_mutex_unlock(&stream->standby_mutex);
+
+	if (!standby)
+		return false;
+
+	free_standby(standby);
+
+	warn("Sending failed, switching to the standby connection to %s",
+	     stream->path.array);
+
+	if (!RTMP_ConnectStream(&stream->rtmp, 0)) {
+		warn("Standby connection could not start publishing");
+		return false;
+	}
+
+	if (!send_meta_data(stream))
+		return false;
+	if (obs_output_get_audio_encoder(stream->output, 1) &&
+	    !send_additional_meta_data(stream))
+		return false;
+
+	stream->sent_headers = false;
+	if (!send_headers(stream))
+		return false;
+
+	for (size_t i = 0; i < stream->gop_packets.num; i++) {
+		struct encoder_packet packet;
+
+		obs_encoder_packet_ref(&packet, &stream->gop_packets.array[i]);
+		if (send_stream_packet(stream, &packet) < 0)
+			return false;
+	}
+
+	info("Switched to standby connection, resent %zu packets from the "
+	     "last keyframe",
+	     stream->gop_packets.num);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
 
 	os_set_thread_name("rtmp-stream: send_thread");
 
-#if defined(_WIN32)
 	log_sndbuf_size(stream);
-#endif
 
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
@@ -658,7 +851,9 @@ static void *send_thread(void *data)
 		}
 
 		if (!stream->sent_headers) {
-			if (!send_headers(stream)) {
+			if (!send_headers(stream) &&
+			    !switch_to_standby(stream)) {
+				obs_encoder_packet_release(&packet);
 				os_atomic_set_bool(&stream->disconnected, true);
 				break;
 			}
@@ -669,19 +864,12 @@ static void *send_thread(void *data)
 			dbr_frame.size = packet.size;
 		}
 
-		int sent;
-		if (packet.type == OBS_ENCODER_VIDEO &&
-		    (stream->video_codec[packet.track_idx] != CODEC_H264 ||
-		     (stream->video_codec[packet.track_idx] == CODEC_H264 &&
-		      packet.track_idx != 0))) {
-			sent = send_packet_ex(stream, &packet, false, false,
-					      packet.track_idx);
-		} else {
-			sent = send_packet(stream, &packet, false,
-					   packet.track_idx);
-		}
+		if (stream->standby_enabled)
+			cache_gop_packet(stream, &packet);
 
-		if (sent < 0) {
+		/* the packet is already part of what the standby replays */
+		int sent = send_stream_packet(stream, &packet);
+		if (sent < 0 && !switch_to_standby(stream)) {
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
@@ -692,9 +880,14 @@ static void *send_thread(void *data)
 			pthread_mutex_lock(&stream->dbr_mutex);
 			dbr_add_frame(stream, &dbr_frame);
 			pthread_mutex_unlock(&stream->dbr_mutex);
+
+			if (stream->dbr_model)
+				dbr_model_update(stream);
 		}
 	}
 
+	stop_standby(stream);
+
 	bool encode_error = os_atomic_load_bool(&stream->encode_error);
 
 	if (disconnected(stream)) {
@@ -707,9 +900,7 @@ static void *send_thread(void *data)
 		send_footers(stream); // Y2023 spec
 	}
 
-#if defined(_WIN32)
 	log_sndbuf_size(stream);
-#endif
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
@@ -1012,8 +1203,12 @@ static int init_send(struct rtmp_stream *stream)
 
 	reset_semaphore(stream);
 
+	if (stream->standby_enabled)
+		start_standby(stream);
+
 	ret = pthread_create(&stream->send_thread, NULL, send_thread, stream);
 	if (ret != 0) {
+		stop_standby(stream);
 		RTMP_Close(&stream->rtmp);
 		warn("Failed to create send thread");
 		return OBS_OUTPUT_ERROR;
@@ -1089,12 +1284,13 @@ static int init_send(struct rtmp_stream *stream)
 		stream->write_buf_size = ideal_buffer_size;
 		stream->write_buf = bmalloc(ideal_buffer_size);
 
-#ifndef _WIN32
-		warn("New socket loop not supported on this platform");
-		return OBS_OUTPUT_ERROR;
-#else
+#ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL,
 				     socket_thread_windows, stream);
+#else
+		ret = pthread_create(&stream->socket_thread, NULL,
+				     socket_thread_posix, stream);
+#endif
 
 		if (ret != 0) {
 			RTMP_Close(&stream->rtmp);
@@ -1106,7 +1302,6 @@ static int init_send(struct rtmp_stream *stream)
 		stream->rtmp.m_bCustomSend = true;
 		stream->rtmp.m_customSendFunc = socket_queue_data;
 		stream->rtmp.m_customSendParam = stream;
-#endif
 	}
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1211,56 +1406,63 @@ static void win32_log_interface_type(struct rtmp_stream *stream)
 }
 #endif
 
-static int try_connect(struct rtmp_stream *stream)
+static bool setup_rtmp(struct rtmp_stream *stream, RTMP *rtmp,
+		       struct dstr *url)
 {
-	if (dstr_is_empty(&stream->path)) {
-		warn("URL is empty");
-		return OBS_OUTPUT_BAD_PATH;
-	}
-
-	info("Connecting to RTMP URL %s...", stream->path.array);
-
 	// free any existing RTMP TLS context
-	RTMP_TLS_Free(&stream->rtmp);
+	RTMP_TLS_Free(rtmp);
 
-	RTMP_Init(&stream->rtmp);
+	RTMP_Init(rtmp);
 
-	if (!RTMP_SetupURL(&stream->rtmp, stream->path.array))
-		return OBS_OUTPUT_BAD_PATH;
-
-	RTMP_EnableWrite(&stream->rtmp);
+	if (!RTMP_SetupURL(rtmp, url->array))
+		return false;
 
-	dstr_copy(&stream->encoder_name, "FMLE/3.0 (compatible; FMSc/1.0)");
+	RTMP_EnableWrite(rtmp);
 
-	set_rtmp_dstr(&stream->rtmp.Link.pubUser, &stream->username);
-	set_rtmp_dstr(&stream->rtmp.Link.pubPasswd, &stream->password);
-	set_rtmp_dstr(&stream->rtmp.Link.flashVer, &stream->encoder_name);
-	stream->rtmp.Link.swfUrl = stream->rtmp.Link.tcUrl;
+	set_rtmp_dstr(&rtmp->Link.pubUser, &stream->username);
+	set_rtmp_dstr(&rtmp->Link.pubPasswd, &stream->password);
+	set_rtmp_dstr(&rtmp->Link.flashVer, &stream->encoder_name);
+	rtmp->Link.swfUrl = rtmp->Link.tcUrl;
 
 	if (dstr_is_empty(&stream->bind_ip) ||
 	    dstr_cmp(&stream->bind_ip, "default") == 0) {
-		memset(&stream->rtmp.m_bindIP, 0,
-		       sizeof(stream->rtmp.m_bindIP));
+		memset(&rtmp->m_bindIP, 0, sizeof(rtmp->m_bindIP));
 	} else {
-		bool success = netif_str_to_addr(&stream->rtmp.m_bindIP.addr,
-						 &stream->rtmp.m_bindIP.addrLen,
+		bool success = netif_str_to_addr(&rtmp->m_bindIP.addr,
+						 &rtmp->m_bindIP.addrLen,
 						 stream->bind_ip.array);
-		if (success) {
-			int len = stream->rtmp.m_bindIP.addrLen;
+		if (success && rtmp == &stream->rtmp) {
+			int len = rtmp->m_bindIP.addrLen;
 			bool ipv6 = len == sizeof(struct sockaddr_in6);
 			info("Binding to IPv%d", ipv6 ? 6 : 4);
 		}
 	}
 
 	// Only use the IPv4 / IPv6 hint if a binding address isn't specified.
-	if (stream->rtmp.m_bindIP.addrLen == 0)
-		stream->rtmp.m_bindIP.addrLen = stream->addrlen_hint;
+	if (rtmp->m_bindIP.addrLen == 0)
+		rtmp->m_bindIP.addrLen = stream->addrlen_hint;
 
-	RTMP_AddStream(&stream->rtmp, stream->key.array);
+	RTMP_AddStream(rtmp, stream->key.array);
 
-	stream->rtmp.m_outChunkSize = 4096;
-	stream->rtmp.m_bSendChunkSizeInfo = true;
-	stream->rtmp.m_bUseNagle = true;
+	rtmp->m_outChunkSize = 4096;
+	rtmp->m_bSendChunkSizeInfo = true;
+	rtmp->m_bUseNagle = true;
+	return true;
+}
+
+static int try_connect(struct rtmp_stream *stream)
+{
+	if (dstr_is_empty(&stream->path)) {
+		warn("URL is empty");
+		return OBS_OUTPUT_BAD_PATH;
+	}
+
+	info("Connecting to RTMP URL %s...", stream->path.array);
+
+	dstr_copy(&stream->encoder_name, "FMLE/3.0 (compatible; FMSc/1.0)");
+
+	if (!setup_rtmp(stream, &stream->rtmp, &stream->path))
+		return OBS_OUTPUT_BAD_PATH;
 
 #ifdef _WIN32
 	win32_log_interface_type(stream);
@@ -1283,6 +1485,89 @@ static int try_connect(struct rtmp_stream *stream)
 	return init_send(stream);
 }
 
+/* ------------------------------------------------------------------------- */
+/* warm standby connection                                                   */
+
+#define STANDBY_REFRESH_MS 30000
+#define STANDBY_RETRY_MS 5000
+
+/* the standby is connected but not published, RTMP_Connect goes through
+ * every resolved address so the standby also covers the other IP family */
+static struct rtmp_standby *connect_standby(struct rtmp_stream *stream,
+					    const char *url)
+{
+	struct rtmp_standby *standby = bzalloc(sizeof(*standby));
+
+	dstr_copy(&standby->url, url);
+
+	if (!setup_rtmp(stream, &standby->rtmp, &standby->url) ||
+	    !RTMP_Connect(&standby->rtmp, NULL)) {
+		free_standby(standby);
+		return NULL;
+	}
+
+	standby->connect_ts = os_gettime_ns();
+	return standby;
+}
+
+static void *standby_thread(void *data)
+{
+	struct rtmp_stream *stream = data;
+	uint32_t wait_ms = 0;
+
+	os_set_thread_name("rtmp-stream: standby_thread");
+
+	while (os_event_timedwait(stream->standby_stop_event, wait_ms) ==
+	       ETIMEDOUT) {
+		struct rtmp_standby *standby;
+		struct rtmp_standby *old;
+		struct dstr url = {0};
+
+		/* keep the standby on whichever server isn't in use */
+		pthread_mutex_lock(&stream->standby_mutex);
+		if (dstr_cmp(&stream->path, stream->backup_url.array) == 0)
+			dstr_copy_dstr(&url, &stream->primary_url);
+		else
+			dstr_copy_dstr(&url, &stream->backup_url);
+		pthread_mutex_unlock(&stream->standby_mutex);
+
+		standby = connect_standby(stream, url.array);
+		if (!standby)
+			warn("Failed to connect standby to %s", url.array);
+		dstr_free(&url);
+
+		if (!standby) {
+			wait_ms = STANDBY_RETRY_MS;
+			continue;
+		}
+
+		/* servers drop idle connections, so a fresh one replaces the
+		 * old one before the old one is closed */
+		pthread_mutex_lock(&stream->standby_mutex);
+		old = stream->standby;
+		stream->standby = standby;
+		pthread_mutex_unlock(&stream->standby_mutex);
+
+		free_standby(old);
+		wait_ms = STANDBY_REFRESH_MS;
+	}
+
+	return NULL;
+}
+
+static void start_standby(struct rtmp_stream *stream)
+{
+	os_event_reset(stream->standby_stop_event);
+
+	if (pthread_create(&stream->standby_thread, NULL, standby_thread,
+			   stream) != 0) {
+		warn("Failed to create standby thread");
+		return;
+	}
+
+	stream->standby_thread_active = true;
+}
+
 static bool init_connect(struct rtmp_stream *stream)
 {
 	obs_service_t *service;
@@ -1308,6 +1593,7 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->total_bytes_sent = 0;
 	stream->dropped_frames = 0;
 	stream->min_priority = 0;
+	stream->drop_hold_dts_usec = 0;
 	stream->got_first_video = false;
 
 	settings = obs_output_get_settings(stream->output);
@@ -1354,6 +1640,10 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->dbr_inc_timeout = 0;
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
 
+	congestion_control_destroy(stream->dbr_model);
+	stream->dbr_model = NULL;
+	stream->dbr_model_ts = 0;
+
 	caps = obs_encoder_get_caps(venc);
 	if ((caps & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
 		stream->dbr_enabled = false;
@@ -1365,8 +1655,21 @@ static bool init_connect(struct rtmp_stream *stream)
 		stream->dbr_enabled = false;
 	}
 
+	if (stream->dbr_enabled &&
+	    obs_data_get_bool(settings, OPT_DYN_BITRATE_MODEL)) {
+		struct congestion_control_config config = {
+			.max_kbps = (uint32_t)stream->dbr_orig_bitrate,
+			.min_kbps = (uint32_t)(stream->dbr_orig_bitrate / 10),
+			.overhead_kbps = (uint32_t)stream->audio_bitrate,
+		};
+		stream->dbr_model = congestion_control_create(
+			&congestion_control_model, &config);
+	}
+
 	if (stream->dbr_enabled) {
 		info("Dynamic bitrate enabled.  Dropped frames begone!");
+		if (stream->dbr_model)
+			info("Using model based bitrate control");
 	}
 
 	obs_data_release(vsettings);
@@ -1393,7 +1696,6 @@ static bool init_connect(struct rtmp_stream *stream)
 		stream->addrlen_hint = len;
 	}
 
-#ifdef _WIN32
 	stream->new_socket_loop =
 		obs_data_get_bool(settings, OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode =
@@ -1405,10 +1707,21 @@ static bool init_connect(struct rtmp_stream *stream)
 		warn("Disabling network optimizations, not compatible with RTMPS");
 		stream->new_socket_loop = false;
 	}
-#else
-	stream->new_socket_loop = false;
-	stream->low_latency_mode = false;
-#endif
+
+	stream->standby_enabled =
+		obs_data_get_bool(settings, OPT_STANDBY_ENABLED);
+	dstr_copy_dstr(&stream->primary_url, &stream->path);
+	dstr_copy(&stream->backup_url,
+		  obs_data_get_string(settings, OPT_STANDBY_URL));
+	dstr_depad(&stream->backup_url);
+	if (dstr_is_empty(&stream->backup_url))
+		dstr_copy_dstr(&stream->backup_url, &stream->path);
+
+	if (stream->standby_enabled && stream->new_socket_loop) {
+		warn("Disabling standby connection, not compatible with "
+		     "network optimizations");
+		stream->standby_enabled = false;
+	}
 
 	obs_data_release(settings);
 	return true;
@@ -1485,69 +1798,39 @@ static inline size_t num_buffered_packets(struct rtmp_stream *stream)
 	return stream->packets.size / sizeof(struct encoder_packet);
 }
 
-static void drop_frames(struct rtmp_stream *stream, const char *name,
-			int highest_priority, bool pframes)
+static void drop_frames(struct rtmp_stream *stream,
+			int64_t buffer_duration_usec)
 {
-	UNUSED_PARAMETER(pframes);
-
-	struct deque new_buf = {0};
-	int num_frames_dropped = 0;
+	bool pframes = buffer_duration_usec >
+		       stream->pframe_drop_threshold_usec;
+	size_t num_frames_dropped;
 
 #ifdef _DEBUG
 	int start_packets = (int)num_buffered_packets(stream);
-#else
-	UNUSED_PARAMETER(name);
 #endif
 
-	deque_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		deque_pop_front(&stream->packets, &packet, sizeof(packet));
+	/* drain back to half the threshold rather than to just below it, so
+	 * that a slightly slow connection does not drop frames constantly */
+	num_frames_dropped = obs_packet_queue_drop(
+		&stream->packets, buffer_duration_usec,
+		stream->drop_threshold_usec / 2, pframes,
+		&stream->min_priority);
 
-		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority >= highest_priority) {
-			deque_push_back(&new_buf, &packet, sizeof(packet));
+	/* the buffered duration does not shrink until the packets that were
+	 * queued before the drop have been sent, so wait for that */
+	stream->drop_hold_dts_usec = stream->last_dts_usec;
 
-		} else {
-			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
-		}
-	}
-
-	deque_free(&stream->packets);
-	stream->packets = new_buf;
-
-	if (stream->min_priority < highest_priority)
-		stream->min_priority = highest_priority;
 	if (!num_frames_dropped)
 		return;
 
-	stream->dropped_frames += num_frames_dropped;
+	stream->dropped_frames += (int)num_frames_dropped;
 #ifdef _DEBUG
-	debug("Dropped %s, prev packet count: %d, new packet count: %d", name,
+	debug("Dropped %d %s, prev packet count: %d, new packet count: %d",
+	      (int)num_frames_dropped, pframes ? "p-frames" : "b-frames",
 	      start_packets, (int)num_buffered_packets(stream));
 #endif
 }
 
-static bool find_first_video_packet(struct rtmp_stream *stream,
-				    struct encoder_packet *first)
-{
-	size_t count = stream->packets.size / sizeof(*first);
-
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur =
-			deque_data(&stream->packets, i * sizeof(*first));
-		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
-			*first = *cur;
-			return true;
-		}
-	}
-
-	return false;
-}
-
 static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 {
 	long prev_bitrate = stream->dbr_prev_bitrate;
@@ -1622,6 +1905,107 @@ static void dbr_set_bitrate(struct rtmp_stream *stream)
 	obs_data_release(settings);
 }
 
+#if defined(_WIN32) && defined(SIO_TCP_INFO)
+static void get_socket_stats(struct rtmp_stream *stream, uint32_t *rtt_us,
+			     uint64_t *unsent)
+{
+	DWORD version = 0;
+	TCP_INFO_v0 tcp_info;
+	DWORD bytes;
+
+	if (WSAIoctl(stream->rtmp.m_sb.sb_socket, SIO_TCP_INFO, &version,
+		     sizeof(version), &tcp_info, sizeof(tcp_info), &bytes, NULL,
+		     NULL) == 0) {
+		*rtt_us = tcp_info.RttUs;
+		*unsent = tcp_info.BytesInFlight;
+	}
+}
+#elif defined(__linux__)
+static void get_socket_stats(struct rtmp_stream *stream, uint32_t *rtt_us,
+			     uint64_t *unsent)
+{
+	int fd = stream->rtmp.m_sb.sb_socket;
+	struct tcp_info tcp_info;
+	socklen_t len = sizeof(tcp_info);
+	int outq;
+
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &tcp_info, &len) == 0)
+		*rtt_us = tcp_info.tcpi_rtt;
+	if (ioctl(fd, SIOCOUTQ, &outq) == 0 && outq > 0)
+		*unsent = (uint64_t)outq;
+}
+#elif defined(__APPLE__)
+static void get_socket_stats(struct rtmp_stream *stream, uint32_t *rtt_us,
+			     uint64_t *unsent)
+{
+	int fd = stream->rtmp.m_sb.sb_socket;
+	struct tcp_connection_info tcp_info;
+	socklen_t len = sizeof(tcp_info);
+	int nwrite;
+
+	if (getsockopt(fd, IPPROTO_TCP, TCP_CONNECTION_INFO, &tcp_info,
+		       &len) == 0)
+		*rtt_us = tcp_info.tcpi_srtt * 1000;
+
+	len = sizeof(nwrite);
+	if (getsockopt(fd, SOL_SOCKET, SO_NWRITE, &nwrite, &len) == 0 &&
+	    nwrite > 0)
+		*unsent = (uint64_t)nwrite;
+}
+#else
+static void get_socket_stats(struct rtmp_stream *stream, uint32_t *rtt_us,
+			     uint64_t *unsent)
+{
+	UNUSED_PARAMETER(stream);
+	UNUSED_PARAMETER(rtt_us);
+	UNUSED_PARAMETER(unsent);
+}
+#endif
+
+#define DBR_MODEL_INTERVAL_NS 100000000ULL
+
+static void dbr_model_update(struct rtmp_stream *stream)
+{
+	struct congestion_sample sample = {0};
+	struct encoder_packet first;
+	uint64_t ts = os_gettime_ns();
+	uint64_t unsent = 0;
+	uint32_t kbps;
+
+	if (ts - stream->dbr_model_ts < DBR_MODEL_INTERVAL_NS)
+		return;
+	stream->dbr_model_ts = ts;
+
+	get_socket_stats(stream, &sample.rtt_us, &unsent);
+
+	if (stream->new_socket_loop) {
+		pthread_mutex_lock(&stream->write_buf_mutex);
+		unsent += stream->write_buf_len;
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+	}
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	if (find_first_video_packet(stream, &first) &&
+	    stream->last_dts_usec > first.dts_usec)
+		sample.queue_delay_us =
+			(uint64_t)(stream->last_dts_usec - first.dts_usec);
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	sample.bytes_in_flight = unsent;
+	sample.bytes_delivered = stream->total_bytes_sent > unsent
+					 ? stream->total_bytes_sent - unsent
+					 : 0;
+
+	if (!congestion_control_update(stream->dbr_model, ts, &sample, &kbps))
+		return;
+
+	stream->dbr_cur_bitrate = (long)kbps;
+	dbr_set_bitrate(stream);
+	info("bitrate changed to: %ld (rtt %u ms, queue %" PRIu64 " ms)",
+	     stream->dbr_cur_bitrate, sample.rtt_us / 1000,
+	     sample.queue_delay_us / 1000);
+}
+
 static void dbr_inc_bitrate(struct rtmp_stream *stream)
 {
 	stream->dbr_prev_bitrate = stream->dbr_cur_bitrate;
@@ -1638,18 +2022,14 @@ static void dbr_inc_bitrate(struct rtmp_stream *stream)
 	}
 }
 
-static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
+static void check_to_drop_frames(struct rtmp_stream *stream)
 {
 	struct encoder_packet first;
 	int64_t buffer_duration_usec;
 	size_t num_packets = num_buffered_packets(stream);
-	const char *name = pframes ? "p-frames" : "b-frames";
-	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST
-			       : OBS_NAL_PRIORITY_HIGH;
-	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec
-					 : stream->drop_threshold_usec;
+	int64_t drop_threshold = stream->drop_threshold_usec;
 
-	if (!pframes && stream->dbr_enabled) {
+	if (stream->dbr_enabled && !stream->dbr_model) {
 		if (stream->dbr_inc_timeout) {
 			uint64_t t = os_gettime_ns();
 
@@ -1662,22 +2042,19 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	}
 
 	if (num_packets < 5) {
-		if (!pframes)
-			stream->congestion = 0.0f;
+		stream->congestion = 0.0f;
 		return;
 	}
 
-	if (!find_first_video_packet(stream, &first))
+	if (!obs_packet_queue_first_video(&stream->packets, &first))
 		return;
 
 	/* if the amount of time stored in the buffered packets waiting to be
 	 * sent is higher than threshold, drop frames */
 	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
 
-	if (!pframes) {
-		stream->congestion =
-			(float)buffer_duration_usec / (float)drop_threshold;
-	}
+	stream->congestion =
+		(float)buffer_duration_usec / (float)drop_threshold;
 
 	/* alternatively, drop only pframes:
 	 * (!pframes && stream->dbr_enabled)
@@ -1686,7 +2063,8 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	if (stream->dbr_enabled) {
 		bool bitrate_changed = false;
 
-		if (pframes) {
+		/* the model is updated from the send thread */
+		if (stream->dbr_model) {
 			return;
 		}
 
@@ -1704,17 +2082,19 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 		return;
 	}
 
-	if (buffer_duration_usec > drop_threshold) {
+	if (buffer_duration_usec > drop_threshold &&
+	    !obs_packet_queue_drop_held(first.dts_usec, stream->last_dts_usec,
+					stream->drop_hold_dts_usec,
+					drop_threshold)) {
 		debug("buffer_duration_usec: %" PRId64, buffer_duration_usec);
-		drop_frames(stream, name, priority, pframes);
+		drop_frames(stream, buffer_duration_usec);
 	}
 }
 
 static bool add_video_packet(struct rtmp_stream *stream,
 			     struct encoder_packet *packet)
 {
-	check_to_drop_frames(stream, false);
-	check_to_drop_frames(stream, true);
+	check_to_drop_frames(stream);
 
 	/* if currently dropping frames, drop packets until it reaches the
 	 * desired priority */
@@ -1798,10 +2178,10 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
-#ifdef _WIN32
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
-#endif
+	obs_data_set_default_bool(defaults, OPT_DYN_BITRATE_MODEL, false);
+	obs_data_set_default_bool(defaults, OPT_STANDBY_ENABLED, false);
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -1843,12 +2223,18 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	}
 	netif_saddr_data_free(&addrs);
 
-#ifdef _WIN32
 	obs_properties_add_bool(props, OPT_NEWSOCKETLOOP_ENABLED,
 				obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED,
 				obs_module_text("RTMPStream.LowLatencyMode"));
-#endif
+	obs_properties_add_bool(
+		props, OPT_DYN_BITRATE_MODEL,
+		obs_module_text("RTMPStream.DynamicBitrateModel"));
+	obs_properties_add_bool(props, OPT_STANDBY_ENABLED,
+				obs_module_text("RTMPStream.Standby"));
+	obs_properties_add_text(props, OPT_STANDBY_URL,
+				obs_module_text("RTMPStream.StandbyURL"),
+				OBS_TEXT_DEFAULT);
 
 	return props;
 }
@@ -1,8 +1,10 @@
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/darray.h>
 #include <util/deque.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/congestion-control.h>
 #include <inttypes.h>
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
@@ -24,6 +26,7 @@
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
 #define OPT_DYN_BITRATE "dyn_bitrate"
+#define OPT_DYN_BITRATE_MODEL "dyn_bitrate_model"
 #define OPT_DROP_THRESHOLD "drop_threshold_ms"
 #define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
@@ -32,6 +35,8 @@
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
 #define OPT_METADATA_MULTITRACK "metadata_multitrack"
+#define OPT_STANDBY_ENABLED "standby_enabled"
+#define OPT_STANDBY_URL "standby_url"
 
 //#define TEST_FRAMEDROPS
 //#define TEST_FRAMEDROPS_WITH_BITRATE_SHORTCUTS
@@ -53,6 +58,14 @@ struct dbr_frame {
 	size_t size;
 };
 
+/* a connected but not yet publishing connection, the RTMP link strings point
+ * into url */
+struct rtmp_standby {
+	RTMP rtmp;
+	struct dstr url;
+	uint64_t connect_ts;
+};
+
 struct rtmp_stream {
 	obs_output_t *output;
 
@@ -88,6 +101,7 @@ struct rtmp_stream {
 	int64_t drop_threshold_usec;
 	int64_t pframe_drop_threshold_usec;
 	int min_priority;
+	int64_t drop_hold_dts_usec;
 	float congestion;
 
 	int64_t last_dts_usec;
@@ -114,10 +128,24 @@ struct rtmp_stream {
 	long dbr_inc_bitrate;
 	bool dbr_enabled;
 
+	/* model based dynamic bitrate, replaces the steps above if set */
+	congestion_control_t *dbr_model;
+	uint64_t dbr_model_ts;
+
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
 
 	RTMP rtmp;
 
+	/* warm standby connection, switched to when sending fails */
+	bool standby_enabled;
+	struct dstr primary_url, backup_url;
+	pthread_mutex_t standby_mutex;
+	struct rtmp_standby *standby;
+	pthread_t standby_thread;
+	bool standby_thread_active;
+	os_event_t *standby_stop_event;
+	DARRAY(struct encoder_packet) gop_packets; /* sent since keyframe */
+
 	bool new_socket_loop;
 	bool low_latency_mode;
 	bool disable_send_window_optimization;
@@ -135,6 +163,8 @@ struct rtmp_stream {
 
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#else
+void *socket_thread_posix(void *data);
 #endif
 
 /* Adapted from FFmpeg's libavutil/pixfmt.h
@@ -70,6 +70,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 mfxHDL QSV_Encoder_Internal::g_GFX_Handle = NULL;
 mfxU16 QSV_Encoder_Internal::g_numEncodersOpen = 0;
+mfxSession QSV_Encoder_Internal::g_parentSession = NULL;
 
 QSV_Encoder_Internal::QSV_Encoder_Internal(mfxVersion &version,
 					   bool useTexAlloc)
@@ -84,6 +85,7 @@ QSV_Encoder_Internal::QSV_Encoder_Internal(mfxVersion &version,
 	  m_outBitstream(),
 	  m_bUseD3D11(false),
 	  m_bUseTexAlloc(useTexAlloc),
+	  m_bJoinedSession(false),
 	  m_sessionData(NULL),
 	  m_ver(version)
 {
@@ -152,6 +154,17 @@ mfxStatus QSV_Encoder_Internal::Open(qsv_param_t *pParams, enum qsv_codec codec)
 
 	MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
+	if (m_bUseD3D11 && g_parentSession && g_parentSession != m_session) {
+		mfxStatus join_sts = MFXJoinSession(g_parentSession, m_session);
+		m_bJoinedSession = join_sts == MFX_ERR_NONE;
+		if (m_bJoinedSession)
+			info("\tjoined session: %d open", g_numEncodersOpen);
+		else
+			warn("Failed to join session: %d", join_sts);
+	} else if (m_bUseD3D11) {
+		g_parentSession = m_session;
+	}
+
 	m_pmfxENC = new MFXVideoENCODE(m_session);
 
 	InitParams(pParams, codec);
@@ -918,9 +931,15 @@ mfxStatus QSV_Encoder_Internal::ClearData()
 		g_numEncodersOpen--;
 	}
 
+	if (m_bJoinedSession) {
+		MFXDisjoinSession(m_session);
+		m_bJoinedSession = false;
+	}
+
 	if ((m_bUseTexAlloc) && (g_numEncodersOpen <= 0)) {
 		Release();
 		g_GFX_Handle = NULL;
+		g_parentSession = NULL;
 	}
 	MFXVideoENCODE_Close(m_session);
 	ReleaseSessionData(m_sessionData);
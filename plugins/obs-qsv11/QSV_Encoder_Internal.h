@@ -131,9 +131,13 @@ private:
 	mfxBitstream m_outBitstream;
 	bool m_bUseD3D11;
 	bool m_bUseTexAlloc;
+	bool m_bJoinedSession;
 	static mfxU16 g_numEncodersOpen;
 	static mfxHDL
 		g_GFX_Handle; // we only want one handle for all instances to use;
+	// sessions of all encoders on the shared device are joined to the
+	// first one, so they share one scheduler instead of competing
+	static mfxSession g_parentSession;
 
 	mfxEncodeCtrl m_ctrl;
 	mfxExtEncoderROI m_roi;
@@ -125,7 +125,12 @@ static void stinger_update(void *data, obs_data_t *settings)
 
 		obs_data_t *tm_media_settings = obs_data_create();
 		obs_data_set_string(tm_media_settings, "local_file", tm_path);
+		obs_data_set_bool(tm_media_settings, "hw_decode", hw_decode);
 		obs_data_set_bool(tm_media_settings, "looping", false);
+		/* the matte has to stay in step with the stinger, so it is
+		 * preloaded along with it */
+		obs_data_set_bool(tm_media_settings, "full_decode", preload);
+		obs_data_set_bool(tm_media_settings, "is_stinger", true);
 
 		s->matte_source = obs_source_create_private(
 			"ffmpeg_source", NULL, tm_media_settings);
@@ -645,6 +650,11 @@ static void stinger_transition_stop(void *data)
 	calldata_t cd = {0};
 	proc_handler_call(ph, "preload_first_frame", &cd);
 
+	if (s->matte_source) {
+		ph = obs_source_get_proc_handler(s->matte_source);
+		proc_handler_call(ph, "preload_first_frame", &cd);
+	}
+
 	s->transitioning = false;
 }
 
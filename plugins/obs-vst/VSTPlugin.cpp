@@ -17,7 +17,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 
 #include "headers/VSTPlugin.h"
+#include "headers/VSTWorkerPool.h"
 #include <util/platform.h>
+#include <util/util_uint64.h>
 
 intptr_t VSTPlugin::hostCallback_static(AEffect *effect, int32_t opcode,
 					int32_t index, intptr_t value,
@@ -86,13 +88,18 @@ VSTPlugin::VSTPlugin(obs_source_t *sourceContext) : sourceContext{sourceContext}
 
 VSTPlugin::~VSTPlugin()
 {
+	VSTWorkerPool::get().cancel(this);
+
 	unloadEffect();
 
 	cleanupChannelBuffers();
+	freePipeline();
 }
 
 void VSTPlugin::createChannelBuffers(size_t count)
 {
+	std::lock_guard<std::recursive_mutex> lock(lockEffect);
+
 	cleanupChannelBuffers();
 
 	int blocksize = BLOCK_SIZE;
@@ -101,10 +108,9 @@ void VSTPlugin::createChannelBuffers(size_t count)
 	if (numChannels > 0) {
 		inputs = (float **)bmalloc(sizeof(float *) * numChannels);
 		outputs = (float **)bmalloc(sizeof(float *) * numChannels);
-		channelrefs = (float **)bmalloc(sizeof(float *) * numChannels);
 		for (size_t channel = 0; channel < numChannels; channel++) {
 			inputs[channel] =
-				(float *)bmalloc(sizeof(float) * blocksize);
+				(float *)bzalloc(sizeof(float) * blocksize);
 			outputs[channel] =
 				(float *)bmalloc(sizeof(float) * blocksize);
 		}
@@ -131,10 +137,6 @@ void VSTPlugin::cleanupChannelBuffers()
 		bfree(outputs);
 		outputs = NULL;
 	}
-	if (channelrefs) {
-		bfree(channelrefs);
-		channelrefs = NULL;
-	}
 	numChannels = 0;
 }
 
@@ -241,55 +243,169 @@ static void silenceChannel(float **channelData, size_t numChannels,
 	}
 }
 
+void VSTPlugin::resetPipeline(size_t latency)
+{
+	queuedChannels = (std::min)(numChannels, (size_t)MAX_AV_PLANES);
+	latencyFrames = latency;
+	pipelineGeneration++;
+
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		deque_pop_front(&inputQueue[c], nullptr, inputQueue[c].size);
+		deque_pop_front(&outputQueue[c], nullptr, outputQueue[c].size);
+
+		if (c < queuedChannels)
+			deque_push_back_zero(&outputQueue[c],
+					     latency * sizeof(float));
+	}
+}
+
+void VSTPlugin::freePipeline()
+{
+	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
+		deque_free(&inputQueue[c]);
+		deque_free(&outputQueue[c]);
+	}
+}
+
+static inline size_t alignToBlock(size_t frames)
+{
+	return (frames + BLOCK_SIZE - 1) & ~(size_t)(BLOCK_SIZE - 1);
+}
+
 obs_audio_data *VSTPlugin::process(struct obs_audio_data *audio)
 {
+	size_t frames = audio->frames;
+	bool scheduleWork;
+
 	// Here we check the status firstly,
 	// which help avoid waiting for lock while unloadEffect() is running.
 	bool effectValid = (effect && effectReady && numChannels > 0);
-	if (!effectValid)
+	if (!effectValid) {
+		std::lock_guard<std::mutex> lock(lockBuffers);
+		if (latencyFrames) {
+			resetPipeline(0);
+			obs_source_set_filter_latency(sourceContext, 0);
+		}
 		return audio;
+	}
 
-	std::lock_guard<std::recursive_mutex> lock(lockEffect);
+	{
+		std::lock_guard<std::mutex> lock(lockBuffers);
+
+		/* one block more than a packet, so the block that completes
+		 * with this packet has until the next one to be processed */
+		size_t channels =
+			(std::min)(numChannels, (size_t)MAX_AV_PLANES);
+		if (!latencyFrames || queuedChannels != channels) {
+			size_t packet =
+				(std::max)(frames, (size_t)AUDIO_OUTPUT_FRAMES);
+			resetPipeline(alignToBlock(packet) + BLOCK_SIZE);
+		}
+
+		for (size_t c = 0; c < queuedChannels; c++) {
+			if (audio->data[c])
+				deque_push_back(&inputQueue[c], audio->data[c],
+						frames * sizeof(float));
+			else
+				deque_push_back_zero(&inputQueue[c],
+						     frames * sizeof(float));
+		}
 
-	if (effect && effectReady && numChannels > 0) {
-		uint passes = (audio->frames + BLOCK_SIZE - 1) / BLOCK_SIZE;
-		uint extra = audio->frames % BLOCK_SIZE;
-		for (uint pass = 0; pass < passes; pass++) {
-			uint frames = pass == passes - 1 && extra ? extra
-								  : BLOCK_SIZE;
-			silenceChannel(outputs, numChannels, BLOCK_SIZE);
-
-			for (size_t d = 0; d < numChannels; d++) {
-				if (d < MAX_AV_PLANES &&
-				    audio->data[d] != nullptr) {
-					channelrefs[d] =
-						((float *)audio->data[d]) +
-						(pass * BLOCK_SIZE);
-				} else {
-					channelrefs[d] = inputs[d];
-				}
-			};
-
-			effect->processReplacing(effect, channelrefs, outputs,
-						 frames);
-
-			// only copy back the channels the plugin may have generated
-			for (size_t c = 0; c < (size_t)effect->numOutputs &&
-					   c < MAX_AV_PLANES;
-			     c++) {
-				if (audio->data[c]) {
-					for (size_t i = 0; i < frames; i++) {
-						channelrefs[c][i] =
-							outputs[c][i];
-					}
-				}
+		/* the workers fell behind: play silence in the gap and keep
+		 * the extra delay, unless that gets too long, in which case
+		 * start over */
+		size_t available = outputQueue[0].size / sizeof(float);
+		if (available < frames) {
+			size_t grow = alignToBlock(frames - available);
+
+			if (latencyFrames + grow <= MAX_LATENCY_FRAMES) {
+				latencyFrames += grow;
+				for (size_t c = 0; c < queuedChannels; c++)
+					deque_push_back_zero(
+						&outputQueue[c],
+						grow * sizeof(float));
+			} else {
+				blog(LOG_WARNING,
+				     "VST Plug-in '%s' can't keep up, "
+				     "resetting its latency",
+				     effectName);
+				resetPipeline(alignToBlock(frames) +
+					      BLOCK_SIZE);
 			}
 		}
+
+		for (size_t c = 0; c < queuedChannels; c++) {
+			if (audio->data[c])
+				deque_pop_front(&outputQueue[c], audio->data[c],
+						frames * sizeof(float));
+			else
+				deque_pop_front(&outputQueue[c], nullptr,
+						frames * sizeof(float));
+		}
+
+		scheduleWork = inputQueue[0].size >=
+			       BLOCK_SIZE * sizeof(float);
+
+		uint32_t sampleRate =
+			audio_output_get_sample_rate(obs_get_audio());
+		obs_source_set_filter_latency(
+			sourceContext,
+			util_mul_div64(latencyFrames, 1000000000ULL,
+				       sampleRate));
 	}
 
+	if (scheduleWork)
+		VSTWorkerPool::get().schedule(this);
+
 	return audio;
 }
 
+void VSTPlugin::processBlocks()
+{
+	std::lock_guard<std::recursive_mutex> lockEffectGuard(lockEffect);
+
+	for (;;) {
+		uint64_t generation;
+		size_t channels;
+
+		{
+			std::lock_guard<std::mutex> lock(lockBuffers);
+
+			channels = queuedChannels;
+			if (!channels ||
+			    inputQueue[0].size < BLOCK_SIZE * sizeof(float))
+				return;
+
+			for (size_t c = 0; c < channels; c++)
+				deque_pop_front(&inputQueue[c], inputs[c],
+						BLOCK_SIZE * sizeof(float));
+
+			generation = pipelineGeneration;
+		}
+
+		if (!effect || !effectReady || numChannels < channels)
+			return;
+
+		silenceChannel(outputs, numChannels, BLOCK_SIZE);
+		effect->processReplacing(effect, inputs, outputs, BLOCK_SIZE);
+
+		std::lock_guard<std::mutex> lock(lockBuffers);
+
+		/* the pipeline was reset while this block was processed */
+		if (generation != pipelineGeneration)
+			continue;
+
+		// only take the channels the plugin may have generated
+		for (size_t c = 0; c < channels; c++) {
+			float *data = c < (size_t)effect->numOutputs
+					      ? outputs[c]
+					      : inputs[c];
+			deque_push_back(&outputQueue[c], data,
+					BLOCK_SIZE * sizeof(float));
+		}
+	}
+}
+
 void VSTPlugin::unloadEffect()
 {
 	closeEditor();
@@ -0,0 +1,130 @@
+/*****************************************************************************
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/VSTWorkerPool.h"
+#include "headers/VSTPlugin.h"
+#include <util/threading.h>
+
+#include <algorithm>
+
+#define MAX_WORKER_THREADS 4
+
+VSTWorkerPool &VSTWorkerPool::get()
+{
+	static VSTWorkerPool pool;
+	return pool;
+}
+
+void VSTWorkerPool::workerThread()
+{
+	os_set_thread_name("vst: worker");
+
+	if (!os_set_thread_priority(OS_THREAD_PRIORITY_REALTIME))
+		os_set_thread_priority(OS_THREAD_PRIORITY_HIGH);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (;;) {
+		workReady.wait(lock,
+			       [this] { return stopping || !queue.empty(); });
+		if (stopping)
+			break;
+
+		VSTPlugin *plugin = queue.front();
+		queue.pop_front();
+		plugin->workQueued = false;
+		plugin->workRunning = true;
+
+		do {
+			plugin->workAgain = false;
+
+			lock.unlock();
+			plugin->processBlocks();
+			lock.lock();
+		} while (plugin->workAgain && !stopping);
+
+		plugin->workRunning = false;
+		workDone.notify_all();
+	}
+}
+
+void VSTWorkerPool::start()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!threads.empty())
+		return;
+
+	/* leave at least half of the cores to the rest of the program */
+	unsigned int count = std::thread::hardware_concurrency() / 2;
+	count = std::clamp(count, 1U, (unsigned int)MAX_WORKER_THREADS);
+
+	stopping = false;
+	for (unsigned int i = 0; i < count; i++)
+		threads.emplace_back(&VSTWorkerPool::workerThread, this);
+
+	blog(LOG_INFO, "VST Plug-in: Started %u worker thread(s)", count);
+}
+
+void VSTWorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	workReady.notify_all();
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	threads.clear();
+	queue.clear();
+}
+
+void VSTWorkerPool::schedule(VSTPlugin *plugin)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (threads.empty() || stopping) {
+		/* not running, so fall back to processing inline */
+		lock.unlock();
+		plugin->processBlocks();
+		return;
+	}
+
+	if (plugin->workRunning) {
+		plugin->workAgain = true;
+	} else if (!plugin->workQueued) {
+		plugin->workQueued = true;
+		queue.push_back(plugin);
+		workReady.notify_one();
+	}
+}
+
+void VSTWorkerPool::cancel(VSTPlugin *plugin)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto it = std::find(queue.begin(), queue.end(), plugin);
+	if (it != queue.end())
+		queue.erase(it);
+
+	plugin->workQueued = false;
+	plugin->workAgain = false;
+
+	workDone.wait(lock, [plugin] { return !plugin->workRunning; });
+}
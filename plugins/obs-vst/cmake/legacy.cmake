@@ -27,8 +27,16 @@ endif()
 
 target_include_directories(obs-vst PRIVATE ${CMAKE_CURRENT_SOURCE_DIR} ${CMAKE_CURRENT_BINARY_DIR})
 
-target_sources(obs-vst PRIVATE obs-vst.cpp VSTPlugin.cpp EditorWidget.cpp headers/vst-plugin-callbacks.hpp
-                               headers/EditorWidget.h headers/VSTPlugin.h)
+target_sources(
+  obs-vst
+  PRIVATE obs-vst.cpp
+          VSTPlugin.cpp
+          VSTWorkerPool.cpp
+          EditorWidget.cpp
+          headers/vst-plugin-callbacks.hpp
+          headers/EditorWidget.h
+          headers/VSTPlugin.h
+          headers/VSTWorkerPool.h)
 
 target_link_libraries(obs-vst PRIVATE OBS::libobs Qt::Widgets)
 
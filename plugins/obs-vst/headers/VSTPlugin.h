@@ -20,12 +20,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define OBS_STUDIO_VSTPLUGIN_H
 
 #define BLOCK_SIZE 512
+#define MAX_LATENCY_FRAMES (BLOCK_SIZE * 16)
+
+static_assert((BLOCK_SIZE & (BLOCK_SIZE - 1)) == 0,
+	      "BLOCK_SIZE must be a power of two");
 
 #include <mutex>
 #include <atomic>
 #include <string>
 #include <QDirIterator>
 #include <obs-module.h>
+#include <util/deque.h>
 #include "aeffectx.h"
 #include "vst-plugin-callbacks.hpp"
 #include "EditorWidget.h"
@@ -49,11 +54,30 @@ class VSTPlugin : public QObject {
 
 	float **inputs = nullptr;
 	float **outputs = nullptr;
-	float **channelrefs = nullptr;
 	size_t numChannels = 0;
 	void createChannelBuffers(size_t count);
 	void cleanupChannelBuffers();
 
+	/* Audio is queued here by the audio thread and processed in blocks of
+	BLOCK_SIZE frames by the worker pool, so a slow effect never holds up
+	the audio thread.  The output queue is primed with latencyFrames of
+	silence, which is reported to libobs as the filter latency. */
+	std::mutex lockBuffers;
+	struct deque inputQueue[MAX_AV_PLANES] = {};
+	struct deque outputQueue[MAX_AV_PLANES] = {};
+	size_t queuedChannels = 0;
+	size_t latencyFrames = 0;
+	uint64_t pipelineGeneration = 0;
+	void resetPipeline(size_t latency);
+	void freePipeline();
+
+	/* only used by VSTWorkerPool, with its mutex held */
+	friend class VSTWorkerPool;
+	bool workQueued = false;
+	bool workRunning = false;
+	bool workAgain = false;
+	void processBlocks();
+
 	EditorWidget *editorWidget = nullptr;
 	bool editorOpened = false;
 
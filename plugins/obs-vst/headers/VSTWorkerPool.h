@@ -0,0 +1,50 @@
+/*****************************************************************************
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class VSTPlugin;
+
+/* Threads shared by all VST filters that run the effects, so that a heavy
+ * effect delays only its own filter instead of the whole audio mix.  Each
+ * plugin is processed by at most one thread at a time. */
+class VSTWorkerPool {
+	std::mutex mutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	std::deque<VSTPlugin *> queue;
+	std::vector<std::thread> threads;
+	bool stopping = false;
+
+	void workerThread();
+
+public:
+	static VSTWorkerPool &get();
+
+	void start();
+	void stop();
+
+	/* called from the audio thread whenever a plugin has a full block */
+	void schedule(VSTPlugin *plugin);
+
+	/* removes a plugin from the queue and waits until no thread is
+	 * processing it anymore */
+	void cancel(VSTPlugin *plugin);
+};
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 
 #include "headers/VSTPlugin.h"
+#include "headers/VSTWorkerPool.h"
 #include <QCryptographicHash>
 
 #define OPEN_VST_SETTINGS "open_vst_settings"
@@ -391,5 +392,12 @@ bool obs_module_load(void)
 	vst_filter.save = vst_save;
 
 	obs_register_source(&vst_filter);
+
+	VSTWorkerPool::get().start();
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	VSTWorkerPool::get().stop();
+}
@@ -1,4 +1,5 @@
 #include "whip-output.h"
+#include "whip-pacer.h"
 #include "whip-utils.h"
 
 /*
@@ -8,6 +9,21 @@
  */
 static uint16_t MAX_VIDEO_FRAGMENT_SIZE = 1200;
 
+/*
+ * Video packets are paced at this multiple of the encoder bitrate, so that
+ * a keyframe takes a few frame intervals to go out instead of leaving in
+ * one burst.  Packets are never held back for longer than the max delay.
+ */
+static const double VIDEO_PACING_FACTOR = 2.5;
+static const uint64_t MAX_VIDEO_PACING_DELAY_NS = 100000000ULL;
+
+/*
+ * Number of sent video packets kept for retransmission.  This has to hold
+ * a whole keyframe at high bitrates, otherwise the packets lost in its
+ * burst are already gone by the time the NACKs arrive.
+ */
+static const size_t VIDEO_NACK_BUFFER_PACKETS = 4096;
+
 const int signaling_media_id_length = 16;
 const char signaling_media_id_valid_char[] = "0123456789"
 					     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -181,7 +197,18 @@ void WHIPOutput::ConfigureVideoTrack(std::string media_stream_id,
 
 	video_sr_reporter = std::make_shared<rtc::RtcpSrReporter>(rtp_config);
 	packetizer->addToChain(video_sr_reporter);
-	packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>());
+	packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>(
+		VIDEO_NACK_BUFFER_PACKETS));
+
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	int64_t bitrate_kbps = obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+	if (bitrate_kbps > 0) {
+		uint64_t rate = uint64_t(double(bitrate_kbps) * 1000.0 *
+					 VIDEO_PACING_FACTOR);
+		packetizer->addToChain(std::make_shared<WHIPPacer>(
+			rate, MAX_VIDEO_PACING_DELAY_NS));
+	}
 
 	video_track = peer_connection->addTrack(video_description);
 	video_track->setMediaHandler(packetizer);
@@ -562,9 +589,6 @@ void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration,
 	if (track == nullptr || !track->isOpen())
 		return;
 
-	std::vector<rtc::byte> sample{(rtc::byte *)data,
-				      (rtc::byte *)data + size};
-
 	auto rtp_config = rtcp_sr_reporter->rtpConfig;
 
 	// Sample time is in microseconds, we need to convert it to seconds
@@ -587,8 +611,8 @@ void WHIPOutput::Send(void *data, uintptr_t size, uint64_t duration,
 		rtcp_sr_reporter->setNeedsToReport();
 
 	try {
-		track->send(sample);
-		total_bytes_sent += sample.size();
+		track->send((const rtc::byte *)data, size);
+		total_bytes_sent += size;
 	} catch (const std::exception &e) {
 		do_log(LOG_ERROR, "error: %s ", e.what());
 	}
@@ -0,0 +1,130 @@
+#include "whip-pacer.h"
+
+#include <util/platform.h>
+
+#include <algorithm>
+#include <chrono>
+
+/* how often queued packets are released */
+#define PACER_INTERVAL_NS 2000000ULL
+
+/* bytes that can go out at once after the pacer was idle */
+#define MIN_BURST_BYTES (16 * 1024)
+
+WHIPPacer::WHIPPacer(uint64_t bits_per_second, uint64_t max_delay_ns)
+	: bytes_per_ns(double(bits_per_second) / 8.0 / 1000000000.0),
+	  max_budget(std::max(bytes_per_ns * double(PACER_INTERVAL_NS) * 4.0,
+			      double(MIN_BURST_BYTES))),
+	  max_delay_ns(max_delay_ns),
+	  mutex(),
+	  cv(),
+	  queue(),
+	  send_callback(),
+	  budget(max_budget),
+	  last_refill_ns(os_gettime_ns()),
+	  stopping(false),
+	  thread(&WHIPPacer::PacerThread, this)
+{
+}
+
+WHIPPacer::~WHIPPacer()
+{
+	{
+		std::lock_guard<std::mutex> l(mutex);
+		stopping = true;
+	}
+	cv.notify_one();
+	thread.join();
+}
+
+void WHIPPacer::Refill(uint64_t now)
+{
+	budget += double(now - last_refill_ns) * bytes_per_ns;
+	budget = std::min(budget, max_budget);
+	last_refill_ns = now;
+}
+
+void WHIPPacer::outgoing(rtc::message_vector &messages,
+			 const rtc::message_callback &send)
+{
+	std::lock_guard<std::mutex> l(mutex);
+	const uint64_t now = os_gettime_ns();
+	bool queued = false;
+
+	send_callback = send;
+	Refill(now);
+
+	/* anything that fits into the budget while nothing is waiting goes
+	 * straight through, the rest is queued in order */
+	rtc::message_vector kept;
+	kept.reserve(messages.size());
+
+	for (auto &message : messages) {
+		if (!message)
+			continue;
+
+		const bool control = message->type == rtc::Message::Control;
+		if (control ||
+		    (queue.empty() && budget >= double(message->size()))) {
+			if (!control)
+				budget -= double(message->size());
+			kept.push_back(std::move(message));
+		} else {
+			queue.push_back({std::move(message), now});
+			queued = true;
+		}
+	}
+
+	messages.swap(kept);
+
+	if (queued)
+		cv.notify_one();
+}
+
+void WHIPPacer::PacerThread()
+{
+	os_set_thread_name("whip-pacer");
+
+	std::unique_lock<std::mutex> l(mutex);
+
+	while (!stopping) {
+		if (queue.empty()) {
+			cv.wait(l,
+				[this] { return stopping || !queue.empty(); });
+			continue;
+		}
+
+		cv.wait_for(l, std::chrono::nanoseconds(PACER_INTERVAL_NS),
+			    [this] { return stopping; });
+		if (stopping)
+			break;
+
+		const uint64_t now = os_gettime_ns();
+		Refill(now);
+
+		rtc::message_callback send = send_callback;
+		std::vector<rtc::message_ptr> ready;
+
+		while (!queue.empty()) {
+			QueuedMessage &front = queue.front();
+			const double size = double(front.message->size());
+			const bool late = now - front.queued_ns >= max_delay_ns;
+
+			if (!late && budget < size)
+				break;
+
+			budget -= size;
+			ready.push_back(std::move(front.message));
+			queue.pop_front();
+		}
+
+		if (ready.empty() || !send)
+			continue;
+
+		/* never call into the transport with the lock held */
+		l.unlock();
+		for (auto &message : ready)
+			send(std::move(message));
+		l.lock();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <rtc/rtc.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/*
+ * Spreads the RTP packets of large frames (keyframes, mostly) out over
+ * time instead of handing them to the transport in a single burst that
+ * overruns the buffers along the path.  Packets leave at the pacing rate
+ * with a small burst allowance, but are never held back for longer than
+ * max_delay_ns.  Control messages are never delayed.
+ */
+class WHIPPacer final : public rtc::MediaHandler {
+public:
+	WHIPPacer(uint64_t bits_per_second, uint64_t max_delay_ns);
+	~WHIPPacer();
+
+	void outgoing(rtc::message_vector &messages,
+		      const rtc::message_callback &send) override;
+
+private:
+	struct QueuedMessage {
+		rtc::message_ptr message;
+		uint64_t queued_ns;
+	};
+
+	void Refill(uint64_t now);
+	void PacerThread();
+
+	const double bytes_per_ns;
+	const double max_budget;
+	const uint64_t max_delay_ns;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<QueuedMessage> queue;
+	rtc::message_callback send_callback;
+	double budget;
+	uint64_t last_refill_ns;
+	bool stopping;
+
+	std::thread thread;
+};
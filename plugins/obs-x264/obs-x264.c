@@ -756,6 +756,7 @@ static void parse_packet(struct obs_x264 *obsx264,
 	packet->pts = pic_out->i_pts;
 	packet->dts = pic_out->i_dts;
 	packet->keyframe = pic_out->b_keyframe != 0;
+	packet->qp = pic_out->i_qpplus1 > 0 ? pic_out->i_qpplus1 - 1 : 0;
 }
 
 static inline void init_pic_data(struct obs_x264 *obsx264, x264_picture_t *pic,
@@ -930,5 +931,6 @@ struct obs_encoder_info obs_x264_encoder = {
 	.get_extra_data = obs_x264_extra_data,
 	.get_sei_data = obs_x264_sei,
 	.get_video_info = obs_x264_video_info,
-	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI,
+	.caps = OBS_ENCODER_CAP_DYN_BITRATE | OBS_ENCODER_CAP_ROI |
+		OBS_ENCODER_CAP_ASYNC_ENCODE,
 };
@@ -0,0 +1,183 @@
+#include "text-file-watch.h"
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static void split_path(const char *path, struct dstr *dir, struct dstr *name)
+{
+	const char *slash;
+
+	dstr_copy(dir, path);
+	dstr_replace(dir, "\\", "/");
+
+	slash = strrchr(dir->array, '/');
+	if (!slash) {
+		dstr_copy(name, dir->array);
+		dstr_copy(dir, ".");
+		return;
+	}
+
+	dstr_copy(name, slash + 1);
+
+	/* keep the separator for root directories such as "/" or "C:/" */
+	size_t len = (size_t)(slash - dir->array);
+	if (len == 0 || slash[-1] == ':')
+		len++;
+	dstr_resize(dir, len);
+}
+
+#ifdef _WIN32
+bool text_file_watch_init(struct text_file_watch *watch, const char *path)
+{
+	struct dstr dir = {0};
+	struct dstr name = {0};
+	wchar_t *wdir = NULL;
+
+	memset(watch, 0, sizeof(*watch));
+
+	split_path(path, &dir, &name);
+	os_utf8_to_wcs_ptr(dir.array, dir.len, &wdir);
+	dstr_free(&dir);
+	dstr_free(&name);
+
+	if (!wdir)
+		return false;
+
+	watch->handle = FindFirstChangeNotificationW(
+		wdir, false,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME |
+			FILE_NOTIFY_CHANGE_SIZE);
+	bfree(wdir);
+
+	if (watch->handle == INVALID_HANDLE_VALUE) {
+		watch->handle = NULL;
+		return false;
+	}
+
+	watch->active = true;
+	return true;
+}
+
+void text_file_watch_free(struct text_file_watch *watch)
+{
+	if (watch->active)
+		FindCloseChangeNotification(watch->handle);
+	memset(watch, 0, sizeof(*watch));
+}
+
+bool text_file_watch_changed(struct text_file_watch *watch)
+{
+	if (!watch->active)
+		return false;
+	if (WaitForSingleObject(watch->handle, 0) != WAIT_OBJECT_0)
+		return false;
+
+	/* the notification covers the whole directory, so the caller still
+	 * has to check whether the file itself was modified */
+	FindNextChangeNotification(watch->handle);
+	return true;
+}
+
+#elif defined(__linux__)
+bool text_file_watch_init(struct text_file_watch *watch, const char *path)
+{
+	struct dstr dir = {0};
+	struct dstr name = {0};
+
+	memset(watch, 0, sizeof(*watch));
+
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd == -1)
+		return false;
+
+	split_path(path, &dir, &name);
+
+	if (inotify_add_watch(watch->fd, dir.array,
+			      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+				      IN_DELETE) == -1) {
+		close(watch->fd);
+		watch->fd = -1;
+		dstr_free(&dir);
+		dstr_free(&name);
+		return false;
+	}
+
+	watch->name = name.array;
+	watch->active = true;
+	dstr_free(&dir);
+	return true;
+}
+
+void text_file_watch_free(struct text_file_watch *watch)
+{
+	if (watch->active) {
+		close(watch->fd);
+		bfree(watch->name);
+	}
+	memset(watch, 0, sizeof(*watch));
+	watch->fd = -1;
+}
+
+bool text_file_watch_changed(struct text_file_watch *watch)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+	ssize_t len;
+
+	if (!watch->active)
+		return false;
+
+	while ((len = read(watch->fd, buf, sizeof(buf))) > 0) {
+		const char *ptr = buf;
+
+		while (ptr < buf + len) {
+			const struct inotify_event *event =
+				(const struct inotify_event *)ptr;
+
+			if (event->mask & IN_Q_OVERFLOW)
+				changed = true;
+			else if (event->len &&
+				 strcmp(event->name, watch->name) == 0)
+				changed = true;
+
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	return changed;
+}
+
+#else
+bool text_file_watch_init(struct text_file_watch *watch, const char *path)
+{
+	memset(watch, 0, sizeof(*watch));
+	watch->last_poll = os_gettime_ns();
+	watch->active = true;
+
+	UNUSED_PARAMETER(path);
+	return true;
+}
+
+void text_file_watch_free(struct text_file_watch *watch)
+{
+	memset(watch, 0, sizeof(*watch));
+}
+
+bool text_file_watch_changed(struct text_file_watch *watch)
+{
+	uint64_t ts = os_gettime_ns();
+
+	if (!watch->active || ts - watch->last_poll < 1000000000)
+		return false;
+
+	watch->last_poll = ts;
+	return true;
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/*
+ * Change notification for the file a text source reads from.
+ *
+ * The directory containing the file is watched rather than the file itself,
+ * so that editors which save by writing a new file and renaming it over the
+ * old one are still picked up.  Where no notification mechanism is available
+ * text_file_watch_changed simply returns true once a second, which keeps the
+ * old polling behavior.
+ */
+
+struct text_file_watch {
+	bool active;
+#ifdef _WIN32
+	HANDLE handle;
+#elif defined(__linux__)
+	int fd;
+	char *name;
+#else
+	uint64_t last_poll;
+#endif
+};
+
+extern bool text_file_watch_init(struct text_file_watch *watch,
+				 const char *path);
+extern void text_file_watch_free(struct text_file_watch *watch);
+
+/* returns true if the file may have changed since the last call */
+extern bool text_file_watch_changed(struct text_file_watch *watch);
@@ -35,6 +35,9 @@ MODULE_EXPORT const char *obs_module_description(void)
 
 uint32_t texbuf_w = 2048, texbuf_h = 2048;
 
+/* how long a changed text file has to stay quiet before it is reloaded */
+#define FILE_SETTLE_NS 100000000ULL
+
 static struct obs_source_info freetype2_source_info_v1 = {
 	.id = "text_ft2_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
@@ -220,17 +223,10 @@ static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
+	ft2_glyph_cache_release(srcdata->cache);
+	srcdata->cache = NULL;
 
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	text_file_watch_free(&srcdata->file_watch);
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
@@ -238,17 +234,13 @@ static void ft2_source_destroy(void *data)
 		bfree(srcdata->font_style);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->text_file != NULL)
 		bfree(srcdata->text_file);
+	bfree(srcdata->layout_text);
+	bfree(srcdata->layout);
 
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -269,7 +261,8 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata == NULL)
 		return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL)
+	if (srcdata->cache == NULL || srcdata->cache->tex == NULL ||
+	    srcdata->vbuf == NULL)
 		return;
 	if (srcdata->text == NULL || *srcdata->text == 0)
 		return;
@@ -280,8 +273,8 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata->drop_shadow)
 		draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6, true);
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->cache->tex,
+			srcdata->draw_effect, srcdata->num_glyphs * 6, true);
 
 	UNUSED_PARAMETER(effect);
 }
@@ -294,25 +287,30 @@ static void ft2_video_tick(void *data, float seconds)
 	if (!srcdata->from_file || !srcdata->text_file)
 		return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
-		time_t t = get_modified_timestamp(srcdata->text_file);
-		srcdata->last_checked = os_gettime_ns();
+	uint64_t ts = os_gettime_ns();
 
-		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
-		}
+	if (text_file_watch_changed(&srcdata->file_watch)) {
+		srcdata->file_change_pending = true;
+		srcdata->file_changed_ts = ts;
+	}
 
-		if (srcdata->m_timestamp != t) {
-			srcdata->m_timestamp = t;
-			srcdata->update_file = true;
-		}
+	/* give the writer a moment to finish before reading the file */
+	if (!srcdata->file_change_pending ||
+	    ts - srcdata->file_changed_ts < FILE_SETTLE_NS)
+		return;
+
+	srcdata->file_change_pending = false;
+
+	time_t t = get_modified_timestamp(srcdata->text_file);
+	if (srcdata->m_timestamp != t) {
+		srcdata->m_timestamp = t;
+
+		if (srcdata->log_mode)
+			read_from_end(srcdata, srcdata->text_file);
+		else
+			load_text_from_file(srcdata, srcdata->text_file);
+		cache_glyphs(srcdata->cache, srcdata->text);
+		set_up_vertex_buffer(srcdata);
 	}
 
 	UNUSED_PARAMETER(seconds);
@@ -327,12 +325,10 @@ static bool init_font(struct ft2_source *srcdata)
 	if (!path)
 		return false;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
-
-	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
+	ft2_glyph_cache_release(srcdata->cache);
+	srcdata->cache = ft2_glyph_cache_acquire(
+		path, index, srcdata->font_size, srcdata->antialiasing);
+	return srcdata->cache != NULL;
 }
 
 static void ft2_source_update(void *data, obs_data_t *settings)
@@ -406,8 +402,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (ft2_lib == NULL)
 		goto error;
 
-	const size_t texbuf_size = (size_t)texbuf_w * (size_t)texbuf_h;
-
 	if (srcdata->draw_effect == NULL) {
 		char *effect_file = NULL;
 		char *error_string = NULL;
@@ -433,10 +427,7 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	const bool aa_changed = srcdata->antialiasing != new_aa_setting;
 	if (aa_changed) {
 		srcdata->antialiasing = new_aa_setting;
-		if (srcdata->texbuf != NULL) {
-			memset(srcdata->texbuf, 0, texbuf_size);
-		}
-		cache_standard_glyphs(srcdata);
+		vbuf_needs_update = true;
 	}
 
 	srcdata->file_load_failed = false;
@@ -446,14 +437,13 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 		if (strcmp(font_name, srcdata->font_name) == 0 &&
 		    strcmp(font_style, srcdata->font_style) == 0 &&
 		    font_flags == srcdata->font_flags &&
-		    font_size == srcdata->font_size)
+		    font_size == srcdata->font_size && !aa_changed)
 			goto skip_font_load;
 
 		bfree(srcdata->font_name);
 		bfree(srcdata->font_style);
 		srcdata->font_name = NULL;
 		srcdata->font_style = NULL;
-		srcdata->max_h = 0;
 		vbuf_needs_update = true;
 	}
 
@@ -462,23 +452,11 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	srcdata->font_size = font_size;
 	srcdata->font_flags = font_flags;
 
-	if (!init_font(srcdata) || srcdata->font_face == NULL) {
+	if (!init_font(srcdata)) {
 		blog(LOG_WARNING, "FT2-text: Failed to load font %s",
 		     srcdata->font_name);
 		goto error;
-	} else {
-		FT_Set_Pixel_Sizes(srcdata->font_face, 0, srcdata->font_size);
-		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
-	}
-
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
 	}
-	srcdata->texbuf = bzalloc(texbuf_size);
-
-	if (srcdata->font_face)
-		cache_standard_glyphs(srcdata);
 
 skip_font_load:
 	if (from_file) {
@@ -509,13 +487,21 @@ skip_font_load:
 				read_from_end(srcdata, tmp);
 			else
 				load_text_from_file(srcdata, tmp);
-			srcdata->last_checked = os_gettime_ns();
+			srcdata->m_timestamp =
+				get_modified_timestamp(srcdata->text_file);
+			srcdata->file_change_pending = false;
+
+			text_file_watch_free(&srcdata->file_watch);
+			text_file_watch_init(&srcdata->file_watch, tmp);
 		}
 	} else {
 		const char *tmp = obs_data_get_string(settings, "text");
 		if (!tmp)
 			goto error;
 
+		text_file_watch_free(&srcdata->file_watch);
+		srcdata->file_change_pending = false;
+
 		if (srcdata->text != NULL) {
 			bfree(srcdata->text);
 			srcdata->text = NULL;
@@ -524,8 +510,8 @@ skip_font_load:
 		os_utf8_to_wcs_ptr(tmp, strlen(tmp), &srcdata->text);
 	}
 
-	if (srcdata->font_face) {
-		cache_glyphs(srcdata, srcdata->text);
+	if (srcdata->cache) {
+		cache_glyphs(srcdata->cache, srcdata->text);
 		set_up_vertex_buffer(srcdata);
 	}
 
@@ -18,10 +18,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <obs-module.h>
+#include <util/threading.h>
 #include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "text-file-watch.h"
 
 #define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
+#define src_glyph srcdata->cache->glyphs[glyph_index]
 
 struct glyph_info {
 	float u, v, u2, v2;
@@ -29,6 +33,38 @@ struct glyph_info {
 	FT_Pos xadv;
 };
 
+/* Face and glyph atlas, shared by all sources that use the same font file,
+ * size and antialiasing.  Glyphs are only ever added, so their texture
+ * coordinates stay valid for as long as the cache exists. */
+struct ft2_glyph_cache {
+	char *path;
+	FT_Long index;
+	uint16_t size;
+	bool antialiasing;
+	long refs;
+
+	/* guards the face, the atlas and the glyph table */
+	pthread_mutex_t mutex;
+	FT_Face face;
+	struct glyph_info **glyphs;
+	uint8_t *texbuf;
+	uint32_t texbuf_x, texbuf_y, max_h;
+	gs_texture_t *tex;
+
+	struct ft2_glyph_cache *next;
+};
+
+struct ft2_glyph_cache *ft2_glyph_cache_acquire(const char *path,
+						FT_Long index, uint16_t size,
+						bool antialiasing);
+void ft2_glyph_cache_release(struct ft2_glyph_cache *cache);
+
+/* layout state before a character of layout_text */
+struct ft2_layout_pos {
+	uint32_t dx, dy, max_y;
+	uint32_t glyph;
+};
+
 struct ft2_source {
 	char *font_name;
 	char *font_style;
@@ -41,24 +77,29 @@ struct ft2_source {
 	char *text_file;
 	wchar_t *text;
 	time_t m_timestamp;
-	bool update_file;
-	uint64_t last_checked;
+	struct text_file_watch file_watch;
+	bool file_change_pending;
+	uint64_t file_changed_ts;
 
-	uint32_t cx, cy, max_h, custom_width;
+	uint32_t cx, cy, custom_width;
 	uint32_t outline_width;
-	uint32_t texbuf_x, texbuf_y;
 	uint32_t color[2];
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
-
-	FT_Face font_face;
+	struct ft2_glyph_cache *cache;
 
-	uint8_t *texbuf;
 	gs_vertbuffer_t *vbuf;
+	uint32_t vbuf_glyphs;
+	uint32_t num_glyphs;
+
+	/* what the vertex buffer was last filled from, so that a text change
+	 * only re-emits the glyphs after the first character that differs */
+	wchar_t *layout_text;
+	size_t layout_len;
+	struct ft2_layout_pos *layout;
+	struct ft2_glyph_cache *layout_cache;
+	uint32_t layout_params[5];
 
 	gs_effect_t *draw_effect;
 	bool outline_text, drop_shadow;
@@ -97,8 +138,8 @@ time_t get_modified_timestamp(char *filename);
 void load_text_from_file(struct ft2_source *srcdata, const char *filename);
 void read_from_end(struct ft2_source *srcdata, const char *filename);
 
-void cache_standard_glyphs(struct ft2_source *srcdata);
-void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
+void cache_standard_glyphs(struct ft2_glyph_cache *cache);
+void cache_glyphs(struct ft2_glyph_cache *cache, const wchar_t *cache_glyphs);
 
 void set_up_vertex_buffer(struct ft2_source *srcdata);
 void fill_vertex_buffer(struct ft2_source *srcdata);
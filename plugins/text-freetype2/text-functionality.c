@@ -37,9 +37,9 @@ void draw_outlines(struct ft2_source *srcdata)
 	for (int32_t i = 0; i < 8; i++) {
 		gs_matrix_translate3f(offsets[i * 2], offsets[(i * 2) + 1],
 				      0.0f);
-		draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
-				srcdata->draw_effect,
-				(uint32_t)wcslen(srcdata->text) * 6, false);
+		draw_uv_vbuffer(srcdata->vbuf, srcdata->cache->tex,
+				srcdata->draw_effect, srcdata->num_glyphs * 6,
+				false);
 	}
 	gs_matrix_identity();
 	gs_matrix_pop();
@@ -52,51 +52,130 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 
 	gs_matrix_push();
 	gs_matrix_translate3f(4.0f, 4.0f, 0.0f);
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6, false);
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->cache->tex,
+			srcdata->draw_effect, srcdata->num_glyphs * 6, false);
 	gs_matrix_identity();
 	gs_matrix_pop();
 }
 
-void set_up_vertex_buffer(struct ft2_source *srcdata)
+/* ------------------------------------------------------------------------- */
+/* Shared glyph caches                                                       */
+
+static pthread_mutex_t caches_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct ft2_glyph_cache *first_cache = NULL;
+
+static void glyph_cache_destroy(struct ft2_glyph_cache *cache)
 {
-	FT_UInt glyph_index = 0;
-	uint32_t x = 0, space_pos = 0, word_width = 0;
-	size_t len;
+	if (cache->glyphs) {
+		for (uint32_t i = 0; i < num_cache_slots; i++)
+			bfree(cache->glyphs[i]);
+		bfree(cache->glyphs);
+	}
 
-	if (!srcdata->text)
-		return;
+	if (cache->tex) {
+		obs_enter_graphics();
+		gs_texture_destroy(cache->tex);
+		obs_leave_graphics();
+	}
 
-	if (srcdata->custom_width >= 100)
-		srcdata->cx = srcdata->custom_width;
-	else
-		srcdata->cx = get_ft2_text_width(srcdata->text, srcdata);
-	srcdata->cy = srcdata->max_h;
+	if (cache->face)
+		FT_Done_Face(cache->face);
 
-	obs_enter_graphics();
-	if (srcdata->vbuf != NULL) {
-		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
-		srcdata->vbuf = NULL;
-		gs_vertexbuffer_destroy(tmpvbuf);
+	pthread_mutex_destroy(&cache->mutex);
+	bfree(cache->texbuf);
+	bfree(cache->path);
+	bfree(cache);
+}
+
+static struct ft2_glyph_cache *glyph_cache_create(const char *path,
+						  FT_Long index, uint16_t size,
+						  bool antialiasing)
+{
+	struct ft2_glyph_cache *cache = bzalloc(sizeof(*cache));
+	cache->path = bstrdup(path);
+	cache->index = index;
+	cache->size = size;
+	cache->antialiasing = antialiasing;
+	cache->refs = 1;
+	pthread_mutex_init_value(&cache->mutex);
+
+	if (pthread_mutex_init(&cache->mutex, NULL) != 0 ||
+	    FT_New_Face(ft2_lib, path, index, &cache->face) != 0) {
+		glyph_cache_destroy(cache);
+		return NULL;
 	}
 
-	if (*srcdata->text == 0) {
-		obs_leave_graphics();
+	FT_Set_Pixel_Sizes(cache->face, 0, size);
+	FT_Select_Charmap(cache->face, FT_ENCODING_UNICODE);
+
+	cache->glyphs = bzalloc(sizeof(struct glyph_info *) * num_cache_slots);
+	cache->texbuf = bzalloc((size_t)texbuf_w * (size_t)texbuf_h);
+
+	cache_standard_glyphs(cache);
+	return cache;
+}
+
+struct ft2_glyph_cache *ft2_glyph_cache_acquire(const char *path,
+						FT_Long index, uint16_t size,
+						bool antialiasing)
+{
+	struct ft2_glyph_cache *cache;
+
+	pthread_mutex_lock(&caches_mutex);
+
+	for (cache = first_cache; cache; cache = cache->next) {
+		if (cache->index == index && cache->size == size &&
+		    cache->antialiasing == antialiasing &&
+		    strcmp(cache->path, path) == 0) {
+			cache->refs++;
+			break;
+		}
+	}
+
+	if (!cache) {
+		cache = glyph_cache_create(path, index, size, antialiasing);
+		if (cache) {
+			cache->next = first_cache;
+			first_cache = cache;
+		}
+	}
+
+	pthread_mutex_unlock(&caches_mutex);
+	return cache;
+}
+
+void ft2_glyph_cache_release(struct ft2_glyph_cache *cache)
+{
+	if (!cache)
 		return;
+
+	pthread_mutex_lock(&caches_mutex);
+
+	if (--cache->refs == 0) {
+		struct ft2_glyph_cache **prev = &first_cache;
+		while (*prev != cache)
+			prev = &(*prev)->next;
+		*prev = cache->next;
+	} else {
+		cache = NULL;
 	}
 
-	srcdata->vbuf =
-		create_uv_vbuffer((uint32_t)wcslen(srcdata->text) * 6, true);
+	pthread_mutex_unlock(&caches_mutex);
 
-	if (srcdata->custom_width <= 100)
-		goto skip_word_wrap;
-	if (!srcdata->word_wrap)
-		goto skip_word_wrap;
+	if (cache)
+		glyph_cache_destroy(cache);
+}
+
+/* ------------------------------------------------------------------------- */
 
-	len = wcslen(srcdata->text);
+static void wrap_words(struct ft2_source *srcdata)
+{
+	FT_UInt glyph_index = 0;
+	uint32_t x = 0, space_pos = 0, word_width = 0;
+	size_t len = wcslen(srcdata->text);
 
 	for (uint32_t i = 0; i <= len; i++) {
-		if (i == wcslen(srcdata->text))
+		if (i == len)
 			goto eos_check;
 
 		if (srcdata->text[i] != L' ' && srcdata->text[i] != L'\n')
@@ -108,7 +187,7 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 				srcdata->text[space_pos] = L'\n';
 			x = 0;
 		}
-		if (i == wcslen(srcdata->text))
+		if (i == len)
 			goto eos_skip;
 
 		x += word_width;
@@ -118,17 +197,77 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 		if (srcdata->text[i] == L' ')
 			space_pos = i;
 	next_char:;
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
+		glyph_index = FT_Get_Char_Index(srcdata->cache->face,
+						srcdata->text[i]);
 		if (src_glyph)
 			word_width += src_glyph->xadv;
 	eos_skip:;
 	}
+}
+
+void set_up_vertex_buffer(struct ft2_source *srcdata)
+{
+	struct ft2_glyph_cache *cache = srcdata->cache;
+	uint32_t len;
+
+	if (!srcdata->text || !cache)
+		return;
+
+	len = (uint32_t)wcslen(srcdata->text);
+
+	pthread_mutex_lock(&cache->mutex);
+
+	if (srcdata->custom_width >= 100)
+		srcdata->cx = srcdata->custom_width;
+	else
+		srcdata->cx = get_ft2_text_width(srcdata->text, srcdata);
+	srcdata->cy = cache->max_h;
+
+	if (srcdata->custom_width > 100 && srcdata->word_wrap)
+		wrap_words(srcdata);
+
+	obs_enter_graphics();
+
+	/* the buffer is only recreated when the text outgrows it */
+	if (srcdata->vbuf && (!len || len > srcdata->vbuf_glyphs)) {
+		gs_vertexbuffer_destroy(srcdata->vbuf);
+		srcdata->vbuf = NULL;
+		srcdata->vbuf_glyphs = 0;
+		srcdata->layout_cache = NULL;
+	}
+
+	srcdata->num_glyphs = 0;
+
+	if (len) {
+		if (!srcdata->vbuf) {
+			srcdata->vbuf_glyphs = len < 64 ? 64 : len;
+			srcdata->vbuf = create_uv_vbuffer(
+				srcdata->vbuf_glyphs * 6, true);
+		}
+
+		fill_vertex_buffer(srcdata);
+		gs_vertexbuffer_flush(srcdata->vbuf);
+	}
 
-skip_word_wrap:;
-	fill_vertex_buffer(srcdata);
-	gs_vertexbuffer_flush(srcdata->vbuf);
 	obs_leave_graphics();
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+/* number of leading characters that can keep their previous layout */
+static size_t reusable_layout(struct ft2_source *srcdata, uint32_t *params,
+			      size_t len)
+{
+	size_t i = 0;
+
+	if (srcdata->layout_cache != srcdata->cache || !srcdata->layout_text ||
+	    memcmp(params, srcdata->layout_params,
+		   sizeof(srcdata->layout_params)) != 0)
+		return 0;
+
+	while (i < len && i < srcdata->layout_len &&
+	       srcdata->text[i] == srcdata->layout_text[i])
+		i++;
+	return i;
 }
 
 void fill_vertex_buffer(struct ft2_source *srcdata)
@@ -139,98 +278,96 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 
 	struct vec2 *tvarray = (struct vec2 *)vdata->tvarray[0].array;
 	uint32_t *col = (uint32_t *)vdata->colors;
+	const uint32_t max_h = srcdata->cache->max_h;
+	const uint32_t offset = srcdata->outline_text ? 2 : 0;
+	const size_t len = wcslen(srcdata->text);
+
+	/* everything other than the text that the layout depends on */
+	uint32_t params[5] = {offset, srcdata->custom_width, max_h,
+			      srcdata->color[0], srcdata->color[1]};
+	size_t start = reusable_layout(srcdata, params, len);
+
+	struct ft2_layout_pos pos = {offset, max_h, max_h, 0};
+	if (start)
+		pos = srcdata->layout[start];
+
+	if (srcdata->layout_len < len || !srcdata->layout) {
+		srcdata->layout =
+			brealloc(srcdata->layout, sizeof(*srcdata->layout) *
+							  (len + 1));
+	}
 
-	FT_UInt glyph_index = 0;
-
-	uint32_t dx = 0, dy = srcdata->max_h, max_y = dy;
-	uint32_t cur_glyph = 0;
-	uint32_t offset = 0;
-	size_t len = wcslen(srcdata->text);
+	for (size_t i = start; i < len; i++) {
+		const wchar_t ch = srcdata->text[i];
+		srcdata->layout[i] = pos;
 
-	if (srcdata->outline_text) {
-		offset = 2;
-		dx = offset;
-	}
+		if (ch == L'\n') {
+			pos.dx = offset;
+			pos.dy += max_h + 4;
+			continue;
+		}
 
-	for (size_t i = 0; i < len; i++) {
-	add_linebreak:;
-		if (srcdata->text[i] != L'\n')
-			goto draw_glyph;
-		dx = offset;
-		i++;
-		dy += srcdata->max_h + 4;
-		if (i == wcslen(srcdata->text))
-			goto skip_glyph;
-		if (srcdata->text[i] == L'\n')
-			goto add_linebreak;
-	draw_glyph:;
 		// Skip filthy dual byte Windows line breaks
-		if (srcdata->text[i] == L'\r')
-			goto skip_glyph;
+		if (ch == L'\r')
+			continue;
 
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
+		FT_UInt glyph_index =
+			FT_Get_Char_Index(srcdata->cache->face, ch);
 		if (src_glyph == NULL)
-			goto skip_glyph;
-
-		if (srcdata->custom_width < 100)
-			goto skip_custom_width;
+			continue;
 
-		if (dx + src_glyph->xadv > srcdata->custom_width) {
-			dx = offset;
-			dy += srcdata->max_h + 4;
+		if (srcdata->custom_width >= 100 &&
+		    pos.dx + src_glyph->xadv > srcdata->custom_width) {
+			pos.dx = offset;
+			pos.dy += max_h + 4;
 		}
 
-	skip_custom_width:;
-
-		set_v3_rect(vdata->points + (cur_glyph * 6),
-			    (float)dx + (float)src_glyph->xoff,
-			    (float)dy - (float)src_glyph->yoff,
+		set_v3_rect(vdata->points + (pos.glyph * 6),
+			    (float)pos.dx + (float)src_glyph->xoff,
+			    (float)pos.dy - (float)src_glyph->yoff,
 			    (float)src_glyph->w, (float)src_glyph->h);
-		set_v2_uv(tvarray + (cur_glyph * 6), src_glyph->u, src_glyph->v,
-			  src_glyph->u2, src_glyph->v2);
-		set_rect_colors2(col + (cur_glyph * 6), srcdata->color[0],
+		set_v2_uv(tvarray + (pos.glyph * 6), src_glyph->u,
+			  src_glyph->v, src_glyph->u2, src_glyph->v2);
+		set_rect_colors2(col + (pos.glyph * 6), srcdata->color[0],
 				 srcdata->color[1]);
-		dx += src_glyph->xadv;
-		if (dy - (float)src_glyph->yoff + src_glyph->h > max_y)
-			max_y = dy - src_glyph->yoff + src_glyph->h;
-		cur_glyph++;
-	skip_glyph:;
+		pos.dx += src_glyph->xadv;
+		if (pos.dy - src_glyph->yoff + src_glyph->h > pos.max_y)
+			pos.max_y = pos.dy - src_glyph->yoff + src_glyph->h;
+		pos.glyph++;
 	}
 
-	srcdata->cy = max_y;
+	srcdata->layout[len] = pos;
+	srcdata->num_glyphs = pos.glyph;
+	srcdata->cy = pos.max_y;
+
+	bfree(srcdata->layout_text);
+	srcdata->layout_text = bwstrdup(srcdata->text);
+	srcdata->layout_len = len;
+	srcdata->layout_cache = srcdata->cache;
+	memcpy(srcdata->layout_params, params, sizeof(params));
 }
 
-void cache_standard_glyphs(struct ft2_source *srcdata)
+void cache_standard_glyphs(struct ft2_glyph_cache *cache)
 {
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
-
-	srcdata->texbuf_x = 0;
-	srcdata->texbuf_y = 0;
-
-	cache_glyphs(srcdata, L"abcdefghijklmnopqrstuvwxyz"
-			      L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
-			      L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
+	cache_glyphs(cache, L"abcdefghijklmnopqrstuvwxyz"
+			    L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
+			    L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
 }
 
-FT_Render_Mode get_render_mode(struct ft2_source *srcdata)
+static FT_Render_Mode get_render_mode(struct ft2_glyph_cache *cache)
 {
-	return srcdata->antialiasing ? FT_RENDER_MODE_NORMAL
-				     : FT_RENDER_MODE_MONO;
+	return cache->antialiasing ? FT_RENDER_MODE_NORMAL
+				   : FT_RENDER_MODE_MONO;
 }
 
-void load_glyph(struct ft2_source *srcdata, const FT_UInt glyph_index,
-		const FT_Render_Mode render_mode)
+static void load_glyph(struct ft2_glyph_cache *cache,
+		       const FT_UInt glyph_index,
+		       const FT_Render_Mode render_mode)
 {
 	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
 					   ? FT_LOAD_TARGET_MONO
 					   : FT_LOAD_DEFAULT;
-	FT_Load_Glyph(srcdata->font_face, glyph_index, load_mode);
+	FT_Load_Glyph(cache->face, glyph_index, load_mode);
 }
 
 struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
@@ -264,7 +401,7 @@ uint8_t get_pixel_value(const unsigned char *buf_row,
 	return pixel_set ? 255 : 0;
 }
 
-void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
+void rasterize(struct ft2_glyph_cache *cache, FT_GlyphSlot slot,
 	       const FT_Render_Mode render_mode, const uint32_t dx,
 	       const uint32_t dy)
 {
@@ -285,47 +422,49 @@ void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
 			const uint8_t pixel_value =
 				get_pixel_value(&slot->bitmap.buffer[row_start],
 						render_mode, x);
-			srcdata->texbuf[row_pixel_position + row] = pixel_value;
+			cache->texbuf[row_pixel_position + row] = pixel_value;
 		}
 	}
 }
 
-void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
+void cache_glyphs(struct ft2_glyph_cache *cache, const wchar_t *cache_glyphs)
 {
-	if (!srcdata->font_face || !cache_glyphs)
+	if (!cache || !cache_glyphs)
 		return;
 
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
+	pthread_mutex_lock(&cache->mutex);
+
+	FT_GlyphSlot slot = cache->face->glyph;
 
-	uint32_t dx = srcdata->texbuf_x;
-	uint32_t dy = srcdata->texbuf_y;
+	uint32_t dx = cache->texbuf_x;
+	uint32_t dy = cache->texbuf_y;
 
 	int32_t cached_glyphs = 0;
 	const size_t len = wcslen(cache_glyphs);
 
-	const FT_Render_Mode render_mode = get_render_mode(srcdata);
+	const FT_Render_Mode render_mode = get_render_mode(cache);
 
 	for (size_t i = 0; i < len; i++) {
 		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, cache_glyphs[i]);
+			FT_Get_Char_Index(cache->face, cache_glyphs[i]);
 
-		if (src_glyph != NULL) {
+		if (cache->glyphs[glyph_index] != NULL) {
 			continue;
 		}
 
-		load_glyph(srcdata, glyph_index, render_mode);
+		load_glyph(cache, glyph_index, render_mode);
 		FT_Render_Glyph(slot, render_mode);
 
 		const uint32_t g_w = slot->bitmap.width;
 		const uint32_t g_h = slot->bitmap.rows;
 
-		if (srcdata->max_h < g_h) {
-			srcdata->max_h = g_h;
+		if (cache->max_h < g_h) {
+			cache->max_h = g_h;
 		}
 
 		if (dx + g_w >= texbuf_w) {
 			dx = 0;
-			dy += srcdata->max_h + 1;
+			dy += cache->max_h + 1;
 		}
 
 		if (dy + g_h >= texbuf_h) {
@@ -334,37 +473,39 @@ void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
 			break;
 		}
 
-		src_glyph = init_glyph(slot, dx, dy, g_w, g_h);
-		rasterize(srcdata, slot, render_mode, dx, dy);
+		cache->glyphs[glyph_index] = init_glyph(slot, dx, dy, g_w, g_h);
+		rasterize(cache, slot, render_mode, dx, dy);
 
 		dx += (g_w + 1);
 		if (dx >= texbuf_w) {
 			dx = 0;
-			dy += srcdata->max_h;
+			dy += cache->max_h;
 		}
 
 		cached_glyphs++;
 	}
 
-	srcdata->texbuf_x = dx;
-	srcdata->texbuf_y = dy;
+	cache->texbuf_x = dx;
+	cache->texbuf_y = dy;
 
 	if (cached_glyphs > 0) {
 
 		obs_enter_graphics();
 
-		if (srcdata->tex != NULL) {
-			gs_texture_t *tmp_texture = srcdata->tex;
-			srcdata->tex = NULL;
+		if (cache->tex != NULL) {
+			gs_texture_t *tmp_texture = cache->tex;
+			cache->tex = NULL;
 			gs_texture_destroy(tmp_texture);
 		}
 
-		srcdata->tex = gs_texture_create(
-			texbuf_w, texbuf_h, GS_A8, 1,
-			(const uint8_t **)&srcdata->texbuf, 0);
+		cache->tex = gs_texture_create(texbuf_w, texbuf_h, GS_A8, 1,
+					       (const uint8_t **)&cache->texbuf,
+					       0);
 
 		obs_leave_graphics();
 	}
+
+	pthread_mutex_unlock(&cache->mutex);
 }
 
 time_t get_modified_timestamp(char *filename)
@@ -534,12 +675,13 @@ uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata)
 		return 0;
 	}
 
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
+	struct ft2_glyph_cache *cache = srcdata->cache;
+	FT_GlyphSlot slot = cache->face->glyph;
 	uint32_t w = 0, max_w = 0;
 	const size_t len = wcslen(text);
 	for (size_t i = 0; i < len; i++) {
 		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, text[i]);
+			FT_Get_Char_Index(cache->face, text[i]);
 
 		if (text[i] == L'\n')
 			w = 0;
@@ -548,8 +690,8 @@ uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata)
 				// Use the cached values.
 				w += src_glyph->xadv;
 			} else {
-				load_glyph(srcdata, glyph_index,
-					   get_render_mode(srcdata));
+				load_glyph(cache, glyph_index,
+					   get_render_mode(cache));
 				w += slot->advance.x >> 6;
 			}
 			if (w > max_w)
@@ -42,6 +42,8 @@
 #define SETTING_ANTI_CHEAT_HOOK      "anti_cheat_hook"
 #define SETTING_HOOK_RATE            "hook_rate"
 #define SETTING_RGBA10A2_SPACE       "rgb10a2_space"
+#define SETTING_SHTEX_RING           "shared_texture_ring"
+#define SETTING_SHTEX_RING_STATS     "shared_texture_ring_stats"
 #define SETTINGS_COMPAT_INFO         "compat_info"
 
 /* deprecated */
@@ -77,6 +79,9 @@
 #define TEXT_RGBA10A2_SPACE        obs_module_text("GameCapture.Rgb10a2Space")
 #define TEXT_RGBA10A2_SPACE_SRGB   obs_module_text("GameCapture.Rgb10a2Space.Srgb")
 #define TEXT_RGBA10A2_SPACE_2100PQ obs_module_text("GameCapture.Rgb10a2Space.2100PQ")
+#define TEXT_SHTEX_RING            obs_module_text("GameCapture.SharedTextureRing")
+#define TEXT_SHTEX_RING_STATS      obs_module_text("GameCapture.SharedTextureRing.Stats")
+#define TEXT_SHTEX_RING_SKIPPED    obs_module_text("GameCapture.SharedTextureRing.Skipped")
 
 #define TEXT_MODE_ANY            TEXT_ANY_FULLSCREEN
 #define TEXT_MODE_WINDOW         obs_module_text("GameCapture.CaptureWindow")
@@ -88,6 +93,7 @@
 /* clang-format on */
 
 #define DEFAULT_RETRY_INTERVAL 2.0f
+#define SHTEX_RING_SIZE 3
 #define ERROR_RETRY_INTERVAL 4.0f
 
 enum capture_mode {
@@ -122,6 +128,13 @@ struct game_capture_config {
 	enum hook_rate hook_rate;
 	bool is_10a2_2100pq;
 	bool capture_audio;
+	bool shtex_ring;
+};
+
+struct shtex_ring_stats {
+	uint32_t frames;
+	uint64_t latency_total;
+	uint64_t latency_max;
 };
 
 typedef DPI_AWARENESS_CONTEXT(WINAPI *PFN_SetThreadDpiAwarenessContext)(
@@ -171,6 +184,13 @@ struct game_capture {
 	ipc_pipe_server_t pipe;
 	gs_texture_t *texture;
 	gs_texture_t *extra_texture;
+	gs_texture_t *ring_textures[SHTEX_RING_MAX];
+	uint32_t ring_size;
+	long ring_slot;
+	uint32_t ring_frame;
+	uint32_t ring_skipped;
+	uint32_t ring_busy;
+	struct shtex_ring_stats ring_stats[SHTEX_RING_MAX];
 	gs_texrender_t *extra_texrender;
 	bool is_10a2_2100pq;
 	bool linear_sample;
@@ -327,6 +347,25 @@ static inline float hook_rate_to_float(enum hook_rate rate)
 	}
 }
 
+static void free_shtex_ring(struct game_capture *gc)
+{
+	if (!gc->ring_size)
+		return;
+
+	if (gc->ring_slot >= 0)
+		gs_texture_release_sync(gc->ring_textures[gc->ring_slot], 0);
+
+	for (uint32_t i = 0; i < gc->ring_size; i++) {
+		gs_texture_destroy(gc->ring_textures[i]);
+		gc->ring_textures[i] = NULL;
+	}
+
+	/* the current texture is always one of the ring textures */
+	gc->texture = NULL;
+	gc->ring_size = 0;
+	gc->ring_slot = -1;
+}
+
 static void stop_capture(struct game_capture *gc)
 {
 	ipc_pipe_server_free(&gc->pipe);
@@ -361,6 +400,7 @@ static void stop_capture(struct game_capture *gc)
 	close_handle(&gc->texture_mutexes[1]);
 
 	obs_enter_graphics();
+	free_shtex_ring(gc);
 	gs_texrender_destroy(gc->extra_texrender);
 	gc->extra_texrender = NULL;
 	gs_texture_destroy(gc->extra_texture);
@@ -469,6 +509,7 @@ static inline void get_config(struct game_capture_config *cfg,
 		obs_data_get_bool(settings, SETTING_LIMIT_FRAMERATE);
 	cfg->capture_overlays =
 		obs_data_get_bool(settings, SETTING_CAPTURE_OVERLAYS);
+	cfg->shtex_ring = obs_data_get_bool(settings, SETTING_SHTEX_RING);
 	cfg->anticheat_hook =
 		obs_data_get_bool(settings, SETTING_ANTI_CHEAT_HOOK);
 	cfg->hook_rate =
@@ -508,6 +549,9 @@ static inline bool capture_needs_reset(struct game_capture_config *cfg1,
 
 	} else if (cfg1->capture_overlays != cfg2->capture_overlays) {
 		return true;
+
+	} else if (cfg1->shtex_ring != cfg2->shtex_ring) {
+		return true;
 	}
 
 	return false;
@@ -871,6 +915,8 @@ static inline bool init_hook_info(struct game_capture *gc)
 	gc->global_hook_info->force_shmem = gc->config.force_shmem;
 	gc->global_hook_info->UNUSED_use_scale = false;
 	gc->global_hook_info->allow_srgb_alias = true;
+	gc->global_hook_info->shtex_ring_size =
+		gc->config.shtex_ring ? SHTEX_RING_SIZE : 0;
 	reset_frame_interval(gc);
 
 	obs_enter_graphics();
@@ -1726,17 +1772,92 @@ static inline bool init_shmem_capture(struct game_capture *gc)
 	return success;
 }
 
+static inline bool shtex_ring_available(struct game_capture *gc)
+{
+	/* older hooks only map the texture handle */
+	if (gc->global_hook_info->map_size < sizeof(struct shtex_data))
+		return false;
+
+	const uint32_t ring_size = gc->shtex_data->ring_size;
+	return ring_size > 1 && ring_size <= SHTEX_RING_MAX;
+}
+
+static gs_texture_t *open_shtex_ring(struct game_capture *gc)
+{
+	const uint32_t ring_size = gc->shtex_data->ring_size;
+
+	for (uint32_t i = 0; i < ring_size; i++) {
+		gs_texture_t *texture = gs_texture_open_shared(
+			gc->shtex_data->slots[i].tex_handle);
+		if (!texture) {
+			while (i > 0)
+				gs_texture_destroy(gc->ring_textures[--i]);
+			return NULL;
+		}
+
+		gc->ring_textures[i] = texture;
+	}
+
+	memset(gc->ring_stats, 0, sizeof(gc->ring_stats));
+	gc->ring_size = ring_size;
+	gc->ring_slot = -1;
+	gc->ring_frame = 0;
+	gc->ring_skipped = 0;
+	gc->ring_busy = 0;
+	return gc->ring_textures[0];
+}
+
+/* Takes over the most recently published slot of the ring.  The slot stays
+ * locked until a newer one is taken, so the hook never writes a texture
+ * that is being rendered, and it never has to wait for OBS either. */
+static void copy_shtex_ring(struct game_capture *gc)
+{
+	const long slot = os_atomic_load_long(&gc->shtex_data->latest_slot);
+	if (slot < 0 || slot >= (long)gc->ring_size || slot == gc->ring_slot)
+		return;
+
+	gs_texture_t *const texture = gc->ring_textures[slot];
+	if (gs_texture_acquire_sync(texture, 0, 0) != 0) {
+		gc->ring_busy++;
+		return;
+	}
+
+	if (gc->ring_slot >= 0)
+		gs_texture_release_sync(gc->ring_textures[gc->ring_slot], 0);
+
+	gc->ring_slot = slot;
+	gc->texture = texture;
+
+	const struct shtex_ring_slot *info = &gc->shtex_data->slots[slot];
+	struct shtex_ring_stats *stats = &gc->ring_stats[slot];
+	const uint64_t timestamp = info->timestamp;
+	const uint64_t now = os_gettime_ns();
+	const uint64_t latency = now > timestamp ? now - timestamp : 0;
+
+	stats->frames++;
+	stats->latency_total += latency;
+	if (latency > stats->latency_max)
+		stats->latency_max = latency;
+
+	if (gc->ring_frame && info->frame > gc->ring_frame + 1)
+		gc->ring_skipped += info->frame - gc->ring_frame - 1;
+	gc->ring_frame = info->frame;
+}
+
 static inline bool init_shtex_capture(struct game_capture *gc)
 {
 	obs_enter_graphics();
+	free_shtex_ring(gc);
 	gs_texrender_destroy(gc->extra_texrender);
 	gc->extra_texrender = NULL;
 	gs_texture_destroy(gc->extra_texture);
 	gc->extra_texture = NULL;
 	gs_texture_destroy(gc->texture);
 	gc->texture = NULL;
+	const bool ring = shtex_ring_available(gc);
 	gs_texture_t *const texture =
-		gs_texture_open_shared(gc->shtex_data->tex_handle);
+		ring ? open_shtex_ring(gc)
+		     : gs_texture_open_shared(gc->shtex_data->tex_handle);
 	bool success = texture != NULL;
 	if (success) {
 		enum gs_color_format format =
@@ -1766,13 +1887,20 @@ static inline bool init_shtex_capture(struct game_capture *gc)
 			}
 		}
 
-		if (success) {
+		if (success && ring) {
+			gc->copy_texture = copy_shtex_ring;
+		} else if (success) {
 			gc->texture = texture;
+		} else if (ring) {
+			free_shtex_ring(gc);
+		} else {
+			gs_texture_destroy(texture);
+		}
+
+		if (success) {
 			gc->linear_sample = linear_sample;
 			gc->extra_texture = extra_texture;
 			gc->extra_texrender = extra_texrender;
-		} else {
-			gs_texture_destroy(texture);
 		}
 	} else {
 		warn("init_shtex_capture: failed to open shared handle");
@@ -2319,6 +2447,7 @@ static void game_capture_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, SETTING_LIMIT_FRAMERATE, false);
 	obs_data_set_default_bool(settings, SETTING_CAPTURE_OVERLAYS, false);
 	obs_data_set_default_bool(settings, SETTING_ANTI_CHEAT_HOOK, true);
+	obs_data_set_default_bool(settings, SETTING_SHTEX_RING, false);
 	obs_data_set_default_int(settings, SETTING_HOOK_RATE,
 				 (int)HOOK_RATE_NORMAL);
 	obs_data_set_default_string(settings, SETTING_RGBA10A2_SPACE,
@@ -2415,6 +2544,30 @@ static bool window_not_blacklisted(const char *title, const char *class,
 	return !is_blacklisted_exe(exe);
 }
 
+static void add_shtex_ring_stats(struct game_capture *gc,
+				 obs_properties_t *ppts)
+{
+	struct dstr text = {0};
+
+	dstr_printf(&text, "%s\n", TEXT_SHTEX_RING_STATS);
+	for (uint32_t i = 0; i < gc->ring_size; i++) {
+		const struct shtex_ring_stats *stats = &gc->ring_stats[i];
+		const uint64_t avg =
+			stats->frames ? stats->latency_total / stats->frames
+				      : 0;
+
+		dstr_catf(&text, "%u: %" PRIu32 ", %.2f / %.2f ms\n", i,
+			  stats->frames, (double)avg / 1000000.0,
+			  (double)stats->latency_max / 1000000.0);
+	}
+	dstr_catf(&text, "%s: %" PRIu32 " / %" PRIu32, TEXT_SHTEX_RING_SKIPPED,
+		  gc->ring_skipped, gc->ring_busy);
+
+	obs_properties_add_text(ppts, SETTING_SHTEX_RING_STATS, text.array,
+				OBS_TEXT_INFO);
+	dstr_free(&text);
+}
+
 static obs_properties_t *game_capture_properties(void *data)
 {
 	HMONITOR monitor;
@@ -2508,6 +2661,11 @@ static obs_properties_t *game_capture_properties(void *data)
 	obs_properties_add_bool(ppts, SETTING_CAPTURE_OVERLAYS,
 				TEXT_CAPTURE_OVERLAYS);
 
+	obs_properties_add_bool(ppts, SETTING_SHTEX_RING, TEXT_SHTEX_RING);
+
+	if (data && ((struct game_capture *)data)->ring_size)
+		add_shtex_ring_stats(data, ppts);
+
 	p = obs_properties_add_list(ppts, SETTING_HOOK_RATE, TEXT_HOOK_RATE,
 				    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(p, TEXT_HOOK_RATE_SLOW, HOOK_RATE_SLOW);
@@ -72,8 +72,23 @@ struct shmem_data {
 	uint32_t tex2_offset;
 };
 
+#define SHTEX_RING_MAX 4
+
+struct shtex_ring_slot {
+	uint32_t tex_handle;
+	uint32_t frame;
+	volatile uint64_t timestamp;
+};
+
+/* ring_size and the fields after it are only present when map_size covers
+ * them; older hooks only share tex_handle.  Ring textures use keyed
+ * mutexes (key 0), and latest_slot is the most recently written slot or -1
+ * if none has been written yet. */
 struct shtex_data {
 	uint32_t tex_handle;
+	uint32_t ring_size;
+	volatile long latest_slot;
+	struct shtex_ring_slot slots[SHTEX_RING_MAX];
 };
 
 enum capture_type {
@@ -118,7 +133,11 @@ struct hook_info {
 	/* hook addresses */
 	struct graphics_offsets offsets;
 
-	uint32_t reserved[126];
+	/* number of shared texture ring slots requested, 0 for a single
+	 * shared texture */
+	uint32_t shtex_ring_size;
+
+	uint32_t reserved[125];
 };
 static_assert(sizeof(struct hook_info) == 648, "ABI compatibility");
 
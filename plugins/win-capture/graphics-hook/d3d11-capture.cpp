@@ -19,6 +19,12 @@ struct d3d11_data {
 			struct shtex_data *shtex_info;
 			ID3D11Texture2D *texture;
 			HANDLE handle;
+
+			/* shared texture ring, only if OBS requested one */
+			ID3D11Texture2D *ring[SHTEX_RING_MAX];
+			IDXGIKeyedMutex *ring_mutexes[SHTEX_RING_MAX];
+			uint32_t ring_size;
+			uint32_t ring_frame;
 		};
 		/* shared memory */
 		struct {
@@ -42,6 +48,12 @@ void d3d11_free(void)
 	if (data.using_shtex) {
 		if (data.texture)
 			data.texture->Release();
+		for (size_t i = 0; i < data.ring_size; i++) {
+			if (data.ring_mutexes[i])
+				data.ring_mutexes[i]->Release();
+			if (data.ring[i])
+				data.ring[i]->Release();
+		}
 	} else {
 		for (size_t i = 0; i < NUM_BUFFERS; i++) {
 			if (data.copy_surfaces[i]) {
@@ -83,7 +95,7 @@ static bool create_d3d11_stage_surface(ID3D11Texture2D **tex)
 }
 
 static bool create_d3d11_tex(uint32_t cx, uint32_t cy, ID3D11Texture2D **tex,
-			     HANDLE *handle)
+			     HANDLE *handle, bool keyed_mutex = false)
 {
 	HRESULT hr;
 
@@ -97,7 +109,8 @@ static bool create_d3d11_tex(uint32_t cx, uint32_t cy, ID3D11Texture2D **tex,
 	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	desc.SampleDesc.Count = 1;
 	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+	desc.MiscFlags = keyed_mutex ? D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX
+				     : D3D11_RESOURCE_MISC_SHARED;
 
 	hr = data.device->CreateTexture2D(&desc, nullptr, tex);
 	if (FAILED(hr)) {
@@ -198,12 +211,59 @@ static bool d3d11_shmem_init(HWND window)
 	return true;
 }
 
+static bool d3d11_shtex_ring_init(HWND window, uint32_t count)
+{
+	uintptr_t handles[SHTEX_RING_MAX];
+	HRESULT hr;
+
+	data.ring_size = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		HANDLE handle;
+
+		if (!create_d3d11_tex(data.cx, data.cy, &data.ring[i], &handle,
+				      true)) {
+			hlog("d3d11_shtex_ring_init: failed to create "
+			     "texture %u",
+			     i);
+			return false;
+		}
+
+		IDXGIKeyedMutex **mutex = &data.ring_mutexes[i];
+		hr = data.ring[i]->QueryInterface(__uuidof(IDXGIKeyedMutex),
+						  (void **)mutex);
+		if (FAILED(hr)) {
+			hlog_hr("d3d11_shtex_ring_init: failed to query "
+				"IDXGIKeyedMutex interface from texture",
+				hr);
+			return false;
+		}
+
+		handles[i] = (uintptr_t)handle;
+	}
+
+	if (!capture_init_shtex_ring(&data.shtex_info, window, data.cx,
+				     data.cy, data.format, false, handles,
+				     count)) {
+		return false;
+	}
+
+	hlog("d3d11 shared texture ring capture successful (%u slots)", count);
+	return true;
+}
+
 static bool d3d11_shtex_init(HWND window)
 {
 	bool success;
 
 	data.using_shtex = true;
 
+	uint32_t ring_size = global_hook_info->shtex_ring_size;
+	if (ring_size > SHTEX_RING_MAX)
+		ring_size = SHTEX_RING_MAX;
+	if (ring_size > 1)
+		return d3d11_shtex_ring_init(window, ring_size);
+
 	success =
 		create_d3d11_tex(data.cx, data.cy, &data.texture, &data.handle);
 
@@ -261,6 +321,34 @@ static inline void d3d11_shtex_capture(ID3D11Resource *backbuffer)
 	d3d11_copy_texture(data.texture, backbuffer);
 }
 
+/* Writes the frame to the oldest slot that OBS is not holding, without ever
+ * waiting on OBS.  The latest slot is left alone so that it stays available
+ * to OBS until a newer one has been published. */
+static inline void d3d11_shtex_ring_capture(ID3D11Resource *backbuffer)
+{
+	struct shtex_data *info = data.shtex_info;
+	const long latest = info->latest_slot;
+
+	for (uint32_t i = 1; i <= data.ring_size; i++) {
+		const uint32_t slot =
+			(uint32_t)(latest + (long)i) % data.ring_size;
+		if ((long)slot == latest)
+			continue;
+
+		IDXGIKeyedMutex *mutex = data.ring_mutexes[slot];
+		if (mutex->AcquireSync(0, 0) != S_OK)
+			continue;
+
+		d3d11_copy_texture(data.ring[slot], backbuffer);
+		mutex->ReleaseSync(0);
+
+		info->slots[slot].frame = ++data.ring_frame;
+		info->slots[slot].timestamp = os_gettime_ns();
+		InterlockedExchange(&info->latest_slot, (long)slot);
+		return;
+	}
+}
+
 static void d3d11_shmem_capture_copy(int i)
 {
 	D3D11_MAPPED_SUBRESOURCE map;
@@ -327,7 +415,9 @@ void d3d11_capture(void *swap_ptr, void *backbuffer_ptr)
 			return;
 		}
 
-		if (data.using_shtex)
+		if (data.using_shtex && data.ring_size)
+			d3d11_shtex_ring_capture(backbuffer);
+		else if (data.using_shtex)
 			d3d11_shtex_capture(backbuffer);
 		else
 			d3d11_shmem_capture(backbuffer);
@@ -563,9 +563,10 @@ static inline bool init_shared_info(size_t size, HWND window)
 	return true;
 }
 
-bool capture_init_shtex(struct shtex_data **data, HWND window, uint32_t cx,
-			uint32_t cy, uint32_t format, bool flip,
-			uintptr_t handle)
+bool capture_init_shtex_ring(struct shtex_data **data, HWND window,
+			     uint32_t cx, uint32_t cy, uint32_t format,
+			     bool flip, const uintptr_t *handles,
+			     uint32_t count)
 {
 	if (!init_shared_info(sizeof(struct shtex_data), window)) {
 		hlog("capture_init_shtex: Failed to initialize memory");
@@ -573,7 +574,14 @@ bool capture_init_shtex(struct shtex_data **data, HWND window, uint32_t cx,
 	}
 
 	*data = shmem_info;
-	(*data)->tex_handle = (uint32_t)handle;
+	(*data)->tex_handle = (uint32_t)handles[0];
+	(*data)->ring_size = count > 1 ? count : 0;
+	(*data)->latest_slot = -1;
+	for (uint32_t i = 0; i < (*data)->ring_size; i++) {
+		(*data)->slots[i].tex_handle = (uint32_t)handles[i];
+		(*data)->slots[i].frame = 0;
+		(*data)->slots[i].timestamp = 0;
+	}
 
 	global_hook_info->hook_ver_major = HOOK_VER_MAJOR;
 	global_hook_info->hook_ver_minor = HOOK_VER_MINOR;
@@ -598,6 +606,14 @@ bool capture_init_shtex(struct shtex_data **data, HWND window, uint32_t cx,
 	return true;
 }
 
+bool capture_init_shtex(struct shtex_data **data, HWND window, uint32_t cx,
+			uint32_t cy, uint32_t format, bool flip,
+			uintptr_t handle)
+{
+	return capture_init_shtex_ring(data, window, cx, cy, format, flip,
+				       &handle, 1);
+}
+
 static DWORD CALLBACK copy_thread(LPVOID unused)
 {
 	uint32_t pitch = thread_data.pitch;
@@ -0,0 +1,404 @@
+#include "wasapi-stream.hpp"
+
+#include <util/platform.h>
+#include <util/windows/HRError.hpp>
+#include <util/windows/CoTaskMemPtr.hpp>
+
+#include <avrt.h>
+#include <cinttypes>
+
+#define BUFFER_TIME_100NS (5 * 10000000)
+
+speaker_layout ConvertSpeakerLayout(DWORD layout, WORD channels)
+{
+	switch (layout) {
+	case KSAUDIO_SPEAKER_2POINT1:
+		return SPEAKERS_2POINT1;
+	case KSAUDIO_SPEAKER_SURROUND:
+		return SPEAKERS_4POINT0;
+	case OBS_KSAUDIO_SPEAKER_4POINT1:
+		return SPEAKERS_4POINT1;
+	case KSAUDIO_SPEAKER_5POINT1_SURROUND:
+		return SPEAKERS_5POINT1;
+	case KSAUDIO_SPEAKER_7POINT1_SURROUND:
+		return SPEAKERS_7POINT1;
+	}
+
+	return (speaker_layout)channels;
+}
+
+static void ClearBuffer(IMMDevice *device)
+{
+	CoTaskMemPtr<WAVEFORMATEX> wfex;
+	HRESULT res;
+	LPBYTE buffer;
+	UINT32 frames;
+	ComPtr<IAudioClient> client;
+
+	res = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+			       (void **)client.Assign());
+	if (FAILED(res))
+		throw HRError("Failed to activate client context", res);
+
+	res = client->GetMixFormat(&wfex);
+	if (FAILED(res))
+		throw HRError("Failed to get mix format", res);
+
+	res = client->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, BUFFER_TIME_100NS,
+				 0, wfex, nullptr);
+	if (FAILED(res))
+		throw HRError("Failed to initialize audio client", res);
+
+	/* Silent loopback fix. Prevents audio stream from stopping and */
+	/* messing up timestamps and other weird glitches during silence */
+	/* by playing a silent sample all over again. */
+
+	res = client->GetBufferSize(&frames);
+	if (FAILED(res))
+		throw HRError("Failed to get buffer size", res);
+
+	ComPtr<IAudioRenderClient> render;
+	res = client->GetService(IID_PPV_ARGS(render.Assign()));
+	if (FAILED(res))
+		throw HRError("Failed to get render client", res);
+
+	res = render->GetBuffer(frames, &buffer);
+	if (FAILED(res))
+		throw HRError("Failed to get buffer", res);
+
+	memset(buffer, 0, (size_t)frames * (size_t)wfex->nBlockAlign);
+
+	render->ReleaseBuffer(frames, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static std::mutex streams_mutex;
+static std::unordered_map<std::wstring, std::weak_ptr<WASAPIStream>> streams;
+
+std::shared_ptr<WASAPIStream> WASAPIStream::Get(IMMDevice *device,
+						bool loopback, bool lowLatency)
+{
+	CoTaskMemPtr<wchar_t> id;
+	HRESULT res = device->GetId(&id);
+	if (FAILED(res))
+		throw HRError("Failed to get device id", res);
+
+	std::wstring key = id.Get();
+	if (loopback)
+		key += L"|loopback";
+	if (lowLatency)
+		key += L"|low-latency";
+
+	std::lock_guard<std::mutex> l(streams_mutex);
+
+	for (auto it = streams.begin(); it != streams.end();) {
+		if (it->second.expired())
+			it = streams.erase(it);
+		else
+			++it;
+	}
+
+	auto it = streams.find(key);
+	if (it != streams.end()) {
+		std::shared_ptr<WASAPIStream> stream = it->second.lock();
+		if (stream && !stream->Failed())
+			return stream;
+	}
+
+	auto stream =
+		std::make_shared<WASAPIStream>(device, loopback, lowLatency);
+	streams[key] = stream;
+	return stream;
+}
+
+WASAPIStream::WASAPIStream(IMMDevice *device, bool loopback_,
+			   bool lowLatency_)
+	: loopback(loopback_)
+{
+	CoTaskMemPtr<WAVEFORMATEX> wfex;
+	HRESULT res;
+
+	stopSignal = CreateEvent(nullptr, true, false, nullptr);
+	if (!stopSignal.Valid())
+		throw "Could not create stop signal";
+
+	receiveSignal = CreateEvent(nullptr, false, false, nullptr);
+	if (!receiveSignal.Valid())
+		throw "Could not create receive signal";
+
+	res = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+			       (void **)client.Assign());
+	if (FAILED(res))
+		throw HRError("Failed to activate client context", res);
+
+	res = client->GetMixFormat(&wfex);
+	if (FAILED(res))
+		throw HRError("Failed to get mix format", res);
+
+	DWORD layout = 0;
+	if (wfex->wFormatTag == WAVE_FORMAT_EXTENSIBLE)
+		layout = ((WAVEFORMATEXTENSIBLE *)wfex.Get())->dwChannelMask;
+
+	/* WASAPI is always float */
+	speakers = ConvertSpeakerLayout(layout, wfex->nChannels);
+	channels = wfex->nChannels;
+	sampleRate = wfex->nSamplesPerSec;
+
+	/* IAudioClient3 can capture with the smallest period the audio engine
+	 * supports rather than the default of 10 ms, loopback can't */
+	ComQIPtr<IAudioClient3> client3(client);
+	if (lowLatency_ && !loopback && client3) {
+		UINT32 defaultPeriod, fundamentalPeriod, minPeriod, maxPeriod;
+		res = client3->GetSharedModeEnginePeriod(
+			wfex, &defaultPeriod, &fundamentalPeriod, &minPeriod,
+			&maxPeriod);
+		if (SUCCEEDED(res))
+			res = client3->InitializeSharedAudioStream(
+				AUDCLNT_STREAMFLAGS_EVENTCALLBACK, minPeriod,
+				wfex, nullptr);
+
+		if (SUCCEEDED(res)) {
+			lowLatency = true;
+			blog(LOG_INFO,
+			     "WASAPI: Low latency capture with a period of "
+			     "%" PRIu32 " frames",
+			     minPeriod);
+		} else {
+			blog(LOG_WARNING,
+			     "WASAPI: Low latency capture unavailable: %lX",
+			     res);
+
+			/* the client can't be initialized twice */
+			client.Clear();
+			res = device->Activate(__uuidof(IAudioClient),
+					       CLSCTX_ALL, nullptr,
+					       (void **)client.Assign());
+			if (FAILED(res))
+				throw HRError(
+					"Failed to activate client context",
+					res);
+		}
+	}
+
+	if (!lowLatency) {
+		DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+		if (loopback)
+			flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
+		res = client->Initialize(AUDCLNT_SHAREMODE_SHARED, flags,
+					 BUFFER_TIME_100NS, 0, wfex, nullptr);
+		if (FAILED(res))
+			throw HRError("Failed to initialize audio client", res);
+	}
+
+	if (loopback)
+		ClearBuffer(device);
+
+	res = client->GetService(IID_PPV_ARGS(capture.Assign()));
+	if (FAILED(res))
+		throw HRError("Failed to create capture context", res);
+
+	res = client->SetEventHandle(receiveSignal);
+	if (FAILED(res))
+		throw HRError("Failed to set event handle", res);
+
+	res = client->Start();
+	if (FAILED(res))
+		throw HRError("Failed to start capture client", res);
+
+	captureThread = CreateThread(nullptr, 0, WASAPIStream::CaptureThread,
+				     this, 0, nullptr);
+	if (!captureThread.Valid()) {
+		client->Stop();
+		throw "Failed to create capture thread";
+	}
+}
+
+WASAPIStream::~WASAPIStream()
+{
+	SetEvent(stopSignal);
+	WaitForSingleObject(captureThread, INFINITE);
+
+	client->Stop();
+}
+
+void WASAPIStream::AddCallback(void *handle, WASAPIStreamCallback cb,
+			       HANDLE failedSignal)
+{
+	std::lock_guard<std::mutex> l(mutex);
+	subscribers[handle] = {cb, failedSignal};
+
+	if (failed)
+		SetEvent(failedSignal);
+}
+
+void WASAPIStream::RemoveCallback(void *handle)
+{
+	std::lock_guard<std::mutex> l(mutex);
+	subscribers.erase(handle);
+}
+
+void WASAPIStream::Fail()
+{
+	std::lock_guard<std::mutex> l(mutex);
+	failed = true;
+
+	for (const auto &subscriber : subscribers)
+		SetEvent(subscriber.second.failedSignal);
+}
+
+bool WASAPIStream::ProcessCaptureData()
+{
+	HRESULT res;
+	LPBYTE buffer;
+	UINT32 frames;
+	DWORD flags;
+	UINT64 pos, ts;
+	UINT captureSize = 0;
+
+	while (true) {
+		res = capture->GetNextPacketSize(&captureSize);
+		if (FAILED(res)) {
+			if (res != AUDCLNT_E_DEVICE_INVALIDATED)
+				blog(LOG_WARNING,
+				     "[WASAPIStream::ProcessCaptureData]"
+				     " capture->GetNextPacketSize"
+				     " failed: %lX",
+				     res);
+			return false;
+		}
+
+		if (!captureSize)
+			break;
+
+		res = capture->GetBuffer(&buffer, &frames, &flags, &pos, &ts);
+		if (FAILED(res)) {
+			if (res != AUDCLNT_E_DEVICE_INVALIDATED)
+				blog(LOG_WARNING,
+				     "[WASAPIStream::ProcessCaptureData]"
+				     " capture->GetBuffer"
+				     " failed: %lX",
+				     res);
+			return false;
+		}
+
+		if (!sawBadTimestamp &&
+		    flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) {
+			blog(LOG_WARNING, "[WASAPIStream::ProcessCaptureData]"
+					  " Timestamp error!");
+			sawBadTimestamp = true;
+		}
+
+		if (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) {
+			/* libobs should handle discontinuities fine. */
+			blog(LOG_DEBUG, "[WASAPIStream::ProcessCaptureData]"
+					" Discontinuity flag is set.");
+		}
+
+		const bool silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+		if (silent) {
+			blog(LOG_DEBUG, "[WASAPIStream::ProcessCaptureData]"
+					" Silent flag is set.");
+		}
+
+		obs_source_audio data = {};
+		data.frames = frames;
+		data.speakers = speakers;
+		data.samples_per_sec = sampleRate;
+		data.timestamp = ts * 100;
+
+		if (channels <= MAX_AV_PLANES) {
+			/* convert once here rather than in each source */
+			const size_t samples = (size_t)channels * frames;
+			if (planes.size() < samples)
+				planes.resize(samples);
+
+			if (silent) {
+				memset(planes.data(), 0,
+				       samples * sizeof(float));
+			} else {
+				const float *in = (const float *)buffer;
+				for (uint32_t f = 0; f < frames; f++) {
+					for (uint32_t c = 0; c < channels; c++)
+						planes[c * frames + f] = *in++;
+				}
+			}
+
+			for (uint32_t c = 0; c < channels; c++)
+				data.data[c] =
+					(uint8_t *)&planes[c * (size_t)frames];
+			data.format = AUDIO_FORMAT_FLOAT_PLANAR;
+		} else {
+			if (silent) {
+				/* sample size = 4 bytes (always float) */
+				const size_t size =
+					(size_t)channels * frames * 4;
+				if (silence.size() < size)
+					silence.resize(size);
+
+				buffer = silence.data();
+			}
+
+			data.data[0] = buffer;
+			data.format = AUDIO_FORMAT_FLOAT;
+		}
+
+		{
+			std::lock_guard<std::mutex> l(mutex);
+			for (const auto &subscriber : subscribers)
+				subscriber.second.cb(data);
+		}
+
+		capture->ReleaseBuffer(frames);
+	}
+
+	return true;
+}
+
+DWORD WINAPI WASAPIStream::CaptureThread(LPVOID param)
+{
+	os_set_thread_name("win-wasapi: stream thread");
+
+	const HRESULT hr = CoInitializeEx(0, COINIT_MULTITHREADED);
+	const bool com_initialized = SUCCEEDED(hr);
+	if (!com_initialized) {
+		blog(LOG_ERROR,
+		     "[WASAPIStream::CaptureThread]"
+		     " CoInitializeEx failed: 0x%08X",
+		     hr);
+	}
+
+	WASAPIStream *stream = (WASAPIStream *)param;
+
+	DWORD unused = 0;
+	const HANDLE handle = AvSetMmThreadCharacteristics(
+		stream->lowLatency ? L"Pro Audio" : L"Audio", &unused);
+
+	const HANDLE sigs[] = {
+		stream->stopSignal,
+		stream->receiveSignal,
+	};
+
+	/* Windows 7 does not seem to wake up for LOOPBACK */
+	const DWORD dwMilliseconds = stream->loopback ? 10 : INFINITE;
+
+	for (;;) {
+		const DWORD ret = WaitForMultipleObjects(_countof(sigs), sigs,
+							 false, dwMilliseconds);
+		if (ret == WAIT_OBJECT_0)
+			break;
+
+		if (!stream->ProcessCaptureData()) {
+			stream->Fail();
+			break;
+		}
+	}
+
+	if (handle)
+		AvRevertMmThreadCharacteristics(handle);
+
+	if (com_initialized)
+		CoUninitialize();
+
+	return 0;
+}
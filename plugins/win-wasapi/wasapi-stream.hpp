@@ -0,0 +1,79 @@
+#pragma once
+
+#include <util/windows/ComPtr.hpp>
+#include <util/windows/WinHandle.hpp>
+#include <obs.h>
+
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#define OBS_KSAUDIO_SPEAKER_4POINT1 \
+	(KSAUDIO_SPEAKER_SURROUND | SPEAKER_LOW_FREQUENCY)
+
+speaker_layout ConvertSpeakerLayout(DWORD layout, WORD channels);
+
+/* the timestamp of the audio passed to the callbacks is the device's */
+typedef std::function<void(const obs_source_audio &)> WASAPIStreamCallback;
+
+/* Device capture shared by every source capturing the same endpoint, so that
+ * each endpoint is only opened once.  The stream captures on its own thread
+ * and passes the audio to each source, already converted to planar float.
+ * When capture fails, the stream signals each source's event and has to be
+ * released, the next call to Get opens the endpoint again. */
+class WASAPIStream {
+public:
+	static std::shared_ptr<WASAPIStream> Get(IMMDevice *device,
+						 bool loopback,
+						 bool lowLatency);
+
+	WASAPIStream(IMMDevice *device, bool loopback, bool lowLatency);
+	~WASAPIStream();
+
+	void AddCallback(void *handle, WASAPIStreamCallback cb,
+			 HANDLE failedSignal);
+	void RemoveCallback(void *handle);
+
+	inline bool Failed() const { return failed; }
+	inline uint32_t GetSampleRate() const { return sampleRate; }
+
+private:
+	struct Subscriber {
+		WASAPIStreamCallback cb;
+		HANDLE failedSignal;
+	};
+
+	static DWORD WINAPI CaptureThread(LPVOID param);
+	bool ProcessCaptureData();
+	void Fail();
+
+	ComPtr<IAudioClient> client;
+	ComPtr<IAudioCaptureClient> capture;
+
+	WinHandle captureThread;
+	WinHandle stopSignal;
+	WinHandle receiveSignal;
+
+	const bool loopback;
+	bool lowLatency = false;
+	std::atomic<bool> failed = false;
+	bool sawBadTimestamp = false;
+
+	speaker_layout speakers;
+	uint32_t channels;
+	uint32_t sampleRate;
+
+	std::vector<float> planes;
+	std::vector<BYTE> silence;
+
+	std::mutex mutex;
+	std::unordered_map<void *, Subscriber> subscribers;
+};
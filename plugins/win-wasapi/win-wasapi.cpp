@@ -1,4 +1,5 @@
 #include "wasapi-notify.hpp"
+#include "wasapi-stream.hpp"
 #include "enum-wasapi.hpp"
 
 #include <obs-module.h>
@@ -28,13 +29,11 @@ using namespace std;
 #define OPT_USE_DEVICE_TIMING "use_device_timing"
 #define OPT_WINDOW "window"
 #define OPT_PRIORITY "priority"
+#define OPT_LOW_LATENCY "low_latency"
 
 WASAPINotify *GetNotify();
 static void GetWASAPIDefaults(obs_data_t *settings);
 
-#define OBS_KSAUDIO_SPEAKER_4POINT1 \
-	(KSAUDIO_SPEAKER_SURROUND | SPEAKER_LOW_FREQUENCY)
-
 typedef HRESULT(STDAPICALLTYPE *PFN_ActivateAudioInterfaceAsync)(
 	LPCWSTR, REFIID, PROPVARIANT *,
 	IActivateAudioInterfaceCompletionHandler *,
@@ -160,6 +159,10 @@ class WASAPISource {
 	ComPtr<IAudioClient> client;
 	ComPtr<IAudioCaptureClient> capture;
 
+	/* device sources capture through a stream shared with every other
+	 * source capturing the same endpoint, process output can't share */
+	std::shared_ptr<WASAPIStream> stream;
+
 	obs_source_t *source;
 	obs_weak_source_t *reroute_target = nullptr;
 	wstring default_id;
@@ -182,6 +185,7 @@ class WASAPISource {
 	const SourceType sourceType;
 	std::atomic<bool> useDeviceTiming = false;
 	std::atomic<bool> isDefaultDevice = false;
+	bool lowLatency = false;
 	std::atomic<bool> sawBadTimestamp = false;
 	bool hooked = false;
 
@@ -258,6 +262,9 @@ class WASAPISource {
 	static DWORD WINAPI CaptureThread(LPVOID param);
 
 	bool ProcessCaptureData();
+	void OnStreamAudio(const obs_source_audio &packet);
+	void OutputAudio(const obs_source_audio &data);
+	void ReleaseCapture();
 
 	void Start();
 	void Stop();
@@ -274,7 +281,6 @@ class WASAPISource {
 	static void InitFormat(const WAVEFORMATEX *wfex,
 			       enum speaker_layout &speakers,
 			       enum audio_format &format, uint32_t &sampleRate);
-	static void ClearBuffer(IMMDevice *device);
 	static ComPtr<IAudioCaptureClient> InitCapture(IAudioClient *client,
 						       HANDLE receiveSignal);
 	void Initialize();
@@ -285,6 +291,7 @@ class WASAPISource {
 		string device_id;
 		bool useDeviceTiming;
 		bool isDefaultDevice;
+		bool lowLatency;
 		window_priority priority;
 		string window_class;
 		string title;
@@ -536,6 +543,8 @@ WASAPISource::UpdateParams WASAPISource::BuildUpdateParams(obs_data_t *settings)
 		obs_data_get_bool(settings, OPT_USE_DEVICE_TIMING);
 	params.isDefaultDevice =
 		_strcmpi(params.device_id.c_str(), "default") == 0;
+	params.lowLatency = sourceType == SourceType::Input &&
+			    obs_data_get_bool(settings, OPT_LOW_LATENCY);
 	params.priority =
 		(window_priority)obs_data_get_int(settings, "priority");
 	params.window_class.clear();
@@ -571,6 +580,7 @@ void WASAPISource::UpdateSettings(UpdateParams &&params)
 	device_id = std::move(params.device_id);
 	useDeviceTiming = params.useDeviceTiming;
 	isDefaultDevice = params.isDefaultDevice;
+	lowLatency = params.lowLatency;
 	priority = params.priority;
 	window_class = std::move(params.window_class);
 	title = std::move(params.title);
@@ -592,9 +602,10 @@ void WASAPISource::LogSettings()
 		blog(LOG_INFO,
 		     "[win-wasapi: '%s'] update settings:\n"
 		     "\tdevice id: %s\n"
-		     "\tuse device timing: %d",
+		     "\tuse device timing: %d\n"
+		     "\tlow latency: %d",
 		     obs_source_get_name(source), device_id.c_str(),
-		     (int)useDeviceTiming);
+		     (int)useDeviceTiming, (int)lowLatency);
 	}
 }
 
@@ -608,7 +619,8 @@ void WASAPISource::Update(obs_data_t *settings)
 			   (window_class != params.window_class) ||
 			   (title != params.title) ||
 			   (executable != params.executable))
-			: (device_id.compare(params.device_id) != 0);
+			: (device_id.compare(params.device_id) != 0) ||
+				  (lowLatency != params.lowLatency);
 
 	UpdateSettings(std::move(params));
 	LogSettings();
@@ -627,7 +639,8 @@ void WASAPISource::OnWindowChanged(obs_data_t *settings)
 			   (window_class != params.window_class) ||
 			   (title != params.title) ||
 			   (executable != params.executable))
-			: (device_id.compare(params.device_id) != 0);
+			: (device_id.compare(params.device_id) != 0) ||
+				  (lowLatency != params.lowLatency);
 
 	UpdateSettings(std::move(params));
 
@@ -807,68 +820,6 @@ ComPtr<IAudioClient> WASAPISource::InitClient(
 	return client;
 }
 
-void WASAPISource::ClearBuffer(IMMDevice *device)
-{
-	CoTaskMemPtr<WAVEFORMATEX> wfex;
-	HRESULT res;
-	LPBYTE buffer;
-	UINT32 frames;
-	ComPtr<IAudioClient> client;
-
-	res = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
-			       (void **)client.Assign());
-	if (FAILED(res))
-		throw HRError("Failed to activate client context", res);
-
-	res = client->GetMixFormat(&wfex);
-	if (FAILED(res))
-		throw HRError("Failed to get mix format", res);
-
-	res = client->Initialize(AUDCLNT_SHAREMODE_SHARED, 0, BUFFER_TIME_100NS,
-				 0, wfex, nullptr);
-	if (FAILED(res))
-		throw HRError("Failed to initialize audio client", res);
-
-	/* Silent loopback fix. Prevents audio stream from stopping and */
-	/* messing up timestamps and other weird glitches during silence */
-	/* by playing a silent sample all over again. */
-
-	res = client->GetBufferSize(&frames);
-	if (FAILED(res))
-		throw HRError("Failed to get buffer size", res);
-
-	ComPtr<IAudioRenderClient> render;
-	res = client->GetService(IID_PPV_ARGS(render.Assign()));
-	if (FAILED(res))
-		throw HRError("Failed to get render client", res);
-
-	res = render->GetBuffer(frames, &buffer);
-	if (FAILED(res))
-		throw HRError("Failed to get buffer", res);
-
-	memset(buffer, 0, (size_t)frames * (size_t)wfex->nBlockAlign);
-
-	render->ReleaseBuffer(frames, 0);
-}
-
-static speaker_layout ConvertSpeakerLayout(DWORD layout, WORD channels)
-{
-	switch (layout) {
-	case KSAUDIO_SPEAKER_2POINT1:
-		return SPEAKERS_2POINT1;
-	case KSAUDIO_SPEAKER_SURROUND:
-		return SPEAKERS_4POINT0;
-	case OBS_KSAUDIO_SPEAKER_4POINT1:
-		return SPEAKERS_4POINT1;
-	case KSAUDIO_SPEAKER_5POINT1_SURROUND:
-		return SPEAKERS_5POINT1;
-	case KSAUDIO_SPEAKER_7POINT1_SURROUND:
-		return SPEAKERS_7POINT1;
-	}
-
-	return (speaker_layout)channels;
-}
-
 void WASAPISource::InitFormat(const WAVEFORMATEX *wfex,
 			      enum speaker_layout &speakers,
 			      enum audio_format &format, uint32_t &sampleRate)
@@ -933,31 +884,39 @@ void WASAPISource::Initialize()
 
 	ResetEvent(receiveSignal);
 
-	ComPtr<IAudioClient> temp_client = InitClient(
-		device, sourceType, process_id, activate_audio_interface_async,
-		speakers, format, sampleRate);
-	if (sourceType == SourceType::DeviceOutput)
-		ClearBuffer(device);
-	ComPtr<IAudioCaptureClient> temp_capture =
-		InitCapture(temp_client, receiveSignal);
-
-	client = std::move(temp_client);
-	capture = std::move(temp_capture);
+	if (sourceType == SourceType::ProcessOutput) {
+		ComPtr<IAudioClient> temp_client =
+			InitClient(device, sourceType, process_id,
+				   activate_audio_interface_async, speakers,
+				   format, sampleRate);
+		ComPtr<IAudioCaptureClient> temp_capture =
+			InitCapture(temp_client, receiveSignal);
+
+		client = std::move(temp_client);
+		capture = std::move(temp_capture);
+	} else {
+		/* the stream only signals receiveSignal when it fails */
+		const bool loopback = sourceType == SourceType::DeviceOutput;
+		stream = WASAPIStream::Get(device, loopback, lowLatency);
+		sampleRate = stream->GetSampleRate();
+		stream->AddCallback(this,
+				    std::bind(&WASAPISource::OnStreamAudio,
+					      this, std::placeholders::_1),
+				    receiveSignal);
+	}
 
 	if (rtwq_supported) {
 		HRESULT hr = rtwq_put_waiting_work_item(
 			receiveSignal, 0, sampleReadyAsyncResult, nullptr);
 		if (FAILED(hr)) {
-			capture.Clear();
-			client.Clear();
+			ReleaseCapture();
 			throw HRError("RtwqPutWaitingWorkItem failed", hr);
 		}
 
 		hr = rtwq_put_waiting_work_item(restartSignal, 0,
 						restartAsyncResult, nullptr);
 		if (FAILED(hr)) {
-			capture.Clear();
-			client.Clear();
+			ReleaseCapture();
 			throw HRError("RtwqPutWaitingWorkItem failed", hr);
 		}
 	}
@@ -1060,6 +1019,51 @@ DWORD WINAPI WASAPISource::ReconnectThread(LPVOID param)
 	return 0;
 }
 
+void WASAPISource::ReleaseCapture()
+{
+	if (stream) {
+		stream->RemoveCallback(this);
+		stream.reset();
+	}
+
+	if (client) {
+		client->Stop();
+
+		capture.Clear();
+		client.Clear();
+	}
+}
+
+void WASAPISource::OutputAudio(const obs_source_audio &data)
+{
+	if (reroute_target) {
+		obs_source_t *target =
+			obs_weak_source_get_source(reroute_target);
+
+		if (target) {
+			obs_source_output_audio(target, &data);
+			obs_source_release(target);
+		}
+	} else {
+		obs_source_output_audio(source, &data);
+	}
+}
+
+/* called on the stream's capture thread */
+void WASAPISource::OnStreamAudio(const obs_source_audio &packet)
+{
+	if (useDeviceTiming) {
+		OutputAudio(packet);
+		return;
+	}
+
+	obs_source_audio data = packet;
+	data.timestamp = os_gettime_ns() -
+			 util_mul_div64(data.frames, UINT64_C(1000000000),
+					data.samples_per_sec);
+	OutputAudio(data);
+}
+
 bool WASAPISource::ProcessCaptureData()
 {
 	HRESULT res;
@@ -1069,6 +1073,10 @@ bool WASAPISource::ProcessCaptureData()
 	UINT64 pos, ts;
 	UINT captureSize = 0;
 
+	/* the stream outputs the audio itself, only check it's still good */
+	if (stream)
+		return !stream->Failed();
+
 	while (true) {
 		if ((sourceType == SourceType::ProcessOutput) &&
 		    !IsWindow(hwnd)) {
@@ -1148,17 +1156,7 @@ bool WASAPISource::ProcessCaptureData()
 					sampleRate);
 		}
 
-		if (reroute_target) {
-			obs_source_t *target =
-				obs_weak_source_get_source(reroute_target);
-
-			if (target) {
-				obs_source_output_audio(target, &data);
-				obs_source_release(target);
-			}
-		} else {
-			obs_source_output_audio(source, &data);
-		}
+		OutputAudio(data);
 
 		capture->ReleaseBuffer(frames);
 	}
@@ -1300,12 +1298,7 @@ DWORD WINAPI WASAPISource::CaptureThread(LPVOID param)
 		sig_count = _countof(inactive_sigs);
 		sigs = inactive_sigs;
 
-		if (source->client) {
-			source->client->Stop();
-
-			source->capture.Clear();
-			source->client.Clear();
-		}
+		source->ReleaseCapture();
 
 		if (idle) {
 			SetEvent(source->idleSignal);
@@ -1429,10 +1422,7 @@ void WASAPISource::OnSampleReady()
 	}
 
 	if (stop) {
-		client->Stop();
-
-		capture.Clear();
-		client.Clear();
+		ReleaseCapture();
 
 		if (reconnect) {
 			blog(LOG_INFO,
@@ -1490,6 +1480,7 @@ static void GetWASAPIDefaultsInput(obs_data_t *settings)
 {
 	obs_data_set_default_string(settings, OPT_DEVICE_ID, "default");
 	obs_data_set_default_bool(settings, OPT_USE_DEVICE_TIMING, false);
+	obs_data_set_default_bool(settings, OPT_LOW_LATENCY, false);
 }
 
 static void GetWASAPIDefaultsDeviceOutput(obs_data_t *settings)
@@ -1654,6 +1645,11 @@ static obs_properties_t *GetWASAPIPropertiesInput(void *)
 	obs_properties_add_bool(props, OPT_USE_DEVICE_TIMING,
 				obs_module_text("UseDeviceTiming"));
 
+	obs_property_t *p = obs_properties_add_bool(
+		props, OPT_LOW_LATENCY, obs_module_text("LowLatency"));
+	obs_property_set_long_description(
+		p, obs_module_text("LowLatency.ToolTip"));
+
 	return props;
 }
 
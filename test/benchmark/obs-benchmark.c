@@ -0,0 +1,682 @@
+/* obs-benchmark.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Pipeline benchmark: renders a scene of synthetic test sources through the
+ * surfaceless EGL platform, encodes it into the null output for a fixed time
+ * and prints what happened as JSON.
+ *
+ * The video sources are the "random" test source stretched over the whole
+ * canvas, so every one of them costs a full canvas draw, the audio sources
+ * are the "test_sinewave" source.  Both come from the test-input module,
+ * which has to be built with ENABLE_TEST_INPUT and installed along with the
+ * regular plugins.
+ *
+ * Counters are taken after a warm-up period so that encoder start-up and
+ * the first frames do not skew the results.  The GPU time is the time spent
+ * rendering the scene and its sources as measured by the GPU source timing,
+ * sampled every SAMPLE_INTERVAL_MS.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <obs.h>
+#include <obs-nix-platform.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/metrics.h>
+#include <util/platform.h>
+
+#define MAX_LINE 4096
+#define SAMPLE_INTERVAL_MS 100
+#define STOP_TIMEOUT_MS 5000
+
+struct benchmark {
+	uint32_t duration;
+	uint32_t warmup;
+	uint32_t video_sources;
+	uint32_t audio_sources;
+	uint32_t base_width;
+	uint32_t base_height;
+	uint32_t output_width;
+	uint32_t output_height;
+	uint32_t fps;
+	uint32_t adapter;
+	const char *encoder_id;
+	int bitrate;
+
+	obs_scene_t *scene;
+	DARRAY(obs_source_t *) sources;
+	obs_encoder_t *video_encoder;
+	obs_encoder_t *audio_encoder;
+	obs_output_t *output;
+	metric_t *render_time;
+};
+
+struct snapshot {
+	uint64_t time_ns;
+	uint64_t cpu_user_ns;
+	uint64_t cpu_system_ns;
+	uint32_t rendered;
+	uint32_t lagged;
+	uint32_t output_frames;
+	uint32_t skipped;
+	uint64_t render_counts[METRIC_HISTOGRAM_BUCKETS];
+};
+
+struct gpu_samples {
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t count;
+};
+
+static int log_verbosity = LOG_WARNING;
+static volatile sig_atomic_t stop_requested = 0;
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	static const char *prefixes[] = {
+		[LOG_ERROR] = "error: ",
+		[LOG_WARNING] = "warning: ",
+		[LOG_INFO] = "",
+		[LOG_DEBUG] = "debug: ",
+	};
+	char str[MAX_LINE];
+
+	if (log_level > log_verbosity)
+		return;
+
+	vsnprintf(str, sizeof(str), msg, args);
+	fprintf(stderr, "%s%s\n", prefixes[log_level], str);
+
+	UNUSED_PARAMETER(param);
+}
+
+static void signal_handler(int sig)
+{
+	stop_requested = 1;
+	UNUSED_PARAMETER(sig);
+}
+
+/* ------------------------------------------------------------------------- */
+/* setup                                                                     */
+
+static bool reset_video(struct benchmark *b)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = DL_OPENGL,
+		.fps_num = b->fps,
+		.fps_den = 1,
+		.base_width = b->base_width,
+		.base_height = b->base_height,
+		.output_width = b->output_width,
+		.output_height = b->output_height,
+		.output_format = VIDEO_FORMAT_NV12,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+		.adapter = b->adapter,
+		.gpu_conversion = true,
+	};
+
+	int ret = obs_reset_video(&ovi);
+	if (ret != OBS_VIDEO_SUCCESS) {
+		blog(LOG_ERROR, "Failed to initialize video (%d)", ret);
+		return false;
+	}
+
+	return true;
+}
+
+static bool reset_audio(void)
+{
+	struct obs_audio_info2 ai = {
+		.samples_per_sec = 48000,
+		.speakers = SPEAKERS_STEREO,
+	};
+
+	if (!obs_reset_audio2(&ai)) {
+		blog(LOG_ERROR, "Failed to initialize audio");
+		return false;
+	}
+
+	return true;
+}
+
+static bool add_source(struct benchmark *b, const char *id, uint32_t idx)
+{
+	struct dstr name = {0};
+	obs_source_t *source;
+	obs_sceneitem_t *item;
+
+	dstr_printf(&name, "%s %" PRIu32, id, idx);
+	source = obs_source_create(id, name.array, NULL, NULL);
+	dstr_free(&name);
+
+	if (!source) {
+		blog(LOG_ERROR, "Failed to create '%s' source, is the "
+				"test-input module installed?",
+		     id);
+		return false;
+	}
+
+	da_push_back(b->sources, &source);
+
+	item = obs_scene_add(b->scene, source);
+	if (obs_source_get_output_flags(source) & OBS_SOURCE_VIDEO) {
+		struct vec2 bounds;
+		vec2_set(&bounds, (float)b->base_width, (float)b->base_height);
+		obs_sceneitem_set_bounds_type(item, OBS_BOUNDS_STRETCH);
+		obs_sceneitem_set_bounds(item, &bounds);
+	}
+
+	return true;
+}
+
+static bool create_scene(struct benchmark *b)
+{
+	b->scene = obs_scene_create("Benchmark");
+
+	for (uint32_t i = 0; i < b->video_sources; i++) {
+		if (!add_source(b, "random", i))
+			return false;
+	}
+	for (uint32_t i = 0; i < b->audio_sources; i++) {
+		if (!add_source(b, "test_sinewave", i))
+			return false;
+	}
+
+	obs_set_output_source(0, obs_scene_get_source(b->scene));
+	return true;
+}
+
+static bool create_output(struct benchmark *b)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_string(settings, "rate_control", "CBR");
+	obs_data_set_int(settings, "bitrate", b->bitrate);
+	b->video_encoder = obs_video_encoder_create(
+		b->encoder_id, "benchmark video", settings, NULL);
+	obs_data_release(settings);
+
+	settings = obs_data_create();
+	obs_data_set_int(settings, "bitrate", 160);
+	b->audio_encoder = obs_audio_encoder_create(
+		"ffmpeg_aac", "benchmark audio", settings, 0, NULL);
+	obs_data_release(settings);
+
+	b->output = obs_output_create("null_output", "benchmark output", NULL,
+				      NULL);
+
+	if (!b->video_encoder || !b->audio_encoder || !b->output) {
+		blog(LOG_ERROR, "Failed to create the '%s' encoder or the "
+				"null output",
+		     b->encoder_id);
+		return false;
+	}
+
+	obs_encoder_set_video(b->video_encoder, obs_get_video());
+	obs_encoder_set_audio(b->audio_encoder, obs_get_audio());
+	obs_output_set_video_encoder(b->output, b->video_encoder);
+	obs_output_set_audio_encoder(b->output, b->audio_encoder, 0);
+
+	return true;
+}
+
+static void free_benchmark(struct benchmark *b)
+{
+	obs_set_output_source(0, NULL);
+
+	obs_output_release(b->output);
+	obs_encoder_release(b->video_encoder);
+	obs_encoder_release(b->audio_encoder);
+
+	for (size_t i = 0; i < b->sources.num; i++)
+		obs_source_release(b->sources.array[i]);
+	da_free(b->sources);
+	obs_scene_release(b->scene);
+
+	metric_release(b->render_time);
+}
+
+/* ------------------------------------------------------------------------- */
+/* measuring                                                                 */
+
+static inline uint64_t timeval_ns(const struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * 1000000000ULL +
+	       (uint64_t)tv->tv_usec * 1000ULL;
+}
+
+static void take_snapshot(struct benchmark *b, struct snapshot *s)
+{
+	video_t *video = obs_get_video();
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	s->time_ns = os_gettime_ns();
+	s->cpu_user_ns = timeval_ns(&usage.ru_utime);
+	s->cpu_system_ns = timeval_ns(&usage.ru_stime);
+	s->rendered = obs_get_total_frames();
+	s->lagged = obs_get_lagged_frames();
+	s->output_frames = video_output_get_total_frames(video);
+	s->skipped = video_output_get_skipped_frames(video);
+	metric_histogram_get_counts(b->render_time, s->render_counts);
+}
+
+static void sample_gpu(struct benchmark *b, struct gpu_samples *gpu)
+{
+	obs_source_t *scene = obs_scene_get_source(b->scene);
+	uint64_t frame_ns = obs_source_get_gpu_render_time_ns(scene);
+
+	for (size_t i = 0; i < b->sources.num; i++)
+		frame_ns += obs_source_get_gpu_render_time_ns(
+			b->sources.array[i]);
+
+	if (!frame_ns)
+		return;
+
+	gpu->total_ns += frame_ns;
+	if (frame_ns > gpu->max_ns)
+		gpu->max_ns = frame_ns;
+	gpu->count++;
+}
+
+/* returns false if the run was interrupted */
+static bool wait_for(struct benchmark *b, uint32_t seconds,
+		     struct gpu_samples *gpu)
+{
+	uint64_t end = os_gettime_ns() + (uint64_t)seconds * 1000000000ULL;
+
+	while (os_gettime_ns() < end) {
+		if (stop_requested || !obs_output_active(b->output))
+			return false;
+
+		os_sleep_ms(SAMPLE_INTERVAL_MS);
+		if (gpu)
+			sample_gpu(b, gpu);
+	}
+
+	return true;
+}
+
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+static obs_data_t *make_config(struct benchmark *b)
+{
+	obs_data_t *config = obs_data_create();
+
+	obs_data_set_int(config, "duration_seconds", b->duration);
+	obs_data_set_int(config, "warmup_seconds", b->warmup);
+	obs_data_set_int(config, "video_sources", b->video_sources);
+	obs_data_set_int(config, "audio_sources", b->audio_sources);
+	obs_data_set_int(config, "base_width", b->base_width);
+	obs_data_set_int(config, "base_height", b->base_height);
+	obs_data_set_int(config, "output_width", b->output_width);
+	obs_data_set_int(config, "output_height", b->output_height);
+	obs_data_set_int(config, "fps", b->fps);
+	obs_data_set_string(config, "encoder", b->encoder_id);
+	obs_data_set_int(config, "bitrate", b->bitrate);
+	obs_data_set_string(config, "version", obs_get_version_string());
+
+	return config;
+}
+
+static inline void set_percentile(obs_data_t *data, const char *name,
+				  const uint64_t *counts, double percentile)
+{
+	uint64_t ns = metric_histogram_percentile(counts, percentile);
+	obs_data_set_double(data, name, ns_to_ms(ns));
+}
+
+static obs_data_t *make_frame_times(const struct snapshot *start,
+				    const struct snapshot *end)
+{
+	obs_data_t *times = obs_data_create();
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+	uint64_t total = 0;
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+		counts[i] = end->render_counts[i] - start->render_counts[i];
+		total += counts[i];
+		sum += counts[i] * metric_histogram_bucket_max(i);
+	}
+
+	obs_data_set_double(times, "avg", total ? ns_to_ms(sum / total) : 0.0);
+	set_percentile(times, "p50", counts, 50.0);
+	set_percentile(times, "p90", counts, 90.0);
+	set_percentile(times, "p99", counts, 99.0);
+	set_percentile(times, "max", counts, 100.0);
+
+	return times;
+}
+
+static obs_data_t *make_report(struct benchmark *b,
+			       const struct snapshot *start,
+			       const struct snapshot *end,
+			       const struct gpu_samples *gpu, bool completed)
+{
+	obs_data_t *report = obs_data_create();
+	obs_data_t *obj;
+	struct obs_encoder_stats stats = {0};
+	struct rusage usage;
+	double elapsed = (double)(end->time_ns - start->time_ns) / 1e9;
+	uint64_t user_ns = end->cpu_user_ns - start->cpu_user_ns;
+	uint64_t system_ns = end->cpu_system_ns - start->cpu_system_ns;
+	double cpu_percent = 0.0;
+
+	if (elapsed > 0.0)
+		cpu_percent = (double)(user_ns + system_ns) / 1e7 / elapsed;
+
+	obs_data_set_bool(report, "completed", completed);
+	obs_data_set_double(report, "elapsed_seconds", elapsed);
+
+	obj = make_config(b);
+	obs_data_set_obj(report, "config", obj);
+	obs_data_release(obj);
+
+	obj = obs_data_create();
+	obs_data_set_int(obj, "rendered", end->rendered - start->rendered);
+	obs_data_set_int(obj, "lagged", end->lagged - start->lagged);
+	obs_data_set_int(obj, "output",
+			 end->output_frames - start->output_frames);
+	obs_data_set_int(obj, "skipped", end->skipped - start->skipped);
+	obs_data_set_int(obj, "dropped",
+			 obs_output_get_frames_dropped(b->output));
+	obs_data_set_obj(report, "frames", obj);
+	obs_data_release(obj);
+
+	/* in milliseconds */
+	obj = make_frame_times(start, end);
+	obs_data_set_obj(report, "frame_time_ms", obj);
+	obs_data_release(obj);
+
+	obj = obs_data_create();
+	obs_data_set_double(obj, "avg",
+			    gpu->count ? ns_to_ms(gpu->total_ns / gpu->count)
+				       : 0.0);
+	obs_data_set_double(obj, "max", ns_to_ms(gpu->max_ns));
+	obs_data_set_int(obj, "samples", (long long)gpu->count);
+	obs_data_set_obj(report, "gpu_time_ms", obj);
+	obs_data_release(obj);
+
+	obj = obs_data_create();
+	if (obs_encoder_get_stats(b->video_encoder, &stats)) {
+		obs_data_set_double(obj, "latency_avg_ms",
+				    ns_to_ms(stats.latency_avg_ns));
+		obs_data_set_double(obj, "latency_max_ms",
+				    ns_to_ms(stats.latency_max_ns));
+		obs_data_set_double(obj, "encode_avg_ms",
+				    ns_to_ms(stats.encode_avg_ns));
+		obs_data_set_double(obj, "encode_max_ms",
+				    ns_to_ms(stats.encode_max_ns));
+	}
+	obs_data_set_obj(report, "encoder", obj);
+	obs_data_release(obj);
+
+	obj = obs_data_create();
+	obs_data_set_double(obj, "user_seconds", (double)user_ns / 1e9);
+	obs_data_set_double(obj, "system_seconds", (double)system_ns / 1e9);
+	obs_data_set_double(obj, "percent", cpu_percent);
+	obs_data_set_obj(report, "cpu", obj);
+	obs_data_release(obj);
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	obj = obs_data_create();
+	obs_data_set_int(obj, "max_rss_kb", usage.ru_maxrss);
+	obs_data_set_int(obj, "allocations", bnum_allocs());
+	obs_data_set_obj(report, "memory", obj);
+	obs_data_release(obj);
+
+	return report;
+}
+
+static bool run_benchmark(struct benchmark *b, const char *report_file)
+{
+	struct gpu_samples gpu = {0};
+	struct snapshot start;
+	struct snapshot end;
+	bool completed;
+	bool success = true;
+
+	b->render_time = metric_get(METRIC_HISTOGRAM, "obs_render_time_seconds",
+				    NULL, NULL);
+
+	if (!obs_output_start(b->output)) {
+		const char *error = obs_output_get_last_error(b->output);
+		blog(LOG_ERROR, "Failed to start the output: %s",
+		     error ? error : "unknown error");
+		return false;
+	}
+
+	completed = wait_for(b, b->warmup, NULL);
+	take_snapshot(b, &start);
+
+	if (completed)
+		completed = wait_for(b, b->duration, &gpu);
+	take_snapshot(b, &end);
+
+	obs_output_stop(b->output);
+	for (uint32_t waited = 0; obs_output_active(b->output) &&
+				  waited < STOP_TIMEOUT_MS;
+	     waited += 10)
+		os_sleep_ms(10);
+
+	obs_data_t *report = make_report(b, &start, &end, &gpu, completed);
+	const char *json = obs_data_get_json_pretty(report);
+
+	if (report_file) {
+		if (!os_quick_write_utf8_file(report_file, json, strlen(json),
+					      false)) {
+			blog(LOG_ERROR, "Failed to write '%s'", report_file);
+			success = false;
+		}
+	} else {
+		printf("%s\n", json);
+	}
+
+	obs_data_release(report);
+	return success && completed;
+}
+
+/* ------------------------------------------------------------------------- */
+/* main                                                                      */
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"\n"
+		"  -d, --duration <sec>      measured time (default 10)\n"
+		"  -w, --warmup <sec>        time before measuring "
+		"(default 2)\n"
+		"  -n, --sources <n>         random video sources (default 1)\n"
+		"      --tones <n>           sine wave audio sources "
+		"(default 1)\n"
+		"  -r, --resolution <WxH>    canvas resolution "
+		"(default 1920x1080)\n"
+		"  -s, --scaled <WxH>        output resolution "
+		"(default canvas)\n"
+		"  -f, --fps <n>             frame rate (default 60)\n"
+		"  -e, --encoder <id>        video encoder (default obs_x264)\n"
+		"  -b, --bitrate <kbps>      video bitrate (default 6000)\n"
+		"  -a, --adapter <index>     EGL device to render on\n"
+		"  -o, --output <file>       write the report to a file "
+		"instead of stdout\n"
+		"  -v, --verbose             log libobs output\n"
+		"  -h, --help                show this help\n",
+		name);
+}
+
+static bool parse_resolution(const char *str, uint32_t *cx, uint32_t *cy)
+{
+	unsigned int w, h;
+
+	if (sscanf(str, "%ux%u", &w, &h) != 2 || w < 32 || h < 32)
+		return false;
+
+	*cx = w;
+	*cy = h;
+	return true;
+}
+
+enum {
+	OPT_TONES = 256,
+};
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_options[] = {
+		{"duration", required_argument, NULL, 'd'},
+		{"warmup", required_argument, NULL, 'w'},
+		{"sources", required_argument, NULL, 'n'},
+		{"tones", required_argument, NULL, OPT_TONES},
+		{"resolution", required_argument, NULL, 'r'},
+		{"scaled", required_argument, NULL, 's'},
+		{"fps", required_argument, NULL, 'f'},
+		{"encoder", required_argument, NULL, 'e'},
+		{"bitrate", required_argument, NULL, 'b'},
+		{"adapter", required_argument, NULL, 'a'},
+		{"output", required_argument, NULL, 'o'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"help", no_argument, NULL, 'h'},
+		{0},
+	};
+
+	struct benchmark b = {
+		.duration = 10,
+		.warmup = 2,
+		.video_sources = 1,
+		.audio_sources = 1,
+		.base_width = 1920,
+		.base_height = 1080,
+		.fps = 60,
+		.encoder_id = "obs_x264",
+		.bitrate = 6000,
+	};
+	const char *report_file = NULL;
+	int ret = EXIT_FAILURE;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "d:w:n:r:s:f:e:b:a:o:vh",
+				  long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'd':
+			b.duration = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			b.warmup = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			b.video_sources = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case OPT_TONES:
+			b.audio_sources = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			if (!parse_resolution(optarg, &b.base_width,
+					      &b.base_height)) {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 's':
+			if (!parse_resolution(optarg, &b.output_width,
+					      &b.output_height)) {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'f':
+			b.fps = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'e':
+			b.encoder_id = optarg;
+			break;
+		case 'b':
+			b.bitrate = atoi(optarg);
+			break;
+		case 'a':
+			b.adapter = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			report_file = optarg;
+			break;
+		case 'v':
+			log_verbosity = LOG_DEBUG;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if (!b.duration || !b.fps || b.bitrate <= 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!b.output_width) {
+		b.output_width = b.base_width;
+		b.output_height = b.base_height;
+	}
+
+	base_set_log_handler(do_log, NULL);
+	signal(SIGINT, signal_handler);
+	signal(SIGTERM, signal_handler);
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_SURFACELESS);
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		blog(LOG_ERROR, "Failed to initialize libobs");
+		return EXIT_FAILURE;
+	}
+
+	if (!reset_audio() || !reset_video(&b))
+		goto fail;
+
+	struct obs_module_failure_info mfi;
+	obs_load_all_modules2(&mfi);
+	obs_module_failure_info_free(&mfi);
+	obs_post_load_modules();
+
+	obs_set_gpu_source_timing(true);
+
+	if (!create_scene(&b) || !create_output(&b))
+		goto fail;
+
+	if (run_benchmark(&b, report_file))
+		ret = EXIT_SUCCESS;
+
+fail:
+	free_benchmark(&b);
+	obs_shutdown();
+	return ret;
+}
@@ -0,0 +1,802 @@
+/* obs-microbench.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* Microbenchmarks of the util/, callback/ and media-io/ primitives.
+ *
+ * Every benchmark runs its loop b->iterations times between bench_start()
+ * and bench_stop(), setup and cleanup outside of those are not measured.
+ * The runner doubles the iterations until a run takes at least the minimum
+ * time and reports the time per iteration of that run, plus the throughput
+ * for benchmarks that set b->bytes.  Sizes are those of a 1080p canvas and
+ * of an audio tick at 48 kHz.
+ *
+ * Arguments that are not options select the benchmarks whose name contains
+ * any of them.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs-data.h>
+#include <callback/calldata.h>
+#include <callback/signal.h>
+#include <media-io/audio-math.h>
+#include <media-io/audio-resampler.h>
+#include <media-io/format-conversion.h>
+#include <media-io/video-scaler.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/deque.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+
+#define DEFAULT_MIN_TIME_MS 200
+#define MAX_ITERATIONS (1ULL << 32)
+
+#define VIDEO_WIDTH 1920
+#define VIDEO_HEIGHT 1080
+#define AUDIO_FRAMES 1024
+
+struct bench {
+	uint64_t iterations;
+	uint64_t bytes;
+	uint64_t start_ns;
+	uint64_t elapsed_ns;
+};
+
+struct bench_info {
+	const char *name;
+	void (*run)(struct bench *b);
+};
+
+/* results are added here so the compiler can't drop the measured code */
+static volatile uint64_t sink;
+
+static inline void bench_start(struct bench *b)
+{
+	b->start_ns = os_gettime_ns();
+}
+
+static inline void bench_stop(struct bench *b)
+{
+	b->elapsed_ns = os_gettime_ns() - b->start_ns;
+}
+
+static void fill_random(void *data, size_t size)
+{
+	uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++)
+		bytes[i] = (uint8_t)rand();
+}
+
+static void fill_random_float(float *data, size_t count, float range)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) *
+			  range;
+}
+
+/* ------------------------------------------------------------------------- */
+/* util                                                                      */
+
+static void bench_darray_push_back(struct bench *b)
+{
+	DARRAY(int) da;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		da_init(da);
+		for (int j = 0; j < 1024; j++)
+			da_push_back(da, &j);
+		sink += da.num;
+		da_free(da);
+	}
+	bench_stop(b);
+}
+
+static void bench_darray_insert_erase(struct bench *b)
+{
+	DARRAY(int) da;
+
+	da_init(da);
+	for (int j = 0; j < 256; j++)
+		da_push_back(da, &j);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		int val = (int)i;
+		da_insert(da, 0, &val);
+		da_erase(da, da.num / 2);
+	}
+	bench_stop(b);
+
+	sink += da.array[0];
+	da_free(da);
+}
+
+static void bench_deque_audio(struct bench *b)
+{
+	float in[AUDIO_FRAMES] = {0};
+	float out[AUDIO_FRAMES];
+	struct deque dq;
+
+	deque_init(&dq);
+	b->bytes = sizeof(in) * 2;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		deque_push_back(&dq, in, sizeof(in));
+		deque_push_back(&dq, in, sizeof(in));
+		deque_pop_front(&dq, out, sizeof(out));
+		deque_pop_front(&dq, out, sizeof(out));
+	}
+	bench_stop(b);
+
+	sink += dq.size;
+	deque_free(&dq);
+}
+
+static void bench_dstr_cat(struct bench *b)
+{
+	struct dstr str = {0};
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		dstr_resize(&str, 0);
+		for (int j = 0; j < 256; j++)
+			dstr_cat(&str, "0123456789abcdef");
+	}
+	bench_stop(b);
+
+	sink += str.len;
+	dstr_free(&str);
+}
+
+static void bench_dstr_printf(struct bench *b)
+{
+	struct dstr str = {0};
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		dstr_printf(&str, "%s: %" PRIu64 " frames, %.2f ms", "output",
+			    i, (double)i / 1000.0);
+	bench_stop(b);
+
+	sink += str.len;
+	dstr_free(&str);
+}
+
+#define DATA_KEYS 32
+
+static void make_keys(char keys[DATA_KEYS][16])
+{
+	for (int i = 0; i < DATA_KEYS; i++)
+		snprintf(keys[i], 16, "key_%d", i);
+}
+
+static void bench_obs_data_int(struct bench *b)
+{
+	char keys[DATA_KEYS][16];
+	obs_data_t *data = obs_data_create();
+
+	make_keys(keys);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (int j = 0; j < DATA_KEYS; j++)
+			obs_data_set_int(data, keys[j], (long long)i);
+		for (int j = 0; j < DATA_KEYS; j++)
+			sink += (uint64_t)obs_data_get_int(data, keys[j]);
+	}
+	bench_stop(b);
+
+	obs_data_release(data);
+}
+
+static void bench_obs_data_string(struct bench *b)
+{
+	char keys[DATA_KEYS][16];
+	obs_data_t *data = obs_data_create();
+
+	make_keys(keys);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (int j = 0; j < DATA_KEYS; j++)
+			obs_data_set_string(data, keys[j],
+					    keys[DATA_KEYS - 1 - j]);
+		for (int j = 0; j < DATA_KEYS; j++)
+			sink += strlen(obs_data_get_string(data, keys[j]));
+	}
+	bench_stop(b);
+
+	obs_data_release(data);
+}
+
+/* ------------------------------------------------------------------------- */
+/* callback                                                                  */
+
+static void bench_signal_callback(void *param, calldata_t *cd)
+{
+	sink += (uint64_t)calldata_int(cd, "val");
+	UNUSED_PARAMETER(param);
+}
+
+static signal_handler_t *create_signal_handler(void)
+{
+	signal_handler_t *handler = signal_handler_create();
+
+	signal_handler_add(handler, "void bench(int val)");
+	for (int i = 0; i < 4; i++)
+		signal_handler_connect(handler, "bench", bench_signal_callback,
+				       (void *)(intptr_t)i);
+	return handler;
+}
+
+static void bench_signal(struct bench *b)
+{
+	signal_handler_t *handler = create_signal_handler();
+	uint8_t stack[128];
+	calldata_t cd;
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		calldata_set_int(&cd, "val", (long long)i);
+		signal_handler_signal(handler, "bench", &cd);
+	}
+	bench_stop(b);
+
+	signal_handler_destroy(handler);
+}
+
+static void bench_signal_id(struct bench *b)
+{
+	signal_handler_t *handler = create_signal_handler();
+	signal_id_t id = signal_handler_get_id(handler, "bench");
+	uint8_t stack[128];
+	calldata_t cd;
+
+	calldata_init_fixed(&cd, stack, sizeof(stack));
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		calldata_set_int(&cd, "val", (long long)i);
+		signal_handler_signal_id(handler, id, &cd);
+	}
+	bench_stop(b);
+
+	signal_handler_destroy(handler);
+}
+
+static void bench_calldata(struct bench *b)
+{
+	calldata_t cd;
+
+	calldata_init(&cd);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		calldata_set_int(&cd, "frames", (long long)i);
+		calldata_set_string(&cd, "name", "program");
+		calldata_set_ptr(&cd, "source", &cd);
+		calldata_set_bool(&cd, "active", true);
+		sink += (uint64_t)calldata_int(&cd, "frames");
+		sink += strlen(calldata_string(&cd, "name"));
+	}
+	bench_stop(b);
+
+	calldata_free(&cd);
+}
+
+/* ------------------------------------------------------------------------- */
+/* format conversion                                                         */
+
+struct video_planes {
+	uint8_t *data[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+};
+
+static void alloc_planes(struct video_planes *planes, uint32_t width,
+			 uint32_t height, enum video_format format)
+{
+	memset(planes, 0, sizeof(*planes));
+
+	switch (format) {
+	case VIDEO_FORMAT_NV12:
+		planes->linesize[0] = width;
+		planes->linesize[1] = width;
+		planes->data[0] = bmalloc(width * height);
+		planes->data[1] = bmalloc(width * height / 2);
+		break;
+	case VIDEO_FORMAT_I420:
+		planes->linesize[0] = width;
+		planes->linesize[1] = width / 2;
+		planes->linesize[2] = width / 2;
+		planes->data[0] = bmalloc(width * height);
+		planes->data[1] = bmalloc(width * height / 4);
+		planes->data[2] = bmalloc(width * height / 4);
+		break;
+	default:
+		planes->linesize[0] = width * 4;
+		planes->data[0] = bmalloc(width * height * 4);
+		break;
+	}
+
+	for (size_t i = 0; i < MAX_AV_PLANES && planes->data[i]; i++)
+		fill_random(planes->data[i],
+			    planes->linesize[i] * (i ? height / 2 : height));
+}
+
+static void free_planes(struct video_planes *planes)
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		bfree(planes->data[i]);
+}
+
+#define PLANES(p) ((const uint8_t *const *)(p).data)
+
+static void bench_compress_uyvx_to_nv12(struct bench *b)
+{
+	struct video_planes in, out;
+
+	alloc_planes(&in, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_BGRA);
+	alloc_planes(&out, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_NV12);
+	b->bytes = VIDEO_WIDTH * VIDEO_HEIGHT * 4;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		compress_uyvx_to_nv12(in.data[0], in.linesize[0], 0,
+				      VIDEO_HEIGHT, out.data, out.linesize);
+	bench_stop(b);
+
+	free_planes(&in);
+	free_planes(&out);
+}
+
+static void bench_decompress_nv12(struct bench *b)
+{
+	struct video_planes in, out;
+
+	alloc_planes(&in, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_NV12);
+	alloc_planes(&out, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_BGRA);
+	b->bytes = VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		decompress_nv12(PLANES(in), in.linesize, 0, VIDEO_HEIGHT,
+				out.data[0], out.linesize[0]);
+	bench_stop(b);
+
+	free_planes(&in);
+	free_planes(&out);
+}
+
+static void bench_convert_rgba_to_nv12(struct bench *b)
+{
+	struct video_planes in, out;
+
+	alloc_planes(&in, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_BGRA);
+	alloc_planes(&out, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_NV12);
+	b->bytes = VIDEO_WIDTH * VIDEO_HEIGHT * 4;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		convert_rgba_to_nv12_709(in.data[0], in.linesize[0],
+					 VIDEO_WIDTH, 0, VIDEO_HEIGHT,
+					 out.data, out.linesize, true);
+	bench_stop(b);
+
+	free_planes(&in);
+	free_planes(&out);
+}
+
+static void bench_convert_nv12_to_i420(struct bench *b)
+{
+	struct video_planes in, out;
+
+	alloc_planes(&in, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_NV12);
+	alloc_planes(&out, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_I420);
+	b->bytes = VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		convert_nv12_to_i420(PLANES(in), in.linesize, VIDEO_WIDTH, 0,
+				     VIDEO_HEIGHT, out.data, out.linesize);
+	bench_stop(b);
+
+	free_planes(&in);
+	free_planes(&out);
+}
+
+static void bench_downscale_nv12_2x(struct bench *b)
+{
+	struct video_planes in, out;
+
+	alloc_planes(&in, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FORMAT_NV12);
+	alloc_planes(&out, VIDEO_WIDTH / 2, VIDEO_HEIGHT / 2,
+		     VIDEO_FORMAT_NV12);
+	b->bytes = VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		downscale_nv12_2x(PLANES(in), in.linesize, VIDEO_WIDTH / 2, 0,
+				  VIDEO_HEIGHT / 2, out.data, out.linesize);
+	bench_stop(b);
+
+	free_planes(&in);
+	free_planes(&out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* video scaler                                                              */
+
+static void run_video_scaler(struct bench *b, enum video_format in_format,
+			     enum video_format out_format, uint32_t out_width,
+			     uint32_t out_height)
+{
+	struct video_scale_info src = {
+		.format = in_format,
+		.width = VIDEO_WIDTH,
+		.height = VIDEO_HEIGHT,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = VIDEO_CS_709,
+	};
+	struct video_scale_info dst = {
+		.format = out_format,
+		.width = out_width,
+		.height = out_height,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = VIDEO_CS_709,
+	};
+	struct video_planes in, out;
+	video_scaler_t *scaler;
+
+	if (video_scaler_create(&scaler, &dst, &src, VIDEO_SCALE_BICUBIC) !=
+	    VIDEO_SCALER_SUCCESS) {
+		fprintf(stderr, "failed to create video scaler\n");
+		return;
+	}
+
+	alloc_planes(&in, VIDEO_WIDTH, VIDEO_HEIGHT, in_format);
+	alloc_planes(&out, out_width, out_height, out_format);
+	b->bytes = VIDEO_WIDTH * VIDEO_HEIGHT *
+		   (in_format == VIDEO_FORMAT_NV12 ? 3 : 8) / 2;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		video_scaler_scale(scaler, out.data, out.linesize, PLANES(in),
+				   in.linesize);
+	bench_stop(b);
+
+	free_planes(&in);
+	free_planes(&out);
+	video_scaler_destroy(scaler);
+}
+
+static void bench_video_scaler_nv12_720p(struct bench *b)
+{
+	run_video_scaler(b, VIDEO_FORMAT_NV12, VIDEO_FORMAT_NV12, 1280, 720);
+}
+
+static void bench_video_scaler_nv12_to_i420(struct bench *b)
+{
+	run_video_scaler(b, VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420, VIDEO_WIDTH,
+			 VIDEO_HEIGHT);
+}
+
+static void bench_video_scaler_bgra_to_nv12(struct bench *b)
+{
+	run_video_scaler(b, VIDEO_FORMAT_BGRA, VIDEO_FORMAT_NV12, VIDEO_WIDTH,
+			 VIDEO_HEIGHT);
+}
+
+/* ------------------------------------------------------------------------- */
+/* audio                                                                     */
+
+static float audio_a[AUDIO_FRAMES];
+static float audio_b[AUDIO_FRAMES];
+static float audio_c[AUDIO_FRAMES];
+
+static void init_audio_buffers(void)
+{
+	fill_random_float(audio_a, AUDIO_FRAMES, 1.0f);
+	fill_random_float(audio_b, AUDIO_FRAMES, 1.0f);
+	for (size_t i = 0; i < AUDIO_FRAMES; i++)
+		audio_c[i] = (float)i / (float)AUDIO_FRAMES;
+}
+
+static void bench_audio_mix_add(struct bench *b)
+{
+	init_audio_buffers();
+	b->bytes = sizeof(audio_a);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		audio_mix_add(audio_a, audio_b, AUDIO_FRAMES);
+	bench_stop(b);
+
+	sink += (uint64_t)audio_a[0];
+}
+
+static void bench_audio_mul_ramp(struct bench *b)
+{
+	init_audio_buffers();
+	b->bytes = sizeof(audio_a);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		audio_mul_ramp(audio_a, audio_c, AUDIO_FRAMES);
+	bench_stop(b);
+
+	sink += (uint64_t)audio_a[0];
+}
+
+static void bench_audio_mul_to_db(struct bench *b)
+{
+	b->bytes = sizeof(audio_a);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		/* refill, the conversion is done in place */
+		memcpy(audio_a, audio_c, sizeof(audio_a));
+		audio_mul_to_db(audio_a, AUDIO_FRAMES);
+	}
+	bench_stop(b);
+
+	sink += (uint64_t)audio_a[1];
+}
+
+static void bench_audio_compressor_gain(struct bench *b)
+{
+	init_audio_buffers();
+	b->bytes = sizeof(audio_a);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		audio_compressor_gain(audio_b, audio_c, -18.0f, 0.75f, 1.0f,
+				      AUDIO_FRAMES);
+	bench_stop(b);
+
+	sink += (uint64_t)audio_b[0];
+}
+
+/* the per-sample formula audio_compressor_gain replaces, for comparison */
+static void bench_audio_compressor_gain_scalar(struct bench *b)
+{
+	init_audio_buffers();
+	b->bytes = sizeof(audio_a);
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (size_t j = 0; j < AUDIO_FRAMES; j++) {
+			float g = 0.75f * (-18.0f - mul_to_db(audio_c[j]));
+			audio_b[j] = db_to_mul(fminf(0, g));
+		}
+	}
+	bench_stop(b);
+
+	sink += (uint64_t)audio_b[0];
+}
+
+static void bench_audio_envelope_peak(struct bench *b)
+{
+	float *channels[2] = {audio_a, audio_b};
+
+	init_audio_buffers();
+	b->bytes = sizeof(audio_a) * 2;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++)
+		audio_envelope_peak(audio_c, channels, 2, AUDIO_FRAMES, 0.0f,
+				    0.01f, 0.0001f);
+	bench_stop(b);
+
+	sink += (uint64_t)audio_c[0];
+}
+
+static void run_audio_resampler(struct bench *b, uint32_t in_rate,
+				enum audio_format in_format)
+{
+	struct resample_info src = {
+		.samples_per_sec = in_rate,
+		.format = in_format,
+		.speakers = SPEAKERS_STEREO,
+	};
+	struct resample_info dst = {
+		.samples_per_sec = 48000,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers = SPEAKERS_STEREO,
+	};
+	audio_resampler_t *resampler = audio_resampler_create(&dst, &src);
+	uint8_t *input[MAX_AV_PLANES] = {0};
+	uint8_t *output[MAX_AV_PLANES];
+	uint32_t out_frames;
+	uint64_t ts_offset;
+	size_t size = AUDIO_FRAMES * 2 * sizeof(float);
+
+	if (!resampler) {
+		fprintf(stderr, "failed to create audio resampler\n");
+		return;
+	}
+
+	input[0] = bmalloc(size);
+	fill_random_float((float *)input[0], AUDIO_FRAMES * 2, 1.0f);
+	b->bytes = size;
+
+	bench_start(b);
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		audio_resampler_resample(resampler, output, &out_frames,
+					 &ts_offset,
+					 (const uint8_t *const *)input,
+					 AUDIO_FRAMES);
+		sink += out_frames;
+	}
+	bench_stop(b);
+
+	bfree(input[0]);
+	audio_resampler_destroy(resampler);
+}
+
+static void bench_audio_resampler_44100(struct bench *b)
+{
+	run_audio_resampler(b, 44100, AUDIO_FORMAT_16BIT);
+}
+
+static void bench_audio_resampler_repack(struct bench *b)
+{
+	run_audio_resampler(b, 48000, AUDIO_FORMAT_FLOAT);
+}
+
+/* ------------------------------------------------------------------------- */
+/* runner                                                                    */
+
+static const struct bench_info benchmarks[] = {
+	{"darray/push_back_1k", bench_darray_push_back},
+	{"darray/insert_erase_256", bench_darray_insert_erase},
+	{"deque/audio_1024", bench_deque_audio},
+	{"dstr/cat_4k", bench_dstr_cat},
+	{"dstr/printf", bench_dstr_printf},
+	{"obs_data/int_32", bench_obs_data_int},
+	{"obs_data/string_32", bench_obs_data_string},
+	{"signal/by_name", bench_signal},
+	{"signal/by_id", bench_signal_id},
+	{"calldata/set_get", bench_calldata},
+	{"format/compress_uyvx_to_nv12", bench_compress_uyvx_to_nv12},
+	{"format/decompress_nv12", bench_decompress_nv12},
+	{"format/convert_rgba_to_nv12_709", bench_convert_rgba_to_nv12},
+	{"format/convert_nv12_to_i420", bench_convert_nv12_to_i420},
+	{"format/downscale_nv12_2x", bench_downscale_nv12_2x},
+	{"video_scaler/nv12_1080p_to_720p", bench_video_scaler_nv12_720p},
+	{"video_scaler/nv12_to_i420", bench_video_scaler_nv12_to_i420},
+	{"video_scaler/bgra_to_nv12", bench_video_scaler_bgra_to_nv12},
+	{"audio_math/mix_add", bench_audio_mix_add},
+	{"audio_math/mul_ramp", bench_audio_mul_ramp},
+	{"audio_math/mul_to_db", bench_audio_mul_to_db},
+	{"audio_math/compressor_gain", bench_audio_compressor_gain},
+	{"audio_math/compressor_gain_scalar",
+	 bench_audio_compressor_gain_scalar},
+	{"audio_math/envelope_peak_stereo", bench_audio_envelope_peak},
+	{"audio_resampler/s16_44100_to_48000", bench_audio_resampler_44100},
+	{"audio_resampler/float_to_planar", bench_audio_resampler_repack},
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static bool selected(const char *name, char **filters, int num_filters)
+{
+	if (!num_filters)
+		return true;
+
+	for (int i = 0; i < num_filters; i++) {
+		if (strstr(name, filters[i]))
+			return true;
+	}
+
+	return false;
+}
+
+static void run_one(const struct bench_info *info, uint64_t min_time_ns)
+{
+	struct bench b = {.iterations = 1};
+
+	for (;;) {
+		b.bytes = 0;
+		b.elapsed_ns = 0;
+		info->run(&b);
+
+		if (b.elapsed_ns >= min_time_ns ||
+		    b.iterations >= MAX_ITERATIONS)
+			break;
+
+		b.iterations *= 2;
+	}
+
+	double ns_per_iter = (double)b.elapsed_ns / (double)b.iterations;
+
+	printf("%-40s %12" PRIu64 " %14.1f", info->name, b.iterations,
+	       ns_per_iter);
+	if (b.bytes && ns_per_iter > 0.0)
+		printf(" %12.1f", (double)b.bytes / ns_per_iter * 1e9 / 1e6);
+	printf("\n");
+	fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [options] [filter]...\n"
+		"\n"
+		"  -t, --min-time <ms>       minimum time per benchmark "
+		"(default %d)\n"
+		"  -l, --list                list the benchmarks\n"
+		"  -h, --help                show this help\n",
+		name, DEFAULT_MIN_TIME_MS);
+}
+
+static inline bool is_option(const char *arg, const char *short_name,
+			     const char *long_name)
+{
+	return strcmp(arg, short_name) == 0 || strcmp(arg, long_name) == 0;
+}
+
+/* no getopt, this also has to build with MSVC */
+int main(int argc, char *argv[])
+{
+	uint64_t min_time_ms = DEFAULT_MIN_TIME_MS;
+	bool list = false;
+	int arg = 1;
+
+	for (; arg < argc && argv[arg][0] == '-'; arg++) {
+		const char *opt = argv[arg];
+
+		if (is_option(opt, "-t", "--min-time") && arg + 1 < argc) {
+			min_time_ms = strtoull(argv[++arg], NULL, 10);
+		} else if (is_option(opt, "-l", "--list")) {
+			list = true;
+		} else {
+			usage(argv[0]);
+			return is_option(opt, "-h", "--help") ? EXIT_SUCCESS
+							      : EXIT_FAILURE;
+		}
+	}
+
+	char **filters = argv + arg;
+	int num_filters = argc - arg;
+
+	if (list) {
+		for (size_t i = 0; i < NUM_BENCHMARKS; i++)
+			printf("%s\n", benchmarks[i].name);
+		return EXIT_SUCCESS;
+	}
+
+	srand(1);
+
+	printf("%-40s %12s %14s %12s\n", "benchmark", "iterations", "ns/iter",
+	       "MB/s");
+
+	for (size_t i = 0; i < NUM_BENCHMARKS; i++) {
+		if (selected(benchmarks[i].name, filters, num_filters))
+			run_one(&benchmarks[i], min_time_ms * 1000000ULL);
+	}
+
+	return EXIT_SUCCESS;
+}
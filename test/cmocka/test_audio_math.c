@@ -0,0 +1,228 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <media-io/audio-math.h>
+
+/* not a multiple of four to also exercise the scalar tails */
+#define TEST_FRAMES 1027
+
+static float in[TEST_FRAMES];
+static float vol[TEST_FRAMES];
+static float out_ref[TEST_FRAMES];
+static float out_test[TEST_FRAMES];
+
+static void fill_random(float *data, size_t count, float range)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) *
+			  range;
+}
+
+static void setup_buffers(void)
+{
+	fill_random(in, TEST_FRAMES, 1.0f);
+	fill_random(vol, TEST_FRAMES, 1.0f);
+	fill_random(out_ref, TEST_FRAMES, 1.0f);
+	memcpy(out_test, out_ref, sizeof(out_ref));
+}
+
+static void mix_add_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	setup_buffers();
+
+	for (size_t i = 0; i < TEST_FRAMES; i++)
+		out_ref[i] += in[i];
+
+	audio_mix_add(out_test, in, TEST_FRAMES);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void mix_add_mul_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	setup_buffers();
+
+	for (size_t i = 0; i < TEST_FRAMES; i++)
+		out_ref[i] += in[i] * vol[i];
+
+	audio_mix_add_mul(out_test, in, vol, TEST_FRAMES);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void mul_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	setup_buffers();
+
+	for (size_t i = 0; i < TEST_FRAMES; i++)
+		out_ref[i] *= 0.3f;
+
+	audio_mul(out_test, 0.3f, TEST_FRAMES);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void mul_ramp_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	setup_buffers();
+
+	for (size_t i = 0; i < TEST_FRAMES; i++)
+		out_ref[i] *= vol[i];
+
+	audio_mul_ramp(out_test, vol, TEST_FRAMES);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void clamp_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	fill_random(out_test, TEST_FRAMES, 4.0f);
+	out_test[0] = NAN;
+	out_test[5] = -NAN;
+	out_test[6] = INFINITY;
+	out_test[7] = -INFINITY;
+	out_test[TEST_FRAMES - 1] = NAN;
+
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		float val = out_test[i];
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		out_ref[i] = val;
+	}
+
+	audio_clamp(out_test, TEST_FRAMES);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void fast_db_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	for (size_t i = 0; i < TEST_FRAMES; i++)
+		out_test[i] = powf(10.0f, -6.0f * (float)i / TEST_FRAMES);
+	out_test[3] = 0.0f;
+	memcpy(out_ref, out_test, sizeof(out_ref));
+
+	audio_mul_to_db(out_test, TEST_FRAMES);
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		if (out_ref[i] == 0.0f) {
+			assert_true(isinf(out_test[i]) && out_test[i] < 0.0f);
+			continue;
+		}
+		assert_true(fabsf(out_test[i] - mul_to_db(out_ref[i])) <
+			    0.001f);
+	}
+
+	/* round trip, with the silent sample coming back as silence */
+	audio_db_to_gain(out_test, out_test, INFINITY, 1.0f, TEST_FRAMES);
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		float err = fabsf(mul_to_db(out_test[i]) -
+				  mul_to_db(out_ref[i]));
+		if (out_ref[i] == 0.0f)
+			assert_true(out_test[i] == 0.0f);
+		else
+			assert_true(err < 0.001f);
+	}
+}
+
+static void envelope_peak_ref(float *env_buf, float *const *samples,
+			      size_t channels, size_t count, float env,
+			      float attack, float release)
+{
+	memset(env_buf, 0, count * sizeof(float));
+	for (size_t c = 0; c < channels; c++) {
+		if (!samples[c])
+			continue;
+
+		float e = env;
+		for (size_t i = 0; i < count; i++) {
+			const float env_in = fabsf(samples[c][i]);
+			if (e < env_in)
+				e = env_in + attack * (e - env_in);
+			else
+				e = env_in + release * (e - env_in);
+			env_buf[i] = fmaxf(env_buf[i], e);
+		}
+	}
+}
+
+static void envelope_peak_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static float chan_data[5][TEST_FRAMES];
+	float *samples[5];
+
+	for (size_t c = 0; c < 5; c++) {
+		fill_random(chan_data[c], TEST_FRAMES, 1.0f);
+		samples[c] = chan_data[c];
+	}
+
+	/* channels beyond the first vector, and a skipped channel */
+	const size_t counts[] = {1, 3, 5};
+	for (size_t t = 0; t < 3; t++) {
+		samples[1] = t == 2 ? NULL : chan_data[1];
+
+		envelope_peak_ref(out_ref, samples, counts[t], TEST_FRAMES,
+				  0.25f, 0.9f, 0.999f);
+		audio_envelope_peak(out_test, samples, counts[t], TEST_FRAMES,
+				    0.25f, 0.9f, 0.999f);
+		assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+	}
+}
+
+static void compressor_gain_ref(float *gain, const float *env,
+				float threshold, float slope, float mul,
+				size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float g = slope * (threshold - mul_to_db(env[i]));
+		gain[i] = db_to_mul(fminf(0, g)) * mul;
+	}
+}
+
+static void compressor_gain_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	fill_random(in, TEST_FRAMES, 1.0f);
+	for (size_t i = 0; i < TEST_FRAMES; i++)
+		in[i] = fabsf(in[i]);
+	in[0] = 0.0f;
+
+	compressor_gain_ref(out_ref, in, -18.0f, 0.75f, 1.5f, TEST_FRAMES);
+	audio_compressor_gain(out_test, in, -18.0f, 0.75f, 1.5f, TEST_FRAMES);
+
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		float err = fabsf(mul_to_db(out_test[i]) -
+				  mul_to_db(out_ref[i]));
+		assert_true(err < 0.001f);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(mix_add_test),
+		cmocka_unit_test(mix_add_mul_test),
+		cmocka_unit_test(mul_test),
+		cmocka_unit_test(mul_ramp_test),
+		cmocka_unit_test(clamp_test),
+		cmocka_unit_test(fast_db_test),
+		cmocka_unit_test(envelope_peak_test),
+		cmocka_unit_test(compressor_gain_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,116 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <media-io/audio-repack.h>
+
+#define FRAMES 5
+
+/* sample value encodes the frame and channel it came from */
+#define SAMPLE(frame, ch) ((frame) * 16 + (ch) + 1)
+
+static void fill16(uint16_t *src)
+{
+	for (int f = 0; f < FRAMES; f++)
+		for (int ch = 0; ch < 8; ch++)
+			src[f * 8 + ch] = (uint16_t)SAMPLE(f, ch);
+}
+
+static void fill32(uint32_t *src)
+{
+	for (int f = 0; f < FRAMES; f++)
+		for (int ch = 0; ch < 8; ch++)
+			src[f * 8 + ch] = (uint32_t)SAMPLE(f, ch) << 16;
+}
+
+static int source_channel(int ch, bool swap)
+{
+	if (swap && ch == 2)
+		return 3;
+	if (swap && ch == 3)
+		return 2;
+	return ch;
+}
+
+static void check_mode(audio_repack_mode_t mode, int channels, bool swap)
+{
+	struct audio_repack repack;
+	uint16_t src16[FRAMES * 8];
+	uint32_t src32[FRAMES * 8];
+
+	fill16(src16);
+	assert_int_equal(audio_repack_init(&repack, mode, 16), 0);
+	assert_int_equal(repack.repack_func(&repack, (uint8_t *)src16, FRAMES),
+			 0);
+
+	const uint16_t *dst16 = (const uint16_t *)repack.packet_buffer;
+	for (int f = 0; f < FRAMES; f++)
+		for (int ch = 0; ch < channels; ch++)
+			assert_int_equal(dst16[f * channels + ch],
+					 SAMPLE(f, source_channel(ch, swap)));
+	audio_repack_free(&repack);
+
+	fill32(src32);
+	assert_int_equal(audio_repack_init(&repack, mode, 32), 0);
+	assert_int_equal(repack.repack_func(&repack, (uint8_t *)src32, FRAMES),
+			 0);
+
+	const uint32_t *dst32 = (const uint32_t *)repack.packet_buffer;
+	for (int f = 0; f < FRAMES; f++)
+		for (int ch = 0; ch < channels; ch++)
+			assert_int_equal(dst32[f * channels + ch],
+					 (uint32_t)SAMPLE(
+						 f, source_channel(ch, swap))
+						 << 16);
+	audio_repack_free(&repack);
+}
+
+static void squash_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	check_mode(repack_mode_8to1ch, 1, false);
+	check_mode(repack_mode_8to2ch, 2, false);
+	check_mode(repack_mode_8to3ch, 3, false);
+	check_mode(repack_mode_8to4ch, 4, false);
+	check_mode(repack_mode_8to5ch, 5, false);
+	check_mode(repack_mode_8to6ch, 6, false);
+	check_mode(repack_mode_8ch, 8, false);
+}
+
+static void swap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	check_mode(repack_mode_8to5ch_swap, 5, true);
+	check_mode(repack_mode_8to6ch_swap, 6, true);
+	check_mode(repack_mode_8ch_swap, 8, true);
+}
+
+static void get_mode_test(void **state)
+{
+	audio_repack_mode_t mode;
+
+	UNUSED_PARAMETER(state);
+
+	assert_true(audio_repack_get_mode(SPEAKERS_STEREO, false, &mode));
+	assert_int_equal(mode, repack_mode_8to2ch);
+	assert_true(audio_repack_get_mode(SPEAKERS_5POINT1, true, &mode));
+	assert_int_equal(mode, repack_mode_8to6ch_swap);
+	assert_true(audio_repack_get_mode(SPEAKERS_MONO, true, &mode));
+	assert_int_equal(mode, repack_mode_8to1ch);
+	assert_false(audio_repack_get_mode(SPEAKERS_UNKNOWN, false, &mode));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(squash_test),
+		cmocka_unit_test(swap_test),
+		cmocka_unit_test(get_mode_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,117 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/config-file.h>
+#include <util/platform.h>
+
+#define TEST_FILE "test_config_file.ini"
+
+static int64_t read_value(void)
+{
+	config_t *config;
+	int64_t value;
+
+	if (config_open(&config, TEST_FILE, CONFIG_OPEN_EXISTING) !=
+	    CONFIG_SUCCESS)
+		return -1;
+
+	value = config_get_int(config, "Test", "Value");
+	config_close(config);
+	return value;
+}
+
+static config_t *create_config(void)
+{
+	config_t *config = config_create(TEST_FILE);
+	assert_non_null(config);
+	return config;
+}
+
+static void deferred_flush_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	config_t *config = create_config();
+
+	for (int i = 1; i <= 10; i++) {
+		config_set_int(config, "Test", "Value", i);
+		assert_int_equal(config_save_safe_deferred(config, "tmp", NULL),
+				 CONFIG_SUCCESS);
+	}
+
+	assert_int_equal(config_flush(config), CONFIG_SUCCESS);
+	assert_int_equal(read_value(), 10);
+
+	/* nothing is pending anymore */
+	assert_int_equal(config_flush(config), CONFIG_SUCCESS);
+
+	config_close(config);
+	os_unlink(TEST_FILE);
+}
+
+static void deferred_close_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	config_t *config = create_config();
+
+	config_set_int(config, "Test", "Value", 42);
+	config_save_safe_deferred(config, "tmp", NULL);
+	config_close(config);
+
+	assert_int_equal(read_value(), 42);
+	os_unlink(TEST_FILE);
+}
+
+static void deferred_background_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	config_t *config = create_config();
+
+	config_set_int(config, "Test", "Value", 7);
+	config_save_safe_deferred(config, "tmp", NULL);
+
+	for (int i = 0; i < 100 && read_value() != 7; i++)
+		os_sleep_ms(100);
+
+	assert_int_equal(read_value(), 7);
+
+	config_close(config);
+	os_unlink(TEST_FILE);
+}
+
+static void deferred_superseded_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	config_t *config = create_config();
+
+	config_set_int(config, "Test", "Value", 1);
+	config_save_safe_deferred(config, "tmp", NULL);
+
+	config_set_int(config, "Test", "Value", 2);
+	assert_int_equal(config_save_safe(config, "tmp", NULL),
+			 CONFIG_SUCCESS);
+	assert_int_equal(read_value(), 2);
+
+	/* the synchronous save already wrote everything, so a later
+	 * deferred write would be redundant */
+	os_unlink(TEST_FILE);
+	config_close(config);
+	assert_int_equal(read_value(), -1);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(deferred_flush_test),
+		cmocka_unit_test(deferred_close_test),
+		cmocka_unit_test(deferred_background_test),
+		cmocka_unit_test(deferred_superseded_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
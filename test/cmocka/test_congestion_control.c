@@ -0,0 +1,134 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/congestion-control.h>
+
+#define STEP_NS 100000000ULL
+#define AUDIO_KBPS 160
+#define BASE_RTT_US 40000
+#define SOCKET_BUFFER 65536.0
+
+/* a link with a fixed capacity that queues whatever it can't carry */
+struct link {
+	double capacity_kbps;
+	double queued;
+	uint64_t delivered;
+};
+
+static void link_step(struct link *link, uint32_t kbps,
+		      struct congestion_sample *sample)
+{
+	double sent = (double)(kbps + AUDIO_KBPS) * 1000.0 / 8.0 * 0.1;
+	double capacity = link->capacity_kbps * 1000.0 / 8.0 * 0.1;
+	double delivered;
+
+	link->queued += sent;
+	delivered = link->queued < capacity ? link->queued : capacity;
+	link->queued -= delivered;
+	link->delivered += (uint64_t)delivered;
+
+	/* the socket holds the first part of the queue, the output the rest */
+	double in_socket = link->queued < SOCKET_BUFFER ? link->queued
+							: SOCKET_BUFFER;
+	double in_output = link->queued - in_socket;
+
+	sample->bytes_delivered = link->delivered;
+	sample->bytes_in_flight = (uint64_t)in_socket;
+	sample->queue_delay_us =
+		(uint64_t)(in_output * 8.0 / (double)(kbps + AUDIO_KBPS) *
+			   1000.0);
+	sample->rtt_us = BASE_RTT_US +
+			 (uint32_t)(in_socket * 8.0 / link->capacity_kbps *
+				    1000.0);
+}
+
+static congestion_control_t *create_controller(void)
+{
+	struct congestion_control_config config = {
+		.max_kbps = 6000,
+		.min_kbps = 500,
+		.overhead_kbps = AUDIO_KBPS,
+	};
+	return congestion_control_create(&congestion_control_model, &config);
+}
+
+static void congestion_control_steady_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	congestion_control_t *cc = create_controller();
+	struct link link = {.capacity_kbps = 10000.0};
+	uint32_t kbps = 6000;
+
+	assert_non_null(cc);
+
+	for (uint64_t i = 1; i <= 600; i++) {
+		struct congestion_sample sample;
+		uint32_t new_kbps;
+
+		link_step(&link, kbps, &sample);
+		assert_false(congestion_control_update(cc, i * STEP_NS,
+						       &sample, &new_kbps));
+	}
+
+	assert_int_equal(congestion_control_get_bitrate(cc), 6000);
+	congestion_control_destroy(cc);
+}
+
+static void congestion_control_drop_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	congestion_control_t *cc = create_controller();
+	struct link link = {.capacity_kbps = 10000.0};
+	uint64_t last_change = 0;
+	uint32_t kbps = 6000;
+	int changes = 0;
+
+	assert_non_null(cc);
+
+	for (uint64_t i = 1; i <= 1200; i++) {
+		struct congestion_sample sample;
+		uint32_t new_kbps;
+		uint64_t ts = i * STEP_NS;
+
+		if (i == 100)
+			link.capacity_kbps = 3000.0;
+
+		link_step(&link, kbps, &sample);
+
+		if (congestion_control_update(cc, ts, &sample, &new_kbps)) {
+			/* changes are rate limited */
+			assert_true(ts - last_change >= 500000000ULL);
+			assert_int_not_equal(new_kbps, kbps);
+			kbps = new_kbps;
+			last_change = ts;
+			changes++;
+		}
+
+		/* reacts to the drop within a few seconds */
+		if (i == 150)
+			assert_true(kbps + AUDIO_KBPS < 3000);
+
+		/* and settles around capacity without queueing up again */
+		if (i > 300) {
+			assert_true(kbps + AUDIO_KBPS < 3300);
+			assert_true(link.queued * 8.0 / 3000.0 < 500.0);
+		}
+	}
+
+	assert_true(changes < 10);
+	congestion_control_destroy(cc);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(congestion_control_steady_test),
+		cmocka_unit_test(congestion_control_drop_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,51 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/deque.h>
+
+static void deque_spans_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque dq;
+	deque_init(&dq);
+
+	uint8_t data[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	deque_push_back(&dq, data, 8);
+
+	const void *data1, *data2;
+	size_t size1, size2;
+
+	/* contiguous */
+	deque_peek_front_spans(&dq, 6, &data1, &size1, &data2, &size2);
+	assert_int_equal(size1, 6);
+	assert_int_equal(size2, 0);
+	assert_memory_equal(data1, data, 6);
+	assert_ptr_equal(deque_peek_front_contiguous(&dq, 6), data1);
+
+	/* make the data wrap around the end of the buffer */
+	deque_pop_front(&dq, NULL, 6);
+	deque_push_back(&dq, data, 4);
+	assert_int_equal(dq.capacity, 8);
+
+	deque_peek_front_spans(&dq, 6, &data1, &size1, &data2, &size2);
+	assert_int_equal(size1, 2);
+	assert_int_equal(size2, 4);
+	assert_memory_equal(data1, data + 6, 2);
+	assert_memory_equal(data2, data, 4);
+	assert_null(deque_peek_front_contiguous(&dq, 6));
+	assert_non_null(deque_peek_front_contiguous(&dq, 2));
+
+	deque_free(&dq);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(deque_spans_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,346 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <media-io/format-conversion.h>
+
+/* odd width to also exercise the scalar tails after the vector loops */
+#define TEST_WIDTH 70
+#define TEST_HEIGHT 6
+
+static uint32_t out_ref[TEST_WIDTH * TEST_HEIGHT];
+static uint32_t out_test[TEST_WIDTH * TEST_HEIGHT];
+
+static void fill_random(void *data, size_t size, uint16_t mask)
+{
+	uint16_t *data16 = data;
+	for (size_t i = 0; i < size / 2; i++)
+		data16[i] = (uint16_t)rand() & mask;
+}
+
+static void reset_output(void)
+{
+	memset(out_ref, 0, sizeof(out_ref));
+	memset(out_test, 0, sizeof(out_test));
+}
+
+static void decompress_420_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t lum[TEST_WIDTH * TEST_HEIGHT];
+	uint8_t u[TEST_WIDTH / 2 * TEST_HEIGHT / 2];
+	uint8_t v[TEST_WIDTH / 2 * TEST_HEIGHT / 2];
+	const uint8_t *input[] = {lum, u, v};
+	const uint32_t linesize[] = {TEST_WIDTH, TEST_WIDTH / 2,
+				     TEST_WIDTH / 2};
+
+	fill_random(lum, sizeof(lum), 0xFFFF);
+	fill_random(u, sizeof(u), 0xFFFF);
+	fill_random(v, sizeof(v), 0xFFFF);
+	reset_output();
+
+	for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++) {
+			uint32_t c = (y / 2) * (TEST_WIDTH / 2) + x / 2;
+			out_ref[y * TEST_WIDTH + x] =
+				(lum[y * TEST_WIDTH + x] << 16) | (u[c] << 8) |
+				v[c];
+		}
+	}
+
+	decompress_420(input, linesize, 0, TEST_HEIGHT, (uint8_t *)out_test,
+		       TEST_WIDTH * 4);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void decompress_i010_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint16_t lum[TEST_WIDTH * TEST_HEIGHT];
+	uint16_t u[TEST_WIDTH / 2 * TEST_HEIGHT / 2];
+	uint16_t v[TEST_WIDTH / 2 * TEST_HEIGHT / 2];
+	const uint8_t *input[] = {(uint8_t *)lum, (uint8_t *)u, (uint8_t *)v};
+	const uint32_t linesize[] = {TEST_WIDTH * 2, TEST_WIDTH, TEST_WIDTH};
+
+	fill_random(lum, sizeof(lum), 0x3FF);
+	fill_random(u, sizeof(u), 0x3FF);
+	fill_random(v, sizeof(v), 0x3FF);
+	reset_output();
+
+	for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++) {
+			uint32_t c = (y / 2) * (TEST_WIDTH / 2) + x / 2;
+			out_ref[y * TEST_WIDTH + x] =
+				((lum[y * TEST_WIDTH + x] >> 2) << 16) |
+				((u[c] >> 2) << 8) | (v[c] >> 2);
+		}
+	}
+
+	decompress_i010(input, linesize, 0, TEST_HEIGHT, (uint8_t *)out_test,
+			TEST_WIDTH * 4);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void decompress_nv12_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t lum[TEST_WIDTH * TEST_HEIGHT];
+	uint8_t uv[TEST_WIDTH * TEST_HEIGHT / 2];
+	const uint8_t *input[] = {lum, uv};
+	const uint32_t linesize[] = {TEST_WIDTH, TEST_WIDTH};
+
+	fill_random(lum, sizeof(lum), 0xFFFF);
+	fill_random(uv, sizeof(uv), 0xFFFF);
+	reset_output();
+
+	for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++) {
+			uint32_t c = (y / 2) * TEST_WIDTH + (x / 2) * 2;
+			out_ref[y * TEST_WIDTH + x] = lum[y * TEST_WIDTH + x] |
+						      (uv[c] << 8) |
+						      (uv[c + 1] << 16);
+		}
+	}
+
+	decompress_nv12(input, linesize, 0, TEST_HEIGHT, (uint8_t *)out_test,
+			TEST_WIDTH * 4);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void decompress_p010_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint16_t lum[TEST_WIDTH * TEST_HEIGHT];
+	uint16_t uv[TEST_WIDTH * TEST_HEIGHT / 2];
+	const uint8_t *input[] = {(uint8_t *)lum, (uint8_t *)uv};
+	const uint32_t linesize[] = {TEST_WIDTH * 2, TEST_WIDTH * 2};
+
+	fill_random(lum, sizeof(lum), 0xFFC0);
+	fill_random(uv, sizeof(uv), 0xFFC0);
+	reset_output();
+
+	for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++) {
+			uint32_t c = (y / 2) * TEST_WIDTH + (x / 2) * 2;
+			out_ref[y * TEST_WIDTH + x] =
+				(lum[y * TEST_WIDTH + x] >> 8) |
+				((uv[c] >> 8) << 8) | ((uv[c + 1] >> 8) << 16);
+		}
+	}
+
+	decompress_p010(input, linesize, 0, TEST_HEIGHT, (uint8_t *)out_test,
+			TEST_WIDTH * 4);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void decompress_yuva444_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t planes[4][TEST_WIDTH * TEST_HEIGHT];
+	const uint8_t *input[] = {planes[0], planes[1], planes[2], planes[3]};
+	const uint32_t linesize[] = {TEST_WIDTH, TEST_WIDTH, TEST_WIDTH,
+				     TEST_WIDTH};
+
+	fill_random(planes, sizeof(planes), 0xFFFF);
+	reset_output();
+
+	for (uint32_t i = 0; i < TEST_WIDTH * TEST_HEIGHT; i++) {
+		out_ref[i] = ((uint32_t)planes[3][i] << 24) |
+			     (planes[0][i] << 16) | (planes[1][i] << 8) |
+			     planes[2][i];
+	}
+
+	decompress_yuva444(input, linesize, 0, TEST_HEIGHT,
+			   (uint8_t *)out_test, TEST_WIDTH * 4);
+	assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+}
+
+static void decompress_422_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t packed[TEST_WIDTH * 2 * TEST_HEIGHT];
+
+	fill_random(packed, sizeof(packed), 0xFFFF);
+
+	for (int leading_lum = 0; leading_lum < 2; leading_lum++) {
+		reset_output();
+
+		for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+			for (uint32_t x = 0; x < TEST_WIDTH; x += 2) {
+				const uint8_t *in = packed + y * TEST_WIDTH * 2 +
+						    x * 2;
+				uint8_t *out = (uint8_t *)&out_ref[y * TEST_WIDTH +
+								    x];
+
+				memcpy(out, in, 4);
+				memcpy(out + 4, in, 4);
+				if (leading_lum)
+					out[4] = in[2];
+				else
+					out[5] = in[3];
+			}
+		}
+
+		decompress_422(packed, TEST_WIDTH * 2, 0, TEST_HEIGHT,
+			       (uint8_t *)out_test, TEST_WIDTH * 4,
+			       leading_lum != 0);
+		assert_memory_equal(out_ref, out_test, sizeof(out_ref));
+	}
+}
+
+static void convert_nv12_to_i420_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t lum[TEST_WIDTH * TEST_HEIGHT];
+	uint8_t uv[TEST_WIDTH * TEST_HEIGHT / 2];
+	uint8_t ref[TEST_WIDTH * TEST_HEIGHT * 3 / 2];
+	uint8_t test[TEST_WIDTH * TEST_HEIGHT * 3 / 2];
+	const uint8_t *input[] = {lum, uv};
+	const uint32_t in_linesize[] = {TEST_WIDTH, TEST_WIDTH};
+	uint8_t *output[] = {test, test + TEST_WIDTH * TEST_HEIGHT,
+			     test + TEST_WIDTH * TEST_HEIGHT * 5 / 4};
+	const uint32_t out_linesize[] = {TEST_WIDTH, TEST_WIDTH / 2,
+					 TEST_WIDTH / 2};
+
+	fill_random(lum, sizeof(lum), 0xFFFF);
+	fill_random(uv, sizeof(uv), 0xFFFF);
+	memset(test, 0, sizeof(test));
+
+	memcpy(ref, lum, sizeof(lum));
+	for (size_t i = 0; i < sizeof(uv) / 2; i++) {
+		ref[TEST_WIDTH * TEST_HEIGHT + i] = uv[i * 2];
+		ref[TEST_WIDTH * TEST_HEIGHT * 5 / 4 + i] = uv[i * 2 + 1];
+	}
+
+	convert_nv12_to_i420(input, in_linesize, TEST_WIDTH, 0, TEST_HEIGHT,
+			     output, out_linesize);
+	assert_memory_equal(ref, test, sizeof(ref));
+}
+
+static void downscale_nv12_2x_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t lum[TEST_WIDTH * TEST_HEIGHT * 4];
+	uint8_t uv[TEST_WIDTH * TEST_HEIGHT * 2];
+	uint8_t ref[TEST_WIDTH * TEST_HEIGHT * 3 / 2];
+	uint8_t test[TEST_WIDTH * TEST_HEIGHT * 3 / 2];
+	const uint8_t *input[] = {lum, uv};
+	const uint32_t in_linesize[] = {TEST_WIDTH * 2, TEST_WIDTH * 2};
+	uint8_t *output[] = {test, test + TEST_WIDTH * TEST_HEIGHT};
+	const uint32_t out_linesize[] = {TEST_WIDTH, TEST_WIDTH};
+
+	fill_random(lum, sizeof(lum), 0xFFFF);
+	fill_random(uv, sizeof(uv), 0xFFFF);
+	memset(test, 0, sizeof(test));
+
+	for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++) {
+			const uint8_t *in =
+				lum + y * 2 * TEST_WIDTH * 2 + x * 2;
+			ref[y * TEST_WIDTH + x] =
+				(uint8_t)((in[0] + in[1] + in[TEST_WIDTH * 2] +
+					   in[TEST_WIDTH * 2 + 1] + 2) /
+					  4);
+		}
+	}
+	for (uint32_t y = 0; y < TEST_HEIGHT / 2; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++) {
+			const uint8_t *in = uv + y * 2 * TEST_WIDTH * 2 +
+					    (x / 2) * 4 + (x % 2);
+			ref[TEST_WIDTH * TEST_HEIGHT + y * TEST_WIDTH + x] =
+				(uint8_t)((in[0] + in[2] + in[TEST_WIDTH * 2] +
+					   in[TEST_WIDTH * 2 + 2] + 2) /
+					  4);
+		}
+	}
+
+	downscale_nv12_2x(input, in_linesize, TEST_WIDTH, 0, TEST_HEIGHT,
+			  output, out_linesize);
+	assert_memory_equal(ref, test, sizeof(ref));
+}
+
+static uint8_t bt709_component(const uint8_t *px, int r, int g, int b,
+			       int count, int offset)
+{
+	int sum = 0;
+	for (int i = 0; i < count; i++)
+		sum += r * px[i * 4] + g * px[i * 4 + 1] + b * px[i * 4 + 2];
+	/* rounds down like the arithmetic shift of the conversion */
+	int div = count * 256;
+	int val = (sum + count * 128 + div * 256) / div - 256;
+	return (uint8_t)(val + offset);
+}
+
+static void convert_rgba_to_nv12_709_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t rgba[TEST_WIDTH * TEST_HEIGHT * 4];
+	uint8_t ref[TEST_WIDTH * TEST_HEIGHT * 3 / 2];
+	uint8_t test[TEST_WIDTH * TEST_HEIGHT * 3 / 2];
+	uint8_t *output[] = {test, test + TEST_WIDTH * TEST_HEIGHT};
+	const uint32_t out_linesize[] = {TEST_WIDTH, TEST_WIDTH};
+
+	/* black and white to check the limits of partial range */
+	fill_random(rgba, sizeof(rgba), 0xFFFF);
+	memset(rgba, 0, 8);
+	memset(rgba + TEST_WIDTH * 4, 0, 8);
+	memset(rgba + 8, 0xFF, 8);
+	memset(rgba + TEST_WIDTH * 4 + 8, 0xFF, 8);
+	memset(test, 0, sizeof(test));
+
+	for (uint32_t y = 0; y < TEST_HEIGHT; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH; x++)
+			ref[y * TEST_WIDTH + x] = bt709_component(
+				rgba + (y * TEST_WIDTH + x) * 4, 47, 157, 16,
+				1, 16);
+	}
+	for (uint32_t y = 0; y < TEST_HEIGHT / 2; y++) {
+		for (uint32_t x = 0; x < TEST_WIDTH / 2; x++) {
+			uint8_t block[16];
+			const uint8_t *px =
+				rgba + (y * 2 * TEST_WIDTH + x * 2) * 4;
+			uint8_t *uv = ref + TEST_WIDTH * TEST_HEIGHT +
+				      y * TEST_WIDTH + x * 2;
+
+			memcpy(block, px, 8);
+			memcpy(block + 8, px + TEST_WIDTH * 4, 8);
+			uv[0] = bt709_component(block, -26, -87, 112, 4, 128);
+			uv[1] = bt709_component(block, 112, -102, -10, 4, 128);
+		}
+	}
+
+	convert_rgba_to_nv12_709(rgba, TEST_WIDTH * 4, TEST_WIDTH, 0,
+				 TEST_HEIGHT, output, out_linesize, false);
+	assert_memory_equal(ref, test, sizeof(ref));
+
+	assert_int_equal(test[0], 16);
+	assert_int_equal(test[2], 235);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(decompress_420_test),
+		cmocka_unit_test(decompress_i010_test),
+		cmocka_unit_test(decompress_nv12_test),
+		cmocka_unit_test(decompress_p010_test),
+		cmocka_unit_test(decompress_yuva444_test),
+		cmocka_unit_test(decompress_422_test),
+		cmocka_unit_test(convert_nv12_to_i420_test),
+		cmocka_unit_test(downscale_nv12_2x_test),
+		cmocka_unit_test(convert_rgba_to_nv12_709_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
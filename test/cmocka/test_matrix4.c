@@ -0,0 +1,82 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <graphics/matrix4.h>
+
+/* not a multiple of four to also exercise the scalar tail */
+#define TEST_TRANSFORMS 27
+
+static float scale_x[TEST_TRANSFORMS];
+static float scale_y[TEST_TRANSFORMS];
+static float origin_x[TEST_TRANSFORMS];
+static float origin_y[TEST_TRANSFORMS];
+static float rot[TEST_TRANSFORMS];
+static float pos_x[TEST_TRANSFORMS];
+static float pos_y[TEST_TRANSFORMS];
+
+static void fill_random(float *data, size_t count, float range)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) *
+			  range;
+}
+
+static void compose_2d_batch_test(void **state)
+{
+	struct matrix4 out[TEST_TRANSFORMS];
+	struct matrix4 *dst[TEST_TRANSFORMS];
+
+	UNUSED_PARAMETER(state);
+
+	fill_random(scale_x, TEST_TRANSFORMS, 4.0f);
+	fill_random(scale_y, TEST_TRANSFORMS, 4.0f);
+	fill_random(origin_x, TEST_TRANSFORMS, 1000.0f);
+	fill_random(origin_y, TEST_TRANSFORMS, 1000.0f);
+	fill_random(rot, TEST_TRANSFORMS, 6.3f);
+	fill_random(pos_x, TEST_TRANSFORMS, 2000.0f);
+	fill_random(pos_y, TEST_TRANSFORMS, 2000.0f);
+
+	/* unrotated transforms take a shortcut */
+	for (size_t i = 0; i < TEST_TRANSFORMS; i += 3)
+		rot[i] = 0.0f;
+
+	for (size_t i = 0; i < TEST_TRANSFORMS; i++)
+		dst[i] = &out[i];
+
+	const struct matrix4_2d_batch batch = {scale_x,  scale_y, origin_x,
+					       origin_y, rot,     pos_x,
+					       pos_y};
+	matrix4_compose_2d_batch(dst, &batch, TEST_TRANSFORMS);
+
+	for (size_t i = 0; i < TEST_TRANSFORMS; i++) {
+		struct matrix4 ref;
+
+		matrix4_identity(&ref);
+		matrix4_scale3f(&ref, &ref, scale_x[i], scale_y[i], 1.0f);
+		matrix4_translate3f(&ref, &ref, -origin_x[i], -origin_y[i],
+				    0.0f);
+		matrix4_rotate_aa4f(&ref, &ref, 0.0f, 0.0f, 1.0f, rot[i]);
+		matrix4_translate3f(&ref, &ref, pos_x[i], pos_y[i], 0.0f);
+
+		const float *ref_f = (const float *)&ref;
+		const float *out_f = (const float *)&out[i];
+
+		for (size_t j = 0; j < 16; j++) {
+			float tolerance = 1e-5f * (fabsf(ref_f[j]) + 1.0f);
+			assert_true(fabsf(ref_f[j] - out_f[j]) <= tolerance);
+		}
+	}
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(compose_2d_batch_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
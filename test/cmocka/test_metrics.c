@@ -0,0 +1,146 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/metrics.h>
+#include <util/dstr.h>
+
+static void metric_bucket_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	metric_t *hist = metric_get(METRIC_HISTOGRAM, "test_hist", NULL, NULL);
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+
+	/* every value must land in a bucket whose range contains it, and the
+	 * bucket maximum may not be off by more than 12.5% */
+	for (uint64_t val = 1; val < (1ULL << 40); val = val * 3 / 2 + 1) {
+		metric_histogram_get_counts(hist, counts);
+		uint64_t before[METRIC_HISTOGRAM_BUCKETS];
+		memcpy(before, counts, sizeof(counts));
+
+		metric_record(hist, val);
+		metric_histogram_get_counts(hist, counts);
+
+		size_t bucket = 0;
+		for (size_t i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+			if (counts[i] != before[i])
+				bucket = i;
+		}
+
+		uint64_t max = metric_histogram_bucket_max(bucket);
+		uint64_t min =
+			bucket ? metric_histogram_bucket_max(bucket - 1) + 1
+			       : 0;
+		assert_true(val >= min && val <= max);
+		assert_true((double)(max - val) <= (double)val * 0.125);
+	}
+
+	for (size_t i = 1; i < METRIC_HISTOGRAM_BUCKETS; i++)
+		assert_true(metric_histogram_bucket_max(i) >
+			    metric_histogram_bucket_max(i - 1));
+
+	metric_release(hist);
+}
+
+static void metric_percentile_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	metric_t *hist = metric_get(METRIC_HISTOGRAM, "test_hist", NULL, NULL);
+	uint64_t counts[METRIC_HISTOGRAM_BUCKETS];
+
+	for (uint64_t i = 1; i <= 1000; i++)
+		metric_record(hist, i * 1000);
+
+	assert_int_equal(metric_histogram_count(hist), 1000);
+	assert_int_equal(metric_histogram_sum(hist), 500500 * 1000);
+
+	metric_histogram_get_counts(hist, counts);
+
+	uint64_t p50 = metric_histogram_percentile(counts, 50.0);
+	uint64_t p99 = metric_histogram_percentile(counts, 99.0);
+	assert_true(p50 >= 500000 && p50 <= 500000 * 9 / 8);
+	assert_true(p99 >= 990000 && p99 <= 990000 * 9 / 8);
+
+	memset(counts, 0, sizeof(counts));
+	assert_int_equal(metric_histogram_percentile(counts, 99.0), 0);
+
+	metric_release(hist);
+}
+
+static void metric_registry_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	metric_t *a = metric_get(METRIC_COUNTER, "test_total", NULL, "help");
+	metric_t *b = metric_get(METRIC_COUNTER, "test_total", NULL, NULL);
+	metric_t *c = metric_get(METRIC_COUNTER, "test_total", "x=\"1\"", NULL);
+
+	assert_ptr_equal(a, b);
+	assert_ptr_not_equal(a, c);
+	assert_null(metric_get(METRIC_GAUGE, "test_total", NULL, NULL));
+
+	metric_add(a, 2);
+	metric_add(b, 3);
+	assert_int_equal(metric_get_value(a), 5);
+	assert_int_equal(metric_get_value(c), 0);
+
+	metric_release(b);
+	assert_int_equal(metric_get_value(a), 5);
+
+	metric_release(a);
+	metric_release(c);
+}
+
+static void metric_prometheus_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct dstr labels = {0};
+	struct dstr out = {0};
+
+	metric_label_cat(&labels, "name", "a\"b\\c");
+	assert_string_equal(labels.array, "name=\"a\\\"b\\\\c\"");
+
+	metric_t *gauge = metric_get(METRIC_GAUGE, "test_gauge", labels.array,
+				     "A gauge");
+	metric_t *hist = metric_get(METRIC_HISTOGRAM, "test_seconds", NULL,
+				    NULL);
+	metric_set(gauge, -4);
+	metric_record(hist, 1000);
+	metric_record(hist, 2000000);
+
+	metrics_write_prometheus(&out);
+
+	const char *gauge_text = "# HELP test_gauge A gauge\n"
+				 "# TYPE test_gauge gauge\n"
+				 "test_gauge{name=\"a\\\"b\\\\c\"} -4\n";
+	const char *bucket_text = "test_seconds_bucket{le=\"1.024e-06\"} 1\n";
+	const char *inf_text = "test_seconds_bucket{le=\"+Inf\"} 2\n";
+
+	assert_non_null(strstr(out.array, gauge_text));
+	assert_non_null(strstr(out.array, "# TYPE test_seconds histogram\n"));
+	assert_non_null(strstr(out.array, bucket_text));
+	assert_non_null(strstr(out.array, inf_text));
+	assert_non_null(strstr(out.array, "test_seconds_count 2\n"));
+
+	metric_release(gauge);
+	metric_release(hist);
+	dstr_free(&labels);
+	dstr_free(&out);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(metric_bucket_test),
+		cmocka_unit_test(metric_percentile_test),
+		cmocka_unit_test(metric_registry_test),
+		cmocka_unit_test(metric_prometheus_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
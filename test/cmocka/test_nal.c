@@ -0,0 +1,97 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <string.h>
+
+#include <obs-nal.h>
+
+static void find_startcode_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t data[64];
+	const uint8_t *end = data + sizeof(data);
+
+	memset(data, 0xAA, sizeof(data));
+	assert_ptr_equal(obs_nal_find_startcode(data, end), end);
+
+	/* 3 byte start code past the first 16 byte block */
+	data[20] = 0;
+	data[21] = 0;
+	data[22] = 1;
+	assert_ptr_equal(obs_nal_find_startcode(data, end), data + 20);
+
+	/* 4 byte start codes include the leading zero */
+	data[19] = 0;
+	assert_ptr_equal(obs_nal_find_startcode(data, end), data + 19);
+
+	/* a start code straddling two blocks */
+	data[15] = 0;
+	data[16] = 0;
+	data[17] = 1;
+	assert_ptr_equal(obs_nal_find_startcode(data, end), data + 15);
+
+	/* start codes at the very end of the data are ignored */
+	memset(data, 0xAA, sizeof(data));
+	data[61] = 0;
+	data[62] = 0;
+	data[63] = 1;
+	assert_ptr_equal(obs_nal_find_startcode(data, end), end);
+
+	data[60] = 0;
+	data[61] = 0;
+	data[62] = 1;
+	data[63] = 0x65;
+	assert_ptr_equal(obs_nal_find_startcode(data, end), data + 60);
+}
+
+static void nal_index_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const uint8_t packet[] = {0, 0, 0, 1, 0x09, 0xF0,   /* AUD */
+				  0, 0, 1,    0x06, 0x05, 0x01, /* SEI */
+				  0, 0, 0, 1, 0x65, 0x88, 0x80, 0x40};
+	struct obs_nal_index index;
+
+	assert_true(obs_nal_index_build(&index, packet, sizeof(packet)));
+	assert_true(obs_nal_index_valid(&index, sizeof(packet)));
+	assert_false(obs_nal_index_valid(&index, sizeof(packet) - 1));
+
+	assert_int_equal(index.num, 3);
+	assert_int_equal(index.units[0].offset, 4);
+	assert_int_equal(index.units[0].size, 2);
+	assert_int_equal(index.units[1].offset, 9);
+	assert_int_equal(index.units[1].size, 3);
+	assert_int_equal(index.units[2].offset, 16);
+	assert_int_equal(index.units[2].size, 4);
+
+	/* too many NAL units for the index */
+	uint8_t many[(OBS_NAL_INDEX_MAX + 1) * 5];
+	for (size_t i = 0; i < OBS_NAL_INDEX_MAX + 1; i++) {
+		uint8_t *nal = many + i * 5;
+		nal[0] = 0;
+		nal[1] = 0;
+		nal[2] = 1;
+		nal[3] = 0x06;
+		nal[4] = 0x80;
+	}
+
+	assert_false(obs_nal_index_build(&index, many, sizeof(many)));
+	assert_false(obs_nal_index_valid(&index, sizeof(many)));
+
+	obs_nal_index_clear(&index);
+	assert_false(obs_nal_index_valid(&index, 0));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(find_startcode_test),
+		cmocka_unit_test(nal_index_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,238 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <obs-nal.h>
+#include <obs-packet-drop.h>
+
+#define GOP_SIZE 12
+#define NUM_GOPS 3
+#define FRAME_USEC 33333
+
+#define KEY_SIZE 100
+#define P_SIZE 30
+#define B_SIZE 10
+#define AUDIO_SIZE 5
+
+/* three GOPs of I P B B P B B P B B P B in decode order, each frame followed
+ * by an audio packet; the last GOP is still open */
+static void fill_queue(struct deque *packets)
+{
+	int64_t dts = 0;
+
+	for (int gop = 0; gop < NUM_GOPS; gop++) {
+		for (int i = 0; i < GOP_SIZE; i++) {
+			struct encoder_packet video = {0};
+			struct encoder_packet audio = {0};
+
+			video.type = OBS_ENCODER_VIDEO;
+			video.dts_usec = dts;
+			if (i == 0) {
+				video.keyframe = true;
+				video.drop_priority = OBS_NAL_PRIORITY_HIGHEST;
+				video.size = KEY_SIZE;
+			} else if (i % 3 == 1) {
+				video.drop_priority = OBS_NAL_PRIORITY_HIGH;
+				video.size = P_SIZE;
+			} else {
+				video.drop_priority =
+					OBS_NAL_PRIORITY_DISPOSABLE;
+				video.size = B_SIZE;
+			}
+
+			audio.type = OBS_ENCODER_AUDIO;
+			audio.dts_usec = dts;
+			audio.size = AUDIO_SIZE;
+
+			deque_push_back(packets, &video, sizeof(video));
+			deque_push_back(packets, &audio, sizeof(audio));
+			dts += FRAME_USEC;
+		}
+	}
+}
+
+struct queue_count {
+	int audio;
+	int key;
+	int p[NUM_GOPS];
+	int b;
+};
+
+static void count_queue(struct deque *packets, struct queue_count *count)
+{
+	size_t num = packets->size / sizeof(struct encoder_packet);
+	int gop = -1;
+
+	memset(count, 0, sizeof(*count));
+
+	for (size_t i = 0; i < num; i++) {
+		struct encoder_packet *packet =
+			deque_data(packets, i * sizeof(*packet));
+
+		if (packet->type == OBS_ENCODER_AUDIO) {
+			count->audio++;
+		} else if (packet->keyframe) {
+			count->key++;
+			gop++;
+		} else if (packet->size == P_SIZE) {
+			count->p[gop]++;
+		} else {
+			count->b++;
+		}
+	}
+}
+
+static void disposable_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque packets = {0};
+	struct queue_count count;
+	int min_priority = 0;
+	size_t dropped;
+
+	fill_queue(&packets);
+
+	/* a small overshoot only costs a few b-frames */
+	dropped = obs_packet_queue_drop(&packets, 1000, 970, true,
+					&min_priority);
+	count_queue(&packets, &count);
+
+	assert_int_equal(dropped, 4);
+	assert_int_equal(count.b, 3 * 7 - 4);
+	assert_int_equal(count.p[0] + count.p[1] + count.p[2], 3 * 4);
+	assert_int_equal(count.key, NUM_GOPS);
+	assert_int_equal(count.audio, NUM_GOPS * GOP_SIZE);
+	assert_int_equal(min_priority, 0);
+
+	deque_free(&packets);
+}
+
+static void no_ref_frames_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque packets = {0};
+	struct queue_count count;
+	int min_priority = 0;
+	size_t dropped;
+
+	fill_queue(&packets);
+
+	/* without ref_frames nothing above the b-frames may be dropped */
+	dropped = obs_packet_queue_drop(&packets, 1000, 100, false,
+					&min_priority);
+	count_queue(&packets, &count);
+
+	assert_int_equal(dropped, 3 * 7);
+	assert_int_equal(count.b, 0);
+	assert_int_equal(count.p[0] + count.p[1] + count.p[2], 3 * 4);
+	assert_int_equal(count.key, NUM_GOPS);
+	assert_int_equal(min_priority, OBS_NAL_PRIORITY_HIGH);
+
+	deque_free(&packets);
+}
+
+static void gop_tail_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque packets = {0};
+	struct queue_count count;
+	int min_priority = 0;
+	size_t dropped;
+
+	fill_queue(&packets);
+
+	/* the b-frames are not enough, so the end of each complete GOP is
+	 * cut, and the open GOP at the end is left alone */
+	dropped = obs_packet_queue_drop(&packets, 1000, 700, true,
+					&min_priority);
+	count_queue(&packets, &count);
+
+	assert_int_equal(dropped, 3 * 7 + 2 * 2);
+	assert_int_equal(count.b, 0);
+	assert_int_equal(count.p[0], 2);
+	assert_int_equal(count.p[1], 2);
+	assert_int_equal(count.p[2], 4);
+	assert_int_equal(count.key, NUM_GOPS);
+	assert_int_equal(count.audio, NUM_GOPS * GOP_SIZE);
+	assert_int_equal(min_priority, OBS_NAL_PRIORITY_HIGH);
+
+	deque_free(&packets);
+}
+
+static void fallback_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque packets = {0};
+	struct queue_count count;
+	int min_priority = 0;
+
+	fill_queue(&packets);
+
+	/* if nothing else helps, only keyframes and audio are left */
+	obs_packet_queue_drop(&packets, 1000, 100, true, &min_priority);
+	count_queue(&packets, &count);
+
+	assert_int_equal(count.b, 0);
+	assert_int_equal(count.p[0] + count.p[1] + count.p[2], 0);
+	assert_int_equal(count.key, NUM_GOPS);
+	assert_int_equal(count.audio, NUM_GOPS * GOP_SIZE);
+	assert_int_equal(min_priority, OBS_NAL_PRIORITY_HIGHEST);
+
+	deque_free(&packets);
+}
+
+static void first_video_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct deque packets = {0};
+	struct encoder_packet first;
+
+	assert_false(obs_packet_queue_first_video(&packets, &first));
+
+	/* keyframes and audio are skipped */
+	fill_queue(&packets);
+	assert_true(obs_packet_queue_first_video(&packets, &first));
+	assert_int_equal(first.type, OBS_ENCODER_VIDEO);
+	assert_false(first.keyframe);
+	assert_int_equal(first.dts_usec, FRAME_USEC);
+
+	deque_free(&packets);
+}
+
+static void drop_held_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* packets from after the drop are at the front */
+	assert_false(obs_packet_queue_drop_held(1100, 2200, 1000, 1000));
+
+	/* still sending packets from before the drop */
+	assert_true(obs_packet_queue_drop_held(900, 2000, 1000, 1000));
+
+	/* the buffer grew well past the threshold */
+	assert_false(obs_packet_queue_drop_held(400, 2000, 1000, 1000));
+
+	/* the wait took longer than the threshold */
+	assert_false(obs_packet_queue_drop_held(900, 2100, 1000, 1000));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(disposable_test),
+		cmocka_unit_test(no_ref_frames_test),
+		cmocka_unit_test(gop_tail_test),
+		cmocka_unit_test(fallback_test),
+		cmocka_unit_test(first_video_test),
+		cmocka_unit_test(drop_held_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,110 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/metrics.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define TEST_LABELS "mutex=\"test_mutex\""
+
+static void mutex_unprofiled_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_mutex_t mutex;
+
+	os_mutex_profiling_set_enabled(false);
+	assert_int_equal(os_mutex_init(&mutex, "test_mutex"), 0);
+	assert_null(mutex.profile);
+
+	assert_int_equal(os_mutex_lock(&mutex), 0);
+	assert_int_equal(os_mutex_unlock(&mutex), 0);
+	os_mutex_destroy(&mutex);
+}
+
+static void mutex_profile_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_mutex_t mutex;
+
+	os_mutex_profiling_set_enabled(true);
+	assert_int_equal(os_mutex_init_recursive(&mutex, "test_mutex"), 0);
+	assert_non_null(mutex.profile);
+
+	metric_t *locks = metric_get(METRIC_COUNTER, "obs_mutex_locks_total",
+				     TEST_LABELS, NULL);
+	metric_t *hold = metric_get(METRIC_HISTOGRAM, "obs_mutex_hold_seconds",
+				    TEST_LABELS, NULL);
+	metric_t *wait = metric_get(METRIC_HISTOGRAM, "obs_mutex_wait_seconds",
+				    TEST_LABELS, NULL);
+
+	/* a recursive lock is only held once */
+	os_mutex_lock(&mutex);
+	os_mutex_lock(&mutex);
+	os_mutex_unlock(&mutex);
+	os_mutex_unlock(&mutex);
+
+	assert_int_equal(os_mutex_trylock(&mutex), 0);
+	os_mutex_unlock(&mutex);
+
+	assert_int_equal(metric_get_value(locks), 3);
+	assert_int_equal(metric_histogram_count(hold), 2);
+	assert_int_equal(metric_histogram_count(wait), 0);
+
+	os_mutex_destroy(&mutex);
+	metric_release(locks);
+	metric_release(hold);
+	metric_release(wait);
+	os_mutex_profiling_set_enabled(false);
+}
+
+static void *lock_thread(void *data)
+{
+	os_mutex_t *mutex = data;
+
+	os_mutex_lock(mutex);
+	os_mutex_unlock(mutex);
+	return NULL;
+}
+
+static void mutex_wait_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_mutex_t mutex;
+	pthread_t thread;
+
+	os_mutex_profiling_set_enabled(true);
+	assert_int_equal(os_mutex_init(&mutex, "test_mutex"), 0);
+
+	metric_t *wait = metric_get(METRIC_HISTOGRAM, "obs_mutex_wait_seconds",
+				    TEST_LABELS, NULL);
+
+	os_mutex_lock(&mutex);
+	assert_int_equal(pthread_create(&thread, NULL, lock_thread, &mutex),
+			 0);
+	os_sleep_ms(50);
+	os_mutex_unlock(&mutex);
+	pthread_join(thread, NULL);
+
+	assert_int_equal(metric_histogram_count(wait), 1);
+	assert_true(metric_histogram_sum(wait) >= 10000000);
+
+	os_mutex_destroy(&mutex);
+	metric_release(wait);
+	os_mutex_profiling_set_enabled(false);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(mutex_unprofiled_test),
+		cmocka_unit_test(mutex_profile_test),
+		cmocka_unit_test(mutex_wait_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -11,6 +11,7 @@ target_sources(
           sync-audio-buffering.c
           sync-pair-vid.c
           sync-pair-aud.c
+          test-latency.c
           test-random.c)
 
 target_link_libraries(test-input PRIVATE OBS::libobs)
@@ -9,6 +9,7 @@ extern struct obs_source_info async_sync_test;
 extern struct obs_source_info buffering_async_sync_test;
 extern struct obs_source_info sync_video;
 extern struct obs_source_info sync_audio;
+extern struct obs_source_info latency_test;
 
 bool obs_module_load(void)
 {
@@ -19,5 +20,6 @@ bool obs_module_load(void)
 	obs_register_source(&buffering_async_sync_test);
 	obs_register_source(&sync_video);
 	obs_register_source(&sync_audio);
+	obs_register_source(&latency_test);
 	return true;
 }
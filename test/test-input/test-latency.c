@@ -0,0 +1,143 @@
+#include <util/threading.h>
+#include <util/platform.h>
+#include <util/util_uint64.h>
+#include <obs.h>
+
+/* Frames of this source are latency probes, see
+ * obs_source_set_latency_probe.  Each frame also shows its frame counter and
+ * the low 32 bits of its capture time in microseconds, as rows of white (1)
+ * and black (0) blocks from the most significant bit, so that the latency
+ * can also be read back from a recording or the other end of a stream. */
+
+#define BLOCK_SIZE 8
+#define WIDTH (32 * BLOCK_SIZE)
+#define HEIGHT (2 * BLOCK_SIZE)
+
+struct latency_test {
+	obs_source_t *source;
+	os_event_t *stop_signal;
+	pthread_t thread;
+	bool initialized;
+};
+
+static const char *latency_test_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Latency Test (Async Video Source)";
+}
+
+static void latency_test_destroy(void *data)
+{
+	struct latency_test *lt = data;
+
+	if (lt->initialized) {
+		os_event_signal(lt->stop_signal);
+		pthread_join(lt->thread, NULL);
+	}
+
+	obs_source_set_latency_probe(lt->source, false);
+	os_event_destroy(lt->stop_signal);
+	bfree(lt);
+}
+
+static void draw_bits(uint32_t *pixels, size_t row, uint32_t val)
+{
+	for (size_t y = row * BLOCK_SIZE; y < (row + 1) * BLOCK_SIZE; y++) {
+		for (size_t x = 0; x < WIDTH; x++) {
+			bool bit = (val >> (31 - x / BLOCK_SIZE)) & 1;
+			pixels[y * WIDTH + x] = bit ? 0xFFFFFFFF : 0xFF000000;
+		}
+	}
+}
+
+static void *video_thread(void *data)
+{
+	struct latency_test *lt = data;
+	struct obs_video_info ovi = {0};
+	uint32_t *pixels = bmalloc(WIDTH * HEIGHT * sizeof(uint32_t));
+	uint64_t interval = 1000000000 / 30;
+	uint64_t cur_time = os_gettime_ns();
+	uint32_t counter = 0;
+
+	struct obs_source_frame frame = {
+		.data = {[0] = (uint8_t *)pixels},
+		.linesize = {[0] = WIDTH * 4},
+		.width = WIDTH,
+		.height = HEIGHT,
+		.format = VIDEO_FORMAT_BGRX,
+	};
+
+	os_set_thread_name("latency-test: video thread");
+
+	if (obs_get_video_info(&ovi) && ovi.fps_num)
+		interval = util_mul_div64(1000000000ULL, ovi.fps_den,
+					  ovi.fps_num);
+
+	while (os_event_try(lt->stop_signal) == EAGAIN) {
+		frame.timestamp = os_gettime_ns();
+
+		draw_bits(pixels, 0, counter++);
+		draw_bits(pixels, 1, (uint32_t)(frame.timestamp / 1000));
+
+		obs_source_output_video(lt->source, &frame);
+
+		os_sleepto_ns(cur_time += interval);
+	}
+
+	bfree(pixels);
+	return NULL;
+}
+
+static void *latency_test_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct latency_test *lt = bzalloc(sizeof(struct latency_test));
+	lt->source = source;
+
+	obs_source_set_async_unbuffered(source,
+					obs_data_get_bool(settings,
+							  "unbuffered"));
+	obs_source_set_latency_probe(source, true);
+
+	if (os_event_init(&lt->stop_signal, OS_EVENT_TYPE_MANUAL) != 0) {
+		latency_test_destroy(lt);
+		return NULL;
+	}
+
+	if (pthread_create(&lt->thread, NULL, video_thread, lt) != 0) {
+		latency_test_destroy(lt);
+		return NULL;
+	}
+
+	lt->initialized = true;
+	return lt;
+}
+
+static void latency_test_update(void *data, obs_data_t *settings)
+{
+	struct latency_test *lt = data;
+
+	obs_source_set_async_unbuffered(lt->source,
+					obs_data_get_bool(settings,
+							  "unbuffered"));
+}
+
+static obs_properties_t *latency_test_properties(void *unused)
+{
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_bool(props, "unbuffered", "Unbuffered");
+
+	UNUSED_PARAMETER(unused);
+	return props;
+}
+
+struct obs_source_info latency_test = {
+	.id = "latency_test",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO,
+	.get_name = latency_test_getname,
+	.create = latency_test_create,
+	.destroy = latency_test_destroy,
+	.update = latency_test_update,
+	.get_properties = latency_test_properties,
+};